@@ -132,6 +132,32 @@ static inline uint32_t div128_32(uint64_t dividend_hi, uint64_t dividend_lo, uin
 // Long divisor with 2^64 base
 void div128_64(uint64_t dividend_hi, uint64_t dividend_lo, uint64_t divisor, uint64_t* quotient_hi, uint64_t *quotient_lo, uint64_t *remainder_hi, uint64_t *remainder_lo);
 
+// multiplier * multiplicand / divisor, rounded down, with a 128 bit intermediate product
+// returns the low 64 bits of the quotient, and sets *overflow (if not NULL) when it does not fit
+// in 64 bits - divisor must not be 0
+static inline uint64_t mul_div64(uint64_t multiplier, uint64_t multiplicand, uint64_t divisor, bool* overflow) {
+  assert(divisor != 0);
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 quotient = (unsigned __int128)multiplier * multiplicand / divisor;
+  if (overflow)
+    *overflow = (quotient >> 64) != 0;
+  return (uint64_t)quotient;
+#else
+  uint64_t product_hi, quotient_hi, quotient_lo;
+  const uint64_t product_lo = mul128(multiplier, multiplicand, &product_hi);
+  if (product_hi == 0)
+  {
+    if (overflow)
+      *overflow = false;
+    return product_lo / divisor;
+  }
+  div128_64(product_hi, product_lo, divisor, &quotient_hi, &quotient_lo, NULL, NULL);
+  if (overflow)
+    *overflow = quotient_hi != 0;
+  return quotient_lo;
+#endif
+}
+
 static inline void add64clamp(uint64_t *value, uint64_t add)
 {
   static const uint64_t maxval = (uint64_t)-1;
@@ -43,16 +43,16 @@ namespace epee
     static size_t get_page_size();
     static size_t get_num_locked_pages();
     static size_t get_num_locked_objects();
+    //! Pages no object uses any more, kept locked on their thread's stack for reuse
+    static size_t get_num_retained_pages();
 
     static void lock(void *ptr, size_t len);
     static void unlock(void *ptr, size_t len);
 
-  private:
-    static size_t page_size;
-    static size_t num_locked_objects;
+    //! Unlocks the calling thread's retained stack pages, done automatically at thread exit
+    static void release_retained_pages();
 
-    static boost::mutex &mutex();
-    static std::map<size_t, unsigned int> &map();
+  private:
     static void lock_page(size_t page);
     static void unlock_page(size_t page);
 
@@ -266,6 +266,7 @@ namespace net_utils
     std::string m_host{};
     state_t m_state{};
     t_protocol_handler m_handler;
+    std::shared_ptr<std::atomic<std::size_t>> m_io_loop_connections{};
   public:
     struct shared_state : connection_basic_shared_state, t_protocol_handler::config_type
     {
@@ -316,6 +317,9 @@ namespace net_utils
 		bool speed_limit_is_enabled() const; ///< tells us should we be sleeping here (e.g. do not sleep on RPC connections)
 
     bool cancel();
+
+    /// Count this connection in the live connections of its io loop until it is destroyed.
+    void track_io_loop(std::shared_ptr<std::atomic<std::size_t>> counter);
     
   private:
     //----------------- i_service_endpoint ---------------------
@@ -386,6 +390,18 @@ namespace net_utils
 
     size_t get_threads_count(){return m_threads_count;}
 
+    /// Run incoming connections on `count` independent io_contexts, each on its own thread, instead
+    /// of on the shared one. Must be called before init_server; 0 or 1 keeps the shared io_context.
+    bool set_io_loops(size_t count);
+
+    struct io_loop_stats
+    {
+      std::size_t connections; // live connections on the loop
+      std::uint64_t accepted;  // connections handed to the loop so far
+    };
+    /// One entry per io loop, empty when the shared io_context is used.
+    std::vector<io_loop_stats> get_io_loop_stats() const;
+
     void set_connection_filter(i_connection_filter* pfilter);
     void set_connection_limit(i_connection_limit* plimit);
     void set_response_soft_limit(std::size_t limit);
@@ -512,6 +528,28 @@ namespace net_utils
     std::unique_ptr<worker> m_io_context_local_instance;
     boost::asio::io_context& io_context_;    
 
+    /// Dedicated io_contexts for incoming connections, see set_io_loops. Acceptors, timers,
+    /// idle handlers and outgoing connections stay on io_context_.
+    struct io_loop : worker
+    {
+      io_loop()
+        : worker(), connections(std::make_shared<std::atomic<std::size_t>>(0)), accepted(0)
+      {}
+
+      std::shared_ptr<std::atomic<std::size_t>> connections;
+      std::atomic<std::uint64_t> accepted;
+    };
+    std::vector<std::unique_ptr<io_loop>> m_io_loops;
+    std::vector<boost::shared_ptr<boost::thread> > m_io_loop_threads;
+
+    /// The io_context the next incoming connection is created on: the least loaded io loop.
+    boost::asio::io_context& pick_io_context();
+    /// Account an accepted connection to the io loop it runs on.
+    void attach_to_io_loop(connection<t_protocol_handler>& conn);
+    bool io_loop_thread(io_loop& loop, uint32_t index);
+    //! \return the epee::thread_placement group the server's threads join
+    std::string thread_group_name() const;
+
     /// Acceptor used to listen for incoming connections.
     boost::asio::ip::tcp::acceptor acceptor_;
     boost::asio::ip::tcp::acceptor acceptor_ipv6;
@@ -45,10 +45,12 @@
 #include "warnings.h"
 #include "string_tools_lexical.h"
 #include "misc_language.h"
+#include "thread_placement.h"
 
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <cctype>
 #include <functional>
 #include <random>
 
@@ -283,6 +285,7 @@ namespace net_utils
         state_status_check();
       }
       else if (ec.value()) {
+        count_ssl_handshake(connection_basic::socket_.native_handle(), false);
         ec_t ec;
         connection_basic::socket_.next_layer().shutdown(
           socket_t::shutdown_both,
@@ -293,6 +296,7 @@ namespace net_utils
         interrupt();
       }
       else {
+        count_ssl_handshake(connection_basic::socket_.native_handle(), true);
         m_state.ssl.handshaked = true;
         start_write();
         start_read();
@@ -1010,6 +1014,8 @@ namespace net_utils
       m_state.status == status_t::WASTED ||
       m_io_context.stopped()
     );
+    if (m_io_loop_connections)
+      --*m_io_loop_connections;
     if (m_state.status != status_t::WASTED)
       return;
     try { host_count(-1); } catch (...) { /* ignore */ }
@@ -1133,6 +1139,15 @@ namespace net_utils
     return m_io_context;
   }
 
+  template<typename T>
+  void connection<T>::track_io_loop(std::shared_ptr<std::atomic<std::size_t>> counter)
+  {
+    if (m_io_loop_connections)
+      return;
+    m_io_loop_connections = std::move(counter);
+    ++*m_io_loop_connections;
+  }
+
   template<typename T>
   bool connection<T>::add_ref()
   {
@@ -1253,7 +1268,7 @@ namespace net_utils
       boost::asio::ip::tcp::endpoint binded_endpoint = acceptor_.local_endpoint();
       m_port = binded_endpoint.port();
       MDEBUG("start accept (IPv4)");
-      new_connection_.reset(new connection<t_protocol_handler>(io_context_, m_state, m_connection_type, m_state->ssl_options().support));
+      new_connection_.reset(new connection<t_protocol_handler>(pick_io_context(), m_state, m_connection_type, m_state->ssl_options().support));
       acceptor_.async_accept(new_connection_->socket(),
             boost::bind(&boosted_tcp_server<t_protocol_handler>::handle_accept_ipv4, this,
               boost::asio::placeholders::error));
@@ -1292,7 +1307,7 @@ namespace net_utils
         boost::asio::ip::tcp::endpoint binded_endpoint = acceptor_ipv6.local_endpoint();
         m_port_ipv6 = binded_endpoint.port();
         MDEBUG("start accept (IPv6)");
-        new_connection_ipv6.reset(new connection<t_protocol_handler>(io_context_, m_state, m_connection_type, m_state->ssl_options().support));
+        new_connection_ipv6.reset(new connection<t_protocol_handler>(pick_io_context(), m_state, m_connection_type, m_state->ssl_options().support));
         acceptor_ipv6.async_accept(new_connection_ipv6->socket(),
           boost::bind(&boosted_tcp_server<t_protocol_handler>::handle_accept_ipv6, this,
           boost::asio::placeholders::error));
@@ -1355,6 +1370,7 @@ namespace net_utils
     thread_name += boost::to_string(local_thr_index) + "]";
     MLOG_SET_THREAD_NAME(thread_name);
     //   _fact("Thread name: " << m_thread_name_prefix);
+    const epee::thread_placement::member placement(thread_group_name());
     while(!m_stop_signal_sent)
     {
       try
@@ -1377,6 +1393,97 @@ namespace net_utils
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  bool boosted_tcp_server<t_protocol_handler>::io_loop_thread(io_loop& loop, uint32_t index)
+  {
+    TRY_ENTRY();
+    MLOG_SET_THREAD_NAME(std::string("[") + m_thread_name_prefix + "_L" + boost::to_string(index) + "]");
+    const epee::thread_placement::member placement(thread_group_name());
+    while(!m_stop_signal_sent)
+    {
+      try
+      {
+        loop.io_context.run();
+        return true;
+      }
+      catch(const std::exception& ex)
+      {
+        _erro("Exception at server io loop thread, what=" << ex.what());
+      }
+      catch(...)
+      {
+        _erro("Exception at server io loop thread, unknown execption");
+      }
+    }
+    return true;
+    CATCH_ENTRY_L0("boosted_tcp_server<t_protocol_handler>::io_loop_thread", false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool boosted_tcp_server<t_protocol_handler>::set_io_loops(size_t count)
+  {
+    CRITICAL_REGION_LOCAL(m_threads_lock);
+    if (new_connection_ || new_connection_ipv6 || !m_threads.empty())
+    {
+      MERROR("io loops must be set before the server is initialized");
+      return false;
+    }
+    m_io_loops.clear();
+    if (count < 2)
+      return true;
+    for (size_t i = 0; i < count; ++i)
+      m_io_loops.emplace_back(new io_loop());
+    MINFO("Incoming " << m_thread_name_prefix << " connections will run on " << count << " io loops");
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  std::vector<typename boosted_tcp_server<t_protocol_handler>::io_loop_stats> boosted_tcp_server<t_protocol_handler>::get_io_loop_stats() const
+  {
+    std::vector<io_loop_stats> stats;
+    stats.reserve(m_io_loops.size());
+    for (const auto& loop: m_io_loops)
+      stats.push_back({loop->connections->load(), loop->accepted.load()});
+    return stats;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  boost::asio::io_context& boosted_tcp_server<t_protocol_handler>::pick_io_context()
+  {
+    if (m_io_loops.empty())
+      return io_context_;
+    // accepts are handled on io_context_ one at a time, so picking needs no lock
+    io_loop* best = m_io_loops.front().get();
+    for (const auto& loop: m_io_loops)
+      if (loop->connections->load() < best->connections->load())
+        best = loop.get();
+    return best->io_context;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void boosted_tcp_server<t_protocol_handler>::attach_to_io_loop(connection<t_protocol_handler>& conn)
+  {
+    boost::asio::io_context& io_context = static_cast<i_service_endpoint&>(conn).get_io_context();
+    for (const auto& loop: m_io_loops)
+    {
+      if (&loop->io_context == &io_context)
+      {
+        ++loop->accepted;
+        conn.track_io_loop(loop->connections);
+        return;
+      }
+    }
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  std::string boosted_tcp_server<t_protocol_handler>::thread_group_name() const
+  {
+    // the placement groups are named after the thread prefix, eg. "p2p" or "rpc"
+    std::string name = m_thread_name_prefix;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    return name;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   void boosted_tcp_server<t_protocol_handler>::set_threads_prefix(const std::string& prefix_name)
   {
     m_thread_name_prefix = prefix_name;
@@ -1419,6 +1526,12 @@ namespace net_utils
 
       // Create a pool of threads to run all of the io_contexts.
       CRITICAL_REGION_BEGIN(m_threads_lock);
+      // one thread per io loop, those are only joined once stopping, they survive a restart
+      for (std::size_t i = m_io_loop_threads.size(); i < m_io_loops.size(); ++i)
+      {
+        m_io_loop_threads.emplace_back(new boost::thread(
+          attrs, boost::bind(&boosted_tcp_server<t_protocol_handler>::io_loop_thread, this, std::ref(*m_io_loops[i]), uint32_t(i))));
+      }
       for (std::size_t i = 0; i < threads_count; ++i)
       {
         boost::shared_ptr<boost::thread> thread(new boost::thread(
@@ -1436,6 +1549,12 @@ namespace net_utils
          }
          _fact("JOINING all threads - almost");
         m_threads.clear();
+        if (m_stop_signal_sent)
+        {
+          for (auto& thread: m_io_loop_threads)
+            thread->join();
+          m_io_loop_threads.clear();
+        }
         _fact("JOINING all threads - DONE");
 
       } 
@@ -1472,6 +1591,11 @@ namespace net_utils
       if(thp->get_id() == boost::this_thread::get_id())
         return true;
     }
+    BOOST_FOREACH(boost::shared_ptr<boost::thread>& thp,  m_io_loop_threads)
+    {
+      if(thp->get_id() == boost::this_thread::get_id())
+        return true;
+    }
     if(m_threads_count == 1 && boost::this_thread::get_id() == m_main_thread_id)
       return true;
     return false;
@@ -1491,6 +1615,14 @@ namespace net_utils
         m_threads[i]->interrupt();
       }
     }
+    for (std::size_t i = 0; i < m_io_loop_threads.size(); ++i)
+    {
+      if(m_io_loop_threads[i]->joinable() && !m_io_loop_threads[i]->try_join_for(ms))
+      {
+        _dbg1("Interrupting thread " << m_io_loop_threads[i]->native_handle());
+        m_io_loop_threads[i]->interrupt();
+      }
+    }
     return true;
     CATCH_ENTRY_L0("boosted_tcp_server<t_protocol_handler>::timed_wait_server_stop", false);
   }
@@ -1510,6 +1642,8 @@ namespace net_utils
     connections_.clear();
     connections_mutex.unlock();
     io_context_.stop();
+    for (auto& loop: m_io_loops)
+      loop->io_context.stop();
     CATCH_ENTRY_L0("boosted_tcp_server<t_protocol_handler>::send_stop_signal()", void());
   }
   //---------------------------------------------------------------------------------
@@ -1556,7 +1690,8 @@ namespace net_utils
         (*current_new_connection)->setRpcStation(); // hopefully this is not needed actually
       }
       connection_ptr conn(std::move((*current_new_connection)));
-      (*current_new_connection).reset(new connection<t_protocol_handler>(io_context_, m_state, m_connection_type, conn->get_ssl_support()));
+      attach_to_io_loop(*conn);
+      (*current_new_connection).reset(new connection<t_protocol_handler>(pick_io_context(), m_state, m_connection_type, conn->get_ssl_support()));
       current_acceptor->async_accept((*current_new_connection)->socket(),
           boost::bind(accept_function_pointer, this,
             boost::asio::placeholders::error));
@@ -1591,7 +1726,7 @@ namespace net_utils
     assert(m_state != nullptr); // always set in constructor
     _erro("Some problems at accept: " << e.message() << ", connections_count = " << m_state->sock_count);
     misc_utils::sleep_no_w(100);
-    (*current_new_connection).reset(new connection<t_protocol_handler>(io_context_, m_state, m_connection_type, (*current_new_connection)->get_ssl_support()));
+    (*current_new_connection).reset(new connection<t_protocol_handler>(pick_io_context(), m_state, m_connection_type, (*current_new_connection)->get_ssl_support()));
     current_acceptor->async_accept((*current_new_connection)->socket(),
         boost::bind(accept_function_pointer, this,
           boost::asio::placeholders::error));
@@ -40,6 +40,7 @@
 #define HTTP_MAX_URI_LEN		 9000 
 #define HTTP_MAX_HEADER_LEN		 100000
 #define HTTP_MAX_STARTING_NEWLINES       8
+#define HTTP_SEPARATE_BODY_MIN_SIZE      (64 * 1024)
 
 namespace epee
 {
@@ -638,10 +639,16 @@ namespace net_utils
 
 		LOG_PRINT_L3("HTTP_RESPONSE_HEAD: << \r\n" << response_data);
 
-		if ((response.m_body.size() && (query_info.m_http_method != http::http_method_head)) || (query_info.m_http_method == http::http_method_options))
+		// large bodies are handed over as their own slice rather than appended to
+		// the header, which would need a second copy of the whole body
+		const bool send_body = response.m_body.size() && query_info.m_http_method != http::http_method_head;
+		const bool separate_body = send_body && response.m_body.size() > HTTP_SEPARATE_BODY_MIN_SIZE;
+		if (send_body && !separate_body)
 			response_data += response.m_body;
 
 		m_psnd_hndlr->do_send(byte_slice{std::move(response_data)});
+		if (separate_body)
+			m_psnd_hndlr->do_send(byte_slice{std::move(response.m_body)});
 		m_psnd_hndlr->send_done();
 		return res;
 	}
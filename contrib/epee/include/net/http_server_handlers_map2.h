@@ -26,14 +26,155 @@
 
 
 #pragma once 
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
 #include "http_base.h"
 #include "jsonrpc_structs.h"
 #include "storages/portable_storage.h"
 #include "storages/portable_storage_template_helper.h"
+#include "storages/portable_storage_to_json.h"
+#include "storages/parserse_base_utils.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "net.http"
 
+namespace epee
+{
+namespace json_rpc
+{
+  //! Most calls accepted in one JSON-RPC batch
+  constexpr const std::size_t max_batch_size = 100;
+
+  //! \return True if `body` is a JSON array, ie a JSON-RPC 2.0 batch
+  inline bool is_batch(const std::string& body) noexcept
+  {
+    for (const char c: body)
+    {
+      if (c == '[')
+        return true;
+      if (!misc_utils::parse::isspace(c))
+        return false;
+    }
+    return false;
+  }
+
+  inline void store_batch_error(net_utils::http::http_response_info& response_info, int code, const std::string& message)
+  {
+    error_response rsp;
+    rsp.jsonrpc = "2.0";
+    rsp.error.code = code;
+    rsp.error.message = message;
+    serialization::store_t_to_json(rsp, response_info.m_body);
+  }
+
+  /*! SAX handler finding the calls of a batch: the byte range of each object
+      in the top level array, or an empty range for any other value, which is
+      not a call. Stops once there are more than `max_batch_size`. */
+  struct batch_splitter : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, batch_splitter>
+  {
+    explicit batch_splitter(const rapidjson::MemoryStream& stream) noexcept
+      : stream(stream), depth(0), start(0)
+    {}
+
+    bool Default()
+    {
+      if (depth == 1)
+        calls.emplace_back(0, 0);
+      return calls.size() <= max_batch_size;
+    }
+    bool StartObject()
+    {
+      if (depth++ == 1)
+        start = stream.Tell() - 1; // the '{' was taken already
+      return true;
+    }
+    bool EndObject(rapidjson::SizeType)
+    {
+      if (--depth == 1)
+        calls.emplace_back(start, stream.Tell());
+      return calls.size() <= max_batch_size;
+    }
+    bool StartArray()
+    {
+      if (depth == 1)
+        calls.emplace_back(0, 0);
+      ++depth;
+      return calls.size() <= max_batch_size;
+    }
+    bool EndArray(rapidjson::SizeType)
+    {
+      --depth;
+      return true;
+    }
+
+    const rapidjson::MemoryStream& stream;
+    std::size_t depth;
+    std::size_t start;
+    std::vector<std::pair<std::size_t, std::size_t>> calls;
+  };
+
+  /*! Runs each call of a JSON-RPC batch through `handle_call` as a request of
+      its own, so limits and payment apply per call, and returns the responses
+      as an array in request order. An entry which is not an object gets an
+      "Invalid Request" error, and a call refused without a body (eg by
+      admission control) an error carrying the HTTP comment. */
+  template<typename F>
+  bool handle_batch(const net_utils::http::http_request_info& query_info, net_utils::http::http_response_info& response_info, F handle_call)
+  {
+    response_info.m_mime_tipe = "application/json";
+    response_info.m_header_info.m_content_type = " application/json";
+
+    rapidjson::MemoryStream stream(query_info.m_body.data(), query_info.m_body.size());
+    batch_splitter splitter(stream);
+    rapidjson::Reader reader;
+    const rapidjson::ParseResult result = reader.Parse<rapidjson::kParseIterativeFlag>(stream, splitter);
+    if (splitter.calls.size() > max_batch_size)
+    {
+      store_batch_error(response_info, -32600, "Too many calls in batch");
+      return true;
+    }
+    if (!result || stream.Tell() != query_info.m_body.size())
+    {
+      store_batch_error(response_info, -32700, "Parse error");
+      return true;
+    }
+    if (splitter.calls.empty())
+    {
+      store_batch_error(response_info, -32600, "Invalid Request");
+      return true;
+    }
+
+    net_utils::http::http_request_info call_query;
+    call_query.m_http_method = query_info.m_http_method;
+    call_query.m_http_method_str = query_info.m_http_method_str;
+    call_query.m_URI = query_info.m_URI;
+    call_query.m_header_info = query_info.m_header_info;
+    call_query.m_uri_content = query_info.m_uri_content;
+
+    std::string body = "[";
+    for (const auto& call: splitter.calls)
+    {
+      net_utils::http::http_response_info call_response{};
+      if (call.first == call.second)
+        store_batch_error(call_response, -32600, "Invalid Request");
+      else
+      {
+        call_query.m_body = query_info.m_body.substr(call.first, call.second - call.first);
+        handle_call(call_query, call_response);
+      }
+      if (call_response.m_body.empty())
+        store_batch_error(call_response, -32000, call_response.m_response_comment.empty() ? "Server error" : call_response.m_response_comment);
+      if (body.size() > 1)
+        body += ',';
+      body += call_response.m_body;
+    }
+    body += ']';
+    response_info.m_body = std::move(body);
+    return true;
+  }
+}
+}
+
 
 #define CHAIN_HTTP_TO_MAP2(context_type) bool handle_http_request(const epee::net_utils::http::http_request_info& query_info, \
               epee::net_utils::http::http_response_info& response, \
@@ -133,7 +274,9 @@
       epee::byte_slice buffer; \
       epee::serialization::store_t_to_binary(static_cast<command_type::response&>(resp), buffer, 64 * 1024); \
       uint64_t ticks3 = epee::misc_utils::get_tick_count(); \
+      static_cast<command_type::response&>(resp) = command_type::response{}; /* release it before the body copy */ \
       response_info.m_body.assign(reinterpret_cast<const char*>(buffer.data()), buffer.size()); \
+      buffer = nullptr; \
       response_info.m_mime_tipe = " application/octet-stream"; \
       response_info.m_header_info.m_content_type = " application/octet-stream"; \
       MDEBUG( s_pattern << "() processed with " << ticks1-ticks << "/"<< ticks2-ticks1 << "/" << ticks3-ticks2 << "ms"); \
@@ -146,6 +289,10 @@
 
 #define BEGIN_JSON_RPC_MAP(uri)    else if(query_info.m_URI == uri) \
     { \
+    if (epee::json_rpc::is_batch(query_info.m_body)) \
+      return epee::json_rpc::handle_batch(query_info, response_info, [&](const epee::net_utils::http::http_request_info& call_query, epee::net_utils::http::http_response_info& call_response) { \
+        return this->handle_http_request_map(call_query, call_response, m_conn_context); \
+      }); \
     uint64_t ticks = epee::misc_utils::get_tick_count(); \
     response_info.m_mime_tipe = "application/json"; \
     epee::serialization::portable_storage ps; \
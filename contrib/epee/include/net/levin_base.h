@@ -30,6 +30,7 @@
 #define _LEVIN_BASE_H_
 
 #include <cstdint>
+#include <string>
 
 #include "byte_stream.h"
 #include "net_utils_base.h"
@@ -80,6 +81,9 @@ namespace levin
 #define LEVIN_PACKET_RESPONSE		0x00000002
 #define LEVIN_PACKET_BEGIN		0x00000004
 #define LEVIN_PACKET_END		0x00000008
+#define LEVIN_PACKET_COMPRESSED		0x00000010 // payload is a compress_payload block
+
+#define LEVIN_COMPRESSION_THRESHOLD	(16 * 1024) // smaller payloads are not worth the CPU
   
 
 #define LEVIN_PROTOCOL_VER_0         0
@@ -131,6 +135,7 @@ namespace levin
   class message_writer
   {
     byte_slice finalize(uint32_t command, uint32_t flags, uint32_t return_code, bool expect_response);
+    uint32_t extra_flags = 0;
   public:
     using header = bucket_head2;
 
@@ -148,6 +153,13 @@ namespace levin
       return buffer.size() < sizeof(header) ? 0 : buffer.size() - sizeof(header);
     }
 
+    /*! Compresses the payload in place with `compress_payload` when it is at
+        least `threshold` bytes and shrinks; the message is then flagged
+        `LEVIN_PACKET_COMPRESSED`. Must be called before any finalize method.
+
+        \return Size of the payload before compression, or 0 if left as is. */
+    std::size_t compress(std::size_t threshold = LEVIN_COMPRESSION_THRESHOLD);
+
     byte_slice finalize_invoke(uint32_t command) { return finalize(command, LEVIN_PACKET_REQUEST, 0, true); }
     byte_slice finalize_notify(uint32_t command) { return finalize(command, LEVIN_PACKET_REQUEST, 0, false); }
     byte_slice finalize_response(uint32_t command, uint32_t return_code)
@@ -159,6 +171,15 @@ namespace levin
     byte_stream buffer;
   };
 
+  /*! LZ4 style block compression: the uncompressed size as a little endian
+      uint32, then sequences of literals and back references up to 64 KiB.
+
+      \return False if `source` does not compress, leaving `out` unspecified. */
+  bool compress_payload(epee::span<const std::uint8_t> source, byte_stream& out);
+
+  //! \return False if `source` is malformed or expands past `max_size` bytes.
+  bool decompress_payload(epee::span<const std::uint8_t> source, std::size_t max_size, std::string& out);
+
   //! \return Intialized levin header.
   bucket_head2 make_header(uint32_t command, uint64_t msg_size, uint32_t flags, bool expect_response) noexcept;
 
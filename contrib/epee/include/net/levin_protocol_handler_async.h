@@ -60,6 +60,8 @@ void on_levin_traffic(const context_t &context, bool initiator, bool sent, bool
 template<typename context_t>
 void on_levin_traffic(const context_t &context, bool initiator, bool sent, bool error, size_t bytes, int command)
 {
+  if (!error)
+    context.on_command_traffic(command, sent, bytes);
   char buf[32];
   snprintf(buf, sizeof(buf),  "command-%u", command);
   on_levin_traffic(context, initiator, sent, error, bytes, buf);
@@ -441,6 +443,11 @@ public:
         if(m_cache_in_buffer.size() < m_current_head.m_cb)
         {
           is_continue = false;
+          // once half the body is in, size the buffer for all of it so the rest
+          // is not copied again by repeated growth; waiting until then keeps a
+          // peer from making us allocate more than twice what it actually sent
+          if(m_cache_in_buffer.size() >= m_current_head.m_cb / 2)
+            m_cache_in_buffer.reserve(m_current_head.m_cb);
           if(cb >= MIN_BYTES_WANTED)
           {
             CRITICAL_REGION_LOCAL(m_invoke_response_handlers_lock);
@@ -495,6 +502,29 @@ public:
             buff_to_invoke = {reinterpret_cast<const uint8_t*>(temp.data()) + sizeof(bucket_head2), temp.size() - sizeof(bucket_head2)};
           }
 
+          // only sent to peers which offered it, so a compressed payload from anyone else is a protocol violation
+          std::string uncompressed{};
+          if (m_current_head.m_flags & LEVIN_PACKET_COMPRESSED)
+          {
+            if (!m_connection_context.levin_compression())
+            {
+              MERROR(m_connection_context << "Compressed payload without negotiated compression, command " << m_current_head.m_command
+                << ", connection will be closed.");
+              return false;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            const size_t max_bytes = std::min<size_t>(max_packet_size, m_connection_context.get_max_bytes(m_current_head.m_command));
+            if (!levin::decompress_payload(buff_to_invoke, max_bytes, uncompressed))
+            {
+              MERROR(m_connection_context << "Bad compressed payload, command " << m_current_head.m_command
+                << ", connection will be closed.");
+              return false;
+            }
+            const uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            m_connection_context.on_compression_traffic(false, uncompressed.size(), buff_to_invoke.size(), microseconds);
+            buff_to_invoke = {reinterpret_cast<const uint8_t*>(uncompressed.data()), uncompressed.size()};
+          }
+
           bool is_response = (m_oponent_protocol_ver == LEVIN_PROTOCOL_VER_1 && m_current_head.m_flags&LEVIN_PACKET_RESPONSE);
 
           MDEBUG(m_connection_context << "LEVIN_PACKET_RECEIVED. [len=" << m_current_head.m_cb
@@ -106,6 +106,10 @@ namespace net_utils
 				m_ssl_socket(new boost::asio::ssl::stream<boost::asio::ip::tcp::socket>(m_io_service, m_ctx)),
 				m_connector(direct_connect{}),
 				m_ssl_options(epee::net_utils::ssl_support_t::e_ssl_support_autodetect),
+				m_ssl_session(),
+				m_ssl_peer(),
+				m_ssl_session_peer(),
+				m_resume_ssl_sessions(true),
 				m_initialized(true),
 				m_connected(false),
 				m_deadline(m_io_service, std::chrono::steady_clock::time_point::max()),
@@ -147,6 +151,7 @@ namespace net_utils
 			else
 				m_ctx = boost::asio::ssl::context(boost::asio::ssl::context::tlsv12);
 			m_ssl_options = std::move(ssl_options);
+			m_ssl_session.reset();
 		}
 
     inline
@@ -178,6 +183,10 @@ namespace net_utils
 					// SSL Options
 					if (m_ssl_options.support == epee::net_utils::ssl_support_t::e_ssl_support_enabled || m_ssl_options.support == epee::net_utils::ssl_support_t::e_ssl_support_autodetect)
 					{
+						// offer the last session with this server, if it issued one, to skip the full handshake
+						m_ssl_peer = addr + ":" + port;
+						if (m_ssl_session && m_ssl_session_peer == m_ssl_peer)
+							SSL_set_session(m_ssl_socket->native_handle(), m_ssl_session.get());
 						if (!m_ssl_options.handshake(m_io_service, *m_ssl_socket, boost::asio::ssl::stream_base::client, {}, addr, timeout))
 						{
 							if (m_ssl_options.support == epee::net_utils::ssl_support_t::e_ssl_support_autodetect)
@@ -208,9 +217,11 @@ namespace net_utils
     inline
 			bool connect(const std::string& addr, const std::string& port, std::chrono::milliseconds timeout)
 		{
-			m_connected = false;
 			try
 			{
+				if (m_connected)
+					save_ssl_session();
+				m_connected = false;
 				m_ssl_socket->next_layer().close();
 
 				// Set SSL options
@@ -250,6 +261,9 @@ namespace net_utils
 		void set_connector(std::function<connect_func> connector)
 		{
 			m_connector = std::move(connector);
+			// a resumed session would link connections made through different proxy circuits
+			m_resume_ssl_sessions = false;
+			m_ssl_session.reset();
 		}
 
 		inline 
@@ -261,7 +275,10 @@ namespace net_utils
 				{
 					m_connected = false;
 					if(m_ssl_options)
+					{
+						save_ssl_session();
 						shutdown_ssl();
+					}
 					m_ssl_socket->next_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both);
 				}
 			}
@@ -625,6 +642,31 @@ namespace net_utils
 			m_deadline.async_wait(boost::bind(&blocked_mode_client::check_deadline, this));
 		}
 
+		void save_ssl_session()
+		{
+			// TLS 1.3 tickets arrive after the handshake, so this is only worth doing once the connection was used
+			if (!m_resume_ssl_sessions || m_ssl_options.support == ssl_support_t::e_ssl_support_disabled)
+				return;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+			// a copy, openssl marks the session of a connection dropped without close_notify as not resumable
+			SSL_SESSION *const current = SSL_get_session(m_ssl_socket->native_handle());
+			SSL_SESSION *session = current ? SSL_SESSION_dup(current) : nullptr;
+#else
+			SSL_SESSION *session = SSL_get1_session(m_ssl_socket->native_handle());
+#endif
+			if (!session)
+				return;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+			if (!SSL_SESSION_is_resumable(session))
+			{
+				SSL_SESSION_free(session);
+				return;
+			}
+#endif
+			m_ssl_session.reset(session, SSL_SESSION_free);
+			m_ssl_session_peer = m_ssl_peer;
+		}
+
 		void shutdown_ssl() {
 			// ssl socket shutdown blocks if server doesn't respond. We close after 2 secs
 			boost::system::error_code ec = boost::asio::error::would_block;
@@ -681,6 +723,10 @@ namespace net_utils
 		std::shared_ptr<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> m_ssl_socket;
 		std::function<connect_func> m_connector;
 		ssl_options_t m_ssl_options;
+		std::shared_ptr<SSL_SESSION> m_ssl_session;
+		std::string m_ssl_peer;
+		std::string m_ssl_session_peer;
+		bool m_resume_ssl_sessions;
 		bool m_initialized;
 		bool m_connected;
 		boost::asio::steady_timer m_deadline;
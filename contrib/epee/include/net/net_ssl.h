@@ -83,6 +83,12 @@ namespace net_utils
     ssl_authentication_t auth;
     ssl_support_t support;
     ssl_verification_t verification;
+    //! Cache sessions and issue TLS session tickets so reconnecting peers skip the full handshake.
+    bool session_resumption;
+    //! TLS 1.2 cipher list, empty for the default (AES-GCM first when the CPU has AES instructions).
+    std::string cipher_list;
+    //! TLS 1.3 ciphersuites, empty for the default ordered like `cipher_list`.
+    std::string ciphersuites;
 
     //! Verification is set to system ca unless SSL is disabled.
     ssl_options_t(ssl_support_t support)
@@ -90,7 +96,10 @@ namespace net_utils
         ca_path(),
         auth(),
         support(support),
-        verification(support == ssl_support_t::e_ssl_support_disabled ? ssl_verification_t::none : ssl_verification_t::system_ca)
+        verification(support == ssl_support_t::e_ssl_support_disabled ? ssl_verification_t::none : ssl_verification_t::system_ca),
+        session_resumption(false),
+        cipher_list(),
+        ciphersuites()
     {}
 
     //! Provide user fingerprints and/or ca path. Enables SSL and user_certificate verification
@@ -151,6 +160,16 @@ namespace net_utils
 	bool is_ssl(const unsigned char *data, size_t len);
 	bool ssl_support_from_string(ssl_support_t &ssl, boost::string_ref s);
 
+	struct ssl_handshake_stats
+	{
+		std::uint64_t full;    //!< completed handshakes that negotiated a new session
+		std::uint64_t resumed; //!< completed handshakes that resumed a cached session or ticket
+		std::uint64_t failed;
+	};
+	//! Count a finished client or server handshake on `ssl`, process wide.
+	void count_ssl_handshake(SSL *ssl, bool success) noexcept;
+	ssl_handshake_stats get_ssl_handshake_stats() noexcept;
+
 	bool create_ec_ssl_certificate(EVP_PKEY *&pkey, X509 *&cert);
 	bool create_rsa_ssl_certificate(EVP_PKEY *&pkey, X509 *&cert);
 
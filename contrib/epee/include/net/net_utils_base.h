@@ -413,6 +413,15 @@ namespace net_utils
                                m_max_speed_up(0)
     {}
 
+    //! Called for each well formed levin message; derived contexts may hide this to account traffic per command.
+    void on_command_traffic(int command, bool sent, size_t bytes) const noexcept {}
+
+    //! Called for each levin payload compressed or decompressed; derived contexts may hide this to account the cost.
+    void on_compression_traffic(bool sent, size_t bytes, size_t wire_bytes, uint64_t microseconds) const noexcept {}
+
+    //! \return True if compressed levin payloads were negotiated with the peer; derived contexts may hide this.
+    bool levin_compression() const noexcept { return false; }
+
     connection_context_base(const connection_context_base& a): connection_context_base()
     {
       set_details(a.m_connection_id, a.m_remote_address, a.m_is_income, a.m_ssl);
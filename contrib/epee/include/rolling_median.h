@@ -189,6 +189,53 @@ public:
     return sz;
   }
 
+  int capacity() const
+  {
+    return N;
+  }
+
+  //Replaces the newest item by v, which becomes the oldest, in O(lg nItems).
+  //Passing the item the last insert evicted undoes that insert, letting the
+  //window slide back by one. Only possible once the window is full.
+  bool undo_insert(Item v)
+  {
+    if (sz < N)
+      return false;
+    idx = (idx + N - 1) % N;
+    int p = pos[idx];
+    Item old = data[idx];
+    data[idx] = v;
+    // same rebalancing as a full window insert, the counts don't change
+    if (p > 0)
+    {
+      if (v > old)
+      {
+        minSortDown(p);
+        return true;
+      }
+      if (minSortUp(p) && mmCmpExch(0, -1))
+        maxSortDown(-1);
+    }
+    else if (p < 0)
+    {
+      if (v < old)
+      {
+        maxSortDown(p);
+        return true;
+      }
+      if (maxSortUp(p) && minCt && mmCmpExch(1, 0))
+        minSortDown(1);
+    }
+    else
+    {
+      if (maxCt && maxSortUp(-1))
+        maxSortDown(-1);
+      if (minCt && minSortUp(1))
+        minSortDown(1);
+    }
+    return true;
+  }
+
   //Inserts item, maintains median in O(lg nItems)
   void insert(Item v)
   {
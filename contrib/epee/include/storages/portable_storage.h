@@ -32,6 +32,7 @@
 #include "span.h"
 
 #include <boost/mpl/contains.hpp>
+#include <string_view>
 
 namespace epee
 {
@@ -58,31 +59,31 @@ namespace epee
 
       portable_storage(){}
       virtual ~portable_storage(){}
-      hsection   open_section(const std::string& section_name,  hsection hparent_section, bool create_if_notexist = false);
+      hsection   open_section(const std::string_view section_name,  hsection hparent_section, bool create_if_notexist = false);
       template<class t_value>
-      bool       get_value(const std::string& value_name, t_value& val, hsection hparent_section);
-      bool       get_value(const std::string& value_name, storage_entry& val, hsection hparent_section);
+      bool       get_value(const std::string_view value_name, t_value& val, hsection hparent_section);
+      bool       get_value(const std::string_view value_name, storage_entry& val, hsection hparent_section);
       template<class t_value>
-      bool       set_value(const std::string& value_name, t_value&& target, hsection hparent_section);
+      bool       set_value(const std::string_view value_name, t_value&& target, hsection hparent_section);
 
       //serial access for arrays of values --------------------------------------
       //values
       template<class t_value>
-      harray get_first_value(const std::string& value_name, t_value& target, hsection hparent_section);
+      harray get_first_value(const std::string_view value_name, t_value& target, hsection hparent_section);
       template<class t_value>
       bool          get_next_value(harray hval_array, t_value& target);
       template<class t_value>
-      harray insert_first_value(const std::string& value_name, t_value&& target, hsection hparent_section);
+      harray insert_first_value(const std::string_view value_name, t_value&& target, hsection hparent_section);
       template<class t_value>
       bool          insert_next_value(harray hval_array, t_value&& target);
       //sections
-      harray get_first_section(const std::string& pSectionName, hsection& h_child_section, hsection hparent_section);
+      harray get_first_section(const std::string_view pSectionName, hsection& h_child_section, hsection hparent_section);
       bool            get_next_section(harray hSecArray, hsection& h_child_section);
-      harray insert_first_section(const std::string& pSectionName, hsection& hinserted_childsection, hsection hparent_section);
+      harray insert_first_section(const std::string_view pSectionName, hsection& hinserted_childsection, hsection hparent_section);
       bool            insert_next_section(harray hSecArray, hsection& hinserted_childsection);
       //------------------------------------------------------------------------
       //delete entry (section, value or array)
-      bool        delete_entry(const std::string& pentry_name, hsection hparent_section = nullptr);
+      bool        delete_entry(const std::string_view pentry_name, hsection hparent_section = nullptr);
 
       //-------------------------------------------------------------------------------
       bool		store_to_binary(byte_slice& target, std::size_t initial_buffer_size = 8192);
@@ -101,11 +102,11 @@ namespace epee
     private:
       section m_root;
       hsection	get_root_section() {return &m_root;}
-      storage_entry* find_storage_entry(const std::string& pentry_name, hsection psection);
+      storage_entry* find_storage_entry(const std::string_view pentry_name, hsection psection);
       template<class entry_type>
-      storage_entry* insert_new_entry_get_storage_entry(const std::string& pentry_name, hsection psection, entry_type&& entry);
+      storage_entry* insert_new_entry_get_storage_entry(const std::string_view pentry_name, hsection psection, entry_type&& entry);
 
-      hsection    insert_new_section(const std::string& pentry_name, hsection psection);
+      hsection    insert_new_section(const std::string_view pentry_name, hsection psection);
 
 #pragma pack(push)
 #pragma pack(1)
@@ -134,7 +135,7 @@ namespace epee
     };
 
     template<class t_value>
-    bool portable_storage::get_value(const std::string& value_name, t_value& val, hsection hparent_section)
+    bool portable_storage::get_value(const std::string_view value_name, t_value& val, hsection hparent_section)
     {
       BOOST_MPL_ASSERT(( boost::mpl::contains<storage_entry::types, t_value> )); 
       //TRY_ENTRY();
@@ -150,7 +151,7 @@ namespace epee
     }
     //---------------------------------------------------------------------------------------------------------------
     template<class t_value>
-    bool portable_storage::set_value(const std::string& value_name, t_value&& v, hsection hparent_section)
+    bool portable_storage::set_value(const std::string_view value_name, t_value&& v, hsection hparent_section)
     {
       using t_real_value = typename std::decay<t_value>::type;
       BOOST_MPL_ASSERT(( boost::mpl::contains<boost::mpl::push_front<storage_entry::types, storage_entry>::type, t_real_value> ));
@@ -171,7 +172,7 @@ namespace epee
     }
     //---------------------------------------------------------------------------------------------------------------
     template<class entry_type>
-    storage_entry* portable_storage::insert_new_entry_get_storage_entry(const std::string& pentry_name, hsection psection, entry_type&& entry)
+    storage_entry* portable_storage::insert_new_entry_get_storage_entry(const std::string_view pentry_name, hsection psection, entry_type&& entry)
     {
       static_assert(std::is_rvalue_reference<entry_type&&>(), "unexpected copy of value");
       TRY_ENTRY();
@@ -199,7 +200,7 @@ namespace epee
     };
     //---------------------------------------------------------------------------------------------------------------
     template<class t_value>
-    harray portable_storage::get_first_value(const std::string& value_name, t_value& target, hsection hparent_section)
+    harray portable_storage::get_first_value(const std::string_view value_name, t_value& target, hsection hparent_section)
     {
       BOOST_MPL_ASSERT(( boost::mpl::contains<storage_entry::types, t_value> )); 
       //TRY_ENTRY();
@@ -250,7 +251,7 @@ namespace epee
     } 
     //---------------------------------------------------------------------------------------------------------------
     template<class t_value>
-    harray portable_storage::insert_first_value(const std::string& value_name, t_value&& target, hsection hparent_section)
+    harray portable_storage::insert_first_value(const std::string_view value_name, t_value&& target, hsection hparent_section)
     {
       using t_real_value = typename std::decay<t_value>::type;
       static_assert(std::is_rvalue_reference<t_value&&>(), "unexpected copy of value");
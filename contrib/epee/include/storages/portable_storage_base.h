@@ -29,6 +29,7 @@
 #pragma once 
 
 #include <boost/variant.hpp>
+#include <type_traits>
 #include <string>
 #include <vector>
 #include <deque>
@@ -83,6 +84,12 @@ namespace epee
     {
       array_entry_t():m_it(m_array.end()){}        
       array_entry_t(const array_entry_t& other):m_array(other.m_array), m_it(m_array.end()){}
+      // without these, every nested array got deep copied on its way up the parse
+      array_entry_t(array_entry_t&& other) noexcept(std::is_nothrow_move_constructible<typename entry_container<t_entry_type>::type>::value)
+        :m_array(std::move(other.m_array)), m_it(m_array.end())
+      {
+        other.m_it = other.m_array.end();
+      }
 
       array_entry_t& operator=(const array_entry_t& other)
       {
@@ -91,6 +98,14 @@ namespace epee
         return *this;
       }
 
+      array_entry_t& operator=(array_entry_t&& other)
+      {
+        m_array = std::move(other.m_array);
+        m_it = m_array.end();
+        other.m_it = other.m_array.end();
+        return *this;
+      }
+
       const t_entry_type* get_first_val() const 
       {
         m_it = m_array.begin();
@@ -167,7 +182,8 @@ namespace epee
     /************************************************************************/
     struct section
     {
-      std::map<std::string, storage_entry> m_entries;
+      // transparent, so lookups by field name don't build a std::string
+      std::map<std::string, storage_entry, std::less<>> m_entries;
     };
 
     //handle-like aliases
@@ -202,9 +202,32 @@ namespace epee
       }
 
       sa.reserve(size);
-      //TODO: add some optimization here later
-      while(size--)
-        sa.m_array.push_back(read<type_name>());
+      if constexpr (std::is_arithmetic<type_name>::value && !std::is_same<type_name, bool>::value)
+      {
+        // fixed width values are laid out back to back, take them in one go
+        CHECK_AND_ASSERT_THROW_MES(m_count >= size * sizeof(type_name), " attempt to read " << size * sizeof(type_name) << " bytes from buffer with " << m_count << " bytes remained");
+        sa.m_array.resize(size);
+        if (size)
+          memcpy(sa.m_array.data(), m_ptr, size * sizeof(type_name));
+        m_ptr += size * sizeof(type_name);
+        m_count -= size * sizeof(type_name);
+        for (type_name &v: sa.m_array)
+          v = CONVERT_POD(v);
+      }
+      else if constexpr (std::is_same<type_name, section>::value || std::is_same<type_name, std::string>::value)
+      {
+        // parse in place rather than into a temporary that gets moved in
+        while(size--)
+        {
+          sa.m_array.emplace_back();
+          read(sa.m_array.back());
+        }
+      }
+      else
+      {
+        while(size--)
+          sa.m_array.push_back(read<type_name>());
+      }
       return storage_entry(array_entry(std::move(sa)));
     }
 
@@ -28,6 +28,9 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/utility/string_ref.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/error/en.h>
 #include "parserse_base_utils.h"
 #include "file_io_utils.h"
 
@@ -43,362 +46,180 @@ namespace epee
   {
     namespace json
     {
-#define CHECK_ISSPACE()  if(!epee::misc_utils::parse::isspace(*it)){ ASSERT_MES_AND_THROW("Wrong JSON character at: " << std::string(it, buf_end));}
-
-      /*inline void parse_error()
-      {
-        ASSERT_MES_AND_THROW("json parse error");
-      }*/
+      /*! rapidjson SAX handler storing values into `t_storage` as they are
+          parsed, so no intermediate document is built. Values are stored the
+          way the former hand written parser did: integers as uint64_t, or
+          int64_t when negative, other numbers as double, nulls are skipped,
+          and arrays must hold values of a single kind. */
       template<class t_storage>
-      inline void run_handler(typename t_storage::hsection current_section, std::string::const_iterator& sec_buf_begin, std::string::const_iterator buf_end, t_storage& stg, unsigned int recursion)
+      class sax_handler
       {
-        CHECK_AND_ASSERT_THROW_MES(recursion < EPEE_JSON_RECURSION_LIMIT_INTERNAL, "Wrong JSON data: recursion limitation (" << EPEE_JSON_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      public:
+        explicit sax_handler(t_storage& stg) : m_stg(stg) {}
 
-        std::string name;        
-        typename t_storage::harray h_array = nullptr;
-        enum match_state
+        const std::string& error() const noexcept { return m_error; }
+
+        bool StartObject()
         {
-          match_state_lookup_for_section_start, 
-          match_state_lookup_for_name, 
-          match_state_waiting_separator, 
-          match_state_wonder_after_separator, 
-          match_state_wonder_after_value, 
-          match_state_wonder_array, 
-          match_state_array_after_value,
-          match_state_array_waiting_value, 
-          match_state_error
-        };
+          if (m_stack.size() >= EPEE_JSON_RECURSION_LIMIT_INTERNAL)
+            return fail("recursion limitation (" + std::to_string(EPEE_JSON_RECURSION_LIMIT_INTERNAL) + ") exceeded");
+          typename t_storage::hsection new_sec = nullptr;
+          if (!m_stack.empty())
+          {
+            frame& top = m_stack.back();
+            if (top.mode == array_mode_none)
+              new_sec = m_stg.open_section(top.name, top.section, true);
+            else if (top.mode == array_mode_undefined)
+            {
+              top.array = m_stg.insert_first_section(top.name, new_sec, top.section);
+              top.mode = array_mode_sections;
+              if (!top.array)
+                return fail("failed to create new section");
+            }
+            else if (top.mode != array_mode_sections || !m_stg.insert_next_section(top.array, new_sec))
+              return fail("failed to insert next section");
+            if (!new_sec)
+              return fail("failed to insert new section");
+          }
+          m_stack.emplace_back(new_sec);
+          return true;
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool)
+        {
+          m_stack.back().name.assign(str, length);
+          return true;
+        }
+        bool EndObject(rapidjson::SizeType)
+        {
+          m_stack.pop_back();
+          return true;
+        }
+        bool StartArray()
+        {
+          if (m_stack.empty())
+            return fail("top level value is not an object");
+          frame& top = m_stack.back();
+          if (top.mode != array_mode_none)
+            return fail("arrays of arrays are not supported");
+          top.mode = array_mode_undefined;
+          top.array = nullptr;
+          return true;
+        }
+        bool EndArray(rapidjson::SizeType)
+        {
+          m_stack.back().mode = array_mode_none;
+          return true;
+        }
+        bool Null()
+        {
+          if (m_stack.empty() || m_stack.back().mode != array_mode_none)
+            return fail("unexpected null");
+          return true; // just skip it
+        }
+        bool Bool(bool b) { return value(b, array_mode_booleans); }
+        bool String(const char* str, rapidjson::SizeType length, bool)
+        {
+          return value(std::string(str, length), array_mode_strings);
+        }
+        // numbers are parsed as strings, to keep the full range of 64 bit integers
+        bool RawNumber(const char* str, rapidjson::SizeType length, bool)
+        {
+          const std::string val(str, length);
+          errno = 0;
+          if (val.find_first_of(".eE") != std::string::npos)
+          {
+            const double nval = strtod(val.c_str(), NULL);
+            if (errno) return fail("Invalid number: " + val);
+            return value(double(nval), array_mode_numbers);
+          }
+          else if (val[0] == '-')
+          {
+            const int64_t nval = strtoll(val.c_str(), NULL, 10);
+            if (errno) return fail("Invalid number: " + val);
+            return value(int64_t(nval), array_mode_numbers);
+          }
+          const uint64_t nval = strtoull(val.c_str(), NULL, 10);
+          if (errno) return fail("Invalid number: " + val);
+          return value(uint64_t(nval), array_mode_numbers);
+        }
+        // never called with kParseNumbersAsStringsFlag
+        bool Int(int) { return false; }
+        bool Uint(unsigned) { return false; }
+        bool Int64(int64_t) { return false; }
+        bool Uint64(uint64_t) { return false; }
+        bool Double(double) { return false; }
 
+      private:
         enum array_mode
         {
-          array_mode_undifined = 0,
-          array_mode_sections, 
-          array_mode_string, 
+          array_mode_none = 0, // not in an array
+          array_mode_undefined, // in an array, kind of values not known yet
+          array_mode_sections,
+          array_mode_strings,
           array_mode_numbers,
           array_mode_booleans
         };
 
-        match_state state = match_state_lookup_for_section_start;
-        array_mode array_md = array_mode_undifined;
-        std::string::const_iterator it = sec_buf_begin;
-        for(;it != buf_end;it++)
+        struct frame
         {
-          switch (state)
-          {
-          case match_state_lookup_for_section_start:
-            if(*it == '{')
-              state = match_state_lookup_for_name;
-            else CHECK_ISSPACE();
-            break;
-          case match_state_lookup_for_name:
-            switch(*it)
-            {
-            case '"':
-              match_string2(it, buf_end, name);
-              state = match_state_waiting_separator;
-              break;
-            case '}':
-              //this is it! section ends here.
-              //seems that it is empty section
-              sec_buf_begin = it;
-              return;
-            default:
-              CHECK_ISSPACE();
-            }
-            break;
-          case match_state_waiting_separator:
-            if(*it == ':')
-              state = match_state_wonder_after_separator;
-            else CHECK_ISSPACE();
-            break;
-          case match_state_wonder_after_separator:
-            if(*it == '"')
-            {//just a named string value started
-              std::string val;
-              match_string2(it, buf_end, val);
-              //insert text value 
-              stg.set_value(name, std::move(val), current_section);
-              state = match_state_wonder_after_value;
-            }else if (epee::misc_utils::parse::isdigit(*it) || *it == '-')
-            {//just a named number value started
-              boost::string_ref val;
-              bool is_v_float = false;bool is_signed = false;
-              match_number2(it, buf_end, val, is_v_float, is_signed);
-              if(!is_v_float)
-              {
-                if(is_signed)
-                {
-                  errno = 0;
-                  int64_t nval = strtoll(val.data(), NULL, 10);
-                  if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                  stg.set_value(name, int64_t(nval), current_section);
-                }else
-                {
-                  errno = 0;
-                  uint64_t nval = strtoull(val.data(), NULL, 10);
-                  if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                  stg.set_value(name, uint64_t(nval), current_section);
-                }
-              }else
-              {
-                errno = 0;
-                double nval = strtod(val.data(), NULL);
-                if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                stg.set_value(name, double(nval), current_section);
-              }
-              state = match_state_wonder_after_value;
-            }else if(isalpha(*it) )
-            {// could be null, true or false
-              boost::string_ref word;
-              match_word2(it, buf_end, word);
-              if(boost::iequals(word, "null"))
-              {
-                state = match_state_wonder_after_value;
-                //just skip this, 
-              }else if(boost::iequals(word, "true"))
-              {
-                stg.set_value(name, true, current_section);              
-                state = match_state_wonder_after_value;
-              }else if(boost::iequals(word, "false"))
-              {
-                stg.set_value(name, false, current_section);              
-                state = match_state_wonder_after_value;
-              }else ASSERT_MES_AND_THROW("Unknown value keyword " << word);
-            }else if(*it == '{')
-            {
-              //sub section here
-              typename t_storage::hsection new_sec = stg.open_section(name, current_section, true);
-              CHECK_AND_ASSERT_THROW_MES(new_sec, "Failed to insert new section in json: " << std::string(it, buf_end));
-              run_handler(new_sec, it, buf_end, stg, recursion + 1);
-              state = match_state_wonder_after_value;
-            }else if(*it == '[')
-            {//array of something
-              state = match_state_wonder_array;
-            }else CHECK_ISSPACE();
-            break;
-          case match_state_wonder_after_value:
-            if(*it == ',')
-              state = match_state_lookup_for_name;
-            else if(*it == '}')
-            {
-              //this is it! section ends here.
-              sec_buf_begin = it;
-              return;
-            }else CHECK_ISSPACE();
-            break;
-          case match_state_wonder_array:
-            if(*it == '[')
-            {
-              ASSERT_MES_AND_THROW("array of array not suppoerted yet :( sorry"); 
-              //mean array of array
-            }
-            if(*it == '{')
-            {
-              //mean array of sections
-              typename t_storage::hsection new_sec = nullptr;
-              h_array = stg.insert_first_section(name, new_sec, current_section);
-              CHECK_AND_ASSERT_THROW_MES(h_array&&new_sec, "failed to create new section");
-              run_handler(new_sec, it, buf_end, stg, recursion + 1);
-              state = match_state_array_after_value;
-              array_md = array_mode_sections;
-            }else if(*it == '"')
-            {
-              //mean array of strings
-              std::string val;
-              match_string2(it, buf_end, val);
-              h_array = stg.insert_first_value(name, std::move(val), current_section);
-              CHECK_AND_ASSERT_THROW_MES(h_array, " failed to insert values entry");
-              state = match_state_array_after_value;
-              array_md = array_mode_string;
-            }else if (epee::misc_utils::parse::isdigit(*it) || *it == '-')
-            {//array of numbers value started
-              boost::string_ref val;
-              bool is_v_float = false;bool is_signed_val = false;
-              match_number2(it, buf_end, val, is_v_float, is_signed_val);
-              if(!is_v_float)
-              {
-                if (is_signed_val)
-                {
-                  errno = 0;
-                  int64_t nval = strtoll(val.data(), NULL, 10);
-                  if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                  h_array = stg.insert_first_value(name, int64_t(nval), current_section);
-                }else
-                {
-                  errno = 0;
-                  uint64_t nval = strtoull(val.data(), NULL, 10);
-                  if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                  h_array = stg.insert_first_value(name, uint64_t(nval), current_section);
-                }
-                CHECK_AND_ASSERT_THROW_MES(h_array, " failed to insert values section entry");
-              }else
-              {
-                errno = 0;
-                double nval = strtod(val.data(), NULL);
-                if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                h_array = stg.insert_first_value(name, double(nval), current_section);
-                CHECK_AND_ASSERT_THROW_MES(h_array, " failed to insert values section entry");
-              }
-
-              state = match_state_array_after_value;
-              array_md = array_mode_numbers;
-            }else if(*it == ']')//empty array
-            {
-              array_md = array_mode_undifined;
-              state = match_state_wonder_after_value;
-            }else if(isalpha(*it) )
-            {// array of booleans
-              boost::string_ref word;
-              match_word2(it, buf_end, word);
-              if(boost::iequals(word, "true"))
-              {
-                h_array = stg.insert_first_value(name, true, current_section);              
-                CHECK_AND_ASSERT_THROW_MES(h_array, " failed to insert values section entry");
-                state = match_state_array_after_value;
-                array_md = array_mode_booleans;
-              }else if(boost::iequals(word, "false"))
-              {
-                h_array = stg.insert_first_value(name, false, current_section);              
-                CHECK_AND_ASSERT_THROW_MES(h_array, " failed to insert values section entry");
-                state = match_state_array_after_value;
-                array_md = array_mode_booleans;
+          explicit frame(typename t_storage::hsection section) : section(section), array(nullptr), mode(array_mode_none) {}
+          typename t_storage::hsection section;
+          std::string name;
+          typename t_storage::harray array;
+          array_mode mode;
+        };
 
-              }else ASSERT_MES_AND_THROW("Unknown value keyword " << word)
-            }else CHECK_ISSPACE();
-            break;
-          case match_state_array_after_value:
-            if(*it == ',')
-              state = match_state_array_waiting_value;
-            else if(*it == ']')
-            {
-              h_array = nullptr;
-              array_md = array_mode_undifined;
-              state = match_state_wonder_after_value;
-            }else CHECK_ISSPACE();
-            break;
-          case match_state_array_waiting_value:
-            switch(array_md)
-            {
-            case array_mode_sections:
-              if(*it == '{')
-              {
-                typename t_storage::hsection new_sec = NULL;
-                bool res = stg.insert_next_section(h_array, new_sec);
-                CHECK_AND_ASSERT_THROW_MES(res&&new_sec, "failed to insert next section");
-                run_handler(new_sec, it, buf_end, stg, recursion + 1);
-                state = match_state_array_after_value;
-              }else CHECK_ISSPACE();
-              break;
-            case array_mode_string:
-              if(*it == '"')
-              {
-                std::string val;
-                match_string2(it, buf_end, val);
-                bool res = stg.insert_next_value(h_array, std::move(val));
-                CHECK_AND_ASSERT_THROW_MES(res, "failed to insert values");
-                state = match_state_array_after_value;
-              }else CHECK_ISSPACE();
-              break;
-            case array_mode_numbers:
-              if (epee::misc_utils::parse::isdigit(*it) || *it == '-')
-              {//array of numbers value started
-                boost::string_ref val;
-                bool is_v_float = false;bool is_signed_val = false;
-                match_number2(it, buf_end, val, is_v_float, is_signed_val);
-                bool insert_res = false;
-                if(!is_v_float)
-                {
-                  if (is_signed_val)
-                  {
-                    errno = 0;
-                    int64_t nval = strtoll(val.data(), NULL, 10);
-                    if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                    insert_res = stg.insert_next_value(h_array, int64_t(nval));
-                  }else
-                  {
-                    errno = 0;
-                    uint64_t nval = strtoull(val.data(), NULL, 10);
-                    if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                    insert_res = stg.insert_next_value(h_array, uint64_t(nval));
-                  }
-                }else
-                {
-                  errno = 0;
-                  double nval = strtod(val.data(), NULL);
-                  if (errno) throw std::runtime_error("Invalid number: " + std::string(val));
-                  insert_res = stg.insert_next_value(h_array, double(nval));
-                }
-                CHECK_AND_ASSERT_THROW_MES(insert_res, "Failed to insert next value");
-                state = match_state_array_after_value;
-                array_md = array_mode_numbers;
-              }else CHECK_ISSPACE();
-              break;
-            case array_mode_booleans:
-              if(isalpha(*it) )
-              {// array of booleans
-                boost::string_ref word;
-                match_word2(it, buf_end, word);
-                if(boost::iequals(word, "true"))
-                {
-                  bool r = stg.insert_next_value(h_array, true);              
-                  CHECK_AND_ASSERT_THROW_MES(r, " failed to insert values section entry");
-                  state = match_state_array_after_value;
-                }else if(boost::iequals(word, "false"))
-                {
-                  bool r = stg.insert_next_value(h_array, false);
-                  CHECK_AND_ASSERT_THROW_MES(r, " failed to insert values section entry");
-                  state = match_state_array_after_value;
-                }
-                else ASSERT_MES_AND_THROW("Unknown value keyword " << word);
-              }else CHECK_ISSPACE();
-              break;
-            case array_mode_undifined:
-            default:
-              ASSERT_MES_AND_THROW("Bad array state");
-            }
-            break;
-          case match_state_error:
-          default:
-            ASSERT_MES_AND_THROW("WRONG JSON STATE");
-          }
-        }
-      }
-/*
-{
-    "firstName": "John",
-    "lastName": "Smith",
-    "age": 25,
-    "address": {
-        "streetAddress": "21 2nd Street",
-        "city": "New York",
-        "state": "NY",
-        "postalCode": -10021, 
-        "have_boobs": true, 
-        "have_balls": false 
-    },
-    "phoneNumber": [
+        bool fail(std::string message)
         {
-            "type": "home",
-            "number": "212 555-1234"
-        },
+          m_error = std::move(message);
+          return false;
+        }
+
+        template<class t_value>
+        bool value(t_value val, array_mode kind)
         {
-            "type": "fax",
-            "number": "646 555-4567"
+          if (m_stack.empty())
+            return fail("top level value is not an object");
+          frame& top = m_stack.back();
+          if (top.mode == array_mode_none)
+            return m_stg.set_value(top.name, std::move(val), top.section);
+          if (top.mode == array_mode_undefined)
+          {
+            top.array = m_stg.insert_first_value(top.name, std::move(val), top.section);
+            top.mode = kind;
+            return top.array || fail("failed to insert values entry");
+          }
+          // numbers of different types in a single array are refused by the storage
+          if (top.mode != kind || !m_stg.insert_next_value(top.array, std::move(val)))
+            return fail("Wrong value in array");
+          return true;
         }
-    ], 
-    "phoneNumbers": [
-    "812 123-1234",
-    "916 123-4567"
-    ]
-}
-*/
+
+        t_storage& m_stg;
+        std::vector<frame> m_stack;
+        std::string m_error;
+      };
+
       template<class t_storage>
       inline bool load_from_json(const std::string& buff_json, t_storage& stg)
       {
-        std::string::const_iterator sec_buf_begin  = buff_json.begin();
         try
         {
-          run_handler(nullptr, sec_buf_begin, buff_json.end(), stg, 0);
+          sax_handler<t_storage> handler(stg);
+          rapidjson::Reader reader;
+          rapidjson::MemoryStream stream(buff_json.data(), buff_json.size());
+          const rapidjson::ParseResult result = reader.Parse<rapidjson::kParseIterativeFlag | rapidjson::kParseNumbersAsStringsFlag>(stream, handler);
+          if (!result)
+          {
+            MERROR("Failed to parse json at offset " << result.Offset() << ", what: " << (handler.error().empty() ? rapidjson::GetParseError_En(result.Code()) : handler.error()));
+            return false;
+          }
+          // the reader takes an embedded NUL for the end of the input, so anything after it was never parsed
+          if (stream.Tell() != buff_json.size())
+          {
+            MERROR("Failed to parse json at offset " << stream.Tell() << ", what: unexpected NUL");
+            return false;
+          }
           return true;
         }
         catch(const std::exception& ex)
@@ -0,0 +1,94 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace epee
+{
+namespace thread_placement
+{
+  //! Where the threads of a group may run, and how eagerly they are scheduled.
+  struct policy
+  {
+    std::vector<unsigned> cpus; //!< CPUs the threads are pinned to, empty for any
+    int nice = 0;               //!< nice level of the threads, 0 to leave it alone
+    bool batch = false;         //!< schedule the threads as SCHED_BATCH (Linux only)
+  };
+
+  //! CPU time used by the threads of a group, live and exited.
+  struct usage
+  {
+    std::string group;
+    uint64_t cpu_us;
+    unsigned threads; //!< live threads
+  };
+
+  /*! Parse a CPU list like "0-3,8,10-11" into sorted, unique CPU numbers.
+      \return false if the list is empty or malformed */
+  bool parse_cpu_list(const std::string &list, std::vector<unsigned> &cpus);
+
+  /*! Set the policy for threads joining `group` from now on. Threads that
+      already joined keep the old one, so this is meant to run at startup,
+      before the groups' threads are created. */
+  void set_policy(const std::string &group, const policy &p);
+
+  //! \return The CPU time of every group that had a thread join, by name.
+  std::vector<usage> get_usage();
+
+  /*! Puts the calling thread into a group for its lifetime: the group's
+      policy is applied on construction, and the thread's CPU time counts
+      towards the group until destruction. Must be destroyed on the thread
+      that created it. A policy that can't be applied (eg. a negative nice
+      level without privileges) is logged and otherwise ignored.
+
+      Memory is not bound explicitly: once a thread is pinned, the kernel's
+      first touch policy already places what it allocates on its local NUMA
+      node. */
+  class member
+  {
+  public:
+    explicit member(const std::string &group);
+    ~member();
+
+    member(const member&) = delete;
+    member &operator=(const member&) = delete;
+
+    //! \return CPU time used by this thread so far
+    uint64_t cpu_us() const;
+
+    struct entry;
+
+  private:
+    entry *m_entry;
+  };
+}
+}
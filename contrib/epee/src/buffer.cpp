@@ -96,5 +96,18 @@ void buffer::append(const void *data, size_t sz)
   NET_BUFFER_LOG("storage now " << offset << "/" << storage.size() << "/" << storage.capacity());
 }
 
+void buffer::reserve(size_t sz)
+{
+  if (sz <= size() || storage.capacity() - offset >= sz)
+    return;
+
+  NET_BUFFER_LOG("reserving " << sz << " with " << size() << " in use");
+  std::vector<uint8_t> new_storage;
+  new_storage.reserve(sz);
+  new_storage.insert(new_storage.end(), storage.begin() + offset, storage.end());
+  offset = 0;
+  std::swap(storage, new_storage);
+}
+
 }
 }
@@ -28,6 +28,7 @@
 
 #include "hex.h"
 
+#include <cstring>
 #include <iterator>
 #include <limits>
 #include <ostream>
@@ -39,19 +40,45 @@ namespace epee
 {
   namespace
   {
+    // both hex digits of every byte value, so each input byte is a single lookup
+    struct hex_pairs_t
+    {
+      char pairs[256][2];
+
+      constexpr hex_pairs_t() noexcept
+        : pairs()
+      {
+        constexpr const char hex[] = u8"0123456789abcdef";
+        static_assert(sizeof(hex) == 17, "bad string size");
+        for (unsigned i = 0; i < 256; ++i)
+        {
+          pairs[i][0] = hex[i >> 4];
+          pairs[i][1] = hex[i & 0x0F];
+        }
+      }
+    };
+    constexpr const hex_pairs_t hex_pairs{};
+
     template<typename T>
     void write_hex(T&& out, const span<const std::uint8_t> src)
     {
-      static constexpr const char hex[] = u8"0123456789abcdef";
-      static_assert(sizeof(hex) == 17, "bad string size");
       for (const std::uint8_t byte : src)
       {
-        *out = hex[byte >> 4];
+        *out = hex_pairs.pairs[byte][0];
         ++out;
-        *out = hex[byte & 0x0F];
+        *out = hex_pairs.pairs[byte][1];
         ++out;
       }
     }
+
+    void write_hex_buffer(char* out, const span<const std::uint8_t> src) noexcept
+    {
+      for (const std::uint8_t byte : src)
+      {
+        std::memcpy(out, hex_pairs.pairs[byte], 2);
+        out += 2;
+      }
+    }
   }
 
   template<typename T>
@@ -81,9 +108,17 @@ namespace epee
     out.put('>');
   }
 
+  bool to_hex::buffer(span<char> out, const span<const std::uint8_t> src) noexcept
+  {
+    if (std::numeric_limits<std::size_t>::max() / 2 < src.size() || out.size() != src.size() * 2)
+      return false;
+    buffer_unchecked(out.data(), src);
+    return true;
+  }
+
   void to_hex::buffer_unchecked(char* out, const span<const std::uint8_t> src) noexcept
   {
-    return write_hex(out, src);
+    return write_hex_buffer(out, src);
   }
 
 
@@ -108,12 +143,10 @@ namespace epee
       const unsigned char *src = (const unsigned char *)s.data();
       for(size_t i = 0; i < s.size(); i += 2)
       {
-        int tmp = *src++;
-        tmp = epee::misc_utils::parse::isx[tmp];
-        if (tmp == 0xff) return false;
-        int t2 = *src++;
-        t2 = epee::misc_utils::parse::isx[t2];
-        if (t2 == 0xff) return false;
+        const int tmp = epee::misc_utils::parse::isx[*src++];
+        const int t2 = epee::misc_utils::parse::isx[*src++];
+        // valid digits are at most 0x0f, isx gives 0xff for anything else
+        if ((tmp | t2) & 0xf0) return false;
         *dst++ = (tmp << 4) | t2;
       }
 
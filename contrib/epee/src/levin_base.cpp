@@ -28,6 +28,11 @@
 
 #include "net/levin_base.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
 #include "int-util.h"
 
 namespace epee
@@ -46,13 +51,184 @@ namespace levin
     if (buffer.size() < sizeof(header))
       throw std::runtime_error{"levin_writer::finalize already called"};
 
-    header head = make_header(command, payload_size(), flags, expect_response);
+    header head = make_header(command, payload_size(), flags | extra_flags, expect_response);
     head.m_return_code = SWAP32LE(return_code);
 
     std::memcpy(buffer.tellp() - buffer.size(), std::addressof(head), sizeof(head));
     return byte_slice{std::move(buffer)};
   }
 
+  std::size_t message_writer::compress(const std::size_t threshold)
+  {
+    if (buffer.size() < sizeof(header))
+      throw std::runtime_error{"levin_writer::compress called after finalize"};
+
+    const std::size_t size = payload_size();
+    if (size < threshold || (extra_flags & LEVIN_PACKET_COMPRESSED))
+      return 0;
+
+    byte_stream compressed{};
+    compressed.reserve(sizeof(header) + size);
+    compressed.put_n(0, sizeof(header));
+    if (!compress_payload({buffer.data() + sizeof(header), size}, compressed))
+      return 0;
+
+    buffer = std::move(compressed);
+    extra_flags |= LEVIN_PACKET_COMPRESSED;
+    return size;
+  }
+
+  namespace
+  {
+    constexpr const std::size_t min_match = 4;
+    constexpr const std::size_t max_offset = 65535;
+    // the last match has to start this far from the end, and the last bytes
+    // are always literals, which lets the decoder copy matches simply
+    constexpr const std::size_t match_safe_distance = 12;
+    constexpr const std::size_t last_literals = 5;
+    constexpr const unsigned hash_bits = 14;
+
+    std::uint32_t read32(const std::uint8_t* ptr) noexcept
+    {
+      std::uint32_t value;
+      std::memcpy(std::addressof(value), ptr, sizeof(value));
+      return value;
+    }
+
+    std::uint32_t hash4(const std::uint8_t* ptr) noexcept
+    {
+      return (read32(ptr) * 2654435761u) >> (32 - hash_bits);
+    }
+
+    void write_length(byte_stream& out, std::size_t length)
+    {
+      for (; length >= 255; length -= 255)
+        out.put(0xff);
+      out.put(std::uint8_t(length));
+    }
+
+    void write_sequence(byte_stream& out, const std::uint8_t* literals, const std::size_t literal_length, const std::size_t offset, const std::size_t match_length)
+    {
+      const std::size_t extra_match = match_length ? match_length - min_match : 0;
+      out.put(std::uint8_t((std::min<std::size_t>(literal_length, 15) << 4) | std::min<std::size_t>(extra_match, 15)));
+      if (literal_length >= 15)
+        write_length(out, literal_length - 15);
+      out.write(literals, literal_length);
+      if (!match_length)
+        return; // last sequence
+      out.put(std::uint8_t(offset));
+      out.put(std::uint8_t(offset >> 8));
+      if (extra_match >= 15)
+        write_length(out, extra_match - 15);
+    }
+
+    bool read_length(const std::uint8_t*& ptr, const std::uint8_t* const end, std::size_t& length, const std::size_t max)
+    {
+      for (;;)
+      {
+        if (ptr == end)
+          return false;
+        const std::uint8_t byte = *ptr++;
+        length += byte;
+        if (length > max)
+          return false;
+        if (byte != 255)
+          return true;
+      }
+    }
+  }
+
+  bool compress_payload(const epee::span<const std::uint8_t> source, byte_stream& out)
+  {
+    const std::size_t size = source.size();
+    if (size > std::numeric_limits<std::uint32_t>::max())
+      return false;
+
+    const std::size_t start = out.size();
+    for (unsigned i = 0; i < 4; ++i)
+      out.put(std::uint8_t(size >> (8 * i)));
+
+    const std::uint8_t* const base = source.data();
+    std::size_t anchor = 0;
+    if (size > match_safe_distance)
+    {
+      std::vector<std::uint32_t> table(std::size_t(1) << hash_bits, 0);
+      const std::size_t match_limit = size - match_safe_distance;
+      std::size_t pos = 1;
+      while (pos < match_limit)
+      {
+        const std::uint32_t hash = hash4(base + pos);
+        const std::size_t candidate = table[hash];
+        table[hash] = std::uint32_t(pos);
+        if (pos - candidate > max_offset || read32(base + candidate) != read32(base + pos))
+        {
+          // step faster through data that does not match, such as keys
+          pos += 1 + ((pos - anchor) >> 6);
+          continue;
+        }
+
+        std::size_t length = min_match;
+        while (pos + length < size - last_literals && base[candidate + length] == base[pos + length])
+          ++length;
+        write_sequence(out, base + anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+        if (out.size() - start >= size)
+          return false;
+      }
+    }
+    write_sequence(out, base + anchor, size - anchor, 0, 0);
+    return out.size() - start < size;
+  }
+
+  bool decompress_payload(const epee::span<const std::uint8_t> source, const std::size_t max_size, std::string& out)
+  {
+    if (source.size() < 4)
+      return false;
+    std::size_t size = 0;
+    for (unsigned i = 0; i < 4; ++i)
+      size |= std::size_t(source[i]) << (8 * i);
+    if (size > max_size)
+      return false;
+
+    out.resize(size);
+    std::uint8_t* const dest = reinterpret_cast<std::uint8_t*>(std::addressof(out[0]));
+    const std::uint8_t* ptr = source.data() + 4;
+    const std::uint8_t* const end = source.data() + source.size();
+    std::size_t pos = 0;
+    while (ptr != end)
+    {
+      const std::uint8_t token = *ptr++;
+      std::size_t length = token >> 4;
+      if (length == 15 && !read_length(ptr, end, length, size))
+        return false;
+      if (length > std::size_t(end - ptr) || length > size - pos)
+        return false;
+      std::memcpy(dest + pos, ptr, length);
+      ptr += length;
+      pos += length;
+      if (ptr == end)
+        break; // last sequence has no match
+
+      if (end - ptr < 2)
+        return false;
+      const std::size_t offset = ptr[0] | (std::size_t(ptr[1]) << 8);
+      ptr += 2;
+      if (offset == 0 || offset > pos)
+        return false;
+      length = token & 0x0f;
+      if (length == 15 && !read_length(ptr, end, length, size))
+        return false;
+      length += min_match;
+      if (length > size - pos)
+        return false;
+      // matches may overlap their own output
+      for (std::size_t i = 0; i < length; ++i, ++pos)
+        dest[pos] = dest[pos - offset];
+    }
+    return pos == size;
+  }
+
   bucket_head2 make_header(uint32_t command, uint64_t msg_size, uint32_t flags, bool expect_response) noexcept
   {
     bucket_head2 head = {0};
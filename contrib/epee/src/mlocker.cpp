@@ -35,11 +35,18 @@
 #if defined HAVE_MLOCK
 #include <sys/mman.h>
 #endif
+#if defined __linux__
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
 #include "misc_log_ex.h"
 #include "syncobj.h"
 #include "mlocker.h"
 
 #include <atomic>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "mlocker"
@@ -89,27 +96,144 @@ static void do_unlock(void *ptr, size_t len)
 #endif
 }
 
-namespace epee
+namespace
 {
-  size_t mlocker::page_size = 0;
-  size_t mlocker::num_locked_objects = 0;
+  //! Page bookkeeping is split by page number, so unrelated objects don't contend on one lock
+  constexpr size_t NUM_SHARDS = 16;
+
+  //! Unreferenced stack pages kept locked, per thread and overall. Kept small
+  //! since they count against RLIMIT_MEMLOCK like any other locked page
+  constexpr size_t MAX_RETAINED_PAGES_PER_THREAD = 4;
+  constexpr size_t MAX_RETAINED_PAGES = 64;
+
+  struct page_state
+  {
+    unsigned int refs;
+    bool retained; //!< on its thread's retained list, so still locked at zero refs
+  };
+
+  struct shard
+  {
+    boost::mutex mutex;
+    std::unordered_map<size_t, page_state> pages;
+  };
 
-  boost::mutex &mlocker::mutex()
+  shard &shard_for(size_t page)
   {
-    static boost::mutex *vmutex = new boost::mutex();
-    return *vmutex;
+    static shard *shards = new shard[NUM_SHARDS];
+    return shards[page % NUM_SHARDS];
   }
-  std::map<size_t, unsigned int> &mlocker::map()
+
+  std::atomic<size_t> num_locked_pages{0};
+  std::atomic<size_t> num_locked_objects{0};
+  std::atomic<size_t> num_retained_pages{0};
+
+  // A thread's own stack stays mapped until it exits, so the pages short lived
+  // secrets keep landing on can stay locked between objects instead of paying
+  // an mlock/munlock pair each time. Heap pages may be unmapped and reused
+  // behind our back, so they are always unlocked as soon as they are unused.
+  // Trivially destructible, so it stays usable from other thread_local dtors
+  struct thread_stack
+  {
+    enum { unknown, known, unavailable } state;
+    bool exiting;
+    size_t first_page, end_page;
+    size_t num_retained;
+    size_t retained[MAX_RETAINED_PAGES_PER_THREAD];
+  };
+  thread_local thread_stack this_thread_stack{};
+
+  void release_retained(thread_stack &ts, size_t page_size)
   {
-    static std::map<size_t, unsigned int> *vmap = new std::map<size_t, unsigned int>();
-    return *vmap;
+    for (size_t n = 0; n < ts.num_retained; ++n)
+    {
+      const size_t page = ts.retained[n];
+      shard &s = shard_for(page);
+      CRITICAL_REGION_LOCAL(s.mutex);
+      const auto i = s.pages.find(page);
+      if (i == s.pages.end())
+        continue;
+      i->second.retained = false;
+      if (i->second.refs == 0)
+      {
+        s.pages.erase(i);
+        do_unlock((void*)(page * page_size), page_size);
+      }
+      --num_retained_pages;
+    }
+    ts.num_retained = 0;
   }
 
+  struct thread_stack_releaser
+  {
+    ~thread_stack_releaser()
+    {
+      this_thread_stack.exiting = true;
+      release_retained(this_thread_stack, epee::mlocker::get_page_size());
+    }
+  };
+
+  bool is_on_this_thread_stack(size_t page, size_t page_size)
+  {
+    thread_stack &ts = this_thread_stack;
+    if (ts.state == thread_stack::unknown)
+    {
+      ts.state = thread_stack::unavailable;
+#if defined __linux__ && defined HAVE_MLOCK
+      pthread_attr_t attr;
+      if (pthread_getattr_np(pthread_self(), &attr) == 0)
+      {
+        void *addr = NULL;
+        size_t size = 0;
+        if (pthread_attr_getstack(&attr, &addr, &size) == 0 && addr && size)
+        {
+          // the main thread's stack is only reported as far as it has grown so
+          // far, but the kernel keeps the whole rlimit below its top for it
+          if (getpid() == (pid_t)syscall(SYS_gettid))
+          {
+            struct rlimit rl;
+            if (getrlimit(RLIMIT_STACK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur > size && rl.rlim_cur < (uintptr_t)addr + size)
+            {
+              addr = (char*)addr + size - rl.rlim_cur;
+              size = rl.rlim_cur;
+            }
+          }
+          ts.first_page = ((uintptr_t)addr + page_size - 1) / page_size;
+          ts.end_page = ((uintptr_t)addr + size) / page_size;
+          ts.state = thread_stack::known;
+        }
+        pthread_attr_destroy(&attr);
+      }
+#endif
+    }
+    return ts.state == thread_stack::known && page >= ts.first_page && page < ts.end_page;
+  }
+
+  // called with the page's shard lock held
+  bool retain(size_t page, size_t page_size)
+  {
+    thread_stack &ts = this_thread_stack;
+    if (ts.exiting || ts.num_retained >= MAX_RETAINED_PAGES_PER_THREAD || previously_failed.load())
+      return false;
+    if (!is_on_this_thread_stack(page, page_size))
+      return false;
+    if (num_retained_pages.fetch_add(1) >= MAX_RETAINED_PAGES)
+    {
+      --num_retained_pages;
+      return false;
+    }
+    static thread_local thread_stack_releaser releaser;
+    (void)releaser;
+    ts.retained[ts.num_retained++] = page;
+    return true;
+  }
+}
+
+namespace epee
+{
   size_t mlocker::get_page_size()
   {
-    CRITICAL_REGION_LOCAL(mutex());
-    if (page_size == 0)
-      page_size = query_page_size();
+    static const size_t page_size = query_page_size();
     return page_size;
   }
 
@@ -132,7 +256,6 @@ namespace epee
     if (page_size == 0)
       return;
 
-    CRITICAL_REGION_LOCAL(mutex());
     const size_t first = ((uintptr_t)ptr) / page_size;
     const size_t last = (((uintptr_t)ptr) + len - 1) / page_size;
     for (size_t page = first; page <= last; ++page)
@@ -149,55 +272,73 @@ namespace epee
     size_t page_size = get_page_size();
     if (page_size == 0)
       return;
-    CRITICAL_REGION_LOCAL(mutex());
     const size_t first = ((uintptr_t)ptr) / page_size;
     const size_t last = (((uintptr_t)ptr) + len - 1) / page_size;
     for (size_t page = first; page <= last; ++page)
       unlock_page(page);
     --num_locked_objects;
 
-    CATCH_ENTRY_L1("mlocker::lock", void());
+    CATCH_ENTRY_L1("mlocker::unlock", void());
   }
 
   size_t mlocker::get_num_locked_pages()
   {
-    CRITICAL_REGION_LOCAL(mutex());
-    return map().size();
+    return num_locked_pages;
   }
 
   size_t mlocker::get_num_locked_objects()
   {
-    CRITICAL_REGION_LOCAL(mutex());
     return num_locked_objects;
   }
 
+  size_t mlocker::get_num_retained_pages()
+  {
+    return num_retained_pages;
+  }
+
+  void mlocker::release_retained_pages()
+  {
+    const size_t page_size = get_page_size();
+    if (page_size != 0)
+      release_retained(this_thread_stack, page_size);
+  }
+
   void mlocker::lock_page(size_t page)
   {
-    std::pair<std::map<size_t, unsigned int>::iterator, bool> p = map().insert(std::make_pair(page, 1));
-    if (p.second)
+    const size_t page_size = get_page_size();
+    shard &s = shard_for(page);
+    CRITICAL_REGION_LOCAL(s.mutex);
+    page_state &state = s.pages[page];
+    if (state.refs++ == 0)
     {
-      do_lock((void*)(page * page_size), page_size);
-    }
-    else
-    {
-      ++p.first->second;
+      ++num_locked_pages;
+      if (!state.retained)
+        do_lock((void*)(page * page_size), page_size);
     }
   }
 
   void mlocker::unlock_page(size_t page)
   {
-    std::map<size_t, unsigned int>::iterator i = map().find(page);
-    if (i == map().end())
+    const size_t page_size = get_page_size();
+    shard &s = shard_for(page);
+    CRITICAL_REGION_LOCAL(s.mutex);
+    std::unordered_map<size_t, page_state>::iterator i = s.pages.find(page);
+    if (i == s.pages.end() || i->second.refs == 0)
     {
       MERROR("Attempt to unlock unlocked page at " << (void*)(page * page_size));
+      return;
     }
-    else
+    if (--i->second.refs)
+      return;
+    --num_locked_pages;
+    if (i->second.retained)
+      return;
+    if (retain(page, page_size))
     {
-      if (!--i->second)
-      {
-        map().erase(i);
-        do_unlock((void*)(page * page_size), page_size);
-      }
+      i->second.retained = true;
+      return;
     }
+    s.pages.erase(i);
+    do_unlock((void*)(page * page_size), page_size);
   }
 }
@@ -27,8 +27,13 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <string.h>
 #include <thread>
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
 #include <boost/asio/post.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/cerrno.hpp>
@@ -63,6 +68,28 @@ static void add_windows_root_certs(SSL_CTX *ctx) noexcept;
 
 namespace
 {
+  const std::string aes_cipher_list = "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-RSA-AES256-GCM-SHA384:ECDHE-RSA-CHACHA20-POLY1305";
+  const std::string chacha_cipher_list = "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-CHACHA20-POLY1305:ECDHE-RSA-AES256-GCM-SHA384:ECDHE-RSA-AES128-GCM-SHA256";
+  const std::string aes_ciphersuites = "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256";
+  const std::string chacha_ciphersuites = "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_256_GCM_SHA384:TLS_AES_128_GCM_SHA256";
+
+  std::atomic<std::uint64_t> handshakes_full{0};
+  std::atomic<std::uint64_t> handshakes_resumed{0};
+  std::atomic<std::uint64_t> handshakes_failed{0};
+
+  bool has_aes_hardware() noexcept
+  {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("aes");
+#elif defined(__aarch64__) && defined(__linux__) && defined(HWCAP_AES)
+    return getauxval(AT_HWCAP) & HWCAP_AES;
+#elif defined(__aarch64__) && defined(__APPLE__)
+    return true;
+#else
+    return false;
+#endif
+  }
+
   struct openssl_bio_free
   {
     void operator()(BIO* ptr) const noexcept
@@ -296,7 +323,10 @@ ssl_options_t::ssl_options_t(std::vector<std::vector<std::uint8_t>> fingerprints
     ca_path(std::move(ca_path)),
     auth(),
     support(ssl_support_t::e_ssl_support_enabled),
-    verification(ssl_verification_t::user_certificates)
+    verification(ssl_verification_t::user_certificates),
+    session_resumption(false),
+    cipher_list(),
+    ciphersuites()
 {
   std::sort(fingerprints_.begin(), fingerprints_.end());
 }
@@ -317,16 +347,33 @@ boost::asio::ssl::context ssl_options_t::create_context() const
   ssl_context.set_options(boost::asio::ssl::context::no_tlsv1_1);
 
   // only allow a select handful of tls v1.3 and v1.2 ciphers to be used
-  SSL_CTX_set_cipher_list(ssl_context.native_handle(), "ECDHE-ECDSA-CHACHA20-POLY1305-SHA256:ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-CHACHA20-POLY1305:ECDHE-RSA-AES256-GCM-SHA384:ECDHE-RSA-AES128-GCM-SHA256");
-
-  // set options on the SSL context for added security
+  // AES-GCM is much cheaper than ChaCha20 with AES instructions and much slower without them
   SSL_CTX *ctx = ssl_context.native_handle();
   CHECK_AND_ASSERT_THROW_MES(ctx, "Failed to get SSL context");
+  const bool aes_first = has_aes_hardware();
+  const std::string &ciphers = !cipher_list.empty() ? cipher_list : aes_first ? aes_cipher_list : chacha_cipher_list;
+  CHECK_AND_ASSERT_THROW_MES(SSL_CTX_set_cipher_list(ctx, ciphers.c_str()), "Failed to set SSL cipher list " << ciphers);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  const std::string &suites = !ciphersuites.empty() ? ciphersuites : aes_first ? aes_ciphersuites : chacha_ciphersuites;
+  CHECK_AND_ASSERT_THROW_MES(SSL_CTX_set_ciphersuites(ctx, suites.c_str()), "Failed to set SSL ciphersuites " << suites);
+#endif
+
+  // set options on the SSL context for added security
   SSL_CTX_clear_options(ctx, SSL_OP_LEGACY_SERVER_CONNECT); // SSL_CTX_SET_OPTIONS(3)
-  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF); // https://stackoverflow.com/questions/22378442
+  if (session_resumption)
+  {
+    // a session id context is required to resume sessions when client certificates are verified
+    static const unsigned char session_id_context[] = "epee";
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_session_id_context(ctx, session_id_context, sizeof(session_id_context) - 1);
+  }
+  else
+  {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF); // https://stackoverflow.com/questions/22378442
 #ifdef SSL_OP_NO_TICKET
-  SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET); // https://stackoverflow.com/questions/22378442
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET); // https://stackoverflow.com/questions/22378442
 #endif
+  }
 #ifdef SSL_OP_NO_RENEGOTIATION
   SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION);
 #endif
@@ -338,6 +385,10 @@ boost::asio::ssl::context ssl_options_t::create_context() const
 #endif
 #ifdef SSL_OP_CIPHER_SERVER_PREFERENCE
   SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
+#endif
+#ifdef SSL_OP_PRIORITIZE_CHACHA
+  // clients without AES instructions (most phones) list ChaCha20 first, let them have it
+  SSL_CTX_set_options(ctx, SSL_OP_PRIORITIZE_CHACHA);
 #endif
   SSL_CTX_set_ecdh_auto(ctx, 1);
 
@@ -642,15 +693,31 @@ bool ssl_options_t::handshake(
   };
   const auto ec = start_handshake();
 
+  count_ssl_handshake(socket.native_handle(), !ec);
   if (ec)
   {
     MERROR("SSL handshake failed, connection dropped: " << ec.message());
     return false;
   }
-  MDEBUG("SSL handshake success");
+  MDEBUG("SSL handshake success" << (SSL_session_reused(socket.native_handle()) ? " (resumed)" : ""));
   return true;
 }
 
+void count_ssl_handshake(SSL *ssl, const bool success) noexcept
+{
+  if (!success)
+    ++handshakes_failed;
+  else if (ssl && SSL_session_reused(ssl))
+    ++handshakes_resumed;
+  else
+    ++handshakes_full;
+}
+
+ssl_handshake_stats get_ssl_handshake_stats() noexcept
+{
+  return {handshakes_full.load(), handshakes_resumed.load(), handshakes_failed.load()};
+}
+
 bool ssl_support_from_string(ssl_support_t &ssl, boost::string_ref s)
 {
   if (s == "enabled")
@@ -114,7 +114,7 @@ namespace serialization
       CATCH_ENTRY("portable_storage::load_from_binary", false);
     }
     
-    hsection portable_storage::open_section(const std::string& section_name,  hsection hparent_section, bool create_if_notexist)
+    hsection portable_storage::open_section(const std::string_view section_name,  hsection hparent_section, bool create_if_notexist)
     {
       TRY_ENTRY();
       hparent_section = hparent_section ? hparent_section:&m_root;
@@ -138,7 +138,7 @@ namespace serialization
       CATCH_ENTRY("portable_storage::open_section", nullptr);
     }
     
-    bool portable_storage::get_value(const std::string& value_name, storage_entry& val, hsection hparent_section)
+    bool portable_storage::get_value(const std::string_view value_name, storage_entry& val, hsection hparent_section)
     {
       //TRY_ENTRY();
       if(!hparent_section) hparent_section = &m_root;
@@ -151,7 +151,7 @@ namespace serialization
       //CATCH_ENTRY("portable_storage::template<>get_value", false);
     }
     
-    storage_entry* portable_storage::find_storage_entry(const std::string& pentry_name, hsection psection)
+    storage_entry* portable_storage::find_storage_entry(const std::string_view pentry_name, hsection psection)
     {
       TRY_ENTRY();
       CHECK_AND_ASSERT(psection, nullptr);
@@ -163,7 +163,7 @@ namespace serialization
       CATCH_ENTRY("portable_storage::find_storage_entry", nullptr);
     }
     
-    hsection portable_storage::insert_new_section(const std::string& pentry_name, hsection psection)
+    hsection portable_storage::insert_new_section(const std::string_view pentry_name, hsection psection)
     {
       TRY_ENTRY();
       storage_entry* pse = insert_new_entry_get_storage_entry(pentry_name, psection, section());
@@ -172,7 +172,7 @@ namespace serialization
       CATCH_ENTRY("portable_storage::insert_new_section", nullptr);
     }
     
-    harray portable_storage::get_first_section(const std::string& sec_name, hsection& h_child_section, hsection hparent_section)
+    harray portable_storage::get_first_section(const std::string_view sec_name, hsection& h_child_section, hsection hparent_section)
     {
       TRY_ENTRY();
       if(!hparent_section) hparent_section = &m_root;
@@ -207,7 +207,7 @@ namespace serialization
       CATCH_ENTRY("portable_storage::get_next_section", false);
     }
     
-    harray portable_storage::insert_first_section(const std::string& sec_name, hsection& hinserted_childsection, hsection hparent_section)
+    harray portable_storage::insert_first_section(const std::string_view sec_name, hsection& hinserted_childsection, hsection hparent_section)
     {
       TRY_ENTRY();
       if(!hparent_section) hparent_section = &m_root;
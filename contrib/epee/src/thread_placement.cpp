@@ -0,0 +1,242 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <set>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include "misc_log_ex.h"
+#include "thread_placement.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "threads"
+
+namespace epee
+{
+namespace thread_placement
+{
+  struct member::entry
+  {
+    std::string group;
+#if defined(__linux__)
+    clockid_t clock;
+#endif
+  };
+
+  namespace
+  {
+    // CPU lists beyond this are surely a typo
+    constexpr unsigned max_cpu = 1u << 16;
+
+    struct group_state
+    {
+      std::set<const member::entry*> live;
+      uint64_t retired_us = 0;
+    };
+
+    // guards both maps below, and the live entries' clocks
+    boost::mutex &registry_mutex()
+    {
+      static boost::mutex mutex;
+      return mutex;
+    }
+
+    std::map<std::string, policy> &policies()
+    {
+      static std::map<std::string, policy> policies;
+      return policies;
+    }
+
+    std::map<std::string, group_state> &groups()
+    {
+      static std::map<std::string, group_state> groups;
+      return groups;
+    }
+
+    uint64_t entry_cpu_us(const member::entry &e)
+    {
+#if defined(__linux__)
+      timespec ts;
+      if (clock_gettime(e.clock, &ts))
+        return 0;
+      return ts.tv_sec * (uint64_t)1000000 + ts.tv_nsec / 1000;
+#else
+      return 0;
+#endif
+    }
+
+    bool parse_cpu(const std::string &s, unsigned &cpu)
+    {
+      if (s.empty() || s.size() > 5 || s.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+      cpu = std::stoul(s);
+      return cpu < max_cpu;
+    }
+
+    void apply_policy(const std::string &group, const policy &p)
+    {
+#if defined(__linux__)
+      if (!p.cpus.empty())
+      {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (unsigned cpu: p.cpus)
+          if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpuset);
+        const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if (err)
+          MWARNING("Failed to pin " << group << " thread to its CPUs: " << std::strerror(err));
+      }
+      if (p.batch)
+      {
+        sched_param param = {};
+        const int err = pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+        if (err)
+          MWARNING("Failed to set batch scheduling for " << group << " thread: " << std::strerror(err));
+      }
+      // nice levels are per thread on Linux, given the thread id
+      if (p.nice && setpriority(PRIO_PROCESS, syscall(SYS_gettid), p.nice))
+        MWARNING("Failed to set nice level " << p.nice << " for " << group << " thread: " << std::strerror(errno));
+#elif defined(_WIN32)
+      if (!p.cpus.empty())
+      {
+        DWORD_PTR mask = 0;
+        for (unsigned cpu: p.cpus)
+          if (cpu < sizeof(DWORD_PTR) * 8)
+            mask |= (DWORD_PTR)1 << cpu;
+        if (!mask || !SetThreadAffinityMask(GetCurrentThread(), mask))
+          MWARNING("Failed to pin " << group << " thread to its CPUs");
+      }
+      if (p.nice || p.batch)
+        MWARNING("Nice levels and batch scheduling are not supported on this platform");
+#else
+      if (!p.cpus.empty() || p.nice || p.batch)
+        MWARNING("Thread placement is not supported on this platform");
+#endif
+    }
+  }
+
+  bool parse_cpu_list(const std::string &list, std::vector<unsigned> &cpus)
+  {
+    std::set<unsigned> result;
+    size_t start = 0;
+    while (start <= list.size())
+    {
+      size_t end = list.find(',', start);
+      if (end == std::string::npos)
+        end = list.size();
+      const std::string range = list.substr(start, end - start);
+      const size_t dash = range.find('-');
+      unsigned first, last;
+      if (dash == std::string::npos)
+      {
+        if (!parse_cpu(range, first))
+          return false;
+        last = first;
+      }
+      else if (!parse_cpu(range.substr(0, dash), first) || !parse_cpu(range.substr(dash + 1), last) || first > last)
+        return false;
+      for (unsigned cpu = first; cpu <= last; ++cpu)
+        result.insert(cpu);
+      start = end + 1;
+    }
+    cpus.assign(result.begin(), result.end());
+    return true;
+  }
+
+  void set_policy(const std::string &group, const policy &p)
+  {
+    const boost::lock_guard<boost::mutex> lock(registry_mutex());
+    policies()[group] = p;
+  }
+
+  std::vector<usage> get_usage()
+  {
+    const boost::lock_guard<boost::mutex> lock(registry_mutex());
+    std::vector<usage> result;
+    result.reserve(groups().size());
+    for (const auto &g: groups())
+    {
+      uint64_t cpu_us = g.second.retired_us;
+      for (const member::entry *e: g.second.live)
+        cpu_us += entry_cpu_us(*e);
+      result.push_back({g.first, cpu_us, (unsigned)g.second.live.size()});
+    }
+    return result;
+  }
+
+  member::member(const std::string &group)
+    : m_entry(new entry{group})
+  {
+#if defined(__linux__)
+    if (pthread_getcpuclockid(pthread_self(), &m_entry->clock))
+      m_entry->clock = CLOCK_THREAD_CPUTIME_ID;
+#endif
+    policy p;
+    {
+      const boost::lock_guard<boost::mutex> lock(registry_mutex());
+      groups()[group].live.insert(m_entry);
+      const auto it = policies().find(group);
+      if (it != policies().end())
+        p = it->second;
+    }
+    apply_policy(group, p);
+  }
+
+  member::~member()
+  {
+    try
+    {
+      const boost::lock_guard<boost::mutex> lock(registry_mutex());
+      group_state &g = groups()[m_entry->group];
+      g.retired_us += entry_cpu_us(*m_entry);
+      g.live.erase(m_entry);
+    }
+    catch (...) { /* ignore */ }
+    delete m_entry;
+  }
+
+  uint64_t member::cpu_us() const
+  {
+    return entry_cpu_us(*m_entry);
+  }
+}
+}
@@ -162,6 +162,16 @@ const command_line::arg_descriptor<bool> arg_db_salvage  = {
 , "Try to salvage a blockchain database if it seems corrupted"
 , false
 };
+const command_line::arg_descriptor<std::string> arg_db_cold_path  = {
+  "db-cold-path"
+, "Keep prunable transaction data in a separate database at this path, eg on a larger, slower disk"
+, ""
+};
+const command_line::arg_descriptor<bool> arg_db_tx_index  = {
+  "db-tx-index"
+, "Index transactions by type and outputs by asset type and height, for explorer range queries"
+, false
+};
 
 BlockchainDB *new_db()
 {
@@ -172,6 +182,8 @@ void BlockchainDB::init_options(boost::program_options::options_description& des
 {
   command_line::add_arg(desc, arg_db_sync_mode);
   command_line::add_arg(desc, arg_db_salvage);
+  command_line::add_arg(desc, arg_db_cold_path);
+  command_line::add_arg(desc, arg_db_tx_index);
 }
 
 void BlockchainDB::pop_block()
@@ -265,6 +277,32 @@ void BlockchainDB::add_transaction(const crypto::hash& blk_hash, const std::pair
   }
 }
 
+void add_block_emission(const block& blk, block_emission_totals& totals)
+{
+  std::string asset_type;
+  for (const auto &vout: blk.miner_tx.vout)
+  {
+    if (!get_output_asset_type(vout, asset_type))
+      throw std::runtime_error("Failed to get output asset type");
+    totals.get(asset_type).coinbase += vout.amount;
+  }
+  if (blk.miner_tx.amount_burnt)
+    totals.get(blk.miner_tx.vout.empty() ? "SAL" : asset_type).coinbase += blk.miner_tx.amount_burnt;
+  for (const auto &vout: blk.protocol_tx.vout)
+  {
+    if (!get_output_asset_type(vout, asset_type))
+      throw std::runtime_error("Failed to get output asset type");
+    totals.get(asset_type).protocol += vout.amount;
+  }
+}
+
+void add_tx_emission(const transaction& tx, block_emission_totals& totals)
+{
+  emission_totals_asset &asset = totals.get(tx.source_asset_type);
+  asset.fees += get_tx_fee(tx);
+  asset.burnt += tx.amount_burnt;
+}
+
 uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
                                 , size_t block_weight
                                 , uint64_t long_term_block_weight
@@ -306,10 +344,10 @@ uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
 
     // count the current block's rct outs by asset type
     for (auto& vout: blk.miner_tx.vout) {
-      std::string asset_type;
-      if (!get_output_asset_type(vout, asset_type))
+      oracle::asset_id asset;
+      if (!get_output_asset_id(vout, asset))
         throw std::runtime_error("Failed to get output asset type");
-      num_rct_outs_by_asset_type.add(asset_type, 1);
+      num_rct_outs_by_asset_type.add(asset, 1);
     }
   }
 
@@ -345,20 +383,29 @@ uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
     add_transaction(blk_hash, tx, &tx_hash);
     for (const auto &vout: tx.first.vout)
     {
-      std::string asset_type;
-      if (!get_output_asset_type(vout, asset_type))
-        throw std::runtime_error("Failed to get output asset type");
-      if (vout.amount == 0) {
-        ++num_rct_outs;
-        num_rct_outs_by_asset_type.add(asset_type, 1);
-      }
-
-      // Is this a CONVERT TX?
+      // Is this a CONVERT TX? The tallies are keyed by asset type string, other txs only need the id
       if (tx.first.type == cryptonote::transaction_type::CONVERT) {
+        std::string asset_type;
+        if (!get_output_asset_type(vout, asset_type))
+          throw std::runtime_error("Failed to get output asset type");
+        if (vout.amount == 0) {
+          ++num_rct_outs;
+          num_rct_outs_by_asset_type.add(asset_type, 1);
+        }
+
         // Update the amount tallies by ADDING the burnt amount
         if (slippage_counts.count(asset_type) == 0)
           slippage_counts[asset_type] = 0;
         slippage_counts[asset_type] += tx.first.amount_burnt;
+        continue;
+      }
+
+      oracle::asset_id asset;
+      if (!get_output_asset_id(vout, asset))
+        throw std::runtime_error("Failed to get output asset type");
+      if (vout.amount == 0) {
+        ++num_rct_outs;
+        num_rct_outs_by_asset_type.add(asset, 1);
       }
     }
 
@@ -379,13 +426,14 @@ uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
   boost::multiprecision::int128_t slippage_total_128 = 0;
   uint64_t slippage_total = 0;
   if (blk.major_version >= HF_VERSION_ENABLE_CONVERT) {
+    // the SAL price is the same for every tally, so look it up in the record once per block
+    const boost::multiprecision::int128_t sal_price = blk.pricing_record["SAL"];
     for (const auto& tally: slippage_counts) {
       boost::multiprecision::int128_t slippage_amount_128 = 0;
       if (tally.first == "SAL") {
         slippage_amount_128 = tally.second;
       } else {
         // Sanity check - do we have a price for both source asset type and SAL in the PR?
-        boost::multiprecision::int128_t sal_price = blk.pricing_record["SAL"];
         boost::multiprecision::int128_t asset_price = blk.pricing_record[tally.first];
         if (sal_price == 0) {
           // No price available - bail out, because block is invalid
@@ -421,6 +469,61 @@ uint64_t BlockchainDB::add_block( const std::pair<block, blobdata>& blck
   // call out to subclass implementation to add the block & metadata
   time1 = epee::misc_utils::get_tick_count();
   add_block(blk, block_weight, long_term_block_weight, cumulative_difficulty, coins_generated, num_rct_outs, num_rct_outs_by_asset_type, blk_hash, slippage_total, yield_total, audit_total, nettype, ybi, abi);
+
+  // build the compact scan record now, while the transactions are at hand
+  block_scan_record scan_record;
+  scan_record.block_hash = blk_hash;
+  scan_record.txs.resize(2 + txs.size());
+  if (!get_tx_scan_record(blk.miner_tx, get_transaction_hash(blk.miner_tx), scan_record.txs[0]) ||
+      !get_tx_scan_record(blk.protocol_tx, get_transaction_hash(blk.protocol_tx), scan_record.txs[1]))
+    throw std::runtime_error("Failed to build scan record for block's miner/protocol tx");
+  for (size_t i = 0; i < txs.size(); ++i)
+    if (!get_tx_scan_record(txs[i].first, blk.tx_hashes[i], scan_record.txs[2 + i]))
+      throw std::runtime_error("Failed to build scan record for block's tx");
+  add_block_scan_record(prev_height, t_serializable_object_to_blob(scan_record));
+
+  // and the block's own entry of the supply series, which the db folds into the coarser buckets
+  supply_series_entry series_block = AUTO_VAL_INIT(series_block);
+  series_block.first_height = series_block.last_height = prev_height;
+  series_block.first_timestamp = series_block.last_timestamp = blk.timestamp;
+  series_block.slippage_total = ybi.slippage_total_this_block;
+  if (ybi.locked_coins_tally == 0)
+    series_block.burnt_total = ybi.slippage_total_this_block;
+  else
+    series_block.yield_total = ybi.slippage_total_this_block;
+  series_block.staked_total = ybi.locked_coins_this_block;
+  series_block.audit_total = abi.locked_coins_this_block;
+  series_block.locked_coins_tally = ybi.locked_coins_tally;
+  series_block.network_health_percentage = ybi.network_health_percentage;
+  for (const auto &supply: get_circulating_supply())
+  {
+    supply_series_asset asset = AUTO_VAL_INIT(asset);
+    asset.asset_type = supply.first;
+    asset.circulating_supply = supply.second;
+    series_block.assets.push_back(std::move(asset));
+  }
+  for (const auto &price: blk.pricing_record.assets)
+  {
+    auto it = std::find_if(series_block.assets.begin(), series_block.assets.end(), [&price](const supply_series_asset &a){ return a.asset_type == price.asset_type; });
+    if (it == series_block.assets.end())
+    {
+      supply_series_asset asset = AUTO_VAL_INIT(asset);
+      asset.asset_type = price.asset_type;
+      it = series_block.assets.insert(series_block.assets.end(), std::move(asset));
+    }
+    it->spot_price = price.spot_price;
+    it->ma_price = price.ma_price;
+  }
+  add_supply_series_block(prev_height, series_block);
+
+  // and the running emission and fee sums, so a range of blocks is two lookups
+  block_emission_totals totals = AUTO_VAL_INIT(totals);
+  if (prev_height == 0 || !get_block_emission_totals(prev_height - 1, totals))
+    totals.first_height = prev_height;
+  add_block_emission(blk, totals);
+  for (const auto &tx: txs)
+    add_tx_emission(tx.first, totals);
+  add_block_emission_totals(prev_height, totals);
   TIME_MEASURE_FINISH(time1);
   time_add_block1 += time1;
 
@@ -512,6 +615,14 @@ bool BlockchainDB::get_tx(const crypto::hash& h, cryptonote::transaction &tx) co
   return true;
 }
 
+void BlockchainDB::has_key_images(const epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const
+{
+  spent.clear();
+  spent.reserve(key_images.size());
+  for (const crypto::key_image &ki: key_images)
+    spent.push_back(has_key_image(ki));
+}
+
 bool BlockchainDB::get_pruned_tx(const crypto::hash& h, cryptonote::transaction &tx) const
 {
   blobdata bd;
@@ -539,6 +650,49 @@ transaction BlockchainDB::get_pruned_tx(const crypto::hash& h) const
   return tx;
 }
 
+int BlockchainDB::get_yield_block_infos(const uint64_t start_height, const uint64_t end_height, std::vector<yield_block_info>& ybis) const
+{
+  ybis.clear();
+  for (uint64_t height = start_height; height < end_height; ++height)
+  {
+    yield_block_info ybi;
+    int result = get_yield_block_info(height, ybi);
+    if (result)
+      return result;
+    ybis.push_back(ybi);
+  }
+  return 0;
+}
+
+blobdata BlockchainDB::make_block_scan_record_blob(const uint64_t height) const
+{
+  const block blk = get_block_from_height(height);
+
+  block_scan_record scan_record;
+  scan_record.block_hash = get_block_hash(blk);
+  scan_record.txs.resize(2 + blk.tx_hashes.size());
+  if (!get_tx_scan_record(blk.miner_tx, get_transaction_hash(blk.miner_tx), scan_record.txs[0]) ||
+      !get_tx_scan_record(blk.protocol_tx, get_transaction_hash(blk.protocol_tx), scan_record.txs[1]))
+    throw DB_ERROR("Failed to build scan record for block's miner/protocol tx");
+  for (size_t i = 0; i < blk.tx_hashes.size(); ++i)
+  {
+    transaction tx;
+    if (!get_pruned_tx(blk.tx_hashes[i], tx))
+      throw DB_ERROR("Failed to get pruned transaction from the db");
+    if (!get_tx_scan_record(tx, blk.tx_hashes[i], scan_record.txs[2 + i]))
+      throw DB_ERROR("Failed to build scan record for block's tx");
+  }
+  return t_serializable_object_to_blob(scan_record);
+}
+
+void BlockchainDB::get_block_scan_record_blobs(const uint64_t start_height, const size_t count, std::vector<blobdata>& blobs) const
+{
+  blobs.clear();
+  const uint64_t end_height = std::min<uint64_t>(height(), start_height + count);
+  for (uint64_t h = start_height; h < end_height; ++h)
+    blobs.push_back(make_block_scan_record_blob(h));
+}
+
 void BlockchainDB::reset_stats()
 {
   num_calls = 0;
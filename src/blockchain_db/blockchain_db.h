@@ -40,6 +40,7 @@
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/difficulty.h"
 #include "cryptonote_basic/hardfork.h"
+#include "cryptonote_basic/supply_series.h"
 #include "cryptonote_protocol/enums.h"
 #include "oracle/asset_types.h"
 
@@ -107,6 +108,8 @@ typedef std::pair<crypto::hash, uint64_t> tx_out_index;
 
 extern const command_line::arg_descriptor<std::string> arg_db_sync_mode;
 extern const command_line::arg_descriptor<bool, false> arg_db_salvage;
+extern const command_line::arg_descriptor<std::string> arg_db_cold_path;
+extern const command_line::arg_descriptor<bool> arg_db_tx_index;
 
 enum class relay_category : uint8_t
 {
@@ -182,8 +185,10 @@ struct txpool_tx_meta_t
   uint8_t dandelionpp_stem : 1;
   uint8_t is_forwarding: 1;
   uint8_t bf_padding: 3;
+  uint8_t validated_version; //!< HF version the tx last fully verified under, 0 if never
+  uint8_t validated_top[8]; //!< leading bytes of the top block id at that verification
 
-  uint8_t padding[19]; // till 256 bytes
+  uint8_t padding[10]; // till 256 bytes
 
   void set_relay_method(relay_method method) noexcept;
   relay_method get_relay_method() const noexcept;
@@ -392,6 +397,27 @@ class KEY_IMAGE_EXISTS : public DB_EXCEPTION
  * End of Exception Definitions
  ***********************************/
 
+//! a transaction found in the tx type index
+struct tx_index_entry
+{
+  uint64_t height;
+  uint64_t tx_id;
+  crypto::hash tx_hash;
+};
+
+//! an output found in the output asset type index
+struct output_index_entry
+{
+  uint64_t height;
+  uint64_t output_id;
+  uint64_t asset_type_output_index;
+};
+
+//! add a block's miner and protocol tx payouts to the emission sums
+void add_block_emission(const block& blk, block_emission_totals& totals);
+
+//! add a tx's fee and burnt amount to the emission sums
+void add_tx_emission(const transaction& tx, block_emission_totals& totals);
 
 /**
  * @brief The BlockchainDB backing store interface declaration/contract
@@ -459,6 +485,45 @@ private:
    */
   virtual void remove_block() = 0;
 
+  /**
+   * @brief store the compact scan record of the block just added
+   *
+   * Called by BlockchainDB::add_block once the block and its transactions
+   * have been added.  The record is removed again by remove_block().  The
+   * default implementation stores nothing, in which case
+   * get_block_scan_record_blobs() builds records on demand.
+   *
+   * @param height the height of the block
+   * @param blob the binary serialized block_scan_record
+   */
+  virtual void add_block_scan_record(const uint64_t height, const blobdata& blob) { }
+
+  /**
+   * @brief fold the block just added into the supply series
+   *
+   * Called by BlockchainDB::add_block once the block and its transactions
+   * have been added, so the circulating supply includes the block.  The
+   * block is removed from the series again by remove_block().  The default
+   * implementation keeps no series.
+   *
+   * @param height the height of the block
+   * @param block the statistics of the block alone
+   */
+  virtual void add_supply_series_block(const uint64_t height, const supply_series_entry& block) { }
+
+  /**
+   * @brief store the emission and fee sums through the block just added
+   *
+   * Called by BlockchainDB::add_block with the sums of the previous block,
+   * as returned by get_block_emission_totals(), plus the block's own.  The
+   * entry is removed again by remove_block().  The default implementation
+   * stores nothing.
+   *
+   * @param height the height of the block
+   * @param totals the sums through the block
+   */
+  virtual void add_block_emission_totals(const uint64_t height, const block_emission_totals& totals) { }
+
   /**
    * @brief store the transaction and its metadata
    *
@@ -609,6 +674,15 @@ protected:
    */
   void add_transaction(const crypto::hash& blk_hash, const std::pair<transaction, blobdata_ref>& tx, const crypto::hash* tx_hash_ptr = NULL, const crypto::hash* tx_prunable_hash_ptr = NULL);
 
+  /**
+   * @brief build the binary serialized block_scan_record of a stored block
+   *
+   * @param height the height of the block
+   *
+   * @return the serialized record
+   */
+  blobdata make_block_scan_record_blob(const uint64_t height) const;
+
   mutable uint64_t time_tx_exists = 0;  //!< a performance metric
   uint64_t time_commit1 = 0;  //!< a performance metric
   bool m_auto_remove_logs = true;  //!< whether or not to automatically remove old logs
@@ -867,6 +941,41 @@ public:
   virtual void block_rtxn_stop() const = 0;
   virtual void block_rtxn_abort() const = 0;
 
+  /**
+   * @brief logs read txns that have been held open for longer than a threshold
+   *
+   * A read txn pins the snapshot it started at, so pages freed by later
+   * writes can't be reused while it is open, and the db keeps growing.
+   *
+   * @param threshold_seconds how long a read txn may be held before it is reported
+   * @return the number of read txns reported
+   */
+  virtual size_t report_long_read_txns(uint64_t threshold_seconds) const { return 0; }
+
+  /**
+   * @brief sets a separate location for the prunable tx data
+   *
+   * Prunable data makes up most of the db but is rarely read, so it can be
+   * kept on a slower, larger disk than the tables every block touches.
+   * Must be called before open(). An empty path keeps everything together.
+   *
+   * @param path the directory to keep the prunable data in, or empty
+   */
+  virtual void set_cold_storage_path(const std::string& path) {}
+
+  /**
+   * @brief sets whether to keep the tx type and output asset type indexes
+   *
+   * The indexes let explorers list transactions of a type, or outputs of an
+   * asset type, over a range of heights without scanning the chain.  Blocks
+   * already in the db when the indexes are first enabled are not indexed;
+   * opening the db with them disabled drops them.  Must be called before
+   * open().
+   *
+   * @param enabled whether to keep the indexes
+   */
+  virtual void set_tx_index(bool enabled) {}
+
   virtual void set_hard_fork(HardFork* hf);
 
   // adds a block with the given metadata to the top of the blockchain, returns the new height
@@ -1607,6 +1716,17 @@ public:
    */
   virtual bool has_key_image(const crypto::key_image& img) const = 0;
 
+  /**
+   * @brief check if several key images are stored as spent
+   *
+   * The default checks them one at a time; a subclass may probe them in
+   * its own storage order instead.
+   *
+   * @param key_images the key images to check for
+   * @param spent return-by-reference whether each image is present, in the same order
+   */
+  virtual void has_key_images(const epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const;
+
   /**
    * @brief add a txpool transaction
    *
@@ -1711,6 +1831,25 @@ public:
    */
   virtual bool check_pruning() = 0;
 
+  /**
+   * @brief prunes part of the blockchain, carrying on from where the last call stopped
+   *
+   * Sets the pruning seed on the first call, like prune_blockchain, then
+   * visits at most max_records transactions per call, so a caller can prune
+   * a live database a little at a time.
+   *
+   * @param max_records the number of transactions to visit in this call
+   * @param pruning_seed the seed to use, 0 for default (highly recommended)
+   * @return true iff the whole blockchain has now been pruned
+   */
+  virtual bool prune_blockchain_step(size_t max_records, uint32_t pruning_seed = 0) = 0;
+
+  /**
+   * @brief writes a compacted copy of the database, leaving out free pages
+   * @param path the directory to write the copy to, which must exist and be empty
+   */
+  virtual void copy_compacted(const std::string& path) const = 0;
+
   /**
    * @brief get the max block size
    */
@@ -1792,6 +1931,24 @@ public:
    */
   virtual bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const = 0;
 
+  /**
+   * @brief runs a function over every raw record of the consensus state tables
+   *
+   * The consensus state is what a node needs to validate new blocks without
+   * replaying history: outputs, spent key images, supply tallies, yield and
+   * audit data, and the hard fork versions.  Records are passed table by
+   * table, in the database's key order, from a single read transaction, so
+   * the walk is a consistent view of the state at the current top block.
+   *
+   * If any call to the function returns false, the subclass should stop and
+   * return false.  Otherwise, the subclass returns true.
+   *
+   * @param std::function fn the function to run, given the table name, key and value
+   *
+   * @return false if the function returns false for any record, otherwise true
+   */
+  virtual bool for_all_state_records(std::function<bool(const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value)>) const = 0;
+
   /**
    * @brief runs a function over a range of blocks
    *
@@ -1831,6 +1988,29 @@ public:
    */
   virtual bool for_all_transactions(std::function<bool(const crypto::hash&, const cryptonote::transaction&)>, bool pruned) const = 0;
 
+  /**
+   * @brief runs a function over a range of transactions, in storage order
+   *
+   * The subclass should run the passed function for each transaction with
+   * an id in [tx_id_start, tx_id_end), in increasing id order, passing
+   * (tx_id, pruned transaction) as its parameters.  Unlike
+   * for_all_transactions, this walks the transactions sequentially, and
+   * disjoint ranges can be walked from different threads.
+   *
+   * If any call to the function returns false, the subclass should return
+   * false.  Otherwise, the subclass returns true.
+   *
+   * The subclass should throw DB_ERROR if any of the expected values are
+   * not found.
+   *
+   * @param tx_id_start the first transaction id
+   * @param tx_id_end one past the last transaction id
+   * @param std::function fn the function to run
+   *
+   * @return false if the function returns false for any transaction, otherwise true
+   */
+  virtual bool for_transactions_range(uint64_t tx_id_start, uint64_t tx_id_end, const std::function<bool(uint64_t, const cryptonote::transaction&)> &f) const = 0;
+
   /**
    * @brief runs a function over all outputs stored
    *
@@ -1929,12 +2109,114 @@ public:
    */
   virtual uint64_t get_database_size() const = 0;
 
+  /**
+   * @brief get how much of the database is currently held in the page cache
+   *
+   * @return the resident bytes, or 0 if the backend or platform can't tell
+   */
+  virtual uint64_t get_database_resident_size() const { return 0; }
+
   virtual int get_audit_block_info(const uint64_t height, audit_block_info& abi) const = 0;
   virtual int get_audit_tx_info(const uint64_t height, std::vector<yield_tx_info>& ati_container) const = 0;
 
   virtual int get_yield_block_info(const uint64_t height, yield_block_info& ybi) const = 0;
+
+  /**
+   * @brief fetch the yield_block_info entries for a range of heights
+   *
+   * The default implementation fetches each height in turn; implementations
+   * should override this with a sequential read where possible.
+   *
+   * @param start_height the first height to fetch
+   * @param end_height one past the last height to fetch
+   * @param ybis return-by-reference the entries, in ascending height order
+   *
+   * @return 0 on success, non-zero if any of the entries could not be found
+   */
+  virtual int get_yield_block_infos(const uint64_t start_height, const uint64_t end_height, std::vector<yield_block_info>& ybis) const;
+
   virtual int get_yield_tx_info(const uint64_t height, std::vector<yield_tx_info>& yti_container) const = 0;
 
+  /**
+   * @brief fetch the compact scan records for a range of heights
+   *
+   * The default implementation builds each record from the stored block and
+   * its pruned transactions; implementations should override this with a
+   * sequential read of records stored by add_block_scan_record().
+   *
+   * @param start_height the first height to fetch
+   * @param count the maximum number of records to fetch
+   * @param blobs return-by-reference the binary serialized block_scan_records, in ascending height order
+   */
+  virtual void get_block_scan_record_blobs(const uint64_t start_height, const size_t count, std::vector<blobdata>& blobs) const;
+
+  /**
+   * @brief fetch a window of the supply series
+   *
+   * Returns the buckets of the given granularity that overlap the height
+   * range, in ascending height order.  Blocks added before the series was
+   * kept have no entries.  The default implementation keeps no series.
+   *
+   * @param granularity which resolution to read
+   * @param start_height the first height of the window
+   * @param end_height the last height of the window, inclusive
+   * @param max_count the maximum number of entries to return
+   * @param entries return-by-reference the entries found
+   */
+  virtual void get_supply_series(const supply_series_granularity granularity, const uint64_t start_height, const uint64_t end_height, const size_t max_count, std::vector<supply_series_entry>& entries) const { entries.clear(); }
+
+  /**
+   * @brief fetch the emission and fee sums through a block
+   *
+   * Blocks added before the sums were stored have none.  The default
+   * implementation stores none.
+   *
+   * @param height the height of the block
+   * @param totals return-by-reference the sums through the block
+   *
+   * @return true if the block has sums stored, otherwise false
+   */
+  virtual bool get_block_emission_totals(const uint64_t height, block_emission_totals& totals) const { return false; }
+
+  /**
+   * @brief check whether the tx type and output asset type indexes are kept
+   *
+   * @param height return-by-reference the first height the indexes cover
+   *
+   * @return true if the indexes are kept, otherwise false
+   */
+  virtual bool get_tx_index_height(uint64_t& height) const { return false; }
+
+  /**
+   * @brief list transactions of a type from the tx type index
+   *
+   * Entries are in ascending (height, tx id) order, starting at start_tx_id
+   * within start_height, so the next page starts after the last entry.
+   * Nothing is returned if the index is not kept.
+   *
+   * @param tx_type the transaction_type to list
+   * @param start_height the first height to list
+   * @param start_tx_id the first tx id to list at start_height
+   * @param end_height the last height to list, inclusive
+   * @param max_count the maximum number of entries to return
+   * @param entries return-by-reference the transactions found
+   */
+  virtual void get_txs_by_type(const uint8_t tx_type, const uint64_t start_height, const uint64_t start_tx_id, const uint64_t end_height, const size_t max_count, std::vector<tx_index_entry>& entries) const { entries.clear(); }
+
+  /**
+   * @brief list outputs of an asset type from the output asset type index
+   *
+   * As get_txs_by_type(), in ascending (height, output id) order.
+   *
+   * @param asset_type the asset type to list
+   * @param start_height the first height to list
+   * @param start_output_id the first output id to list at start_height
+   * @param end_height the last height to list, inclusive
+   * @param max_count the maximum number of entries to return
+   * @param entries return-by-reference the outputs found
+   */
+  virtual void get_outputs_by_asset_type(const std::string& asset_type, const uint64_t start_height, const uint64_t start_output_id, const uint64_t end_height, const size_t max_count, std::vector<output_index_entry>& entries) const { entries.clear(); }
+
   virtual int get_carrot_yield_tx_info(const uint64_t height, std::vector<yield_tx_info_carrot>& yti_container) const = 0;
 
   
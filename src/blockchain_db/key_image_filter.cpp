@@ -0,0 +1,105 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "key_image_filter.h"
+
+namespace
+{
+  inline uint64_t mix64(uint64_t x)
+  {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+  }
+}
+
+namespace cryptonote
+{
+  key_image_filter::key_image_filter():
+    m_num_blocks(0), m_capacity(0), m_salt(0), m_count(0), m_ready(false)
+  {
+  }
+
+  void key_image_filter::reset(uint64_t capacity)
+  {
+    m_ready.store(false, std::memory_order_release);
+    m_capacity = capacity;
+    m_num_blocks = std::max<uint64_t>(1, (capacity * BITS_PER_KEY + WORDS_PER_BLOCK * 64 - 1) / (WORDS_PER_BLOCK * 64));
+    m_words.reset(new std::atomic<uint64_t>[m_num_blocks * WORDS_PER_BLOCK]);
+    // key images are chosen by whoever spends, so don't let them pick where they land
+    m_salt = crypto::rand<uint64_t>();
+    clear();
+  }
+
+  void key_image_filter::clear()
+  {
+    for (uint64_t i = 0; i < m_num_blocks * WORDS_PER_BLOCK; ++i)
+      m_words[i].store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+  }
+
+  void key_image_filter::locate(const crypto::key_image &ki, uint64_t &block, uint64_t &bits) const
+  {
+    uint64_t w[2];
+    static_assert(sizeof(ki) >= sizeof(w), "key image too small");
+    memcpy(w, &ki, sizeof(w));
+    block = mix64(w[0] ^ m_salt) % m_num_blocks;
+    bits = mix64(w[1] ^ m_salt);
+  }
+
+  void key_image_filter::insert(const crypto::key_image &ki)
+  {
+    if (!m_words)
+      return;
+    uint64_t block, bits;
+    locate(ki, block, bits);
+    std::atomic<uint64_t> *words = &m_words[block * WORDS_PER_BLOCK];
+    for (uint64_t i = 0; i < WORDS_PER_BLOCK; ++i)
+      words[i].fetch_or(1ull << ((bits >> (i * 8)) & 63), std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool key_image_filter::maybe_contains(const crypto::key_image &ki) const
+  {
+    if (!is_ready())
+      return true;
+    uint64_t block, bits;
+    locate(ki, block, bits);
+    const std::atomic<uint64_t> *words = &m_words[block * WORDS_PER_BLOCK];
+    for (uint64_t i = 0; i < WORDS_PER_BLOCK; ++i)
+      if (!(words[i].load(std::memory_order_relaxed) & (1ull << ((bits >> (i * 8)) & 63))))
+        return false;
+    return true;
+  }
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "crypto/crypto.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief an in-memory filter over the spent key images, to skip most db lookups
+   *
+   * A split block bloom filter: a key image sets one bit in each of the eight
+   * words of a 64 byte block, so a lookup touches a single cache line. It can
+   * only tell a key image is definitely not there, so nothing is ever removed:
+   * the bits of popped key images stay set, and just cost a db lookup.
+   *
+   * Lookups and inserts may run concurrently, but reset must not race either.
+   */
+  class key_image_filter
+  {
+  public:
+    key_image_filter();
+
+    //! sizes the filter for about capacity key images and empties it, leaving it not ready
+    void reset(uint64_t capacity);
+    //! empties the filter, keeping its size and readiness
+    void clear();
+    //! marks the filter as holding every key image in the db, so lookups can trust it
+    void set_ready() { m_ready.store(true, std::memory_order_release); }
+    bool is_ready() const { return m_ready.load(std::memory_order_acquire); }
+
+    void insert(const crypto::key_image &ki);
+    //! false if ki is definitely not in the set, true if it may be or the filter is not ready
+    bool maybe_contains(const crypto::key_image &ki) const;
+
+    uint64_t size() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t capacity() const { return m_capacity; }
+    uint64_t memory_size() const { return m_num_blocks * WORDS_PER_BLOCK * sizeof(uint64_t); }
+
+  private:
+    static constexpr uint64_t WORDS_PER_BLOCK = 8;
+    static constexpr uint64_t BITS_PER_KEY = 16;
+
+    void locate(const crypto::key_image &ki, uint64_t &block, uint64_t &bits) const;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+    uint64_t m_num_blocks;
+    uint64_t m_capacity;
+    uint64_t m_salt;
+    std::atomic<uint64_t> m_count;
+    std::atomic<bool> m_ready;
+  };
+}
@@ -32,16 +32,26 @@
 #include <boost/filesystem/fstream.hpp>
 #include <boost/format.hpp>
 #include <boost/circular_buffer.hpp>
+#include <boost/endian/conversion.hpp>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
 #include <memory>  // std::unique_ptr
 #include <cstring>  // memcpy
+#include <chrono>
+#include <set>
 
 #ifdef WIN32
 #include <winioctl.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include "string_tools.h"
 #include "common/util.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "common/pruning.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_core/cryptonote_tx_utils.h"
@@ -64,7 +74,7 @@ using epee::string_tools::pod_to_hex;
 using namespace crypto;
 
 // Increase when the DB structure changes
-#define VERSION 2
+#define VERSION 4
 
 namespace
 {
@@ -222,6 +232,13 @@ namespace
  * audit_block_data block height {locked_coins, lc_total}
  * audit_tx_data    block height {txn hash, locked_coins, return_address}
  *
+ * block_scan_records block height {block_scan_record}
+ * block_emission_totals block height {emission and fee sums through the block}
+ *
+ * Optional, with --db-tx-index:
+ * tx_type_index    {tx type, block height, txn ID}                 txn hash
+ * output_asset_index {asset type, block height, output ID}         asset type output index
+ *
  * Note: where the data items are of uniform size, DUPFIXED tables have
  * been used to save space. In most of these cases, a dummy "zerokval"
  * key is used when accessing the table; the Key listed above will be
@@ -299,6 +316,11 @@ const char* const LMDB_YIELD_BLOCKS = "yield_blocks";
 const char* const LMDB_AUDIT_TXS = "audit_txs";
 const char* const LMDB_AUDIT_BLOCKS = "audit_blocks";
 const char* const LMDB_CARROT_YIELD_TXS = "carrot_yield_txs";
+const char* const LMDB_BLOCK_SCAN_RECORDS = "block_scan_records";
+const char* const LMDB_SUPPLY_SERIES = "supply_series";
+const char* const LMDB_BLOCK_EMISSION_TOTALS = "block_emission_totals";
+const char* const LMDB_TX_TYPE_INDEX = "tx_type_index";
+const char* const LMDB_OUTPUT_ASSET_INDEX = "output_asset_index";
 
 const char zerokey[8] = {0};
 const MDB_val zerokval = { sizeof(zerokey), (void *)zerokey };
@@ -315,6 +337,71 @@ inline void lmdb_db_open(MDB_txn* txn, const char* name, int flags, MDB_dbi& dbi
     throw0(cryptonote::DB_OPEN_FAILURE((lmdb_error(error_string + " : ", res) + std::string(" - you may want to start with --db-salvage")).c_str()));
 }
 
+// largest forward distance stepped through duplicates, rather than searched from the root again
+const uint64_t DUP_WALK_MAX_STEPS = 16;
+
+// the key image filter is sized for twice the key images at startup, and at least this many
+const uint64_t KEY_IMAGE_FILTER_MIN_CAPACITY = 1 << 20;
+
+struct dup_cursor_position
+{
+  bool valid = false;
+  uint64_t index = 0;
+};
+
+/**
+ * Like MDB_GET_BOTH, for dupsort tables whose duplicates start with a dense uint64 index
+ * (output_amounts, output_types). When the cursor already sits a few indices below the one
+ * wanted on the same key, it steps there with MDB_NEXT_DUP, so a sorted batch of lookups is
+ * one forward walk instead of a tree search per lookup. pos tracks where the cursor is, and
+ * must be reset when the key changes.
+ */
+inline int cursor_get_dup_sorted(MDB_cursor *cur, MDB_val &k, MDB_val &v, uint64_t index, dup_cursor_position &pos)
+{
+  if (pos.valid && index >= pos.index && index - pos.index <= DUP_WALK_MAX_STEPS)
+  {
+    MDB_val k2, v2;
+    int result = mdb_cursor_get(cur, &k2, &v2, MDB_GET_CURRENT);
+    for (uint64_t n = pos.index; n < index && result == 0; ++n)
+      result = mdb_cursor_get(cur, &k2, &v2, MDB_NEXT_DUP);
+    if (result == 0 && v2.mv_size >= sizeof(uint64_t) && *(const uint64_t*)v2.mv_data == index)
+    {
+      v = v2;
+      pos.index = index;
+      return 0;
+    }
+  }
+
+  v.mv_size = sizeof(index);
+  v.mv_data = &index;
+  const int result = mdb_cursor_get(cur, &k, &v, MDB_GET_BOTH);
+  pos.valid = result == 0;
+  pos.index = index;
+  return result;
+}
+
+
+/**
+ * For keys that should sort after everything already in the table: MDB_APPEND
+ * skips the tree search and fills pages to the brim instead of splitting them,
+ * but fails with MDB_KEYEXIST on a key that doesn't sort last, which then goes
+ * through an ordinary put. Tables holding data from before they were written
+ * in order, or overwritten in place, still get the right result either way.
+ */
+inline int cursor_put_append(MDB_cursor *cur, MDB_val *key, MDB_val *val)
+{
+  static tools::metrics::counter &appended = tools::metrics::get_counter("lmdb_append_puts_total", "LMDB puts tried as appends", tools::metrics::label("result", "appended"));
+  static tools::metrics::counter &fallbacks = tools::metrics::get_counter("lmdb_append_puts_total", "LMDB puts tried as appends", tools::metrics::label("result", "fallback"));
+  int result = mdb_cursor_put(cur, key, val, MDB_APPEND);
+  if (result == MDB_KEYEXIST)
+  {
+    fallbacks.inc();
+    result = mdb_cursor_put(cur, key, val, 0);
+  }
+  else
+    appended.inc();
+  return result;
+}
 
 }  // anonymous namespace
 
@@ -339,6 +426,21 @@ inline void lmdb_db_open(MDB_txn* txn, const char* name, int flags, MDB_dbi& dbi
 	  m_tinfo->m_ti_rflags.m_rf_ ## name = true; \
 	}
 
+// txs_prunable lives in the cold env when there is one
+#define PRUNABLE_CURSOR() \
+	if (m_cold_env) \
+	  cold_prunable_cursor(m_cursors); \
+	else { \
+	  CURSOR(txs_prunable) \
+	}
+
+#define PRUNABLE_RCURSOR() \
+	if (m_cold_env) \
+	  cold_prunable_cursor(m_cursors); \
+	else { \
+	  RCURSOR(txs_prunable) \
+	}
+
 namespace cryptonote
 {
 
@@ -387,6 +489,31 @@ typedef struct outassettype {
   uint64_t output_id;
 } outassettype;
 
+// big endian fields, so the default key order is by type, then height, then id
+#pragma pack(push, 1)
+typedef struct tx_type_index_key {
+  uint8_t tx_type;
+  uint64_t height;
+  uint64_t tx_id;
+} tx_type_index_key;
+
+typedef struct output_asset_index_key {
+  uint32_t asset_type;
+  uint64_t height;
+  uint64_t output_id;
+} output_asset_index_key;
+#pragma pack(pop)
+
+tx_type_index_key make_tx_type_index_key(const uint8_t tx_type, const uint64_t height, const uint64_t tx_id)
+{
+  return {tx_type, boost::endian::native_to_big(height), boost::endian::native_to_big(tx_id)};
+}
+
+output_asset_index_key make_output_asset_index_key(const uint32_t asset_type, const uint64_t height, const uint64_t output_id)
+{
+  return {boost::endian::native_to_big(asset_type), boost::endian::native_to_big(height), boost::endian::native_to_big(output_id)};
+}
+
 typedef struct circ_supply_tally {
   bool is_negative;
   uint64_t amount_hi;
@@ -394,10 +521,26 @@ typedef struct circ_supply_tally {
 } circ_supply_tally;
   
 std::atomic<uint64_t> mdb_txn_safe::num_active_txns{0};
+
+namespace
+{
+  // every thread's read txn info, so long held snapshots can be reported from elsewhere
+  boost::mutex threadinfo_registry_lock;
+  std::set<mdb_threadinfo*> threadinfo_registry;
+
+  uint64_t steady_ms()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
 std::atomic_flag mdb_txn_safe::creation_gate = ATOMIC_FLAG_INIT;
 
 mdb_threadinfo::~mdb_threadinfo()
 {
+  {
+    boost::lock_guard<boost::mutex> lock(threadinfo_registry_lock);
+    threadinfo_registry.erase(this);
+  }
   MDB_cursor **cur = &m_ti_rcursors.m_txc_blocks;
   unsigned i;
   for (i=0; i<sizeof(mdb_txn_cursors)/sizeof(MDB_cursor *); i++)
@@ -405,6 +548,18 @@ mdb_threadinfo::~mdb_threadinfo()
       mdb_cursor_close(cur[i]);
   if (m_ti_rtxn)
     mdb_txn_abort(m_ti_rtxn);
+  if (m_ti_cold_rtxn)
+    mdb_txn_abort(m_ti_cold_rtxn);
+}
+
+// the cold read txn is started on first use, and ends with the read txn it was started in
+static inline void reset_cold_rtxn(mdb_threadinfo *tinfo)
+{
+  if (tinfo->m_ti_cold_active)
+  {
+    mdb_txn_reset(tinfo->m_ti_cold_rtxn);
+    tinfo->m_ti_cold_active = false;
+  }
 }
 
 mdb_txn_safe::mdb_txn_safe(const bool check) : m_txn(NULL), m_tinfo(NULL), m_check(check)
@@ -424,7 +579,9 @@ mdb_txn_safe::~mdb_txn_safe()
   LOG_PRINT_L3("mdb_txn_safe: destructor");
   if (m_tinfo != nullptr)
   {
+    m_tinfo->m_ti_rtxn_start = 0;
     mdb_txn_reset(m_tinfo->m_ti_rtxn);
+    reset_cold_rtxn(m_tinfo);
     memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
   } else if (m_txn != nullptr)
   {
@@ -460,6 +617,9 @@ void mdb_txn_safe::commit(std::string message)
     message = "Failed to commit a transaction to the db";
   }
 
+  static tools::metrics::histogram &commit_time = tools::metrics::get_histogram("lmdb_txn_commit_seconds", "Time taken to commit LMDB transactions");
+  tools::metrics::scoped_timer timer(commit_time);
+  TRACE_SPAN("lmdb_txn_commit");
   if (auto result = mdb_txn_commit(m_txn))
   {
     m_txn = nullptr;
@@ -538,6 +698,8 @@ void lmdb_resized(MDB_env *env, int isactive)
   mdb_txn_safe::prevent_new_txns();
 
   MGINFO("LMDB map resize detected.");
+  static tools::metrics::counter &resizes = tools::metrics::get_counter("lmdb_resizes_total", "LMDB map resizes", tools::metrics::label("trigger", "external"));
+  resizes.inc();
 
   MDB_envinfo mei;
 
@@ -588,22 +750,39 @@ inline void BlockchainLMDB::check_open() const
     throw0(DB_ERROR("DB operation attempted on a not-open DB instance"));
 }
 
-void BlockchainLMDB::do_resize(uint64_t increase_size)
+// the map size env should grow to, or 0 if there isn't the disk space for it
+uint64_t BlockchainLMDB::grown_mapsize(MDB_env *env, const std::string &folder, uint64_t increase_size)
 {
-  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
-  CRITICAL_REGION_LOCAL(m_synchronization_lock);
-  const uint64_t add_size = 1LL << 30;
+  const uint64_t min_add_size = 1LL << 30;
+
+  MDB_envinfo mei;
+
+  mdb_env_info(env, &mei);
+
+  MDB_stat mst;
+
+  mdb_env_stat(env, &mst);
+
+  // grow by a fraction of the current map, so a growing chain needs fewer resizes,
+  // or by increase_size if more, which is the estimated size at the start of a batch
+  uint64_t add_size = std::max<uint64_t>(min_add_size, mei.me_mapsize * RESIZE_GROWTH_FACTOR);
+  add_size = std::max(add_size, increase_size);
 
   // check disk capacity
   try
   {
-    boost::filesystem::path path(m_folder);
+    boost::filesystem::path path(folder);
     boost::filesystem::space_info si = boost::filesystem::space(path);
     if(si.available < add_size)
     {
-      MERROR("!! WARNING: Insufficient free space to extend database !!: " <<
-          (si.available >> 20L) << " MB available, " << (add_size >> 20L) << " MB needed");
-      return;
+      const uint64_t needed_size = std::max(min_add_size, increase_size);
+      if(si.available < needed_size)
+      {
+        MERROR("!! WARNING: Insufficient free space to extend database !!: " <<
+            (si.available >> 20L) << " MB available, " << (needed_size >> 20L) << " MB needed");
+        return 0;
+      }
+      add_size = needed_size;
     }
   }
   catch(...)
@@ -612,62 +791,36 @@ void BlockchainLMDB::do_resize(uint64_t increase_size)
     MWARNING("Unable to query free disk space.");
   }
 
-  MDB_envinfo mei;
-
-  mdb_env_info(m_env, &mei);
-
-  MDB_stat mst;
-
-  mdb_env_stat(m_env, &mst);
-
-  // add 1Gb per resize, instead of doing a percentage increase
   uint64_t new_mapsize = (uint64_t) mei.me_mapsize + add_size;
 
-  // If given, use increase_size instead of above way of resizing.
-  // This is currently used for increasing by an estimated size at start of new
-  // batch txn.
-  if (increase_size > 0)
-    new_mapsize = mei.me_mapsize + increase_size;
-
   new_mapsize += (new_mapsize % mst.ms_psize);
+  return new_mapsize;
+}
 
-  mdb_txn_safe::prevent_new_txns();
-
-  if (m_write_txn != nullptr)
-  {
-    if (m_batch_active)
-    {
-      throw0(DB_ERROR("lmdb resizing not yet supported when batch transactions enabled!"));
-    }
-    else
-    {
-      throw0(DB_ERROR("attempting resize with write transaction in progress, this should not happen!"));
-    }
-  }
+static void set_mapsize(MDB_env *env, uint64_t new_mapsize, const char *name)
+{
+  MDB_envinfo mei;
 
-  mdb_txn_safe::wait_no_active_txns();
+  mdb_env_info(env, &mei);
 
-  int result = mdb_env_set_mapsize(m_env, new_mapsize);
+  int result = mdb_env_set_mapsize(env, new_mapsize);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to set new mapsize: ", result).c_str()));
 
-  MGINFO("LMDB Mapsize increased." << "  Old: " << mei.me_mapsize / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB");
-
-  mdb_txn_safe::allow_new_txns();
+  MGINFO(name << " Mapsize increased." << "  Old: " << mei.me_mapsize / (1024 * 1024) << "MiB" << ", New: " << new_mapsize / (1024 * 1024) << "MiB");
 }
 
 // threshold_size is used for batch transactions
-bool BlockchainLMDB::need_resize(uint64_t threshold_size) const
+bool BlockchainLMDB::env_needs_resize(MDB_env *env, uint64_t threshold_size)
 {
-  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
 #if defined(ENABLE_AUTO_RESIZE)
   MDB_envinfo mei;
 
-  mdb_env_info(m_env, &mei);
+  mdb_env_info(env, &mei);
 
   MDB_stat mst;
 
-  mdb_env_stat(m_env, &mst);
+  mdb_env_stat(env, &mst);
 
   // size_used doesn't include data yet to be committed, which can be
   // significant size during batch transactions. For that, we estimate the size
@@ -704,6 +857,61 @@ bool BlockchainLMDB::need_resize(uint64_t threshold_size) const
 #endif
 }
 
+void BlockchainLMDB::do_resize(uint64_t increase_size)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  CRITICAL_REGION_LOCAL(m_synchronization_lock);
+
+  // with cold storage, only grow the env(s) running out of room
+  bool resize_hot = true, resize_cold = false;
+  if (m_cold_env)
+  {
+    resize_cold = env_needs_resize(m_cold_env, increase_size);
+    resize_hot = !resize_cold || env_needs_resize(m_env, increase_size);
+  }
+  const uint64_t new_mapsize = resize_hot ? grown_mapsize(m_env, m_folder, increase_size) : 0;
+  const uint64_t new_cold_mapsize = resize_cold ? grown_mapsize(m_cold_env, m_cold_folder, increase_size) : 0;
+  if (!new_mapsize && !new_cold_mapsize)
+    return;
+
+  static tools::metrics::counter &resizes = tools::metrics::get_counter("lmdb_resizes_total", "LMDB map resizes", tools::metrics::label("trigger", "grow"));
+  static tools::metrics::histogram &resize_time = tools::metrics::get_histogram("lmdb_resize_seconds", "Time taken to resize the LMDB map, including waiting for readers");
+  resizes.inc();
+  tools::metrics::scoped_timer timer(resize_time);
+  mdb_txn_safe::prevent_new_txns();
+
+  if (m_write_txn != nullptr)
+  {
+    if (m_batch_active)
+    {
+      throw0(DB_ERROR("attempting resize with batch transaction in progress, it must be checkpointed first!"));
+    }
+    else
+    {
+      throw0(DB_ERROR("attempting resize with write transaction in progress, this should not happen!"));
+    }
+  }
+
+  // this covers the cold env too, whose txns are only ever open alongside one here
+  mdb_txn_safe::wait_no_active_txns();
+
+  if (new_mapsize)
+    set_mapsize(m_env, new_mapsize, "LMDB");
+  if (new_cold_mapsize)
+    set_mapsize(m_cold_env, new_cold_mapsize, "LMDB cold db");
+
+  mdb_txn_safe::allow_new_txns();
+}
+
+// threshold_size is used for batch transactions
+bool BlockchainLMDB::need_resize(uint64_t threshold_size) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (env_needs_resize(m_env, threshold_size))
+    return true;
+  return m_cold_env && env_needs_resize(m_cold_env, threshold_size);
+}
+
 void BlockchainLMDB::check_and_resize_for_batch(uint64_t batch_num_blocks, uint64_t batch_bytes)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -807,6 +1015,19 @@ estim:
   if (batch_fudge_factor < 5000.0)
     batch_fudge_factor = 5000.0;
   threshold_size = avg_block_size * db_expand_factor * batch_fudge_factor;
+
+  // the db space actually used per block so far also accounts for indices and
+  // other per-block data, which the block size estimate above does not see
+  if (m_height > 0)
+  {
+    MDB_envinfo mei;
+    mdb_env_info(m_env, &mei);
+    MDB_stat mst;
+    mdb_env_stat(m_env, &mst);
+    const uint64_t db_bytes_per_block = mst.ms_psize * mei.me_last_pgno / m_height;
+    MDEBUG("db bytes per block: " << db_bytes_per_block);
+    threshold_size = std::max<uint64_t>(threshold_size, db_bytes_per_block * batch_safety_factor * batch_num_blocks);
+  }
   return threshold_size;
 }
 
@@ -910,6 +1131,45 @@ int BlockchainLMDB::get_yield_block_info(const uint64_t height, yield_block_info
   return ret;
 }
 
+int BlockchainLMDB::get_yield_block_infos(const uint64_t start_height, const uint64_t end_height, std::vector<yield_block_info>& ybis) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  // Clear the container
+  ybis.clear();
+  if (start_height >= end_height)
+    return 0;
+  ybis.reserve(end_height - start_height);
+
+  // Walk the YIELD_BLOCK_INFO entries with a single cursor, rather than seeking to each height
+  TXN_PREFIX_RDONLY();
+  RCURSOR(yield_blocks);
+
+  MDB_val v;
+  MDB_val_set(k, start_height);
+  MDB_cursor_op op = MDB_SET;
+  for (uint64_t height = start_height; height < end_height; ++height)
+  {
+    int ret = mdb_cursor_get(m_cur_yield_blocks, &k, &v, op);
+    op = MDB_NEXT;
+    if (ret == MDB_NOTFOUND) {
+      LOG_ERROR("Failed to locate YBI for block height " << height);
+      return ret;
+    }
+    if (ret)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate yield block info: ", ret).c_str()));
+
+    const yield_block_info *p = (const yield_block_info*)v.mv_data;
+    ybis.push_back(*p);
+  }
+
+  TXN_POSTFIX_RDONLY();
+
+  // Return success to caller
+  return 0;
+}
+
 int BlockchainLMDB::get_yield_tx_info(const uint64_t height, std::vector<yield_tx_info>& yti_container) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -1096,8 +1356,8 @@ void BlockchainLMDB::add_block(const block& blk, size_t block_weight, uint64_t l
         throw1(BLOCK_DNE(lmdb_error("Failed to get block info: ", result).c_str()));
     const mdb_block_info *bi_prev = (const mdb_block_info*)h.mv_data;
     bi.bi_cum_rct += bi_prev->bi_cum_rct;
-    for (auto const& asset_type : oracle::ASSET_TYPES)
-      cum_rct_by_asset_type.add(asset_type, bi_prev->bi_cum_rct_by_asset_type[asset_type]);
+    for (const oracle::asset_id asset : {oracle::asset_id::SAL, oracle::asset_id::SAL1, oracle::asset_id::BURN})
+      cum_rct_by_asset_type.add(asset, bi_prev->bi_cum_rct_by_asset_type[asset]);
   }
   bi.bi_long_term_block_weight = long_term_block_weight;
   bi.bi_cum_rct_by_asset_type = cum_rct_by_asset_type;
@@ -1167,6 +1427,319 @@ void BlockchainLMDB::remove_block()
   if ((result = mdb_cursor_get(m_cur_audit_blocks, &k2,  NULL, MDB_SET)) == 0)
     if ((result = mdb_cursor_del(m_cur_audit_blocks, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of audit block info to db transaction: ", result).c_str()));
+
+  // Blocks added before the scan record table existed have no entry
+  CURSOR(block_scan_records)
+  if ((result = mdb_cursor_get(m_cur_block_scan_records, &k2,  NULL, MDB_SET)) == 0)
+    if ((result = mdb_cursor_del(m_cur_block_scan_records, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block scan record to db transaction: ", result).c_str()));
+
+  remove_supply_series_block(m_height - 1);
+
+  // Nor an emission totals entry, if synced before that table existed
+  CURSOR(block_emission_totals)
+  if ((result = mdb_cursor_get(m_cur_block_emission_totals, &k2,  NULL, MDB_SET)) == 0)
+    if ((result = mdb_cursor_del(m_cur_block_emission_totals, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block emission totals to db transaction: ", result).c_str()));
+}
+
+void BlockchainLMDB::add_block_scan_record(const uint64_t height, const blobdata& blob)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+  CURSOR(block_scan_records)
+
+  // heights come in order and pops delete their records, so this sorts last bar
+  // something unexpected, which the fallback covers
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val val = {blob.size(), (void *)blob.data()};
+  int result = cursor_put_append(m_cur_block_scan_records, &key, &val);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add block scan record to db transaction: ", result).c_str()));
+}
+
+void BlockchainLMDB::get_block_scan_record_blobs(const uint64_t start_height, const size_t count, std::vector<blobdata>& blobs) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  blobs.clear();
+  const uint64_t end_height = std::min<uint64_t>(height(), start_height + count);
+  if (start_height >= end_height)
+    return;
+  blobs.reserve(end_height - start_height);
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_scan_records);
+
+  MDB_val v;
+  MDB_val_set(k, start_height);
+  MDB_cursor_op op = MDB_SET_RANGE;
+  bool at_end = false;
+  for (uint64_t h = start_height; h < end_height; ++h)
+  {
+    // the records are keyed by height, so one forward walk serves the whole range
+    uint64_t record_height = 0;
+    if (!at_end)
+    {
+      int ret = mdb_cursor_get(m_cur_block_scan_records, &k, &v, op);
+      if (ret == MDB_NOTFOUND)
+        at_end = true;
+      else if (ret)
+        throw0(DB_ERROR(lmdb_error("Failed to enumerate block scan records: ", ret).c_str()));
+      else
+        record_height = *(const uint64_t*)k.mv_data;
+    }
+    if (at_end || record_height != h)
+    {
+      // not stored (synced before the table existed): build it from the block, and keep
+      // the cursor on the record found so it can serve a later height
+      blobs.push_back(make_block_scan_record_blob(h));
+      op = MDB_GET_CURRENT;
+      continue;
+    }
+    op = MDB_NEXT;
+    blobs.emplace_back((const char*)v.mv_data, v.mv_size);
+  }
+
+  TXN_POSTFIX_RDONLY();
+}
+
+static uint64_t supply_series_key(const supply_series_granularity granularity, const uint64_t height)
+{
+  // granularity in the top byte, so each resolution is one contiguous run of keys
+  return ((uint64_t)granularity << 56) | (height / get_supply_series_bucket_blocks(granularity));
+}
+
+bool BlockchainLMDB::get_supply_series_entry(const supply_series_granularity granularity, const uint64_t height, supply_series_entry& entry)
+{
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+  CURSOR(supply_series)
+
+  MDB_val_copy<uint64_t> key(supply_series_key(granularity, height));
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_supply_series, &key, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to get supply series entry: ", result).c_str()));
+  if (!t_serializable_object_from_blob(entry, blobdata((const char*)v.mv_data, v.mv_size)))
+    throw0(DB_ERROR("Failed to parse supply series entry"));
+  return true;
+}
+
+void BlockchainLMDB::put_supply_series_entry(const supply_series_granularity granularity, const supply_series_entry& entry)
+{
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+  CURSOR(supply_series)
+
+  const blobdata blob = t_serializable_object_to_blob(entry);
+  MDB_val_copy<uint64_t> key(supply_series_key(granularity, entry.first_height));
+  MDB_val val = {blob.size(), (void *)blob.data()};
+  int result = mdb_cursor_put(m_cur_supply_series, &key, &val, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add supply series entry to db transaction: ", result).c_str()));
+}
+
+void BlockchainLMDB::add_supply_series_block(const uint64_t height, const supply_series_entry& block)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  for (int g = 0; g < SUPPLY_SERIES_GRANULARITIES; ++g)
+  {
+    const supply_series_granularity granularity = (supply_series_granularity)g;
+    supply_series_entry entry;
+    // the bucket may also lack blocks below this one if they were added before the series was kept
+    if (granularity != SUPPLY_SERIES_BLOCK && get_supply_series_entry(granularity, height, entry) && entry.last_height + 1 == height)
+      entry.add_block(block);
+    else
+      entry = block;
+    put_supply_series_entry(granularity, entry);
+  }
+}
+
+void BlockchainLMDB::remove_supply_series_block(const uint64_t height)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+  CURSOR(supply_series)
+
+  // blocks added before the series was kept have no entry
+  supply_series_entry block;
+  if (!get_supply_series_entry(SUPPLY_SERIES_BLOCK, height, block))
+    return;
+  supply_series_entry prev;
+  const bool has_prev = height > 0 && get_supply_series_entry(SUPPLY_SERIES_BLOCK, height - 1, prev);
+
+  for (int g = 0; g < SUPPLY_SERIES_GRANULARITIES; ++g)
+  {
+    const supply_series_granularity granularity = (supply_series_granularity)g;
+    supply_series_entry entry;
+    if (!get_supply_series_entry(granularity, height, entry))
+      continue;
+    if (entry.first_height < height && has_prev)
+    {
+      entry.remove_block(block, prev);
+      put_supply_series_entry(granularity, entry);
+    }
+    else
+    {
+      // get_supply_series_entry left the cursor on the entry
+      int result = mdb_cursor_del(m_cur_supply_series, 0);
+      if (result)
+        throw1(DB_ERROR(lmdb_error("Failed to add removal of supply series entry to db transaction: ", result).c_str()));
+    }
+  }
+}
+
+void BlockchainLMDB::get_supply_series(const supply_series_granularity granularity, const uint64_t start_height, const uint64_t end_height, const size_t max_count, std::vector<supply_series_entry>& entries) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  entries.clear();
+  if (granularity >= SUPPLY_SERIES_GRANULARITIES || start_height > end_height || max_count == 0)
+    return;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(supply_series);
+
+  const uint64_t end_key = supply_series_key(granularity, end_height);
+  MDB_val_copy<uint64_t> k(supply_series_key(granularity, start_height));
+  MDB_val key = k, v;
+  MDB_cursor_op op = MDB_SET_RANGE;
+  while (entries.size() < max_count)
+  {
+    int result = mdb_cursor_get(m_cur_supply_series, &key, &v, op);
+    op = MDB_NEXT;
+    if (result == MDB_NOTFOUND)
+      break;
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate supply series: ", result).c_str()));
+    if (*(const uint64_t*)key.mv_data > end_key)
+      break;
+    supply_series_entry entry;
+    if (!t_serializable_object_from_blob(entry, blobdata((const char*)v.mv_data, v.mv_size)))
+      throw0(DB_ERROR("Failed to parse supply series entry"));
+    entries.push_back(std::move(entry));
+  }
+
+  TXN_POSTFIX_RDONLY();
+}
+
+void BlockchainLMDB::add_block_emission_totals(const uint64_t height, const block_emission_totals& totals)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+  CURSOR(block_emission_totals)
+
+  // see add_block_scan_record
+  const blobdata blob = t_serializable_object_to_blob(totals);
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val val = {blob.size(), (void *)blob.data()};
+  int result = cursor_put_append(m_cur_block_emission_totals, &key, &val);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add block emission totals to db transaction: ", result).c_str()));
+}
+
+bool BlockchainLMDB::get_block_emission_totals(const uint64_t height, block_emission_totals& totals) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_emission_totals);
+
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val v;
+  int result = mdb_cursor_get(m_cur_block_emission_totals, &key, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to get block emission totals: ", result).c_str()));
+  if (!t_serializable_object_from_blob(totals, blobdata((const char*)v.mv_data, v.mv_size)))
+    throw0(DB_ERROR("Failed to parse block emission totals"));
+
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
+bool BlockchainLMDB::get_tx_index_height(uint64_t& height) const
+{
+  height = m_tx_index_height;
+  return m_tx_index;
+}
+
+void BlockchainLMDB::get_txs_by_type(const uint8_t tx_type, const uint64_t start_height, const uint64_t start_tx_id, const uint64_t end_height, const size_t max_count, std::vector<tx_index_entry>& entries) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  entries.clear();
+  if (!m_tx_index || start_height > end_height || max_count == 0)
+    return;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(tx_type_index);
+
+  tx_type_index_key tk = make_tx_type_index_key(tx_type, start_height, start_tx_id);
+  MDB_val_set(k, tk);
+  MDB_val v;
+  MDB_cursor_op op = MDB_SET_RANGE;
+  while (entries.size() < max_count)
+  {
+    int ret = mdb_cursor_get(m_cur_tx_type_index, &k, &v, op);
+    op = MDB_NEXT;
+    if (ret == MDB_NOTFOUND)
+      break;
+    if (ret)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate tx type index: ", ret).c_str()));
+    const tx_type_index_key *key = (const tx_type_index_key*)k.mv_data;
+    const uint64_t height = boost::endian::big_to_native(key->height);
+    if (key->tx_type != tx_type || height > end_height)
+      break;
+    entries.push_back({height, boost::endian::big_to_native(key->tx_id), *(const crypto::hash*)v.mv_data});
+  }
+
+  TXN_POSTFIX_RDONLY();
+}
+
+void BlockchainLMDB::get_outputs_by_asset_type(const std::string& asset_type, const uint64_t start_height, const uint64_t start_output_id, const uint64_t end_height, const size_t max_count, std::vector<output_index_entry>& entries) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  entries.clear();
+  if (!m_tx_index || start_height > end_height || max_count == 0)
+    return;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(output_asset_index);
+
+  const uint32_t asset_id = cryptonote::asset_id_from_type(asset_type);
+  output_asset_index_key ak = make_output_asset_index_key(asset_id, start_height, start_output_id);
+  MDB_val_set(k, ak);
+  MDB_val v;
+  MDB_cursor_op op = MDB_SET_RANGE;
+  while (entries.size() < max_count)
+  {
+    int ret = mdb_cursor_get(m_cur_output_asset_index, &k, &v, op);
+    op = MDB_NEXT;
+    if (ret == MDB_NOTFOUND)
+      break;
+    if (ret)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate output asset index: ", ret).c_str()));
+    const output_asset_index_key *key = (const output_asset_index_key*)k.mv_data;
+    const uint64_t height = boost::endian::big_to_native(key->height);
+    if (boost::endian::big_to_native(key->asset_type) != asset_id || height > end_height)
+      break;
+    entries.push_back({height, boost::endian::big_to_native(key->output_id), *(const uint64_t*)v.mv_data});
+  }
+
+  TXN_POSTFIX_RDONLY();
 }
 
 boost::multiprecision::int128_t
@@ -1245,7 +1818,7 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, cons
   uint64_t tx_id = get_tx_count();
 
   CURSOR(txs_pruned)
-  CURSOR(txs_prunable)
+  PRUNABLE_CURSOR()
   CURSOR(txs_prunable_hash)
   CURSOR(txs_prunable_tip)
   CURSOR(tx_indices)
@@ -1279,6 +1852,17 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, cons
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add tx data to db transaction: ", result).c_str()));
 
+  if (m_tx_index)
+  {
+    CURSOR(tx_type_index)
+    tx_type_index_key tk = make_tx_type_index_key(tx.type, m_height, tx_id);
+    MDB_val_set(ktk, tk);
+    MDB_val_set(vtk, ti.key);
+    result = mdb_cursor_put(m_cur_tx_type_index, &ktk, &vtk, 0);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to add tx type index to db transaction: ", result).c_str()));
+  }
+
   const cryptonote::blobdata_ref &blob = txp.second;
 
   unsigned int unprunable_size = tx.unprunable_size;
@@ -1301,14 +1885,15 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, cons
     throw0(DB_ERROR(lmdb_error("Failed to add pruned tx blob to db transaction: ", result).c_str()));
 
   MDB_val prunable_blob = {blob.size() - unprunable_size, (void*)(blob.data() + unprunable_size)};
-  result = mdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
+  // the cold db may still hold data left at this id by a popped block, see remove_transaction_data
+  result = m_cold_env ? cursor_put_append(m_cur_txs_prunable, &val_tx_id, &prunable_blob) : mdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add prunable tx blob to db transaction: ", result).c_str()));
 
   if (get_blockchain_pruning_seed())
   {
     MDB_val_set(val_height, m_height);
-    result = mdb_cursor_put(m_cur_txs_prunable_tip, &val_tx_id, &val_height, 0);
+    result = cursor_put_append(m_cur_txs_prunable_tip, &val_tx_id, &val_height);
     if (result)
       throw0(DB_ERROR(lmdb_error("Failed to add prunable tx id to db transaction: ", result).c_str()));
   }
@@ -1593,7 +2178,10 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
   mdb_txn_cursors *m_cursors = &m_wcursors;
   CURSOR(tx_indices)
   CURSOR(txs_pruned)
-  CURSOR(txs_prunable)
+  if (!m_cold_env)
+  {
+    CURSOR(txs_prunable)
+  }
   CURSOR(txs_prunable_hash)
   CURSOR(txs_prunable_tip)
   CURSOR(tx_outputs)
@@ -1609,21 +2197,39 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
   txindex *tip = (txindex *)val_h.mv_data;
   MDB_val_set(val_tx_id, tip->data.tx_id);
 
+  if (m_tx_index && tip->data.block_id >= m_tx_index_height)
+  {
+    CURSOR(tx_type_index)
+    tx_type_index_key tk = make_tx_type_index_key(tx.type, tip->data.block_id, tip->data.tx_id);
+    MDB_val_set(ktk, tk);
+    if ((result = mdb_cursor_get(m_cur_tx_type_index, &ktk, NULL, MDB_SET)))
+        throw1(DB_ERROR(lmdb_error("Failed to locate tx type index for removal: ", result).c_str()));
+    if ((result = mdb_cursor_del(m_cur_tx_type_index, 0)))
+        throw1(DB_ERROR(lmdb_error("Failed to add removal of tx type index to db transaction: ", result).c_str()));
+  }
+
   if ((result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, NULL, MDB_SET)))
       throw1(DB_ERROR(lmdb_error("Failed to locate pruned tx for removal: ", result).c_str()));
   result = mdb_cursor_del(m_cur_txs_pruned, 0);
   if (result)
       throw1(DB_ERROR(lmdb_error("Failed to add removal of pruned tx to db transaction: ", result).c_str()));
 
-  result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
-  if (result == 0)
+  // The cold db commits just ahead of this one, so removing the prunable data
+  // there could lose it if this commit then failed. It is left in place
+  // instead: the id is overwritten when reused, and anything past the last tx
+  // is cleared when the db is opened.
+  if (!m_cold_env)
   {
-      result = mdb_cursor_del(m_cur_txs_prunable, 0);
-      if (result)
-          throw1(DB_ERROR(lmdb_error("Failed to add removal of prunable tx to db transaction: ", result).c_str()));
+    result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
+    if (result == 0)
+    {
+        result = mdb_cursor_del(m_cur_txs_prunable, 0);
+        if (result)
+            throw1(DB_ERROR(lmdb_error("Failed to add removal of prunable tx to db transaction: ", result).c_str()));
+    }
+    else if (result != MDB_NOTFOUND)
+        throw1(DB_ERROR(lmdb_error("Failed to locate prunable tx for removal: ", result).c_str()));
   }
-  else if (result != MDB_NOTFOUND)
-      throw1(DB_ERROR(lmdb_error("Failed to locate prunable tx for removal: ", result).c_str()));
 
   result = mdb_cursor_get(m_cur_txs_prunable_tip, &val_tx_id, NULL, MDB_SET);
   if (result && result != MDB_NOTFOUND)
@@ -1945,6 +2551,17 @@ std::pair<uint64_t, uint64_t> BlockchainLMDB::add_output(const crypto::hash& tx_
   if ((result = mdb_cursor_put(m_cur_output_types, &koat, &voat, MDB_APPENDDUP)))
     throw0(DB_ERROR(lmdb_error("Failed to add output type to db transaction: ", result).c_str()));
 
+  if (m_tx_index)
+  {
+    CURSOR(output_asset_index)
+    output_asset_index_key ak = make_output_asset_index_key(asset_type, m_height, ok.output_id);
+    MDB_val_set(kak, ak);
+    MDB_val_set(vak, oat.asset_type_output_index);
+    // not MDB_APPEND, keys of other asset types sort after this one
+    if ((result = mdb_cursor_put(m_cur_output_asset_index, &kak, &vak, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to add output asset index to db transaction: ", result).c_str()));
+  }
+
   return std::make_pair(ok.amount_index, oat.asset_type_output_index);
 }
 
@@ -2049,6 +2666,17 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
                     .append(boost::lexical_cast<std::string>(out_index)).c_str()));
 
 
+  if (m_tx_index && ok->data.height >= m_tx_index_height)
+  {
+    CURSOR(output_asset_index)
+    output_asset_index_key ak = make_output_asset_index_key(output_asset_type, ok->data.height, out_index);
+    MDB_val_set(kak, ak);
+    if ((result = mdb_cursor_get(m_cur_output_asset_index, &kak, NULL, MDB_SET)))
+      throw1(DB_ERROR(lmdb_error("Failed to locate output asset index for removal: ", result).c_str()));
+    if ((result = mdb_cursor_del(m_cur_output_asset_index, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of output asset index to db transaction: ", result).c_str()));
+  }
+
   result = mdb_cursor_del(m_cur_output_txs, 0);
   if (result)
     throw0(DB_ERROR(lmdb_error(std::string("Error deleting output index ").append(boost::lexical_cast<std::string>(out_index).append(": ")).c_str(), result).c_str()));
@@ -2132,6 +2760,8 @@ void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image)
     else
       throw1(DB_ERROR(lmdb_error("Error adding spent key image to db transaction: ", result).c_str()));
   }
+  // before the commit, so the filter never misses a key image another thread can see
+  m_key_image_filter.insert(k_image);
 }
 
 void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image)
@@ -2181,6 +2811,14 @@ BlockchainLMDB::BlockchainLMDB(bool batch_transactions): BlockchainDB()
   m_batch_active = false;
   m_cum_size = 0;
   m_cum_count = 0;
+  m_circulating_supply_generation = 0;
+  m_circulating_supply_write_pending = false;
+  m_prune_resume_valid = false;
+  m_cold_env = nullptr;
+  m_cold_write_txn = nullptr;
+  m_tx_index_requested = false;
+  m_tx_index = false;
+  m_tx_index_height = 0;
 
   // reset may also need changing when initialize things here
 
@@ -2244,6 +2882,7 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   if (m_open)
     throw0(DB_OPEN_FAILURE("Attempted to open db, but it's already open"));
+  ++m_circulating_supply_generation;
 
   boost::filesystem::path direc(filename);
   if (!boost::filesystem::exists(direc) &&
@@ -2326,7 +2965,8 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
     LOG_PRINT_L1("LMDB memory map size: " << cur_mapsize);
   }
 
-  if (need_resize())
+  // a read-only env follows the map size of whoever writes to it
+  if (!(mdb_flags & MDB_RDONLY) && need_resize())
   {
     LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
     do_resize();
@@ -2390,6 +3030,15 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
 
   lmdb_db_open(txn, LMDB_CARROT_YIELD_TXS, MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_CREATE, m_carrot_yield_txs, "Failed to open db handle for m_carrot_yield_txs");
 
+  lmdb_db_open(txn, LMDB_BLOCK_SCAN_RECORDS, MDB_INTEGERKEY | MDB_CREATE, m_block_scan_records, "Failed to open db handle for m_block_scan_records");
+
+  lmdb_db_open(txn, LMDB_SUPPLY_SERIES, MDB_INTEGERKEY | MDB_CREATE, m_supply_series, "Failed to open db handle for m_supply_series");
+
+  lmdb_db_open(txn, LMDB_BLOCK_EMISSION_TOTALS, MDB_INTEGERKEY | MDB_CREATE, m_block_emission_totals, "Failed to open db handle for m_block_emission_totals");
+
+  lmdb_db_open(txn, LMDB_TX_TYPE_INDEX, MDB_CREATE, m_tx_type_index, "Failed to open db handle for m_tx_type_index");
+  lmdb_db_open(txn, LMDB_OUTPUT_ASSET_INDEX, MDB_CREATE, m_output_asset_index, "Failed to open db handle for m_output_asset_index");
+
   mdb_set_dupsort(txn, m_spent_keys, compare_hash32);
   mdb_set_dupsort(txn, m_block_heights, compare_hash32);
   mdb_set_dupsort(txn, m_tx_indices, compare_hash32);
@@ -2430,6 +3079,8 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   LOG_PRINT_L2("Setting m_height to: " << db_stats.ms_entries);
   uint64_t m_height = db_stats.ms_entries;
 
+  open_tx_index(txn, m_height, mdb_flags & MDB_RDONLY);
+
   bool compatible = true;
 
   MDB_val_str(k, "version");
@@ -2459,8 +3110,10 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
       // See commit e5d2680094ee15889934fe28901e4e133cda56f2 2015/07/10
       // We don't handle the old format previous to that commit.
       txn.commit();
+      open_cold_storage(mdb_flags);
       m_open = true;
       migrate(db_version);
+      build_key_image_filter();
       return;
     }
 #endif
@@ -2506,10 +3159,275 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   // commit the transaction
   txn.commit();
 
+  open_cold_storage(mdb_flags);
+
   m_open = true;
+  build_key_image_filter();
   // from here, init should be finished
 }
 
+void BlockchainLMDB::set_cold_storage_path(const std::string& path)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (m_open)
+    throw0(DB_ERROR("The cold storage path must be set before the db is opened"));
+  m_cold_folder = path;
+}
+
+void BlockchainLMDB::set_tx_index(bool enabled)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (m_open)
+    throw0(DB_ERROR("The tx index must be enabled before the db is opened"));
+  m_tx_index_requested = enabled;
+}
+
+void BlockchainLMDB::open_tx_index(MDB_txn *txn, uint64_t height, bool read_only)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  MDB_val_str(k, "tx_index_height");
+  MDB_val v;
+  int result = mdb_get(txn, m_properties, &k, &v);
+  if (result && result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to read tx index height: ", result).c_str()));
+  const bool present = result == 0;
+  if (present)
+    m_tx_index_height = *(const uint64_t*)v.mv_data;
+
+  if (read_only)
+  {
+    // queries can still use an index another process keeps
+    m_tx_index = present;
+    return;
+  }
+
+  if (m_tx_index_requested && !present)
+  {
+    // blocks already in the db are not indexed, the index is complete from here up
+    if (height > 0)
+      MWARNING("Transactions and outputs below height " << height << " will not be in the tx index; resync to index them");
+    m_tx_index_height = height;
+    MDB_val_copy<uint64_t> vh(height);
+    if ((result = mdb_put(txn, m_properties, &k, &vh, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to write tx index height: ", result).c_str()));
+  }
+  else if (!m_tx_index_requested && present)
+  {
+    // an index that is not kept up to date would give wrong answers
+    MINFO("Dropping the tx index");
+    if ((result = mdb_drop(txn, m_tx_type_index, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to drop m_tx_type_index: ", result).c_str()));
+    if ((result = mdb_drop(txn, m_output_asset_index, 0)))
+      throw0(DB_ERROR(lmdb_error("Failed to drop m_output_asset_index: ", result).c_str()));
+    if ((result = mdb_del(txn, m_properties, &k, NULL)))
+      throw0(DB_ERROR(lmdb_error("Failed to remove tx index height: ", result).c_str()));
+  }
+  m_tx_index = m_tx_index_requested;
+}
+
+void BlockchainLMDB::open_cold_storage(int mdb_flags)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  const bool read_only = mdb_flags & MDB_RDONLY;
+  int result;
+
+  // once the prunable data has moved out, the main db is no use without it
+  MDB_val_str(k_cold, "cold_prunable");
+  bool moved_out;
+  uint64_t num_txs, num_prunable, prunable_bytes;
+  {
+    mdb_txn_safe txn;
+    if ((result = lmdb_txn_begin(m_env, NULL, MDB_RDONLY, txn)))
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+    MDB_val v;
+    result = mdb_get(txn, m_properties, &k_cold, &v);
+    if (result && result != MDB_NOTFOUND)
+      throw0(DB_ERROR(lmdb_error("Failed to check for cold storage: ", result).c_str()));
+    moved_out = result == 0;
+    MDB_stat db_stats;
+    if ((result = mdb_stat(txn, m_txs_pruned, &db_stats)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_txs_pruned: ", result).c_str()));
+    num_txs = db_stats.ms_entries;
+    if ((result = mdb_stat(txn, m_txs_prunable, &db_stats)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_txs_prunable: ", result).c_str()));
+    num_prunable = db_stats.ms_entries;
+    prunable_bytes = db_stats.ms_psize * (db_stats.ms_branch_pages + db_stats.ms_leaf_pages + db_stats.ms_overflow_pages);
+    txn.commit();
+  }
+
+  if (m_cold_folder.empty())
+  {
+    if (moved_out)
+      throw0(DB_OPEN_FAILURE("The prunable data of this database is kept separately, use --db-cold-path to give its location"));
+    return;
+  }
+  if (read_only && num_prunable > 0)
+    throw0(DB_OPEN_FAILURE("The prunable data needs moving to the cold db, which cannot be done on a read-only database"));
+
+  boost::filesystem::path direc(m_cold_folder);
+  if (!boost::filesystem::exists(direc) &&
+      !boost::filesystem::create_directories(direc)) {
+      throw0(DB_OPEN_FAILURE(std::string("Failed to create directory ").append(m_cold_folder).c_str()));
+  }
+
+  if ((result = mdb_env_create(&m_cold_env)))
+    throw0(DB_ERROR(lmdb_error("Failed to create lmdb environment: ", result).c_str()));
+  try
+  {
+    if ((result = mdb_env_set_maxdbs(m_cold_env, 1)))
+      throw0(DB_ERROR(lmdb_error("Failed to set max number of dbs: ", result).c_str()));
+    int threads = tools::get_max_concurrency();
+    if (threads > 110 &&
+      (result = mdb_env_set_maxreaders(m_cold_env, threads+16)))
+      throw0(DB_ERROR(lmdb_error("Failed to set max number of readers: ", result).c_str()));
+    if ((result = mdb_env_open(m_cold_env, m_cold_folder.c_str(), mdb_flags, 0644)))
+      throw0(DB_ERROR(lmdb_error("Failed to open lmdb environment: ", result).c_str()));
+
+    // make room for what is moved over up front, the batches below may not be resized on all builds
+    MDB_envinfo mei;
+    mdb_env_info(m_cold_env, &mei);
+    const uint64_t mapsize = std::max<uint64_t>(DEFAULT_MAPSIZE, prunable_bytes + prunable_bytes / 4);
+    if (!read_only && mei.me_mapsize < mapsize)
+    {
+      if ((result = mdb_env_set_mapsize(m_cold_env, mapsize)))
+        throw0(DB_ERROR(lmdb_error("Failed to set max memory map size: ", result).c_str()));
+    }
+    if (!read_only && env_needs_resize(m_cold_env, 0))
+    {
+      if (const uint64_t new_mapsize = grown_mapsize(m_cold_env, m_cold_folder, 0))
+        set_mapsize(m_cold_env, new_mapsize, "LMDB cold db");
+    }
+
+    uint64_t num_cold;
+    {
+      mdb_txn_safe txn;
+      if ((result = lmdb_txn_begin(m_cold_env, NULL, read_only ? MDB_RDONLY : 0, txn)))
+        throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the cold db: ", result).c_str()));
+      lmdb_db_open(txn, LMDB_TXS_PRUNABLE, MDB_INTEGERKEY | (read_only ? 0 : MDB_CREATE), m_cold_txs_prunable, "Failed to open db handle for m_cold_txs_prunable");
+      mdb_set_compare(txn, m_cold_txs_prunable, compare_uint64);
+      MDB_stat db_stats;
+      if ((result = mdb_stat(txn, m_cold_txs_prunable, &db_stats)))
+        throw0(DB_ERROR(lmdb_error("Failed to query m_cold_txs_prunable: ", result).c_str()));
+      num_cold = db_stats.ms_entries;
+      txn.commit();
+    }
+    // the newest blocks are never pruned, so a cold db in use can't be empty
+    if (moved_out && num_txs > 0 && num_cold == 0)
+      throw0(DB_OPEN_FAILURE((std::string("The cold db at ") + m_cold_folder + " is empty, but this database keeps its prunable data there").c_str()));
+
+    if (!read_only)
+    {
+      if (num_prunable > 0)
+      {
+        // copied over in batches, then dropped here in one go with the
+        // marker, so an interrupted move just starts over
+        MGINFO("Moving " << num_prunable << " prunable tx records to " << m_cold_folder << ", this may take a while");
+        const uint64_t batch_bytes = 256 * (1 << 20);
+        mdb_txn_safe txn;
+        if ((result = lmdb_txn_begin(m_env, NULL, MDB_RDONLY, txn)))
+          throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        MDB_cursor *cur;
+        if ((result = mdb_cursor_open(txn, m_txs_prunable, &cur)))
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
+        MDB_cursor_op op = MDB_FIRST;
+        uint64_t n_moved = 0;
+        bool finished = false;
+        while (!finished)
+        {
+          if (env_needs_resize(m_cold_env, batch_bytes * 2))
+          {
+            if (const uint64_t new_mapsize = grown_mapsize(m_cold_env, m_cold_folder, batch_bytes * 2))
+              set_mapsize(m_cold_env, new_mapsize, "LMDB cold db");
+          }
+          mdb_txn_safe ctxn;
+          if ((result = lmdb_txn_begin(m_cold_env, NULL, 0, ctxn)))
+            throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the cold db: ", result).c_str()));
+          uint64_t bytes = 0;
+          while (bytes < batch_bytes)
+          {
+            MDB_val k, v;
+            result = mdb_cursor_get(cur, &k, &v, op);
+            op = MDB_NEXT;
+            if (result == MDB_NOTFOUND)
+            {
+              finished = true;
+              break;
+            }
+            if (result)
+              throw0(DB_ERROR(lmdb_error("Failed to enumerate prunable tx data: ", result).c_str()));
+            if ((result = mdb_put(ctxn, m_cold_txs_prunable, &k, &v, 0)))
+              throw0(DB_ERROR(lmdb_error("Failed to copy prunable tx data to the cold db: ", result).c_str()));
+            bytes += k.mv_size + v.mv_size;
+            ++n_moved;
+          }
+          ctxn.commit();
+          MGINFO("Moved " << n_moved << "/" << num_prunable << " prunable tx records");
+        }
+        mdb_cursor_close(cur);
+        txn.commit();
+      }
+
+      // anything past the last tx was left by blocks popped since, or by a main db commit that failed
+      {
+        mdb_txn_safe ctxn;
+        if ((result = lmdb_txn_begin(m_cold_env, NULL, 0, ctxn)))
+          throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the cold db: ", result).c_str()));
+        MDB_cursor *cur;
+        if ((result = mdb_cursor_open(ctxn, m_cold_txs_prunable, &cur)))
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for cold txs_prunable: ", result).c_str()));
+        uint64_t tx_id = num_txs;
+        MDB_val_set(k, tx_id);
+        MDB_val v;
+        size_t n_removed = 0;
+        result = mdb_cursor_get(cur, &k, &v, MDB_SET_RANGE);
+        while (result == 0)
+        {
+          if ((result = mdb_cursor_del(cur, 0)))
+            throw0(DB_ERROR(lmdb_error("Failed to remove stale prunable tx data: ", result).c_str()));
+          ++n_removed;
+          result = mdb_cursor_get(cur, &k, &v, MDB_NEXT);
+        }
+        if (result != MDB_NOTFOUND)
+          throw0(DB_ERROR(lmdb_error("Failed to enumerate prunable tx data: ", result).c_str()));
+        // with an async sync mode, a crash can leave the main db ahead of the cold one
+        if (num_txs > 0)
+        {
+          tx_id = num_txs - 1;
+          result = mdb_cursor_get(cur, &k, &v, MDB_SET);
+          if (result == MDB_NOTFOUND)
+            MERROR("The cold db is missing the prunable data of the newest txs, pop a few blocks to resync them");
+          else if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to look up prunable tx data: ", result).c_str()));
+        }
+        mdb_cursor_close(cur);
+        ctxn.commit();
+        if (n_removed)
+          MINFO("Removed " << n_removed << " stale prunable tx records from the cold db");
+      }
+
+      if (num_prunable > 0 || !moved_out)
+      {
+        mdb_txn_safe txn;
+        if ((result = lmdb_txn_begin(m_env, NULL, 0, txn)))
+          throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        if ((result = mdb_drop(txn, m_txs_prunable, 0)))
+          throw0(DB_ERROR(lmdb_error("Failed to drop m_txs_prunable: ", result).c_str()));
+        MDB_val_copy<uint32_t> v(1);
+        if ((result = mdb_put(txn, m_properties, &k_cold, &v, 0)))
+          throw0(DB_ERROR(lmdb_error("Failed to mark the prunable data as moved: ", result).c_str()));
+        txn.commit();
+      }
+    }
+  }
+  catch (...)
+  {
+    mdb_env_close(m_cold_env);
+    m_cold_env = nullptr;
+    throw;
+  }
+  MGINFO("Keeping prunable tx data in " << m_cold_folder);
+}
+
 void BlockchainLMDB::close()
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2523,6 +3441,11 @@ void BlockchainLMDB::close()
 
   // FIXME: not yet thread safe!!!  Use with care.
   mdb_env_close(m_env);
+  if (m_cold_env)
+  {
+    mdb_env_close(m_cold_env);
+    m_cold_env = nullptr;
+  }
   m_open = false;
 }
 
@@ -2536,6 +3459,12 @@ void BlockchainLMDB::sync()
 
   // Does nothing unless LMDB environment was opened with MDB_NOSYNC or in part
   // MDB_NOMETASYNC. Force flush to be synchronous.
+  // The cold env goes first, as the main one refers to what is in it.
+  if (m_cold_env)
+  {
+    if (auto result = mdb_env_sync(m_cold_env, true))
+      throw0(DB_ERROR(lmdb_error("Failed to sync cold database: ", result).c_str()));
+  }
   if (auto result = mdb_env_sync(m_env, true))
   {
     throw0(DB_ERROR(lmdb_error("Failed to sync database: ", result).c_str()));
@@ -2546,6 +3475,8 @@ void BlockchainLMDB::safesyncmode(const bool onoff)
 {
   MINFO("switching safe mode " << (onoff ? "on" : "off"));
   mdb_env_set_flags(m_env, MDB_NOSYNC|MDB_MAPASYNC, !onoff);
+  if (m_cold_env)
+    mdb_env_set_flags(m_cold_env, MDB_NOSYNC|MDB_MAPASYNC, !onoff);
 }
 
 void BlockchainLMDB::reset()
@@ -2602,6 +3533,16 @@ void BlockchainLMDB::reset()
     throw0(DB_ERROR(lmdb_error("Failed to drop m_audit_blocks: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_carrot_yield_txs, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_carrot_yield_txs: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_block_scan_records, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_scan_records: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_supply_series, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_supply_series: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_block_emission_totals, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_emission_totals: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_tx_type_index, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_tx_type_index: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_output_asset_index, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_output_asset_index: ", result).c_str()));
 
   // init with current version
   MDB_val_str(k, "version");
@@ -2609,9 +3550,33 @@ void BlockchainLMDB::reset()
   if (auto result = mdb_put(txn, m_properties, &k, &v, 0))
     throw0(DB_ERROR(lmdb_error("Failed to write version to database: ", result).c_str()));
 
+  if (m_cold_env)
+  {
+    MDB_val_str(k_cold, "cold_prunable");
+    MDB_val_copy<uint32_t> v_cold(1);
+    if (auto result = mdb_put(txn, m_properties, &k_cold, &v_cold, 0))
+      throw0(DB_ERROR(lmdb_error("Failed to write cold storage marker to database: ", result).c_str()));
+  }
+
+  m_tx_index = false;
+  open_tx_index(txn, 0, false);
+
   txn.commit();
+
+  // after the main db, so a failure here only leaves stale data, cleared on the next open
+  if (m_cold_env)
+  {
+    mdb_txn_safe ctxn;
+    if (auto result = lmdb_txn_begin(m_cold_env, NULL, 0, ctxn))
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the cold db: ", result).c_str()));
+    if (auto result = mdb_drop(ctxn, m_cold_txs_prunable, 0))
+      throw0(DB_ERROR(lmdb_error("Failed to drop m_cold_txs_prunable: ", result).c_str()));
+    ctxn.commit();
+  }
   m_cum_size = 0;
   m_cum_count = 0;
+  ++m_circulating_supply_generation;
+  m_key_image_filter.clear();
 }
 
 std::vector<std::string> BlockchainLMDB::get_filenames() const
@@ -2627,6 +3592,12 @@ std::vector<std::string> BlockchainLMDB::get_filenames() const
   filenames.push_back(datafile.string());
   filenames.push_back(lockfile.string());
 
+  if (m_cold_env)
+  {
+    filenames.push_back((boost::filesystem::path(m_cold_folder) / CRYPTONOTE_BLOCKCHAINDATA_FILENAME).string());
+    filenames.push_back((boost::filesystem::path(m_cold_folder) / CRYPTONOTE_BLOCKCHAINDATA_LOCK_FILENAME).string());
+  }
+
   return filenames;
 }
 
@@ -2947,7 +3918,7 @@ static bool is_v1_tx(MDB_cursor *c_txs_pruned, MDB_val *tx_id)
 
 enum { prune_mode_prune, prune_mode_update, prune_mode_check };
 
-bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
+bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed, size_t max_records, bool *done)
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   const uint32_t log_stripes = tools::get_pruning_log_stripes(pruning_seed);
@@ -2968,8 +3939,27 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
 
+  // with cold storage the prunable data is changed in a txn of its own, which
+  // commits after the main one, so a failure in between only leaves data that
+  // should have been pruned
+  const MDB_dbi prunable_dbi = m_cold_env ? m_cold_txs_prunable : m_txs_prunable;
+  std::unique_ptr<mdb_txn_safe> cold_txn;
+  auto prunable_txn_begin = [&]() -> MDB_txn* {
+    if (!m_cold_env)
+      return txn;
+    cold_txn.reset(new mdb_txn_safe());
+    if (auto res = lmdb_txn_begin(m_cold_env, NULL, 0, *cold_txn))
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the cold db: ", res).c_str()));
+    return *cold_txn;
+  };
+  auto prunable_txn_commit = [&]() {
+    if (cold_txn)
+      cold_txn->commit();
+  };
+  MDB_txn *ptxn = prunable_txn_begin();
+
   MDB_stat db_stats;
-  if ((result = mdb_stat(txn, m_txs_prunable, &db_stats)))
+  if ((result = mdb_stat(ptxn, prunable_dbi, &db_stats)))
     throw0(DB_ERROR(lmdb_error("Failed to query m_txs_prunable: ", result).c_str()));
   const size_t pages0 = db_stats.ms_branch_pages + db_stats.ms_leaf_pages + db_stats.ms_overflow_pages;
 
@@ -3017,16 +4007,18 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
     throw0(DB_ERROR(lmdb_error("Failed to retrieve or create pruning seed: ", result).c_str()));
   }
 
+  // incremental steps run often, so only log them at debug level
+  const el::Level log_level = max_records ? el::Level::Debug : el::Level::Info;
   if (mode == prune_mode_check)
-    MINFO("Checking blockchain pruning...");
+    MCLOG(log_level, MONERO_DEFAULT_LOG_CATEGORY, el::Color::Default, "Checking blockchain pruning...");
   else
-    MINFO("Pruning blockchain...");
+    MCLOG(log_level, MONERO_DEFAULT_LOG_CATEGORY, el::Color::Default, "Pruning blockchain...");
 
   MDB_cursor *c_txs_pruned, *c_txs_prunable, *c_txs_prunable_tip;
   result = mdb_cursor_open(txn, m_txs_pruned, &c_txs_pruned);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
-  result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable);
+  result = mdb_cursor_open(ptxn, prunable_dbi, &c_txs_prunable);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
   result = mdb_cursor_open(txn, m_txs_prunable_tip, &c_txs_prunable_tip);
@@ -3078,13 +4070,15 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
         {
           MDEBUG("Committing txn at checkpoint...");
           txn.commit();
+          prunable_txn_commit();
           result = mdb_txn_begin(m_env, NULL, 0, txn);
           if (result)
             throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+          ptxn = prunable_txn_begin();
           result = mdb_cursor_open(txn, m_txs_pruned, &c_txs_pruned);
           if (result)
             throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
-          result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable);
+          result = mdb_cursor_open(ptxn, prunable_dbi, &c_txs_prunable);
           if (result)
             throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
           result = mdb_cursor_open(txn, m_txs_prunable_tip, &c_txs_prunable_tip);
@@ -3102,7 +4096,20 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
     if (result)
       throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
     MDB_cursor_op op = MDB_FIRST;
-    while (1)
+    bool finished = true, at_end = false;
+    if (max_records && m_prune_resume_valid)
+    {
+      // carry on from the last tx visited, or the next one if it has since been removed
+      MDB_val val;
+      val.mv_size = sizeof(m_prune_resume);
+      val.mv_data = (void *)&m_prune_resume;
+      result = mdb_cursor_get(c_tx_indices, (MDB_val*)&zerokval, &val, MDB_GET_BOTH_RANGE);
+      if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to restore cursor for tx_indices: ", result).c_str()));
+      op = MDB_GET_CURRENT;
+      at_end = result == MDB_NOTFOUND;
+    }
+    while (!at_end)
     {
       int ret = mdb_cursor_get(c_tx_indices, &k, &v, op);
       op = MDB_NEXT;
@@ -3111,6 +4118,13 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
       if (ret)
         throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
 
+      if (max_records && n_total_records >= max_records)
+      {
+        memcpy(&m_prune_resume, v.mv_data, sizeof(m_prune_resume));
+        finished = false;
+        break;
+      }
+
       ++n_total_records;
       //const txindex *ti = (const txindex *)v.mv_data;
       txindex ti;
@@ -3183,13 +4197,15 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
       {
         MDEBUG("Committing txn at checkpoint...");
         txn.commit();
+        prunable_txn_commit();
         result = mdb_txn_begin(m_env, NULL, 0, txn);
         if (result)
           throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        ptxn = prunable_txn_begin();
         result = mdb_cursor_open(txn, m_txs_pruned, &c_txs_pruned);
         if (result)
           throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
-        result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable);
+        result = mdb_cursor_open(ptxn, prunable_dbi, &c_txs_prunable);
         if (result)
           throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
         result = mdb_cursor_open(txn, m_txs_prunable_tip, &c_txs_prunable_tip);
@@ -3208,9 +4224,15 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
       }
     }
     mdb_cursor_close(c_tx_indices);
+    if (max_records)
+    {
+      m_prune_resume_valid = !finished;
+      if (done)
+        *done = finished;
+    }
   }
 
-  if ((result = mdb_stat(txn, m_txs_prunable, &db_stats)))
+  if ((result = mdb_stat(ptxn, prunable_dbi, &db_stats)))
     throw0(DB_ERROR(lmdb_error("Failed to query m_txs_prunable: ", result).c_str()));
   const size_t pages1 = db_stats.ms_branch_pages + db_stats.ms_leaf_pages + db_stats.ms_overflow_pages;
   const size_t db_bytes = (pages0 - pages1) * db_stats.ms_psize;
@@ -3220,10 +4242,11 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed)
   mdb_cursor_close(c_txs_pruned);
 
   txn.commit();
+  prunable_txn_commit();
 
   TIME_MEASURE_FINISH(t);
 
-  MINFO((mode == prune_mode_check ? "Checked" : "Pruned") << " blockchain in " <<
+  MCLOG(log_level, MONERO_DEFAULT_LOG_CATEGORY, el::Color::Default, (mode == prune_mode_check ? "Checked" : "Pruned") << " blockchain in " <<
       t << " ms: " << (n_bytes/1024.0f/1024.0f) << " MB (" << db_bytes/1024.0f/1024.0f << " MB) pruned in " <<
       n_pruned_records << " records (" << pages0 - pages1 << "/" << pages0 << " " << db_stats.ms_psize << " byte pages), " <<
       n_prunable_records << "/" << n_total_records << " pruned records");
@@ -3245,6 +4268,26 @@ bool BlockchainLMDB::check_pruning()
   return prune_worker(prune_mode_check, 0);
 }
 
+bool BlockchainLMDB::prune_blockchain_step(size_t max_records, uint32_t pruning_seed)
+{
+  bool done = true;
+  if (max_records == 0)
+    throw0(DB_ERROR("prune_blockchain_step needs a positive record count"));
+  prune_worker(prune_mode_prune, pruning_seed, max_records, &done);
+  return done;
+}
+
+void BlockchainLMDB::copy_compacted(const std::string& path) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  // this only needs a read txn, so it can run next to the writer
+  MINFO("Writing compacted copy of the blockchain to " << path);
+  if (int result = mdb_env_copy2(m_env, path.c_str(), MDB_CP_COMPACT))
+    throw0(DB_ERROR(lmdb_error("Failed to write compacted copy of the db: ", result).c_str()));
+}
+
 bool BlockchainLMDB::for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob, relay_category category) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -3514,7 +4557,7 @@ std::pair<std::vector<uint64_t>, uint64_t> BlockchainLMDB::get_block_cumulative_
     // and is expecting the global output distribution that isn't bucketed by asset type in response
     res.push_back(asset_type.empty() ? bi->bi_cum_rct : bi->bi_cum_rct_by_asset_type[asset_type]);
 
-    if (height == heights[heights.size() - CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE])
+    if (heights.size() >= CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE && height == heights[heights.size() - CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE])
       num_spendable_global_outs = bi->bi_cum_rct;
 
     prev_height = height;
@@ -3900,6 +4943,38 @@ uint64_t BlockchainLMDB::height() const
 }
 
 std::map<std::string,uint64_t> BlockchainLMDB::get_circulating_supply() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+
+  // the writer sees its own uncommitted changes, which must not be shared with other threads;
+  // a read-only env is written by another process, so the generation would never move
+  if (is_read_only() || (m_write_txn && m_writer == boost::this_thread::get_id()))
+    return read_circulating_supply();
+
+  // read the generation before the db, so a commit racing with the read leaves the snapshot stale
+  const uint64_t generation = m_circulating_supply_generation;
+  const std::shared_ptr<const circulating_supply_snapshot> snapshot = std::atomic_load(&m_circulating_supply_snapshot);
+  if (snapshot && snapshot->generation == generation)
+    return snapshot->supply;
+
+  std::shared_ptr<circulating_supply_snapshot> new_snapshot = std::make_shared<circulating_supply_snapshot>();
+  new_snapshot->generation = generation;
+  new_snapshot->supply = read_circulating_supply();
+  std::atomic_store(&m_circulating_supply_snapshot, std::shared_ptr<const circulating_supply_snapshot>(new_snapshot));
+  return new_snapshot->supply;
+}
+
+void BlockchainLMDB::end_circulating_supply_write()
+{
+  // committed or rolled back, either way what other threads read may have changed
+  if (m_circulating_supply_write_pending)
+  {
+    m_circulating_supply_write_pending = false;
+    ++m_circulating_supply_generation;
+  }
+}
+
+std::map<std::string,uint64_t> BlockchainLMDB::read_circulating_supply() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   std::map<std::string, uint64_t> circulating_supply;
@@ -4087,7 +5162,7 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd
   TXN_PREFIX_RDONLY();
   RCURSOR(tx_indices);
   RCURSOR(txs_pruned);
-  RCURSOR(txs_prunable);
+  PRUNABLE_RCURSOR();
 
   MDB_val_set(v, h);
   MDB_val result0, result1;
@@ -4198,7 +5273,7 @@ bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_block_cou
   RCURSOR(txs_pruned);
   if (!pruned)
   {
-    RCURSOR(txs_prunable);
+    PRUNABLE_RCURSOR();
   }
 
   blocks.reserve(std::min<size_t>(max_block_count, 10000)); // guard against very large max count if only checking bytes
@@ -4308,7 +5383,7 @@ bool BlockchainLMDB::get_prunable_tx_blob(const crypto::hash& h, cryptonote::blo
 
   TXN_PREFIX_RDONLY();
   RCURSOR(tx_indices);
-  RCURSOR(txs_prunable);
+  PRUNABLE_RCURSOR();
 
   MDB_val_set(v, h);
   MDB_val result;
@@ -4514,11 +5589,13 @@ void BlockchainLMDB::get_output_id_from_asset_type_output_index(const std::strin
   uint32_t asset_type = cryptonote::asset_id_from_type(asset_type_str);
   MDB_val_copy<uint32_t> k_type(asset_type);
 
+  // ring members are sorted, so most lookups step forward from the previous one
+  dup_cursor_position pos;
   for (size_t i = 0; i < asset_type_output_indices.size(); ++i)
   {
-    MDB_val_set(v, asset_type_output_indices[i]);
+    MDB_val v;
 
-    auto get_result = mdb_cursor_get(m_cur_output_types, &k_type, &v, MDB_GET_BOTH);
+    auto get_result = cursor_get_dup_sorted(m_cur_output_types, k_type, v, asset_type_output_indices[i], pos);
     if (get_result == MDB_NOTFOUND)
     {
       throw1(OUTPUT_DNE((std::string("Attempting to get output id by asset type output id (asset type " + asset_type_str + " asset type ouput id " + boost::lexical_cast<std::string>(asset_type_output_indices[i]) + "), but key does not exist (current height " + boost::lexical_cast<std::string>(height()) + ")").c_str())));
@@ -4643,6 +5720,9 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  if (!m_key_image_filter.maybe_contains(img))
+    return false;
+
   bool ret;
 
   TXN_PREFIX_RDONLY();
@@ -4655,6 +5735,108 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   return ret;
 }
 
+void BlockchainLMDB::has_key_images(const epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  spent.assign(key_images.size(), false);
+
+  // the filter rules out most of them, the rest are probed in the db's own order
+  std::vector<size_t> candidates;
+  for (size_t n = 0; n < key_images.size(); ++n)
+    if (m_key_image_filter.maybe_contains(key_images[n]))
+      candidates.push_back(n);
+  if (candidates.empty())
+    return;
+
+  const auto compare = [](const crypto::key_image &a, const crypto::key_image &b) {
+    MDB_val va = {sizeof(a), (void *)&a}, vb = {sizeof(b), (void *)&b};
+    return compare_hash32(&va, &vb);
+  };
+  std::sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+    return compare(key_images[a], key_images[b]) < 0;
+  });
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(spent_keys);
+
+  // each seek lands on the first stored image not below the probe, which
+  // also answers every following probe up to it without another seek
+  crypto::key_image next;
+  bool have_next = false;
+  for (const size_t n: candidates)
+  {
+    const crypto::key_image &img = key_images[n];
+    if (!have_next || compare(img, next) > 0)
+    {
+      MDB_val k = {sizeof(img), (void *)&img};
+      const int result = mdb_cursor_get(m_cur_spent_keys, (MDB_val *)&zerokval, &k, MDB_GET_BOTH_RANGE);
+      if (result == MDB_NOTFOUND)
+        break;
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to look up key images: ", result).c_str()));
+      next = *(const crypto::key_image*)k.mv_data;
+      have_next = true;
+    }
+    spent[n] = compare(img, next) == 0;
+  }
+
+  TXN_POSTFIX_RDONLY();
+}
+
+void BlockchainLMDB::build_key_image_filter()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  // a read-only env is written by another process, whose key images would never reach
+  // this filter, so leave it not ready and let every lookup go to the db
+  if (is_read_only())
+  {
+    MINFO("Database is read-only, not using a key image filter");
+    return;
+  }
+
+  // without it every lookup just goes to the db, so a failure here needn't stop the daemon
+  try
+  {
+    TIME_MEASURE_START(t);
+    TXN_PREFIX_RDONLY();
+    RCURSOR(spent_keys);
+
+    MDB_stat db_stats;
+    if (auto result = mdb_stat(m_txn, m_spent_keys, &db_stats))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_spent_keys: ", result).c_str()));
+    m_key_image_filter.reset(std::max<uint64_t>(KEY_IMAGE_FILTER_MIN_CAPACITY, db_stats.ms_entries * 2));
+
+    // all key images are dups of one key, so read them a page at a time
+    MDB_val k, v;
+    int result = mdb_cursor_get(m_cur_spent_keys, &k, &v, MDB_FIRST);
+    if (result == 0)
+      result = mdb_cursor_get(m_cur_spent_keys, &k, &v, MDB_GET_MULTIPLE);
+    while (result == 0)
+    {
+      const crypto::key_image *images = (const crypto::key_image *)v.mv_data;
+      for (size_t i = 0; i < v.mv_size / sizeof(crypto::key_image); ++i)
+        m_key_image_filter.insert(images[i]);
+      result = mdb_cursor_get(m_cur_spent_keys, &k, &v, MDB_NEXT_MULTIPLE);
+    }
+    if (result != MDB_NOTFOUND)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate key images: ", result).c_str()));
+
+    TXN_POSTFIX_RDONLY();
+    m_key_image_filter.set_ready();
+    TIME_MEASURE_FINISH(t);
+    MINFO("Key image filter built in " << t << " ms: " << m_key_image_filter.size() << " key images, " <<
+        m_key_image_filter.memory_size() / 1024 / 1024 << " MB");
+  }
+  catch (const std::exception &e)
+  {
+    MWARNING("Failed to build the key image filter, key image lookups will all go to the db: " << e.what());
+  }
+}
+
 bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_image&)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4688,6 +5870,68 @@ bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_ima
   return fret;
 }
 
+bool BlockchainLMDB::for_all_state_records(std::function<bool(const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value)> f) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+
+  // the order is part of the snapshot format, append new tables at the end
+  const std::pair<const char*, MDB_dbi> tables[] = {
+    {LMDB_OUTPUT_TXS, m_output_txs},
+    {LMDB_OUTPUT_AMOUNTS, m_output_amounts},
+    {LMDB_OUTPUT_TYPES, m_output_types},
+    {LMDB_SPENT_KEYS, m_spent_keys},
+    {LMDB_CIRC_SUPPLY, m_circ_supply},
+    {LMDB_CIRC_SUPPLY_TALLY, m_circ_supply_tally},
+    {LMDB_YIELD_TXS, m_yield_txs},
+    {LMDB_YIELD_BLOCKS, m_yield_blocks},
+    {LMDB_AUDIT_TXS, m_audit_txs},
+    {LMDB_AUDIT_BLOCKS, m_audit_blocks},
+    {LMDB_CARROT_YIELD_TXS, m_carrot_yield_txs},
+    {LMDB_HF_VERSIONS, m_hf_versions},
+  };
+
+  bool fret = true;
+  for (const auto &table: tables)
+  {
+    MDB_cursor *cur;
+    int result = mdb_cursor_open(m_txn, table.second, &cur);
+    if (result)
+      throw0(DB_ERROR(lmdb_error(std::string("Failed to open cursor for ") + table.first + ": ", result).c_str()));
+
+    MDB_val k, v;
+    MDB_cursor_op op = MDB_FIRST;
+    while (1)
+    {
+      result = mdb_cursor_get(cur, &k, &v, op);
+      op = MDB_NEXT;
+      if (result == MDB_NOTFOUND)
+        break;
+      if (result)
+      {
+        mdb_cursor_close(cur);
+        throw0(DB_ERROR(lmdb_error(std::string("Failed to enumerate ") + table.first + ": ", result).c_str()));
+      }
+      const epee::span<const uint8_t> key{static_cast<const uint8_t*>(k.mv_data), k.mv_size};
+      const epee::span<const uint8_t> value{static_cast<const uint8_t*>(v.mv_data), v.mv_size};
+      if (!f(table.first, key, value))
+      {
+        fret = false;
+        break;
+      }
+    }
+    mdb_cursor_close(cur);
+    if (!fret)
+      break;
+  }
+
+  TXN_POSTFIX_RDONLY();
+
+  return fret;
+}
+
 bool BlockchainLMDB::for_blocks_range(const uint64_t& h1, const uint64_t& h2, std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4745,7 +5989,7 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash&
 
   TXN_PREFIX_RDONLY();
   RCURSOR(txs_pruned);
-  RCURSOR(txs_prunable);
+  PRUNABLE_RCURSOR();
   RCURSOR(tx_indices);
 
   MDB_val k;
@@ -4801,6 +6045,48 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash&
   return fret;
 }
 
+bool BlockchainLMDB::for_transactions_range(uint64_t tx_id_start, uint64_t tx_id_end, const std::function<bool(uint64_t, const cryptonote::transaction&)> &f) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  if (tx_id_start >= tx_id_end)
+    return true;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(txs_pruned);
+
+  MDB_val_set(k, tx_id_start);
+  MDB_val v;
+  bool fret = true;
+
+  MDB_cursor_op op = MDB_SET_RANGE;
+  while (1)
+  {
+    int ret = mdb_cursor_get(m_cur_txs_pruned, &k, &v, op);
+    op = MDB_NEXT;
+    if (ret == MDB_NOTFOUND)
+      break;
+    if (ret)
+      throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
+    const uint64_t tx_id = *(const uint64_t*)k.mv_data;
+    if (tx_id >= tx_id_end)
+      break;
+    transaction tx;
+    blobdata_ref bd{reinterpret_cast<char*>(v.mv_data), v.mv_size};
+    if (!parse_and_validate_tx_base_from_blob(bd, tx))
+      throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
+    if (!f(tx_id, tx)) {
+      fret = false;
+      break;
+    }
+  }
+
+  TXN_POSTFIX_RDONLY();
+
+  return fret;
+}
+
 bool BlockchainLMDB::for_all_outputs(std::function<bool(uint64_t amount, const crypto::hash &tx_hash, uint64_t height, size_t tx_idx)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -4893,6 +6179,16 @@ bool BlockchainLMDB::batch_start(uint64_t batch_num_blocks, uint64_t batch_bytes
   m_writer = boost::this_thread::get_id();
   check_and_resize_for_batch(batch_num_blocks, batch_bytes);
 
+  batch_txn_begin();
+
+  m_batch_active = true;
+
+  LOG_PRINT_L3("batch transaction: begin");
+  return true;
+}
+
+void BlockchainLMDB::batch_txn_begin()
+{
   m_write_batch_txn = new mdb_txn_safe();
 
   // NOTE: need to make sure it's destroyed properly when done
@@ -4907,17 +6203,34 @@ bool BlockchainLMDB::batch_start(uint64_t batch_num_blocks, uint64_t batch_bytes
   m_write_batch_txn->m_batch_txn = true;
   m_write_txn = m_write_batch_txn;
 
-  m_batch_active = true;
   memset(&m_wcursors, 0, sizeof(m_wcursors));
   if (m_tinfo.get())
   {
     if (m_tinfo->m_ti_rflags.m_rf_txn)
       mdb_txn_reset(m_tinfo->m_ti_rtxn);
+    reset_cold_rtxn(m_tinfo.get());
     memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
   }
+}
 
-  LOG_PRINT_L3("batch transaction: begin");
-  return true;
+// LMDB can only change the map size while no transaction is open, so the batch
+// commits what it has so far at this block boundary, and carries on in a new
+// transaction once the map is resized
+void BlockchainLMDB::batch_checkpoint_and_resize()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  batch_commit();
+  try
+  {
+    do_resize();
+    batch_txn_begin();
+  }
+  catch (...)
+  {
+    m_batch_active = false;
+    throw;
+  }
+  LOG_PRINT_L3("batch transaction: resumed after resize");
 }
 
 void BlockchainLMDB::batch_commit()
@@ -4936,6 +6249,7 @@ void BlockchainLMDB::batch_commit()
 
   LOG_PRINT_L3("batch transaction: committing...");
   TIME_MEASURE_START(time1);
+  cold_wtxn_commit();
   m_write_txn->commit();
   TIME_MEASURE_FINISH(time1);
   time_commit1 += time1;
@@ -4945,16 +6259,19 @@ void BlockchainLMDB::batch_commit()
   delete m_write_batch_txn;
   m_write_batch_txn = nullptr;
   memset(&m_wcursors, 0, sizeof(m_wcursors));
+  end_circulating_supply_write();
 }
 
 void BlockchainLMDB::cleanup_batch()
 {
   // for destruction of batch transaction
+  cold_wtxn_abort();
   m_write_txn = nullptr;
   delete m_write_batch_txn;
   m_write_batch_txn = nullptr;
   m_batch_active = false;
   memset(&m_wcursors, 0, sizeof(m_wcursors));
+  end_circulating_supply_write();
 }
 
 void BlockchainLMDB::batch_stop()
@@ -4973,6 +6290,7 @@ void BlockchainLMDB::batch_stop()
   TIME_MEASURE_START(time1);
   try
   {
+    cold_wtxn_commit();
     m_write_txn->commit();
     TIME_MEASURE_FINISH(time1);
     time_commit1 += time1;
@@ -4999,6 +6317,7 @@ void BlockchainLMDB::batch_abort()
     throw1(DB_ERROR("batch transaction owned by other thread"));
   check_open();
   // for destruction of batch transaction
+  cold_wtxn_abort();
   m_write_txn = nullptr;
   // explicitly call in case mdb_env_close() (BlockchainLMDB::close()) called before BlockchainLMDB destructor called.
   m_write_batch_txn->abort();
@@ -5006,6 +6325,7 @@ void BlockchainLMDB::batch_abort()
   m_write_batch_txn = nullptr;
   m_batch_active = false;
   memset(&m_wcursors, 0, sizeof(m_wcursors));
+  end_circulating_supply_write();
   LOG_PRINT_L3("batch transaction: aborted");
 }
 
@@ -5041,6 +6361,11 @@ bool BlockchainLMDB::block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) co
     memset(&tinfo->m_ti_rflags, 0, sizeof(tinfo->m_ti_rflags));
     if (auto mdb_res = lmdb_txn_begin(m_env, NULL, MDB_RDONLY, &tinfo->m_ti_rtxn))
       throw0(DB_ERROR_TXN_START(lmdb_error("Failed to create a read transaction for the db: ", mdb_res).c_str()));
+    tinfo->m_ti_thread = boost::this_thread::get_id();
+    {
+      boost::lock_guard<boost::mutex> lock(threadinfo_registry_lock);
+      threadinfo_registry.insert(tinfo);
+    }
     ret = true;
   } else if (!tinfo->m_ti_rflags.m_rf_txn)
   {
@@ -5049,7 +6374,10 @@ bool BlockchainLMDB::block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) co
     ret = true;
   }
   if (ret)
+  {
     tinfo->m_ti_rflags.m_rf_txn = true;
+    tinfo->m_ti_rtxn_start = steady_ms();
+  }
   *mtxn = tinfo->m_ti_rtxn;
   *mcur = &tinfo->m_ti_rcursors;
 
@@ -5061,7 +6389,9 @@ bool BlockchainLMDB::block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) co
 void BlockchainLMDB::block_rtxn_stop() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  m_tinfo->m_ti_rtxn_start = 0;
   mdb_txn_reset(m_tinfo->m_ti_rtxn);
+  reset_cold_rtxn(m_tinfo.get());
   memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
   /* cancel out the increment from rtxn_start */
   mdb_txn_safe::increment_txns(-1);
@@ -5106,6 +6436,7 @@ void BlockchainLMDB::block_wtxn_start()
     {
       if (m_tinfo->m_ti_rflags.m_rf_txn)
         mdb_txn_reset(m_tinfo->m_ti_rtxn);
+      reset_cold_rtxn(m_tinfo.get());
       memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
     }
   } else if (m_writer != boost::this_thread::get_id())
@@ -5123,6 +6454,7 @@ void BlockchainLMDB::block_wtxn_stop()
     if (! m_batch_active)
 	{
       TIME_MEASURE_START(time1);
+      cold_wtxn_commit();
       m_write_txn->commit();
       TIME_MEASURE_FINISH(time1);
       time_commit1 += time1;
@@ -5130,6 +6462,7 @@ void BlockchainLMDB::block_wtxn_stop()
       delete m_write_txn;
       m_write_txn = nullptr;
       memset(&m_wcursors, 0, sizeof(m_wcursors));
+      end_circulating_supply_write();
 	}
   }
 }
@@ -5144,19 +6477,115 @@ void BlockchainLMDB::block_wtxn_abort()
 
   if (! m_batch_active)
   {
+    cold_wtxn_abort();
     delete m_write_txn;
     m_write_txn = nullptr;
     memset(&m_wcursors, 0, sizeof(m_wcursors));
+    end_circulating_supply_write();
   }
 }
 
 void BlockchainLMDB::block_rtxn_abort() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  m_tinfo->m_ti_rtxn_start = 0;
   mdb_txn_reset(m_tinfo->m_ti_rtxn);
+  reset_cold_rtxn(m_tinfo.get());
   memset(&m_tinfo->m_ti_rflags, 0, sizeof(m_tinfo->m_ti_rflags));
 }
 
+// opens the txs_prunable cursor in the cold env, in the txn matching the one
+// the cursors belong to, starting it if needed
+void BlockchainLMDB::cold_prunable_cursor(mdb_txn_cursors *cursors) const
+{
+  MDB_cursor *&cur = cursors->m_txc_txs_prunable;
+  if (cursors == &m_wcursors)
+  {
+    if (!m_cold_write_txn)
+    {
+      mdb_txn_safe *txn = new mdb_txn_safe();
+      if (auto result = lmdb_txn_begin(m_cold_env, NULL, 0, *txn))
+      {
+        delete txn;
+        throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the cold db: ", result).c_str()));
+      }
+      m_cold_write_txn = txn;
+      cur = NULL;
+    }
+    if (!cur)
+    {
+      if (auto result = mdb_cursor_open(*m_cold_write_txn, m_cold_txs_prunable, &cur))
+        throw0(DB_ERROR(lmdb_error("Failed to open cursor: ", result).c_str()));
+    }
+    return;
+  }
+
+  mdb_threadinfo *tinfo = m_tinfo.get();
+  if (!tinfo->m_ti_cold_active)
+  {
+    int result;
+    if (!tinfo->m_ti_cold_rtxn)
+      result = lmdb_txn_begin(m_cold_env, NULL, MDB_RDONLY, &tinfo->m_ti_cold_rtxn);
+    else
+      result = lmdb_txn_renew(tinfo->m_ti_cold_rtxn);
+    if (result)
+      throw0(DB_ERROR_TXN_START(lmdb_error("Failed to create a read transaction for the cold db: ", result).c_str()));
+    tinfo->m_ti_cold_active = true;
+  }
+  if (!cur)
+  {
+    if (auto result = mdb_cursor_open(tinfo->m_ti_cold_rtxn, m_cold_txs_prunable, &cur))
+      throw0(DB_ERROR(lmdb_error("Failed to open cursor: ", result).c_str()));
+    tinfo->m_ti_rflags.m_rf_txs_prunable = true;
+  }
+  else if (!tinfo->m_ti_rflags.m_rf_txs_prunable)
+  {
+    if (auto result = mdb_cursor_renew(tinfo->m_ti_cold_rtxn, cur))
+      throw0(DB_ERROR(lmdb_error("Failed to renew cursor: ", result).c_str()));
+    tinfo->m_ti_rflags.m_rf_txs_prunable = true;
+  }
+}
+
+// The cold txn commits first: if the main one then fails, all that's left is
+// prunable data for txs that aren't in the db, which is overwritten or
+// cleared later. The other way round could lose prunable data.
+void BlockchainLMDB::cold_wtxn_commit()
+{
+  if (!m_cold_write_txn)
+    return;
+  std::unique_ptr<mdb_txn_safe> txn(m_cold_write_txn);
+  m_cold_write_txn = nullptr;
+  m_wcursors.m_txc_txs_prunable = NULL;
+  txn->commit("Failed to commit a transaction to the cold db");
+}
+
+void BlockchainLMDB::cold_wtxn_abort()
+{
+  delete m_cold_write_txn;
+  m_cold_write_txn = nullptr;
+  m_wcursors.m_txc_txs_prunable = NULL;
+}
+
+size_t BlockchainLMDB::report_long_read_txns(uint64_t threshold_seconds) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  const uint64_t now = steady_ms();
+  size_t n_reported = 0;
+  boost::lock_guard<boost::mutex> lock(threadinfo_registry_lock);
+  for (const mdb_threadinfo *tinfo: threadinfo_registry)
+  {
+    const uint64_t start = tinfo->m_ti_rtxn_start;
+    if (!start || now < start || now - start < threshold_seconds * 1000)
+      continue;
+    if (mdb_txn_env(tinfo->m_ti_rtxn) != m_env)
+      continue;
+    MWARNING("Read txn held for " << (now - start) / 1000 << " seconds by thread " << tinfo->m_ti_thread <<
+        ", the db can't reuse pages freed since it started");
+    ++n_reported;
+  }
+  return n_reported;
+}
+
 uint64_t BlockchainLMDB::add_block(const std::pair<block, blobdata>& blk, size_t block_weight, uint64_t long_term_block_weight, const difficulty_type& cumulative_difficulty, const uint64_t& coins_generated,
                                    const std::vector<std::pair<transaction, blobdata>>& txs, const cryptonote::network_type nettype, cryptonote::yield_block_info& ybi, cryptonote::audit_block_info& abi)
 {
@@ -5164,16 +6593,25 @@ uint64_t BlockchainLMDB::add_block(const std::pair<block, blobdata>& blk, size_t
   check_open();
   uint64_t m_height = height();
 
-  if (m_height % 1024 == 0)
+  if (m_batch_active)
+  {
+    // the size estimated at the start of the batch may fall short, so keep checking as it goes
+    if (m_height % RESIZE_BATCH_CHECK_INTERVAL == 0 && m_writer == boost::this_thread::get_id() && need_resize())
+    {
+      LOG_PRINT_L0("LMDB memory map needs to be resized during a batch transaction, doing that now.");
+      batch_checkpoint_and_resize();
+    }
+  }
+  else if (m_height % 1024 == 0)
   {
-    // for batch mode, DB resize check is done at start of batch transaction
-    if (! m_batch_active && need_resize())
+    if (need_resize())
     {
       LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
       do_resize();
     }
   }
 
+  m_circulating_supply_write_pending = true;
   try
   {
     BlockchainDB::add_block(blk, block_weight, long_term_block_weight, cumulative_difficulty, coins_generated, txs, nettype, ybi, abi);
@@ -5192,6 +6630,7 @@ void BlockchainLMDB::pop_block(block& blk, std::vector<transaction>& txs)
   check_open();
 
   block_wtxn_start();
+  m_circulating_supply_write_pending = true;
 
   try
   {
@@ -5248,13 +6687,17 @@ void BlockchainLMDB::get_output_key(const epee::span<const uint64_t> &amounts, c
 
   RCURSOR(output_amounts);
 
+  // ring members are sorted, so most lookups step forward from the previous one
+  dup_cursor_position pos;
   for (size_t i = 0; i < offsets.size(); ++i)
   {
     const uint64_t amount = amounts.size() == 1 ? amounts[0] : amounts[i];
+    if (i > 0 && amount != (amounts.size() == 1 ? amounts[0] : amounts[i - 1]))
+      pos.valid = false;
     MDB_val_set(k, amount);
-    MDB_val_set(v, offsets[i]);
+    MDB_val v;
 
-    auto get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
+    auto get_result = cursor_get_dup_sorted(m_cur_output_amounts, k, v, offsets[i], pos);
     if (get_result == MDB_NOTFOUND)
     {
       if (allow_partial)
@@ -5645,7 +7088,54 @@ uint64_t BlockchainLMDB::get_database_size() const
   datafile /= CRYPTONOTE_BLOCKCHAINDATA_FILENAME;
   boost::system::error_code ec{};
   const boost::uintmax_t size = boost::filesystem::file_size(datafile, ec);
-  return (ec ? 0 : static_cast<uint64_t>(size));
+  uint64_t total = ec ? 0 : static_cast<uint64_t>(size);
+  if (m_cold_env)
+  {
+    const boost::uintmax_t cold_size = boost::filesystem::file_size(boost::filesystem::path(m_cold_folder) / CRYPTONOTE_BLOCKCHAINDATA_FILENAME, ec);
+    if (!ec)
+      total += cold_size;
+  }
+  return total;
+}
+
+uint64_t BlockchainLMDB::get_database_resident_size() const
+{
+#ifdef WIN32
+  return 0;
+#else
+  const long page_size = sysconf(_SC_PAGESIZE);
+  if (page_size <= 0)
+    return 0;
+
+  // mincore over the used part of the map, in chunks so the status vector stays small
+  const auto resident = [page_size](MDB_env *env) -> uint64_t
+  {
+    MDB_envinfo info;
+    MDB_stat stat;
+    if (!env || mdb_env_info(env, &info) || mdb_env_stat(env, &stat) || !info.me_mapaddr)
+      return 0;
+    const size_t used = std::min<size_t>((info.me_last_pgno + 1) * stat.ms_psize, info.me_mapsize);
+    static constexpr const size_t chunk = 64 * 1024 * 1024;
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__)
+    std::vector<char> pages(chunk / page_size);
+#else
+    std::vector<unsigned char> pages(chunk / page_size);
+#endif
+    uint64_t total = 0;
+    char *addr = static_cast<char*>(info.me_mapaddr);
+    for (size_t offset = 0; offset < used; offset += chunk)
+    {
+      const size_t len = std::min(chunk, used - offset);
+      if (mincore(addr + offset, len, pages.data()) != 0)
+        return 0;
+      const size_t n_pages = (len + page_size - 1) / page_size;
+      for (size_t i = 0; i < n_pages; ++i)
+        total += (pages[i] & 1) ? page_size : 0;
+    }
+    return total;
+  };
+  return resident(m_env) + resident(m_cold_env);
+#endif
 }
 
 #define RENAME_DB(name) do { \
@@ -5675,25 +7165,55 @@ uint64_t BlockchainLMDB::get_database_size() const
 void BlockchainLMDB::migrate_2_3()
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
-  uint64_t i;
   int result;
   mdb_txn_safe txn(false);
-  MDB_val k, v;
-  char *ptr;
+  MDB_val v;
 
-  MGINFO_YELLOW("Migrating blockchain from DB version 2 to 3 - this may take a while:");
+  MGINFO_YELLOW("Migrating blockchain from DB version 2 to 3");
 
-  // Create the missing (and empty) "audit_block_info" records for all blocks
-  do {
-  } while(0);
-  
-  uint32_t version = VERSION;
+  // Records of blocks without one are built on demand from the stored block, so nothing is filled in
+  // here. Any record already there may have been left behind by a binary which popped blocks without
+  // knowing about the table, so start it over; the version bump keeps such binaries out from now on.
+  result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+  result = mdb_drop(txn, m_block_scan_records, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to empty block_scan_records: ", result).c_str()));
+
+  uint32_t version = 3;
   v.mv_data = (void *)&version;
   v.mv_size = sizeof(version);
   MDB_val_str(vk, "version");
+  result = mdb_put(txn, m_properties, &vk, &v, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+  txn.commit();
+}
+
+void BlockchainLMDB::migrate_3_4()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  int result;
+  mdb_txn_safe txn(false);
+  MDB_val v;
+
+  MGINFO_YELLOW("Migrating blockchain from DB version 3 to 4");
+
+  // Sums start at the first block added once the table is empty, and ranges reaching below that fall
+  // back to walking the blocks, so nothing is filled in here. As for block_scan_records, entries an
+  // older binary left behind after popping blocks would be wrong, so start the table over.
   result = mdb_txn_begin(m_env, NULL, 0, txn);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+  result = mdb_drop(txn, m_block_emission_totals, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to empty block_emission_totals: ", result).c_str()));
+
+  uint32_t version = 4;
+  v.mv_data = (void *)&version;
+  v.mv_size = sizeof(version);
+  MDB_val_str(vk, "version");
   result = mdb_put(txn, m_properties, &vk, &v, 0);
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
@@ -5702,8 +7222,10 @@ void BlockchainLMDB::migrate_2_3()
 
 void BlockchainLMDB::migrate(const uint32_t oldversion)
 {
-  //if (oldversion < 3)
-  //  migrate_2_3();
+  if (oldversion < 3)
+    migrate_2_3();
+  if (oldversion < 4)
+    migrate_3_4();
 }
 
 }  // namespace cryptonote
@@ -29,9 +29,11 @@
 #include <atomic>
 
 #include "blockchain_db/blockchain_db.h"
+#include "blockchain_db/key_image_filter.h"
 #include "cryptonote_basic/blobdatatype.h" // for type blobdata
 #include "ringct/rctTypes.h"
 #include <boost/thread/tss.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <lmdb.h>
 
@@ -81,6 +83,11 @@ typedef struct mdb_txn_cursors
   MDB_cursor *m_txc_audit_txs;
   MDB_cursor *m_txc_audit_blocks;
   MDB_cursor *m_txc_carrot_yield_txs;
+  MDB_cursor *m_txc_block_scan_records;
+  MDB_cursor *m_txc_supply_series;
+  MDB_cursor *m_txc_block_emission_totals;
+  MDB_cursor *m_txc_tx_type_index;
+  MDB_cursor *m_txc_output_asset_index;
 
 } mdb_txn_cursors;
 
@@ -110,6 +117,11 @@ typedef struct mdb_txn_cursors
 #define m_cur_audit_txs		m_cursors->m_txc_audit_txs
 #define m_cur_audit_blocks	m_cursors->m_txc_audit_blocks
 #define m_cur_carrot_yield_txs		m_cursors->m_txc_carrot_yield_txs
+#define m_cur_block_scan_records	m_cursors->m_txc_block_scan_records
+#define m_cur_supply_series	m_cursors->m_txc_supply_series
+#define m_cur_block_emission_totals	m_cursors->m_txc_block_emission_totals
+#define m_cur_tx_type_index	m_cursors->m_txc_tx_type_index
+#define m_cur_output_asset_index	m_cursors->m_txc_output_asset_index
 
 typedef struct mdb_rflags
 {
@@ -140,6 +152,11 @@ typedef struct mdb_rflags
   bool m_rf_audit_txs;
   bool m_rf_audit_blocks;
   bool m_rf_carrot_yield_txs;
+  bool m_rf_block_scan_records;
+  bool m_rf_supply_series;
+  bool m_rf_block_emission_totals;
+  bool m_rf_tx_type_index;
+  bool m_rf_output_asset_index;
 } mdb_rflags;
 
 typedef struct mdb_threadinfo
@@ -147,6 +164,10 @@ typedef struct mdb_threadinfo
   MDB_txn *m_ti_rtxn;	// per-thread read txn
   mdb_txn_cursors m_ti_rcursors;	// per-thread read cursors
   mdb_rflags m_ti_rflags;	// per-thread read state
+  std::atomic<uint64_t> m_ti_rtxn_start{0};	// steady clock ms when the read txn was started, 0 if none
+  boost::thread::id m_ti_thread;	// owning thread, for reporting
+  MDB_txn *m_ti_cold_rtxn = nullptr;	// per-thread read txn on the cold env, if one is open
+  bool m_ti_cold_active = false;	// whether m_ti_cold_rtxn is live in the current read txn
 
   ~mdb_threadinfo();
 } mdb_threadinfo;
@@ -315,6 +336,7 @@ public:
   virtual std::vector<std::vector<std::pair<uint64_t, uint64_t>>> get_tx_amount_output_indices(const uint64_t tx_id, size_t n_txes) const;
 
   virtual bool has_key_image(const crypto::key_image& img) const;
+  virtual void has_key_images(const epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const;
 
   virtual void add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata_ref &blob, const txpool_tx_meta_t& meta);
   virtual void update_txpool_tx(const crypto::hash &txid, const txpool_tx_meta_t& meta);
@@ -328,6 +350,8 @@ public:
   virtual bool prune_blockchain(uint32_t pruning_seed = 0);
   virtual bool update_pruning();
   virtual bool check_pruning();
+  virtual bool prune_blockchain_step(size_t max_records, uint32_t pruning_seed = 0);
+  virtual void copy_compacted(const std::string& path) const;
 
   virtual void add_alt_block(const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata_ref &blob);
   virtual bool get_alt_block(const crypto::hash &blkid, alt_block_data_t *data, cryptonote::blobdata *blob);
@@ -338,8 +362,12 @@ public:
   virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob = false, relay_category category = relay_category::broadcasted) const;
 
   virtual bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const;
+
+  virtual bool for_all_state_records(std::function<bool(const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value)> f) const;
+
   virtual bool for_blocks_range(const uint64_t& h1, const uint64_t& h2, std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)>) const;
   virtual bool for_all_transactions(std::function<bool(const crypto::hash&, const cryptonote::transaction&)>, bool pruned) const;
+  virtual bool for_transactions_range(uint64_t tx_id_start, uint64_t tx_id_end, const std::function<bool(uint64_t, const cryptonote::transaction&)> &f) const;
   virtual bool for_all_outputs(std::function<bool(uint64_t amount, const crypto::hash &tx_hash, uint64_t height, size_t tx_idx)> f) const;
   virtual bool for_all_outputs(uint64_t amount, const std::function<bool(uint64_t height)> &f) const;
   virtual bool for_all_alt_blocks(std::function<bool(const crypto::hash &blkid, const alt_block_data_t &data, const cryptonote::blobdata_ref *blob)> f, bool include_blob = false) const;
@@ -367,6 +395,11 @@ public:
   virtual bool block_rtxn_start() const;
   virtual void block_rtxn_stop() const;
   virtual void block_rtxn_abort() const;
+  virtual size_t report_long_read_txns(uint64_t threshold_seconds) const;
+
+  virtual void set_cold_storage_path(const std::string& path);
+
+  virtual void set_tx_index(bool enabled);
 
   bool block_rtxn_start(MDB_txn **mtxn, mdb_txn_cursors **mcur) const;
 
@@ -397,7 +430,14 @@ private:
   void do_resize(uint64_t size_increase=0);
 
   bool need_resize(uint64_t threshold_size=0) const;
+  static bool env_needs_resize(MDB_env *env, uint64_t threshold_size);
+  static uint64_t grown_mapsize(MDB_env *env, const std::string &folder, uint64_t increase_size);
   void check_and_resize_for_batch(uint64_t batch_num_blocks, uint64_t batch_bytes);
+  void batch_txn_begin();
+  void batch_checkpoint_and_resize();
+
+  std::map<std::string, uint64_t> read_circulating_supply() const;
+  void end_circulating_supply_write();
   uint64_t get_estimated_batch_size(uint64_t batch_num_blocks, uint64_t batch_bytes) const;
 
   virtual void add_block( const block& blk,
@@ -418,6 +458,16 @@ private:
 
   virtual void remove_block();
 
+  virtual void add_block_scan_record(const uint64_t height, const blobdata& blob);
+
+  virtual void add_supply_series_block(const uint64_t height, const supply_series_entry& block);
+
+  void remove_supply_series_block(const uint64_t height);
+  bool get_supply_series_entry(const supply_series_granularity granularity, const uint64_t height, supply_series_entry& entry);
+  void put_supply_series_entry(const supply_series_granularity granularity, const supply_series_entry& entry);
+
+  virtual void add_block_emission_totals(const uint64_t height, const block_emission_totals& totals);
+
   virtual uint64_t add_transaction_data(const crypto::hash& blk_hash, const std::pair<transaction, blobdata_ref>& tx, const crypto::hash& tx_hash, const crypto::hash& tx_prunable_hash, const bool miner_tx);
 
   virtual void remove_transaction_data(const crypto::hash& tx_hash, const transaction& tx, const bool miner_tx);
@@ -453,12 +503,24 @@ private:
 
   inline void check_open() const;
 
-  bool prune_worker(int mode, uint32_t pruning_seed);
+  bool prune_worker(int mode, uint32_t pruning_seed, size_t max_records = 0, bool *done = NULL);
+
+  // cold storage for prunable tx data, see set_cold_storage_path
+  void open_cold_storage(int mdb_flags);
+
+  void open_tx_index(MDB_txn *txn, uint64_t height, bool read_only);
+  void cold_prunable_cursor(mdb_txn_cursors *cursors) const;
+  void cold_wtxn_commit();
+  void cold_wtxn_abort();
+
+  void build_key_image_filter();
 
   virtual bool is_read_only() const;
 
   virtual uint64_t get_database_size() const;
 
+  virtual uint64_t get_database_resident_size() const;
+
   std::vector<uint64_t> get_block_info_64bit_fields(uint64_t start_height, size_t count, off_t offset) const;
 
   uint64_t get_max_block_size();
@@ -469,6 +531,9 @@ private:
 
   // migrate from DB version 2 to 3
   void migrate_2_3();
+
+  // migrate from DB version 3 to 4
+  void migrate_3_4();
   
   void cleanup_batch();
 
@@ -476,9 +541,22 @@ private:
   virtual int get_audit_tx_info(const uint64_t height, std::vector<yield_tx_info>& ati_container) const;
 
   virtual int get_yield_block_info(const uint64_t height, yield_block_info& ybi) const;
+  virtual int get_yield_block_infos(const uint64_t start_height, const uint64_t end_height, std::vector<yield_block_info>& ybis) const;
   virtual int get_yield_tx_info(const uint64_t height, std::vector<yield_tx_info>& yti_container) const;
   virtual int get_carrot_yield_tx_info(const uint64_t height, std::vector<yield_tx_info_carrot>& yti_container) const;
 
+  virtual void get_block_scan_record_blobs(const uint64_t start_height, const size_t count, std::vector<blobdata>& blobs) const;
+
+  virtual void get_supply_series(const supply_series_granularity granularity, const uint64_t start_height, const uint64_t end_height, const size_t max_count, std::vector<supply_series_entry>& entries) const;
+
+  virtual bool get_block_emission_totals(const uint64_t height, block_emission_totals& totals) const;
+
+  virtual bool get_tx_index_height(uint64_t& height) const;
+
+  virtual void get_txs_by_type(const uint8_t tx_type, const uint64_t start_height, const uint64_t start_tx_id, const uint64_t end_height, const size_t max_count, std::vector<tx_index_entry>& entries) const;
+
+  virtual void get_outputs_by_asset_type(const std::string& asset_type, const uint64_t start_height, const uint64_t start_output_id, const uint64_t end_height, const size_t max_count, std::vector<output_index_entry>& entries) const;
+
 private:
   MDB_env* m_env;
 
@@ -521,6 +599,28 @@ private:
 
   MDB_dbi m_carrot_yield_txs;
 
+  MDB_dbi m_block_scan_records;
+
+  MDB_dbi m_supply_series;
+
+  MDB_dbi m_block_emission_totals;
+
+  // optional explorer indexes, kept from m_tx_index_height up when m_tx_index is set
+  MDB_dbi m_tx_type_index;
+  MDB_dbi m_output_asset_index;
+  bool m_tx_index_requested;
+  bool m_tx_index;
+  uint64_t m_tx_index_height;
+
+  // optional second env holding the prunable tx blobs, NULL if not in use
+  MDB_env* m_cold_env;
+  MDB_dbi m_cold_txs_prunable;
+  std::string m_cold_folder;
+  mutable mdb_txn_safe* m_cold_write_txn; // follows m_write_txn, started on first use
+
+  // answers most has_key_image misses without a db lookup
+  key_image_filter m_key_image_filter;
+
   mutable uint64_t m_cum_size;	// used in batch size estimation
   mutable unsigned int m_cum_count;
   std::string m_folder;
@@ -531,6 +631,20 @@ private:
   bool m_batch_transactions; // support for batch transactions
   bool m_batch_active; // whether batch transaction is in progress
 
+  // circulating supply as last read from the db, valid while the generation it was read at is current
+  struct circulating_supply_snapshot
+  {
+    uint64_t generation;
+    std::map<std::string, uint64_t> supply;
+  };
+  mutable std::shared_ptr<const circulating_supply_snapshot> m_circulating_supply_snapshot;
+  std::atomic<uint64_t> m_circulating_supply_generation;
+  bool m_circulating_supply_write_pending; // a block was added or popped in the open write txn
+
+  // where the next prune_blockchain_step carries on in the tx_indices table
+  txindex m_prune_resume;
+  bool m_prune_resume_valid;
+
   mdb_txn_cursors m_wcursors;
   mutable boost::thread_specific_ptr<mdb_threadinfo> m_tinfo;
 
@@ -546,6 +660,8 @@ private:
 #endif
 
   constexpr static float RESIZE_PERCENT = 0.9f;
+  constexpr static float RESIZE_GROWTH_FACTOR = 0.25f; // fraction of the map size added per resize
+  constexpr static uint64_t RESIZE_BATCH_CHECK_INTERVAL = 32; // blocks between resize checks in a batch
 };
 
 }  // namespace cryptonote
@@ -123,8 +123,10 @@ public:
   virtual void remove_spent_key(const crypto::key_image& k_image) override {}
 
   virtual bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const override { return true; }
+  virtual bool for_all_state_records(std::function<bool(const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value)>) const override { return true; }
   virtual bool for_blocks_range(const uint64_t&, const uint64_t&, std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)>) const override { return true; }
   virtual bool for_all_transactions(std::function<bool(const crypto::hash&, const cryptonote::transaction&)>, bool pruned) const override { return true; }
+  virtual bool for_transactions_range(uint64_t tx_id_start, uint64_t tx_id_end, const std::function<bool(uint64_t, const cryptonote::transaction&)> &f) const override { return true; }
   virtual bool for_all_outputs(std::function<bool(uint64_t amount, const crypto::hash &tx_hash, uint64_t height, size_t tx_idx)> f) const override { return true; }
   virtual bool for_all_outputs(uint64_t amount, const std::function<bool(uint64_t height)> &f) const override { return true; }
   virtual bool is_read_only() const override { return false; }
@@ -174,6 +176,8 @@ public:
   virtual bool prune_blockchain(uint32_t pruning_seed = 0) override { return true; }
   virtual bool update_pruning() override { return true; }
   virtual bool check_pruning() override { return true; }
+  virtual bool prune_blockchain_step(size_t max_records, uint32_t pruning_seed = 0) override { return true; }
+  virtual void copy_compacted(const std::string& path) const override {}
   virtual void prune_outputs(uint64_t amount) override {}
 
   virtual uint64_t get_max_block_size() override { return 100000000; }
@@ -26,21 +26,18 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <unordered_map>
-#include <unordered_set>
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/algorithm/string.hpp>
-#include <boost/archive/portable_binary_iarchive.hpp>
-#include <boost/archive/portable_binary_oarchive.hpp>
-#include <boost/filesystem/path.hpp>
-#include "common/unordered_containers_boost_serialization.h"
+#include <boost/filesystem.hpp>
 #include "common/command_line.h"
 #include "common/varint.h"
-#include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "cryptonote_core/tx_pool.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_core/blockchain.h"
 #include "blockchain_db/blockchain_db.h"
+#include "tx_graph.h"
 #include "version.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -50,284 +47,40 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
-static bool stop_requested = false;
-static uint64_t cached_txes = 0, cached_blocks = 0, cached_outputs = 0, total_txes = 0, total_blocks = 0, total_outputs = 0;
-static bool opt_cache_outputs = false, opt_cache_txes = false, opt_cache_blocks = false;
+static std::atomic<bool> stop_requested(false);
 
-struct ancestor
+// path counts grow exponentially with depth, so they stop at the maximum
+static uint64_t saturating_add(uint64_t a, uint64_t b)
 {
-  uint64_t amount;
-  uint64_t offset;
-
-  bool operator==(const ancestor &other) const { return amount == other.amount && offset == other.offset; }
-
-  template <typename t_archive> void serialize(t_archive &a, const unsigned int ver)
-  {
-    a & amount;
-    a & offset;
-  }
-};
-BOOST_CLASS_VERSION(ancestor, 0)
-
-namespace std
-{
-  template<> struct hash<ancestor>
-  {
-    size_t operator()(const ancestor &a) const
-    {
-      return a.amount ^ a.offset; // not that bad, since amount almost always have a high bit set, and offset doesn't
-    }
-  };
-}
-
-struct tx_data_t
-{
-  std::vector<std::pair<uint64_t, std::vector<uint64_t>>> vin;
-  std::vector<crypto::public_key> vout;
-  bool coinbase;
-
-  tx_data_t(): coinbase(false) {}
-  tx_data_t(const cryptonote::transaction &tx)
-  {
-    coinbase = tx.vin.size() == 1 && tx.vin[0].type() == typeid(cryptonote::txin_gen);
-    if (!coinbase)
-    {
-      vin.reserve(tx.vin.size());
-      for (size_t ring = 0; ring < tx.vin.size(); ++ring)
-      {
-        if (tx.vin[ring].type() == typeid(cryptonote::txin_to_key))
-        {
-          const cryptonote::txin_to_key &txin = boost::get<cryptonote::txin_to_key>(tx.vin[ring]);
-          vin.push_back(std::make_pair(txin.amount, cryptonote::relative_output_offsets_to_absolute(txin.key_offsets)));
-        }
-        else
-        {
-          LOG_PRINT_L0("Bad vin type in txid " << get_transaction_hash(tx));
-          throw std::runtime_error("Bad vin type");
-        }
-      }
-    }
-    vout.reserve(tx.vout.size());
-    for (size_t out = 0; out < tx.vout.size(); ++out)
-    {
-      if (tx.vout[out].target.type() == typeid(cryptonote::txout_to_key))
-      {
-        const auto &txout = boost::get<cryptonote::txout_to_key>(tx.vout[out].target);
-        vout.push_back(txout.key);
-      }
-      else
-      {
-        LOG_PRINT_L0("Bad vout type in txid " << get_transaction_hash(tx));
-        throw std::runtime_error("Bad vout type");
-      }
-    }
-  }
-
-  template <typename t_archive> void serialize(t_archive &a, const unsigned int ver)
-  {
-    a & coinbase;
-    a & vin;
-    a & vout;
-  }
-};
-
-struct ancestry_state_t
-{
-  uint64_t height;
-  std::unordered_map<crypto::hash, std::unordered_set<ancestor>> ancestry;
-  std::unordered_map<ancestor, crypto::hash> output_cache;
-  std::unordered_map<crypto::hash, ::tx_data_t> tx_cache;
-  std::vector<cryptonote::block> block_cache;
-
-  ancestry_state_t(): height(0) {}
-
-  template <typename t_archive> void serialize(t_archive &a, const unsigned int ver)
-  {
-    a & height;
-    a & ancestry;
-    a & output_cache;
-    if (ver < 1)
-    {
-      std::unordered_map<crypto::hash, cryptonote::transaction> old_tx_cache;
-      a & old_tx_cache;
-      for (const auto& i: old_tx_cache)
-        tx_cache.insert(std::make_pair(i.first, ::tx_data_t(i.second)));
-    }
-    else
-    {
-      a & tx_cache;
-    }
-    if (ver < 2)
-    {
-      std::unordered_map<uint64_t, cryptonote::block> old_block_cache;
-      a & old_block_cache;
-      block_cache.resize(old_block_cache.size());
-      for (const auto& i: old_block_cache)
-        block_cache[i.first] = i.second;
-    }
-    else
-    {
-      a & block_cache;
-    }
-  }
-};
-BOOST_CLASS_VERSION(ancestry_state_t, 2)
-
-static void add_ancestor(std::unordered_map<ancestor, unsigned int> &ancestry, uint64_t amount, uint64_t offset)
-{
-  std::pair<std::unordered_map<ancestor, unsigned int>::iterator, bool> p = ancestry.insert(std::make_pair(ancestor{amount, offset}, 1));
-  if (!p.second)
-  {
-    ++p.first->second;
-  }
-}
-
-static size_t get_full_ancestry(const std::unordered_map<ancestor, unsigned int> &ancestry)
-{
-  size_t count = 0;
-  for (const auto &i: ancestry)
-    count += i.second;
-  return count;
-}
-
-static size_t get_deduplicated_ancestry(const std::unordered_map<ancestor, unsigned int> &ancestry)
-{
-  return ancestry.size();
-}
-
-static void add_ancestry(std::unordered_map<crypto::hash, std::unordered_set<ancestor>> &ancestry, const crypto::hash &txid, const std::unordered_set<ancestor> &ancestors)
-{
-  std::pair<std::unordered_map<crypto::hash, std::unordered_set<ancestor>>::iterator, bool> p = ancestry.insert(std::make_pair(txid, ancestors));
-  if (!p.second)
-  {
-    for (const auto &e: ancestors)
-      p.first->second.insert(e);
-  }
-}
-
-static void add_ancestry(std::unordered_map<crypto::hash, std::unordered_set<ancestor>> &ancestry, const crypto::hash &txid, const ancestor &new_ancestor)
-{
-  std::pair<std::unordered_map<crypto::hash, std::unordered_set<ancestor>>::iterator, bool> p = ancestry.insert(std::make_pair(txid, std::unordered_set<ancestor>()));
-  p.first->second.insert(new_ancestor);
-}
-
-static std::unordered_set<ancestor> get_ancestry(const std::unordered_map<crypto::hash, std::unordered_set<ancestor>> &ancestry, const crypto::hash &txid)
-{
-  std::unordered_map<crypto::hash, std::unordered_set<ancestor>>::const_iterator i = ancestry.find(txid);
-  if (i == ancestry.end())
-  {
-    //MERROR("txid ancestry not found: " << txid);
-    //throw std::runtime_error("txid ancestry not found");
-    return std::unordered_set<ancestor>();
-  }
-  return i->second;
-}
-
-static bool get_block_from_height(ancestry_state_t &state, BlockchainDB *db, uint64_t height, cryptonote::block &b)
-{
-  ++total_blocks;
-  if (state.block_cache.size() > height && !state.block_cache[height].miner_tx.vin.empty())
-  {
-    ++cached_blocks;
-    b = state.block_cache[height];
-    return true;
-  }
-  cryptonote::blobdata bd = db->get_block_blob_from_height(height);
-  if (!cryptonote::parse_and_validate_block_from_blob(bd, b))
-  {
-    LOG_PRINT_L0("Bad block from db");
-    return false;
-  }
-  if (opt_cache_blocks)
-  {
-    state.block_cache.resize(height + 1);
-    state.block_cache[height] = b;
-  }
-  return true;
-}
-
-static bool get_transaction(ancestry_state_t &state, BlockchainDB *db, const crypto::hash &txid, ::tx_data_t &tx_data)
-{
-  std::unordered_map<crypto::hash, ::tx_data_t>::const_iterator i = state.tx_cache.find(txid);
-  ++total_txes;
-  if (i != state.tx_cache.end())
-  {
-    ++cached_txes;
-    tx_data = i->second;
-    return true;
-  }
-
-  cryptonote::blobdata bd;
-  if (!db->get_pruned_tx_blob(txid, bd))
-  {
-    LOG_PRINT_L0("Failed to get txid " << txid << " from db");
-    return false;
-  }
-  cryptonote::transaction tx;
-  if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, tx))
-  {
-    LOG_PRINT_L0("Bad tx: " << txid);
-    return false;
-  }
-  tx_data = ::tx_data_t(tx);
-  if (opt_cache_txes)
-    state.tx_cache.insert(std::make_pair(txid, tx_data));
-  return true;
+  return a > std::numeric_limits<uint64_t>::max() - b ? std::numeric_limits<uint64_t>::max() : a + b;
 }
 
-static bool get_output_txid(ancestry_state_t &state, BlockchainDB *db, uint64_t amount, uint64_t offset, crypto::hash &txid)
+// ring members of a tx's ancestors, keyed by global output id, each with the
+// number of times it is met over all the paths from the tx
+static bool get_ancestry(const TxGraph &graph, uint64_t start, size_t threads, std::unordered_map<uint64_t, uint64_t> &ancestry)
 {
-  ++total_outputs;
-  std::unordered_map<ancestor, crypto::hash>::const_iterator i = state.output_cache.find({amount, offset});
-  if (i != state.output_cache.end())
-  {
-    ++cached_outputs;
-    txid = i->second;
-    return true;
-  }
-
-  const output_data_t od = db->get_output_key(amount, offset, false);
-  cryptonote::block b;
-  if (!get_block_from_height(state, db, od.height, b))
+  std::vector<uint64_t> nodes = graph.walk({start}, threads, [](uint64_t, const std::vector<uint64_t>&) { return !stop_requested; });
+  if (stop_requested)
     return false;
 
-  for (size_t out = 0; out < b.miner_tx.vout.size(); ++out)
+  // edges point to lower nodes, so going from the highest node down reaches
+  // each node only once all the paths to it are counted
+  std::sort(nodes.begin(), nodes.end(), std::greater<uint64_t>());
+  std::unordered_map<uint64_t, uint64_t> paths;
+  paths.reserve(nodes.size());
+  paths[start] = 1;
+  for (uint64_t node: nodes)
   {
-    if (b.miner_tx.vout[out].target.type() == typeid(cryptonote::txout_to_key))
+    const uint64_t node_paths = paths[node];
+    for (const uint64_t *m = graph.ring_members_begin(node); m != graph.ring_members_end(node); ++m)
     {
-      const auto &txout = boost::get<cryptonote::txout_to_key>(b.miner_tx.vout[out].target);
-      if (txout.key == od.pubkey)
-      {
-        txid = cryptonote::get_transaction_hash(b.miner_tx);
-        if (opt_cache_outputs)
-          state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
-        return true;
-      }
-    }
-    else
-    {
-      LOG_PRINT_L0("Bad vout type in txid " << cryptonote::get_transaction_hash(b.miner_tx));
-      return false;
+      uint64_t &count = ancestry[*m];
+      count = saturating_add(count, node_paths);
+      uint64_t &source_paths = paths[graph.get_output_tx(*m)];
+      source_paths = saturating_add(source_paths, node_paths);
     }
   }
-  for (const crypto::hash &block_txid: b.tx_hashes)
-  {
-    ::tx_data_t tx_data3;
-    if (!get_transaction(state, db, block_txid, tx_data3))
-      return false;
-
-    for (size_t out = 0; out < tx_data3.vout.size(); ++out)
-    {
-      if (tx_data3.vout[out] == od.pubkey)
-      {
-        txid = block_txid;
-        if (opt_cache_outputs)
-          state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
-        return true;
-      }
-    }
-  }
-  return false;
+  return true;
 }
 
 int main(int argc, char* argv[])
@@ -346,14 +99,12 @@ int main(int argc, char* argv[])
   po::options_description desc_cmd_sett("Command line options and settings options");
   const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
   const command_line::arg_descriptor<std::string> arg_txid  = {"txid", "Get ancestry for this txid", ""};
-  const command_line::arg_descriptor<std::string> arg_output  = {"output", "Get ancestry for this output (amount/offset format)", ""};
+  const command_line::arg_descriptor<std::string> arg_output  = {"output", "Get ancestry for this output (asset_type/index format)", ""};
   const command_line::arg_descriptor<uint64_t> arg_height  = {"height", "Get ancestry for all txes at this height", 0};
-  const command_line::arg_descriptor<bool> arg_refresh  = {"refresh", "Refresh the whole chain first", false};
-  const command_line::arg_descriptor<bool> arg_cache_outputs  = {"cache-outputs", "Cache outputs (memory hungry)", false};
-  const command_line::arg_descriptor<bool> arg_cache_txes  = {"cache-txes", "Cache txes (memory hungry)", false};
-  const command_line::arg_descriptor<bool> arg_cache_blocks  = {"cache-blocks", "Cache blocks (memory hungry)", false};
+  const command_line::arg_descriptor<bool> arg_refresh  = {"refresh", "Bring the tx graph up to the chain's height first", false};
+  const command_line::arg_descriptor<std::string> arg_graph_file  = {"graph-file", "Tx graph file (default: " TX_GRAPH_RAW " in the data dir)", ""};
+  const command_line::arg_descriptor<uint64_t> arg_threads  = {"threads", "Number of threads to build and walk the tx graph with (0 = all cores)", 0};
   const command_line::arg_descriptor<bool> arg_include_coinbase  = {"include-coinbase", "Including coinbase tx in per height average", false};
-  const command_line::arg_descriptor<bool> arg_show_cache_stats  = {"show-cache-stats", "Show cache statistics", false};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -363,11 +114,9 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_output);
   command_line::add_arg(desc_cmd_sett, arg_height);
   command_line::add_arg(desc_cmd_sett, arg_refresh);
-  command_line::add_arg(desc_cmd_sett, arg_cache_outputs);
-  command_line::add_arg(desc_cmd_sett, arg_cache_txes);
-  command_line::add_arg(desc_cmd_sett, arg_cache_blocks);
+  command_line::add_arg(desc_cmd_sett, arg_graph_file);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
   command_line::add_arg(desc_cmd_sett, arg_include_coinbase);
-  command_line::add_arg(desc_cmd_sett, arg_show_cache_stats);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -407,11 +156,9 @@ int main(int argc, char* argv[])
   std::string opt_output_string = command_line::get_arg(vm, arg_output);
   uint64_t opt_height = command_line::get_arg(vm, arg_height);
   bool opt_refresh = command_line::get_arg(vm, arg_refresh);
-  opt_cache_outputs = command_line::get_arg(vm, arg_cache_outputs);
-  opt_cache_txes = command_line::get_arg(vm, arg_cache_txes);
-  opt_cache_blocks = command_line::get_arg(vm, arg_cache_blocks);
+  std::string opt_graph_file = command_line::get_arg(vm, arg_graph_file);
+  uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
   bool opt_include_coinbase = command_line::get_arg(vm, arg_include_coinbase);
-  bool opt_show_cache_stats = command_line::get_arg(vm, arg_show_cache_stats);
 
   if ((!opt_txid_string.empty()) + !!opt_height + !opt_output_string.empty() > 1)
   {
@@ -419,7 +166,8 @@ int main(int argc, char* argv[])
     return 1;
   }
   crypto::hash opt_txid = crypto::null_hash;
-  uint64_t output_amount = 0, output_offset = 0;
+  std::string output_asset_type;
+  uint64_t output_index = 0;
   if (!opt_txid_string.empty())
   {
     if (!epee::string_tools::hex_to_pod(opt_txid_string, opt_txid))
@@ -430,11 +178,13 @@ int main(int argc, char* argv[])
   }
   else if (!opt_output_string.empty())
   {
-    if (sscanf(opt_output_string.c_str(), "%" SCNu64 "/%" SCNu64, &output_amount, &output_offset) != 2)
+    const size_t slash = opt_output_string.find('/');
+    if (slash == std::string::npos || slash == 0 || sscanf(opt_output_string.c_str() + slash + 1, "%" SCNu64, &output_index) != 1)
     {
       std::cerr << "Invalid output" << std::endl;
       return 1;
     }
+    output_asset_type = opt_output_string.substr(0, slash);
   }
 
   // If we wanted to use the memory pool, we would set up a fake_core.
@@ -475,168 +225,52 @@ int main(int argc, char* argv[])
   CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
   LOG_PRINT_L0("Source blockchain storage initialized OK");
 
-  std::vector<crypto::hash> start_txids;
-
-  ancestry_state_t state;
-
-  const std::string state_file_path = (boost::filesystem::path(opt_data_dir) / "ancestry-state.bin").string();
-  LOG_PRINT_L0("Loading state data from " << state_file_path);
-  std::ifstream state_data_in;
-  state_data_in.open(state_file_path, std::ios_base::binary | std::ios_base::in);
-  if (!state_data_in.fail())
-  {
-    try
-    {
-      boost::archive::portable_binary_iarchive a(state_data_in);
-      a >> state;
-    }
-    catch (const std::exception &e)
-    {
-      MERROR("Failed to load state data from " << state_file_path << ", restarting from scratch");
-      state = ancestry_state_t();
-    }
-    state_data_in.close();
-  }
-
   tools::signal_handler::install([](int type) {
     stop_requested = true;
   });
 
-  // forward method
-  const uint64_t db_height = db->height();
-  if (opt_refresh)
+  const std::string graph_file_path = opt_graph_file.empty() ? (boost::filesystem::path(opt_data_dir) / TX_GRAPH_RAW).string() : opt_graph_file;
+  if (opt_refresh || !boost::filesystem::exists(graph_file_path))
   {
-    MINFO("Starting from height " << state.height);
-    state.block_cache.reserve(db_height);
-    for (uint64_t h = state.height; h < db_height; ++h)
-    {
-      size_t block_ancestry_size = 0;
-      const cryptonote::blobdata bd = db->get_block_blob_from_height(h);
-      ++total_blocks;
-      cryptonote::block b;
-      if (!cryptonote::parse_and_validate_block_from_blob(bd, b))
-      {
-        LOG_PRINT_L0("Bad block from db");
-        return 1;
-      }
-      if (opt_cache_blocks)
-      {
-        state.block_cache.resize(h + 1);
-        state.block_cache[h] = b;
-      }
-      std::vector<crypto::hash> txids;
-      txids.reserve(1 + b.tx_hashes.size());
-      if (opt_include_coinbase)
-        txids.push_back(cryptonote::get_transaction_hash(b.miner_tx));
-      for (const auto &h: b.tx_hashes)
-        txids.push_back(h);
-      for (const crypto::hash &txid: txids)
-      {
-        printf("%lu/%lu               \r", (unsigned long)h, (unsigned long)db_height);
-        fflush(stdout);
-        ::tx_data_t tx_data;
-        std::unordered_map<crypto::hash, ::tx_data_t>::const_iterator i = state.tx_cache.find(txid);
-        ++total_txes;
-        if (i != state.tx_cache.end())
-        {
-          ++cached_txes;
-          tx_data = i->second;
-        }
-        else
-        {
-          cryptonote::blobdata bd;
-          if (!db->get_pruned_tx_blob(txid, bd))
-          {
-            LOG_PRINT_L0("Failed to get txid " << txid << " from db");
-            return 1;
-          }
-          cryptonote::transaction tx;
-          if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, tx))
-          {
-            LOG_PRINT_L0("Bad tx: " << txid);
-            return 1;
-          }
-          tx_data = ::tx_data_t(tx);
-          if (opt_cache_txes)
-            state.tx_cache.insert(std::make_pair(txid, tx_data));
-        }
-        if (tx_data.coinbase)
-        {
-          add_ancestry(state.ancestry, txid, std::unordered_set<ancestor>());
-        }
-        else
-        {
-          for (size_t ring = 0; ring < tx_data.vin.size(); ++ring)
-          {
-            const uint64_t amount = tx_data.vin[ring].first;
-            const std::vector<uint64_t> &absolute_offsets = tx_data.vin[ring].second;
-            for (uint64_t offset: absolute_offsets)
-            {
-              add_ancestry(state.ancestry, txid, ancestor{amount, offset});
-              // find the tx which created this output
-              crypto::hash output_txid;
-              if (!get_output_txid(state, db, amount, offset, output_txid))
-              {
-                LOG_PRINT_L0("Output originating transaction not found");
-                return 1;
-              }
-              add_ancestry(state.ancestry, txid, get_ancestry(state.ancestry, output_txid));
-            }
-          }
-        }
-        const size_t ancestry_size = get_ancestry(state.ancestry, txid).size();
-        block_ancestry_size += ancestry_size;
-        MINFO(txid << ": " << ancestry_size);
-      }
-      if (!txids.empty())
-      {
-        std::string stats_msg;
-        MINFO("Height " << h << ": " << (block_ancestry_size / txids.size()) << " average over " << txids.size() << stats_msg);
-      }
-      state.height = h;
-      if (stop_requested)
-        break;
-    }
-
-    LOG_PRINT_L0("Saving state data to " << state_file_path);
-    std::ofstream state_data_out;
-    state_data_out.open(state_file_path, std::ios_base::binary | std::ios_base::out | std::ios::trunc);
-    if (!state_data_out.fail())
-    {
-      try
-      {
-        boost::archive::portable_binary_oarchive a(state_data_out);
-        a << state;
-      }
-      catch (const std::exception &e)
-      {
-        MERROR("Failed to save state data to " << state_file_path);
-      }
-      state_data_out.close();
-    }
+    LOG_PRINT_L0("Building tx graph in " << graph_file_path);
+    if (!TxGraph::build(db, graph_file_path, opt_threads, stop_requested))
+      return 1;
   }
-  else
+  TxGraph graph;
+  LOG_PRINT_L0("Loading tx graph from " << graph_file_path);
+  if (!graph.open(graph_file_path))
+    return 1;
+  const uint64_t db_height = db->height();
+  if (graph.height() < db_height)
   {
-    if (state.height < db_height)
-    {
-      MWARNING("The state file is only built up to height " << state.height << ", but the blockchain reached height " << db_height);
-      MWARNING("You may want to run with --refresh if you want to get ancestry for newer data");
-    }
+    MWARNING("The tx graph is only built up to height " << graph.height() << ", but the blockchain reached height " << db_height);
+    MWARNING("You may want to run with --refresh if you want to get ancestry for newer data");
   }
 
+  std::vector<crypto::hash> start_txids;
   if (!opt_txid_string.empty())
   {
     start_txids.push_back(opt_txid);
   }
   else if (!opt_output_string.empty())
   {
-    crypto::hash txid;
-    if (!get_output_txid(state, db, output_amount, output_offset, txid))
+    uint64_t output_id;
+    try
+    {
+      output_id = db->get_output_id_from_asset_type_output_index(output_asset_type, output_index);
+    }
+    catch (const std::exception &e)
     {
       LOG_PRINT_L0("Output not found in db");
       return 1;
     }
-    start_txids.push_back(txid);
+    const uint64_t node = graph.get_output_tx(output_id);
+    if (node >= graph.tx_count())
+    {
+      LOG_PRINT_L0("Output is newer than the tx graph");
+      return 1;
+    }
+    start_txids.push_back(graph.get_tx_hash(node));
   }
   else
   {
@@ -647,6 +281,8 @@ int main(int argc, char* argv[])
       LOG_PRINT_L0("Bad block from db");
       return 1;
     }
+    if (opt_include_coinbase)
+      start_txids.push_back(cryptonote::get_transaction_hash(b.miner_tx));
     for (const crypto::hash &txid: b.tx_hashes)
       start_txids.push_back(txid);
   }
@@ -657,71 +293,35 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  size_t total_ancestry_size = 0;
   for (const crypto::hash &start_txid: start_txids)
   {
     LOG_PRINT_L0("Checking ancestry for txid " << start_txid);
 
-    std::unordered_map<ancestor, unsigned int> ancestry;
-
-    std::list<crypto::hash> txids;
-    txids.push_back(start_txid);
-    while (!txids.empty())
+    uint64_t node;
+    if (!graph.find_tx(db, start_txid, node))
     {
-      const crypto::hash txid = txids.front();
-      txids.pop_front();
-
-      if (stop_requested)
-        goto done;
-
-      ::tx_data_t tx_data2;
-      if (!get_transaction(state, db, txid, tx_data2))
-        return 1;
-
-      const bool coinbase = tx_data2.coinbase;
-      if (coinbase)
-        continue;
-
-      for (size_t ring = 0; ring < tx_data2.vin.size(); ++ring)
-      {
-        {
-          const uint64_t amount = tx_data2.vin[ring].first;
-          auto absolute_offsets = tx_data2.vin[ring].second;
-          for (uint64_t offset: absolute_offsets)
-          {
-            add_ancestor(ancestry, amount, offset);
-
-            // find the tx which created this output
-            crypto::hash output_txid;
-            if (!get_output_txid(state, db, amount, offset, output_txid))
-            {
-              LOG_PRINT_L0("Output originating transaction not found");
-              return 1;
-            }
-
-            add_ancestry(state.ancestry, txid, get_ancestry(state.ancestry, output_txid));
-            txids.push_back(output_txid);
-            MDEBUG("adding txid: " << output_txid);
-          }
-        }
-      }
+      LOG_PRINT_L0("Transaction " << start_txid << " is not in the tx graph");
+      return 1;
     }
+    std::unordered_map<uint64_t, uint64_t> ancestry;
+    if (!get_ancestry(graph, node, opt_threads, ancestry))
+      break;
 
-    MINFO("Ancestry for " << start_txid << ": " << get_deduplicated_ancestry(ancestry) << " / " << get_full_ancestry(ancestry));
+    uint64_t full_ancestry_size = 0;
+    for (const auto &i: ancestry)
+      full_ancestry_size = saturating_add(full_ancestry_size, i.second);
+    MINFO("Ancestry for " << start_txid << ": " << ancestry.size() << " / " << full_ancestry_size);
     for (const auto &i: ancestry)
     {
-      MINFO(cryptonote::print_money(i.first.amount) << "/" << i.first.offset << ": " << i.second);
+      MINFO("output " << i.first << ": " << i.second);
     }
+    total_ancestry_size += ancestry.size();
   }
+  if (start_txids.size() > 1)
+    MINFO("Height " << opt_height << ": " << (total_ancestry_size / start_txids.size()) << " average over " << start_txids.size());
 
-done:
   core_storage->blockchain.deinit();
-
-  if (opt_show_cache_stats)
-  MINFO("cache: txes " << std::to_string(cached_txes*100./total_txes)
-        << "%, blocks " << std::to_string(cached_blocks*100./total_blocks)
-        << "%, outputs " << std::to_string(cached_outputs*100./total_outputs)
-        << "%");
-
   return 0;
 
   CATCH_ENTRY("Depth query error", 1);
@@ -32,6 +32,7 @@
 #include "common/unordered_containers_boost_serialization.h"
 #include "common/command_line.h"
 #include "common/varint.h"
+#include "common/threadpool.h"
 #include "serialization/crypto.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "cryptonote_core/tx_pool.h"
@@ -226,7 +227,7 @@ static void init(std::string cache_filename)
 
   tools::create_directories_if_necessary(cache_filename);
 
-  int flags = 0;
+  int flags = MDB_NOTLS;
   if (db_flags & DBF_FAST)
     flags |= MDB_NOSYNC;
   if (db_flags & DBF_FASTEST)
@@ -910,6 +911,60 @@ static void add_key_image(MDB_txn *txn, const output_data &od, const crypto::key
   CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to set outputs: " + std::string(mdb_strerror(dbr)));
 }
 
+// both rings are absolute offsets, hence sorted
+static std::vector<uint64_t> intersect_rings(const std::vector<uint64_t> &r0, const std::vector<uint64_t> &r1)
+{
+  std::vector<uint64_t> common;
+  common.reserve(std::min(r0.size(), r1.size()));
+  std::set_intersection(r0.begin(), r0.end(), r1.begin(), r1.end(), std::back_inserter(common));
+  return common;
+}
+
+struct chain_reaction_candidate
+{
+  output_data od;
+  size_t ring_size;
+};
+
+// Read only part of a chain reaction pass, run in parallel on a slice of the
+// spent outputs, each slice with its own read txn. Candidates are deduced from
+// the spent set as it was at the start of the pass, anything depending on an
+// output found in the same pass will be found in the next one.
+static void find_chain_reaction_candidates(const std::vector<output_data> &spent, size_t start, size_t end, const bool &stop_requested, std::vector<chain_reaction_candidate> &candidates)
+{
+  MDB_txn *txn;
+  int dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+  CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+  epee::misc_utils::auto_scope_leave_caller txn_dtor = epee::misc_utils::create_scope_leave_handler([&](){mdb_txn_abort(txn);});
+  MDB_cursor *cur;
+  dbr = mdb_cursor_open(txn, dbi_spent, &cur);
+  CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
+  epee::misc_utils::auto_scope_leave_caller cur_dtor = epee::misc_utils::create_scope_leave_handler([&](){mdb_cursor_close(cur);});
+
+  std::vector<uint64_t> relative_ring;
+  for (size_t i = start; i < end && !stop_requested; ++i)
+  {
+    const output_data &od = spent[i];
+    const std::vector<crypto::key_image> key_images = get_key_images(txn, od);
+    for (const crypto::key_image &ki: key_images)
+    {
+      CHECK_AND_ASSERT_THROW_MES(get_relative_ring(txn, ki, relative_ring), "Relative ring not found");
+      const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(relative_ring);
+      size_t known = 0;
+      uint64_t last_unknown = 0;
+      for (uint64_t out: absolute)
+      {
+        if (is_output_spent(cur, output_data(od.amount, out)))
+          ++known;
+        else
+          last_unknown = out;
+      }
+      if (known == absolute.size() - 1)
+        candidates.push_back({output_data(od.amount, last_unknown), absolute.size()});
+    }
+  }
+}
+
 static bool get_stat(MDB_txn *txn, const char *key, uint64_t &data)
 {
   MDB_val k, v;
@@ -1487,12 +1542,7 @@ int main(int argc, char* argv[])
             std::cout << "\r" << start_idx << "/" << n_txes << "         \r" << std::flush;
             const std::vector<uint64_t> r0 = cryptonote::relative_output_offsets_to_absolute(relative_ring);
             const std::vector<uint64_t> r1 = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
-            std::vector<uint64_t> common;
-            for (uint64_t out: r0)
-            {
-              if (std::find(r1.begin(), r1.end(), out) != r1.end())
-                common.push_back(out);
-            }
+            const std::vector<uint64_t> common = intersect_rings(r0, r1);
             if (common.empty())
             {
               MERROR("Rings for the same key image are disjoint");
@@ -1514,9 +1564,7 @@ int main(int argc, char* argv[])
             {
               MDEBUG("The intersection has more than one element, it's still ok");
               std::cout << "\r" << start_idx << "/" << n_txes << "         \r" << std::flush;
-              for (const auto &out: r0)
-                if (std::find(common.begin(), common.end(), out) != common.end())
-                  new_ring.push_back(out);
+              new_ring.insert(new_ring.end(), common.begin(), common.end());
               new_ring = cryptonote::absolute_output_offsets_to_relative(new_ring);
             }
           }
@@ -1599,6 +1647,26 @@ int main(int argc, char* argv[])
     int dbr = resize_env(cache_dir.c_str());
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to resize LMDB database: " + std::string(mdb_strerror(dbr)));
 
+    std::vector<output_data> scan_spent = std::move(work_spent);
+    work_spent.clear();
+
+    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+    const size_t n_slices = std::max<size_t>(1, std::min<size_t>(tpool.get_max_concurrency(), scan_spent.size() / 64));
+    std::vector<std::vector<chain_reaction_candidate>> candidates(n_slices);
+    tools::threadpool::waiter waiter(tpool);
+    for (size_t s = 0; s < n_slices; ++s)
+    {
+      const size_t start = scan_spent.size() * s / n_slices, end = scan_spent.size() * (s + 1) / n_slices;
+      tpool.submit(&waiter, [&, s, start, end](){ find_chain_reaction_candidates(scan_spent, start, end, stop_requested, candidates[s]); });
+    }
+    CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to scan spent outputs");
+
+    if (stop_requested)
+    {
+      MINFO("Stopping secondary passes. Secondary passes are not incremental, they will re-run fully.");
+      return 0;
+    }
+
     MDB_txn *txn;
     dbr = mdb_txn_begin(env, NULL, 0, &txn);
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
@@ -1607,46 +1675,23 @@ int main(int argc, char* argv[])
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
 
     std::vector<std::pair<uint64_t, uint64_t>> blackballs;
-    std::vector<output_data> scan_spent = std::move(work_spent);
-    work_spent.clear();
-    for (const output_data &od: scan_spent)
+    for (const std::vector<chain_reaction_candidate> &slice: candidates)
     {
-      std::vector<crypto::key_image> key_images = get_key_images(txn, od);
-      for (const crypto::key_image &ki: key_images)
+      for (const chain_reaction_candidate &candidate: slice)
       {
-        std::vector<uint64_t> relative_ring;
-        CHECK_AND_ASSERT_THROW_MES(get_relative_ring(txn, ki, relative_ring), "Relative ring not found");
-        std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(relative_ring);
-        size_t known = 0;
-        uint64_t last_unknown = 0;
-        for (uint64_t out: absolute)
+        const std::pair<uint64_t, uint64_t> output = std::make_pair(candidate.od.amount, candidate.od.offset);
+        if (opt_verbose)
         {
-          output_data new_od(od.amount, out);
-          if (is_output_spent(cur, new_od))
-            ++known;
-          else
-            last_unknown = out;
+          MINFO("Marking output " << output.first << "/" << output.second << " as spent, due to being used in a " <<
+              candidate.ring_size << "-ring where all other outputs are known to be spent");
         }
-        if (known == absolute.size() - 1)
+        blackballs.push_back(output);
+        if (add_spent_output(cur, candidate.od))
         {
-          const std::pair<uint64_t, uint64_t> output = std::make_pair(od.amount, last_unknown);
-          if (opt_verbose)
-          {
-            MINFO("Marking output " << output.first << "/" << output.second << " as spent, due to being used in a " <<
-                absolute.size() << "-ring where all other outputs are known to be spent");
-          }
-          blackballs.push_back(output);
-          if (add_spent_output(cur, output_data(od.amount, last_unknown)))
-            inc_stat(txn, od.amount ? "pre-rct-chain-reaction" : "rct-chain-reaction");
-          work_spent.push_back(output_data(od.amount, last_unknown));
+          inc_stat(txn, candidate.od.amount ? "pre-rct-chain-reaction" : "rct-chain-reaction");
+          work_spent.push_back(candidate.od);
         }
       }
-
-      if (stop_requested)
-      {
-        MINFO("Stopping secondary passes. Secondary passes are not incremental, they will re-run fully.");
-        return 0;
-      }
     }
     if (!blackballs.empty())
     {
@@ -26,8 +26,9 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <boost/range/adaptor/transformed.hpp>
-#include <boost/filesystem/path.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include "common/command_line.h"
 #include "common/varint.h"
@@ -35,6 +36,7 @@
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_core/blockchain.h"
 #include "blockchain_db/blockchain_db.h"
+#include "tx_graph.h"
 #include "version.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -44,6 +46,8 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
+static std::atomic<bool> stop_requested(false);
+
 int main(int argc, char* argv[])
 {
   TRY_ENTRY();
@@ -62,6 +66,9 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<std::string> arg_txid  = {"txid", "Get min depth for this txid", ""};
   const command_line::arg_descriptor<uint64_t> arg_height  = {"height", "Get min depth for all txes at this height", 0};
   const command_line::arg_descriptor<bool> arg_include_coinbase  = {"include-coinbase", "Include coinbase in the average", false};
+  const command_line::arg_descriptor<bool> arg_refresh  = {"refresh", "Bring the tx graph up to the chain's height first", false};
+  const command_line::arg_descriptor<std::string> arg_graph_file  = {"graph-file", "Tx graph file (default: " TX_GRAPH_RAW " in the data dir)", ""};
+  const command_line::arg_descriptor<uint64_t> arg_threads  = {"threads", "Number of threads to build and walk the tx graph with (0 = all cores)", 0};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -70,6 +77,9 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_txid);
   command_line::add_arg(desc_cmd_sett, arg_height);
   command_line::add_arg(desc_cmd_sett, arg_include_coinbase);
+  command_line::add_arg(desc_cmd_sett, arg_refresh);
+  command_line::add_arg(desc_cmd_sett, arg_graph_file);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -108,6 +118,9 @@ int main(int argc, char* argv[])
   std::string opt_txid_string = command_line::get_arg(vm, arg_txid);
   uint64_t opt_height = command_line::get_arg(vm, arg_height);
   bool opt_include_coinbase = command_line::get_arg(vm, arg_include_coinbase);
+  bool opt_refresh = command_line::get_arg(vm, arg_refresh);
+  std::string opt_graph_file = command_line::get_arg(vm, arg_graph_file);
+  uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
 
   if (!opt_txid_string.empty() && opt_height)
   {
@@ -162,6 +175,24 @@ int main(int argc, char* argv[])
   CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
   LOG_PRINT_L0("Source blockchain storage initialized OK");
 
+  tools::signal_handler::install([](int type) {
+    stop_requested = true;
+  });
+
+  const std::string graph_file_path = opt_graph_file.empty() ? (boost::filesystem::path(opt_data_dir) / TX_GRAPH_RAW).string() : opt_graph_file;
+  if (opt_refresh || !boost::filesystem::exists(graph_file_path))
+  {
+    LOG_PRINT_L0("Building tx graph in " << graph_file_path);
+    if (!TxGraph::build(db, graph_file_path, opt_threads, stop_requested))
+      return 1;
+  }
+  TxGraph graph;
+  LOG_PRINT_L0("Loading tx graph from " << graph_file_path);
+  if (!graph.open(graph_file_path))
+    return 1;
+  if (graph.height() < db->height())
+    MWARNING("The tx graph is only built up to height " << graph.height() << ", run with --refresh to get depths of newer txes");
+
   std::vector<crypto::hash> start_txids;
   if (!opt_txid_string.empty())
   {
@@ -191,139 +222,42 @@ int main(int argc, char* argv[])
   std::vector<uint64_t> depths;
   for (const crypto::hash &start_txid: start_txids)
   {
-    uint64_t depth = 0;
-    bool coinbase = false;
-
     LOG_PRINT_L0("Checking depth for txid " << start_txid);
-    std::vector<crypto::hash> txids(1, start_txid);
-    while (!coinbase)
+    uint64_t node;
+    if (!graph.find_tx(db, start_txid, node))
     {
-      LOG_PRINT_L0("Considering "<< txids.size() << " transaction(s) at depth " << depth);
-      std::vector<crypto::hash> new_txids;
-      for (const crypto::hash &txid: txids)
+      LOG_PRINT_L0("Transaction " << start_txid << " is not in the tx graph");
+      return 1;
+    }
+
+    // the min depth is the first level of the walk reaching a coinbase
+    uint64_t depth = 0;
+    graph.walk({node}, opt_threads, [&graph, &depth](uint64_t level, const std::vector<uint64_t> &txes) {
+      LOG_PRINT_L0("Considering "<< txes.size() << " transaction(s) at depth " << level);
+      depth = level;
+      for (uint64_t tx: txes)
       {
-        cryptonote::blobdata bd;
-        if (!db->get_pruned_tx_blob(txid, bd))
+        if (graph.is_leaf(tx))
         {
-          LOG_PRINT_L0("Failed to get txid " << txid << " from db");
-          return 1;
+          MDEBUG(graph.get_tx_hash(tx) << " is a coinbase transaction");
+          return false;
         }
-        cryptonote::transaction tx;
-        if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, tx))
-        {
-          LOG_PRINT_L0("Bad tx: " << txid);
-          return 1;
-        }
-        for (size_t ring = 0; ring < tx.vin.size(); ++ring)
-        {
-          if (tx.vin[ring].type() == typeid(cryptonote::txin_gen))
-          {
-            MDEBUG(txid << " is a coinbase transaction");
-            coinbase = true;
-            goto done;
-          }
-          if (tx.vin[ring].type() == typeid(cryptonote::txin_to_key))
-          {
-            const cryptonote::txin_to_key &txin = boost::get<cryptonote::txin_to_key>(tx.vin[ring]);
-            const uint64_t amount = txin.amount;
-            auto absolute_offsets = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
-            for (uint64_t offset: absolute_offsets)
-            {
-              const output_data_t od = db->get_output_key(amount, offset);
-              const crypto::hash block_hash = db->get_block_hash_from_height(od.height);
-              bd = db->get_block_blob(block_hash);
-              cryptonote::block b;
-              if (!cryptonote::parse_and_validate_block_from_blob(bd, b))
-              {
-                LOG_PRINT_L0("Bad block from db");
-                return 1;
-              }
-              // find the tx which created this output
-              bool found = false;
-              for (size_t out = 0; out < b.miner_tx.vout.size(); ++out)
-              {
-                if (b.miner_tx.vout[out].target.type() == typeid(cryptonote::txout_to_key))
-                {
-                  const auto &txout = boost::get<cryptonote::txout_to_key>(b.miner_tx.vout[out].target);
-                  if (txout.key == od.pubkey)
-                  {
-                    found = true;
-                    new_txids.push_back(cryptonote::get_transaction_hash(b.miner_tx));
-                    MDEBUG("adding txid: " << cryptonote::get_transaction_hash(b.miner_tx));
-                    break;
-                  }
-                }
-                else
-                {
-                  LOG_PRINT_L0("Bad vout type in txid " << cryptonote::get_transaction_hash(b.miner_tx));
-                  return 1;
-                }
-              }
-              for (const crypto::hash &block_txid: b.tx_hashes)
-              {
-                if (found)
-                  break;
-                if (!db->get_pruned_tx_blob(block_txid, bd))
-                {
-                  LOG_PRINT_L0("Failed to get txid " << block_txid << " from db");
-                  return 1;
-                }
-                cryptonote::transaction tx2;
-                if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, tx2))
-                {
-                  LOG_PRINT_L0("Bad tx: " << block_txid);
-                  return 1;
-                }
-                for (size_t out = 0; out < tx2.vout.size(); ++out)
-                {
-                  if (tx2.vout[out].target.type() == typeid(cryptonote::txout_to_key))
-                  {
-                    const auto &txout = boost::get<cryptonote::txout_to_key>(tx2.vout[out].target);
-                    if (txout.key == od.pubkey)
-                    {
-                      found = true;
-                      new_txids.push_back(block_txid);
-                      MDEBUG("adding txid: " << block_txid);
-                      break;
-                    }
-                  }
-                  else
-                  {
-                    LOG_PRINT_L0("Bad vout type in txid " << block_txid);
-                    return 1;
-                  }
-                }
-              }
-              if (!found)
-              {
-                LOG_PRINT_L0("Output originating transaction not found");
-                return 1;
-              }
-            }
-          }
-          else
-          {
-            LOG_PRINT_L0("Bad vin type in txid " << txid);
-            return 1;
-          }
-        }
-      }
-      if (!coinbase)
-      {
-        std::swap(txids, new_txids);
-        ++depth;
       }
-    }
-done:
+      return !stop_requested;
+    });
+    if (stop_requested)
+      break;
     LOG_PRINT_L0("Min depth for txid " << start_txid << ": " << depth);
     depths.push_back(depth);
   }
+  if (depths.empty())
+    return 1;
 
   uint64_t cumulative_depth = 0;
   for (uint64_t depth: depths)
     cumulative_depth += depth;
-  LOG_PRINT_L0("Average min depth for " << start_txids.size() << " transaction(s): " << cumulative_depth/(float)depths.size());
-  LOG_PRINT_L0("Median min depth for " << start_txids.size() << " transaction(s): " << epee::misc_utils::median(depths));
+  LOG_PRINT_L0("Average min depth for " << depths.size() << " transaction(s): " << cumulative_depth/(float)depths.size());
+  LOG_PRINT_L0("Median min depth for " << depths.size() << " transaction(s): " << epee::misc_utils::median(depths));
 
   core_storage->blockchain.deinit();
   return 0;
@@ -0,0 +1,367 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <boost/filesystem.hpp>
+#include <deque>
+#include <fstream>
+#include "carrot_core/account_secrets.h"
+#include "carrot_core/device_ram_borrowed.h"
+#include "common/command_line.h"
+#include "common/threadpool.h"
+#include "common/util.h"
+#include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/blockchain_and_pool.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/enote_stream.h"
+#include "cryptonote_core/light_wallet_scanner.h"
+#include "blockchain_db/blockchain_db.h"
+#include "memwipe.h"
+#include "ringct/rctOps.h"
+#include "string_tools.h"
+#include "version.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+namespace po = boost::program_options;
+using namespace epee;
+using namespace cryptonote;
+
+static std::atomic<bool> stop_requested(false);
+
+namespace
+{
+  // blocks scanned by one worker at a time; outputs are kept per shard and
+  // written out in height order
+  const uint64_t scan_shard_size = 1000;
+
+  // how far back block ids are remembered to find the fork point of a reorg
+  const size_t reorg_window = 720;
+
+  struct scan_account
+  {
+    crypto::public_key main_spend_pubkey;
+    crypto::secret_key view_key;
+  };
+
+  struct scan_shard
+  {
+    uint64_t start;
+    uint64_t stop;
+    std::vector<light_wallet_output> outputs;
+    std::vector<crypto::hash> block_ids;
+    std::string error;
+  };
+
+  void scan_block(BlockchainDB *db, uint64_t h, const scan_account &acc, const carrot::view_incoming_key_device &view_dev, scan_shard &shard)
+  {
+    const cryptonote::blobdata bd = db->get_block_blob_from_height(h);
+    cryptonote::block blk;
+    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+      throw std::runtime_error("Bad block from db at height " + std::to_string(h));
+    shard.block_ids.push_back(get_block_hash(blk));
+
+    carrot_tx_enotes enotes;
+    if (enotes.load(blk.miner_tx, true))
+      enotes.scan(acc.main_spend_pubkey, view_dev, get_transaction_hash(blk.miner_tx), h, blk.timestamp, shard.outputs);
+    if (enotes.load(blk.protocol_tx, true))
+      enotes.scan(acc.main_spend_pubkey, view_dev, get_transaction_hash(blk.protocol_tx), h, blk.timestamp, shard.outputs);
+
+    cryptonote::blobdata tx_bd;
+    for (const crypto::hash &tx_id: blk.tx_hashes)
+    {
+      if (!db->get_pruned_tx_blob(tx_id, tx_bd))
+        throw std::runtime_error("Transaction " + epee::string_tools::pod_to_hex(tx_id) + " not found");
+      transaction tx;
+      if (!parse_and_validate_tx_base_from_blob(tx_bd, tx))
+        throw std::runtime_error("Bad transaction from db: " + epee::string_tools::pod_to_hex(tx_id));
+      if (enotes.load(tx, false))
+        enotes.scan(acc.main_spend_pubkey, view_dev, tx_id, h, blk.timestamp, shard.outputs);
+    }
+  }
+
+  void scan_range(BlockchainDB *db, const scan_account &acc, scan_shard &shard)
+  {
+    try
+    {
+      const carrot::view_incoming_key_ram_borrowed_device view_dev(acc.view_key);
+      for (uint64_t h = shard.start; h < shard.stop; ++h)
+        scan_block(db, h, acc, view_dev, shard);
+    }
+    catch (const std::exception &e)
+    {
+      shard.error = e.what();
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  TRY_ENTRY();
+
+  epee::string_tools::set_module_name_and_folder(argv[0]);
+
+  tools::on_startup();
+
+  po::options_description desc_cmd_only("Command line options");
+  po::options_description desc_cmd_sett("Command line options and settings options");
+  const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
+  const command_line::arg_descriptor<std::string> arg_address  = {"address", "Main address of the account to scan for", ""};
+  const command_line::arg_descriptor<std::string> arg_view_incoming_key  = {"view-incoming-key", "Carrot view-incoming key k_v of the account, hex", ""};
+  const command_line::arg_descriptor<std::string> arg_view_balance_secret  = {"view-balance-secret", "Carrot view-balance secret s_vb of the account, hex, instead of --view-incoming-key", ""};
+  const command_line::arg_descriptor<uint64_t> arg_block_start  = {"block-start", "Start at block number, if the output file is new", 0};
+  const command_line::arg_descriptor<std::string> arg_output_file  = {"output-file", "Enote stream to write, resumed if it exists", ""};
+  const command_line::arg_descriptor<bool> arg_follow  = {"follow", "Keep scanning new blocks as they are added", false};
+  const command_line::arg_descriptor<uint64_t> arg_poll_interval  = {"poll-interval", "Seconds between checks for new blocks with --follow", 10};
+  const command_line::arg_descriptor<uint64_t> arg_threads  = {"threads", "Number of block ranges to scan in parallel (0 = all cores)", 0};
+
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_stagenet_on);
+  command_line::add_arg(desc_cmd_sett, arg_log_level);
+  command_line::add_arg(desc_cmd_sett, arg_address);
+  command_line::add_arg(desc_cmd_sett, arg_view_incoming_key);
+  command_line::add_arg(desc_cmd_sett, arg_view_balance_secret);
+  command_line::add_arg(desc_cmd_sett, arg_block_start);
+  command_line::add_arg(desc_cmd_sett, arg_output_file);
+  command_line::add_arg(desc_cmd_sett, arg_follow);
+  command_line::add_arg(desc_cmd_sett, arg_poll_interval);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
+  command_line::add_arg(desc_cmd_only, command_line::arg_help);
+
+  po::options_description desc_options("Allowed options");
+  desc_options.add(desc_cmd_only).add(desc_cmd_sett);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_options, [&]()
+  {
+    auto parser = po::command_line_parser(argc, argv).options(desc_options);
+    po::store(parser.run(), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (! r)
+    return 1;
+
+  if (command_line::get_arg(vm, command_line::arg_help))
+  {
+    std::cout << "Salvium '" << MONERO_RELEASE_NAME << "' (v" << MONERO_VERSION_FULL << ")" << ENDL << ENDL;
+    std::cout << desc_options << std::endl;
+    return 1;
+  }
+
+  mlog_configure(mlog_get_default_log_path("salvium-blockchain-enote-scanner.log"), true);
+  if (!command_line::is_arg_defaulted(vm, arg_log_level))
+    mlog_set_log(command_line::get_arg(vm, arg_log_level).c_str());
+  else
+    mlog_set_log("0,bcutil:INFO");
+
+  std::string opt_data_dir = command_line::get_arg(vm, cryptonote::arg_data_dir);
+  bool opt_testnet = command_line::get_arg(vm, cryptonote::arg_testnet_on);
+  bool opt_stagenet = command_line::get_arg(vm, cryptonote::arg_stagenet_on);
+  network_type net_type = opt_testnet ? TESTNET : opt_stagenet ? STAGENET : MAINNET;
+  const std::string opt_output_file = command_line::get_arg(vm, arg_output_file);
+  const bool opt_follow = command_line::get_arg(vm, arg_follow);
+  const uint64_t opt_poll_interval = std::max<uint64_t>(1, command_line::get_arg(vm, arg_poll_interval));
+  const uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
+
+  if (opt_output_file.empty())
+  {
+    std::cerr << "--output-file is required" << std::endl;
+    return 1;
+  }
+
+  // only the incoming view key is ever held: it finds and decodes received
+  // enotes, but cannot spend them or tell when they are spent
+  address_parse_info info;
+  if (!get_account_address_from_str(info, net_type, command_line::get_arg(vm, arg_address)) || info.is_subaddress)
+  {
+    std::cerr << "--address must be the main address of the account" << std::endl;
+    return 1;
+  }
+  scan_account acc;
+  acc.main_spend_pubkey = info.address.m_spend_public_key;
+  if (!command_line::is_arg_defaulted(vm, arg_view_balance_secret))
+  {
+    crypto::secret_key s_view_balance;
+    if (!epee::string_tools::hex_to_pod(command_line::get_arg(vm, arg_view_balance_secret), s_view_balance))
+    {
+      std::cerr << "Invalid --view-balance-secret" << std::endl;
+      return 1;
+    }
+    carrot::make_carrot_viewincoming_key(s_view_balance, acc.view_key);
+    memwipe(&s_view_balance, sizeof(s_view_balance));
+  }
+  else if (!epee::string_tools::hex_to_pod(command_line::get_arg(vm, arg_view_incoming_key), acc.view_key))
+  {
+    std::cerr << "One of --view-incoming-key or --view-balance-secret is required" << std::endl;
+    return 1;
+  }
+  const crypto::public_key view_pubkey = rct::rct2pk(rct::scalarmultKey(rct::pk2rct(acc.main_spend_pubkey), rct::sk2rct(acc.view_key)));
+  if (view_pubkey != info.address.m_view_public_key)
+  {
+    std::cerr << "The view key does not match the address" << std::endl;
+    return 1;
+  }
+
+  // resume an existing stream from where it stopped
+  uint64_t height = command_line::get_arg(vm, arg_block_start);
+  crypto::hash top_id = crypto::null_hash;
+  bool resumed = false;
+  if (boost::filesystem::exists(opt_output_file))
+  {
+    std::ifstream in(opt_output_file, std::ios_base::binary);
+    std::vector<light_wallet_output> outputs;
+    if (!enote_stream::read(in, outputs, height, top_id))
+    {
+      std::cerr << "Existing " << opt_output_file << " is not an enote stream" << std::endl;
+      return 1;
+    }
+    resumed = true;
+    MINFO("Resuming " << opt_output_file << " at height " << height << ", " << outputs.size() << " enotes found so far");
+  }
+
+  std::ofstream output(opt_output_file, std::ios_base::binary | std::ios_base::out | std::ios_base::app);
+  if (output.fail())
+  {
+    LOG_PRINT_L0("Failed to open output file " << opt_output_file);
+    return 1;
+  }
+  if (!resumed)
+    enote_stream::write_header(output);
+
+  LOG_PRINT_L0("Initializing source blockchain (BlockchainDB)");
+  std::unique_ptr<BlockchainAndPool> core_storage = std::make_unique<BlockchainAndPool>();
+  BlockchainDB* db = new_db();
+  if (db == NULL)
+  {
+    LOG_ERROR("Failed to initialize a database");
+    throw std::runtime_error("Failed to initialize a database");
+  }
+
+  boost::filesystem::path folder(opt_data_dir);
+  if (opt_stagenet) {
+    folder /= std::to_string(STAGENET_VERSION);
+  } else if (opt_testnet) {
+    folder /= std::to_string(TESTNET_VERSION);
+  }
+  folder /= db->get_db_name();
+  LOG_PRINT_L0("Loading blockchain from folder " << folder << " ...");
+
+  try
+  {
+    db->open(folder.string(), DBF_RDONLY);
+  }
+  catch (const std::exception& e)
+  {
+    LOG_PRINT_L0("Error opening database: " << e.what());
+    return 1;
+  }
+  r = core_storage->blockchain.init(db, net_type);
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
+
+  tools::signal_handler::install([](int type) {
+    stop_requested = true;
+  });
+
+  // ids of the last blocks scanned, recent_ids.back() being the one below height
+  std::deque<crypto::hash> recent_ids;
+  if (top_id != crypto::null_hash)
+    recent_ids.push_back(top_id);
+
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  size_t threads = opt_threads ? opt_threads : tpool.get_max_concurrency();
+  threads = std::max<size_t>(1, threads);
+  uint64_t found = 0;
+  while (!stop_requested)
+  {
+    const uint64_t db_height = db->height();
+
+    // a reorg: walk back to the last block still on the main chain
+    if (!recent_ids.empty() && (height > db_height || db->get_block_hash_from_height(height - 1) != recent_ids.back()))
+    {
+      while (!recent_ids.empty() && (height > db_height || db->get_block_hash_from_height(height - 1) != recent_ids.back()))
+      {
+        recent_ids.pop_back();
+        --height;
+      }
+      // the fork is older than the ids remembered, rescan the whole window
+      if (recent_ids.empty())
+        height = height > reorg_window ? height - reorg_window : 0;
+      MINFO("Reorg detected, rescanning from height " << height);
+      enote_stream::write_rollback(output, height);
+      output.flush();
+      continue;
+    }
+
+    if (height >= db_height)
+    {
+      if (!opt_follow)
+        break;
+      for (uint64_t i = 0; i < opt_poll_interval && !stop_requested; ++i)
+        epee::misc_utils::sleep_no_w(1000);
+      continue;
+    }
+
+    std::vector<scan_shard> shards;
+    for (uint64_t h = height; shards.size() < threads && h < db_height; h += scan_shard_size)
+      shards.push_back({h, std::min(db_height, h + scan_shard_size), {}, {}, std::string()});
+
+    tools::threadpool::waiter waiter(tpool);
+    for (scan_shard &shard: shards)
+      tpool.submit(&waiter, [db, &acc, &shard]() { scan_range(db, acc, shard); }, true);
+    if (!waiter.wait())
+    {
+      LOG_PRINT_L0("Failed to scan blocks");
+      return 1;
+    }
+
+    for (const scan_shard &shard: shards)
+    {
+      if (!shard.error.empty())
+        throw std::runtime_error(shard.error);
+      for (const light_wallet_output &out: shard.outputs)
+        enote_stream::write_enote(output, out);
+      found += shard.outputs.size();
+      recent_ids.insert(recent_ids.end(), shard.block_ids.begin(), shard.block_ids.end());
+      height = shard.stop;
+    }
+    while (recent_ids.size() > reorg_window)
+      recent_ids.pop_front();
+
+    enote_stream::write_scanned(output, height, recent_ids.back());
+    output.flush();
+    MINFO("Scanned up to height " << height << ", " << found << " enotes found");
+  }
+
+  core_storage->blockchain.deinit();
+  return 0;
+
+  CATCH_ENTRY("Enote scanning error", 1);
+}
@@ -28,6 +28,9 @@
 
 #include "bootstrap_file.h"
 #include "blocksdat_file.h"
+#include "chunked_bootstrap_file.h"
+#include "state_snapshot_file.h"
+#include "checkpoints/checkpoints.h"
 #include "common/command_line.h"
 #include "cryptonote_core/tx_pool.h"
 #include "cryptonote_core/cryptonote_core.h"
@@ -62,6 +65,12 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<uint64_t> arg_block_start = {"block-start", "Start at block number", block_start};
   const command_line::arg_descriptor<uint64_t> arg_block_stop = {"block-stop", "Stop at block number", block_stop};
   const command_line::arg_descriptor<bool> arg_blocks_dat = {"blocksdat", "Output in blocks.dat format", blocks_dat};
+  const command_line::arg_descriptor<bool> arg_chunked = {"chunked", "Output in chunked bootstrap format, with a chunk index and per chunk hashes", false};
+  const command_line::arg_descriptor<uint64_t> arg_blocks_per_chunk = {"blocks-per-chunk", "Number of blocks per chunk in chunked bootstrap format", CHUNKED_BLOCKS_PER_CHUNK};
+  const command_line::arg_descriptor<bool> arg_state_snapshot = {"state-snapshot", "Output a snapshot of the consensus state at the top block instead of blocks", false};
+  const command_line::arg_descriptor<std::string> arg_verify_state_snapshot = {"verify-state-snapshot", "Check a state snapshot file, and the database state against it", ""};
+  const command_line::arg_descriptor<std::string> arg_state_commitment = {"state-commitment", "Expected commitment of the state snapshot", ""};
+  const command_line::arg_descriptor<bool> arg_allow_uncheckpointed_state = {"allow-uncheckpointed-state", "Allow a state snapshot at a top block which is not a checkpoint", false};
 
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
@@ -72,6 +81,12 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_block_start);
   command_line::add_arg(desc_cmd_sett, arg_block_stop);
   command_line::add_arg(desc_cmd_sett, arg_blocks_dat);
+  command_line::add_arg(desc_cmd_sett, arg_chunked);
+  command_line::add_arg(desc_cmd_sett, arg_blocks_per_chunk);
+  command_line::add_arg(desc_cmd_sett, arg_state_snapshot);
+  command_line::add_arg(desc_cmd_sett, arg_verify_state_snapshot);
+  command_line::add_arg(desc_cmd_sett, arg_state_commitment);
+  command_line::add_arg(desc_cmd_sett, arg_allow_uncheckpointed_state);
 
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
@@ -113,6 +128,21 @@ int main(int argc, char* argv[])
     return 1;
   }
   bool opt_blocks_dat = command_line::get_arg(vm, arg_blocks_dat);
+  bool opt_chunked = command_line::get_arg(vm, arg_chunked);
+  bool opt_state_snapshot = command_line::get_arg(vm, arg_state_snapshot);
+  const std::string verify_state_snapshot = command_line::get_arg(vm, arg_verify_state_snapshot);
+  if (opt_blocks_dat + opt_chunked + opt_state_snapshot + !verify_state_snapshot.empty() > 1)
+  {
+    std::cerr << "Can't specify more than one of --blocksdat, --chunked, --state-snapshot and --verify-state-snapshot" << std::endl;
+    return 1;
+  }
+  crypto::hash expected_commitment = crypto::null_hash;
+  const std::string state_commitment = command_line::get_arg(vm, arg_state_commitment);
+  if (!state_commitment.empty() && !epee::string_tools::hex_to_pod(state_commitment, expected_commitment))
+  {
+    std::cerr << "Invalid state commitment: " << state_commitment << std::endl;
+    return 1;
+  }
 
   std::string m_config_folder;
 
@@ -120,9 +150,12 @@ int main(int argc, char* argv[])
 
   if (command_line::has_arg(vm, arg_output_file))
     output_file_path = boost::filesystem::path(command_line::get_arg(vm, arg_output_file));
+  else if (opt_state_snapshot)
+    output_file_path = boost::filesystem::path(m_config_folder) / "export" / STATE_SNAPSHOT_RAW;
   else
     output_file_path = boost::filesystem::path(m_config_folder) / "export" / BLOCKCHAIN_RAW;
-  LOG_PRINT_L0("Export output file: " << output_file_path.string());
+  if (verify_state_snapshot.empty())
+    LOG_PRINT_L0("Export output file: " << output_file_path.string());
 
   // If we wanted to use the memory pool, we would set up a fake_core.
 
@@ -162,7 +195,7 @@ int main(int argc, char* argv[])
   }
   r = core_storage->blockchain.init(db, opt_testnet ? cryptonote::TESTNET : opt_stagenet ? cryptonote::STAGENET : cryptonote::MAINNET);
 
-  if (core_storage->blockchain.get_blockchain_pruning_seed() && !opt_blocks_dat)
+  if (core_storage->blockchain.get_blockchain_pruning_seed() && !opt_blocks_dat && !opt_state_snapshot && verify_state_snapshot.empty())
   {
     LOG_PRINT_L0("Blockchain is pruned, cannot export");
     return 1;
@@ -170,6 +203,72 @@ int main(int argc, char* argv[])
 
   CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
   LOG_PRINT_L0("Source blockchain storage initialized OK");
+
+  if (opt_state_snapshot || !verify_state_snapshot.empty())
+  {
+    // a snapshot is only worth trusting at a height the chain is pinned at
+    cryptonote::checkpoints checkpoints;
+    checkpoints.init_default_checkpoints(core_storage->blockchain.get_nettype());
+    const bool allow_uncheckpointed = command_line::get_arg(vm, arg_allow_uncheckpointed_state);
+
+    StateSnapshotFile snapshot;
+    if (opt_state_snapshot)
+    {
+      const uint64_t top_height = core_storage->blockchain.get_current_blockchain_height() - 1;
+      bool is_a_checkpoint = false;
+      if (!checkpoints.check_block(top_height, core_storage->blockchain.get_tail_id(), is_a_checkpoint))
+      {
+        LOG_PRINT_L0("Top block " << top_height << " does not match its checkpoint");
+        return 1;
+      }
+      if (!is_a_checkpoint && !allow_uncheckpointed)
+      {
+        LOG_PRINT_L0("Top block " << top_height << " is not a checkpoint, pop blocks to one or use --" << arg_allow_uncheckpointed_state.name);
+        return 1;
+      }
+      LOG_PRINT_L0("Exporting consensus state...");
+      r = snapshot.store_state(&core_storage->blockchain, output_file_path);
+      CHECK_AND_ASSERT_MES(r, 1, "Failed to export consensus state");
+      if (expected_commitment != crypto::null_hash && snapshot.get_info().commitment != expected_commitment)
+      {
+        LOG_PRINT_L0("Exported state does not match the expected commitment " << expected_commitment);
+        return 1;
+      }
+      LOG_PRINT_L0("Consensus state exported OK, commitment " << snapshot.get_info().commitment);
+      return 0;
+    }
+
+    LOG_PRINT_L0("Verifying state snapshot " << verify_state_snapshot);
+    if (!snapshot.open_reader(verify_state_snapshot) || !snapshot.verify_file(verify_state_snapshot))
+    {
+      LOG_PRINT_L0("State snapshot file is invalid");
+      return 1;
+    }
+    const bootstrap::state_snapshot_info &info = snapshot.get_info();
+    bool is_a_checkpoint = false;
+    if (info.height == 0 || !checkpoints.check_block(info.height - 1, info.top_block_hash, is_a_checkpoint))
+    {
+      LOG_PRINT_L0("State snapshot top block does not match its checkpoint");
+      return 1;
+    }
+    if (!is_a_checkpoint && !allow_uncheckpointed)
+    {
+      LOG_PRINT_L0("State snapshot is not at a checkpoint, use --" << arg_allow_uncheckpointed_state.name << " to check it anyway");
+      return 1;
+    }
+    if (expected_commitment != crypto::null_hash && info.commitment != expected_commitment)
+    {
+      LOG_PRINT_L0("State snapshot commitment " << info.commitment << " does not match the expected " << expected_commitment);
+      return 1;
+    }
+    if (!snapshot.verify_state(&core_storage->blockchain))
+    {
+      LOG_PRINT_L0("Database state does not match the state snapshot");
+      return 1;
+    }
+    LOG_PRINT_L0("State snapshot verified OK, commitment " << info.commitment);
+    return 0;
+  }
   LOG_PRINT_L0("Exporting blockchain raw data...");
 
   if (opt_blocks_dat)
@@ -177,6 +276,11 @@ int main(int argc, char* argv[])
     BlocksdatFile blocksdat;
     r = blocksdat.store_blockchain_raw(&core_storage->blockchain, NULL, output_file_path, block_stop);
   }
+  else if (opt_chunked)
+  {
+    ChunkedBootstrapFile chunked;
+    r = chunked.store_blockchain_raw(&core_storage->blockchain, output_file_path, block_start, block_stop, command_line::get_arg(vm, arg_blocks_per_chunk));
+  }
   else
   {
     BootstrapFile bootstrap;
@@ -29,6 +29,7 @@
 #include <atomic>
 #include <cstdio>
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 
 #include <boost/filesystem.hpp>
@@ -36,13 +37,18 @@
 #include <unistd.h>
 #include "misc_log_ex.h"
 #include "bootstrap_file.h"
+#include "chunked_bootstrap_file.h"
 #include "bootstrap_serialization.h"
 #include "blocks/blocks.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "serialization/binary_utils.h" // dump_binary(), parse_binary()
 #include "serialization/json_utils.h" // dump_json()
 #include "include_base_utils.h"
+#include "file_io_utils.h"
+#include "common/threadpool.h"
+#include "common/metrics.h"
 #include "cryptonote_core/cryptonote_core.h"
+#include "ringct/multiexp.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
@@ -70,6 +76,15 @@ uint64_t db_batch_size = 100;
 uint64_t db_batch_size_verify = 5000;
 
 std::string refresh_string = "\r                                    \r";
+
+// what a verified replay went through, for --benchmark-output
+uint64_t replay_blocks = 0;
+uint64_t replay_bytes = 0;
+
+tools::metrics::histogram &import_stage_time(const char *stage)
+{
+  return tools::metrics::get_histogram("import_stage_seconds", "Time taken by each stage of a verified import batch", tools::metrics::label("stage", stage));
+}
 }
 
 
@@ -127,35 +142,119 @@ int pop_blocks(cryptonote::core& core, int num_blocks)
   return num_blocks;
 }
 
-int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &blocks, bool force)
+std::string get_resume_marker_path(const std::string& import_file_path)
+{
+  return import_file_path + ".resume";
+}
+
+bool load_resume_marker(const std::string& import_file_path, bootstrap::import_resume_marker& marker)
+{
+  std::string blob;
+  if (!epee::file_io_utils::load_file_to_string(get_resume_marker_path(import_file_path), blob))
+    return false;
+  return ::serialization::parse_binary(blob, marker);
+}
+
+void store_resume_marker(const std::string& import_file_path, bootstrap::import_resume_marker& marker, uint64_t height, std::streampos file_pos)
+{
+  marker.height = height;
+  marker.file_pos = file_pos;
+  std::string blob;
+  if (!::serialization::dump_binary(marker, blob) || !epee::file_io_utils::save_string_to_file(get_resume_marker_path(import_file_path), blob))
+    MWARNING("Failed to save resume marker at height " << height);
+}
+
+void block_package_to_entry(const bootstrap::block_package& bp, block_complete_entry& bce, crypto::hash& hash)
+{
+  bce.pruned = false;
+  cryptonote::block_to_blob(bp.block, bce.block);
+  bce.txs.reserve(bp.txs.size());
+  for (const auto &tx: bp.txs)
+  {
+    bce.txs.push_back({cryptonote::blobdata(), crypto::null_hash});
+    cryptonote::tx_to_blob(tx, bce.txs.back().blob);
+  }
+  hash = cryptonote::get_block_hash(bp.block);
+}
+
+bool add_block_package_unverified(cryptonote::core& core, const bootstrap::block_package& bp)
+{
+  // add_block() adds the coinbase tx itself, so only the other txs go in here
+  std::vector<std::pair<transaction, blobdata>> txs;
+  txs.reserve(bp.txs.size());
+  for (const transaction &tx : bp.txs)
+    txs.push_back(std::make_pair(tx, tx_to_blob(tx)));
+
+  try
+  {
+    cryptonote::yield_block_info ybi; // This just gets discarded because we aren't looking to maintain a cache of YBI data in the import utility
+    cryptonote::audit_block_info abi; // This just gets discarded because we aren't looking to maintain a cache of ABI data in the import utility
+    uint64_t long_term_block_weight = core.get_blockchain_storage().get_next_long_term_block_weight(bp.block_weight);
+    core.get_blockchain_storage().get_db().add_block(std::make_pair(bp.block, block_to_blob(bp.block)), bp.block_weight, long_term_block_weight, bp.cumulative_difficulty, bp.coins_generated, txs, opt_testnet ? cryptonote::TESTNET : opt_stagenet ? cryptonote::STAGENET : cryptonote::MAINNET, ybi, abi);
+  }
+  catch (const std::exception& e)
+  {
+    MFATAL("Error adding block to blockchain: " << e.what());
+    return false;
+  }
+  return true;
+}
+
+int check_flush(cryptonote::core &core, std::vector<bootstrap::block_package> &packages, bool force)
 {
-  if (blocks.empty())
+  if (packages.empty())
     return 0;
-  if (!force && blocks.size() < db_batch_size)
+  if (!force && packages.size() < db_batch_size)
     return 0;
 
   // wait till we can verify a full HOH without extra, for speed
-  uint64_t new_height = core.get_blockchain_storage().get_db().height() + blocks.size();
+  uint64_t new_height = core.get_blockchain_storage().get_db().height() + packages.size();
   if (!force && new_height % HASH_OF_HASHES_STEP)
     return 0;
 
-  std::vector<crypto::hash> hashes;
-  for (const auto &b: blocks)
+  static tools::metrics::histogram &parse_time = import_stage_time("parse");
+  static tools::metrics::histogram &prevalidate_time = import_stage_time("prevalidate");
+  static tools::metrics::histogram &prepare_time = import_stage_time("prepare");
+  static tools::metrics::histogram &txs_time = import_stage_time("txs");
+  static tools::metrics::histogram &blocks_time = import_stage_time("blocks");
+  static tools::metrics::histogram &cleanup_time = import_stage_time("cleanup");
+
+  // turning the blocks back into blobs and hashing them is independent per block, so spread it
+  // over all cores, ahead of the (sequential) verification below
+  std::vector<block_complete_entry> blocks(packages.size());
+  std::vector<crypto::hash> hashes(packages.size());
   {
-    cryptonote::block block;
-    if (!parse_and_validate_block_from_blob(b.block, block))
+    tools::metrics::scoped_timer timer(parse_time);
+    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+    tools::threadpool::waiter waiter(tpool);
+    const size_t threads = std::max<size_t>(1, tpool.get_max_concurrency());
+    const size_t blocks_per_thread = (packages.size() + threads - 1) / threads;
+    for (size_t start = 0; start < packages.size(); start += blocks_per_thread)
     {
-      MERROR("Failed to parse block: "
-          << epee::string_tools::buff_to_hex_nodelimer(b.block));
-      core.cleanup_handle_incoming_blocks();
+      const size_t end = std::min(packages.size(), start + blocks_per_thread);
+      tpool.submit(&waiter, [&packages, &blocks, &hashes, start, end]() {
+        for (size_t i = start; i < end; ++i)
+          block_package_to_entry(packages[i], blocks[i], hashes[i]);
+      }, true);
+    }
+    if (!waiter.wait())
+    {
+      MERROR("Failed to prepare blocks");
       return 1;
     }
-    hashes.push_back(cryptonote::get_block_hash(block));
   }
-  core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), hashes, {});
+  {
+    tools::metrics::scoped_timer timer(prevalidate_time);
+    core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), hashes, {});
+  }
 
   std::vector<block> pblocks;
-  if (!core.prepare_handle_incoming_blocks(blocks, pblocks))
+  bool prepared;
+  {
+    tools::metrics::scoped_timer timer(prepare_time);
+    prepared = core.prepare_handle_incoming_blocks(blocks, pblocks);
+  }
+  if (!prepared)
   {
     MERROR("Failed to prepare to add blocks");
     return 1;
@@ -168,13 +267,20 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
   }
 
   size_t blockidx = 0;
+  uint64_t bytes = 0;
   for(const block_complete_entry& block_entry: blocks)
   {
+    bytes += block_entry.block.size();
+
     // process transactions
     for(auto& tx_blob: block_entry.txs)
     {
+      bytes += tx_blob.blob.size();
       tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-      core.handle_incoming_tx(tx_blob, tvc, relay_method::block, true);
+      {
+        tools::metrics::scoped_timer timer(txs_time);
+        core.handle_incoming_tx(tx_blob, tvc, relay_method::block, true);
+      }
       if(tvc.m_verifivation_failed)
       {
         cryptonote::transaction transaction;
@@ -191,7 +297,10 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
 
     block_verification_context bvc = {};
 
-    core.handle_incoming_block(block_entry.block, pblocks.empty() ? NULL : &pblocks[blockidx++], bvc, false); // <--- process block
+    {
+      tools::metrics::scoped_timer timer(blocks_time);
+      core.handle_incoming_block(block_entry.block, pblocks.empty() ? NULL : &pblocks[blockidx++], bvc, false); // <--- process block
+    }
 
     if(bvc.m_verifivation_failed)
     {
@@ -211,13 +320,188 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
     }
 
   } // each download block
-  if (!core.cleanup_handle_incoming_blocks())
+  bool cleaned_up;
+  {
+    tools::metrics::scoped_timer timer(cleanup_time);
+    cleaned_up = core.cleanup_handle_incoming_blocks();
+  }
+  if (!cleaned_up)
     return 1;
 
-  blocks.clear();
+  replay_blocks += packages.size();
+  replay_bytes += bytes;
+  packages.clear();
   return 0;
 }
 
+bool write_benchmark_report(const std::string &path, double seconds, uint64_t db_bytes_grown)
+{
+  std::ofstream out(path, std::ios_base::trunc);
+  if (!out)
+  {
+    MERROR("Failed to open " << path << " for writing");
+    return false;
+  }
+
+  const auto stage = [&out](const char *name, tools::metrics::histogram &h, bool last) {
+    out << "    \"" << name << "\": {\"count\": " << h.count() << ", \"seconds\": " << h.sum_us() / 1e6 << "}" << (last ? "\n" : ",\n");
+  };
+  const auto block_stage = [](const char *name) -> tools::metrics::histogram& {
+    return tools::metrics::get_histogram("block_verification_seconds", "Time taken by each stage of adding a block to the main chain", tools::metrics::label("stage", name));
+  };
+
+  out << "{\n";
+  out << "  \"blocks\": " << replay_blocks << ",\n";
+  out << "  \"bytes\": " << replay_bytes << ",\n";
+  out << "  \"seconds\": " << seconds << ",\n";
+  out << "  \"blocks_per_second\": " << (seconds > 0 ? replay_blocks / seconds : 0) << ",\n";
+  out << "  \"bytes_per_second\": " << (seconds > 0 ? replay_bytes / seconds : 0) << ",\n";
+  // bytes the db file grew by per byte of block data replayed
+  out << "  \"db_bytes_grown\": " << db_bytes_grown << ",\n";
+  out << "  \"write_amplification\": " << (replay_bytes > 0 ? db_bytes_grown / (double)replay_bytes : 0) << ",\n";
+  const auto appends = [](const char *result) {
+    return tools::metrics::get_counter("lmdb_append_puts_total", "LMDB puts tried as appends", tools::metrics::label("result", result)).get();
+  };
+  out << "  \"lmdb_append_puts\": {\"appended\": " << appends("appended") << ", \"fallback\": " << appends("fallback") << "},\n";
+  out << "  \"stages\": {\n";
+  for (const char *name: {"parse", "prevalidate", "prepare", "txs", "blocks", "cleanup"})
+    stage(name, import_stage_time(name), false);
+  for (const char *name: {"difficulty", "pow", "miner_tx", "protocol_tx", "db_add"})
+    stage((std::string("block_") + name).c_str(), block_stage(name), false);
+  stage("lmdb_commit", tools::metrics::get_histogram("lmdb_txn_commit_seconds", "Time taken to commit LMDB transactions"), true);
+  out << "  }\n";
+  out << "}\n";
+  return out.good();
+}
+
+int import_from_chunked_file(cryptonote::core& core, const std::string& import_file_path, uint64_t block_stop)
+{
+  ChunkedBootstrapFile chunked;
+  if (!chunked.open_reader(import_file_path))
+    return false;
+  const bootstrap::chunk_index &index = chunked.get_index();
+  if (index.chunks.empty())
+    return false;
+
+  // the index locates any height directly, so this always picks up at the db height
+  uint64_t h = core.get_blockchain_storage().get_current_blockchain_height();
+  const uint64_t block_last = index.chunks.back().block_first + index.chunks.back().block_count - 1;
+  if (!block_stop || block_stop > block_last)
+    block_stop = block_last;
+  MINFO("chunked bootstrap file last block number: " << block_last << "  start block: " << h << "  stop block: " << block_stop);
+  if (block_stop < h)
+    return false;
+
+  size_t first_chunk = 0;
+  while (first_chunk < index.chunks.size() && index.chunks[first_chunk].block_first + index.chunks[first_chunk].block_count <= h)
+    ++first_chunk;
+  if (first_chunk == index.chunks.size() || index.chunks[first_chunk].block_first > h)
+  {
+    MFATAL("chunked bootstrap file does not contain block " << h);
+    return false;
+  }
+
+  const bool use_batch = opt_batch && !opt_verify;
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  const size_t window = std::max<size_t>(1, tpool.get_max_concurrency());
+  uint64_t num_imported = 0;
+  int quit = 0;
+  std::vector<bootstrap::block_package> packages;
+
+  if (use_batch)
+    core.get_blockchain_storage().get_db().batch_start(db_batch_size);
+
+  for (size_t chunk = first_chunk; chunk < index.chunks.size() && !quit; chunk += window)
+  {
+    // chunks carry their own hash, so a window of them is read and checked at once,
+    // each on its own stream, then added in height order
+    const size_t count = std::min(window, index.chunks.size() - chunk);
+    std::vector<std::vector<bootstrap::block_package>> chunk_blocks(count);
+    std::unique_ptr<bool[]> chunk_ok(new bool[count]());
+    tools::threadpool::waiter waiter(tpool);
+    for (size_t i = 0; i < count; ++i)
+    {
+      tpool.submit(&waiter, [&, i]() {
+        std::ifstream import_file(import_file_path, std::ios_base::binary | std::ifstream::in);
+        chunk_ok[i] = ChunkedBootstrapFile::read_chunk(import_file, index.chunks[chunk + i], index.codec, chunk_blocks[i]);
+      }, true);
+    }
+    if (!waiter.wait())
+    {
+      MFATAL("Failed to read chunks");
+      quit = 2;
+      break;
+    }
+
+    for (size_t i = 0; i < count && !quit; ++i)
+    {
+      if (!chunk_ok[i])
+      {
+        MFATAL("Aborting: bad chunk at height " << index.chunks[chunk + i].block_first);
+        quit = 2;
+        break;
+      }
+      uint64_t height = index.chunks[chunk + i].block_first;
+      for (bootstrap::block_package &bp: chunk_blocks[i])
+      {
+        if (height > block_stop)
+        {
+          quit = 1;
+          break;
+        }
+        if (height++ < h)
+          continue;
+
+        if (opt_verify)
+        {
+          packages.push_back(std::move(bp));
+          if (check_flush(core, packages, false))
+          {
+            quit = 2; // make sure we don't commit partial block data
+            break;
+          }
+        }
+        else
+        {
+          if (!add_block_package_unverified(core, bp))
+          {
+            quit = 2; // make sure we don't commit partial block data
+            break;
+          }
+          if (use_batch && height % db_batch_size == 0)
+          {
+            std::cout << refresh_string;
+            std::cout << ENDL << "[- batch commit at height " << height-1 << " -]" << ENDL;
+            core.get_blockchain_storage().get_db().batch_stop();
+            core.get_blockchain_storage().get_db().batch_start(db_batch_size);
+            core.get_blockchain_storage().get_db().show_stats();
+          }
+        }
+        h = height;
+        ++num_imported;
+      }
+      std::cout << refresh_string << "block " << h-1 << " / " << block_stop << "\r" << std::flush;
+    }
+  }
+
+  if (opt_verify && quit <= 1)
+  {
+    int ret = check_flush(core, packages, true);
+    if (ret)
+      return ret;
+  }
+  // on error, the batch destructor aborts the pending write txn
+  if (use_batch && quit <= 1)
+    core.get_blockchain_storage().get_db().batch_stop();
+
+  std::cout << refresh_string;
+  core.get_blockchain_storage().get_db().show_stats();
+  MINFO("Number of blocks imported: " << num_imported);
+  MINFO("Finished at block: " << h-1 << "  total blocks: " << h);
+  std::cout << ENDL;
+  return quit > 1 ? 2 : 0;
+}
+
 int import_from_file(cryptonote::core& core, const std::string& import_file_path, uint64_t block_stop=0)
 {
   // Reset stats, in case we're using newly created db, accumulating stats
@@ -232,6 +516,8 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
     MFATAL("bootstrap file not found: " << fs_import_file_path);
     return false;
   }
+  if (ChunkedBootstrapFile::is_chunked_file(import_file_path))
+    return import_from_chunked_file(core, import_file_path, block_stop);
 
   uint64_t block_first;
   uint64_t start_height = 1, seek_height;
@@ -241,8 +527,25 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
   seek_height = start_height;
   BootstrapFile bootstrap;
   std::streampos pos;
-  // BootstrapFile bootstrap(import_file_path);
-  uint64_t total_source_blocks = bootstrap.count_blocks(import_file_path, pos, seek_height, block_first);
+  uint64_t total_source_blocks;
+  const uint64_t file_size = boost::filesystem::file_size(fs_import_file_path, ec);
+  bootstrap::import_resume_marker resume_marker = AUTO_VAL_INIT(resume_marker);
+  if (opt_resume && load_resume_marker(import_file_path, resume_marker) && !ec &&
+      resume_marker.height == start_height && resume_marker.file_size == file_size)
+  {
+    MINFO("Resuming import at height " << start_height << " from " << get_resume_marker_path(import_file_path));
+    pos = static_cast<std::streamoff>(resume_marker.file_pos);
+    total_source_blocks = resume_marker.total_blocks;
+    block_first = resume_marker.block_first;
+  }
+  else
+  {
+    // BootstrapFile bootstrap(import_file_path);
+    total_source_blocks = bootstrap.count_blocks(import_file_path, pos, seek_height, block_first);
+    resume_marker.file_size = file_size;
+    resume_marker.total_blocks = total_source_blocks;
+    resume_marker.block_first = block_first;
+  }
   MINFO("bootstrap file last block number: " << total_source_blocks+block_first-1 << " (zero-based height)  total blocks: " << total_source_blocks);
 
   if (total_source_blocks+block_first-1 <= start_height)
@@ -296,13 +599,17 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
   MINFO("Reading blockchain from bootstrap file...");
   std::cout << ENDL;
 
-  std::vector<block_complete_entry> blocks;
+  std::vector<bootstrap::block_package> packages;
+  std::streampos chunk_end_pos = pos;
 
   // Skip to start_height before we start adding.
   {
     bool q2 = false;
     import_file.seekg(pos);
-    bytes_read = bootstrap.count_bytes(import_file, start_height-seek_height, h, q2);
+    // count_bytes always reads at least one chunk, and a resume marker points right at start_height
+    bytes_read = 0;
+    if (start_height > seek_height)
+      bytes_read = bootstrap.count_bytes(import_file, start_height-seek_height, h, q2);
     if (q2)
     {
       quit = 2;
@@ -372,6 +679,7 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
       }
     }
     bytes_read += chunk_size;
+    chunk_end_pos = import_file.tellg();
     MDEBUG("Total bytes read: " << bytes_read);
 
     if (h > block_stop)
@@ -435,74 +743,28 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
 
         if (opt_verify)
         {
-          cryptonote::blobdata block;
-          cryptonote::block_to_blob(bp.block, block);
-          std::vector<tx_blob_entry> txs;
-          for (const auto &tx: bp.txs)
-          {
-            txs.push_back({cryptonote::blobdata(), crypto::null_hash});
-            cryptonote::tx_to_blob(tx, txs.back().blob);
-          }
-          block_complete_entry bce;
-          bce.pruned = false;
-          bce.block = std::move(block);
-          bce.txs = std::move(txs);
-          blocks.push_back(bce);
-          int ret = check_flush(core, blocks, false);
+          packages.push_back(std::move(bp));
+          int ret = check_flush(core, packages, false);
           if (ret)
           {
             quit = 2; // make sure we don't commit partial block data
             break;
           }
+          if (packages.empty())
+            store_resume_marker(import_file_path, resume_marker, core.get_blockchain_storage().get_db().height(), chunk_end_pos);
         }
         else
         {
-          std::vector<std::pair<transaction, blobdata>> txs;
-          std::vector<transaction> archived_txs;
-
-          archived_txs = bp.txs;
-
-          // tx number 1: coinbase tx
-          // tx number 2 onwards: archived_txs
-          for (const transaction &tx : archived_txs)
-          {
-            // add blocks with verification.
-            // for Blockchain and blockchain_storage add_new_block().
-            // for add_block() method, without (much) processing.
-            // don't add coinbase transaction to txs.
-            //
-            // because add_block() calls
-            // add_transaction(blk_hash, blk.miner_tx) first, and
-            // then a for loop for the transactions in txs.
-            txs.push_back(std::make_pair(tx, tx_to_blob(tx)));
-          }
-
-          size_t block_weight;
-          difficulty_type cumulative_difficulty;
-          uint64_t coins_generated;
-
-          block_weight = bp.block_weight;
-          cumulative_difficulty = bp.cumulative_difficulty;
-          coins_generated = bp.coins_generated;
-
-          try
-          {
-            cryptonote::yield_block_info ybi; // This just gets discarded because we aren't looking to maintain a cache of YBI data in the import utility
-            cryptonote::audit_block_info abi; // This just gets discarded because we aren't looking to maintain a cache of ABI data in the import utility
-            uint64_t long_term_block_weight = core.get_blockchain_storage().get_next_long_term_block_weight(block_weight);
-            core.get_blockchain_storage().get_db().add_block(std::make_pair(b, block_to_blob(b)), block_weight, long_term_block_weight, cumulative_difficulty, coins_generated, txs, opt_testnet ? cryptonote::TESTNET : opt_stagenet ? cryptonote::STAGENET : cryptonote::MAINNET, ybi, abi);
-          }
-          catch (const std::exception& e)
+          if (!add_block_package_unverified(core, bp))
           {
             std::cout << refresh_string;
-            MFATAL("Error adding block to blockchain: " << e.what());
             quit = 2; // make sure we don't commit partial block data
             break;
           }
 
-          if (use_batch)
+          if ((h-1) % db_batch_size == 0)
           {
-            if ((h-1) % db_batch_size == 0)
+            if (use_batch)
             {
               uint64_t bytes, h2;
               bool q2;
@@ -510,6 +772,7 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
               // zero-based height
               std::cout << ENDL << "[- batch commit at height " << h-1 << " -]" << ENDL;
               core.get_blockchain_storage().get_db().batch_stop();
+              store_resume_marker(import_file_path, resume_marker, core.get_blockchain_storage().get_db().height(), chunk_end_pos);
               pos = import_file.tellg();
               bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
               import_file.seekg(pos);
@@ -517,6 +780,10 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
               std::cout << ENDL;
               core.get_blockchain_storage().get_db().show_stats();
             }
+            else
+            {
+              store_resume_marker(import_file_path, resume_marker, core.get_blockchain_storage().get_db().height(), chunk_end_pos);
+            }
           }
         }
         ++num_imported;
@@ -535,9 +802,11 @@ quitting:
 
   if (opt_verify)
   {
-    int ret = check_flush(core, blocks, true);
+    int ret = check_flush(core, packages, true);
     if (ret)
       return ret;
+    if (quit <= 1)
+      store_resume_marker(import_file_path, resume_marker, core.get_blockchain_storage().get_db().height(), chunk_end_pos);
   }
 
   if (use_batch)
@@ -550,6 +819,7 @@ quitting:
     else
     {
       core.get_blockchain_storage().get_db().batch_stop();
+      store_resume_marker(import_file_path, resume_marker, core.get_blockchain_storage().get_db().height(), chunk_end_pos);
     }
   }
 
@@ -596,13 +866,19 @@ int main(int argc, char* argv[])
     "Blindly trust the import file and use potentially malicious blocks and transactions during import (only enable if you exported the file yourself)", false};
   const command_line::arg_descriptor<bool> arg_batch  =  {"batch",
     "Batch transactions for faster import", true};
+  const command_line::arg_descriptor<std::string> arg_benchmark_output = {"benchmark-output",
+    "Write a JSON report of replay throughput and per stage timings to this file when done (verified import only)", ""};
   const command_line::arg_descriptor<bool> arg_resume =  {"resume",
     "Resume from current height if output database already exists", true};
+  const command_line::arg_descriptor<std::string> arg_multiexp_backend = {"multiexp-backend",
+    "Where the largest batch verification multiexps are computed: cpu, or threads to split them over the compute threads", "cpu"};
 
   command_line::add_arg(desc_cmd_sett, arg_input_file);
   command_line::add_arg(desc_cmd_sett, arg_log_level);
   command_line::add_arg(desc_cmd_sett, arg_batch_size);
   command_line::add_arg(desc_cmd_sett, arg_block_stop);
+  command_line::add_arg(desc_cmd_sett, arg_benchmark_output);
+  command_line::add_arg(desc_cmd_sett, arg_multiexp_backend);
 
   command_line::add_arg(desc_cmd_only, arg_count_blocks);
   command_line::add_arg(desc_cmd_only, arg_pop_blocks);
@@ -644,6 +920,14 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  std::shared_ptr<rct::multiexp_backend> multiexp_backend;
+  if (!rct::make_multiexp_backend(command_line::get_arg(vm, arg_multiexp_backend), multiexp_backend))
+  {
+    std::cerr << "Error: unknown multiexp backend " << command_line::get_arg(vm, arg_multiexp_backend) << ENDL;
+    return 1;
+  }
+  rct::set_multiexp_backend(multiexp_backend);
+
   if (! opt_batch && !command_line::is_arg_defaulted(vm, arg_batch_size))
   {
     std::cerr << "Error: batch-size set, but batch option not enabled" << ENDL;
@@ -765,7 +1049,17 @@ int main(int argc, char* argv[])
     return 0;
   }
 
+  const auto import_start = std::chrono::steady_clock::now();
+  const uint64_t db_size_start = core.get_blockchain_storage().get_db().get_database_size();
   import_from_file(core, import_file_path, block_stop);
+  const std::string benchmark_output = command_line::get_arg(vm, arg_benchmark_output);
+  if (!benchmark_output.empty())
+  {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - import_start).count();
+    const uint64_t db_size = core.get_blockchain_storage().get_db().get_database_size();
+    if (write_benchmark_report(benchmark_output, seconds, db_size > db_size_start ? db_size - db_size_start : 0))
+      MINFO("Replay report written to " << benchmark_output);
+  }
 
   // ensure db closed
   //   - transactions properly checked and handled
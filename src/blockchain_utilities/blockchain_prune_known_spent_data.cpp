@@ -34,6 +34,7 @@
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_core/blockchain.h"
 #include "blockchain_db/blockchain_db.h"
+#include "common/threadpool.h"
 #include "version.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -43,6 +44,23 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
+#define SCAN_CHUNK_SIZE 100000 // transactions per unit of scan work
+#define SCAN_STATE_SAVE_INTERVAL 30 // seconds between scan state saves
+#define PROGRESS_INTERVAL 10 // seconds between progress reports
+#define PRUNE_BATCH_OUTPUTS 100000 // pruned outputs per committed write batch
+
+static const char scan_state_magic[] = "salvium-known-spent-scan 1";
+
+static std::atomic<bool> stop_requested(false);
+
+// what was found so far by the scan, saved as it goes so an interrupted scan can be resumed
+struct scan_state
+{
+  uint64_t tx_count = 0;
+  std::set<uint64_t> done_chunks;
+  std::map<uint64_t, std::pair<uint64_t, uint64_t>> outputs; // amount -> (outputs, spent outputs)
+};
+
 static std::map<uint64_t, uint64_t> load_outputs(const std::string &filename)
 {
   std::map<uint64_t, uint64_t> outputs;
@@ -95,6 +113,98 @@ static std::map<uint64_t, uint64_t> load_outputs(const std::string &filename)
   return outputs;
 }
 
+static bool load_scan_state(const std::string &filename, scan_state &state)
+{
+  std::ifstream in(filename);
+  if (!in)
+    return false;
+  std::string line;
+  if (!std::getline(in, line) || line != scan_state_magic)
+  {
+    MERROR("Bad format in " << filename);
+    return false;
+  }
+  scan_state loaded;
+  while (std::getline(in, line))
+  {
+    uint64_t a, b, c;
+    if (sscanf(line.c_str(), "txs %" PRIu64, &a) == 1)
+      loaded.tx_count = a;
+    else if (sscanf(line.c_str(), "chunk %" PRIu64, &a) == 1)
+      loaded.done_chunks.insert(a);
+    else if (sscanf(line.c_str(), "@%" PRIu64 " %" PRIu64 " %" PRIu64, &a, &b, &c) == 3)
+      loaded.outputs[a] = std::make_pair(b, c);
+    else if (!line.empty())
+    {
+      MERROR("Bad format in " << filename);
+      return false;
+    }
+  }
+  state = std::move(loaded);
+  return true;
+}
+
+static bool save_scan_state(const std::string &filename, const scan_state &state)
+{
+  // write aside and rename, so an interruption never leaves a truncated state behind
+  const std::string tmp = filename + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    out << scan_state_magic << std::endl;
+    out << "txs " << state.tx_count << std::endl;
+    for (uint64_t chunk: state.done_chunks)
+      out << "chunk " << chunk << std::endl;
+    for (const auto &i: state.outputs)
+      out << "@" << i.first << " " << i.second.first << " " << i.second.second << std::endl;
+    if (!out.flush())
+    {
+      MERROR("Failed to write scan state to " << tmp);
+      return false;
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, filename, ec);
+  if (ec)
+  {
+    MERROR("Failed to rename " << tmp << " to " << filename << ": " << ec.message());
+    return false;
+  }
+  return true;
+}
+
+// counts the outputs created and spent by amount in a range of transactions, walked in storage order
+static bool scan_chunk(const BlockchainDB *db, uint64_t start, uint64_t end, std::map<uint64_t, std::pair<uint64_t, uint64_t>> &outputs, std::atomic<uint64_t> &scanned)
+{
+  return db->for_transactions_range(start, end, [&](uint64_t tx_id, const cryptonote::transaction &tx){
+    const bool miner_tx = tx.vin.size() == 1 && tx.vin[0].type() == typeid(txin_gen);
+    for (const auto &in: tx.vin)
+    {
+      if (in.type() != typeid(txin_to_key))
+        continue;
+      const auto &txin = boost::get<txin_to_key>(in);
+      if (txin.amount == 0)
+        continue;
+
+      outputs[txin.amount].second++;
+    }
+
+    for (const auto &out: tx.vout)
+    {
+      uint64_t amount = out.amount;
+      if (miner_tx && tx.version >= 2)
+        amount = 0;
+      if (amount == 0)
+        continue;
+      if (out.target.type() != typeid(txout_to_key))
+        continue;
+
+      outputs[amount].first++;
+    }
+    ++scanned;
+    return !stop_requested;
+  });
+}
+
 int main(int argc, char* argv[])
 {
   TRY_ENTRY();
@@ -111,6 +221,8 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<bool> arg_verbose  = {"verbose", "Verbose output", false};
   const command_line::arg_descriptor<bool> arg_dry_run  = {"dry-run", "Do not actually prune", false};
   const command_line::arg_descriptor<std::string> arg_input = {"input", "Path to the known spent outputs file"};
+  const command_line::arg_descriptor<std::string> arg_state_file = {"state-file", "Path to the file an interrupted scan is resumed from (default: in the data directory)", ""};
+  const command_line::arg_descriptor<uint64_t> arg_threads = {"threads", "Number of transaction ranges to scan in parallel (0 = all cores)", 0};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -119,6 +231,8 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_verbose);
   command_line::add_arg(desc_cmd_sett, arg_dry_run);
   command_line::add_arg(desc_cmd_sett, arg_input);
+  command_line::add_arg(desc_cmd_sett, arg_state_file);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -158,6 +272,10 @@ int main(int argc, char* argv[])
   bool opt_dry_run = command_line::get_arg(vm, arg_dry_run);
 
   const std::string input = command_line::get_arg(vm, arg_input);
+  std::string state_file = command_line::get_arg(vm, arg_state_file);
+  if (state_file.empty())
+    state_file = (boost::filesystem::path(opt_data_dir) / "prune_known_spent_data.state").string();
+  const uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
 
   LOG_PRINT_L0("Initializing source blockchain (BlockchainDB)");
   std::unique_ptr<BlockchainAndPool> core_storage = std::make_unique<BlockchainAndPool>();
@@ -185,41 +303,111 @@ int main(int argc, char* argv[])
   CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
   LOG_PRINT_L0("Source blockchain storage initialized OK");
 
+  tools::signal_handler::install([](int type) {
+    stop_requested = true;
+  });
+
   std::map<uint64_t, uint64_t> known_spent_outputs;
   if (input.empty())
   {
-    std::map<uint64_t, std::pair<uint64_t, uint64_t>> outputs;
-
-    LOG_PRINT_L0("Scanning for known spent data...");
-    db->for_all_transactions([&](const crypto::hash &txid, const cryptonote::transaction &tx){
-      const bool miner_tx = tx.vin.size() == 1 && tx.vin[0].type() == typeid(txin_gen);
-      for (const auto &in: tx.vin)
+    scan_state state;
+    const uint64_t tx_count = db->get_tx_count();
+    if (load_scan_state(state_file, state))
+    {
+      if (state.tx_count == tx_count)
+        LOG_PRINT_L0("Resuming scan from " << state_file << ", " << state.done_chunks.size() << " ranges already scanned");
+      else
       {
-        if (in.type() != typeid(txin_to_key))
-          continue;
-        const auto &txin = boost::get<txin_to_key>(in);
-        if (txin.amount == 0)
-          continue;
-
-        outputs[txin.amount].second++;
+        LOG_PRINT_L0("The blockchain changed since " << state_file << " was written, scanning again");
+        state = scan_state();
       }
+    }
+    state.tx_count = tx_count;
 
-      for (const auto &out: tx.vout)
-      {
-        uint64_t amount = out.amount;
-        if (miner_tx && tx.version >= 2)
-          amount = 0;
-        if (amount == 0)
-          continue;
-        if (out.target.type() != typeid(txout_to_key))
-          continue;
-
-        outputs[amount].first++;
-      }
-      return true;
-    }, true);
+    std::vector<uint64_t> chunks;
+    uint64_t to_scan = 0;
+    for (uint64_t chunk = 0; chunk * SCAN_CHUNK_SIZE < tx_count; ++chunk)
+    {
+      if (state.done_chunks.find(chunk) != state.done_chunks.end())
+        continue;
+      chunks.push_back(chunk);
+      to_scan += std::min<uint64_t>(SCAN_CHUNK_SIZE, tx_count - chunk * SCAN_CHUNK_SIZE);
+    }
+
+    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+    const size_t threads = std::max<size_t>(1, std::min<size_t>(opt_threads ? opt_threads : tpool.get_max_concurrency(), chunks.size()));
+    LOG_PRINT_L0("Scanning " << to_scan << " transactions for known spent data, using " << threads << " threads...");
+
+    std::atomic<size_t> next_chunk(0);
+    std::atomic<uint64_t> scanned(0);
+    boost::mutex state_mutex;
+    std::string error;
+    const auto scan_start = std::chrono::steady_clock::now();
+    auto last_save = scan_start, last_progress = scan_start;
+    tools::threadpool::waiter waiter(tpool);
+    for (size_t t = 0; t < threads; ++t)
+    {
+      tpool.submit(&waiter, [&]() {
+        // each thread keeps pulling the next range to scan, so slow ranges do not hold the others up
+        for (size_t i = next_chunk++; i < chunks.size() && !stop_requested; i = next_chunk++)
+        {
+          const uint64_t start = chunks[i] * SCAN_CHUNK_SIZE;
+          std::map<uint64_t, std::pair<uint64_t, uint64_t>> outputs;
+          bool completed;
+          try
+          {
+            completed = scan_chunk(db, start, std::min<uint64_t>(tx_count, start + SCAN_CHUNK_SIZE), outputs, scanned);
+          }
+          catch (const std::exception &e)
+          {
+            boost::unique_lock<boost::mutex> lock(state_mutex);
+            error = e.what();
+            stop_requested = true;
+            return;
+          }
+          if (!completed)
+            return;
+
+          boost::unique_lock<boost::mutex> lock(state_mutex);
+          for (const auto &o: outputs)
+          {
+            state.outputs[o.first].first += o.second.first;
+            state.outputs[o.first].second += o.second.second;
+          }
+          state.done_chunks.insert(chunks[i]);
+          const auto now = std::chrono::steady_clock::now();
+          if (now - last_save >= std::chrono::seconds(SCAN_STATE_SAVE_INTERVAL))
+          {
+            save_scan_state(state_file, state);
+            last_save = now;
+          }
+          if (now - last_progress >= std::chrono::seconds(PROGRESS_INTERVAL))
+          {
+            const double elapsed = std::chrono::duration<double>(now - scan_start).count();
+            MINFO("Scanned " << scanned << "/" << to_scan << " transactions, " << (uint64_t)(scanned / elapsed) << " tx/s");
+            last_progress = now;
+          }
+        }
+      }, true);
+    }
+    waiter.wait();
+    save_scan_state(state_file, state);
+    if (!error.empty())
+    {
+      LOG_ERROR("Failed to scan transactions: " << error);
+      core_storage->blockchain.deinit();
+      return 1;
+    }
+    if (stop_requested)
+    {
+      LOG_PRINT_L0("Interrupted, the scan will resume from " << state_file);
+      core_storage->blockchain.deinit();
+      return 1;
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - scan_start).count();
+    LOG_PRINT_L0("Scanned " << scanned << " transactions in " << (uint64_t)elapsed << " seconds");
 
-    for (const auto &i: outputs)
+    for (const auto &i: state.outputs)
     {
       known_spent_outputs[i.first] = i.second.second;
     }
@@ -232,15 +420,14 @@ int main(int argc, char* argv[])
 
   LOG_PRINT_L0("Pruning known spent data...");
 
-  bool stop_requested = false;
-  tools::signal_handler::install([&stop_requested](int type) {
-    stop_requested = true;
-  });
-
+  // amounts are pruned in increasing order, committing every PRUNE_BATCH_OUTPUTS outputs: pruning
+  // an amount which is already pruned does nothing, so an interrupted run can just be started again
   db->batch_start();
 
   size_t num_total_outputs = 0, num_prunable_outputs = 0, num_known_spent_outputs = 0, num_eligible_outputs = 0, num_eligible_known_spent_outputs = 0;
-  for (auto i = known_spent_outputs.begin(); i != known_spent_outputs.end(); ++i)
+  size_t num_batch_outputs = 0, num_amounts_done = 0;
+  const auto prune_start = std::chrono::steady_clock::now();
+  for (auto i = known_spent_outputs.begin(); i != known_spent_outputs.end() && !stop_requested; ++i, ++num_amounts_done)
   {
     uint64_t num_outputs = db->get_num_outputs(i->first);
     num_total_outputs += num_outputs;
@@ -267,6 +454,16 @@ int main(int argc, char* argv[])
     if (!opt_dry_run)
       db->prune_outputs(i->first);
     num_prunable_outputs += i->second;
+
+    num_batch_outputs += num_outputs;
+    if (num_batch_outputs >= PRUNE_BATCH_OUTPUTS)
+    {
+      db->batch_stop();
+      db->batch_start();
+      num_batch_outputs = 0;
+      const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - prune_start).count();
+      MINFO("Pruned " << num_prunable_outputs << " outputs, " << num_amounts_done + 1 << "/" << known_spent_outputs.size() << " amounts, " << (uint64_t)(num_prunable_outputs / std::max(elapsed, 1.0)) << " outputs/s");
+    }
   }
 
   db->batch_stop();
@@ -277,6 +474,19 @@ int main(int argc, char* argv[])
   MINFO("Eligible known spent outputs: " << num_eligible_known_spent_outputs);
   MINFO("Prunable outputs: " << num_prunable_outputs);
 
+  if (stop_requested)
+  {
+    LOG_PRINT_L0("Interrupted, run again to prune the remaining amounts");
+    core_storage->blockchain.deinit();
+    return 1;
+  }
+
+  if (input.empty() && !opt_dry_run)
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove(state_file, ec);
+  }
+
   LOG_PRINT_L0("Blockchain known spent data pruned OK");
   core_storage->blockchain.deinit();
   return 0;
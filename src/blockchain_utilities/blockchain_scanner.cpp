@@ -32,6 +32,7 @@
 #include "common/i18n.h"
 #include "common/password.h"
 #include "common/varint.h"
+#include "common/threadpool.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "cryptonote_core/tx_pool.h"
 #include "cryptonote_core/cryptonote_core.h"
@@ -59,7 +60,255 @@ namespace scanner
   }
 }
 
-static bool stop_requested = false;
+static std::atomic<bool> stop_requested(false);
+
+namespace
+{
+  // magic for the binary output, followed by a uint32 format version and
+  // a uint32 record size, then one scan_record per transaction
+  const char scan_binary_magic[8] = {'S', 'A', 'L', 'S', 'C', 'A', 'N', '\0'};
+  const uint32_t scan_binary_version = 1;
+  const size_t scan_asset_type_size = 8;
+
+  // blocks scanned by one worker at a time; output is kept per shard and
+  // written out in height order
+  const uint64_t scan_shard_size = 1000;
+
+  // fixed width, little endian, so it can be ingested without parsing text
+  #pragma pack(push, 1)
+  struct scan_record
+  {
+    uint64_t height;
+    uint64_t timestamp;
+    crypto::hash tx_hash;
+    uint8_t tx_type;
+    uint8_t tx_version;
+    char source_asset_type[scan_asset_type_size];
+    char destination_asset_type[scan_asset_type_size];
+    uint64_t amount_burnt;
+    uint64_t amount_slippage_limit;
+    uint64_t fee;
+    // from the block's pricing record, zero when it has none for the asset
+    uint64_t source_spot_price;
+    uint64_t source_ma_price;
+    uint64_t destination_spot_price;
+    uint64_t destination_ma_price;
+    uint64_t supply_sal;
+    uint64_t supply_vsd;
+  };
+  #pragma pack(pop)
+
+  struct scan_options
+  {
+    std::string delimiter;
+    std::string stake_mode;
+    bool check_asset_types;
+    bool binary;
+  };
+
+  struct scan_shard
+  {
+    uint64_t start;
+    uint64_t stop;
+    std::string output;
+    std::string error;
+    uint64_t blocks;
+    uint64_t txs;
+  };
+
+  void copy_asset_type(char (&dst)[scan_asset_type_size], const std::string &asset_type)
+  {
+    if (asset_type.size() > scan_asset_type_size)
+      throw std::runtime_error("Aborting: asset type too long for binary output: " + asset_type);
+    memset(dst, 0, sizeof(dst));
+    memcpy(dst, asset_type.data(), asset_type.size());
+  }
+
+  void get_asset_prices(const oracle::pricing_record &pr, const std::string &asset_type, uint64_t &spot, uint64_t &ma)
+  {
+    spot = ma = 0;
+    for (const auto &asset: pr.assets)
+    {
+      if (asset.asset_type == asset_type)
+      {
+        spot = SWAP64LE(asset.spot_price);
+        ma = SWAP64LE(asset.ma_price);
+        return;
+      }
+    }
+  }
+
+  void append_record(std::string &output, uint64_t h, const block &blk, const crypto::hash &tx_id, const transaction &tx)
+  {
+    scan_record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.height = SWAP64LE(h);
+    rec.timestamp = SWAP64LE(blk.timestamp);
+    rec.tx_hash = tx_id;
+    rec.tx_type = (uint8_t)tx.type;
+    rec.tx_version = (uint8_t)tx.version;
+    copy_asset_type(rec.source_asset_type, tx.source_asset_type);
+    copy_asset_type(rec.destination_asset_type, tx.destination_asset_type);
+    rec.amount_burnt = SWAP64LE(tx.amount_burnt);
+    rec.amount_slippage_limit = SWAP64LE(tx.amount_slippage_limit);
+    rec.fee = SWAP64LE(tx.rct_signatures.txnFee);
+    get_asset_prices(blk.pricing_record, tx.source_asset_type, rec.source_spot_price, rec.source_ma_price);
+    get_asset_prices(blk.pricing_record, tx.destination_asset_type, rec.destination_spot_price, rec.destination_ma_price);
+    rec.supply_sal = SWAP64LE(blk.pricing_record.supply.sal);
+    rec.supply_vsd = SWAP64LE(blk.pricing_record.supply.vsd);
+    output.append((const char*)&rec, sizeof(rec));
+  }
+
+  void scan_block(BlockchainDB *db, uint64_t h, const scan_options &opts, scan_shard &shard)
+  {
+    const std::string &delimiter = opts.delimiter;
+    std::ostringstream out;
+
+    cryptonote::blobdata bd = db->get_block_blob_from_height(h);
+    cryptonote::block blk;
+    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+      throw std::runtime_error("Bad block from db at height " + std::to_string(h));
+    struct tm currtm;
+    char timebuf[64];
+    epee::misc_utils::get_gmt_time(blk.timestamp, currtm);
+    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &currtm);
+
+    uint8_t hf_version = blk.major_version;
+
+    // Check TX versions
+    if (blk.miner_tx.version != 2) {
+      out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.miner_tx.hash << "" << delimiter << "invalid miner TX version detected" << delimiter << "version:" << blk.miner_tx.version << std::endl;
+    }
+    if (blk.protocol_tx.version != 2 && h>0) {
+      out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.protocol_tx.hash << "" << delimiter << "invalid protocol TX version detected" << delimiter << "version:" << blk.protocol_tx.version << std::endl;
+    }
+
+    // Get the miner_tx assets
+    std::set<crypto::public_key> used_keys;
+    for (const auto& miner_tx_vout : blk.miner_tx.vout) {
+      std::string asset_type;
+      if (!cryptonote::get_output_asset_type(miner_tx_vout, asset_type)) {
+        throw std::runtime_error("Aborting: failed to get output asset type from miner_tx");
+      } else if (blk.major_version >= HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL1") {
+        throw std::runtime_error("Aborting: invalid output asset type from miner_tx: " + asset_type);
+      } else if (blk.major_version < HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL") {
+        throw std::runtime_error("Aborting: invalid output asset type from miner_tx: " + asset_type + ", HF:" + std::to_string(blk.major_version));
+      }
+      if (miner_tx_vout.amount > 13500000000 && h>0) {
+        out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.miner_tx.hash << "" << delimiter << "invalid miner TX amount detected" << delimiter << "amount:" << miner_tx_vout.amount << std::endl;
+      }
+      crypto::public_key key;
+      cryptonote::get_output_public_key(miner_tx_vout, key);
+      if (used_keys.count(key)) {
+        out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.miner_tx.hash << "" << delimiter << "invalid miner TX - duplicate output detected" << delimiter << "pubkey:" << key << std::endl;
+      }
+      used_keys.insert(key);
+    }
+
+    // Get the protocol_tx assets
+    used_keys.clear();
+    for (const auto& protocol_tx_vout : blk.protocol_tx.vout) {
+      std::string asset_type;
+      if (!cryptonote::get_output_asset_type(protocol_tx_vout, asset_type)) {
+        throw std::runtime_error("Aborting: failed to get output asset type from protocol_tx");
+      } else if (blk.major_version >= HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL1") {
+        throw std::runtime_error("Aborting: invalid output asset type from protocol_tx: " + asset_type);
+      } else if (blk.major_version < HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL") {
+        throw std::runtime_error("Aborting: invalid output asset type from protocol_tx: " + asset_type + ", HF:" + std::to_string(blk.major_version));
+      }
+      crypto::public_key key;
+      cryptonote::get_output_public_key(protocol_tx_vout, key);
+      if (used_keys.count(key)) {
+        out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.protocol_tx.hash << "" << delimiter << "invalid protocol TX - duplicate output detected" << delimiter << "pubkey:" << key << std::endl;
+      }
+      used_keys.insert(key);
+    }
+
+    for (const auto& tx_id : blk.tx_hashes)
+    {
+      if (tx_id == crypto::null_hash)
+      {
+        throw std::runtime_error("Aborting: tx == null_hash");
+      }
+      if (!db->get_pruned_tx_blob(tx_id, bd))
+      {
+        throw std::runtime_error("Aborting: tx not found");
+      }
+      transaction tx;
+      if (!parse_and_validate_tx_base_from_blob(bd, tx))
+      {
+        out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "invalid TX detected" << delimiter << std::endl;
+        continue;
+      }
+      shard.txs++;
+
+      if (opts.binary)
+      {
+        append_record(shard.output, h, blk, tx_id, tx);
+        continue;
+      }
+
+      if (tx.type != cryptonote::transaction_type::TRANSFER &&
+          tx.type != cryptonote::transaction_type::BURN &&
+          tx.type != cryptonote::transaction_type::STAKE &&
+          tx.type != cryptonote::transaction_type::AUDIT) {
+        out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "invalid TX type detected" << delimiter << "type:" << (uint8_t)tx.type << std::endl;
+      }
+
+      if ((tx.version != 2 && hf_version < HF_VERSION_ENABLE_N_OUTS) || (tx.version != 3 && hf_version < HF_VERSION_ENABLE_N_OUTS && tx.type == cryptonote::transaction_type::TRANSFER)) {
+        out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "invalid TX version detected" << delimiter << "version:" << tx.version << std::endl;
+      }
+
+      if (tx.type == cryptonote::transaction_type::STAKE && opts.stake_mode.compare("off")) {
+        if (opts.stake_mode.compare("all") == 0) {
+          out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "STAKE TX detected" << delimiter << "amount:" << (tx.amount_burnt / 100000000) << std::endl;
+        } else if (opts.stake_mode.compare("large") == 0 && tx.amount_burnt > 25000000000000llu) {
+          out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "large STAKE TX detected" << delimiter << "amount:" << (tx.amount_burnt / 100000000) << std::endl;
+        }
+      }
+
+      if (opts.check_asset_types) {
+        if (tx.source_asset_type != "SAL") {
+          throw std::runtime_error("Aborting: invalid source asset type found in tx");
+        } else if (tx.destination_asset_type != "SAL") {
+          if (tx.destination_asset_type == "BURN") {
+            out << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "BURN TX detected" << delimiter << "amount:" << tx.amount_burnt << std::endl;
+          } else {
+            throw std::runtime_error("Aborting: invalid destination asset type found in tx");
+          }
+        }
+
+        for (const auto& tx_vout : tx.vout) {
+          std::string asset_type;
+          if (!cryptonote::get_output_asset_type(tx_vout, asset_type)) {
+            throw std::runtime_error("Aborting: failed to get output asset type from tx");
+          } else if (asset_type != "SAL") {
+            throw std::runtime_error("Aborting: invalid output asset type from tx");
+          }
+        }
+      }
+    }
+
+    // in binary mode, the checks above still run but only records are written
+    if (!opts.binary)
+      shard.output += out.str();
+    shard.blocks++;
+  }
+
+  void scan_range(BlockchainDB *db, const scan_options &opts, scan_shard &shard)
+  {
+    try
+    {
+      for (uint64_t h = shard.start; h < shard.stop; ++h)
+        scan_block(db, h, opts, shard);
+    }
+    catch (const std::exception &e)
+    {
+      shard.error = e.what();
+    }
+  }
+}
+
 
 int main(int argc, char* argv[])
 {
@@ -83,6 +332,9 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<std::string> arg_delimiter  = {"delimiter", "\"<string>\"", DELIM};
   const command_line::arg_descriptor<std::string> arg_stake_mode  = {"stake", "\"<string>\"", DEF_STAKE_MODE};
   const command_line::arg_descriptor<bool> arg_check_asset_types  = {"check-asset-types", "Scan for asset-type issues", false};
+  const command_line::arg_descriptor<std::string> arg_output_file  = {"output-file", "Write output to this file instead of stdout", ""};
+  const command_line::arg_descriptor<bool> arg_binary  = {"binary", "Write fixed width binary records, one per transaction, instead of text", false};
+  const command_line::arg_descriptor<uint64_t> arg_threads  = {"threads", "Number of block ranges to scan in parallel (0 = all cores)", 0};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -93,6 +345,9 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_delimiter);
   command_line::add_arg(desc_cmd_sett, arg_stake_mode);
   command_line::add_arg(desc_cmd_sett, arg_check_asset_types);
+  command_line::add_arg(desc_cmd_sett, arg_output_file);
+  command_line::add_arg(desc_cmd_sett, arg_binary);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -130,9 +385,13 @@ int main(int argc, char* argv[])
   network_type net_type = opt_testnet ? TESTNET : opt_stagenet ? STAGENET : MAINNET;
   block_start = command_line::get_arg(vm, arg_block_start);
   block_stop = command_line::get_arg(vm, arg_block_stop);
-  std::string delimiter = command_line::get_arg(vm, arg_delimiter);
-  std::string stake_mode = command_line::get_arg(vm, arg_stake_mode);
-  bool opt_check_asset_types = command_line::get_arg(vm, arg_check_asset_types);
+  scan_options opts;
+  opts.delimiter = command_line::get_arg(vm, arg_delimiter);
+  opts.stake_mode = command_line::get_arg(vm, arg_stake_mode);
+  opts.check_asset_types = command_line::get_arg(vm, arg_check_asset_types);
+  opts.binary = command_line::get_arg(vm, arg_binary);
+  std::string opt_output_file = command_line::get_arg(vm, arg_output_file);
+  uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
 
   // If we wanted to use the memory pool, we would set up a fake_core.
 
@@ -205,180 +464,67 @@ set y2tics nomirror
 plot 'stats.csv' index "DATA" using (timecolumn(1,"%Y-%m-%d")):4 with lines, '' using (timecolumn(1,"%Y-%m-%d")):7 axes x1y2 with lines
  */
 
-  // spit out a comment that GnuPlot can use as an index
-  std::cout << ENDL << "# DATA" << ENDL;
-  std::cout << "Date" << delimiter << "Height" << delimiter << "Transaction ID" << delimiter << "Reason" << delimiter << "Extra Information";
-  std::cout << ENDL;
-
-#define MAX_INOUT	0xffffffff
-#define MAX_RINGS	0xffffffff
-
-  struct tm prevtm = {0}, currtm;
-  uint64_t prevsz = 0, currsz = 0;
-  uint64_t prevtxs = 0, currtxs = 0;
-  uint64_t currblks = 0;
-  uint32_t txhr[24] = {0};
-  unsigned int i;
-
-  const std::map<uint8_t, std::pair<uint64_t, std::pair<std::string, std::string>>> audit_hard_forks = get_config(net_type).AUDIT_HARD_FORKS;
-  
-  for (uint64_t h = block_start; h < block_stop; ++h)
+  std::ostream *output = &std::cout;
+  std::ofstream output_file;
+  if (!opt_output_file.empty())
   {
-    cryptonote::blobdata bd = db->get_block_blob_from_height(h);
-    cryptonote::block blk;
-    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+    output_file.open(opt_output_file, std::ios_base::binary | std::ios_base::out | std::ios::trunc);
+    if (output_file.fail())
     {
-      LOG_PRINT_L0("Bad block from db");
+      LOG_PRINT_L0("Failed to open output file " << opt_output_file);
       return 1;
     }
-    time_t tt = blk.timestamp;
-    char timebuf[64];
-    epee::misc_utils::get_gmt_time(tt, currtm);
-    if (!prevtm.tm_year)
-      prevtm = currtm;
-    // catch change of day
-    if (currtm.tm_mday > prevtm.tm_mday || (currtm.tm_mday == 1 && prevtm.tm_mday > 27))
-    {
-      // check for timestamp fudging around month ends
-      if (prevtm.tm_mday == 1 && currtm.tm_mday > 27)
-        goto skip;
-      strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &currtm);
-      prevtm = currtm;
-    }
-skip:
-    currsz += bd.size();
-    uint64_t coinbase_amount;
-    uint64_t tx_fee_amount = 0;
-    std::set<std::string> used_assets, miner_tx_assets, protocol_tx_assets;
-    std::map<size_t, std::vector<std::string>> used_tx_versions;
-    used_assets.insert("SAL");
+    output = &output_file;
+  }
 
-    uint8_t hf_version = blk.major_version;
-    
-    // Check TX versions
-    if (blk.miner_tx.version != 2) {
-      std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.miner_tx.hash << "" << delimiter << "invalid miner TX version detected" << delimiter << "version:" << blk.miner_tx.version << std::endl;
-    }
-    if (blk.protocol_tx.version != 2 && h>0) {
-      std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.protocol_tx.hash << "" << delimiter << "invalid protocol TX version detected" << delimiter << "version:" << blk.protocol_tx.version << std::endl;
-    }
-    
-    // Get the miner_tx assets
-    std::set<crypto::public_key> used_keys;
-    for (const auto& miner_tx_vout : blk.miner_tx.vout) {
-      std::string asset_type;
-      if (!cryptonote::get_output_asset_type(miner_tx_vout, asset_type)) {
-        throw std::runtime_error("Aborting: failed to get output asset type from miner_tx");
-      } else if (blk.major_version >= HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL1") {
-        throw std::runtime_error("Aborting: invalid output asset type from miner_tx: " + asset_type);
-      } else if (blk.major_version < HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL") {
-        throw std::runtime_error("Aborting: invalid output asset type from miner_tx: " + asset_type + ", HF:" + std::to_string(blk.major_version));
-      }
-      miner_tx_assets.insert(asset_type);
-      if (miner_tx_vout.amount > 13500000000 && h>0) {
-        std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.miner_tx.hash << "" << delimiter << "invalid miner TX amount detected" << delimiter << "amount:" << miner_tx_vout.amount << std::endl;
-      }
-      crypto::public_key key;
-      cryptonote::get_output_public_key(miner_tx_vout, key);
-      if (used_keys.count(key)) {
-        std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.miner_tx.hash << "" << delimiter << "invalid miner TX - duplicate output detected" << delimiter << "pubkey:" << key << std::endl;
-      }
-      used_keys.insert(key);
-    }
+  if (opts.binary)
+  {
+    const uint32_t version = SWAP32LE(scan_binary_version);
+    const uint32_t record_size = SWAP32LE((uint32_t)sizeof(scan_record));
+    output->write(scan_binary_magic, sizeof(scan_binary_magic));
+    output->write((const char*)&version, sizeof(version));
+    output->write((const char*)&record_size, sizeof(record_size));
+  }
+  else
+  {
+    // spit out a comment that GnuPlot can use as an index
+    *output << ENDL << "# DATA" << ENDL;
+    *output << "Date" << opts.delimiter << "Height" << opts.delimiter << "Transaction ID" << opts.delimiter << "Reason" << opts.delimiter << "Extra Information";
+    *output << ENDL;
+  }
 
-    // Get the protocol_tx assets
-    used_keys.clear();
-    for (const auto& protocol_tx_vout : blk.protocol_tx.vout) {
-      std::string asset_type;
-      if (!cryptonote::get_output_asset_type(protocol_tx_vout, asset_type)) {
-        throw std::runtime_error("Aborting: failed to get output asset type from protocol_tx");
-      } else if (blk.major_version >= HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL1") {
-        throw std::runtime_error("Aborting: invalid output asset type from protocol_tx: " + asset_type);
-      } else if (blk.major_version < HF_VERSION_SALVIUM_ONE_PROOFS && asset_type != "SAL") {
-        throw std::runtime_error("Aborting: invalid output asset type from protocol_tx: " + asset_type + ", HF:" + std::to_string(blk.major_version));
-      }
-      protocol_tx_assets.insert(asset_type);
-      if (protocol_tx_vout.amount > 25000000000000) {
-        //std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.protocol_tx.hash << "" << delimiter << "large protocol TX amount detected from height " << (h-audit_lock_period) << delimiter << "amount:" << protocol_tx_vout.amount << std::endl;
-      }
-      crypto::public_key key;
-      cryptonote::get_output_public_key(protocol_tx_vout, key);
-      if (used_keys.count(key)) {
-        std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << blk.protocol_tx.hash << "" << delimiter << "invalid protocol TX - duplicate output detected" << delimiter << "pubkey:" << key << std::endl;
-      }
-      used_keys.insert(key);
+  // shard the range over the compute threads; each shard reads through the
+  // db's per thread read txn, and shards are written out in height order
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  size_t threads = opt_threads ? opt_threads : tpool.get_max_concurrency();
+  threads = std::max<size_t>(1, threads);
+  uint64_t blocks = 0, txs = 0;
+  for (uint64_t h = block_start; h < block_stop && !stop_requested; )
+  {
+    std::vector<scan_shard> shards;
+    for (size_t i = 0; i < threads && h < block_stop; ++i, h += scan_shard_size)
+      shards.push_back({h, std::min(block_stop, h + scan_shard_size), std::string(), std::string(), 0, 0});
+
+    tools::threadpool::waiter waiter(tpool);
+    for (scan_shard &shard: shards)
+      tpool.submit(&waiter, [db, &opts, &shard]() { scan_range(db, opts, shard); }, true);
+    if (!waiter.wait())
+    {
+      LOG_PRINT_L0("Failed to scan blocks");
+      return 1;
     }
 
-    for (const auto& tx_id : blk.tx_hashes)
+    for (const scan_shard &shard: shards)
     {
-      if (tx_id == crypto::null_hash)
-      {
-        throw std::runtime_error("Aborting: tx == null_hash");
-      }
-      if (!db->get_pruned_tx_blob(tx_id, bd))
-      {
-        throw std::runtime_error("Aborting: tx not found");
-      }
-      transaction tx;
-      if (!parse_and_validate_tx_base_from_blob(bd, tx))
-      {
-        std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "invalid TX detected" << delimiter << std::endl;
-        continue;
-      }
-      currsz += bd.size();
-      if (db->get_prunable_tx_blob(tx_id, bd))
-        currsz += bd.size();
-      currtxs++;
-
-      if (tx.type != cryptonote::transaction_type::TRANSFER &&
-          tx.type != cryptonote::transaction_type::BURN &&
-          tx.type != cryptonote::transaction_type::STAKE &&
-          tx.type != cryptonote::transaction_type::AUDIT) {
-        std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "invalid TX type detected" << delimiter << "type:" << (uint8_t)tx.type << std::endl;
-      }
-      
-      if ((tx.version != 2 && hf_version < HF_VERSION_ENABLE_N_OUTS) || (tx.version != 3 && hf_version < HF_VERSION_ENABLE_N_OUTS && tx.type == cryptonote::transaction_type::TRANSFER)) {
-        std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "invalid TX version detected" << delimiter << "version:" << tx.version << std::endl;
-      }
-    
-      if (tx.type == cryptonote::transaction_type::STAKE && stake_mode.compare("off")) {
-        if (stake_mode.compare("all") == 0) {
-          std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "STAKE TX detected" << delimiter << "amount:" << (tx.amount_burnt / 100000000) << std::endl;
-        } else if (stake_mode.compare("large") == 0 && tx.amount_burnt > 25000000000000llu) {
-          std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "large STAKE TX detected" << delimiter << "amount:" << (tx.amount_burnt / 100000000) << std::endl;
-        }
-      }
-
-      if (opt_check_asset_types) {
-        if (tx.source_asset_type != "SAL") {
-          throw std::runtime_error("Aborting: invalid source asset type found in tx");
-        } else if (tx.destination_asset_type != "SAL") {
-          if (tx.destination_asset_type == "BURN") {
-            std::cout << timebuf << "" << delimiter << "" << h << "" << delimiter << "" << tx_id << "" << delimiter << "BURN TX detected" << delimiter << "amount:" << tx.amount_burnt << std::endl;
-          } else {
-            throw std::runtime_error("Aborting: invalid destination asset type found in tx");
-          }
-        }
-
-        for (const auto& tx_vout : tx.vout) {
-          std::string asset_type;
-          if (!cryptonote::get_output_asset_type(tx_vout, asset_type)) {
-            throw std::runtime_error("Aborting: failed to get output asset type from tx");
-          } else if (asset_type != "SAL") {
-            throw std::runtime_error("Aborting: invalid output asset type from tx");
-          }
-        }
-            
-        // Add the source currency to the list of expected ones
-        used_assets.insert(tx.source_asset_type);
-      }
+      output->write(shard.output.data(), shard.output.size());
+      blocks += shard.blocks;
+      txs += shard.txs;
+      if (!shard.error.empty())
+        throw std::runtime_error(shard.error);
     }
-    
-    currblks++;
-
-    if (stop_requested)
-      break;
+    output->flush();
   }
+  MINFO("Scanned " << blocks << " blocks, " << txs << " transactions");
 
   return 0;
 
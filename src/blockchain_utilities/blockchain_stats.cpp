@@ -26,13 +26,21 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include "common/command_line.h"
+#include "common/threadpool.h"
 #include "common/varint.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "blockchain_db/blockchain_db.h"
+#include "file_io_utils.h"
+#include "serialization/binary_utils.h"
+#include "serialization/containers.h"
+#include "serialization/crypto.h"
+#include "serialization/difficulty_type.h"
+#include "serialization/string.h"
 #include "time_helper.h"
 #include "version.h"
 
@@ -43,77 +51,277 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
-static bool stop_requested = false;
-
-static bool do_inputs, do_outputs, do_ringsize, do_hours, do_emission, do_fees, do_diff;
-
-static struct tm prevtm, currtm;
-static uint64_t prevsz, currsz;
-static uint64_t prevtxs, currtxs;
-static uint64_t currblks;
-static uint64_t h;
-static uint64_t totins, totouts, totrings;
-static boost::multiprecision::uint128_t prevemission, prevfees;
-static boost::multiprecision::uint128_t emission, fees;
-static boost::multiprecision::uint128_t totdiff, mindiff, maxdiff;
+static std::atomic<bool> stop_requested(false);
 
 #define MAX_INOUT	0xffffffff
 #define MAX_RINGS	0xffffffff
 
-static uint32_t minins = MAX_INOUT, maxins;
-static uint32_t minouts = MAX_INOUT, maxouts;
-static uint32_t minrings = MAX_RINGS, maxrings;
-static uint32_t io, tottxs;
-static uint32_t txhr[24];
-
-static void doprint()
+namespace
 {
-  char timebuf[64];
-
-  strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &prevtm);
-  prevtm = currtm;
-  std::cout << timebuf << "\t" << currblks << "\t" << h << "\t" << currtxs << "\t" << prevtxs + currtxs << "\t" << currsz << "\t" << prevsz + currsz;
-  prevsz += currsz;
-  currsz = 0;
-  prevtxs += currtxs;
-  currtxs = 0;
-  if (!tottxs)
-    tottxs = 1;
-  if (do_emission) {
-    std::cout << "\t" << print_money(emission) << "\t" << print_money(prevemission + emission);
-    prevemission += emission;
-    emission = 0;
+  // blocks aggregated by one worker at a time; each shard yields the days it
+  // touched, which are merged in height order
+  const uint64_t stats_shard_size = 1000;
+
+  const uint32_t stats_state_version = 1;
+
+  struct stats_options
+  {
+    bool do_inputs, do_outputs, do_ringsize, do_hours, do_emission, do_fees, do_diff;
+
+    uint32_t mask() const
+    {
+      return do_inputs | do_outputs << 1 | do_ringsize << 2 | do_hours << 3 | do_emission << 4 | do_fees << 5 | do_diff << 6;
+    }
+  };
+
+  // the stats for one day; partial days from adjacent shards merge into one
+  struct day_stats
+  {
+    std::string date;
+    uint64_t blocks = 0;
+    uint64_t end_height = 0;
+    uint64_t txs = 0;
+    uint64_t bytes = 0;
+    difficulty_type emission = 0, fees = 0;
+    difficulty_type mindiff = 0, maxdiff = 0, totdiff = 0;
+    uint32_t minins = MAX_INOUT, maxins = 0;
+    uint32_t minouts = MAX_INOUT, maxouts = 0;
+    uint32_t minrings = MAX_RINGS, maxrings = 0;
+    uint64_t totins = 0, totouts = 0, totrings = 0;
+    std::vector<uint32_t> hours = std::vector<uint32_t>(24, 0);
+
+    void merge(const day_stats &other)
+    {
+      blocks += other.blocks;
+      end_height = std::max(end_height, other.end_height);
+      txs += other.txs;
+      bytes += other.bytes;
+      emission += other.emission;
+      fees += other.fees;
+      if (other.maxdiff && (!maxdiff || other.mindiff < mindiff))
+        mindiff = other.mindiff;
+      maxdiff = std::max(maxdiff, other.maxdiff);
+      totdiff += other.totdiff;
+      minins = std::min(minins, other.minins);
+      maxins = std::max(maxins, other.maxins);
+      minouts = std::min(minouts, other.minouts);
+      maxouts = std::max(maxouts, other.maxouts);
+      minrings = std::min(minrings, other.minrings);
+      maxrings = std::max(maxrings, other.maxrings);
+      totins += other.totins;
+      totouts += other.totouts;
+      totrings += other.totrings;
+      for (size_t i = 0; i < hours.size() && i < other.hours.size(); ++i)
+        hours[i] += other.hours[i];
+    }
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(date)
+      VARINT_FIELD(blocks)
+      VARINT_FIELD(end_height)
+      VARINT_FIELD(txs)
+      VARINT_FIELD(bytes)
+      FIELD(emission)
+      FIELD(fees)
+      FIELD(mindiff)
+      FIELD(maxdiff)
+      FIELD(totdiff)
+      VARINT_FIELD(minins)
+      VARINT_FIELD(maxins)
+      VARINT_FIELD(minouts)
+      VARINT_FIELD(maxouts)
+      VARINT_FIELD(minrings)
+      VARINT_FIELD(maxrings)
+      VARINT_FIELD(totins)
+      VARINT_FIELD(totouts)
+      VARINT_FIELD(totrings)
+      FIELD(hours)
+      if (hours.size() != 24)
+        return false;
+    END_SERIALIZE()
+  };
+
+  // what a run leaves behind for the next one: the running totals of every
+  // day already printed, and the last day, which may still get more blocks
+  struct stats_state
+  {
+    uint32_t version = stats_state_version;
+    uint32_t options = 0;
+    uint64_t next_height = 0;
+    crypto::hash top_hash = crypto::null_hash;
+    uint64_t prevsz = 0;
+    uint64_t prevtxs = 0;
+    difficulty_type prevemission = 0, prevfees = 0;
+    std::vector<day_stats> open_day;
+
+    BEGIN_SERIALIZE_OBJECT()
+      VARINT_FIELD(version)
+      if (version != stats_state_version)
+        return false;
+      VARINT_FIELD(options)
+      VARINT_FIELD(next_height)
+      FIELD(top_hash)
+      VARINT_FIELD(prevsz)
+      VARINT_FIELD(prevtxs)
+      FIELD(prevemission)
+      FIELD(prevfees)
+      FIELD(open_day)
+      if (open_day.size() > 1)
+        return false;
+    END_SERIALIZE()
+  };
+
+  struct stats_shard
+  {
+    uint64_t start;
+    uint64_t stop;
+    std::vector<day_stats> days;
+    std::string error;
+  };
+
+  void update_min_max(uint32_t io, uint32_t &min, uint32_t &max, uint64_t &tot)
+  {
+    if (io < min)
+      min = io;
+    if (io > max)
+      max = io;
+    tot += io;
   }
-  if (do_fees) {
-    std::cout << "\t" << print_money(fees) << "\t" << print_money(prevfees + fees);
-    prevfees += fees;
-    fees = 0;
+
+  void stats_block(BlockchainDB *db, uint64_t h, const stats_options &opts, stats_shard &shard)
+  {
+    cryptonote::blobdata bd = db->get_block_blob_from_height(h);
+    cryptonote::block blk;
+    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+      throw std::runtime_error("Bad block from db");
+    time_t tt = blk.timestamp;
+    struct tm currtm;
+    epee::misc_utils::get_gmt_time(tt, currtm);
+    char timebuf[64];
+    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &currtm);
+
+    // a block only opens a new day when it is dated after the current one,
+    // so timestamps fudged backwards across midnight stay in the current day
+    if (shard.days.empty() || timebuf > shard.days.back().date)
+    {
+      shard.days.push_back(day_stats());
+      shard.days.back().date = timebuf;
+    }
+    day_stats &day = shard.days.back();
+
+    day.bytes += bd.size();
+    uint64_t tx_fee_amount = 0;
+    for (const auto& tx_id : blk.tx_hashes)
+    {
+      if (tx_id == crypto::null_hash)
+        throw std::runtime_error("Aborting: tx == null_hash");
+      if (!db->get_pruned_tx_blob(tx_id, bd))
+        throw std::runtime_error("Aborting: tx not found");
+      transaction tx;
+      if (!parse_and_validate_tx_base_from_blob(bd, tx))
+        throw std::runtime_error("Bad txn from db");
+      day.bytes += bd.size();
+      if (db->get_prunable_tx_blob(tx_id, bd))
+        day.bytes += bd.size();
+      day.txs++;
+      if (opts.do_fees || opts.do_emission)
+        tx_fee_amount += get_tx_fee(tx);
+      if (opts.do_hours)
+        day.hours[currtm.tm_hour]++;
+      if (opts.do_inputs)
+        update_min_max(tx.vin.size(), day.minins, day.maxins, day.totins);
+      if (opts.do_ringsize)
+      {
+        const cryptonote::txin_to_key& tx_in_to_key
+                       = boost::get<cryptonote::txin_to_key>(tx.vin[0]);
+        update_min_max(tx_in_to_key.key_offsets.size(), day.minrings, day.maxrings, day.totrings);
+      }
+      if (opts.do_outputs)
+        update_min_max(tx.vout.size(), day.minouts, day.maxouts, day.totouts);
+    }
+    if (opts.do_diff)
+    {
+      difficulty_type diff = db->get_block_difficulty(h);
+      if (!day.mindiff || diff < day.mindiff)
+        day.mindiff = diff;
+      if (diff > day.maxdiff)
+        day.maxdiff = diff;
+      day.totdiff += diff;
+    }
+    if (opts.do_emission)
+      day.emission += get_outs_money_amount(blk.miner_tx) - tx_fee_amount;
+    if (opts.do_fees)
+      day.fees += tx_fee_amount;
+    day.blocks++;
+    day.end_height = h + 1;
   }
-  if (do_diff) {
-    std::cout << "\t" << (maxdiff ? mindiff : 0) << "\t" << maxdiff << "\t" << totdiff / currblks;
-    mindiff = 0; maxdiff = 0; totdiff = 0;
+
+  void stats_range(BlockchainDB *db, const stats_options &opts, stats_shard &shard)
+  {
+    try
+    {
+      for (uint64_t h = shard.start; h < shard.stop; ++h)
+        stats_block(db, h, opts, shard);
+    }
+    catch (const std::exception &e)
+    {
+      shard.error = e.what();
+    }
   }
-  if (do_inputs) {
-    std::cout << "\t" << (maxins ? minins : 0) << "\t" << maxins << "\t" << totins * 1.0 / tottxs;
-    minins = MAX_INOUT; maxins = 0; totins = 0;
+
+  void print_day(const day_stats &day, const stats_state &state, const stats_options &opts)
+  {
+    const uint64_t txs = std::max<uint64_t>(day.txs, 1);
+    std::cout << day.date << "\t" << day.blocks << "\t" << day.end_height << "\t" << day.txs << "\t" << state.prevtxs + day.txs << "\t" << day.bytes << "\t" << state.prevsz + day.bytes;
+    if (opts.do_emission)
+      std::cout << "\t" << print_money(day.emission) << "\t" << print_money(state.prevemission + day.emission);
+    if (opts.do_fees)
+      std::cout << "\t" << print_money(day.fees) << "\t" << print_money(state.prevfees + day.fees);
+    if (opts.do_diff)
+      std::cout << "\t" << (day.maxdiff ? day.mindiff : 0) << "\t" << day.maxdiff << "\t" << day.totdiff / std::max<uint64_t>(day.blocks, 1);
+    if (opts.do_inputs)
+      std::cout << "\t" << (day.maxins ? day.minins : 0) << "\t" << day.maxins << "\t" << day.totins * 1.0 / txs;
+    if (opts.do_outputs)
+      std::cout << "\t" << (day.maxouts ? day.minouts : 0) << "\t" << day.maxouts << "\t" << day.totouts * 1.0 / txs;
+    if (opts.do_ringsize)
+      std::cout << "\t" << (day.maxrings ? day.minrings : 0) << "\t" << day.maxrings << "\t" << day.totrings * 1.0 / txs;
+    if (opts.do_hours)
+      for (int i=0; i<24; i++)
+        std::cout << "\t" << day.hours[i];
+    std::cout << ENDL;
   }
-  if (do_outputs) {
-    std::cout << "\t" << (maxouts ? minouts : 0) << "\t" << maxouts << "\t" << totouts * 1.0 / tottxs;
-    minouts = MAX_INOUT; maxouts = 0; totouts = 0;
+
+  // folds a finished day into the running totals
+  void close_day(const day_stats &day, stats_state &state, const stats_options &opts)
+  {
+    print_day(day, state, opts);
+    state.prevsz += day.bytes;
+    state.prevtxs += day.txs;
+    state.prevemission += day.emission;
+    state.prevfees += day.fees;
   }
-  if (do_ringsize) {
-    std::cout << "\t" << (maxrings ? minrings : 0) << "\t" << maxrings << "\t" << totrings * 1.0 / tottxs;
-    minrings = MAX_RINGS; maxrings = 0; totrings = 0;
+
+  bool load_state(const std::string &path, stats_state &state)
+  {
+    std::string blob;
+    if (!epee::file_io_utils::load_file_to_string(path, blob))
+      return false;
+    return ::serialization::parse_binary(blob, state);
   }
-  if (do_hours) {
-    for (int i=0; i<24; i++) {
-      std::cout << "\t" << txhr[i];
-      txhr[i] = 0;
-    }
+
+  bool save_state(const std::string &path, stats_state &state)
+  {
+    std::string blob;
+    if (!::serialization::dump_binary(state, blob))
+      return false;
+    // write aside and rename, so an interrupted save leaves the old state
+    const std::string tmp = path + ".tmp";
+    if (!epee::file_io_utils::save_string_to_file(tmp, blob))
+      return false;
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp, path, ec);
+    return !ec;
   }
-  currblks = 0;
-  tottxs = 0;
-  std::cout << ENDL;
 }
 
 int main(int argc, char* argv[])
@@ -142,6 +350,8 @@ int main(int argc, char* argv[])
   const command_line::arg_descriptor<bool> arg_emission  = {"with-emission", "with coin emission", false};
   const command_line::arg_descriptor<bool> arg_fees  = {"with-fees", "with txn fees", false};
   const command_line::arg_descriptor<bool> arg_diff  = {"with-diff", "with difficulty", false};
+  const command_line::arg_descriptor<uint64_t> arg_threads  = {"threads", "Number of block ranges to process in parallel (0 = all cores)", 0};
+  const command_line::arg_descriptor<std::string> arg_state_file  = {"state-file", "Resume from, and save progress to, this file", ""};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
@@ -156,6 +366,8 @@ int main(int argc, char* argv[])
   command_line::add_arg(desc_cmd_sett, arg_emission);
   command_line::add_arg(desc_cmd_sett, arg_fees);
   command_line::add_arg(desc_cmd_sett, arg_diff);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
+  command_line::add_arg(desc_cmd_sett, arg_state_file);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
   po::options_description desc_options("Allowed options");
@@ -193,13 +405,34 @@ int main(int argc, char* argv[])
   network_type net_type = opt_testnet ? TESTNET : opt_stagenet ? STAGENET : MAINNET;
   block_start = command_line::get_arg(vm, arg_block_start);
   block_stop = command_line::get_arg(vm, arg_block_stop);
-  do_inputs = command_line::get_arg(vm, arg_inputs);
-  do_outputs = command_line::get_arg(vm, arg_outputs);
-  do_ringsize = command_line::get_arg(vm, arg_ringsize);
-  do_hours = command_line::get_arg(vm, arg_hours);
-  do_emission = command_line::get_arg(vm, arg_emission);
-  do_fees = command_line::get_arg(vm, arg_fees);
-  do_diff = command_line::get_arg(vm, arg_diff);
+  stats_options opts;
+  opts.do_inputs = command_line::get_arg(vm, arg_inputs);
+  opts.do_outputs = command_line::get_arg(vm, arg_outputs);
+  opts.do_ringsize = command_line::get_arg(vm, arg_ringsize);
+  opts.do_hours = command_line::get_arg(vm, arg_hours);
+  opts.do_emission = command_line::get_arg(vm, arg_emission);
+  opts.do_fees = command_line::get_arg(vm, arg_fees);
+  opts.do_diff = command_line::get_arg(vm, arg_diff);
+  uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
+  std::string opt_state_file = command_line::get_arg(vm, arg_state_file);
+
+  stats_state state;
+  state.options = opts.mask();
+  bool resumed = false;
+  if (!opt_state_file.empty() && boost::filesystem::exists(opt_state_file))
+  {
+    if (!load_state(opt_state_file, state))
+    {
+      LOG_PRINT_L0("Failed to load state from " << opt_state_file);
+      return 1;
+    }
+    if (state.options != opts.mask())
+    {
+      LOG_PRINT_L0("State file " << opt_state_file << " was written with different --with-* options");
+      return 1;
+    }
+    resumed = true;
+  }
 
   LOG_PRINT_L0("Initializing source blockchain (BlockchainDB)");
   std::unique_ptr<BlockchainAndPool> core_storage = std::make_unique<BlockchainAndPool>();
@@ -235,6 +468,21 @@ int main(int argc, char* argv[])
   const uint64_t db_height = db->height();
   if (!block_stop)
       block_stop = db_height;
+  if (resumed)
+  {
+    // the state is only good for the chain it was taken from
+    if (state.next_height > db_height || (state.next_height && db->get_block_hash_from_height(state.next_height - 1) != state.top_hash))
+    {
+      LOG_PRINT_L0("State file " << opt_state_file << " does not match this blockchain, delete it to start over");
+      return 1;
+    }
+    block_start = state.next_height;
+    MINFO("Resuming from state file " << opt_state_file);
+  }
+  else
+  {
+    state.next_height = block_start;
+  }
   MINFO("Starting from height " << block_start << ", stopping at height " << block_stop);
 
 /*
@@ -256,21 +504,21 @@ plot 'stats.csv' index "DATA" using (timecolumn(1,"%Y-%m-%d")):4 with lines, ''
   // spit out a comment that GnuPlot can use as an index
   std::cout << ENDL << "# DATA" << ENDL;
   std::cout << "Date\tBlocks/day\tBlocks\tTxs/Day\tTxs\tBytes/Day\tBytes";
-  if (do_emission)
+  if (opts.do_emission)
     std::cout << "\tEmission/day\tEmission";
-  if (do_fees)
+  if (opts.do_fees)
     std::cout << "\tFees/day\tFees";
-  if (do_diff)
+  if (opts.do_diff)
     std::cout << "\tDiffMin\tDiffMax\tDiffAvg";
-  if (do_inputs)
+  if (opts.do_inputs)
     std::cout << "\tInMin\tInMax\tInAvg";
-  if (do_outputs)
+  if (opts.do_outputs)
     std::cout << "\tOutMin\tOutMax\tOutAvg";
-  if (do_ringsize)
+  if (opts.do_ringsize)
     std::cout << "\tRingMin\tRingMax\tRingAvg";
-  if (do_inputs || do_outputs || do_ringsize)
+  if (opts.do_inputs || opts.do_outputs || opts.do_ringsize)
     std::cout << std::setprecision(2) << std::fixed;
-  if (do_hours) {
+  if (opts.do_hours) {
     char buf[8];
     unsigned int i;
     for (i=0; i<24; i++) {
@@ -280,104 +528,63 @@ plot 'stats.csv' index "DATA" using (timecolumn(1,"%Y-%m-%d")):4 with lines, ''
   }
   std::cout << ENDL;
 
-  for (h = block_start; h < block_stop; ++h)
+  // shard the range over the compute threads; each shard reads through the
+  // db's per thread read txn, and its days are merged in height order. The
+  // last day stays open, since the next shard (or run) may add to it
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  size_t threads = opt_threads ? opt_threads : tpool.get_max_concurrency();
+  threads = std::max<size_t>(1, threads);
+  for (uint64_t h = block_start; h < block_stop && !stop_requested; )
   {
-    cryptonote::blobdata bd = db->get_block_blob_from_height(h);
-    cryptonote::block blk;
-    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+    std::vector<stats_shard> shards;
+    for (size_t i = 0; i < threads && h < block_stop; ++i, h += stats_shard_size)
+      shards.push_back({h, std::min(block_stop, h + stats_shard_size), {}, std::string()});
+
+    tools::threadpool::waiter waiter(tpool);
+    for (stats_shard &shard: shards)
+      tpool.submit(&waiter, [db, &opts, &shard]() { stats_range(db, opts, shard); }, true);
+    if (!waiter.wait())
     {
-      LOG_PRINT_L0("Bad block from db");
+      LOG_PRINT_L0("Failed to process blocks");
       return 1;
     }
-    time_t tt = blk.timestamp;
-    epee::misc_utils::get_gmt_time(tt, currtm);
-    if (!prevtm.tm_year)
-      prevtm = currtm;
-    // catch change of day
-    if (currtm.tm_mday > prevtm.tm_mday || (currtm.tm_mday == 1 && prevtm.tm_mday > 27))
-    {
-      // check for timestamp fudging around month ends
-      if (!(prevtm.tm_mday == 1 && currtm.tm_mday > 27))
-        doprint();
-    }
-    currsz += bd.size();
-    uint64_t coinbase_amount;
-    uint64_t tx_fee_amount = 0;
-    for (const auto& tx_id : blk.tx_hashes)
+
+    for (const stats_shard &shard: shards)
     {
-      if (tx_id == crypto::null_hash)
-      {
-        throw std::runtime_error("Aborting: tx == null_hash");
-      }
-      if (!db->get_pruned_tx_blob(tx_id, bd))
+      if (!shard.error.empty())
       {
-        throw std::runtime_error("Aborting: tx not found");
-      }
-      transaction tx;
-      if (!parse_and_validate_tx_base_from_blob(bd, tx))
-      {
-        LOG_PRINT_L0("Bad txn from db");
+        LOG_PRINT_L0(shard.error);
         return 1;
       }
-      currsz += bd.size();
-      if (db->get_prunable_tx_blob(tx_id, bd))
-        currsz += bd.size();
-      currtxs++;
-      if (do_fees || do_emission) {
-        tx_fee_amount += get_tx_fee(tx);
-      }
-      if (do_hours)
-        txhr[currtm.tm_hour]++;
-      if (do_inputs) {
-        io = tx.vin.size();
-        if (io < minins)
-          minins = io;
-        else if (io > maxins)
-          maxins = io;
-        totins += io;
-      }
-      if (do_ringsize) {
-        const cryptonote::txin_to_key& tx_in_to_key
-                       = boost::get<cryptonote::txin_to_key>(tx.vin[0]);
-        io = tx_in_to_key.key_offsets.size();
-        if (io < minrings)
-          minrings = io;
-        else if (io > maxrings)
-          maxrings = io;
-        totrings += io;
-      }
-      if (do_outputs) {
-        io = tx.vout.size();
-        if (io < minouts)
-          minouts = io;
-        else if (io > maxouts)
-          maxouts = io;
-        totouts += io;
+      for (const day_stats &day: shard.days)
+      {
+        if (!state.open_day.empty() && day.date <= state.open_day.back().date)
+        {
+          state.open_day.back().merge(day);
+          continue;
+        }
+        if (!state.open_day.empty())
+          close_day(state.open_day.back(), state, opts);
+        state.open_day = {day};
       }
-      tottxs++;
-    }
-    if (do_diff) {
-      difficulty_type diff = db->get_block_difficulty(h);
-      if (!mindiff || diff < mindiff)
-        mindiff = diff;
-      if (diff > maxdiff)
-        maxdiff = diff;
-      totdiff += diff;
+      state.next_height = shard.stop;
     }
-    if (do_emission) {
-      coinbase_amount = get_outs_money_amount(blk.miner_tx);
-      emission += coinbase_amount - tx_fee_amount;
-    }
-    if (do_fees) {
-      fees += tx_fee_amount;
-    }
-    currblks++;
+    std::cout.flush();
+  }
+  if (!state.open_day.empty())
+    print_day(state.open_day.back(), state, opts);
 
-    if (stop_requested)
-      break;
+  if (!opt_state_file.empty())
+  {
+    if (state.next_height)
+      state.top_hash = db->get_block_hash_from_height(state.next_height - 1);
+    if (!save_state(opt_state_file, state))
+    {
+      LOG_PRINT_L0("Failed to save state to " << opt_state_file);
+      return 1;
+    }
+    MINFO("Saved state at height " << state.next_height << " to " << opt_state_file);
   }
-  if (currblks)
-    doprint();
 
   core_storage->blockchain.deinit();
   return 0;
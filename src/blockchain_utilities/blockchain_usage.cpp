@@ -26,15 +26,21 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/algorithm/string.hpp>
-#include <boost/filesystem/path.hpp>
+#include <boost/filesystem.hpp>
 #include "common/command_line.h"
+#include "common/threadpool.h"
 #include "common/varint.h"
 #include "cryptonote_core/tx_pool.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_core/blockchain.h"
 #include "blockchain_db/blockchain_db.h"
+#include "file_io_utils.h"
+#include "serialization/binary_utils.h"
+#include "serialization/containers.h"
+#include "serialization/crypto.h"
 #include "version.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -44,15 +50,14 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
+// ring members are asset type output indices, so outputs are keyed by
+// asset type and the index within that asset type
 struct output_data
 {
-  uint64_t amount;
+  uint32_t asset_id;
   uint64_t index;
-  mutable bool coinbase;
-  mutable uint64_t height;
-  output_data(uint64_t a, uint64_t i, bool cb, uint64_t h): amount(a), index(i), coinbase(cb), height(h) {}
-  bool operator==(const output_data &other) const { return other.amount == amount && other.index == index; }
-  void info(bool c, uint64_t h) const { coinbase = c; height =h; }
+  output_data(uint32_t a, uint64_t i): asset_id(a), index(i) {}
+  bool operator==(const output_data &other) const { return other.asset_id == asset_id && other.index == index; }
 };
 namespace std
 {
@@ -60,7 +65,7 @@ namespace std
   {
     size_t operator()(const output_data &od) const
     {
-      const uint64_t data[2] = {od.amount, od.index};
+      const uint64_t data[2] = {od.asset_id, od.index};
       crypto::hash h;
       crypto::cn_fast_hash(data, 2 * sizeof(uint64_t), h);
       return reinterpret_cast<const std::size_t &>(h);
@@ -68,13 +73,154 @@ namespace std
   };
 }
 
-struct reference
+static std::atomic<bool> stop_requested(false);
+
+namespace
 {
-  uint64_t height;
-  uint64_t ring_size;
-  uint64_t position;
-  reference(uint64_t h, uint64_t rs, uint64_t p): height(h), ring_size(rs), position(p) {}
-};
+  // blocks read by one worker at a time; the reference counts of all shards
+  // sum to those of the whole range
+  const uint64_t usage_shard_size = 1000;
+
+  const uint32_t usage_state_version = 1;
+
+  // how many times each output was used in a ring, outputs never used included
+  typedef std::unordered_map<output_data, uint64_t> usage_map;
+
+  struct usage_record
+  {
+    uint32_t asset_id;
+    uint64_t index;
+    uint64_t references;
+
+    BEGIN_SERIALIZE_OBJECT()
+      VARINT_FIELD(asset_id)
+      VARINT_FIELD(index)
+      VARINT_FIELD(references)
+    END_SERIALIZE()
+  };
+
+  struct usage_state
+  {
+    uint32_t version = usage_state_version;
+    bool rct_only = false;
+    uint64_t next_height = 0;
+    crypto::hash top_hash = crypto::null_hash;
+    std::vector<usage_record> outputs;
+
+    BEGIN_SERIALIZE_OBJECT()
+      VARINT_FIELD(version)
+      if (version != usage_state_version)
+        return false;
+      FIELD(rct_only)
+      VARINT_FIELD(next_height)
+      FIELD(top_hash)
+      FIELD(outputs)
+    END_SERIALIZE()
+  };
+
+  struct usage_shard
+  {
+    uint64_t start;
+    uint64_t stop;
+    usage_map outputs;
+    std::string error;
+  };
+
+  void usage_tx(BlockchainDB *db, const crypto::hash &hash, const transaction &tx, bool rct_only, usage_map &outputs)
+  {
+    uint64_t tx_id;
+    if (!db->tx_exists(hash, tx_id))
+      throw std::runtime_error("Aborting: tx not found");
+    const std::vector<std::vector<std::pair<uint64_t, uint64_t>>> indices = db->get_tx_amount_output_indices(tx_id);
+    if (indices.size() != 1 || indices[0].size() != tx.vout.size())
+      throw std::runtime_error("Aborting: bad output indices for tx " + epee::string_tools::pod_to_hex(hash));
+
+    // create new outputs
+    for (size_t i = 0; i < tx.vout.size(); ++i)
+    {
+      if (rct_only && tx.vout[i].amount)
+        continue;
+      std::string asset_type;
+      if (!get_output_asset_type(tx.vout[i], asset_type))
+        throw std::runtime_error("Aborting: bad output asset type in tx " + epee::string_tools::pod_to_hex(hash));
+      outputs.emplace(output_data(asset_id_from_type(asset_type), indices[0][i].second), 0);
+    }
+
+    for (const auto &in: tx.vin)
+    {
+      if (in.type() != typeid(txin_to_key))
+        continue;
+      const auto &txin = boost::get<txin_to_key>(in);
+      if (rct_only && txin.amount != 0)
+        continue;
+
+      const uint32_t asset_id = asset_id_from_type(txin.asset_type);
+      const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
+      for (size_t n = 0; n < absolute.size(); ++n)
+        outputs[output_data(asset_id, absolute[n])]++;
+    }
+  }
+
+  void usage_range(BlockchainDB *db, bool rct_only, usage_shard &shard)
+  {
+    try
+    {
+      for (uint64_t h = shard.start; h < shard.stop; ++h)
+      {
+        cryptonote::block blk;
+        if (!cryptonote::parse_and_validate_block_from_blob(db->get_block_blob_from_height(h), blk))
+          throw std::runtime_error("Bad block from db");
+        usage_tx(db, get_transaction_hash(blk.miner_tx), blk.miner_tx, rct_only, shard.outputs);
+        usage_tx(db, get_transaction_hash(blk.protocol_tx), blk.protocol_tx, rct_only, shard.outputs);
+        for (const crypto::hash &tx_hash: blk.tx_hashes)
+        {
+          transaction tx;
+          if (!db->get_pruned_tx(tx_hash, tx))
+            throw std::runtime_error("Aborting: tx not found");
+          usage_tx(db, tx_hash, tx, rct_only, shard.outputs);
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      shard.error = e.what();
+    }
+  }
+
+  bool load_state(const std::string &path, usage_state &state, usage_map &outputs)
+  {
+    std::string blob;
+    if (!epee::file_io_utils::load_file_to_string(path, blob))
+      return false;
+    if (!::serialization::parse_binary(blob, state))
+      return false;
+    outputs.reserve(state.outputs.size());
+    for (const usage_record &rec: state.outputs)
+      outputs.emplace(output_data(rec.asset_id, rec.index), rec.references);
+    state.outputs.clear();
+    return true;
+  }
+
+  bool save_state(const std::string &path, usage_state &state, const usage_map &outputs)
+  {
+    state.outputs.clear();
+    state.outputs.reserve(outputs.size());
+    for (const auto &out: outputs)
+      state.outputs.push_back({out.first.asset_id, out.first.index, out.second});
+    std::string blob;
+    const bool r = ::serialization::dump_binary(state, blob);
+    state.outputs.clear();
+    if (!r)
+      return false;
+    // write aside and rename, so an interrupted save leaves the old state
+    const std::string tmp = path + ".tmp";
+    if (!epee::file_io_utils::save_string_to_file(tmp, blob))
+      return false;
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp, path, ec);
+    return !ec;
+  }
+}
 
 int main(int argc, char* argv[])
 {
@@ -92,12 +238,16 @@ int main(int argc, char* argv[])
   po::options_description desc_cmd_sett("Command line options and settings options");
   const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
   const command_line::arg_descriptor<bool> arg_rct_only  = {"rct-only", "Only work on ringCT outputs", false};
+  const command_line::arg_descriptor<uint64_t> arg_threads  = {"threads", "Number of block ranges to read in parallel (0 = all cores)", 0};
+  const command_line::arg_descriptor<std::string> arg_state_file  = {"state-file", "Resume from, and save progress to, this file", ""};
   const command_line::arg_descriptor<std::string> arg_input = {"input", ""};
 
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
   command_line::add_arg(desc_cmd_sett, cryptonote::arg_stagenet_on);
   command_line::add_arg(desc_cmd_sett, arg_log_level);
   command_line::add_arg(desc_cmd_sett, arg_rct_only);
+  command_line::add_arg(desc_cmd_sett, arg_threads);
+  command_line::add_arg(desc_cmd_sett, arg_state_file);
   command_line::add_arg(desc_cmd_sett, arg_input);
   command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
@@ -137,6 +287,27 @@ int main(int argc, char* argv[])
   bool opt_stagenet = command_line::get_arg(vm, cryptonote::arg_stagenet_on);
   network_type net_type = opt_testnet ? TESTNET : opt_stagenet ? STAGENET : MAINNET;
   bool opt_rct_only = command_line::get_arg(vm, arg_rct_only);
+  uint64_t opt_threads = command_line::get_arg(vm, arg_threads);
+  std::string opt_state_file = command_line::get_arg(vm, arg_state_file);
+
+  usage_state state;
+  state.rct_only = opt_rct_only;
+  usage_map outputs;
+  bool resumed = false;
+  if (!opt_state_file.empty() && boost::filesystem::exists(opt_state_file))
+  {
+    if (!load_state(opt_state_file, state, outputs))
+    {
+      LOG_PRINT_L0("Failed to load state from " << opt_state_file);
+      return 1;
+    }
+    if (state.rct_only != opt_rct_only)
+    {
+      LOG_PRINT_L0("State file " << opt_state_file << " was written with a different --rct-only setting");
+      return 1;
+    }
+    resumed = true;
+  }
 
   // If we wanted to use the memory pool, we would set up a fake_core.
 
@@ -178,51 +349,63 @@ int main(int argc, char* argv[])
   CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
   LOG_PRINT_L0("Source blockchain storage initialized OK");
 
-  LOG_PRINT_L0("Building usage patterns...");
+  tools::signal_handler::install([](int type) {
+    stop_requested = true;
+  });
 
-  std::unordered_map<output_data, std::list<reference>> outputs;
-  std::unordered_map<uint64_t,uint64_t> indices;
+  const uint64_t db_height = db->height();
+  if (resumed)
+  {
+    // the state is only good for the chain it was taken from
+    if (state.next_height > db_height || (state.next_height && db->get_block_hash_from_height(state.next_height - 1) != state.top_hash))
+    {
+      LOG_PRINT_L0("State file " << opt_state_file << " does not match this blockchain, delete it to start over");
+      return 1;
+    }
+    MINFO("Resuming from state file " << opt_state_file << " at height " << state.next_height);
+  }
 
+  LOG_PRINT_L0("Building usage patterns...");
+
+  // shard the new blocks over the compute threads; each shard reads through
+  // the db's per thread read txn, and its counts are summed into the total
   LOG_PRINT_L0("Reading blockchain from " << input);
-  core_storage->blockchain.for_all_transactions([&](const crypto::hash &hash, const cryptonote::transaction &tx)->bool
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  size_t threads = opt_threads ? opt_threads : tpool.get_max_concurrency();
+  threads = std::max<size_t>(1, threads);
+  for (uint64_t h = state.next_height; h < db_height && !stop_requested; )
   {
-    const bool coinbase = tx.vin.size() == 1 && tx.vin[0].type() == typeid(txin_gen);
-    const uint64_t height = core_storage->blockchain.get_db().get_tx_block_height(hash);
-
-    // create new outputs
-    for (const auto &out: tx.vout)
+    std::vector<usage_shard> shards;
+    for (size_t i = 0; i < threads && h < db_height; ++i, h += usage_shard_size)
+      shards.push_back({h, std::min(db_height, h + usage_shard_size), usage_map(), std::string()});
+
+    tools::threadpool::waiter waiter(tpool);
+    for (usage_shard &shard: shards)
+      tpool.submit(&waiter, [db, opt_rct_only, &shard]() { usage_range(db, opt_rct_only, shard); }, true);
+    if (!waiter.wait())
     {
-      if (opt_rct_only && out.amount)
-        continue;
-      indices[out.amount]++;
-      output_data od(out.amount, indices[out.amount], coinbase, height);
-      auto itb = outputs.emplace(od, std::list<reference>());
-      itb.first->first.info(coinbase, height);
+      LOG_PRINT_L0("Failed to read blocks");
+      return 1;
     }
 
-    for (const auto &in: tx.vin)
+    for (const usage_shard &shard: shards)
     {
-      if (in.type() != typeid(txin_to_key))
-        continue;
-      const auto &txin = boost::get<txin_to_key>(in);
-      if (opt_rct_only && txin.amount != 0)
-        continue;
-
-      const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
-      for (size_t n = 0; n < txin.key_offsets.size(); ++n)
+      if (!shard.error.empty())
       {
-        output_data od(txin.amount, absolute[n], coinbase, height);
-        outputs[od].push_back(reference(height, txin.key_offsets.size(), n));
+        LOG_PRINT_L0(shard.error);
+        return 1;
       }
+      for (const auto &out: shard.outputs)
+        outputs[out.first] += out.second;
+      state.next_height = shard.stop;
     }
-    return true;
-  }, true);
+  }
 
   std::unordered_map<uint64_t, uint64_t> counts;
   size_t total = 0;
   for (const auto &out: outputs)
   {
-    counts[out.second.size()]++;
+    counts[out.second]++;
     total++;
   }
   if (total > 0)
@@ -238,6 +421,18 @@ int main(int argc, char* argv[])
     MINFO("No outputs to process");
   }
 
+  if (!opt_state_file.empty())
+  {
+    if (state.next_height)
+      state.top_hash = db->get_block_hash_from_height(state.next_height - 1);
+    if (!save_state(opt_state_file, state, outputs))
+    {
+      LOG_PRINT_L0("Failed to save state to " << opt_state_file);
+      return 1;
+    }
+    MINFO("Saved state at height " << state.next_height << " to " << opt_state_file);
+  }
+
   LOG_PRINT_L0("Blockchain usage exported OK");
   return 0;
 
@@ -36,5 +36,8 @@
 #define BUFFER_SIZE (2 * 1024 * 1024)
 #define CHUNK_SIZE_WARNING_THRESHOLD 500000
 #define NUM_BLOCKS_PER_CHUNK 1
+#define CHUNKED_BLOCKS_PER_CHUNK 1000
+#define CHUNKED_MAX_CHUNK_SIZE (512 * 1024 * 1024)
 #define BLOCKCHAIN_RAW "blockchain.raw"
+#define STATE_SNAPSHOT_RAW "state.snapshot"
 
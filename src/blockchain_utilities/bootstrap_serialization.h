@@ -30,6 +30,7 @@
 
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "serialization/difficulty_type.h"
+#include "serialization/string.h"
 
 
 namespace cryptonote
@@ -66,6 +67,139 @@ namespace cryptonote
       END_SERIALIZE()
     };
 
+    // written next to the bootstrap file as an import commits, so a resumed
+    // import can seek straight to where it stopped instead of scanning the file
+    struct import_resume_marker
+    {
+      // db height reached, and file position of the chunk for that height
+      uint64_t height;
+      uint64_t file_pos;
+
+      // to check the marker still belongs to the same file
+      uint64_t file_size;
+      uint64_t total_blocks;
+      uint64_t block_first;
+
+      BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(height);
+        VARINT_FIELD(file_pos);
+        VARINT_FIELD(file_size);
+        VARINT_FIELD(total_blocks);
+        VARINT_FIELD(block_first);
+      END_SERIALIZE()
+    };
+
+    // chunked export format: the file is a run of chunks of a fixed number of
+    // blocks, followed by this index, so any height range can be located,
+    // fetched and verified on its own
+    struct chunk_index_entry
+    {
+      // zero-based height of the chunk's first block, and its number of blocks
+      uint64_t block_first;
+      uint64_t block_count;
+
+      // file position and size of the encoded chunk
+      uint64_t offset;
+      uint64_t size;
+
+      // cn_fast_hash of the encoded chunk bytes
+      crypto::hash hash;
+
+      BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(block_first);
+        VARINT_FIELD(block_count);
+        VARINT_FIELD(offset);
+        VARINT_FIELD(size);
+        FIELD(hash);
+      END_SERIALIZE()
+    };
+
+    struct chunk_index
+    {
+      uint8_t  major_version;
+      uint8_t  minor_version;
+
+      // how each chunk is encoded, see chunked_bootstrap_file.h
+      uint8_t  codec;
+      uint64_t blocks_per_chunk;
+      std::vector<chunk_index_entry> chunks;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(major_version);
+        FIELD(minor_version);
+        FIELD(codec);
+        VARINT_FIELD(blocks_per_chunk);
+        FIELD(chunks);
+      END_SERIALIZE()
+    };
+
+    // state snapshot format: raw records of the consensus state tables at one
+    // height, in batches, followed by this info, see state_snapshot_file.h
+    struct state_record
+    {
+      std::string key;
+      std::string value;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(key);
+        FIELD(value);
+      END_SERIALIZE()
+    };
+
+    struct state_batch
+    {
+      std::string table;
+      std::vector<state_record> records;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(table);
+        FIELD(records);
+      END_SERIALIZE()
+    };
+
+    struct state_table_info
+    {
+      std::string table;
+      uint64_t records;
+
+      // keccak over the table's records, in order
+      crypto::hash hash;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(table);
+        VARINT_FIELD(records);
+        FIELD(hash);
+      END_SERIALIZE()
+    };
+
+    struct state_snapshot_info
+    {
+      uint8_t  major_version;
+      uint8_t  minor_version;
+      uint8_t  nettype;
+
+      // chain height the state belongs to, and the hash of its top block
+      uint64_t height;
+      crypto::hash top_block_hash;
+      uint8_t  hf_version;
+
+      std::vector<state_table_info> tables;
+
+      // cn_fast_hash of this info serialized with a null commitment
+      crypto::hash commitment;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(major_version);
+        FIELD(minor_version);
+        FIELD(nettype);
+        VARINT_FIELD(height);
+        FIELD(top_block_hash);
+        FIELD(hf_version);
+        FIELD(tables);
+        FIELD(commitment);
+      END_SERIALIZE()
+    };
+
     struct block_package_1
     {
       cryptonote::block block;
@@ -100,6 +234,15 @@ namespace cryptonote
       END_SERIALIZE()
     };
 
+    struct block_chunk
+    {
+      std::vector<block_package> blocks;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(blocks);
+      END_SERIALIZE()
+    };
+
   }
 
 }
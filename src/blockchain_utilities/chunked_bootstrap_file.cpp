@@ -0,0 +1,357 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "chunked_bootstrap_file.h"
+#include "crypto/hash.h"
+#include "serialization/binary_utils.h" // dump_binary(), parse_binary()
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+using namespace cryptonote;
+using namespace epee;
+
+namespace
+{
+  // This number was picked by taking the leading 4 bytes from this output:
+  // echo Salvium chunked bootstrap file | sha1sum
+  const uint32_t chunked_raw_magic = 0xc217185e;
+
+  // index position followed by the magic again, so the tail can be checked on its own
+  const size_t footer_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+  std::string refresh_string = "\r                                    \r";
+}
+
+
+
+bool ChunkedBootstrapFile::open_writer(const boost::filesystem::path& file_path)
+{
+  const boost::filesystem::path dir_path = file_path.parent_path();
+  if (!dir_path.empty())
+  {
+    if (boost::filesystem::exists(dir_path))
+    {
+      if (!boost::filesystem::is_directory(dir_path))
+      {
+        MFATAL("export directory path is a file: " << dir_path);
+        return false;
+      }
+    }
+    else
+    {
+      if (!boost::filesystem::create_directory(dir_path))
+      {
+        MFATAL("Failed to create directory " << dir_path);
+        return false;
+      }
+    }
+  }
+
+  m_raw_data_file = new std::ofstream();
+
+  MINFO("creating file");
+
+  m_raw_data_file->open(file_path.string(), std::ios_base::binary | std::ios_base::out | std::ios::trunc);
+  if (m_raw_data_file->fail())
+    return false;
+
+  std::string blob;
+  if (! ::serialization::dump_binary(chunked_raw_magic, blob))
+  {
+    throw std::runtime_error("Error in serialization of file magic");
+  }
+  *m_raw_data_file << blob;
+
+  return true;
+}
+
+void ChunkedBootstrapFile::make_block_package(uint64_t height, bootstrap::block_package& bp)
+{
+  BlockchainDB &db = m_blockchain_storage->get_db();
+  const crypto::hash hash = db.get_block_hash_from_height(height);
+  bp.block = db.get_block(hash);
+
+  bp.txs.clear();
+  bp.txs.reserve(bp.block.tx_hashes.size());
+  for (const auto& tx_id : bp.block.tx_hashes)
+  {
+    if (tx_id == crypto::null_hash)
+    {
+      throw std::runtime_error("Aborting: tx == null_hash");
+    }
+    bp.txs.push_back(db.get_tx(tx_id));
+  }
+
+  // needed for an import without verification, as in the legacy format
+  bp.block_weight = db.get_block_weight(height);
+  bp.cumulative_difficulty = db.get_block_cumulative_difficulty(height);
+  bp.coins_generated = db.get_block_already_generated_coins(height);
+}
+
+void ChunkedBootstrapFile::write_chunk(uint64_t block_first, std::vector<bootstrap::block_package>& blocks)
+{
+  bootstrap::block_chunk chunk;
+  chunk.blocks = std::move(blocks);
+  blocks.clear();
+
+  std::string blob;
+  if (! ::serialization::dump_binary(chunk, blob))
+  {
+    throw std::runtime_error("Error in serialization of chunk");
+  }
+
+  bootstrap::chunk_index_entry entry;
+  entry.block_first = block_first;
+  entry.block_count = chunk.blocks.size();
+  entry.offset = m_raw_data_file->tellp();
+  entry.size = blob.size();
+  entry.hash = crypto::cn_fast_hash(blob.data(), blob.size());
+
+  m_raw_data_file->write(blob.data(), blob.size());
+  if (m_raw_data_file->fail())
+  {
+    MFATAL("Error writing chunk:  first block: " << block_first << "  chunk_size: " << blob.size());
+    throw std::runtime_error("Error writing chunk");
+  }
+  m_index.chunks.push_back(entry);
+  MDEBUG("wrote chunk:  first block: " << block_first << "  blocks: " << entry.block_count << "  chunk_size: " << entry.size);
+}
+
+void ChunkedBootstrapFile::write_index()
+{
+  const uint64_t index_pos = m_raw_data_file->tellp();
+
+  std::string blob;
+  if (! ::serialization::dump_binary(m_index, blob))
+  {
+    throw std::runtime_error("Error in serialization of chunk index");
+  }
+  *m_raw_data_file << blob;
+
+  uint64_t pos = index_pos;
+  uint32_t magic = chunked_raw_magic;
+  if (! ::serialization::dump_binary(pos, blob))
+  {
+    throw std::runtime_error("Error in serialization of chunk index position");
+  }
+  *m_raw_data_file << blob;
+  if (! ::serialization::dump_binary(magic, blob))
+  {
+    throw std::runtime_error("Error in serialization of file magic");
+  }
+  *m_raw_data_file << blob;
+}
+
+bool ChunkedBootstrapFile::close()
+{
+  if (m_raw_data_file->fail())
+    return false;
+
+  m_raw_data_file->flush();
+  delete m_raw_data_file;
+  return true;
+}
+
+bool ChunkedBootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, boost::filesystem::path& output_file, uint64_t start_block, uint64_t requested_block_stop, uint64_t blocks_per_chunk)
+{
+  m_blockchain_storage = _blockchain_storage;
+  uint64_t progress_interval = 100;
+  MINFO("Storing blocks raw data in chunks of " << blocks_per_chunk << " blocks...");
+
+  if (blocks_per_chunk == 0)
+  {
+    MFATAL("blocks per chunk must be positive");
+    return false;
+  }
+
+  uint64_t block_stop = 0;
+  MINFO("source blockchain height: " <<  m_blockchain_storage->get_current_blockchain_height()-1);
+  if ((requested_block_stop > 0) && (requested_block_stop < m_blockchain_storage->get_current_blockchain_height()))
+  {
+    MINFO("Using requested block height: " << requested_block_stop);
+    block_stop = requested_block_stop;
+  }
+  else
+  {
+    block_stop = m_blockchain_storage->get_current_blockchain_height() - 1;
+    MINFO("Using block height of source blockchain: " << block_stop);
+  }
+  if (start_block > block_stop)
+  {
+    MFATAL("start block " << start_block << " is above stop block " << block_stop);
+    return false;
+  }
+  if (!open_writer(output_file))
+  {
+    MFATAL("failed to open raw file for write");
+    return false;
+  }
+
+  m_index.major_version = 1;
+  m_index.minor_version = 0;
+  m_index.codec = CODEC_NONE;
+  m_index.blocks_per_chunk = blocks_per_chunk;
+  m_index.chunks.clear();
+
+  std::vector<bootstrap::block_package> blocks;
+  blocks.reserve(blocks_per_chunk);
+  uint64_t chunk_first = start_block;
+  uint64_t max_chunk = 0;
+  for (uint64_t height = start_block; height <= block_stop; ++height)
+  {
+    blocks.emplace_back();
+    make_block_package(height, blocks.back());
+    if (blocks.size() == blocks_per_chunk || height == block_stop)
+    {
+      write_chunk(chunk_first, blocks);
+      max_chunk = std::max(max_chunk, m_index.chunks.back().size);
+      chunk_first = height + 1;
+    }
+    if (height % progress_interval == 0) {
+      std::cout << refresh_string;
+      std::cout << "block " << height << "/" << block_stop << "\r" << std::flush;
+    }
+  }
+  write_index();
+
+  std::cout << refresh_string;
+  std::cout << "block " << block_stop << "/" << block_stop << ENDL;
+
+  MINFO("Number of blocks exported: " << block_stop - start_block + 1 << " in " << m_index.chunks.size() << " chunks");
+  MINFO("Largest chunk: " << max_chunk << " bytes");
+
+  return close();
+}
+
+bool ChunkedBootstrapFile::is_chunked_file(const std::string& file_path)
+{
+  std::ifstream import_file(file_path, std::ios_base::binary | std::ifstream::in);
+  char buf[sizeof(uint32_t)];
+  import_file.read(buf, sizeof(buf));
+  if (!import_file)
+    return false;
+  uint32_t file_magic;
+  if (! ::serialization::parse_binary(std::string(buf, sizeof(buf)), file_magic))
+    return false;
+  return file_magic == chunked_raw_magic;
+}
+
+bool ChunkedBootstrapFile::open_reader(const std::string& file_path)
+{
+  if (!is_chunked_file(file_path))
+  {
+    MFATAL("not a chunked bootstrap file: " << file_path);
+    return false;
+  }
+
+  boost::system::error_code ec;
+  const uint64_t file_size = boost::filesystem::file_size(file_path, ec);
+  if (ec || file_size < sizeof(uint32_t) + footer_size)
+  {
+    MFATAL("chunked bootstrap file is truncated: " << file_path);
+    return false;
+  }
+
+  std::ifstream import_file(file_path, std::ios_base::binary | std::ifstream::in);
+  char footer[footer_size];
+  import_file.seekg(file_size - footer_size);
+  import_file.read(footer, footer_size);
+  uint64_t index_pos;
+  uint32_t file_magic;
+  if (!import_file ||
+      !::serialization::parse_binary(std::string(footer, sizeof(uint64_t)), index_pos) ||
+      !::serialization::parse_binary(std::string(footer + sizeof(uint64_t), sizeof(uint32_t)), file_magic) ||
+      file_magic != chunked_raw_magic || index_pos < sizeof(uint32_t) || index_pos > file_size - footer_size)
+  {
+    MFATAL("chunked bootstrap file has no valid index: " << file_path);
+    return false;
+  }
+
+  std::string blob(file_size - footer_size - index_pos, '\0');
+  import_file.seekg(index_pos);
+  import_file.read(&blob[0], blob.size());
+  if (!import_file || !::serialization::parse_binary(blob, m_index))
+  {
+    MFATAL("Error in deserialization of chunk index");
+    return false;
+  }
+  if (m_index.major_version != 1 || m_index.codec != CODEC_NONE)
+  {
+    MFATAL("Unsupported chunked bootstrap file version " << (unsigned)m_index.major_version << ", codec " << (unsigned)m_index.codec);
+    return false;
+  }
+
+  // chunks must be contiguous in height and lie before the index
+  for (size_t i = 0; i < m_index.chunks.size(); ++i)
+  {
+    const bootstrap::chunk_index_entry &entry = m_index.chunks[i];
+    const bool contiguous = i == 0 || entry.block_first == m_index.chunks[i-1].block_first + m_index.chunks[i-1].block_count;
+    if (!contiguous || entry.block_count == 0 || entry.size > CHUNKED_MAX_CHUNK_SIZE || entry.offset < sizeof(uint32_t) || entry.offset + entry.size > index_pos)
+    {
+      MFATAL("Invalid chunk index entry " << i);
+      return false;
+    }
+  }
+
+  MINFO("chunked bootstrap file: " << m_index.chunks.size() << " chunks of up to " << m_index.blocks_per_chunk << " blocks");
+  return true;
+}
+
+bool ChunkedBootstrapFile::read_chunk(std::ifstream& import_file, const bootstrap::chunk_index_entry& entry,
+    uint8_t codec, std::vector<bootstrap::block_package>& blocks)
+{
+  if (codec != CODEC_NONE)
+  {
+    MERROR("Unsupported chunk codec " << (unsigned)codec);
+    return false;
+  }
+
+  std::string blob(entry.size, '\0');
+  import_file.seekg(entry.offset);
+  import_file.read(&blob[0], blob.size());
+  if (!import_file)
+  {
+    MERROR("Failed to read chunk at height " << entry.block_first);
+    return false;
+  }
+  if (crypto::cn_fast_hash(blob.data(), blob.size()) != entry.hash)
+  {
+    MERROR("Chunk at height " << entry.block_first << " does not match its hash");
+    return false;
+  }
+
+  bootstrap::block_chunk chunk;
+  if (!::serialization::parse_binary(blob, chunk) || chunk.blocks.size() != entry.block_count)
+  {
+    MERROR("Error in deserialization of chunk at height " << entry.block_first);
+    return false;
+  }
+  blocks = std::move(chunk.blocks);
+  return true;
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_core/blockchain.h"
+
+#include <fstream>
+
+#include "blockchain_utilities.h"
+#include "bootstrap_serialization.h"
+
+
+using namespace cryptonote;
+
+
+// Chunked bootstrap file: a magic, then chunks of blocks_per_chunk blocks, each
+// a serialized bootstrap::block_chunk, then a bootstrap::chunk_index and a fixed
+// size footer holding the index position. Given the footer, a reader can find,
+// fetch and verify any chunk without reading the rest of the file.
+class ChunkedBootstrapFile
+{
+public:
+
+  // chunks are stored as is; the codec field leaves room for compression
+  static const uint8_t CODEC_NONE = 0;
+
+  bool store_blockchain_raw(cryptonote::Blockchain* cs, boost::filesystem::path& output_file,
+      uint64_t start_block=0, uint64_t stop_block=0, uint64_t blocks_per_chunk=CHUNKED_BLOCKS_PER_CHUNK);
+
+  static bool is_chunked_file(const std::string& file_path);
+
+  // reads the footer and index of an existing file
+  bool open_reader(const std::string& file_path);
+  const bootstrap::chunk_index& get_index() const { return m_index; }
+
+  // reads one chunk and checks it against its index entry, before decoding it
+  static bool read_chunk(std::ifstream& import_file, const bootstrap::chunk_index_entry& entry,
+      uint8_t codec, std::vector<bootstrap::block_package>& blocks);
+
+protected:
+
+  Blockchain* m_blockchain_storage;
+
+  std::ofstream * m_raw_data_file;
+
+  bool open_writer(const boost::filesystem::path& file_path);
+  bool close();
+  void write_chunk(uint64_t block_first, std::vector<bootstrap::block_package>& blocks);
+  void write_index();
+  void make_block_package(uint64_t height, bootstrap::block_package& bp);
+
+private:
+
+  bootstrap::chunk_index m_index;
+};
@@ -0,0 +1,479 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "state_snapshot_file.h"
+#include "int-util.h"
+#include "crypto/hash.h"
+#include "serialization/binary_utils.h" // dump_binary(), parse_binary()
+
+extern "C"
+{
+#include "crypto/keccak.h"
+}
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+using namespace cryptonote;
+using namespace epee;
+
+namespace
+{
+  // This number was picked by taking the leading 4 bytes from this output:
+  // echo Salvium state snapshot file | sha1sum
+  const uint32_t state_snapshot_magic = 0x5a7e5a9b;
+
+  // info position followed by the magic again, so the tail can be checked on its own
+  const size_t footer_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+  // batches are cut at this many bytes of keys and values
+  const size_t batch_bytes = 4 * 1024 * 1024;
+  const size_t max_batch_size = 2 * batch_bytes;
+
+  std::string refresh_string = "\r                                    \r";
+
+  // hashes the records of one table, and counts them
+  class table_hasher
+  {
+  public:
+    explicit table_hasher(const std::string &table)
+    {
+      m_info.table = table;
+      m_info.records = 0;
+      keccak_init(&m_ctx);
+    }
+
+    void add(const epee::span<const uint8_t> key, const epee::span<const uint8_t> value)
+    {
+      add_field(key);
+      add_field(value);
+      ++m_info.records;
+    }
+
+    bootstrap::state_table_info finish()
+    {
+      keccak_finish(&m_ctx, reinterpret_cast<uint8_t*>(&m_info.hash));
+      return m_info;
+    }
+
+  private:
+    void add_field(const epee::span<const uint8_t> field)
+    {
+      const uint64_t size = SWAP64LE(uint64_t(field.size()));
+      keccak_update(&m_ctx, reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+      keccak_update(&m_ctx, field.data(), field.size());
+    }
+
+    KECCAK_CTX m_ctx;
+    bootstrap::state_table_info m_info;
+  };
+
+  epee::span<const uint8_t> to_byte_span(const std::string &s)
+  {
+    return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+  }
+
+  void set_chain_info(Blockchain* cs, bootstrap::state_snapshot_info& info)
+  {
+    const BlockchainDB &db = cs->get_db();
+    info.major_version = 1;
+    info.minor_version = 0;
+    info.nettype = cs->get_nettype();
+    info.height = db.height();
+    info.top_block_hash = db.top_block_hash();
+    info.hf_version = cs->get_current_hard_fork_version();
+    info.tables.clear();
+    info.commitment = crypto::null_hash;
+  }
+}
+
+
+
+bool StateSnapshotFile::open_writer(const boost::filesystem::path& file_path)
+{
+  const boost::filesystem::path dir_path = file_path.parent_path();
+  if (!dir_path.empty())
+  {
+    if (boost::filesystem::exists(dir_path))
+    {
+      if (!boost::filesystem::is_directory(dir_path))
+      {
+        MFATAL("export directory path is a file: " << dir_path);
+        return false;
+      }
+    }
+    else
+    {
+      if (!boost::filesystem::create_directory(dir_path))
+      {
+        MFATAL("Failed to create directory " << dir_path);
+        return false;
+      }
+    }
+  }
+
+  m_raw_data_file = new std::ofstream();
+
+  MINFO("creating file");
+
+  m_raw_data_file->open(file_path.string(), std::ios_base::binary | std::ios_base::out | std::ios::trunc);
+  if (m_raw_data_file->fail())
+    return false;
+
+  std::string blob;
+  if (! ::serialization::dump_binary(state_snapshot_magic, blob))
+  {
+    throw std::runtime_error("Error in serialization of file magic");
+  }
+  *m_raw_data_file << blob;
+
+  return true;
+}
+
+void StateSnapshotFile::write_batch(bootstrap::state_batch& batch)
+{
+  std::string blob;
+  if (! ::serialization::dump_binary(batch, blob))
+  {
+    throw std::runtime_error("Error in serialization of state batch");
+  }
+
+  std::string size_blob;
+  uint64_t size = blob.size();
+  if (! ::serialization::dump_binary(size, size_blob))
+  {
+    throw std::runtime_error("Error in serialization of state batch size");
+  }
+  *m_raw_data_file << size_blob;
+  m_raw_data_file->write(blob.data(), blob.size());
+  if (m_raw_data_file->fail())
+  {
+    MFATAL("Error writing state batch:  table: " << batch.table << "  batch_size: " << blob.size());
+    throw std::runtime_error("Error writing state batch");
+  }
+  MDEBUG("wrote state batch:  table: " << batch.table << "  records: " << batch.records.size() << "  batch_size: " << blob.size());
+  batch.records.clear();
+}
+
+void StateSnapshotFile::write_info()
+{
+  const uint64_t info_pos = m_raw_data_file->tellp();
+
+  std::string blob;
+  if (! ::serialization::dump_binary(m_info, blob))
+  {
+    throw std::runtime_error("Error in serialization of state snapshot info");
+  }
+  *m_raw_data_file << blob;
+
+  uint64_t pos = info_pos;
+  uint32_t magic = state_snapshot_magic;
+  if (! ::serialization::dump_binary(pos, blob))
+  {
+    throw std::runtime_error("Error in serialization of state snapshot info position");
+  }
+  *m_raw_data_file << blob;
+  if (! ::serialization::dump_binary(magic, blob))
+  {
+    throw std::runtime_error("Error in serialization of file magic");
+  }
+  *m_raw_data_file << blob;
+}
+
+bool StateSnapshotFile::close()
+{
+  if (m_raw_data_file->fail())
+    return false;
+
+  m_raw_data_file->flush();
+  delete m_raw_data_file;
+  return true;
+}
+
+crypto::hash StateSnapshotFile::get_commitment(const bootstrap::state_snapshot_info& info)
+{
+  bootstrap::state_snapshot_info unsigned_info = info;
+  unsigned_info.commitment = crypto::null_hash;
+  std::string blob;
+  if (! ::serialization::dump_binary(unsigned_info, blob))
+  {
+    throw std::runtime_error("Error in serialization of state snapshot info");
+  }
+  return crypto::cn_fast_hash(blob.data(), blob.size());
+}
+
+bool StateSnapshotFile::store_state(Blockchain* _blockchain_storage, const boost::filesystem::path& output_file)
+{
+  if (!open_writer(output_file))
+  {
+    MFATAL("failed to open state snapshot file for write");
+    return false;
+  }
+
+  set_chain_info(_blockchain_storage, m_info);
+  MINFO("Storing consensus state at height " << m_info.height << ", top block " << m_info.top_block_hash);
+
+  // the walk runs in one read txn, so the state can't move under the height recorded above
+  std::unique_ptr<table_hasher> hasher;
+  bootstrap::state_batch batch;
+  size_t batch_size = 0;
+  uint64_t records = 0;
+  const auto finish_table = [&]() {
+    if (!hasher)
+      return;
+    if (!batch.records.empty())
+      write_batch(batch);
+    m_info.tables.push_back(hasher->finish());
+    MINFO("table " << m_info.tables.back().table << ": " << m_info.tables.back().records << " records");
+    hasher.reset();
+  };
+  const bool r = _blockchain_storage->get_db().for_all_state_records([&](const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value) {
+    if (!hasher || batch.table != table)
+    {
+      finish_table();
+      hasher.reset(new table_hasher(table));
+      batch.table = table;
+      batch_size = 0;
+    }
+    hasher->add(key, value);
+    batch.records.push_back({std::string(reinterpret_cast<const char*>(key.data()), key.size()), std::string(reinterpret_cast<const char*>(value.data()), value.size())});
+    batch_size += key.size() + value.size();
+    if (batch_size >= batch_bytes)
+    {
+      write_batch(batch);
+      batch_size = 0;
+    }
+    if (++records % 100000 == 0)
+    {
+      std::cout << refresh_string;
+      std::cout << "record " << records << "\r" << std::flush;
+    }
+    return true;
+  });
+  if (!r)
+  {
+    MFATAL("Failed to walk the consensus state");
+    return false;
+  }
+  finish_table();
+
+  m_info.commitment = get_commitment(m_info);
+  write_info();
+
+  std::cout << refresh_string;
+  MINFO("Number of state records exported: " << records << " in " << m_info.tables.size() << " tables");
+  MINFO("State commitment: " << m_info.commitment);
+
+  return close();
+}
+
+bool StateSnapshotFile::is_snapshot_file(const std::string& file_path)
+{
+  std::ifstream import_file(file_path, std::ios_base::binary | std::ifstream::in);
+  char buf[sizeof(uint32_t)];
+  import_file.read(buf, sizeof(buf));
+  if (!import_file)
+    return false;
+  uint32_t file_magic;
+  if (! ::serialization::parse_binary(std::string(buf, sizeof(buf)), file_magic))
+    return false;
+  return file_magic == state_snapshot_magic;
+}
+
+bool StateSnapshotFile::open_reader(const std::string& file_path)
+{
+  if (!is_snapshot_file(file_path))
+  {
+    MFATAL("not a state snapshot file: " << file_path);
+    return false;
+  }
+
+  boost::system::error_code ec;
+  const uint64_t file_size = boost::filesystem::file_size(file_path, ec);
+  if (ec || file_size < sizeof(uint32_t) + footer_size)
+  {
+    MFATAL("state snapshot file is truncated: " << file_path);
+    return false;
+  }
+
+  std::ifstream import_file(file_path, std::ios_base::binary | std::ifstream::in);
+  char footer[footer_size];
+  import_file.seekg(file_size - footer_size);
+  import_file.read(footer, footer_size);
+  uint64_t info_pos;
+  uint32_t file_magic;
+  if (!import_file ||
+      !::serialization::parse_binary(std::string(footer, sizeof(uint64_t)), info_pos) ||
+      !::serialization::parse_binary(std::string(footer + sizeof(uint64_t), sizeof(uint32_t)), file_magic) ||
+      file_magic != state_snapshot_magic || info_pos < sizeof(uint32_t) || info_pos > file_size - footer_size)
+  {
+    MFATAL("state snapshot file has no valid info: " << file_path);
+    return false;
+  }
+
+  std::string blob(file_size - footer_size - info_pos, '\0');
+  import_file.seekg(info_pos);
+  import_file.read(&blob[0], blob.size());
+  if (!import_file || !::serialization::parse_binary(blob, m_info))
+  {
+    MFATAL("Error in deserialization of state snapshot info");
+    return false;
+  }
+  if (m_info.major_version != 1)
+  {
+    MFATAL("Unsupported state snapshot file version " << (unsigned)m_info.major_version);
+    return false;
+  }
+  if (get_commitment(m_info) != m_info.commitment)
+  {
+    MFATAL("State snapshot info does not match its commitment");
+    return false;
+  }
+  m_info_pos = info_pos;
+  return true;
+}
+
+bool StateSnapshotFile::verify_file(const std::string& file_path) const
+{
+  std::ifstream import_file(file_path, std::ios_base::binary | std::ifstream::in);
+  import_file.seekg(sizeof(uint32_t));
+
+  std::unique_ptr<table_hasher> hasher;
+  std::vector<bootstrap::state_table_info> tables;
+  while (import_file && uint64_t(import_file.tellg()) < m_info_pos)
+  {
+    char size_buf[sizeof(uint64_t)];
+    import_file.read(size_buf, sizeof(size_buf));
+    uint64_t size;
+    if (!import_file || !::serialization::parse_binary(std::string(size_buf, sizeof(size_buf)), size) ||
+        size > max_batch_size || size > m_info_pos - uint64_t(import_file.tellg()))
+    {
+      MERROR("Invalid state batch size");
+      return false;
+    }
+
+    std::string blob(size, '\0');
+    import_file.read(&blob[0], blob.size());
+    bootstrap::state_batch batch;
+    if (!import_file || !::serialization::parse_binary(blob, batch))
+    {
+      MERROR("Error in deserialization of state batch");
+      return false;
+    }
+    if (!hasher || batch.table != tables.back().table)
+    {
+      if (hasher)
+        tables.back() = hasher->finish();
+      hasher.reset(new table_hasher(batch.table));
+      tables.emplace_back();
+      tables.back().table = batch.table;
+    }
+    for (const bootstrap::state_record &record: batch.records)
+      hasher->add(to_byte_span(record.key), to_byte_span(record.value));
+  }
+  if (hasher)
+    tables.back() = hasher->finish();
+
+  if (uint64_t(import_file.tellg()) != m_info_pos)
+  {
+    MERROR("State batches do not end at the snapshot info");
+    return false;
+  }
+  if (tables.size() != m_info.tables.size())
+  {
+    MERROR("State snapshot has " << tables.size() << " tables, its info lists " << m_info.tables.size());
+    return false;
+  }
+  for (size_t i = 0; i < tables.size(); ++i)
+  {
+    const bootstrap::state_table_info &expected = m_info.tables[i];
+    if (tables[i].table != expected.table || tables[i].records != expected.records || tables[i].hash != expected.hash)
+    {
+      MERROR("State snapshot table " << expected.table << " does not match its hash");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StateSnapshotFile::hash_state(Blockchain* cs, bootstrap::state_snapshot_info& info)
+{
+  set_chain_info(cs, info);
+
+  std::unique_ptr<table_hasher> hasher;
+  const bool r = cs->get_db().for_all_state_records([&](const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value) {
+    if (!hasher || info.tables.back().table != table)
+    {
+      if (hasher)
+        info.tables.back() = hasher->finish();
+      hasher.reset(new table_hasher(table));
+      info.tables.emplace_back();
+      info.tables.back().table = table;
+    }
+    hasher->add(key, value);
+    return true;
+  });
+  if (!r)
+    return false;
+  if (hasher)
+    info.tables.back() = hasher->finish();
+
+  info.commitment = get_commitment(info);
+  return true;
+}
+
+bool StateSnapshotFile::verify_state(Blockchain* cs) const
+{
+  bootstrap::state_snapshot_info info;
+  if (!hash_state(cs, info))
+  {
+    MERROR("Failed to walk the consensus state");
+    return false;
+  }
+  if (info.height != m_info.height || info.top_block_hash != m_info.top_block_hash)
+  {
+    MERROR("Database is at height " << info.height << ", top block " << info.top_block_hash <<
+        ", the snapshot is at height " << m_info.height << ", top block " << m_info.top_block_hash);
+    return false;
+  }
+
+  bool ok = info.commitment == m_info.commitment;
+  for (const bootstrap::state_table_info &expected: m_info.tables)
+  {
+    const auto it = std::find_if(info.tables.begin(), info.tables.end(), [&](const bootstrap::state_table_info &t) { return t.table == expected.table; });
+    if (it == info.tables.end() || it->records != expected.records || it->hash != expected.hash)
+    {
+      MERROR("Table " << expected.table << " differs from the snapshot: " <<
+          (it == info.tables.end() ? uint64_t(0) : it->records) << " records in the database, " << expected.records << " in the snapshot");
+      ok = false;
+    }
+  }
+  if (ok)
+    MINFO("Database state matches state commitment " << m_info.commitment);
+  return ok;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_core/blockchain.h"
+
+#include <fstream>
+#include <string>
+
+#include "blockchain_utilities.h"
+#include "bootstrap_serialization.h"
+
+
+using namespace cryptonote;
+
+
+// State snapshot file: a magic, then bootstrap::state_batch records of the
+// consensus state tables (see BlockchainDB::for_all_state_records), then a
+// bootstrap::state_snapshot_info and a fixed size footer holding its position.
+// The info carries a hash per table and a commitment over all of them, so a
+// snapshot, or a node's own state, can be checked against a published value.
+// Records are raw database records, so a snapshot only matches between nodes
+// with the same database format and byte order.
+class StateSnapshotFile
+{
+public:
+
+  bool store_state(Blockchain* cs, const boost::filesystem::path& output_file);
+
+  static bool is_snapshot_file(const std::string& file_path);
+
+  // reads the footer and info of an existing file
+  bool open_reader(const std::string& file_path);
+  const bootstrap::state_snapshot_info& get_info() const { return m_info; }
+
+  // reads every batch of the file and checks it against the table hashes
+  bool verify_file(const std::string& file_path) const;
+
+  // hashes the database's current state and checks it against the info
+  bool verify_state(Blockchain* cs) const;
+
+  static crypto::hash get_commitment(const bootstrap::state_snapshot_info& info);
+
+private:
+
+  bool open_writer(const boost::filesystem::path& file_path);
+  bool close();
+  void write_batch(bootstrap::state_batch& batch);
+  void write_info();
+
+  // hashes the database's state the same way store_state does, without writing it
+  static bool hash_state(Blockchain* cs, bootstrap::state_snapshot_info& info);
+
+  std::ofstream * m_raw_data_file;
+
+  bootstrap::state_snapshot_info m_info;
+  uint64_t m_info_pos;
+};
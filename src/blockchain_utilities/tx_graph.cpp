@@ -0,0 +1,415 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "tx_graph.h"
+#include "common/threadpool.h"
+#include "string_tools.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+using namespace cryptonote;
+
+namespace
+{
+  const char tx_graph_magic[8] = {'S', 'A', 'L', 'T', 'X', 'G', 'R', '\0'};
+  const uint32_t tx_graph_version = 1;
+
+  // blocks scanned by one worker at a time when building
+  const uint64_t tx_graph_shard_size = 1000;
+
+  // levels smaller than this many txes per thread are not worth splitting
+  const size_t tx_graph_walk_chunk = 256;
+
+  // a multiple of 8 bytes, so the arrays after it stay aligned
+  #pragma pack(push, 1)
+  struct tx_graph_header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t height;
+    crypto::hash top_hash;
+    uint64_t tx_count;
+    uint64_t ring_member_count;
+  };
+  #pragma pack(pop)
+  static_assert(sizeof(tx_graph_header) % 8 == 0, "tx_graph_header breaks alignment");
+
+  struct graph_tx
+  {
+    uint64_t tx_id;
+    crypto::hash hash;
+    uint64_t first_output;
+    uint64_t outputs;
+    uint64_t ring_members;
+  };
+
+  struct graph_shard
+  {
+    uint64_t start;
+    uint64_t stop;
+    std::vector<graph_tx> txs;
+    std::vector<uint64_t> ring_members;
+    std::string error;
+  };
+
+  void add_graph_tx(BlockchainDB *db, const crypto::hash &hash, const transaction &tx, graph_shard &shard)
+  {
+    graph_tx gtx;
+    gtx.hash = hash;
+    if (!db->tx_exists(hash, gtx.tx_id))
+      throw std::runtime_error("Aborting: tx not found: " + epee::string_tools::pod_to_hex(hash));
+    gtx.outputs = tx.vout.size();
+    gtx.first_output = 0;
+    if (!tx.vout.empty())
+    {
+      const std::vector<std::vector<std::pair<uint64_t, uint64_t>>> indices = db->get_tx_amount_output_indices(gtx.tx_id);
+      if (indices.size() != 1 || indices[0].size() != tx.vout.size())
+        throw std::runtime_error("Aborting: bad output indices for tx " + epee::string_tools::pod_to_hex(hash));
+      std::string asset_type;
+      if (!get_output_asset_type(tx.vout[0], asset_type))
+        throw std::runtime_error("Aborting: bad output asset type in tx " + epee::string_tools::pod_to_hex(hash));
+      gtx.first_output = db->get_output_id_from_asset_type_output_index(asset_type, indices[0][0].second);
+    }
+
+    const size_t ring_members = shard.ring_members.size();
+    std::vector<uint64_t> output_ids;
+    for (const auto &in: tx.vin)
+    {
+      if (in.type() != typeid(txin_to_key))
+        continue;
+      const txin_to_key &txin = boost::get<txin_to_key>(in);
+      output_ids.clear();
+      db->get_output_id_from_asset_type_output_index(txin.asset_type, relative_output_offsets_to_absolute(txin.key_offsets), output_ids);
+      shard.ring_members.insert(shard.ring_members.end(), output_ids.begin(), output_ids.end());
+    }
+    gtx.ring_members = shard.ring_members.size() - ring_members;
+    shard.txs.push_back(gtx);
+  }
+
+  void scan_graph_range(BlockchainDB *db, graph_shard &shard)
+  {
+    try
+    {
+      for (uint64_t h = shard.start; h < shard.stop; ++h)
+      {
+        block blk;
+        if (!parse_and_validate_block_from_blob(db->get_block_blob_from_height(h), blk))
+          throw std::runtime_error("Bad block from db");
+        add_graph_tx(db, get_transaction_hash(blk.miner_tx), blk.miner_tx, shard);
+        add_graph_tx(db, get_transaction_hash(blk.protocol_tx), blk.protocol_tx, shard);
+        for (const crypto::hash &tx_hash: blk.tx_hashes)
+        {
+          transaction tx;
+          if (!db->get_pruned_tx(tx_hash, tx))
+            throw std::runtime_error("Aborting: tx not found: " + epee::string_tools::pod_to_hex(tx_hash));
+          add_graph_tx(db, tx_hash, tx, shard);
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      shard.error = e.what();
+    }
+  }
+
+  template<typename T>
+  void write_array(std::ofstream &out, const std::vector<T> &v)
+  {
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+  }
+}
+
+TxGraph::TxGraph():
+  m_height(0),
+  m_top_hash(crypto::null_hash),
+  m_tx_count(0),
+  m_ring_member_count(0),
+  m_tx_hashes(NULL),
+  m_first_output(NULL),
+  m_ring_begin(NULL),
+  m_ring_members(NULL)
+{
+}
+
+TxGraph::~TxGraph()
+{
+}
+
+bool TxGraph::build(BlockchainDB *db, const std::string &path, size_t threads, const std::atomic<bool> &stop)
+{
+  std::vector<crypto::hash> tx_hashes;
+  std::vector<uint64_t> first_output(1, 0), ring_begin(1, 0), ring_members;
+  uint64_t height = 0;
+  const uint64_t db_height = db->height();
+
+  if (boost::filesystem::exists(path))
+  {
+    TxGraph graph;
+    if (graph.open(path) && graph.height() <= db_height &&
+        (graph.height() == 0 || db->get_block_hash_from_height(graph.height() - 1) == graph.m_top_hash))
+    {
+      MINFO("Extending tx graph from height " << graph.height());
+      height = graph.height();
+      tx_hashes.assign(graph.m_tx_hashes, graph.m_tx_hashes + graph.m_tx_count);
+      first_output.assign(graph.m_first_output, graph.m_first_output + graph.m_tx_count + 1);
+      ring_begin.assign(graph.m_ring_begin, graph.m_ring_begin + graph.m_tx_count + 1);
+      ring_members.assign(graph.m_ring_members, graph.m_ring_members + graph.m_ring_member_count);
+    }
+    else
+    {
+      MINFO("Existing tx graph does not match this chain, rebuilding it");
+    }
+  }
+
+  // shard the new blocks over the compute threads; each shard reads through
+  // the db's per thread read txn, and shards are appended in height order
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  threads = std::max<size_t>(1, threads ? threads : tpool.get_max_concurrency());
+  for (uint64_t h = height; h < db_height && !stop; )
+  {
+    std::vector<graph_shard> shards;
+    for (size_t i = 0; i < threads && h < db_height; ++i, h += tx_graph_shard_size)
+      shards.push_back({h, std::min(db_height, h + tx_graph_shard_size), {}, {}, std::string()});
+
+    tools::threadpool::waiter waiter(tpool);
+    for (graph_shard &shard: shards)
+      tpool.submit(&waiter, [db, &shard]() { scan_graph_range(db, shard); }, true);
+    if (!waiter.wait())
+    {
+      MERROR("Failed to scan blocks");
+      return false;
+    }
+
+    for (const graph_shard &shard: shards)
+    {
+      if (!shard.error.empty())
+      {
+        MERROR(shard.error);
+        return false;
+      }
+      auto member = shard.ring_members.begin();
+      for (const graph_tx &gtx: shard.txs)
+      {
+        // nodes are tx ids, and outputs are found from each tx's first one,
+        // so both have to follow chain order
+        if (gtx.tx_id != tx_hashes.size())
+        {
+          MERROR("Unexpected tx id " << gtx.tx_id << " for tx " << gtx.hash << ", expected " << tx_hashes.size());
+          return false;
+        }
+        if (gtx.outputs && gtx.first_output != first_output.back())
+        {
+          MERROR("Unexpected first output id " << gtx.first_output << " for tx " << gtx.hash << ", expected " << first_output.back());
+          return false;
+        }
+        tx_hashes.push_back(gtx.hash);
+        first_output.push_back(first_output.back() + gtx.outputs);
+        ring_members.insert(ring_members.end(), member, member + gtx.ring_members);
+        member += gtx.ring_members;
+        ring_begin.push_back(ring_members.size());
+      }
+      height = shard.stop;
+    }
+    MINFO("Scanned up to height " << height << "/" << db_height << ", " << tx_hashes.size() << " txes, " << ring_members.size() << " ring members");
+  }
+
+  tx_graph_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, tx_graph_magic, sizeof(header.magic));
+  header.version = tx_graph_version;
+  header.height = height;
+  header.top_hash = height ? db->get_block_hash_from_height(height - 1) : crypto::null_hash;
+  header.tx_count = tx_hashes.size();
+  header.ring_member_count = ring_members.size();
+
+  // write aside and rename, so an interrupted write leaves the old graph
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, tx_hashes);
+    write_array(out, first_output);
+    write_array(out, ring_begin);
+    write_array(out, ring_members);
+    if (!out.good())
+    {
+      MERROR("Failed to write tx graph to " << tmp);
+      return false;
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp, path, ec);
+  if (ec)
+  {
+    MERROR("Failed to rename " << tmp << " to " << path << ": " << ec.message());
+    return false;
+  }
+  MINFO("Saved tx graph up to height " << height << " to " << path);
+  return true;
+}
+
+bool TxGraph::open(const std::string &path)
+{
+  try
+  {
+    boost::interprocess::file_mapping mapping(path.c_str(), boost::interprocess::read_only);
+    m_region.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to map tx graph " << path << ": " << e.what());
+    return false;
+  }
+
+  const char *data = static_cast<const char*>(m_region->get_address());
+  const size_t size = m_region->get_size();
+  tx_graph_header header;
+  if (size < sizeof(header))
+  {
+    MERROR("Tx graph " << path << " is truncated");
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, tx_graph_magic, sizeof(header.magic)) || header.version != tx_graph_version)
+  {
+    MERROR("Tx graph " << path << " has an unknown format");
+    return false;
+  }
+  // checked one term at a time so corrupt counts can't overflow the sum
+  size_t left = size - sizeof(header);
+  if (left < 2 * sizeof(uint64_t) || header.tx_count > (left - 2 * sizeof(uint64_t)) / (sizeof(crypto::hash) + 2 * sizeof(uint64_t)))
+  {
+    MERROR("Tx graph " << path << " is truncated");
+    return false;
+  }
+  left -= header.tx_count * sizeof(crypto::hash) + (header.tx_count + 1) * 2 * sizeof(uint64_t);
+  if (left % sizeof(uint64_t) || left / sizeof(uint64_t) != header.ring_member_count)
+  {
+    MERROR("Tx graph " << path << " has a bad size");
+    return false;
+  }
+
+  m_height = header.height;
+  m_top_hash = header.top_hash;
+  m_tx_count = header.tx_count;
+  m_ring_member_count = header.ring_member_count;
+  data += sizeof(header);
+  m_tx_hashes = reinterpret_cast<const crypto::hash*>(data);
+  data += m_tx_count * sizeof(crypto::hash);
+  m_first_output = reinterpret_cast<const uint64_t*>(data);
+  data += (m_tx_count + 1) * sizeof(uint64_t);
+  m_ring_begin = reinterpret_cast<const uint64_t*>(data);
+  data += (m_tx_count + 1) * sizeof(uint64_t);
+  m_ring_members = reinterpret_cast<const uint64_t*>(data);
+  if (m_ring_begin[m_tx_count] != m_ring_member_count)
+  {
+    MERROR("Tx graph " << path << " is inconsistent");
+    return false;
+  }
+  return true;
+}
+
+bool TxGraph::find_tx(const BlockchainDB *db, const crypto::hash &txid, uint64_t &node) const
+{
+  return db->tx_exists(txid, node) && node < m_tx_count;
+}
+
+uint64_t TxGraph::get_output_tx(uint64_t output_id) const
+{
+  // txes without outputs share their first output id with the next tx, so
+  // the last tx starting at or below the output is the one which created it
+  return std::upper_bound(m_first_output, m_first_output + m_tx_count + 1, output_id) - m_first_output - 1;
+}
+
+std::vector<uint64_t> TxGraph::walk(const std::vector<uint64_t> &start, size_t threads, const std::function<bool(uint64_t, const std::vector<uint64_t>&)> &on_level) const
+{
+  // one bit per node, set by whichever thread reaches the node first
+  std::unique_ptr<std::atomic<uint64_t>[]> seen(new std::atomic<uint64_t>[m_tx_count / 64 + 1]());
+  const auto mark = [&seen](uint64_t node) {
+    const uint64_t bit = (uint64_t)1 << (node & 63);
+    return !(seen[node >> 6].fetch_or(bit, std::memory_order_relaxed) & bit);
+  };
+
+  std::vector<uint64_t> visited, level;
+  for (uint64_t node: start)
+    if (node < m_tx_count && mark(node))
+      level.push_back(node);
+
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  threads = std::max<size_t>(1, threads ? threads : tpool.get_max_concurrency());
+  for (uint64_t depth = 0; !level.empty(); ++depth)
+  {
+    visited.insert(visited.end(), level.begin(), level.end());
+    if (!on_level(depth, level))
+      break;
+
+    const size_t chunks = std::min(threads, (level.size() + tx_graph_walk_chunk - 1) / tx_graph_walk_chunk);
+    std::vector<std::vector<uint64_t>> next(chunks);
+    std::atomic<bool> bad(false);
+    tools::threadpool::waiter waiter(tpool);
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      tpool.submit(&waiter, [this, &level, &next, &mark, &bad, c, chunks]() {
+        const size_t begin = level.size() * c / chunks, end = level.size() * (c + 1) / chunks;
+        for (size_t i = begin; i < end; ++i)
+        {
+          for (const uint64_t *m = ring_members_begin(level[i]); m != ring_members_end(level[i]); ++m)
+          {
+            const uint64_t source = get_output_tx(*m);
+            if (source >= level[i])
+            {
+              bad = true;
+              return;
+            }
+            if (mark(source))
+              next[c].push_back(source);
+          }
+        }
+      }, true);
+    }
+    if (!waiter.wait())
+      throw std::runtime_error("Failed to walk the tx graph");
+    if (bad)
+      throw std::runtime_error("Tx graph has a ring member which is not older than its tx");
+
+    level.clear();
+    for (const std::vector<uint64_t> &n: next)
+      level.insert(level.end(), n.begin(), n.end());
+  }
+  return visited;
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crypto/hash.h"
+#include "blockchain_db/blockchain_db.h"
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+#define TX_GRAPH_RAW "tx-graph.bin"
+
+// Spend graph of the chain, for the ancestry and depth tools. There is one
+// node per transaction, numbered by its database tx id, holding the global
+// output ids of its ring members in one CSR array. The tx which created an
+// output is found from the first global output id of each tx, so edges only
+// cost one uint64 each. Since a tx can only spend older outputs, every edge
+// points to a lower node.
+//
+// The graph is built by a parallel scan of the db and written to a file,
+// which is then memory mapped. The file starts with a tx_graph_header, then
+// the tx hashes, the first output ids (tx_count + 1, the last being the
+// number of outputs), the first ring member of each tx (tx_count + 1) and
+// the ring members, in host byte order.
+class TxGraph
+{
+public:
+  TxGraph();
+  ~TxGraph();
+
+  // builds, or extends when path holds a graph of a prefix of this chain,
+  // the graph up to the db's height and writes it out to path
+  static bool build(cryptonote::BlockchainDB *db, const std::string &path, size_t threads, const std::atomic<bool> &stop);
+
+  bool open(const std::string &path);
+
+  uint64_t height() const { return m_height; }
+  uint64_t tx_count() const { return m_tx_count; }
+
+  // false if the tx is not in the db, or newer than the graph
+  bool find_tx(const cryptonote::BlockchainDB *db, const crypto::hash &txid, uint64_t &node) const;
+  const crypto::hash &get_tx_hash(uint64_t node) const { return m_tx_hashes[node]; }
+
+  const uint64_t *ring_members_begin(uint64_t node) const { return m_ring_members + m_ring_begin[node]; }
+  const uint64_t *ring_members_end(uint64_t node) const { return m_ring_members + m_ring_begin[node + 1]; }
+  // coinbase and protocol txes spend nothing
+  bool is_leaf(uint64_t node) const { return m_ring_begin[node] == m_ring_begin[node + 1]; }
+
+  // the node which created the output with this global id
+  uint64_t get_output_tx(uint64_t output_id) const;
+
+  // visits the nodes reachable from start one level at a time, expanding each
+  // level on the compute threadpool; nodes are seen once, at the lowest level
+  // they are found at. on_level gets each level, start being level 0, and
+  // stops the walk by returning false. Returns the nodes visited
+  std::vector<uint64_t> walk(const std::vector<uint64_t> &start, size_t threads, const std::function<bool(uint64_t, const std::vector<uint64_t>&)> &on_level) const;
+
+private:
+  std::unique_ptr<boost::interprocess::mapped_region> m_region;
+  uint64_t m_height;
+  crypto::hash m_top_hash;
+  uint64_t m_tx_count;
+  uint64_t m_ring_member_count;
+  const crypto::hash *m_tx_hashes;
+  const uint64_t *m_first_output;
+  const uint64_t *m_ring_begin;
+  const uint64_t *m_ring_members;
+};
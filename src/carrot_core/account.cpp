@@ -112,6 +112,7 @@ CarrotDestinationV1 carrot_and_legacy_account::subaddress(const subaddress_index
 //----------------------------------------------------------------------------------------------------------------------
 const std::unordered_map<crypto::public_key, cryptonote::subaddress_index> carrot_and_legacy_account::get_subaddress_map_cn() const
 {
+    merge_subaddress_table();
     std::unordered_map<crypto::public_key, cryptonote::subaddress_index> res;
     for (const auto &p : subaddress_map)
         res.emplace(p.first, cryptonote::subaddress_index{p.second.index.major, p.second.index.minor});
@@ -121,9 +122,51 @@ const std::unordered_map<crypto::public_key, cryptonote::subaddress_index> carro
 }
 //----------------------------------------------------------------------------------------------------------------------
 const std::unordered_map<crypto::public_key, subaddress_index_extended>& carrot_and_legacy_account::get_subaddress_map_ref() const {
+    merge_subaddress_table();
     return subaddress_map;
 }
 //----------------------------------------------------------------------------------------------------------------------
+std::optional<subaddress_index_extended> carrot_and_legacy_account::find_subaddress(const crypto::public_key &address_spend_pubkey) const
+{
+    if (!subaddress_table_merged.load(std::memory_order_acquire))
+    {
+        // a concurrent merge may be inserting into the map
+        std::lock_guard<std::mutex> lock(subaddress_table_mutex);
+        if (!subaddress_table_merged.load(std::memory_order_relaxed))
+        {
+            const auto it = subaddress_map.find(address_spend_pubkey);
+            if (it != subaddress_map.cend())
+                return it->second;
+            return subaddress_table->find(address_spend_pubkey);
+        }
+    }
+
+    const auto it = subaddress_map.find(address_spend_pubkey);
+    if (it == subaddress_map.cend())
+        return std::nullopt;
+    return it->second;
+}
+//----------------------------------------------------------------------------------------------------------------------
+void carrot_and_legacy_account::set_subaddress_table(std::shared_ptr<const subaddress_lookup_table> table)
+{
+    merge_subaddress_table();
+    subaddress_table = std::move(table);
+    subaddress_table_merged.store(subaddress_table == nullptr, std::memory_order_release);
+}
+//----------------------------------------------------------------------------------------------------------------------
+void carrot_and_legacy_account::merge_subaddress_table() const
+{
+    if (subaddress_table_merged.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> lock(subaddress_table_mutex);
+    if (subaddress_table_merged.load(std::memory_order_relaxed))
+        return;
+    subaddress_table->for_each([this](const crypto::public_key &address_spend_pubkey, const subaddress_index_extended &subaddr_index)
+        { subaddress_map.insert({address_spend_pubkey, subaddr_index}); });
+    subaddress_table_merged.store(true, std::memory_order_release);
+}
+//----------------------------------------------------------------------------------------------------------------------
 const std::unordered_map<crypto::public_key, return_output_info_t>& 
 carrot_and_legacy_account::get_return_output_map_ref() const {
     return return_output_map;
@@ -199,12 +242,12 @@ bool carrot_and_legacy_account::try_searching_for_opening_for_subaddress(const c
     crypto::secret_key &address_privkey_g_out,
     crypto::secret_key &address_privkey_t_out) const
 {
-    const auto it = subaddress_map.find(address_spend_pubkey);
-    if (it == subaddress_map.cend())
+    const std::optional<subaddress_index_extended> subaddr_index = find_subaddress(address_spend_pubkey);
+    if (!subaddr_index)
         return false;
 
     crypto::public_key recomputed_address_spend_pubkey;
-    opening_for_subaddress(it->second,
+    opening_for_subaddress(*subaddr_index,
         address_privkey_g_out,
         address_privkey_t_out,
         recomputed_address_spend_pubkey);
@@ -396,23 +439,84 @@ void carrot_and_legacy_account::set_carrot_keys(const AddressDeriveType default_
 //----------------------------------------------------------------------------------------------------------------------
 void carrot_and_legacy_account::insert_subaddresses(const std::unordered_map<crypto::public_key, subaddress_index_extended>& subaddress_map_cn)
 {
+  insert_subaddress_entries(make_subaddress_entries(subaddress_map_cn));
+}
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<std::pair<crypto::public_key, subaddress_index_extended>> carrot_and_legacy_account::make_subaddress_entries(
+  const std::unordered_map<crypto::public_key, subaddress_index_extended>& subaddress_map_cn) const
+{
+  std::vector<std::pair<crypto::public_key, subaddress_index_extended>> entries;
+  entries.reserve(2 * subaddress_map_cn.size());
+  std::vector<subaddress_index_extended> carrot_indices;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> carrot_j;
   for (const auto &p : subaddress_map_cn) {
-    subaddress_map.insert({p.first, {{p.second.index.major, p.second.index.minor}, p.second.derive_type, p.second.is_return_spend_key}});
+    entries.push_back({p.first, {{p.second.index.major, p.second.index.minor}, p.second.derive_type, p.second.is_return_spend_key}});
     if (p.second.derive_type == AddressDeriveType::PreCarrot) {
       // Create a matching Carrot address
-      const subaddress_index_extended subaddr_index{{p.second.index.major, p.second.index.minor}, AddressDeriveType::Carrot, p.second.is_return_spend_key};
-      const CarrotDestinationV1 addr = subaddress(subaddr_index);
-      subaddress_map.insert({addr.address_spend_pubkey, subaddr_index});
+      carrot_indices.push_back({{p.second.index.major, p.second.index.minor}, AddressDeriveType::Carrot, p.second.is_return_spend_key});
+      carrot_j.emplace_back(p.second.index.major, p.second.index.minor);
     }
   }
+
+  // the Carrot spend pubkeys of a whole lookahead are made in one go
+  std::vector<crypto::public_key> carrot_spend_pubkeys;
+  make_carrot_subaddress_spend_pubkeys_v1(get_keys().m_carrot_account_address.m_spend_public_key,
+    s_generate_address_dev,
+    carrot_j,
+    carrot_spend_pubkeys);
+  for (size_t i = 0; i < carrot_indices.size(); ++i)
+    entries.push_back({carrot_spend_pubkeys[i], carrot_indices[i]});
+  return entries;
+}
+//----------------------------------------------------------------------------------------------------------------------
+void carrot_and_legacy_account::insert_subaddress_entries(const std::vector<std::pair<crypto::public_key, subaddress_index_extended>>& entries)
+{
+  if (defer_inserts) {
+    std::lock_guard<std::mutex> lock(deferred_inserts_mutex);
+    deferred_subaddresses.insert(deferred_subaddresses.end(), entries.begin(), entries.end());
+    return;
+  }
+
+  for (const auto &p : entries)
+    subaddress_map.insert(p);
 }
 //----------------------------------------------------------------------------------------------------------------------
 void carrot_and_legacy_account::insert_return_output_info(const std::unordered_map<crypto::public_key, return_output_info_t>& roi_map)
 {
+    if (defer_inserts) {
+        std::lock_guard<std::mutex> lock(deferred_inserts_mutex);
+        deferred_return_outputs.insert(deferred_return_outputs.end(), roi_map.begin(), roi_map.end());
+        return;
+    }
+
     for (const auto &p : roi_map)
         return_output_map.insert({p.first, p.second});
 }
 //----------------------------------------------------------------------------------------------------------------------
+void carrot_and_legacy_account::remove_return_output_info(const std::vector<crypto::public_key>& return_onetime_addresses)
+{
+    for (const crypto::public_key &return_onetime_address : return_onetime_addresses)
+        return_output_map.erase(return_onetime_address);
+}
+//----------------------------------------------------------------------------------------------------------------------
+void carrot_and_legacy_account::set_defer_inserts(const bool defer)
+{
+    if (!defer)
+        apply_deferred_inserts();
+    defer_inserts = defer;
+}
+//----------------------------------------------------------------------------------------------------------------------
+void carrot_and_legacy_account::apply_deferred_inserts()
+{
+    std::lock_guard<std::mutex> lock(deferred_inserts_mutex);
+    for (const auto &p : deferred_subaddresses)
+        subaddress_map.insert(p);
+    for (const auto &p : deferred_return_outputs)
+        return_output_map.insert(p);
+    deferred_subaddresses.clear();
+    deferred_return_outputs.clear();
+}
+//----------------------------------------------------------------------------------------------------------------------
 AddressDeriveType carrot_and_legacy_account::resolve_derive_type(const AddressDeriveType derive_type) const
 {
     return derive_type == AddressDeriveType::Auto ? default_derive_type : derive_type;
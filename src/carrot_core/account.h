@@ -33,10 +33,18 @@
 #include "destination.h"
 #include "device_ram_borrowed.h"
 #include "enote_utils.h"
+#include "subaddress_lookup_table.h"
 #include "carrot_impl/subaddress_index.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/subaddress_index.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
 //----------------------------------------------------------------------------------------------------------------------
 static constexpr std::uint32_t MAX_SUBADDRESS_MAJOR_INDEX = 5;
 static constexpr std::uint32_t MAX_SUBADDRESS_MINOR_INDEX = 20;
@@ -116,6 +124,13 @@ namespace carrot
 
     const std::unordered_map<crypto::public_key, cryptonote::subaddress_index> get_subaddress_map_cn() const;
     const std::unordered_map<crypto::public_key, subaddress_index_extended>& get_subaddress_map_ref() const;
+    // brief: find_subaddress - look up j for K^j_s in the subaddress map, then in the attached lookup table, if any
+    std::optional<subaddress_index_extended> find_subaddress(const crypto::public_key &address_spend_pubkey) const;
+
+    // brief: set_subaddress_table - attach a lookup table whose entries are served by find_subaddress() without
+    //   being copied into the subaddress map; they are merged into the map the first time the whole map is
+    //   requested, or when the table is detached by passing nullptr
+    void set_subaddress_table(std::shared_ptr<const subaddress_lookup_table> table);
     const std::unordered_map<crypto::public_key, return_output_info_t>& get_return_output_map_ref() const;
 
     // brief: opening_for_subaddress - return (k^g_a, k^t_a) for j s.t. K^j_s = (k^g_a * G + k^t_a * T)
@@ -156,16 +171,40 @@ namespace carrot
     void create_from_svb_key(const cryptonote::account_public_address& address, const crypto::secret_key& svb_key);
     void set_carrot_keys(const AddressDeriveType default_derive_type = AddressDeriveType::Carrot);
     void insert_subaddresses(const std::unordered_map<crypto::public_key, subaddress_index_extended>& subaddress_map);
+    // brief: make_subaddress_entries - the entries insert_subaddresses() would add for subaddress_map, i.e. with a
+    //   matching Carrot address for each PreCarrot one; doesn't touch the account, so it can run on many threads
+    std::vector<std::pair<crypto::public_key, subaddress_index_extended>> make_subaddress_entries(
+        const std::unordered_map<crypto::public_key, subaddress_index_extended>& subaddress_map) const;
+    // brief: insert_subaddress_entries - insert entries from make_subaddress_entries()
+    void insert_subaddress_entries(const std::vector<std::pair<crypto::public_key, subaddress_index_extended>>& entries);
     void insert_return_output_info(
         const std::unordered_map<crypto::public_key, return_output_info_t>& input_context_map
     );
+    // brief: remove_return_output_info - forget the return output info for each Kr, e.g. once its return was spent
+    void remove_return_output_info(const std::vector<crypto::public_key>& return_onetime_addresses);
+
+    // brief: set_defer_inserts - while set, insert_subaddresses() and insert_return_output_info() only queue their
+    //   entries, so the maps stay read-only for threads scanning in parallel; clearing it applies the queue
+    void set_defer_inserts(const bool defer);
+    // brief: apply_deferred_inserts - apply entries queued since set_defer_inserts(true), in queue order
+    void apply_deferred_inserts();
 
     AddressDeriveType resolve_derive_type(const AddressDeriveType derive_type) const;
 
     private:
-        std::unordered_map<crypto::public_key, subaddress_index_extended> subaddress_map;
+        void merge_subaddress_table() const;
+
+        mutable std::unordered_map<crypto::public_key, subaddress_index_extended> subaddress_map;
+        std::shared_ptr<const subaddress_lookup_table> subaddress_table;
+        mutable std::mutex subaddress_table_mutex;
+        mutable std::atomic<bool> subaddress_table_merged{true};
         // Kr -> return_output_info
         std::unordered_map<crypto::public_key, return_output_info_t> return_output_map;
+
+        bool defer_inserts = false;
+        std::mutex deferred_inserts_mutex;
+        std::vector<std::pair<crypto::public_key, subaddress_index_extended>> deferred_subaddresses;
+        std::vector<std::pair<crypto::public_key, return_output_info_t>> deferred_return_outputs;
   };
 }
 
@@ -31,6 +31,10 @@
 
 //local headers
 #include "address_utils.h"
+extern "C"
+{
+#include "crypto/crypto-ops.h"
+}
 #include "exceptions.h"
 #include "misc_log_ex.h"
 #include "ringct/rctOps.h"
@@ -38,6 +42,7 @@
 //third party headers
 
 //standard headers
+#include <memory>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "carrot.dest"
@@ -99,6 +104,71 @@ void make_carrot_subaddress_v1(const crypto::public_key &account_spend_pubkey,
     };
 }
 //-------------------------------------------------------------------------------------------------------------------
+void make_carrot_subaddress_spend_pubkeys_v1(const crypto::public_key &account_spend_pubkey,
+    const generate_address_secret_device &s_generate_address_dev,
+    const std::vector<std::pair<std::uint32_t, std::uint32_t>> &subaddress_indices,
+    std::vector<crypto::public_key> &address_spend_pubkeys_out)
+{
+    // below this a table of K_s costs more than it saves
+    static constexpr std::size_t MIN_PRECOMP_BATCH = 16;
+
+    const std::size_t n = subaddress_indices.size();
+    address_spend_pubkeys_out.resize(n);
+
+    // k^j_subscal = H_n(K_s, j_major, j_minor, s^j_gen)
+    std::vector<crypto::secret_key> subaddress_scalars(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::uint32_t j_major = subaddress_indices[i].first;
+        const std::uint32_t j_minor = subaddress_indices[i].second;
+        if (!j_major && !j_minor)
+            continue;
+
+        crypto::secret_key address_index_generator;
+        s_generate_address_dev.make_index_extension_generator(j_major, j_minor, address_index_generator);
+        make_carrot_subaddress_scalar(account_spend_pubkey,
+            address_index_generator,
+            j_major,
+            j_minor,
+            subaddress_scalars[i]);
+    }
+
+    if (n < MIN_PRECOMP_BATCH)
+    {
+        // K^j_s = k^j_subscal * K_s
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (!subaddress_indices[i].first && !subaddress_indices[i].second)
+                address_spend_pubkeys_out[i] = account_spend_pubkey;
+            else
+                address_spend_pubkeys_out[i] = rct::rct2pk(rct::scalarmultKey(rct::pk2rct(account_spend_pubkey),
+                    rct::sk2rct(subaddress_scalars[i])));
+        }
+        return;
+    }
+
+    ge_p3 spend_pubkey_p3;
+    CARROT_CHECK_AND_THROW(ge_frombytes_vartime(&spend_pubkey_p3, to_bytes(account_spend_pubkey)) == 0,
+        invalid_point, "account spend pubkey is not a valid point");
+
+    // K^j_s = k^j_subscal * K_s, all off one fixed-base table of K_s, encoded with a single inversion
+    std::unique_ptr<ge_precomp[][8]> spend_pubkey_table(new ge_precomp[32][8]);
+    ge_precomp_table_init(spend_pubkey_table.get(), &spend_pubkey_p3);
+
+    std::vector<ge_p3> address_spend_pubkeys_p3(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (!subaddress_indices[i].first && !subaddress_indices[i].second)
+            address_spend_pubkeys_p3[i] = spend_pubkey_p3;
+        else
+            ge_scalarmult_precomp(&address_spend_pubkeys_p3[i], to_bytes(subaddress_scalars[i]), spend_pubkey_table.get());
+    }
+
+    CARROT_CHECK_AND_THROW(ge_p3_tobytes_batch(reinterpret_cast<unsigned char*>(address_spend_pubkeys_out.data()),
+            address_spend_pubkeys_p3.data(), static_cast<int>(n)) == 0,
+        crypto_function_failed, "failed to allocate space to encode subaddress spend pubkeys");
+}
+//-------------------------------------------------------------------------------------------------------------------
 void make_carrot_integrated_address_v1(const crypto::public_key &account_spend_pubkey,
     const crypto::public_key &primary_address_view_pubkey,
     const payment_id_t payment_id,
@@ -91,6 +91,17 @@ void make_carrot_subaddress_v1(const crypto::public_key &account_spend_pubkey,
     const std::uint32_t j_minor,
     CarrotDestinationV1 &destination_out);
 /**
+* brief: make_carrot_subaddress_spend_pubkeys_v1 - make many address spend pubkeys K^j_s at once
+* param: account_spend_pubkey - K_s
+* param: s_generate_address_dev - device for s_ga
+* param: subaddress_indices - {j_major, j_minor} for each address, {0, 0} gives K_s
+* outparam: address_spend_pubkeys_out - K^j_s, in the order of subaddress_indices
+*/
+void make_carrot_subaddress_spend_pubkeys_v1(const crypto::public_key &account_spend_pubkey,
+    const generate_address_secret_device &s_generate_address_dev,
+    const std::vector<std::pair<std::uint32_t, std::uint32_t>> &subaddress_indices,
+    std::vector<crypto::public_key> &address_spend_pubkeys_out);
+/**
 * brief: make_carrot_integrated_address_v1 - make a destination address
 * param: account_spend_pubkey - K_s
 * param: primary_address_view_pubkey - K^0_v = k_v G
@@ -34,6 +34,7 @@
 #include "core_types.h"
 #include "crypto/crypto.h"
 #include "mx25519.h"
+#include "span.h"
 
 //third party headers
 
@@ -41,6 +42,7 @@
 #include <cstdio>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 //forward declarations
 
@@ -121,6 +123,25 @@ struct view_incoming_key_device
      */
     virtual bool view_key_scalar_mult_x25519(const mx25519_pubkey &D, mx25519_pubkey &kvD) const = 0;
 
+    /**
+     * brief: view_key_scalar_mult_x25519_batch - view_key_scalar_mult_x25519() for many points at once
+     *   kvD_i = k_v * D_i
+     * param: D - {D_i, ...}
+     * outparam: kvD - {kvD_i, ...}, must already have one entry per point
+     * outparam: failed_out - one entry per point, true where the mult failed
+     * note: devices which can pipeline or share work between points should override this
+     */
+    virtual void view_key_scalar_mult_x25519_batch(const epee::span<const mx25519_pubkey> D,
+        const epee::span<mx25519_pubkey> kvD,
+        std::vector<bool> &failed_out) const
+    {
+        if (kvD.size() != D.size())
+            throw std::invalid_argument("view_key_scalar_mult_x25519_batch: wrong number of outputs");
+        failed_out.assign(D.size(), false);
+        for (std::size_t i = 0; i < D.size(); ++i)
+            failed_out[i] = !view_key_scalar_mult_x25519(D[i], kvD.data()[i]);
+    }
+
     /**
      * brief: make_janus_anchor_special - make a janus anchor for "special" enotes
      *   anchor_sp = H_16(D_e, input_context, Ko, k_v)
@@ -55,6 +55,14 @@ bool view_incoming_key_ram_borrowed_device::view_key_scalar_mult_x25519(const mx
     return make_carrot_uncontextualized_shared_key_receiver(m_k_view_incoming, D, kvD);
 }
 //-------------------------------------------------------------------------------------------------------------------
+void view_incoming_key_ram_borrowed_device::view_key_scalar_mult_x25519_batch(const epee::span<const mx25519_pubkey> D,
+    const epee::span<mx25519_pubkey> kvD,
+    std::vector<bool> &failed_out) const
+{
+    make_carrot_uncontextualized_shared_keys_receiver(m_k_view_incoming, D, kvD);
+    failed_out.assign(D.size(), false);
+}
+//-------------------------------------------------------------------------------------------------------------------
 void view_incoming_key_ram_borrowed_device::make_internal_return_privkey(const input_context_t &input_context,
     const crypto::public_key &onetime_address,
     crypto::secret_key &return_privkey_out) const
@@ -55,6 +55,10 @@ public:
     bool view_key_scalar_mult_x25519(const mx25519_pubkey &D,
         mx25519_pubkey &kvD) const override;
 
+    void view_key_scalar_mult_x25519_batch(const epee::span<const mx25519_pubkey> D,
+        const epee::span<mx25519_pubkey> kvD,
+        std::vector<bool> &failed_out) const override;
+
     void make_janus_anchor_special(const mx25519_pubkey &enote_ephemeral_pubkey,
         const input_context_t &input_context,
         const crypto::public_key &onetime_address,
@@ -37,16 +37,20 @@ extern "C"
 }
 #include "crypto/generators.h"
 #include "crypto/wallet/crypto.h"
+#include "exceptions.h"
 #include "hash_functions.h"
 #include "int-util.h"
 #include "misc_language.h"
+#include "misc_log_ex.h"
 #include "ringct/rctOps.h"
 #include "transcript_fixed.h"
 
 //third party headers
 
 //standard headers
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "carrot"
@@ -100,6 +104,44 @@ static OtherPid convert_payment_id(const Pid &v)
 }
 //-------------------------------------------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------------------------------------------
+// equal sized transcripts, keys and outputs for one of the derive_bytes_*_batch() functions
+//-------------------------------------------------------------------------------------------------------------------
+class batch_transcripts final
+{
+public:
+    explicit batch_transcripts(const std::size_t count):
+        m_transcript_size(0), m_keys(count), m_outputs(count)
+    {}
+
+    template <typename Transcript>
+    void set(const std::size_t i, const Transcript &transcript, const void *key, void *output)
+    {
+        if (m_buffer.empty())
+        {
+            m_transcript_size = transcript.size();
+            m_buffer.resize(m_transcript_size * m_keys.size());
+        }
+        memcpy(m_buffer.data() + i * m_transcript_size, transcript.data(), m_transcript_size);
+        m_keys[i] = key;
+        m_outputs[i] = output;
+    }
+
+    template <typename Derive>
+    void derive(Derive &&derive_batch)
+    {
+        std::vector<const void*> data(m_keys.size());
+        for (std::size_t i = 0; i < data.size(); ++i)
+            data[i] = m_buffer.data() + i * m_transcript_size;
+        derive_batch(data.size(), data.data(), m_transcript_size, m_keys.data(), m_outputs.data());
+    }
+
+private:
+    std::size_t m_transcript_size;
+    std::vector<unsigned char> m_buffer;
+    std::vector<const void*> m_keys;
+    std::vector<void*> m_outputs;
+};
+//-------------------------------------------------------------------------------------------------------------------
 void make_carrot_enote_ephemeral_privkey(const janus_anchor_t &anchor_norm,
     const input_context_t &input_context,
     const crypto::public_key &address_spend_pubkey,
@@ -169,6 +211,40 @@ bool make_carrot_uncontextualized_shared_key_receiver(const crypto::secret_key &
     return true;
 }
 //-------------------------------------------------------------------------------------------------------------------
+void make_carrot_uncontextualized_shared_keys_receiver(const crypto::secret_key &k_view,
+    const epee::span<const mx25519_pubkey> enote_ephemeral_pubkeys,
+    const epee::span<mx25519_pubkey> s_sender_receiver_unctx_out)
+{
+    const std::size_t count = enote_ephemeral_pubkeys.size();
+    CARROT_CHECK_AND_THROW(s_sender_receiver_unctx_out.size() == count,
+        missing_components, "make_carrot_uncontextualized_shared_keys_receiver: wrong number of outputs");
+
+    // every output of a tx shares D_e unless it has a subaddress destination, so sort the points to find all repeats
+    std::vector<std::size_t> order(count);
+    for (std::size_t i = 0; i < count; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b)
+        { return memcmp(enote_ephemeral_pubkeys[a].data, enote_ephemeral_pubkeys[b].data, sizeof(mx25519_pubkey)) < 0; });
+
+    // s_sr = k_v D_e
+    mx25519_pubkey *const s_sr_out = s_sender_receiver_unctx_out.data();
+    const mx25519_impl *impl = get_mx25519_impl();
+    const mx25519_privkey *k_view_x25519 = reinterpret_cast<const mx25519_privkey*>(&k_view);
+    for (std::size_t n = 0; n < count; ++n)
+    {
+        const std::size_t i = order[n];
+        if (n > 0 && memcmp(enote_ephemeral_pubkeys[i].data,
+                enote_ephemeral_pubkeys[order[n - 1]].data,
+                sizeof(mx25519_pubkey)) == 0)
+        {
+            s_sr_out[i] = s_sr_out[order[n - 1]];
+            continue;
+        }
+
+        mx25519_scmul_key(impl, &s_sr_out[i], k_view_x25519, &enote_ephemeral_pubkeys[i]);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------------
 bool make_carrot_uncontextualized_shared_key_sender(const crypto::secret_key &enote_ephemeral_privkey,
     const crypto::public_key &address_view_pubkey,
     mx25519_pubkey &s_sender_receiver_unctx_out)
@@ -201,6 +277,29 @@ void make_carrot_view_tag(const unsigned char s_sender_receiver_unctx[32],
     derive_bytes_3(transcript.data(), transcript.size(), s_sender_receiver_unctx, &view_tag_out);
 }
 //-------------------------------------------------------------------------------------------------------------------
+void make_carrot_view_tags(const epee::span<const mx25519_pubkey> s_sender_receiver_unctx,
+    const epee::span<const input_context_t> input_contexts,
+    const epee::span<const crypto::public_key> onetime_addresses,
+    const epee::span<view_tag_t> view_tags_out)
+{
+    const std::size_t count = s_sender_receiver_unctx.size();
+    CARROT_CHECK_AND_THROW(input_contexts.size() == count
+            && onetime_addresses.size() == count
+            && view_tags_out.size() == count,
+        missing_components, "make_carrot_view_tags: wrong number of inputs");
+
+    // vt = H_3(s_sr || input_context || Ko)
+    batch_transcripts transcripts(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        transcripts.set(i,
+            sp::make_fixed_transcript<CARROT_DOMAIN_SEP_VIEW_TAG>(input_contexts[i], onetime_addresses[i]),
+            s_sender_receiver_unctx[i].data,
+            view_tags_out.data() + i);
+    }
+    transcripts.derive(derive_bytes_3_batch);
+}
+//-------------------------------------------------------------------------------------------------------------------
 void make_sparc_return_privkey(const unsigned char s_sender_receiver_unctx[32],
     const input_context_t &input_context,
     const crypto::public_key &onetime_address,
@@ -270,6 +369,29 @@ void make_carrot_sender_receiver_secret(const unsigned char s_sender_receiver_un
     derive_bytes_32(transcript.data(), transcript.size(), s_sender_receiver_unctx, &s_sender_receiver_out);
 }
 //-------------------------------------------------------------------------------------------------------------------
+void make_carrot_sender_receiver_secrets(const epee::span<const mx25519_pubkey> s_sender_receiver_unctx,
+    const epee::span<const mx25519_pubkey> enote_ephemeral_pubkeys,
+    const epee::span<const input_context_t> input_contexts,
+    const epee::span<crypto::hash> s_sender_receiver_out)
+{
+    const std::size_t count = s_sender_receiver_unctx.size();
+    CARROT_CHECK_AND_THROW(enote_ephemeral_pubkeys.size() == count
+            && input_contexts.size() == count
+            && s_sender_receiver_out.size() == count,
+        missing_components, "make_carrot_sender_receiver_secrets: wrong number of inputs");
+
+    // s^ctx_sr = H_32(s_sr, D_e, input_context)
+    batch_transcripts transcripts(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        transcripts.set(i,
+            sp::make_fixed_transcript<CARROT_DOMAIN_SEP_SENDER_RECEIVER_SECRET>(enote_ephemeral_pubkeys[i], input_contexts[i]),
+            s_sender_receiver_unctx[i].data,
+            s_sender_receiver_out.data() + i);
+    }
+    transcripts.derive(derive_bytes_32_batch);
+}
+//-------------------------------------------------------------------------------------------------------------------
 void make_carrot_onetime_address_extension_g(const crypto::hash &s_sender_receiver,
     const rct::key &amount_commitment,
     crypto::secret_key &sender_extension_out)
@@ -378,6 +500,26 @@ void make_carrot_amount_encryption_mask(const crypto::hash &s_sender_receiver,
     derive_bytes_8(transcript.data(), transcript.size(), &s_sender_receiver, &amount_encryption_mask_out);
 }
 //-------------------------------------------------------------------------------------------------------------------
+void make_carrot_amount_encryption_masks(const epee::span<const crypto::hash> s_sender_receiver,
+    const epee::span<const crypto::public_key> onetime_addresses,
+    const epee::span<encrypted_amount_t> amount_encryption_masks_out)
+{
+    const std::size_t count = s_sender_receiver.size();
+    CARROT_CHECK_AND_THROW(onetime_addresses.size() == count && amount_encryption_masks_out.size() == count,
+        missing_components, "make_carrot_amount_encryption_masks: wrong number of inputs");
+
+    // m_a = H_8(s^ctx_sr, Ko)
+    batch_transcripts transcripts(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        transcripts.set(i,
+            sp::make_fixed_transcript<CARROT_DOMAIN_SEP_ENCRYPTION_MASK_AMOUNT>(onetime_addresses[i]),
+            &s_sender_receiver[i],
+            amount_encryption_masks_out.data() + i);
+    }
+    transcripts.derive(derive_bytes_8_batch);
+}
+//-------------------------------------------------------------------------------------------------------------------
 encrypted_amount_t encrypt_carrot_amount(const rct::xmr_amount amount,
     const crypto::hash &s_sender_receiver,
     const crypto::public_key &onetime_address)
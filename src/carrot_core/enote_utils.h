@@ -36,6 +36,7 @@
 #include "mx25519.h"
 #include "ringct/rctTypes.h"
 #include "device.h"
+#include "span.h"
 
 //third party headers
 
@@ -102,6 +103,18 @@ void make_carrot_enote_ephemeral_pubkey(const crypto::secret_key &enote_ephemera
 bool make_carrot_uncontextualized_shared_key_receiver(const crypto::secret_key &k_view,
     const mx25519_pubkey &enote_ephemeral_pubkey,
     mx25519_pubkey &s_sender_receiver_unctx_out);
+/**
+ * brief: make_carrot_uncontextualized_shared_keys_receiver - make_carrot_uncontextualized_shared_key_receiver() for
+ *        many enotes at once
+ *   s_sr_i = k_v D_e_i
+ * param: k_view - k_v
+ * param: enote_ephemeral_pubkeys - {D_e_i, ...}
+ * outparam: s_sender_receiver_unctx_out - {s_sr_i, ...}, must already have one entry per enote
+ * note: a D_e repeated anywhere in the batch is only multiplied once
+ */
+void make_carrot_uncontextualized_shared_keys_receiver(const crypto::secret_key &k_view,
+    const epee::span<const mx25519_pubkey> enote_ephemeral_pubkeys,
+    const epee::span<mx25519_pubkey> s_sender_receiver_unctx_out);
 /**
  * brief: make_carrot_uncontextualized_shared_key_sender - perform the sender-side ECDH exchange for Carrot enotes
  *   s_sr = d_e ConvertPointE(K^j_v)
@@ -126,6 +139,17 @@ void make_carrot_view_tag(const unsigned char s_sender_receiver_unctx[32],
     const crypto::public_key &onetime_address,
     view_tag_t &view_tag_out);
 /**
+* brief: make_carrot_view_tags - make_carrot_view_tag() for many enotes at once
+* param: s_sender_receiver_unctx - {s_sr, ...}
+* param: input_contexts - {input_context, ...}
+* param: onetime_addresses - {Ko, ...}
+* outparam: view_tags_out - {vt, ...}, must already have one entry per enote
+*/
+void make_carrot_view_tags(const epee::span<const mx25519_pubkey> s_sender_receiver_unctx,
+    const epee::span<const input_context_t> input_contexts,
+    const epee::span<const crypto::public_key> onetime_addresses,
+    const epee::span<view_tag_t> view_tags_out);
+/**
 * brief: make_sparc_return_privkey - return private key, given non-secret data
 *    k_return = H_32(s_sr || input_context || Ko)
 * param: s_sender_receiver_unctx - s_sr
@@ -191,6 +215,17 @@ void make_carrot_sender_receiver_secret(const unsigned char s_sender_receiver_un
     const input_context_t &input_context,
     crypto::hash &s_sender_receiver_out);
 /**
+* brief: make_carrot_sender_receiver_secrets - make_carrot_sender_receiver_secret() for many enotes at once
+* param: s_sender_receiver_unctx - {s_sr, ...}
+* param: enote_ephemeral_pubkeys - {D_e, ...}
+* param: input_contexts - {input_context, ...}
+* outparam: s_sender_receiver_out - {s^ctx_sr, ...}, must already have one entry per enote
+*/
+void make_carrot_sender_receiver_secrets(const epee::span<const mx25519_pubkey> s_sender_receiver_unctx,
+    const epee::span<const mx25519_pubkey> enote_ephemeral_pubkeys,
+    const epee::span<const input_context_t> input_contexts,
+    const epee::span<crypto::hash> s_sender_receiver_out);
+/**
 * brief: make_carrot_onetime_address_extension_g - extension for transforming a receiver's spendkey into an
 *        enote one-time address
 *    k^o_g = H_n("..g..", s^ctx_sr, C_a)
@@ -291,6 +326,15 @@ void make_carrot_amount_encryption_mask(const crypto::hash &s_sender_receiver,
     const crypto::public_key &onetime_address,
     encrypted_amount_t &amount_encryption_mask_out);
 /**
+* brief: make_carrot_amount_encryption_masks - make_carrot_amount_encryption_mask() for many enotes at once
+* param: s_sender_receiver - {s^ctx_sr, ...}
+* param: onetime_addresses - {Ko, ...}
+* outparam: amount_encryption_masks_out - {m_a, ...}, must already have one entry per enote
+*/
+void make_carrot_amount_encryption_masks(const epee::span<const crypto::hash> s_sender_receiver,
+    const epee::span<const crypto::public_key> onetime_addresses,
+    const epee::span<encrypted_amount_t> amount_encryption_masks_out);
+/**
 * brief: encrypt_carrot_amount - encrypt an amount for an enote
 *   a_enc = a XOR m_a
 * param: amount - a
@@ -36,11 +36,16 @@ extern "C"
 }
 #include "crypto/blake2b.h"
 #include "exceptions.h"
+#include "int-util.h"
+#include "memwipe.h"
 #include "misc_log_ex.h"
 
 //third party headers
 
 //standard headers
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "carrot"
@@ -66,6 +71,175 @@ static void hash_base(const void *derivation_key,  //32 bytes
         crypto_function_failed, "carrot hash base: blake2b failed");
 }
 //-------------------------------------------------------------------------------------------------------------------
+// keyed Blake2b over HASH_BATCH_LANES independent messages of equal length
+// - the state is stored lane-major (word[i][lane]) so every step of the compression function is the same operation
+//   over adjacent lanes, which the compiler turns into SIMD code wherever the target has it
+//-------------------------------------------------------------------------------------------------------------------
+static constexpr std::size_t HASH_BATCH_LANES = 4;
+static constexpr std::size_t BLAKE2B_BLOCK_BYTES = 128;
+
+static const std::uint64_t s_blake2b_iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+
+static const unsigned char s_blake2b_sigma[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}};
+
+using lanes_t = std::uint64_t[HASH_BATCH_LANES];
+
+static inline std::uint64_t rotr64(const std::uint64_t w, const unsigned int c)
+{
+    return (w >> c) | (w << (64 - c));
+}
+
+static inline void lanes_g(lanes_t &a, lanes_t &b, lanes_t &c, lanes_t &d, const lanes_t &x, const lanes_t &y)
+{
+    for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+    {
+        a[l] = a[l] + b[l] + x[l];
+        d[l] = rotr64(d[l] ^ a[l], 32);
+        c[l] = c[l] + d[l];
+        b[l] = rotr64(b[l] ^ c[l], 24);
+        a[l] = a[l] + b[l] + y[l];
+        d[l] = rotr64(d[l] ^ a[l], 16);
+        c[l] = c[l] + d[l];
+        b[l] = rotr64(b[l] ^ c[l], 63);
+    }
+}
+
+static void blake2b_compress_lanes(lanes_t (&h)[8],
+    const lanes_t (&m)[16],
+    const std::uint64_t bytes_counted,
+    const bool last_block)
+{
+    lanes_t v[16];
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+        for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+        {
+            v[i][l] = h[i][l];
+            v[i + 8][l] = s_blake2b_iv[i];
+        }
+    }
+    for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+    {
+        v[12][l] ^= bytes_counted;
+        v[14][l] ^= last_block ? ~0ULL : 0;
+    }
+
+    for (std::size_t r = 0; r < 12; ++r)
+    {
+        const unsigned char *sigma = s_blake2b_sigma[r];
+        lanes_g(v[0], v[4], v[8], v[12], m[sigma[0]], m[sigma[1]]);
+        lanes_g(v[1], v[5], v[9], v[13], m[sigma[2]], m[sigma[3]]);
+        lanes_g(v[2], v[6], v[10], v[14], m[sigma[4]], m[sigma[5]]);
+        lanes_g(v[3], v[7], v[11], v[15], m[sigma[6]], m[sigma[7]]);
+        lanes_g(v[0], v[5], v[10], v[15], m[sigma[8]], m[sigma[9]]);
+        lanes_g(v[1], v[6], v[11], v[12], m[sigma[10]], m[sigma[11]]);
+        lanes_g(v[2], v[7], v[8], v[13], m[sigma[12]], m[sigma[13]]);
+        lanes_g(v[3], v[4], v[9], v[14], m[sigma[14]], m[sigma[15]]);
+    }
+
+    for (std::size_t i = 0; i < 8; ++i)
+        for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+            h[i][l] ^= v[i][l] ^ v[i + 8][l];
+
+    memwipe(v, sizeof(v));
+}
+
+static void load_block_lanes(lanes_t (&m)[16],
+    const void *const *data,
+    const std::size_t offset,
+    const std::size_t length)
+{
+    unsigned char block[BLAKE2B_BLOCK_BYTES];
+    for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+    {
+        memset(block, 0, sizeof(block));
+        memcpy(block, static_cast<const unsigned char*>(data[l]) + offset, length);
+        for (std::size_t i = 0; i < 16; ++i)
+        {
+            std::uint64_t word;
+            memcpy(&word, block + 8 * i, 8);
+            m[i][l] = SWAP64LE(word);
+        }
+    }
+    memwipe(block, sizeof(block));
+}
+
+static void hash_base_lanes(const void *const *derivation_keys, //32 bytes each
+    const void *const *data,
+    const std::size_t data_length,
+    void *const *hashes_out,
+    const std::size_t out_length)
+{
+    lanes_t h[8];
+    lanes_t m[16];
+    for (std::size_t i = 0; i < 8; ++i)
+        for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+            h[i][l] = s_blake2b_iv[i];
+    for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+        h[0][l] ^= 0x01010000ULL ^ (32ULL << 8) ^ out_length;
+
+    // the key, zero-padded, is the first block
+    load_block_lanes(m, derivation_keys, 0, 32);
+    std::uint64_t bytes_counted = BLAKE2B_BLOCK_BYTES;
+    blake2b_compress_lanes(h, m, bytes_counted, data_length == 0);
+
+    for (std::size_t offset = 0; offset < data_length; offset += BLAKE2B_BLOCK_BYTES)
+    {
+        const std::size_t length = std::min(BLAKE2B_BLOCK_BYTES, data_length - offset);
+        load_block_lanes(m, data, offset, length);
+        bytes_counted += length;
+        blake2b_compress_lanes(h, m, bytes_counted, offset + length == data_length);
+    }
+
+    unsigned char out[64];
+    for (std::size_t l = 0; l < HASH_BATCH_LANES; ++l)
+    {
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            const std::uint64_t word = SWAP64LE(h[i][l]);
+            memcpy(out + 8 * i, &word, 8);
+        }
+        memcpy(hashes_out[l], out, out_length);
+    }
+
+    memwipe(h, sizeof(h));
+    memwipe(m, sizeof(m));
+    memwipe(out, sizeof(out));
+}
+//-------------------------------------------------------------------------------------------------------------------
+// H_x[k_i](data_i) for many keyed messages of the same length
+//-------------------------------------------------------------------------------------------------------------------
+static void hash_base_batch(const std::size_t count,
+    const void *const *derivation_keys, //32 bytes each
+    const void *const *data,
+    const std::size_t data_length,
+    void *const *hashes_out,
+    const std::size_t out_length)
+{
+    CARROT_CHECK_AND_THROW(out_length > 0 && out_length <= 64,
+        crypto_function_failed, "carrot hash base batch: bad output length");
+
+    std::size_t i = 0;
+    for (; i + HASH_BATCH_LANES <= count; i += HASH_BATCH_LANES)
+        hash_base_lanes(derivation_keys + i, data + i, data_length, hashes_out + i, out_length);
+    for (; i < count; ++i)
+        hash_base(derivation_keys[i], data[i], data_length, hashes_out[i], out_length);
+}
+//-------------------------------------------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------------------------------------------
 void derive_bytes_3(const void *data, const std::size_t data_length, const void *key, void *hash_out)
 {
@@ -107,4 +281,31 @@ void derive_scalar(const void *data, const std::size_t data_length, const void *
     memcpy(hash_out, temp, 32);
 }
 //-------------------------------------------------------------------------------------------------------------------
+void derive_bytes_3_batch(const std::size_t count,
+    const void *const *data,
+    const std::size_t data_length,
+    const void *const *keys,
+    void *const *hashes_out)
+{
+    hash_base_batch(count, keys, data, data_length, hashes_out, 3);
+}
+//-------------------------------------------------------------------------------------------------------------------
+void derive_bytes_8_batch(const std::size_t count,
+    const void *const *data,
+    const std::size_t data_length,
+    const void *const *keys,
+    void *const *hashes_out)
+{
+    hash_base_batch(count, keys, data, data_length, hashes_out, 8);
+}
+//-------------------------------------------------------------------------------------------------------------------
+void derive_bytes_32_batch(const std::size_t count,
+    const void *const *data,
+    const std::size_t data_length,
+    const void *const *keys,
+    void *const *hashes_out)
+{
+    hash_base_batch(count, keys, data, data_length, hashes_out, 32);
+}
+//-------------------------------------------------------------------------------------------------------------------
 } //namespace carrot
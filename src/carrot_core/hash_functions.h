@@ -56,4 +56,22 @@ void derive_bytes_64(const void *data, const std::size_t data_length, const void
 /// H_n(x): unclamped Curve25519/Ed25519 group scalar output (32 bytes)
 void derive_scalar(const void *data, const std::size_t data_length, const void *key, void *hash_out);
 
+/// batch variants: hashes_out[i] = H_x[keys[i]](data[i]) for count messages of data_length bytes each, all keyed
+/// with 32 bytes, computed several messages at a time
+void derive_bytes_3_batch(const std::size_t count,
+    const void *const *data,
+    const std::size_t data_length,
+    const void *const *keys,
+    void *const *hashes_out);
+void derive_bytes_8_batch(const std::size_t count,
+    const void *const *data,
+    const std::size_t data_length,
+    const void *const *keys,
+    void *const *hashes_out);
+void derive_bytes_32_batch(const std::size_t count,
+    const void *const *data,
+    const std::size_t data_length,
+    const void *const *keys,
+    void *const *hashes_out);
+
 } //namespace carrot
@@ -34,6 +34,7 @@
 //local headers
 #include "destination.h"
 #include "enote_utils.h"
+#include "exceptions.h"
 #include "ringct/rctOps.h"
 #include "scan_unsafe.h"
 
@@ -458,6 +459,97 @@ bool try_scan_carrot_enote_external_receiver(const CarrotEnoteV1 &enote,
     return true;
 }
 //-------------------------------------------------------------------------------------------------------------------
+void try_scan_carrot_enotes_external_receiver(const epee::span<const CarrotEnoteV1> enotes,
+    const std::optional<encrypted_payment_id_t> &encrypted_payment_id,
+    const epee::span<const crypto::public_key> main_address_spend_pubkeys,
+    const view_incoming_key_device &k_view_dev,
+    std::vector<std::optional<CarrotEnoteExternalScanResultV1>> &results_out)
+{
+    // s_sr = k_v D_e
+    // one call for the whole batch, so the device can share work between enotes, eg. ones with the same D_e
+    std::vector<mx25519_pubkey> enote_ephemeral_pubkeys;
+    enote_ephemeral_pubkeys.reserve(enotes.size());
+    for (const CarrotEnoteV1 &enote : enotes)
+        enote_ephemeral_pubkeys.push_back(enote.enote_ephemeral_pubkey);
+    std::vector<mx25519_pubkey> s_sender_receiver_unctx(enotes.size());
+    std::vector<bool> ecdh_failed;
+    k_view_dev.view_key_scalar_mult_x25519_batch(epee::to_span(enote_ephemeral_pubkeys),
+        epee::to_mut_span(s_sender_receiver_unctx),
+        ecdh_failed);
+
+    try_scan_carrot_enotes_external_receiver(enotes,
+        epee::to_span(s_sender_receiver_unctx),
+        encrypted_payment_id,
+        main_address_spend_pubkeys,
+        k_view_dev,
+        results_out);
+
+    // a failed point decompression can't produce a valid match, but don't trust whatever got left in s_sr
+    for (std::size_t i = 0; i < enotes.size(); ++i)
+        if (ecdh_failed[i])
+            results_out[i].reset();
+}
+//-------------------------------------------------------------------------------------------------------------------
+void try_scan_carrot_enotes_external_receiver(const epee::span<const CarrotEnoteV1> enotes,
+    const epee::span<const mx25519_pubkey> s_sender_receiver_unctx,
+    const std::optional<encrypted_payment_id_t> &encrypted_payment_id,
+    const epee::span<const crypto::public_key> main_address_spend_pubkeys,
+    const view_incoming_key_device &k_view_dev,
+    std::vector<std::optional<CarrotEnoteExternalScanResultV1>> &results_out)
+{
+    CARROT_CHECK_AND_THROW(s_sender_receiver_unctx.size() == enotes.size(),
+        missing_components, "try_scan_carrot_enotes_external_receiver: wrong number of shared secrets");
+
+    results_out.clear();
+    results_out.resize(enotes.size());
+
+    // 1. view tag filter: if vt' != vt, then skip
+    // this is the only work done for the vast majority of enotes, so the view tags are hashed as one batch
+    std::vector<input_context_t> input_contexts;
+    std::vector<crypto::public_key> onetime_addresses;
+    input_contexts.reserve(enotes.size());
+    onetime_addresses.reserve(enotes.size());
+    for (const CarrotEnoteV1 &enote : enotes)
+    {
+        input_contexts.push_back(make_carrot_input_context(enote.tx_first_key_image));
+        onetime_addresses.push_back(enote.onetime_address);
+    }
+    std::vector<view_tag_t> nominal_view_tags(enotes.size());
+    make_carrot_view_tags(s_sender_receiver_unctx,
+        epee::to_span(input_contexts),
+        epee::to_span(onetime_addresses),
+        epee::to_mut_span(nominal_view_tags));
+
+    std::vector<std::size_t> view_tag_matches;
+    view_tag_matches.reserve(enotes.size() / 128 + 1);
+    for (std::size_t i = 0; i < enotes.size(); ++i)
+    {
+        if (nominal_view_tags[i] == enotes[i].view_tag)
+            view_tag_matches.push_back(i);
+    }
+
+    // 2. full scan process for the enotes which survived the filter
+    for (const std::size_t i : view_tag_matches)
+    {
+        CarrotEnoteExternalScanResultV1 res;
+        if (!try_scan_carrot_enote_external_receiver(enotes[i],
+                encrypted_payment_id,
+                s_sender_receiver_unctx[i],
+                main_address_spend_pubkeys,
+                k_view_dev,
+                res.sender_extension_g,
+                res.sender_extension_t,
+                res.address_spend_pubkey,
+                res.amount,
+                res.amount_blinding_factor,
+                res.payment_id,
+                res.enote_type))
+            continue;
+
+        results_out[i] = res;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------------
 bool try_scan_carrot_enote_internal_receiver(const CarrotEnoteV1 &enote,
     carrot::carrot_and_legacy_account &account,
     crypto::secret_key &sender_extension_g_out,
@@ -476,6 +568,30 @@ bool try_scan_carrot_enote_internal_receiver(const CarrotEnoteV1 &enote,
     // assume that the enote is not a return output
     is_return_out = false;
 
+    // check for known return addresses first: the map lookup is cheaper than the internal view tag
+    if (account.get_return_output_map_ref().count(enote.onetime_address))
+    {
+        // scan the return output
+        if (scan_return_output(
+                enote.onetime_address,
+                enote.enote_ephemeral_pubkey,
+                enote.view_tag,
+                enote.anchor_enc,
+                enote.amount_enc,
+                enote.amount_commitment,
+                input_context,
+                account,
+                address_spend_pubkey_out,
+                amount_out,
+                amount_blinding_factor_out))
+        {
+            // if we come here, we have a return output
+            is_return_out = true;
+            return_address_out = enote.onetime_address;
+            return true;
+        }
+    }
+
     // vt = H_3(s_sr || input_context || Ko)
     view_tag_t nominal_view_tag;
     account.s_view_balance_dev.make_internal_view_tag(input_context, enote.onetime_address, nominal_view_tag);
@@ -542,30 +658,7 @@ bool try_scan_carrot_enote_internal_receiver(const CarrotEnoteV1 &enote,
         return true;
     }
 
-    // check for known return addresses
-    const auto &return_map = account.get_return_output_map_ref();
-    if (return_map.find(enote.onetime_address) == return_map.end())
-        return false;
-
-    // scan the return output
-    if (!scan_return_output(
-            enote.onetime_address,
-            enote.enote_ephemeral_pubkey,
-            enote.view_tag,
-            enote.anchor_enc,
-            enote.amount_enc,
-            enote.amount_commitment,
-            carrot::make_carrot_input_context(enote.tx_first_key_image),
-            account,
-            address_spend_pubkey_out,
-            amount_out,
-            amount_blinding_factor_out)) 
-        return false;
-
-    // if we come here, we have a return output
-    is_return_out = true;
-    return_address_out = enote.onetime_address;
-    return true;
+    return false;
 }
 //-------------------------------------------------------------------------------------------------------------------
 } //namespace carrot
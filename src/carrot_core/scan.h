@@ -45,6 +45,7 @@
 
 //standard headers
 #include <optional>
+#include <vector>
 
 //forward declarations
 namespace carrot { struct CarrotDestinationV1; }
@@ -165,6 +166,49 @@ bool try_scan_carrot_enote_external_receiver(const CarrotEnoteV1 &enote,
     crypto::secret_key &amount_blinding_factor_out,
     payment_id_t &payment_id_out,
     CarrotEnoteType &enote_type_out);
+/**
+ * brief: CarrotEnoteExternalScanResultV1 - information recovered from one external enote by a batch scan
+ */
+struct CarrotEnoteExternalScanResultV1
+{
+    /// k^g_o
+    crypto::secret_key sender_extension_g;
+    /// k^t_o
+    crypto::secret_key sender_extension_t;
+    /// K^j_s
+    crypto::public_key address_spend_pubkey;
+    /// a
+    rct::xmr_amount amount;
+    /// k_a
+    crypto::secret_key amount_blinding_factor;
+    /// pid
+    payment_id_t payment_id;
+    /// enote_type
+    CarrotEnoteType enote_type;
+};
+/**
+ * brief: try_scan_carrot_enotes_external_receiver - attempt scan process on many external enotes at once
+ *   1. s_sr = k_v D_e for each enote, reusing the result for consecutive enotes which share D_e
+ *   2. drop every enote whose view tag doesn't match
+ *   3. do the full external scan process for the enotes which remain
+ * param: enotes - enotes to scan, all from the same transaction if encrypted_payment_id is set
+ * param: s_sender_receiver_unctx - {s_sr, ...}, one per enote
+ * param: encrypted_payment_id - pid_enc
+ * param: main_address_spend_pubkeys - {K^0_s, ...}
+ * param: k_view_dev -
+ * outparam: results_out - one entry per enote, set iff the scan process succeeded for that enote
+ */
+void try_scan_carrot_enotes_external_receiver(const epee::span<const CarrotEnoteV1> enotes,
+    const std::optional<encrypted_payment_id_t> &encrypted_payment_id,
+    const epee::span<const crypto::public_key> main_address_spend_pubkeys,
+    const view_incoming_key_device &k_view_dev,
+    std::vector<std::optional<CarrotEnoteExternalScanResultV1>> &results_out);
+void try_scan_carrot_enotes_external_receiver(const epee::span<const CarrotEnoteV1> enotes,
+    const epee::span<const mx25519_pubkey> s_sender_receiver_unctx,
+    const std::optional<encrypted_payment_id_t> &encrypted_payment_id,
+    const epee::span<const crypto::public_key> main_address_spend_pubkeys,
+    const view_incoming_key_device &k_view_dev,
+    std::vector<std::optional<CarrotEnoteExternalScanResultV1>> &results_out);
 /**
  * brief: try_scan_carrot_enote_internal_receiver - attempt scan process on internal enote
  * param: enote -
@@ -50,6 +50,17 @@
 
 namespace carrot {
 
+  namespace {
+    // c = H_n(R || K_o), hashed straight from the stack; the same bytes rct::hash_to_scalar(keyV{R, K_o}) hashes
+    rct::key sparc_challenge(const rct::key &R, const rct::key &K_o) {
+      const std::array<rct::key, 2> keys{R, K_o};
+      static_assert(sizeof(keys) == 2 * sizeof(rct::key), "keys must be contiguous");
+      rct::key challenge;
+      rct::hash_to_scalar(challenge, keys.data(), sizeof(keys));
+      return challenge;
+    }
+  }
+
   // Optimized function to hash a vector of keys into a scalar
   rct::key hash_to_scalar(std::vector<rct::key>& keys) {
     
@@ -91,8 +102,7 @@ namespace carrot {
     commitment = rct::addKeys(commitment_G, commitment_T); // R = r_xG + r_yT
     
     // Step 3: Calculate the challenge scalar
-    std::vector<rct::key> keys{commitment, K_o};
-    rct::key challenge = rct::hash_to_scalar(keys); // c = H(R || K_o)
+    rct::key challenge = sparc_challenge(commitment, K_o); // c = H(R || K_o)
     
     // Step 4: Calculate responses
     rct::key response_x;
@@ -117,8 +127,7 @@ namespace carrot {
   bool verify_sparc_spend_authority_proof(const rct::zk_proof &proof, const rct::key &K_o) {
     
     // Step 1: calculate the challenge
-    std::vector<rct::key> keys{proof.R, K_o};
-    rct::key recomputed_challenge = rct::hash_to_scalar(keys);
+    rct::key recomputed_challenge = sparc_challenge(proof.R, K_o);
     
     // Step 2: Calculate z_xG + x_yT
     rct::key z_xG  = rct::scalarmultBase(proof.z1); // z1 * G
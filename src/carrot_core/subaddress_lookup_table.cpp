@@ -0,0 +1,293 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//paired header
+#include "subaddress_lookup_table.h"
+
+//local headers
+#include "hash_functions.h"
+#include "int-util.h"
+#include "misc_log_ex.h"
+#include "transcript_fixed.h"
+
+//third party headers
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+//standard headers
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "carrot"
+
+namespace carrot
+{
+static constexpr const unsigned char TABLE_DOMAIN_SEP_KEY[] = "Salvium subaddress table key";
+static constexpr const unsigned char TABLE_DOMAIN_SEP_TAG[] = "Salvium subaddress table tag";
+static constexpr const unsigned char TABLE_DOMAIN_SEP_MASK[] = "Salvium subaddress table mask";
+static constexpr const unsigned char TABLE_DOMAIN_SEP_CHECK[] = "Salvium subaddress table check";
+
+static constexpr const char TABLE_MAGIC[8] = {'S', 'A', 'L', 'S', 'U', 'B', 'T', '1'};
+// magic[8] || check[8] || slot count || entry count || legacy count || extended count || lookahead (4+4) || reserved[8]
+static constexpr std::size_t TABLE_HEADER_SIZE = 64;
+static constexpr std::size_t TABLE_TAG_SIZE = 8;
+// masked K^j_s[32] || j_major (4) || j_minor (4) || derive type (1) || is return (1) || reserved[6]
+static constexpr std::size_t TABLE_PAYLOAD_SIZE = 48;
+static constexpr std::uint64_t TABLE_MIN_SLOTS = 16;
+
+//-------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------
+static std::uint64_t load_u64(const unsigned char *p)
+{
+    std::uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return SWAP64LE(v);
+}
+//-------------------------------------------------------------------------------------------------------------------
+static std::uint32_t load_u32(const unsigned char *p)
+{
+    std::uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return SWAP32LE(v);
+}
+//-------------------------------------------------------------------------------------------------------------------
+static void store_u64(unsigned char *p, std::uint64_t v)
+{
+    v = SWAP64LE(v);
+    memcpy(p, &v, sizeof(v));
+}
+//-------------------------------------------------------------------------------------------------------------------
+static void store_u32(unsigned char *p, std::uint32_t v)
+{
+    v = SWAP32LE(v);
+    memcpy(p, &v, sizeof(v));
+}
+//-------------------------------------------------------------------------------------------------------------------
+static std::uint64_t make_table_tag(const crypto::secret_key &table_key, const crypto::public_key &address_spend_pubkey)
+{
+    // tag = H_8[k](K^j_s), with 0 reserved for empty slots
+    const auto transcript = sp::make_fixed_transcript<TABLE_DOMAIN_SEP_TAG>(address_spend_pubkey);
+    unsigned char tag_bytes[TABLE_TAG_SIZE];
+    derive_bytes_8(transcript.data(), transcript.size(), &table_key, tag_bytes);
+    const std::uint64_t tag = load_u64(tag_bytes);
+    return tag ? tag : 1;
+}
+//-------------------------------------------------------------------------------------------------------------------
+static void make_table_mask(const crypto::secret_key &table_key, const std::uint64_t tag, crypto::public_key &mask_out)
+{
+    // mask = H_32[k](tag)
+    const auto transcript = sp::make_fixed_transcript<TABLE_DOMAIN_SEP_MASK>(tag);
+    derive_bytes_32(transcript.data(), transcript.size(), &table_key, &mask_out);
+}
+//-------------------------------------------------------------------------------------------------------------------
+static void make_table_check(const crypto::secret_key &table_key, unsigned char check_out[8])
+{
+    const auto transcript = sp::make_fixed_transcript<TABLE_DOMAIN_SEP_CHECK>();
+    derive_bytes_8(transcript.data(), transcript.size(), &table_key, check_out);
+}
+//-------------------------------------------------------------------------------------------------------------------
+static void unmask_payload(const crypto::secret_key &table_key,
+    const std::uint64_t tag,
+    const unsigned char *payload,
+    crypto::public_key &address_spend_pubkey_out,
+    subaddress_index_extended &subaddr_index_out)
+{
+    crypto::public_key mask;
+    make_table_mask(table_key, tag, mask);
+    for (std::size_t i = 0; i < sizeof(address_spend_pubkey_out.data); ++i)
+        address_spend_pubkey_out.data[i] = payload[i] ^ mask.data[i];
+
+    subaddr_index_out.index.major = load_u32(payload + 32);
+    subaddr_index_out.index.minor = load_u32(payload + 36);
+    subaddr_index_out.derive_type = static_cast<AddressDeriveType>(payload[40]);
+    subaddr_index_out.is_return_spend_key = payload[41] != 0;
+}
+//-------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------
+subaddress_lookup_table::~subaddress_lookup_table()
+{
+    memwipe(&m_table_key, sizeof(m_table_key));
+}
+//-------------------------------------------------------------------------------------------------------------------
+bool subaddress_lookup_table::write(const std::string &path,
+    const std::unordered_map<crypto::public_key, subaddress_index_extended> &entries,
+    const crypto::secret_key &table_key,
+    const fingerprint_t &fingerprint)
+{
+    // keep the load factor at or below 1/2 so that probe sequences stay short
+    std::uint64_t slot_count = TABLE_MIN_SLOTS;
+    while (slot_count < 2 * entries.size())
+        slot_count *= 2;
+    const std::uint64_t slot_mask = slot_count - 1;
+
+    std::vector<unsigned char> buf(TABLE_HEADER_SIZE + slot_count * (TABLE_TAG_SIZE + TABLE_PAYLOAD_SIZE), 0);
+    unsigned char *header = buf.data();
+    unsigned char *tags = header + TABLE_HEADER_SIZE;
+    unsigned char *payloads = tags + slot_count * TABLE_TAG_SIZE;
+
+    memcpy(header, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    make_table_check(table_key, header + 8);
+    store_u64(header + 16, slot_count);
+    store_u64(header + 24, entries.size());
+    store_u64(header + 32, fingerprint.legacy_subaddress_count);
+    store_u64(header + 40, fingerprint.extended_subaddress_count);
+    store_u32(header + 48, fingerprint.lookahead_major);
+    store_u32(header + 52, fingerprint.lookahead_minor);
+
+    for (const auto &entry : entries)
+    {
+        const std::uint64_t tag = make_table_tag(table_key, entry.first);
+        std::uint64_t slot = tag & slot_mask;
+        while (load_u64(tags + slot * TABLE_TAG_SIZE) != 0)
+            slot = (slot + 1) & slot_mask;
+
+        store_u64(tags + slot * TABLE_TAG_SIZE, tag);
+        unsigned char *payload = payloads + slot * TABLE_PAYLOAD_SIZE;
+        crypto::public_key mask;
+        make_table_mask(table_key, tag, mask);
+        for (std::size_t i = 0; i < sizeof(mask.data); ++i)
+            payload[i] = entry.first.data[i] ^ mask.data[i];
+        store_u32(payload + 32, entry.second.index.major);
+        store_u32(payload + 36, entry.second.index.minor);
+        payload[40] = static_cast<unsigned char>(entry.second.derive_type);
+        payload[41] = entry.second.is_return_spend_key ? 1 : 0;
+    }
+
+    std::ofstream ostr;
+    ostr.open(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    ostr.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    ostr.close();
+    return ostr.good();
+}
+//-------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const subaddress_lookup_table> subaddress_lookup_table::open(const std::string &path,
+    const crypto::secret_key &table_key,
+    const fingerprint_t &fingerprint)
+{
+    std::shared_ptr<subaddress_lookup_table> table(new subaddress_lookup_table());
+    try
+    {
+        boost::interprocess::file_mapping mapping(path.c_str(), boost::interprocess::read_only);
+        table->m_region.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+    }
+    catch (const std::exception &e)
+    {
+        MDEBUG("Subaddress lookup table " << path << " not opened: " << e.what());
+        return nullptr;
+    }
+
+    const unsigned char *header = static_cast<const unsigned char*>(table->m_region->get_address());
+    const std::size_t file_size = table->m_region->get_size();
+    if (file_size < TABLE_HEADER_SIZE || memcmp(header, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0)
+    {
+        MWARNING("Subaddress lookup table " << path << " is malformed, ignoring it");
+        return nullptr;
+    }
+
+    unsigned char check[8];
+    make_table_check(table_key, check);
+    if (memcmp(header + 8, check, sizeof(check)) != 0)
+    {
+        MWARNING("Subaddress lookup table " << path << " belongs to another account, ignoring it");
+        return nullptr;
+    }
+
+    const std::uint64_t slot_count = load_u64(header + 16);
+    const std::uint64_t entry_count = load_u64(header + 24);
+    if (slot_count < TABLE_MIN_SLOTS || (slot_count & (slot_count - 1)) != 0 || entry_count > slot_count / 2 ||
+        file_size != TABLE_HEADER_SIZE + slot_count * (TABLE_TAG_SIZE + TABLE_PAYLOAD_SIZE))
+    {
+        MWARNING("Subaddress lookup table " << path << " is malformed, ignoring it");
+        return nullptr;
+    }
+
+    if (load_u64(header + 32) != fingerprint.legacy_subaddress_count ||
+        load_u64(header + 40) != fingerprint.extended_subaddress_count ||
+        load_u32(header + 48) != fingerprint.lookahead_major ||
+        load_u32(header + 52) != fingerprint.lookahead_minor)
+    {
+        MDEBUG("Subaddress lookup table " << path << " is stale, ignoring it");
+        return nullptr;
+    }
+
+    table->m_table_key = table_key;
+    table->m_tags = header + TABLE_HEADER_SIZE;
+    table->m_payloads = table->m_tags + slot_count * TABLE_TAG_SIZE;
+    table->m_slot_mask = slot_count - 1;
+    table->m_entry_count = entry_count;
+    return table;
+}
+//-------------------------------------------------------------------------------------------------------------------
+std::optional<subaddress_index_extended> subaddress_lookup_table::find(const crypto::public_key &address_spend_pubkey) const
+{
+    const std::uint64_t tag = make_table_tag(m_table_key, address_spend_pubkey);
+    std::uint64_t slot = tag & m_slot_mask;
+    for (std::uint64_t probes = 0; probes <= m_slot_mask; ++probes, slot = (slot + 1) & m_slot_mask)
+    {
+        const std::uint64_t slot_tag = load_u64(m_tags + slot * TABLE_TAG_SIZE);
+        if (slot_tag == 0)
+            return std::nullopt;
+        if (slot_tag != tag)
+            continue;
+
+        // a 64-bit tag can collide, so compare the full key
+        crypto::public_key stored_pubkey;
+        subaddress_index_extended subaddr_index;
+        unmask_payload(m_table_key, tag, m_payloads + slot * TABLE_PAYLOAD_SIZE, stored_pubkey, subaddr_index);
+        if (stored_pubkey == address_spend_pubkey)
+            return subaddr_index;
+    }
+    return std::nullopt;
+}
+//-------------------------------------------------------------------------------------------------------------------
+void subaddress_lookup_table::for_each(
+    const std::function<void(const crypto::public_key&, const subaddress_index_extended&)> &f) const
+{
+    for (std::uint64_t slot = 0; slot <= m_slot_mask; ++slot)
+    {
+        const std::uint64_t tag = load_u64(m_tags + slot * TABLE_TAG_SIZE);
+        if (tag == 0)
+            continue;
+
+        crypto::public_key address_spend_pubkey;
+        subaddress_index_extended subaddr_index;
+        unmask_payload(m_table_key, tag, m_payloads + slot * TABLE_PAYLOAD_SIZE, address_spend_pubkey, subaddr_index);
+        f(address_spend_pubkey, subaddr_index);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------------
+void make_subaddress_lookup_table_key(const crypto::secret_key &k_view, crypto::secret_key &table_key_out)
+{
+    // k = H_32[k_v]()
+    const auto transcript = sp::make_fixed_transcript<TABLE_DOMAIN_SEP_KEY>();
+    derive_bytes_32(transcript.data(), transcript.size(), &k_view, &table_key_out);
+}
+//-------------------------------------------------------------------------------------------------------------------
+} //namespace carrot
@@ -0,0 +1,119 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+//local headers
+#include "carrot_impl/subaddress_index.h"
+#include "crypto/crypto.h"
+
+//third party headers
+
+//standard headers
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+//forward declarations
+namespace boost { namespace interprocess { class mapped_region; } }
+
+namespace carrot
+{
+/**
+ * brief: subaddress_lookup_table - read-only, memory-mapped open-addressing table K^j_s -> j
+ *
+ * The file holds an array of 8-byte tags followed by an array of payloads, so that a lookup probes
+ * consecutive tags and touches one payload per match. Tags are H_8[k](K^j_s) and the stored K^j_s are
+ * masked with H_32[k](tag), where k is derived from the account's view key, so the file does not
+ * link the wallet's subaddresses together. Opening the table maps the file and checks its header;
+ * nothing is read or hashed per entry.
+ */
+class subaddress_lookup_table
+{
+public:
+    /// what the table was built from: a table is only opened if its fingerprint matches
+    struct fingerprint_t
+    {
+        std::uint64_t legacy_subaddress_count;
+        std::uint64_t extended_subaddress_count;
+        std::uint32_t lookahead_major;
+        std::uint32_t lookahead_minor;
+    };
+
+    ~subaddress_lookup_table();
+
+    /**
+    * brief: write - build a table for the given entries and write it to a file
+    * param: path -
+    * param: entries - K^j_s -> j
+    * param: table_key - k
+    * param: fingerprint -
+    * return: true on success
+    */
+    static bool write(const std::string &path,
+        const std::unordered_map<crypto::public_key, subaddress_index_extended> &entries,
+        const crypto::secret_key &table_key,
+        const fingerprint_t &fingerprint);
+    /**
+    * brief: open - map a table file
+    * param: path -
+    * param: table_key - k
+    * param: fingerprint - expected fingerprint
+    * return: the table, or nullptr if the file is missing, malformed, for another account or stale
+    */
+    static std::shared_ptr<const subaddress_lookup_table> open(const std::string &path,
+        const crypto::secret_key &table_key,
+        const fingerprint_t &fingerprint);
+
+    std::optional<subaddress_index_extended> find(const crypto::public_key &address_spend_pubkey) const;
+
+    void for_each(const std::function<void(const crypto::public_key&, const subaddress_index_extended&)> &f) const;
+
+    std::size_t size() const { return m_entry_count; }
+
+private:
+    subaddress_lookup_table() = default;
+
+    std::unique_ptr<boost::interprocess::mapped_region> m_region;
+    crypto::secret_key m_table_key;
+    const unsigned char *m_tags = nullptr;
+    const unsigned char *m_payloads = nullptr;
+    std::uint64_t m_slot_mask = 0;
+    std::size_t m_entry_count = 0;
+};
+
+/**
+* brief: make_subaddress_lookup_table_key - k = H_32[k_v]()
+* param: k_view - legacy private view key
+* outparam: table_key_out - k
+*/
+void make_subaddress_lookup_table_key(const crypto::secret_key &k_view, crypto::secret_key &table_key_out);
+} //namespace carrot
@@ -161,10 +161,37 @@ bool try_load_carrot_extra_v1(
     std::vector<mx25519_pubkey> &enote_ephemeral_pubkeys_out,
     std::optional<encrypted_payment_id_t> &encrypted_payment_id_out)
 {
-    std::vector<cryptonote::tx_extra_field> tx_extra_fields;
-    cryptonote::parse_tx_extra(tx_extra, tx_extra_fields);
+    cryptonote::tx_extra_view extra;
+    cryptonote::parse_tx_extra_view(tx_extra, extra);
 
-    return try_load_carrot_extra_v1(tx_extra_fields, enote_ephemeral_pubkeys_out, encrypted_payment_id_out);
+    //ephemeral pubkeys: D_e
+    static_assert(sizeof(mx25519_pubkey) == sizeof(crypto::public_key));
+    if (extra.num_pub_keys > 0)
+    {
+        enote_ephemeral_pubkeys_out = {raw_byte_convert<mx25519_pubkey>(*extra.pub_keys[0])};
+    }
+    else if (extra.has_additional_pub_keys)
+    {
+        enote_ephemeral_pubkeys_out.resize(extra.additional_pub_keys.size());
+        memcpy(enote_ephemeral_pubkeys_out.data(),
+            extra.additional_pub_keys.data(),
+            extra.additional_pub_keys.size() * sizeof(mx25519_pubkey));
+    }
+    else
+    {
+        return false;
+    }
+
+    //encrypted payment ID: pid_enc
+    encrypted_payment_id_out = std::nullopt;
+    if (extra.has_nonce && extra.nonce.size() == sizeof(crypto::hash8) + 1
+        && extra.nonce[0] == TX_EXTRA_NONCE_ENCRYPTED_PAYMENT_ID)
+    {
+        encrypted_payment_id_t &pid_enc = encrypted_payment_id_out.emplace();
+        memcpy(pid_enc.bytes, extra.nonce.data() + 1, sizeof(pid_enc.bytes));
+    }
+
+    return true;
 }
 //-------------------------------------------------------------------------------------------------------------------
 bool try_load_carrot_extra_v1(
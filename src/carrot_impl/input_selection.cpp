@@ -40,10 +40,15 @@
 
 //standard headers
 #include <algorithm>
+#include <array>
+#include <functional>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "carrot_impl"
 
+// search budget of select_branch_and_bound, bounds its run time regardless of the number of candidates
+#define BRANCH_AND_BOUND_MAX_NODES 100000
+
 namespace carrot
 {
 //-------------------------------------------------------------------------------------------------------------------
@@ -74,54 +79,79 @@ static std::set<size_t> set_union(const std::set<size_t> &a, const std::set<size
 static void stable_sort_indices_by_amount(const epee::span<const InputCandidate> input_candidates,
     std::vector<size_t> &indices_inout)
 {
-    std::stable_sort(indices_inout.begin(), indices_inout.end(),
-        [input_candidates](const std::size_t a, const std::size_t b) -> bool
+    const auto amount_less = [input_candidates](const std::size_t a, const std::size_t b) -> bool
         {
             CARROT_CHECK_AND_THROW(a < input_candidates.size() && b < input_candidates.size(),
                 std::out_of_range, "input candidate index out of range");
             return input_candidates[a].core.amount < input_candidates[b].core.amount;
-        });
+        };
+
+    // callers which keep their candidates ordered by amount (e.g. wallet2's unspent transfer index) hand us
+    // increasing indices which are already sorted, so check that first
+    if (std::is_sorted(indices_inout.cbegin(), indices_inout.cend(), amount_less))
+        return;
+
+    std::stable_sort(indices_inout.begin(), indices_inout.end(), amount_less);
+}
+//-------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------
+static std::vector<rct::xmr_amount> get_top_amounts(const epee::span<const InputCandidate> input_candidates,
+    const std::set<std::size_t> *selectable_inputs,
+    const std::size_t max_num_amounts)
+{
+    // Returns the greatest min(max_num_amounts, |selectable_inputs|) amounts of selectable_inputs, in descending
+    // order. If selectable_inputs is null, all input candidates are selectable
+
+    std::vector<rct::xmr_amount> top_amounts;
+    if (selectable_inputs == nullptr)
+    {
+        top_amounts.reserve(input_candidates.size());
+        for (const InputCandidate &input_candidate : input_candidates)
+            top_amounts.push_back(input_candidate.core.amount);
+    }
+    else
+    {
+        top_amounts.reserve(selectable_inputs->size());
+        for (const std::size_t selectable_input : *selectable_inputs)
+        {
+            CARROT_CHECK_AND_THROW(selectable_input < input_candidates.size(),
+                std::out_of_range, "selectable input out of range");
+            top_amounts.push_back(input_candidates[selectable_input].core.amount);
+        }
+    }
+
+    const std::size_t num_amounts = std::min(max_num_amounts, top_amounts.size());
+    std::partial_sort(top_amounts.begin(), top_amounts.begin() + num_amounts, top_amounts.end(),
+        std::greater<rct::xmr_amount>());
+    top_amounts.resize(num_amounts);
+    return top_amounts;
 }
 //-------------------------------------------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------------------------------------------
 static std::pair<std::size_t, boost::multiprecision::uint128_t> input_count_for_max_usable_money(
-    const epee::span<const InputCandidate> input_candidates,
-    const std::set<std::size_t> &selectable_inputs,
+    const std::vector<rct::xmr_amount> &top_amounts,
     std::size_t max_num_input_count,
     const std::map<std::size_t, rct::xmr_amount> &fee_by_input_count)
 {
     // Returns (N, X) where the X is the sum of the amounts of the greatest N <= max_num_input_count
-    // inputs from selectable_inputs, maximizing X - F(N). F(N) is the fee for this transaction,
-    // given input count N. This should correctly handle "almost-dust": inputs which are less than
-    // the fee, but greater than or equal to the difference of the fee compared to excluding that
-    // input. If this function returns N == 0, then there aren't enough usable funds, i.e. no N
-    // exists such that X - F(N) > 0.
+    // amounts from top_amounts (sorted descending), maximizing X - F(N). F(N) is the fee for this
+    // transaction, given input count N. This should correctly handle "almost-dust": inputs which
+    // are less than the fee, but greater than or equal to the difference of the fee compared to
+    // excluding that input. If this function returns N == 0, then there aren't enough usable funds,
+    // i.e. no N exists such that X - F(N) > 0.
 
-    if (fee_by_input_count.empty() || selectable_inputs.empty())
+    if (fee_by_input_count.empty() || top_amounts.empty())
         return {0, 0};
 
-    max_num_input_count = std::min(max_num_input_count, selectable_inputs.size());
+    max_num_input_count = std::min(max_num_input_count, top_amounts.size());
     CARROT_CHECK_AND_THROW(max_num_input_count <= fee_by_input_count.crbegin()->first,
         too_few_inputs, "fee by input count does not contain info for provided max input count");
 
-    // maintain list of top amounts of selectable_inputs
-    std::multiset<rct::xmr_amount> top_amounts;
-    for (const std::size_t selectable_input : selectable_inputs)
-    {
-        CARROT_CHECK_AND_THROW(selectable_input < input_candidates.size(),
-            std::out_of_range, "selectable input out of range");
-        const rct::xmr_amount amount = input_candidates[selectable_input].core.amount;
-        top_amounts.insert(amount);
-
-        if (top_amounts.size() > max_num_input_count)
-            top_amounts.erase(top_amounts.cbegin());
-    }
-
     // add up all the top amounts from the greatest to least until one fails to pay for its own marginal fee
     std::size_t num_ins = 0;
     rct::xmr_amount last_fee = 0;
     boost::multiprecision::uint128_t cumulative_input_sum = 0;
-    for (auto amount_it = top_amounts.crbegin(); amount_it != top_amounts.crend(); ++amount_it)
+    for (auto amount_it = top_amounts.cbegin(); amount_it != top_amounts.cbegin() + max_num_input_count; ++amount_it)
     {
         const rct::xmr_amount amount = *amount_it;
         const rct::xmr_amount current_fee = fee_by_input_count.at(num_ins + 1);
@@ -139,6 +169,18 @@ static std::pair<std::size_t, boost::multiprecision::uint128_t> input_count_for_
 }
 //-------------------------------------------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------------------------------------------
+static std::pair<std::size_t, boost::multiprecision::uint128_t> input_count_for_max_usable_money(
+    const epee::span<const InputCandidate> input_candidates,
+    const std::set<std::size_t> &selectable_inputs,
+    const std::size_t max_num_input_count,
+    const std::map<std::size_t, rct::xmr_amount> &fee_by_input_count)
+{
+    return input_count_for_max_usable_money(get_top_amounts(input_candidates, &selectable_inputs, max_num_input_count),
+        max_num_input_count,
+        fee_by_input_count);
+}
+//-------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------
 int compare_input_candidate_same_ki(const InputCandidate &lhs, const InputCandidate &rhs)
 {
     CARROT_CHECK_AND_THROW(lhs.core.key_image == rhs.core.key_image,
@@ -390,9 +432,9 @@ select_inputs_func_t make_single_transfer_input_selector(
             "Not enough money in all inputs (" << cryptonote::print_money(total_candidate_money)
             << ") to fund minimum output sum (" << cryptonote::print_money(absolute_minimum_required_money) << ')');
 
-        std::set<std::size_t> all_idxs; for (std::size_t i = 0; i < input_candidates.size(); ++i) all_idxs.insert(i);
         const std::pair<std::size_t, boost::multiprecision::uint128_t> max_usable_money =
-            input_count_for_max_usable_money(input_candidates, all_idxs, CARROT_MAX_TX_INPUTS, fee_by_input_count);
+            input_count_for_max_usable_money(get_top_amounts(input_candidates, nullptr, CARROT_MAX_TX_INPUTS),
+                CARROT_MAX_TX_INPUTS, fee_by_input_count);
         CARROT_CHECK_AND_THROW(max_usable_money.second >= absolute_minimum_required_money,
             not_enough_usable_money,
             "Not enough usable money in top " << max_usable_money.first << " inputs ("
@@ -416,8 +458,10 @@ select_inputs_func_t make_single_transfer_input_selector(
             if (selected_inputs_indices.size()) break;
 
             // Skip if not enough money in this selectable set for max number of tx inputs...
-            const auto max_usable_money = input_count_for_max_usable_money(input_candidates,
-                input_candidate_subset, CARROT_MAX_TX_INPUTS, fee_by_input_count);
+            const std::vector<rct::xmr_amount> subset_top_amounts = get_top_amounts(input_candidates,
+                &input_candidate_subset, CARROT_MAX_TX_INPUTS);
+            const auto max_usable_money = input_count_for_max_usable_money(subset_top_amounts,
+                CARROT_MAX_TX_INPUTS, fee_by_input_count);
             if (!max_usable_money.first)
                 continue;
             else if (max_usable_money.second < required_money_by_input_count.at(max_usable_money.first))
@@ -440,8 +484,8 @@ select_inputs_func_t make_single_transfer_input_selector(
                 const boost::multiprecision::uint128_t &required_money = required_money_by_input_count.at(n_inputs);
 
                 // Skip if not enough money in this selectable set for exact number of inputs...
-                const auto max_usable_money = input_count_for_max_usable_money(input_candidates,
-                    input_candidate_subset, n_inputs, fee_by_input_count);
+                const auto max_usable_money = input_count_for_max_usable_money(subset_top_amounts,
+                    n_inputs, fee_by_input_count);
                 if (max_usable_money.first != n_inputs)
                     continue;
                 else if (max_usable_money.second < required_money)
@@ -571,7 +615,11 @@ void select_greedy_aging(const epee::span<const InputCandidate> input_candidates
         const rct::xmr_amount lowest_replacement_amount = (currently_selected_amount > surplus)
             ? boost::numeric_cast<rct::xmr_amount>(currently_selected_amount - surplus) : 0;
         const auto lower_amount_it = std::lower_bound(selectable_inputs_by_amount.cbegin(),
-            selectable_inputs_by_amount.cend(), lowest_replacement_amount);
+            selectable_inputs_by_amount.cend(), lowest_replacement_amount,
+            [input_candidates](const std::size_t idx, const rct::xmr_amount amount) -> bool
+            {
+                return input_candidates[idx].core.amount < amount;
+            });
         for (auto amount_it = lower_amount_it; amount_it != selectable_inputs_by_amount.cend(); ++amount_it)
         {
             const std::size_t potential_replacement_idx = *amount_it;
@@ -603,5 +651,102 @@ void select_greedy_aging(const epee::span<const InputCandidate> input_candidates
     }
 }
 //-------------------------------------------------------------------------------------------------------------------
+namespace
+{
+struct branch_and_bound_search
+{
+    // amount-ascending selectable inputs, and prefix[i] = sum of the i smallest amounts
+    const std::vector<std::size_t> &inputs_by_amount;
+    const std::vector<boost::multiprecision::uint128_t> &prefix;
+    const epee::span<const InputCandidate> input_candidates;
+    const std::size_t n_inputs;
+    const boost::multiprecision::uint128_t &required_money;
+
+    std::size_t num_nodes_left;
+    std::array<std::size_t, CARROT_MAX_TX_INPUTS> stack;
+    std::array<std::size_t, CARROT_MAX_TX_INPUTS> best;
+    boost::multiprecision::uint128_t best_sum;
+    bool found;
+
+    // pick stack[depth] among positions [0, end) of inputs_by_amount, larger amounts first
+    void search(const std::size_t depth, const std::size_t end, const boost::multiprecision::uint128_t &sum)
+    {
+        const std::size_t num_left = n_inputs - depth;
+        for (std::size_t pos = end; pos-- > num_left - 1;)
+        {
+            if (!num_nodes_left || (found && best_sum == required_money))
+                return;
+            --num_nodes_left;
+
+            const boost::multiprecision::uint128_t new_sum = sum + input_candidates[inputs_by_amount[pos]].core.amount;
+
+            // upper bound: even the largest remaining amounts can't reach the required money, and it only gets
+            // worse for smaller pos
+            const boost::multiprecision::uint128_t max_sum = new_sum + prefix[pos] - prefix[pos - (num_left - 1)];
+            if (max_sum < required_money)
+                return;
+
+            // lower bound: the smallest remaining amounts already don't beat the best selection, try smaller pos
+            const boost::multiprecision::uint128_t min_sum = new_sum + prefix[num_left - 1];
+            if (found && min_sum >= best_sum)
+                continue;
+
+            stack[depth] = inputs_by_amount[pos];
+            if (num_left == 1)
+            {
+                if (new_sum >= required_money && (!found || new_sum < best_sum))
+                {
+                    best = stack;
+                    best_sum = new_sum;
+                    found = true;
+                }
+                continue;
+            }
+            search(depth + 1, pos, new_sum);
+        }
+    }
+};
+} //anonymous namespace
+//-------------------------------------------------------------------------------------------------------------------
+void select_branch_and_bound(const epee::span<const InputCandidate> input_candidates,
+    const std::set<std::size_t> &selectable_inputs,
+    const std::size_t n_inputs,
+    const boost::multiprecision::uint128_t &required_money,
+    std::set<std::size_t> &selected_inputs_indices_out)
+{
+    MTRACE(__func__ << ": n_inputs=" << n_inputs << ", selectable_inputs.size()=" << selectable_inputs.size());
+
+    selected_inputs_indices_out.clear();
+
+    CHECK_AND_ASSERT_MES(n_inputs && n_inputs <= CARROT_MAX_TX_INPUTS,,
+        "select_branch_and_bound: invalid n_inputs: " << n_inputs);
+    CHECK_AND_ASSERT_MES(n_inputs <= selectable_inputs.size(),,
+        "select_branch_and_bound: not enough inputs: " << selectable_inputs.size() << '/' << n_inputs);
+
+    // Sort selectable inputs by amount and sum them up
+    std::vector<std::size_t> selectable_inputs_by_amount(selectable_inputs.cbegin(), selectable_inputs.cend());
+    stable_sort_indices_by_amount(input_candidates, selectable_inputs_by_amount);
+    std::vector<boost::multiprecision::uint128_t> prefix(selectable_inputs_by_amount.size() + 1);
+    for (std::size_t i = 0; i < selectable_inputs_by_amount.size(); ++i)
+        prefix[i + 1] = prefix[i] + input_candidates[selectable_inputs_by_amount[i]].core.amount;
+
+    branch_and_bound_search bnb{selectable_inputs_by_amount, prefix, input_candidates, n_inputs, required_money};
+    bnb.num_nodes_left = BRANCH_AND_BOUND_MAX_NODES;
+    bnb.best_sum = 0;
+    bnb.found = false;
+    bnb.search(0, selectable_inputs_by_amount.size(), 0);
+
+    if (!bnb.found)
+    {
+        MDEBUG("select_branch_and_bound: no " << n_inputs << "-input selection found");
+        return;
+    }
+
+    selected_inputs_indices_out.insert(bnb.best.cbegin(), bnb.best.cbegin() + n_inputs);
+    MDEBUG("select_branch_and_bound: selected " << n_inputs << " inputs with surplus "
+        << cryptonote::print_money(bnb.best_sum - required_money)
+        << ", " << (BRANCH_AND_BOUND_MAX_NODES - bnb.num_nodes_left) << " nodes searched");
+}
+//-------------------------------------------------------------------------------------------------------------------
 } //namespace ispolicy
 } //namespace carrot
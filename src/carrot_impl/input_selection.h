@@ -190,6 +190,19 @@ void select_greedy_aging(const epee::span<const InputCandidate>,
     std::size_t,
     const boost::multiprecision::uint128_t&,
     std::set<std::size_t>&);
+/**
+ * brief: select_branch_and_bound - an ISP which searches for the selection with the least surplus over required money
+ *
+ * The search runs depth-first over the selectable inputs in amount order, pruning branches which cannot reach the
+ * required money or cannot beat the best selection so far. It stops at an exact match, or after a fixed budget of
+ * search nodes, returning the best selection found by then. Apart from the amount-sorted index and its prefix sums,
+ * built once per call, the search does not allocate.
+ */
+void select_branch_and_bound(const epee::span<const InputCandidate>,
+    const std::set<std::size_t>&,
+    std::size_t,
+    const boost::multiprecision::uint128_t&,
+    std::set<std::size_t>&);
 
 } //namespace ispolicy
 } //namespace carrot
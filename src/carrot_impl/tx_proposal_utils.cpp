@@ -38,6 +38,7 @@
 //third party headers
 
 //standard headers
+#include <mutex>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "carrot_impl.tpu"
@@ -112,6 +113,44 @@ std::uint64_t get_carrot_default_tx_extra_size(const std::size_t n_outputs)
     return enc_pid_extra_field_size + ephemeral_pubkeys_field_size;
 }
 //-------------------------------------------------------------------------------------------------------------------
+std::map<std::size_t, rct::xmr_amount> get_carrot_fee_per_input_count(const std::size_t n_outputs,
+    const std::size_t tx_extra_size,
+    const rct::xmr_amount fee_per_weight,
+    const rct::xmr_amount fee_quantization_mask)
+{
+    // a wallet only plans a handful of tx shapes, but an arbitrary tx.extra could make the keys unbounded
+    static constexpr std::size_t max_cached_shapes = 256;
+    static std::mutex weights_mutex;
+    static std::map<std::pair<std::size_t, std::size_t>, std::vector<std::uint64_t>> weights_by_shape;
+
+    std::vector<std::uint64_t> weights;
+    {
+        const std::lock_guard<std::mutex> lock(weights_mutex);
+        const auto it = weights_by_shape.find({n_outputs, tx_extra_size});
+        if (it != weights_by_shape.end())
+            weights = it->second;
+    }
+    if (weights.empty())
+    {
+        weights.reserve(CARROT_MAX_TX_INPUTS - CARROT_MIN_TX_INPUTS + 1);
+        for (size_t num_ins = CARROT_MIN_TX_INPUTS; num_ins <= CARROT_MAX_TX_INPUTS; ++num_ins)
+            weights.push_back(estimate_tx_weigh_carrot(num_ins, 15, n_outputs, tx_extra_size, true, true, true, true));
+
+        const std::lock_guard<std::mutex> lock(weights_mutex);
+        if (weights_by_shape.size() >= max_cached_shapes)
+            weights_by_shape.clear();
+        weights_by_shape.emplace(std::make_pair(n_outputs, tx_extra_size), weights);
+    }
+
+    std::map<std::size_t, rct::xmr_amount> fee_per_input_count;
+    for (size_t num_ins = CARROT_MIN_TX_INPUTS; num_ins <= CARROT_MAX_TX_INPUTS; ++num_ins)
+    {
+        fee_per_input_count.emplace_hint(fee_per_input_count.end(), num_ins,
+            calculate_fee_from_weight_carrot(fee_per_weight, weights[num_ins - CARROT_MIN_TX_INPUTS], fee_quantization_mask));
+    }
+    return fee_per_input_count;
+}
+//-------------------------------------------------------------------------------------------------------------------
 void make_carrot_transaction_proposal_v1(const std::vector<CarrotPaymentProposalV1> &normal_payment_proposals_in,
     const std::vector<CarrotPaymentProposalVerifiableSelfSendV1> &selfsend_payment_proposals_in,
     const rct::xmr_amount fee_per_weight,
@@ -171,12 +210,10 @@ void make_carrot_transaction_proposal_v1(const std::vector<CarrotPaymentProposal
     const size_t tx_extra_size = get_carrot_default_tx_extra_size(num_outs) + extra.size();
 
     // calculate the concrete fee for this transaction for each possible valid input count
-    std::map<size_t, rct::xmr_amount> fee_per_input_count;
-    for (size_t num_ins = CARROT_MIN_TX_INPUTS; num_ins <= CARROT_MAX_TX_INPUTS; ++num_ins)
-    {
-        const rct::xmr_amount fee = estimate_fee_carrot(num_ins, 15, num_outs, tx_extra_size, true, true, true, true, fee_per_weight, fee_quantization_mask);
-        fee_per_input_count.emplace(num_ins, fee);
-    }
+    const std::map<size_t, rct::xmr_amount> fee_per_input_count = get_carrot_fee_per_input_count(num_outs,
+        tx_extra_size,
+        fee_per_weight,
+        fee_quantization_mask);
 
     // calculate sum of payment proposal amounts before fee carving
     boost::multiprecision::uint128_t nominal_output_amount_sum = 0;
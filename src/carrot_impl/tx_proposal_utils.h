@@ -189,6 +189,13 @@ static uint64_t estimate_fee_carrot(int n_inputs, int mixin, int n_outputs, size
     return calculate_fee_from_weight_carrot(base_fee, estimated_tx_weight, fee_quantization_mask);
 }
 
+// estimate_fee_carrot() for every valid input count of a tx shape, the weights are memoized per
+// (n_outputs, tx_extra_size) since planning asks for the same few shapes over and over
+std::map<std::size_t, rct::xmr_amount> get_carrot_fee_per_input_count(const std::size_t n_outputs,
+    const std::size_t tx_extra_size,
+    const rct::xmr_amount fee_per_weight,
+    const rct::xmr_amount fee_quantization_mask);
+
 void make_carrot_transaction_proposal_v1(const std::vector<CarrotPaymentProposalV1> &normal_payment_proposals,
     const std::vector<CarrotPaymentProposalVerifiableSelfSendV1> &selfsend_payment_proposals,
     const rct::xmr_amount fee_per_weight,
@@ -245,10 +245,8 @@ namespace cryptonote
     return true;
   }
 
-  bool checkpoints::load_checkpoints_from_dns(network_type nettype)
+  bool checkpoints::fetch_dns_checkpoint_records(std::vector<std::string> &records, network_type nettype)
   {
-    std::vector<std::string> records;
-
     // All four MoneroPulse domains have DNSSEC on and valid
     static const std::vector<std::string> dns_urls = { /*"checkpoints.moneropulse.se"
 						     , "checkpoints.moneropulse.org"
@@ -268,9 +266,20 @@ namespace cryptonote
                    , "stagenetpoints.moneropulse.co"*/
     };
 
-    if (!tools::dns_utils::load_txt_records_from_dns(records, nettype == TESTNET ? testnet_dns_urls : nettype == STAGENET ? stagenet_dns_urls : dns_urls))
+    return tools::dns_utils::load_txt_records_from_dns(records, nettype == TESTNET ? testnet_dns_urls : nettype == STAGENET ? stagenet_dns_urls : dns_urls);
+  }
+
+  bool checkpoints::load_checkpoints_from_dns(network_type nettype)
+  {
+    std::vector<std::string> records;
+    if (!fetch_dns_checkpoint_records(records, nettype))
       return true; // why true ?
 
+    return load_checkpoints_from_dns_records(records);
+  }
+
+  bool checkpoints::load_checkpoints_from_dns_records(const std::vector<std::string> &records)
+  {
     for (const auto& record : records)
     {
       auto pos = record.find(":");
@@ -313,4 +322,66 @@ namespace cryptonote
 
     return result;
   }
+
+  dns_checkpoints_cache::dns_checkpoints_cache(network_type nettype, std::chrono::seconds ttl):
+    m_nettype(nettype), m_ttl(ttl), m_generation(0), m_expiry(), m_busy(false)
+  {
+  }
+
+  dns_checkpoints_cache::~dns_checkpoints_cache()
+  {
+    try
+    {
+      if (m_thread.joinable())
+        m_thread.join();
+    }
+    catch (...) { /* ignore */ }
+  }
+
+  void dns_checkpoints_cache::refresh()
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    if (m_busy || std::chrono::steady_clock::now() < m_expiry)
+      return;
+    // the previous lookup has finished, so this does not block
+    if (m_thread.joinable())
+      m_thread.join();
+    m_busy = true;
+    m_thread = boost::thread([this](){ lookup(); });
+  }
+
+  bool dns_checkpoints_cache::get(std::vector<std::string> &records, uint64_t &generation) const
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    if (m_generation == 0)
+      return false;
+    records = m_records;
+    generation = m_generation;
+    return true;
+  }
+
+  void dns_checkpoints_cache::lookup()
+  {
+    std::vector<std::string> records;
+    bool found = false;
+    try
+    {
+      found = checkpoints::fetch_dns_checkpoint_records(records, m_nettype);
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to look up DNS checkpoints: " << e.what());
+    }
+
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    if (found && (m_generation == 0 || records != m_records))
+    {
+      MDEBUG("Caching " << records.size() << " DNS checkpoint records");
+      m_records = std::move(records);
+      ++m_generation;
+    }
+    // a failed lookup keeps the previous records until the next try
+    m_expiry = std::chrono::steady_clock::now() + m_ttl;
+    m_busy = false;
+  }
 }
@@ -29,7 +29,12 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+#include <chrono>
 #include <map>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include "misc_log_ex.h"
 #include "crypto/hash.h"
 #include "cryptonote_config.h"
@@ -195,9 +200,82 @@ namespace cryptonote
      */
     bool load_checkpoints_from_dns(network_type nettype = MAINNET);
 
+    /**
+     * @brief load new checkpoints from already fetched DNS TXT records
+     *
+     * Records which do not parse as "height:hash" are skipped.
+     *
+     * @param records the validated TXT records
+     *
+     * @return true if no conflicts
+     */
+    bool load_checkpoints_from_dns_records(const std::vector<std::string> &records);
+
+    /**
+     * @brief fetch the DNS checkpoint TXT records for a network
+     *
+     * Blocks until all the checkpoint domains have been queried.
+     *
+     * @param records where to store the DNSSEC validated, majority agreed records
+     * @param nettype network type
+     *
+     * @return false if no valid majority of records was found
+     */
+    static bool fetch_dns_checkpoint_records(std::vector<std::string> &records, network_type nettype = MAINNET);
+
   private:
     std::map<uint64_t, crypto::hash> m_points; //!< the checkpoints container
     std::map<uint64_t, difficulty_type> m_difficulty_points; //!< the difficulty checkpoints container
   };
 
+  /**
+   * @brief DNS checkpoint records, looked up in the background
+   *
+   * Lookups run on a thread of their own so a slow resolver never holds up
+   * the caller, which only ever reads the last cached result.
+   */
+  class dns_checkpoints_cache
+  {
+  public:
+    /**
+     * @param nettype network type to look up checkpoints for
+     * @param ttl how long a lookup result is kept before refreshing
+     */
+    dns_checkpoints_cache(network_type nettype, std::chrono::seconds ttl);
+
+    /**
+     * @brief waits for any lookup in progress
+     */
+    ~dns_checkpoints_cache();
+
+    /**
+     * @brief starts a background lookup if the cached result expired
+     *
+     * Does nothing if a lookup is already running.
+     */
+    void refresh();
+
+    /**
+     * @brief gets the cached records
+     *
+     * @param records where to store the records
+     * @param generation incremented each time a lookup finds new records
+     *
+     * @return false if no lookup has succeeded yet
+     */
+    bool get(std::vector<std::string> &records, uint64_t &generation) const;
+
+  private:
+    void lookup();
+
+    const network_type m_nettype;
+    const std::chrono::seconds m_ttl;
+    mutable boost::mutex m_lock;
+    boost::thread m_thread;
+    std::vector<std::string> m_records;
+    uint64_t m_generation;
+    std::chrono::steady_clock::time_point m_expiry;
+    bool m_busy;
+  };
+
 }
@@ -0,0 +1,88 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <utility>
+
+namespace tools
+{
+  // bounded key/value cache which evicts the least recently used entry when full
+  template<typename K, typename V>
+  class lru_cache
+  {
+  public:
+    explicit lru_cache(size_t max_size): max_size(max_size) {}
+
+    const V *get(const K &key)
+    {
+      const auto it = index.find(key);
+      if (it == index.end())
+        return nullptr;
+      entries.splice(entries.begin(), entries, it->second);
+      return &it->second->second;
+    }
+
+    void put(const K &key, V value)
+    {
+      const auto it = index.find(key);
+      if (it != index.end())
+      {
+        it->second->second = std::move(value);
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+      }
+      if (max_size == 0)
+        return;
+      if (entries.size() >= max_size)
+      {
+        index.erase(entries.back().first);
+        entries.pop_back();
+      }
+      entries.emplace_front(key, std::move(value));
+      index.emplace(key, entries.begin());
+    }
+
+    void clear()
+    {
+      index.clear();
+      entries.clear();
+    }
+
+    size_t size() const { return entries.size(); }
+
+  private:
+    typedef std::list<std::pair<K, V>> entry_list;
+    size_t max_size;
+    entry_list entries;
+    std::map<K, typename entry_list::iterator> index;
+  };
+}
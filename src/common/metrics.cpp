@@ -0,0 +1,247 @@
+// Copyright (c) 2024, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <stdio.h>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include "metrics.h"
+
+namespace tools
+{
+namespace metrics
+{
+  constexpr const std::array<uint64_t, 17> histogram::bounds_us;
+
+  void histogram::observe(const std::chrono::microseconds elapsed) noexcept
+  {
+    const uint64_t us = elapsed.count() < 0 ? 0 : elapsed.count();
+    std::size_t i = 0;
+    while (i < bounds_us.size() && us > bounds_us[i])
+      ++i;
+    m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+    m_sum_us.fetch_add(us, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  namespace
+  {
+    constexpr const std::size_t max_series_per_name = 256;
+
+    enum class metric_type { counter, gauge, histogram };
+
+    struct series
+    {
+      std::unique_ptr<counter> c;
+      std::unique_ptr<gauge> g;
+      std::unique_ptr<histogram> h;
+    };
+
+    struct family
+    {
+      metric_type type;
+      std::string help;
+      std::map<std::string, series> by_labels;
+    };
+
+    struct registry
+    {
+      boost::shared_mutex mutex;
+      std::map<std::string, family> families; // by name
+      counter overflow_counter;
+      gauge overflow_gauge;
+      histogram overflow_histogram;
+    };
+
+    registry &get_registry()
+    {
+      static registry r;
+      return r;
+    }
+
+    series *find(registry &r, metric_type type, const std::string &name, const std::string &labels)
+    {
+      const auto f = r.families.find(name);
+      if (f == r.families.end())
+        return nullptr;
+      if (f->second.type != type)
+        throw std::logic_error("metric " + name + " registered with another type");
+      const auto s = f->second.by_labels.find(labels);
+      return s == f->second.by_labels.end() ? nullptr : &s->second;
+    }
+
+    series *get_series(metric_type type, const std::string &name, const std::string &help, const std::string &labels)
+    {
+      registry &r = get_registry();
+      {
+        boost::shared_lock<boost::shared_mutex> lock(r.mutex);
+        if (series *s = find(r, type, name, labels))
+          return s;
+      }
+
+      boost::unique_lock<boost::shared_mutex> lock(r.mutex);
+      if (series *s = find(r, type, name, labels))
+        return s;
+      family &f = r.families.emplace(name, family{type, help, {}}).first->second;
+      if (f.by_labels.size() >= max_series_per_name)
+        return nullptr;
+      series &s = f.by_labels[labels];
+      switch (type)
+      {
+        case metric_type::counter: s.c.reset(new counter()); break;
+        case metric_type::gauge: s.g.reset(new gauge()); break;
+        case metric_type::histogram: s.h.reset(new histogram()); break;
+      }
+      return &s;
+    }
+
+    void append_seconds(std::string &out, uint64_t us)
+    {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%llu.%06llu", (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+      std::string s(buf);
+      while (s.back() == '0')
+        s.pop_back();
+      if (s.back() == '.')
+        s.pop_back();
+      out += s;
+    }
+
+    void append_series_name(std::string &out, const std::string &name, const char *suffix, const std::string &labels, const std::string &extra = {})
+    {
+      out += "salvium_";
+      out += name;
+      out += suffix;
+      if (!labels.empty() || !extra.empty())
+      {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra.empty())
+          out += ',';
+        out += extra;
+        out += '}';
+      }
+      out += ' ';
+    }
+  }
+
+  counter &get_counter(const std::string &name, const std::string &help, const std::string &labels)
+  {
+    series *s = get_series(metric_type::counter, name, help, labels);
+    return s ? *s->c : get_registry().overflow_counter;
+  }
+
+  gauge &get_gauge(const std::string &name, const std::string &help, const std::string &labels)
+  {
+    series *s = get_series(metric_type::gauge, name, help, labels);
+    return s ? *s->g : get_registry().overflow_gauge;
+  }
+
+  histogram &get_histogram(const std::string &name, const std::string &help, const std::string &labels)
+  {
+    series *s = get_series(metric_type::histogram, name, help, labels);
+    return s ? *s->h : get_registry().overflow_histogram;
+  }
+
+  std::string label(const std::string &key, const std::string &value)
+  {
+    std::string out = key;
+    out += "=\"";
+    for (const char c: value)
+    {
+      switch (c)
+      {
+        case '\\': out += "\\\\"; break;
+        case '"': out += "\\\""; break;
+        case '\n': out += "\\n"; break;
+        default: out += c; break;
+      }
+    }
+    out += '"';
+    return out;
+  }
+
+  std::string render()
+  {
+    registry &r = get_registry();
+    boost::shared_lock<boost::shared_mutex> lock(r.mutex);
+    std::string out;
+    for (const auto &f: r.families)
+    {
+      static const char *const type_names[] = {"counter", "gauge", "histogram"};
+      out += "# HELP salvium_" + f.first + " " + f.second.help + "\n";
+      out += "# TYPE salvium_" + f.first + " " + type_names[static_cast<int>(f.second.type)] + "\n";
+      for (const auto &s: f.second.by_labels)
+      {
+        const std::string &labels = s.first;
+        switch (f.second.type)
+        {
+          case metric_type::counter:
+            append_series_name(out, f.first, "", labels);
+            out += std::to_string(s.second.c->get()) + "\n";
+            break;
+          case metric_type::gauge:
+            append_series_name(out, f.first, "", labels);
+            out += std::to_string(s.second.g->get()) + "\n";
+            break;
+          case metric_type::histogram:
+          {
+            const histogram &h = *s.second.h;
+            uint64_t cumulative = 0;
+            for (std::size_t i = 0; i < histogram::bounds_us.size(); ++i)
+            {
+              cumulative += h.bucket(i);
+              std::string le = "le=\"";
+              append_seconds(le, histogram::bounds_us[i]);
+              le += '"';
+              append_series_name(out, f.first, "_bucket", labels, le);
+              out += std::to_string(cumulative) + "\n";
+            }
+            // read separately from the buckets, so +Inf takes the larger of the two to stay monotonic
+            const uint64_t count = h.count();
+            cumulative += h.bucket(histogram::bounds_us.size());
+            append_series_name(out, f.first, "_bucket", labels, "le=\"+Inf\"");
+            out += std::to_string(std::max(cumulative, count)) + "\n";
+            append_series_name(out, f.first, "_sum", labels);
+            append_seconds(out, h.sum_us());
+            out += "\n";
+            append_series_name(out, f.first, "_count", labels);
+            out += std::to_string(std::max(cumulative, count)) + "\n";
+            break;
+          }
+        }
+      }
+    }
+    return out;
+  }
+}
+}
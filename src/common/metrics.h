@@ -0,0 +1,120 @@
+// Copyright (c) 2024, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace tools
+{
+namespace metrics
+{
+  //! Monotonic counter, padded to its own cache line so hot counters do not share one.
+  class alignas(64) counter
+  {
+  public:
+    void inc(uint64_t n = 1) noexcept { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t get() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> m_value{0};
+  };
+
+  //! Value that can go up and down.
+  class alignas(64) gauge
+  {
+  public:
+    void set(int64_t value) noexcept { m_value.store(value, std::memory_order_relaxed); }
+    void add(int64_t n) noexcept { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t get() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<int64_t> m_value{0};
+  };
+
+  //! Duration histogram with fixed buckets from 50us to 10s, exported in seconds.
+  class alignas(64) histogram
+  {
+  public:
+    static constexpr const std::array<uint64_t, 17> bounds_us = {{
+      50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+      100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+    }};
+
+    void observe(std::chrono::microseconds elapsed) noexcept;
+
+    //! \return Observations in bucket `i` only (not cumulative), the last one being +Inf.
+    uint64_t bucket(std::size_t i) const noexcept { return m_buckets[i].load(std::memory_order_relaxed); }
+    uint64_t count() const noexcept { return m_count.load(std::memory_order_relaxed); }
+    uint64_t sum_us() const noexcept { return m_sum_us.load(std::memory_order_relaxed); }
+
+  private:
+    std::array<std::atomic<uint64_t>, bounds_us.size() + 1> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum_us{0};
+  };
+
+  //! Records the time between construction and destruction into a histogram.
+  class scoped_timer
+  {
+  public:
+    explicit scoped_timer(histogram &h) noexcept: m_histogram(h), m_start(std::chrono::steady_clock::now()) {}
+    ~scoped_timer() { m_histogram.observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start)); }
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer &operator=(const scoped_timer&) = delete;
+
+  private:
+    histogram &m_histogram;
+    const std::chrono::steady_clock::time_point m_start;
+  };
+
+  /*! Find or register a metric series. `name` is given without the
+      "salvium_" prefix, `labels` is empty or a comma separated list built
+      with `label()`. The returned reference stays valid for the life of the
+      process, so callers with fixed labels look it up once, eg. in a function
+      local static, and then only touch the atomics.
+
+      A metric name keeps at most a few hundred label sets. Past that, updates
+      go to an unexported series, so labels taken from requests cannot grow
+      the registry without bound. */
+  counter &get_counter(const std::string &name, const std::string &help, const std::string &labels = {});
+  gauge &get_gauge(const std::string &name, const std::string &help, const std::string &labels = {});
+  histogram &get_histogram(const std::string &name, const std::string &help, const std::string &labels = {});
+
+  //! \return `key="value"`, with the value escaped.
+  std::string label(const std::string &key, const std::string &value);
+
+  //! \return All series in the Prometheus text exposition format.
+  std::string render();
+}
+}
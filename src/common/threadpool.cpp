@@ -26,6 +26,7 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "misc_log_ex.h"
+#include "thread_placement.h"
 #include "common/threadpool.h"
 
 #include "cryptonote_config.h"
@@ -33,10 +34,13 @@
 
 static __thread int depth = 0;
 static __thread bool is_leaf = false;
+// the pool whose worker this thread is, and the index of its queue
+static __thread const tools::threadpool *worker_pool = NULL;
+static __thread int worker_index = -1;
 
 namespace tools
 {
-threadpool::threadpool(unsigned int max_threads) : running(true), active(0) {
+threadpool::threadpool(unsigned int max_threads, const char *group) : active(0), group(group), running(true), pending(0), sleepers(0), next_queue(0) {
   create(max_threads);
 }
 
@@ -76,19 +80,69 @@ void threadpool::create(unsigned int max_threads) {
   attrs.set_stack_size(THREAD_STACK_SIZE);
   max = max_threads ? max_threads : tools::get_max_concurrency();
   size_t i = max ? max - 1 : 0;
+  // queues survive a recycle, along with anything still queued on them
+  if (queues.empty())
+  {
+    const size_t n_queues = std::max<size_t>(i, 1);
+    for (size_t q = 0; q < n_queues; ++q)
+      queues.emplace_back(new worker_queue());
+  }
   running = true;
   while(i--) {
-    threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this, false)));
+    threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this, false, (int)(i % queues.size()))));
   }
 }
 
+void threadpool::push(entry &&e) {
+  // workers feed their own queue, other threads spread theirs around
+  const size_t index = worker_pool == this ? worker_index : next_queue++ % queues.size();
+  worker_queue &q = *queues[index];
+  // counted before it is visible, so a thief can never take it below zero
+  ++pending;
+  {
+    const boost::unique_lock<boost::mutex> lock(q.mutex);
+    if (e.leaf)
+      q.tasks.push_front(std::move(e));
+    else
+      q.tasks.push_back(std::move(e));
+  }
+  if (sleepers > 0)
+  {
+    const boost::unique_lock<boost::mutex> lock(mutex);
+    has_work.notify_one();
+  }
+}
+
+bool threadpool::pop(entry &e) {
+  const size_t n_queues = queues.size();
+  const size_t self = worker_pool == this ? worker_index : 0;
+  for (size_t n = 0; n < n_queues; ++n)
+  {
+    worker_queue &q = *queues[(self + n) % n_queues];
+    const boost::unique_lock<boost::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+      continue;
+    if (n == 0)
+    {
+      e = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+    else
+    {
+      e = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    }
+    --pending;
+    return true;
+  }
+  return false;
+}
+
 void threadpool::submit(waiter *obj, std::function<void()> f, bool leaf) {
   CHECK_AND_ASSERT_THROW_MES(!is_leaf, "A leaf routine is using a thread pool");
-  boost::unique_lock<boost::mutex> lock(mutex);
-  if (!leaf && ((active == max && !queue.empty()) || depth > 0)) {
+  if (!leaf && ((active == max && pending > 0) || depth > 0)) {
     // if all available threads are already running
     // and there's work waiting, just run in current thread
-    lock.unlock();
     ++depth;
     is_leaf = leaf;
     f();
@@ -97,11 +151,7 @@ void threadpool::submit(waiter *obj, std::function<void()> f, bool leaf) {
   } else {
     if (obj)
       obj->inc();
-    if (leaf)
-      queue.push_front({obj, f, leaf});
-    else
-      queue.push_back({obj, f, leaf});
-    has_work.notify_one();
+    push({obj, std::move(f), leaf});
   }
 }
 
@@ -137,43 +187,56 @@ bool threadpool::waiter::wait() {
 }
 
 void threadpool::waiter::inc() {
-  const boost::unique_lock<boost::mutex> lock(mt);
-  num++;
+  ++num;
 }
 
 void threadpool::waiter::dec() {
+  // only the last decrement needs the lock, so wait() can't miss it and
+  // the waiter can't be destroyed under us
+  int n = num.load();
+  while (n > 1)
+    if (num.compare_exchange_weak(n, n - 1))
+      return;
   const boost::unique_lock<boost::mutex> lock(mt);
-  num--;
-  if (!num)
+  if (--num == 0)
     cv.notify_all();
 }
 
-void threadpool::run(bool flush) {
-  boost::unique_lock<boost::mutex> lock(mutex);
+void threadpool::run(bool flush, int index) {
+  std::unique_ptr<epee::thread_placement::member> placement;
+  if (index >= 0)
+  {
+    worker_pool = this;
+    worker_index = index;
+    if (group)
+      placement.reset(new epee::thread_placement::member(group));
+  }
   while (running) {
     entry e;
-    while(queue.empty() && running)
+    if (!pop(e))
     {
       if (flush)
         return;
-      has_work.wait(lock);
+      ++sleepers;
+      {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (running && pending == 0)
+          has_work.wait(lock);
+      }
+      --sleepers;
+      continue;
     }
-    if (!running) break;
 
     active++;
-    e = std::move(queue.front());
-    queue.pop_front();
-    lock.unlock();
     ++depth;
     is_leaf = e.leaf;
     try { e.f(); }
-    catch (const std::exception &ex) { e.wo->set_error(); try { MERROR("Exception in threadpool job: " << ex.what()); } catch (...) {} }
+    catch (const std::exception &ex) { if (e.wo) e.wo->set_error(); try { MERROR("Exception in threadpool job: " << ex.what()); } catch (...) {} }
     --depth;
     is_leaf = false;
 
     if (e.wo)
       e.wo->dec();
-    lock.lock();
     active--;
   }
 }
@@ -30,9 +30,12 @@
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <deque>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 #include <stdexcept>
@@ -44,11 +47,11 @@ class threadpool
 {
 public:
   static threadpool& getInstanceForCompute() {
-    static threadpool instance;
+    static threadpool instance(0, "compute");
     return instance;
   }
   static threadpool& getInstanceForIO() {
-    static threadpool instance(8);
+    static threadpool instance(8, "io");
     return instance;
   }
   static threadpool *getNewForUnitTests(unsigned max_threads = 0) {
@@ -61,8 +64,8 @@ public:
     boost::mutex mt;
     boost::condition_variable cv;
     threadpool &pool;
-    int num;
-    bool error_flag;
+    std::atomic<int> num;
+    std::atomic<bool> error_flag;
     public:
     void inc();
     void dec();
@@ -78,6 +81,25 @@ public:
   // task to finish.
   void submit(waiter *waiter, std::function<void()> f, bool leaf = false);
 
+  // Run f(i) for every i in [begin, end), split into contiguous ranges of
+  // at least min_chunk indices. Returns false iff any range threw.
+  template<typename F>
+  bool parallel_for(size_t begin, size_t end, F f, size_t min_chunk = 1)
+  {
+    if (begin >= end)
+      return true;
+    const size_t n = end - begin;
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(n / std::max<size_t>(min_chunk, 1), max * 4));
+    const size_t chunk_size = (n + chunks - 1) / chunks;
+    waiter w(*this);
+    for (size_t lo = begin; lo < end; lo += chunk_size)
+    {
+      const size_t hi = std::min(end, lo + chunk_size);
+      submit(&w, [&f, lo, hi](){ for (size_t i = lo; i < hi; ++i) f(i); });
+    }
+    return w.wait();
+  }
+
   // destroy and recreate threads
   void recycle();
 
@@ -86,7 +108,8 @@ public:
   ~threadpool();
 
   private:
-    threadpool(unsigned int max_threads = 0);
+    // workers join the named epee::thread_placement group, if any
+    threadpool(unsigned int max_threads = 0, const char *group = NULL);
     void destroy();
     void create(unsigned int max_threads);
     typedef struct entry {
@@ -94,14 +117,27 @@ public:
       std::function<void()> f;
       bool leaf;
     } entry;
-    std::deque<entry> queue;
+    // Each worker owns a deque it pops from the front of, and steals from
+    // the back of the others' when it runs dry. The pool mutex is only
+    // taken to sleep and to wake sleepers.
+    struct worker_queue {
+      boost::mutex mutex;
+      std::deque<entry> tasks;
+    };
+    std::vector<std::unique_ptr<worker_queue>> queues;
     boost::condition_variable has_work;
     boost::mutex mutex;
     std::vector<boost::thread> threads;
-    unsigned int active;
+    std::atomic<unsigned int> active;
     unsigned int max;
-    bool running;
-    void run(bool flush = false);
+    const char *group;
+    std::atomic<bool> running;
+    std::atomic<size_t> pending;
+    std::atomic<unsigned int> sleepers;
+    std::atomic<unsigned int> next_queue;
+    void push(entry &&e);
+    bool pop(entry &e);
+    void run(bool flush = false, int index = -1);
 };
 
 }
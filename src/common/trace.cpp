@@ -0,0 +1,210 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <stdio.h>
+#include <vector>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include "trace.h"
+
+namespace tools
+{
+namespace trace
+{
+  std::atomic<bool> detail::enabled{false};
+
+  namespace
+  {
+    constexpr const std::size_t events_per_thread = 4096;
+    constexpr const std::size_t max_names = 4096;
+
+    struct event
+    {
+      const char *name;
+      uint64_t start_ns;
+      uint64_t end_ns;
+    };
+
+    // the owning thread is the only writer, so its lock is only ever contended by exports
+    struct thread_buffer
+    {
+      boost::mutex mutex;
+      std::vector<event> events;
+      std::size_t next = 0;
+      uint64_t tid = 0;
+      std::atomic<bool> exited{false};
+    };
+
+    struct registry
+    {
+      boost::mutex mutex;
+      std::vector<std::shared_ptr<thread_buffer>> buffers;
+      uint64_t next_tid = 1;
+      std::set<std::string> names;
+    };
+
+    // never destroyed, threads may still record while statics are torn down
+    registry &get_registry()
+    {
+      static registry *r = new registry();
+      return *r;
+    }
+
+    struct thread_handle
+    {
+      std::shared_ptr<thread_buffer> buffer;
+      ~thread_handle() { if (buffer) buffer->exited = true; }
+    };
+    thread_local thread_handle this_thread;
+
+    thread_buffer &get_thread_buffer()
+    {
+      if (!this_thread.buffer)
+      {
+        std::shared_ptr<thread_buffer> buffer = std::make_shared<thread_buffer>();
+        buffer->events.reserve(events_per_thread);
+        registry &r = get_registry();
+        boost::lock_guard<boost::mutex> lock(r.mutex);
+        buffer->tid = r.next_tid++;
+        r.buffers.push_back(buffer);
+        this_thread.buffer = std::move(buffer);
+      }
+      return *this_thread.buffer;
+    }
+
+    void append_escaped(std::string &out, const char *s)
+    {
+      for (; *s; ++s)
+      {
+        const unsigned char c = *s;
+        if (c == '"' || c == '\\')
+        {
+          out += '\\';
+          out += c;
+        }
+        else if (c < 0x20)
+        {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          out += buf;
+        }
+        else
+          out += c;
+      }
+    }
+  }
+
+  void detail::record(const char *name, uint64_t start_ns, uint64_t end_ns) noexcept
+  {
+    try
+    {
+      thread_buffer &buffer = get_thread_buffer();
+      boost::lock_guard<boost::mutex> lock(buffer.mutex);
+      if (buffer.events.size() < events_per_thread)
+        buffer.events.push_back({name, start_ns, end_ns});
+      else
+        buffer.events[buffer.next] = {name, start_ns, end_ns};
+      buffer.next = (buffer.next + 1) % events_per_thread;
+    }
+    catch (...) { /* dropping a span beats failing the traced code */ }
+  }
+
+  void enable(const bool enable) noexcept
+  {
+    detail::enabled.store(enable, std::memory_order_relaxed);
+  }
+
+  const char *intern(const std::string &name)
+  {
+    registry &r = get_registry();
+    boost::lock_guard<boost::mutex> lock(r.mutex);
+    const auto it = r.names.find(name);
+    if (it != r.names.end())
+      return it->c_str();
+    if (r.names.size() >= max_names)
+      return "other";
+    return r.names.insert(name).first->c_str();
+  }
+
+  std::string render()
+  {
+    std::vector<std::shared_ptr<thread_buffer>> buffers;
+    {
+      registry &r = get_registry();
+      boost::lock_guard<boost::mutex> lock(r.mutex);
+      buffers = r.buffers;
+      // an exited thread's buffer is exported one last time below
+      r.buffers.erase(std::remove_if(r.buffers.begin(), r.buffers.end(), [](const std::shared_ptr<thread_buffer> &b) { return b->exited.load(); }), r.buffers.end());
+    }
+
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    std::vector<event> events;
+    for (const std::shared_ptr<thread_buffer> &buffer: buffers)
+    {
+      {
+        boost::lock_guard<boost::mutex> lock(buffer->mutex);
+        events.clear();
+        if (buffer->events.size() == events_per_thread)
+          events.insert(events.end(), buffer->events.begin() + buffer->next, buffer->events.end());
+        events.insert(events.end(), buffer->events.begin(), buffer->events.begin() + (buffer->events.size() == events_per_thread ? buffer->next : buffer->events.size()));
+      }
+      for (const event &e: events)
+      {
+        char buf[128];
+        // timestamps are in microseconds, with the nanoseconds as decimals
+        snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+          (unsigned long long)buffer->tid,
+          (unsigned long long)(e.start_ns / 1000), (unsigned)(e.start_ns % 1000),
+          (unsigned long long)((e.end_ns - e.start_ns) / 1000), (unsigned)((e.end_ns - e.start_ns) % 1000));
+        out += first ? "\n{\"name\":\"" : ",\n{\"name\":\"";
+        append_escaped(out, e.name);
+        out += buf;
+        first = false;
+      }
+    }
+    out += "\n]}\n";
+    return out;
+  }
+
+  void clear()
+  {
+    registry &r = get_registry();
+    boost::lock_guard<boost::mutex> lock(r.mutex);
+    for (const std::shared_ptr<thread_buffer> &buffer: r.buffers)
+    {
+      boost::lock_guard<boost::mutex> buffer_lock(buffer->mutex);
+      buffer->events.clear();
+      buffer->next = 0;
+    }
+  }
+}
+}
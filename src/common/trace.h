@@ -0,0 +1,89 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/*! Spans are timed scopes recorded into a ring buffer per thread while
+    tracing is enabled, and exported in the Chrome trace event format (which
+    Perfetto loads too). A disabled span costs one relaxed atomic load, so
+    they can stay in hot paths. Span names are not copied, they must outlive
+    the process: string literals, or names returned by `intern()`. */
+
+namespace tools
+{
+namespace trace
+{
+  namespace detail
+  {
+    extern std::atomic<bool> enabled;
+    void record(const char *name, uint64_t start_ns, uint64_t end_ns) noexcept;
+
+    inline uint64_t now_ns() noexcept
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+  }
+
+  //! Spans already running when tracing gets enabled are not recorded.
+  void enable(bool enable) noexcept;
+  inline bool enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+
+  class span
+  {
+  public:
+    //! A null name records nothing.
+    explicit span(const char *name) noexcept: m_name(enabled() ? name : nullptr), m_start_ns(m_name ? detail::now_ns() : 0) {}
+    ~span() { if (m_name) detail::record(m_name, m_start_ns, detail::now_ns()); }
+    span(const span&) = delete;
+    span &operator=(const span&) = delete;
+
+  private:
+    const char *const m_name;
+    const uint64_t m_start_ns;
+  };
+
+  /*! \return A copy of `name` living as long as the process. There are at
+      most a few thousand names, past that every new one maps to "other". */
+  const char *intern(const std::string &name);
+
+  //! \return The buffered spans of all threads, oldest first per thread, as Chrome trace event JSON.
+  std::string render();
+
+  //! Drops every buffered span.
+  void clear();
+}
+}
+
+#define TRACE_SPAN_CONCAT_(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_(a, b)
+#define TRACE_SPAN(name) tools::trace::span TRACE_SPAN_CONCAT(trace_span_, __LINE__)(name)
@@ -30,11 +30,14 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <type_traits>
 #include <utility>
 #include <sstream>
 #include <string>
+#include <boost/endian/conversion.hpp>
 /*! \file varint.h
  * \brief provides the implementation of varint's
  * 
@@ -125,4 +128,50 @@ namespace tools {
     int read_varint(InputIt &&first, InputIt &&last, T &i) {
     return read_varint<std::numeric_limits<T>::digits>(std::forward<InputIt>(first), std::forward<InputIt>(last), i);
   }
+
+  /*! \brief reads count consecutive varints into out, in one pass
+   *
+   * Accepts exactly what read_varint does for a uint64_t. Where 8 bytes can
+   * be loaded at once, a varint of up to 8 bytes is found from the stop bits
+   * of the whole word and its 7 bit groups are packed with three masked
+   * shifts, one branch per value instead of one per byte. Short varints like
+   * output offsets and lengths take this path; the rest fall back to
+   * read_varint.
+   *
+   * \return false if a varint fails to read, first is then past it
+   */
+  inline bool read_varint_array(const std::uint8_t *&first, const std::uint8_t *last, std::uint64_t *out, std::size_t count) {
+    for (std::size_t n = 0; n < count; ++n) {
+      if (last - first >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, first, sizeof(word));
+        boost::endian::little_to_native_inplace(word);
+        const std::uint64_t stops = ~word & 0x8080808080808080ull;
+        if (stops) {
+#if defined(_MSC_VER) && !defined(__clang__)
+          unsigned long bit;
+          _BitScanForward64(&bit, stops);
+          const unsigned bytes = (bit >> 3) + 1;
+#else
+          const unsigned bytes = (__builtin_ctzll(stops) >> 3) + 1;
+#endif
+          if (bytes < 8)
+            word &= (std::uint64_t(1) << (bytes * 8)) - 1;
+          /* the last byte of a longer varint can't be 0, as in read_varint */
+          if (bytes > 1 && (word >> ((bytes - 1) * 8)) == 0)
+            return false;
+          word &= 0x7f7f7f7f7f7f7f7full;
+          word = ((word & 0x7f007f007f007f00ull) >> 1) | (word & 0x007f007f007f007full);
+          word = ((word & 0x3fff00003fff0000ull) >> 2) | (word & 0x00003fff00003fffull);
+          word = ((word & 0x0fffffff00000000ull) >> 4) | (word & 0x000000000fffffffull);
+          out[n] = word;
+          first += bytes;
+          continue;
+        }
+      }
+      if (read_varint(first, last, out[n]) < 0)
+        return false;
+    }
+    return true;
+  }
 }
@@ -1614,6 +1614,43 @@ void ge_p3_tobytes(unsigned char *s, const ge_p3 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/*
+Encodes n points into s[32 * i], sharing one field inversion between them.
+Returns non-zero if the scratch space could not be allocated.
+*/
+
+int ge_p3_tobytes_batch(unsigned char *s, const ge_p3 *h, const int n) {
+  fe *z;
+  fe *recip;
+  fe x;
+  fe y;
+  int i;
+
+  if (n <= 0) {
+    return 0;
+  }
+  z = (fe *) malloc(2 * n * sizeof(fe));
+  if (!z) {
+    return 1;
+  }
+  recip = z + n;
+  for (i = 0; i < n; ++i) {
+    fe_copy(z[i], h[i].Z);
+  }
+  if (fe_batch_invert(recip, (const fe *) z, n) != 0) {
+    free(z);
+    return 1;
+  }
+  for (i = 0; i < n; ++i) {
+    fe_mul(x, h[i].X, recip[i]);
+    fe_mul(y, h[i].Y, recip[i]);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+  free(z);
+  return 0;
+}
+
 /* From ge_precomp_0.c */
 
 static void ge_precomp_0(ge_precomp *h) {
@@ -1646,20 +1683,20 @@ static void ge_precomp_cmov(ge_precomp *t, const ge_precomp *u, unsigned char b)
   fe_cmov(t->xy2d, u->xy2d, b);
 }
 
-static void _select(ge_precomp *t, int pos, signed char b) {
+static void _select(ge_precomp *t, const ge_precomp table[32][8], int pos, signed char b) {
   ge_precomp minust;
   unsigned char bnegative = negative(b);
   unsigned char babs = b - (((-bnegative) & b) << 1);
 
   ge_precomp_0(t);
-  ge_precomp_cmov(t, &ge_base[pos][0], equal(babs, 1));
-  ge_precomp_cmov(t, &ge_base[pos][1], equal(babs, 2));
-  ge_precomp_cmov(t, &ge_base[pos][2], equal(babs, 3));
-  ge_precomp_cmov(t, &ge_base[pos][3], equal(babs, 4));
-  ge_precomp_cmov(t, &ge_base[pos][4], equal(babs, 5));
-  ge_precomp_cmov(t, &ge_base[pos][5], equal(babs, 6));
-  ge_precomp_cmov(t, &ge_base[pos][6], equal(babs, 7));
-  ge_precomp_cmov(t, &ge_base[pos][7], equal(babs, 8));
+  ge_precomp_cmov(t, &table[pos][0], equal(babs, 1));
+  ge_precomp_cmov(t, &table[pos][1], equal(babs, 2));
+  ge_precomp_cmov(t, &table[pos][2], equal(babs, 3));
+  ge_precomp_cmov(t, &table[pos][3], equal(babs, 4));
+  ge_precomp_cmov(t, &table[pos][4], equal(babs, 5));
+  ge_precomp_cmov(t, &table[pos][5], equal(babs, 6));
+  ge_precomp_cmov(t, &table[pos][6], equal(babs, 7));
+  ge_precomp_cmov(t, &table[pos][7], equal(babs, 8));
   fe_copy(minust.yplusx, t->yminusx);
   fe_copy(minust.yminusx, t->yplusx);
   fe_neg(minust.xy2d, t->xy2d);
@@ -1676,6 +1713,67 @@ Preconditions:
 */
 
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
+  ge_scalarmult_precomp(h, a, ge_base);
+}
+
+/*
+Fills table[i][j] = (j+1)*256^i*P, the layout of ge_base, so any fixed
+point can use the ge_scalarmult_base algorithm.
+*/
+
+void ge_precomp_table_init(ge_precomp table[32][8], const ge_p3 *p) {
+  ge_p3 base = *p;
+  ge_p3 multiples[8];
+  ge_cached base_cached;
+  ge_p1p1 r;
+  fe prefix[8];
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  int i, j;
+
+  for (i = 0; i < 32; ++i) {
+    ge_p3_to_cached(&base_cached, &base);
+    multiples[0] = base;
+    for (j = 1; j < 8; ++j) {
+      ge_add(&r, &multiples[j - 1], &base_cached); ge_p1p1_to_p3(&multiples[j], &r);
+    }
+    /* one inversion per row (Montgomery's trick), kept on the stack */
+    fe_copy(prefix[0], multiples[0].Z);
+    for (j = 1; j < 8; ++j) {
+      fe_mul(prefix[j], prefix[j - 1], multiples[j].Z);
+    }
+    fe_invert(inv, prefix[7]);
+    for (j = 7; j >= 0; --j) {
+      if (j > 0) {
+        fe_mul(recip, inv, prefix[j - 1]);
+        fe_mul(inv, inv, multiples[j].Z);
+      } else {
+        fe_copy(recip, inv);
+      }
+      fe_mul(x, multiples[j].X, recip);
+      fe_mul(y, multiples[j].Y, recip);
+      fe_add(table[i][j].yplusx, y, x);
+      fe_sub(table[i][j].yminusx, y, x);
+      fe_mul(table[i][j].xy2d, x, y);
+      fe_mul(table[i][j].xy2d, table[i][j].xy2d, fe_d2);
+    }
+    for (j = 0; j < 8; ++j) {
+      ge_p3_dbl(&r, &base); ge_p1p1_to_p3(&base, &r);
+    }
+  }
+}
+
+/*
+h = a * P
+where table was filled from P by ge_precomp_table_init.
+
+Preconditions:
+  a[31] <= 127
+*/
+
+void ge_scalarmult_precomp(ge_p3 *h, const unsigned char *a, const ge_precomp table[32][8]) {
   signed char e[64];
   signed char carry;
   ge_p1p1 r;
@@ -1702,7 +1800,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
 
   ge_p3_0(h);
   for (i = 1; i < 64; i += 2) {
-    _select(&t, i / 2, e[i]);
+    _select(&t, table, i / 2, e[i]);
     ge_madd(&r, h, &t); ge_p1p1_to_p3(h, &r);
   }
 
@@ -1712,7 +1810,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
   ge_p2_dbl(&r, &s); ge_p1p1_to_p3(h, &r);
 
   for (i = 0; i < 64; i += 2) {
-    _select(&t, i / 2, e[i]);
+    _select(&t, table, i / 2, e[i]);
     ge_madd(&r, h, &t); ge_p1p1_to_p3(h, &r);
   }
 }
@@ -115,11 +115,14 @@ void ge_p3_to_p2(ge_p2 *, const ge_p3 *);
 /* From ge_p3_tobytes.c */
 
 void ge_p3_tobytes(unsigned char *, const ge_p3 *);
+int ge_p3_tobytes_batch(unsigned char *, const ge_p3 *, const int);
 
 /* From ge_scalarmult_base.c */
 
 extern const ge_precomp ge_base[32][8];
 void ge_scalarmult_base(ge_p3 *, const unsigned char *);
+void ge_precomp_table_init(ge_precomp table[32][8], const ge_p3 *);
+void ge_scalarmult_precomp(ge_p3 *, const unsigned char *, const ge_precomp table[32][8]);
 
 /* From ge_tobytes.c */
 
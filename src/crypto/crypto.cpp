@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <boost/shared_ptr.hpp>
@@ -633,6 +634,41 @@ namespace crypto {
     ge_tobytes(&image, &point2);
   }
 
+  void crypto_ops::generate_key_images(const public_key *pubs, const secret_key *secs, std::size_t count, key_image *images) {
+    struct fe_wrapper { fe v; };
+    if (count == 0)
+      return;
+    std::vector<ge_p2> points(count);
+    std::vector<fe_wrapper> acc(count);
+    for (size_t i = 0; i < count; ++i) {
+      ge_p3 point;
+      assert(sc_check(&secs[i]) == 0);
+      hash_to_ec(pubs[i], point);
+      ge_scalarmult(&points[i], &unwrap(secs[i]), &point);
+      if (i == 0)
+        fe_copy(acc[0].v, points[0].Z);
+      else
+        fe_mul(acc[i].v, acc[i - 1].v, points[i].Z);
+    }
+
+    // Montgomery's trick: invert the product of all Z once, then peel off each 1/Z from the back
+    fe inv;
+    fe_invert(inv, acc[count - 1].v);
+    for (size_t i = count; i-- > 0; ) {
+      fe recip, x, y;
+      if (i > 0) {
+        fe_mul(recip, inv, acc[i - 1].v);
+        fe_mul(inv, inv, points[i].Z);
+      } else {
+        fe_copy(recip, inv);
+      }
+      fe_mul(x, points[i].X, recip);
+      fe_mul(y, points[i].Y, recip);
+      fe_tobytes(reinterpret_cast<unsigned char*>(&images[i]), y);
+      reinterpret_cast<unsigned char*>(&images[i])[31] ^= fe_isnegative(x) << 7;
+    }
+  }
+
 PUSH_WARNINGS
 DISABLE_VS_WARNINGS(4200)
   struct ec_point_pair {
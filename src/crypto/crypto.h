@@ -137,6 +137,8 @@ namespace crypto {
     friend void derive_key_image_generator(const public_key &, ec_point &);
     static void generate_key_image(const public_key &, const secret_key &, key_image &);
     friend void generate_key_image(const public_key &, const secret_key &, key_image &);
+    static void generate_key_images(const public_key *, const secret_key *, std::size_t, key_image *);
+    friend void generate_key_images(const public_key *, const secret_key *, std::size_t, key_image *);
     static void generate_ring_signature(const hash &, const key_image &,
       const public_key *const *, std::size_t, const secret_key &, std::size_t, signature *);
     friend void generate_ring_signature(const hash &, const key_image &,
@@ -277,6 +279,12 @@ namespace crypto {
   inline void generate_key_image(const public_key &pub, const secret_key &sec, key_image &image) {
     crypto_ops::generate_key_image(pub, sec, image);
   }
+  /* Same as generate_key_image() for each of the count (pub, sec) pairs, but normalizes all the resulting
+   * points with a single field inversion, which makes it noticeably cheaper when many key images are needed at once.
+   */
+  inline void generate_key_images(const public_key *pubs, const secret_key *secs, std::size_t count, key_image *images) {
+    crypto_ops::generate_key_images(pubs, secs, count, images);
+  }
   inline void generate_ring_signature(const hash &prefix_hash, const key_image &image,
     const public_key *const *pubs, std::size_t pubs_count,
     const secret_key &sec, std::size_t sec_index,
@@ -99,7 +99,10 @@ uint64_t rx_seedheight(const uint64_t height);
 void rx_seedheights(const uint64_t height, uint64_t *seed_height, uint64_t *next_height);
 
 void rx_set_main_seedhash(const char *seedhash, size_t max_dataset_init_threads);
+void rx_set_next_seedhash(const char *seedhash, size_t max_dataset_init_threads);
 void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *result_hash);
 
 void rx_set_miner_thread(uint32_t value, size_t max_dataset_init_threads);
 uint32_t rx_get_miner_thread(void);
+void rx_get_cache_stats(uint64_t *main_hits, uint64_t *secondary_hits, uint64_t *secondary_misses);
+void rx_get_memory_usage(uint64_t *dataset_bytes, uint64_t *cache_bytes);
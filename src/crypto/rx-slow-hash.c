@@ -54,11 +54,72 @@ static randomx_cache *main_cache = NULL;
 static char main_seedhash[HASH_SIZE];
 static int main_seedhash_set = 0;
 
-static CTHR_RWLOCK_TYPE secondary_cache_lock = CTHR_RWLOCK_INIT;
+// Light mode caches for seeds other than the main one, eg. when syncing across several
+// epochs at once. The least recently used one is reseeded on a miss.
+#define RX_SECONDARY_CACHES	3
 
-static randomx_cache *secondary_cache = NULL;
-static char secondary_seedhash[HASH_SIZE];
-static int secondary_seedhash_set = 0;
+typedef struct rx_cache_slot {
+  CTHR_RWLOCK_TYPE lock;
+  randomx_cache *cache;
+  char seedhash[HASH_SIZE];
+  int seedhash_set;
+  uint64_t last_used;
+  uint64_t hits;
+} rx_cache_slot;
+
+static rx_cache_slot secondary_caches[RX_SECONDARY_CACHES] = {
+  { CTHR_RWLOCK_INIT, NULL, {0}, 0, 0, 0 },
+  { CTHR_RWLOCK_INIT, NULL, {0}, 0, 0, 0 },
+  { CTHR_RWLOCK_INIT, NULL, {0}, 0, 0, 0 },
+};
+
+static uint64_t cache_tick = 0;
+static uint64_t main_hits = 0;
+static uint64_t secondary_hits = 0;
+static uint64_t secondary_misses = 0;
+
+#if defined(_MSC_VER)
+#define RX_ATOMIC_INC(x)	InterlockedIncrement64((volatile LONG64*)&(x))
+#define RX_ATOMIC_LOAD(x)	(*(volatile uint64_t*)&(x))
+#else
+#define RX_ATOMIC_INC(x)	__atomic_add_fetch(&(x), 1, __ATOMIC_RELAXED)
+#define RX_ATOMIC_LOAD(x)	__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#endif
+
+// Cache (and optionally dataset) for the upcoming epoch, built in the background while
+// the chain is inside the SEEDHASH_EPOCH_LAG window so the switch is a pointer swap
+static CTHR_RWLOCK_TYPE next_lock = CTHR_RWLOCK_INIT;
+
+static randomx_dataset *next_dataset = NULL;
+static randomx_cache *next_cache = NULL;
+static char next_seedhash[HASH_SIZE];
+static int next_seedhash_set = 0;
+static int next_dataset_ready = 0;
+static int next_building = 0;
+
+// Full VMs used by verification threads; each slot remembers the dataset it was bound to
+#define RX_VM_POOL_SIZE	16
+
+static CTHR_RWLOCK_TYPE vm_pool_lock = CTHR_RWLOCK_INIT;
+
+static randomx_vm *vm_pool[RX_VM_POOL_SIZE];
+static randomx_dataset *vm_pool_dataset[RX_VM_POOL_SIZE];
+static size_t vm_pool_count = 0;
+
+// Light VMs shared by verification threads, so thread pool workers that exit through
+// slow_hash_free_state don't recompile them for every batch
+#define RX_LIGHT_VM_POOL_SIZE	32
+
+typedef struct rx_light_vm {
+  randomx_vm *vm;
+  randomx_cache *cache;
+  char seedhash[HASH_SIZE];
+} rx_light_vm;
+
+static CTHR_RWLOCK_TYPE light_vm_pool_lock = CTHR_RWLOCK_INIT;
+
+static rx_light_vm light_vm_pool[RX_LIGHT_VM_POOL_SIZE];
+static size_t light_vm_pool_count = 0;
 
 #if defined(_MSC_VER)
 #define THREADV __declspec(thread)
@@ -67,13 +128,15 @@ static int secondary_seedhash_set = 0;
 #endif
 
 static THREADV randomx_vm *main_vm_full = NULL;
+static THREADV randomx_dataset *main_vm_full_dataset = NULL;
 static THREADV randomx_vm *main_vm_light = NULL;
 static THREADV randomx_vm *secondary_vm_light = NULL;
 
 static THREADV uint32_t miner_thread = 0;
 
 static bool is_main(const char* seedhash) { return main_seedhash_set && (memcmp(seedhash, main_seedhash, HASH_SIZE) == 0); }
-static bool is_secondary(const char* seedhash) { return secondary_seedhash_set && (memcmp(seedhash, secondary_seedhash, HASH_SIZE) == 0); }
+static bool is_slot(const rx_cache_slot* slot, const char* seedhash) { return slot->seedhash_set && (memcmp(seedhash, slot->seedhash, HASH_SIZE) == 0); }
+static bool is_next(const char* seedhash) { return next_seedhash_set && (memcmp(seedhash, next_seedhash, HASH_SIZE) == 0); }
 
 static void local_abort(const char *msg)
 {
@@ -133,6 +196,19 @@ static inline int enabled_flags(void) {
   return flags;
 }
 
+// Pre-seeding the next dataset doubles the full-mem footprint, so it's opt-in
+static inline int preseed_dataset_enabled(void) {
+  static int enabled = -1;
+
+  if (enabled != -1) {
+    return enabled;
+  }
+
+  enabled = getenv("MONERO_RANDOMX_PRESEED_DATASET") ? 1 : 0;
+
+  return enabled;
+}
+
 #define SEEDHASH_EPOCH_BLOCKS	2048	/* Must be same as BLOCKS_SYNCHRONIZING_MAX_COUNT in cryptonote_config.h */
 #define SEEDHASH_EPOCH_LAG		64
 
@@ -286,7 +362,110 @@ static void rx_init_light_vm(randomx_flags flags, randomx_vm** vm, randomx_cache
   }
 }
 
+// Must be called with the lock of `cache` held, `seedhash` being what it was initialized with
+static randomx_vm* rx_borrow_light_vm(randomx_flags flags, randomx_cache* cache, const char* seedhash)
+{
+  randomx_vm *vm = NULL;
+  int bound = 0;
+
+  CTHR_RWLOCK_LOCK_WRITE(light_vm_pool_lock);
+  if (light_vm_pool_count > 0) {
+    // Prefer a VM already set up for this cache, otherwise take any and reprogram it
+    size_t idx = light_vm_pool_count - 1;
+    for (size_t i = 0; i < light_vm_pool_count; ++i) {
+      if (light_vm_pool[i].cache == cache && memcmp(light_vm_pool[i].seedhash, seedhash, HASH_SIZE) == 0) {
+        idx = i;
+        bound = 1;
+        break;
+      }
+    }
+    vm = light_vm_pool[idx].vm;
+    --light_vm_pool_count;
+    light_vm_pool[idx] = light_vm_pool[light_vm_pool_count];
+  }
+  CTHR_RWLOCK_UNLOCK_WRITE(light_vm_pool_lock);
+
+  if (!bound) {
+    rx_init_light_vm(flags, &vm, cache);
+  }
+  return vm;
+}
+
+// Must be called with the lock of `cache` held, `seedhash` being what it was initialized with
+static void rx_return_light_vm(randomx_vm* vm, randomx_cache* cache, const char* seedhash)
+{
+  CTHR_RWLOCK_LOCK_WRITE(light_vm_pool_lock);
+  if (light_vm_pool_count < RX_LIGHT_VM_POOL_SIZE) {
+    rx_light_vm *entry = &light_vm_pool[light_vm_pool_count];
+    entry->vm = vm;
+    entry->cache = cache;
+    memcpy(entry->seedhash, seedhash, HASH_SIZE);
+    ++light_vm_pool_count;
+    vm = NULL;
+  }
+  CTHR_RWLOCK_UNLOCK_WRITE(light_vm_pool_lock);
+
+  if (vm) {
+    randomx_destroy_vm(vm);
+  }
+}
+
+static void rx_light_hash(randomx_flags flags, randomx_cache* cache, const char* seedhash, randomx_vm** thread_vm,
+                          const void *data, size_t length, char *result_hash)
+{
+  // Miner threads keep their own non-secure VM for the lifetime of the thread
+  if (miner_thread) {
+    rx_init_light_vm(flags, thread_vm, cache);
+    randomx_calculate_hash(*thread_vm, data, length, result_hash);
+    return;
+  }
+
+  randomx_vm *vm = rx_borrow_light_vm(flags, cache, seedhash);
+  randomx_calculate_hash(vm, data, length, result_hash);
+  rx_return_light_vm(vm, cache, seedhash);
+}
+
+// Must be called with main_dataset_lock held for reading
+static randomx_vm* rx_borrow_full_vm(randomx_flags flags)
+{
+  randomx_vm *vm = NULL;
+  randomx_dataset *bound = NULL;
+
+  CTHR_RWLOCK_LOCK_WRITE(vm_pool_lock);
+  if (vm_pool_count > 0) {
+    --vm_pool_count;
+    vm = vm_pool[vm_pool_count];
+    bound = vm_pool_dataset[vm_pool_count];
+  }
+  CTHR_RWLOCK_UNLOCK_WRITE(vm_pool_lock);
+
+  if (!vm) {
+    rx_init_full_vm(flags, &vm);
+  } else if (bound != main_dataset) {
+    randomx_vm_set_dataset(vm, main_dataset);
+  }
+  return vm;
+}
+
+// Must be called with main_dataset_lock held for reading
+static void rx_return_full_vm(randomx_vm* vm)
+{
+  CTHR_RWLOCK_LOCK_WRITE(vm_pool_lock);
+  if (vm_pool_count < RX_VM_POOL_SIZE) {
+    vm_pool[vm_pool_count] = vm;
+    vm_pool_dataset[vm_pool_count] = main_dataset;
+    ++vm_pool_count;
+    vm = NULL;
+  }
+  CTHR_RWLOCK_UNLOCK_WRITE(vm_pool_lock);
+
+  if (vm) {
+    randomx_destroy_vm(vm);
+  }
+}
+
 typedef struct seedinfo {
+  randomx_dataset *si_dataset;
   randomx_cache *si_cache;
   unsigned long si_start;
   unsigned long si_count;
@@ -294,17 +473,11 @@ typedef struct seedinfo {
 
 static CTHR_THREAD_RTYPE rx_seedthread(void *arg) {
   seedinfo *si = arg;
-  randomx_init_dataset(main_dataset, si->si_cache, si->si_start, si->si_count);
+  randomx_init_dataset(si->si_dataset, si->si_cache, si->si_start, si->si_count);
   CTHR_THREAD_RETURN;
 }
 
-static void rx_init_dataset(size_t max_threads) {
-  if (!main_dataset) {
-    return;
-  }
-
-  // leave 2 CPU cores for other tasks
-  const size_t num_threads = (max_threads < 4) ? 1 : (max_threads - 2);
+static void rx_fill_dataset(randomx_dataset *dataset, randomx_cache *cache, size_t num_threads) {
   seedinfo* si = malloc(num_threads * sizeof(seedinfo));
   if (!si) local_abort("Couldn't allocate RandomX mining threadinfo");
 
@@ -313,31 +486,44 @@ static void rx_init_dataset(size_t max_threads) {
 
   const size_t n1 = num_threads - 1;
   for (size_t i = 0; i < n1; ++i) {
-    si[i].si_cache = main_cache;
+    si[i].si_dataset = dataset;
+    si[i].si_cache = cache;
     si[i].si_start = start;
     si[i].si_count = delta;
     start += delta;
   }
 
-  si[n1].si_cache = main_cache;
+  si[n1].si_dataset = dataset;
+  si[n1].si_cache = cache;
   si[n1].si_start = start;
   si[n1].si_count = randomx_dataset_item_count() - start;
 
   CTHR_THREAD_TYPE *st = malloc(num_threads * sizeof(CTHR_THREAD_TYPE));
   if (!st) local_abort("Couldn't allocate RandomX mining threadlist");
 
-  CTHR_RWLOCK_LOCK_READ(main_cache_lock);
   for (size_t i = 0; i < n1; ++i) {
     if (!CTHR_THREAD_CREATE(st[i], rx_seedthread, &si[i])) {
       local_abort("Couldn't start RandomX seed thread");
     }
   }
-  randomx_init_dataset(main_dataset, si[n1].si_cache, si[n1].si_start, si[n1].si_count);
+  randomx_init_dataset(dataset, si[n1].si_cache, si[n1].si_start, si[n1].si_count);
   for (size_t i = 0; i < n1; ++i) CTHR_THREAD_JOIN(st[i]);
-  CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
 
   free(st);
   free(si);
+}
+
+static void rx_init_dataset(size_t max_threads) {
+  if (!main_dataset) {
+    return;
+  }
+
+  // leave 2 CPU cores for other tasks
+  const size_t num_threads = (max_threads < 4) ? 1 : (max_threads - 2);
+
+  CTHR_RWLOCK_LOCK_READ(main_cache_lock);
+  rx_fill_dataset(main_dataset, main_cache, num_threads);
+  CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
 
   minfo(RX_LOGCAT, "RandomX dataset initialized");
 }
@@ -371,13 +557,40 @@ static CTHR_THREAD_RTYPE rx_set_main_seedhash_thread(void *arg) {
   rx_alloc_dataset(flags, &main_dataset, 0);
   rx_alloc_cache(flags, &main_cache);
 
-  randomx_init_cache(main_cache, info->seedhash, HASH_SIZE);
-  minfo(RX_LOGCAT, "RandomX main cache initialized");
+  // If this epoch was pre-seeded, swap it in and keep the old buffers for the next one
+  int cache_ready = 0, dataset_ready = 0;
+  CTHR_RWLOCK_LOCK_WRITE(next_lock);
+  if (is_next(info->seedhash)) {
+    randomx_cache *cache = main_cache;
+    main_cache = next_cache;
+    next_cache = cache;
+    cache_ready = 1;
+    if (next_dataset_ready && main_dataset) {
+      randomx_dataset *dataset = main_dataset;
+      main_dataset = next_dataset;
+      next_dataset = dataset;
+      dataset_ready = 1;
+    }
+    next_seedhash_set = 0;
+    next_dataset_ready = 0;
+  }
+  CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+
+  if (cache_ready) {
+    minfo(RX_LOGCAT, "RandomX main cache switched to pre-seeded cache");
+  } else {
+    randomx_init_cache(main_cache, info->seedhash, HASH_SIZE);
+    minfo(RX_LOGCAT, "RandomX main cache initialized");
+  }
 
   CTHR_RWLOCK_UNLOCK_WRITE(main_cache_lock);
 
   // From this point, rx_slow_hash can calculate hashes in light mode, but dataset is not initialized yet
-  rx_init_dataset(info->max_threads);
+  if (dataset_ready) {
+    minfo(RX_LOGCAT, "RandomX dataset switched to pre-seeded dataset");
+  } else {
+    rx_init_dataset(info->max_threads);
+  }
 
   CTHR_RWLOCK_UNLOCK_WRITE(main_dataset_lock);
 
@@ -405,6 +618,79 @@ void rx_set_main_seedhash(const char *seedhash, size_t max_dataset_init_threads)
   CTHR_THREAD_CLOSE(t);
 }
 
+static CTHR_THREAD_RTYPE rx_set_next_seedhash_thread(void *arg) {
+  thread_info* info = arg;
+
+  // Take the spare buffers out so the build runs without holding next_lock,
+  // otherwise an early epoch switch would stall every hashing thread behind it
+  CTHR_RWLOCK_LOCK_WRITE(next_lock);
+  if (next_building || is_next(info->seedhash)) {
+    CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+    free(info);
+    CTHR_THREAD_RETURN;
+  }
+  next_building = 1;
+  next_seedhash_set = 0;
+  next_dataset_ready = 0;
+  randomx_cache *cache = next_cache;
+  randomx_dataset *dataset = next_dataset;
+  next_cache = NULL;
+  next_dataset = NULL;
+  CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+
+  char buf[HASH_SIZE * 2 + 1];
+  hash2hex(info->seedhash, buf);
+  minfo(RX_LOGCAT, "RandomX pre-seeding next seed hash %s", buf);
+
+  const randomx_flags flags = enabled_flags() & ~disabled_flags();
+  rx_alloc_cache(flags, &cache);
+  randomx_init_cache(cache, info->seedhash, HASH_SIZE);
+
+  int dataset_ready = 0;
+  if (main_dataset && preseed_dataset_enabled()) {
+    rx_alloc_dataset(flags, &dataset, 1);
+    if (dataset) {
+      // Only use half of the cores, blocks are still being verified with the current dataset
+      const size_t num_threads = (info->max_threads < 4) ? 1 : (info->max_threads / 2);
+      rx_fill_dataset(dataset, cache, num_threads);
+      dataset_ready = 1;
+    }
+  }
+
+  CTHR_RWLOCK_LOCK_WRITE(next_lock);
+  next_cache = cache;
+  next_dataset = dataset;
+  memcpy(next_seedhash, info->seedhash, HASH_SIZE);
+  next_seedhash_set = 1;
+  next_dataset_ready = dataset_ready;
+  next_building = 0;
+  CTHR_RWLOCK_UNLOCK_WRITE(next_lock);
+
+  minfo(RX_LOGCAT, "RandomX next %s pre-seeded", dataset_ready ? "cache and dataset" : "cache");
+
+  free(info);
+  CTHR_THREAD_RETURN;
+}
+
+void rx_set_next_seedhash(const char *seedhash, size_t max_dataset_init_threads) {
+  // Early out if seedhash is already in use or prepared
+  if (is_main(seedhash) || is_next(seedhash) || next_building) {
+    return;
+  }
+
+  thread_info* info = malloc(sizeof(thread_info));
+  if (!info) local_abort("Couldn't allocate RandomX mining threadinfo");
+
+  memcpy(info->seedhash, seedhash, HASH_SIZE);
+  info->max_threads = max_dataset_init_threads;
+
+  CTHR_THREAD_TYPE t;
+  if (!CTHR_THREAD_CREATE(t, rx_set_next_seedhash_thread, info)) {
+    local_abort("Couldn't start RandomX seed thread");
+  }
+  CTHR_THREAD_CLOSE(t);
+}
+
 void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *result_hash) {
   const randomx_flags flags = enabled_flags() & ~disabled_flags();
   int success = 0;
@@ -416,10 +702,24 @@ void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *r
     if (main_dataset && CTHR_RWLOCK_TRYLOCK_READ(main_dataset_lock)) {
       // Double check that main_seedhash didn't change
       if (is_main(seedhash)) {
-        rx_init_full_vm(flags, &main_vm_full);
-        if (main_vm_full) {
-          randomx_calculate_hash(main_vm_full, data, length, result_hash);
-          success = 1;
+        if (miner_thread) {
+          // Miner threads keep their own non-secure VM for the lifetime of the thread
+          if (main_vm_full && main_vm_full_dataset != main_dataset) {
+            randomx_vm_set_dataset(main_vm_full, main_dataset);
+          }
+          rx_init_full_vm(flags, &main_vm_full);
+          main_vm_full_dataset = main_dataset;
+          if (main_vm_full) {
+            randomx_calculate_hash(main_vm_full, data, length, result_hash);
+            success = 1;
+          }
+        } else {
+          randomx_vm *vm = rx_borrow_full_vm(flags);
+          if (vm) {
+            randomx_calculate_hash(vm, data, length, result_hash);
+            rx_return_full_vm(vm);
+            success = 1;
+          }
         }
       }
       CTHR_RWLOCK_UNLOCK_READ(main_dataset_lock);
@@ -427,8 +727,7 @@ void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *r
       CTHR_RWLOCK_LOCK_READ(main_cache_lock);
       // Double check that main_seedhash didn't change
       if (is_main(seedhash)) {
-        rx_init_light_vm(flags, &main_vm_light, main_cache);
-        randomx_calculate_hash(main_vm_light, data, length, result_hash);
+        rx_light_hash(flags, main_cache, seedhash, &main_vm_light, data, length, result_hash);
         success = 1;
       }
       CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
@@ -436,55 +735,100 @@ void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *r
   }
 
   if (success) {
+    RX_ATOMIC_INC(main_hits);
     return;
   }
 
   char buf[HASH_SIZE * 2 + 1];
 
-  // Slow path (seedhash != main_seedhash, but seedhash == secondary_seedhash)
+  // Slow path (seedhash != main_seedhash, but seedhash is in one of the secondary caches)
   // Multiple threads can run in parallel in light mode, 10-15 ms per hash per thread
-  if (!secondary_cache) {
-    CTHR_RWLOCK_LOCK_WRITE(secondary_cache_lock);
-    if (!secondary_cache) {
-      hash2hex(seedhash, buf);
-      minfo(RX_LOGCAT, "RandomX new secondary seed hash is %s", buf);
-
-      rx_alloc_cache(flags, &secondary_cache);
-      randomx_init_cache(secondary_cache, seedhash, HASH_SIZE);
-      minfo(RX_LOGCAT, "RandomX secondary cache updated");
-      memcpy(secondary_seedhash, seedhash, HASH_SIZE);
-      secondary_seedhash_set = 1;
+  for (size_t i = 0; i < RX_SECONDARY_CACHES; ++i) {
+    rx_cache_slot *slot = &secondary_caches[i];
+    if (!is_slot(slot, seedhash)) {
+      continue;
     }
-    CTHR_RWLOCK_UNLOCK_WRITE(secondary_cache_lock);
-  }
+    CTHR_RWLOCK_LOCK_READ(slot->lock);
+    // Double check that the slot wasn't reseeded
+    if (is_slot(slot, seedhash)) {
+      slot->last_used = RX_ATOMIC_INC(cache_tick);
+      RX_ATOMIC_INC(slot->hits);
+      rx_light_hash(flags, slot->cache, seedhash, &secondary_vm_light, data, length, result_hash);
+      success = 1;
+    }
+    CTHR_RWLOCK_UNLOCK_READ(slot->lock);
 
-  CTHR_RWLOCK_LOCK_READ(secondary_cache_lock);
-  if (is_secondary(seedhash)) {
-    rx_init_light_vm(flags, &secondary_vm_light, secondary_cache);
-    randomx_calculate_hash(secondary_vm_light, data, length, result_hash);
-    success = 1;
+    if (success) {
+      RX_ATOMIC_INC(secondary_hits);
+      return;
+    }
   }
-  CTHR_RWLOCK_UNLOCK_READ(secondary_cache_lock);
 
-  if (success) {
-    return;
+  // Slowest path (seedhash isn't cached anywhere)
+  // The least recently used secondary cache is reseeded while holding its lock, up to 200-500 ms per hash
+  RX_ATOMIC_INC(secondary_misses);
+  rx_cache_slot *victim = &secondary_caches[0];
+  for (size_t i = 1; i < RX_SECONDARY_CACHES; ++i) {
+    if (secondary_caches[i].last_used < victim->last_used) {
+      victim = &secondary_caches[i];
+    }
   }
 
-  // Slowest path (seedhash != main_seedhash, seedhash != secondary_seedhash)
-  // Only one thread runs at a time and updates secondary_seedhash if needed, up to 200-500 ms per hash
-  CTHR_RWLOCK_LOCK_WRITE(secondary_cache_lock);
-  if (!is_secondary(seedhash)) {
+  CTHR_RWLOCK_LOCK_WRITE(victim->lock);
+  // Another thread may have just seeded it with the same hash
+  if (!is_slot(victim, seedhash)) {
+    if (victim->seedhash_set) {
+      hash2hex(victim->seedhash, buf);
+      mdebug(RX_LOGCAT, "RandomX evicting secondary seed hash %s after %llu hits", buf, (unsigned long long)victim->hits);
+    }
     hash2hex(seedhash, buf);
     minfo(RX_LOGCAT, "RandomX new secondary seed hash is %s", buf);
 
-    randomx_init_cache(secondary_cache, seedhash, HASH_SIZE);
+    victim->seedhash_set = 0;
+    rx_alloc_cache(flags, &victim->cache);
+    randomx_init_cache(victim->cache, seedhash, HASH_SIZE);
     minfo(RX_LOGCAT, "RandomX secondary cache updated");
-    memcpy(secondary_seedhash, seedhash, HASH_SIZE);
-    secondary_seedhash_set = 1;
+    memcpy(victim->seedhash, seedhash, HASH_SIZE);
+    victim->seedhash_set = 1;
+    victim->hits = 0;
   }
-  rx_init_light_vm(flags, &secondary_vm_light, secondary_cache);
-  randomx_calculate_hash(secondary_vm_light, data, length, result_hash);
-  CTHR_RWLOCK_UNLOCK_WRITE(secondary_cache_lock);
+  victim->last_used = RX_ATOMIC_INC(cache_tick);
+  rx_light_hash(flags, victim->cache, seedhash, &secondary_vm_light, data, length, result_hash);
+  CTHR_RWLOCK_UNLOCK_WRITE(victim->lock);
+}
+
+void rx_get_cache_stats(uint64_t *main, uint64_t *secondary, uint64_t *misses) {
+  *main = RX_ATOMIC_LOAD(main_hits);
+  *secondary = RX_ATOMIC_LOAD(secondary_hits);
+  *misses = RX_ATOMIC_LOAD(secondary_misses);
+}
+
+// Not exposed by randomx.h; these are the sizes in RandomX's configuration.h
+#define RX_DATASET_ITEM_SIZE	64
+#define RX_CACHE_SIZE	(262144ull * 1024)
+
+void rx_get_memory_usage(uint64_t *dataset_bytes, uint64_t *cache_bytes) {
+  const uint64_t dataset_size = (uint64_t)randomx_dataset_item_count() * RX_DATASET_ITEM_SIZE;
+  uint64_t datasets = 0, caches = 0;
+
+  CTHR_RWLOCK_LOCK_READ(main_dataset_lock);
+  datasets += main_dataset != NULL;
+  CTHR_RWLOCK_UNLOCK_READ(main_dataset_lock);
+  CTHR_RWLOCK_LOCK_READ(main_cache_lock);
+  caches += main_cache != NULL;
+  CTHR_RWLOCK_UNLOCK_READ(main_cache_lock);
+  CTHR_RWLOCK_LOCK_READ(next_lock);
+  datasets += next_dataset != NULL;
+  caches += next_cache != NULL;
+  CTHR_RWLOCK_UNLOCK_READ(next_lock);
+  for (size_t i = 0; i < RX_SECONDARY_CACHES; ++i) {
+    CTHR_RWLOCK_LOCK_READ(secondary_caches[i].lock);
+    caches += secondary_caches[i].cache != NULL;
+    CTHR_RWLOCK_UNLOCK_READ(secondary_caches[i].lock);
+  }
+
+  *dataset_bytes = datasets * dataset_size;
+  *cache_bytes = caches * RX_CACHE_SIZE;
 }
 
 void rx_set_miner_thread(uint32_t value, size_t max_dataset_init_threads) {
@@ -519,6 +863,7 @@ static void rx_destroy_vm(randomx_vm** vm) {
 
 void rx_slow_hash_free_state() {
   rx_destroy_vm(&main_vm_full);
+  main_vm_full_dataset = NULL;
   rx_destroy_vm(&main_vm_light);
   rx_destroy_vm(&secondary_vm_light);
 }
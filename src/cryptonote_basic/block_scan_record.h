@@ -0,0 +1,102 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "serialization/containers.h"
+#include "serialization/crypto.h"
+#include "serialization/serialization.h"
+#include "serialization/string.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief the part of a transaction output needed to test its view tag
+   */
+  struct output_scan_record
+  {
+    crypto::public_key onetime_address;
+    std::string asset_type;
+    std::string view_tag; // 3 bytes for Carrot outputs, 1 byte for tagged legacy outputs, empty otherwise
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(onetime_address)
+      FIELD(asset_type)
+      FIELD(view_tag)
+    END_SERIALIZE()
+  };
+
+  /**
+   * @brief the part of a transaction needed to test the view tags of its outputs
+   *
+   * The Carrot input context is first_key_image for transactions spending key images, and
+   * coinbase_height for transactions with a txin_gen input (miner and protocol txs).
+   */
+  struct tx_scan_record
+  {
+    crypto::hash tx_hash;
+    uint8_t tx_type;
+    crypto::key_image first_key_image;
+    uint64_t coinbase_height;
+    std::vector<crypto::public_key> tx_pub_keys;
+    std::vector<crypto::public_key> additional_tx_pub_keys;
+    std::vector<output_scan_record> outputs;
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(tx_hash)
+      FIELD(tx_type)
+      FIELD(first_key_image)
+      VARINT_FIELD(coinbase_height)
+      FIELD(tx_pub_keys)
+      FIELD(additional_tx_pub_keys)
+      FIELD(outputs)
+    END_SERIALIZE()
+  };
+
+  /**
+   * @brief compact per-block record of everything a wallet needs to test view tags
+   *
+   * Transactions are in block order: miner tx, protocol tx, then the block's transactions.
+   */
+  struct block_scan_record
+  {
+    crypto::hash block_hash;
+    std::vector<tx_scan_record> txs;
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(block_hash)
+      FIELD(txs)
+    END_SERIALIZE()
+  };
+}
@@ -29,12 +29,39 @@
 
 #include "connection_context.h"
 
+#include <atomic>
 #include <boost/optional/optional.hpp>
+#include "common/metrics.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "p2p/p2p_protocol_defs.h"
 
 namespace cryptonote
 {
+  namespace
+  {
+    constexpr const std::size_t traffic_slots = std::tuple_size<decltype(cryptonote_connection_context::m_command_traffic)>::value;
+
+    // node wide byte counters, using the same slots as the per connection stats
+    tools::metrics::counter &traffic_bytes(const std::size_t slot, const int command, const bool sent)
+    {
+      static std::array<std::atomic<tools::metrics::counter*>, traffic_slots * 2> counters{};
+      std::atomic<tools::metrics::counter*> &cached = counters[slot * 2 + sent];
+      tools::metrics::counter *counter = cached.load(std::memory_order_acquire);
+      if (!counter)
+      {
+        counter = &tools::metrics::get_counter("levin_bytes_total", "Levin payload bytes by command",
+          tools::metrics::label("command", std::to_string(command)) + "," + tools::metrics::label("direction", sent ? "sent" : "received"));
+        cached.store(counter, std::memory_order_release);
+      }
+      return *counter;
+    }
+
+    tools::metrics::counter &compression_counter(const char *name, const char *help, const bool sent)
+    {
+      return tools::metrics::get_counter(name, help, tools::metrics::label("direction", sent ? "sent" : "received"));
+    }
+  }
+
   std::size_t cryptonote_connection_context::get_max_bytes(const int command) noexcept
   {
     switch (command)
@@ -82,6 +109,66 @@ namespace cryptonote
     m_requested_objects.clear();
   }
 
+  void cryptonote_connection_context::on_command_traffic(const int command, const bool sent, const std::size_t bytes) const noexcept
+  {
+    // p2p commands take the first half of the slots, protocol commands the second
+    static constexpr const int pool_slots = traffic_slots / 2;
+    int slot;
+    if (command > P2P_COMMANDS_POOL_BASE && command <= P2P_COMMANDS_POOL_BASE + pool_slots)
+      slot = command - P2P_COMMANDS_POOL_BASE - 1;
+    else if (command > BC_COMMANDS_POOL_BASE && command <= BC_COMMANDS_POOL_BASE + pool_slots)
+      slot = pool_slots + command - BC_COMMANDS_POOL_BASE - 1;
+    else
+      return;
+
+    traffic_bytes(slot, command, sent).inc(bytes);
+
+    command_traffic &traffic = m_command_traffic[slot];
+    traffic.command = command;
+    if (sent)
+    {
+      ++traffic.send_count;
+      traffic.send_bytes += bytes;
+    }
+    else
+    {
+      ++traffic.recv_count;
+      traffic.recv_bytes += bytes;
+    }
+  }
+
+  void cryptonote_connection_context::on_compression_traffic(const bool sent, const std::size_t bytes, const std::size_t wire_bytes, const std::uint64_t microseconds) const noexcept
+  {
+    static tools::metrics::counter &sent_bytes = compression_counter("levin_compression_bytes_total", "Levin payload bytes before compression", true);
+    static tools::metrics::counter &received_bytes = compression_counter("levin_compression_bytes_total", "Levin payload bytes before compression", false);
+    static tools::metrics::counter &sent_wire_bytes = compression_counter("levin_compression_wire_bytes_total", "Levin payload bytes after compression", true);
+    static tools::metrics::counter &received_wire_bytes = compression_counter("levin_compression_wire_bytes_total", "Levin payload bytes after compression", false);
+    static tools::metrics::counter &sent_us = compression_counter("levin_compression_microseconds_total", "Time spent compressing or decompressing levin payloads", true);
+    static tools::metrics::counter &received_us = compression_counter("levin_compression_microseconds_total", "Time spent compressing or decompressing levin payloads", false);
+
+    compression_traffic &traffic = m_compression_traffic;
+    if (sent)
+    {
+      sent_bytes.inc(bytes);
+      sent_wire_bytes.inc(wire_bytes);
+      sent_us.inc(microseconds);
+      ++traffic.send_count;
+      traffic.send_bytes += bytes;
+      traffic.send_wire_bytes += wire_bytes;
+      traffic.compress_us += microseconds;
+    }
+    else
+    {
+      received_bytes.inc(bytes);
+      received_wire_bytes.inc(wire_bytes);
+      received_us.inc(microseconds);
+      ++traffic.recv_count;
+      traffic.recv_bytes += bytes;
+      traffic.recv_wire_bytes += wire_bytes;
+      traffic.decompress_us += microseconds;
+    }
+  }
+
   boost::optional<crypto::hash> cryptonote_connection_context::get_expected_hash(const uint64_t height) const
   {
     const auto difference = height - m_expected_heights_start;
@@ -31,6 +31,7 @@
 
 #pragma once
 #include <unordered_set>
+#include <array>
 #include <atomic>
 #include <algorithm>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -45,7 +46,7 @@ namespace cryptonote
     cryptonote_connection_context(): m_state(state_before_handshake), m_remote_blockchain_height(0), m_last_response_height(0),
         m_expected_heights_start(0), m_last_request_time(boost::date_time::not_a_date_time), m_callback_request_count(0),
         m_last_known_hash(crypto::null_hash), m_pruning_seed(0), m_rpc_port(0), m_rpc_credits_per_hash(0), m_anchor(false), m_score(0),
-        m_expect_response(0), m_expect_height(0), m_num_requested(0) {}
+        m_expect_response(0), m_expect_height(0), m_num_requested(0), m_levin_compression(false) {}
 
     enum state
     {
@@ -98,6 +99,35 @@ namespace cryptonote
 
     boost::optional<crypto::hash> get_expected_hash(uint64_t height) const;
 
+    struct command_traffic
+    {
+      int command;
+      uint64_t recv_count;
+      uint64_t recv_bytes;
+      uint64_t send_count;
+      uint64_t send_bytes;
+    };
+
+    //! Accounts a levin message of `bytes` for `command`; commands outside the p2p and protocol pools are not tracked.
+    void on_command_traffic(int command, bool sent, size_t bytes) const noexcept;
+
+    struct compression_traffic
+    {
+      uint64_t send_count;
+      uint64_t send_bytes;       //!< before compression
+      uint64_t send_wire_bytes;  //!< after compression, or as sent when it did not shrink
+      uint64_t compress_us;
+      uint64_t recv_count;
+      uint64_t recv_bytes;
+      uint64_t recv_wire_bytes;
+      uint64_t decompress_us;
+    };
+
+    //! Accounts a levin payload of `bytes` sent or received as `wire_bytes`, and the time spent (de)compressing it.
+    void on_compression_traffic(bool sent, size_t bytes, size_t wire_bytes, uint64_t microseconds) const noexcept;
+
+    bool levin_compression() const noexcept { return m_levin_compression; }
+
     state m_state;
     std::vector<std::pair<crypto::hash, uint64_t>> m_needed_objects;
     std::vector<crypto::hash> m_expected_heights;
@@ -118,6 +148,9 @@ namespace cryptonote
     size_t m_num_requested;
     copyable_atomic m_new_stripe_notification{0};
     copyable_atomic m_idle_peer_notification{0};
+    mutable std::array<command_traffic, 32> m_command_traffic{}; //!< slot command is 0 until used
+    bool m_levin_compression; //!< both sides offered P2P_SUPPORT_FLAG_LEVIN_COMPRESSION
+    mutable compression_traffic m_compression_traffic{};
   };
 
   inline std::string get_protocol_state_string(cryptonote_connection_context::state s)
@@ -94,6 +94,8 @@ namespace cryptonote
     return &reinterpret_cast<const unsigned char &>(point);
   }
 
+  static bool calculate_transaction_hash_from_blob(const transaction& t, const blobdata_ref& blob, crypto::hash& res);
+
   // a copy of rct::addKeys, since we can't link to libringct to avoid circular dependencies
   static void add_public_key(crypto::public_key &AB, const crypto::public_key &A, const crypto::public_key &B) {
       ge_p3 B2, A2;
@@ -258,6 +260,19 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------
+  bool parse_and_validate_tx_prefix_from_blob(const blobdata_ref& tx_blob, transaction_prefix& tx, crypto::hash& tx_prefix_hash)
+  {
+    // only the prefix is decoded, the signatures (pruned or not) are left untouched,
+    // and the prefix hash comes from the blob rather than from serializing it again
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
+    bool r = ::serialization::serialize_noeof(ba, tx);
+    CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction prefix from blob");
+    const size_t prefix_size = ba.getpos();
+    CHECK_AND_ASSERT_MES(prefix_size <= tx_blob.size(), false, "Inconsistent transaction prefix and blob sizes");
+    cryptonote::get_blob_hash(blobdata_ref(tx_blob.data(), prefix_size), tx_prefix_hash);
+    return true;
+  }
+  //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata_ref& tx_blob, transaction& tx, crypto::hash& tx_hash)
   {
     binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
@@ -265,16 +280,23 @@ namespace cryptonote
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     CHECK_AND_ASSERT_MES(expand_transaction_1(tx, false), false, "Failed to expand transaction data");
     tx.invalidate_hashes();
+    tx.set_blob_size(tx_blob.size());
     //TODO: validate tx
 
-    return get_transaction_hash(tx, tx_hash);
+    // we already have the blob, no need to serialize the tx again to hash it
+    CHECK_AND_ASSERT_MES(calculate_transaction_hash_from_blob(tx, tx_blob, tx_hash), false, "Failed to calculate transaction hash");
+    tx.set_hash(tx_hash);
+    ++tx_hashes_calculated_count;
+    return true;
   }
   //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata_ref& tx_blob, transaction& tx, crypto::hash& tx_hash, crypto::hash& tx_prefix_hash)
   {
     if (!parse_and_validate_tx_from_blob(tx_blob, tx, tx_hash))
       return false;
-    get_transaction_prefix_hash(tx, tx_prefix_hash);
+    const unsigned int prefix_size = tx.prefix_size;
+    CHECK_AND_ASSERT_MES(prefix_size <= tx_blob.size(), false, "Inconsistent transaction prefix and blob sizes");
+    cryptonote::get_blob_hash(blobdata_ref(tx_blob.data(), prefix_size), tx_prefix_hash);
     return true;
   }
   //---------------------------------------------------------------
@@ -756,6 +778,105 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------
+  bool parse_tx_extra_view(const std::vector<uint8_t>& tx_extra, tx_extra_view& view)
+  {
+    view = tx_extra_view{};
+
+    // reads exactly what binary_archive<false> would accept for each field
+    const uint8_t *p = tx_extra.data();
+    const uint8_t *const end = tx_extra.data() + tx_extra.size();
+    const auto read_varint = [&p, end](uint64_t &v) -> bool
+    {
+      const uint8_t *it = p;
+      const uint8_t *last = end;
+      if (tools::read_varint(it, last, v) < 0)
+        return false;
+      p = it;
+      return true;
+    };
+    // a varint size followed by that many bytes, as a serialized std::string
+    const auto read_string = [&p, end, &read_varint](epee::span<const uint8_t> &str) -> bool
+    {
+      uint64_t size;
+      if (!read_varint(size) || uint64_t(end - p) < size)
+        return false;
+      str = {p, size_t(size)};
+      p += size;
+      return true;
+    };
+
+    while (p != end)
+    {
+      const uint8_t tag = *p++;
+      epee::span<const uint8_t> str;
+      switch (tag)
+      {
+        case TX_EXTRA_TAG_PADDING:
+        {
+          // the tag counts towards the padding size, and padding must run to the end
+          size_t size = 1;
+          for (; size <= TX_EXTRA_PADDING_MAX_COUNT && p != end; ++size, ++p)
+            if (*p != 0)
+              return false;
+          if (size > TX_EXTRA_PADDING_MAX_COUNT)
+            return false;
+          break;
+        }
+        case TX_EXTRA_TAG_PUBKEY:
+          if (size_t(end - p) < sizeof(crypto::public_key))
+            return false;
+          if (view.num_pub_keys < tx_extra_view::MAX_PUB_KEYS)
+            view.pub_keys[view.num_pub_keys] = reinterpret_cast<const crypto::public_key*>(p);
+          ++view.num_pub_keys;
+          p += sizeof(crypto::public_key);
+          break;
+        case TX_EXTRA_NONCE:
+          if (!read_string(str) || str.size() > TX_EXTRA_NONCE_MAX_COUNT)
+            return false;
+          if (!view.has_nonce)
+          {
+            view.has_nonce = true;
+            view.nonce = str;
+          }
+          break;
+        case TX_EXTRA_MERGE_MINING_TAG:
+        {
+          // a string holding a varint depth then the merkle root, with nothing after
+          if (!read_string(str))
+            return false;
+          const uint8_t *it = str.begin();
+          const uint8_t *last = str.end();
+          uint64_t depth;
+          if (tools::read_varint(it, last, depth) < 0 || size_t(last - it) != sizeof(crypto::hash))
+            return false;
+          break;
+        }
+        case TX_EXTRA_TAG_ADDITIONAL_PUBKEYS:
+        {
+          uint64_t count;
+          if (!read_varint(count) || uint64_t(end - p) / sizeof(crypto::public_key) < count)
+            return false;
+          if (!view.has_additional_pub_keys)
+          {
+            view.has_additional_pub_keys = true;
+            view.additional_pub_keys = {reinterpret_cast<const crypto::public_key*>(p), size_t(count)};
+          }
+          p += count * sizeof(crypto::public_key);
+          break;
+        }
+        case TX_EXTRA_MYSTERIOUS_MINERGATE_TAG:
+          if (!read_string(str))
+            return false;
+          break;
+        default:
+          return false;
+      }
+    }
+
+    view.complete = true;
+    return true;
+  }
+  //---------------------------------------------------------------
   template<typename T>
   static bool pick(binary_archive<true> &ar, std::vector<tx_extra_field> &fields, uint8_t tag)
   {
@@ -836,6 +957,13 @@ namespace cryptonote
   //---------------------------------------------------------------
   crypto::public_key get_tx_pub_key_from_extra(const std::vector<uint8_t>& tx_extra, size_t pk_index)
   {
+    tx_extra_view view;
+    parse_tx_extra_view(tx_extra, view);
+    if (pk_index >= view.num_pub_keys)
+      return null_pkey;
+    if (pk_index < tx_extra_view::MAX_PUB_KEYS)
+      return *view.pub_keys[pk_index];
+
     std::vector<tx_extra_field> tx_extra_fields;
     parse_tx_extra(tx_extra, tx_extra_fields);
 
@@ -876,14 +1004,9 @@ namespace cryptonote
   //---------------------------------------------------------------
   std::vector<crypto::public_key> get_additional_tx_pub_keys_from_extra(const std::vector<uint8_t>& tx_extra)
   {
-    // parse
-    std::vector<tx_extra_field> tx_extra_fields;
-    parse_tx_extra(tx_extra, tx_extra_fields);
-    // find corresponding field
-    tx_extra_additional_pub_keys additional_pub_keys;
-    if(!find_tx_extra_field_by_type(tx_extra_fields, additional_pub_keys))
-      return {};
-    return additional_pub_keys.data;
+    tx_extra_view view;
+    parse_tx_extra_view(tx_extra, view);
+    return {view.additional_pub_keys.begin(), view.additional_pub_keys.end()};
   }
   //---------------------------------------------------------------
   std::vector<crypto::public_key> get_additional_tx_pub_keys_from_extra(const transaction_prefix& tx)
@@ -1118,7 +1241,7 @@ namespace cryptonote
     return "";
   }
   //---------------------------------------------------------------
-  uint32_t asset_id_from_type(const std::string asset_type)
+  uint32_t asset_id_from_type(const std::string &asset_type)
   {
     if (asset_type == "SAL") {
       return 0x53414C00;
@@ -1263,12 +1386,12 @@ namespace cryptonote
     }
     
     // check both strSource and strDest are supported.
-    if (std::find(oracle::ASSET_TYPES.begin(), oracle::ASSET_TYPES.end(), source) == oracle::ASSET_TYPES.end()) {
+    if (!oracle::is_known_asset_type(source)) {
       LOG_ERROR("Source Asset type " << source << " is not supported! Rejecting..");
       return false;
     }
     if (destination != "BURN") {
-      if (std::find(oracle::ASSET_TYPES.begin(), oracle::ASSET_TYPES.end(), destination) == oracle::ASSET_TYPES.end()) {
+      if (!oracle::is_known_asset_type(destination)) {
         LOG_ERROR("Destination Asset type " << destination << " is not supported! Rejecting..");
         return false;
       }
@@ -1304,22 +1427,75 @@ namespace cryptonote
       : boost::optional<crypto::view_tag>();
   }
   //---------------------------------------------------------------
-  bool get_output_asset_type(const cryptonote::tx_out& out, std::string& output_asset_type)
+  static const std::string* get_output_asset_type_ptr(const cryptonote::tx_out& out)
   {
     // before HF_VERSION_VIEW_TAGS, outputs with public keys are of type txout_to_key
     // after HF_VERSION_VIEW_TAGS, outputs with public keys are of type txout_to_tagged_key
     if (out.target.type() == typeid(txout_to_key))
-      output_asset_type = boost::get< txout_to_key>(out.target).asset_type;
+      return &boost::get< txout_to_key>(out.target).asset_type;
     else if (out.target.type() == typeid(txout_to_tagged_key))
-      output_asset_type = boost::get< txout_to_tagged_key >(out.target).asset_type;
+      return &boost::get< txout_to_tagged_key >(out.target).asset_type;
     else if (out.target.type() == typeid(txout_to_carrot_v1))
-      output_asset_type = boost::get<txout_to_carrot_v1>(out.target).asset_type;
-    else
-    {
-      LOG_ERROR("Unexpected output target type found: " << out.target.type().name() << " - cannot retrieve output_asset_type");
+      return &boost::get<txout_to_carrot_v1>(out.target).asset_type;
+
+    LOG_ERROR("Unexpected output target type found: " << out.target.type().name() << " - cannot retrieve output_asset_type");
+    return nullptr;
+  }
+  //---------------------------------------------------------------
+  bool get_output_asset_type(const cryptonote::tx_out& out, std::string& output_asset_type)
+  {
+    const std::string *asset_type = get_output_asset_type_ptr(out);
+    if (!asset_type)
       return false;
-    }
+    output_asset_type = *asset_type;
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool get_output_asset_id(const cryptonote::tx_out& out, oracle::asset_id& output_asset_id)
+  {
+    const std::string *asset_type = get_output_asset_type_ptr(out);
+    if (!asset_type)
+      return false;
+    output_asset_id = oracle::get_asset_id(*asset_type);
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool get_tx_scan_record(const transaction& tx, const crypto::hash& tx_hash, tx_scan_record& record)
+  {
+    record = tx_scan_record();
+    record.tx_hash = tx_hash;
+    record.tx_type = static_cast<uint8_t>(tx.type);
+    record.first_key_image = crypto::key_image{};
+    record.coinbase_height = 0;
+    if (!tx.vin.empty() && tx.vin[0].type() == typeid(txin_to_key))
+      record.first_key_image = boost::get<txin_to_key>(tx.vin[0]).k_image;
+    else if (!tx.vin.empty() && tx.vin[0].type() == typeid(txin_gen))
+      record.coinbase_height = boost::get<txin_gen>(tx.vin[0]).height;
+
+    tx_extra_view extra;
+    parse_tx_extra_view(tx.extra, extra);
+    if (extra.num_pub_keys > 0 && *extra.pub_keys[0] != crypto::null_pkey)
+      record.tx_pub_keys.push_back(*extra.pub_keys[0]);
+    record.additional_tx_pub_keys.assign(extra.additional_pub_keys.begin(), extra.additional_pub_keys.end());
 
+    record.outputs.reserve(tx.vout.size());
+    for (const tx_out &o : tx.vout)
+    {
+      output_scan_record out;
+      CHECK_AND_ASSERT_MES(get_output_public_key(o, out.onetime_address), false, "Failed to get output public key");
+      CHECK_AND_ASSERT_MES(get_output_asset_type(o, out.asset_type), false, "Failed to get output asset type");
+      if (o.target.type() == typeid(txout_to_carrot_v1))
+      {
+        const carrot::view_tag_t &vt = boost::get<txout_to_carrot_v1>(o.target).view_tag;
+        out.view_tag.assign(reinterpret_cast<const char*>(vt.bytes), sizeof(vt.bytes));
+      }
+      else if (o.target.type() == typeid(txout_to_tagged_key))
+      {
+        const crypto::view_tag &vt = boost::get<txout_to_tagged_key>(o.target).view_tag;
+        out.view_tag.assign(reinterpret_cast<const char*>(&vt), sizeof(vt));
+      }
+      record.outputs.push_back(std::move(out));
+    }
     return true;
   }
   //---------------------------------------------------------------
@@ -1825,29 +2001,28 @@ namespace cryptonote
     return res;
   }
   //---------------------------------------------------------------
-  bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t* blob_size)
+  // hashes the parts of a serialized tx directly, t must be the tx the blob was serialized from or parsed into
+  static bool calculate_transaction_hash_from_blob(const transaction& t, const blobdata_ref& blob, crypto::hash& res)
   {
     CHECK_AND_ASSERT_MES(!t.pruned, false, "Cannot calculate the hash of a pruned transaction");
 
     // v1 transactions hash the entire blob
     if (t.version == 1)
     {
-      size_t ignored_blob_size, &blob_size_ref = blob_size ? *blob_size : ignored_blob_size;
-      return get_object_hash(t, res, blob_size_ref);
+      cryptonote::get_blob_hash(blob, res);
+      return true;
     }
 
     // v2 transactions hash different parts together, than hash the set of those hashes
     crypto::hash hashes[3];
-
-    // prefix
-    get_transaction_prefix_hash(t, hashes[0]);
-
-    const blobdata blob = tx_to_blob(t);
     const unsigned int unprunable_size = t.unprunable_size;
     const unsigned int prefix_size = t.prefix_size;
+    CHECK_AND_ASSERT_MES(prefix_size <= unprunable_size && unprunable_size <= blob.size(), false, "Inconsistent transaction prefix, unprunable and blob sizes");
+
+    // prefix
+    cryptonote::get_blob_hash(blobdata_ref(blob.data(), prefix_size), hashes[0]);
 
     // base rct
-    CHECK_AND_ASSERT_MES(prefix_size <= unprunable_size && unprunable_size <= blob.size(), false, "Inconsistent transaction prefix, unprunable and blob sizes");
     cryptonote::get_blob_hash(blobdata_ref(blob.data() + prefix_size, unprunable_size - prefix_size), hashes[1]);
 
     // prunable rct
@@ -1855,14 +2030,29 @@ namespace cryptonote
     {
       hashes[2] = crypto::null_hash;
     }
+    else if (t.is_prunable_hash_valid())
+    {
+      hashes[2] = t.prunable_hash;
+    }
     else
     {
-      cryptonote::blobdata_ref blobref(blob);
-      CHECK_AND_ASSERT_MES(calculate_transaction_prunable_hash(t, &blobref, hashes[2]), false, "Failed to get tx prunable hash");
+      CHECK_AND_ASSERT_MES(calculate_transaction_prunable_hash(t, &blob, hashes[2]), false, "Failed to get tx prunable hash");
+      t.set_prunable_hash(hashes[2]);
     }
 
     // the tx hash is the hash of the 3 hashes
     res = cn_fast_hash(hashes, sizeof(hashes));
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t* blob_size)
+  {
+    CHECK_AND_ASSERT_MES(!t.pruned, false, "Cannot calculate the hash of a pruned transaction");
+
+    // serializing also sets the prefix and unprunable sizes the hash needs
+    const blobdata blob = tx_to_blob(t);
+    if (!calculate_transaction_hash_from_blob(t, blob, res))
+      return false;
 
     // we still need the size
     if (blob_size)
@@ -1924,15 +2114,7 @@ namespace cryptonote
   //---------------------------------------------------------------
   bool calculate_block_hash(const block& b, crypto::hash& res, const blobdata_ref *blob)
   {
-    blobdata bd;
-    blobdata_ref bdref;
-    if (!blob)
-    {
-      bd = block_to_blob(b);
-      bdref = bd;
-      blob = &bdref;
-    }
-
+    // the hashing blob only needs the header and the tx tree hash, the block blob isn't used
     return get_object_hash(get_block_hashing_blob(b), res);
   }
   //---------------------------------------------------------------
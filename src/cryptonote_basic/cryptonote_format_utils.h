@@ -31,6 +31,7 @@
 
 #pragma once
 #include "blobdatatype.h"
+#include "block_scan_record.h"
 #include "cryptonote_basic_impl.h"
 #include "tx_extra.h"
 #include "account.h"
@@ -38,7 +39,9 @@
 #include "include_base_utils.h"
 #include "crypto/crypto.h"
 #include "crypto/hash.h"
+#include "oracle/asset_types.h"
 #include "span.h"
+#include <array>
 #include <unordered_map>
 #include <boost/multiprecision/cpp_int.hpp>
 
@@ -55,6 +58,7 @@ namespace cryptonote
   void get_transaction_prefix_hash(const transaction_prefix& tx, crypto::hash& h);
   crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx);
   bool parse_and_validate_tx_prefix_from_blob(const blobdata_ref& tx_blob, transaction_prefix& tx);
+  bool parse_and_validate_tx_prefix_from_blob(const blobdata_ref& tx_blob, transaction_prefix& tx, crypto::hash& tx_prefix_hash);
   bool expand_transaction_1(transaction &tx, bool base_only);
   bool parse_and_validate_tx_from_blob(const blobdata_ref& tx_blob, transaction& tx, crypto::hash& tx_hash, crypto::hash& tx_prefix_hash);
   bool parse_and_validate_tx_from_blob(const blobdata_ref& tx_blob, transaction& tx, crypto::hash& tx_hash);
@@ -75,6 +79,23 @@ namespace cryptonote
   }
 
   bool parse_tx_extra(const std::vector<uint8_t>& tx_extra, std::vector<tx_extra_field>& tx_extra_fields);
+
+  // The fields of a tx_extra that lookups and scanning need, found in one pass over the blob without building
+  // tx_extra_field variants. The pointers and spans point into the blob, so they only live as long as it does.
+  struct tx_extra_view
+  {
+    static constexpr size_t MAX_PUB_KEYS = 4;
+
+    std::array<const crypto::public_key*, MAX_PUB_KEYS> pub_keys{}; // first MAX_PUB_KEYS tx pubkey fields
+    size_t num_pub_keys = 0;                                        // all tx pubkey fields, can be over MAX_PUB_KEYS
+    bool has_additional_pub_keys = false;
+    epee::span<const crypto::public_key> additional_pub_keys;      // first additional pubkeys field
+    bool has_nonce = false;
+    epee::span<const uint8_t> nonce;                                // first nonce field
+    bool complete = false;                                          // the whole blob parsed, as parse_tx_extra() returning true
+  };
+  // same fields, and same leniency with a malformed tail, as parse_tx_extra() + find_tx_extra_field_by_type()
+  bool parse_tx_extra_view(const std::vector<uint8_t>& tx_extra, tx_extra_view& view);
   bool sort_tx_extra(const std::vector<uint8_t>& tx_extra, std::vector<uint8_t> &sorted_tx_extra, bool allow_partial = false);
   crypto::public_key get_tx_pub_key_from_extra(const std::vector<uint8_t>& tx_extra, size_t pk_index = 0);
   crypto::public_key get_tx_pub_key_from_extra(const transaction_prefix& tx, size_t pk_index = 0);
@@ -134,11 +155,14 @@ namespace cryptonote
   bool get_inputs_money_amount(const transaction& tx, uint64_t& money);
   uint64_t get_outs_money_amount(const transaction& tx);
   std::string asset_type_from_id(const uint32_t asset_type_id);
-  uint32_t asset_id_from_type(const std::string asset_type);
+  uint32_t asset_id_from_type(const std::string &asset_type);
   bool get_tx_asset_types(const transaction& tx, const crypto::hash &txid, std::string& source, std::string& destination, const bool is_miner_tx);
   bool get_output_public_key(const cryptonote::tx_out& out, crypto::public_key& output_public_key);
   boost::optional<crypto::view_tag> get_output_view_tag(const cryptonote::tx_out& out);
   bool get_output_asset_type(const cryptonote::tx_out& out, std::string& output_asset_type);
+  // like get_output_asset_type, without copying the string out
+  bool get_output_asset_id(const cryptonote::tx_out& out, oracle::asset_id& output_asset_id);
+  bool get_tx_scan_record(const transaction& tx, const crypto::hash& tx_hash, tx_scan_record& record);
   bool get_output_unlock_time(const cryptonote::tx_out& out, uint64_t& output_unlock_time);
   bool check_inputs_types_supported(const transaction& tx);
   bool check_outs_valid(const transaction& tx);
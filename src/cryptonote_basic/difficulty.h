@@ -31,6 +31,7 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <vector>
 #include <string>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -61,4 +62,83 @@ namespace cryptonote
     difficulty_type next_difficulty_v2(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t target_seconds);
   
     std::string hex(difficulty_type v);
+
+    /**
+     * @brief timestamps and cumulative difficulties of a contiguous run of blocks
+     *
+     * Covers heights [start_height(), end_height()). Blocks can be added or
+     * removed at either end in constant time, so the window can follow the
+     * chain tip through pops and reorgs instead of being reloaded.
+     */
+    class difficulty_window
+    {
+    public:
+      difficulty_window(): m_start_height(0) {}
+
+      void reset(uint64_t start_height) { m_start_height = start_height; m_timestamps.clear(); m_cumulative_difficulties.clear(); m_hashes.clear(); }
+      bool empty() const { return m_timestamps.empty(); }
+      size_t size() const { return m_timestamps.size(); }
+      uint64_t start_height() const { return m_start_height; }
+      uint64_t end_height() const { return m_start_height + m_timestamps.size(); }
+
+      void push_back(uint64_t timestamp, const difficulty_type &cumulative_difficulty, const crypto::hash &hash)
+      {
+        m_timestamps.push_back(timestamp);
+        m_cumulative_difficulties.push_back(cumulative_difficulty);
+        m_hashes.push_back(hash);
+      }
+      void pop_back()
+      {
+        m_timestamps.pop_back();
+        m_cumulative_difficulties.pop_back();
+        m_hashes.pop_back();
+      }
+      void push_front(uint64_t timestamp, const difficulty_type &cumulative_difficulty, const crypto::hash &hash)
+      {
+        m_timestamps.push_front(timestamp);
+        m_cumulative_difficulties.push_front(cumulative_difficulty);
+        m_hashes.push_front(hash);
+        --m_start_height;
+      }
+      void pop_front()
+      {
+        m_timestamps.pop_front();
+        m_cumulative_difficulties.pop_front();
+        m_hashes.pop_front();
+        ++m_start_height;
+      }
+
+      /*! hash of the highest block in the window, the window is only valid
+          for a chain that has this block at `end_height() - 1` */
+      const crypto::hash &top_hash() const { return m_hashes.back(); }
+
+      //! drops any blocks at or above height
+      void truncate(uint64_t height)
+      {
+        while (!empty() && end_height() > height)
+          pop_back();
+        if (empty() && m_start_height > height)
+          m_start_height = height;
+      }
+
+      //! timestamp of a block in the window
+      uint64_t timestamp(uint64_t height) const { return m_timestamps[height - m_start_height]; }
+
+      //! whether heights [begin, end) are all in the window
+      bool covers(uint64_t begin, uint64_t end) const { return begin >= m_start_height && end <= end_height() && begin <= end; }
+
+      //! appends heights [begin, end), which must be covered
+      void copy(uint64_t begin, uint64_t end, std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties) const
+      {
+        const size_t b = begin - m_start_height, e = end - m_start_height;
+        timestamps.insert(timestamps.end(), m_timestamps.begin() + b, m_timestamps.begin() + e);
+        cumulative_difficulties.insert(cumulative_difficulties.end(), m_cumulative_difficulties.begin() + b, m_cumulative_difficulties.begin() + e);
+      }
+
+    private:
+      uint64_t m_start_height;
+      std::deque<uint64_t> m_timestamps;
+      std::deque<difficulty_type> m_cumulative_difficulties;
+      std::deque<crypto::hash> m_hashes;
+    };
 }
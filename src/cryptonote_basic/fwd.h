@@ -32,7 +32,9 @@
 namespace cryptonote
 {
   struct block;
+  struct block_processing_stats;
   class transaction;
   struct txpool_event;
   struct tx_block_template_backlog_entry;
+  struct tx_block_template_backlog_diff;
 }
@@ -54,6 +54,20 @@ static uint8_t get_block_version(const cryptonote::block &b)
   return b.major_version;
 }
 
+// index of the last entry <= height in a sorted table starting at 0; the
+// loop runs log2(size) times whatever the data, with no unpredictable branch
+static size_t find_start(const std::vector<uint64_t> &starts, uint64_t height)
+{
+  const uint64_t *base = starts.data();
+  size_t n = starts.size();
+  while (n > 1) {
+    const size_t half = n / 2;
+    base = base[half] <= height ? base + half : base;
+    n -= half;
+  }
+  return base - starts.data();
+}
+
 HardFork::HardFork(cryptonote::BlockchainDB &db, uint8_t original_version, uint64_t original_version_till_height, time_t forked_time, time_t update_time, uint64_t window_size, uint8_t default_threshold_percent):
   db(db),
   forked_time(forked_time),
@@ -62,7 +76,9 @@ HardFork::HardFork(cryptonote::BlockchainDB &db, uint8_t original_version, uint6
   default_threshold_percent(default_threshold_percent),
   original_version(original_version),
   original_version_till_height(original_version_till_height),
-  current_fork_index(0)
+  current_fork_index(0),
+  current_version(original_version),
+  version_table_height(0)
 {
   if (window_size == 0)
     throw "window_size needs to be strictly positive";
@@ -88,6 +104,7 @@ bool HardFork::add_fork(uint8_t version, uint64_t height, uint8_t threshold, tim
   if (threshold > 100)
     return false;
   heights.push_back(hardfork_t(version, height, threshold, time));
+  build_ideal_table();
   return true;
 }
 
@@ -138,7 +155,19 @@ bool HardFork::add(uint8_t block_version, uint8_t voting_version, uint64_t heigh
   if (!do_check(block_version, voting_version))
     return false;
 
-  db.set_hard_fork_version(height, heights[current_fork_index].version);
+  const uint8_t stored_version = heights[current_fork_index].version;
+  db.set_hard_fork_version(height, stored_version);
+  if (version_table_height < height) {
+    // blocks were added behind our back, start over from the db
+    build_version_table();
+  } else {
+    truncate_version_table(height);
+    if (version_values.empty() || version_values.back() != stored_version) {
+      version_starts.push_back(height);
+      version_values.push_back(stored_version);
+    }
+    version_table_height = height + 1;
+  }
 
   voting_version = get_effective_version(voting_version);
 
@@ -155,6 +184,7 @@ bool HardFork::add(uint8_t block_version, uint8_t voting_version, uint64_t heigh
   uint8_t voted = get_voted_fork_index(height + 1);
   if (voted > current_fork_index) {
     current_fork_index = voted;
+    update_current_version();
   }
 
   return true;
@@ -186,6 +216,9 @@ void HardFork::init()
     height = 1;
 
   rescan_from_chain_height(height);
+  update_current_version();
+  build_ideal_table();
+  build_version_table();
   MDEBUG("init done");
 }
 
@@ -226,6 +259,8 @@ bool HardFork::reorganize_from_block_height(uint64_t height)
   if (voted > current_fork_index) {
     current_fork_index = voted;
   }
+  update_current_version();
+  truncate_version_table(height + 1);
 
   const uint64_t bc_height = db.height();
   for (uint64_t h = height + 1; h < bc_height; ++h) {
@@ -272,6 +307,7 @@ bool HardFork::rescan_from_block_height(uint64_t height)
   if (voted > current_fork_index) {
     current_fork_index = voted;
   }
+  update_current_version();
 
   return true;
 }
@@ -306,6 +342,98 @@ void HardFork::on_block_popped(uint64_t nblocks)
   for (current_fork_index = heights.size() - 1; current_fork_index > 0; --current_fork_index)
     if (new_chain_height >= heights[current_fork_index].height)
       break;
+  update_current_version();
+  truncate_version_table(new_chain_height);
+}
+
+void HardFork::on_blocks_added(uint64_t nblocks)
+{
+  CHECK_AND_ASSERT_THROW_MES(nblocks > 0, "nblocks must be greater than 0");
+
+  CRITICAL_REGION_LOCAL(lock);
+  db_rtxn_guard rtxn_guard(&db);
+
+  const uint64_t new_chain_height = db.height();
+  CHECK_AND_ASSERT_THROW_MES(nblocks <= new_chain_height, "nblocks must not exceed the chain height");
+  for (uint64_t height = new_chain_height - nblocks; height < new_chain_height; ++height)
+  {
+    const cryptonote::block b = db.get_block_from_height(height);
+    const uint8_t v = get_effective_version(get_block_vote(b));
+    while (versions.size() >= window_size) {
+      const uint8_t old_version = versions.front();
+      assert(last_versions[old_version] >= 1);
+      last_versions[old_version]--;
+      versions.pop_front();
+    }
+    last_versions[v]++;
+    versions.push_back(v);
+  }
+
+  const uint8_t lastv = db.get_hard_fork_version(new_chain_height - 1);
+  while (current_fork_index + 1 < heights.size() && heights[current_fork_index].version != lastv)
+    ++current_fork_index;
+  const int voted = get_voted_fork_index(new_chain_height);
+  if (voted > (int)current_fork_index)
+    current_fork_index = voted;
+  update_current_version();
+  if (version_table_height < new_chain_height)
+    build_version_table();
+}
+
+void HardFork::build_ideal_table()
+{
+  CRITICAL_REGION_LOCAL(lock);
+  // heights[0] is never returned by height, original_version is
+  ideal_starts.assign(1, 0);
+  ideal_versions.assign(1, original_version);
+  for (size_t n = 1; n < heights.size(); ++n) {
+    ideal_starts.push_back(heights[n].height);
+    ideal_versions.push_back(heights[n].version);
+  }
+}
+
+void HardFork::build_version_table()
+{
+  CRITICAL_REGION_LOCAL(lock);
+  db_rtxn_guard rtxn_guard(&db);
+  version_starts.clear();
+  version_values.clear();
+  version_table_height = 0;
+
+  // stored versions never decrease along the chain, so each change is found
+  // by bisection, costing a few db reads per fork rather than one per call
+  const uint64_t chain_height = db.height();
+  uint64_t start = 0;
+  while (start < chain_height) {
+    const uint8_t version = db.get_hard_fork_version(start);
+    version_starts.push_back(start);
+    version_values.push_back(version);
+    uint64_t lo = start + 1, hi = chain_height;
+    while (lo < hi) {
+      const uint64_t mid = lo + (hi - lo) / 2;
+      if (db.get_hard_fork_version(mid) == version)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    start = lo;
+  }
+  version_table_height = chain_height;
+}
+
+void HardFork::truncate_version_table(uint64_t height)
+{
+  CRITICAL_REGION_LOCAL(lock);
+  while (!version_starts.empty() && version_starts.back() >= height) {
+    version_starts.pop_back();
+    version_values.pop_back();
+  }
+  version_table_height = std::min(version_table_height, height);
+}
+
+void HardFork::update_current_version()
+{
+  current_version.store(heights[current_fork_index].version, std::memory_order_release);
 }
 
 int HardFork::get_voted_fork_index(uint64_t height) const
@@ -347,6 +475,8 @@ HardFork::State HardFork::get_state() const
 uint8_t HardFork::get(uint64_t height) const
 {
   CRITICAL_REGION_LOCAL(lock);
+  if (height < version_table_height)
+    return version_values[find_start(version_starts, height)];
   if (height > db.height()) {
     assert(false);
     return 255;
@@ -359,8 +489,7 @@ uint8_t HardFork::get(uint64_t height) const
 
 uint8_t HardFork::get_current_version() const
 {
-  CRITICAL_REGION_LOCAL(lock);
-  return heights[current_fork_index].version;
+  return current_version.load(std::memory_order_acquire);
 }
 
 uint8_t HardFork::get_ideal_version() const
@@ -371,13 +500,9 @@ uint8_t HardFork::get_ideal_version() const
 
 uint8_t HardFork::get_ideal_version(uint64_t height) const
 {
-  CRITICAL_REGION_LOCAL(lock);
-  for (unsigned int n = heights.size() - 1; n > 0; --n) {
-    if (height >= heights[n].height) {
-      return heights[n].version;
-    }
-  }
-  return original_version;
+  if (ideal_starts.empty())
+    return original_version;
+  return ideal_versions[find_start(ideal_starts, height)];
 }
 
 uint64_t HardFork::get_earliest_ideal_height_for_version(uint8_t version) const
@@ -28,6 +28,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "syncobj.h"
 #include "hardforks/hardforks.h"
 #include "cryptonote_basic/cryptonote_basic.h"
@@ -160,6 +163,16 @@ namespace cryptonote
      */
     void on_block_popped(uint64_t new_chain_height);
 
+    /**
+     * @brief called when blocks were appended to the db by another process
+     *
+     * Like add(), but the fork versions are read from the db rather than
+     * written to it, so this works on a read-only db
+     *
+     * @param nblocks the number of blocks appended since the last update
+     */
+    void on_blocks_added(uint64_t nblocks);
+
     /**
      * @brief returns current state at the given time
      *
@@ -188,6 +201,8 @@ namespace cryptonote
     /**
      * @brief returns the "ideal" version for a given height
      *
+     * Lock free once init() has run: the fork heights are fixed by then.
+     *
      * @param height height of the block to check
      */
     uint8_t get_ideal_version(uint64_t height) const;
@@ -248,6 +263,11 @@ namespace cryptonote
     bool rescan_from_block_height(uint64_t height);
     bool rescan_from_chain_height(uint64_t height);
 
+    void build_ideal_table();
+    void build_version_table();
+    void truncate_version_table(uint64_t height);
+    void update_current_version();
+
   private:
 
     BlockchainDB &db;
@@ -265,6 +285,16 @@ namespace cryptonote
     std::deque<uint8_t> versions; /* rolling window of the last N blocks' versions */
     unsigned int last_versions[256]; /* count of the block versions in the last N blocks */
     uint32_t current_fork_index;
+    std::atomic<uint8_t> current_version; /* heights[current_fork_index].version, readable without the lock */
+
+    /* first height of each scheduled version, from 0; searched instead of walking `heights` */
+    std::vector<uint64_t> ideal_starts;
+    std::vector<uint8_t> ideal_versions;
+
+    /* first chain height of each version stored in the db, from 0, valid below version_table_height */
+    std::vector<uint64_t> version_starts;
+    std::vector<uint8_t> version_values;
+    uint64_t version_table_height;
 
     mutable epee::critical_section lock;
   };
@@ -28,6 +28,7 @@
 //
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <algorithm>
 #include <sstream>
 #include <numeric>
 #include <boost/algorithm/string.hpp>
@@ -55,6 +56,7 @@
   #include <AvailabilityMacros.h>
   #include <TargetConditionals.h>
 #elif defined(__linux__)
+  #include <pthread.h>
   #include <unistd.h>
   #include <sys/resource.h>
   #include <sys/times.h>
@@ -101,19 +103,36 @@ namespace cryptonote
     const command_line::arg_descriptor<uint64_t>    arg_bg_mining_min_idle_interval_seconds =  {"bg-mining-min-idle-interval", "Specify min lookback interval in seconds for determining idle state", miner::BACKGROUND_MINING_DEFAULT_MIN_IDLE_INTERVAL_IN_SECONDS, true};
     const command_line::arg_descriptor<uint16_t>     arg_bg_mining_idle_threshold_percentage =  {"bg-mining-idle-threshold", "Specify minimum avg idle percentage over lookback interval", miner::BACKGROUND_MINING_DEFAULT_IDLE_THRESHOLD_PERCENTAGE, true};
     const command_line::arg_descriptor<uint16_t>     arg_bg_mining_miner_target_percentage =  {"bg-mining-miner-target", "Specify maximum percentage cpu use by miner(s)", miner::BACKGROUND_MINING_DEFAULT_MINING_TARGET_PERCENTAGE, true};
+    const command_line::arg_descriptor<bool>        arg_mining_pin_threads =  {"mining-pin-threads", "Pin each mining thread to its own CPU", false, true};
+
+    void pin_current_thread(uint32_t index)
+    {
+      const unsigned int n_cpus = std::max(1u, boost::thread::hardware_concurrency());
+      const unsigned int cpu = index % n_cpus;
+#if defined(__linux__)
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpu, &cpuset);
+      const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+      if (err)
+        MWARNING("Failed to pin miner thread " << index << " to CPU " << cpu << ": " << err);
+#elif defined(_WIN32)
+      if (cpu >= sizeof(DWORD_PTR) * 8 || !SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+        MWARNING("Failed to pin miner thread " << index << " to CPU " << cpu);
+#else
+      MWARNING("Pinning miner threads is not supported on this platform");
+#endif
+    }
   }
 
 
   miner::miner(i_miner_handler* phandler, const get_block_hash_t &gbh):
     m_forced_stop(1),
     m_stop(1),
-    m_template{},
     m_template_no(0),
-    m_diffic(0),
     m_thread_index(0),
     m_phandler(phandler),
     m_gbh(gbh),
-    m_height(0),
     m_threads_active(0),
     m_pausers_count(0),
     m_threads_total(0),
@@ -123,6 +142,7 @@ namespace cryptonote
     m_total_hashes(0),
     m_do_print_hashrate(false),
     m_do_mining(false),
+    m_pin_threads(false),
     m_current_hash_rate(0),
     m_is_background_mining_enabled(false),
     m_min_idle_seconds(BACKGROUND_MINING_DEFAULT_MIN_IDLE_INTERVAL_IN_SECONDS),
@@ -143,12 +163,15 @@ namespace cryptonote
   bool miner::set_block_template(const block& bl, const difficulty_type& di, uint64_t height, uint64_t block_reward)
   {
     CRITICAL_REGION_LOCAL(m_template_lock);
-    m_template = bl;
-    m_diffic = di;
-    m_height = height;
+    std::shared_ptr<template_snapshot> snapshot = std::make_shared<template_snapshot>();
+    snapshot->b = bl;
+    snapshot->diffic = di;
+    snapshot->height = height;
+    snapshot->template_no = m_template_no + 1;
     m_block_reward = block_reward;
-    ++m_template_no;
     m_starter_nonce = crypto::rand<uint32_t>();
+    std::atomic_store(&m_template_snapshot, std::shared_ptr<const template_snapshot>(std::move(snapshot)));
+    ++m_template_no;
     return true;
   }
   //-----------------------------------------------------------------------------------------------------
@@ -243,6 +266,25 @@ namespace cryptonote
     m_hashes = 0;
   }
   //-----------------------------------------------------------------------------------------------------
+  void miner::get_speed_percentiles(uint64_t &p10, uint64_t &p50, uint64_t &p90) const
+  {
+    std::vector<uint64_t> rates;
+    {
+      CRITICAL_REGION_LOCAL(m_last_hash_rates_lock);
+      rates.assign(m_last_hash_rates.begin(), m_last_hash_rates.end());
+    }
+    if (rates.empty())
+    {
+      p10 = p50 = p90 = 0;
+      return;
+    }
+    std::sort(rates.begin(), rates.end());
+    const auto percentile = [&rates](unsigned int p) { return rates[(rates.size() - 1) * p / 100]; };
+    p10 = percentile(10);
+    p50 = percentile(50);
+    p90 = percentile(90);
+  }
+  //-----------------------------------------------------------------------------------------------------
   void miner::update_autodetection()
   {
     if (m_threads_autodetect.empty())
@@ -307,6 +349,7 @@ namespace cryptonote
     command_line::add_arg(desc, arg_bg_mining_min_idle_interval_seconds);
     command_line::add_arg(desc, arg_bg_mining_idle_threshold_percentage);
     command_line::add_arg(desc, arg_bg_mining_miner_target_percentage);
+    command_line::add_arg(desc, arg_mining_pin_threads);
   }
   //-----------------------------------------------------------------------------------------------------
   bool miner::init(const boost::program_options::variables_map& vm, network_type nettype)
@@ -364,6 +407,7 @@ namespace cryptonote
       set_idle_threshold( command_line::get_arg(vm, arg_bg_mining_idle_threshold_percentage) );
     if(command_line::has_arg(vm, arg_bg_mining_miner_target_percentage))
       set_mining_target( command_line::get_arg(vm, arg_bg_mining_miner_target_percentage) );
+    m_pin_threads = command_line::get_arg(vm, arg_mining_pin_threads);
 
     return true;
   }
@@ -576,13 +620,15 @@ namespace cryptonote
 
       if(local_template_ver != m_template_no)
       {
-        CRITICAL_REGION_BEGIN(m_template_lock);
-        b = m_template;
-        local_diff = m_diffic;
-        height = m_height;
-        CRITICAL_REGION_END();
-        local_template_ver = m_template_no;
-        nonce = m_starter_nonce + th_local_index;
+        const std::shared_ptr<const template_snapshot> snapshot = std::atomic_load(&m_template_snapshot);
+        if (snapshot)
+        {
+          b = snapshot->b;
+          local_diff = snapshot->diffic;
+          height = snapshot->height;
+          local_template_ver = snapshot->template_no;
+          nonce = m_starter_nonce + th_local_index;
+        }
       }
 
       if(!local_template_ver)//no any set_block_template call
@@ -597,6 +643,8 @@ namespace cryptonote
 
       if (!rx_set)
       {
+        if (m_pin_threads)
+          pin_current_thread(th_local_index);
         crypto::rx_set_miner_thread(th_local_index, tools::get_max_concurrency());
         rx_set = true;
       }
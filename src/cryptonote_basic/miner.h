@@ -33,6 +33,7 @@
 #include <boost/program_options.hpp>
 #include <boost/logic/tribool_fwd.hpp>
 #include <atomic>
+#include <memory>
 #include "cryptonote_basic.h"
 #include "verification_context.h"
 #include "difficulty.h"
@@ -68,6 +69,7 @@ namespace cryptonote
     bool on_block_chain_update();
     bool start(const account_public_address& adr, size_t threads_count, bool do_background = false, bool ignore_battery = false);
     uint64_t get_speed() const;
+    void get_speed_percentiles(uint64_t &p10, uint64_t &p50, uint64_t &p90) const;
     uint32_t get_threads_count() const;
     void send_stop_signal();
     bool stop();
@@ -118,14 +120,22 @@ namespace cryptonote
     };
 
 
+    // what the worker threads hash, replaced as a whole on each new template so that the workers
+    // never have to take a lock: they load the current one whenever m_template_no moves on
+    struct template_snapshot
+    {
+      block b;
+      difficulty_type diffic;
+      uint64_t height;
+      uint32_t template_no;
+    };
+
     std::atomic<bool> m_forced_stop;
     std::atomic<bool> m_stop;
-    epee::critical_section m_template_lock;
-    block m_template;
+    epee::critical_section m_template_lock; // serializes the writers of m_template_snapshot
+    std::shared_ptr<const template_snapshot> m_template_snapshot; // only accessed through std::atomic_load/store
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
-    difficulty_type m_diffic;
-    uint64_t m_height;
     std::atomic<uint32_t> m_thread_index;
     volatile uint32_t m_threads_total;
     std::atomic<uint32_t> m_threads_active;
@@ -147,10 +157,11 @@ namespace cryptonote
     std::atomic<uint64_t> m_hashes;
     std::atomic<uint64_t> m_total_hashes;
     std::atomic<uint64_t> m_current_hash_rate;
-    epee::critical_section m_last_hash_rates_lock;
+    mutable epee::critical_section m_last_hash_rates_lock;
     std::list<uint64_t> m_last_hash_rates;
     bool m_do_print_hashrate;
     bool m_do_mining;
+    bool m_pin_threads;
     std::vector<std::pair<uint64_t, uint64_t>> m_threads_autodetect;
     boost::thread::attributes m_attrs;
 
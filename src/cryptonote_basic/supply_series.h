@@ -0,0 +1,208 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cryptonote_config.h"
+#include "serialization/containers.h"
+#include "serialization/serialization.h"
+#include "serialization/string.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief the resolutions the supply series is kept at
+   *
+   * Buckets are spans of heights rather than of wall clock time, so a bucket
+   * only ever grows or shrinks at its top when blocks are added or popped.
+   * An hour (day) bucket covers an hour (day) worth of blocks at the target
+   * block time; first_timestamp and last_timestamp give the actual times.
+   */
+  enum supply_series_granularity: uint8_t
+  {
+    SUPPLY_SERIES_BLOCK = 0,
+    SUPPLY_SERIES_HOUR = 1,
+    SUPPLY_SERIES_DAY = 2,
+    SUPPLY_SERIES_GRANULARITIES
+  };
+
+  inline uint64_t get_supply_series_bucket_blocks(const supply_series_granularity granularity)
+  {
+    switch (granularity)
+    {
+      case SUPPLY_SERIES_HOUR: return 3600 / DIFFICULTY_TARGET_V2;
+      case SUPPLY_SERIES_DAY: return 86400 / DIFFICULTY_TARGET_V2;
+      default: return 1;
+    }
+  }
+
+  /**
+   * @brief per asset levels, as of the last block of a bucket
+   */
+  struct supply_series_asset
+  {
+    std::string asset_type;
+    uint64_t circulating_supply;
+    uint64_t spot_price;
+    uint64_t ma_price;
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(asset_type)
+      VARINT_FIELD(circulating_supply)
+      VARINT_FIELD(spot_price)
+      VARINT_FIELD(ma_price)
+    END_SERIALIZE()
+  };
+
+  /**
+   * @brief supply and yield statistics over a span of blocks
+   *
+   * The *_total fields are summed over the span, the others are levels as
+   * of last_height. Slippage is counted as yield while coins are staked and
+   * as burnt otherwise, as get_yield_info does.
+   */
+  struct supply_series_entry
+  {
+    uint64_t first_height;
+    uint64_t last_height;
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+    uint64_t slippage_total;
+    uint64_t yield_total;
+    uint64_t burnt_total;
+    uint64_t staked_total;
+    uint64_t audit_total;
+    uint64_t locked_coins_tally;
+    uint8_t network_health_percentage;
+    std::vector<supply_series_asset> assets;
+
+    BEGIN_SERIALIZE_OBJECT()
+      VARINT_FIELD(first_height)
+      VARINT_FIELD(last_height)
+      VARINT_FIELD(first_timestamp)
+      VARINT_FIELD(last_timestamp)
+      VARINT_FIELD(slippage_total)
+      VARINT_FIELD(yield_total)
+      VARINT_FIELD(burnt_total)
+      VARINT_FIELD(staked_total)
+      VARINT_FIELD(audit_total)
+      VARINT_FIELD(locked_coins_tally)
+      FIELD(network_health_percentage)
+      FIELD(assets)
+    END_SERIALIZE()
+
+    //! extend the span with the block after last_height
+    void add_block(const supply_series_entry &block)
+    {
+      last_height = block.last_height;
+      last_timestamp = block.last_timestamp;
+      slippage_total += block.slippage_total;
+      yield_total += block.yield_total;
+      burnt_total += block.burnt_total;
+      staked_total += block.staked_total;
+      audit_total += block.audit_total;
+      set_levels(block);
+    }
+
+    //! shrink the span by its last block, prev being the block before it
+    void remove_block(const supply_series_entry &block, const supply_series_entry &prev)
+    {
+      last_height = prev.last_height;
+      last_timestamp = prev.last_timestamp;
+      slippage_total -= block.slippage_total;
+      yield_total -= block.yield_total;
+      burnt_total -= block.burnt_total;
+      staked_total -= block.staked_total;
+      audit_total -= block.audit_total;
+      set_levels(prev);
+    }
+
+  private:
+    void set_levels(const supply_series_entry &block)
+    {
+      locked_coins_tally = block.locked_coins_tally;
+      network_health_percentage = block.network_health_percentage;
+      assets = block.assets;
+    }
+  };
+
+  /**
+   * @brief running emission and fee sums of one asset type
+   *
+   * coinbase is the miner tx outputs plus its amount_burnt (the stake
+   * share), protocol the protocol tx payouts, burnt the amount_burnt of
+   * user txs; fees and burnt are counted in the tx's source asset type.
+   */
+  struct emission_totals_asset
+  {
+    std::string asset_type;
+    uint64_t coinbase;
+    uint64_t fees;
+    uint64_t burnt;
+    uint64_t protocol;
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(asset_type)
+      VARINT_FIELD(coinbase)
+      VARINT_FIELD(fees)
+      VARINT_FIELD(burnt)
+      VARINT_FIELD(protocol)
+    END_SERIALIZE()
+  };
+
+  /**
+   * @brief emission and fee sums from first_height through a block
+   *
+   * first_height is 0 except on chains synced before the sums were stored,
+   * where it is the first block added since. Any range of blocks with a
+   * start of first_height or above is then the difference of two entries.
+   */
+  struct block_emission_totals
+  {
+    uint64_t first_height;
+    std::vector<emission_totals_asset> assets;
+
+    BEGIN_SERIALIZE_OBJECT()
+      VARINT_FIELD(first_height)
+      FIELD(assets)
+    END_SERIALIZE()
+
+    emission_totals_asset &get(const std::string &asset_type)
+    {
+      for (auto &asset: assets)
+        if (asset.asset_type == asset_type)
+          return asset;
+      assets.push_back({asset_type, 0, 0, 0, 0});
+      return assets.back();
+    }
+  };
+}
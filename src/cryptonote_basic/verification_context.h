@@ -30,6 +30,9 @@
 
 #pragma once
 
+#include <cstdint>
+
+#include "crypto/hash.h"
 #include "cryptonote_protocol/enums.h"
 
 namespace cryptonote
@@ -62,6 +65,25 @@ namespace cryptonote
     bool m_version_mismatch; // TX version wrong for the currently-active HF version
   };
 
+  //! Where the time went while adding a block to the main chain, all in microseconds
+  struct block_processing_stats
+  {
+    uint64_t height;
+    crypto::hash id;
+    uint64_t timestamp;
+    uint64_t n_txs;
+    uint64_t difficulty_us;
+    uint64_t pow_us;
+    uint64_t tx_inputs_us;   // excluding the wait for the deferred ring signature checks
+    uint64_t rct_batch_us;   // waiting on the ring signature checks batched to the threadpool
+    uint64_t miner_tx_us;
+    uint64_t protocol_tx_us; // including payouts_us
+    uint64_t payouts_us;     // computing the yield and audit payouts maturing in the block
+    uint64_t db_add_us;
+    uint64_t ybi_us;         // updating the yield block info cache
+    uint64_t total_us;
+  };
+
   struct block_verification_context
   {
     bool m_added_to_main_chain;
@@ -70,5 +92,6 @@ namespace cryptonote
     bool m_already_exists;
     bool m_partial_block_reward;
     bool m_bad_pow; // if bad pow, bad peer outright for DoS protection
+    block_processing_stats m_stats; // only set once m_added_to_main_chain is
   };
 }
@@ -0,0 +1,87 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "alt_block_index.h"
+
+#include <unordered_set>
+
+namespace cryptonote
+{
+//------------------------------------------------------------------
+std::vector<std::vector<crypto::hash>> get_alt_chains(const alt_block_index_t &index)
+{
+  std::unordered_set<crypto::hash> parents;
+  parents.reserve(index.size());
+  for (const auto &i: index)
+    parents.insert(i.second.prev_id);
+
+  std::vector<std::vector<crypto::hash>> chains;
+  for (const auto &i: index)
+  {
+    if (parents.find(i.first) != parents.end())
+      continue;
+
+    std::vector<crypto::hash> chain;
+    chain.push_back(i.first);
+    alt_block_index_t::const_iterator prev;
+    for (crypto::hash h = i.second.prev_id; (prev = index.find(h)) != index.end(); h = prev->second.prev_id)
+      chain.push_back(h);
+    chains.push_back(std::move(chain));
+  }
+  return chains;
+}
+//------------------------------------------------------------------
+std::vector<crypto::hash> get_stale_alt_blocks(const alt_block_index_t &index, uint64_t cutoff)
+{
+  std::unordered_map<crypto::hash, size_t> children;
+  for (const auto &e: index)
+    ++children[e.second.prev_id];
+
+  std::vector<crypto::hash> stale;
+  for (const auto &e: index)
+  {
+    if (e.second.height >= cutoff || children.find(e.first) != children.end())
+      continue;
+
+    // walk down from the tip, stopping where another chain still branches off
+    crypto::hash h = e.first;
+    alt_block_index_t::const_iterator it;
+    while ((it = index.find(h)) != index.end())
+    {
+      stale.push_back(h);
+      const auto c = children.find(it->second.prev_id);
+      if (c == children.end() || --c->second > 0)
+        break;
+      h = it->second.prev_id;
+    }
+  }
+  return stale;
+}
+//------------------------------------------------------------------
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+
+//! parent and height of an alt block, enough to walk alt chains without parsing their blobs
+struct alt_block_index_entry
+{
+  crypto::hash prev_id;
+  uint64_t height;
+};
+
+//! alt block hash to its index entry
+typedef std::unordered_map<crypto::hash, alt_block_index_entry> alt_block_index_t;
+
+/**
+ * @brief lists every alt chain in an alt block index
+ *
+ * A chain is listed for each tip, that is each block no other alt block builds on. Chains that
+ * branch from each other share their common blocks.
+ *
+ * @param index the alt block index
+ *
+ * @return one list per tip, going from the tip down to the alt block just above the main chain
+ */
+std::vector<std::vector<crypto::hash>> get_alt_chains(const alt_block_index_t &index);
+
+/**
+ * @brief finds the alt blocks of chains that were abandoned
+ *
+ * A chain is abandoned if its tip is below `cutoff`. Its blocks are returned from the tip down,
+ * stopping at the first block that another chain still builds on, so blocks shared with a chain
+ * that is still being extended are kept.
+ *
+ * @param index the alt block index
+ * @param cutoff the lowest height a tip may have and still be kept
+ *
+ * @return the hashes of the alt blocks to remove, each chain from its tip down
+ */
+std::vector<crypto::hash> get_stale_alt_blocks(const alt_block_index_t &index, uint64_t cutoff);
+
+}
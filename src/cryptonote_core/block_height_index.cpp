@@ -0,0 +1,125 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "block_height_index.h"
+
+#include <cstring>
+
+namespace cryptonote
+{
+//------------------------------------------------------------------
+void block_height_index::clear()
+{
+  m_prefixes.clear();
+  m_slots.clear();
+}
+//------------------------------------------------------------------
+uint64_t block_height_index::prefix(const crypto::hash &hash) noexcept
+{
+  uint64_t p;
+  memcpy(&p, hash.data, sizeof(p));
+  return p;
+}
+//------------------------------------------------------------------
+void block_height_index::insert(uint32_t height)
+{
+  const size_t mask = m_slots.size() - 1;
+  size_t slot = m_prefixes[height] & mask;
+  while (m_slots[slot])
+    slot = (slot + 1) & mask;
+  m_slots[slot] = height + 1;
+}
+//------------------------------------------------------------------
+void block_height_index::rehash(size_t capacity)
+{
+  m_slots.assign(capacity, 0);
+  for (size_t height = 0; height < m_prefixes.size(); ++height)
+    insert(height);
+}
+//------------------------------------------------------------------
+void block_height_index::push_back(const crypto::hash &hash)
+{
+  m_prefixes.push_back(prefix(hash));
+
+  // keep the table at most half full, so probe runs stay short
+  if (m_prefixes.size() * 2 > m_slots.size())
+    rehash(m_slots.empty() ? 1024 : m_slots.size() * 2);
+  else
+    insert(m_prefixes.size() - 1);
+}
+//------------------------------------------------------------------
+void block_height_index::pop_back()
+{
+  if (m_prefixes.empty())
+    return;
+
+  const uint32_t height = m_prefixes.size() - 1;
+  const size_t mask = m_slots.size() - 1;
+  size_t slot = m_prefixes[height] & mask;
+  while (m_slots[slot] != height + 1)
+    slot = (slot + 1) & mask;
+
+  // backward shift deletion: move later entries of the probe run into the hole when their home
+  // slot does not lie between the hole and their current slot, so no tombstones are needed
+  size_t next = slot;
+  while (true)
+  {
+    next = (next + 1) & mask;
+    if (!m_slots[next])
+      break;
+    const size_t home = m_prefixes[m_slots[next] - 1] & mask;
+    if (((next - home) & mask) >= ((next - slot) & mask))
+    {
+      m_slots[slot] = m_slots[next];
+      slot = next;
+    }
+  }
+  m_slots[slot] = 0;
+  m_prefixes.pop_back();
+}
+//------------------------------------------------------------------
+bool block_height_index::find(const crypto::hash &hash, uint64_t &height) const
+{
+  if (m_slots.empty())
+    return false;
+
+  const uint64_t p = prefix(hash);
+  const size_t mask = m_slots.size() - 1;
+  for (size_t slot = p & mask; m_slots[slot]; slot = (slot + 1) & mask)
+  {
+    if (m_prefixes[m_slots[slot] - 1] == p)
+    {
+      height = m_slots[slot] - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+}
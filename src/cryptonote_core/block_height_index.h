@@ -0,0 +1,91 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief in memory index from main chain block hash to height
+ *
+ * Holds the leading 8 bytes of the hash of every block from height 0 up to end_height() - 1, and
+ * an open addressing table (linear probing) from those to the height. Peers and wallets send a
+ * short chain history with every sync request, and this resolves it without a db lookup per hash.
+ *
+ * Hashes are truncated, so a height found here must be checked against the full block id before
+ * it is trusted.
+ *
+ * Not thread-safe: callers are expected to hold the blockchain lock.
+ */
+class block_height_index
+{
+public:
+  //! empty the index
+  void clear();
+
+  //! one past the highest indexed height
+  uint64_t end_height() const noexcept { return m_prefixes.size(); }
+
+  bool empty() const noexcept { return m_prefixes.empty(); }
+
+  //! append the hash of the block at end_height()
+  void push_back(const crypto::hash &hash);
+
+  //! remove the highest indexed height, if any
+  void pop_back();
+
+  /**
+   * @brief look up the height of a block hash
+   *
+   * @param hash the block hash
+   * @param height return-by-reference the height of an indexed block with the same leading bytes
+   *
+   * @return false if no indexed block shares the leading bytes of the hash
+   */
+  bool find(const crypto::hash &hash, uint64_t &height) const;
+
+  //! bytes allocated for the index
+  size_t memory_usage() const noexcept { return m_prefixes.capacity() * sizeof(uint64_t) + m_slots.capacity() * sizeof(uint32_t); }
+
+private:
+  static uint64_t prefix(const crypto::hash &hash) noexcept;
+  void rehash(size_t capacity);
+  void insert(uint32_t height);
+
+  std::vector<uint64_t> m_prefixes; // by height
+  std::vector<uint32_t> m_slots; // height + 1, 0 for an empty slot
+};
+
+}
@@ -57,15 +57,14 @@
 #include "cryptonote_core.h"
 #include "ringct/rctSigs.h"
 #include "common/perf_timer.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "common/notify.h"
 #include "common/varint.h"
 #include "common/pruning.h"
 #include "common/data_cache.h"
 #include "time_helper.h"
 
-#include "net/http_client.h"
-#include "storages/http_abstract_invoke.h"
-
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "blockchain"
 
@@ -93,9 +92,11 @@ DISABLE_VS_WARNINGS(4267)
 // used to overestimate the block reward when estimating a per kB to use
 #define BLOCK_REWARD_OVERESTIMATE (10 * 1000000000000)
 
+#define KEY_IMAGES_PER_LOOKUP_THREAD 4096
+
 //------------------------------------------------------------------
 Blockchain::Blockchain(tx_memory_pool& tx_pool) :
-  m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_reset_timestamps_and_difficulties_height(true), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
+  m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
   m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_sync_on_blocks(true), m_db_sync_threshold(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_bytes_to_sync(0), m_cancel(false),
   m_long_term_block_weights_window(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_long_term_effective_median_block_weight(0),
@@ -104,9 +105,20 @@ Blockchain::Blockchain(tx_memory_pool& tx_pool) :
   m_difficulty_for_next_block_top_hash(crypto::null_hash),
   m_difficulty_for_next_block(1),
   m_btc_valid(false),
+  m_btc_base_valid(false),
   m_batch_success(true),
+  m_miner_notify_backlog_version(0),
+  m_block_stats(BLOCK_PROCESSING_STATS_COUNT),
   m_prepare_height(0),
-  m_rct_ver_cache()
+  m_rct_ver_cache(),
+  m_pricing_record_prefetch(false),
+  m_next_payouts_height(0),
+  m_next_payouts_top_hash(crypto::null_hash),
+  m_next_payouts_pending(false),
+  m_txpool_validated(true),
+  m_db_refresh_tip_hash(crypto::null_hash),
+  m_db_refresh_height(0),
+  m_alt_block_index_valid(false)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
 }
@@ -137,6 +149,43 @@ bool Blockchain::have_tx_keyimg_as_spent(const crypto::key_image &key_im) const
   return  m_db->has_key_image(key_im);
 }
 //------------------------------------------------------------------
+void Blockchain::have_key_images_as_spent(const epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  // same locking caveat as have_tx_keyimg_as_spent
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  const size_t parts = std::min<size_t>(tpool.get_max_concurrency(), key_images.size() / KEY_IMAGES_PER_LOOKUP_THREAD);
+  if (parts <= 1)
+  {
+    m_db->has_key_images(key_images, spent);
+    return;
+  }
+
+  const size_t part_size = (key_images.size() + parts - 1) / parts;
+  std::vector<std::vector<bool>> part_spent(parts);
+  std::atomic<bool> failed(false);
+  tpool.parallel_for(0, parts, [&](size_t i) {
+    try
+    {
+      const size_t begin = i * part_size;
+      const size_t end = std::min(key_images.size(), begin + part_size);
+      m_db->has_key_images({key_images.data() + begin, end - begin}, part_spent[i]);
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to look up key images: " << e.what());
+      failed = true;
+    }
+  });
+  if (failed)
+    throw DB_ERROR("Failed to look up key images");
+
+  spent.clear();
+  spent.reserve(key_images.size());
+  for (const std::vector<bool> &part: part_spent)
+    spent.insert(spent.end(), part.begin(), part.end());
+}
+//------------------------------------------------------------------
 // This function makes sure that each "input" in an input (mixins) exists
 // and collects the public key for each from the transaction it was included in
 // via the visitor passed to it.
@@ -313,6 +362,7 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
 
   m_nettype = test_options != NULL ? FAKECHAIN : nettype;
   m_offline = offline;
+  m_pricing_record_cache.init(m_nettype);
   m_fixed_difficulty = fixed_difficulty;
   if (m_hardfork == nullptr)
   {
@@ -346,6 +396,7 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
   m_hardfork->init();
 
   m_db->set_hard_fork(m_hardfork);
+  build_audit_maturity_index();
 
   // if the blockchain is new, add the genesis block
   // this feels kinda kludgy to do it this way, but can be looked at later.
@@ -353,6 +404,11 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
   //       taking testnet into account
   if(!m_db->height())
   {
+    if (m_db->is_read_only())
+    {
+      LOG_ERROR("Blockchain not loaded, and the database is read-only");
+      return false;
+    }
     MINFO("Blockchain not loaded, generating genesis block.");
     block bl;
     block_verification_context bvc = {};
@@ -434,8 +490,7 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
   }
   if (num_popped_blocks > 0)
   {
-    m_timestamps_and_difficulties_height = 0;
-    m_reset_timestamps_and_difficulties_height = true;
+    m_difficulty_window.reset(0);
     m_hardfork->reorganize_from_chain_height(get_current_blockchain_height());
     uint64_t top_block_height;
     crypto::hash top_block_hash = get_tail_id(top_block_height);
@@ -454,7 +509,8 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
   if (!difficulty_ok)
   {
     MERROR("Difficulty drift detected!");
-    recalculate_difficulties(difficulty_recalc_height);
+    if (!m_db->is_read_only())
+      recalculate_difficulties(difficulty_recalc_height);
   }
 
   {
@@ -467,8 +523,19 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
   if (seedhash != crypto::null_hash)
     rx_set_main_seedhash(seedhash.data, tools::get_max_concurrency());
 
-  // Preload the yield_block_info cache
-  rebuild_ybi_cache();
+  // The yield_block_info cache is paged in from the DB on first use
+  uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
+  m_yield_block_info_cache.reset(yield_lock_period + 1 + YBI_CACHE_REORG_DEPTH);
+
+  {
+    CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+    m_output_distribution_cache.clear();
+  }
+
+  // The block height index is built on first use too
+  m_block_height_index.clear();
+
+  m_db_refresh_tip_hash = m_db->top_block_hash(&m_db_refresh_height);
   
   return true;
 }
@@ -524,6 +591,8 @@ bool Blockchain::deinit()
   m_async_pool.join_all();
   m_async_service.stop();
 
+  m_notify_dispatcher.stop();
+
   // as this should be called if handling a SIGSEGV, need to check
   // if m_db is a NULL pointer (and thus may have caused the illegal
   // memory operation), otherwise we may cause a loop.
@@ -575,6 +644,7 @@ void Blockchain::pop_blocks(uint64_t nblocks)
   catch (const std::exception& e)
   {
     LOG_ERROR("Error when popping blocks after processing " << i << " blocks: " << e.what());
+    m_difficulty_window.reset(0);
     if (stop_batch)
       m_db->batch_abort();
     return;
@@ -597,9 +667,6 @@ block Blockchain::pop_block_from_blockchain()
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-  m_timestamps_and_difficulties_height = 0;
-  m_reset_timestamps_and_difficulties_height = true;
-
   block popped_block;
   std::vector<transaction> popped_txs;
 
@@ -623,8 +690,35 @@ block Blockchain::pop_block_from_blockchain()
     throw;
   }
 
-  // Rebuild the YBI cache
-  rebuild_ybi_cache();
+  m_difficulty_window.truncate(m_db->height());
+
+  // Slide the long term weight median back over the popped block rather than
+  // have the next query re-read the whole window
+  {
+    const uint64_t popped_height = m_db->height();
+    const int window_size = m_long_term_block_weights_cache_rolling_median.size();
+    if (m_long_term_block_weights_cache_tip_hash == get_block_hash(popped_block)
+        && popped_height >= (uint64_t)window_size
+        && m_long_term_block_weights_cache_rolling_median.undo_insert(m_db->get_block_long_term_weight(popped_height - window_size)))
+      m_long_term_block_weights_cache_tip_hash = m_db->top_block_hash();
+    else
+      m_long_term_block_weights_cache_tip_hash = crypto::null_hash;
+  }
+
+  // Drop the popped block from the YBI cache - the entries kept below the lock
+  // period mean nothing needs to be re-read until the reorg depth is exhausted
+  if (m_yield_block_info_cache.end_height() == m_db->height() + 1)
+    m_yield_block_info_cache.pop_back();
+
+  if (m_block_height_index.end_height() == m_db->height() + 1)
+    m_block_height_index.pop_back();
+  else
+    m_block_height_index.clear();
+
+  {
+    CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+    m_output_distribution_cache.trim(m_db->height());
+  }
 
   // make sure the hard fork object updates its current version
   m_hardfork->on_block_popped(1);
@@ -685,11 +779,11 @@ bool Blockchain::reset_and_set_genesis_block(const block& b)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  m_timestamps_and_difficulties_height = 0;
-  m_reset_timestamps_and_difficulties_height = true;
+  m_difficulty_window.reset(0);
   invalidate_block_template_cache();
   m_db->reset();
   m_db->drop_alt_blocks();
+  m_alt_block_index_valid = false;
   m_hardfork->init();
 
   db_wtxn_guard wtxn_guard(m_db);
@@ -889,50 +983,39 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
   }
 
   // ND: Speedup
-  // 1. Keep a list of the last 735 (or less) blocks that is used to compute difficulty,
+  // 1. Keep a window of the last 735 (or less) blocks that is used to compute difficulty,
   //    then when the next block difficulty is queried, push the latest height data and
-  //    pop the oldest one from the list. This only requires 1x read per height instead
-  //    of doing 735 (DIFFICULTY_BLOCKS_COUNT).
-  if (m_reset_timestamps_and_difficulties_height)
-    m_timestamps_and_difficulties_height = 0;
-  if (m_timestamps_and_difficulties_height != 0 && ((height - m_timestamps_and_difficulties_height) == 1) && m_timestamps.size() >= difficulty_blocks_count)
-  {
-    uint64_t index = height - 1;
-    m_timestamps.push_back(m_db->get_block_timestamp(index));
-    m_difficulties.push_back(m_db->get_block_cumulative_difficulty(index));
-
-    while (m_timestamps.size() > difficulty_blocks_count)
-      m_timestamps.erase(m_timestamps.begin());
-    while (m_difficulties.size() > difficulty_blocks_count)
-      m_difficulties.erase(m_difficulties.begin());
-
-    m_timestamps_and_difficulties_height = height;
-    timestamps = m_timestamps;
-    difficulties = m_difficulties;
-  }
-  else
-  {
-    uint64_t offset = height - std::min <uint64_t> (height, static_cast<uint64_t>(difficulty_blocks_count));
-    if (offset == 0)
-      ++offset;
-
-    timestamps.clear();
-    difficulties.clear();
-    if (height > offset)
-    {
-      timestamps.reserve(height - offset);
-      difficulties.reserve(height - offset);
-    }
-    for (; offset < height; offset++)
-    {
-      timestamps.push_back(m_db->get_block_timestamp(offset));
-      difficulties.push_back(m_db->get_block_cumulative_difficulty(offset));
-    }
+  //    pop the oldest one from the window. This only requires 1x read per height instead
+  //    of doing 735 (DIFFICULTY_BLOCKS_COUNT). Pops trim the window's tip, so after a
+  //    reorg only the replaced blocks and the few that slid back in are read.
+  // 2. Blocks are added in a DB batch and the blockchain lock is dropped before it is
+  //    committed, so another thread can fill the window from the older committed chain.
+  //    Only reuse it when its top block is still the one at that height.
+  uint64_t window_start = height - std::min <uint64_t> (height, static_cast<uint64_t>(difficulty_blocks_count));
+  if (window_start == 0)
+    ++window_start;
+  if (window_start > height)
+    window_start = height;
+  difficulty_window &window = m_difficulty_window;
+  if (window.empty() || window.end_height() > height || window.end_height() < window_start || window.start_height() > height || !difficulty_window_matches_db())
+    window.reset(window_start);
+  while (window.start_height() > window_start)
+  {
+    const uint64_t index = window.start_height() - 1;
+    window.push_front(m_db->get_block_timestamp(index), m_db->get_block_cumulative_difficulty(index), m_db->get_block_hash_from_height(index));
+  }
+  while (window.end_height() < height)
+  {
+    const uint64_t index = window.end_height();
+    window.push_back(m_db->get_block_timestamp(index), m_db->get_block_cumulative_difficulty(index), m_db->get_block_hash_from_height(index));
+  }
+  while (window.start_height() < window_start)
+    window.pop_front();
+
+  timestamps.reserve(window.size());
+  difficulties.reserve(window.size());
+  window.copy(window.start_height(), window.end_height(), timestamps, difficulties);
 
-    m_timestamps_and_difficulties_height = height;
-    m_timestamps = timestamps;
-    m_difficulties = difficulties;
-  }
   size_t target = get_difficulty_target();
   difficulty_type diff;
   if (version == 1) {
@@ -947,6 +1030,14 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
   return diff;
 }
 //------------------------------------------------------------------
+bool Blockchain::difficulty_window_matches_db() const
+{
+  const difficulty_window &window = m_difficulty_window;
+  if (window.empty() || window.end_height() > m_db->height())
+    return false;
+  return m_db->get_block_hash_from_height(window.end_height() - 1) == window.top_hash();
+}
+//------------------------------------------------------------------
 std::pair<bool, uint64_t> Blockchain::check_difficulty_checkpoints() const
 {
   uint64_t res = 0;
@@ -1069,7 +1160,7 @@ size_t Blockchain::recalculate_difficulties(boost::optional<uint64_t> start_heig
     LOG_ERROR("Corrected difficulties for " << new_cumulative_difficulties.size() << " blocks");
     // clear cache
     m_difficulty_for_next_block_top_hash = crypto::null_hash;
-    m_timestamps_and_difficulties_height = 0;
+    m_difficulty_window.reset(0);
   }
 
   return new_cumulative_difficulties.size();
@@ -1101,9 +1192,6 @@ bool Blockchain::rollback_blockchain_switching(std::list<block>& original_chain,
     return true;
   }
 
-  m_timestamps_and_difficulties_height = 0;
-  m_reset_timestamps_and_difficulties_height = true;
-
   // remove blocks from blockchain until we get back to where we should be.
   while (m_db->height() != rollback_height)
   {
@@ -1139,9 +1227,6 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<block_extended_info>
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-  m_timestamps_and_difficulties_height = 0;
-  m_reset_timestamps_and_difficulties_height = true;
-
   // if empty alt chain passed (not sure how that could happen), return false
   CHECK_AND_ASSERT_MES(alt_chain.size(), false, "switch_to_alternative_blockchain: empty chain passed");
 
@@ -1185,14 +1270,14 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<block_extended_info>
       rollback_blockchain_switching(disconnected_chain, split_height);
 
       const crypto::hash blkid = cryptonote::get_block_hash(bei.bl);
-      m_db->remove_alt_block(blkid);
+      remove_alt_block(blkid);
       alt_ch_iter++;
 
       for(auto alt_ch_to_orph_iter = alt_ch_iter; alt_ch_to_orph_iter != alt_chain.end(); )
       {
         const auto &bei = *alt_ch_to_orph_iter++;
         const crypto::hash blkid = cryptonote::get_block_hash(bei.bl);
-        m_db->remove_alt_block(blkid);
+        remove_alt_block(blkid);
       }
       return false;
     }
@@ -1219,17 +1304,13 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<block_extended_info>
   //removing alt_chain entries from alternative chains container
   for (const auto &bei: alt_chain)
   {
-    m_db->remove_alt_block(cryptonote::get_block_hash(bei.bl));
+    remove_alt_block(cryptonote::get_block_hash(bei.bl));
   }
 
   m_hardfork->reorganize_from_chain_height(split_height);
 
-  std::shared_ptr<tools::Notify> reorg_notify = m_reorg_notify;
-  if (reorg_notify)
-    reorg_notify->notify("%s", std::to_string(split_height).c_str(), "%h", std::to_string(m_db->height()).c_str(),
-        "%n", std::to_string(m_db->height() - split_height).c_str(), "%d", std::to_string(discarded_blocks).c_str(), NULL);
-
   const uint64_t new_height = m_db->height();
+  m_notify_dispatcher.on_reorg(split_height, new_height, discarded_blocks);
   const crypto::hash seedhash = get_block_id_by_height(crypto::rx_seedheight(new_height));
 
   crypto::hash prev_id;
@@ -1238,6 +1319,10 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<block_extended_info>
   else
     send_miner_notifications(new_height, seedhash, prev_id, alt_chain.back().already_generated_coins);
 
+  uint64_t notify_height = split_height;
+  for (const auto &bei: alt_chain)
+    m_notify_dispatcher.on_block(notify_height++, cryptonote::get_block_hash(bei.bl));
+
   for (const auto& notifier : m_block_notifiers)
   {
     std::size_t notify_height = split_height;
@@ -1289,8 +1374,13 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
     if(!main_chain_start_offset)
       ++main_chain_start_offset; //skip genesis block
 
-    // get difficulties and timestamps from relevant main chain blocks
-    for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
+    // get difficulties and timestamps from relevant main chain blocks, the
+    // main chain window usually has them already unless the fork is deep
+    if (main_chain_start_offset <= main_chain_stop_offset && m_difficulty_window.covers(main_chain_start_offset, main_chain_stop_offset) && difficulty_window_matches_db())
+    {
+      m_difficulty_window.copy(main_chain_start_offset, main_chain_stop_offset, timestamps, cumulative_difficulties);
+    }
+    else for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
     {
       timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
       cumulative_difficulties.push_back(m_db->get_block_cumulative_difficulty(main_chain_start_offset));
@@ -1557,7 +1647,7 @@ bool Blockchain::validate_miner_transaction(const block& b, size_t cumulative_bl
 }
 //------------------------------------------------------------------
 // SRCG
-bool Blockchain::validate_protocol_transaction(const block& b, uint64_t height, uint8_t hf_version)
+bool Blockchain::validate_protocol_transaction(const block& b, uint64_t height, uint8_t hf_version, uint64_t *payouts_us)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
 
@@ -1579,59 +1669,19 @@ bool Blockchain::validate_protocol_transaction(const block& b, uint64_t height,
     return true;
   }
 
-  // Get the staking data for the block that matured this time
-  cryptonote::yield_block_info ybi_matured;
-  std::vector<std::pair<yield_tx_info, uint64_t>> yield_payouts;
-  std::vector<std::pair<yield_tx_info_carrot, uint64_t>> carrot_yield_payouts;
-  uint64_t matured_height = height - stake_lock_period - 1;
-  bool ok = get_ybi_entry(matured_height, ybi_matured);
-  if (!ok) {
-    LOG_ERROR("Block at height: " << height << " - Failed to obtain yield block information - aborting");
+  // Get the yield and audit payouts that mature at this height
+  matured_payouts matured;
+  TIME_MEASURE_NS_START(payouts_time);
+  if (!get_matured_payouts(height, matured)) {
+    LOG_ERROR("Block at height: " << height << " - Failed to obtain matured payout information - aborting");
     return false;
-  } else if (ybi_matured.locked_coins_this_block == 0) {
-    LOG_PRINT_L1("Block at height: " << height << " - no yield payouts due - skipping");
-  } else {
-    // Iterate over the cached data for block yield, calculating the yield payouts due
-    if (get_ideal_hard_fork_version(matured_height) >= HF_VERSION_CARROT) {
-      if (!calculate_yield_payouts(matured_height, carrot_yield_payouts)) {
-        LOG_ERROR("Block at height: " << height << " - Failed to obtain carrot yield payout information - aborting");
-        return false;
-      }
-    } else {
-      if (!calculate_yield_payouts(matured_height, yield_payouts)) {
-        LOG_ERROR("Block at height: " << height << " - Failed to obtain yield payout information - aborting");
-        return false;
-      }
-    }
-  }
-
-  // Get the audit data for the block that matures at this height
-  std::vector<std::pair<yield_tx_info, uint64_t>> audit_payouts;
-  const std::map<uint8_t, std::pair<uint64_t, std::pair<std::string, std::string>>> audit_hard_forks = get_config(m_nettype).AUDIT_HARD_FORKS;
-  for (const auto &audit_hf : audit_hard_forks) {
-    uint64_t audit_lock_period = audit_hf.second.first;
-    uint64_t matured_audit_height = height - audit_lock_period - 1;
-    uint8_t hf = m_hardfork->get_ideal_version(matured_audit_height);
-    if (hf == audit_hf.first) {
-      // Found a matching audit
-      // Maturing height was during an audit - process accordingly
-      cryptonote::audit_block_info abi_matured;
-      ok = get_abi_entry(matured_audit_height, abi_matured);
-      if (!ok) {
-        LOG_PRINT_L1("Block at height: " << height << " - failed to obtain audit block information - aborting");
-        return false;
-      } else if (abi_matured.locked_coins_this_block == 0) {
-        LOG_PRINT_L1("Block at height: " << height << " - no audit payouts due - skipping");
-      } else {
-        // Iterate over the cached data for audits, calculating the audit payouts due
-        if (!calculate_audit_payouts(matured_audit_height, audit_payouts)) {
-          LOG_ERROR("Block at height: " << height << " - Failed to obtain audit payout information - aborting");
-          return false;
-        }
-      }
-      break;
-    }
   }
+  TIME_MEASURE_NS_FINISH(payouts_time);
+  if (payouts_us)
+    *payouts_us = payouts_time / 1000;
+  const std::vector<std::pair<yield_tx_info, uint64_t>> &yield_payouts = matured.yield;
+  const std::vector<std::pair<yield_tx_info_carrot, uint64_t>> &carrot_yield_payouts = matured.carrot_yield;
+  const std::vector<std::pair<yield_tx_info, uint64_t>> &audit_payouts = matured.audit;
 
   // Check we have the correct number of entries
   CHECK_AND_ASSERT_MES(
@@ -1775,6 +1825,19 @@ uint64_t Blockchain::get_long_term_block_weight_median(uint64_t start_height, si
     }
   }
 
+  // after a pop, the window is one block too high
+  if (count == (size_t)m_long_term_block_weights_cache_rolling_median.size() && tip_height + 1 < blockchain_height)
+  {
+    crypto::hash next_tip_hash = m_db->get_block_hash_from_height(tip_height + 1);
+    if (next_tip_hash == m_long_term_block_weights_cache_tip_hash
+        && m_long_term_block_weights_cache_rolling_median.undo_insert(m_db->get_block_long_term_weight(start_height)))
+    {
+      MTRACE("requesting " << count << " from " << start_height << ", decremental");
+      m_long_term_block_weights_cache_tip_hash = tip_hash;
+      return m_long_term_block_weights_cache_rolling_median.median();
+    }
+  }
+
   MTRACE("requesting " << count << " from " << start_height << ", uncached");
   std::vector<uint64_t> weights = m_db->get_long_term_block_weights(start_height, count);
   m_long_term_block_weights_cache_tip_hash = tip_hash;
@@ -1839,7 +1902,36 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
       return true;
     }
     MDEBUG("Not using cached template: address " << (!memcmp(&miner_address, &m_btc_address, sizeof(cryptonote::account_public_address))) << ", nonce " << (m_btc_nonce == ex_nonce) << ", cookie " << (m_btc_pool_cookie == m_tx_pool.cookie()) << ", from_block " << (!!from_block));
-    invalidate_block_template_cache();
+    m_btc_valid = false;
+  }
+
+  // A different miner address or extra nonce only changes the miner tx, so
+  // reuse the rest of the template (pool selection, pricing record, yield and
+  // audit payouts) as long as the chain, pool and Oracle record are unchanged
+  if (m_btc_base_valid && !from_block) {
+    if (m_btc_base.pool_cookie == m_tx_pool.cookie() && m_btc_base.b.prev_id == get_tail_id()
+      && m_btc_base.pr_generation == m_pricing_record_cache.get_generation()) {
+      MDEBUG("Using cached template base, rebuilding miner tx");
+      if ((m_btc_base.b.major_version >= HF_VERSION_CARROT) != miner_address.m_is_carrot) {
+        LOG_ERROR("mining to " << (miner_address.m_is_carrot ? "Carrot" : "CryptoNote") << " wallet address, which is not valid at this height");
+        return false;
+      }
+      b = m_btc_base.b;
+      const uint64_t now = time(NULL);
+      if (b.timestamp < now)
+        b.timestamp = now;
+      if (!construct_block_template_miner_tx(b, m_btc_base.height, m_btc_base.median_weight, m_btc_base.already_generated_coins, m_btc_base.txs_weight, m_btc_base.fee, miner_address, ex_nonce))
+        return false;
+      diffic = m_btc_base.difficulty;
+      height = m_btc_base.height;
+      expected_reward = m_btc_base.expected_reward;
+      seed_height = m_btc_base.seed_height;
+      seed_hash = m_btc_base.seed_hash;
+      cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, seed_height, seed_hash, m_btc_base.pool_cookie);
+      return true;
+    }
+    MDEBUG("Not using cached template base: cookie " << (m_btc_base.pool_cookie == m_tx_pool.cookie()) << ", pricing record " << (m_btc_base.pr_generation == m_pricing_record_cache.get_generation()));
+    m_btc_base_valid = false;
   }
 
   if (from_block)
@@ -1951,12 +2043,14 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
     return false;
   }
   
-  std::map<std::string, uint64_t> circ_supply = get_db().get_circulating_supply();
+  // Read before fetching, so a record arriving meanwhile invalidates the template base
+  const uint64_t pr_generation = m_pricing_record_cache.get_generation();
 
   // Check if we are supposed to be obtaining PRs from the Oracle
   if (b.major_version >= HF_VERSION_ENABLE_ORACLE) {
 
-    // Yep - go get the pricing records
+    // Yep - go get the pricing records, the only user of the supply snapshot here
+    std::map<std::string, uint64_t> circ_supply = get_db().get_circulating_supply();
     oracle::pricing_record pr;
     if (!get_pricing_record(pr, circ_supply, b.timestamp)) {
       LOG_ERROR("Creating block template: error: failed to get pricing record");
@@ -1982,126 +2076,65 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
     return false;
   }
 
-  // Check to see if there are any matured YIELD TXs
-  uint64_t yield_lock_period = get_config(m_nettype).STAKE_LOCK_PERIOD;
-  uint64_t start_height = (height > yield_lock_period) ? height - yield_lock_period - 1 : 0;
-
+  // Get the yield and audit payouts that mature at this height
   std::vector<cryptonote::protocol_data_entry> protocol_entries;
-  cryptonote::yield_block_info ybi_matured;
-  bool ok = get_ybi_entry(start_height, ybi_matured);
-  if (ok && ybi_matured.locked_coins_this_block > 0) {
-
-    // Work out what the asset_type should be based on height of submission
-    uint8_t hf_submitted = m_hardfork->get_ideal_version(start_height);
-
-    // Iterate over the cached data for block yield, calculating the yield payouts due
-    std::vector<std::pair<yield_tx_info, uint64_t>> yield_payouts;
-    std::vector<std::pair<yield_tx_info_carrot, uint64_t>> carrot_yield_payouts;  
-    if (hf_submitted >= HF_VERSION_CARROT) {
-      if (!calculate_yield_payouts(start_height, carrot_yield_payouts)) {
-        LOG_ERROR("Failed to obtain yield payout information - aborting");
-        return false;
-      }
-    } else {
-      if (!calculate_yield_payouts(start_height, yield_payouts)) {
-        LOG_ERROR("Failed to obtain yield payout information - aborting");
-        return false;
-      }
-    }
-
-    // Create the protocol_metadata entries here
-    if (!carrot_yield_payouts.empty()) {
-      for (const auto& yield_entry: carrot_yield_payouts) {
-        cryptonote::protocol_data_entry entry;
-        entry.amount_burnt = yield_entry.second;
-        entry.amount_minted = 0;
-        entry.amount_slippage_limit = 0;
-        if (hf_submitted >= HF_VERSION_SALVIUM_ONE_PROOFS) {
-          entry.source_asset = "SAL1";
-          entry.destination_asset = "SAL1";
-        } else {
-          entry.source_asset = "SAL";
-          entry.destination_asset = "SAL";
-        }
-        entry.return_address = yield_entry.first.return_address;
-        entry.type = cryptonote::transaction_type::STAKE;
-        entry.return_pubkey = yield_entry.first.return_pubkey;
-        entry.origin_height = start_height;
-        entry.return_view_tag = yield_entry.first.return_view_tag;
-        entry.return_anchor_enc = yield_entry.first.return_anchor_enc;
-        entry.is_carrot = true;
-        protocol_entries.push_back(entry);
-      }
-    } else {
-      for (const auto& yield_entry: yield_payouts) {
-        cryptonote::protocol_data_entry entry;
-        entry.amount_burnt = yield_entry.second;
-        entry.amount_minted = 0;
-        entry.amount_slippage_limit = 0;
-        if (hf_submitted >= HF_VERSION_SALVIUM_ONE_PROOFS) {
-          entry.source_asset = "SAL1";
-          entry.destination_asset = "SAL1";
-        } else {
-          entry.source_asset = "SAL";
-          entry.destination_asset = "SAL";
-        }
-        entry.return_address = yield_entry.first.return_address;
-        entry.type = cryptonote::transaction_type::STAKE;
-        entry.P_change = yield_entry.first.P_change;
-        entry.return_pubkey = yield_entry.first.return_pubkey;
-        entry.origin_height = start_height;
-        entry.is_carrot = false;
-        protocol_entries.push_back(entry);
-      }
+  matured_payouts payouts;
+  if (height > get_config(m_nettype).STAKE_LOCK_PERIOD) {
+    if (!get_matured_payouts(height, payouts)) {
+      LOG_ERROR("Failed to obtain matured payout information - aborting");
+      return false;
     }
   }
-
-  // Get the audit data for the block that matures at this height
-  std::vector<std::pair<yield_tx_info, uint64_t>> audit_payouts;
-  const std::map<uint8_t, std::pair<uint64_t, std::pair<std::string, std::string>>> audit_hard_forks = get_config(m_nettype).AUDIT_HARD_FORKS;
-  for (const auto &audit_hf : audit_hard_forks) {
-    uint64_t audit_lock_period = audit_hf.second.first;
-    uint64_t matured_audit_height = height - audit_lock_period - 1;
-    uint8_t hf = m_hardfork->get_ideal_version(matured_audit_height);
-    if (hf == audit_hf.first) {
-      // Found a matching audit
-      // Maturing height was during an audit - process accordingly
-      cryptonote::audit_block_info abi_matured;
-      ok = get_abi_entry(matured_audit_height, abi_matured);
-      if (!ok) {
-        LOG_PRINT_L1("Block at height: " << height << " - failed to obtain audit block information - aborting");
-        return false;
-      } else if (abi_matured.locked_coins_this_block == 0) {
-        LOG_PRINT_L1("Block at height: " << height << " - no audit payouts due - skipping");
-      } else {
-        // Iterate over the cached data for audits, calculating the audit payouts due
-        if (!calculate_audit_payouts(matured_audit_height, audit_payouts)) {
-          LOG_ERROR("Block at height: " << height << " - Failed to obtain audit payout information - aborting");
-          return false;
-        }
-
-        // Get the asset types
-        const std::pair<std::string, std::string> audit_asset_types = audit_hf.second.second;
-      
-        // Create the protocol_metadata entries here
-        for (const auto& audit_entry: audit_payouts) {
-          cryptonote::protocol_data_entry entry;
-          entry.amount_burnt = audit_entry.second;
-          entry.amount_minted = 0;
-          entry.amount_slippage_limit = 0;
-          entry.source_asset = audit_asset_types.first;
-          entry.destination_asset = audit_asset_types.second;
-          entry.return_address = audit_entry.first.return_address;
-          entry.type = cryptonote::transaction_type::AUDIT;
-          entry.P_change = audit_entry.first.P_change;
-          entry.return_pubkey = audit_entry.first.return_pubkey;
-          entry.origin_height = matured_audit_height;
-          entry.is_carrot = false;
-          protocol_entries.push_back(entry);
-        }
-      }
-      break;
-    }
+  protocol_entries.reserve(payouts.carrot_yield.size() + payouts.yield.size() + payouts.audit.size());
+
+  // Create the protocol_metadata entries here
+  const uint8_t hf_submitted = m_hardfork->get_ideal_version(payouts.yield_height);
+  const std::string yield_asset = hf_submitted >= HF_VERSION_SALVIUM_ONE_PROOFS ? "SAL1" : "SAL";
+  for (const auto& yield_entry: payouts.carrot_yield) {
+    cryptonote::protocol_data_entry entry;
+    entry.amount_burnt = yield_entry.second;
+    entry.amount_minted = 0;
+    entry.amount_slippage_limit = 0;
+    entry.source_asset = yield_asset;
+    entry.destination_asset = yield_asset;
+    entry.return_address = yield_entry.first.return_address;
+    entry.type = cryptonote::transaction_type::STAKE;
+    entry.return_pubkey = yield_entry.first.return_pubkey;
+    entry.origin_height = payouts.yield_height;
+    entry.return_view_tag = yield_entry.first.return_view_tag;
+    entry.return_anchor_enc = yield_entry.first.return_anchor_enc;
+    entry.is_carrot = true;
+    protocol_entries.push_back(entry);
+  }
+  for (const auto& yield_entry: payouts.yield) {
+    cryptonote::protocol_data_entry entry;
+    entry.amount_burnt = yield_entry.second;
+    entry.amount_minted = 0;
+    entry.amount_slippage_limit = 0;
+    entry.source_asset = yield_asset;
+    entry.destination_asset = yield_asset;
+    entry.return_address = yield_entry.first.return_address;
+    entry.type = cryptonote::transaction_type::STAKE;
+    entry.P_change = yield_entry.first.P_change;
+    entry.return_pubkey = yield_entry.first.return_pubkey;
+    entry.origin_height = payouts.yield_height;
+    entry.is_carrot = false;
+    protocol_entries.push_back(entry);
+  }
+  for (const auto& audit_entry: payouts.audit) {
+    cryptonote::protocol_data_entry entry;
+    entry.amount_burnt = audit_entry.second;
+    entry.amount_minted = 0;
+    entry.amount_slippage_limit = 0;
+    entry.source_asset = payouts.audit_asset_types.first;
+    entry.destination_asset = payouts.audit_asset_types.second;
+    entry.return_address = audit_entry.first.return_address;
+    entry.type = cryptonote::transaction_type::AUDIT;
+    entry.P_change = audit_entry.first.P_change;
+    entry.return_pubkey = audit_entry.first.return_pubkey;
+    entry.origin_height = payouts.audit_height;
+    entry.is_carrot = false;
+    protocol_entries.push_back(entry);
   }
 
   /*
@@ -2125,7 +2158,7 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
   // Time to construct the protocol_tx
   uint64_t protocol_fee = 0;
   address_parse_info treasury_address_info;
-  ok = cryptonote::get_account_address_from_str(treasury_address_info, m_nettype, get_config(m_nettype).TREASURY_ADDRESS);
+  bool ok = cryptonote::get_account_address_from_str(treasury_address_info, m_nettype, get_config(m_nettype).TREASURY_ADDRESS);
   CHECK_AND_ASSERT_MES(ok, false, "Failed to obtain treasury address info");
   ok = construct_protocol_tx(height, b.protocol_tx, protocol_entries, b.major_version);
   CHECK_AND_ASSERT_MES(ok, false, "Failed to construct protocol tx");
@@ -2184,6 +2217,33 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
       ", fee " << fee);
 #endif
 
+  if (!from_block)
+  {
+    m_btc_base.b = b;
+    m_btc_base.difficulty = diffic;
+    m_btc_base.height = height;
+    m_btc_base.median_weight = median_weight;
+    m_btc_base.already_generated_coins = already_generated_coins;
+    m_btc_base.txs_weight = txs_weight;
+    m_btc_base.fee = fee;
+    m_btc_base.expected_reward = expected_reward;
+    m_btc_base.seed_height = seed_height;
+    m_btc_base.seed_hash = seed_hash;
+    m_btc_base.pool_cookie = pool_cookie;
+    m_btc_base.pr_generation = pr_generation;
+    m_btc_base_valid = true;
+  }
+
+  if (!construct_block_template_miner_tx(b, height, median_weight, already_generated_coins, txs_weight, fee, miner_address, ex_nonce))
+    return false;
+
+  if (!from_block)
+    cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, seed_height, seed_hash, pool_cookie);
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::construct_block_template_miner_tx(block &b, uint64_t height, size_t median_weight, uint64_t already_generated_coins, size_t txs_weight, uint64_t fee, const account_public_address &miner_address, const blobdata &ex_nonce)
+{
   /*
    two-phase miner transaction generation: we don't know exact block weight until we prepare block, but we don't know reward until we know
    block weight, so first miner transaction generated with fake amount of money, and with phase we know think we know expected block weight
@@ -2244,8 +2304,6 @@ bool Blockchain::create_block_template(block& b, const crypto::hash *from_block,
         ", cumulative weight " << cumulative_weight << " is now good");
 #endif
 
-    if (!from_block)
-      cache_block_template(b, miner_address, ex_nonce, diffic, height, expected_reward, seed_height, seed_hash, pool_cookie);
     return true;
   }
   LOG_ERROR("Failed to create_block_template with " << 10 << " tries");
@@ -2258,6 +2316,15 @@ bool Blockchain::create_block_template(block& b, const account_public_address& m
 }
 //------------------------------------------------------------------
 bool Blockchain::get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, std::vector<tx_block_template_backlog_entry>& tx_backlog)
+{
+  tx_block_template_backlog_diff diff;
+  if (!get_miner_data(major_version, height, prev_id, seed_hash, difficulty, median_weight, already_generated_coins, 0, diff))
+    return false;
+  tx_backlog = std::move(diff.changed);
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, uint64_t since_backlog_version, tx_block_template_backlog_diff& tx_backlog)
 {
   prev_id = m_db->top_block_hash(&height);
   ++height;
@@ -2273,7 +2340,7 @@ bool Blockchain::get_miner_data(uint8_t& major_version, uint64_t& height, crypto
   median_weight = m_current_block_cumul_weight_median;
   already_generated_coins = m_db->get_block_already_generated_coins(height - 1);
 
-  m_tx_pool.get_block_template_backlog(tx_backlog);
+  m_tx_pool.get_block_template_backlog_diff(since_backlog_version, tx_backlog);
 
   return true;
 }
@@ -2292,9 +2359,14 @@ bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vect
   CHECK_AND_ASSERT_MES(start_top_height < m_db->height(), false, "internal error: passed start_height not < " << " m_db->height() -- " << start_top_height << " >= " << m_db->height());
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
   timestamps.reserve(timestamps.size() + start_top_height - stop_offset);
+  const bool use_window = difficulty_window_matches_db();
   while (start_top_height != stop_offset)
   {
-    timestamps.push_back(m_db->get_block_timestamp(start_top_height));
+    // most alt chains fork within the difficulty window, which has these already
+    if (use_window && m_difficulty_window.covers(start_top_height, start_top_height + 1))
+      timestamps.push_back(m_difficulty_window.timestamp(start_top_height));
+    else
+      timestamps.push_back(m_db->get_block_timestamp(start_top_height));
     --start_top_height;
   }
   return true;
@@ -2303,22 +2375,38 @@ bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vect
 bool Blockchain::build_alt_chain(const crypto::hash &prev_id, std::list<block_extended_info>& alt_chain, std::vector<uint64_t> &timestamps, block_verification_context& bvc) const
 {
     //build alternative subchain, front -> mainchain, back -> alternative head
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    static constexpr size_t ALT_BLOCK_CACHE_SIZE = 1024;
     cryptonote::alt_block_data_t data;
     cryptonote::blobdata blob;
-    bool found = m_db->get_alt_block(prev_id, &data, &blob);
+    crypto::hash id = prev_id;
+    bool found = m_db->get_alt_block(id, &data, NULL);
     timestamps.clear();
     while(found)
     {
       block_extended_info bei;
-      CHECK_AND_ASSERT_MES(cryptonote::parse_and_validate_block_from_blob(blob, bei.bl), false, "Failed to parse alt block");
+      const auto cached = m_alt_block_cache.find(id);
+      if (cached != m_alt_block_cache.end())
+      {
+        bei.bl = cached->second;
+      }
+      else
+      {
+        CHECK_AND_ASSERT_MES(m_db->get_alt_block(id, NULL, &blob), false, "Failed to get alt block");
+        CHECK_AND_ASSERT_MES(cryptonote::parse_and_validate_block_from_blob(blob, bei.bl), false, "Failed to parse alt block");
+        if (m_alt_block_cache.size() >= ALT_BLOCK_CACHE_SIZE)
+          m_alt_block_cache.clear();
+        m_alt_block_cache.emplace(id, bei.bl);
+      }
       bei.height = data.height;
       bei.block_cumulative_weight = data.cumulative_weight;
       bei.cumulative_difficulty = data.cumulative_difficulty_high;
       bei.cumulative_difficulty = (bei.cumulative_difficulty << 64) + data.cumulative_difficulty_low;
       bei.already_generated_coins = data.already_generated_coins;
       timestamps.push_back(bei.bl.timestamp);
+      id = bei.bl.prev_id;
       alt_chain.push_front(std::move(bei));
-      found = m_db->get_alt_block(bei.bl.prev_id, &data, &blob);
+      found = m_db->get_alt_block(id, &data, NULL);
     }
 
     // if block to be added connects to known blocks that aren't part of the
@@ -2363,10 +2451,9 @@ bool Blockchain::build_alt_chain(const crypto::hash &prev_id, std::list<block_ex
 // a long forked chain eventually.
 bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc)
 {
+  TRACE_SPAN("alternative_block");
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  m_timestamps_and_difficulties_height = 0;
-  m_reset_timestamps_and_difficulties_height = true;
   uint64_t block_height = get_block_height(b);
   if(0 == block_height)
   {
@@ -2542,6 +2629,7 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     data.cumulative_difficulty_high = ((bei.cumulative_difficulty >> 64) & 0xffffffffffffffff).convert_to<uint64_t>();
     data.already_generated_coins = bei.already_generated_coins;
     m_db->add_alt_block(id, data, cryptonote::block_to_blob(bei.bl));
+    m_alt_block_index.emplace(id, alt_block_index_entry{bei.bl.prev_id, bei.height});
     alt_chain.push_back(bei);
 
     // FIXME: is it even possible for a checkpoint to show up not on the main chain?
@@ -2715,15 +2803,90 @@ size_t Blockchain::get_alternative_blocks_count() const
   return m_db->get_alt_block_count();
 }
 //------------------------------------------------------------------
+const alt_block_index_t &Blockchain::get_alt_block_index() const
+{
+  // the alt block table is the authority, and may change behind our back
+  // (dropped at startup, written by the daemon owning a replica's db)
+  if (m_alt_block_index_valid && m_alt_block_index.size() == m_db->get_alt_block_count())
+    return m_alt_block_index;
+
+  m_alt_block_index.clear();
+  m_db->for_all_alt_blocks([this](const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata_ref *blob) {
+    if (!blob)
+    {
+      MERROR("No blob, but blobs were requested");
+      return false;
+    }
+    cryptonote::block bl;
+    if (cryptonote::parse_and_validate_block_from_blob(*blob, bl))
+      m_alt_block_index.emplace(blkid, alt_block_index_entry{bl.prev_id, data.height});
+    else
+      MERROR("Failed to parse block from blob");
+    return true;
+  }, true);
+  m_alt_block_index_valid = true;
+  return m_alt_block_index;
+}
+//------------------------------------------------------------------
+void Blockchain::remove_alt_block(const crypto::hash &blkid)
+{
+  m_db->remove_alt_block(blkid);
+  m_alt_block_index.erase(blkid);
+  m_alt_block_cache.erase(blkid);
+}
+//------------------------------------------------------------------
+void Blockchain::prune_stale_alt_chains()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  const uint64_t height = m_db->height();
+  if (height <= ALT_CHAIN_MAX_STALE_BLOCKS || m_db->get_alt_block_count() == 0)
+    return;
+  const uint64_t cutoff = height - ALT_CHAIN_MAX_STALE_BLOCKS;
+
+  const std::vector<crypto::hash> stale = get_stale_alt_blocks(get_alt_block_index(), cutoff);
+  size_t removed = 0;
+  for (const crypto::hash &h: stale)
+  {
+    try
+    {
+      remove_alt_block(h);
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to prune alt block " << h << ": " << e.what());
+      return;
+    }
+    ++removed;
+  }
+  if (removed > 0)
+    MINFO("Pruned " << removed << " alt blocks from chains ending over " << ALT_CHAIN_MAX_STALE_BLOCKS << " blocks below the top");
+}
+//------------------------------------------------------------------
 // This function adds the output specified by <amount, i> to the result_outs container
 // unlocked and other such checks should be done by here.
 uint64_t Blockchain::get_num_mature_outputs(const std::string asset_type) const
 {
+  db_rtxn_guard rtxn_guard(m_db);
   uint64_t num_outs_of_asset_type = m_db->get_num_outputs_of_asset_type(asset_type);
 
-  // ensure we don't include outputs that aren't yet eligible to be used
-  // outpouts are sorted by height
+  // the outputs of the blocks above the spendable age are not eligible yet,
+  // the output distribution cache has their count: a block's outputs
+  // mature once height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE <= blockchain_height
   const uint64_t blockchain_height = m_db->height();
+  if (blockchain_height > CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE)
+  {
+    const uint64_t top_height = blockchain_height - 1;
+    const uint64_t last_mature_height = blockchain_height - CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE;
+    CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+    m_output_distribution_cache.enforce_limit(asset_type);
+    if (fill_output_distribution_cache(asset_type, top_height))
+    {
+      const uint64_t immature = m_output_distribution_cache.at(asset_type, top_height) - m_output_distribution_cache.at(asset_type, last_mature_height);
+      return num_outs_of_asset_type - std::min(immature, num_outs_of_asset_type);
+    }
+  }
+
+  // outputs are sorted by height
   while (num_outs_of_asset_type > 0)
   {
     uint64_t output_id = m_db->get_output_id_from_asset_type_output_index(asset_type, num_outs_of_asset_type - 1);
@@ -2748,7 +2911,8 @@ crypto::public_key Blockchain::get_output_key(uint64_t amount, uint64_t global_i
 bool Blockchain::get_outs(const COMMAND_RPC_GET_OUTPUTS_BIN::request& req, COMMAND_RPC_GET_OUTPUTS_BIN::response& res) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  // DB reads only: a read txn gives a consistent snapshot without waiting on block processing
+  db_rtxn_guard rtxn_guard(m_db);
 
   res.outs.clear();
   res.outs.reserve(req.outputs.size());
@@ -2870,20 +3034,17 @@ bool Blockchain::get_output_distribution(uint64_t amount, std::string asset_type
     return false;
   if (amount == 0)
   {
-    std::vector<uint64_t> heights;
-    heights.reserve(to_height + 1 - start_height);
-    const uint64_t real_start_height = start_height > 0 ? start_height-1 : start_height;
-    for (uint64_t h = real_start_height; h <= to_height; ++h)
-      heights.push_back(h);
-    std::pair<std::vector<uint64_t>, uint64_t> block_cum_outputs = m_db->get_block_cumulative_rct_outputs(heights, asset_type);
-    distribution = block_cum_outputs.first;
-    num_spendable_global_outs = block_cum_outputs.second;
-    if (start_height > 0)
-    {
-      base = distribution[0];
-      distribution.erase(distribution.begin());
-    }
-    return true;
+    CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+    m_output_distribution_cache.enforce_limit(asset_type);
+
+    // the global counts are needed for the spendable count too
+    for (const std::string &type: {asset_type, std::string()})
+      if (!fill_output_distribution_cache(type, to_height))
+        return false;
+
+    if (to_height + 1 >= CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE)
+      num_spendable_global_outs = m_output_distribution_cache.at(std::string(), to_height + 1 - CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
+    return m_output_distribution_cache.get(asset_type, start_height, to_height, distribution, base);
   }
   else
   {
@@ -2891,6 +3052,22 @@ bool Blockchain::get_output_distribution(uint64_t amount, std::string asset_type
   }
 }
 //------------------------------------------------------------------
+bool Blockchain::fill_output_distribution_cache(const std::string &asset_type, uint64_t to_height) const
+{
+  // only read the heights not cached yet
+  const uint64_t cached_end_height = m_output_distribution_cache.end_height(asset_type);
+  if (cached_end_height > to_height)
+    return true;
+  std::vector<uint64_t> heights;
+  heights.reserve(to_height + 1 - cached_end_height);
+  for (uint64_t h = cached_end_height; h <= to_height; ++h)
+    heights.push_back(h);
+  const std::pair<std::vector<uint64_t>, uint64_t> block_cum_outputs = m_db->get_block_cumulative_rct_outputs(heights, asset_type);
+  CHECK_AND_ASSERT_MES(m_output_distribution_cache.update(asset_type, cached_end_height, block_cum_outputs.first), false,
+      "Failed to update the output distribution cache");
+  return true;
+}
+//------------------------------------------------------------------
 // This function takes a list of block hashes from another node
 // on the network to find where the split point is between us and them.
 // This is used to see what to send another node that needs to sync.
@@ -2919,13 +3096,16 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
 
   // Find the first block the foreign chain has that we also have.
   // Assume qblock_ids is in reverse-chronological order.
+  // The index holds every main chain block, so a miss needs no db lookup, and since it
+  // only keeps truncated hashes a hit is checked against the block id at that height
+  fill_block_height_index();
   auto bl_it = qblock_ids.begin();
   uint64_t split_height = 0;
   for(; bl_it != qblock_ids.end(); bl_it++)
   {
     try
     {
-      if (m_db->block_exists(*bl_it, &split_height))
+      if (m_block_height_index.find(*bl_it, split_height) && m_db->get_block_hash_from_height(split_height) == *bl_it)
         break;
     }
     catch (const std::exception& e)
@@ -2948,47 +3128,39 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
   return true;
 }
 //------------------------------------------------------------------
+void Blockchain::fill_block_height_index() const
+{
+  const uint64_t db_height = m_db->height();
+  if (m_block_height_index.end_height() > db_height)
+    m_block_height_index.clear();
+  if (m_block_height_index.end_height() == db_height)
+    return;
+
+  const uint64_t start_height = m_block_height_index.end_height();
+  const uint64_t t0 = epee::misc_utils::get_ns_count();
+  static constexpr uint64_t chunk_size = 10000;
+  for (uint64_t height = start_height; height < db_height; height += chunk_size)
+  {
+    for (const crypto::hash &hash: m_db->get_hashes_range(height, std::min(height + chunk_size, db_height) - 1))
+      m_block_height_index.push_back(hash);
+  }
+  if (db_height - start_height > chunk_size)
+    MINFO("Indexed " << db_height - start_height << " block hashes in " << (epee::misc_utils::get_ns_count() - t0) / 1000000 << " ms");
+}
+//------------------------------------------------------------------
 bool Blockchain::get_pricing_record(oracle::pricing_record &pr, std::map<std::string, uint64_t> &circ_supply, uint64_t timestamp)
 {
   LOG_PRINT_L1("Requesting pricing record from Oracle - time : " << timestamp);
 
-  bool r = false;
   const uint64_t height = get_current_blockchain_height();
-  const uint8_t hf_version = m_hardfork->get_current_version();
 
-  epee::net_utils::http::http_simple_client http_client;
-  COMMAND_RPC_GET_PRICING_RECORD::request req = AUTO_VAL_INIT(req);
-  COMMAND_RPC_GET_PRICING_RECORD::response res = AUTO_VAL_INIT(res);
-  
-  std::array<std::string, 3> oracle_urls = get_config(m_nettype).ORACLE_URLS;
-  std::shuffle(oracle_urls.begin(), oracle_urls.end(), std::default_random_engine(crypto::rand<unsigned>()));
-  std::string url = "/price?height=" + std::to_string(height);
-  //url += "&timestamp=" + boost::lexical_cast<std::string>(timestamp) + "&version=" + std::to_string(hf_version);
-  url += "&sal=" + (circ_supply.count("SAL") ? std::to_string(circ_supply["SAL"]) : "0");
-  url += "&vsd=" + (circ_supply.count("VSD") ? std::to_string(circ_supply["VSD"]) : "0");
-  for (size_t n = 0; n < oracle_urls.size(); n++) {
-    http_client.set_server(oracle_urls[n], boost::none, epee::net_utils::ssl_support_t::e_ssl_support_autodetect);
-    r = epee::net_utils::invoke_http_json(url, req, res, http_client, std::chrono::seconds(10), "GET");
-    if (r) {
-      LOG_PRINT_L1("Obtained pricing record from Oracle : " << oracle_urls[n]);
-      break;
-    }
-    LOG_PRINT_L1("Failed to obtain pricing record from Oracle : " << oracle_urls[n]);
-  }
-    
-  if (!r) {
-    LOG_PRINT_L0("Failed to get pricing record from Oracle - returning empty PR");
-    res.pr = oracle::pricing_record();
-  }
+  // From now on, keep the record for the next block prefetched whenever a block is added
+  m_pricing_record_prefetch = true;
 
-  // Verify the signature
-  if (res.pr.verifySignature(get_config(m_nettype).ORACLE_PUBLIC_KEY)) {
-    // Copy the PR
-    pr = res.pr;
-  } else {
-    LOG_PRINT_L0("Failed to verify signature of pricing record from Oracle - returning empty PR");
-    pr = oracle::pricing_record();
-  }
+  // Served from memory if it was prefetched, otherwise this waits for the
+  // (parallel) fetch - an empty record is returned if no Oracle responds
+  if (!m_pricing_record_cache.get(height, circ_supply, pr))
+    LOG_PRINT_L1("Pricing record for height " << height << " was not prefetched");
 
   std::string sig_hex;
   for (size_t i = 0; i < pr.signature.size(); i++) {
@@ -3000,6 +3172,11 @@ bool Blockchain::get_pricing_record(oracle::pricing_record &pr, std::map<std::st
   return true;
 }
 //------------------------------------------------------------------
+int64_t Blockchain::get_pricing_record_age() const
+{
+  return m_pricing_record_cache.get_age();
+}
+//------------------------------------------------------------------
 difficulty_type Blockchain::block_difficulty(uint64_t i) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3112,7 +3289,7 @@ static bool fill(BlockchainDB *db, const crypto::hash &tx_hash, tx_blob_entry &t
 bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::blobdata>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
 
   txs.reserve(txs_ids.size());
   for (const auto& tx_hash : txs_ids)
@@ -3136,7 +3313,7 @@ bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids
 bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash>& txs_ids, std::vector<tx_blob_entry>& txs, std::vector<crypto::hash>& missed_txs, bool pruned) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
 
   txs.reserve(txs_ids.size());
   for (const auto& tx_hash : txs_ids)
@@ -3172,7 +3349,7 @@ template<class t_ids_container, class t_tx_container, class t_missed_container>
 bool Blockchain::get_split_transactions_blobs(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
 
   reserve_container(txs, txs_ids.size());
   for (const auto& tx_hash : txs_ids)
@@ -3206,7 +3383,7 @@ template<class t_ids_container, class t_tx_container, class t_missed_container>
 bool Blockchain::get_transactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs, bool pruned) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
 
   reserve_container(txs, txs_ids.size());
   for (const auto& tx_hash : txs_ids)
@@ -3479,7 +3656,7 @@ bool Blockchain::check_for_double_spend(const transaction& tx, key_images_contai
 bool Blockchain::get_tx_outputs_gindexs(const crypto::hash& tx_id, size_t n_txes, std::vector<std::vector<std::pair<uint64_t, uint64_t>>>& indexs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
   uint64_t tx_index;
   if (!m_db->tx_exists(tx_id, tx_index))
   {
@@ -3495,7 +3672,7 @@ bool Blockchain::get_tx_outputs_gindexs(const crypto::hash& tx_id, size_t n_txes
 bool Blockchain::get_tx_outputs_gindexs(const crypto::hash& tx_id, std::vector<std::pair<uint64_t, uint64_t>>& indexs) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  db_rtxn_guard rtxn_guard(m_db);
   uint64_t tx_index;
   if (!m_db->tx_exists(tx_id, tx_index))
   {
@@ -3996,7 +4173,7 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
 //        check_tx_input() rather than here, and use this function simply
 //        to iterate the inputs as necessary (splitting the task
 //        using threads, etc.)
-bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height) const
+bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height, deferred_rct_verification *deferred) const
 {
   PERF_TIMER(check_tx_inputs);
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -4279,6 +4456,19 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
     case rct::RCTTypeSalviumZero:
     case rct::RCTTypeSalviumOne:
     {
+      if (deferred)
+      {
+        // everything but the signatures checked out, so let the caller carry on with the next tx meanwhile
+        const auto mix_ring = std::make_shared<rct::ctkeyM>(std::move(pubkeys));
+        tools::threadpool::getInstanceForCompute().submit(&deferred->waiter, [this, &tx, mix_ring, hf_version, deferred]() {
+          if (!ver_rct_non_semantics_simple_cached(tx, *mix_ring, m_rct_ver_cache, RCT_CACHE_TYPE, hf_version))
+          {
+            MERROR_VER("Failed to check ringct signatures for tx " << get_transaction_hash(tx));
+            deferred->failed = true;
+          }
+        });
+        break;
+      }
       if (!ver_rct_non_semantics_simple_cached(tx, pubkeys, m_rct_ver_cache, RCT_CACHE_TYPE, hf_version))
       {
         MERROR_VER("Failed to check ringct signatures!");
@@ -4663,6 +4853,8 @@ uint64_t Blockchain::get_adjusted_time(uint64_t height) const
 bool Blockchain::calculate_audit_payouts(const uint64_t start_height, std::vector<std::pair<yield_tx_info, uint64_t>>& audit_container)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
+  static tools::metrics::histogram &payout_time = tools::metrics::get_histogram("payout_calculation_seconds", "Time taken to compute protocol payouts", tools::metrics::label("kind", "audit"));
+  tools::metrics::scoped_timer payout_timer(payout_time);
 
   // Clear the audit payout amounts
   audit_container.clear();
@@ -4697,36 +4889,161 @@ bool Blockchain::calculate_audit_payouts(const uint64_t start_height, std::vecto
   return true;
 }
 //------------------------------------------------------------------
-bool Blockchain::get_abi_entry(const uint64_t height, cryptonote::audit_block_info& abi)
+bool Blockchain::get_matured_payouts(const uint64_t height, matured_payouts& payouts)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
-  
-  // Clear the provided container
-  std::memset(&abi, 0, sizeof(struct cryptonote::audit_block_info));
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-  int result = m_db->get_audit_block_info(height, abi);
-  if (result) {
-    // Request failed - report error and bail out
-    LOG_ERROR("failed to retrieve ABI entry for height " << height << " - aborting");
-    return false;
+  static tools::metrics::counter &hits = tools::metrics::get_counter("precomputed_payouts_total", "Payout lookups answered by the background precompute", tools::metrics::label("result", "hit"));
+  static tools::metrics::counter &misses = tools::metrics::get_counter("precomputed_payouts_total", "Payout lookups answered by the background precompute", tools::metrics::label("result", "miss"));
+  if (height == m_next_payouts_height && height == m_db->height() && m_next_payouts_top_hash == m_db->top_block_hash()) {
+    hits.inc();
+    MDEBUG("Using precomputed payouts for height " << height);
+    payouts = m_next_payouts;
+    return true;
   }
-  return true;
+  misses.inc();
+  MDEBUG("No precomputed payouts for height " << height << " (have " << m_next_payouts_height << "), computing them now");
+  return compute_matured_payouts(height, payouts);
 }
 //------------------------------------------------------------------
-bool Blockchain::calculate_yield_payouts(const uint64_t start_height, std::vector<std::pair<yield_tx_info_carrot, uint64_t>>& yield_container)
+bool Blockchain::compute_matured_payouts(const uint64_t height, matured_payouts& payouts)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
 
-  // Clear the yield payout amounts
-  yield_container.clear();
+  payouts.yield.clear();
+  payouts.carrot_yield.clear();
+  payouts.audit.clear();
+  payouts.yield_height = payouts.audit_height = 0;
 
-  // Get the YIELD TX information for matured staked coins
-  std::vector<cryptonote::yield_tx_info_carrot> yield_entries;
-  // We get the yield_tx_info from the block _before_ they started to accrue yield
-  int yield_tx_result = m_db->get_carrot_yield_tx_info(start_height, yield_entries);
-  if (!yield_entries.size()) {
+  const uint64_t stake_lock_period = get_config(m_nettype).STAKE_LOCK_PERIOD;
+  if (height <= stake_lock_period)
+    return true;
 
-    // Report error and abort
+  // Get the staking data for the block that matured this time
+  payouts.yield_height = height - stake_lock_period - 1;
+  cryptonote::yield_block_info ybi_matured;
+  if (!get_ybi_entry(payouts.yield_height, ybi_matured)) {
+    LOG_ERROR("Block at height: " << height << " - Failed to obtain yield block information - aborting");
+    return false;
+  } else if (ybi_matured.locked_coins_this_block == 0) {
+    LOG_PRINT_L1("Block at height: " << height << " - no yield payouts due - skipping");
+  } else if (m_hardfork->get_ideal_version(payouts.yield_height) >= HF_VERSION_CARROT) {
+    if (!calculate_yield_payouts(payouts.yield_height, payouts.carrot_yield)) {
+      LOG_ERROR("Block at height: " << height << " - Failed to obtain carrot yield payout information - aborting");
+      return false;
+    }
+  } else {
+    if (!calculate_yield_payouts(payouts.yield_height, payouts.yield)) {
+      LOG_ERROR("Block at height: " << height << " - Failed to obtain yield payout information - aborting");
+      return false;
+    }
+  }
+
+  // Get the audit data for the block that matures at this height
+  if (!get_matured_audit(height, payouts.audit_height, payouts.audit_asset_types))
+    return true;
+  cryptonote::audit_block_info abi_matured;
+  if (!get_abi_entry(payouts.audit_height, abi_matured)) {
+    LOG_PRINT_L1("Block at height: " << height << " - failed to obtain audit block information - aborting");
+    return false;
+  } else if (abi_matured.locked_coins_this_block == 0) {
+    LOG_PRINT_L1("Block at height: " << height << " - no audit payouts due - skipping");
+  } else if (!calculate_audit_payouts(payouts.audit_height, payouts.audit)) {
+    LOG_ERROR("Block at height: " << height << " - Failed to obtain audit payout information - aborting");
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------
+void Blockchain::precompute_next_payouts_async()
+{
+  if (m_next_payouts_pending.exchange(true))
+    return;
+  boost::asio::dispatch(m_async_service, [this]() {
+    m_next_payouts_pending = false;
+    // the txpool lock is held from prepare_handle_incoming_blocks until the
+    // batch is committed, so this never runs against a half-added block
+    CRITICAL_REGION_LOCAL(m_tx_pool);
+    CRITICAL_REGION_LOCAL1(m_blockchain_lock);
+    const uint64_t height = m_db->height();
+    const crypto::hash top_hash = m_db->top_block_hash();
+    if (height == m_next_payouts_height && top_hash == m_next_payouts_top_hash)
+      return;
+    matured_payouts payouts;
+    if (!compute_matured_payouts(height, payouts)) {
+      MDEBUG("Failed to precompute payouts for height " << height << ", they will be computed on demand");
+      return;
+    }
+    m_next_payouts = std::move(payouts);
+    m_next_payouts_height = height;
+    m_next_payouts_top_hash = top_hash;
+  });
+}
+//------------------------------------------------------------------
+void Blockchain::build_audit_maturity_index()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  m_audit_maturity_index.clear();
+  const std::vector<hardfork_t> &forks = m_hardfork->get_hardforks();
+  for (const auto &audit_hf : get_config(m_nettype).AUDIT_HARD_FORKS) {
+    const uint64_t lock_period = audit_hf.second.first;
+    for (size_t n = 0; n < forks.size(); ++n) {
+      // the heights from this fork to the next one have this fork's ideal version
+      if (m_hardfork->get_ideal_version(forks[n].height) != audit_hf.first)
+        continue;
+      const uint64_t end = n + 1 < forks.size() ? forks[n + 1].height + lock_period + 1 : std::numeric_limits<uint64_t>::max();
+      m_audit_maturity_index.push_back({forks[n].height + lock_period + 1, end, lock_period, audit_hf.second.second});
+    }
+  }
+}
+//------------------------------------------------------------------
+bool Blockchain::get_matured_audit(const uint64_t height, uint64_t& matured_audit_height, std::pair<std::string, std::string>& asset_types) const
+{
+  // the first matching audit fork wins, as AUDIT_HARD_FORKS is walked in order
+  for (const audit_maturity_range &range: m_audit_maturity_index) {
+    if (height >= range.begin && height < range.end) {
+      matured_audit_height = height - range.lock_period - 1;
+      asset_types = range.asset_types;
+      return true;
+    }
+  }
+  return false;
+}
+//------------------------------------------------------------------
+bool Blockchain::get_abi_entry(const uint64_t height, cryptonote::audit_block_info& abi)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  
+  // Clear the provided container
+  std::memset(&abi, 0, sizeof(struct cryptonote::audit_block_info));
+
+  int result = m_db->get_audit_block_info(height, abi);
+  if (result) {
+    // Request failed - report error and bail out
+    LOG_ERROR("failed to retrieve ABI entry for height " << height << " - aborting");
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::calculate_yield_payouts(const uint64_t start_height, std::vector<std::pair<yield_tx_info_carrot, uint64_t>>& yield_container)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  static tools::metrics::histogram &payout_time = tools::metrics::get_histogram("payout_calculation_seconds", "Time taken to compute protocol payouts", tools::metrics::label("kind", "yield"));
+  tools::metrics::scoped_timer payout_timer(payout_time);
+
+  // Clear the yield payout amounts
+  yield_container.clear();
+
+  // Get the YIELD TX information for matured staked coins
+  std::vector<cryptonote::yield_tx_info_carrot> yield_entries;
+  // We get the yield_tx_info from the block _before_ they started to accrue yield
+  int yield_tx_result = m_db->get_carrot_yield_tx_info(start_height, yield_entries);
+  if (!yield_entries.size()) {
+
+    // Report error and abort
     LOG_ERROR("calculate_yield_payouts() called for carrot, but no yield TXs found at height " << start_height << " - aborting");
     return false;
   }
@@ -4744,44 +5061,16 @@ bool Blockchain::calculate_yield_payouts(const uint64_t start_height, std::vecto
     yield_container.emplace_back(std::make_pair(entry, entry.locked_coins));
   }
   
-  // Iterate over the cached yield_block_info data
-  uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
-  for (uint64_t idx = start_height+1; idx <= start_height + yield_lock_period; ++idx) {
-    // Get the next block
-    if (m_yield_block_info_cache.count(idx) == 0) {
-      LOG_ERROR("failed to locate yield information for block height " << idx <<"  - aborting");
-      return false;
-    }
-    yield_block_info ybi = m_yield_block_info_cache[idx];
-    if (ybi.slippage_total_this_block == 0) continue;
-    if (ybi.locked_coins_tally == 0) continue;
-    
-    boost::multiprecision::int128_t slippage_128 = ybi.slippage_total_this_block;
-
-    // Get the total number of coins locked at this height
-    boost::multiprecision::int128_t locked_total_128 = ybi.locked_coins_tally;
-    
-    // Iterate over the yield_container, adding each proportion of the yield
-    for (auto& entry: yield_container) {
-      boost::multiprecision::int128_t locked_coins_128 = entry.first.locked_coins;
-      boost::multiprecision::int128_t yield_128 = (slippage_128 * locked_coins_128) / locked_total_128;
-      uint64_t yield_u64 = boost::numeric_cast<uint64_t>(yield_128);
-
-      if (entry.second + yield_u64 < entry.second) {
-        throw std::overflow_error("uint64_t addition overflow");
-      }
-      entry.second += yield_u64;
-    }
-  }
-  
-  // Return success to caller
-  return true;
+  // Accumulate the yield over the lock period for each of the matured stakes
+  return accrue_yield_payouts(start_height, yield_container);
 }
 //------------------------------------------------------------------
 //------------------------------------------------------------------
 bool Blockchain::calculate_yield_payouts(const uint64_t start_height, std::vector<std::pair<yield_tx_info, uint64_t>>& yield_container)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
+  static tools::metrics::histogram &payout_time = tools::metrics::get_histogram("payout_calculation_seconds", "Time taken to compute protocol payouts", tools::metrics::label("kind", "yield"));
+  tools::metrics::scoped_timer payout_timer(payout_time);
 
   // Clear the yield payout amounts
   yield_container.clear();
@@ -4810,28 +5099,49 @@ bool Blockchain::calculate_yield_payouts(const uint64_t start_height, std::vecto
     yield_container.emplace_back(std::make_pair(entry, entry.locked_coins));
   }
   
-  // Iterate over the cached yield_block_info data
+  // Accumulate the yield over the lock period for each of the matured stakes
+  return accrue_yield_payouts(start_height, yield_container);
+}
+//------------------------------------------------------------------
+template<typename T>
+bool Blockchain::accrue_yield_payouts(const uint64_t start_height, std::vector<std::pair<T, uint64_t>>& yield_container)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  // Make sure the whole lock period is covered by the cache
   uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
-  for (uint64_t idx = start_height+1; idx <= start_height + yield_lock_period; ++idx) {
-    // Get the next block
-    if (m_yield_block_info_cache.count(idx) == 0) {
-      LOG_ERROR("failed to locate yield information for block height " << idx <<"  - aborting");
+  const uint64_t first_height = start_height + 1;
+  const uint64_t last_height = start_height + yield_lock_period;
+  if (!m_yield_block_info_cache.contains(first_height) || !m_yield_block_info_cache.contains(last_height)) {
+    LOG_ERROR("failed to locate yield information for block heights " << first_height << " to " << last_height << " - aborting");
+    return false;
+  }
+
+  // Only the blocks that produced slippage (while coins were locked) contribute any yield, so
+  // iterate over the accrual index rather than every block in the lock period
+  const std::deque<uint64_t>& accrual_heights = m_yield_block_info_cache.get_accrual_heights();
+  auto it = std::lower_bound(accrual_heights.begin(), accrual_heights.end(), first_height);
+  for (; it != accrual_heights.end() && *it <= last_height; ++it) {
+    const yield_block_info* ybi = m_yield_block_info_cache.get(*it);
+    if (!ybi) {
+      LOG_ERROR("failed to locate yield information for block height " << *it << "  - aborting");
       return false;
     }
-    yield_block_info ybi = m_yield_block_info_cache[idx];
-    if (ybi.slippage_total_this_block == 0) continue;
-    if (ybi.locked_coins_tally == 0) continue;
-    
-    boost::multiprecision::int128_t slippage_128 = ybi.slippage_total_this_block;
+
+    const uint64_t slippage = ybi->slippage_total_this_block;
 
     // Get the total number of coins locked at this height
-    boost::multiprecision::int128_t locked_total_128 = ybi.locked_coins_tally;
-    
+    const uint64_t locked_total = ybi->locked_coins_tally;
+
+    // A zero divisor throws the same error the multiprecision division did
+    if (locked_total == 0)
+      throw std::overflow_error("Division by zero.");
+
     // Iterate over the yield_container, adding each proportion of the yield
+    // - this keeps the low 64 bits of an oversized quotient, as the numeric_cast from the
+    //   multiprecision int128_t it replaces did, so payouts are unchanged
     for (auto& entry: yield_container) {
-      boost::multiprecision::int128_t locked_coins_128 = entry.first.locked_coins;
-      boost::multiprecision::int128_t yield_128 = (slippage_128 * locked_coins_128) / locked_total_128;
-      uint64_t yield_u64 = boost::numeric_cast<uint64_t>(yield_128);
+      const uint64_t yield_u64 = mul_div64(slippage, entry.first.locked_coins, locked_total, NULL);
 
       if (entry.second + yield_u64 < entry.second) {
         throw std::overflow_error("uint64_t addition overflow");
@@ -4839,7 +5149,7 @@ bool Blockchain::calculate_yield_payouts(const uint64_t start_height, std::vecto
       entry.second += yield_u64;
     }
   }
-  
+
   // Return success to caller
   return true;
 }
@@ -4848,30 +5158,84 @@ bool Blockchain::rebuild_ybi_cache()
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   
-  // If we need to (re)build the cache, we need to pull the data from the blockchain directly
-
-  // Clear the existing cache
+  // Clear the existing cache, and page the lock period back in from the blockchain
   m_yield_block_info_cache.clear();
-  
-  // Get the size that the cache should be when fully populated (could be less than the lock period if the chain is young)
+  return sync_ybi_cache();
+}
+//------------------------------------------------------------------
+bool Blockchain::sync_ybi_cache()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
   uint64_t height = m_db->height();
   uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
-  uint64_t ybi_cache_expected_size = std::min(height, yield_lock_period+1);
+  const uint64_t capacity = yield_lock_period + 1 + YBI_CACHE_REORG_DEPTH;
+  if (m_yield_block_info_cache.capacity() != capacity)
+    m_yield_block_info_cache.reset(capacity);
+
+  // Drop any entries above the top of the chain
+  while (!m_yield_block_info_cache.empty() && m_yield_block_info_cache.end_height() > height)
+    m_yield_block_info_cache.pop_back();
 
-  // Now get this number of entries from the blockchain
-  for (uint64_t idx = height - ybi_cache_expected_size; idx < height; ++idx) {
+  // A gap wider than the cache can't be filled incrementally, so start afresh
+  if (!m_yield_block_info_cache.empty() && height - m_yield_block_info_cache.end_height() >= capacity)
+    m_yield_block_info_cache.clear();
+
+  // Get the lowest height that must be cached (could be less than the lock period if the chain is young)
+  uint64_t ybi_cache_expected_size = std::min(height, yield_lock_period + 1);
+  const uint64_t window_start = height - ybi_cache_expected_size;
+  if (ybi_cache_expected_size == 0)
+    return true;
 
-    // Get the specified YBI entry
-    yield_block_info ybi;
-    int result = m_db->get_yield_block_info(idx, ybi);
-    if (result) {
-      // Request failed - report error and bail out
-      LOG_ERROR("failed to retrieve YBI entry for height " << idx << " - aborting");
+  std::vector<yield_block_info> ybis;
+  if (m_yield_block_info_cache.empty()) {
+    // Nothing cached - page in the whole lock period
+    if (m_db->get_yield_block_infos(window_start, height, ybis)) {
+      LOG_ERROR("failed to retrieve YBI entries for heights " << window_start << " to " << (height - 1) << " - aborting");
       return false;
     }
+    for (const yield_block_info& ybi: ybis) {
+      if (!m_yield_block_info_cache.push_back(ybi)) {
+        LOG_ERROR("YBI entry has unexpected height " << ybi.block_height << " - aborting");
+        m_yield_block_info_cache.clear();
+        return false;
+      }
+    }
+    return true;
+  }
 
-    // Store in the map
-    m_yield_block_info_cache[idx] = ybi;
+  // Append whatever is missing at the top of the chain
+  if (m_yield_block_info_cache.end_height() < height) {
+    const uint64_t from_height = m_yield_block_info_cache.end_height();
+    if (m_db->get_yield_block_infos(from_height, height, ybis)) {
+      LOG_ERROR("failed to retrieve YBI entries for heights " << from_height << " to " << (height - 1) << " - aborting");
+      m_yield_block_info_cache.clear();
+      return false;
+    }
+    for (const yield_block_info& ybi: ybis) {
+      if (!m_yield_block_info_cache.push_back(ybi)) {
+        LOG_ERROR("YBI entry has unexpected height " << ybi.block_height << " - aborting");
+        m_yield_block_info_cache.clear();
+        return false;
+      }
+    }
+  }
+
+  // Prepend whatever is missing at the bottom of the lock period (after pops, or a partial cache)
+  if (m_yield_block_info_cache.start_height() > window_start) {
+    const uint64_t to_height = m_yield_block_info_cache.start_height();
+    if (m_db->get_yield_block_infos(window_start, to_height, ybis)) {
+      LOG_ERROR("failed to retrieve YBI entries for heights " << window_start << " to " << (to_height - 1) << " - aborting");
+      m_yield_block_info_cache.clear();
+      return false;
+    }
+    for (auto it = ybis.rbegin(); it != ybis.rend(); ++it) {
+      if (!m_yield_block_info_cache.push_front(*it)) {
+        LOG_ERROR("YBI entry has unexpected height " << it->block_height << " - aborting");
+        m_yield_block_info_cache.clear();
+        return false;
+      }
+    }
   }
 
   // Return success to caller
@@ -4881,51 +5245,151 @@ bool Blockchain::rebuild_ybi_cache()
 bool Blockchain::validate_ybi_cache()
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
   
   // Get the size that the cache should be if fully populated
   uint64_t height = m_db->height();
   uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
   uint64_t ybi_cache_expected_size = std::min(height, yield_lock_period + 1);
-  if (m_yield_block_info_cache.size() != ybi_cache_expected_size) {
+  if (m_yield_block_info_cache.size() < ybi_cache_expected_size) {
     // It's not the right size - report error and bail out
-    LOG_ERROR("YBI cache is incorrect size - should be " << ybi_cache_expected_size << ", but found " << m_yield_block_info_cache.size() << " - aborting");
+    LOG_ERROR("YBI cache is incorrect size - should be at least " << ybi_cache_expected_size << ", but found " << m_yield_block_info_cache.size() << " - aborting");
     return false;
   }
+  if (ybi_cache_expected_size == 0)
+    return true;
     
   // It's the right size - check we have the correct limits
-  if (m_yield_block_info_cache.count(height - 1) == 0) {
+  if (m_yield_block_info_cache.end_height() != height) {
     // Missing the latest block - report error and bail out
     LOG_ERROR("Failed to locate YBI entry for height " << (height - 1) << " - aborting");
     return false;
   }
   
-  if (m_yield_block_info_cache.count(height - ybi_cache_expected_size) == 0) {
+  if (!m_yield_block_info_cache.contains(height - ybi_cache_expected_size)) {
     // Missing the latest block - report error and bail out
     LOG_ERROR("Failed to locate YBI entry for height " << (height - ybi_cache_expected_size) << " - aborting");
     return false;
   }
 
+  // Compare every cached entry with the blockchain
+  const uint64_t start_height = m_yield_block_info_cache.start_height();
+  std::vector<yield_block_info> ybis;
+  if (m_db->get_yield_block_infos(start_height, height, ybis)) {
+    LOG_ERROR("failed to retrieve YBI entries for heights " << start_height << " to " << (height - 1) << " - aborting");
+    return false;
+  }
+  const epee::span<const yield_block_info> cached = m_yield_block_info_cache.get_range(start_height, height);
+  for (size_t i = 0; i < ybis.size(); ++i) {
+    const yield_block_info& a = cached[i];
+    const yield_block_info& b = ybis[i];
+    if (a.block_height != b.block_height ||
+        a.slippage_total_this_block != b.slippage_total_this_block ||
+        a.locked_coins_this_block != b.locked_coins_this_block ||
+        a.locked_coins_tally != b.locked_coins_tally ||
+        a.network_health_percentage != b.network_health_percentage) {
+      LOG_ERROR("YBI cache entry for height " << b.block_height << " does not match the blockchain - aborting");
+      return false;
+    }
+  }
+
   return true;
 }
 //------------------------------------------------------------------
-bool Blockchain::get_ybi_cache(std::map<uint64_t, yield_block_info>& ybi_cache)
+void Blockchain::check_ybi_cache_async()
+{
+  boost::asio::dispatch(m_async_service, [this]() {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    if (!sync_ybi_cache() || !validate_ybi_cache()) {
+      MWARNING("yield information cache is inconsistent with the blockchain - rebuilding cache");
+      if (!rebuild_ybi_cache())
+        LOG_ERROR("Failed to rebuild yield information cache");
+    } else {
+      MINFO("yield information cache is consistent with the blockchain");
+    }
+  });
+}
+//------------------------------------------------------------------
+void Blockchain::validate_txpool_async()
+{
+  m_txpool_validated = false;
+  boost::asio::dispatch(m_async_service, [this]() {
+    // the pool takes its own lock before ours, so don't hold m_blockchain_lock here
+    const size_t n_removed = m_tx_pool.validate(get_current_hard_fork_version());
+    MGINFO("txpool re-validated, " << n_removed << " transactions dropped");
+    m_txpool_validated = true;
+  });
+}
+//------------------------------------------------------------------
+bool Blockchain::refresh_from_db()
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_tx_pool);
+  CRITICAL_REGION_LOCAL1(m_blockchain_lock);
+
+  db_rtxn_guard rtxn_guard(m_db);
+  uint64_t top_height;
+  const crypto::hash top_hash = m_db->top_block_hash(&top_height);
+  if (top_hash == m_db_refresh_tip_hash)
+    return false;
+
+  // if the block we last saw as the tip is still in place, the db only grew
+  const bool extended = top_height > m_db_refresh_height
+    && m_db->get_block_hash_from_height(m_db_refresh_height) == m_db_refresh_tip_hash;
+  MINFO("Database top moved to " << top_hash << " at height " << top_height << (extended ? "" : " (reorg)"));
+
+  if (extended)
+  {
+    m_hardfork->on_blocks_added(top_height - m_db_refresh_height);
+    if (!sync_ybi_cache())
+      rebuild_ybi_cache();
+  }
+  else
+  {
+    m_hardfork->init();
+    m_difficulty_window.reset(0);
+    m_long_term_block_weights_cache_tip_hash = crypto::null_hash;
+    m_block_height_index.clear();
+    {
+      CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+      m_output_distribution_cache.clear();
+    }
+    rebuild_ybi_cache();
+  }
+
+  update_next_cumulative_weight_limit();
+
+  const crypto::hash seedhash = get_block_id_by_height(crypto::rx_seedheight(m_db->height()));
+  if (seedhash != crypto::null_hash)
+    rx_set_main_seedhash(seedhash.data, tools::get_max_concurrency());
+
+  m_db_refresh_tip_hash = top_hash;
+  m_db_refresh_height = top_height;
+  m_alt_block_index_valid = false;
+  invalidate_block_template_cache();
+  precompute_next_payouts_async();
+  return true;
+}
+//------------------------------------------------------------------
+bool Blockchain::get_ybi_cache(epee::span<const yield_block_info>& ybi_cache)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
   
   // Clear the provided container
-  ybi_cache.clear();
+  ybi_cache = {};
   
   // Make sure the cache is fully populated and up to date
-  if (!validate_ybi_cache()) {
-    LOG_PRINT_L1("yield information cache is invalid - rebuilding cache");
-    if (!rebuild_ybi_cache()) {
-      LOG_ERROR("Failed to rebuild yield information cache - aborting");
-      return false;
-    }
+  if (!sync_ybi_cache()) {
+    LOG_ERROR("Failed to update yield information cache - aborting");
+    return false;
   }
 
-  // Copy the cache
-  ybi_cache = m_yield_block_info_cache;
+  // Hand out the lock period window of the cache
+  uint64_t height = m_db->height();
+  uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
+  uint64_t ybi_cache_expected_size = std::min(height, yield_lock_period + 1);
+  ybi_cache = m_yield_block_info_cache.get_range(height - ybi_cache_expected_size, height);
   return true;
 }
 //------------------------------------------------------------------
@@ -4937,22 +5401,20 @@ bool Blockchain::get_ybi_entry(const uint64_t height, cryptonote::yield_block_in
   std::memset(&ybi, 0, sizeof(struct cryptonote::yield_block_info));
   
   // Make sure the cache is fully populated and up to date
-  if (!validate_ybi_cache()) {
-    LOG_PRINT_L1("yield information cache is invalid - rebuilding cache");
-    if (!rebuild_ybi_cache()) {
-      LOG_ERROR("Failed to rebuild yield information cache - aborting");
-      return false;
-    }
+  if (!sync_ybi_cache()) {
+    LOG_ERROR("Failed to update yield information cache - aborting");
+    return false;
   }
 
   // Check to see if the height is in the cache
-  if (m_yield_block_info_cache.count(height) == 0) {
+  const yield_block_info* entry = m_yield_block_info_cache.get(height);
+  if (!entry) {
     LOG_ERROR("Failed to locate yield block info for height " << height << " - aborting");
     return false;
   }
 
   // Copy the specified entry
-  ybi = m_yield_block_info_cache[height];
+  ybi = *entry;
   return true;
 }
 //------------------------------------------------------------------
@@ -5055,9 +5517,10 @@ bool Blockchain::flush_txes_from_pool(const std::vector<crypto::hash> &txids)
 //      m_db->add_block()
 bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc, bool notify/* = true*/)
 {
+  TRACE_SPAN("block_to_main_chain");
   LOG_PRINT_L3("Blockchain::" << __func__);
 
-  TIME_MEASURE_START(block_processing_time);
+  TIME_MEASURE_NS_START(block_processing_time);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   TIME_MEASURE_START(t1);
 
@@ -5110,7 +5573,7 @@ leave:
 
   TIME_MEASURE_FINISH(t2);
   //check proof of work
-  TIME_MEASURE_START(target_calculating_time);
+  TIME_MEASURE_NS_START(target_calculating_time);
 
   // get the target difficulty for the block.
   // the calculation can overflow, among other failure cases,
@@ -5120,9 +5583,9 @@ leave:
   difficulty_type current_diffic = get_difficulty_for_next_block();
   CHECK_AND_ASSERT_MES(current_diffic, false, "!!!!!!!!! difficulty overhead !!!!!!!!!");
 
-  TIME_MEASURE_FINISH(target_calculating_time);
+  TIME_MEASURE_NS_FINISH(target_calculating_time);
 
-  TIME_MEASURE_START(longhash_calculating_time);
+  TIME_MEASURE_NS_START(longhash_calculating_time);
 
   crypto::hash proof_of_work;
   memset(proof_of_work.data, 0xff, sizeof(proof_of_work.data));
@@ -5191,9 +5654,9 @@ leave:
     }
   }
 
-  TIME_MEASURE_FINISH(longhash_calculating_time);
+  TIME_MEASURE_NS_FINISH(longhash_calculating_time);
   if (precomputed)
-    longhash_calculating_time += m_fake_pow_calc_time;
+    longhash_calculating_time += m_fake_pow_calc_time * 1000000;
 
   TIME_MEASURE_START(t3);
 
@@ -5220,7 +5683,7 @@ leave:
   key_images_container keys;
 
   uint64_t fee_summary = 0;
-  uint64_t t_checktx = 0;
+  uint64_t t_checktx = 0; // ns
   uint64_t t_exists = 0;
   uint64_t t_pool = 0;
   uint64_t t_dblspnd = 0;
@@ -5230,6 +5693,11 @@ leave:
 // XXX old code adds miner tx here
 
   size_t tx_index = 0;
+  // With several txs, their ring signatures are verified on the threadpool
+  // while the next tx's inputs are looked up. txs must not reallocate and
+  // must not be handed back to the pool until the verification is waited on.
+  deferred_rct_verification deferred(tools::threadpool::getInstanceForCompute());
+  deferred_rct_verification *pdeferred = bl.tx_hashes.size() > 1 ? &deferred : NULL;
   // Iterate over the block's transaction hashes, grabbing each
   // from the tx_pool and validating them.  Each is then added
   // to txs.  Keys spent in each are added to <keys> by the double spend check.
@@ -5248,6 +5716,7 @@ leave:
     {
       MERROR("Block with id: " << id << " attempting to add transaction already in blockchain with id: " << tx_id);
       bvc.m_verifivation_failed = true;
+      deferred.waiter.wait();
       return_tx_to_pool(txs);
       goto leave;
     }
@@ -5261,6 +5730,7 @@ leave:
     {
       MERROR_VER("Block with id: " << id  << " has at least one unknown transaction with id: " << tx_id);
       bvc.m_verifivation_failed = true;
+      deferred.waiter.wait();
       return_tx_to_pool(txs);
       goto leave;
     }
@@ -5291,7 +5761,7 @@ leave:
 
     TIME_MEASURE_FINISH(dd);
     t_dblspnd += dd;
-    TIME_MEASURE_START(cc);
+    TIME_MEASURE_NS_START(cc);
 
 #if defined(PER_BLOCK_CHECKPOINT)
     if (!fast_check)
@@ -5299,7 +5769,7 @@ leave:
     {
       // validate that transaction inputs and the keys spending them are correct.
       tx_verification_context tvc;
-      if(!check_tx_inputs(tx, tvc))
+      if(!check_tx_inputs(tx, tvc, NULL, pdeferred))
       {
         MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with wrong inputs.");
 
@@ -5309,6 +5779,7 @@ leave:
         MERROR_VER("tx_index " << tx_index << ", m_blocks_txs_check " << m_blocks_txs_check.size() << ":");
         for (const auto &h: m_blocks_txs_check) MERROR_VER("  " << h);
         bvc.m_verifivation_failed = true;
+        deferred.waiter.wait();
         return_tx_to_pool(txs);
         goto leave;
       }
@@ -5325,17 +5796,30 @@ leave:
         add_block_as_invalid(bl, id);
         MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
         bvc.m_verifivation_failed = true;
+        deferred.waiter.wait();
         return_tx_to_pool(txs);
         goto leave;
       }
     }
 #endif
-    TIME_MEASURE_FINISH(cc);
+    TIME_MEASURE_NS_FINISH(cc);
     t_checktx += cc;
     fee_summary += fee;
     cumulative_block_weight += tx_weight;
   }
 
+  TIME_MEASURE_NS_START(dv);
+  if (!deferred.waiter.wait() || deferred.failed)
+  {
+    MERROR_VER("Block with id: " << id << " has at least one transaction with invalid ring signatures.");
+    add_block_as_invalid(bl, id);
+    MERROR_VER("Block with id " << id << " added as invalid because of wrong inputs in transactions");
+    bvc.m_verifivation_failed = true;
+    return_tx_to_pool(txs);
+    goto leave;
+  }
+  TIME_MEASURE_NS_FINISH(dv);
+
   // if we were syncing pruned blocks
   if (n_pruned > 0)
   {
@@ -5349,7 +5833,7 @@ leave:
 
   m_blocks_txs_check.clear();
 
-  TIME_MEASURE_START(vmt);
+  TIME_MEASURE_NS_START(vmt);
   uint64_t base_reward = 0;
   uint64_t already_generated_coins = blockchain_height ? m_db->get_block_already_generated_coins(blockchain_height - 1) : 0;
   if(!validate_miner_transaction(bl, cumulative_block_weight, fee_summary, base_reward, already_generated_coins, bvc.m_partial_block_reward, m_hardfork->get_current_version()))
@@ -5359,17 +5843,18 @@ leave:
     return_tx_to_pool(txs);
     goto leave;
   }
-  TIME_MEASURE_FINISH(vmt);
+  TIME_MEASURE_NS_FINISH(vmt);
 
-  TIME_MEASURE_START(vpt);
-  if(!validate_protocol_transaction(bl, blockchain_height, m_hardfork->get_current_version()))
+  TIME_MEASURE_NS_START(vpt);
+  uint64_t payouts_us = 0;
+  if(!validate_protocol_transaction(bl, blockchain_height, m_hardfork->get_current_version(), &payouts_us))
   {
     MERROR_VER("Block with id: " << id << " has incorrect protocol transaction");
     bvc.m_verifivation_failed = true;
     return_tx_to_pool(txs);
     goto leave;
   }
-  TIME_MEASURE_FINISH(vpt);
+  TIME_MEASURE_NS_FINISH(vpt);
 
   size_t block_weight;
   difficulty_type cumulative_difficulty;
@@ -5385,12 +5870,13 @@ leave:
   if(blockchain_height)
     cumulative_difficulty += m_db->get_block_cumulative_difficulty(blockchain_height - 1);
 
-  TIME_MEASURE_FINISH(block_processing_time);
+  TIME_MEASURE_NS_FINISH(block_processing_time);
   if(precomputed)
-    block_processing_time += m_fake_pow_calc_time;
+    block_processing_time += m_fake_pow_calc_time * 1000000;
 
   rtxn_guard.stop();
-  TIME_MEASURE_START(addblock);
+  TIME_MEASURE_NS_START(addblock);
+  uint64_t ybi_time = 0;
   uint64_t new_height = 0;
   if (!bvc.m_verifivation_failed)
   {
@@ -5405,14 +5891,17 @@ leave:
       new_height = m_db->add_block(std::make_pair(std::move(bl), std::move(bd)), block_weight, long_term_block_weight, cumulative_difficulty, already_generated_coins, txs, m_nettype, new_ybi, new_abi);
 
       // Update the YBI cache data
-      uint64_t yield_lock_period = cryptonote::get_config(m_nettype).STAKE_LOCK_PERIOD;
-      uint64_t ybi_cache_expected_size = std::min(new_height, yield_lock_period);
-      if (new_height > yield_lock_period) {
-        if (m_yield_block_info_cache.count(new_height - yield_lock_period - 2) != 0) {
-          m_yield_block_info_cache.erase(new_height - yield_lock_period - 2);
-        }
-      }
-      m_yield_block_info_cache[new_ybi.block_height] = new_ybi;
+      // - the oldest entry is evicted once the cache is full, and a gap forces a rebuild on next use
+      ybi_time = epee::misc_utils::get_ns_count();
+      if (!m_yield_block_info_cache.push_back(new_ybi))
+        m_yield_block_info_cache.clear();
+      ybi_time = epee::misc_utils::get_ns_count() - ybi_time;
+
+      // Extend the block height index only if it is already built and in step with the db
+      if (m_block_height_index.end_height() + 1 == new_height)
+        m_block_height_index.push_back(id);
+      else
+        m_block_height_index.clear();
     }
     catch (const KEY_IMAGE_EXISTS& e)
     {
@@ -5437,7 +5926,8 @@ leave:
     LOG_ERROR("Blocks that failed verification should not reach here");
   }
 
-  TIME_MEASURE_FINISH(addblock);
+  TIME_MEASURE_NS_FINISH(addblock);
+  addblock -= ybi_time;
 
   // do this after updating the hard fork state since the weight limit may change due to fork
   if (!update_next_cumulative_weight_limit())
@@ -5447,16 +5937,63 @@ leave:
     return false;
   }
 
-  MINFO("+++++ BLOCK SUCCESSFULLY ADDED" << std::endl << "id:\t" << id << std::endl << "PoW:\t" << proof_of_work << std::endl << "HEIGHT " << new_height-1 << ", difficulty:\t" << current_diffic << std::endl << "block reward: " << print_money(fee_summary + base_reward - bl.miner_tx.amount_burnt) << "(" << print_money(base_reward - bl.miner_tx.amount_burnt) << " reward + " << print_money(fee_summary) << " fees), coinbase_weight: " << coinbase_weight << ", cumulative weight: " << cumulative_block_weight << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms");
+  block_processing_stats &stats = bvc.m_stats;
+  stats.height = new_height - 1;
+  stats.id = id;
+  stats.timestamp = bl.timestamp;
+  stats.n_txs = txs.size();
+  stats.difficulty_us = target_calculating_time / 1000;
+  stats.pow_us = longhash_calculating_time / 1000;
+  stats.tx_inputs_us = t_checktx / 1000;
+  stats.rct_batch_us = dv / 1000;
+  stats.miner_tx_us = vmt / 1000;
+  stats.protocol_tx_us = vpt / 1000;
+  stats.payouts_us = payouts_us;
+  stats.db_add_us = addblock / 1000;
+  stats.ybi_us = ybi_time / 1000;
+  stats.total_us = (block_processing_time + addblock + ybi_time) / 1000;
+
+  MINFO("+++++ BLOCK SUCCESSFULLY ADDED" << std::endl << "id:\t" << id << std::endl << "PoW:\t" << proof_of_work << std::endl << "HEIGHT " << new_height-1 << ", difficulty:\t" << current_diffic << std::endl << "block reward: " << print_money(fee_summary + base_reward - bl.miner_tx.amount_burnt) << "(" << print_money(base_reward - bl.miner_tx.amount_burnt) << " reward + " << print_money(fee_summary) << " fees), coinbase_weight: " << coinbase_weight << ", cumulative weight: " << cumulative_block_weight << ", " << block_processing_time / 1000000 << "(" << target_calculating_time / 1000000 << "/" << longhash_calculating_time / 1000000 << ")ms");
   if(m_show_time_stats)
   {
     MINFO("Height: " << new_height << " coinbase weight: " << coinbase_weight << " cumm: "
-        << cumulative_block_weight << " p/t: " << block_processing_time << " ("
-        << target_calculating_time << "/" << longhash_calculating_time << "/"
+        << cumulative_block_weight << " p/t: " << block_processing_time / 1000000 << " ("
+        << target_calculating_time / 1000000 << "/" << longhash_calculating_time / 1000000 << "/"
         << t1 << "/" << t2 << "/" << t3 << "/" << t_exists << "/" << t_pool
-        << "/" << t_checktx << "/" << t_dblspnd << "/" << vmt << "/" << addblock << ")ms");
+        << "/" << (t_checktx + dv) / 1000000 << "/" << t_dblspnd << "/" << vmt / 1000000 << "/" << (addblock + ybi_time) / 1000000 << ")ms");
+    MINFO("Height: " << stats.height << " us: pow " << stats.pow_us << ", inputs " << stats.tx_inputs_us
+        << ", rct batch " << stats.rct_batch_us << ", miner tx " << stats.miner_tx_us << ", protocol tx "
+        << stats.protocol_tx_us << " (payouts " << stats.payouts_us << "), db " << stats.db_add_us
+        << ", ybi " << stats.ybi_us << ", total " << stats.total_us);
   }
 
+  {
+    static const auto stage_time = [](const char *stage) -> tools::metrics::histogram& {
+      return tools::metrics::get_histogram("block_verification_seconds", "Time taken by each stage of adding a block to the main chain", tools::metrics::label("stage", stage));
+    };
+    static tools::metrics::histogram &difficulty_time = stage_time("difficulty");
+    static tools::metrics::histogram &pow_time = stage_time("pow");
+    static tools::metrics::histogram &txs_time = stage_time("txs");
+    static tools::metrics::histogram &miner_tx_time = stage_time("miner_tx");
+    static tools::metrics::histogram &protocol_tx_time = stage_time("protocol_tx");
+    static tools::metrics::histogram &db_time = stage_time("db_add");
+    static tools::metrics::histogram &total_time = stage_time("total");
+    difficulty_time.observe(std::chrono::microseconds{stats.difficulty_us});
+    pow_time.observe(std::chrono::microseconds{stats.pow_us});
+    txs_time.observe(std::chrono::microseconds{stats.tx_inputs_us + stats.rct_batch_us});
+    miner_tx_time.observe(std::chrono::microseconds{stats.miner_tx_us});
+    protocol_tx_time.observe(std::chrono::microseconds{stats.protocol_tx_us});
+    db_time.observe(std::chrono::microseconds{stats.db_add_us + stats.ybi_us});
+    total_time.observe(std::chrono::microseconds{stats.total_us});
+  }
+
+  {
+    const boost::lock_guard<boost::mutex> lock{m_block_stats_lock};
+    m_block_stats.push_back(stats);
+  }
+  for (const auto& notifier: m_block_stats_notifiers)
+    notifier(stats);
+
   bvc.m_added_to_main_chain = true;
   ++m_sync_counter;
 
@@ -5481,14 +6018,56 @@ leave:
   const crypto::hash seedhash = get_block_id_by_height(crypto::rx_seedheight(new_height));
   send_miner_notifications(new_height, seedhash, id, already_generated_coins);
 
+  m_notify_dispatcher.on_block(new_height - 1, id);
   for (const auto& notifier: m_block_notifiers)
     notifier(new_height - 1, {std::addressof(bl), 1});
 
   rx_set_main_seedhash(seedhash.data, tools::get_max_concurrency());
 
+  // Within SEEDHASH_EPOCH_LAG of an epoch switch the next seed block is already
+  // known, so build its cache in the background before blocks start needing it
+  uint64_t seed_height, next_seed_height;
+  crypto::rx_seedheights(new_height, &seed_height, &next_seed_height);
+  if (next_seed_height != seed_height)
+  {
+    const crypto::hash next_seedhash = get_block_id_by_height(next_seed_height);
+    if (next_seedhash != crypto::null_hash)
+      rx_set_next_seedhash(next_seedhash.data, tools::get_max_concurrency());
+  }
+
+  // Fetch the pricing record for the next block template in the background
+  if (m_pricing_record_prefetch && !m_offline && new_hf_version >= HF_VERSION_ENABLE_ORACLE)
+    m_pricing_record_cache.prefetch(new_height, m_db->get_circulating_supply());
+
   return true;
 }
 //------------------------------------------------------------------
+Blockchain::read_snapshot::read_snapshot(const Blockchain &blockchain, bool lock_blockchain):
+  m_blockchain(blockchain),
+  m_locked(lock_blockchain)
+{
+  // lock before opening the read txn, the same order as the writer
+  if (m_locked)
+    m_blockchain.m_blockchain_lock.lock();
+  try
+  {
+    m_rtxn_guard.reset(new db_rtxn_guard(m_blockchain.m_db));
+  }
+  catch (...)
+  {
+    if (m_locked)
+      m_blockchain.m_blockchain_lock.unlock();
+    throw;
+  }
+}
+//------------------------------------------------------------------
+Blockchain::read_snapshot::~read_snapshot()
+{
+  m_rtxn_guard.reset();
+  if (m_locked)
+    m_blockchain.m_blockchain_lock.unlock();
+}
+//------------------------------------------------------------------
 bool Blockchain::prune_blockchain(uint32_t pruning_seed)
 {
   m_tx_pool.lock();
@@ -5516,6 +6095,95 @@ bool Blockchain::check_blockchain_pruning()
   return m_db->check_pruning();
 }
 //------------------------------------------------------------------
+bool Blockchain::prune_blockchain_step(size_t max_records, uint32_t pruning_seed)
+{
+  // the locks are only held for one step, so the node keeps syncing and serving in between
+  m_tx_pool.lock();
+  epee::misc_utils::auto_scope_leave_caller unlocker = epee::misc_utils::create_scope_leave_handler([&](){m_tx_pool.unlock();});
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  return m_db->prune_blockchain_step(max_records, pruning_seed);
+}
+//------------------------------------------------------------------
+bool Blockchain::verify_history_step(uint64_t &height, size_t max_blocks, std::string &error) const
+{
+  // only a read txn, the blockchain lock would stall syncing for the whole step
+  db_rtxn_guard rtxn_guard(m_db);
+
+  const uint64_t top = m_db->height();
+  for (size_t n = 0; n < max_blocks && height < top; ++n, ++height)
+  {
+    const crypto::hash id = m_db->get_block_hash_from_height(height);
+    const block b = m_db->get_block_from_height(height);
+    if (get_block_hash(b) != id)
+    {
+      error = "block does not hash to its id " + epee::string_tools::pod_to_hex(id);
+      return false;
+    }
+    const crypto::hash parent = height ? m_db->get_block_hash_from_height(height - 1) : crypto::null_hash;
+    if (b.prev_id != parent)
+    {
+      error = "block " + epee::string_tools::pod_to_hex(id) + " does not link to its parent";
+      return false;
+    }
+    if (!m_checkpoints.check_block(height, id))
+    {
+      error = "block " + epee::string_tools::pod_to_hex(id) + " does not match its checkpoint";
+      return false;
+    }
+
+    // the genesis block has no proof of work
+    if (height > 0)
+    {
+      const difficulty_type difficulty = m_db->get_block_difficulty(height);
+      const crypto::hash pow = get_block_longhash(this, b, height, 0);
+      if (!check_hash(pow, difficulty))
+      {
+        error = "block " + epee::string_tools::pod_to_hex(id) + " does not have enough proof of work for difficulty " + difficulty.str();
+        return false;
+      }
+    }
+
+    // the block id commits to the tx ids, which must commit to what is stored
+    for (const crypto::hash &tx_id: b.tx_hashes)
+    {
+      transaction tx;
+      if (!m_db->get_pruned_tx(tx_id, tx))
+      {
+        error = "transaction " + epee::string_tools::pod_to_hex(tx_id) + " is missing";
+        return false;
+      }
+      crypto::hash hash = crypto::null_hash;
+      if (tx.version == 1)
+      {
+        cryptonote::blobdata blob;
+        if (m_db->get_tx_blob(tx_id, blob))
+          hash = get_blob_hash(blob);
+      }
+      else
+      {
+        crypto::hash prunable_hash;
+        if (m_db->get_prunable_tx_hash(tx_id, prunable_hash))
+          hash = get_pruned_transaction_hash(tx, prunable_hash);
+      }
+      if (hash != tx_id)
+      {
+        error = "transaction " + epee::string_tools::pod_to_hex(tx_id) + " does not hash to its id";
+        return false;
+      }
+      for (const txin_v &in: tx.vin)
+      {
+        if (in.type() == typeid(txin_to_key) && !m_db->has_key_image(boost::get<txin_to_key>(in).k_image))
+        {
+          error = "key image " + epee::string_tools::pod_to_hex(boost::get<txin_to_key>(in).k_image) + " of transaction " + epee::string_tools::pod_to_hex(tx_id) + " is not marked spent";
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------
 // returns min(Mb, 1.7*Ml) as per https://github.com/ArticMine/Monero-Documents/blob/master/MoneroScaling2021-02.pdf from HF_VERSION_LONG_TERM_BLOCK_WEIGHT
 uint64_t Blockchain::get_next_long_term_block_weight(uint64_t block_weight) const
 {
@@ -5644,7 +6312,10 @@ bool Blockchain::add_new_block(const block& bl, block_verification_context& bvc)
   }
 
   rtxn_guard.stop();
-  return handle_block_to_main_chain(bl, id, bvc);
+  const bool r = handle_block_to_main_chain(bl, id, bvc);
+  if (r && bvc.m_added_to_main_chain)
+    prune_stale_alt_chains();
+  return r;
 
   }
   catch (const std::exception &e)
@@ -5695,7 +6366,7 @@ void Blockchain::check_against_checkpoints(const checkpoints& points, bool enfor
 // returns false if any of the checkpoints loading returns false.
 // That should happen only if a checkpoint is added that conflicts
 // with an existing checkpoint.
-bool Blockchain::update_checkpoints(const std::string& file_path, bool check_dns)
+bool Blockchain::update_checkpoints(const std::string& file_path, const std::vector<std::string> *dns_records)
 {
   if (!m_checkpoints.load_checkpoints_from_json(file_path))
   {
@@ -5704,17 +6375,17 @@ bool Blockchain::update_checkpoints(const std::string& file_path, bool check_dns
 
   // if we're checking both dns and json, load checkpoints from dns.
   // if we're not hard-enforcing dns checkpoints, handle accordingly
-  if (m_enforce_dns_checkpoints && check_dns && !m_offline)
+  if (m_enforce_dns_checkpoints && dns_records && !m_offline)
   {
-    if (!m_checkpoints.load_checkpoints_from_dns())
+    if (!m_checkpoints.load_checkpoints_from_dns_records(*dns_records))
     {
       return false;
     }
   }
-  else if (check_dns && !m_offline)
+  else if (dns_records && !m_offline)
   {
     checkpoints dns_points;
-    dns_points.load_checkpoints_from_dns();
+    dns_points.load_checkpoints_from_dns_records(*dns_records);
     if (m_checkpoints.check_for_conflicts(dns_points))
     {
       check_against_checkpoints(dns_points, false);
@@ -5768,14 +6439,15 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
     if (m_batch_success)
     {
       m_db->batch_stop();
-      if (m_reset_timestamps_and_difficulties_height)
-      {
-        m_timestamps_and_difficulties_height = 0;
-        m_reset_timestamps_and_difficulties_height = false;
-      }
+      // only now can another thread's read txn see the new blocks
+      precompute_next_payouts_async();
     }
     else
+    {
+      // the window may have read blocks the abort just discarded
+      m_difficulty_window.reset(0);
       m_db->batch_abort();
+    }
     success = true;
   }
   catch (const std::exception &e)
@@ -5838,6 +6510,13 @@ void Blockchain::output_scan_worker(const uint64_t amount, const std::vector<uin
   try
   {
     m_db->get_output_key(epee::span<const uint64_t>(&amount, 1), offsets, outputs, true);
+
+    // these outputs are the ring members of the incoming txes, decompress them for the ring signature checks
+    rct::ctkeyV members;
+    members.reserve(outputs.size());
+    for (const output_data_t &od : outputs)
+      members.push_back({rct::pk2rct(od.pubkey), od.commitment});
+    rct::cache_ring_member_points(members);
   }
   catch (const std::exception& e)
   {
@@ -5893,11 +6572,15 @@ uint64_t Blockchain::prevalidate_block_hashes(uint64_t height, const std::vector
   else
   {
     // we might need some already in the chain for the first part of the first hash
-    for (uint64_t h = first_index * HASH_OF_HASHES_STEP; h < height; ++h)
+    const uint64_t chain_start = first_index * HASH_OF_HASHES_STEP;
+    if (chain_start < height)
     {
-      data_hashes.push_back(m_db->get_block_hash_from_height(h));
+      data_hashes = m_db->get_hashes_range(chain_start, height - 1);
+      if (!weights.empty())
+        data_weights = m_db->get_block_weights(chain_start, height - chain_start);
+      data_hashes.reserve(hashes.size() + HASH_OF_HASHES_STEP - 1);
       if (!weights.empty())
-        data_weights.push_back(m_db->get_block_weight(h));
+        data_weights.reserve(data_hashes.capacity());
     }
     pop = 0;
   }
@@ -5915,24 +6598,35 @@ uint64_t Blockchain::prevalidate_block_hashes(uint64_t height, const std::vector
     }
   }
 
-  // hash and check
+  // hash every complete span within the precomputed area up front, the
+  // spans are independent so a large batch is split across the pool
+  size_t n_spans = 0;
+  if (first_index < m_blocks_hash_of_hashes.size())
+    n_spans = std::min<size_t>(std::min<size_t>(last_index + 1, m_blocks_hash_of_hashes.size()) - first_index, data_hashes.size() / HASH_OF_HASHES_STEP);
+  std::vector<std::pair<crypto::hash, crypto::hash>> span_hashes(n_spans);
+  auto hash_span = [&](size_t i) {
+    cn_fast_hash(data_hashes.data() + i * HASH_OF_HASHES_STEP, HASH_OF_HASHES_STEP * sizeof(crypto::hash), span_hashes[i].first);
+    if (!weights.empty())
+      cn_fast_hash(data_weights.data() + i * HASH_OF_HASHES_STEP, HASH_OF_HASHES_STEP * sizeof(uint64_t), span_hashes[i].second);
+  };
+  if (n_spans > 1)
+    tools::threadpool::getInstanceForCompute().parallel_for(0, n_spans, hash_span, 4);
+  else if (n_spans == 1)
+    hash_span(0);
+
+  // check
   uint64_t usable = first_index * HASH_OF_HASHES_STEP - height; // may start negative, but unsigned under/overflow is not UB
   for (size_t n = first_index; n <= last_index; ++n)
   {
     if (n < m_blocks_hash_of_hashes.size())
     {
       // if the last index isn't fully filled, we can't tell if valid
-      if (data_hashes.size() < (n - first_index) * HASH_OF_HASHES_STEP + HASH_OF_HASHES_STEP)
+      if (n - first_index >= n_spans)
         break;
 
-      crypto::hash hash;
-      cn_fast_hash(data_hashes.data() + (n - first_index) * HASH_OF_HASHES_STEP, HASH_OF_HASHES_STEP * sizeof(crypto::hash), hash);
-      bool valid = hash == m_blocks_hash_of_hashes[n].first;
+      bool valid = span_hashes[n - first_index].first == m_blocks_hash_of_hashes[n].first;
       if (valid && !weights.empty())
-      {
-        cn_fast_hash(data_weights.data() + (n - first_index) * HASH_OF_HASHES_STEP, HASH_OF_HASHES_STEP * sizeof(uint64_t), hash);
-        valid &= hash == m_blocks_hash_of_hashes[n].second;
-      }
+        valid &= span_hashes[n - first_index].second == m_blocks_hash_of_hashes[n].second;
 
       // add to the known hashes array
       if (!valid)
@@ -5990,6 +6684,7 @@ bool Blockchain::has_block_weights(uint64_t height, uint64_t nblocks) const
 //    keys.
 bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete_entry> &blocks_entry, std::vector<block> &blocks)
 {
+  TRACE_SPAN("prepare_incoming_blocks");
   MTRACE("Blockchain::" << __func__);
   TIME_MEASURE_START(prepare);
   bool stop_batch;
@@ -6161,7 +6856,8 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   std::map<uint64_t, std::vector<uint64_t>> offset_map;
   // [output] stores all output_data_t for each absolute_offset
   std::map<uint64_t, std::vector<output_data_t>> tx_map;
-  std::vector<std::pair<cryptonote::transaction, crypto::hash>> txes(total_txs);
+  // only the prefixes are needed to build the scan table
+  std::vector<std::pair<cryptonote::transaction_prefix, crypto::hash>> txes(total_txs);
 
 #define SCAN_TABLE_QUIT(m) \
         do { \
@@ -6181,13 +6877,12 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     {
       if (tx_index >= txes.size())
         SCAN_TABLE_QUIT("tx_index is out of sync");
-      transaction &tx = txes[tx_index].first;
+      transaction_prefix &tx = txes[tx_index].first;
       crypto::hash &tx_prefix_hash = txes[tx_index].second;
       ++tx_index;
 
-      if (!parse_and_validate_tx_base_from_blob(tx_blob.blob, tx))
+      if (!parse_and_validate_tx_prefix_from_blob(tx_blob.blob, tx, tx_prefix_hash))
         SCAN_TABLE_QUIT("Could not parse tx from incoming blocks.");
-      cryptonote::get_transaction_prefix_hash(tx, tx_prefix_hash);
 
       auto its = m_scan_table.find(tx_prefix_hash);
       if (its != m_scan_table.end())
@@ -6290,7 +6985,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     {
       if (tx_index >= txes.size())
         SCAN_TABLE_QUIT("tx_index is out of sync");
-      const transaction &tx = txes[tx_index].first;
+      const transaction_prefix &tx = txes[tx_index].first;
       const crypto::hash &tx_prefix_hash = txes[tx_index].second;
       ++tx_index;
 
@@ -6419,6 +7114,49 @@ void Blockchain::add_miner_notify(MinerNotifyCallback&& notify)
   }
 }
 
+void Blockchain::add_block_stats_notify(BlockStatsNotifyCallback&& notify)
+{
+  if (notify)
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    m_block_stats_notifiers.push_back(std::move(notify));
+  }
+}
+
+void Blockchain::set_output_distribution_cache_max_bytes(size_t max_bytes)
+{
+  CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+  m_output_distribution_cache.set_max_bytes(max_bytes);
+  m_output_distribution_cache.enforce_limit(std::string());
+}
+
+Blockchain::cache_memory_usage Blockchain::get_cache_memory_usage() const
+{
+  cache_memory_usage usage;
+  usage.rct_ver_cache = m_rct_ver_cache.get_stats().bytes;
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    usage.ybi_cache = m_yield_block_info_cache.memory_usage();
+    usage.block_height_index = m_block_height_index.memory_usage();
+  }
+  {
+    CRITICAL_REGION_LOCAL(m_output_distribution_cache_lock);
+    usage.output_distribution_cache = m_output_distribution_cache.memory_usage();
+  }
+  {
+    const boost::lock_guard<boost::mutex> lock{m_block_stats_lock};
+    usage.block_stats = m_block_stats.capacity() * sizeof(block_processing_stats);
+  }
+  return usage;
+}
+
+std::vector<block_processing_stats> Blockchain::get_block_processing_stats(size_t count) const
+{
+  const boost::lock_guard<boost::mutex> lock{m_block_stats_lock};
+  count = std::min(count, m_block_stats.size());
+  return {m_block_stats.end() - count, m_block_stats.end()};
+}
+
 void Blockchain::safesyncmode(const bool onoff)
 {
   /* all of this is no-op'd if the user set a specific
@@ -6455,55 +7193,25 @@ std::vector<std::pair<Blockchain::block_extended_info,std::vector<crypto::hash>>
 {
   std::vector<std::pair<Blockchain::block_extended_info,std::vector<crypto::hash>>> chains;
 
-  blocks_ext_by_hash alt_blocks;
-  alt_blocks.reserve(m_db->get_alt_block_count());
-  m_db->for_all_alt_blocks([&alt_blocks](const crypto::hash &blkid, const cryptonote::alt_block_data_t &data, const cryptonote::blobdata_ref *blob) {
-    if (!blob)
-    {
-      MERROR("No blob, but blobs were requested");
-      return false;
-    }
-    cryptonote::block bl;
-    block_extended_info bei;
-    if (cryptonote::parse_and_validate_block_from_blob(*blob, bei.bl))
-    {
-      bei.height = data.height;
-      bei.block_cumulative_weight = data.cumulative_weight;
-      bei.cumulative_difficulty = data.cumulative_difficulty_high;
-      bei.cumulative_difficulty = (bei.cumulative_difficulty << 64) + data.cumulative_difficulty_low;
-      bei.already_generated_coins = data.already_generated_coins;
-      alt_blocks.insert(std::make_pair(cryptonote::get_block_hash(bei.bl), std::move(bei)));
-    }
-    else
-      MERROR("Failed to parse block from blob");
-    return true;
-  }, true);
-
-  for (const auto &i: alt_blocks)
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  for (std::vector<crypto::hash> &chain: get_alt_chains(get_alt_block_index()))
   {
-    const crypto::hash top = cryptonote::get_block_hash(i.second.bl);
-    bool found = false;
-    for (const auto &j: alt_blocks)
-    {
-      if (j.second.bl.prev_id == top)
-      {
-        found = true;
-        break;
-      }
-    }
-    if (!found)
+    // only the tips need their full block
+    const crypto::hash top = chain.front();
+    cryptonote::alt_block_data_t data;
+    cryptonote::blobdata blob;
+    block_extended_info bei;
+    if (!m_db->get_alt_block(top, &data, &blob) || !cryptonote::parse_and_validate_block_from_blob(blob, bei.bl))
     {
-      std::vector<crypto::hash> chain;
-      auto h = i.second.bl.prev_id;
-      chain.push_back(top);
-      blocks_ext_by_hash::const_iterator prev;
-      while ((prev = alt_blocks.find(h)) != alt_blocks.end())
-      {
-        chain.push_back(h);
-        h = prev->second.bl.prev_id;
-      }
-      chains.push_back(std::make_pair(i.second, chain));
+      MERROR("Failed to get alt chain tip " << top);
+      continue;
     }
+    bei.height = data.height;
+    bei.block_cumulative_weight = data.cumulative_weight;
+    bei.cumulative_difficulty = data.cumulative_difficulty_high;
+    bei.cumulative_difficulty = (bei.cumulative_difficulty << 64) + data.cumulative_difficulty_low;
+    bei.already_generated_coins = data.already_generated_coins;
+    chains.push_back(std::make_pair(std::move(bei), std::move(chain)));
   }
   return chains;
 }
@@ -6524,6 +7232,19 @@ void Blockchain::load_compiled_in_block_hashes(const GetCheckpointsCallback& get
   const epee::span<const unsigned char> &checkpoints = get_checkpoints(m_nettype);
   if (!checkpoints.empty())
   {
+    // nothing to load once the chain is past the precomputed area, so
+    // don't pay for hashing the whole blob on every start of a synced node
+    if (checkpoints.size() > 4)
+    {
+      const unsigned char *p = checkpoints.data();
+      const uint32_t nblocks = *p | ((*(p+1))<<8) | ((*(p+2))<<16) | ((*(p+3))<<24);
+      if (nblocks <= (m_db->height() + HASH_OF_HASHES_STEP - 1) / HASH_OF_HASHES_STEP)
+      {
+        MINFO("Chain is past the precomputed blocks, not loading them");
+        return;
+      }
+    }
+
     MINFO("Loading precomputed blocks (" << checkpoints.size() << " bytes)");
     if (m_nettype == MAINNET)
     {
@@ -6654,6 +7375,7 @@ void Blockchain::invalidate_block_template_cache()
 {
   MDEBUG("Invalidating block template cache");
   m_btc_valid = false;
+  m_btc_base_valid = false;
 }
 
 void Blockchain::cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie)
@@ -6680,12 +7402,15 @@ void Blockchain::send_miner_notifications(uint64_t height, const crypto::hash &s
   const difficulty_type diff = get_difficulty_for_next_block();
   const uint64_t median_weight = m_current_block_cumul_weight_median;
 
+  // the diff is against the previous notification, for subscribers following every one of them
   std::vector<tx_block_template_backlog_entry> tx_backlog;
-  m_tx_pool.get_block_template_backlog(tx_backlog);
+  tx_block_template_backlog_diff tx_backlog_diff;
+  m_tx_pool.get_block_template_backlog_diff(m_miner_notify_backlog_version, tx_backlog_diff, &tx_backlog);
+  m_miner_notify_backlog_version = tx_backlog_diff.version;
 
   for (const auto& notifier : m_miner_notifiers)
   {
-    notifier(major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog);
+    notifier(major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog, tx_backlog_diff);
   }
 }
 
@@ -31,6 +31,7 @@
 #pragma once
 #include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/circular_buffer.hpp>
 #include <boost/function/function_fwd.hpp>
 #if BOOST_VERSION >= 107400
 #include <boost/serialization/library_version_type.hpp>
@@ -54,11 +55,18 @@
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "common/powerof.h"
 #include "common/util.h"
+#include "common/threadpool.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "cryptonote_basic/difficulty.h"
 #include "cryptonote_tx_utils.h"
 #include "tx_verification_utils.h"
+#include "alt_block_index.h"
+#include "block_height_index.h"
+#include "output_distribution_cache.h"
+#include "notify_dispatcher.h"
+#include "pricing_record_cache.h"
+#include "yield_block_info_cache.h"
 #include "cryptonote_basic/verification_context.h"
 #include "crypto/hash.h"
 #include "checkpoints/checkpoints.h"
@@ -93,7 +101,8 @@ namespace cryptonote
   typedef std::function<const epee::span<const unsigned char>(cryptonote::network_type network)> GetCheckpointsCallback;
 
   typedef boost::function<void(uint64_t /* height */, epee::span<const block> /* blocks */)> BlockNotifyCallback;
-  typedef boost::function<void(uint8_t /* major_version */, uint64_t /* height */, const crypto::hash& /* prev_id */, const crypto::hash& /* seed_hash */, difficulty_type /* diff */, uint64_t /* median_weight */, uint64_t /* already_generated_coins */, const std::vector<tx_block_template_backlog_entry>& /* tx_backlog */)> MinerNotifyCallback;
+  typedef boost::function<void(uint8_t /* major_version */, uint64_t /* height */, const crypto::hash& /* prev_id */, const crypto::hash& /* seed_hash */, difficulty_type /* diff */, uint64_t /* median_weight */, uint64_t /* already_generated_coins */, const std::vector<tx_block_template_backlog_entry>& /* tx_backlog */, const tx_block_template_backlog_diff& /* tx_backlog_diff */)> MinerNotifyCallback;
+  typedef boost::function<void(const block_processing_stats& /* stats */)> BlockStatsNotifyCallback;
 
   /************************************************************************/
   /*                                                                      */
@@ -113,6 +122,29 @@ namespace cryptonote
       uint64_t already_generated_coins; //!< the total coins minted after that block
     };
 
+    /**
+     * @brief one consistent view of the chain for a multi-call reader, such as an RPC request
+     *
+     * While it lives, every db read made on this thread shares one read txn,
+     * and so one snapshot, along with the thread's cursors.
+     *
+     * With lock_blockchain, the blockchain lock is held too, so the holder may
+     * call anything that takes the lock. Without it, the holder must not call
+     * anything that takes the blockchain lock: a map resize waits for open read
+     * txns, while holding that lock.
+     */
+    class read_snapshot
+    {
+    public:
+      read_snapshot(const Blockchain &blockchain, bool lock_blockchain);
+      ~read_snapshot();
+
+    private:
+      const Blockchain &m_blockchain;
+      const bool m_locked;
+      std::unique_ptr<db_rtxn_guard> m_rtxn_guard;
+    };
+
     /**
      * @brief Blockchain constructor
      *
@@ -174,6 +206,13 @@ namespace cryptonote
      */
     void set_checkpoints(checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
 
+    /**
+     * @brief get the network type given to init
+     *
+     * @return the network type
+     */
+    network_type get_nettype() const { return m_nettype; }
+
     /**
      * @brief get blocks and transactions from blocks based on start height and count
      *
@@ -271,6 +310,13 @@ namespace cryptonote
      */
     bool get_pricing_record(oracle::pricing_record &pr, std::map<std::string, uint64_t> &circ_supply, uint64_t timestamp);
 
+    /**
+     * @brief gets the age of the cached Oracle pricing record
+     *
+     * @return the number of seconds since the cached record was received, or -1 if there is none
+     */
+    int64_t get_pricing_record_age() const;
+
     /**
      * @brief gets the latest pricing record that was in the last 10 block.
      * If no pricing record found in the past 10 block, fails.
@@ -311,6 +357,17 @@ namespace cryptonote
      */
     bool have_tx_keyimg_as_spent(const crypto::key_image &key_im) const;
 
+    /**
+     * @brief check if several key images are already spent on the blockchain
+     *
+     * Large batches are split across the compute threadpool, each part
+     * looked up under its own read txn.
+     *
+     * @param key_images the key images to search for
+     * @param spent return-by-reference whether each image is spent, in the same order
+     */
+    void have_key_images_as_spent(const epee::span<const crypto::key_image> key_images, std::vector<bool> &spent) const;
+
     /**
      * @brief get the current height of the blockchain
      *
@@ -413,6 +470,18 @@ namespace cryptonote
      */
     bool get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, std::vector<tx_block_template_backlog_entry>& tx_backlog);
 
+    /**
+     * @brief gets data required to create a block template, with the backlog as changes since an earlier version
+     *
+     * @param since_backlog_version backlog version the caller has, 0 for none
+     * @param tx_backlog the backlog changes since `since_backlog_version`, or the whole backlog
+     *
+     * @return true if block template filled in successfully, else false
+     *
+     * @note see the overload above for the other parameters, and tx_memory_pool::get_block_template_backlog_diff
+     */
+    bool get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, uint64_t since_backlog_version, tx_block_template_backlog_diff& tx_backlog);
+
     /**
      * @brief checks if a block is known about with a given hash
      *
@@ -534,6 +603,9 @@ namespace cryptonote
     /**
      * @brief get number of outputs of an asset type past the minimum spendable age
      *
+     * The outputs still too young are counted from the cached output
+     * distribution, so this is cheap enough to run for every submitted tx.
+     *
      * @param asset_type the asset type to query
      *
      * @return the number of mature outputs of the asset type
@@ -829,14 +901,14 @@ namespace cryptonote
     void set_enforce_dns_checkpoints(bool enforce);
 
     /**
-     * @brief loads new checkpoints from a file and optionally from DNS
+     * @brief loads new checkpoints from a file and optionally from DNS records
      *
      * @param file_path the path of the file to look for and load checkpoints from
-     * @param check_dns whether or not to check for new DNS-based checkpoints
+     * @param dns_records already fetched DNS checkpoint records, or NULL to skip DNS
      *
      * @return false if any enforced checkpoint type fails to load, otherwise true
      */
-    bool update_checkpoints(const std::string& file_path, bool check_dns);
+    bool update_checkpoints(const std::string& file_path, const std::vector<std::string> *dns_records);
 
 
     // user options, must be called before calling init()
@@ -867,12 +939,38 @@ namespace cryptonote
      */
     void add_miner_notify(MinerNotifyCallback&& notify);
 
+    /**
+     * @brief sets a notify object to call with the timing breakdown of every new block
+     *
+     * @param notify the notify object to call at every new block
+     */
+    void add_block_stats_notify(BlockStatsNotifyCallback&& notify);
+
+    /**
+     * @brief gets the timing breakdown of the most recently added blocks
+     *
+     * @param count the maximum number of blocks to return
+     *
+     * @return up to count entries, oldest first
+     */
+    std::vector<block_processing_stats> get_block_processing_stats(size_t count) const;
+
     /**
      * @brief sets a reorg notify object to call for every reorg
      *
      * @param notify the notify object to call at every reorg
      */
-    void set_reorg_notify(const std::shared_ptr<tools::Notify> &notify) { m_reorg_notify = notify; }
+    void set_reorg_notify(const std::shared_ptr<tools::Notify> &notify) { m_notify_dispatcher.set_reorg_notify(notify); }
+
+    /**
+     * @brief sets a notify object to run for new main chain blocks
+     *
+     * Unlike add_block_notify callbacks, this runs off the block path and
+     * blocks arriving while it is busy are covered by a single call.
+     *
+     * @param notify the notify object to run
+     */
+    void set_block_notify(const std::shared_ptr<tools::Notify> &notify) { m_notify_dispatcher.set_block_notify(notify); }
 
     /**
      * @brief Put DB in safe sync mode
@@ -886,6 +984,39 @@ namespace cryptonote
      */
     void set_show_time_stats(bool stats) { m_show_time_stats = stats; }
 
+    /**
+     * @brief set how many RCT verification results are cached
+     *
+     * @param size the number of tx+mixring hashes to keep
+     */
+    void set_rct_ver_cache_size(size_t size) { m_rct_ver_cache.set_capacity(size); }
+
+    /**
+     * @brief gets the RCT verification cache counters
+     */
+    rct_ver_cache_t::stats_t get_rct_ver_cache_stats() const { return m_rct_ver_cache.get_stats(); }
+
+    /**
+     * @brief set the most bytes the output distribution cache may hold
+     *
+     * @param max_bytes the limit, 0 for no limit
+     */
+    void set_output_distribution_cache_max_bytes(size_t max_bytes);
+
+    struct cache_memory_usage
+    {
+      uint64_t rct_ver_cache;
+      uint64_t ybi_cache;
+      uint64_t output_distribution_cache;
+      uint64_t block_height_index;
+      uint64_t block_stats;
+    };
+
+    /**
+     * @brief estimates the bytes held by the in memory caches
+     */
+    cache_memory_usage get_cache_memory_usage() const;
+
     /**
      * @brief gets the hardfork voting state object
      *
@@ -1101,6 +1232,23 @@ namespace cryptonote
     bool prune_blockchain(uint32_t pruning_seed = 0);
     bool update_blockchain_pruning();
     bool check_blockchain_pruning();
+    bool prune_blockchain_step(size_t max_records, uint32_t pruning_seed = 0);
+
+    /**
+     * @brief re-checks up to max_blocks stored blocks, starting at height
+     *
+     * Each block must hash to its stored id, link to its parent, match any
+     * checkpoint and meet the difficulty stored for it; its transactions must
+     * hash to the ids it commits to and their key images must be spent.
+     * Only a read txn is held, so syncing and serving carry on meanwhile.
+     *
+     * @param height the first height to check, advanced past the checked blocks
+     * @param max_blocks the most blocks to check
+     * @param error set to what failed, if a check fails
+     *
+     * @return false if a check failed, true otherwise
+     */
+    bool verify_history_step(uint64_t &height, size_t max_blocks, std::string &error) const;
 
     void lock();
     void unlock();
@@ -1182,6 +1330,70 @@ namespace cryptonote
      */
     bool calculate_yield_payouts(const uint64_t start_height, std::vector<std::pair<yield_tx_info_carrot, uint64_t>>& yield_payouts);
 
+    /**
+     * @brief the yield and audit payouts due in the protocol_tx of a block
+     */
+    struct matured_payouts
+    {
+      uint64_t yield_height; //!< the height the matured stakes were made at
+      std::vector<std::pair<yield_tx_info, uint64_t>> yield;
+      std::vector<std::pair<yield_tx_info_carrot, uint64_t>> carrot_yield;
+      uint64_t audit_height; //!< the height the matured audits were made at, if any
+      std::pair<std::string, std::string> audit_asset_types;
+      std::vector<std::pair<yield_tx_info, uint64_t>> audit;
+    };
+
+    /**
+     * @brief gather the yield and audit payouts maturing at a height
+     *
+     * Shared by protocol_tx validation and block template creation, so
+     * both agree on what is due.  Nothing matures within the stake lock
+     * period of the genesis block.  The payouts for the next height are
+     * normally already gathered by precompute_next_payouts_async().
+     *
+     * @param height the height of the block carrying the protocol_tx
+     * @param payouts return-by-reference the payouts due
+     *
+     * @return TRUE if the payouts were gathered, FALSE otherwise
+     */
+    bool get_matured_payouts(const uint64_t height, matured_payouts& payouts);
+
+    /**
+     * @brief gather the payouts maturing at a height from the blockchain
+     *
+     * @copydetails get_matured_payouts
+     */
+    bool compute_matured_payouts(const uint64_t height, matured_payouts& payouts);
+
+    /**
+     * @brief gather the payouts due at the next height on the async service
+     *
+     * The result is kept with the top block hash it was gathered on, so a
+     * pop or reorg simply makes it unused.  At most one run is queued.
+     * Called once blocks are committed, as the async thread reads its own
+     * db snapshot and would not see a batch still in progress.
+     */
+    void precompute_next_payouts_async();
+
+    /**
+     * @brief (re)build the index of the heights at which audits mature
+     *
+     * Which audit fork (if any) matures at a height depends only on the
+     * hard fork schedule, so this is built once the schedule is known.
+     */
+    void build_audit_maturity_index();
+
+    /**
+     * @brief find the audit maturing at a height, if any
+     *
+     * @param height the height of the block carrying the protocol_tx
+     * @param matured_audit_height return-by-reference the height the audits were made at
+     * @param asset_types return-by-reference the source and destination assets of the audit fork
+     *
+     * @return TRUE if an audit fork matures at this height, FALSE otherwise
+     */
+    bool get_matured_audit(const uint64_t height, uint64_t& matured_audit_height, std::pair<std::string, std::string>& asset_types) const;
+
     /**
      * @brief get the ABI entry for a particular height from the cache
      *
@@ -1194,13 +1406,17 @@ namespace cryptonote
     /**
      * @brief get the complete YBI cache
      *
-     * Retrieve the YBI local cache.
+     * Retrieve a read-only view of the YBI entries for the lock period ending
+     * at the top block, in ascending height order.
      * If the cache is out of date, the cache will (attempt to) be rebuilt
      * before being returned.
      *
+     * The view is not a copy: the caller must hold the blockchain lock for as
+     * long as it is in use.
+     *
      * @return TRUE if the call is successful, FALSE otherwise
      */
-    bool get_ybi_cache(std::map<uint64_t, yield_block_info>& ybi_cache);
+    bool get_ybi_cache(epee::span<const yield_block_info>& ybi_cache);
 
     /**
      * @brief get the YBI entry for a particular height from the cache
@@ -1219,13 +1435,30 @@ namespace cryptonote
      * @return TRUE if the cache rebuilt correctly, FALSE otherwise
      */
     bool rebuild_ybi_cache();
+
+    /**
+     * @brief bring the yield_block_info cache up to date with the blockchain
+     *
+     * Only the heights that differ from the cache are read from the
+     * blockchain: entries above the top block are dropped, missing entries
+     * at the top are appended, and missing entries at the bottom of the lock
+     * period are prepended. This is a no-op if the cache is already in sync,
+     * and pages in the whole lock period on first use.
+     *
+     * @return TRUE if the cache covers the lock period, FALSE otherwise
+     */
+    bool sync_ybi_cache();
     
     /**
      * @brief validate the yield_block_info cache
      *
      * Checks that the m_yield_block_info_cache is fully populated by
-     * checking the size of the map, and making sure it has the most recent entry
-     * and the oldest expected entry as well
+     * making sure it ends at the most recent entry and reaches back to the
+     * oldest expected entry as well, and that every cached entry matches the
+     * one stored in the blockchain.
+     *
+     * This reads every cached entry from the blockchain, so it is not used on
+     * the hot path - see check_ybi_cache_async()
      *
      * Returns TRUE if the cache is intact, full, and up-to-date, FALSE otherwise
      *
@@ -1233,6 +1466,43 @@ namespace cryptonote
      */
     bool validate_ybi_cache();
 
+    /**
+     * @brief validate the yield_block_info cache in the background
+     *
+     * Runs validate_ybi_cache() on the async service, rebuilding the cache
+     * if it is found to be inconsistent with the blockchain.
+     */
+    void check_ybi_cache_async();
+
+    /**
+     * @brief re-validate the txpool against the current fork in the background
+     *
+     * Startup does not wait for every pool tx to be re-verified; until
+     * the pass finishes is_txpool_validated() returns false.
+     */
+    void validate_txpool_async();
+
+    /**
+     * @brief whether the startup txpool re-validation has finished
+     *
+     * @return true once validate_txpool_async()'s pass has completed
+     */
+    bool is_txpool_validated() const { return m_txpool_validated; }
+
+    /**
+     * @brief catch up with blocks another process wrote to a shared db
+     *
+     * For a read-only db kept in sync by another daemon: if the top block
+     * has moved since the last call, the in-memory chain state (hard fork
+     * state, difficulty window, weight limits and the various caches) is
+     * brought in line with the db.  Blocks appended on top of the last seen
+     * tip are taken incrementally; anything else is treated as a reorg and
+     * the caches are rebuilt.
+     *
+     * @return true if the top block changed, false otherwise
+     */
+    bool refresh_from_db();
+
 #ifndef IN_UNIT_TESTS
   private:
 #endif
@@ -1275,10 +1545,19 @@ namespace cryptonote
     uint64_t m_fake_scan_time;
     uint64_t m_sync_counter;
     uint64_t m_bytes_to_sync;
-    std::vector<uint64_t> m_timestamps;
-    std::vector<difficulty_type> m_difficulties;
-    uint64_t m_timestamps_and_difficulties_height;
-    bool m_reset_timestamps_and_difficulties_height;
+    // timestamps and cumulative difficulties of main chain blocks, kept in
+    // step with pops so reorgs only re-read the blocks that changed
+    difficulty_window m_difficulty_window;
+
+    // parsed alt blocks, so extending an alt chain doesn't parse the whole
+    // chain again; the alt block table stays the authority on membership
+    mutable std::unordered_map<crypto::hash, block> m_alt_block_cache;
+
+    // parent and height of every alt block, so alt chain tips and their
+    // chains are found without parsing every blob again; rebuilt from the
+    // alt block table whenever it no longer matches it
+    mutable alt_block_index_t m_alt_block_index;
+    mutable bool m_alt_block_index_valid;
     uint64_t m_long_term_block_weights_window;
     uint64_t m_long_term_effective_median_block_weight;
     mutable crypto::hash m_long_term_block_weights_cache_tip_hash;
@@ -1319,6 +1598,34 @@ namespace cryptonote
     uint64_t m_btc_seed_height;
     bool m_btc_valid;
 
+    // ring signature checks queued by check_tx_inputs while adding a block
+    struct deferred_rct_verification
+    {
+      deferred_rct_verification(tools::threadpool &tpool): waiter(tpool), failed(false) {}
+      tools::threadpool::waiter waiter;
+      std::atomic<bool> failed;
+    };
+
+    // miner independent part of the block template cache: everything but
+    // the miner tx, which is all that differs between miners' templates
+    struct block_template_base
+    {
+      block b;
+      difficulty_type difficulty;
+      uint64_t height;
+      size_t median_weight;
+      uint64_t already_generated_coins;
+      size_t txs_weight;
+      uint64_t fee;
+      uint64_t expected_reward;
+      uint64_t seed_height;
+      crypto::hash seed_hash;
+      uint64_t pool_cookie;
+      uint64_t pr_generation;
+    };
+    block_template_base m_btc_base;
+    bool m_btc_base_valid;
+
 
     bool m_batch_success;
 
@@ -1328,7 +1635,15 @@ namespace cryptonote
 
     std::vector<BlockNotifyCallback> m_block_notifiers;
     std::vector<MinerNotifyCallback> m_miner_notifiers;
-    std::shared_ptr<tools::Notify> m_reorg_notify;
+    uint64_t m_miner_notify_backlog_version; //!< backlog version in the last miner notification
+    std::vector<BlockStatsNotifyCallback> m_block_stats_notifiers;
+
+    // timing breakdown of the last blocks added to the main chain, has its own
+    // lock so reading it does not wait on block processing
+    boost::circular_buffer<block_processing_stats> m_block_stats;
+    mutable boost::mutex m_block_stats_lock;
+    // --block-notify and --reorg-notify, spawned from a thread of their own
+    notify_dispatcher m_notify_dispatcher;
 
     // for prepare_handle_incoming_blocks
     uint64_t m_prepare_height;
@@ -1338,10 +1653,64 @@ namespace cryptonote
     // cache for verifying transaction RCT non semantics
     mutable rct_ver_cache_t m_rct_ver_cache;
 
+    // Oracle pricing records, prefetched for the next block template
+    pricing_record_cache m_pricing_record_cache;
+    std::atomic<bool> m_pricing_record_prefetch;
+
     /**
-     * @brief hashmap linking blockchain height to YBI struct for that height
+     * @brief ring buffer linking blockchain height to YBI struct for that height
      */
-    std::map<uint64_t, yield_block_info> m_yield_block_info_cache;
+    yield_block_info_cache m_yield_block_info_cache;
+
+    /**
+     * @brief a span of heights at which the audits of one audit fork mature
+     */
+    struct audit_maturity_range
+    {
+      uint64_t begin; //!< the first height the audits mature at
+      uint64_t end; //!< one past the last height the audits mature at
+      uint64_t lock_period;
+      std::pair<std::string, std::string> asset_types;
+    };
+
+    /**
+     * @brief the spans of heights at which audits mature, in AUDIT_HARD_FORKS order
+     */
+    std::vector<audit_maturity_range> m_audit_maturity_index;
+
+    /**
+     * @brief the payouts due at the next height, guarded by m_blockchain_lock
+     */
+    uint64_t m_next_payouts_height;
+    crypto::hash m_next_payouts_top_hash;
+    matured_payouts m_next_payouts;
+    std::atomic<bool> m_next_payouts_pending;
+
+    std::atomic<bool> m_txpool_validated;
+
+    // the top of the db as of init() or the last refresh_from_db()
+    crypto::hash m_db_refresh_tip_hash;
+    uint64_t m_db_refresh_height;
+
+    /**
+     * @brief cumulative rct output counts by height and asset type, extended on request and trimmed on pop
+     */
+    // main chain hash to height, built on first use (guarded by m_blockchain_lock)
+    mutable block_height_index m_block_height_index;
+
+    mutable output_distribution_cache m_output_distribution_cache;
+    mutable epee::critical_section m_output_distribution_cache_lock;
+
+    /**
+     * @brief accumulate the yield accrued over the lock period for each matured stake
+     *
+     * @param start_height the height of the block before the stakes started to accrue yield
+     * @param yield_container the matured stakes, paired with the amount to pay out
+     *
+     * @return TRUE if the whole lock period was available in the cache, FALSE otherwise
+     */
+    template<typename T>
+    bool accrue_yield_payouts(const uint64_t start_height, std::vector<std::pair<T, uint64_t>>& yield_container);
     
     /**
      * @brief collects the keys for all outputs being "spent" as an input
@@ -1402,13 +1771,19 @@ namespace cryptonote
      * Currently this function calls ring signature validation for each
      * transaction.
      *
+     * If deferred is not NULL, RingCT signature verification is queued on the
+     * compute threadpool instead, and its outcome is only known once
+     * deferred->waiter has been waited on.  The transaction must then stay
+     * alive and untouched until that point.
+     *
      * @param tx the transaction to validate
      * @param tvc returned information about tx verification
      * @param pmax_related_block_height return-by-pointer the height of the most recent block in the input set
+     * @param deferred if not NULL, where to queue ring signature verification
      *
      * @return false if any validation step fails, otherwise true
      */
-    bool check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height = NULL) const;
+    bool check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height = NULL, deferred_rct_verification *deferred = NULL) const;
 
     /**
      * @brief performs a blockchain reorganization according to the longest chain rule
@@ -1477,6 +1852,28 @@ namespace cryptonote
      */
     bool handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc);
 
+    /**
+     * @brief gets the alt block index, rebuilding it from the db if needed
+     *
+     * The caller must hold m_blockchain_lock.
+     */
+    const alt_block_index_t &get_alt_block_index() const;
+
+    /**
+     * @brief removes an alt block from the db and the in memory caches of it
+     *
+     * @param blkid the hash of the alt block
+     */
+    void remove_alt_block(const crypto::hash &blkid);
+
+    /**
+     * @brief drops alt chains whose tip is more than ALT_CHAIN_MAX_STALE_BLOCKS below the top
+     *
+     * Blocks shared with a chain that is still recent are kept. The caller
+     * must hold m_blockchain_lock and a write txn.
+     */
+    void prune_stale_alt_chains();
+
     /**
      * @brief builds a list of blocks connecting a block to the main chain
      *
@@ -1564,10 +1961,11 @@ namespace cryptonote
      * @param b the block containing the miner transaction to be validated
      * @param height the blockchain's weight
      * @param version hard fork version for that transaction
+     * @param payouts_us if not NULL, set to the time spent computing the matured payouts
      *
      * @return false if anything is found wrong with the protocol transaction, otherwise true
      */
-    bool validate_protocol_transaction(const block& b, uint64_t height, uint8_t hf_version);
+    bool validate_protocol_transaction(const block& b, uint64_t height, uint8_t hf_version, uint64_t *payouts_us = NULL);
 
     /**
      * @brief reverts the blockchain to its previous state following a failed switch
@@ -1690,6 +2088,16 @@ namespace cryptonote
      */
     bool complete_timestamps_vector(uint64_t start_height, std::vector<uint64_t>& timestamps) const;
 
+    /**
+     * @brief checks that m_difficulty_window was filled from the chain now in the db
+     *
+     * The window is kept by height, so a window filled from a snapshot the
+     * current chain has since replaced must not be reused.
+     *
+     * @return true if the window is non-empty and its top block hash matches the db
+     */
+    bool difficulty_window_matches_db() const;
+
     /**
      * @brief calculate the block weight limit for the next block to be added
      *
@@ -1733,6 +2141,25 @@ namespace cryptonote
      */
     void load_compiled_in_block_hashes(const GetCheckpointsCallback& get_checkpoints);
 
+    /**
+     * @brief reads the cumulative rct output counts of an asset type into the cache, up to a height
+     *
+     * The caller must hold m_output_distribution_cache_lock.
+     *
+     * @param asset_type the asset type, "" for the global outputs
+     * @param to_height the last height to have cached, below the db height
+     *
+     * @return false if the cache could not be extended
+     */
+    bool fill_output_distribution_cache(const std::string &asset_type, uint64_t to_height) const;
+
+    /**
+     * @brief index the hashes of the main chain blocks not yet in the block height index
+     *
+     * The caller must hold m_blockchain_lock and a read txn.
+     */
+    void fill_block_height_index() const;
+
     /**
      * @brief invalidates any cached block template
      */
@@ -1745,6 +2172,25 @@ namespace cryptonote
      */
     void cache_block_template(const block &b, const cryptonote::account_public_address &address, const blobdata &nonce, const difficulty_type &diff, uint64_t height, uint64_t expected_reward, uint64_t seed_height, const crypto::hash &seed_hash, uint64_t pool_cookie);
 
+    /**
+     * @brief builds the miner tx of a block template
+     *
+     * Runs the two-phase miner tx construction, so the miner tx weight
+     * matches what was assumed when calculating the block reward.
+     *
+     * @param b the block template, whose miner tx is replaced
+     * @param height the height of the block template
+     * @param median_weight the median block weight used for the reward
+     * @param already_generated_coins the coins generated before this block
+     * @param txs_weight the total weight of the block's transactions
+     * @param fee the total fee of the block's transactions
+     * @param miner_address the address the block reward is paid to
+     * @param ex_nonce the extra nonce to add to the miner tx
+     *
+     * @return true on success, false otherwise
+     */
+    bool construct_block_template_miner_tx(block &b, uint64_t height, size_t median_weight, uint64_t already_generated_coins, size_t txs_weight, uint64_t fee, const account_public_address &miner_address, const blobdata &ex_nonce);
+
     /**
      * @brief sends new block notifications to ZMQ `miner_data` subscribers
      *
@@ -40,12 +40,14 @@ using namespace epee;
 #include "common/updates.h"
 #include "common/download.h"
 #include "common/threadpool.h"
+#include "common/perf_timer.h"
 #include "common/command_line.h"
 #include "cryptonote_basic/events.h"
 #include "warnings.h"
 #include "crypto/crypto.h"
 #include "cryptonote_config.h"
 #include "misc_language.h"
+#include "profile_tools.h"
 #include "file_io_utils.h"
 #include <csignal>
 #include "checkpoints/checkpoints.h"
@@ -71,6 +73,12 @@ DISABLE_VS_WARNINGS(4355)
 // basically at least how many bytes the block itself serializes to without the miner tx
 #define BLOCK_SIZE_SANITY_LEEWAY 100
 
+#define DEFAULT_BACKGROUND_PRUNING_RATE 2000
+#define DEFAULT_HISTORY_VERIFICATION_RATE 20
+
+// read txns held longer than this are logged, since they stop the db reusing freed pages
+#define LONG_READ_TXN_WARN_SECONDS 60
+
 namespace cryptonote
 {
   const command_line::arg_descriptor<bool, false> arg_testnet_on  = {
@@ -115,6 +123,10 @@ namespace cryptonote
     "offline"
   , "Do not listen for peers, nor connect to any"
   };
+  const command_line::arg_descriptor<bool> arg_read_replica = {
+    "read-replica"
+  , "Serve RPC from a data directory kept in sync by another daemon, opening its database read-only. Implies --offline"
+  };
   const command_line::arg_descriptor<bool> arg_disable_dns_checkpoints = {
     "disable-dns-checkpoints"
   , "Do not retrieve checkpoints from DNS"
@@ -190,7 +202,10 @@ namespace cryptonote
   };
   static const command_line::arg_descriptor<std::string> arg_block_notify = {
     "block-notify"
-  , "Run a program for each new block, '%s' will be replaced by the block hash"
+  , "Run a program for each new block, '%s' will be replaced by the block hash "
+    "and '%h' by its height. Blocks arriving while the program is being started "
+    "are covered by one run for the latest of them, with '%f' replaced by the "
+    "lowest height it covers"
   , ""
   };
   static const command_line::arg_descriptor<bool> arg_prune_blockchain  = {
@@ -198,6 +213,31 @@ namespace cryptonote
   , "Prune blockchain"
   , false
   };
+  static const command_line::arg_descriptor<bool> arg_prune_blockchain_background  = {
+    "prune-blockchain-background"
+  , "Prune blockchain a little at a time while the daemon runs, instead of all at once at startup"
+  , false
+  };
+  static const command_line::arg_descriptor<uint64_t> arg_prune_blockchain_rate  = {
+    "prune-blockchain-rate"
+  , "Number of transactions background pruning visits per second"
+  , DEFAULT_BACKGROUND_PRUNING_RATE
+  };
+  static const command_line::arg_descriptor<bool> arg_verify_history  = {
+    "verify-history"
+  , "Re-check every stored block from genesis in the background, e.g. after starting from a copied database"
+  , false
+  };
+  static const command_line::arg_descriptor<uint64_t> arg_verify_history_rate  = {
+    "verify-history-rate"
+  , "Number of blocks background history verification checks per second"
+  , DEFAULT_HISTORY_VERIFICATION_RATE
+  };
+  static const command_line::arg_descriptor<bool> arg_verify_history_halt  = {
+    "verify-history-halt"
+  , "Stop the daemon if background history verification finds a bad block"
+  , false
+  };
   static const command_line::arg_descriptor<std::string> arg_reorg_notify = {
     "reorg-notify"
   , "Run a program for each reorg, '%s' will be replaced by the split height, "
@@ -218,6 +258,26 @@ namespace cryptonote
     "is acted upon."
   , ""
   };
+  static const command_line::arg_descriptor<uint64_t> arg_light_wallet_scanner_max_accounts = {
+    "light-wallet-scanner-max-accounts"
+  , "Scan new blocks for up to this many light wallet accounts registered over the unrestricted RPC, 0 to disable"
+  , 0
+  };
+  static const command_line::arg_descriptor<bool> arg_check_ybi_cache  = {
+    "check-ybi-cache"
+  , "Check the yield information cache against the blockchain in the background after startup"
+  , false
+  };
+  static const command_line::arg_descriptor<size_t> arg_rct_ver_cache_size  = {
+    "rct-ver-cache-size"
+  , "Number of ring signature verification results to cache, so transactions verified in the pool are not verified again when mined"
+  , RCT_VER_CACHE_SIZE
+  };
+  static const command_line::arg_descriptor<size_t> arg_output_distribution_cache_max_bytes  = {
+    "output-distribution-cache-max-bytes"
+  , "Most bytes of cached output distributions to keep, dropping the least recently requested asset types first, 0 for no limit"
+  , 0
+  };
   static const command_line::arg_descriptor<bool> arg_keep_alt_blocks  = {
     "keep-alt-blocks"
   , "Keep alternative blocks on restart"
@@ -233,9 +293,16 @@ namespace cryptonote
                 return cryptonote::get_block_longhash(&m_blockchain_storage, b, hash, height, seed_hash, threads);
               }),
               m_starter_message_showed(false),
+              m_background_pruning(false),
+              m_background_pruning_rate(DEFAULT_BACKGROUND_PRUNING_RATE),
+              m_history_verification(false),
+              m_history_verification_failed(false),
+              m_history_verified_height(0),
+              m_history_verification_rate(DEFAULT_HISTORY_VERIFICATION_RATE),
+              m_history_verification_halt(false),
               m_target_blockchain_height(0),
               m_checkpoints_path(""),
-              m_last_dns_checkpoints_update(0),
+              m_dns_checkpoints_generation(0),
               m_last_json_checkpoints_update(0),
               m_disable_dns_checkpoints(false),
               m_update_download(0),
@@ -286,15 +353,26 @@ namespace cryptonote
     if (m_checkpoints_updating.test_and_set()) return true;
 
     bool res = true;
-    if (!skip_dns && time(NULL) - m_last_dns_checkpoints_update >= 3600)
+    std::vector<std::string> dns_records;
+    uint64_t dns_generation = m_dns_checkpoints_generation;
+    if (!skip_dns && !m_offline)
     {
-      res = m_blockchain_storage.update_checkpoints(m_checkpoints_path, true);
-      m_last_dns_checkpoints_update = time(NULL);
+      // lookups run in the background, only what is already cached is used here
+      if (!m_dns_checkpoints)
+        m_dns_checkpoints.reset(new dns_checkpoints_cache(m_nettype, std::chrono::seconds(DNS_CHECKPOINTS_CACHE_TTL)));
+      m_dns_checkpoints->refresh();
+      m_dns_checkpoints->get(dns_records, dns_generation);
+    }
+
+    if (dns_generation != m_dns_checkpoints_generation)
+    {
+      res = m_blockchain_storage.update_checkpoints(m_checkpoints_path, &dns_records);
+      m_dns_checkpoints_generation = dns_generation;
       m_last_json_checkpoints_update = time(NULL);
     }
     else if (time(NULL) - m_last_json_checkpoints_update >= 600)
     {
-      res = m_blockchain_storage.update_checkpoints(m_checkpoints_path, false);
+      res = m_blockchain_storage.update_checkpoints(m_checkpoints_path, nullptr);
       m_last_json_checkpoints_update = time(NULL);
     }
 
@@ -345,15 +423,25 @@ namespace cryptonote
     command_line::add_arg(desc, arg_no_fluffy_blocks);
     command_line::add_arg(desc, arg_test_dbg_lock_sleep);
     command_line::add_arg(desc, arg_offline);
+    command_line::add_arg(desc, arg_read_replica);
     command_line::add_arg(desc, arg_disable_dns_checkpoints);
     command_line::add_arg(desc, arg_block_download_max_size);
     command_line::add_arg(desc, arg_sync_pruned_blocks);
     command_line::add_arg(desc, arg_max_txpool_weight);
     command_line::add_arg(desc, arg_block_notify);
     command_line::add_arg(desc, arg_prune_blockchain);
+    command_line::add_arg(desc, arg_prune_blockchain_background);
+    command_line::add_arg(desc, arg_prune_blockchain_rate);
+    command_line::add_arg(desc, arg_verify_history);
+    command_line::add_arg(desc, arg_verify_history_rate);
+    command_line::add_arg(desc, arg_verify_history_halt);
     command_line::add_arg(desc, arg_reorg_notify);
     command_line::add_arg(desc, arg_block_rate_notify);
+    command_line::add_arg(desc, arg_light_wallet_scanner_max_accounts);
     command_line::add_arg(desc, arg_keep_alt_blocks);
+    command_line::add_arg(desc, arg_check_ybi_cache);
+    command_line::add_arg(desc, arg_rct_ver_cache_size);
+    command_line::add_arg(desc, arg_output_distribution_cache_max_bytes);
 
     miner::init_options(desc);
     BlockchainDB::init_options(desc);
@@ -391,7 +479,8 @@ namespace cryptonote
     set_enforce_dns_checkpoints(command_line::get_arg(vm, arg_dns_checkpoints));
     test_drop_download_height(command_line::get_arg(vm, arg_test_drop_download_height));
     m_fluffy_blocks_enabled = !get_arg(vm, arg_no_fluffy_blocks);
-    m_offline = get_arg(vm, arg_offline);
+    m_read_replica = get_arg(vm, arg_read_replica);
+    m_offline = get_arg(vm, arg_offline) || m_read_replica;
     m_disable_dns_checkpoints = get_arg(vm, arg_disable_dns_checkpoints);
 
     if (!command_line::is_arg_defaulted(vm, arg_fluffy_blocks))
@@ -481,14 +570,26 @@ namespace cryptonote
 
     std::string db_sync_mode = command_line::get_arg(vm, cryptonote::arg_db_sync_mode);
     bool db_salvage = command_line::get_arg(vm, cryptonote::arg_db_salvage) != 0;
+    const std::string db_cold_path = command_line::get_arg(vm, cryptonote::arg_db_cold_path);
+    const bool db_tx_index = command_line::get_arg(vm, cryptonote::arg_db_tx_index);
     bool fast_sync = command_line::get_arg(vm, arg_fast_block_sync) != 0;
     uint64_t blocks_threads = command_line::get_arg(vm, arg_prep_blocks_threads);
     std::string check_updates_string = command_line::get_arg(vm, arg_check_updates);
     size_t max_txpool_weight = command_line::get_arg(vm, arg_max_txpool_weight);
     bool prune_blockchain = command_line::get_arg(vm, arg_prune_blockchain);
+    bool prune_blockchain_background = command_line::get_arg(vm, arg_prune_blockchain_background);
+    m_background_pruning_rate = std::max<uint64_t>(1, command_line::get_arg(vm, arg_prune_blockchain_rate));
+    m_history_verification_rate = std::max<uint64_t>(1, command_line::get_arg(vm, arg_verify_history_rate));
+    m_history_verification_halt = command_line::get_arg(vm, arg_verify_history_halt);
     bool keep_alt_blocks = command_line::get_arg(vm, arg_keep_alt_blocks);
     bool keep_fakechain = command_line::get_arg(vm, arg_keep_fakechain);
 
+    if (m_read_replica && (prune_blockchain || prune_blockchain_background))
+    {
+      MERROR("--" << arg_read_replica.name << " cannot prune the database it follows");
+      return false;
+    }
+
     boost::filesystem::path folder(m_config_folder);
     if (m_nettype == FAKECHAIN)
       folder /= "fake";
@@ -621,7 +722,11 @@ namespace cryptonote
 
       if (db_salvage)
         db_flags |= DBF_SALVAGE;
+      if (m_read_replica)
+        db_flags |= DBF_RDONLY;
 
+      db->set_cold_storage_path(db_cold_path);
+      db->set_tx_index(db_tx_index);
       db->open(filename, db_flags);
       if(!db->m_open)
         return false;
@@ -638,20 +743,7 @@ namespace cryptonote
     try
     {
       if (!command_line::is_arg_defaulted(vm, arg_block_notify))
-      {
-        struct hash_notify
-        {
-          tools::Notify cmdline;
-
-          void operator()(std::uint64_t, epee::span<const block> blocks) const
-          {
-            for (const block& bl : blocks)
-              cmdline.notify("%s", epee::string_tools::pod_to_hex(get_block_hash(bl)).c_str(), NULL);
-          }
-        };
-
-        m_blockchain_storage.add_block_notify(hash_notify{{command_line::get_arg(vm, arg_block_notify).c_str()}});
-      }
+        m_blockchain_storage.set_block_notify(std::make_shared<tools::Notify>(command_line::get_arg(vm, arg_block_notify).c_str()));
     }
     catch (const std::exception &e)
     {
@@ -678,26 +770,56 @@ namespace cryptonote
       MERROR("Failed to parse block rate notify spec: " << e.what());
     }
 
+    const uint64_t light_wallet_max_accounts = command_line::get_arg(vm, arg_light_wallet_scanner_max_accounts);
+    if (light_wallet_max_accounts)
+    {
+      m_light_wallet_scanner.start([this](const std::vector<crypto::hash>& ids, std::vector<transaction>& txs) {
+        std::vector<crypto::hash> missed;
+        return get_transactions(ids, txs, missed) && missed.empty();
+      }, light_wallet_max_accounts);
+      m_blockchain_storage.add_block_notify([this](uint64_t height, epee::span<const block> blocks) {
+        m_light_wallet_scanner.notify_block(height, blocks);
+      });
+      MINFO("Light wallet scanner enabled for up to " << light_wallet_max_accounts << " accounts");
+    }
+
     const std::pair<uint8_t, uint64_t> regtest_hard_forks[3] = {std::make_pair(1, 0), std::make_pair(mainnet_hard_forks[num_mainnet_hard_forks-1].version, 1), std::make_pair(0, 0)};
     const cryptonote::test_options regtest_test_options = {
       regtest_hard_forks,
       0
     };
     const difficulty_type fixed_difficulty = command_line::get_arg(vm, arg_fixed_difficulty);
+    TIME_MEASURE_START(blockchain_init_time);
     r = m_blockchain_storage.init(db.release(), m_nettype, m_offline, regtest ? &regtest_test_options : test_options, fixed_difficulty, get_checkpoints);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
+    TIME_MEASURE_FINISH(blockchain_init_time);
+    MGINFO("Blockchain storage initialized in " << blockchain_init_time << " ms");
 
+    TIME_MEASURE_START(mempool_init_time);
     r = m_mempool.init(max_txpool_weight, m_nettype == FAKECHAIN);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize memory pool");
+    TIME_MEASURE_FINISH(mempool_init_time);
+    MGINFO("Memory pool initialized in " << mempool_init_time << " ms");
 
     // now that we have a valid m_blockchain_storage, we can clean out any
-    // transactions in the pool that do not conform to the current fork
-    m_mempool.validate(m_blockchain_storage.get_current_hard_fork_version());
+    // transactions in the pool that do not conform to the current fork.
+    // This re-verifies every pool tx, so it runs once P2P and RPC are up
+    // rather than holding up startup; the regtest/test chains keep it inline
+    // A read replica leaves that to the daemon which owns the db
+    if (m_nettype == FAKECHAIN)
+      m_mempool.validate(m_blockchain_storage.get_current_hard_fork_version());
+    else if (!m_read_replica)
+      m_blockchain_storage.validate_txpool_async();
 
     bool show_time_stats = command_line::get_arg(vm, arg_show_time_stats) != 0;
     m_blockchain_storage.set_show_time_stats(show_time_stats);
+    m_blockchain_storage.set_rct_ver_cache_size(command_line::get_arg(vm, arg_rct_ver_cache_size));
+    m_blockchain_storage.set_output_distribution_cache_max_bytes(command_line::get_arg(vm, arg_output_distribution_cache_max_bytes));
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
 
+    if (command_line::get_arg(vm, arg_check_ybi_cache))
+      m_blockchain_storage.check_ybi_cache_async();
+
     block_sync_size = command_line::get_arg(vm, arg_block_sync_size);
     if (block_sync_size > BLOCKS_SYNCHRONIZING_MAX_COUNT)
       MERROR("Error --block-sync-size cannot be greater than " << BLOCKS_SYNCHRONIZING_MAX_COUNT);
@@ -707,7 +829,10 @@ namespace cryptonote
     // load json & DNS checkpoints, and verify them
     // with respect to what blocks we already have
     const bool skip_dns_checkpoints = !command_line::get_arg(vm, arg_dns_checkpoints);
+    TIME_MEASURE_START(checkpoints_time);
     CHECK_AND_ASSERT_MES(update_checkpoints(skip_dns_checkpoints), false, "One or more checkpoints loaded from json or dns conflicted with existing checkpoints.");
+    TIME_MEASURE_FINISH(checkpoints_time);
+    MGINFO("Checkpoints loaded in " << checkpoints_time << " ms");
 
    // DNS versions checking
     if (check_updates_string == "disabled" || not allow_dns)
@@ -729,7 +854,15 @@ namespace cryptonote
     if (!keep_alt_blocks && !m_blockchain_storage.get_db().is_read_only())
       m_blockchain_storage.get_db().drop_alt_blocks();
 
-    if (prune_blockchain)
+    if (command_line::get_arg(vm, arg_verify_history))
+      start_history_verification();
+
+    if (prune_blockchain_background)
+    {
+      // a full pass every start, since the seed alone can't tell an interrupted pass from a finished one
+      CHECK_AND_ASSERT_MES(start_background_pruning(), false, "Failed to start background blockchain pruning");
+    }
+    else if (prune_blockchain)
     {
       // display a message if the blockchain is not pruned yet
       if (!m_blockchain_storage.get_blockchain_pruning_seed())
@@ -760,7 +893,9 @@ namespace cryptonote
     bool core::deinit()
   {
     m_miner.stop();
+    m_light_wallet_scanner.stop();
     m_mempool.deinit();
+    m_dns_checkpoints.reset();
     m_blockchain_storage.deinit();
     return true;
   }
@@ -902,6 +1037,21 @@ namespace cryptonote
     return true;
   }
   //-----------------------------------------------------------------------------------------------
+  static uint64_t get_rct_amount_burnt(const transaction &tx)
+  {
+    // the burnt amount leaves the commitment balance for these tx types only
+    switch (tx.type)
+    {
+      case cryptonote::transaction_type::BURN:
+      case cryptonote::transaction_type::CONVERT:
+      case cryptonote::transaction_type::STAKE:
+      case cryptonote::transaction_type::AUDIT:
+        return tx.amount_burnt;
+      default:
+        return 0;
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::handle_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool keeped_by_block)
   {
     bool ret = true;
@@ -912,6 +1062,7 @@ namespace cryptonote
     }
 
     std::vector<const rct::rctSig*> rvv;
+    std::vector<uint64_t> amounts_burnt;
     for (size_t n = 0; n < tx_info.size(); ++n)
     {
       if (!check_tx_semantic(*tx_info[n].tx, keeped_by_block))
@@ -960,13 +1111,7 @@ namespace cryptonote
           tx_info[n].result = false;
           break;
         case rct::RCTTypeSimple:
-          if (!rct::verRctSemanticsSimple(rv,
-                                          tx_info[n].tx->type == cryptonote::transaction_type::BURN ? tx_info[n].tx->amount_burnt :
-                                          tx_info[n].tx->type == cryptonote::transaction_type::CONVERT ? tx_info[n].tx->amount_burnt :
-                                          tx_info[n].tx->type == cryptonote::transaction_type::STAKE ? tx_info[n].tx->amount_burnt :
-                                          tx_info[n].tx->type == cryptonote::transaction_type::AUDIT ? tx_info[n].tx->amount_burnt :
-                                          0
-                                          ))
+          if (!rct::verRctSemanticsSimple(rv, get_rct_amount_burnt(*tx_info[n].tx)))
           {
             MERROR_VER("rct signature semantics check failed");
             set_semantics_failed(tx_info[n].tx_hash);
@@ -997,6 +1142,7 @@ namespace cryptonote
             break;
           }
           rvv.push_back(&rv); // delayed batch verification
+          amounts_burnt.push_back(get_rct_amount_burnt(*tx_info[n].tx));
           break;
         case rct::RCTTypeBulletproofPlus:
         case rct::RCTTypeFullProofs:
@@ -1011,6 +1157,7 @@ namespace cryptonote
             break;
           }
           rvv.push_back(&rv); // delayed batch verification
+          amounts_burnt.push_back(get_rct_amount_burnt(*tx_info[n].tx));
           break;
         default:
           MERROR_VER("Unknown rct type: " << rv.type);
@@ -1021,6 +1168,13 @@ namespace cryptonote
       }
     }
     if (!rvv.empty())
+    {
+      // Verify the range proofs of the whole batch with a single multiexp, and
+      // only fall back to checking one at a time to find the culprit(s)
+      if (rct::verRctSemanticsSimple(rvv, amounts_burnt))
+        return ret;
+    }
+    if (!rvv.empty())
     {
       LOG_PRINT_L1("Verifying transactions one at a time");
       ret = false;
@@ -1030,13 +1184,7 @@ namespace cryptonote
           continue;
         if (tx_info[n].tx->rct_signatures.type != rct::RCTTypeBulletproof && tx_info[n].tx->rct_signatures.type != rct::RCTTypeBulletproof2 && tx_info[n].tx->rct_signatures.type != rct::RCTTypeCLSAG && tx_info[n].tx->rct_signatures.type != rct::RCTTypeBulletproofPlus && tx_info[n].tx->rct_signatures.type != rct::RCTTypeFullProofs && tx_info[n].tx->rct_signatures.type != rct::RCTTypeSalviumZero && tx_info[n].tx->rct_signatures.type != rct::RCTTypeSalviumOne)
           continue;
-        if (!rct::verRctSemanticsSimple(tx_info[n].tx->rct_signatures,
-                                        tx_info[n].tx->type == cryptonote::transaction_type::BURN ? tx_info[n].tx->amount_burnt :
-                                        tx_info[n].tx->type == cryptonote::transaction_type::CONVERT ? tx_info[n].tx->amount_burnt :
-                                        tx_info[n].tx->type == cryptonote::transaction_type::STAKE ? tx_info[n].tx->amount_burnt :
-                                        tx_info[n].tx->type == cryptonote::transaction_type::AUDIT ? tx_info[n].tx->amount_burnt :
-                                        0
-                                        ))
+        if (!rct::verRctSemanticsSimple(tx_info[n].tx->rct_signatures, get_rct_amount_burnt(*tx_info[n].tx)))
         {
           set_semantics_failed(tx_info[n].tx_hash);
           tx_info[n].tvc.m_verifivation_failed = true;
@@ -1058,12 +1206,21 @@ namespace cryptonote
       return false;
     }
 
+    if (m_read_replica)
+    {
+      MERROR("Read replica cannot accept transactions, submit them to the primary daemon");
+      for (tx_verification_context &ctx: tvc)
+        ctx.m_verifivation_failed = true;
+      return false;
+    }
+
     std::vector<txpool_event> results(tx_blobs.size());
 
     CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
 
     tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
     tools::threadpool::waiter waiter(tpool);
+    PERF_TIMER_START(incoming_txs_parse);
     epee::span<tx_blob_entry>::const_iterator it = tx_blobs.begin();
     for (size_t i = 0; i < tx_blobs.size(); i++, ++it) {
       tpool.submit(&waiter, [&, i, it] {
@@ -1096,6 +1253,11 @@ namespace cryptonote
         LOG_PRINT_L2("tx " << results[i].hash << " already have transaction in blockchain");
         already_have[i] = true;
       }
+      else if(tx_relay != relay_method::block && check_inputs_types_supported(results[i].tx) && m_mempool.check_double_spend(results[i].tx, results[i].hash, tvc[i]))
+      {
+        // no point verifying proofs of a tx the pool would refuse anyway
+        results[i].res = false;
+      }
       else
       {
         tpool.submit(&waiter, [&, i, it] {
@@ -1114,7 +1276,9 @@ namespace cryptonote
     }
     if (!waiter.wait())
       return false;
+    PERF_TIMER_STOP(incoming_txs_parse);
 
+    PERF_TIMER_START(incoming_txs_verify);
     std::vector<tx_verification_batch_info> tx_info;
     tx_info.reserve(tx_blobs.size());
     for (size_t i = 0; i < tx_blobs.size(); i++) {
@@ -1124,7 +1288,9 @@ namespace cryptonote
     }
     if (!tx_info.empty())
       handle_incoming_tx_accumulated_batch(tx_info, tx_relay == relay_method::block);
+    PERF_TIMER_STOP(incoming_txs_verify);
 
+    PERF_TIMER_START(incoming_txs_add);
     bool valid_events = false;
     bool ok = true;
     it = tx_blobs.begin();
@@ -1259,14 +1425,16 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------
   bool core::are_key_images_spent(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent) const
   {
-    spent.clear();
-    for(auto& ki: key_im)
-    {
-      spent.push_back(m_blockchain_storage.have_tx_keyimg_as_spent(ki));
-    }
+    // most of these are answered by the key image filter, the rest are probed in storage order
+    m_blockchain_storage.have_key_images_as_spent(epee::to_span(key_im), spent);
     return true;
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::is_block_sync_size_fixed() const
+  {
+    return block_sync_size > 0;
+  }
+  //-----------------------------------------------------------------------------------------------
   size_t core::get_block_sync_size(uint64_t height) const
   {
     static const uint64_t quick_height = m_nettype == TESTNET ? 801219 : m_nettype == MAINNET ? 1220516 : 0;
@@ -1308,40 +1476,78 @@ namespace cryptonote
     return res;
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::are_key_images_spent_in_pool(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent) const
+  bool core::are_key_images_spent_in_pool(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent, bool include_sensitive_txes) const
   {
     spent.clear();
 
-    return m_mempool.check_for_key_images(key_im, spent);
+    return m_mempool.check_for_key_images(key_im, spent, include_sensitive_txes);
   }
   //-----------------------------------------------------------------------------------------------
-  std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t> core::get_coinbase_tx_sum(const uint64_t start_offset, const size_t count)
+  std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t> core::get_coinbase_tx_sum(const uint64_t start_offset, const size_t count, std::vector<emission_totals_asset> *assets_out)
   {
-    boost::multiprecision::uint128_t emission_amount = 0;
+    boost::multiprecision::uint128_t coinbase_amount = 0;
     boost::multiprecision::uint128_t total_fee_amount = 0;
-    if (count)
+    std::vector<emission_totals_asset> local_assets;
+    std::vector<emission_totals_asset> &assets = assets_out ? *assets_out : local_assets;
+    get_emission_totals(start_offset, count, assets);
+    for (const auto &asset: assets)
+    {
+      coinbase_amount += asset.coinbase;
+      total_fee_amount += asset.fees;
+    }
+    // the miner tx pays out the fees, which are not emission
+    const boost::multiprecision::uint128_t emission_amount = coinbase_amount > total_fee_amount ? coinbase_amount - total_fee_amount : 0;
+    return std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t>(emission_amount, total_fee_amount);
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::get_emission_totals(const uint64_t start_offset, const size_t count, std::vector<emission_totals_asset>& assets)
+  {
+    assets.clear();
+    if (!count)
+      return;
+    const uint64_t end = start_offset + count - 1;
+
+    BlockchainDB &db = m_blockchain_storage.get_db();
     {
-      const uint64_t end = start_offset + count - 1;
-      m_blockchain_storage.for_blocks_range(start_offset, end,
-        [this, &emission_amount, &total_fee_amount](uint64_t, const crypto::hash& hash, const block& b){
+      db_rtxn_guard rtxn_guard(&db);
+      block_emission_totals last, before;
+      if (db.get_block_emission_totals(end, last) && start_offset >= last.first_height)
+      {
+        if (start_offset == last.first_height)
+        {
+          assets = std::move(last.assets);
+          return;
+        }
+        if (db.get_block_emission_totals(start_offset - 1, before) && before.first_height == last.first_height)
+        {
+          // sums only grow, and an asset type never leaves the list once in it
+          for (auto &asset: last.assets)
+          {
+            const emission_totals_asset &prev = before.get(asset.asset_type);
+            asset.coinbase -= prev.coinbase;
+            asset.fees -= prev.fees;
+            asset.burnt -= prev.burnt;
+            asset.protocol -= prev.protocol;
+          }
+          assets = std::move(last.assets);
+          return;
+        }
+      }
+    }
+
+    // blocks synced before the sums were stored
+    block_emission_totals totals = AUTO_VAL_INIT(totals);
+    m_blockchain_storage.for_blocks_range(start_offset, end,
+      [this, &totals](uint64_t, const crypto::hash& hash, const block& b){
       std::vector<transaction> txs;
       std::vector<crypto::hash> missed_txs;
-      uint64_t coinbase_amount = get_outs_money_amount(b.miner_tx);
-      coinbase_amount += b.miner_tx.amount_burnt;
+      add_block_emission(b, totals);
       this->get_transactions(b.tx_hashes, txs, missed_txs, true);
-      uint64_t tx_fee_amount = 0;
       for(const auto& tx: txs)
-      {
-        tx_fee_amount += get_tx_fee(tx);
-      }
-      
-      emission_amount += coinbase_amount - tx_fee_amount;
-      total_fee_amount += tx_fee_amount;
+        add_tx_emission(tx, totals);
       return true;
-      });
-    }
-
-    return std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t>(emission_amount, total_fee_amount);
+    });
+    assets = std::move(totals.assets);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::check_tx_inputs_keyimages_diff(const transaction& tx) const
@@ -1537,6 +1743,11 @@ namespace cryptonote
     return m_blockchain_storage.get_miner_data(major_version, height, prev_id, seed_hash, difficulty, median_weight, already_generated_coins, tx_backlog);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, uint64_t since_backlog_version, tx_block_template_backlog_diff& tx_backlog)
+  {
+    return m_blockchain_storage.get_miner_data(major_version, height, prev_id, seed_hash, difficulty, median_weight, already_generated_coins, since_backlog_version, tx_backlog);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, bool clip_pruned, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp) const
   {
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, clip_pruned, resp);
@@ -1606,6 +1817,11 @@ namespace cryptonote
       m_miner.resume();
       return false;
     }
+    // txes we never broadcast (eg, mined while still in stem phase) can't be in peers' pools
+    std::vector<size_t> prefill_tx_indices;
+    for (size_t i = 0; i < b.tx_hashes.size(); ++i)
+      if (!m_mempool.have_tx(b.tx_hashes[i], relay_category::broadcasted))
+        prefill_tx_indices.push_back(i);
     std::vector<block> pblocks;
     if (!prepare_handle_incoming_blocks(blocks, pblocks))
     {
@@ -1642,7 +1858,7 @@ namespace cryptonote
       for(auto& tx:  txs)
         arg.b.txs.push_back({tx, crypto::null_hash});
 
-      m_pprotocol->relay_block(arg, exclude_context);
+      m_pprotocol->relay_block(arg, exclude_context, prefill_tx_indices);
     }
     return true;
   }
@@ -1698,6 +1914,13 @@ namespace cryptonote
 
     bvc = {};
 
+    if (m_read_replica)
+    {
+      MERROR("Read replica cannot accept blocks, submit them to the primary daemon");
+      bvc.m_verifivation_failed = true;
+      return false;
+    }
+
     if (!check_incoming_block_size(block_blob))
     {
       bvc.m_verifivation_failed = true;
@@ -1758,6 +1981,16 @@ namespace cryptonote
     return m_mempool.get_transactions_count(include_sensitive_txes);
   }
   //-----------------------------------------------------------------------------------------------
+  uint64_t core::get_pool_cookie() const
+  {
+    return m_mempool.cookie();
+  }
+  //-----------------------------------------------------------------------------------------------
+  size_t core::get_pool_weight() const
+  {
+    return m_mempool.get_txpool_weight();
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::have_block_unlocked(const crypto::hash& id, int *where) const
   {
     return m_blockchain_storage.have_block_unlocked(id, where);
@@ -1862,7 +2095,9 @@ namespace cryptonote
     if(!m_starter_message_showed)
     {
       std::string main_message;
-      if (m_offline)
+      if (m_read_replica)
+        main_message = "The daemon is running as a read replica, following the blockchain another daemon writes to this data directory.";
+      else if (m_offline)
         main_message = "The daemon is running offline and will not attempt to sync to the Salvium network.";
       else
         main_message = "The daemon will start synchronizing with the network. This may take a long time to complete.";
@@ -1878,12 +2113,28 @@ namespace cryptonote
       m_starter_message_showed = true;
     }
 
+    if (m_read_replica)
+    {
+      // everything below writes to the db, which is the primary daemon's job
+      m_read_replica_interval.do_call(boost::bind(&core::refresh_read_replica, this));
+      m_check_updates_interval.do_call(boost::bind(&core::check_updates, this));
+      m_long_read_txn_interval.do_call(boost::bind(&core::check_long_read_txns, this));
+      if (m_history_verification)
+        m_history_verification_interval.do_call(boost::bind(&core::history_verification_step, this));
+      return true;
+    }
+
     relay_txpool_transactions(); // txpool handles periodic DB checking
     m_check_updates_interval.do_call(boost::bind(&core::check_updates, this));
     m_check_disk_space_interval.do_call(boost::bind(&core::check_disk_space, this));
+    m_long_read_txn_interval.do_call(boost::bind(&core::check_long_read_txns, this));
     m_block_rate_interval.do_call(boost::bind(&core::check_block_rate, this));
     m_blockchain_pruning_interval.do_call(boost::bind(&core::update_blockchain_pruning, this));
+    if (m_background_pruning)
+      m_background_pruning_interval.do_call(boost::bind(&core::background_pruning_step, this));
     m_diff_recalc_interval.do_call(boost::bind(&core::recalculate_difficulties, this));
+    if (m_history_verification)
+      m_history_verification_interval.do_call(boost::bind(&core::history_verification_step, this));
     m_miner.on_idle();
     m_mempool.on_idle();
     return true;
@@ -2146,6 +2397,22 @@ namespace cryptonote
     return m_mempool.get_complement(hashes, txes);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::refresh_read_replica()
+  {
+    try
+    {
+      // the pool is only re-read when a block comes in, so it may lag the primary's by a block
+      if (m_blockchain_storage.refresh_from_db())
+        return m_mempool.reload();
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to refresh from the database: " << e.what());
+      return false;
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::update_blockchain_pruning()
   {
     return m_blockchain_storage.update_blockchain_pruning();
@@ -2156,6 +2423,117 @@ namespace cryptonote
     return m_blockchain_storage.check_blockchain_pruning();
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::check_long_read_txns()
+  {
+    m_blockchain_storage.get_db().report_long_read_txns(LONG_READ_TXN_WARN_SECONDS);
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::start_background_pruning()
+  {
+    if (m_blockchain_storage.get_db().is_read_only())
+    {
+      MERROR("Cannot prune a read only blockchain");
+      return false;
+    }
+    if (!m_background_pruning)
+      MGINFO("Pruning blockchain in the background, " << m_background_pruning_rate << " transactions per second");
+    m_background_pruning = true;
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::background_pruning_step()
+  {
+    try
+    {
+      if (m_blockchain_storage.prune_blockchain_step(m_background_pruning_rate))
+      {
+        MGINFO("Background blockchain pruning finished");
+        m_background_pruning = false;
+      }
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Background blockchain pruning failed: " << e.what());
+      m_background_pruning = false;
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::start_history_verification()
+  {
+    if (!m_history_verification)
+      MGINFO("Verifying stored blocks in the background, " << m_history_verification_rate << " blocks per second");
+    m_history_verified_height = 0;
+    m_history_verification_failed = false;
+    m_history_verification = true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::history_verification_step()
+  {
+    uint64_t height = m_history_verified_height;
+    std::string error;
+    bool r;
+    try
+    {
+      r = m_blockchain_storage.verify_history_step(height, m_history_verification_rate, error);
+    }
+    catch (const std::exception &e)
+    {
+      r = false;
+      error = e.what();
+    }
+    m_history_verified_height = height;
+
+    if (!r)
+    {
+      MCLOG_RED(el::Level::Error, "global", "Background history verification failed at block " << height << ": " << error);
+      m_history_verification_failed = true;
+      m_history_verification = false;
+      if (m_history_verification_halt)
+      {
+        MCLOG_RED(el::Level::Error, "global", "Stopping the daemon, the local blockchain can't be trusted");
+        graceful_exit();
+      }
+    }
+    else if (height >= m_blockchain_storage.get_current_blockchain_height())
+    {
+      // blocks from here on were verified as they were added
+      MGINFO_GREEN("Background history verification finished, " << height << " blocks checked");
+      m_history_verification = false;
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::compact_blockchain(std::string &path)
+  {
+    BlockchainDB &db = m_blockchain_storage.get_db();
+    const boost::filesystem::path dir = boost::filesystem::path(m_config_folder) / (db.get_db_name() + "-compacted");
+    boost::system::error_code ec;
+    if (boost::filesystem::exists(dir, ec) && !boost::filesystem::is_empty(dir, ec))
+    {
+      MERROR("Compacted blockchain directory is not empty: " << dir.string());
+      return false;
+    }
+    if (!boost::filesystem::create_directories(dir, ec) && ec)
+    {
+      MERROR("Failed to create directory " << dir.string() << ": " << ec.message());
+      return false;
+    }
+    try
+    {
+      db.copy_compacted(dir.string());
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to compact blockchain: " << e.what());
+      return false;
+    }
+    path = dir.string();
+    MGINFO("Compacted blockchain written to " << path << ", swap it in for the live database while the daemon is stopped");
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
   void core::set_target_blockchain_height(uint64_t target_blockchain_height)
   {
     m_target_blockchain_height = target_blockchain_height;
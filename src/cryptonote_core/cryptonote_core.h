@@ -31,6 +31,7 @@
 #pragma once
 
 #include <ctime>
+#include <memory>
 
 #include <boost/function.hpp>
 #include <boost/program_options/options_description.hpp>
@@ -43,6 +44,7 @@
 #include "common/download.h"
 #include "common/command_line.h"
 #include "blockchain_and_pool.h"
+#include "light_wallet_scanner.h"
 #include "cryptonote_basic/miner.h"
 #include "cryptonote_basic/connection_context.h"
 #include "warnings.h"
@@ -68,6 +70,7 @@ namespace cryptonote
   extern const command_line::arg_descriptor<bool, false> arg_regtest_on;
   extern const command_line::arg_descriptor<difficulty_type> arg_fixed_difficulty;
   extern const command_line::arg_descriptor<bool> arg_offline;
+  extern const command_line::arg_descriptor<bool> arg_read_replica;
   extern const command_line::arg_descriptor<size_t> arg_block_download_max_size;
   extern const command_line::arg_descriptor<bool> arg_sync_pruned_blocks;
 
@@ -240,6 +243,7 @@ namespace cryptonote
       * @note see Blockchain::get_miner_data
       */
      bool get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, std::vector<tx_block_template_backlog_entry>& tx_backlog);
+     bool get_miner_data(uint8_t& major_version, uint64_t& height, crypto::hash& prev_id, crypto::hash& seed_hash, difficulty_type& difficulty, uint64_t& median_weight, uint64_t& already_generated_coins, uint64_t since_backlog_version, tx_block_template_backlog_diff& tx_backlog);
 
      /**
       * @brief called when a transaction is relayed.
@@ -563,6 +567,20 @@ namespace cryptonote
       */
      size_t get_pool_transactions_count(bool include_sensitive_txes = false) const;
 
+     /**
+      * @copydoc tx_memory_pool::cookie
+      *
+      * @note see tx_memory_pool::cookie
+      */
+     uint64_t get_pool_cookie() const;
+
+     /**
+      * @copydoc tx_memory_pool::get_txpool_weight
+      *
+      * @note see tx_memory_pool::get_txpool_weight
+      */
+     size_t get_pool_weight() const;
+
      /**
       * @copydoc Blockchain::get_total_transactions
       *
@@ -663,6 +681,13 @@ namespace cryptonote
       */
      const Blockchain& get_blockchain_storage()const{return m_blockchain_storage;}
 
+     /**
+      * @brief gets the light wallet scanner
+      *
+      * @return a reference to the scanner, which is only running if enabled on the command line
+      */
+     light_wallet_scanner& get_light_wallet_scanner(){return m_light_wallet_scanner;}
+
      /**
       * @copydoc tx_memory_pool::print_pool
       *
@@ -744,7 +769,9 @@ namespace cryptonote
       *
       * This function will check if enough time has passed since the last
       * time checkpoints were updated and tell the Blockchain to update
-      * its checkpoints if it is time.  If updating checkpoints fails,
+      * its checkpoints if it is time.  DNS checkpoints are looked up in
+      * the background and applied once a new result is cached, so this
+      * never waits on the resolver.  If updating checkpoints fails,
       * the daemon is told to shut down.
       *
       * @note see Blockchain::update_checkpoints()
@@ -790,10 +817,11 @@ namespace cryptonote
       *
       * @param key_im list of key images to check
       * @param spent return-by-reference result for each image checked
+      * @param include_sensitive_txes include txes not broadcast yet
       *
       * @return true
       */
-     bool are_key_images_spent_in_pool(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent) const;
+     bool are_key_images_spent_in_pool(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent, bool include_sensitive_txes = false) const;
 
      /**
       * @brief get the number of blocks to sync in one go
@@ -802,12 +830,33 @@ namespace cryptonote
       */
      size_t get_block_sync_size(uint64_t height) const;
 
+     /**
+      * @brief check whether the block sync size was set by the user
+      *
+      * @return true if --block-sync-size was given, false if the default is in use
+      */
+     bool is_block_sync_size_fixed() const;
+
      /**
       * @brief get the sum of coinbase tx amounts between blocks
       *
-      * @return the number of blocks to sync in one go
+      * @param assets if not NULL, return-by-reference the sums per asset type, see get_emission_totals
+      *
+      * @return the emission and the fees over the blocks
       */
-     std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t> get_coinbase_tx_sum(const uint64_t start_offset, const size_t count);
+     std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t> get_coinbase_tx_sum(const uint64_t start_offset, const size_t count, std::vector<emission_totals_asset> *assets = NULL);
+
+     /**
+      * @brief get the emission and fee sums of a range of blocks, per asset type
+      *
+      * The stored running sums make this two lookups; ranges reaching below
+      * the first block the sums were stored for are walked block by block.
+      *
+      * @param start_offset the first block of the range
+      * @param count the number of blocks in the range
+      * @param assets return-by-reference the sums over the range
+      */
+     void get_emission_totals(const uint64_t start_offset, const size_t count, std::vector<emission_totals_asset>& assets);
      
      /**
       * @brief get the network type we're on
@@ -854,6 +903,13 @@ namespace cryptonote
       */
      bool offline() const { return m_offline; }
 
+     /**
+      * @brief get whether the core serves a database another daemon writes
+      *
+      * @return whether the core is running as a read replica
+      */
+     bool read_replica() const { return m_read_replica; }
+
      /**
       * @brief get the blockchain pruning seed
       *
@@ -884,6 +940,64 @@ namespace cryptonote
       */
      bool check_blockchain_pruning();
 
+     /**
+      * @brief starts pruning the blockchain a little at a time from the idle loop
+      *
+      * Each second, at most the --prune-blockchain-rate number of transactions
+      * are visited, holding the blockchain lock only for that long.
+      *
+      * @return false if the blockchain is read only
+      */
+     bool start_background_pruning();
+
+     /**
+      * @brief checks whether background pruning is still running
+      *
+      * @return true iff it is
+      */
+     bool is_background_pruning() const { return m_background_pruning; }
+
+     /**
+      * @brief starts re-checking stored blocks from genesis from the idle loop
+      *
+      * Each second, at most the --verify-history-rate number of blocks are
+      * checked, see Blockchain::verify_history_step.
+      */
+     void start_history_verification();
+
+     /**
+      * @brief checks whether background history verification is still running
+      *
+      * @return true iff it is
+      */
+     bool is_verifying_history() const { return m_history_verification; }
+
+     /**
+      * @brief gets the height up to which stored blocks were re-checked
+      *
+      * @return the number of blocks checked from genesis
+      */
+     uint64_t get_history_verified_height() const { return m_history_verified_height; }
+
+     /**
+      * @brief checks whether background history verification found a bad block
+      *
+      * @return true iff it did
+      */
+     bool has_history_verification_failed() const { return m_history_verification_failed; }
+
+     /**
+      * @brief writes a compacted copy of the blockchain next to the live one
+      *
+      * Pruning only marks space as free in the database file; the copy leaves
+      * it out, and can replace the live database while the daemon is stopped.
+      *
+      * @param path return-by-reference the directory the copy was written to
+      *
+      * @return true on success, false otherwise
+      */
+     bool compact_blockchain(std::string &path);
+
      /**
       * @brief checks whether a given block height is included in the precompiled block hash area
       *
@@ -1079,6 +1193,27 @@ namespace cryptonote
       */
      bool check_disk_space();
 
+     /**
+      * @brief logs db read txns that have been held for too long
+      *
+      * @return true
+      */
+     bool check_long_read_txns();
+
+     /**
+      * @brief runs one step of background pruning, stopping it when done
+      *
+      * @return true
+      */
+     bool background_pruning_step();
+
+     /**
+      * @brief runs one step of background history verification, stopping it when done or on failure
+      *
+      * @return true
+      */
+     bool history_verification_step();
+
      /**
       * @brief checks block rate, and warns if it's too slow
       *
@@ -1093,6 +1228,13 @@ namespace cryptonote
       */
      bool recalculate_difficulties();
 
+     /**
+      * @brief picks up the blocks and pool txes the primary daemon has written to the db
+      *
+      * @return true on success, false otherwise
+      */
+     bool refresh_read_replica();
+
      bool m_test_drop_download = true; //!< whether or not to drop incoming blocks (for testing)
 
      uint64_t m_test_drop_download_height = 0; //!< height under which to drop incoming blocks, if doing so
@@ -1101,6 +1243,8 @@ namespace cryptonote
      tx_memory_pool& m_mempool; //!< transaction pool instance
      Blockchain& m_blockchain_storage; //!< Blockchain instance
 
+     light_wallet_scanner m_light_wallet_scanner; //!< server-side view scanning for light wallets
+
      i_cryptonote_protocol* m_pprotocol; //!< cryptonote protocol instance
 
      epee::critical_section m_incoming_tx_lock; //!< incoming transaction lock
@@ -1116,12 +1260,25 @@ namespace cryptonote
      epee::math_helper::once_a_time_seconds<60*60*2, true> m_fork_moaner; //!< interval for checking HardFork status
      epee::math_helper::once_a_time_seconds<60*60*12, true> m_check_updates_interval; //!< interval for checking for new versions
      epee::math_helper::once_a_time_seconds<60*10, true> m_check_disk_space_interval; //!< interval for checking for disk space
+     epee::math_helper::once_a_time_seconds<60, true> m_long_read_txn_interval; //!< interval for checking for long held db read txns
      epee::math_helper::once_a_time_seconds<90, false> m_block_rate_interval; //!< interval for checking block rate
      epee::math_helper::once_a_time_seconds<60*60*5, true> m_blockchain_pruning_interval; //!< interval for incremental blockchain pruning
+     epee::math_helper::once_a_time_seconds<1, true> m_background_pruning_interval; //!< interval for background blockchain pruning steps
+     epee::math_helper::once_a_time_seconds<1, true> m_history_verification_interval; //!< interval for background history verification steps
      epee::math_helper::once_a_time_seconds<60*60*24*7, false> m_diff_recalc_interval; //!< interval for recalculating difficulties
+     epee::math_helper::once_a_time_seconds<1, true> m_read_replica_interval; //!< interval for picking up blocks written by the primary daemon
 
      std::atomic<bool> m_starter_message_showed; //!< has the "daemon will sync now" message been shown?
 
+     std::atomic<bool> m_background_pruning; //!< is background pruning running?
+     size_t m_background_pruning_rate; //!< transactions visited per background pruning step
+
+     std::atomic<bool> m_history_verification; //!< is background history verification running?
+     std::atomic<bool> m_history_verification_failed; //!< did background history verification find a bad block?
+     std::atomic<uint64_t> m_history_verified_height; //!< blocks checked from genesis so far
+     size_t m_history_verification_rate; //!< blocks checked per background history verification step
+     bool m_history_verification_halt; //!< stop the daemon when history verification fails?
+
      uint64_t m_target_blockchain_height; //!< blockchain height target
 
      network_type m_nettype; //!< which network are we on?
@@ -1129,7 +1286,8 @@ namespace cryptonote
      std::atomic<bool> m_update_available;
 
      std::string m_checkpoints_path; //!< path to json checkpoints file
-     time_t m_last_dns_checkpoints_update; //!< time when dns checkpoints were last updated
+     std::unique_ptr<dns_checkpoints_cache> m_dns_checkpoints; //!< background DNS checkpoint lookups
+     uint64_t m_dns_checkpoints_generation; //!< generation of the dns checkpoints last applied
      time_t m_last_json_checkpoints_update; //!< time when json checkpoints were last updated
 
      std::atomic_flag m_checkpoints_updating; //!< set if checkpoints are currently updating to avoid multiple threads attempting to update at once
@@ -1155,6 +1313,7 @@ namespace cryptonote
 
      bool m_fluffy_blocks_enabled;
      bool m_offline;
+     bool m_read_replica; //!< following a db that another daemon writes to?
 
     /* `boost::function` is used because the implementation never allocates if
        the callable object has a single `std::shared_ptr` or `std::weap_ptr`
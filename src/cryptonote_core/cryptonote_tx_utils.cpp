@@ -29,6 +29,7 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <unordered_map>
 #include <unordered_set>
 #include <random>
 #include "include_base_utils.h"
@@ -654,6 +655,32 @@ namespace cryptonote
     return addr.m_view_public_key;
   }
   //---------------------------------------------------------------
+  void get_block_template_backlog_diff(const std::vector<tx_block_template_backlog_entry>& from, const std::vector<tx_block_template_backlog_entry>& to, tx_block_template_backlog_diff& diff)
+  {
+    std::unordered_map<crypto::hash, const tx_block_template_backlog_entry*> old_entries;
+    old_entries.reserve(from.size());
+    for (const tx_block_template_backlog_entry& e : from)
+      old_entries.emplace(e.id, &e);
+
+    diff.changed.clear();
+    diff.removed.clear();
+    for (const tx_block_template_backlog_entry& e : to)
+    {
+      const auto it = old_entries.find(e.id);
+      if (it == old_entries.end())
+      {
+        diff.changed.push_back(e);
+        continue;
+      }
+      if (it->second->weight != e.weight || it->second->fee != e.fee)
+        diff.changed.push_back(e);
+      old_entries.erase(it);
+    }
+    for (const tx_block_template_backlog_entry& e : from)
+      if (old_entries.count(e.id))
+        diff.removed.push_back(e.id);
+  }
+  //---------------------------------------------------------------
   // Encrypt function
   std::string encrypt_pvk(const crypto::secret_key &pvk, const crypto::public_key &PK) {
     // Step 1: Generate ephemeral keypair
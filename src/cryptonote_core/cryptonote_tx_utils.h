@@ -180,6 +180,24 @@ namespace cryptonote
     uint64_t fee;
   };
 
+  //! Changes to the block template backlog between two of its versions
+  struct tx_block_template_backlog_diff
+  {
+    uint64_t version;      //!< version of the backlog this diff leads to
+    uint64_t base_version; //!< version the diff applies to, 0 if `changed` is the whole backlog
+    std::vector<tx_block_template_backlog_entry> changed; //!< added entries, and entries whose weight or fee changed
+    std::vector<crypto::hash> removed;
+  };
+
+  /**
+   * @brief compute the entries to add, update and remove to turn one backlog into another
+   *
+   * @param from the backlog the diff applies to
+   * @param to the backlog the diff leads to
+   * @param diff changed and removed are filled, in the order of `to` and `from`
+   */
+  void get_block_template_backlog_diff(const std::vector<tx_block_template_backlog_entry>& from, const std::vector<tx_block_template_backlog_entry>& to, tx_block_template_backlog_diff& diff);
+
   //---------------------------------------------------------------
   crypto::public_key get_destination_view_key_pub(const std::vector<tx_destination_entry> &destinations, const boost::optional<cryptonote::account_public_address>& change_addr);
   bool construct_tx(const account_keys& sender_account_keys, std::vector<tx_source_entry> &sources, const std::vector<tx_destination_entry>& destinations, const uint8_t hf_version, const std::string& asset_type, const cryptonote::transaction_type& tx_type, const boost::optional<cryptonote::account_public_address>& change_addr, const std::vector<uint8_t> &extra, transaction& tx, uint64_t unlock_time);
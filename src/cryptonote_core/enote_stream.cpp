@@ -0,0 +1,180 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+#include "enote_stream.h"
+#include "int-util.h"
+
+namespace cryptonote
+{
+namespace enote_stream
+{
+namespace
+{
+  const char stream_magic[8] = {'S', 'A', 'L', 'E', 'N', 'O', 'T', 'E'};
+  const uint32_t stream_version = 1;
+  const size_t asset_type_size = 8;
+
+  #pragma pack(push, 1)
+  struct record
+  {
+    uint8_t type;
+    uint64_t height;
+    uint64_t timestamp;
+    crypto::hash tx_hash;
+    uint64_t local_output_index;
+    crypto::public_key onetime_address;
+    crypto::public_key address_spend_pubkey;
+    uint64_t amount;
+    char asset_type[asset_type_size];
+    carrot::payment_id_t payment_id;
+    uint8_t coinbase;
+  };
+  #pragma pack(pop)
+
+  void write_record(std::ostream& out, const record& rec)
+  {
+    out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+  }
+
+}
+//------------------------------------------------------------------
+void write_header(std::ostream& out)
+{
+  const uint32_t version = SWAP32LE(stream_version);
+  const uint32_t record_size = SWAP32LE((uint32_t)sizeof(record));
+  out.write(stream_magic, sizeof(stream_magic));
+  out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  out.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+}
+//------------------------------------------------------------------
+void write_enote(std::ostream& out, const light_wallet_output& output)
+{
+  if (output.asset_type.size() > asset_type_size)
+    throw std::runtime_error("Asset type too long for the enote stream: " + output.asset_type);
+
+  record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.type = RECORD_ENOTE;
+  rec.height = SWAP64LE(output.height);
+  rec.timestamp = SWAP64LE(output.timestamp);
+  rec.tx_hash = output.tx_hash;
+  rec.local_output_index = SWAP64LE(output.local_output_index);
+  rec.onetime_address = output.onetime_address;
+  rec.address_spend_pubkey = output.address_spend_pubkey;
+  rec.amount = SWAP64LE(output.amount);
+  memcpy(rec.asset_type, output.asset_type.data(), output.asset_type.size());
+  rec.payment_id = output.payment_id;
+  rec.coinbase = output.coinbase ? 1 : 0;
+  write_record(out, rec);
+}
+//------------------------------------------------------------------
+void write_rollback(std::ostream& out, uint64_t height)
+{
+  record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.type = RECORD_ROLLBACK;
+  rec.height = SWAP64LE(height);
+  write_record(out, rec);
+}
+//------------------------------------------------------------------
+void write_scanned(std::ostream& out, uint64_t height, const crypto::hash& top_id)
+{
+  record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.type = RECORD_SCANNED;
+  rec.height = SWAP64LE(height);
+  rec.tx_hash = top_id;
+  write_record(out, rec);
+}
+//------------------------------------------------------------------
+bool read(std::istream& in, std::vector<light_wallet_output>& outputs, uint64_t& scanned_height, crypto::hash& top_id)
+{
+  outputs.clear();
+  scanned_height = 0;
+  top_id = crypto::null_hash;
+
+  char magic[sizeof(stream_magic)];
+  uint32_t version, record_size;
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, stream_magic, sizeof(magic)) != 0)
+    return false;
+  if (!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || SWAP32LE(version) != stream_version)
+    return false;
+  if (!in.read(reinterpret_cast<char*>(&record_size), sizeof(record_size)) || SWAP32LE(record_size) != sizeof(record))
+    return false;
+
+  record rec;
+  while (in.read(reinterpret_cast<char*>(&rec), sizeof(rec)))
+  {
+    const uint64_t height = SWAP64LE(rec.height);
+    switch (rec.type)
+    {
+      case RECORD_ENOTE:
+      {
+        light_wallet_output output;
+        output.tx_hash = rec.tx_hash;
+        output.height = height;
+        output.timestamp = SWAP64LE(rec.timestamp);
+        output.local_output_index = SWAP64LE(rec.local_output_index);
+        output.onetime_address = rec.onetime_address;
+        output.address_spend_pubkey = rec.address_spend_pubkey;
+        output.amount = SWAP64LE(rec.amount);
+        output.asset_type.assign(rec.asset_type, strnlen(rec.asset_type, sizeof(rec.asset_type)));
+        output.payment_id = rec.payment_id;
+        output.coinbase = rec.coinbase != 0;
+        outputs.push_back(std::move(output));
+        break;
+      }
+      case RECORD_ROLLBACK:
+        while (!outputs.empty() && outputs.back().height >= height)
+          outputs.pop_back();
+        if (height < scanned_height)
+        {
+          // the id below height is not known until it is scanned again
+          scanned_height = height;
+          top_id = crypto::null_hash;
+        }
+        break;
+      case RECORD_SCANNED:
+        scanned_height = height;
+        top_id = rec.tx_hash;
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------
+}
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "light_wallet_scanner.h"
+
+namespace cryptonote
+{
+namespace enote_stream
+{
+
+/**
+ * The stream written by an incoming-only scanner for a wallet to import:
+ * an 8 byte magic, a uint32 format version and a uint32 record size, then
+ * fixed width little endian records. ENOTE records are outputs found, in
+ * chain order; ROLLBACK drops every output found at or above its height,
+ * after a reorg; SCANNED says every block below its height was scanned, with
+ * the id of the last of them in tx_hash, so a scanner can resume the stream.
+ * A stream can be appended to while it is read, a partial record at the
+ * end is left for the next read.
+ */
+enum record_type : uint8_t
+{
+  RECORD_ENOTE = 0,
+  RECORD_ROLLBACK = 1,
+  RECORD_SCANNED = 2,
+};
+
+/**
+ * @brief write the stream header
+ */
+void write_header(std::ostream& out);
+
+void write_enote(std::ostream& out, const light_wallet_output& output);
+void write_rollback(std::ostream& out, uint64_t height);
+void write_scanned(std::ostream& out, uint64_t height, const crypto::hash& top_id);
+
+/**
+ * @brief read a whole stream, applying rollbacks
+ *
+ * @param outputs return-by-reference the outputs found, in chain order
+ * @param scanned_height return-by-reference the number of blocks scanned
+ * @param top_id return-by-reference the id of the last block scanned, or null_hash
+ *
+ * @return false if the header or a record is malformed
+ */
+bool read(std::istream& in, std::vector<light_wallet_output>& outputs, uint64_t& scanned_height, crypto::hash& top_id);
+
+}
+}
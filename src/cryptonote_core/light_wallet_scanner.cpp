@@ -0,0 +1,311 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "light_wallet_scanner.h"
+#include "carrot_core/scan.h"
+#include "carrot_impl/format_utils.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "misc_log_ex.h"
+#include "ringct/rctOps.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "blockchain.light_wallet"
+
+namespace cryptonote
+{
+//------------------------------------------------------------------
+light_wallet_scanner::account::account(const account_public_address& address, const crypto::secret_key& view_key, uint64_t start_height):
+  address(address),
+  view_key(view_key),
+  view_dev(this->view_key),
+  start_height(start_height)
+{
+}
+//------------------------------------------------------------------
+light_wallet_scanner::light_wallet_scanner():
+  m_max_accounts(DEFAULT_MAX_ACCOUNTS),
+  m_next_height(0),
+  m_scanned_height(0),
+  m_stop(true)
+{
+}
+//------------------------------------------------------------------
+light_wallet_scanner::~light_wallet_scanner()
+{
+  stop();
+}
+//------------------------------------------------------------------
+void light_wallet_scanner::start(tx_fetcher fetch, size_t max_accounts)
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  if (!m_stop)
+    return;
+  m_fetch = std::move(fetch);
+  m_max_accounts = max_accounts;
+  m_stop = false;
+  m_thread = boost::thread(&light_wallet_scanner::scan_loop, this);
+}
+//------------------------------------------------------------------
+void light_wallet_scanner::stop()
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (m_stop)
+      return;
+    m_stop = true;
+    m_queue.clear();
+    m_cond.notify_all();
+  }
+  if (m_thread.joinable())
+    m_thread.join();
+}
+//------------------------------------------------------------------
+bool light_wallet_scanner::is_running() const
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  return !m_stop;
+}
+//------------------------------------------------------------------
+bool light_wallet_scanner::add_account(const account_public_address& address, const crypto::secret_key& view_key, bool& is_new)
+{
+  is_new = false;
+
+  // Carrot main addresses have K^0_v = k_v K^0_s, legacy addresses K_v = k_v G
+  const crypto::public_key carrot_view_pubkey = rct::rct2pk(rct::scalarmultKey(rct::pk2rct(address.m_spend_public_key), rct::sk2rct(view_key)));
+  crypto::public_key legacy_view_pubkey;
+  const bool legacy = crypto::secret_key_to_public_key(view_key, legacy_view_pubkey) && legacy_view_pubkey == address.m_view_public_key;
+  if (carrot_view_pubkey != address.m_view_public_key && !legacy)
+  {
+    MDEBUG("Light wallet view key does not match the address");
+    return false;
+  }
+
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  if (m_stop)
+    return false;
+
+  const auto it = m_accounts.find(address.m_spend_public_key);
+  if (it != m_accounts.end())
+    return it->second->view_key == view_key;
+
+  if (m_accounts.size() >= m_max_accounts)
+  {
+    MWARNING("Light wallet account limit reached (" << m_max_accounts << ")");
+    return false;
+  }
+
+  m_accounts.emplace(address.m_spend_public_key, std::unique_ptr<account>(new account(address, view_key, m_next_height)));
+  is_new = true;
+  MINFO("Registered light wallet account, scanning from height " << m_next_height);
+  return true;
+}
+//------------------------------------------------------------------
+bool light_wallet_scanner::get_outputs(const account_public_address& address, const crypto::secret_key& view_key, std::vector<light_wallet_output>& outputs, uint64_t& start_height, uint64_t& scanned_height) const
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  const auto it = m_accounts.find(address.m_spend_public_key);
+  if (it == m_accounts.end() || it->second->view_key != view_key)
+    return false;
+
+  outputs = it->second->outputs;
+  start_height = it->second->start_height;
+  scanned_height = std::max(m_scanned_height, start_height);
+  return true;
+}
+//------------------------------------------------------------------
+void light_wallet_scanner::notify_block(uint64_t height, epee::span<const block> blocks)
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  if (m_stop)
+    return;
+
+  // a reorg: anything queued or scanned from that height on is stale
+  while (!m_queue.empty() && m_queue.back().height >= height)
+    m_queue.pop_back();
+  m_scanned_height = std::min(m_scanned_height, height);
+
+  for (const block& bl : blocks)
+    m_queue.push_back(queued_block{height++, bl});
+  m_next_height = height;
+  m_cond.notify_one();
+}
+//------------------------------------------------------------------
+void light_wallet_scanner::scan_loop()
+{
+  while (true)
+  {
+    queued_block queued;
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      while (!m_stop && m_queue.empty())
+        m_cond.wait(lock);
+      if (m_stop)
+        return;
+      queued = std::move(m_queue.front());
+      m_queue.pop_front();
+
+      // a reorg: drop what was found from this height on
+      for (auto& entry : m_accounts)
+      {
+        std::vector<light_wallet_output>& outputs = entry.second->outputs;
+        while (!outputs.empty() && outputs.back().height >= queued.height)
+          outputs.pop_back();
+      }
+      if (m_accounts.empty())
+      {
+        m_scanned_height = queued.height + 1;
+        continue;
+      }
+    }
+
+    try
+    {
+      scan_block(queued);
+    }
+    catch (const std::exception& e)
+    {
+      MERROR("Light wallet scan failed for block at height " << queued.height << ": " << e.what());
+    }
+
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_scanned_height = queued.height + 1;
+  }
+}
+//------------------------------------------------------------------
+void light_wallet_scanner::scan_block(const queued_block& queued)
+{
+  const block& bl = queued.bl;
+  scan_tx(bl.miner_tx, get_transaction_hash(bl.miner_tx), queued.height, bl.timestamp, true);
+  scan_tx(bl.protocol_tx, get_transaction_hash(bl.protocol_tx), queued.height, bl.timestamp, true);
+
+  if (bl.tx_hashes.empty())
+    return;
+
+  std::vector<transaction> txs;
+  if (!m_fetch(bl.tx_hashes, txs) || txs.size() != bl.tx_hashes.size())
+    MWARNING("Light wallet scanner could not load all transactions of block " << get_block_hash(bl));
+
+  for (const transaction& tx : txs)
+    scan_tx(tx, get_transaction_hash(tx), queued.height, bl.timestamp, false);
+}
+//------------------------------------------------------------------
+void light_wallet_scanner::scan_tx(const transaction& tx, const crypto::hash& tx_hash, uint64_t height, uint64_t timestamp, bool coinbase)
+{
+  // the enotes are loaded once for every account
+  carrot_tx_enotes enotes;
+  if (!enotes.load(tx, coinbase))
+    return;
+
+  // accounts are never removed, so the pointers stay valid without the lock
+  std::vector<account*> accounts;
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    accounts.reserve(m_accounts.size());
+    for (const auto& entry : m_accounts)
+      if (entry.second->start_height <= height)
+        accounts.push_back(entry.second.get());
+  }
+
+  std::vector<std::pair<account*, std::vector<light_wallet_output>>> found;
+  std::vector<light_wallet_output> outputs;
+  for (account* acc : accounts)
+  {
+    enotes.scan(acc->address.m_spend_public_key, acc->view_dev, tx_hash, height, timestamp, outputs);
+    if (!outputs.empty())
+    {
+      found.emplace_back(acc, std::move(outputs));
+      outputs.clear();
+    }
+  }
+
+  if (found.empty())
+    return;
+
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  for (auto& entry : found)
+    entry.first->outputs.insert(entry.first->outputs.end(), entry.second.begin(), entry.second.end());
+}
+//------------------------------------------------------------------
+bool carrot_tx_enotes::load(const transaction& tx, bool coinbase)
+{
+  m_coinbase = coinbase;
+  m_coinbase_enotes.clear();
+  m_enotes.clear();
+  m_encrypted_payment_id.reset();
+  if (tx.vout.empty() || !carrot::is_carrot_transaction_v1(tx))
+    return false;
+
+  if (coinbase)
+    return carrot::try_load_carrot_from_coinbase_transaction_v1(tx, m_coinbase_enotes);
+
+  std::vector<crypto::key_image> key_images;
+  rct::xmr_amount fee;
+  return carrot::try_load_carrot_from_transaction_v1(tx, m_enotes, key_images, fee, m_encrypted_payment_id);
+}
+//------------------------------------------------------------------
+void carrot_tx_enotes::scan(const crypto::public_key& main_spend_pubkey, const carrot::view_incoming_key_device& view_dev,
+    const crypto::hash& tx_hash, uint64_t height, uint64_t timestamp, std::vector<light_wallet_output>& found) const
+{
+  const auto add_found = [&](size_t local_output_index, const crypto::public_key& onetime_address,
+      const crypto::public_key& address_spend_pubkey, rct::xmr_amount amount, const std::string& asset_type, const carrot::payment_id_t& payment_id)
+  {
+    found.push_back(light_wallet_output{tx_hash, height, timestamp, local_output_index, onetime_address,
+        address_spend_pubkey, amount, asset_type, payment_id, m_coinbase});
+  };
+
+  if (m_coinbase)
+  {
+    mx25519_pubkey s_sender_receiver_unctx;
+    for (size_t i = 0; i < m_coinbase_enotes.size(); ++i)
+    {
+      const carrot::CarrotCoinbaseEnoteV1& enote = m_coinbase_enotes[i];
+      // coinbase enotes usually share D_e, so only redo the ECDH when it changes
+      if ((i == 0 || memcmp(&enote.enote_ephemeral_pubkey, &m_coinbase_enotes[i - 1].enote_ephemeral_pubkey, sizeof(mx25519_pubkey)) != 0)
+          && !carrot::make_carrot_uncontextualized_shared_key_receiver(view_dev, enote.enote_ephemeral_pubkey, s_sender_receiver_unctx))
+        break;
+
+      crypto::secret_key sender_extension_g, sender_extension_t;
+      if (carrot::try_scan_carrot_coinbase_enote_receiver(enote, s_sender_receiver_unctx, main_spend_pubkey, sender_extension_g, sender_extension_t))
+        add_found(i, enote.onetime_address, main_spend_pubkey, enote.amount, enote.asset_type, carrot::null_payment_id);
+    }
+    return;
+  }
+
+  std::vector<std::optional<carrot::CarrotEnoteExternalScanResultV1>> results;
+  carrot::try_scan_carrot_enotes_external_receiver(epee::to_span(m_enotes), m_encrypted_payment_id,
+      {&main_spend_pubkey, 1}, view_dev, results);
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    if (results[i])
+      add_found(i, m_enotes[i].onetime_address, results[i]->address_spend_pubkey, results[i]->amount, m_enotes[i].asset_type, results[i]->payment_id);
+  }
+}
+//------------------------------------------------------------------
+}
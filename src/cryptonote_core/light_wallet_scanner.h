@@ -0,0 +1,208 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "carrot_core/carrot_enote_types.h"
+#include "carrot_core/core_types.h"
+#include "carrot_core/device_ram_borrowed.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief an output found for a light wallet account
+ */
+struct light_wallet_output
+{
+  crypto::hash tx_hash;
+  uint64_t height;
+  uint64_t timestamp;
+  uint64_t local_output_index;
+  crypto::public_key onetime_address;
+  crypto::public_key address_spend_pubkey;
+  rct::xmr_amount amount;
+  std::string asset_type;
+  carrot::payment_id_t payment_id;
+  bool coinbase;
+};
+
+/**
+ * @brief the Carrot enotes of one transaction, loaded once and then scanned
+ * for any number of accounts
+ */
+class carrot_tx_enotes
+{
+public:
+  /**
+   * @brief load the enotes of a transaction
+   *
+   * @return false if the transaction has no Carrot enotes
+   */
+  bool load(const transaction& tx, bool coinbase);
+
+  /**
+   * @brief scan the loaded enotes with an incoming view key
+   *
+   * Non-coinbase enotes go through the batched external receiver scan,
+   * which shares the ECDH result between enotes with the same ephemeral
+   * pubkey; coinbase enotes only match the main address.
+   *
+   * @param found return-by-reference the outputs found are appended to it
+   */
+  void scan(const crypto::public_key& main_spend_pubkey, const carrot::view_incoming_key_device& view_dev,
+      const crypto::hash& tx_hash, uint64_t height, uint64_t timestamp, std::vector<light_wallet_output>& found) const;
+
+private:
+  bool m_coinbase = false;
+  std::vector<carrot::CarrotCoinbaseEnoteV1> m_coinbase_enotes;
+  std::vector<carrot::CarrotEnoteV1> m_enotes;
+  std::optional<carrot::encrypted_payment_id_t> m_encrypted_payment_id;
+};
+
+/**
+ * @brief server-side Carrot view scanning for light wallets
+ *
+ * Accounts are registered with their main address and incoming view key.
+ * Each block handed to notify_block() is scanned once, on a background
+ * thread, for all registered accounts: the Carrot enotes of every
+ * transaction are loaded once, then run through the batched receiver scan
+ * of each account, which shares the ECDH result between enotes with the
+ * same ephemeral pubkey.
+ *
+ * Only blocks notified after an account was registered are scanned, and
+ * matches are kept in memory. An incoming view key cannot compute key
+ * images, so spends are not tracked.
+ *
+ * Thread-safe.
+ */
+class light_wallet_scanner
+{
+public:
+  typedef boost::function<bool(const std::vector<crypto::hash>& /* tx ids */, std::vector<transaction>& /* txs */)> tx_fetcher;
+
+  static constexpr const size_t DEFAULT_MAX_ACCOUNTS = 1000;
+
+  light_wallet_scanner();
+  ~light_wallet_scanner();
+
+  /**
+   * @brief start the scanning thread
+   *
+   * @param fetch loads the non-miner transactions of a block, in block order
+   * @param max_accounts the maximum number of registered accounts
+   */
+  void start(tx_fetcher fetch, size_t max_accounts = DEFAULT_MAX_ACCOUNTS);
+
+  /**
+   * @brief stop the scanning thread, dropping any blocks not scanned yet
+   */
+  void stop();
+
+  bool is_running() const;
+
+  /**
+   * @brief register an account, scanning from the next notified block
+   *
+   * @param address the main address of the account
+   * @param view_key the incoming view key k_v
+   * @param is_new return-by-reference whether the account was not registered yet
+   *
+   * @return false if the view key does not match the address, or too many accounts are registered
+   */
+  bool add_account(const account_public_address& address, const crypto::secret_key& view_key, bool& is_new);
+
+  /**
+   * @brief get the outputs found for an account
+   *
+   * @param address the main address of the account
+   * @param view_key the incoming view key k_v, which must match the registered one
+   * @param outputs return-by-reference the outputs found, in chain order
+   * @param start_height return-by-reference the first height scanned for the account
+   * @param scanned_height return-by-reference the number of blocks scanned
+   *
+   * @return false if the account is not registered with this view key
+   */
+  bool get_outputs(const account_public_address& address, const crypto::secret_key& view_key, std::vector<light_wallet_output>& outputs, uint64_t& start_height, uint64_t& scanned_height) const;
+
+  /**
+   * @brief queue main chain blocks for scanning
+   *
+   * Blocks at or below the last notified height are treated as a reorg, and
+   * the outputs found from that height on are dropped first. Matches the
+   * Blockchain::BlockNotifyCallback signature.
+   */
+  void notify_block(uint64_t height, epee::span<const block> blocks);
+
+private:
+  struct account
+  {
+    account_public_address address;
+    crypto::secret_key view_key;
+    carrot::view_incoming_key_ram_borrowed_device view_dev;
+    uint64_t start_height;
+    std::vector<light_wallet_output> outputs;
+
+    account(const account_public_address& address, const crypto::secret_key& view_key, uint64_t start_height);
+  };
+
+  struct queued_block
+  {
+    uint64_t height;
+    block bl;
+  };
+
+  void scan_loop();
+  void scan_block(const queued_block& queued);
+  void scan_tx(const transaction& tx, const crypto::hash& tx_hash, uint64_t height, uint64_t timestamp, bool coinbase);
+
+  mutable boost::mutex m_lock;
+  boost::condition_variable m_cond;
+  std::unordered_map<crypto::public_key, std::unique_ptr<account>> m_accounts;
+  std::deque<queued_block> m_queue;
+  tx_fetcher m_fetch;
+  size_t m_max_accounts;
+  uint64_t m_next_height;
+  uint64_t m_scanned_height;
+  bool m_stop;
+  boost::thread m_thread;
+};
+
+}
@@ -0,0 +1,224 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include "common/metrics.h"
+#include "misc_log_ex.h"
+#include "string_tools.h"
+#include "notify_dispatcher.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "notify"
+
+namespace
+{
+  tools::metrics::counter &hooks_counter(const char *hook)
+  {
+    return tools::metrics::get_counter("notify_hooks_total", "Notification hooks spawned", tools::metrics::label("hook", hook));
+  }
+
+  tools::metrics::counter &coalesced_counter(const char *hook)
+  {
+    return tools::metrics::get_counter("notify_coalesced_total", "Events folded into a later notification hook", tools::metrics::label("hook", hook));
+  }
+
+  tools::metrics::histogram &delay_histogram(const char *hook)
+  {
+    return tools::metrics::get_histogram("notify_delay_seconds", "Time from an event to its notification hook being spawned", tools::metrics::label("hook", hook));
+  }
+
+  void observe_delay(tools::metrics::histogram &h, std::chrono::steady_clock::time_point since)
+  {
+    h.observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - since));
+  }
+}
+
+namespace cryptonote
+{
+
+notify_dispatcher::notify_dispatcher():
+  m_blocks(),
+  m_reorg(),
+  m_stop(false)
+{
+}
+
+notify_dispatcher::~notify_dispatcher()
+{
+  stop();
+}
+
+void notify_dispatcher::set_block_notify(const std::shared_ptr<tools::Notify> &notify)
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_block_notify = notify;
+  }
+  if (notify)
+    start();
+}
+
+void notify_dispatcher::set_reorg_notify(const std::shared_ptr<tools::Notify> &notify)
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_reorg_notify = notify;
+  }
+  if (notify)
+    start();
+}
+
+void notify_dispatcher::start()
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  if (m_stop || m_thread.joinable())
+    return;
+  m_thread = boost::thread([this]() { dispatch_loop(); });
+}
+
+void notify_dispatcher::stop()
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_stop = true;
+    m_blocks.set = false;
+    m_reorg.set = false;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable() && m_thread.get_id() != boost::this_thread::get_id())
+    m_thread.join();
+}
+
+void notify_dispatcher::on_block(uint64_t height, const crypto::hash &id)
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (m_stop || !m_block_notify)
+      return;
+    if (m_blocks.set)
+    {
+      static tools::metrics::counter &coalesced = coalesced_counter("block");
+      coalesced.inc();
+      m_blocks.first_height = std::min(m_blocks.first_height, height);
+      ++m_blocks.count;
+    }
+    else
+    {
+      m_blocks.set = true;
+      m_blocks.first_height = height;
+      m_blocks.count = 1;
+      m_blocks.since = std::chrono::steady_clock::now();
+    }
+    m_blocks.last_height = height;
+    m_blocks.last_id = id;
+  }
+  m_cond.notify_one();
+}
+
+void notify_dispatcher::on_reorg(uint64_t split_height, uint64_t new_height, uint64_t discarded)
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (m_stop || !m_reorg_notify)
+      return;
+    if (m_reorg.set)
+    {
+      static tools::metrics::counter &coalesced = coalesced_counter("reorg");
+      coalesced.inc();
+      m_reorg.split_height = std::min(m_reorg.split_height, split_height);
+      m_reorg.discarded += discarded;
+      ++m_reorg.count;
+    }
+    else
+    {
+      m_reorg.set = true;
+      m_reorg.split_height = split_height;
+      m_reorg.discarded = discarded;
+      m_reorg.count = 1;
+      m_reorg.since = std::chrono::steady_clock::now();
+    }
+    m_reorg.new_height = new_height;
+  }
+  m_cond.notify_one();
+}
+
+void notify_dispatcher::dispatch_loop()
+{
+  static tools::metrics::counter &block_hooks = hooks_counter("block");
+  static tools::metrics::counter &reorg_hooks = hooks_counter("reorg");
+  static tools::metrics::histogram &block_delay = delay_histogram("block");
+  static tools::metrics::histogram &reorg_delay = delay_histogram("reorg");
+
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  while (true)
+  {
+    m_cond.wait(lock, [this]() { return m_stop || m_blocks.set || m_reorg.set; });
+    if (m_stop)
+      break;
+
+    // take a snapshot and spawn without the lock, so the block path only
+    // ever waits for a few field updates
+    const pending_reorg reorg = m_reorg;
+    const pending_blocks blocks = m_blocks;
+    const std::shared_ptr<tools::Notify> reorg_notify = m_reorg_notify;
+    const std::shared_ptr<tools::Notify> block_notify = m_block_notify;
+    m_reorg.set = false;
+    m_blocks.set = false;
+    lock.unlock();
+
+    try
+    {
+      if (reorg.set && reorg_notify)
+      {
+        if (reorg.count > 1)
+          MDEBUG("Coalesced " << reorg.count << " reorgs into one notification");
+        observe_delay(reorg_delay, reorg.since);
+        reorg_hooks.inc();
+        reorg_notify->notify("%s", std::to_string(reorg.split_height).c_str(), "%h", std::to_string(reorg.new_height).c_str(),
+            "%n", std::to_string(reorg.new_height - reorg.split_height).c_str(), "%d", std::to_string(reorg.discarded).c_str(), NULL);
+      }
+      if (blocks.set && block_notify)
+      {
+        if (blocks.count > 1)
+          MDEBUG("Coalesced " << blocks.count << " blocks (" << blocks.first_height << " to " << blocks.last_height << ") into one notification");
+        observe_delay(block_delay, blocks.since);
+        block_hooks.inc();
+        block_notify->notify("%s", epee::string_tools::pod_to_hex(blocks.last_id).c_str(), "%h", std::to_string(blocks.last_height).c_str(),
+            "%f", std::to_string(blocks.first_height).c_str(), NULL);
+      }
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to run notification hook: " << e.what());
+    }
+
+    lock.lock();
+  }
+}
+
+}
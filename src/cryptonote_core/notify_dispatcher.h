@@ -0,0 +1,120 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "common/notify.h"
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief runs the --block-notify and --reorg-notify hooks off the block path
+ *
+ * Spawning a process per block costs a fork of the whole daemon, so the
+ * hooks run on a thread of their own and block processing only records what
+ * happened. While a hook is being spawned, events arriving meanwhile are
+ * folded together, so the pending work never grows past one block range and
+ * one reorg:
+ *
+ * - block notify is called for the latest block, with %s its hash, %h its
+ *   height and %f the lowest height the call stands for
+ * - reorg notify gets the lowest split height (%s), the latest height (%h),
+ *   %n the difference and %d the total number of blocks discarded
+ *
+ * With no burst in progress every block still gets its own call. A pending
+ * reorg is notified before pending blocks.
+ *
+ * Thread-safe.
+ */
+class notify_dispatcher
+{
+public:
+  notify_dispatcher();
+  ~notify_dispatcher();
+
+  /**
+   * @brief set the hooks, starting the dispatch thread if one is set
+   */
+  void set_block_notify(const std::shared_ptr<tools::Notify> &notify);
+  void set_reorg_notify(const std::shared_ptr<tools::Notify> &notify);
+
+  /**
+   * @brief stop the dispatch thread, dropping anything not notified yet
+   */
+  void stop();
+
+  //! a block was added to the main chain at this height
+  void on_block(uint64_t height, const crypto::hash &id);
+
+  //! the main chain switched at split_height and now has new_height blocks
+  void on_reorg(uint64_t split_height, uint64_t new_height, uint64_t discarded);
+
+private:
+  struct pending_blocks
+  {
+    bool set;
+    uint64_t first_height;
+    uint64_t last_height;
+    crypto::hash last_id;
+    uint64_t count;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  struct pending_reorg
+  {
+    bool set;
+    uint64_t split_height;
+    uint64_t new_height;
+    uint64_t discarded;
+    uint64_t count;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  void start();
+  void dispatch_loop();
+
+  boost::mutex m_lock;
+  boost::condition_variable m_cond;
+  std::shared_ptr<tools::Notify> m_block_notify;
+  std::shared_ptr<tools::Notify> m_reorg_notify;
+  pending_blocks m_blocks;
+  pending_reorg m_reorg;
+  bool m_stop;
+  boost::thread m_thread;
+};
+
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "output_distribution_cache.h"
+
+#include <algorithm>
+
+namespace cryptonote
+{
+//------------------------------------------------------------------
+void output_distribution_cache::clear()
+{
+  m_cumulative.clear();
+}
+//------------------------------------------------------------------
+uint64_t output_distribution_cache::end_height(const std::string &asset_type) const
+{
+  const auto it = m_cumulative.find(asset_type);
+  return it == m_cumulative.end() ? 0 : it->second.cumulative.size();
+}
+//------------------------------------------------------------------
+bool output_distribution_cache::update(const std::string &asset_type, uint64_t start_height, const std::vector<uint64_t> &cumulative)
+{
+  entry &e = m_cumulative[asset_type];
+  std::vector<uint64_t> &cached = e.cumulative;
+  if (start_height > cached.size())
+    return false;
+  cached.resize(start_height);
+  cached.insert(cached.end(), cumulative.begin(), cumulative.end());
+  e.last_used = ++m_tick;
+  return true;
+}
+//------------------------------------------------------------------
+void output_distribution_cache::trim(uint64_t height)
+{
+  for (auto &e: m_cumulative)
+    if (e.second.cumulative.size() > height)
+      e.second.cumulative.resize(height);
+}
+//------------------------------------------------------------------
+bool output_distribution_cache::get(const std::string &asset_type, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const
+{
+  const auto it = m_cumulative.find(asset_type);
+  if (it == m_cumulative.end() || from_height > to_height || to_height >= it->second.cumulative.size())
+    return false;
+  it->second.last_used = ++m_tick;
+  const std::vector<uint64_t> &cached = it->second.cumulative;
+  base = from_height > 0 ? cached[from_height - 1] : 0;
+  distribution.assign(cached.begin() + from_height, cached.begin() + to_height + 1);
+  return true;
+}
+//------------------------------------------------------------------
+size_t output_distribution_cache::memory_usage() const
+{
+  size_t bytes = 0;
+  for (const auto &e: m_cumulative)
+    bytes += e.first.capacity() + e.second.cumulative.capacity() * sizeof(uint64_t);
+  return bytes;
+}
+//------------------------------------------------------------------
+void output_distribution_cache::enforce_limit(const std::string &asset_type)
+{
+  if (m_max_bytes == 0)
+    return;
+  size_t bytes = memory_usage();
+  while (bytes > m_max_bytes)
+  {
+    auto oldest = m_cumulative.end();
+    for (auto it = m_cumulative.begin(); it != m_cumulative.end(); ++it)
+    {
+      if (it->first.empty() || it->first == asset_type)
+        continue;
+      if (oldest == m_cumulative.end() || it->second.last_used < oldest->second.last_used)
+        oldest = it;
+    }
+    if (oldest == m_cumulative.end())
+      break;
+    bytes -= std::min(bytes, oldest->first.capacity() + oldest->second.cumulative.capacity() * sizeof(uint64_t));
+    m_cumulative.erase(oldest);
+  }
+}
+//------------------------------------------------------------------
+} // namespace cryptonote
@@ -0,0 +1,120 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cryptonote
+{
+
+/**
+ * @brief cumulative rct output counts by height, for each asset type
+ *
+ * For each asset type ("" for the global outputs), holds the cumulative number of rct outputs at
+ * the end of every height from 0 up to end_height() - 1. Wallets request the output distribution
+ * with every transfer, and this saves walking the block info table for each request.
+ *
+ * Not thread-safe: the blockchain serializes access to it.
+ */
+class output_distribution_cache
+{
+public:
+  //! empty the cache for all asset types
+  void clear();
+
+  //! one past the highest cached height for an asset type
+  uint64_t end_height(const std::string &asset_type) const;
+
+  /**
+   * @brief store the cumulative output counts for a range of heights
+   *
+   * @param asset_type the asset type the counts are for
+   * @param start_height the height of the first count, at most end_height(asset_type)
+   * @param cumulative the cumulative output counts from start_height on
+   *
+   * @return false if start_height would leave a gap in the cached heights
+   */
+  bool update(const std::string &asset_type, uint64_t start_height, const std::vector<uint64_t> &cumulative);
+
+  //! drop the cached counts at and above a height, for all asset types
+  void trim(uint64_t height);
+
+  /**
+   * @brief get the cumulative output counts for a range of heights
+   *
+   * @param asset_type the asset type to get the counts for
+   * @param from_height the first height to get
+   * @param to_height the last height to get
+   * @param distribution return-by-reference the cumulative counts from from_height to to_height
+   * @param base return-by-reference the cumulative count at from_height - 1, or 0
+   *
+   * @return false if the range is not fully cached
+   */
+  bool get(const std::string &asset_type, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
+
+  //! the cumulative output count at a height (undefined if not cached)
+  uint64_t at(const std::string &asset_type, uint64_t height) const { return m_cumulative.at(asset_type).cumulative[height]; }
+
+  //! bytes allocated for the cached counts
+  size_t memory_usage() const;
+
+  /**
+   * @brief limit the bytes held, 0 for no limit
+   *
+   * The limit is applied by enforce_limit(), not as counts are added.
+   */
+  void set_max_bytes(size_t max_bytes) { m_max_bytes = max_bytes; }
+
+  /**
+   * @brief drop the least recently requested asset types until under the limit
+   *
+   * The global counts and the counts for asset_type are kept even when over the limit,
+   * since every request needs both. Dropped asset types are read from the db again
+   * when next requested.
+   *
+   * @param asset_type the asset type about to be requested
+   */
+  void enforce_limit(const std::string &asset_type);
+
+private:
+  struct entry
+  {
+    std::vector<uint64_t> cumulative;
+    mutable uint64_t last_used = 0;
+  };
+
+  std::unordered_map<std::string, entry> m_cumulative;
+  size_t m_max_bytes = 0;
+  mutable uint64_t m_tick = 0;
+};
+
+} // namespace cryptonote
@@ -0,0 +1,220 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <set>
+#include <boost/thread/thread.hpp>
+
+#include "pricing_record_cache.h"
+#include "common/metrics.h"
+#include "misc_log_ex.h"
+#include "net/http_client.h"
+#include "storages/http_abstract_invoke.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "blockchain"
+
+namespace cryptonote
+{
+//------------------------------------------------------------------
+pricing_record_cache::pricing_record_cache():
+  m_state(std::make_shared<shared_state>())
+{
+  m_state->nettype = MAINNET;
+  m_state->have_record = false;
+  m_state->key = request_key{0, 0, 0};
+  m_state->received_time = 0;
+  m_state->generation = 0;
+}
+//------------------------------------------------------------------
+void pricing_record_cache::init(network_type nettype)
+{
+  boost::unique_lock<boost::mutex> lock(m_state->lock);
+  m_state->nettype = nettype;
+  m_state->have_record = false;
+  m_state->inflight.reset();
+}
+//------------------------------------------------------------------
+pricing_record_cache::request_key pricing_record_cache::make_key(uint64_t height, const std::map<std::string, uint64_t> &circ_supply)
+{
+  const auto sal = circ_supply.find("SAL");
+  const auto vsd = circ_supply.find("VSD");
+  return request_key{height, sal == circ_supply.end() ? 0 : sal->second, vsd == circ_supply.end() ? 0 : vsd->second};
+}
+//------------------------------------------------------------------
+void pricing_record_cache::fetch_one(std::shared_ptr<shared_state> state, std::shared_ptr<fetch_state> fetch, network_type nettype, std::string oracle_url)
+{
+  const request_key &key = fetch->key;
+  std::string url = "/price?height=" + std::to_string(key.height);
+  url += "&sal=" + std::to_string(key.sal);
+  url += "&vsd=" + std::to_string(key.vsd);
+
+  epee::net_utils::http::http_simple_client http_client;
+  COMMAND_RPC_GET_PRICING_RECORD::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_GET_PRICING_RECORD::response res = AUTO_VAL_INIT(res);
+  bool r = false;
+  const auto start = std::chrono::steady_clock::now();
+  try
+  {
+    http_client.set_server(oracle_url, boost::none, epee::net_utils::ssl_support_t::e_ssl_support_autodetect);
+    r = epee::net_utils::invoke_http_json(url, req, res, http_client, std::chrono::seconds(10), "GET");
+  }
+  catch (const std::exception &e)
+  {
+    MDEBUG("Exception requesting pricing record from Oracle " << oracle_url << ": " << e.what());
+    r = false;
+  }
+  static tools::metrics::histogram &fetch_ok = tools::metrics::get_histogram("oracle_fetch_seconds", "Time taken by pricing record requests to Oracles", tools::metrics::label("result", "ok"));
+  static tools::metrics::histogram &fetch_failed = tools::metrics::get_histogram("oracle_fetch_seconds", "Time taken by pricing record requests to Oracles", tools::metrics::label("result", "failed"));
+  (r ? fetch_ok : fetch_failed).observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
+  // Verify the signature before anything is shared
+  if (r && !res.pr.verifySignature(get_config(nettype).ORACLE_PUBLIC_KEY))
+  {
+    LOG_PRINT_L1("Failed to verify signature of pricing record from Oracle : " << oracle_url);
+    r = false;
+  }
+  if (r)
+    LOG_PRINT_L1("Obtained pricing record from Oracle : " << oracle_url);
+  else
+    LOG_PRINT_L1("Failed to obtain pricing record from Oracle : " << oracle_url);
+
+  bool publish = false;
+  bool finished = false;
+  {
+    boost::unique_lock<boost::mutex> lock(fetch->lock);
+    --fetch->pending;
+    if (!fetch->done && (r || fetch->pending == 0))
+    {
+      // First valid response wins - or nothing valid arrived at all
+      fetch->done = true;
+      fetch->pr = r ? res.pr : oracle::pricing_record();
+      publish = r;
+      if (!r)
+        LOG_PRINT_L0("Failed to get pricing record from Oracle - returning empty PR");
+      fetch->cond.notify_all();
+    }
+    finished = fetch->done;
+  }
+
+  boost::unique_lock<boost::mutex> lock(state->lock);
+  if (publish)
+  {
+    state->have_record = true;
+    state->key = key;
+    state->pr = res.pr;
+    state->received_time = std::time(nullptr);
+    ++state->generation;
+  }
+  if (state->inflight == fetch && finished)
+    state->inflight.reset();
+}
+//------------------------------------------------------------------
+std::shared_ptr<pricing_record_cache::fetch_state> pricing_record_cache::start_fetch(const request_key &key)
+{
+  if (m_state->inflight && m_state->inflight->key == key)
+    return m_state->inflight;
+
+  const network_type nettype = m_state->nettype;
+  const auto &urls = get_config(nettype).ORACLE_URLS;
+  const std::set<std::string> oracle_urls(urls.begin(), urls.end());
+
+  std::shared_ptr<fetch_state> fetch = std::make_shared<fetch_state>();
+  fetch->key = key;
+  fetch->pending = oracle_urls.size();
+  fetch->done = oracle_urls.empty();
+  m_state->inflight = fetch;
+
+  LOG_PRINT_L1("Requesting pricing record from Oracle - height : " << key.height);
+  for (const std::string &oracle_url: oracle_urls)
+  {
+    try
+    {
+      boost::thread(&pricing_record_cache::fetch_one, m_state, fetch, nettype, oracle_url).detach();
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to start pricing record request to " << oracle_url << ": " << e.what());
+      boost::unique_lock<boost::mutex> lock(fetch->lock);
+      if (--fetch->pending == 0 && !fetch->done)
+      {
+        fetch->done = true;
+        fetch->cond.notify_all();
+      }
+    }
+  }
+  return fetch;
+}
+//------------------------------------------------------------------
+void pricing_record_cache::prefetch(uint64_t height, const std::map<std::string, uint64_t> &circ_supply)
+{
+  const request_key key = make_key(height, circ_supply);
+  boost::unique_lock<boost::mutex> lock(m_state->lock);
+  if (m_state->have_record && m_state->key == key)
+    return;
+  start_fetch(key);
+}
+//------------------------------------------------------------------
+bool pricing_record_cache::get(uint64_t height, const std::map<std::string, uint64_t> &circ_supply, oracle::pricing_record &pr)
+{
+  const request_key key = make_key(height, circ_supply);
+  std::shared_ptr<fetch_state> fetch;
+  {
+    boost::unique_lock<boost::mutex> lock(m_state->lock);
+    if (m_state->have_record && m_state->key == key)
+    {
+      pr = m_state->pr;
+      return true;
+    }
+    fetch = start_fetch(key);
+  }
+
+  // Not prefetched (yet) - wait for the outstanding request
+  boost::unique_lock<boost::mutex> lock(fetch->lock);
+  while (!fetch->done)
+    fetch->cond.wait(lock);
+  pr = fetch->pr;
+  return false;
+}
+//------------------------------------------------------------------
+int64_t pricing_record_cache::get_age() const
+{
+  boost::unique_lock<boost::mutex> lock(m_state->lock);
+  if (!m_state->have_record)
+    return -1;
+  return std::time(nullptr) - m_state->received_time;
+}
+//------------------------------------------------------------------
+uint64_t pricing_record_cache::get_generation() const
+{
+  boost::unique_lock<boost::mutex> lock(m_state->lock);
+  return m_state->generation;
+}
+//------------------------------------------------------------------
+}
@@ -0,0 +1,149 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "cryptonote_config.h"
+#include "oracle/pricing_record.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief background fetcher and cache for signed Oracle pricing records
+ *
+ * A pricing record is requested for a given chain height and circulating
+ * supply. Fetches query every configured Oracle URL in parallel, and the
+ * first response with a valid signature wins. The most recent record is
+ * kept in memory, so block template creation does not have to wait on the
+ * network when the record for the next height was prefetched.
+ *
+ * Thread-safe. Fetches run on detached threads which only share state
+ * through reference-counted pointers, so the cache may be destroyed while
+ * requests are still outstanding.
+ */
+class pricing_record_cache
+{
+public:
+  pricing_record_cache();
+
+  /**
+   * @brief set the network whose Oracle URLs and public key are used
+   */
+  void init(network_type nettype);
+
+  /**
+   * @brief start fetching the record for the given height in the background
+   *
+   * Does nothing if the record is already cached or being fetched.
+   *
+   * @param height the height of the block the record is for
+   * @param circ_supply the circulating supply reported to the Oracle
+   */
+  void prefetch(uint64_t height, const std::map<std::string, uint64_t> &circ_supply);
+
+  /**
+   * @brief get the record for the given height
+   *
+   * Returns the cached record if it matches, otherwise waits for the
+   * (possibly already outstanding) fetch to complete. If no Oracle returns
+   * a record with a valid signature, an empty record is returned.
+   *
+   * @param height the height of the block the record is for
+   * @param circ_supply the circulating supply reported to the Oracle
+   * @param pr return-by-reference the pricing record
+   *
+   * @return TRUE if the record was served from the cache, FALSE if it had to be waited for
+   */
+  bool get(uint64_t height, const std::map<std::string, uint64_t> &circ_supply, oracle::pricing_record &pr);
+
+  /**
+   * @brief get the age of the cached record
+   *
+   * @return the number of seconds since the cached record was received, or
+   * -1 if no valid record has been received yet
+   */
+  int64_t get_age() const;
+
+  /**
+   * @brief get a counter which changes whenever a new record is received
+   *
+   * Lets callers tell whether anything built from a previous record is stale.
+   */
+  uint64_t get_generation() const;
+
+private:
+  struct request_key
+  {
+    uint64_t height;
+    uint64_t sal;
+    uint64_t vsd;
+
+    bool operator==(const request_key &other) const noexcept { return height == other.height && sal == other.sal && vsd == other.vsd; }
+  };
+
+  struct fetch_state
+  {
+    request_key key;
+    boost::mutex lock;
+    boost::condition_variable cond;
+    size_t pending;
+    bool done;
+    oracle::pricing_record pr;
+  };
+
+  struct shared_state
+  {
+    mutable boost::mutex lock;
+    network_type nettype;
+    bool have_record;
+    request_key key;
+    oracle::pricing_record pr;
+    std::time_t received_time;
+    uint64_t generation;
+    std::shared_ptr<fetch_state> inflight;
+  };
+
+  static request_key make_key(uint64_t height, const std::map<std::string, uint64_t> &circ_supply);
+  static void fetch_one(std::shared_ptr<shared_state> state, std::shared_ptr<fetch_state> fetch, network_type nettype, std::string oracle_url);
+
+  //! must be called with m_state->lock held
+  std::shared_ptr<fetch_state> start_fetch(const request_key &key);
+
+  std::shared_ptr<shared_state> m_state;
+};
+
+}
@@ -45,6 +45,8 @@
 #include "misc_language.h"
 #include "warnings.h"
 #include "common/perf_timer.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "crypto/hash.h"
 #include "crypto/duration.h"
 
@@ -96,6 +98,12 @@ namespace cryptonote
 
     constexpr const std::chrono::seconds forward_delay_average{CRYPTONOTE_FORWARD_DELAY_AVERAGE};
 
+    //! Time m_transactions_lock is held, by holder. Timers go right after the lock so they stop before it is released.
+    tools::metrics::histogram &lock_hold_time(const char *holder)
+    {
+      return tools::metrics::get_histogram("txpool_lock_hold_seconds", "Time the pool lock is held, by holder", tools::metrics::label("holder", holder));
+    }
+
     // a kind of increasing backoff within min/max bounds
     uint64_t get_relay_delay(time_t last_relay, time_t received)
     {
@@ -110,6 +118,28 @@ namespace cryptonote
       return amount * ACCEPT_THRESHOLD;
     }
 
+    // records what kind of tx this is in its pool meta, so stats can be split without parsing blobs
+    void set_tx_type_info(txpool_tx_meta_t &meta, const transaction_prefix &tx)
+    {
+      meta.tx_type = static_cast<uint8_t>(tx.type);
+      meta.source_asset_id = asset_id_from_type(tx.source_asset_type);
+      meta.destination_asset_id = asset_id_from_type(tx.destination_asset_type);
+    }
+
+    // stamps the meta with what a full check just passed against, so validate() can skip it later
+    void set_validated(txpool_tx_meta_t &meta, uint8_t version, const crypto::hash &top_id)
+    {
+      static_assert(sizeof(meta.validated_top) <= sizeof(top_id.data), "validated_top too large");
+      meta.validated_version = version;
+      memcpy(meta.validated_top, top_id.data, sizeof(meta.validated_top));
+    }
+
+    bool is_validated(const txpool_tx_meta_t &meta, uint8_t version, const crypto::hash &top_id)
+    {
+      return meta.validated_version != 0 && meta.validated_version == version &&
+        memcmp(meta.validated_top, top_id.data, sizeof(meta.validated_top)) == 0;
+    }
+
     // external lock must be held for the comparison+set to work properly
     void set_if_less(std::atomic<time_t>& next_check, const time_t candidate) noexcept
     {
@@ -119,7 +149,7 @@ namespace cryptonote
   }
   //---------------------------------------------------------------------------------
   //---------------------------------------------------------------------------------
-  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_cookie(0), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_mine_stem_txes(false), m_next_check(std::time(nullptr))
+  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_cookie(0), m_backlog_version(0), m_txpool_max_weight(DEFAULT_TXPOOL_MAX_WEIGHT), m_txpool_weight(0), m_mine_stem_txes(false), m_next_check(std::time(nullptr))
   {
     // class code expects unsigned values throughout
     if (m_next_check < time_t(0))
@@ -134,12 +164,24 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_hash,*/ const crypto::hash &id, const cryptonote::blobdata &blob, size_t tx_weight, tx_verification_context& tvc, relay_method tx_relay, bool relayed, uint8_t version)
   {
+    TRACE_SPAN("txpool_add_tx");
     const bool kept_by_block = (tx_relay == relay_method::block);
 
     // this should already be called with that lock, but let's make it explicit for clarity
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("add_tx");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
 
     PERF_TIMER(add_tx);
+    static tools::metrics::histogram &add_time = tools::metrics::get_histogram("txpool_add_seconds", "Time taken to check and add a transaction to the pool");
+    static tools::metrics::counter &added = tools::metrics::get_counter("txpool_add_total", "Transactions submitted to the pool, by outcome", tools::metrics::label("result", "added"));
+    static tools::metrics::counter &not_added = tools::metrics::get_counter("txpool_add_total", "Transactions submitted to the pool, by outcome", tools::metrics::label("result", "not_added"));
+    static tools::metrics::counter &rejected = tools::metrics::get_counter("txpool_add_total", "Transactions submitted to the pool, by outcome", tools::metrics::label("result", "rejected"));
+    tools::metrics::scoped_timer add_timer(add_time);
+    const auto count_outcome = epee::misc_utils::create_scope_leave_handler([&tvc]{
+      (tvc.m_verifivation_failed ? rejected : tvc.m_added_to_pool ? added : not_added).inc();
+    });
+
     if (tx.version == 0)
     {
       // v0 never accepted
@@ -241,15 +283,8 @@ namespace cryptonote
     // TODO: Investigate why not?
     if(!kept_by_block)
     {
-      if(have_tx_keyimges_as_spent(tx, id))
-      {
-        mark_double_spend(tx);
-        LOG_PRINT_L1("Transaction with id= "<< id << " used already spent key images");
-        tvc.m_verifivation_failed = true;
-        tvc.m_double_spend = true;
-        tvc.m_no_drop_offense = true;
+      if(check_double_spend(tx, id, tvc))
         return false;
-      }
     }
 
     if (!m_blockchain.check_tx_outputs(tx, tvc))
@@ -295,7 +330,9 @@ namespace cryptonote
         meta.double_spend_seen = have_tx_keyimges_as_spent(tx, id);
         meta.pruned = tx.pruned;
         meta.bf_padding = 0;
+        set_validated(meta, 0, null_hash);
         memset(meta.padding, 0, sizeof(meta.padding));
+        set_tx_type_info(meta, tx);
         try
         {
           if (kept_by_block)
@@ -370,7 +407,9 @@ namespace cryptonote
           meta.double_spend_seen = false;
           meta.pruned = tx.pruned;
           meta.bf_padding = 0;
+          set_validated(meta, version, m_blockchain.get_tail_id());
           memset(meta.padding, 0, sizeof(meta.padding));
+          set_tx_type_info(meta, tx);
 
           if (!insert_key_images(tx, id, tx_relay))
             return false;
@@ -763,6 +802,8 @@ namespace cryptonote
   bool tx_memory_pool::remove_stuck_transactions()
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("remove_stuck_transactions");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
     CRITICAL_REGION_LOCAL1(m_blockchain);
     std::list<std::pair<crypto::hash, uint64_t>> remove;
     m_blockchain.for_all_txpool_txes([this, &remove](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
@@ -827,6 +868,8 @@ namespace cryptonote
     std::vector<std::pair<crypto::hash, txpool_tx_meta_t>> change_timestamps;
 
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("get_relayable_transactions");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
     CRITICAL_REGION_LOCAL1(m_blockchain);
     LockedTXN lock(m_blockchain.get_db());
     txs.reserve(m_blockchain.get_txpool_tx_count());
@@ -926,6 +969,7 @@ namespace cryptonote
             meta.last_relayed_time = std::chrono::system_clock::to_time_t(now);
 
           m_blockchain.update_txpool_tx(hash, meta);
+          m_template_candidates.erase(hash);
           // wait until db update succeeds to ensure tx is visible in the pool
           was_just_broadcasted = !already_broadcasted && meta.matches(relay_category::broadcasted);
 
@@ -1062,6 +1106,8 @@ namespace cryptonote
   void tx_memory_pool::get_transaction_backlog(std::vector<tx_backlog_entry>& backlog, bool include_sensitive) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("get_transaction_backlog");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
     CRITICAL_REGION_LOCAL1(m_blockchain);
     const uint64_t now = time(NULL);
     const relay_category category = include_sensitive ? relay_category::all : relay_category::broadcasted;
@@ -1077,6 +1123,79 @@ namespace cryptonote
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
 
+    if (include_sensitive)
+      compute_block_template_backlog(backlog, true);
+    else
+      backlog = get_block_template_backlog_snapshot().entries;
+  }
+  //------------------------------------------------------------------
+  void tx_memory_pool::get_block_template_backlog_diff(uint64_t since_version, tx_block_template_backlog_diff& diff, std::vector<tx_block_template_backlog_entry>* backlog) const
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    CRITICAL_REGION_LOCAL1(m_blockchain);
+
+    const block_template_backlog_snapshot& current = get_block_template_backlog_snapshot();
+    diff.version = current.version;
+    if (backlog)
+      *backlog = current.entries;
+
+    if (since_version)
+    {
+      for (const block_template_backlog_snapshot& snapshot : m_backlog_snapshots)
+      {
+        if (snapshot.version == since_version)
+        {
+          diff.base_version = since_version;
+          cryptonote::get_block_template_backlog_diff(snapshot.entries, current.entries, diff);
+          return;
+        }
+      }
+    }
+
+    diff.base_version = 0;
+    diff.changed = current.entries;
+    diff.removed.clear();
+  }
+  //------------------------------------------------------------------
+  const tx_memory_pool::block_template_backlog_snapshot& tx_memory_pool::get_block_template_backlog_snapshot() const
+  {
+    uint64_t top_height;
+    const crypto::hash top_hash = m_blockchain.get_tail_id(top_height);
+    const uint64_t cookie = m_cookie;
+
+    if (!m_backlog_snapshots.empty())
+    {
+      block_template_backlog_snapshot& last = m_backlog_snapshots.back();
+      if (last.cookie == cookie && last.top_hash == top_hash)
+        return last;
+    }
+
+    std::vector<tx_block_template_backlog_entry> entries;
+    compute_block_template_backlog(entries, false);
+
+    // a pool or chain change does not always change the backlog, keep the version then
+    if (!m_backlog_snapshots.empty())
+    {
+      block_template_backlog_snapshot& last = m_backlog_snapshots.back();
+      tx_block_template_backlog_diff diff;
+      cryptonote::get_block_template_backlog_diff(last.entries, entries, diff);
+      if (diff.changed.empty() && diff.removed.empty())
+      {
+        last.cookie = cookie;
+        last.top_hash = top_hash;
+        last.entries = std::move(entries);
+        return last;
+      }
+    }
+
+    if (m_backlog_snapshots.size() >= TXPOOL_BLOCK_TEMPLATE_BACKLOG_VERSIONS)
+      m_backlog_snapshots.pop_front();
+    m_backlog_snapshots.push_back({++m_backlog_version, cookie, top_hash, std::move(entries)});
+    return m_backlog_snapshots.back();
+  }
+  //------------------------------------------------------------------
+  void tx_memory_pool::compute_block_template_backlog(std::vector<tx_block_template_backlog_entry>& backlog, bool include_sensitive) const
+  {
     std::vector<tx_block_template_backlog_entry> tmp;
     uint64_t total_weight = 0;
 
@@ -1143,8 +1262,13 @@ namespace cryptonote
     stats.txs_total = m_blockchain.get_txpool_tx_count(include_sensitive);
     std::vector<uint32_t> weights;
     weights.reserve(stats.txs_total);
-    m_blockchain.for_all_txpool_txes([&stats, &weights, now, &agebytes](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
+    std::map<std::pair<uint8_t, uint32_t>, txpool_type_stats> types;
+    m_blockchain.for_all_txpool_txes([&stats, &weights, now, &agebytes, &types](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd){
       weights.push_back(meta.weight);
+      txpool_type_stats &type_stats = types[std::make_pair(meta.tx_type, meta.source_asset_id)];
+      type_stats.txs++;
+      type_stats.bytes += meta.weight;
+      type_stats.fee_total += meta.fee;
       stats.bytes_total += meta.weight;
       if (!stats.bytes_min || meta.weight < stats.bytes_min)
         stats.bytes_min = meta.weight;
@@ -1167,6 +1291,14 @@ namespace cryptonote
       return true;
     }, false, category);
 
+    stats.types.reserve(types.size());
+    for (auto &e: types)
+    {
+      e.second.tx_type = e.first.first;
+      e.second.asset_type = asset_type_from_id(e.first.second);
+      stats.types.push_back(std::move(e.second));
+    }
+
     stats.bytes_med = epee::misc_utils::median(weights);
     if (stats.txs_total > 1)
     {
@@ -1326,12 +1458,14 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const
+  bool tx_memory_pool::check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent, bool include_sensitive_txes) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
 
+    const relay_category category = include_sensitive_txes ? relay_category::all : relay_category::broadcasted;
     spent.clear();
+    spent.reserve(key_images.size());
 
     for (const auto& image : key_images)
     {
@@ -1340,7 +1474,7 @@ namespace cryptonote
       if (found != m_spent_key_images.end())
       {
         for (const crypto::hash& tx_hash : found->second)
-          is_spent |= m_blockchain.txpool_tx_matches_category(tx_hash, relay_category::broadcasted);
+          is_spent |= m_blockchain.txpool_tx_matches_category(tx_hash, category);
       }
       spent.push_back(is_spent);
     }
@@ -1365,6 +1499,8 @@ namespace cryptonote
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("on_blockchain_inc");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
     return true;
@@ -1398,6 +1534,20 @@ namespace cryptonote
     return false;
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::check_double_spend(const transaction &tx, const crypto::hash &id, tx_verification_context &tvc)
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    CRITICAL_REGION_LOCAL1(m_blockchain);
+    if(!have_tx_keyimges_as_spent(tx, id))
+      return false;
+    mark_double_spend(tx);
+    LOG_PRINT_L1("Transaction with id= "<< id << " used already spent key images");
+    tvc.m_verifivation_failed = true;
+    tvc.m_double_spend = true;
+    tvc.m_no_drop_offense = true;
+    return true;
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx_keyimg_as_spent(const crypto::key_image& key_im, const crypto::hash& txid) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
@@ -1617,6 +1767,8 @@ namespace cryptonote
   bool tx_memory_pool::fill_block_template(block &bl, size_t median_weight, uint64_t already_generated_coins, size_t &total_weight, uint64_t &fee, uint64_t &expected_reward, uint8_t version)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("fill_block_template");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
     CRITICAL_REGION_LOCAL1(m_blockchain);
 
     uint64_t best_coinbase = 0, coinbase = 0;
@@ -1638,42 +1790,55 @@ namespace cryptonote
 
     LOG_PRINT_L2("Filling block template, median weight " << median_weight << ", " << m_txs_by_fee_and_receive_time.size() << " txes in the pool");
 
+    // readiness only depends on the chain state, so cached verdicts stay valid until the top block changes
+    const crypto::hash top_id = m_blockchain.get_tail_id();
+
     LockedTXN lock(m_blockchain.get_db());
 
     auto sorted_it = m_txs_by_fee_and_receive_time.begin();
     for (; sorted_it != m_txs_by_fee_and_receive_time.end(); ++sorted_it)
     {
-      txpool_tx_meta_t meta;
-      if (!m_blockchain.get_txpool_tx_meta(sorted_it->second, meta))
-      {
-        static bool warned = false;
-        if (!warned)
-          MERROR("  failed to find tx meta: " << sorted_it->second << " (will only print once)");
-        warned = true;
-        continue;
-      }
+      const crypto::hash &txid = sorted_it->second;
 
       // SRCG: skip all user TXs for HF 5 - when the node restarts, it'll discard them fully in `tx_memory_pool::validate()`
       if (version == HF_VERSION_SHUTDOWN_USER_TXS) {
         LOG_PRINT_L2("  User TXs forbidden by consensus for HF 5 - skipping");
         continue;
       }
-      
-      LOG_PRINT_L2("Considering " << sorted_it->second << ", weight " << meta.weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase) << ", relay method " << (unsigned)meta.get_relay_method());
 
-      if (!meta.matches(relay_category::legacy) && !(m_mine_stem_txes && meta.get_relay_method() == relay_method::stem))
+      auto ci = m_template_candidates.find(txid);
+      if (ci == m_template_candidates.end())
       {
-        LOG_PRINT_L2("  tx relay method is " << (unsigned)meta.get_relay_method());
-        continue;
+        txpool_tx_meta_t meta;
+        if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+        {
+          static bool warned = false;
+          if (!warned)
+            MERROR("  failed to find tx meta: " << txid << " (will only print once)");
+          warned = true;
+          continue;
+        }
+        template_candidate candidate;
+        candidate.weight = meta.weight;
+        candidate.fee = meta.fee;
+        candidate.tx_version = 0;
+        candidate.minable = !meta.pruned && (meta.matches(relay_category::legacy) || (m_mine_stem_txes && meta.get_relay_method() == relay_method::stem));
+        candidate.ready = false;
+        candidate.checked_top_id = crypto::null_hash;
+        ci = m_template_candidates.emplace(txid, std::move(candidate)).first;
       }
-      if (meta.pruned)
+      template_candidate &candidate = ci->second;
+
+      LOG_PRINT_L2("Considering " << txid << ", weight " << candidate.weight << ", current block weight " << total_weight << "/" << max_total_weight << ", current coinbase " << print_money(best_coinbase));
+
+      if (!candidate.minable)
       {
-        LOG_PRINT_L2("  tx is pruned");
+        LOG_PRINT_L2("  tx is pruned or its relay method does not allow mining");
         continue;
       }
 
       // Can not exceed maximum block weight
-      if (max_total_weight < total_weight + meta.weight)
+      if (max_total_weight < total_weight + candidate.weight)
       {
         LOG_PRINT_L2("  would exceed maximum block weight");
         continue;
@@ -1685,12 +1850,12 @@ namespace cryptonote
         // If we're getting lower coinbase tx,
         // stop including more tx
         uint64_t block_reward;
-        if(!get_block_reward(median_weight, total_weight + meta.weight, already_generated_coins, block_reward, version))
+        if(!get_block_reward(median_weight, total_weight + candidate.weight, already_generated_coins, block_reward, version))
         {
           LOG_PRINT_L2("  would exceed maximum block weight");
           continue;
         }
-        coinbase = block_reward + fee + meta.fee;
+        coinbase = block_reward + fee + candidate.fee;
         if (coinbase < template_accept_threshold(best_coinbase))
         {
           LOG_PRINT_L2("  would decrease coinbase to " << print_money(coinbase));
@@ -1708,63 +1873,84 @@ namespace cryptonote
         }
       }
 
-      // "local" and "stem" txes are filtered above
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second, relay_category::all);
+      if (candidate.checked_top_id != top_id)
+      {
+        // Skip transactions that are not ready to be
+        // included into the blockchain or that are
+        // missing key images
+        candidate.ready = false;
+        candidate.checked_top_id = top_id;
+        txpool_tx_meta_t meta;
+        if (!m_blockchain.get_txpool_tx_meta(txid, meta))
+        {
+          MERROR("  failed to find tx meta: " << txid);
+          continue;
+        }
 
-      cryptonote::transaction tx;
+        // "local" and "stem" txes are filtered above
+        cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid, relay_category::all);
 
-      // Skip transactions that are not ready to be
-      // included into the blockchain or that are
-      // missing key images
-      const cryptonote::txpool_tx_meta_t original_meta = meta;
-      bool ready = false;
-      try
-      {
-        ready = is_transaction_ready_to_go(meta, sorted_it->second, txblob, tx);
-      }
-      catch (const std::exception &e)
-      {
-        MERROR("Failed to check transaction readiness: " << e.what());
-        // continue, not fatal
-      }
-      if (memcmp(&original_meta, &meta, sizeof(meta)))
-      {
+        cryptonote::transaction tx;
+        const cryptonote::txpool_tx_meta_t original_meta = meta;
         try
         {
-          m_blockchain.update_txpool_tx(sorted_it->second, meta);
+          candidate.ready = is_transaction_ready_to_go(meta, txid, txblob, tx);
         }
         catch (const std::exception &e)
         {
-          MERROR("Failed to update tx meta: " << e.what());
+          MERROR("Failed to check transaction readiness: " << e.what());
           // continue, not fatal
         }
+        if (memcmp(&original_meta, &meta, sizeof(meta)))
+        {
+          try
+          {
+            m_blockchain.update_txpool_tx(txid, meta);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Failed to update tx meta: " << e.what());
+            // continue, not fatal
+          }
+        }
+        if (candidate.ready)
+        {
+          candidate.tx_version = tx.version;
+          candidate.key_images.clear();
+          for (const auto &in: tx.vin)
+          {
+            if (in.type() != typeid(txin_to_key))
+              break;
+            candidate.key_images.push_back(boost::get<txin_to_key>(in).k_image);
+          }
+        }
       }
-      if (!ready)
+      if (!candidate.ready)
       {
         LOG_PRINT_L2("  not ready to go");
         continue;
       }
-      if (have_key_images(k_images, tx))
+      if (std::any_of(candidate.key_images.begin(), candidate.key_images.end(), [&k_images](const crypto::key_image &ki) { return k_images.count(ki) != 0; }))
       {
         LOG_PRINT_L2("  key images already seen");
         continue;
       }
-      if (version < HF_VERSION_CARROT && tx.version >= TRANSACTION_VERSION_CARROT)
+      if (version < HF_VERSION_CARROT && candidate.tx_version >= TRANSACTION_VERSION_CARROT)
       {
         LOG_PRINT_L2("  is a Carrot transaction - cannot be mined");
         continue;
       }
-      if (version >= HF_VERSION_CARROT && tx.version < TRANSACTION_VERSION_CARROT)
+      if (version >= HF_VERSION_CARROT && candidate.tx_version < TRANSACTION_VERSION_CARROT)
       {
         LOG_PRINT_L2("  is not a Carrot transaction - cannot be mined");
         continue;
       }
 
-      bl.tx_hashes.push_back(sorted_it->second);
-      total_weight += meta.weight;
-      fee += meta.fee;
+      bl.tx_hashes.push_back(txid);
+      total_weight += candidate.weight;
+      fee += candidate.fee;
       best_coinbase = coinbase;
-      append_key_images(k_images, tx);
+      k_images.insert(candidate.key_images.begin(), candidate.key_images.end());
       LOG_PRINT_L2("  added, new block weight " << total_weight << "/" << max_total_weight << ", coinbase " << print_money(best_coinbase));
     }
     lock.commit();
@@ -1779,6 +1965,8 @@ namespace cryptonote
   size_t tx_memory_pool::validate(uint8_t version)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    static tools::metrics::histogram &lock_hold = lock_hold_time("validate");
+    tools::metrics::scoped_timer lock_hold_timer(lock_hold);
     CRITICAL_REGION_LOCAL1(m_blockchain);
 
     // Simply throw away incremental info, too difficult to update
@@ -1797,13 +1985,22 @@ namespace cryptonote
       txpool_tx_meta_t meta;
     };
 
-    // get all txids
+    // get all txids, leaving out those already verified against this very
+    // top under this version (eg, stamped before the last restart): nothing
+    // they were checked against has changed since
+    const crypto::hash top_id = m_blockchain.get_tail_id();
     std::vector<tx_entry_t> txes;
-    m_blockchain.for_all_txpool_txes([&txes](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
-      if (!meta.pruned) // skip pruned txes
+    size_t kept = 0;
+    m_blockchain.for_all_txpool_txes([&](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref*) {
+      if (meta.pruned) // skip pruned txes
+        return true;
+      if (is_validated(meta, version, top_id))
+        ++kept;
+      else
         txes.push_back({txid, meta});
       return true;
     }, false, relay_category::all);
+    MINFO(kept << " txes already verified against the current top, re-validating " << txes.size());
 
     // take them all out and add them back in, some might fail
     size_t added = 0;
@@ -1826,6 +2023,7 @@ namespace cryptonote
           MINFO("Failed to re-validate tx " << e.txid << " for v" << (unsigned)version << ", dropped");
           continue;
         }
+        set_validated(e.meta, version, top_id);
         m_blockchain.update_txpool_tx(e.txid, e.meta);
         ++added;
       }
@@ -1872,6 +2070,7 @@ namespace cryptonote
       }
     }
     m_txs_by_fee_and_receive_time.emplace(std::pair<double, time_t>(fee, receive_time), txid);
+    m_template_candidates.erase(txid);
 
     // Don't check for "resurrected" txs in case of reorgs i.e. don't check in 'm_removed_txs_by_time'
     // whether we have that txid there and if yes remove it; this results in possible duplicates
@@ -1893,6 +2092,7 @@ namespace cryptonote
     {
       m_txs_by_fee_and_receive_time.erase(sorted_it);
     }
+    m_template_candidates.erase(txid);
 
     const std::unordered_map<crypto::hash, time_t>::iterator it = m_added_txs_by_id.find(txid);
     if (it != m_added_txs_by_id.end())
@@ -1951,6 +2151,7 @@ namespace cryptonote
 
     m_txpool_max_weight = max_txpool_weight ? max_txpool_weight : DEFAULT_TXPOOL_MAX_WEIGHT;
     m_txs_by_fee_and_receive_time.clear();
+    m_template_candidates.clear();
     m_added_txs_by_id.clear();
     m_added_txs_start_time = (time_t)0;
     m_removed_txs_by_time.clear();
@@ -1958,13 +2159,14 @@ namespace cryptonote
     m_spent_key_images.clear();
     m_txpool_weight = 0;
     std::vector<crypto::hash> remove;
+    std::vector<std::pair<crypto::hash, txpool_tx_meta_t>> untyped;
 
     // first add the not kept by block, then the kept by block,
     // to avoid rejection due to key image collision
     for (int pass = 0; pass < 2; ++pass)
     {
       const bool kept = pass == 1;
-      bool r = m_blockchain.for_all_txpool_txes([this, &remove, kept](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd) {
+      bool r = m_blockchain.for_all_txpool_txes([this, &remove, &untyped, kept](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata_ref *bd) {
         if (!!kept != !!meta.kept_by_block)
           return true;
         cryptonote::transaction_prefix tx;
@@ -1981,12 +2183,35 @@ namespace cryptonote
         }
         add_tx_to_transient_lists(txid, meta.fee / (double)meta.weight, meta.receive_time);
         m_txpool_weight += meta.weight;
+        if (meta.tx_type == cryptonote::transaction_type::UNSET && tx.type != cryptonote::transaction_type::UNSET)
+        {
+          // added by an older version which did not record the tx type
+          untyped.push_back({txid, meta});
+          set_tx_type_info(untyped.back().second, tx);
+        }
         return true;
       }, true, relay_category::all);
       if (!r)
         return false;
     }
-    if (!remove.empty())
+    if (!untyped.empty() && !m_blockchain.get_db().is_read_only())
+    {
+      LockedTXN lock(m_blockchain.get_db());
+      for (const auto &entry: untyped)
+      {
+        try
+        {
+          m_blockchain.update_txpool_tx(entry.first, entry.second);
+        }
+        catch (const std::exception &e)
+        {
+          MWARNING("Failed to update txpool transaction metadata: " << e.what());
+          // ignore error
+        }
+      }
+      lock.commit();
+    }
+    if (!remove.empty() && !m_blockchain.get_db().is_read_only())
     {
       LockedTXN lock(m_blockchain.get_db());
       for (const auto &txid: remove)
@@ -2011,6 +2236,17 @@ namespace cryptonote
     return true;
   }
 
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::reload()
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    // init() resets the cookie, but the contents may well have changed
+    const uint64_t cookie = m_cookie;
+    if (!init(m_txpool_max_weight, m_mine_stem_txes))
+      return false;
+    m_cookie = cookie + 1;
+    return true;
+  }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::deinit()
   {
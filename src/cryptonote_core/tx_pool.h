@@ -32,6 +32,7 @@
 #include "include_base_utils.h"
 
 #include <atomic>
+#include <deque>
 #include <set>
 #include <tuple>
 #include <unordered_map>
@@ -206,6 +207,15 @@ namespace cryptonote
      */
     bool init(size_t max_txpool_weight = 0, bool mine_stem_txes = false);
 
+    /**
+     * @brief re-reads the pool from disk, keeping the current settings
+     *
+     * For a pool kept in a db that another process writes to.
+     *
+     * @return true on success, false otherwise
+     */
+    bool reload();
+
     /**
      * @brief attempts to save the transaction pool state to disk
      *
@@ -272,6 +282,21 @@ namespace cryptonote
      */
     void get_block_template_backlog(std::vector<tx_block_template_backlog_entry>& backlog, bool include_sensitive = false) const;
 
+    /**
+     * @brief get the block template backlog as changes since an earlier version
+     *
+     * The pool remembers the last few backlogs it handed out, each with a
+     * version that changes whenever the backlog does. If `since_version` is
+     * one of them, only the entries added, updated or removed since then
+     * are returned, otherwise the whole backlog is. Stempool, anonymity-pool
+     * and unrelayed txes are never included.
+     *
+     * @param since_version the backlog version the caller has, 0 for none
+     * @param diff return-by-reference the changes, or the whole backlog
+     * @param backlog if not null, return-by-reference the whole backlog at `diff.version`
+     */
+    void get_block_template_backlog_diff(uint64_t since_version, tx_block_template_backlog_diff& diff, std::vector<tx_block_template_backlog_entry>* backlog = nullptr) const;
+
     /**
      * @brief get a summary statistics of all transaction hashes in the pool
      *
@@ -312,10 +337,27 @@ namespace cryptonote
      *
      * @param key_images [in] vector of key images to check
      * @param spent [out] vector of bool to return
+     * @param include_sensitive_txes [in] include txes not broadcast yet
      *
      * @return true
      */
-    bool check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const;
+    bool check_for_key_images(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent, bool include_sensitive_txes = false) const;
+
+    /**
+     * @brief reject a transaction early if it double spends a pool transaction
+     *
+     * This is the same check add_tx does, but is cheap enough to run before
+     * the expensive proof verification of incoming transactions. On a hit,
+     * the conflicting pool transactions are marked and tvc is filled in as
+     * add_tx would.
+     *
+     * @param tx the transaction to check
+     * @param id the hash of the transaction
+     * @param tvc [out] verification results, set only on a double spend
+     *
+     * @return true if the transaction double spends, otherwise false
+     */
+    bool check_double_spend(const transaction &tx, const crypto::hash &id, tx_verification_context &tvc);
 
     /**
      * @brief get a specific transaction from the pool
@@ -627,6 +669,28 @@ private:
 
     std::atomic<uint64_t> m_cookie; //!< incremented at each change
 
+    //! a block template backlog handed out, kept to compute diffs against
+    struct block_template_backlog_snapshot
+    {
+      uint64_t version;
+      uint64_t cookie;        //!< pool cookie when the backlog was last checked
+      crypto::hash top_hash;  //!< chain tip when the backlog was last checked
+      std::vector<tx_block_template_backlog_entry> entries;
+    };
+
+    /**
+     * @brief get the current block template backlog, recomputing it only if the pool or the chain changed
+     *
+     * @return the latest snapshot, valid while m_transactions_lock is held
+     */
+    const block_template_backlog_snapshot& get_block_template_backlog_snapshot() const;
+
+    //! builds the block template backlog from the pool contents
+    void compute_block_template_backlog(std::vector<tx_block_template_backlog_entry>& backlog, bool include_sensitive) const;
+
+    mutable std::deque<block_template_backlog_snapshot> m_backlog_snapshots; //!< oldest first
+    mutable uint64_t m_backlog_version; //!< version of the newest snapshot
+
     // Info when transactions entered the pool, accessible by txid
     std::unordered_map<crypto::hash, time_t> m_added_txs_by_id;
 
@@ -675,6 +739,21 @@ private:
 
     std::unordered_map<crypto::hash, transaction> m_parsed_tx_cache;
 
+    //! what fill_block_template needs to know about a pool tx, so it can skip the db
+    struct template_candidate
+    {
+      uint64_t weight;
+      uint64_t fee;
+      size_t tx_version;
+      bool minable;  //!< relay method allows mining and the tx is not pruned
+      bool ready;  //!< result of is_transaction_ready_to_go at checked_top_id
+      crypto::hash checked_top_id;
+      std::vector<crypto::key_image> key_images;
+    };
+
+    //! template candidates by txid, filled lazily and dropped when a tx leaves the pool or changes relay method
+    std::unordered_map<crypto::hash, template_candidate> m_template_candidates;
+
     //! Next timestamp that a DB check for relayable txes is allowed
     std::atomic<time_t> m_next_check;
 
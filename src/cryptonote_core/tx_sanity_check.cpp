@@ -27,6 +27,7 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdint.h>
+#include <algorithm>
 #include <vector>
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
@@ -54,7 +55,8 @@ bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_avai
     MERROR("Transaction is coinbase");
     return false;
   }
-  std::set<uint64_t> rct_indices;
+  // a sorted vector is much cheaper to build than a set for a few hundred ring members
+  std::vector<uint64_t> rct_indices;
   size_t n_indices = 0;
 
   for (const auto &txin : tx.vin)
@@ -65,15 +67,21 @@ bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_avai
     if (in_to_key.amount != 0)
       continue;
     const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(in_to_key.key_offsets);
-    for (uint64_t offset: absolute)
-      rct_indices.insert(offset);
+    rct_indices.insert(rct_indices.end(), absolute.begin(), absolute.end());
     n_indices += in_to_key.key_offsets.size();
   }
+  std::sort(rct_indices.begin(), rct_indices.end());
+  rct_indices.erase(std::unique(rct_indices.begin(), rct_indices.end()), rct_indices.end());
 
-  return tx_sanity_check(rct_indices, n_indices, rct_outs_available);
+  return tx_sanity_check(std::move(rct_indices), n_indices, rct_outs_available);
 }
 
 bool tx_sanity_check(const std::set<uint64_t> &rct_indices, size_t n_indices, uint64_t rct_outs_available)
+{
+  return tx_sanity_check(std::vector<uint64_t>(rct_indices.begin(), rct_indices.end()), n_indices, rct_outs_available);
+}
+
+bool tx_sanity_check(std::vector<uint64_t> &&rct_indices, size_t n_indices, uint64_t rct_outs_available)
 {
   if (n_indices <= 10)
   {
@@ -90,8 +98,7 @@ bool tx_sanity_check(const std::set<uint64_t> &rct_indices, size_t n_indices, ui
     return false;
   }
 
-  std::vector<uint64_t> offsets(rct_indices.begin(), rct_indices.end());
-  uint64_t median = epee::misc_utils::median(offsets);
+  uint64_t median = epee::misc_utils::median(rct_indices);
   if (median < rct_outs_available * 6 / 10)
   {
     MERROR("median offset index is too low (median is " << median << " out of total " << rct_outs_available << "offsets). Transactions should contain a higher fraction of recent outputs.");
@@ -27,10 +27,13 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <set>
+#include <vector>
 #include "cryptonote_basic/blobdatatype.h"
 
 namespace cryptonote
 {
   bool tx_sanity_check(const cryptonote::blobdata &tx_blob, uint64_t rct_outs_available);
   bool tx_sanity_check(const std::set<uint64_t> &rct_indices, size_t n_indices, uint64_t rct_outs_available);
+  //! rct_indices must be sorted and unique
+  bool tx_sanity_check(std::vector<uint64_t> &&rct_indices, size_t n_indices, uint64_t rct_outs_available);
 }
@@ -28,6 +28,8 @@
 
 #include <boost/iterator/transform_iterator.hpp>
 
+#include <algorithm>
+
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_core/blockchain.h"
 #include "cryptonote_core/tx_verification_utils.h"
@@ -121,6 +123,86 @@ static crypto::hash calc_tx_mixring_hash(const transaction& tx, const rct::ctkey
 namespace cryptonote
 {
 
+rct_ver_cache_t::rct_ver_cache_t(size_t capacity):
+    m_shard_capacity(0),
+    m_hits(0),
+    m_misses(0),
+    m_evictions(0)
+{
+    set_capacity(capacity);
+}
+
+void rct_ver_cache_t::set_capacity(size_t capacity)
+{
+    m_shard_capacity = (std::max<size_t>(capacity, 1) + NUM_SHARDS - 1) / NUM_SHARDS;
+    for (shard_t &shard: m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        shard.hashes.clear();
+        shard.fifo.clear();
+        shard.fifo.shrink_to_fit();
+        shard.next = 0;
+    }
+}
+
+rct_ver_cache_t::shard_t &rct_ver_cache_t::get_shard(const crypto::hash &tx_mixring_hash) const
+{
+    // the hash is uniformly distributed, so any byte of it spreads the shards evenly
+    return m_shards[static_cast<unsigned char>(tx_mixring_hash.data[0]) % NUM_SHARDS];
+}
+
+void rct_ver_cache_t::add(const crypto::hash &tx_mixring_hash)
+{
+    shard_t &shard = get_shard(tx_mixring_hash);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (!shard.hashes.insert(tx_mixring_hash).second)
+        return;
+    const size_t shard_capacity = m_shard_capacity;
+    if (shard.fifo.size() < shard_capacity)
+    {
+        shard.fifo.push_back(tx_mixring_hash);
+        return;
+    }
+    crypto::hash &oldest = shard.fifo[shard.next];
+    shard.hashes.erase(oldest);
+    oldest = tx_mixring_hash;
+    shard.next = (shard.next + 1) % shard.fifo.size();
+    ++m_evictions;
+}
+
+bool rct_ver_cache_t::has(const crypto::hash &tx_mixring_hash) const
+{
+    const shard_t &shard = get_shard(tx_mixring_hash);
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        found = shard.hashes.find(tx_mixring_hash) != shard.hashes.end();
+    }
+    ++(found ? m_hits : m_misses);
+    return found;
+}
+
+rct_ver_cache_t::stats_t rct_ver_cache_t::get_stats() const
+{
+    stats_t stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.size = 0;
+    stats.bytes = 0;
+    for (const shard_t &shard: m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        stats.size += shard.hashes.size();
+        // a node per hash with its next pointer and cached hash code, plus the bucket array
+        stats.bytes += shard.hashes.size() * (sizeof(crypto::hash) + 2 * sizeof(void*))
+            + shard.hashes.bucket_count() * sizeof(void*)
+            + shard.fifo.capacity() * sizeof(crypto::hash);
+    }
+    stats.capacity = m_shard_capacity * NUM_SHARDS;
+    return stats;
+}
+
 bool collect_pubkeys_and_commitments(const transaction& tx, std::vector<rct::key> &pubkeys_and_commitments_inout)
 {
     for (std::size_t i = 0; i < tx.vout.size(); ++i)
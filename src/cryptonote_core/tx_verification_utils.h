@@ -28,7 +28,12 @@
 
 #pragma once
 
-#include "common/data_cache.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 #include "cryptonote_basic/cryptonote_basic.h"
 
 namespace cryptonote
@@ -50,7 +55,57 @@ bool are_transaction_output_pubkeys_sorted(const transaction_prefix &tx_prefix);
 // Modifying this value should not affect consensus. You can adjust it for performance needs
 static constexpr const size_t RCT_VER_CACHE_SIZE = 8192;
 
-using rct_ver_cache_t = ::tools::data_cache<::crypto::hash, RCT_VER_CACHE_SIZE>;
+/**
+ * @brief Set of tx+mixring hashes which passed RCT verification
+ *
+ * The oldest entries are evicted first once the capacity is reached. The
+ * set is split into shards with a lock each, so verifications running on
+ * different threads rarely contend. Lookups and evictions are counted.
+ */
+class rct_ver_cache_t
+{
+public:
+  struct stats_t
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t size;
+    size_t capacity;
+    size_t bytes; // estimated heap use of the hash sets and eviction queues
+  };
+
+  explicit rct_ver_cache_t(size_t capacity = RCT_VER_CACHE_SIZE);
+
+  /**
+   * @brief change the number of hashes kept, dropping the current ones
+   */
+  void set_capacity(size_t capacity);
+
+  void add(const crypto::hash &tx_mixring_hash);
+  bool has(const crypto::hash &tx_mixring_hash) const;
+
+  stats_t get_stats() const;
+
+private:
+  static constexpr const size_t NUM_SHARDS = 16;
+
+  struct shard_t
+  {
+    mutable std::mutex lock;
+    std::unordered_set<crypto::hash> hashes;
+    std::vector<crypto::hash> fifo;
+    size_t next = 0;
+  };
+
+  shard_t &get_shard(const crypto::hash &tx_mixring_hash) const;
+
+  mutable std::array<shard_t, NUM_SHARDS> m_shards;
+  std::atomic<size_t> m_shard_capacity;
+  mutable std::atomic<uint64_t> m_hits;
+  mutable std::atomic<uint64_t> m_misses;
+  std::atomic<uint64_t> m_evictions;
+};
 
 /**
  * @brief Cached version of rct::verRctNonSemanticsSimple
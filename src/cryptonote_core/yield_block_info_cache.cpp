@@ -0,0 +1,137 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+
+#include "yield_block_info_cache.h"
+
+namespace cryptonote
+{
+//------------------------------------------------------------------
+yield_block_info_cache::yield_block_info_cache(size_t capacity)
+{
+  reset(capacity);
+}
+//------------------------------------------------------------------
+void yield_block_info_cache::reset(size_t capacity)
+{
+  m_capacity = capacity;
+  m_entries.clear();
+  m_entries.resize(2 * capacity);
+  clear();
+}
+//------------------------------------------------------------------
+void yield_block_info_cache::clear()
+{
+  m_accrual_heights.clear();
+  m_head = 0;
+  m_size = 0;
+  m_start_height = 0;
+}
+//------------------------------------------------------------------
+bool yield_block_info_cache::push_back(const yield_block_info& ybi)
+{
+  if (m_capacity == 0)
+    return false;
+
+  if (m_size == 0) {
+    m_head = 0;
+    m_start_height = ybi.block_height;
+  } else if (ybi.block_height != end_height()) {
+    return false;
+  }
+
+  // Evict the oldest entry if the buffer is full
+  if (m_size == m_capacity) {
+    if (!m_accrual_heights.empty() && m_accrual_heights.front() == m_start_height)
+      m_accrual_heights.pop_front();
+    m_head = (m_head + 1) % m_capacity;
+    ++m_start_height;
+    --m_size;
+  }
+
+  // Store the entry in both halves, so any window is contiguous
+  const size_t idx = slot(ybi.block_height);
+  m_entries[idx] = ybi;
+  m_entries[idx + m_capacity] = ybi;
+  ++m_size;
+
+  if (ybi.slippage_total_this_block != 0 && ybi.locked_coins_tally != 0)
+    m_accrual_heights.push_back(ybi.block_height);
+  return true;
+}
+//------------------------------------------------------------------
+bool yield_block_info_cache::push_front(const yield_block_info& ybi)
+{
+  if (m_size == 0)
+    return push_back(ybi);
+  if (m_size == m_capacity || m_start_height == 0 || ybi.block_height != m_start_height - 1)
+    return false;
+
+  m_head = (m_head + m_capacity - 1) % m_capacity;
+  --m_start_height;
+  m_entries[m_head] = ybi;
+  m_entries[m_head + m_capacity] = ybi;
+  ++m_size;
+
+  if (ybi.slippage_total_this_block != 0 && ybi.locked_coins_tally != 0)
+    m_accrual_heights.push_front(ybi.block_height);
+  return true;
+}
+//------------------------------------------------------------------
+bool yield_block_info_cache::pop_back()
+{
+  if (m_size == 0)
+    return false;
+
+  --m_size;
+  if (!m_accrual_heights.empty() && m_accrual_heights.back() == end_height())
+    m_accrual_heights.pop_back();
+  return true;
+}
+//------------------------------------------------------------------
+const yield_block_info* yield_block_info_cache::get(uint64_t height) const noexcept
+{
+  if (!contains(height))
+    return nullptr;
+  return &m_entries[slot(height)];
+}
+//------------------------------------------------------------------
+epee::span<const yield_block_info> yield_block_info_cache::get_range(uint64_t from_height, uint64_t to_height) const noexcept
+{
+  if (m_size == 0)
+    return {};
+  from_height = std::max(from_height, m_start_height);
+  to_height = std::min(to_height, end_height());
+  if (from_height >= to_height)
+    return {};
+  return {&m_entries[slot(from_height)], static_cast<size_t>(to_height - from_height)};
+}
+//------------------------------------------------------------------
+}
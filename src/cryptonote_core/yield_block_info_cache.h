@@ -0,0 +1,149 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "span.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+
+namespace cryptonote
+{
+
+// Number of blocks kept below the yield lock period window, so that popping blocks during a reorg
+// does not require the cache to be reloaded from the DB. Modifying this value does not affect consensus.
+static constexpr const uint64_t YBI_CACHE_REORG_DEPTH = 720;
+
+/**
+ * @brief height-indexed circular buffer of yield_block_info entries
+ *
+ * Holds the YBI entries for a contiguous range of heights, ending at the top of the chain. Each
+ * entry is stored twice, at its slot and again one capacity further on, so that any range of
+ * cached heights can be handed out as a single contiguous read-only span without copying.
+ *
+ * The cache also keeps an ascending index of the cached heights that accrue yield (non-zero
+ * slippage and non-zero locked coin tally), which is all the yield payout calculation needs to
+ * visit.
+ *
+ * Not thread-safe: callers are expected to hold the blockchain lock, and spans handed out are
+ * only valid until the next push_back() / pop_back() / reset().
+ */
+class yield_block_info_cache
+{
+public:
+  explicit yield_block_info_cache(size_t capacity = 0);
+
+  /**
+   * @brief empty the cache and change its capacity
+   *
+   * @param capacity the maximum number of heights to hold
+   */
+  void reset(size_t capacity);
+
+  //! empty the cache, keeping its capacity
+  void clear();
+
+  size_t capacity() const noexcept { return m_capacity; }
+  size_t size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+
+  //! the lowest cached height (undefined if empty)
+  uint64_t start_height() const noexcept { return m_start_height; }
+
+  //! one past the highest cached height
+  uint64_t end_height() const noexcept { return m_start_height + m_size; }
+
+  //! TRUE if the given height is in the cache
+  bool contains(uint64_t height) const noexcept { return m_size && height >= m_start_height && height < end_height(); }
+
+  /**
+   * @brief append the entry for the next height, evicting the oldest entry if full
+   *
+   * @param ybi the entry to append - its block_height must be end_height() unless the cache is empty
+   *
+   * @return TRUE if the entry was appended, FALSE if it was not the next height
+   */
+  bool push_back(const yield_block_info& ybi);
+
+  /**
+   * @brief prepend the entry for the height below the lowest cached height
+   *
+   * @param ybi the entry to prepend - its block_height must be start_height() - 1 unless the cache is empty
+   *
+   * @return TRUE if the entry was prepended, FALSE if it was not the previous height or the cache is full
+   */
+  bool push_front(const yield_block_info& ybi);
+
+  /**
+   * @brief remove the entry for the highest height
+   *
+   * @return TRUE if an entry was removed, FALSE if the cache was empty
+   */
+  bool pop_back();
+
+  /**
+   * @brief get the entry for a height
+   *
+   * @return a pointer to the entry, or nullptr if not cached
+   */
+  const yield_block_info* get(uint64_t height) const noexcept;
+
+  /**
+   * @brief get the cached entries for a range of heights
+   *
+   * The range is clamped to the cached heights.
+   *
+   * @param from_height first height of the range
+   * @param to_height one past the last height of the range
+   *
+   * @return read-only span over the entries, in ascending height order
+   */
+  epee::span<const yield_block_info> get_range(uint64_t from_height, uint64_t to_height) const noexcept;
+
+  //! ascending cached heights with non-zero slippage and locked coin tally
+  const std::deque<uint64_t>& get_accrual_heights() const noexcept { return m_accrual_heights; }
+
+  //! bytes allocated for the entries and the accrual index
+  size_t memory_usage() const noexcept { return m_entries.capacity() * sizeof(yield_block_info) + m_accrual_heights.size() * sizeof(uint64_t); }
+
+private:
+  size_t slot(uint64_t height) const noexcept { return (m_head + (height - m_start_height)) % m_capacity; }
+
+  std::vector<yield_block_info> m_entries;
+  std::deque<uint64_t> m_accrual_heights;
+  size_t m_capacity;
+  size_t m_head;
+  size_t m_size;
+  uint64_t m_start_height;
+};
+
+}
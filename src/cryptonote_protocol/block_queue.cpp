@@ -46,6 +46,12 @@ namespace cryptonote
 void block_queue::add_blocks(uint64_t height, std::vector<cryptonote::block_complete_entry> bcel, const boost::uuids::uuid &connection_id, const epee::net_utils::network_address &addr, float rate, size_t size)
 {
   boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  if (!bcel.empty())
+  {
+    // same pseudo average as the rates: recent spans matter most
+    const float span_block_size = size / (float)bcel.size();
+    avg_block_size = avg_block_size > 0.0f ? (avg_block_size + span_block_size) / 2 : span_block_size;
+  }
   std::vector<crypto::hash> hashes;
   bool has_hashes = remove_span(height, &hashes);
   blocks.insert(span(height, std::move(bcel), connection_id, addr, rate, size));
@@ -104,6 +110,13 @@ void block_queue::flush_stale_spans(const std::set<boost::uuids::uuid> &live_con
       erase_block(j);
     }
   }
+  for (auto p = stripe_peers.begin(); p != stripe_peers.end(); )
+  {
+    if (live_connections.find(p->first) == live_connections.end())
+      remove_stripe_peer((p++)->first);
+    else
+      ++p;
+  }
 }
 
 bool block_queue::remove_span(uint64_t start_block_height, std::vector<crypto::hash> *hashes)
@@ -270,8 +283,22 @@ std::pair<uint64_t, uint64_t> block_queue::reserve_span(uint64_t first_block_hei
       span_start_height = next_unpruned_height;
     }
   }
-  MDEBUG("span_start_height: " <<span_start_height);
   const uint64_t block_hashes_start_height = last_block_height - block_hashes.size() + 1;
+  if (!sync_pruned_blocks && pruning_seed == 0)
+  {
+    // full peers are the only ones able to serve stripes no pruned peer has, so leave
+    // the stripes pruned peers can serve to them and start on the next uncovered one
+    const uint64_t limit = std::min<uint64_t>(block_hashes_start_height + block_hashes.size(),
+        span_start_height + (CRYPTONOTE_PRUNING_STRIPE_SIZE << CRYPTONOTE_PRUNING_LOG_STRIPES));
+    const uint64_t uncovered_height = get_next_uncovered_height(span_start_height, limit, blockchain_height);
+    if (uncovered_height != span_start_height && uncovered_height < limit)
+    {
+      MDEBUG("Full peer skipping to uncovered stripe: ideal height " << span_start_height << ", uncovered height " << uncovered_height <<
+          " (+" << uncovered_height - span_start_height << ")");
+      span_start_height = uncovered_height;
+    }
+  }
+  MDEBUG("span_start_height: " <<span_start_height);
   if (span_start_height >= block_hashes.size() + block_hashes_start_height)
   {
     MDEBUG("Out of hashes, cannot reserve");
@@ -311,6 +338,19 @@ std::pair<uint64_t, uint64_t> block_queue::reserve_span(uint64_t first_block_hei
   return std::make_pair(span_start_height, span_length);
 }
 
+uint64_t block_queue::get_next_uncovered_height(uint64_t height, uint64_t limit, uint64_t blockchain_height) const
+{
+  while (height < limit)
+  {
+    const uint32_t stripe = tools::get_pruning_stripe(height, blockchain_height, CRYPTONOTE_PRUNING_LOG_STRIPES);
+    if (stripe == 0 || stripe >= num_stripe_peers.size() || num_stripe_peers[stripe] == 0)
+      return height;
+    // no need to look at every block in a covered stripe, skip to the start of the next one
+    height = (height / CRYPTONOTE_PRUNING_STRIPE_SIZE + 1) * CRYPTONOTE_PRUNING_STRIPE_SIZE;
+  }
+  return limit;
+}
+
 std::pair<uint64_t, uint64_t> block_queue::get_next_span_if_scheduled(std::vector<crypto::hash> &hashes, boost::uuids::uuid &connection_id, boost::posix_time::ptime &time) const
 {
   boost::unique_lock<boost::recursive_mutex> lock(mutex);
@@ -531,6 +571,12 @@ float block_queue::get_download_rate(const boost::uuids::uuid &connection_id) co
   return conn_rate;
 }
 
+float block_queue::get_average_block_size() const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  return avg_block_size;
+}
+
 bool block_queue::foreach(std::function<bool(const span&)> f) const
 {
   boost::unique_lock<boost::recursive_mutex> lock(mutex);
@@ -541,4 +587,31 @@ bool block_queue::foreach(std::function<bool(const span&)> f) const
   return true;
 }
 
+void block_queue::add_stripe_peer(const boost::uuids::uuid &connection_id, uint32_t pruning_seed)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  remove_stripe_peer(connection_id);
+  const uint32_t stripe = tools::get_pruning_stripe(pruning_seed);
+  if (num_stripe_peers.size() <= stripe)
+    num_stripe_peers.resize(stripe + 1, 0);
+  stripe_peers[connection_id] = stripe;
+  ++num_stripe_peers[stripe];
+}
+
+void block_queue::remove_stripe_peer(const boost::uuids::uuid &connection_id)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  const auto i = stripe_peers.find(connection_id);
+  if (i == stripe_peers.end())
+    return;
+  --num_stripe_peers[i->second];
+  stripe_peers.erase(i);
+}
+
+size_t block_queue::get_num_stripe_peers(uint32_t stripe) const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  return stripe < num_stripe_peers.size() ? num_stripe_peers[stripe] : 0;
+}
+
 }
@@ -32,6 +32,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <set>
 #include <unordered_set>
 #include <boost/thread/recursive_mutex.hpp>
@@ -95,19 +96,27 @@ namespace cryptonote
     bool has_spans(const boost::uuids::uuid &connection_id) const;
     float get_speed(const boost::uuids::uuid &connection_id) const;
     float get_download_rate(const boost::uuids::uuid &connection_id) const;
+    float get_average_block_size() const;
     bool foreach(std::function<bool(const span&)> f) const;
     bool requested(const crypto::hash &hash) const;
     bool have(const crypto::hash &hash) const;
     std::uint64_t have_height(const crypto::hash &hash) const;
+    void add_stripe_peer(const boost::uuids::uuid &connection_id, uint32_t pruning_seed);
+    void remove_stripe_peer(const boost::uuids::uuid &connection_id);
+    size_t get_num_stripe_peers(uint32_t stripe) const;
 
   private:
     void erase_block(block_map::iterator j);
     inline bool requested_internal(const crypto::hash &hash) const;
+    uint64_t get_next_uncovered_height(uint64_t height, uint64_t limit, uint64_t blockchain_height) const;
 
   private:
     block_map blocks;
     mutable boost::recursive_mutex mutex;
     std::unordered_set<crypto::hash> requested_hashes;
     std::unordered_map<crypto::hash, std::uint64_t> have_blocks;
+    float avg_block_size = 0.0f;
+    std::map<boost::uuids::uuid, uint32_t> stripe_peers;
+    std::vector<size_t> num_stripe_peers;
   };
 }
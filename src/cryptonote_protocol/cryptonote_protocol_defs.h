@@ -44,6 +44,46 @@ namespace cryptonote
   /************************************************************************/
   /* P2P connection info, serializable to json                            */
   /************************************************************************/
+  struct connection_command_traffic
+  {
+    uint32_t command;
+    uint64_t recv_count;
+    uint64_t recv_bytes;
+    uint64_t send_count;
+    uint64_t send_bytes;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(command)
+      KV_SERIALIZE(recv_count)
+      KV_SERIALIZE(recv_bytes)
+      KV_SERIALIZE(send_count)
+      KV_SERIALIZE(send_bytes)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct connection_compression_traffic
+  {
+    uint64_t send_count;
+    uint64_t send_bytes;
+    uint64_t send_wire_bytes;
+    uint64_t compress_us;
+    uint64_t recv_count;
+    uint64_t recv_bytes;
+    uint64_t recv_wire_bytes;
+    uint64_t decompress_us;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(send_count)
+      KV_SERIALIZE(send_bytes)
+      KV_SERIALIZE(send_wire_bytes)
+      KV_SERIALIZE(compress_us)
+      KV_SERIALIZE(recv_count)
+      KV_SERIALIZE(recv_bytes)
+      KV_SERIALIZE(recv_wire_bytes)
+      KV_SERIALIZE(decompress_us)
+    END_KV_SERIALIZE_MAP()
+  };
+
   struct connection_info
   {
     bool incoming;
@@ -86,6 +126,11 @@ namespace cryptonote
 
     uint8_t address_type;
 
+    std::vector<connection_command_traffic> command_traffic;
+
+    bool compression;
+    connection_compression_traffic compression_traffic;
+
     BEGIN_KV_SERIALIZE_MAP()
       KV_SERIALIZE(incoming)
       KV_SERIALIZE(localhost)
@@ -112,6 +157,9 @@ namespace cryptonote
       KV_SERIALIZE(height)
       KV_SERIALIZE(pruning_seed)
       KV_SERIALIZE(address_type)
+      KV_SERIALIZE(command_traffic)
+      KV_SERIALIZE_OPT(compression, false)
+      KV_SERIALIZE(compression_traffic)
     END_KV_SERIALIZE_MAP()
   };
 
@@ -145,15 +193,24 @@ namespace cryptonote
       }
       else
       {
-        std::vector<blobdata> txs;
         if (is_store)
         {
-          txs.reserve(this_ref.txs.size());
-          for (const auto &e: this_ref.txs) txs.push_back(e.blob);
+          // unpruned txs go out as a plain array of blobs; build it straight
+          // from the entries, since the storage has to take its own copy of
+          // each blob anyway and an intermediate vector would be a second one
+          if (!this_ref.txs.empty())
+          {
+            auto it = this_ref.txs.begin();
+            auto hval_array = stg.insert_first_value("txs", blobdata(it->blob), hparent_section);
+            CHECK_AND_ASSERT_MES(hval_array, false, "failed to insert first value to storage");
+            for (++it; it != this_ref.txs.end(); ++it)
+              stg.insert_next_value(hval_array, blobdata(it->blob));
+          }
         }
-        epee::serialization::selector<is_store>::serialize(txs, stg, hparent_section, "txs");
-        if (!is_store)
+        else
         {
+          std::vector<blobdata> txs;
+          epee::serialization::selector<is_store>::serialize(txs, stg, hparent_section, "txs");
           block_complete_entry &self = const_cast<block_complete_entry&>(this_ref);
           self.txs.clear();
           self.txs.reserve(txs.size());
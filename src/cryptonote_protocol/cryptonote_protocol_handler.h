@@ -34,6 +34,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <boost/program_options/variables_map.hpp>
 #include <string>
 
@@ -146,13 +147,15 @@ namespace cryptonote
     int handle_notify_get_txpool_complement(int command, NOTIFY_GET_TXPOOL_COMPLEMENT::request& arg, cryptonote_connection_context& context);
 		
     //----------------- i_bc_protocol_layout ---------------------------------------
-    virtual bool relay_block(NOTIFY_NEW_BLOCK::request& arg, cryptonote_connection_context& exclude_context);
+    //! relays a block, fluffy peers get the txs at prefill_tx_indices (into arg.b.txs) inline as they likely lack them
+    virtual bool relay_block(NOTIFY_NEW_BLOCK::request& arg, cryptonote_connection_context& exclude_context, const std::vector<size_t>& prefill_tx_indices);
     virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg, const boost::uuids::uuid& source, epee::net_utils::zone zone, relay_method tx_relay);
     //----------------------------------------------------------------------------------
     //bool get_payload_sync_data(HANDSHAKE_DATA::request& hshd, cryptonote_connection_context& context);
     bool should_drop_connection(cryptonote_connection_context& context, uint32_t next_stripe);
     bool request_missing_objects(cryptonote_connection_context& context, bool check_having_blocks, bool force_next_span = false);
     size_t get_synchronizing_connections_count();
+    size_t get_span_block_count(const cryptonote_connection_context& context) const;
     bool on_connection_synchronized();
     bool should_download_next_span(cryptonote_connection_context& context, bool standby);
     bool should_ask_for_pruned_data(cryptonote_connection_context& context, uint64_t first_block_height, uint64_t nblocks, bool check_block_weights) const;
@@ -214,6 +217,15 @@ namespace cryptonote
 
         epee::levin::message_writer out{256 * 1024}; // optimize for block responses
         epee::serialization::store_t_to_binary(arg, out.buffer);
+        // mostly block spans and chain entries get past the threshold
+        const std::size_t size = out.payload_size();
+        if (context.m_levin_compression && size >= LEVIN_COMPRESSION_THRESHOLD)
+        {
+          const auto start = std::chrono::steady_clock::now();
+          out.compress();
+          const uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+          context.on_compression_traffic(true, size, out.payload_size(), microseconds);
+        }
         //handler_response_blocks_now(blob.size()); // XXX
         return m_p2p->invoke_notify_to_peer(t_parameter::ID, std::move(out), context);
       }
@@ -44,6 +44,7 @@
 #include "net/network_throttle-detail.hpp"
 #include "common/pruning.h"
 #include "common/util.h"
+#include "common/trace.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "net.cn"
@@ -73,6 +74,7 @@
 #define PASSIVE_PEER_KICK_TIME (60 * 1000000) // microseconds
 #define DROP_ON_SYNC_WEDGE_THRESHOLD (30 * 1000000000ull) // nanoseconds
 #define LAST_ACTIVITY_STALL_THRESHOLD (2.0f) // seconds
+#define SPAN_TARGET_DOWNLOAD_TIME (3.0f) // seconds, at the peer's measured rate
 #define DROP_PEERS_ON_SCORE -2
 
 namespace cryptonote
@@ -325,6 +327,15 @@ namespace cryptonote
       cnx.pruning_seed = cntxt.m_pruning_seed;
       cnx.address_type = (uint8_t)cntxt.m_remote_address.get_type_id();
 
+      for (const auto &traffic: cntxt.m_command_traffic)
+        if (traffic.command)
+          cnx.command_traffic.push_back({(uint32_t)traffic.command, traffic.recv_count, traffic.recv_bytes, traffic.send_count, traffic.send_bytes});
+
+      const auto &compression = cntxt.m_compression_traffic;
+      cnx.compression = cntxt.m_levin_compression;
+      cnx.compression_traffic = {compression.send_count, compression.send_bytes, compression.send_wire_bytes, compression.compress_us,
+        compression.recv_count, compression.recv_bytes, compression.recv_wire_bytes, compression.decompress_us};
+
       connections.push_back(cnx);
 
       return true;
@@ -374,6 +385,7 @@ namespace cryptonote
     }
     context.m_remote_blockchain_height = hshd.current_height;
     context.m_pruning_seed = hshd.pruning_seed;
+    m_block_queue.add_stripe_peer(context.m_connection_id, context.m_pruning_seed);
 
     uint64_t target = m_core.get_target_blockchain_height();
     if (target == 0)
@@ -470,6 +482,7 @@ namespace cryptonote
     template<class t_core>
     int t_cryptonote_protocol_handler<t_core>::handle_notify_new_block(int command, NOTIFY_NEW_BLOCK::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_notify_new_block");
     MLOGIF_P2P_MESSAGE(crypto::hash hash; cryptonote::block b; bool ret = cryptonote::parse_and_validate_block_from_blob(arg.b.block, b, &hash);, ret, context << "Received NOTIFY_NEW_BLOCK " << hash << " (height " << arg.current_blockchain_height << ", " << arg.b.txs.size() << " txes)");
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
@@ -521,7 +534,7 @@ namespace cryptonote
     if(bvc.m_added_to_main_chain)
     {
       //TODO: Add here announce protocol usage
-      relay_block(arg, context);
+      relay_block(arg, context, {});
     }else if(bvc.m_marked_as_orphaned)
     {
       context.m_needed_objects.clear();
@@ -548,6 +561,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_notify_new_fluffy_block(int command, NOTIFY_NEW_FLUFFY_BLOCK::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_notify_new_fluffy_block");
     MLOGIF_P2P_MESSAGE(crypto::hash hash; cryptonote::block b; bool ret = cryptonote::parse_and_validate_block_from_blob(arg.b.block, b, &hash);, ret, context << "Received NOTIFY_NEW_FLUFFY_BLOCK " << hash << " (height " << arg.current_blockchain_height << ", " << arg.b.txs.size() << " txes)");
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
@@ -595,6 +609,9 @@ namespace cryptonote
       // moneromooo ... only because I <3 him. 
       std::vector<uint64_t> need_tx_indices;
       need_tx_indices.reserve(new_block.tx_hashes.size());
+
+      // txes the peer had to send us, other peers are likely to be missing them too
+      std::unordered_set<crypto::hash> received_txs;
         
       transaction tx;
       crypto::hash tx_hash;
@@ -680,6 +697,7 @@ namespace cryptonote
             // according to monero-moo so keep track of these separately ..
             //
           }
+          received_txs.insert(tx_hash);
         }
         else
         {
@@ -807,7 +825,11 @@ namespace cryptonote
           NOTIFY_NEW_BLOCK::request reg_arg = AUTO_VAL_INIT(reg_arg);
           reg_arg.current_blockchain_height = arg.current_blockchain_height;
           reg_arg.b = b;
-          relay_block(reg_arg, context);
+          std::vector<size_t> prefill_tx_indices;
+          for (size_t i = 0; i < new_block.tx_hashes.size(); ++i)
+            if (received_txs.count(new_block.tx_hashes[i]))
+              prefill_tx_indices.push_back(i);
+          relay_block(reg_arg, context, prefill_tx_indices);
         }
         else if( bvc.m_marked_as_orphaned )
         {
@@ -851,6 +873,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_request_fluffy_missing_tx(int command, NOTIFY_REQUEST_FLUFFY_MISSING_TX::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_request_fluffy_missing_tx");
     MLOG_P2P_MESSAGE("Received NOTIFY_REQUEST_FLUFFY_MISSING_TX (" << arg.missing_tx_indices.size() << " txes), block hash " << arg.block_hash);
     if (context.m_state == cryptonote_connection_context::state_before_handshake)
     {
@@ -949,6 +972,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_notify_get_txpool_complement(int command, NOTIFY_GET_TXPOOL_COMPLEMENT::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_notify_get_txpool_complement");
     MLOG_P2P_MESSAGE("Received NOTIFY_GET_TXPOOL_COMPLEMENT (" << arg.hashes.size() << " txes)");
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
@@ -979,6 +1003,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_notify_new_transactions");
     MLOG_P2P_MESSAGE("Received NOTIFY_NEW_TRANSACTIONS (" << arg.txs.size() << " txes)");
     std::unordered_set<blobdata> seen;
     for (const auto &blob: arg.txs)
@@ -1015,6 +1040,14 @@ namespace cryptonote
        sybil spy will be unable to link an IP to an i2p/tor connection). */
 
     const epee::net_utils::zone zone = context.m_remote_address.get_zone();
+
+    // the peer has these now, whether or not we accept them
+    std::vector<crypto::hash> blob_hashes;
+    blob_hashes.reserve(arg.txs.size());
+    for (const auto &blob: arg.txs)
+      blob_hashes.push_back(crypto::cn_fast_hash(blob.data(), blob.size()));
+    m_p2p->on_txs_received(zone, context.m_connection_id, std::move(blob_hashes));
+
     relay_method tx_relay = zone == epee::net_utils::zone::public_ ?
       relay_method::stem : relay_method::forward;
 
@@ -1075,6 +1108,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_request_get_objects");
     if (context.m_state == cryptonote_connection_context::state_before_handshake)
     {
       LOG_ERROR_CCONTEXT("Requested objects before handshake, dropping connection");
@@ -1127,6 +1161,7 @@ namespace cryptonote
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_response_get_objects(int command, NOTIFY_RESPONSE_GET_OBJECTS::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_response_get_objects");
     MLOG_P2P_MESSAGE("Received NOTIFY_RESPONSE_GET_OBJECTS (" << arg.blocks.size() << " blocks)");
     MLOG_PEER_STATE("received objects");
 
@@ -1906,6 +1941,7 @@ skip:
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_request_chain");
     MLOG_P2P_MESSAGE("Received NOTIFY_REQUEST_CHAIN (" << arg.block_ids.size() << " blocks");
     if (context.m_state == cryptonote_connection_context::state_before_handshake)
     {
@@ -1935,6 +1971,28 @@ skip:
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
+  size_t t_cryptonote_protocol_handler<t_core>::get_span_block_count(const cryptonote_connection_context& context) const
+  {
+    const size_t default_count = m_core.get_block_sync_size(m_core.get_current_blockchain_height());
+    if (m_core.is_block_sync_size_fixed())
+      return default_count;
+
+    // size spans by bytes rather than blocks, so that each takes about the same time
+    // to arrive from this peer whatever the block sizes in this part of the chain
+    float rate = m_block_queue.get_download_rate(context.m_connection_id);
+    if (rate <= 0.0f)
+      rate = context.m_current_speed_down; // spans from this peer already consumed
+    const float block_size = m_block_queue.get_average_block_size();
+    if (rate <= 0.0f || block_size <= 0.0f)
+      return default_count;
+    const size_t block_queue_size_threshold = m_block_download_max_size ? m_block_download_max_size : BLOCK_QUEUE_SIZE_THRESHOLD;
+    const float span_bytes = std::min(rate * SPAN_TARGET_DOWNLOAD_TIME, block_queue_size_threshold / (float)BLOCK_QUEUE_NSPANS_THRESHOLD);
+    const size_t count = std::max<size_t>(1, std::min<size_t>(span_bytes / block_size, CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT));
+    MDEBUG(context << " span size " << count << " blocks at " << rate / 1024 << " kB/s and " << block_size / 1024 << " kB/block");
+    return count;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::should_download_next_span(cryptonote_connection_context& context, bool standby)
   {
     std::vector<crypto::hash> hashes;
@@ -2268,7 +2326,7 @@ skip:
       NOTIFY_REQUEST_GET_OBJECTS::request req;
       bool is_next = false;
       size_t count = 0;
-      const size_t count_limit = m_core.get_block_sync_size(m_core.get_current_blockchain_height());
+      const size_t count_limit = get_span_block_count(context);
       std::pair<uint64_t, uint64_t> span = std::make_pair(0, 0);
       if (force_next_span)
       {
@@ -2597,6 +2655,7 @@ skip:
   template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, cryptonote_connection_context& context)
   {
+    TRACE_SPAN("levin_response_chain_entry");
     MLOG_P2P_MESSAGE("Received NOTIFY_RESPONSE_CHAIN_ENTRY: m_block_ids.size()=" << arg.m_block_ids.size()
       << ", m_start_height=" << arg.start_height << ", m_total_height=" << arg.total_height);
     MLOG_PEER_STATE("received chain");
@@ -2763,11 +2822,18 @@ skip:
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
-  bool t_cryptonote_protocol_handler<t_core>::relay_block(NOTIFY_NEW_BLOCK::request& arg, cryptonote_connection_context& exclude_context)
+  bool t_cryptonote_protocol_handler<t_core>::relay_block(NOTIFY_NEW_BLOCK::request& arg, cryptonote_connection_context& exclude_context, const std::vector<size_t>& prefill_tx_indices)
   {
     NOTIFY_NEW_FLUFFY_BLOCK::request fluffy_arg = AUTO_VAL_INIT(fluffy_arg);
     fluffy_arg.current_blockchain_height = arg.current_blockchain_height;    
     std::vector<tx_blob_entry> fluffy_txs;
+    // fluffy receivers add any txes sent along with the block before looking
+    // in their pool, so these save them a NOTIFY_REQUEST_FLUFFY_MISSING_TX round trip
+    for (const size_t idx: prefill_tx_indices)
+    {
+      if (idx < arg.b.txs.size())
+        fluffy_txs.push_back(arg.b.txs[idx]);
+    }
     fluffy_arg.b = arg.b;
     fluffy_arg.b.txs = fluffy_txs;
 
@@ -3008,6 +3074,7 @@ skip:
     }
 
     m_block_queue.flush_spans(context.m_connection_id, false);
+    m_block_queue.remove_stripe_peer(context.m_connection_id);
     MLOG_PEER_STATE("closed");
   }
 
@@ -28,6 +28,7 @@
 
 #include "levin_notify.h"
 
+#include <algorithm>
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/post.hpp>
 #include <boost/asio/steady_timer.hpp>
@@ -36,10 +37,12 @@
 #include <chrono>
 #include <deque>
 #include <stdexcept>
+#include <unordered_set>
 #include <utility>
 
 #include "byte_slice.h"
 #include "common/expect.h"
+#include "common/metrics.h"
 #include "common/varint.h"
 #include "cryptonote_config.h"
 #include "crypto/crypto.h"
@@ -87,6 +90,15 @@ namespace levin
     using fluff_duration = crypto::random_poisson_subseconds::result_type;
     constexpr const fluff_duration fluff_average_out{fluff_duration{fluff_average_in} / 2};
 
+    //! Max tx blob hashes remembered per connection as already known to the peer
+    constexpr const std::size_t max_known_txs = 2048;
+
+    /*! Stem txs to the same destination are held for a random [0, window]
+        delay and sent in one notification. The window is well below the
+        fluff and embargo timers, and the destination is still chosen per
+        source, so the stem routing is unchanged. */
+    constexpr const std::chrono::milliseconds stem_batch_window{CRYPTONOTE_DANDELIONPP_STEM_BATCH_WINDOW};
+
     /*! Select a randomized duration from 0 to `range`. The precision will be to
         the systems `steady_clock`. As an example, supplying 3 seconds to this
         function will select a duration from [0, 3] seconds, and the increments
@@ -100,6 +112,12 @@ namespace levin
       return std::chrono::steady_clock::duration{crypto::rand_range(rep(0), range.count())};
     }
 
+    tools::metrics::histogram& relay_delay(const char* relay)
+    {
+      return tools::metrics::get_histogram("dandelionpp_relay_delay_seconds",
+        "Time txs wait in the Dandelion++ stem batch or fluff queue before being sent", tools::metrics::label("relay", relay));
+    }
+
     uint64_t get_median_remote_height(connections& p2p)
     {
         std::vector<uint64_t> remote_heights;
@@ -271,11 +289,15 @@ namespace levin
           noise(std::move(noise_in)),
           next_epoch(io_service),
           flush_txs(io_service),
+          flush_stems(io_service),
           strand(io_service),
           map(),
           channels(),
           connection_count(0),
           flush_callbacks(0),
+          stem_callbacks(0),
+          stem_delays(),
+          fluff_delays(),
           nzone(zone),
           pad_txs(pad_txs),
           fluffing(false)
@@ -288,17 +310,48 @@ namespace levin
       const epee::byte_slice noise; //!< `!empty()` means zone is using noise channels
       boost::asio::steady_timer next_epoch;
       boost::asio::steady_timer flush_txs;
+      boost::asio::steady_timer flush_stems;
       boost::asio::io_context::strand strand;
       struct context_t {
         std::vector<cryptonote::blobdata> fluff_txs;
+        std::vector<crypto::hash> fluff_tx_hashes; //!< Blob hash of each of `fluff_txs`, in the same order
         std::chrono::steady_clock::time_point flush_time;
+        std::chrono::steady_clock::time_point fluff_queued; //!< When `fluff_txs` became non-empty
         bool m_is_income;
+        std::unordered_set<crypto::hash> known_txs; //!< Blob hashes of txs the peer sent us
+        std::deque<crypto::hash> known_txs_order;   //!< Insertion order of `known_txs`, for eviction
       };
       boost::unordered_map<boost::uuids::uuid, context_t> contexts;
+      struct stem_tx {
+        cryptonote::blobdata blob;
+        boost::uuids::uuid source; //!< Kept to pick a new stem if `destination` is gone at flush
+      };
+      struct stem_batch {
+        std::vector<stem_tx> txs;
+        std::chrono::steady_clock::time_point queued; //!< When the oldest tx in `txs` was queued
+      };
+      boost::unordered_map<boost::uuids::uuid, stem_batch> stem_batches; //!< Keyed by stem destination
+      //! Queue delays observed in the current epoch, logged and reset when it ends
+      struct delay_stats {
+        std::uint64_t count;
+        std::chrono::microseconds total;
+        std::chrono::microseconds max;
+
+        void add(const std::chrono::steady_clock::duration delay)
+        {
+          const auto us = std::chrono::duration_cast<std::chrono::microseconds>(delay);
+          ++count;
+          total += us;
+          max = std::max(max, us);
+        }
+      };
       net::dandelionpp::connection_map map;//!< Tracks outgoing uuid's for noise channels or Dandelion++ stems
       std::deque<noise_channel> channels;  //!< Never touch after init; only update elements on `noise_channel.strand`
       std::atomic<std::size_t> connection_count; //!< Only update in strand, can be read at any time
       std::uint32_t flush_callbacks;             //!< Number of active fluff flush callbacks queued
+      std::uint32_t stem_callbacks;              //!< Number of active stem flush callbacks queued
+      delay_stats stem_delays;
+      delay_stats fluff_delays;
       const epee::net_utils::zone nzone;         //!< Zone is public ipv4/ipv6 connections, or i2p or tor
       const bool pad_txs;                        //!< Pad txs to the next boundary for privacy
       bool fluffing;                             //!< Zone is in Dandelion++ fluff epoch
@@ -307,6 +360,26 @@ namespace levin
 
   namespace
   {
+    crypto::hash get_blob_hash(const blobdata& blob)
+    {
+      return crypto::cn_fast_hash(blob.data(), blob.size());
+    }
+
+    void add_known_txs(detail::zone::context_t& context, const std::vector<crypto::hash>& tx_hashes)
+    {
+      for (const crypto::hash& tx_hash : tx_hashes)
+      {
+        if (!context.known_txs.insert(tx_hash).second)
+          continue;
+        context.known_txs_order.push_back(tx_hash);
+        if (max_known_txs < context.known_txs_order.size())
+        {
+          context.known_txs.erase(context.known_txs_order.front());
+          context.known_txs_order.pop_front();
+        }
+      }
+    }
+
     //! Adds a message to the sending queue of the channel.
     class queue_covert_notify
     {
@@ -379,9 +452,13 @@ namespace levin
           {
             if (context.flush_time <= now || timer_error) // flush on canceled timer
             {
+              static tools::metrics::histogram& fluff_delay = relay_delay("fluff");
+              fluff_delay.observe(std::chrono::duration_cast<std::chrono::microseconds>(now - context.fluff_queued));
+              zone_->fluff_delays.add(now - context.fluff_queued);
               context.flush_time = std::chrono::steady_clock::time_point::max();
               connections.emplace_back(std::move(context.fluff_txs), id);
               context.fluff_txs.clear();
+              context.fluff_tx_hashes.clear();
             }
             else // not flushing yet
               next_flush = std::min(next_flush, context.flush_time);
@@ -437,6 +514,11 @@ namespace levin
         crypto::random_poisson_subseconds out_duration(fluff_average_out);
 
 
+        std::vector<crypto::hash> tx_hashes;
+        tx_hashes.reserve(txs.size());
+        for (const blobdata& tx : txs)
+          tx_hashes.push_back(get_blob_hash(tx));
+
         MDEBUG("Queueing " << txs.size() << " transaction(s) for Dandelion++ fluffing");
         for (auto &e: zone->contexts)
         {
@@ -445,12 +527,28 @@ namespace levin
           // When i2p/tor, only fluff to outbound connections
           if (source != id && (zone->nzone == epee::net_utils::zone::public_ || !context.m_is_income))
           {
-            if (context.fluff_txs.empty())
+            const std::size_t queued = context.fluff_txs.size();
+            context.fluff_txs.reserve(queued + txs.size());
+            context.fluff_tx_hashes.reserve(queued + txs.size());
+            for (std::size_t i = 0; i < txs.size(); ++i)
+            {
+              // no point sending a peer what it sent us
+              if (!context.known_txs.count(tx_hashes[i]))
+              {
+                context.fluff_txs.push_back(txs[i]);
+                context.fluff_tx_hashes.push_back(tx_hashes[i]);
+              }
+            }
+            if (context.fluff_txs.size() == queued)
+              continue;
+
+            if (queued == 0)
+            {
               context.flush_time = now + (context.m_is_income ? in_duration() : out_duration());
+              context.fluff_queued = now;
+            }
 
             next_flush = std::min(next_flush, context.flush_time);
-            context.fluff_txs.reserve(context.fluff_txs.size() + txs.size());
-            context.fluff_txs.insert(context.fluff_txs.end(), txs.begin(), txs.end());
           }
         }
 
@@ -539,6 +637,115 @@ namespace levin
       }
     };
 
+    /*! Sends the stem txs queued per destination, and falls back to a new
+        stem (or fluff) for destinations that are no longer reachable. Like
+        `fluff_flush`, there is one system timer per-zone; it is started when
+        the first tx is queued and covers every destination. */
+    struct stem_flush
+    {
+      std::shared_ptr<detail::zone> zone_;
+      i_core_events* core_;
+
+      //! \pre Called within `zone->strand`.
+      static void add(std::shared_ptr<detail::zone> zone, i_core_events* core, const boost::uuids::uuid& destination, std::vector<blobdata> txs, const boost::uuids::uuid& source)
+      {
+        assert(zone != nullptr);
+        assert(zone->strand.running_in_this_thread());
+
+        detail::zone::stem_batch& batch = zone->stem_batches[destination];
+        if (batch.txs.empty())
+          batch.queued = std::chrono::steady_clock::now();
+        batch.txs.reserve(batch.txs.size() + txs.size());
+        for (blobdata& tx : txs)
+          batch.txs.push_back({std::move(tx), source});
+
+        if (!zone->stem_callbacks)
+        {
+          detail::zone& this_zone = *zone;
+          ++this_zone.stem_callbacks;
+          this_zone.flush_stems.expires_after(random_duration(stem_batch_window));
+          this_zone.flush_stems.async_wait(this_zone.strand.wrap(stem_flush{std::move(zone), core}));
+        }
+      }
+
+      static bool send(detail::zone& zone, const boost::uuids::uuid& destination, const detail::zone::stem_batch& batch)
+      {
+        std::vector<blobdata> txs;
+        txs.reserve(batch.txs.size());
+        for (const detail::zone::stem_tx& tx : batch.txs)
+          txs.push_back(tx.blob);
+
+        if (destination.is_nil() || !make_payload_send_txs(*zone.p2p, std::move(txs), destination, zone.pad_txs, false))
+          return false;
+
+        /* Source is intentionally omitted in debug log for privacy - a nil
+           uuid indicates source is that node. */
+        MDEBUG("Sent " << batch.txs.size() << " transaction(s) to " << destination << " using Dandelion++ stem");
+
+        static tools::metrics::histogram& stem_delay = relay_delay("stem");
+        const auto delay = std::chrono::steady_clock::now() - batch.queued;
+        stem_delay.observe(std::chrono::duration_cast<std::chrono::microseconds>(delay));
+        zone.stem_delays.add(delay);
+        return true;
+      }
+
+      void operator()(const boost::system::error_code error)
+      {
+        if (!zone_ || !core_ || !zone_->stem_callbacks || --zone_->stem_callbacks || !zone_->p2p)
+          return;
+
+        assert(zone_->strand.running_in_this_thread());
+
+        if (error && error != boost::system::errc::operation_canceled)
+          throw boost::system::system_error{error, "stem_flush timer failed"};
+
+        // canceled timer flushes everything now, same as an expired one
+        auto batches = std::move(zone_->stem_batches);
+        zone_->stem_batches.clear();
+
+        std::vector<detail::zone::stem_batch> failed;
+        for (auto& batch : batches)
+        {
+          if (!send(*zone_, batch.first, batch.second))
+            failed.push_back(std::move(batch.second));
+        }
+        if (failed.empty())
+          return;
+
+        // connection list may be outdated, try again with new stems
+        update_channels::run(zone_, get_out_connections(*zone_->p2p, core_));
+
+        boost::unordered_map<boost::uuids::uuid, detail::zone::stem_batch> retry;
+        for (detail::zone::stem_batch& batch : failed)
+        {
+          for (detail::zone::stem_tx& tx : batch.txs)
+          {
+            detail::zone::stem_batch& next = retry[zone_->map.get_stem(tx.source)];
+            next.queued = batch.queued;
+            next.txs.push_back(std::move(tx));
+          }
+        }
+
+        boost::unordered_map<boost::uuids::uuid, std::vector<blobdata>> fluff;
+        for (auto& batch : retry)
+        {
+          if (send(*zone_, batch.first, batch.second))
+            continue;
+          for (detail::zone::stem_tx& tx : batch.second.txs)
+            fluff[tx.source].push_back(std::move(tx.blob));
+        }
+        if (fluff.empty())
+          return;
+
+        MERROR("Unable to send transaction(s) via Dandelion++ stem");
+        for (auto& txs : fluff)
+        {
+          core_->on_transactions_relayed(epee::to_span(txs.second), relay_method::fluff);
+          fluff_notify::run(zone_, epee::to_span(txs.second), txs.first);
+        }
+      }
+    };
+
     //! Checks fluff status for this node, and then does stem or fluff for txes
     struct dandelionpp_notify
     {
@@ -560,11 +767,9 @@ namespace levin
           for (int tries = 2; 0 < tries; tries--)
           {
             const boost::uuids::uuid destination = zone_->map.get_stem(source_);
-            if (!destination.is_nil() && make_payload_send_txs(*zone_->p2p, std::vector<blobdata>{txs_}, destination, zone_->pad_txs, false))
+            if (!destination.is_nil())
             {
-              /* Source is intentionally omitted in debug log for privacy - a
-                 nil uuid indicates source is that node. */
-              MDEBUG("Sent " << txs_.size() << " transaction(s) to " << destination << " using Dandelion++ stem");
+              stem_flush::add(std::move(zone_), core_, destination, std::move(txs_), source_);
               return;
             }
 
@@ -606,7 +811,18 @@ namespace levin
         assert(zone_->strand.running_in_this_thread());
 
         if (zone_->nzone == epee::net_utils::zone::public_)
+        {
+          const auto log_delays = [] (const char* relay, detail::zone::delay_stats& stats)
+          {
+            if (stats.count)
+              MDEBUG("Dandelion++ " << relay << " delay last epoch: " << stats.count << " send(s), average " <<
+                (stats.total / stats.count).count() << "us, max " << stats.max.count() << "us");
+            stats = {};
+          };
+          log_delays("stem", zone_->stem_delays);
+          log_delays("fluff", zone_->fluff_delays);
           MDEBUG("Starting new Dandelion++ epoch: " << (fluffing_ ? "fluff" : "stem"));
+        }
 
         zone_->map = std::move(map_);
         zone_->fluffing = fluffing_;
@@ -776,12 +992,49 @@ namespace levin
     boost::asio::dispatch(zone_->strand, [zone, id, is_income] {
       zone->contexts[id] = {
         .fluff_txs = {},
+        .fluff_tx_hashes = {},
         .flush_time = std::chrono::steady_clock::time_point::max(),
+        .fluff_queued = {},
         .m_is_income = is_income,
+        .known_txs = {},
+        .known_txs_order = {},
       };
     });
   }
 
+  void notify::on_txs_received(const boost::uuids::uuid &id, std::vector<crypto::hash> tx_hashes)
+  {
+    if (!zone_ || tx_hashes.empty())
+      return;
+
+    auto& zone = zone_;
+    boost::asio::dispatch(zone_->strand, [zone, id, tx_hashes = std::move(tx_hashes)] {
+      const auto context = zone->contexts.find(id);
+      if (context == zone->contexts.end())
+        return;
+
+      add_known_txs(context->second, tx_hashes);
+
+      // the peer may have got these elsewhere while they waited for the fluff timer
+      auto& fluff_txs = context->second.fluff_txs;
+      auto& fluff_tx_hashes = context->second.fluff_tx_hashes;
+      std::size_t kept = 0;
+      for (std::size_t i = 0; i < fluff_txs.size(); ++i)
+      {
+        if (context->second.known_txs.count(fluff_tx_hashes[i]))
+          continue;
+        if (kept != i)
+        {
+          fluff_txs[kept] = std::move(fluff_txs[i]);
+          fluff_tx_hashes[kept] = fluff_tx_hashes[i];
+        }
+        ++kept;
+      }
+      fluff_txs.resize(kept);
+      fluff_tx_hashes.resize(kept);
+    });
+  }
+
   void notify::on_connection_close(const boost::uuids::uuid &id)
   {
     if (!zone_)
@@ -805,6 +1058,7 @@ namespace levin
     if (!zone_)
       return;
 
+    zone_->flush_stems.cancel();
     for (noise_channel& channel : zone_->channels)
       channel.next_noise.cancel();
   }
@@ -35,6 +35,7 @@
 
 #include "byte_slice.h"
 #include "cryptonote_basic/blobdatatype.h"
+#include "crypto/hash.h"
 #include "cryptonote_protocol/enums.h"
 #include "cryptonote_protocol/fwd.h"
 #include "net/enums.h"
@@ -105,10 +106,14 @@ namespace levin
     void on_handshake_complete(const boost::uuids::uuid &id, bool is_income);
     void on_connection_close(const boost::uuids::uuid &id);
 
+    /*! Records that the peer `id` sent us txs with the given blob hashes, so
+        they are not fluffed back to it (including ones already queued). */
+    void on_txs_received(const boost::uuids::uuid &id, std::vector<crypto::hash> tx_hashes);
+
     //! Run the logic for the next epoch immediately. Only use in testing.
     void run_epoch();
 
-    //! Run the logic for the next stem timeout imemdiately. Only use in  testing.
+    //! Run the logic for the next stem timeout and flush batched Dandelion++ stem txs immediately. Only use in testing.
     void run_stems();
 
     //! Run the logic for flushing all Dandelion++ fluff queued txs. Only use in testing.
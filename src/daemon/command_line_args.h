@@ -96,6 +96,25 @@ namespace daemon_args
   , 0
   };
 
+  const command_line::arg_descriptor<std::vector<std::string>> arg_thread_group_cpus = {
+    "thread-group-cpus"
+  , "Pin a thread group to CPUs, as <group>:<cpus>, eg. compute:0-3,8. Groups are compute (verification), p2p, rpc and io"
+  };
+  const command_line::arg_descriptor<std::vector<std::string>> arg_thread_group_nice = {
+    "thread-group-nice"
+  , "Set the nice level of a thread group, as <group>:<level>, eg. rpc:10"
+  };
+  const command_line::arg_descriptor<std::vector<std::string>> arg_thread_group_batch = {
+    "thread-group-batch"
+  , "Schedule a thread group as SCHED_BATCH (Linux), eg. rpc"
+  };
+
+  const command_line::arg_descriptor<bool> arg_trace_spans = {
+    "trace-spans"
+  , "Record trace spans from startup, the RPC /trace endpoint exports them and turns recording on and off"
+  , false
+  };
+
   const command_line::arg_descriptor<std::string> arg_proxy = {
     "proxy",
     "Network communication through proxy: <socks-ip:port> i.e. \"127.0.0.1:9050\"",
@@ -131,6 +150,11 @@ namespace daemon_args
       return val;
     }
   };
+  const command_line::arg_descriptor<uint32_t> arg_zmq_rpc_threads = {
+    "zmq-rpc-threads"
+  , "Number of threads handling ZMQ RPC requests"
+  , 1
+  };
   const command_line::arg_descriptor<std::vector<std::string>> arg_zmq_pub = {
     "zmq-pub"
   , "Address for ZMQ pub - tcp://ip:port or ipc://path"
@@ -986,14 +986,20 @@ bool t_command_parser_executor::prune_blockchain(const std::vector<std::string>&
     return true;
   }
 
+  if (!args.empty() && args[0] == "background")
+    return m_executor.prune_blockchain(true, false);
+  if (!args.empty() && args[0] == "compact")
+    return m_executor.prune_blockchain(false, true);
+
   if (args.empty() || args[0] != "confirm")
   {
     std::cout << "Warning: pruning from within salviumd will not shrink the database file size." << std::endl;
     std::cout << "Instead, parts of the file will be marked as free, so the file will not grow" << std::endl;
     std::cout << "until that newly free space is used up. If you want a smaller file size now," << std::endl;
-    std::cout << "exit salviumd and run salvium-blockchain-prune (you will temporarily need more" << std::endl;
-    std::cout << "disk space for the database conversion though). If you are OK with the database" << std::endl;
-    std::cout << "file keeping the same size, re-run this command with the \"confirm\" parameter." << std::endl;
+    std::cout << "run this command with the \"compact\" parameter afterwards, and swap in the" << std::endl;
+    std::cout << "compacted copy while salviumd is stopped. If you are OK with the database" << std::endl;
+    std::cout << "file keeping the same size, re-run this command with the \"confirm\" parameter," << std::endl;
+    std::cout << "or with \"background\" to prune a little at a time while salviumd keeps running." << std::endl;
     return true;
   }
 
@@ -315,8 +315,8 @@ t_command_server::t_command_server(
     m_command_lookup.set_handler(
       "prune_blockchain"
     , std::bind(&t_command_parser_executor::prune_blockchain, &m_parser, p::_1)
-    , "prune_blockchain [confirm]"
-    , "Prune the blockchain."
+    , "prune_blockchain [confirm|background|compact]"
+    , "Prune the blockchain. \"background\" prunes a little at a time while the daemon keeps running, \"compact\" writes a copy of the database without the freed space."
     );
     m_command_lookup.set_handler(
       "check_blockchain_pruning"
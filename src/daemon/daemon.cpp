@@ -82,7 +82,7 @@ public:
       boost::program_options::variables_map const & vm
     )
     : core{vm}
-    , protocol{vm, core, command_line::get_arg(vm, cryptonote::arg_offline)}
+    , protocol{vm, core, command_line::get_arg(vm, cryptonote::arg_offline) || command_line::get_arg(vm, cryptonote::arg_read_replica)}
     , p2p{vm, protocol}
     , zmq{nullptr}
   {
@@ -90,7 +90,9 @@ public:
     protocol.set_p2p_endpoint(p2p.get());
     core.set_protocol(protocol.get());
 
-    const auto restricted = command_line::get_arg(vm, cryptonote::core_rpc_server::arg_restricted_rpc);
+    // a read replica can't change anything, so it only serves the restricted surface
+    const auto restricted = command_line::get_arg(vm, cryptonote::core_rpc_server::arg_restricted_rpc)
+      || command_line::get_arg(vm, cryptonote::arg_read_replica);
     const auto main_rpc_port = command_line::get_arg(vm, cryptonote::core_rpc_server::arg_rpc_bind_port);
     const auto restricted_rpc_port_arg = cryptonote::core_rpc_server::arg_rpc_restricted_bind_port;
     const bool has_restricted_rpc_port_arg = !command_line::is_arg_defaulted(vm, restricted_rpc_port_arg);
@@ -108,8 +110,9 @@ public:
 
       const std::string zmq_port = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_bind_port);
       const std::string zmq_address = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_bind_ip);
+      const uint32_t zmq_threads = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_threads);
 
-      if (!zmq->server.init_rpc(zmq_address, zmq_port))
+      if (!zmq->server.init_rpc(zmq_address, zmq_port, zmq_threads))
         throw std::runtime_error{"Failed to add TCP socket(" + zmq_address + ":" + zmq_port + ") to ZMQ RPC Server"};
 
       std::shared_ptr<cryptonote::listener::zmq_pub> shared;
@@ -121,6 +124,7 @@ public:
       {
         core.get().get_blockchain_storage().add_block_notify(cryptonote::listener::zmq_pub::chain_main{shared});
         core.get().get_blockchain_storage().add_miner_notify(cryptonote::listener::zmq_pub::miner_data{shared});
+        core.get().get_blockchain_storage().add_block_stats_notify(cryptonote::listener::zmq_pub::block_stats{shared});
         core.get().set_txpool_listener(cryptonote::listener::zmq_pub::txpool_add{shared});
       }
     }
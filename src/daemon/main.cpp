@@ -32,6 +32,7 @@
 #include "common/scoped_message_writer.h"
 #include "common/password.h"
 #include "common/util.h"
+#include "common/trace.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_basic/miner.h"
 #include "daemon/command_server.h"
@@ -39,6 +40,7 @@
 #include "daemon/executor.h"
 #include "daemonizer/daemonizer.h"
 #include "misc_log_ex.h"
+#include "thread_placement.h"
 #include "net/parse.h"
 #include "p2p/net_node.h"
 #include "rpc/core_rpc_server.h"
@@ -108,6 +110,37 @@ uint16_t parse_public_rpc_port(const po::variables_map &vm)
   return rpc_port;
 }
 
+bool set_thread_group_policies(const po::variables_map &vm)
+{
+  std::map<std::string, epee::thread_placement::policy> policies;
+  for (const std::string &spec: command_line::get_arg(vm, daemon_args::arg_thread_group_cpus))
+  {
+    const size_t colon = spec.find(':');
+    if (colon == std::string::npos || colon == 0 || !epee::thread_placement::parse_cpu_list(spec.substr(colon + 1), policies[spec.substr(0, colon)].cpus))
+    {
+      MERROR("Invalid --" << daemon_args::arg_thread_group_cpus.name << " value: " << spec);
+      return false;
+    }
+  }
+  for (const std::string &spec: command_line::get_arg(vm, daemon_args::arg_thread_group_nice))
+  {
+    const size_t colon = spec.find(':');
+    int nice;
+    if (colon == std::string::npos || colon == 0 || !epee::string_tools::get_xtype_from_string(nice, spec.substr(colon + 1)) || nice < -20 || nice > 19)
+    {
+      MERROR("Invalid --" << daemon_args::arg_thread_group_nice.name << " value: " << spec);
+      return false;
+    }
+    policies[spec.substr(0, colon)].nice = nice;
+  }
+  for (const std::string &group: command_line::get_arg(vm, daemon_args::arg_thread_group_batch))
+    policies[group].batch = true;
+
+  for (const auto &p: policies)
+    epee::thread_placement::set_policy(p.first, p.second);
+  return true;
+}
+
 #ifdef WIN32
 bool isFat32(const wchar_t* root_path)
 {
@@ -201,11 +234,16 @@ int main(int argc, char const * argv[])
       command_line::add_arg(core_settings, daemon_args::arg_max_log_file_size);
       command_line::add_arg(core_settings, daemon_args::arg_max_log_files);
       command_line::add_arg(core_settings, daemon_args::arg_max_concurrency);
+      command_line::add_arg(core_settings, daemon_args::arg_thread_group_cpus);
+      command_line::add_arg(core_settings, daemon_args::arg_thread_group_nice);
+      command_line::add_arg(core_settings, daemon_args::arg_thread_group_batch);
+      command_line::add_arg(core_settings, daemon_args::arg_trace_spans);
       command_line::add_arg(core_settings, daemon_args::arg_proxy);
       command_line::add_arg(core_settings, daemon_args::arg_proxy_allow_dns_leaks);
       command_line::add_arg(core_settings, daemon_args::arg_public_node);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_bind_ip);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_bind_port);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_threads);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_pub);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_disabled);
       command_line::add_arg(core_settings, daemon_args::arg_print_genesis_tx);
@@ -357,6 +395,13 @@ int main(int argc, char const * argv[])
     if (!command_line::is_arg_defaulted(vm, daemon_args::arg_max_concurrency))
       tools::set_max_concurrency(command_line::get_arg(vm, daemon_args::arg_max_concurrency));
 
+    // before any of the groups' threads are started
+    if (!set_thread_group_policies(vm))
+      return 1;
+
+    if (command_line::get_arg(vm, daemon_args::arg_trace_spans))
+      tools::trace::enable(true);
+
     // logging is now set up
     MGINFO("Salvium '" << MONERO_RELEASE_NAME << "' (v" << MONERO_VERSION_FULL << ")");
 
@@ -143,6 +143,22 @@ namespace {
     return std::string(buffer);
   }
 
+  const char *get_tx_type_name(uint8_t tx_type)
+  {
+    switch (tx_type)
+    {
+      case cryptonote::transaction_type::MINER: return "miner";
+      case cryptonote::transaction_type::PROTOCOL: return "protocol";
+      case cryptonote::transaction_type::TRANSFER: return "transfer";
+      case cryptonote::transaction_type::CONVERT: return "convert";
+      case cryptonote::transaction_type::BURN: return "burn";
+      case cryptonote::transaction_type::STAKE: return "stake";
+      case cryptonote::transaction_type::RETURN: return "return";
+      case cryptonote::transaction_type::AUDIT: return "audit";
+      default: return "unknown";
+    }
+  }
+
   std::string make_error(const std::string &base, const std::string &status)
   {
     if (status == CORE_RPC_STATUS_OK)
@@ -541,6 +557,13 @@ bool t_rpc_command_executor::show_status() {
     ;
   }
 
+  if (!ires.txpool_validated)
+    str << ", txpool validating";
+  if (ires.history_verification_failed)
+    str << ", history verification FAILED at " << ires.history_verified_height;
+  else if (ires.history_verification)
+    str << ", history verified to " << ires.history_verified_height;
+
   tools::success_msg_writer() << str.str();
 
   return true;
@@ -592,6 +615,9 @@ bool t_rpc_command_executor::mining_status() {
   else
   {
     tools::msg_writer() << "Mining at " << get_mining_speed(mres.speed) << " with " << mres.threads_count << " threads";
+    if (mres.speed_p50 > 0)
+      tools::msg_writer() << "  Recent hashrate: p10 " << get_mining_speed(mres.speed_p10) << ", median " << get_mining_speed(mres.speed_p50)
+          << ", p90 " << get_mining_speed(mres.speed_p90);
   }
 
   tools::msg_writer() << "PoW algorithm: " << mres.pow_algorithm;
@@ -1321,6 +1347,16 @@ bool t_rpc_command_executor::print_transaction_pool_stats() {
       << "fees " << cryptonote::print_money(res.pool_stats.fee_total) << " (avg " << cryptonote::print_money(n_transactions ? res.pool_stats.fee_total / n_transactions : 0) << " per tx" << ", " << cryptonote::print_money(res.pool_stats.bytes_total ? res.pool_stats.fee_total / res.pool_stats.bytes_total : 0) << " per byte)" << std::endl
       << res.pool_stats.num_double_spends << " double spends, " << res.pool_stats.num_not_relayed << " not relayed, " << res.pool_stats.num_failing << " failing, " << res.pool_stats.num_10m << " older than 10 minutes (oldest " << (res.pool_stats.oldest == 0 ? "-" : get_human_time_ago(res.pool_stats.oldest, now)) << "), " << backlog_message;
 
+  if (!res.pool_stats.types.empty())
+  {
+    tools::msg_writer() << "   Type      Asset     Txes       Bytes            Fees";
+    for (const auto &t: res.pool_stats.types)
+    {
+      tools::msg_writer() << "   " << std::left << std::setw(10) << get_tx_type_name(t.tx_type) << std::setw(6) << (t.asset_type.empty() ? "-" : t.asset_type)
+          << std::right << std::setw(8) << t.txs << std::setw(12) << t.bytes << std::setw(16) << cryptonote::print_money(t.fee_total);
+    }
+  }
+
   if (n_transactions > 1 && res.pool_stats.histo.size())
   {
     std::vector<uint64_t> times;
@@ -2301,6 +2337,10 @@ bool t_rpc_command_executor::sync_info()
     tools::success_msg_writer() << "Downloading at " << current_download << " kB/s";
     if (res.next_needed_pruning_seed)
       tools::success_msg_writer() << "Next needed pruning seed: " << res.next_needed_pruning_seed;
+    if (res.history_verification_failed)
+      tools::fail_msg_writer() << "History verification failed at height " << res.history_verified_height;
+    else if (res.history_verification)
+      tools::success_msg_writer() << "History verified to height " << res.history_verified_height << " (" << (100.0 * res.history_verified_height / res.height) << "%)";
 
     tools::success_msg_writer() << std::to_string(res.peers.size()) << " peers";
     tools::success_msg_writer() << "Remote Host                        Peer_ID   State   Prune_Seed          Height  DL kB/s, Queued Blocks / MB";
@@ -2366,7 +2406,7 @@ bool t_rpc_command_executor::pop_blocks(uint64_t num_blocks)
   return true;
 }
 
-bool t_rpc_command_executor::prune_blockchain()
+bool t_rpc_command_executor::prune_blockchain(bool background, bool compact)
 {
     cryptonote::COMMAND_RPC_PRUNE_BLOCKCHAIN::request req;
     cryptonote::COMMAND_RPC_PRUNE_BLOCKCHAIN::response res;
@@ -2374,6 +2414,8 @@ bool t_rpc_command_executor::prune_blockchain()
     epee::json_rpc::error error_resp;
 
     req.check = false;
+    req.background = background;
+    req.compact = compact;
 
     if (m_is_rpc)
     {
@@ -2391,7 +2433,12 @@ bool t_rpc_command_executor::prune_blockchain()
         }
     }
 
-    tools::success_msg_writer() << "Blockchain pruned";
+    if (compact)
+      tools::success_msg_writer() << "Compacted blockchain written to " << res.compacted_path << ", swap it in while salviumd is stopped";
+    else if (background)
+      tools::success_msg_writer() << "Blockchain pruning started in the background";
+    else
+      tools::success_msg_writer() << "Blockchain pruned";
     return true;
 }
 
@@ -33,6 +33,7 @@
 #include "crypto/chacha.h"
 #include "ringct/rctTypes.h"
 #include "cryptonote_config.h"
+#include "span.h"
 
 
 #ifndef USE_DEVICE_LEDGER
@@ -179,6 +180,25 @@ namespace hw {
         virtual bool  generate_key_image(const crypto::public_key &pub, const crypto::secret_key &sec, crypto::key_image &image) = 0;
         virtual bool  derive_view_tag(const crypto::key_derivation &derivation, const std::size_t output_index, crypto::view_tag &view_tag) = 0;
 
+        // batched variants, so a device paying per call can keep itself locked for a whole tx. The defaults
+        // loop over the single element calls
+        virtual bool  generate_key_derivations(const epee::span<const crypto::public_key> pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations)
+        {
+            derivations.resize(pubs.size());
+            for (size_t i = 0; i < pubs.size(); ++i)
+                if (!generate_key_derivation(pubs[i], sec, derivations[i]))
+                    return false;
+            return true;
+        }
+        virtual bool  derive_view_tags(const crypto::key_derivation &derivation, const epee::span<const std::size_t> output_indices, std::vector<crypto::view_tag> &view_tags)
+        {
+            view_tags.resize(output_indices.size());
+            for (size_t i = 0; i < output_indices.size(); ++i)
+                if (!derive_view_tag(derivation, output_indices[i], view_tags[i]))
+                    return false;
+            return true;
+        }
+
         // alternative prototypes available in libringct
         rct::key scalarmultKey(const rct::key &P, const rct::key &a)
         {
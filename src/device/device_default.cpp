@@ -144,22 +144,24 @@ namespace hw {
         std::vector<crypto::public_key>  device_default::get_subaddress_spend_public_keys(const cryptonote::account_keys &keys, uint32_t account, uint32_t begin, uint32_t end) {
             CHECK_AND_ASSERT_THROW_MES(begin <= end, "begin > end");
 
-            std::vector<crypto::public_key> pkeys;
-            pkeys.reserve(end - begin);
+            std::vector<crypto::public_key> pkeys(end - begin);
             cryptonote::subaddress_index index = {account, begin};
 
-            ge_p3 p3;
+            ge_p3 spend_p3;
             ge_cached cached;
-            CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&p3, (const unsigned char*)keys.m_account_address.m_spend_public_key.data) == 0,
+            CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&spend_p3, (const unsigned char*)keys.m_account_address.m_spend_public_key.data) == 0,
                 "ge_frombytes_vartime failed to convert spend public key");
-            ge_p3_to_cached(&cached, &p3);
+            ge_p3_to_cached(&cached, &spend_p3);
 
+            // the points stay projective until the end, so the whole range shares one field inversion
+            std::vector<ge_p3> points(end - begin);
             for (uint32_t idx = begin; idx < end; ++idx)
             {
                 index.minor = idx;
+                ge_p3 &p3 = points[idx - begin];
                 if (index.is_zero())
                 {
-                    pkeys.push_back(keys.m_account_address.m_spend_public_key);
+                    p3 = spend_p3;
                     continue;
                 }
                 crypto::secret_key m = get_subaddress_secret_key(keys.m_view_secret_key, index);
@@ -168,14 +170,12 @@ namespace hw {
                 ge_scalarmult_base(&p3, (const unsigned char*)m.data);
 
                 // D = B + M
-                crypto::public_key D;
                 ge_p1p1 p1p1;
                 ge_add(&p1p1, &p3, &cached);
                 ge_p1p1_to_p3(&p3, &p1p1);
-                ge_p3_tobytes((unsigned char*)D.data, &p3);
-
-                pkeys.push_back(D);
             }
+            CHECK_AND_ASSERT_THROW_MES(ge_p3_tobytes_batch((unsigned char*)pkeys.data(), points.data(), points.size()) == 0,
+                "ge_p3_tobytes_batch failed to encode subaddress spend public keys");
             return pkeys;
         }
 
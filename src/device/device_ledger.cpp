@@ -1360,6 +1360,38 @@ namespace hw {
       return true;
     }
 
+    bool device_ledger::generate_key_derivations(const epee::span<const crypto::public_key> pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations) {
+      derivations.resize(pubs.size());
+      if ((this->mode == TRANSACTION_PARSE) && has_view_key) {
+        //No exchange at all in PARSE mode with the view key, see generate_key_derivation
+        assert(is_fake_view_key(sec));
+        for (size_t i = 0; i < pubs.size(); ++i)
+          if (!crypto::generate_key_derivation(pubs[i], this->viewkey, derivations[i]))
+            return false;
+        return true;
+      }
+      //Keep the device for the whole batch so the exchanges of one tx are not interleaved with other callers
+      std::lock_guard<std::recursive_mutex> lock(device_locker);
+      for (size_t i = 0; i < pubs.size(); ++i)
+        if (!this->generate_key_derivation(pubs[i], sec, derivations[i]))
+          return false;
+      return true;
+    }
+
+    bool device_ledger::derive_view_tags(const crypto::key_derivation &derivation, const epee::span<const std::size_t> output_indices, std::vector<crypto::view_tag> &view_tags) {
+      view_tags.resize(output_indices.size());
+      if ((this->mode == TRANSACTION_PARSE) && has_view_key) {
+        for (size_t i = 0; i < output_indices.size(); ++i)
+          crypto::derive_view_tag(derivation, output_indices[i], view_tags[i]);
+        return true;
+      }
+      std::lock_guard<std::recursive_mutex> lock(device_locker);
+      for (size_t i = 0; i < output_indices.size(); ++i)
+        if (!this->derive_view_tag(derivation, output_indices[i], view_tags[i]))
+          return false;
+      return true;
+    }
+
     /* ======================================================================= */
     /*                               TRANSACTION                               */
     /* ======================================================================= */
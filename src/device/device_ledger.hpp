@@ -245,6 +245,8 @@ namespace hw {
         bool  secret_key_to_public_key(const crypto::secret_key &sec, crypto::public_key &pub) override;
         bool  generate_key_image(const crypto::public_key &pub, const crypto::secret_key &sec, crypto::key_image &image) override;
         bool  derive_view_tag(const crypto::key_derivation &derivation, const size_t output_index, crypto::view_tag &view_tag) override;
+        bool  generate_key_derivations(const epee::span<const crypto::public_key> pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations) override;
+        bool  derive_view_tags(const crypto::key_derivation &derivation, const epee::span<const std::size_t> output_indices, std::vector<crypto::view_tag> &view_tags) override;
 
         /* ======================================================================= */
         /*                               TRANSACTION                               */
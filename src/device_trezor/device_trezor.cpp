@@ -58,6 +58,49 @@ namespace trezor {
       hw::register_device(HW_TREZOR_NAME, ensure_trezor_device());
     }
 
+    // Time spent waiting on the device for each tx signing step, to tell the
+    // per-message round trips apart from the host side work in between
+    class tx_sign_timings {
+    public:
+      enum step { INIT, SET_INPUT, INPUT_VINI, ALL_INPUTS_SET, SET_OUTPUT, RSIG, ALL_OUTS_SET, SIGN_INPUT, FINAL, NUM_STEPS };
+
+      tx_sign_timings(): m_start(std::chrono::steady_clock::now()), m_calls(), m_device() {}
+
+      template<class F>
+      auto exchange(step s, F &&f) -> decltype(f()) {
+        const auto start = std::chrono::steady_clock::now();
+        BOOST_SCOPE_EXIT_ALL(&, this) {
+          m_device[s] += std::chrono::steady_clock::now() - start;
+          ++m_calls[s];
+        };
+        return f();
+      }
+
+      void log(size_t idx) const {
+        static const char *names[NUM_STEPS] = {"init", "set_input", "input_vini", "all_inputs_set", "set_output", "rsig", "all_outs_set", "sign_input", "final"};
+        const auto total = std::chrono::steady_clock::now() - m_start;
+        std::chrono::steady_clock::duration device{};
+        for (size_t i = 0; i < NUM_STEPS; ++i) {
+          device += m_device[i];
+          if (m_calls[i] == 0)
+            continue;
+          MDEBUG("Transaction " << idx << " step " << names[i] << ": " << m_calls[i] << " messages, "
+              << ms(m_device[i]) << " ms on device, " << ms(m_device[i]) / m_calls[i] << " ms per message");
+        }
+        MDEBUG("Transaction " << idx << " signed in " << ms(total) << " ms, " << ms(device) << " ms waiting on the device, "
+            << ms(total - device) << " ms on the host");
+      }
+
+    private:
+      static uint64_t ms(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+      }
+
+      const std::chrono::steady_clock::time_point m_start;
+      uint64_t m_calls[NUM_STEPS];
+      std::chrono::steady_clock::duration m_device[NUM_STEPS];
+    };
+
     device_trezor::device_trezor() {
       m_live_refresh_in_progress = false;
       m_live_refresh_enabled = true;
@@ -616,6 +659,7 @@ namespace trezor {
       const tools::wallet2::tx_construction_data & cur_tx = unsigned_tx.txes[idx];
       unsigned long num_sources = cur_tx.sources.size();
       unsigned long num_outputs = cur_tx.splitted_dsts.size();
+      tx_sign_timings timings;
 
       // Step: Init
       auto init_msg = signer->step_init();
@@ -623,13 +667,13 @@ namespace trezor {
       transaction_pre_check(init_msg);
       EVENT_PROGRESS(1, 1, 1);
 
-      auto response = this->client_exchange<messages::monero::MoneroTransactionInitAck>(init_msg);
+      auto response = timings.exchange(tx_sign_timings::INIT, [&]{ return this->client_exchange<messages::monero::MoneroTransactionInitAck>(init_msg); });
       signer->step_init_ack(response);
 
       // Step: Set transaction inputs
       for(size_t cur_src = 0; cur_src < num_sources; ++cur_src){
         auto src = signer->step_set_input(cur_src);
-        auto ack = this->client_exchange<messages::monero::MoneroTransactionSetInputAck>(src);
+        auto ack = timings.exchange(tx_sign_timings::SET_INPUT, [&]{ return this->client_exchange<messages::monero::MoneroTransactionSetInputAck>(src); });
         signer->step_set_input_ack(ack);
         EVENT_PROGRESS(2, cur_src, num_sources);
       }
@@ -641,27 +685,27 @@ namespace trezor {
       // Step: input_vini
       for(size_t cur_src = 0; cur_src < num_sources; ++cur_src){
         auto src = signer->step_set_vini_input(cur_src);
-        auto ack = this->client_exchange<messages::monero::MoneroTransactionInputViniAck>(src);
+        auto ack = timings.exchange(tx_sign_timings::INPUT_VINI, [&]{ return this->client_exchange<messages::monero::MoneroTransactionInputViniAck>(src); });
         signer->step_set_vini_input_ack(ack);
         EVENT_PROGRESS(4, cur_src, num_sources);
       }
 
       // Step: all inputs set
       auto all_inputs_set = signer->step_all_inputs_set();
-      auto ack_all_inputs = this->client_exchange<messages::monero::MoneroTransactionAllInputsSetAck>(all_inputs_set);
+      auto ack_all_inputs = timings.exchange(tx_sign_timings::ALL_INPUTS_SET, [&]{ return this->client_exchange<messages::monero::MoneroTransactionAllInputsSetAck>(all_inputs_set); });
       signer->step_all_inputs_set_ack(ack_all_inputs);
       EVENT_PROGRESS(5, 1, 1);
 
       // Step: outputs
       for(size_t cur_dst = 0; cur_dst < num_outputs; ++cur_dst){
         auto src = signer->step_set_output(cur_dst);
-        auto ack = this->client_exchange<messages::monero::MoneroTransactionSetOutputAck>(src);
+        auto ack = timings.exchange(tx_sign_timings::SET_OUTPUT, [&]{ return this->client_exchange<messages::monero::MoneroTransactionSetOutputAck>(src); });
         signer->step_set_output_ack(ack);
 
         // If BP is offloaded to host, another step with computed BP may be needed.
         auto offloaded_bp = signer->step_rsig(cur_dst);
         if (offloaded_bp){
-          auto bp_ack = this->client_exchange<messages::monero::MoneroTransactionSetOutputAck>(offloaded_bp);
+          auto bp_ack = timings.exchange(tx_sign_timings::RSIG, [&]{ return this->client_exchange<messages::monero::MoneroTransactionSetOutputAck>(offloaded_bp); });
           signer->step_set_rsig_ack(ack);
         }
 
@@ -670,23 +714,24 @@ namespace trezor {
 
       // Step: all outs set
       auto all_out_set = signer->step_all_outs_set();
-      auto ack_all_out_set = this->client_exchange<messages::monero::MoneroTransactionAllOutSetAck>(all_out_set);
+      auto ack_all_out_set = timings.exchange(tx_sign_timings::ALL_OUTS_SET, [&]{ return this->client_exchange<messages::monero::MoneroTransactionAllOutSetAck>(all_out_set); });
       signer->step_all_outs_set_ack(ack_all_out_set, *this);
       EVENT_PROGRESS(7, 1, 1);
 
       // Step: sign each input
       for(size_t cur_src = 0; cur_src < num_sources; ++cur_src){
         auto src = signer->step_sign_input(cur_src);
-        auto ack_sign = this->client_exchange<messages::monero::MoneroTransactionSignInputAck>(src);
+        auto ack_sign = timings.exchange(tx_sign_timings::SIGN_INPUT, [&]{ return this->client_exchange<messages::monero::MoneroTransactionSignInputAck>(src); });
         signer->step_sign_input_ack(ack_sign);
         EVENT_PROGRESS(8, cur_src, num_sources);
       }
 
       // Step: final
       auto final_msg = signer->step_final();
-      auto ack_final = this->client_exchange<messages::monero::MoneroTransactionFinalAck>(final_msg);
+      auto ack_final = timings.exchange(tx_sign_timings::FINAL, [&]{ return this->client_exchange<messages::monero::MoneroTransactionFinalAck>(final_msg); });
       signer->step_final_ack(ack_final);
       EVENT_PROGRESS(9, 1, 1);
+      timings.log(idx);
 #undef EVENT_PROGRESS
     }
 
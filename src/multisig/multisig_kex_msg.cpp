@@ -30,6 +30,7 @@
 #include "multisig_kex_msg_serialization.h"
 
 #include "common/base58.h"
+#include "common/threadpool.h"
 #include "crypto/crypto.h"
 extern "C"
 {
@@ -43,6 +44,7 @@ extern "C"
 
 #include <boost/utility/string_ref.hpp> 
 
+#include <exception>
 #include <sstream>
 #include <utility>
 #include <vector>
@@ -290,4 +292,30 @@ namespace multisig
       "Multisig kex msg signature invalid.");
   }
   //----------------------------------------------------------------------------------------------------------------------
+  // EXTERNAL
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<multisig_kex_msg> parse_multisig_kex_msgs(const std::vector<std::string> &msgs)
+  {
+    std::vector<multisig_kex_msg> expanded_msgs(msgs.size());
+    std::vector<std::exception_ptr> errors(msgs.size());
+
+    tools::threadpool &tpool = tools::threadpool::getInstanceForCompute();
+    tools::threadpool::waiter waiter(tpool);
+    for (std::size_t i = 0; i < msgs.size(); ++i)
+    {
+      tpool.submit(&waiter, [&msgs, &expanded_msgs, &errors, i]{
+        try { expanded_msgs[i] = multisig_kex_msg{msgs[i]}; }
+        catch (...) { errors[i] = std::current_exception(); }
+      });
+    }
+    CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to parse multisig kex msgs.");
+    for (const std::exception_ptr &error : errors)
+    {
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+    return expanded_msgs;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
 } //namespace multisig
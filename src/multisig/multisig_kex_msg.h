@@ -106,4 +106,13 @@ namespace multisig
     // pubkey used to sign this msg
     crypto::public_key m_signing_pubkey;
   };
+
+  /**
+  * brief: parse_multisig_kex_msgs - parse and validate a set of kex messages, spread over the compute threadpool
+  *   - the subgroup checks and signature of each message are independent, so they are checked concurrently
+  * param: msgs - kex messages as strings
+  * return: parsed messages, in input order
+  * throws: the error of the first invalid message
+  */
+  std::vector<multisig_kex_msg> parse_multisig_kex_msgs(const std::vector<std::string> &msgs);
 } //namespace multisig
@@ -31,6 +31,7 @@
 #include "int-util.h"
 #include "memwipe.h"
 
+#include "common/threadpool.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
@@ -45,7 +46,9 @@
 #include <boost/multiprecision/cpp_int.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <functional>
 #include <limits>
 #include <set>
 #include <string>
@@ -132,6 +135,27 @@ bool view_tag_required(const int bp_version)
 }
 //----------------------------------------------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------------------------------------------
+// run f(i) for every input on the compute threadpool; inputs are signed independently, so large sweeps scale with cores
+static bool parallel_for_each_source(const std::size_t num_sources, const std::function<bool(std::size_t)>& f)
+{
+  if (num_sources <= 1)
+    return num_sources == 0 or f(0);
+
+  std::atomic<bool> ok{true};
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  tools::threadpool::waiter waiter(tpool);
+  for (std::size_t i = 0; i < num_sources; ++i) {
+    tpool.submit(&waiter, [&f, &ok, i]{
+      if (ok and not f(i))
+        ok = false;
+    });
+  }
+  if (not waiter.wait())
+    return false;
+  return ok;
+}
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
 static void sort_sources(
   std::vector<cryptonote::tx_source_entry>& sources
 )
@@ -996,7 +1020,8 @@ static bool set_tx_rct_signatures(
   if (not reconstruction)
     cached_w.resize(num_sources);
 
-  for (std::size_t i = 0; i < num_sources; ++i) {
+  // each input's ring, key aggregation hashes and fake responses are independent of the others
+  auto init_input = [&](const std::size_t i) -> bool {
     const std::size_t ring_size = rv.mixRing[i].size();
     const rct::key& I = sources[i].multisig_kLRki.ki;
     const std::size_t l = sources[i].real_output;
@@ -1057,7 +1082,10 @@ static bool set_tx_rct_signatures(
       sc_mul(cached_w[i].bytes, mu_P.bytes, input_secret_keys[i].bytes);
       sc_muladd(cached_w[i].bytes, mu_C.bytes, z.bytes, cached_w[i].bytes);
     }
-  }
+    return true;
+  };
+  if (not parallel_for_each_source(num_sources, init_input))
+    return false;
   unsigned_tx.rct_signatures = std::move(rv);
   return true;
 }
@@ -1393,7 +1421,7 @@ bool tx_builder_ringct_t::next_partial_sign(
     return false;
   if (num_sources != s.size())
     return false;
-  for (std::size_t i = 0; i < num_sources; ++i) {
+  return parallel_for_each_source(num_sources, [&](const std::size_t i) -> bool {
     rct::key c;
     rct::key alpha_combined;
     auto alpha_combined_wiper = epee::misc_utils::create_scope_leave_handler([&]{
@@ -1423,8 +1451,8 @@ bool tx_builder_ringct_t::next_partial_sign(
     //      s += alpha_combined_local - challenge*[mu_P*(local keys)]
     sc_add(s[i].bytes, s[i].bytes, alpha_combined.bytes);
     sc_mulsub(s[i].bytes, c.bytes, w.bytes, s[i].bytes);
-  }
-  return true;
+    return true;
+  });
 }
 //----------------------------------------------------------------------------------------------------------------------
 bool tx_builder_ringct_t::finalize_tx(
@@ -26,6 +26,7 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,44 @@ namespace oracle {
 
   const std::vector<std::string> ASSET_TYPES = {"SAL", "SAL1", "BURN"};
 
+  // Interned asset types: the position of the type in ASSET_TYPES. Transactions still carry the
+  // asset type strings on the wire, code that only compares or tallies asset types can use these.
+  enum class asset_id : uint8_t
+  {
+    SAL = 0,
+    SAL1 = 1,
+    BURN = 2,
+    UNKNOWN = 0xff
+  };
+
+  inline asset_id get_asset_id(const std::string &asset_type) noexcept
+  {
+    switch (asset_type.size())
+    {
+      case 3:
+        return asset_type == "SAL" ? asset_id::SAL : asset_id::UNKNOWN;
+      case 4:
+        if (asset_type == "SAL1")
+          return asset_id::SAL1;
+        return asset_type == "BURN" ? asset_id::BURN : asset_id::UNKNOWN;
+      default:
+        return asset_id::UNKNOWN;
+    }
+  }
+
+  // the asset type string of an interned asset type, empty for asset_id::UNKNOWN
+  inline const std::string &get_asset_type(const asset_id id) noexcept
+  {
+    static const std::string unknown;
+    const size_t index = static_cast<size_t>(id);
+    return index < ASSET_TYPES.size() ? ASSET_TYPES[index] : unknown;
+  }
+
+  inline bool is_known_asset_type(const std::string &asset_type) noexcept
+  {
+    return get_asset_id(asset_type) != asset_id::UNKNOWN;
+  }
+
   class asset_type_counts
   {
 
@@ -50,28 +89,47 @@ namespace oracle {
       {
       }
 
-      uint64_t operator[](const std::string asset_type) const noexcept
+      uint64_t operator[](const asset_id id) const noexcept
       {
-        if (asset_type == "SAL") {
-          return SAL;
-        } else if (asset_type == "SAL1") {
-          return SAL1;
-        } else if (asset_type == "BURN") {
-          return BURN;
+        switch (id)
+        {
+          case asset_id::SAL:
+            return SAL;
+          case asset_id::SAL1:
+            return SAL1;
+          case asset_id::BURN:
+            return BURN;
+          default:
+            return 0;
         }
+      }
 
-        return 0;
+      uint64_t operator[](const std::string &asset_type) const noexcept
+      {
+        return (*this)[get_asset_id(asset_type)];
       }
 
-      void add(const std::string asset_type, const uint64_t val)
+      void add(const asset_id id, const uint64_t val)
       {
-        if (asset_type == "SAL") {
-          SAL += val;
-        } else if (asset_type == "SAL1") {
-          SAL1 += val;
-        } else if (asset_type == "BURN") {
-          BURN += val;
+        switch (id)
+        {
+          case asset_id::SAL:
+            SAL += val;
+            break;
+          case asset_id::SAL1:
+            SAL1 += val;
+            break;
+          case asset_id::BURN:
+            BURN += val;
+            break;
+          default:
+            break;
         }
       }
+
+      void add(const std::string &asset_type, const uint64_t val)
+      {
+        add(get_asset_id(asset_type), val);
+      }
   };
 }
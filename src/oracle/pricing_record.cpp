@@ -28,8 +28,13 @@
 // Portions of this code based upon code Copyright (c) 2019, The Monero Project
 
 #include <boost/multiprecision/cpp_int.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <memory>
 #include "pricing_record.h"
 
+#include "common/lru_cache.h"
+#include "int-util.h"
 #include "serialization/keyvalue_serialization.h"
 #include "storages/portable_storage.h"
 
@@ -39,6 +44,33 @@ namespace oracle
 
   namespace
   {
+    // The same records get verified repeatedly (when fetched from an Oracle, then
+    // in every block template built while they are current), so both the parsed
+    // key and the verification results are kept
+    constexpr size_t VERIFY_CACHE_SIZE = 1024;
+    boost::mutex verify_cache_lock;
+    tools::lru_cache<std::string, bool> verify_cache(VERIFY_CACHE_SIZE);
+    std::string cached_public_key_pem;
+    std::shared_ptr<EVP_PKEY> cached_public_key;
+
+    std::shared_ptr<EVP_PKEY> get_public_key(const std::string& public_key)
+    {
+      boost::lock_guard<boost::mutex> lock(verify_cache_lock);
+      if (cached_public_key && cached_public_key_pem == public_key)
+        return cached_public_key;
+
+      BIO* bio = BIO_new_mem_buf(public_key.c_str(), public_key.size());
+      if (!bio)
+        return nullptr;
+      EVP_PKEY* pubkey = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+      BIO_free(bio);
+      if (!pubkey)
+        return nullptr;
+      cached_public_key.reset(pubkey, EVP_PKEY_free);
+      cached_public_key_pem = public_key;
+      return cached_public_key;
+    }
+
     struct asset_data_serialized
     {
       std::string asset_type;
@@ -227,16 +259,6 @@ namespace oracle
   {
     CHECK_AND_ASSERT_THROW_MES(!public_key.empty(), "Pricing record verification failed. NULL public key. PK Size: " << public_key.size());
 
-    // extract the key
-    EVP_PKEY* pubkey;
-    BIO* bio = BIO_new_mem_buf(public_key.c_str(), public_key.size());
-    if (!bio) {
-      return false;
-    }
-    pubkey = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
-    BIO_free(bio);
-    CHECK_AND_ASSERT_THROW_MES(pubkey != NULL, "Pricing record verification failed. NULL public key.");
-
     // Build the JSON string, so that we can verify the signature
     std::ostringstream oss;
     oss << "{\"pr_version\":" << pr_version;
@@ -256,11 +278,35 @@ namespace oracle
     oss << "}";
     std::string message = oss.str();
 
+    // The result only depends on the key, the message and the signature; each is length prefixed so no two
+    // different triples hash the same bytes
+    std::string cache_key;
+    const auto append_field = [&cache_key](const void *data, const std::size_t size) {
+      const uint64_t length = SWAP64LE(static_cast<uint64_t>(size));
+      cache_key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+      cache_key.append(reinterpret_cast<const char*>(data), size);
+    };
+    append_field(public_key.data(), public_key.size());
+    append_field(message.data(), message.size());
+    append_field(signature.data(), signature.size());
+    const crypto::hash cache_hash = crypto::cn_fast_hash(cache_key.data(), cache_key.size());
+    cache_key.assign(cache_hash.data, sizeof(cache_hash.data));
+    {
+      boost::lock_guard<boost::mutex> lock(verify_cache_lock);
+      const bool *cached = verify_cache.get(cache_key);
+      if (cached)
+        return *cached;
+    }
+
+    // extract the key
+    std::shared_ptr<EVP_PKEY> pubkey = get_public_key(public_key);
+    CHECK_AND_ASSERT_THROW_MES(pubkey != NULL, "Pricing record verification failed. NULL public key.");
+
     // Create a verify digest from the message
     EVP_MD_CTX *ctx = EVP_MD_CTX_create();
     int ret = 0;
     if (ctx) {
-      ret = EVP_DigestVerifyInit(ctx, NULL, EVP_sha256(), NULL, pubkey);
+      ret = EVP_DigestVerifyInit(ctx, NULL, EVP_sha256(), NULL, pubkey.get());
       if (ret == 1) {
         ret = EVP_DigestVerifyUpdate(ctx, message.data(), message.length());
         if (ret == 1) {
@@ -271,10 +317,14 @@ namespace oracle
 
     // Cleanup the context we created
     EVP_MD_CTX_destroy(ctx);
-    // Cleanup the openssl stuff
-    EVP_PKEY_free(pubkey);
 
-    if (ret == 1)
+    const bool verified = ret == 1;
+    if (ctx) {
+      // a missing context is a local failure, not a verdict on the record
+      boost::lock_guard<boost::mutex> lock(verify_cache_lock);
+      verify_cache.put(cache_key, verified);
+    }
+    if (verified)
       return true;
 
     // Get the errors from OpenSSL
@@ -32,6 +32,7 @@
 #include <boost/algorithm/string/finder.hpp>
 #include <boost/chrono/duration.hpp>
 #include <boost/endian/conversion.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/optional/optional.hpp>
 #include <boost/thread/future.hpp>
 #include <boost/utility/string_ref.hpp>
@@ -39,6 +40,7 @@
 #include <utility>
 
 #include "common/command_line.h"
+#include "common/metrics.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "net_node.h"
@@ -153,6 +155,7 @@ namespace nodetool
     const command_line::arg_descriptor<bool> arg_p2p_hide_my_port   =    {"hide-my-port", "Do not announce yourself as peerlist candidate", false, true};
     const command_line::arg_descriptor<bool> arg_no_sync = {"no-sync", "Don't synchronize the blockchain with other peers", false};
     const command_line::arg_descriptor<bool> arg_enable_dns_blocklist = {"enable-dns-blocklist", "Apply realtime blocklist from DNS", false};
+    const command_line::arg_descriptor<bool> arg_disable_p2p_compression = {"disable-p2p-compression", "Do not offer compressed block and chain responses to peers", false};
 
     const command_line::arg_descriptor<bool>        arg_no_igd  = {"no-igd", "Disable UPnP port mapping"};
     const command_line::arg_descriptor<std::string> arg_igd = {"igd", "UPnP port mapping (disabled, enabled, delayed)", "delayed"};
@@ -170,6 +173,7 @@ namespace nodetool
       "pad-transactions", "Pad relayed transactions to help defend against traffic volume analysis", false
     };
     const command_line::arg_descriptor<uint32_t> arg_max_connections_per_ip = {"max-connections-per-ip", "Maximum number of p2p connections allowed from the same IP address", 1};
+    const command_line::arg_descriptor<uint32_t> arg_p2p_io_loops = {"p2p-io-loops", "Run incoming p2p connections on this many network loops, each with its own thread (0 to share the p2p threads)", 0};
 
     boost::optional<std::vector<proxy>> get_proxies(boost::program_options::variables_map const& vm)
     {
@@ -385,4 +389,143 @@ namespace nodetool
 
         return boost::none;
     }
+
+    namespace
+    {
+        struct socks_pool_connect
+        {
+            std::shared_ptr<socks_pool> pool;
+            epee::net_utils::network_address remote;
+            std::shared_ptr<boost::asio::steady_timer> timeout;
+            std::chrono::steady_clock::time_point start;
+
+            void operator()(boost::system::error_code error, boost::asio::ip::tcp::socket&& socket)
+            {
+                timeout->cancel();
+                pool->on_connect(remote, error, std::move(socket), start);
+            }
+        };
+    }
+
+    socks_pool::socks_pool(const epee::net_utils::zone zone, const std::size_t size, const std::chrono::seconds max_idle)
+      : m_lock(), m_entries(), m_zone(zone), m_size(size), m_max_idle(max_idle), m_closed(false)
+    {}
+
+    void socks_pool::fill(boost::asio::io_context& service, const boost::asio::ip::tcp::endpoint& proxy, const std::vector<epee::net_utils::network_address>& candidates)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<epee::net_utils::network_address> connect{};
+        {
+            boost::lock_guard<boost::mutex> lock{m_lock};
+            if (m_closed)
+                return;
+
+            // the remote end drops connections that never handshake, do not keep them around for long
+            m_entries.erase(
+                std::remove_if(m_entries.begin(), m_entries.end(), [this, now](const entry& e) {
+                    return e.socket && m_max_idle < now - e.time;
+                }),
+                m_entries.end()
+            );
+
+            for (const epee::net_utils::network_address& candidate : candidates)
+            {
+                if (m_size <= m_entries.size())
+                    break;
+                const bool pooled = std::any_of(m_entries.begin(), m_entries.end(), [&candidate](const entry& e) {
+                    return e.address == candidate;
+                });
+                if (pooled)
+                    continue;
+                m_entries.push_back({candidate, boost::none, now});
+                connect.push_back(candidate);
+            }
+        }
+
+        for (const epee::net_utils::network_address& remote : connect)
+        {
+            auto timeout = std::make_shared<boost::asio::steady_timer>(service);
+            auto client = net::socks::make_connect_client(
+                boost::asio::ip::tcp::socket{service}, net::socks::version::v4a, socks_pool_connect{shared_from_this(), remote, timeout, now}
+            );
+            // armed first, the connect can complete on another thread as soon as it starts
+            timeout->expires_after(socks_connect_timeout);
+            timeout->async_wait(net::socks::client::async_close{client});
+            if (!start_socks(std::move(client), proxy, remote))
+            {
+                timeout->cancel();
+                on_connect(remote, boost::asio::error::operation_aborted, boost::asio::ip::tcp::socket{service}, now);
+            }
+        }
+    }
+
+    boost::optional<boost::asio::ip::tcp::socket> socks_pool::take(const epee::net_utils::network_address& remote)
+    {
+        boost::lock_guard<boost::mutex> lock{m_lock};
+        const auto now = std::chrono::steady_clock::now();
+        for (auto e = m_entries.begin(); e != m_entries.end(); ++e)
+        {
+            if (e->address != remote || !e->socket)
+                continue;
+            boost::optional<boost::asio::ip::tcp::socket> out{};
+            if (now - e->time <= m_max_idle && e->socket->is_open())
+                out.emplace(std::move(*e->socket));
+            m_entries.erase(e);
+            return out;
+        }
+        return boost::none;
+    }
+
+    std::vector<epee::net_utils::network_address> socks_pool::ready() const
+    {
+        std::vector<epee::net_utils::network_address> out{};
+        boost::lock_guard<boost::mutex> lock{m_lock};
+        for (const entry& e : m_entries)
+        {
+            if (e.socket)
+                out.push_back(e.address);
+        }
+        return out;
+    }
+
+    void socks_pool::close()
+    {
+        boost::lock_guard<boost::mutex> lock{m_lock};
+        m_closed = true;
+        m_entries.clear();
+    }
+
+    void socks_pool::record_latency(const std::chrono::steady_clock::duration elapsed, const bool pooled) const
+    {
+        tools::metrics::get_histogram(
+            "p2p_socks_connect_seconds", "Time to get a socks connection for a new outbound peer",
+            tools::metrics::label("zone", epee::net_utils::zone_to_string(m_zone)) + "," + tools::metrics::label("pooled", pooled ? "yes" : "no")
+        ).observe(std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+    }
+
+    void socks_pool::on_connect(const epee::net_utils::network_address& remote, const boost::system::error_code error, boost::asio::ip::tcp::socket&& socket, const std::chrono::steady_clock::time_point start)
+    {
+        boost::lock_guard<boost::mutex> lock{m_lock};
+        const auto e = std::find_if(m_entries.begin(), m_entries.end(), [&remote](const entry& x) {
+            return x.address == remote && !x.socket;
+        });
+        if (e == m_entries.end())
+            return; // closed meanwhile, dropping the socket closes it
+
+        if (error)
+        {
+            MDEBUG("Failed to pre-connect to " << remote.str() << " via socks: " << error.message());
+            m_entries.erase(e);
+            return;
+        }
+
+        MDEBUG("Pre-connected to " << remote.str() << " via socks");
+        const auto now = std::chrono::steady_clock::now();
+        tools::metrics::get_histogram(
+            "p2p_socks_preconnect_seconds", "Time to pre-connect a pooled socks connection",
+            tools::metrics::label("zone", epee::net_utils::zone_to_string(m_zone))
+        ).observe(std::chrono::duration_cast<std::chrono::microseconds>(now - start));
+        e->socket.emplace(std::move(socket));
+        e->time = now;
+    }
 }
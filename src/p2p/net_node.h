@@ -40,6 +40,7 @@
 #include <boost/uuid/uuid.hpp>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -105,6 +106,50 @@ namespace nodetool
   boost::optional<boost::asio::ip::tcp::socket>
   socks_connect_internal(const std::atomic<bool>& stop_signal, boost::asio::io_context& service, const boost::asio::ip::tcp::endpoint& proxy, const epee::net_utils::network_address& remote);
 
+  /*! Socks connections to peers made ahead of time, so that a new outbound
+      peer in an anonymity zone does not wait on circuit setup. Sockets are
+      connected asynchronously and handed over to the p2p server as is. */
+  class socks_pool: public std::enable_shared_from_this<socks_pool>
+  {
+    struct entry
+    {
+      epee::net_utils::network_address address;
+      boost::optional<boost::asio::ip::tcp::socket> socket; //!< none while connecting
+      std::chrono::steady_clock::time_point time;
+    };
+
+    mutable boost::mutex m_lock;
+    std::vector<entry> m_entries;
+    const epee::net_utils::zone m_zone;
+    const std::size_t m_size;
+    const std::chrono::seconds m_max_idle;
+    bool m_closed;
+
+  public:
+    socks_pool(epee::net_utils::zone zone, std::size_t size, std::chrono::seconds max_idle);
+
+    socks_pool(const socks_pool&) = delete;
+    socks_pool& operator=(const socks_pool&) = delete;
+
+    //! Closes sockets idle past `max_idle`, then connects to `candidates` not already pooled until `size` are ready or pending.
+    void fill(boost::asio::io_context& service, const boost::asio::ip::tcp::endpoint& proxy, const std::vector<epee::net_utils::network_address>& candidates);
+
+    //! \return Ready socket to `remote`, if any.
+    boost::optional<boost::asio::ip::tcp::socket> take(const epee::net_utils::network_address& remote);
+
+    //! \return Addresses with a ready socket.
+    std::vector<epee::net_utils::network_address> ready() const;
+
+    //! Closes all pooled sockets; connects still pending are closed as they finish.
+    void close();
+
+    //! Records the time taken to get a socket for a new outbound connection to the zone.
+    void record_latency(std::chrono::steady_clock::duration elapsed, bool pooled) const;
+
+    //! Called when a socks connect started by `fill` completes.
+    void on_connect(const epee::net_utils::network_address& remote, boost::system::error_code error, boost::asio::ip::tcp::socket&& socket, std::chrono::steady_clock::time_point start);
+  };
+
 
   template<class base_type>
   struct p2p_connection_context_t: base_type //t_payload_net_handler::connection_context //public net_utils::connection_context_base
@@ -171,6 +216,7 @@ namespace nodetool
           m_peerlist(),
           m_config{},
           m_proxy_address(),
+          m_socks_pool(),
           m_current_number_of_out_peers(0),
           m_current_number_of_in_peers(0),
           m_seed_nodes_lock(),
@@ -193,6 +239,7 @@ namespace nodetool
           m_peerlist(),
           m_config{},
           m_proxy_address(),
+          m_socks_pool(),
           m_current_number_of_out_peers(0),
           m_current_number_of_in_peers(0),
           m_seed_nodes_lock(),
@@ -214,6 +261,7 @@ namespace nodetool
       peerlist_manager m_peerlist;
       config m_config;
       boost::asio::ip::tcp::endpoint m_proxy_address;
+      std::shared_ptr<socks_pool> m_socks_pool;
       std::atomic<unsigned int> m_current_number_of_out_peers;
       std::atomic<unsigned int> m_current_number_of_in_peers;
       boost::shared_mutex m_seed_nodes_lock;
@@ -253,9 +301,11 @@ namespace nodetool
         m_hide_my_port(false),
         m_igd(no_igd),
         m_offline(false),
+        m_read_replica(false),
         is_closing(false),
         m_network_id(),
         m_enable_dns_seed_nodes(true),
+        m_p2p_compression(true),
         max_connections(1)
     {}
     virtual ~node_server();
@@ -342,6 +392,7 @@ namespace nodetool
     //----------------- i_p2p_endpoint -------------------------------------------------------------
     virtual bool relay_notify_to_list(int command, epee::levin::message_writer message, std::vector<std::pair<epee::net_utils::zone, boost::uuids::uuid>> connections) final;
     virtual epee::net_utils::zone send_txs(std::vector<cryptonote::blobdata> txs, const epee::net_utils::zone origin, const boost::uuids::uuid& source, cryptonote::relay_method tx_relay);
+    virtual void on_txs_received(const epee::net_utils::zone zone, const boost::uuids::uuid& source, std::vector<crypto::hash> tx_hashes);
     virtual bool invoke_notify_to_peer(int command, epee::levin::message_writer message, const epee::net_utils::connection_context_base& context) final;
     virtual bool drop_connection(const epee::net_utils::connection_context_base& context);
     virtual void request_callback(const epee::net_utils::connection_context_base& context);
@@ -366,6 +417,7 @@ namespace nodetool
     bool sanitize_peerlist(std::vector<peerlist_entry>& local_peerlist);
 
     bool connections_maker();
+    bool fill_socks_pools();
     bool peer_sync_idle_maker();
     bool do_handshake_with_peer(peerid_type& pi, p2p_connection_context& context, bool just_take_peerlist = false);
     bool do_peer_timed_sync(const epee::net_utils::connection_context_base& context, peerid_type peer_id);
@@ -389,9 +441,12 @@ namespace nodetool
     template<class t_callback>
     bool try_ping(basic_node_data& node_data, p2p_connection_context& context, const t_callback &cb);
     bool try_get_support_flags(const p2p_connection_context& context, std::function<void(p2p_connection_context&, const uint32_t&)> f);
+    void set_support_flags(p2p_connection_context& context, uint32_t support_flags);
     bool make_expected_connections_count(network_zone& zone, PeerType peer_type, size_t expected_connections);
     void record_addr_failed(const epee::net_utils::network_address& addr);
     bool is_addr_recently_failed(const epee::net_utils::network_address& addr);
+    void record_handshake_latency(const epee::net_utils::network_address& addr, uint64_t ms);
+    uint64_t get_handshake_latency(const epee::net_utils::network_address& addr);
     bool is_priority_node(const epee::net_utils::network_address& na);
     std::set<std::string> get_ip_seed_nodes() const;
     std::set<std::string> get_dns_seed_nodes();
@@ -460,6 +515,7 @@ namespace nodetool
     bool m_hide_my_port;
     igd_t m_igd;
     bool m_offline;
+    bool m_read_replica; //!< sharing the data dir with another daemon, so leave its state files alone
     bool m_use_ipv6;
     bool m_require_ipv4;
     std::atomic<bool> is_closing;
@@ -476,6 +532,7 @@ namespace nodetool
     epee::math_helper::once_a_time_seconds<60> m_gray_peerlist_housekeeping_interval;
     epee::math_helper::once_a_time_seconds<3600, false> m_incoming_connections_interval;
     epee::math_helper::once_a_time_seconds<7000> m_dns_blocklist_interval;
+    epee::math_helper::once_a_time_seconds<10> m_socks_pool_interval;
 
     std::list<epee::net_utils::network_address>   m_priority_peers;
     std::vector<epee::net_utils::network_address> m_exclusive_peers;
@@ -507,6 +564,9 @@ namespace nodetool
     epee::critical_section m_host_fails_score_lock;
     std::map<std::string, uint64_t> m_host_fails_score;
 
+    epee::critical_section m_handshake_latency_lock;
+    std::map<std::string, uint64_t> m_handshake_latency; // host -> last outgoing handshake time, ms
+
     boost::mutex m_used_stripe_peers_mutex;
     std::array<std::list<epee::net_utils::network_address>, 1 << CRYPTONOTE_PRUNING_LOG_STRIPES> m_used_stripe_peers;
 
@@ -517,6 +577,7 @@ namespace nodetool
 
     bool m_enable_dns_seed_nodes;
     bool m_enable_dns_blocklist;
+    bool m_p2p_compression;
 
     uint32_t max_connections;
   };
@@ -541,6 +602,7 @@ namespace nodetool
     extern const command_line::arg_descriptor<bool> arg_p2p_hide_my_port;
     extern const command_line::arg_descriptor<bool> arg_no_sync;
     extern const command_line::arg_descriptor<bool> arg_enable_dns_blocklist;
+    extern const command_line::arg_descriptor<bool> arg_disable_p2p_compression;
 
     extern const command_line::arg_descriptor<bool>        arg_no_igd;
     extern const command_line::arg_descriptor<std::string> arg_igd;
@@ -554,6 +616,7 @@ namespace nodetool
     extern const command_line::arg_descriptor<int64_t> arg_limit_rate;
     extern const command_line::arg_descriptor<bool> arg_pad_transactions;
     extern const command_line::arg_descriptor<uint32_t> arg_max_connections_per_ip;
+    extern const command_line::arg_descriptor<uint32_t> arg_p2p_io_loops;
 }
 
 POP_WARNINGS
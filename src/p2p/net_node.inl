@@ -121,6 +121,7 @@ namespace nodetool
     command_line::add_arg(desc, arg_p2p_hide_my_port);
     command_line::add_arg(desc, arg_no_sync);
     command_line::add_arg(desc, arg_enable_dns_blocklist);
+    command_line::add_arg(desc, arg_disable_p2p_compression);
     command_line::add_arg(desc, arg_no_igd);
     command_line::add_arg(desc, arg_igd);
     command_line::add_arg(desc, arg_out_peers);
@@ -131,6 +132,7 @@ namespace nodetool
     command_line::add_arg(desc, arg_limit_rate);
     command_line::add_arg(desc, arg_pad_transactions);
     command_line::add_arg(desc, arg_max_connections_per_ip);
+    command_line::add_arg(desc, arg_p2p_io_loops);
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
@@ -143,6 +145,8 @@ namespace nodetool
 
     network_zone& public_zone = m_network_zones[epee::net_utils::zone::public_];
     public_zone.m_config.m_support_flags = P2P_SUPPORT_FLAGS;
+    if (!m_p2p_compression)
+      public_zone.m_config.m_support_flags &= ~P2P_SUPPORT_FLAG_LEVIN_COMPRESSION;
     public_zone.m_config.m_peer_id = crypto::rand<uint64_t>();
     m_first_connection_maker_call = true;
 
@@ -472,7 +476,8 @@ namespace nodetool
       MFATAL("Invalid value for --" << arg_igd.name << ", expected enabled, disabled or delayed");
       return false;
     }
-    m_offline = command_line::get_arg(vm, cryptonote::arg_offline);
+    m_read_replica = command_line::get_arg(vm, cryptonote::arg_read_replica);
+    m_offline = command_line::get_arg(vm, cryptonote::arg_offline) || m_read_replica;
     m_use_ipv6 = command_line::get_arg(vm, arg_p2p_use_ipv6);
     m_require_ipv4 = !command_line::get_arg(vm, arg_p2p_ignore_ipv4);
     public_zone.m_notifier = cryptonote::levin::notify{
@@ -584,6 +589,7 @@ namespace nodetool
       m_payload_handler.set_no_sync(true);
 
     m_enable_dns_blocklist = command_line::get_arg(vm, arg_enable_dns_blocklist);
+    m_p2p_compression = !command_line::get_arg(vm, arg_disable_p2p_compression);
 
     if ( !set_max_out_peers(public_zone, command_line::get_arg(vm, arg_out_peers) ) )
       return false;
@@ -622,6 +628,9 @@ namespace nodetool
       }
       zone.m_connect = &socks_connect;
       zone.m_proxy_address = std::move(proxy.address);
+      zone.m_socks_pool = std::make_shared<socks_pool>(
+        proxy.zone, P2P_DEFAULT_SOCKS_POOL_SIZE, std::chrono::seconds{P2P_DEFAULT_SOCKS_POOL_MAX_IDLE}
+      );
 
       if (!set_max_out_peers(zone, proxy.max_connections))
         return false;
@@ -975,6 +984,8 @@ namespace nodetool
     //configure self
 
     public_zone.m_net_server.set_threads_prefix("P2P"); // all zones use these threads/asio::io_service
+    if (!public_zone.m_net_server.set_io_loops(command_line::get_arg(vm, arg_p2p_io_loops)))
+      return false;
 
     // from here onwards, it's online stuff
     if (m_offline)
@@ -1105,11 +1116,17 @@ namespace nodetool
     if (!m_offline)
     {
       for(auto& zone : m_network_zones)
+      {
+        if (zone.second.m_socks_pool)
+          zone.second.m_socks_pool->close();
         zone.second.m_net_server.deinit_server();
+      }
       // remove UPnP port mapping
       if(m_igd == igd)
         delete_upnp_port_mapping(m_listening_port);
     }
+    if (m_read_replica)
+      return true;
     return store_config();
   }
   //-----------------------------------------------------------------------------------
@@ -1212,7 +1229,7 @@ namespace nodetool
         pi = context.peer_id = rsp.node_data.peer_id;
         context.m_rpc_port = rsp.node_data.rpc_port;
         context.m_rpc_credits_per_hash = rsp.node_data.rpc_credits_per_hash;
-        context.support_flags = rsp.node_data.support_flags;
+        set_support_flags(context, rsp.node_data.support_flags);
         const auto azone = context.m_remote_address.get_zone();
         network_zone& zone = m_network_zones.at(azone);
         zone.m_peerlist.set_peer_just_seen(rsp.node_data.peer_id, context.m_remote_address, context.m_pruning_seed, context.m_rpc_port, context.m_rpc_credits_per_hash);
@@ -1247,9 +1264,9 @@ namespace nodetool
     else if (!just_take_peerlist)
     {
       if (context_.support_flags == 0)
-        try_get_support_flags(context_, [](p2p_connection_context& flags_context, const uint32_t& support_flags) 
+        try_get_support_flags(context_, [this](p2p_connection_context& flags_context, const uint32_t& support_flags)
         {
-          flags_context.support_flags = support_flags;
+          set_support_flags(flags_context, support_flags);
         });
     }
 
@@ -1426,6 +1443,7 @@ namespace nodetool
 
     con->m_anchor = peer_type == anchor;
     peerid_type pi = AUTO_VAL_INIT(pi);
+    const uint64_t handshake_start = epee::misc_utils::get_tick_count();
     bool res = do_handshake_with_peer(pi, *con, just_take_peerlist);
 
     if(!res)
@@ -1437,6 +1455,7 @@ namespace nodetool
       record_addr_failed(na);
       return false;
     }
+    record_handshake_latency(na, epee::misc_utils::get_tick_count() - handshake_start);
 
     if(just_take_peerlist)
     {
@@ -1534,6 +1553,25 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::record_handshake_latency(const epee::net_utils::network_address& addr, uint64_t ms)
+  {
+    CRITICAL_REGION_LOCAL(m_handshake_latency_lock);
+    // 0 means unknown
+    m_handshake_latency[addr.host_str()] = std::max<uint64_t>(ms, 1);
+    // bounded by the white list size, forget an arbitrary host past that
+    if (m_handshake_latency.size() > P2P_LOCAL_WHITE_PEERLIST_LIMIT)
+      m_handshake_latency.erase(std::next(m_handshake_latency.begin(), crypto::rand_idx(m_handshake_latency.size())));
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  uint64_t node_server<t_payload_net_handler>::get_handshake_latency(const epee::net_utils::network_address& addr)
+  {
+    CRITICAL_REGION_LOCAL(m_handshake_latency_lock);
+    auto it = m_handshake_latency.find(addr.host_str());
+    return it == m_handshake_latency.end() ? 0 : it->second;
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::make_new_connection_from_anchor_peerlist(const std::vector<anchor_peerlist_entry>& anchor_peerlist)
   {
     for (const auto& pe: anchor_peerlist) {
@@ -1687,6 +1725,22 @@ namespace nodetool
       {
         // if using the white list, we first pick in the set of peers we've already been using earlier
         random_index = get_random_index_with_fixed_probability(std::min<uint64_t>(filtered.size() - 1, 20));
+
+        // draw a second candidate the same way and keep whichever answered our last
+        // handshake faster; both are random picks, so no single fast host can take
+        // every slot, and if either was never timed the first draw stands
+        const size_t other_index = get_random_index_with_fixed_probability(std::min<uint64_t>(filtered.size() - 1, 20));
+        if (other_index != random_index)
+        {
+          peerlist_entry pe, other_pe;
+          if (zone.m_peerlist.get_white_peer_by_index(pe, filtered[random_index]) && zone.m_peerlist.get_white_peer_by_index(other_pe, filtered[other_index]))
+          {
+            const uint64_t latency = get_handshake_latency(pe.adr), other_latency = get_handshake_latency(other_pe.adr);
+            if (latency && other_latency && other_latency < latency)
+              random_index = other_index;
+          }
+        }
+
         CRITICAL_REGION_LOCAL(m_used_stripe_peers_mutex);
         if (next_needed_pruning_stripe > 0 && next_needed_pruning_stripe <= (1ul << CRYPTONOTE_PRUNING_LOG_STRIPES) && !m_used_stripe_peers[next_needed_pruning_stripe-1].empty())
         {
@@ -1849,6 +1903,18 @@ namespace nodetool
 
       if (zone.first == zone_type::public_ && !connect_to_peerlist(m_priority_peers)) continue;
 
+      // peers with a pre-connected socks socket are only a handshake away, so use them first
+      if (zone.second.m_socks_pool)
+      {
+        for (const epee::net_utils::network_address& na : zone.second.m_socks_pool->ready())
+        {
+          if (zone.second.m_config.m_net_config.max_out_connection_count <= get_outgoing_connections_count(zone.second))
+            break;
+          if (!is_addr_connected(na))
+            try_to_connect_and_handshake_with_new_peer(na);
+        }
+      }
+
       size_t base_expected_white_connections = (zone.second.m_config.m_net_config.max_out_connection_count*P2P_DEFAULT_WHITELIST_CONNECTIONS_PERCENT)/100;
 
       // carefully avoid `continue` in nested loop
@@ -1903,6 +1969,40 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::fill_socks_pools()
+  {
+    if (m_offline)
+      return true;
+
+    for (auto& zone : m_network_zones)
+    {
+      if (!zone.second.m_socks_pool || zone.second.m_net_server.is_stop_signal_sent())
+        continue;
+
+      // a few of the most recently seen peers from each list, checked outside the peerlist lock
+      std::vector<epee::net_utils::network_address> addresses;
+      for (const bool white : {true, false})
+      {
+        const size_t limit = addresses.size() + 16;
+        zone.second.m_peerlist.foreach(white, [&addresses, limit](const peerlist_entry &pe){
+          addresses.push_back(pe.adr);
+          return addresses.size() < limit;
+        });
+      }
+      std::shuffle(addresses.begin(), addresses.end(), crypto::random_device{});
+
+      std::vector<epee::net_utils::network_address> candidates;
+      for (const epee::net_utils::network_address& na : addresses)
+      {
+        if (!is_addr_connected(na) && !is_addr_recently_failed(na) && is_remote_host_allowed(na))
+          candidates.push_back(na);
+      }
+      zone.second.m_socks_pool->fill(zone.second.m_net_server.get_io_context(), zone.second.m_proxy_address, candidates);
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::make_expected_connections_count(network_zone& zone, PeerType peer_type, size_t expected_connections)
   {
     if (m_offline)
@@ -2042,6 +2142,7 @@ namespace nodetool
     m_peerlist_store_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::store_config, this));
     m_incoming_connections_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::check_incoming_connections, this));
     m_dns_blocklist_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::update_dns_blocklist, this));
+    m_socks_pool_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::fill_socks_pools, this));
     return true;
   }
   //-----------------------------------------------------------------------------------
@@ -2275,6 +2376,14 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::on_txs_received(const epee::net_utils::zone zone, const boost::uuids::uuid& source, std::vector<crypto::hash> tx_hashes)
+  {
+    const auto network = m_network_zones.find(zone);
+    if (network != m_network_zones.end())
+      network->second.m_notifier.on_txs_received(source, std::move(tx_hashes));
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   epee::net_utils::zone node_server<t_payload_net_handler>::send_txs(std::vector<cryptonote::blobdata> txs, const epee::net_utils::zone origin, const boost::uuids::uuid& source, const cryptonote::relay_method tx_relay)
   {
     namespace enet = epee::net_utils;
@@ -2485,6 +2594,15 @@ namespace nodetool
   }  
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::set_support_flags(p2p_connection_context& context, const uint32_t support_flags)
+  {
+    context.support_flags = support_flags;
+    // compressed payloads are only sent when both sides offer them
+    const uint32_t our_flags = m_network_zones.at(context.m_remote_address.get_zone()).m_config.m_support_flags;
+    context.m_levin_compression = (support_flags & our_flags & P2P_SUPPORT_FLAG_LEVIN_COMPRESSION) != 0;
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   int node_server<t_payload_net_handler>::handle_timed_sync(int command, typename COMMAND_TIMED_SYNC::request& arg, typename COMMAND_TIMED_SYNC::response& rsp, p2p_connection_context& context)
   {
     if(!m_payload_handler.process_payload_sync_data(arg.payload_data, context, false))
@@ -2586,7 +2704,7 @@ namespace nodetool
     context.m_in_timedsync = false;
     context.m_rpc_port = arg.node_data.rpc_port;
     context.m_rpc_credits_per_hash = arg.node_data.rpc_credits_per_hash;
-    context.support_flags = arg.node_data.support_flags;
+    set_support_flags(context, arg.node_data.support_flags);
 
     if(arg.node_data.my_port && zone.m_can_pingback)
     {
@@ -2621,9 +2739,9 @@ namespace nodetool
     }
     
     if (context.support_flags == 0)
-      try_get_support_flags(context, [](p2p_connection_context& flags_context, const uint32_t& support_flags) 
+      try_get_support_flags(context, [this](p2p_connection_context& flags_context, const uint32_t& support_flags)
       {
-        flags_context.support_flags = support_flags;
+        set_support_flags(flags_context, support_flags);
       });
 
     //fill response
@@ -3120,9 +3238,17 @@ namespace nodetool
   boost::optional<p2p_connection_context_t<typename t_payload_net_handler::connection_context>>
   node_server<t_payload_net_handler>::socks_connect(network_zone& zone, const epee::net_utils::network_address& remote, epee::net_utils::ssl_support_t ssl_support)
   {
-    auto result = socks_connect_internal(zone.m_net_server.get_stop_signal(), zone.m_net_server.get_io_context(), zone.m_proxy_address, remote);
+    const auto start = std::chrono::steady_clock::now();
+    boost::optional<boost::asio::ip::tcp::socket> result{};
+    if (zone.m_socks_pool)
+      result = zone.m_socks_pool->take(remote);
+    const bool pooled = bool(result);
+    if (!result)
+      result = socks_connect_internal(zone.m_net_server.get_stop_signal(), zone.m_net_server.get_io_context(), zone.m_proxy_address, remote);
     if (result) // if no error
     {
+      if (zone.m_socks_pool)
+        zone.m_socks_pool->record_latency(std::chrono::steady_clock::now() - start, pooled);
       p2p_connection_context context{};
       if (zone.m_net_server.add_connection(context, std::move(*result), remote, ssl_support))
         return {std::move(context)};
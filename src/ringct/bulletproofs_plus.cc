@@ -38,9 +38,11 @@
 //      in this code, taking on the roles of `H` and `G`, respectively. Read carefully!
 
 #include <stdlib.h>
+#include <exception>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include "misc_log_ex.h"
+#include "common/threadpool.h"
 #include "span.h"
 #include "cryptonote_config.h"
 extern "C"
@@ -69,6 +71,7 @@ namespace rct
 
     // Cached public generators
     static ge_p3 Hi_p3[maxN*maxM], Gi_p3[maxN*maxM];
+    static ge_p3 G_p3, H_p3;
     static std::shared_ptr<straus_cached_data> straus_HiGi_cache;
     static std::shared_ptr<pippenger_cached_data> pippenger_HiGi_cache;
 
@@ -88,14 +91,30 @@ namespace rct
     // Use the generator caches to compute a multiscalar multiplication
     static inline rct::key multiexp(const std::vector<MultiexpData> &data, size_t HiGi_size)
     {
+        const std::shared_ptr<multiexp_backend> backend = get_multiexp_backend();
+        if (backend && data.size() >= backend->min_size())
+        {
+            try
+            {
+                const ge_p3 result_p3 = backend->multiexp_p3(data);
+                rct::key result;
+                ge_p3_tobytes(result.bytes, &result_p3);
+                return result;
+            }
+            catch (const std::exception &e)
+            {
+                MERROR("Multiexp backend " << backend->name() << " failed, falling back to the CPU: " << e.what());
+            }
+        }
+
         if (HiGi_size > 0)
         {
             static_assert(232 <= STRAUS_SIZE_LIMIT, "Straus in precalc mode can only be calculated till STRAUS_SIZE_LIMIT");
-            return HiGi_size <= 232 && data.size() == HiGi_size ? straus(data, straus_HiGi_cache, 0) : pippenger(data, pippenger_HiGi_cache, HiGi_size, get_pippenger_c(data.size()));
+            return HiGi_size <= std::min<size_t>(get_straus_max_size(true), STRAUS_SIZE_LIMIT) && data.size() == HiGi_size ? straus(data, straus_HiGi_cache, 0) : pippenger(data, pippenger_HiGi_cache, HiGi_size, get_pippenger_c(data.size()));
         }
         else
         {
-            return data.size() <= 95 ? straus(data, NULL, 0) : pippenger(data, NULL, 0, get_pippenger_c(data.size()));
+            return data.size() <= get_straus_max_size(false) ? straus(data, NULL, 0) : pippenger(data, NULL, 0, get_pippenger_c(data.size()));
         }
     }
 
@@ -141,6 +160,10 @@ namespace rct
         straus_HiGi_cache = straus_init_cache(data, STRAUS_SIZE_LIMIT);
         pippenger_HiGi_cache = pippenger_init_cache(data, 0, PIPPENGER_SIZE_LIMIT);
 
+        // Fixed generators used by every inner-product round
+        CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&G_p3, rct::G.bytes) == 0, "ge_frombytes_vartime failed");
+        CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&H_p3, rct::H.bytes) == 0, "ge_frombytes_vartime failed");
+
         // Compute 2**64 - 1 for later use in simplifying verification
         TWO_SIXTY_FOUR_MINUS_ONE = TWO;
         for (size_t i = 0; i < 6; i++)
@@ -203,13 +226,9 @@ namespace rct
         }
 
         sc_mul(multiexp_data[2*size].scalar.bytes, c.bytes, INV_EIGHT.bytes);
-        ge_p3 H_p3;
-        ge_frombytes_vartime(&H_p3, rct::H.bytes);
         multiexp_data[2*size].point = H_p3;
 
         sc_mul(multiexp_data[2*size+1].scalar.bytes, d.bytes, INV_EIGHT.bytes);
-        ge_p3 G_p3;
-        ge_frombytes_vartime(&G_p3, rct::G.bytes);
         multiexp_data[2*size+1].point = G_p3;
 
         return multiexp(multiexp_data, 0);
@@ -553,7 +572,7 @@ namespace rct
             rct::key gamma8, sv8;
             sc_mul(gamma8.bytes, gamma[i].bytes, INV_EIGHT.bytes);
             sc_mul(sv8.bytes, sv[i].bytes, INV_EIGHT.bytes);
-            rct::addKeys2(V[i], gamma8, sv8, rct::H);
+            rct::addKeys_aGbH(V[i], gamma8, sv8);
         }
 
         // Decompose values
@@ -730,8 +749,6 @@ try_again:
         A1_data[1].point = Hprime[0];
 
         sc_mul(A1_data[2].scalar.bytes, d_.bytes, INV_EIGHT.bytes);
-        ge_p3 G_p3;
-        ge_frombytes_vartime(&G_p3, rct::G.bytes);
         A1_data[2].point = G_p3;
 
         sc_mul(temp.bytes, r.bytes, y.bytes);
@@ -740,8 +757,6 @@ try_again:
         sc_mul(temp2.bytes, temp2.bytes, aprime[0].bytes);
         sc_add(temp.bytes, temp.bytes, temp2.bytes);
         sc_mul(A1_data[3].scalar.bytes, temp.bytes, INV_EIGHT.bytes);
-        ge_p3 H_p3;
-        ge_frombytes_vartime(&H_p3, rct::H.bytes);
         A1_data[3].point = H_p3;
 
         rct::key A1 = multiexp(A1_data, 0);
@@ -751,7 +766,7 @@ try_again:
         sc_mul(temp.bytes, temp.bytes, INV_EIGHT.bytes);
         sc_mul(temp2.bytes, eta.bytes, INV_EIGHT.bytes);
         rct::key B;
-        rct::addKeys2(B, temp2, temp, rct::H);
+        rct::addKeys_aGbH(B, temp2, temp);
 
         rct::key e = transcript_update(transcript, A1, B);
         if (e == rct::zero())
@@ -788,6 +803,39 @@ try_again:
         return bulletproof_plus_PROVE(sv, gamma);
     }
 
+    // Construct several independent aggregate proofs, one per set of values, in parallel
+    std::vector<BulletproofPlus> bulletproof_plus_PROVE(const std::vector<std::vector<uint64_t>> &v, const std::vector<rct::keyV> &gamma)
+    {
+        CHECK_AND_ASSERT_THROW_MES(v.size() == gamma.size(), "Incompatible sizes of v and gamma");
+
+        // Generators are shared read-only by the workers once built
+        init_exponents();
+
+        std::vector<BulletproofPlus> proofs(v.size());
+        if (v.size() == 1)
+        {
+            proofs[0] = bulletproof_plus_PROVE(v[0], gamma[0]);
+            return proofs;
+        }
+
+        std::vector<std::exception_ptr> errors(v.size());
+        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+        tools::threadpool::waiter waiter(tpool);
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            tpool.submit(&waiter, [&, i] {
+                try { proofs[i] = bulletproof_plus_PROVE(v[i], gamma[i]); }
+                catch (...) { errors[i] = std::current_exception(); }
+            });
+        }
+        CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to wait for range proof workers");
+
+        for (const std::exception_ptr &e: errors)
+            if (e)
+                std::rethrow_exception(e);
+        return proofs;
+    }
+
     struct bp_plus_proof_data_t
     {
         rct::key y, z, e;
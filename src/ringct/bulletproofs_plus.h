@@ -40,6 +40,7 @@ BulletproofPlus bulletproof_plus_PROVE(const rct::key &v, const rct::key &gamma)
 BulletproofPlus bulletproof_plus_PROVE(uint64_t v, const rct::key &gamma);
 BulletproofPlus bulletproof_plus_PROVE(const rct::keyV &v, const rct::keyV &gamma);
 BulletproofPlus bulletproof_plus_PROVE(const std::vector<uint64_t> &v, const rct::keyV &gamma);
+std::vector<BulletproofPlus> bulletproof_plus_PROVE(const std::vector<std::vector<uint64_t>> &v, const std::vector<rct::keyV> &gamma);
 bool bulletproof_plus_VERIFY(const BulletproofPlus &proof);
 bool bulletproof_plus_VERIFY(const std::vector<const BulletproofPlus*> &proofs);
 bool bulletproof_plus_VERIFY(const std::vector<BulletproofPlus> &proofs);
@@ -29,8 +29,13 @@
 //
 // Adapted from Python code by Sarang Noether
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
 #include "misc_log_ex.h"
 #include "common/perf_timer.h"
+#include "common/threadpool.h"
 extern "C"
 {
 #include "crypto/crypto-ops.h"
@@ -46,6 +51,9 @@ extern "C"
 #define MULTIEXP_PERF(x)
 
 #define RAW_MEMORY_BLOCK
+
+#define THREADED_MULTIEXP_MIN_SIZE 4096 // points below which splitting a multiexp does not pay
+#define THREADED_MULTIEXP_MIN_CHUNK 1024 // points per range at least
 //#define ALTERNATE_LAYOUT
 //#define TRACK_STRAUS_ZERO_IDENTITY
 
@@ -577,6 +585,64 @@ size_t get_pippenger_c(size_t N)
   return 9;
 }
 
+// Time straus and pippenger on random data and return the largest sizes at which straus
+// is still the faster one. The defaults below are the crossovers from the tables above.
+multiexp_crossover multiexp_calibrate()
+{
+  static constexpr size_t max_size = 256;
+  static constexpr size_t step = 16;
+  static constexpr size_t cached_max_size = 232; // STRAUS_SIZE_LIMIT in bulletproofs
+
+  std::vector<MultiexpData> data(max_size);
+  for (MultiexpData &d: data)
+  {
+    d.scalar = rct::skGen();
+    ge_scalarmult_base(&d.point, rct::skGen().bytes);
+  }
+  const std::shared_ptr<straus_cached_data> straus_cache = straus_init_cache(data, cached_max_size);
+  const std::shared_ptr<pippenger_cached_data> pippenger_cache = pippenger_init_cache(data, 0, max_size);
+
+  const auto best_of = [](const std::function<void()> &f) {
+    auto best = std::chrono::steady_clock::duration::max();
+    for (int i = 0; i < 3; ++i)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      best = std::min(best, std::chrono::steady_clock::now() - start);
+    }
+    return best;
+  };
+  const auto crossover = [&](size_t limit, bool cached) {
+    size_t straus_max = step;
+    for (size_t N = step; ; N += step)
+    {
+      N = std::min(N, limit);
+      const std::vector<MultiexpData> subset(data.begin(), data.begin() + N);
+      const auto t_straus = best_of([&]{ straus(subset, cached ? straus_cache : NULL, 0); });
+      const auto t_pippenger = best_of([&]{ pippenger(subset, cached ? pippenger_cache : NULL, cached ? N : 0, get_pippenger_c(N)); });
+      if (t_pippenger < t_straus)
+        break;
+      straus_max = N;
+      if (N == limit)
+        break;
+    }
+    return straus_max;
+  };
+
+  multiexp_crossover res;
+  res.straus_max = crossover(max_size, false);
+  res.straus_cached_max = crossover(cached_max_size, true);
+  MINFO("Calibrated Straus/Pippenger crossover at " << res.straus_max << " points, " << res.straus_cached_max << " cached");
+  return res;
+}
+
+size_t get_straus_max_size(bool cached)
+{
+  // Calibration costs a fraction of a second, so it's only done on request
+  static const multiexp_crossover crossover = getenv("MONERO_MULTIEXP_CALIBRATE") ? multiexp_calibrate() : multiexp_crossover{95, 232};
+  return cached ? crossover.straus_cached_max : crossover.straus_max;
+}
+
 std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t start_offset, size_t N)
 {
   MULTIEXP_PERF(PERF_TIMER_START_UNIT(pippenger_init_cache, 1000000));
@@ -707,4 +773,85 @@ rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<
   return res;
 }
 
+static boost::mutex multiexp_backend_mutex;
+static std::shared_ptr<multiexp_backend> current_multiexp_backend;
+
+void set_multiexp_backend(std::shared_ptr<multiexp_backend> backend)
+{
+  boost::unique_lock<boost::mutex> lock(multiexp_backend_mutex);
+  current_multiexp_backend = std::move(backend);
+}
+
+std::shared_ptr<multiexp_backend> get_multiexp_backend()
+{
+  boost::unique_lock<boost::mutex> lock(multiexp_backend_mutex);
+  return current_multiexp_backend;
+}
+
+namespace
+{
+  class threaded_multiexp_backend: public multiexp_backend
+  {
+  public:
+    threaded_multiexp_backend(size_t threads): threads(threads) {}
+
+    const char *name() const override { return "threads"; }
+    size_t min_size() const override { return THREADED_MULTIEXP_MIN_SIZE; }
+
+    ge_p3 multiexp_p3(const std::vector<MultiexpData> &data) override
+    {
+      tools::threadpool &tpool = tools::threadpool::getInstanceForCompute();
+      const size_t chunks = std::min<size_t>(threads ? threads : tpool.get_max_concurrency(), data.size() / THREADED_MULTIEXP_MIN_CHUNK);
+      if (chunks <= 1)
+        return pippenger_p3(data);
+
+      // the sum of the multiexps of the ranges is the multiexp of the whole
+      std::vector<ge_p3> results(chunks);
+      std::vector<std::string> errors(chunks);
+      tools::threadpool::waiter waiter(tpool);
+      for (size_t i = 0; i < chunks; ++i)
+      {
+        tpool.submit(&waiter, [&data, &results, &errors, chunks, i]() {
+          try
+          {
+            const std::vector<MultiexpData> chunk(data.begin() + data.size() * i / chunks, data.begin() + data.size() * (i + 1) / chunks);
+            results[i] = pippenger_p3(chunk, NULL, 0, get_pippenger_c(chunk.size()));
+          }
+          catch (const std::exception &e)
+          {
+            errors[i] = e.what();
+          }
+        }, true);
+      }
+      CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to compute multiexp ranges");
+      for (const std::string &error: errors)
+        CHECK_AND_ASSERT_THROW_MES(error.empty(), "Failed to compute multiexp range: " << error);
+
+      ge_p3 result = results[0];
+      for (size_t i = 1; i < chunks; ++i)
+        add(result, results[i]);
+      return result;
+    }
+
+  private:
+    const size_t threads;
+  };
+}
+
+std::shared_ptr<multiexp_backend> make_threaded_multiexp_backend(size_t threads)
+{
+  return std::make_shared<threaded_multiexp_backend>(threads);
+}
+
+bool make_multiexp_backend(const std::string &name, std::shared_ptr<multiexp_backend> &backend)
+{
+  if (name == "cpu")
+    backend = nullptr;
+  else if (name == "threads")
+    backend = make_threaded_multiexp_backend();
+  else
+    return false;
+  return true;
+}
+
 }
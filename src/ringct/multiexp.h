@@ -34,6 +34,8 @@
 #ifndef MULTIEXP_H
 #define MULTIEXP_H
 
+#include <memory>
+#include <string>
 #include <vector>
 extern "C"
 {
@@ -72,9 +74,34 @@ rct::key straus(const std::vector<MultiexpData> &data, const std::shared_ptr<str
 std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t start_offset = 0, size_t N =0);
 size_t pippenger_get_cache_size(const std::shared_ptr<pippenger_cached_data> &cache);
 size_t get_pippenger_c(size_t N);
+struct multiexp_crossover
+{
+  size_t straus_max;        // largest size where Straus beats Pippenger
+  size_t straus_cached_max; // same, both using precomputed generator caches
+};
+multiexp_crossover multiexp_calibrate();
+size_t get_straus_max_size(bool cached);
 ge_p3 pippenger_p3(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache = NULL, size_t cache_size = 0, size_t c = 0);
 rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache = NULL, const size_t cache_size = 0, const size_t c = 0);
 
+// An implementation batch verification hands its largest multiexps to, eg on other
+// hardware. The functions above stay the reference, and are used whenever no backend
+// is set, the multiexp is smaller than min_size(), or the backend throws.
+class multiexp_backend
+{
+public:
+  virtual ~multiexp_backend() {}
+  virtual const char *name() const = 0;
+  virtual size_t min_size() const = 0;
+  virtual ge_p3 multiexp_p3(const std::vector<MultiexpData> &data) = 0;
+};
+void set_multiexp_backend(std::shared_ptr<multiexp_backend> backend);
+std::shared_ptr<multiexp_backend> get_multiexp_backend();
+// splits the multiexp in ranges computed by Pippenger on the compute threadpool, 0 threads meaning all of them
+std::shared_ptr<multiexp_backend> make_threaded_multiexp_backend(size_t threads = 0);
+// by name, "cpu" giving none
+bool make_multiexp_backend(const std::string &name, std::shared_ptr<multiexp_backend> &backend);
+
 }
 
 #endif
@@ -385,12 +385,25 @@ namespace rct {
     }
 
 
+    namespace {
+        struct precomp_table {
+            ge_precomp table[32][8];
+            explicit precomp_table(const ge_p3 &P) { ge_precomp_table_init(table, &P); }
+        };
+
+        //multiples of H laid out like ge_base, built once on first use
+        const precomp_table &get_H_table() {
+            static const precomp_table H_table(ge_p3_H);
+            return H_table;
+        }
+    }
+
     //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
     key scalarmultH(const key & a) {
-        ge_p2 R;
-        ge_scalarmult(&R, a.bytes, &ge_p3_H);
+        ge_p3 R;
+        ge_scalarmult_precomp(&R, a.bytes, get_H_table().table);
         key aP;
-        ge_tobytes(aP.bytes, &R);
+        ge_p3_tobytes(aP.bytes, &R);
         return aP;
     }
 
@@ -483,6 +496,20 @@ namespace rct {
         ge_tobytes(aGbB.bytes, &rv);
     }
 
+    //Computes aG + bH in constant time; unlike addKeys2 neither point needs decompressing
+    void addKeys_aGbH(key &aGbH, const key &a, const key &b) {
+        ge_p3 A, B;
+        ge_scalarmult_base(&A, a.bytes);
+        ge_scalarmult_precomp(&B, b.bytes, get_H_table().table);
+        ge_cached B2;
+        ge_p3_to_cached(&B2, &B);
+        ge_p1p1 R;
+        ge_add(&R, &A, &B2);
+        ge_p2 rv;
+        ge_p1p1_to_p2(&rv, &R);
+        ge_tobytes(aGbH.bytes, &rv);
+    }
+
     //Does some precomputation to make addKeys3 more efficient
     // input B a curve point and output a ge_dsmp which has precomputation applied
     void precomp(ge_dsmp rv, const key & B) {
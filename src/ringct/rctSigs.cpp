@@ -29,11 +29,14 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
 #include "misc_log_ex.h"
 #include "misc_language.h"
 #include "common/perf_timer.h"
 #include "common/threadpool.h"
 #include "common/util.h"
+#include "common/lru_cache.h"
 #include "crypto/generators.h"
 #include "rctSigs.h"
 #include "bulletproofs.h"
@@ -51,6 +54,86 @@ using namespace std;
 
 namespace
 {
+    // Outputs get picked as decoys by many transactions, and the tables built for a
+    // ring member in CLSAG verification only depend on its output key
+    struct ring_member_precomp
+    {
+        rct::geDsmp P;
+        rct::geDsmp hash;
+    };
+
+    constexpr size_t RING_MEMBER_PRECOMP_CACHE_SIZE = 8192; // 2.5 kB each
+
+    boost::mutex ring_member_precomp_mutex;
+    tools::lru_cache<crypto::public_key, ring_member_precomp> ring_member_precomp_cache(RING_MEMBER_PRECOMP_CACHE_SIZE);
+
+    // Decompressed ring member output keys and commitments, keyed by their compressed form so that they
+    // stay valid whatever happens to the chain. Also filled ahead of verification by cache_ring_member_points()
+    constexpr size_t DECOMPRESSED_POINT_CACHE_SIZE = 32768; // 160 B each
+
+    boost::mutex decompressed_point_mutex;
+    tools::lru_cache<crypto::public_key, ge_p3> decompressed_point_cache(DECOMPRESSED_POINT_CACHE_SIZE);
+
+    // Same as ge_frombytes_vartime, but returns false on failure
+    bool get_decompressed_point(const rct::key &k, ge_p3 &point)
+    {
+        const crypto::public_key pkey = rct::rct2pk(k);
+        {
+            boost::lock_guard<boost::mutex> lock(decompressed_point_mutex);
+            const ge_p3 *cached = decompressed_point_cache.get(pkey);
+            if (cached)
+            {
+                point = *cached;
+                return true;
+            }
+        }
+
+        if (ge_frombytes_vartime(&point, k.bytes) != 0)
+            return false;
+
+        boost::lock_guard<boost::mutex> lock(decompressed_point_mutex);
+        decompressed_point_cache.put(pkey, point);
+        return true;
+    }
+
+    // Sets P_precomp to the table for P and hash_precomp to the one for Hp(P)
+    void get_ring_member_precomp(const rct::key &P, rct::geDsmp &P_precomp, rct::geDsmp &hash_precomp)
+    {
+        const crypto::public_key pkey = rct::rct2pk(P);
+        {
+            boost::lock_guard<boost::mutex> lock(ring_member_precomp_mutex);
+            const ring_member_precomp *cached = ring_member_precomp_cache.get(pkey);
+            if (cached)
+            {
+                P_precomp = cached->P;
+                hash_precomp = cached->hash;
+                return;
+            }
+        }
+
+        ge_p3 P_p3;
+        CHECK_AND_ASSERT_THROW_MES(get_decompressed_point(P, P_p3), "point conv failed");
+        ge_dsm_precomp(P_precomp.k, &P_p3);
+        ge_p3 hash8_p3;
+        rct::hash_to_p3(hash8_p3, P);
+        ge_dsm_precomp(hash_precomp.k, &hash8_p3);
+
+        boost::lock_guard<boost::mutex> lock(ring_member_precomp_mutex);
+        ring_member_precomp_cache.put(pkey, {P_precomp, hash_precomp});
+    }
+
+    const rct::geDsmp &get_G_precomp()
+    {
+        static const rct::geDsmp G_precomp = []{ rct::geDsmp res; rct::precomp(res.k, rct::G); return res; }();
+        return G_precomp;
+    }
+
+    const rct::geDsmp &get_T_precomp()
+    {
+        static const rct::geDsmp T_precomp = []{ rct::geDsmp res; rct::precomp(res.k, rct::pk2rct(crypto::get_T())); return res; }();
+        return T_precomp;
+    }
+
     rct::Bulletproof make_dummy_bulletproof(const std::vector<uint64_t> &outamounts, rct::keyV &C, rct::keyV &masks)
     {
         const size_t n_outs = outamounts.size();
@@ -1164,7 +1247,6 @@ namespace rct {
             geDsmp P_precomp;
             geDsmp C_precomp;
             size_t i = 0;
-            ge_p3 hash8_p3;
             geDsmp hash_precomp;
             ge_p3 temp_p3;
             ge_p1p1 temp_p1;
@@ -1175,9 +1257,9 @@ namespace rct {
                 sc_mul(c_c.bytes,mu_C.bytes,c.bytes);
 
                 // Precompute points for L/R
-                precomp(P_precomp.k,pubs[i].dest);
+                get_ring_member_precomp(pubs[i].dest, P_precomp, hash_precomp);
 
-                CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&temp_p3, pubs[i].mask.bytes) == 0, false, "point conv failed");
+                CHECK_AND_ASSERT_MES(get_decompressed_point(pubs[i].mask, temp_p3), false, "point conv failed");
                 ge_sub(&temp_p1,&temp_p3,&C_offset_cached);
                 ge_p1p1_to_p3(&temp_p3,&temp_p1);
                 ge_dsm_precomp(C_precomp.k,&temp_p3);
@@ -1186,8 +1268,6 @@ namespace rct {
                 addKeys_aGbBcC(L,sig.s[i],c_p,P_precomp.k,c_c,C_precomp.k);
 
                 // Compute R
-                hash_to_p3(hash8_p3,pubs[i].dest);
-                ge_dsm_precomp(hash_precomp.k, &hash8_p3);
                 addKeys_aAbBcC(R,sig.s[i],hash_precomp.k,c_p,I_precomp.k,c_c,D_precomp.k);
 
                 c_to_hash[2*n+3] = L;
@@ -1281,7 +1361,6 @@ namespace rct {
             geDsmp P_precomp;
             geDsmp C_precomp;
             size_t i = 0;
-            ge_p3 hash8_p3;
             geDsmp hash_precomp;
             ge_p3 temp_p3;
             ge_p1p1 temp_p1;
@@ -1292,23 +1371,21 @@ namespace rct {
                 sc_mul(c_c.bytes,mu_C.bytes,c.bytes);
 
                 // Precompute points for L/R
-                precomp(P_precomp.k,pubs[i].dest);
+                get_ring_member_precomp(pubs[i].dest, P_precomp, hash_precomp);
 
-                CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&temp_p3, pubs[i].mask.bytes) == 0, false, "point conv failed");
+                CHECK_AND_ASSERT_MES(get_decompressed_point(pubs[i].mask, temp_p3), false, "point conv failed");
                 ge_sub(&temp_p1,&temp_p3,&C_offset_cached);
                 ge_p1p1_to_p3(&temp_p3,&temp_p1);
                 ge_dsm_precomp(C_precomp.k,&temp_p3);
 
                 // Compute L
                 key xGyT;
-                addKeys2(xGyT, sig.sx[i], sig.sy[i], rct::pk2rct(crypto::get_T()));
+                addKeys3(xGyT, sig.sx[i], get_G_precomp().k, sig.sy[i], get_T_precomp().k);
                 key temp_precomp;
                 addKeys3(temp_precomp, c_p, P_precomp.k, c_c, C_precomp.k);
                 L = addKeys(xGyT, temp_precomp);
 
                 // Compute R
-                hash_to_p3(hash8_p3,pubs[i].dest);
-                ge_dsm_precomp(hash_precomp.k, &hash8_p3);
                 addKeys_aAbBcC(R,sig.sx[i],hash_precomp.k,c_p,I_precomp.k,c_c,D_precomp.k);
 
                 c_to_hash[2*n+3] = L;
@@ -1325,6 +1402,30 @@ namespace rct {
         catch (...) { return false; }
     }
 
+    void cache_ring_member_points(const ctkeyV &members)
+    {
+        // don't let a large batch evict the entries it just added before they get used
+        const size_t n = std::min(members.size(), DECOMPRESSED_POINT_CACHE_SIZE / 2);
+        std::vector<std::pair<crypto::public_key, ge_p3>> points;
+        points.reserve(2 * n);
+        {
+            boost::lock_guard<boost::mutex> lock(decompressed_point_mutex);
+            for (size_t i = 0; i < n; ++i)
+                for (const key *k : {&members[i].dest, &members[i].mask})
+                    if (!decompressed_point_cache.get(rct2pk(*k)))
+                        points.emplace_back(rct2pk(*k), ge_p3{});
+        }
+
+        size_t n_valid = 0;
+        for (auto &point : points)
+            if (ge_frombytes_vartime(&point.second, (const unsigned char*)point.first.data) == 0)
+                points[n_valid++] = point;
+
+        boost::lock_guard<boost::mutex> lock(decompressed_point_mutex);
+        for (size_t i = 0; i < n_valid; ++i)
+            decompressed_point_cache.put(points[i].first, points[i].second);
+    }
+
 
     //These functions get keys from blockchain
     //replace these when connecting blockchain
@@ -1607,7 +1708,7 @@ namespace rct {
 
       // gen tclsags
       key full_message = get_pre_mlsag_hash(rv, hwdev);
-      for (size_t i = 0 ; i < inamounts.size(); i++)
+      const auto gen_tclsag = [&](size_t i)
       {
         if (hwdev.get_mode() == hw::device::TRANSACTION_CREATE_FAKE)
           rv.p.TCLSAGs[i] = make_dummy_tclsag(rv.mixRing[i].size());
@@ -1617,6 +1718,20 @@ namespace rct {
           CHECK_AND_ASSERT_THROW_MES(verRctTCLSAGSimple(full_message, rv.p.TCLSAGs[i], rv.mixRing[i], pseudoOuts[i]), "T-CLSAG verification failed");
 #endif
         }
+      };
+      // the inputs are signed independently, but a hardware device has to see them one at a time
+      if (inamounts.size() > 1 && hwdev.get_type() == hw::device::SOFTWARE)
+      {
+        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+        tools::threadpool::waiter waiter(tpool);
+        for (size_t i = 0 ; i < inamounts.size(); i++)
+          tpool.submit(&waiter, [&gen_tclsag, i]() { gen_tclsag(i); });
+        CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to generate T-CLSAGs");
+      }
+      else
+      {
+        for (size_t i = 0 ; i < inamounts.size(); i++)
+          gen_tclsag(i);
       }
     }
 
@@ -1707,6 +1822,13 @@ namespace rct {
             const bool plus = is_rct_bulletproof_plus(rv.type);
             size_t n_amounts = outamounts.size();
             size_t amounts_proved = 0;
+            const auto next_batch_size = [&](size_t proved) {
+                size_t batch_size = 1;
+                if (rct_config.range_proof_type == RangeProofMultiOutputBulletproof)
+                  while (batch_size * 2 + proved <= n_amounts && batch_size * 2 <= (plus ? BULLETPROOF_PLUS_MAX_OUTPUTS : BULLETPROOF_MAX_OUTPUTS))
+                    batch_size *= 2;
+                return batch_size;
+            };
             if (rct_config.range_proof_type == RangeProofPaddedBulletproof)
             {
                 rct::keyV C, masks;
@@ -1739,12 +1861,40 @@ namespace rct {
                     outSk[i].mask = masks[i];
                 }
             }
+            else if (plus && hwdev.get_mode() != hw::device::TRANSACTION_CREATE_FAKE)
+            {
+                // Masks come from the device in output order, then the independent proofs are built in parallel
+                std::vector<std::vector<uint64_t>> batch_amounts;
+                std::vector<keyV> batch_masks;
+                while (amounts_proved < n_amounts)
+                {
+                    const size_t batch_size = next_batch_size(amounts_proved);
+                    batch_amounts.emplace_back(outamounts.begin() + amounts_proved, outamounts.begin() + amounts_proved + batch_size);
+                    batch_masks.emplace_back(batch_size);
+                    for (i = 0; i < batch_size; ++i)
+                      batch_masks.back()[i] = hwdev.genCommitmentMask(amount_keys[i + amounts_proved]);
+                    amounts_proved += batch_size;
+                }
+                std::vector<BulletproofPlus> proofs = bulletproof_plus_PROVE(batch_amounts, batch_masks);
+                amounts_proved = 0;
+                for (size_t j = 0; j < proofs.size(); ++j)
+                {
+                    CHECK_AND_ASSERT_THROW_MES(proofs[j].V.size() == batch_amounts[j].size(), "V does not have the expected size");
+                #ifdef DBG
+                    CHECK_AND_ASSERT_THROW_MES(verBulletproofPlus(proofs[j]), "verBulletproofPlus failed on newly created proof");
+                #endif
+                    for (i = 0; i < batch_amounts[j].size(); ++i)
+                    {
+                      rv.outPk[i + amounts_proved].mask = rct::scalarmult8(proofs[j].V[i]);
+                      outSk[i + amounts_proved].mask = batch_masks[j][i];
+                    }
+                    amounts_proved += batch_amounts[j].size();
+                    rv.p.bulletproofs_plus.push_back(std::move(proofs[j]));
+                }
+            }
             else while (amounts_proved < n_amounts)
             {
-                size_t batch_size = 1;
-                if (rct_config.range_proof_type == RangeProofMultiOutputBulletproof)
-                  while (batch_size * 2 + amounts_proved <= n_amounts && batch_size * 2 <= (plus ? BULLETPROOF_PLUS_MAX_OUTPUTS : BULLETPROOF_MAX_OUTPUTS))
-                    batch_size *= 2;
+                const size_t batch_size = next_batch_size(amounts_proved);
                 rct::keyV C, masks;
                 std::vector<uint64_t> batch_amounts(batch_size);
                 for (i = 0; i < batch_size; ++i)
@@ -1961,12 +2111,14 @@ namespace rct {
 
     //ver RingCT simple
     //assumes only post-rct style inputs (at least for max anonymity)
-    bool verRctSemanticsSimple(const rctSig & rv, const uint64_t amount_burnt)
+    bool verRctSemanticsSimple(const std::vector<const rctSig*> & rvv, const std::vector<uint64_t> & amounts_burnt)
     {
       try
       {
         PERF_TIMER(verRctSemanticsSimple);
 
+        CHECK_AND_ASSERT_MES(amounts_burnt.empty() || amounts_burnt.size() == rvv.size(), false, "Mismatched sizes of rvv and amounts_burnt");
+
         tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
         tools::threadpool::waiter waiter(tpool);
         std::deque<bool> results;
@@ -1974,118 +2126,126 @@ namespace rct {
         std::vector<const BulletproofPlus*> bpp_proofs;
         size_t max_non_bp_proofs = 0, offset = 0;
 
-        CHECK_AND_ASSERT_MES(rv.type == RCTTypeSimple || rv.type == RCTTypeBulletproofPlus || rv.type == RCTTypeFullProofs || rv.type == RCTTypeSalviumZero || rv.type == RCTTypeSalviumOne,
-                             false, "verRctSemanticsSimple called on non simple rctSig");
-        if (rv.type == RCTTypeFullProofs || rv.type == RCTTypeSalviumZero || rv.type == RCTTypeSalviumOne)
-          CHECK_AND_ASSERT_MES(PRProof_Ver(rv.p_r, rv.salvium_data.pr_proof), false, "Invalid p_r commitment to difference");
-          
-        const bool bulletproof = is_rct_bulletproof(rv.type);
-        const bool bulletproof_plus = is_rct_bulletproof_plus(rv.type);
-        if (bulletproof || bulletproof_plus)
+        for (const rctSig *rvp: rvv)
         {
-          if (bulletproof_plus)
-            CHECK_AND_ASSERT_MES(rv.outPk.size() == n_bulletproof_plus_amounts(rv.p.bulletproofs_plus), false, "Mismatched sizes of outPk and bulletproofs_plus");
-          else
-            CHECK_AND_ASSERT_MES(rv.outPk.size() == n_bulletproof_amounts(rv.p.bulletproofs), false, "Mismatched sizes of outPk and bulletproofs");
-          if (is_rct_tclsag(rv.type))
+          CHECK_AND_ASSERT_MES(rvp, false, "rctSig pointer is NULL");
+          const rctSig &rv = *rvp;
+          CHECK_AND_ASSERT_MES(rv.type == RCTTypeSimple || rv.type == RCTTypeBulletproofPlus || rv.type == RCTTypeFullProofs || rv.type == RCTTypeSalviumZero || rv.type == RCTTypeSalviumOne,
+                               false, "verRctSemanticsSimple called on non simple rctSig");
+          if (rv.type == RCTTypeFullProofs || rv.type == RCTTypeSalviumZero || rv.type == RCTTypeSalviumOne)
+            CHECK_AND_ASSERT_MES(PRProof_Ver(rv.p_r, rv.salvium_data.pr_proof), false, "Invalid p_r commitment to difference");
+
+          const bool bulletproof = is_rct_bulletproof(rv.type);
+          const bool bulletproof_plus = is_rct_bulletproof_plus(rv.type);
+          if (bulletproof || bulletproof_plus)
           {
-            CHECK_AND_ASSERT_MES(rv.p.CLSAGs.empty(), false, "CLSAGs are not empty for TCLSAG");
-            CHECK_AND_ASSERT_MES(rv.p.MGs.empty(), false, "MGs are not empty for TCLSAG");
-            CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.p.TCLSAGs.size(), false, "Mismatched sizes of rv.p.pseudoOuts and rv.p.TCLSAGs");
-          }
-          else if (is_rct_clsag(rv.type))
-          {
-            CHECK_AND_ASSERT_MES(rv.p.TCLSAGs.empty(), false, "TCLSAGs are not empty for CLSAG");
-            CHECK_AND_ASSERT_MES(rv.p.MGs.empty(), false, "MGs are not empty for CLSAG");
-            CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.p.CLSAGs.size(), false, "Mismatched sizes of rv.p.pseudoOuts and rv.p.CLSAGs");
+            if (bulletproof_plus)
+              CHECK_AND_ASSERT_MES(rv.outPk.size() == n_bulletproof_plus_amounts(rv.p.bulletproofs_plus), false, "Mismatched sizes of outPk and bulletproofs_plus");
+            else
+              CHECK_AND_ASSERT_MES(rv.outPk.size() == n_bulletproof_amounts(rv.p.bulletproofs), false, "Mismatched sizes of outPk and bulletproofs");
+            if (is_rct_tclsag(rv.type))
+            {
+              CHECK_AND_ASSERT_MES(rv.p.CLSAGs.empty(), false, "CLSAGs are not empty for TCLSAG");
+              CHECK_AND_ASSERT_MES(rv.p.MGs.empty(), false, "MGs are not empty for TCLSAG");
+              CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.p.TCLSAGs.size(), false, "Mismatched sizes of rv.p.pseudoOuts and rv.p.TCLSAGs");
+            }
+            else if (is_rct_clsag(rv.type))
+            {
+              CHECK_AND_ASSERT_MES(rv.p.TCLSAGs.empty(), false, "TCLSAGs are not empty for CLSAG");
+              CHECK_AND_ASSERT_MES(rv.p.MGs.empty(), false, "MGs are not empty for CLSAG");
+              CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.p.CLSAGs.size(), false, "Mismatched sizes of rv.p.pseudoOuts and rv.p.CLSAGs");
+            }
+            else
+            {
+              CHECK_AND_ASSERT_MES(rv.p.CLSAGs.empty(), false, "CLSAGs are not empty for MLSAG");
+              CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.p.MGs.size(), false, "Mismatched sizes of rv.p.pseudoOuts and rv.p.MGs");
+            }
+            CHECK_AND_ASSERT_MES(rv.pseudoOuts.empty(), false, "rv.pseudoOuts is not empty");
           }
           else
           {
-            CHECK_AND_ASSERT_MES(rv.p.CLSAGs.empty(), false, "CLSAGs are not empty for MLSAG");
-            CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.p.MGs.size(), false, "Mismatched sizes of rv.p.pseudoOuts and rv.p.MGs");
+            CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.p.rangeSigs.size(), false, "Mismatched sizes of outPk and rv.p.rangeSigs");
+            CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.p.MGs.size(), false, "Mismatched sizes of rv.pseudoOuts and rv.p.MGs");
+            CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.empty(), false, "rv.p.pseudoOuts is not empty");
           }
-          CHECK_AND_ASSERT_MES(rv.pseudoOuts.empty(), false, "rv.pseudoOuts is not empty");
-        }
-        else
-        {
-          CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.p.rangeSigs.size(), false, "Mismatched sizes of outPk and rv.p.rangeSigs");
-          CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.p.MGs.size(), false, "Mismatched sizes of rv.pseudoOuts and rv.p.MGs");
-          CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.empty(), false, "rv.p.pseudoOuts is not empty");
-        }
-        CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.ecdhInfo.size(), false, "Mismatched sizes of outPk and rv.ecdhInfo");
+          CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.ecdhInfo.size(), false, "Mismatched sizes of outPk and rv.ecdhInfo");
 
-        if (!bulletproof && !bulletproof_plus)
-          max_non_bp_proofs += rv.p.rangeSigs.size();
+          if (!bulletproof && !bulletproof_plus)
+            max_non_bp_proofs += rv.p.rangeSigs.size();
+        }
 
         results.resize(max_non_bp_proofs);
-        
-        const keyV &pseudoOuts = bulletproof || bulletproof_plus ? rv.p.pseudoOuts : rv.pseudoOuts;
-        
-        rct::keyV masks(rv.outPk.size());
-        for (size_t i = 0; i < rv.outPk.size(); i++) {
-          masks[i] = rv.outPk[i].mask;
-        }
-        key sumOutpks = addKeys(masks);
-        DP(sumOutpks);
-        const key txnFeeKey = scalarmultH(d2h(rv.txnFee));
-        addKeys(sumOutpks, txnFeeKey, sumOutpks);
-        
-        const key txnAmountBurntKey = scalarmultH(d2h(amount_burnt));
-        addKeys(sumOutpks, txnAmountBurntKey, sumOutpks);
-        
-        // Account for the "blinding factor remainder" term `p_r`
-        addKeys(sumOutpks, rv.p_r, sumOutpks);
-        
-        key sumPseudoOuts = addKeys(pseudoOuts);
-        DP(sumPseudoOuts);
-        
-        //check pseudoOuts vs Outs..
-        if (!equalKeys(sumPseudoOuts, sumOutpks)) {
-          LOG_PRINT_L1("Sum check failed");
-          return false;
-        }
-        
-        if (bulletproof_plus)
-        {
-          for (size_t i = 0; i < rv.p.bulletproofs_plus.size(); i++)
-            bpp_proofs.push_back(&rv.p.bulletproofs_plus[i]);
-        }
-        else if (bulletproof)
+        for (size_t n = 0; n < rvv.size(); ++n)
         {
-          for (size_t i = 0; i < rv.p.bulletproofs.size(); i++)
-            bp_proofs.push_back(&rv.p.bulletproofs[i]);
-        }
-        else
-        {
-          for (size_t i = 0; i < rv.p.rangeSigs.size(); i++)
-            tpool.submit(&waiter, [&, i, offset] { results[i+offset] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]); });
-          offset += rv.p.rangeSigs.size();
+          const rctSig &rv = *rvv[n];
+          const uint64_t amount_burnt = amounts_burnt.empty() ? 0 : amounts_burnt[n];
+
+          const bool bulletproof = is_rct_bulletproof(rv.type);
+          const bool bulletproof_plus = is_rct_bulletproof_plus(rv.type);
+          const keyV &pseudoOuts = bulletproof || bulletproof_plus ? rv.p.pseudoOuts : rv.pseudoOuts;
+
+          rct::keyV masks(rv.outPk.size());
+          for (size_t i = 0; i < rv.outPk.size(); i++) {
+            masks[i] = rv.outPk[i].mask;
+          }
+          key sumOutpks = addKeys(masks);
+          DP(sumOutpks);
+          const key txnFeeKey = scalarmultH(d2h(rv.txnFee));
+          addKeys(sumOutpks, txnFeeKey, sumOutpks);
+
+          const key txnAmountBurntKey = scalarmultH(d2h(amount_burnt));
+          addKeys(sumOutpks, txnAmountBurntKey, sumOutpks);
+
+          // Account for the "blinding factor remainder" term `p_r`
+          addKeys(sumOutpks, rv.p_r, sumOutpks);
+
+          key sumPseudoOuts = addKeys(pseudoOuts);
+          DP(sumPseudoOuts);
+
+          //check pseudoOuts vs Outs..
+          if (!equalKeys(sumPseudoOuts, sumOutpks)) {
+            LOG_PRINT_L1("Sum check failed");
+            waiter.wait(); // queued range checks still reference rvv and results
+            return false;
+          }
+
+          if (bulletproof_plus)
+          {
+            for (size_t i = 0; i < rv.p.bulletproofs_plus.size(); i++)
+              bpp_proofs.push_back(&rv.p.bulletproofs_plus[i]);
+          }
+          else if (bulletproof)
+          {
+            for (size_t i = 0; i < rv.p.bulletproofs.size(); i++)
+              bp_proofs.push_back(&rv.p.bulletproofs[i]);
+          }
+          else
+          {
+            for (size_t i = 0; i < rv.p.rangeSigs.size(); i++)
+              tpool.submit(&waiter, [&, i, offset] { results[i+offset] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]); });
+            offset += rv.p.rangeSigs.size();
+          }
         }
 
+        if (!waiter.wait())
+          return false;
+        // all the range proofs of the batch go through a single multiexp
         if (!bpp_proofs.empty() && !verBulletproofPlus(bpp_proofs))
         {
           LOG_PRINT_L1("Aggregate range proof verified failed");
-          if (!waiter.wait())
-            return false;
           return false;
         }
         if (!bp_proofs.empty() && !verBulletproof(bp_proofs))
         {
           LOG_PRINT_L1("Aggregate range proof verified failed");
-          if (!waiter.wait())
-            return false;
           return false;
         }
-
-        if (!waiter.wait())
-          return false;
         for (size_t i = 0; i < results.size(); ++i) {
           if (!results[i]) {
             LOG_PRINT_L1("Range proof verified failed for proof " << i);
             return false;
           }
         }
-        
         return true;
       }
       // we can get deep throws from ge_frombytes_vartime if input isn't valid
@@ -2101,6 +2261,61 @@ namespace rct {
       }
     }
 
+    bool verRctSemanticsSimple(const rctSig & rv, const uint64_t amount_burnt)
+    {
+      return verRctSemanticsSimple(std::vector<const rctSig*>(1, &rv), std::vector<uint64_t>(1, amount_burnt));
+    }
+
+    namespace
+    {
+      // which ring signature an rctSig's inputs carry, resolved once per rctSig so the per input loop doesn't branch on it
+      enum class ring_sig_kind { mlsag, clsag, tclsag };
+
+      template <ring_sig_kind kind>
+      bool verRingSigSimple(const key &message, const rctSig &rv, size_t i, const key &pseudoOut);
+
+      template <>
+      bool verRingSigSimple<ring_sig_kind::mlsag>(const key &message, const rctSig &rv, size_t i, const key &pseudoOut)
+      {
+        return verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], pseudoOut);
+      }
+
+      template <>
+      bool verRingSigSimple<ring_sig_kind::clsag>(const key &message, const rctSig &rv, size_t i, const key &pseudoOut)
+      {
+        return verRctCLSAGSimple(message, rv.p.CLSAGs[i], rv.mixRing[i], pseudoOut);
+      }
+
+      template <>
+      bool verRingSigSimple<ring_sig_kind::tclsag>(const key &message, const rctSig &rv, size_t i, const key &pseudoOut)
+      {
+        return verRctTCLSAGSimple(message, rv.p.TCLSAGs[i], rv.mixRing[i], pseudoOut);
+      }
+
+      template <ring_sig_kind kind>
+      bool verRingSigsSimple(const key &message, const rctSig &rv, const keyV &pseudoOuts)
+      {
+        std::deque<bool> results(rv.mixRing.size());
+        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+        tools::threadpool::waiter waiter(tpool);
+        for (size_t i = 0 ; i < rv.mixRing.size() ; i++) {
+          tpool.submit(&waiter, [&, i] {
+              results[i] = verRingSigSimple<kind>(message, rv, i, pseudoOuts[i]);
+          });
+        }
+        if (!waiter.wait())
+          return false;
+
+        for (size_t i = 0; i < results.size(); ++i) {
+          if (!results[i]) {
+            LOG_PRINT_L1("verRctMGSimple/verRctCLSAGSimple failed for input " << i);
+            return false;
+          }
+        }
+        return true;
+      }
+    }
+
     //ver RingCT simple
     //assumes only post-rct style inputs (at least for max anonymity)
     bool verRctNonSemanticsSimple(const rctSig & rv) {
@@ -2118,37 +2333,19 @@ namespace rct {
         else
           CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.pseudoOuts and mixRing");
 
-        const size_t threads = std::max(rv.outPk.size(), rv.mixRing.size());
-
-        std::deque<bool> results(threads);
-        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
-        tools::threadpool::waiter waiter(tpool);
-
         const keyV &pseudoOuts = bulletproof || bulletproof_plus ? rv.p.pseudoOuts : rv.pseudoOuts;
 
         const key message = get_pre_mlsag_hash(rv, hw::get_device("default"));
-        
-        results.clear();
-        results.resize(rv.mixRing.size());
-        for (size_t i = 0 ; i < rv.mixRing.size() ; i++) {
-          tpool.submit(&waiter, [&, i] {
-              if (is_rct_tclsag(rv.type))
-                  results[i] = verRctTCLSAGSimple(message, rv.p.TCLSAGs[i], rv.mixRing[i], pseudoOuts[i]);
-              else if (is_rct_clsag(rv.type))
-                  results[i] = verRctCLSAGSimple(message, rv.p.CLSAGs[i], rv.mixRing[i], pseudoOuts[i]);
-              else
-                  results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
-          });
-        }
-        if (!waiter.wait())
-          return false;
 
-        for (size_t i = 0; i < results.size(); ++i) {
-          if (!results[i]) {
-            LOG_PRINT_L1("verRctMGSimple/verRctCLSAGSimple failed for input " << i);
-            return false;
-          }
-        }
+        bool ring_sigs_ok;
+        if (is_rct_tclsag(rv.type))
+          ring_sigs_ok = verRingSigsSimple<ring_sig_kind::tclsag>(message, rv, pseudoOuts);
+        else if (is_rct_clsag(rv.type))
+          ring_sigs_ok = verRingSigsSimple<ring_sig_kind::clsag>(message, rv, pseudoOuts);
+        else
+          ring_sigs_ok = verRingSigsSimple<ring_sig_kind::mlsag>(message, rv, pseudoOuts);
+        if (!ring_sigs_ok)
+          return false;
 
         bool audit = (rv.type == RCTTypeSalviumZero && rv.salvium_data.salvium_data_type == rct::SalviumZeroAudit);
         if (audit) {
@@ -88,6 +88,9 @@ namespace rct {
     tclsag TCLSAG_Gen(const key &message, const keyV & P, const key & x, const key & y, const keyV & C, const key & z, const keyV & C_nonzero, const key & C_offset, const unsigned int l, hw::device &hwdev);
     tclsag proveRctTCLSAGSimple(const key &message, const ctkeyV &pubs, const key &x, const key &y, const key &mask, const key &a, const key &Cout, unsigned int index, hw::device &hwdev);
     bool verRctTCLSAGSimple(const key &message, const tclsag &sig, const ctkeyV & pubs, const key & C_offset);
+    //Decompresses the output keys (dest) and commitments (mask) of outputs about to be used as ring members,
+    //  so that the CLSAG verifiers find them in their bounded cache. Points which fail to decompress are skipped
+    void cache_ring_member_points(const ctkeyV &members);
 
     zk_proof PRProof_Gen(const rct::key &difference);
     bool PRProof_Ver(const rct::key &C, const zk_proof &proof);
@@ -203,6 +206,7 @@ namespace rct {
     bool verRct(const rctSig & rv, bool semantics);
     static inline bool verRct(const rctSig & rv) { return verRct(rv, true) && verRct(rv, false); }
     bool verRctSemanticsSimple(const rctSig & rv, const uint64_t amount_burnt=0);
+    bool verRctSemanticsSimple(const std::vector<const rctSig*> & rv, const std::vector<uint64_t> & amounts_burnt);
     bool verRctNonSemanticsSimple(const rctSig & rv);
   static inline bool verRctSimple(const rctSig & rv, const uint64_t amount_burnt=0) { return verRctSemanticsSimple(rv, amount_burnt) && verRctNonSemanticsSimple(rv); }
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, key & mask, hw::device &hwdev);
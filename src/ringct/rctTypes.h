@@ -444,27 +444,20 @@ namespace rct {
           PREPARE_CUSTOM_VECTOR_SERIALIZATION(outputs, ecdhInfo);
           if (ecdhInfo.size() != outputs)
             return false;
+          // every type accepted above is a post RCTTypeBulletproof2 one, so no per output type check: we don't
+          // serialize the blinding factor, and only serialize the first 8 bytes of ecdhInfo[i].amount
           for (size_t i = 0; i < outputs; ++i)
           {
-            if (type == RCTTypeBulletproofPlus || type == RCTTypeFullProofs || type == RCTTypeSalviumZero || type == RCTTypeSalviumOne)
-            {
-              // Since RCTTypeBulletproof2 enote types, we don't serialize the blinding factor, and only serialize the
-              // first 8 bytes of ecdhInfo[i].amount
-              ar.begin_object();
-              crypto::hash8 trunc_amount; // placeholder variable needed to maintain "strict aliasing"
-              if (!typename Archive<W>::is_saving()) // loading
-                memset(ecdhInfo[i].amount.bytes, 0, sizeof(ecdhInfo[i].amount.bytes));
-              else // saving
-                memcpy(trunc_amount.data, ecdhInfo[i].amount.bytes, sizeof(trunc_amount));
-              FIELD_N("amount", trunc_amount);
-              if (!typename Archive<W>::is_saving()) // loading
-                memcpy(ecdhInfo[i].amount.bytes, trunc_amount.data, sizeof(trunc_amount));
-              ar.end_object();
-            }
-            else
-            {
-              FIELDS(ecdhInfo[i])
-            }
+            ar.begin_object();
+            crypto::hash8 trunc_amount; // placeholder variable needed to maintain "strict aliasing"
+            if (!typename Archive<W>::is_saving()) // loading
+              memset(ecdhInfo[i].amount.bytes, 0, sizeof(ecdhInfo[i].amount.bytes));
+            else // saving
+              memcpy(trunc_amount.data, ecdhInfo[i].amount.bytes, sizeof(trunc_amount));
+            FIELD_N("amount", trunc_amount);
+            if (!typename Archive<W>::is_saving()) // loading
+              memcpy(ecdhInfo[i].amount.bytes, trunc_amount.data, sizeof(trunc_amount));
+            ar.end_object();
             if (outputs - i > 1)
               ar.delimit_array();
           }
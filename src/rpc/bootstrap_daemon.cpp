@@ -2,7 +2,9 @@
 
 #include <stdexcept>
 
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "crypto/crypto.h"
 #include "cryptonote_core/cryptonote_core.h"
@@ -15,13 +17,26 @@
 namespace cryptonote
 {
 
+  constexpr const std::chrono::milliseconds bootstrap_daemon::hedge_delay;
+
+  struct bootstrap_daemon::race
+  {
+    boost::mutex lock;
+    boost::condition_variable cond;
+    size_t pending = 0;
+    int winner = -1;
+    std::string primary; //!< address of the first attempt, once connected
+  };
+
   bootstrap_daemon::bootstrap_daemon(
     std::function<std::map<std::string, bool>()> get_public_nodes,
     bool rpc_payment_enabled,
     const std::string &proxy)
-    : m_selector(new bootstrap_node::selector_auto(std::move(get_public_nodes)))
+    : m_slots{{std::make_shared<client_slot>(), std::make_shared<client_slot>()}}
     , m_rpc_payment_enabled(rpc_payment_enabled)
+    , m_selector(std::make_shared<shared_selector>())
   {
+    m_selector->selector.reset(new bootstrap_node::selector_auto(std::move(get_public_nodes)));
     set_proxy(proxy);
   }
 
@@ -30,11 +45,12 @@ namespace cryptonote
     boost::optional<epee::net_utils::http::login> credentials,
     bool rpc_payment_enabled,
     const std::string &proxy)
-    : m_selector(nullptr)
+    : m_slots{{std::make_shared<client_slot>(), std::make_shared<client_slot>()}}
     , m_rpc_payment_enabled(rpc_payment_enabled)
+    , m_selector(nullptr)
   {
     set_proxy(proxy);
-    if (!set_server(address, std::move(credentials)))
+    if (!set_server(*m_slots[0], address, std::move(credentials)))
     {
       throw std::runtime_error("invalid bootstrap daemon address or credentials");
     }
@@ -42,12 +58,8 @@ namespace cryptonote
 
   std::string bootstrap_daemon::address() const noexcept
   {
-    const auto& host = m_http_client.get_host();
-    if (host.empty())
-    {
-      return std::string();
-    }
-    return host + ":" + m_http_client.get_port();
+    const boost::unique_lock<boost::mutex> lock(m_slots[0]->address_lock);
+    return m_slots[0]->address;
   }
 
   boost::optional<std::pair<uint64_t, uint64_t>> bootstrap_daemon::get_height()
@@ -74,10 +86,13 @@ namespace cryptonote
     if (failed && m_selector)
     {
       const std::string current_address = address();
-      m_http_client.disconnect();
+      {
+        const boost::unique_lock<boost::mutex> lock(m_slots[0]->lock);
+        m_slots[0]->client.disconnect();
+      }
 
-      const boost::unique_lock<boost::mutex> lock(m_selector_mutex);
-      m_selector->handle_result(current_address, !failed);
+      const boost::unique_lock<boost::mutex> lock(m_selector->lock);
+      m_selector->selector->handle_result(current_address, !failed);
     }
 
     return success;
@@ -89,39 +104,164 @@ namespace cryptonote
     {
       throw std::runtime_error("invalid proxy address format");
     }
-    if (!m_http_client.set_proxy(address))
+    for (const std::shared_ptr<client_slot> &slot : m_slots)
+    {
+      const boost::unique_lock<boost::mutex> lock(slot->lock);
+      if (!slot->client.set_proxy(address))
+      {
+        throw std::runtime_error("failed to set proxy address");
+      }
+    }
+  }
+
+  int bootstrap_daemon::invoke_hedged(const attempt_fn &attempt)
+  {
+    if (!m_selector)
+    {
+      // a single fixed node, nothing to hedge with
+      client_slot &slot = *m_slots[0];
+      const boost::unique_lock<boost::mutex> lock(slot.lock);
+      if (!switch_server_if_needed(slot, nullptr))
+      {
+        return -1;
+      }
+      std::string status;
+      return attempt(0, slot.client, status) ? 0 : -1;
+    }
+
+    const auto state = std::make_shared<race>();
+    const auto start = [&](size_t index, boost::optional<bootstrap_node::node_info> node) {
+      {
+        const boost::unique_lock<boost::mutex> lock(state->lock);
+        ++state->pending;
+      }
+      try
+      {
+        boost::thread(&bootstrap_daemon::run_attempt, m_slots[index], m_selector, state, attempt, index, m_rpc_payment_enabled, std::move(node)).detach();
+      }
+      catch (const std::exception &e)
+      {
+        MERROR("Failed to start bootstrap daemon request: " << e.what());
+        const boost::unique_lock<boost::mutex> lock(state->lock);
+        --state->pending;
+      }
+    };
+
+    start(0, boost::none);
+
+    boost::unique_lock<boost::mutex> lock(state->lock);
+    const auto hedge_at = boost::chrono::steady_clock::now() + boost::chrono::milliseconds(hedge_delay.count());
+    while (state->winner < 0 && state->pending && state->cond.wait_until(lock, hedge_at) != boost::cv_status::timeout)
+      ;
+
+    if (state->winner < 0 && state->pending)
     {
-      throw std::runtime_error("failed to set proxy address");
+      const std::string primary = state->primary;
+      lock.unlock();
+      boost::optional<bootstrap_node::node_info> node;
+      {
+        const boost::unique_lock<boost::mutex> selector_lock(m_selector->lock);
+        node = m_selector->selector->next_hedge_node(primary);
+      }
+      if (node)
+      {
+        MDEBUG("Bootstrap daemon " << primary << " is slow, also asking " << node->address);
+        start(1, std::move(node));
+      }
+      lock.lock();
     }
+
+    while (state->winner < 0 && state->pending)
+      state->cond.wait(lock);
+    return state->winner;
   }
 
-  bool bootstrap_daemon::set_server(const std::string &address, const boost::optional<epee::net_utils::http::login> &credentials /* = boost::none */)
+  void bootstrap_daemon::run_attempt(std::shared_ptr<client_slot> slot, std::shared_ptr<shared_selector> selector, std::shared_ptr<race> state,
+    attempt_fn attempt, size_t index, bool rpc_payment_enabled, boost::optional<bootstrap_node::node_info> node)
   {
-    if (!m_http_client.set_server(address, credentials))
+    bool success = false;
+    try
+    {
+      const boost::unique_lock<boost::mutex> lock(slot->lock);
+      const bool ready = node ? set_server(*slot, node->address, node->credentials) : switch_server_if_needed(*slot, selector.get());
+      if (ready)
+      {
+        const std::string current_address = slot->client.get_host() + ":" + slot->client.get_port();
+        if (index == 0)
+        {
+          const boost::unique_lock<boost::mutex> state_lock(state->lock);
+          state->primary = current_address;
+        }
+        const auto started = std::chrono::steady_clock::now();
+
+        std::string status;
+        success = attempt(index, slot->client, status);
+        const bool failed = !success || (!rpc_payment_enabled && status == CORE_RPC_STATUS_PAYMENT_REQUIRED);
+        if (failed)
+        {
+          slot->client.disconnect();
+        }
+
+        const boost::unique_lock<boost::mutex> selector_lock(selector->lock);
+        selector->selector->handle_result(current_address, !failed);
+        if (!failed)
+        {
+          selector->selector->handle_latency(current_address,
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started));
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Bootstrap daemon request failed: " << e.what());
+      success = false;
+    }
+
+    const boost::unique_lock<boost::mutex> lock(state->lock);
+    --state->pending;
+    if (success && state->winner < 0)
+    {
+      state->winner = index;
+    }
+    state->cond.notify_all();
+  }
+
+  bool bootstrap_daemon::set_server(client_slot &slot, const std::string &address, const boost::optional<epee::net_utils::http::login> &credentials /* = boost::none */)
+  {
+    if (slot.client.get_host() + ":" + slot.client.get_port() == address && slot.client.is_connected())
+    {
+      return true;
+    }
+
+    if (!slot.client.set_server(address, credentials))
     {
       MERROR("Failed to set bootstrap daemon address " << address);
       return false;
     }
 
+    {
+      const boost::unique_lock<boost::mutex> lock(slot.address_lock);
+      slot.address = slot.client.get_host().empty() ? std::string() : slot.client.get_host() + ":" + slot.client.get_port();
+    }
     MINFO("Changed bootstrap daemon address to " << address);
     return true;
   }
 
 
-  bool bootstrap_daemon::switch_server_if_needed()
+  bool bootstrap_daemon::switch_server_if_needed(client_slot &slot, shared_selector *selector)
   {
-    if (m_http_client.is_connected() || !m_selector)
+    if (slot.client.is_connected() || !selector)
     {
       return true;
     }
 
     boost::optional<bootstrap_node::node_info> node;
     {
-      const boost::unique_lock<boost::mutex> lock(m_selector_mutex);
-      node = m_selector->next_node();
+      const boost::unique_lock<boost::mutex> lock(selector->lock);
+      node = selector->selector->next_node();
     }
     if (node) {
-      return set_server(node->address, node->credentials);
+      return set_server(slot, node->address, node->credentials);
     }
 
     return false;
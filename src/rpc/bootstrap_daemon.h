@@ -1,7 +1,10 @@
 #pragma  once
 
+#include <array>
+#include <chrono>
 #include <functional>
 #include <map>
+#include <memory>
 #include <utility>
 
 #include <boost/optional/optional.hpp>
@@ -16,9 +19,18 @@
 namespace cryptonote
 {
 
+  /*! Proxies RPC requests to a remote node.
+
+      With an automatically selected node, a request that has not been
+      answered after `hedge_delay` is also sent to a second node, and the
+      first successful response is used. Each attempt owns its client and a
+      copy of the request, so an abandoned attempt may finish in the
+      background. */
   class bootstrap_daemon
   {
   public:
+    static constexpr const std::chrono::milliseconds hedge_delay{1000};
+
     bootstrap_daemon(
       std::function<std::map<std::string, bool>()> get_public_nodes,
       bool rpc_payment_enabled,
@@ -36,55 +48,81 @@ namespace cryptonote
     template <class t_request, class t_response>
     bool invoke_http_json(const boost::string_ref uri, const t_request &out_struct, t_response &result_struct)
     {
-      if (!switch_server_if_needed())
-      {
-        return false;
-      }
-
-      const bool result = epee::net_utils::invoke_http_json(uri, out_struct, result_struct, m_http_client);
-      return handle_result(result, result_struct.status);
+      const std::string uri_copy(uri.begin(), uri.end());
+      return invoke([uri_copy, out_struct](net::http::client &client, t_response &res) {
+        return epee::net_utils::invoke_http_json(uri_copy, out_struct, res, client);
+      }, result_struct);
     }
 
     template <class t_request, class t_response>
     bool invoke_http_bin(const boost::string_ref uri, const t_request &out_struct, t_response &result_struct)
     {
-      if (!switch_server_if_needed())
-      {
-        return false;
-      }
-
-      const bool result = epee::net_utils::invoke_http_bin(uri, out_struct, result_struct, m_http_client);
-      return handle_result(result, result_struct.status);
+      const std::string uri_copy(uri.begin(), uri.end());
+      return invoke([uri_copy, out_struct](net::http::client &client, t_response &res) {
+        return epee::net_utils::invoke_http_bin(uri_copy, out_struct, res, client);
+      }, result_struct);
     }
 
     template <class t_request, class t_response>
     bool invoke_http_json_rpc(const boost::string_ref command_name, const t_request &out_struct, t_response &result_struct)
     {
-      if (!switch_server_if_needed())
+      const std::string command(command_name.begin(), command_name.end());
+      return invoke([command, out_struct](net::http::client &client, t_response &res) {
+        return epee::net_utils::invoke_http_json_rpc("/json_rpc", command, out_struct, res, client);
+      }, result_struct);
+    }
+
+    void set_proxy(const std::string &address);
+
+  private:
+    struct client_slot
+    {
+      boost::mutex lock; //!< held for the whole of an attempt
+      net::http::client client;
+      mutable boost::mutex address_lock; //!< so `address` can be read while an attempt runs
+      std::string address;
+    };
+
+    struct shared_selector
+    {
+      boost::mutex lock;
+      std::unique_ptr<bootstrap_node::selector> selector;
+    };
+
+    struct race;
+
+    //! Runs one attempt into response `index`, returning transport success and the response status.
+    typedef std::function<bool(size_t /* index */, net::http::client &, std::string & /* status */)> attempt_fn;
+
+    template <class t_response, class F>
+    bool invoke(F invoke_one, t_response &result_struct)
+    {
+      const auto responses = std::make_shared<std::array<t_response, 2>>();
+      const int winner = invoke_hedged([responses, invoke_one](size_t index, net::http::client &client, std::string &status) {
+        const bool result = invoke_one(client, (*responses)[index]);
+        status = (*responses)[index].status;
+        return result;
+      });
+      if (winner < 0)
       {
         return false;
       }
-
-      const bool result = epee::net_utils::invoke_http_json_rpc(
-        "/json_rpc",
-        std::string(command_name.begin(), command_name.end()),
-        out_struct,
-        result_struct,
-        m_http_client);
-      return handle_result(result, result_struct.status);
+      result_struct = std::move((*responses)[winner]);
+      return true;
     }
 
-    void set_proxy(const std::string &address);
+    //! \return Index of the attempt whose response should be used, or -1 if all failed.
+    int invoke_hedged(const attempt_fn &attempt);
 
-  private:
-    bool set_server(const std::string &address, const boost::optional<epee::net_utils::http::login> &credentials = boost::none);
-    bool switch_server_if_needed();
+    static void run_attempt(std::shared_ptr<client_slot> slot, std::shared_ptr<shared_selector> selector, std::shared_ptr<race> state,
+      attempt_fn attempt, size_t index, bool rpc_payment_enabled, boost::optional<bootstrap_node::node_info> node);
+    static bool set_server(client_slot &slot, const std::string &address, const boost::optional<epee::net_utils::http::login> &credentials = boost::none);
+    static bool switch_server_if_needed(client_slot &slot, shared_selector *selector);
 
   private:
-    net::http::client m_http_client;
+    const std::array<std::shared_ptr<client_slot>, 2> m_slots;
     const bool m_rpc_payment_enabled;
-    const std::unique_ptr<bootstrap_node::selector> m_selector;
-    boost::mutex m_selector_mutex;
+    const std::shared_ptr<shared_selector> m_selector;
   };
 
 }
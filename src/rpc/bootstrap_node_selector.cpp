@@ -48,6 +48,12 @@ namespace bootstrap_node
     }
   }
 
+  void selector_auto::node::handle_latency(std::chrono::milliseconds latency)
+  {
+    const uint64_t sample = std::max<int64_t>(1, latency.count());
+    latency_ms = latency_ms ? (latency_ms * 3 + sample) / 4 : sample;
+  }
+
   void selector_auto::handle_result(const std::string &address, bool success)
   {
     auto &nodes_by_address = m_nodes.get<by_address>();
@@ -60,6 +66,32 @@ namespace bootstrap_node
     }
   }
 
+  void selector_auto::handle_latency(const std::string &address, std::chrono::milliseconds latency)
+  {
+    auto &nodes_by_address = m_nodes.get<by_address>();
+    const auto it = nodes_by_address.find(address);
+    if (it != nodes_by_address.end())
+    {
+      nodes_by_address.modify(it, [latency](node &entry) {
+        entry.handle_latency(latency);
+      });
+    }
+  }
+
+  boost::optional<node_info> selector_auto::pick_faster(const candidates &nodes)
+  {
+    if (nodes.empty())
+    {
+      return {};
+    }
+
+    // two random choices, keeping the faster one; nodes not timed yet win so they get measured
+    const node *first = nodes[crypto::rand_idx(nodes.size())];
+    const node *second = nodes[crypto::rand_idx(nodes.size())];
+    const node *chosen = second->latency_ms < first->latency_ms ? second : first;
+    return {{chosen->address, {}}};
+  }
+
   boost::optional<node_info> selector_auto::next_node()
   {
     if (!has_at_least_one_good_node())
@@ -72,11 +104,30 @@ namespace bootstrap_node
       return {};
     }
 
-    auto node = m_nodes.get<by_fails>().begin();
-    const size_t count = std::distance(node, m_nodes.get<by_fails>().upper_bound(node->fails));
-    std::advance(node, crypto::rand_idx(count));
+    const auto &nodes_by_fails = m_nodes.get<by_fails>();
+    candidates least_failed;
+    for (auto it = nodes_by_fails.begin(); it != nodes_by_fails.upper_bound(nodes_by_fails.begin()->fails); ++it)
+    {
+      least_failed.push_back(std::addressof(*it));
+    }
+    return pick_faster(least_failed);
+  }
 
-    return {{node->address, {}}};
+  boost::optional<node_info> selector_auto::next_hedge_node(const std::string &primary)
+  {
+    candidates least_failed;
+    for (const node &entry : m_nodes.get<by_fails>())
+    {
+      if (!least_failed.empty() && entry.fails != least_failed.front()->fails)
+      {
+        break;
+      }
+      if (entry.address != primary)
+      {
+        least_failed.push_back(std::addressof(entry));
+      }
+    }
+    return pick_faster(least_failed);
   }
 
   bool selector_auto::has_at_least_one_good_node() const
@@ -93,7 +144,7 @@ namespace bootstrap_node
       const auto &address = node.first;
       const auto &white = node.second;
       const size_t initial_score = white ? 0 : 1;
-      updated |= m_nodes.get<by_address>().insert({address, initial_score}).second;
+      updated |= m_nodes.get<by_address>().insert({address, initial_score, 0}).second;
     }
 
     if (updated)
@@ -29,11 +29,13 @@
 
 #pragma  once
 
+#include <chrono>
 #include <functional>
 #include <limits>
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
@@ -59,6 +61,11 @@ namespace bootstrap_node
 
     virtual void handle_result(const std::string &address, bool success) = 0;
     virtual boost::optional<node_info> next_node() = 0;
+
+    //! Feedback on how long a successful request to `address` took.
+    virtual void handle_latency(const std::string &address, std::chrono::milliseconds latency) {}
+    //! A node other than `primary` to send a duplicate request to, if any.
+    virtual boost::optional<node_info> next_hedge_node(const std::string &primary) { return boost::none; }
   };
 
   class selector_auto : public selector
@@ -71,8 +78,14 @@ namespace bootstrap_node
 
     void handle_result(const std::string &address, bool success) final;
     boost::optional<node_info> next_node() final;
+    void handle_latency(const std::string &address, std::chrono::milliseconds latency) final;
+    boost::optional<node_info> next_hedge_node(const std::string &primary) final;
 
   private:
+    struct node;
+    typedef std::vector<const node *> candidates;
+
+    static boost::optional<node_info> pick_faster(const candidates &nodes);
     bool has_at_least_one_good_node() const;
     void append_new_nodes();
     void truncate();
@@ -82,8 +95,10 @@ namespace bootstrap_node
     {
       std::string address;
       size_t fails;
+      uint64_t latency_ms; // moving average of successful requests, 0 if none yet
 
       void handle_result(bool success);
+      void handle_latency(std::chrono::milliseconds latency);
     };
 
     struct by_address {};
@@ -41,7 +41,10 @@ using namespace epee;
 #include "common/download.h"
 #include "common/util.h"
 #include "common/perf_timer.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "int-util.h"
+#include "thread_placement.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
@@ -75,6 +78,15 @@ using namespace epee;
 #define RESTRICTED_TRANSACTIONS_COUNT 100
 #define RESTRICTED_SPENT_KEY_IMAGES_COUNT 5000
 #define RESTRICTED_BLOCK_COUNT 1000
+#define RESTRICTED_SUPPLY_SERIES_COUNT 1000
+#define RESTRICTED_TX_INDEX_COUNT 1000
+
+#define RESTRICTED_HEAVY_REQUEST_WAIT boost::chrono::seconds(10) // before answering busy
+
+#define GET_BLOCKS_CACHE_MAX_SIZE (128 * 1024 * 1024)
+#define BLOCK_HEADER_CACHE_SIZE 4096 // block headers kept for the header RPCs
+#define GET_INFO_SNAPSHOT_MAX_AGE std::chrono::seconds(1) // for the fields not tied to the chain or the pool
+#define GET_BLOCKS_CACHE_MIN_DEPTH 10
 
 #define RPC_TRACKER(rpc) \
   PERF_TIMER(rpc); \
@@ -121,6 +133,41 @@ namespace
   boost::mutex RPCTracker::mutex;
   std::unordered_map<std::string, RPCTracker::entry_t> RPCTracker::tracker;
 
+  // takes one of a limited number of slots for an expensive call, if limited,
+  // waiting a while for one to free up so concurrent wallets queue rather than fail
+  class heavy_request_slot
+  {
+  public:
+    heavy_request_slot(boost::mutex &lock, boost::condition_variable &cond, std::size_t &running, std::size_t max, bool limited):
+      lock(lock), cond(cond), running(running), acquired(!limited)
+    {
+      if (acquired)
+        return;
+      boost::unique_lock<boost::mutex> guard(lock);
+      acquired = cond.wait_for(guard, RESTRICTED_HEAVY_REQUEST_WAIT, [&]{ return running < max; });
+      if (acquired)
+        ++running;
+      held = acquired;
+    }
+    ~heavy_request_slot()
+    {
+      if (!held)
+        return;
+      {
+        boost::unique_lock<boost::mutex> guard(lock);
+        --running;
+      }
+      cond.notify_one();
+    }
+    explicit operator bool() const noexcept { return acquired; }
+  private:
+    boost::mutex &lock;
+    boost::condition_variable &cond;
+    std::size_t &running;
+    bool acquired;
+    bool held = false;
+  };
+
   void add_reason(std::string &reasons, const char *reason)
   {
     if (!reasons.empty())
@@ -144,6 +191,47 @@ namespace
   {
     store_128(difficulty, sdiff, swdiff, stop64);
   }
+
+  bool parse_light_wallet_account(cryptonote::network_type nettype, const std::string &address, const std::string &view_key, cryptonote::account_public_address &address_out, crypto::secret_key &view_key_out, std::string &status)
+  {
+    cryptonote::address_parse_info info;
+    if (!cryptonote::get_account_address_from_str(info, nettype, address) || info.is_subaddress)
+    {
+      status = "Invalid main address";
+      return false;
+    }
+    if (!epee::string_tools::hex_to_pod(view_key, view_key_out))
+    {
+      status = "Invalid view key";
+      return false;
+    }
+    address_out = info.address;
+    return true;
+  }
+
+  // Key a request is costed under: its URI, or the JSON-RPC method name, found
+  // without parsing the body since this runs before the request is admitted
+  std::string admission_method(const epee::net_utils::http::http_request_info &query_info)
+  {
+    if (query_info.m_URI != "/json_rpc")
+      return query_info.m_URI;
+    const std::string &body = query_info.m_body;
+    size_t pos = body.find("\"method\"");
+    if (pos == std::string::npos)
+      return query_info.m_URI;
+    pos = body.find_first_not_of(" \t\r\n", pos + 8);
+    if (pos == std::string::npos || body[pos] != ':')
+      return query_info.m_URI;
+    pos = body.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos || body[pos] != '"')
+      return query_info.m_URI;
+    const size_t start = ++pos;
+    while (pos < body.size() && pos - start < 64 && (std::isalnum((unsigned char)body[pos]) || body[pos] == '_'))
+      ++pos;
+    if (pos == start || pos == body.size() || body[pos] != '"')
+      return query_info.m_URI;
+    return "/json_rpc:" + body.substr(start, pos - start);
+  }
 }
 
 namespace cryptonote
@@ -167,6 +255,8 @@ namespace cryptonote
     command_line::add_arg(desc, arg_rpc_max_connections_per_private_ip);
     command_line::add_arg(desc, arg_rpc_max_connections);
     command_line::add_arg(desc, arg_rpc_response_soft_limit);
+    command_line::add_arg(desc, arg_rpc_restricted_cost_budget);
+    command_line::add_arg(desc, arg_rpc_restricted_max_heavy_requests);
   }
   //------------------------------------------------------------------------------------------------------------------------------
   core_rpc_server::core_rpc_server(
@@ -178,6 +268,13 @@ namespace cryptonote
     , m_was_bootstrap_ever_used(false)
     , disable_rpc_ban(false)
     , m_rpc_payment_allow_free_loopback(false)
+    , m_get_blocks_cache_size(0)
+    , m_get_blocks_cache_hits(0)
+    , m_get_blocks_cache_misses(0)
+    , m_block_header_cache(BLOCK_HEADER_CACHE_SIZE)
+    , m_heavy_requests(0)
+    , m_max_heavy_requests(server_threads - 1)
+    , m_heavy_requests_rejected(0)
   {}
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::set_bootstrap_daemon(
@@ -398,6 +495,13 @@ namespace cryptonote
     );
 
     m_net_server.get_config_object().m_max_content_length = MAX_RPC_CONTENT_LENGTH;
+    if (m_restricted)
+    {
+      m_admission.set_budget(std::chrono::milliseconds{command_line::get_arg(vm, arg_rpc_restricted_cost_budget)});
+      // by default keep one thread free for cheap calls
+      const std::size_t max_heavy_requests = command_line::get_arg(vm, arg_rpc_restricted_max_heavy_requests);
+      m_max_heavy_requests = max_heavy_requests ? max_heavy_requests : std::max<std::size_t>(1, server_threads - 1);
+    }
 
     if (store_ssl_key && inited)
     {
@@ -410,6 +514,58 @@ namespace cryptonote
     return inited;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context)
+  {
+    MINFO("HTTP [" << m_conn_context.m_remote_address.host_str() << "] " << query_info.m_http_method_str << " " << query_info.m_URI);
+    if (query_info.m_URI == "/json_rpc" && epee::json_rpc::is_batch(query_info.m_body))
+    {
+      // each call is admitted and costed under its own method, so a batch costs what its calls would separately
+      response.m_response_code = 200;
+      response.m_response_comment = "Ok";
+      return epee::json_rpc::handle_batch(query_info, response, [&](const epee::net_utils::http::http_request_info& call_query, epee::net_utils::http::http_response_info& call_response) {
+        return handle_http_request(call_query, call_response, m_conn_context);
+      });
+    }
+    const bool admission = m_admission.enabled() && !m_conn_context.m_remote_address.is_loopback();
+    const std::string method = admission_method(query_info);
+    if (admission && !m_admission.admit(m_conn_context.m_remote_address.host_str(), method))
+    {
+      static tools::metrics::counter &rejected = tools::metrics::get_counter("rpc_admission_rejected_total", "Requests refused by RPC admission control");
+      rejected.inc();
+      response.m_response_code = 429;
+      response.m_response_comment = "Too Many Requests";
+      return true;
+    }
+
+    response.m_response_code = 200;
+    response.m_response_comment = "Ok";
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+      tools::trace::span span(tools::trace::enabled() ? tools::trace::intern("rpc " + method) : nullptr);
+      if (!handle_http_request_map(query_info, response, m_conn_context))
+      {
+        response.m_response_code = 404;
+        response.m_response_comment = "Not found";
+      }
+    }
+    catch (const std::exception &e)
+    {
+      MERROR(m_conn_context << "Exception in handle_http_request_map: " << e.what());
+      response.m_response_code = 500;
+      response.m_response_comment = "Internal Server Error";
+    }
+    if (response.m_response_code != 404)
+    {
+      const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+      if (admission)
+        m_admission.record(method, elapsed);
+      tools::metrics::get_histogram("rpc_request_seconds", "Time taken by RPC handlers",
+        tools::metrics::label("method", method) + "," + tools::metrics::label("server", m_restricted ? "restricted" : "unrestricted")).observe(elapsed);
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::check_payment(const std::string &client_message, uint64_t payment, const std::string &rpc, bool same_ts, std::string &message, uint64_t &credits, std::string &top_hash)
   {
     if (m_rpc_payment == NULL)
@@ -475,6 +631,14 @@ namespace cryptonote
     return true;
   }
 #define CHECK_CORE_READY() do { if(!check_core_ready()){res.status =  CORE_RPC_STATUS_BUSY;return true;} } while(0)
+#define CHECK_HEAVY_REQUEST_SLOT() \
+  heavy_request_slot heavy_slot(m_heavy_requests_lock, m_heavy_requests_cond, m_heavy_requests, m_max_heavy_requests, m_restricted && ctx); \
+  if (!heavy_slot) \
+  { \
+    MDEBUG("Too many expensive requests running, " << ++m_heavy_requests_rejected << " rejected so far"); \
+    res.status = CORE_RPC_STATUS_BUSY; \
+    return true; \
+  }
 
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_height(const COMMAND_RPC_GET_HEIGHT::request& req, COMMAND_RPC_GET_HEIGHT::response& res, const connection_context *ctx)
@@ -516,22 +680,109 @@ namespace cryptonote
 
     const bool restricted = m_restricted && ctx;
 
+    // everything but the payment fields comes from the shared snapshot
+    const std::shared_ptr<const get_info_snapshot> snapshot = get_current_info_snapshot();
+    const uint64_t credits = res.credits;
+    std::string payment_top_hash = std::move(res.top_hash);
+    res = snapshot->info;
+    res.credits = credits;
+    res.top_hash = std::move(payment_top_hash);
+
+    if (restricted)
+    {
+      res.tx_pool_size = snapshot->public_tx_pool_size;
+      res.alt_blocks_count = 0;
+      res.outgoing_connections_count = 0;
+      res.incoming_connections_count = 0;
+      res.rpc_connections_count = 0;
+      res.white_peerlist_size = 0;
+      res.grey_peerlist_size = 0;
+      res.start_time = 0;
+      res.free_space = std::numeric_limits<uint64_t>::max();
+      res.height_without_bootstrap = 0;
+      res.bootstrap_daemon_address = "";
+      res.was_bootstrap_ever_used = false;
+      res.database_size = round_up(res.database_size, 5ull* 1024 * 1024 * 1024);
+      res.update_available = false;
+      res.version = "";
+      res.pricing_record_age = -1;
+      res.rct_ver_cache_hits = 0;
+      res.rct_ver_cache_misses = 0;
+      res.rct_ver_cache_evictions = 0;
+    }
+    else
+    {
+      boost::shared_lock<boost::shared_mutex> lock(m_bootstrap_daemon_mutex);
+      if (m_bootstrap_daemon.get() != nullptr)
+      {
+        res.bootstrap_daemon_address = m_bootstrap_daemon->address();
+      }
+      res.was_bootstrap_ever_used = m_was_bootstrap_ever_used;
+    }
+    res.restricted = restricted;
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<const core_rpc_server::get_info_snapshot> core_rpc_server::get_current_info_snapshot()
+  {
+    uint64_t top_height;
+    crypto::hash top_hash;
+    m_core.get_blockchain_top(top_height, top_hash);
+    const uint64_t pool_cookie = m_core.get_pool_cookie();
+    const auto is_current = [&](const std::shared_ptr<const get_info_snapshot> &snapshot) {
+      return snapshot && snapshot->top_hash == top_hash && snapshot->pool_cookie == pool_cookie
+          && std::chrono::steady_clock::now() - snapshot->built < GET_INFO_SNAPSHOT_MAX_AGE;
+    };
+
+    {
+      boost::unique_lock<boost::mutex> lock(m_get_info_snapshot_lock);
+      if (is_current(m_get_info_snapshot))
+        return m_get_info_snapshot;
+    }
+
+    boost::unique_lock<boost::mutex> build_lock(m_get_info_snapshot_build_lock);
+    {
+      boost::unique_lock<boost::mutex> lock(m_get_info_snapshot_lock);
+      if (is_current(m_get_info_snapshot))
+        return m_get_info_snapshot;
+    }
+    std::shared_ptr<const get_info_snapshot> snapshot = build_info_snapshot();
+    {
+      boost::unique_lock<boost::mutex> lock(m_get_info_snapshot_lock);
+      m_get_info_snapshot = snapshot;
+    }
+    return snapshot;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<const core_rpc_server::get_info_snapshot> core_rpc_server::build_info_snapshot()
+  {
+    PERF_TIMER(build_info_snapshot);
+    auto snapshot = std::make_shared<get_info_snapshot>();
+    snapshot->built = std::chrono::steady_clock::now();
+    // read before the fields, so a change while building makes the next request rebuild
+    snapshot->pool_cookie = m_core.get_pool_cookie();
+    COMMAND_RPC_GET_INFO::response &res = snapshot->info;
+
     crypto::hash top_hash;
     m_core.get_blockchain_top(res.height, top_hash);
+    snapshot->top_hash = top_hash;
     ++res.height; // turn top block height into blockchain height
     res.top_block_hash = string_tools::pod_to_hex(top_hash);
     res.target_height = m_p2p.get_payload_object().is_synchronized() ? 0 : m_core.get_target_blockchain_height();
     store_difficulty(m_core.get_blockchain_storage().get_difficulty_for_next_block(), res.difficulty, res.wide_difficulty, res.difficulty_top64);
     res.target = m_core.get_blockchain_storage().get_difficulty_target();
     res.tx_count = m_core.get_blockchain_storage().get_total_transactions() - res.height; //without coinbase
-    res.tx_pool_size = m_core.get_pool_transactions_count(!restricted);
-    res.alt_blocks_count = restricted ? 0 : m_core.get_blockchain_storage().get_alternative_blocks_count();
-    uint64_t total_conn = restricted ? 0 : m_p2p.get_public_connections_count();
-    res.outgoing_connections_count = restricted ? 0 : m_p2p.get_public_outgoing_connections_count();
-    res.incoming_connections_count = restricted ? 0 : (total_conn - res.outgoing_connections_count);
-    res.rpc_connections_count = restricted ? 0 : get_connections_count();
-    res.white_peerlist_size = restricted ? 0 : m_p2p.get_public_white_peers_count();
-    res.grey_peerlist_size = restricted ? 0 : m_p2p.get_public_gray_peers_count();
+    res.tx_pool_size = m_core.get_pool_transactions_count(true);
+    snapshot->public_tx_pool_size = m_core.get_pool_transactions_count(false);
+    res.alt_blocks_count = m_core.get_blockchain_storage().get_alternative_blocks_count();
+    uint64_t total_conn = m_p2p.get_public_connections_count();
+    res.outgoing_connections_count = m_p2p.get_public_outgoing_connections_count();
+    res.incoming_connections_count = total_conn - res.outgoing_connections_count;
+    res.rpc_connections_count = get_connections_count();
+    res.white_peerlist_size = m_p2p.get_public_white_peers_count();
+    res.grey_peerlist_size = m_p2p.get_public_gray_peers_count();
 
     cryptonote::network_type net_type = nettype();
     res.mainnet = net_type == MAINNET;
@@ -544,35 +795,26 @@ namespace cryptonote
     res.block_size_median = res.block_weight_median = m_core.get_blockchain_storage().get_current_cumulative_block_weight_median();
     res.adjusted_time = m_core.get_blockchain_storage().get_adjusted_time(res.height);
 
-    res.start_time = restricted ? 0 : (uint64_t)m_core.get_start_time();
-    res.free_space = restricted ? std::numeric_limits<uint64_t>::max() : m_core.get_free_space();
+    res.start_time = (uint64_t)m_core.get_start_time();
+    res.free_space = m_core.get_free_space();
     res.offline = m_core.offline();
-    res.height_without_bootstrap = restricted ? 0 : res.height;
-    if (restricted)
-    {
-      res.bootstrap_daemon_address = "";
-      res.was_bootstrap_ever_used = false;
-    }
-    else
-    {
-      boost::shared_lock<boost::shared_mutex> lock(m_bootstrap_daemon_mutex);
-      if (m_bootstrap_daemon.get() != nullptr)
-      {
-        res.bootstrap_daemon_address = m_bootstrap_daemon->address();
-      }
-      res.was_bootstrap_ever_used = m_was_bootstrap_ever_used;
-    }
+    res.height_without_bootstrap = res.height;
     res.database_size = m_core.get_blockchain_storage().get_db().get_database_size();
-    if (restricted)
-      res.database_size = round_up(res.database_size, 5ull* 1024 * 1024 * 1024);
-    res.update_available = restricted ? false : m_core.is_update_available();
-    res.version = restricted ? "" : MONERO_VERSION_FULL;
+    res.update_available = m_core.is_update_available();
+    res.version = MONERO_VERSION_FULL;
     res.synchronized = check_core_ready();
     res.busy_syncing = m_p2p.get_payload_object().is_busy_syncing();
-    res.restricted = restricted;
-
+    res.pricing_record_age = m_core.get_blockchain_storage().get_pricing_record_age();
+    res.txpool_validated = m_core.get_blockchain_storage().is_txpool_validated();
+    res.history_verification = m_core.is_verifying_history();
+    res.history_verified_height = m_core.get_history_verified_height();
+    res.history_verification_failed = m_core.has_history_verification_failed();
+    const rct_ver_cache_t::stats_t rct_ver_cache_stats = m_core.get_blockchain_storage().get_rct_ver_cache_stats();
+    res.rct_ver_cache_hits = rct_ver_cache_stats.hits;
+    res.rct_ver_cache_misses = rct_ver_cache_stats.misses;
+    res.rct_ver_cache_evictions = rct_ver_cache_stats.evictions;
     res.status = CORE_RPC_STATUS_OK;
-    return true;
+    return snapshot;
   }
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_net_stats(const COMMAND_RPC_GET_NET_STATS::request& req, COMMAND_RPC_GET_NET_STATS::response& res, const connection_context *ctx)
@@ -695,6 +937,10 @@ namespace cryptonote
 
     if (get_blocks)
     {
+      // the blocks and their output indices must come from the same chain, and
+      // find_blockchain_supplement takes the blockchain lock anyway
+      cryptonote::Blockchain::read_snapshot snapshot(m_core.get_blockchain_storage(), true);
+
       // quick check for noop
       if (!req.block_ids.empty())
       {
@@ -722,6 +968,25 @@ namespace cryptonote
           return true;
         }
       }
+      if (req.max_block_count && req.max_block_count < max_blocks)
+        max_blocks = req.max_block_count;
+
+      // wallets syncing from the same height ask for the same ranges, so ranges
+      // ending well below the top are kept and served again without the db
+      uint64_t cache_start_height = req.start_height;
+      const uint64_t chain_height = m_core.get_current_blockchain_height();
+      const bool cacheable = req.start_height > 0 ? req.start_height < chain_height :
+          m_core.get_blockchain_storage().find_blockchain_supplement(req.block_ids, cache_start_height);
+      const get_blocks_cache_key cache_key{cache_start_height, req.prune, req.no_miner_tx, max_blocks};
+      if (cacheable && get_cached_blocks(cache_key, res))
+      {
+        CHECK_PAYMENT_SAME_TS(req, res, res.blocks.size() * COST_PER_BLOCK);
+        res.start_height = cache_start_height;
+        res.current_height = chain_height;
+        MDEBUG("on_get_blocks: " << res.blocks.size() << " blocks from cache");
+        res.status = CORE_RPC_STATUS_OK;
+        return true;
+      }
 
       std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
       if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, !req.no_miner_tx, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
@@ -794,11 +1059,98 @@ namespace cryptonote
         }
       }
       MDEBUG("on_get_blocks: " << bs.size() << " blocks, " << ntxes << " txes, size " << size);
+
+      if (cacheable && !res.blocks.empty() && res.start_height == cache_start_height && res.start_height + res.blocks.size() + GET_BLOCKS_CACHE_MIN_DEPTH <= res.current_height)
+        add_cached_blocks(cache_key, res);
     }
 
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::get_cached_blocks(const get_blocks_cache_key &key, COMMAND_RPC_GET_BLOCKS_FAST::response &res)
+  {
+    boost::unique_lock<boost::mutex> lock(m_get_blocks_cache_lock);
+    auto it = m_get_blocks_cache.find(key);
+    // the range is only still valid if its last block is still on the main chain
+    if (it != m_get_blocks_cache.end() && m_core.get_block_id_by_height(std::get<0>(key) + it->second.blocks.size() - 1) != it->second.last_block_hash)
+    {
+      m_get_blocks_cache_size -= it->second.size;
+      m_get_blocks_cache.erase(it);
+      it = m_get_blocks_cache.end();
+    }
+    if (it == m_get_blocks_cache.end())
+    {
+      ++m_get_blocks_cache_misses;
+      return false;
+    }
+    ++m_get_blocks_cache_hits;
+    MDEBUG("getblocks cache hit at " << std::get<0>(key) << ", " << m_get_blocks_cache_hits << " hits, " << m_get_blocks_cache_misses << " misses");
+    res.blocks = it->second.blocks;
+    res.output_indices = it->second.output_indices;
+    res.asset_type_output_indices = it->second.asset_type_output_indices;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::add_cached_blocks(const get_blocks_cache_key &key, const COMMAND_RPC_GET_BLOCKS_FAST::response &res)
+  {
+    get_blocks_cache_entry entry;
+    entry.last_block_hash = m_core.get_block_id_by_height(res.start_height + res.blocks.size() - 1);
+    entry.size = 0;
+    for (const auto &b: res.blocks)
+    {
+      entry.size += b.block.size();
+      for (const auto &tx: b.txs)
+        entry.size += tx.blob.size();
+    }
+    for (const auto &i: res.output_indices)
+      for (const auto &tx: i.indices)
+        entry.size += tx.indices.size() * sizeof(uint64_t) * 2; // with the asset type indices
+    if (entry.size > GET_BLOCKS_CACHE_MAX_SIZE / 4)
+      return;
+    entry.blocks = res.blocks;
+    entry.output_indices = res.output_indices;
+    entry.asset_type_output_indices = res.asset_type_output_indices;
+
+    boost::unique_lock<boost::mutex> lock(m_get_blocks_cache_lock);
+    if (m_get_blocks_cache.find(key) != m_get_blocks_cache.end())
+      return;
+    while (m_get_blocks_cache_size + entry.size > GET_BLOCKS_CACHE_MAX_SIZE && !m_get_blocks_cache_order.empty())
+    {
+      auto it = m_get_blocks_cache.find(m_get_blocks_cache_order.front());
+      m_get_blocks_cache_order.pop_front();
+      if (it != m_get_blocks_cache.end())
+      {
+        m_get_blocks_cache_size -= it->second.size;
+        m_get_blocks_cache.erase(it);
+      }
+    }
+    m_get_blocks_cache_size += entry.size;
+    m_get_blocks_cache.emplace(key, std::move(entry));
+    m_get_blocks_cache_order.push_back(key);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::get_cached_block_header(uint64_t height, const crypto::hash &hash, block_header_response &response)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(m_block_header_cache_lock);
+      const block_header_cache_entry *entry = m_block_header_cache.get(height);
+      if (!entry || entry->hash != hash)
+        return false;
+      response = entry->header;
+    }
+    response.depth = m_core.get_current_blockchain_height() - height - 1;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::add_cached_block_header(const crypto::hash &hash, const block_header_response &response)
+  {
+    if (response.orphan_status || !response.pow_hash.empty())
+      return;
+    boost::unique_lock<boost::mutex> lock(m_block_header_cache_lock);
+    m_block_header_cache.put(response.height, {hash, response});
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
     bool core_rpc_server::on_get_alt_blocks_hashes(const COMMAND_RPC_GET_ALT_BLOCKS_HASHES::request& req, COMMAND_RPC_GET_ALT_BLOCKS_HASHES::response& res, const connection_context *ctx)
     {
       RPC_TRACKER(get_alt_blocks_hashes);
@@ -844,6 +1196,8 @@ namespace cryptonote
     res.blocks.clear();
     res.blocks.reserve(req.heights.size());
     CHECK_PAYMENT_MIN1(req, res, req.heights.size() * COST_PER_BLOCK, false);
+    // db reads only, so no blockchain lock is needed for all blocks to come from one snapshot
+    cryptonote::Blockchain::read_snapshot snapshot(m_core.get_blockchain_storage(), false);
     for (uint64_t height : req.heights)
     {
       block blk;
@@ -891,6 +1245,35 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_block_scan_records(const COMMAND_RPC_GET_BLOCK_SCAN_RECORDS::request& req, COMMAND_RPC_GET_BLOCK_SCAN_RECORDS::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(get_block_scan_records);
+    bool r;
+    if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_BLOCK_SCAN_RECORDS>(invoke_http_mode::BIN, "/get_block_scan_records.bin", req, res, r))
+      return r;
+
+    CHECK_PAYMENT(req, res, 1);
+
+    const size_t count = std::min<uint64_t>(req.count, COMMAND_RPC_GET_BLOCKS_FAST_MAX_BLOCK_COUNT);
+    res.start_height = req.start_height;
+    res.current_height = m_core.get_current_blockchain_height();
+    try
+    {
+      m_core.get_blockchain_storage().get_db().get_block_scan_record_blobs(req.start_height, count, res.records);
+    }
+    catch (const std::exception &e)
+    {
+      res.status = "Failed";
+      MERROR("Failed to get block scan records: " << e.what());
+      return true;
+    }
+
+    CHECK_PAYMENT_SAME_TS(req, res, res.records.size() * COST_PER_BLOCK_SCAN_RECORD);
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_outs_bin(const COMMAND_RPC_GET_OUTPUTS_BIN::request& req, COMMAND_RPC_GET_OUTPUTS_BIN::response& res, const connection_context *ctx)
   {
     RPC_TRACKER(get_outs_bin);
@@ -898,6 +1281,8 @@ namespace cryptonote
     if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_OUTPUTS_BIN>(invoke_http_mode::BIN, "/get_outs.bin", req, res, r))
       return r;
 
+    CHECK_HEAVY_REQUEST_SLOT();
+
     CHECK_PAYMENT_MIN1(req, res, req.outputs.size() * COST_PER_OUT, false);
 
     res.status = "Failed";
@@ -928,6 +1313,8 @@ namespace cryptonote
     if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_OUTPUTS>(invoke_http_mode::JON, "/get_outs", req, res, r))
       return r;
 
+    CHECK_HEAVY_REQUEST_SLOT();
+
     CHECK_PAYMENT_MIN1(req, res, req.outputs.size() * COST_PER_OUT, false);
 
     res.status = "Failed";
@@ -1287,35 +1674,17 @@ namespace cryptonote
     for (size_t n = 0; n < spent_status.size(); ++n)
       res.spent_status.push_back(spent_status[n] ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_BLOCKCHAIN : COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT);
 
-    // check the pool too
-    std::vector<cryptonote::tx_info> txs;
-    std::vector<cryptonote::spent_key_image_info> ki;
-    r = m_core.get_pool_transactions_and_spent_keys_info(txs, ki, !request_has_rpc_origin || !restricted);
-    if(!r)
+    // check the pool too, in one pass under its lock
+    std::vector<bool> pool_spent_status;
+    r = m_core.are_key_images_spent_in_pool(key_images, pool_spent_status, !request_has_rpc_origin || !restricted);
+    if(!r || pool_spent_status.size() != res.spent_status.size())
     {
       res.status = "Failed";
       return true;
     }
-    for (std::vector<cryptonote::spent_key_image_info>::const_iterator i = ki.begin(); i != ki.end(); ++i)
-    {
-      crypto::hash hash;
-      crypto::key_image spent_key_image;
-      if (parse_hash256(i->id_hash, hash))
-      {
-        memcpy(&spent_key_image, &hash, sizeof(hash)); // a bit dodgy, should be other parse functions somewhere
-        for (size_t n = 0; n < res.spent_status.size(); ++n)
-        {
-          if (res.spent_status[n] == COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT)
-          {
-            if (key_images[n] == spent_key_image)
-            {
-              res.spent_status[n] = COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
-              break;
-            }
-          }
-        }
-      }
-    }
+    for (size_t n = 0; n < res.spent_status.size(); ++n)
+      if (res.spent_status[n] == COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT && pool_spent_status[n])
+        res.spent_status[n] = COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
 
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -1361,14 +1730,12 @@ namespace cryptonote
     }
 
     uint64_t output_count = m_core.get_blockchain_storage().get_num_mature_outputs(req.source_asset_type);
-    bool ok = cryptonote::tx_sanity_check(tx_blob, output_count);
-    if (!ok) {
-      if (req.do_sanity_checks && !cryptonote::tx_sanity_check(tx_blob, output_count)) {
-        res.status = "Failed";
-        res.reason = "Sanity check failed";
-        res.sanity_check_failed = true;
-        return true;
-      }
+    if (!cryptonote::tx_sanity_check(tx_blob, output_count) && req.do_sanity_checks)
+    {
+      res.status = "Failed";
+      res.reason = "Sanity check failed";
+      res.sanity_check_failed = true;
+      return true;
     }
     res.sanity_check_failed = false;
 
@@ -1521,6 +1888,7 @@ namespace cryptonote
     res.block_target = DIFFICULTY_TARGET_V2;
     if ( lMiner.is_mining() ) {
       res.speed = lMiner.get_speed();
+      lMiner.get_speed_percentiles(res.speed_p10, res.speed_p50, res.speed_p90);
       res.threads_count = lMiner.get_threads_count();
       res.block_reward = lMiner.get_block_reward();
     }
@@ -1807,6 +2175,209 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_light_wallet_login(const tools::COMMAND_RPC_LOGIN::request& req, tools::COMMAND_RPC_LOGIN::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(light_wallet_login);
+    res.new_address = false;
+    light_wallet_scanner &scanner = m_core.get_light_wallet_scanner();
+    if (!scanner.is_running())
+    {
+      res.status = "Light wallet scanner is not enabled";
+      return true;
+    }
+
+    account_public_address address;
+    crypto::secret_key view_key;
+    if (!parse_light_wallet_account(nettype(), req.address, req.view_key, address, view_key, res.status))
+      return true;
+
+    if (!req.create_account)
+    {
+      std::vector<light_wallet_output> outputs;
+      uint64_t start_height, scanned_height;
+      if (!scanner.get_outputs(address, view_key, outputs, start_height, scanned_height))
+      {
+        res.status = "Account not registered";
+        return true;
+      }
+      res.status = CORE_RPC_STATUS_OK;
+      return true;
+    }
+
+    if (!scanner.add_account(address, view_key, res.new_address))
+    {
+      res.status = "Failed to register account";
+      res.reason = "The view key does not match the address, or the account limit was reached";
+      return true;
+    }
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_light_wallet_get_address_txs(const tools::COMMAND_RPC_GET_ADDRESS_TXS::request& req, tools::COMMAND_RPC_GET_ADDRESS_TXS::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(light_wallet_get_address_txs);
+    account_public_address address;
+    crypto::secret_key view_key;
+    if (!parse_light_wallet_account(nettype(), req.address, req.view_key, address, view_key, res.status))
+      return true;
+
+    std::vector<light_wallet_output> outputs;
+    uint64_t start_height, scanned_height;
+    if (!m_core.get_light_wallet_scanner().get_outputs(address, view_key, outputs, start_height, scanned_height))
+    {
+      res.status = "Account not registered";
+      return true;
+    }
+
+    // outputs are in chain order, so the outputs of a transaction are consecutive
+    res.total_received = 0;
+    for (const light_wallet_output &out : outputs)
+    {
+      if (res.transactions.empty() || res.transactions.back().hash != epee::string_tools::pod_to_hex(out.tx_hash))
+      {
+        res.transactions.emplace_back();
+        tools::COMMAND_RPC_GET_ADDRESS_TXS::transaction &tx = res.transactions.back();
+        tx.id = res.transactions.size() - 1;
+        tx.hash = epee::string_tools::pod_to_hex(out.tx_hash);
+        tx.timestamp = out.timestamp;
+        tx.total_received = 0;
+        tx.total_sent = 0;
+        tx.unlock_time = 0;
+        tx.height = out.height;
+        if (out.payment_id != carrot::null_payment_id)
+          tx.payment_id = epee::string_tools::pod_to_hex(out.payment_id);
+        tx.coinbase = out.coinbase;
+        tx.mempool = false;
+        tx.mixin = 0;
+      }
+      res.transactions.back().total_received += out.amount;
+      res.total_received += out.amount;
+    }
+
+    res.blockchain_height = m_core.get_current_blockchain_height();
+    res.scanned_height = scanned_height;
+    res.scanned_block_height = scanned_height;
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_light_wallet_get_unspent_outs(const tools::COMMAND_RPC_GET_UNSPENT_OUTS::request& req, tools::COMMAND_RPC_GET_UNSPENT_OUTS::response& res, const connection_context *ctx)
+  {
+    RPC_TRACKER(light_wallet_get_unspent_outs);
+    account_public_address address;
+    crypto::secret_key view_key;
+    if (!parse_light_wallet_account(nettype(), req.address, req.view_key, address, view_key, res.status))
+      return true;
+
+    uint64_t min_amount = 0;
+    if (!req.amount.empty() && !epee::string_tools::get_xtype_from_string(min_amount, req.amount))
+    {
+      res.status = "Invalid amount";
+      return true;
+    }
+
+    std::vector<light_wallet_output> outputs;
+    uint64_t start_height, scanned_height;
+    if (!m_core.get_light_wallet_scanner().get_outputs(address, view_key, outputs, start_height, scanned_height))
+    {
+      res.status = "Account not registered";
+      return true;
+    }
+
+    // an incoming view key cannot compute key images: every output found is reported, the wallet checks for spends
+    res.amount = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> indices;
+    crypto::hash indices_tx_hash = crypto::null_hash;
+    for (const light_wallet_output &out : outputs)
+    {
+      if (out.amount < min_amount)
+        continue;
+
+      if (out.tx_hash != indices_tx_hash)
+      {
+        indices.clear();
+        indices_tx_hash = out.tx_hash;
+        if (!m_core.get_tx_outputs_gindexs(out.tx_hash, indices))
+          indices.clear();
+      }
+      // a wrong global index would make the wallet build rings it cannot spend with, so fail rather than guess
+      if (out.local_output_index >= indices.size())
+      {
+        res.outputs.clear();
+        res.amount = 0;
+        res.status = "Failed to get output global indices for tx " + epee::string_tools::pod_to_hex(out.tx_hash);
+        return true;
+      }
+
+      res.outputs.emplace_back();
+      tools::COMMAND_RPC_GET_UNSPENT_OUTS::output &o = res.outputs.back();
+      o.amount = out.amount;
+      o.public_key = epee::string_tools::pod_to_hex(out.onetime_address);
+      o.index = out.local_output_index;
+      o.global_index = indices[out.local_output_index].first;
+      o.tx_hash = epee::string_tools::pod_to_hex(out.tx_hash);
+      o.timestamp = out.timestamp;
+      o.height = out.height;
+      res.amount += out.amount;
+    }
+
+    res.per_kb_fee = 0;
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_metrics(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, const connection_context *ctx)
+  {
+    if (m_restricted)
+      return false;
+
+    // point in time values are sampled on scrape, everything else is updated as it happens
+    uint64_t height;
+    crypto::hash top_hash;
+    m_core.get_blockchain_top(height, top_hash);
+    tools::metrics::get_gauge("chain_height", "Height of the main chain").set(height + 1);
+    tools::metrics::get_gauge("txpool_transactions", "Transactions in the pool").set(m_core.get_pool_transactions_count(true));
+    const uint64_t outgoing = m_p2p.get_public_outgoing_connections_count();
+    const uint64_t total = m_p2p.get_public_connections_count();
+    tools::metrics::get_gauge("p2p_connections", "Public P2P connections", tools::metrics::label("direction", "out")).set(outgoing);
+    tools::metrics::get_gauge("p2p_connections", "Public P2P connections", tools::metrics::label("direction", "in")).set(total - outgoing);
+    tools::metrics::get_gauge("rpc_connections", "RPC connections", tools::metrics::label("server", m_restricted ? "restricted" : "unrestricted")).set(get_connections_count());
+    uint64_t rx_main_hits, rx_secondary_hits, rx_secondary_misses;
+    crypto::rx_get_cache_stats(&rx_main_hits, &rx_secondary_hits, &rx_secondary_misses);
+    tools::metrics::get_gauge("randomx_cache_lookups", "RandomX hashes by cache used, misses reseed a secondary cache", tools::metrics::label("result", "main")).set(rx_main_hits);
+    tools::metrics::get_gauge("randomx_cache_lookups", "RandomX hashes by cache used, misses reseed a secondary cache", tools::metrics::label("result", "secondary")).set(rx_secondary_hits);
+    tools::metrics::get_gauge("randomx_cache_lookups", "RandomX hashes by cache used, misses reseed a secondary cache", tools::metrics::label("result", "miss")).set(rx_secondary_misses);
+    for (const epee::thread_placement::usage &u: epee::thread_placement::get_usage())
+    {
+      tools::metrics::get_gauge("thread_group_cpu_milliseconds", "CPU time used by each thread group", tools::metrics::label("group", u.group)).set(u.cpu_us / 1000);
+      tools::metrics::get_gauge("thread_group_threads", "Live threads in each thread group", tools::metrics::label("group", u.group)).set(u.threads);
+    }
+
+    response.m_body = tools::metrics::render();
+    response.m_mime_tipe = "text/plain; version=0.0.4";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_trace(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, const connection_context *ctx)
+  {
+    if (m_restricted)
+      return false;
+
+    // /trace?enable=1 starts recording, /trace?enable=0 stops it, /trace?clear=1 drops what was recorded
+    for (const auto &param: query_info.m_uri_content.m_query_params)
+    {
+      if (param.first == "enable")
+        tools::trace::enable(param.second == "1" || param.second == "true");
+      else if (param.first == "clear" && (param.second == "1" || param.second == "true"))
+        tools::trace::clear();
+    }
+
+    response.m_body = tools::trace::render();
+    response.m_mime_tipe = "application/json";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_getblockcount(const COMMAND_RPC_GETBLOCKCOUNT::request& req, COMMAND_RPC_GETBLOCKCOUNT::response& res, const connection_context *ctx)
   {
     RPC_TRACKER(getblockcount);
@@ -2053,8 +2624,9 @@ namespace cryptonote
     crypto::hash prev_id, seed_hash;
     difficulty_type difficulty;
 
-    std::vector<tx_block_template_backlog_entry> tx_backlog;
-    if (!m_core.get_miner_data(res.major_version, res.height, prev_id, seed_hash, difficulty, res.median_weight, res.already_generated_coins, tx_backlog))
+    // with since_backlog_version, tx_backlog only lists entries added or changed since then
+    tx_block_template_backlog_diff tx_backlog;
+    if (!m_core.get_miner_data(res.major_version, res.height, prev_id, seed_hash, difficulty, res.median_weight, res.already_generated_coins, req.since_backlog_version, tx_backlog))
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
       error_resp.message = "Internal error: failed to get miner data";
@@ -2063,13 +2635,20 @@ namespace cryptonote
     }
 
     res.tx_backlog.clear();
-    res.tx_backlog.reserve(tx_backlog.size());
+    res.tx_backlog.reserve(tx_backlog.changed.size());
 
-    for (const auto& entry : tx_backlog)
+    for (const auto& entry : tx_backlog.changed)
     {
       res.tx_backlog.emplace_back(COMMAND_RPC_GETMINERDATA::response::tx_backlog_entry{string_tools::pod_to_hex(entry.id), entry.weight, entry.fee});
     }
 
+    res.backlog_version = tx_backlog.version;
+    res.backlog_base_version = tx_backlog.base_version;
+    res.tx_backlog_removed.clear();
+    res.tx_backlog_removed.reserve(tx_backlog.removed.size());
+    for (const crypto::hash& id : tx_backlog.removed)
+      res.tx_backlog_removed.push_back(string_tools::pod_to_hex(id));
+
     res.prev_id = string_tools::pod_to_hex(prev_id);
     res.seed_hash = string_tools::pod_to_hex(seed_hash);
     res.difficulty = cryptonote::hex(difficulty);
@@ -2506,6 +3085,13 @@ namespace cryptonote
     uint64_t last_block_height;
     crypto::hash last_block_hash;
     m_core.get_blockchain_top(last_block_height, last_block_hash);
+    const bool restricted = m_restricted && ctx;
+    const bool fill_pow_hash = req.fill_pow_hash && !restricted;
+    if (!fill_pow_hash && get_cached_block_header(last_block_height, last_block_hash, res.block_header))
+    {
+      res.status = CORE_RPC_STATUS_OK;
+      return true;
+    }
     block last_block;
     bool have_last_block = m_core.get_block_by_hash(last_block_hash, last_block);
     if (!have_last_block)
@@ -2514,14 +3100,14 @@ namespace cryptonote
       error_resp.message = "Internal error: can't get last block.";
       return false;
     }
-    const bool restricted = m_restricted && ctx;
-    bool response_filled = fill_block_header_response(last_block, false, last_block_height, last_block_hash, res.block_header, req.fill_pow_hash && !restricted);
+    bool response_filled = fill_block_header_response(last_block, false, last_block_height, last_block_hash, res.block_header, fill_pow_hash);
     if (!response_filled)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
       error_resp.message = "Internal error: can't produce valid response.";
       return false;
     }
+    add_cached_block_header(last_block_hash, res.block_header);
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -2618,9 +3204,16 @@ namespace cryptonote
     }
 
     CHECK_PAYMENT_MIN1(req, res, (req.end_height - req.start_height + 1) * COST_PER_BLOCK_HEADER, false);
+    const bool fill_pow_hash = req.fill_pow_hash && !restricted;
     for (uint64_t h = req.start_height; h <= req.end_height; ++h)
     {
       crypto::hash block_hash = m_core.get_block_id_by_height(h);
+      block_header_response cached_header;
+      if (!fill_pow_hash && get_cached_block_header(h, block_hash, cached_header))
+      {
+        res.headers.push_back(std::move(cached_header));
+        continue;
+      }
       block blk;
       bool have_block = m_core.get_block_by_hash(block_hash, blk);
       if (!have_block)
@@ -2643,13 +3236,14 @@ namespace cryptonote
         return false;
       }
       res.headers.push_back(block_header_response());
-      bool response_filled = fill_block_header_response(blk, false, block_height, block_hash, res.headers.back(), req.fill_pow_hash && !restricted);
+      bool response_filled = fill_block_header_response(blk, false, block_height, block_hash, res.headers.back(), fill_pow_hash);
       if (!response_filled)
       {
         error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
         error_resp.message = "Internal error: can't produce valid response.";
         return false;
       }
+      add_cached_block_header(block_hash, res.headers.back());
     }
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -2670,6 +3264,13 @@ namespace cryptonote
     }
     CHECK_PAYMENT_MIN1(req, res, COST_PER_BLOCK_HEADER, false);
     crypto::hash block_hash = m_core.get_block_id_by_height(req.height);
+    const bool restricted = m_restricted && ctx;
+    const bool fill_pow_hash = req.fill_pow_hash && !restricted;
+    if (!fill_pow_hash && get_cached_block_header(req.height, block_hash, res.block_header))
+    {
+      res.status = CORE_RPC_STATUS_OK;
+      return true;
+    }
     block blk;
     bool have_block = m_core.get_block_by_hash(block_hash, blk);
     if (!have_block)
@@ -2678,14 +3279,14 @@ namespace cryptonote
       error_resp.message = "Internal error: can't get block by height. Height = " + std::to_string(req.height) + '.';
       return false;
     }
-    const bool restricted = m_restricted && ctx;
-    bool response_filled = fill_block_header_response(blk, false, req.height, block_hash, res.block_header, req.fill_pow_hash && !restricted);
+    bool response_filled = fill_block_header_response(blk, false, req.height, block_hash, res.block_header, fill_pow_hash);
     if (!response_filled)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
       error_resp.message = "Internal error: can't produce valid response.";
       return false;
     }
+    add_cached_block_header(block_hash, res.block_header);
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -2974,6 +3575,8 @@ namespace cryptonote
     if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_OUTPUT_HISTOGRAM>(invoke_http_mode::JON_RPC, "get_output_histogram", req, res, r))
       return r;
 
+    CHECK_HEAVY_REQUEST_SLOT();
+
     const bool restricted = m_restricted && ctx;
     size_t amounts = req.amounts.size();
     if (restricted && amounts == 0)
@@ -3041,9 +3644,12 @@ namespace cryptonote
       return true;
     }
     CHECK_PAYMENT_MIN1(req, res, COST_PER_COINBASE_TX_SUM_BLOCK * req.count, false);
-    std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t> amounts = m_core.get_coinbase_tx_sum(req.height, req.count);
+    std::vector<emission_totals_asset> assets;
+    std::pair<boost::multiprecision::uint128_t, boost::multiprecision::uint128_t> amounts = m_core.get_coinbase_tx_sum(req.height, req.count, &assets);
     store_128(amounts.first, res.emission_amount, res.wide_emission_amount, res.emission_amount_top64);
     store_128(amounts.second, res.fee_amount, res.wide_fee_amount, res.fee_amount_top64);
+    for (const auto &asset: assets)
+      res.asset_sums.push_back({asset.asset_type, asset.coinbase, asset.fees, asset.burnt, asset.protocol});
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -3066,9 +3672,13 @@ namespace cryptonote
   {
     CHECK_CORE_READY();
     PERF_TIMER(on_get_yield_info);
+    // The YBI cache is handed out as a view, so hold the blockchain lock while it is read
+    Blockchain &blockchain = m_core.get_blockchain_storage();
+    blockchain.lock();
+    auto unlocker = epee::misc_utils::create_scope_leave_handler([&blockchain](){ blockchain.unlock(); });
     uint64_t height = m_core.get_current_blockchain_height();
-    std::map<uint64_t, yield_block_info> ybi_cache;
-    if (!m_core.get_blockchain_storage().get_ybi_cache(ybi_cache)) {
+    epee::span<const yield_block_info> ybi_cache;
+    if (!blockchain.get_ybi_cache(ybi_cache)) {
       res.status = "failed to get YBI data from blockchain";
       return true;
     }
@@ -3078,44 +3688,181 @@ namespace cryptonote
     for (const auto& entry: ybi_cache) {
 
       // Check for last entry
-      if (entry.first == height - 1) {
-        res.total_staked = entry.second.locked_coins_tally;
-        if (entry.second.locked_coins_tally > 0) {
-          boost::multiprecision::uint128_t yield_per_stake = entry.second.slippage_total_this_block;
+      if (entry.block_height == height - 1) {
+        res.total_staked = entry.locked_coins_tally;
+        if (entry.locked_coins_tally > 0) {
+          boost::multiprecision::uint128_t yield_per_stake = entry.slippage_total_this_block;
           yield_per_stake *= COIN;
-          yield_per_stake /= entry.second.locked_coins_tally;
+          yield_per_stake /= entry.locked_coins_tally;
           res.yield_per_stake = yield_per_stake.convert_to<uint64_t>();
         }
       }
       
       // Skip this entry if out-of-range
-      if (req.from_height > 0 and entry.first < req.from_height) continue;
-      if (req.to_height > 0 and entry.first > req.to_height) continue;
+      if (req.from_height > 0 and entry.block_height < req.from_height) continue;
+      if (req.to_height > 0 and entry.block_height > req.to_height) continue;
 
       // Do we need to include raw data?
       if (req.include_raw_data) {
         
         // Clone the data into the response
         COMMAND_RPC_GET_YIELD_INFO::yield_data_t yd;
-        yd.block_height = entry.second.block_height;
-        yd.slippage_total_this_block = entry.second.slippage_total_this_block;
-        yd.locked_coins_this_block = entry.second.locked_coins_this_block;
-        yd.locked_coins_tally = entry.second.locked_coins_tally;
-        yd.network_health_percentage = entry.second.network_health_percentage;
+        yd.block_height = entry.block_height;
+        yd.slippage_total_this_block = entry.slippage_total_this_block;
+        yd.locked_coins_this_block = entry.locked_coins_this_block;
+        yd.locked_coins_tally = entry.locked_coins_tally;
+        yd.network_health_percentage = entry.network_health_percentage;
         res.yield_data.push_back(yd);
       }
       
       // Perform the aggregation
-      if (entry.second.locked_coins_tally == 0) {
-        res.total_burnt += entry.second.slippage_total_this_block;
+      if (entry.locked_coins_tally == 0) {
+        res.total_burnt += entry.slippage_total_this_block;
       } else {
-        res.total_yield += entry.second.slippage_total_this_block;
+        res.total_yield += entry.slippage_total_this_block;
       }
     }
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_supply_series(const COMMAND_RPC_GET_SUPPLY_SERIES::request& req, COMMAND_RPC_GET_SUPPLY_SERIES::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
+  {
+    CHECK_CORE_READY();
+    PERF_TIMER(on_get_supply_series);
+    supply_series_granularity granularity;
+    if (req.granularity == "block")
+      granularity = SUPPLY_SERIES_BLOCK;
+    else if (req.granularity == "hour")
+      granularity = SUPPLY_SERIES_HOUR;
+    else if (req.granularity == "day")
+      granularity = SUPPLY_SERIES_DAY;
+    else
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_WRONG_PARAM;
+      error_resp.message = "Invalid granularity, expected block, hour or day";
+      return false;
+    }
+
+    const bool restricted = m_restricted && ctx;
+    size_t max_count = req.limit ? req.limit : std::numeric_limits<size_t>::max();
+    if (restricted)
+      max_count = std::min<size_t>(max_count, RESTRICTED_SUPPLY_SERIES_COUNT);
+
+    res.height = m_core.get_current_blockchain_height();
+    const uint64_t to_height = req.to_height ? req.to_height : res.height - 1;
+    std::vector<supply_series_entry> entries;
+    m_core.get_blockchain_storage().get_db().get_supply_series(granularity, req.from_height, to_height, max_count, entries);
+
+    res.bucket_blocks = get_supply_series_bucket_blocks(granularity);
+    res.entries.reserve(entries.size());
+    for (const supply_series_entry &entry: entries)
+    {
+      res.entries.push_back({entry.first_height, entry.last_height, entry.first_timestamp, entry.last_timestamp,
+          entry.slippage_total, entry.yield_total, entry.burnt_total, entry.staked_total, entry.audit_total,
+          entry.locked_coins_tally, entry.network_health_percentage, {}});
+      for (const supply_series_asset &asset: entry.assets)
+        res.entries.back().assets.push_back({asset.asset_type, asset.circulating_supply, asset.spot_price, asset.ma_price});
+    }
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_txs_by_type(const COMMAND_RPC_GET_TXS_BY_TYPE::request& req, COMMAND_RPC_GET_TXS_BY_TYPE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
+  {
+    CHECK_CORE_READY();
+    PERF_TIMER(on_get_txs_by_type);
+    const BlockchainDB &db = m_core.get_blockchain_storage().get_db();
+    if (!db.get_tx_index_height(res.index_height))
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_UNSUPPORTED_RPC;
+      error_resp.message = "The tx index is not kept, start the daemon with --db-tx-index";
+      return false;
+    }
+
+    const bool restricted = m_restricted && ctx;
+    size_t max_count = req.limit ? req.limit : std::numeric_limits<size_t>::max();
+    if (restricted)
+      max_count = std::min<size_t>(max_count, RESTRICTED_TX_INDEX_COUNT);
+
+    res.height = m_core.get_current_blockchain_height();
+    const uint64_t to_height = req.to_height ? req.to_height : res.height - 1;
+    std::vector<tx_index_entry> entries;
+    db.get_txs_by_type(req.tx_type, req.from_height, req.from_tx_id, to_height, max_count, entries);
+
+    res.entries.reserve(entries.size());
+    for (const tx_index_entry &entry: entries)
+      res.entries.push_back({entry.height, entry.tx_id, epee::string_tools::pod_to_hex(entry.tx_hash)});
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_outputs_by_asset_type(const COMMAND_RPC_GET_OUTPUTS_BY_ASSET_TYPE::request& req, COMMAND_RPC_GET_OUTPUTS_BY_ASSET_TYPE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
+  {
+    CHECK_CORE_READY();
+    PERF_TIMER(on_get_outputs_by_asset_type);
+    const BlockchainDB &db = m_core.get_blockchain_storage().get_db();
+    if (!db.get_tx_index_height(res.index_height))
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_UNSUPPORTED_RPC;
+      error_resp.message = "The tx index is not kept, start the daemon with --db-tx-index";
+      return false;
+    }
+
+    const bool restricted = m_restricted && ctx;
+    size_t max_count = req.limit ? req.limit : std::numeric_limits<size_t>::max();
+    if (restricted)
+      max_count = std::min<size_t>(max_count, RESTRICTED_TX_INDEX_COUNT);
+
+    res.height = m_core.get_current_blockchain_height();
+    const uint64_t to_height = req.to_height ? req.to_height : res.height - 1;
+    std::vector<output_index_entry> entries;
+    db.get_outputs_by_asset_type(req.asset_type, req.from_height, req.from_output_id, to_height, max_count, entries);
+
+    res.entries.reserve(entries.size());
+    for (const output_index_entry &entry: entries)
+      res.entries.push_back({entry.height, entry.output_id, entry.asset_type_output_index});
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_block_processing_stats(const COMMAND_RPC_GET_BLOCK_PROCESSING_STATS::request& req, COMMAND_RPC_GET_BLOCK_PROCESSING_STATS::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
+  {
+    PERF_TIMER(on_get_block_processing_stats);
+    const std::vector<block_processing_stats> stats = m_core.get_blockchain_storage().get_block_processing_stats(req.count);
+    res.entries.reserve(stats.size());
+    for (const block_processing_stats &s: stats)
+    {
+      res.entries.push_back({s.height, epee::string_tools::pod_to_hex(s.id), s.timestamp, s.n_txs,
+          s.difficulty_us, s.pow_us, s.tx_inputs_us, s.rct_batch_us, s.miner_tx_us, s.protocol_tx_us,
+          s.payouts_us, s.db_add_us, s.ybi_us, s.total_us});
+    }
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_memory_stats(const COMMAND_RPC_GET_MEMORY_STATS::request& req, COMMAND_RPC_GET_MEMORY_STATS::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
+  {
+    PERF_TIMER(on_get_memory_stats);
+    res.txpool_weight = m_core.get_pool_weight();
+    res.txpool_count = m_core.get_pool_transactions_count(true);
+
+    const Blockchain::cache_memory_usage caches = m_core.get_blockchain_storage().get_cache_memory_usage();
+    res.rct_ver_cache_bytes = caches.rct_ver_cache;
+    res.ybi_cache_bytes = caches.ybi_cache;
+    res.output_distribution_cache_bytes = caches.output_distribution_cache;
+    res.block_height_index_bytes = caches.block_height_index;
+    res.block_stats_bytes = caches.block_stats;
+    res.block_queue_bytes = m_p2p.get_payload_object().get_block_queue().get_data_size();
+    crypto::rx_get_memory_usage(&res.randomx_dataset_bytes, &res.randomx_cache_bytes);
+
+    // walking the page cache status of the whole map takes a while on a large db
+    res.db_size = m_core.get_blockchain_storage().get_db().get_database_size();
+    res.db_resident_bytes = req.include_db_resident ? m_core.get_blockchain_storage().get_db().get_database_resident_size() : 0;
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_base_fee_estimate(const COMMAND_RPC_GET_BASE_FEE_ESTIMATE::request& req, COMMAND_RPC_GET_BASE_FEE_ESTIMATE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
   {
     RPC_TRACKER(get_base_fee_estimate);
@@ -3133,6 +3880,46 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_chain_state(const COMMAND_RPC_GET_CHAIN_STATE::request& req, COMMAND_RPC_GET_CHAIN_STATE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
+  {
+    RPC_TRACKER(get_chain_state);
+    bool r;
+    if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_CHAIN_STATE>(invoke_http_mode::JON_RPC, "get_chain_state", req, res, r))
+      return r;
+
+    CHECK_PAYMENT(req, res, COST_PER_CHAIN_STATE);
+
+    Blockchain &blockchain = m_core.get_blockchain_storage();
+    crypto::hash top_hash;
+    uint64_t top_height;
+    m_core.get_blockchain_top(top_height, top_hash);
+    res.height = top_height + 1;
+    res.top_block_hash = string_tools::pod_to_hex(top_hash);
+    res.target_height = m_p2p.get_payload_object().is_synchronized() ? 0 : m_core.get_target_blockchain_height();
+    res.block_weight_limit = blockchain.get_current_cumulative_block_weight_limit();
+    res.adjusted_time = blockchain.get_adjusted_time(res.height);
+    res.hard_fork_version = blockchain.get_current_hard_fork_version();
+    blockchain.get_dynamic_base_fee_estimate_2021_scaling(req.grace_blocks, res.fees);
+    res.fee = res.fees[0];
+    res.quantization_mask = Blockchain::get_fee_quantization_mask();
+    try
+    {
+      res.pricing_record = blockchain.get_db().get_block_from_height(top_height).pricing_record;
+    }
+    catch (const std::exception &e)
+    {
+      res.status = "Failed to get top block";
+      return true;
+    }
+    if (req.include_supply)
+    {
+      for (const auto &i: blockchain.get_db().get_circulating_supply())
+        res.supply_tally.push_back(COMMAND_RPC_GET_SUPPLY_INFO::supply_entry(i.first, std::to_string(i.second)));
+    }
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_alternate_chains(const COMMAND_RPC_GET_ALTERNATE_CHAINS::request& req, COMMAND_RPC_GET_ALTERNATE_CHAINS::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx)
   {
     RPC_TRACKER(get_alternate_chains);
@@ -3416,6 +4203,9 @@ namespace cryptonote
     ++res.height; // turn top block height into blockchain height
     res.target_height = m_p2p.get_payload_object().is_synchronized() ? 0 : m_core.get_target_blockchain_height();
     res.next_needed_pruning_seed = m_p2p.get_payload_object().get_next_needed_pruning_stripe().second;
+    res.history_verification = m_core.is_verifying_history();
+    res.history_verified_height = m_core.get_history_verified_height();
+    res.history_verification_failed = m_core.has_history_verification_failed();
 
     for (const auto &c: m_p2p.get_payload_object().get_connections())
       res.peers.push_back({c});
@@ -3459,6 +4249,8 @@ namespace cryptonote
     if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_OUTPUT_DISTRIBUTION>(invoke_http_mode::JON_RPC, "get_output_distribution", req, res, r))
       return r;
 
+    CHECK_HEAVY_REQUEST_SLOT();
+
     const bool restricted = m_restricted && ctx;
     if (restricted && req.amounts != std::vector<uint64_t>(1, 0))
     {
@@ -3509,6 +4301,8 @@ namespace cryptonote
     if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_OUTPUT_DISTRIBUTION>(invoke_http_mode::BIN, "/get_output_distribution.bin", req, res, r))
       return r;
 
+    CHECK_HEAVY_REQUEST_SLOT();
+
     const bool restricted = m_restricted && ctx;
     if (restricted && req.amounts != std::vector<uint64_t>(1, 0))
     {
@@ -3561,7 +4355,25 @@ namespace cryptonote
 
     try
     {
-      if (!(req.check ? m_core.check_blockchain_pruning() : m_core.prune_blockchain()))
+      if (req.compact)
+      {
+        if (!m_core.compact_blockchain(res.compacted_path))
+        {
+          error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
+          error_resp.message = "Failed to compact blockchain";
+          return false;
+        }
+      }
+      else if (req.background && !req.check)
+      {
+        if (!m_core.start_background_pruning())
+        {
+          error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
+          error_resp.message = "Failed to start background blockchain pruning";
+          return false;
+        }
+      }
+      else if (!(req.check ? m_core.check_blockchain_pruning() : m_core.prune_blockchain()))
       {
         error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
         error_resp.message = req.check ? "Failed to check blockchain pruning" : "Failed to prune blockchain";
@@ -3569,6 +4381,7 @@ namespace cryptonote
       }
       res.pruning_seed = m_core.get_blockchain_pruning_seed();
       res.pruned = res.pruning_seed != 0;
+      res.background_pruning = m_core.is_background_pruning();
     }
     catch (const std::exception &e)
     {
@@ -3919,4 +4732,16 @@ namespace cryptonote
     , "Max response bytes that can be queued, enforced at next response attempt"
     , DEFAULT_RPC_SOFT_LIMIT_SIZE
   };
+
+  const command_line::arg_descriptor<uint64_t> core_rpc_server::arg_rpc_restricted_cost_budget = {
+      "rpc-restricted-cost-budget"
+    , "Milliseconds of handler time per second each restricted RPC client may use, 0 to disable"
+    , 250
+  };
+
+  const command_line::arg_descriptor<std::size_t> core_rpc_server::arg_rpc_restricted_max_heavy_requests = {
+      "rpc-restricted-max-heavy-requests"
+    , "Max output fetches and distributions run at once for restricted RPC clients, others wait for a slot; 0 for one less than the RPC threads"
+    , 0
+  };
 }  // namespace cryptonote
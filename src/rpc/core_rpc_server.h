@@ -30,19 +30,28 @@
 
 #pragma  once 
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <tuple>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
 #include "bootstrap_daemon.h"
+#include "common/lru_cache.h"
 #include "net/http_server_impl_base.h"
 #include "net/http_client.h"
 #include "core_rpc_server_commands_defs.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "p2p/net_node.h"
 #include "cryptonote_protocol/cryptonote_protocol_handler.h"
+#include "rpc_admission.h"
 #include "rpc_payment.h"
+#include "wallet/wallet_light_rpc.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "daemon.rpc"
@@ -56,6 +65,8 @@ namespace cryptonote
   {
   public:
 
+    static constexpr const std::size_t server_threads = 2; //!< threads running the RPC handlers
+
     static const command_line::arg_descriptor<std::string, false, true, 2> arg_rpc_bind_port;
     static const command_line::arg_descriptor<std::string> arg_rpc_restricted_bind_port;
     static const command_line::arg_descriptor<bool> arg_restricted_rpc;
@@ -76,6 +87,8 @@ namespace cryptonote
     static const command_line::arg_descriptor<std::size_t> arg_rpc_max_connections_per_private_ip;
     static const command_line::arg_descriptor<std::size_t> arg_rpc_max_connections;
     static const command_line::arg_descriptor<std::size_t> arg_rpc_response_soft_limit;
+    static const command_line::arg_descriptor<uint64_t> arg_rpc_restricted_cost_budget;
+    static const command_line::arg_descriptor<std::size_t> arg_rpc_restricted_max_heavy_requests;
 
     typedef epee::net_utils::connection_context_base connection_context;
 
@@ -95,7 +108,7 @@ namespace cryptonote
       );
     network_type nettype() const { return m_core.get_nettype(); }
 
-    CHAIN_HTTP_TO_MAP2(connection_context); //forward http requests to uri map
+    bool handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context); //forward http requests to uri map, after admission control
 
     BEGIN_URI_MAP2()
       MAP_URI_AUTO_JON2("/get_height", on_get_height, COMMAND_RPC_GET_HEIGHT)
@@ -106,6 +119,7 @@ namespace cryptonote
       MAP_URI_AUTO_BIN2("/getblocks_by_height.bin", on_get_blocks_by_height, COMMAND_RPC_GET_BLOCKS_BY_HEIGHT)
       MAP_URI_AUTO_BIN2("/get_hashes.bin", on_get_hashes, COMMAND_RPC_GET_HASHES_FAST)
       MAP_URI_AUTO_BIN2("/gethashes.bin", on_get_hashes, COMMAND_RPC_GET_HASHES_FAST)
+      MAP_URI_AUTO_BIN2("/get_block_scan_records.bin", on_get_block_scan_records, COMMAND_RPC_GET_BLOCK_SCAN_RECORDS)
       MAP_URI_AUTO_BIN2("/get_o_indexes.bin", on_get_indexes, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES)      
       MAP_URI_AUTO_BIN2("/get_outs.bin", on_get_outs_bin, COMMAND_RPC_GET_OUTPUTS_BIN)
       MAP_URI_AUTO_JON2("/get_transactions", on_get_transactions, COMMAND_RPC_GET_TRANSACTIONS)
@@ -140,6 +154,11 @@ namespace cryptonote
       MAP_URI_AUTO_JON2_IF("/update", on_update, COMMAND_RPC_UPDATE, !m_restricted)
       MAP_URI_AUTO_BIN2("/get_output_distribution.bin", on_get_output_distribution_bin, COMMAND_RPC_GET_OUTPUT_DISTRIBUTION)
       MAP_URI_AUTO_JON2_IF("/pop_blocks", on_pop_blocks, COMMAND_RPC_POP_BLOCKS, !m_restricted)
+      MAP_URI_AUTO_JON2_IF("/login", on_light_wallet_login, tools::COMMAND_RPC_LOGIN, !m_restricted)
+      MAP_URI_AUTO_JON2_IF("/get_address_txs", on_light_wallet_get_address_txs, tools::COMMAND_RPC_GET_ADDRESS_TXS, !m_restricted)
+      MAP_URI_AUTO_JON2_IF("/get_unspent_outs", on_light_wallet_get_unspent_outs, tools::COMMAND_RPC_GET_UNSPENT_OUTS, !m_restricted)
+      MAP_URI2("/metrics", on_metrics)
+      MAP_URI2("/trace", on_trace)
       BEGIN_JSON_RPC_MAP("/json_rpc")
         MAP_JON_RPC("get_block_count",           on_getblockcount,              COMMAND_RPC_GETBLOCKCOUNT)
         MAP_JON_RPC("getblockcount",             on_getblockcount,              COMMAND_RPC_GETBLOCKCOUNT)
@@ -175,7 +194,13 @@ namespace cryptonote
         MAP_JON_RPC_WE_IF("get_coinbase_tx_sum", on_get_coinbase_tx_sum,        COMMAND_RPC_GET_COINBASE_TX_SUM, !m_restricted)
         MAP_JON_RPC_WE("get_supply_info",        on_get_supply_info,            COMMAND_RPC_GET_SUPPLY_INFO)
         MAP_JON_RPC_WE("get_yield_info",         on_get_yield_info,             COMMAND_RPC_GET_YIELD_INFO)
+        MAP_JON_RPC_WE("get_supply_series",      on_get_supply_series,          COMMAND_RPC_GET_SUPPLY_SERIES)
+        MAP_JON_RPC_WE("get_txs_by_type",        on_get_txs_by_type,            COMMAND_RPC_GET_TXS_BY_TYPE)
+        MAP_JON_RPC_WE("get_outputs_by_asset_type", on_get_outputs_by_asset_type, COMMAND_RPC_GET_OUTPUTS_BY_ASSET_TYPE)
+        MAP_JON_RPC_WE_IF("get_block_processing_stats", on_get_block_processing_stats, COMMAND_RPC_GET_BLOCK_PROCESSING_STATS, !m_restricted)
+        MAP_JON_RPC_WE_IF("get_memory_stats",    on_get_memory_stats,           COMMAND_RPC_GET_MEMORY_STATS, !m_restricted)
         MAP_JON_RPC_WE("get_fee_estimate",       on_get_base_fee_estimate,      COMMAND_RPC_GET_BASE_FEE_ESTIMATE)
+        MAP_JON_RPC_WE("get_chain_state",        on_get_chain_state,            COMMAND_RPC_GET_CHAIN_STATE)
         MAP_JON_RPC_WE_IF("get_alternate_chains",on_get_alternate_chains,       COMMAND_RPC_GET_ALTERNATE_CHAINS, !m_restricted)
         MAP_JON_RPC_WE_IF("relay_tx",            on_relay_tx,                   COMMAND_RPC_RELAY_TX, !m_restricted)
         MAP_JON_RPC_WE_IF("sync_info",           on_sync_info,                  COMMAND_RPC_SYNC_INFO, !m_restricted)
@@ -197,6 +222,7 @@ namespace cryptonote
     bool on_get_alt_blocks_hashes(const COMMAND_RPC_GET_ALT_BLOCKS_HASHES::request& req, COMMAND_RPC_GET_ALT_BLOCKS_HASHES::response& res, const connection_context *ctx = NULL);
     bool on_get_blocks_by_height(const COMMAND_RPC_GET_BLOCKS_BY_HEIGHT::request& req, COMMAND_RPC_GET_BLOCKS_BY_HEIGHT::response& res, const connection_context *ctx = NULL);
     bool on_get_hashes(const COMMAND_RPC_GET_HASHES_FAST::request& req, COMMAND_RPC_GET_HASHES_FAST::response& res, const connection_context *ctx = NULL);
+    bool on_get_block_scan_records(const COMMAND_RPC_GET_BLOCK_SCAN_RECORDS::request& req, COMMAND_RPC_GET_BLOCK_SCAN_RECORDS::response& res, const connection_context *ctx = NULL);
     bool on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::request& req, COMMAND_RPC_GET_TRANSACTIONS::response& res, const connection_context *ctx = NULL);
     bool on_is_key_image_spent(const COMMAND_RPC_IS_KEY_IMAGE_SPENT::request& req, COMMAND_RPC_IS_KEY_IMAGE_SPENT::response& res, const connection_context *ctx = NULL);
     bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res, const connection_context *ctx = NULL);
@@ -220,6 +246,11 @@ namespace cryptonote
     bool on_get_transaction_pool_stats(const COMMAND_RPC_GET_TRANSACTION_POOL_STATS::request& req, COMMAND_RPC_GET_TRANSACTION_POOL_STATS::response& res, const connection_context *ctx = NULL);
     bool on_set_bootstrap_daemon(const COMMAND_RPC_SET_BOOTSTRAP_DAEMON::request& req, COMMAND_RPC_SET_BOOTSTRAP_DAEMON::response& res, const connection_context *ctx = NULL);
     bool on_stop_daemon(const COMMAND_RPC_STOP_DAEMON::request& req, COMMAND_RPC_STOP_DAEMON::response& res, const connection_context *ctx = NULL);
+    bool on_light_wallet_login(const tools::COMMAND_RPC_LOGIN::request& req, tools::COMMAND_RPC_LOGIN::response& res, const connection_context *ctx = NULL);
+    bool on_light_wallet_get_address_txs(const tools::COMMAND_RPC_GET_ADDRESS_TXS::request& req, tools::COMMAND_RPC_GET_ADDRESS_TXS::response& res, const connection_context *ctx = NULL);
+    bool on_light_wallet_get_unspent_outs(const tools::COMMAND_RPC_GET_UNSPENT_OUTS::request& req, tools::COMMAND_RPC_GET_UNSPENT_OUTS::response& res, const connection_context *ctx = NULL);
+    bool on_metrics(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, const connection_context *ctx = NULL);
+    bool on_trace(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, const connection_context *ctx = NULL);
     bool on_get_limit(const COMMAND_RPC_GET_LIMIT::request& req, COMMAND_RPC_GET_LIMIT::response& res, const connection_context *ctx = NULL);
     bool on_set_limit(const COMMAND_RPC_SET_LIMIT::request& req, COMMAND_RPC_SET_LIMIT::response& res, const connection_context *ctx = NULL);
     bool on_out_peers(const COMMAND_RPC_OUT_PEERS::request& req, COMMAND_RPC_OUT_PEERS::response& res, const connection_context *ctx = NULL);
@@ -254,7 +285,13 @@ namespace cryptonote
     bool on_get_coinbase_tx_sum(const COMMAND_RPC_GET_COINBASE_TX_SUM::request& req, COMMAND_RPC_GET_COINBASE_TX_SUM::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
     bool on_get_supply_info(const COMMAND_RPC_GET_SUPPLY_INFO::request& req, COMMAND_RPC_GET_SUPPLY_INFO::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
     bool on_get_yield_info(const COMMAND_RPC_GET_YIELD_INFO::request& req, COMMAND_RPC_GET_YIELD_INFO::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
+    bool on_get_supply_series(const COMMAND_RPC_GET_SUPPLY_SERIES::request& req, COMMAND_RPC_GET_SUPPLY_SERIES::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
+    bool on_get_txs_by_type(const COMMAND_RPC_GET_TXS_BY_TYPE::request& req, COMMAND_RPC_GET_TXS_BY_TYPE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
+    bool on_get_outputs_by_asset_type(const COMMAND_RPC_GET_OUTPUTS_BY_ASSET_TYPE::request& req, COMMAND_RPC_GET_OUTPUTS_BY_ASSET_TYPE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
+    bool on_get_block_processing_stats(const COMMAND_RPC_GET_BLOCK_PROCESSING_STATS::request& req, COMMAND_RPC_GET_BLOCK_PROCESSING_STATS::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
+    bool on_get_memory_stats(const COMMAND_RPC_GET_MEMORY_STATS::request& req, COMMAND_RPC_GET_MEMORY_STATS::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
     bool on_get_base_fee_estimate(const COMMAND_RPC_GET_BASE_FEE_ESTIMATE::request& req, COMMAND_RPC_GET_BASE_FEE_ESTIMATE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
+    bool on_get_chain_state(const COMMAND_RPC_GET_CHAIN_STATE::request& req, COMMAND_RPC_GET_CHAIN_STATE::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
     bool on_get_alternate_chains(const COMMAND_RPC_GET_ALTERNATE_CHAINS::request& req, COMMAND_RPC_GET_ALTERNATE_CHAINS::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
     bool on_relay_tx(const COMMAND_RPC_RELAY_TX::request& req, COMMAND_RPC_RELAY_TX::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
     bool on_sync_info(const COMMAND_RPC_SYNC_INFO::request& req, COMMAND_RPC_SYNC_INFO::response& res, epee::json_rpc::error& error_resp, const connection_context *ctx = NULL);
@@ -292,6 +329,40 @@ private:
     bool use_bootstrap_daemon_if_necessary(const invoke_http_mode &mode, const std::string &command_name, const typename COMMAND_TYPE::request& req, typename COMMAND_TYPE::response& res, bool &r);
     bool get_block_template(const account_public_address &address, const crypto::hash *prev_block, const cryptonote::blobdata &extra_nonce, size_t &reserved_offset, cryptonote::difficulty_type &difficulty, uint64_t &height, uint64_t &expected_reward, block &b, uint64_t &seed_height, crypto::hash &seed_hash, crypto::hash &next_seed_hash, epee::json_rpc::error &error_resp);
     bool check_payment(const std::string &client, uint64_t payment, const std::string &rpc, bool same_ts, std::string &message, uint64_t &credits, std::string &top_hash);
+
+    // start height, prune, no_miner_tx, max block count
+    typedef std::tuple<uint64_t, bool, bool, size_t> get_blocks_cache_key;
+    struct get_blocks_cache_entry
+    {
+      crypto::hash last_block_hash;
+      std::vector<block_complete_entry> blocks;
+      std::vector<COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> output_indices;
+      std::vector<COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> asset_type_output_indices;
+      size_t size;
+    };
+    bool get_cached_blocks(const get_blocks_cache_key &key, COMMAND_RPC_GET_BLOCKS_FAST::response &res);
+    void add_cached_blocks(const get_blocks_cache_key &key, const COMMAND_RPC_GET_BLOCKS_FAST::response &res);
+
+    // main chain header without pow hash, keyed by height and checked against the block id at that height
+    struct block_header_cache_entry
+    {
+      crypto::hash hash;
+      block_header_response header;
+    };
+    // unrestricted get_info fields, shared by requests until the top block or the pool changes, or it gets old
+    struct get_info_snapshot
+    {
+      crypto::hash top_hash;
+      uint64_t pool_cookie;
+      std::chrono::steady_clock::time_point built;
+      COMMAND_RPC_GET_INFO::response info;
+      uint64_t public_tx_pool_size;
+    };
+    std::shared_ptr<const get_info_snapshot> get_current_info_snapshot();
+    std::shared_ptr<const get_info_snapshot> build_info_snapshot();
+
+    bool get_cached_block_header(uint64_t height, const crypto::hash &hash, block_header_response &response);
+    void add_cached_block_header(const crypto::hash &hash, const block_header_response &response);
     
     core& m_core;
     nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core> >& m_p2p;
@@ -305,8 +376,25 @@ private:
     epee::critical_section m_host_fails_score_lock;
     std::map<std::string, uint64_t> m_host_fails_score;
     std::unique_ptr<rpc_payment> m_rpc_payment;
+    rpc_admission m_admission;
     bool disable_rpc_ban;
     bool m_rpc_payment_allow_free_loopback;
+    boost::mutex m_get_blocks_cache_lock;
+    std::map<get_blocks_cache_key, get_blocks_cache_entry> m_get_blocks_cache;
+    std::deque<get_blocks_cache_key> m_get_blocks_cache_order; // oldest first
+    size_t m_get_blocks_cache_size;
+    uint64_t m_get_blocks_cache_hits;
+    uint64_t m_get_blocks_cache_misses;
+    boost::mutex m_get_info_snapshot_lock;
+    boost::mutex m_get_info_snapshot_build_lock; // one build at a time, others wait for its result
+    std::shared_ptr<const get_info_snapshot> m_get_info_snapshot;
+    boost::mutex m_block_header_cache_lock;
+    tools::lru_cache<uint64_t, block_header_cache_entry> m_block_header_cache;
+    boost::mutex m_heavy_requests_lock;
+    boost::condition_variable m_heavy_requests_cond; // a slot was freed
+    std::size_t m_heavy_requests; // expensive calls running on behalf of restricted clients
+    std::size_t m_max_heavy_requests;
+    std::atomic<uint64_t> m_heavy_requests_rejected;
   };
 }
 
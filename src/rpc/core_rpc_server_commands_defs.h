@@ -91,7 +91,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 3
-#define CORE_RPC_VERSION_MINOR 13
+#define CORE_RPC_VERSION_MINOR 30
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -180,6 +180,7 @@ namespace cryptonote
       bool        prune;
       bool        no_miner_tx;
       uint64_t    pool_info_since;
+      uint64_t    max_block_count; // 0 for the daemon's default
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_request_base)
         KV_SERIALIZE_OPT(requested_info, (uint8_t)0)
@@ -188,6 +189,7 @@ namespace cryptonote
         KV_SERIALIZE(prune)
         KV_SERIALIZE_OPT(no_miner_tx, false)
         KV_SERIALIZE_OPT(pool_info_since, (uint64_t)0)
+        KV_SERIALIZE_OPT(max_block_count, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -360,6 +362,37 @@ namespace cryptonote
     typedef epee::misc_utils::struct_init<response_t> response;
   };
   //-----------------------------------------------
+  struct COMMAND_RPC_GET_BLOCK_SCAN_RECORDS
+  {
+
+    struct request_t: public rpc_access_request_base
+    {
+      uint64_t    start_height;
+      uint64_t    count;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_request_base)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE_OPT(count, (uint64_t)COMMAND_RPC_GET_BLOCKS_FAST_MAX_BLOCK_COUNT)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct response_t: public rpc_access_response_base
+    {
+      std::vector<blobdata> records; // serialized cryptonote::block_scan_record, one per height
+      uint64_t    start_height;
+      uint64_t    current_height;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_response_base)
+        KV_SERIALIZE(records)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(current_height)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+  //-----------------------------------------------
   struct COMMAND_RPC_SUBMIT_RAW_TX
   {
       struct request_t
@@ -778,6 +811,14 @@ namespace cryptonote
       std::string version;
       bool synchronized;
       bool restricted;
+      int64_t pricing_record_age;
+      uint64_t rct_ver_cache_hits;
+      uint64_t rct_ver_cache_misses;
+      uint64_t rct_ver_cache_evictions;
+      bool txpool_validated;
+      bool history_verification;
+      uint64_t history_verified_height;
+      bool history_verification_failed;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
@@ -820,6 +861,14 @@ namespace cryptonote
         KV_SERIALIZE(version)
         KV_SERIALIZE(synchronized)
         KV_SERIALIZE(restricted)
+        KV_SERIALIZE_OPT(pricing_record_age, (int64_t)-1)
+        KV_SERIALIZE_OPT(rct_ver_cache_hits, (uint64_t)0)
+        KV_SERIALIZE_OPT(rct_ver_cache_misses, (uint64_t)0)
+        KV_SERIALIZE_OPT(rct_ver_cache_evictions, (uint64_t)0)
+        KV_SERIALIZE_OPT(txpool_validated, true)
+        KV_SERIALIZE_OPT(history_verification, false)
+        KV_SERIALIZE_OPT(history_verified_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(history_verification_failed, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -895,6 +944,9 @@ namespace cryptonote
     {
       bool active;
       uint64_t speed;
+      uint64_t speed_p10;
+      uint64_t speed_p50;
+      uint64_t speed_p90;
       uint32_t threads_count;
       std::string address;
       std::string pow_algorithm;
@@ -913,6 +965,9 @@ namespace cryptonote
         KV_SERIALIZE_PARENT(rpc_response_base)
         KV_SERIALIZE(active)
         KV_SERIALIZE(speed)
+        KV_SERIALIZE_OPT(speed_p10, (uint64_t)0)
+        KV_SERIALIZE_OPT(speed_p50, (uint64_t)0)
+        KV_SERIALIZE_OPT(speed_p90, (uint64_t)0)
         KV_SERIALIZE(threads_count)
         KV_SERIALIZE(address)
         KV_SERIALIZE(pow_algorithm)
@@ -1034,8 +1089,11 @@ namespace cryptonote
   {
     struct request_t: public rpc_request_base
     {
+      uint64_t since_backlog_version;
+
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_request_base)
+        KV_SERIALIZE_OPT(since_backlog_version, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -1064,6 +1122,9 @@ namespace cryptonote
       };
 
       std::vector<tx_backlog_entry> tx_backlog;
+      uint64_t backlog_version;
+      uint64_t backlog_base_version;
+      std::vector<std::string> tx_backlog_removed;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_response_base)
@@ -1075,6 +1136,9 @@ namespace cryptonote
         KV_SERIALIZE(median_weight)
         KV_SERIALIZE(already_generated_coins)
         KV_SERIALIZE(tx_backlog)
+        KV_SERIALIZE(backlog_version)
+        KV_SERIALIZE(backlog_base_version)
+        KV_SERIALIZE(tx_backlog_removed)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -1488,6 +1552,294 @@ namespace cryptonote
     typedef epee::misc_utils::struct_init<response_t> response;
   };
 
+  struct COMMAND_RPC_GET_SUPPLY_SERIES
+  {
+    struct request_t
+    {
+      std::string granularity;
+      uint64_t from_height;
+      uint64_t to_height;
+      uint64_t limit;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_OPT(granularity, std::string("block"))
+        KV_SERIALIZE_OPT(from_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(to_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(limit, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct asset_entry
+    {
+      std::string asset_type;
+      uint64_t circulating_supply;
+      uint64_t spot_price;
+      uint64_t ma_price;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(asset_type)
+        KV_SERIALIZE(circulating_supply)
+        KV_SERIALIZE(spot_price)
+        KV_SERIALIZE(ma_price)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct series_entry
+    {
+      uint64_t first_height;
+      uint64_t last_height;
+      uint64_t first_timestamp;
+      uint64_t last_timestamp;
+      uint64_t slippage_total;
+      uint64_t yield_total;
+      uint64_t burnt_total;
+      uint64_t staked_total;
+      uint64_t audit_total;
+      uint64_t locked_coins_tally;
+      uint8_t network_health_percentage;
+      std::vector<asset_entry> assets;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(first_height)
+        KV_SERIALIZE(last_height)
+        KV_SERIALIZE(first_timestamp)
+        KV_SERIALIZE(last_timestamp)
+        KV_SERIALIZE(slippage_total)
+        KV_SERIALIZE(yield_total)
+        KV_SERIALIZE(burnt_total)
+        KV_SERIALIZE(staked_total)
+        KV_SERIALIZE(audit_total)
+        KV_SERIALIZE(locked_coins_tally)
+        KV_SERIALIZE(network_health_percentage)
+        KV_SERIALIZE(assets)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response_t
+    {
+      std::string status;
+      uint64_t height;
+      uint64_t bucket_blocks;
+      std::vector<series_entry> entries;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(bucket_blocks)
+        KV_SERIALIZE(entries)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
+  struct COMMAND_RPC_GET_TXS_BY_TYPE
+  {
+    struct request_t
+    {
+      uint8_t tx_type;
+      uint64_t from_height;
+      uint64_t from_tx_id;
+      uint64_t to_height;
+      uint64_t limit;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(tx_type)
+        KV_SERIALIZE_OPT(from_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(from_tx_id, (uint64_t)0)
+        KV_SERIALIZE_OPT(to_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(limit, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct tx_entry
+    {
+      uint64_t height;
+      uint64_t tx_id;
+      std::string tx_hash;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(tx_id)
+        KV_SERIALIZE(tx_hash)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response_t
+    {
+      std::string status;
+      uint64_t height;
+      uint64_t index_height;
+      std::vector<tx_entry> entries;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(index_height)
+        KV_SERIALIZE(entries)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
+  struct COMMAND_RPC_GET_OUTPUTS_BY_ASSET_TYPE
+  {
+    struct request_t
+    {
+      std::string asset_type;
+      uint64_t from_height;
+      uint64_t from_output_id;
+      uint64_t to_height;
+      uint64_t limit;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(asset_type)
+        KV_SERIALIZE_OPT(from_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(from_output_id, (uint64_t)0)
+        KV_SERIALIZE_OPT(to_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(limit, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct output_entry
+    {
+      uint64_t height;
+      uint64_t output_id;
+      uint64_t asset_type_output_index;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(output_id)
+        KV_SERIALIZE(asset_type_output_index)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response_t
+    {
+      std::string status;
+      uint64_t height;
+      uint64_t index_height;
+      std::vector<output_entry> entries;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(index_height)
+        KV_SERIALIZE(entries)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
+  struct COMMAND_RPC_GET_BLOCK_PROCESSING_STATS
+  {
+    struct request_t: public rpc_request_base
+    {
+      uint64_t count;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_request_base)
+        KV_SERIALIZE_OPT(count, (uint64_t)BLOCK_PROCESSING_STATS_COUNT)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct entry
+    {
+      uint64_t height;
+      std::string id;
+      uint64_t timestamp;
+      uint64_t n_txs;
+      uint64_t difficulty_us;
+      uint64_t pow_us;
+      uint64_t tx_inputs_us;
+      uint64_t rct_batch_us;
+      uint64_t miner_tx_us;
+      uint64_t protocol_tx_us;
+      uint64_t payouts_us;
+      uint64_t db_add_us;
+      uint64_t ybi_us;
+      uint64_t total_us;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(id)
+        KV_SERIALIZE(timestamp)
+        KV_SERIALIZE(n_txs)
+        KV_SERIALIZE(difficulty_us)
+        KV_SERIALIZE(pow_us)
+        KV_SERIALIZE(tx_inputs_us)
+        KV_SERIALIZE(rct_batch_us)
+        KV_SERIALIZE(miner_tx_us)
+        KV_SERIALIZE(protocol_tx_us)
+        KV_SERIALIZE(payouts_us)
+        KV_SERIALIZE(db_add_us)
+        KV_SERIALIZE(ybi_us)
+        KV_SERIALIZE(total_us)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response_t: public rpc_response_base
+    {
+      std::vector<entry> entries;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_response_base)
+        KV_SERIALIZE(entries)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
+  struct COMMAND_RPC_GET_MEMORY_STATS
+  {
+    struct request_t: public rpc_request_base
+    {
+      bool include_db_resident;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_request_base)
+        KV_SERIALIZE_OPT(include_db_resident, false)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct response_t: public rpc_response_base
+    {
+      uint64_t txpool_weight;
+      uint64_t txpool_count;
+      uint64_t rct_ver_cache_bytes;
+      uint64_t ybi_cache_bytes;
+      uint64_t output_distribution_cache_bytes;
+      uint64_t block_height_index_bytes;
+      uint64_t block_stats_bytes;
+      uint64_t block_queue_bytes;
+      uint64_t randomx_dataset_bytes;
+      uint64_t randomx_cache_bytes;
+      uint64_t db_size;
+      uint64_t db_resident_bytes;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_response_base)
+        KV_SERIALIZE(txpool_weight)
+        KV_SERIALIZE(txpool_count)
+        KV_SERIALIZE(rct_ver_cache_bytes)
+        KV_SERIALIZE(ybi_cache_bytes)
+        KV_SERIALIZE(output_distribution_cache_bytes)
+        KV_SERIALIZE(block_height_index_bytes)
+        KV_SERIALIZE(block_stats_bytes)
+        KV_SERIALIZE(block_queue_bytes)
+        KV_SERIALIZE(randomx_dataset_bytes)
+        KV_SERIALIZE(randomx_cache_bytes)
+        KV_SERIALIZE(db_size)
+        KV_SERIALIZE(db_resident_bytes)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
   struct peer {
     uint64_t id;
     std::string host;
@@ -1830,6 +2182,25 @@ namespace cryptonote
     END_KV_SERIALIZE_MAP()
   };
 
+  struct txpool_type_stats
+  {
+    uint8_t tx_type;
+    std::string asset_type;
+    uint32_t txs;
+    uint64_t bytes;
+    uint64_t fee_total;
+
+    txpool_type_stats(): tx_type(0), txs(0), bytes(0), fee_total(0) {}
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(tx_type)
+      KV_SERIALIZE(asset_type)
+      KV_SERIALIZE(txs)
+      KV_SERIALIZE(bytes)
+      KV_SERIALIZE(fee_total)
+    END_KV_SERIALIZE_MAP()
+  };
+
   struct txpool_stats
   {
     uint64_t bytes_total;
@@ -1845,6 +2216,7 @@ namespace cryptonote
     uint64_t histo_98pc;
     std::vector<txpool_histo> histo;
     uint32_t num_double_spends;
+    std::vector<txpool_type_stats> types;
 
     txpool_stats(): bytes_total(0), bytes_min(0), bytes_max(0), bytes_med(0), fee_total(0), oldest(0), txs_total(0), num_failing(0), num_10m(0), num_not_relayed(0), histo_98pc(0), num_double_spends(0) {}
 
@@ -1862,6 +2234,7 @@ namespace cryptonote
       KV_SERIALIZE(histo_98pc)
       KV_SERIALIZE(histo)
       KV_SERIALIZE(num_double_spends)
+      KV_SERIALIZE(types)
     END_KV_SERIALIZE_MAP()
   };
 
@@ -2381,6 +2754,23 @@ namespace cryptonote
     };
     typedef epee::misc_utils::struct_init<request_t> request;
 
+    struct asset_sum
+    {
+      std::string asset_type;
+      uint64_t coinbase_amount;
+      uint64_t fee_amount;
+      uint64_t burnt_amount;
+      uint64_t protocol_amount;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(asset_type)
+        KV_SERIALIZE(coinbase_amount)
+        KV_SERIALIZE(fee_amount)
+        KV_SERIALIZE(burnt_amount)
+        KV_SERIALIZE(protocol_amount)
+      END_KV_SERIALIZE_MAP()
+    };
+
     struct response_t: public rpc_access_response_base
     {
       uint64_t emission_amount;
@@ -2389,6 +2779,7 @@ namespace cryptonote
       uint64_t fee_amount;
       std::string wide_fee_amount;
       uint64_t fee_amount_top64;
+      std::vector<asset_sum> asset_sums;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
@@ -2398,6 +2789,7 @@ namespace cryptonote
         KV_SERIALIZE(fee_amount)
         KV_SERIALIZE(wide_fee_amount)
         KV_SERIALIZE(fee_amount_top64)
+        KV_SERIALIZE(asset_sums)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -2432,6 +2824,53 @@ namespace cryptonote
     typedef epee::misc_utils::struct_init<response_t> response;
   };
 
+  struct COMMAND_RPC_GET_CHAIN_STATE
+  {
+    struct request_t: public rpc_access_request_base
+    {
+      uint64_t grace_blocks;
+      bool include_supply;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_request_base)
+        KV_SERIALIZE(grace_blocks)
+        KV_SERIALIZE_OPT(include_supply, false)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<request_t> request;
+
+    struct response_t: public rpc_access_response_base
+    {
+      uint64_t height;
+      uint64_t target_height;
+      std::string top_block_hash;
+      uint64_t block_weight_limit;
+      uint64_t adjusted_time;
+      uint8_t hard_fork_version;
+      uint64_t fee;
+      uint64_t quantization_mask;
+      std::vector<uint64_t> fees;
+      oracle::pricing_record pricing_record;
+      std::vector<COMMAND_RPC_GET_SUPPLY_INFO::supply_entry> supply_tally;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_PARENT(rpc_access_response_base)
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(target_height)
+        KV_SERIALIZE(top_block_hash)
+        KV_SERIALIZE(block_weight_limit)
+        KV_SERIALIZE(adjusted_time)
+        KV_SERIALIZE(hard_fork_version)
+        KV_SERIALIZE(fee)
+        KV_SERIALIZE_OPT(quantization_mask, (uint64_t)1)
+        KV_SERIALIZE(fees)
+        KV_SERIALIZE(pricing_record)
+        KV_SERIALIZE(supply_tally)
+      END_KV_SERIALIZE_MAP()
+    };
+    typedef epee::misc_utils::struct_init<response_t> response;
+  };
+
   struct COMMAND_RPC_GET_ALTERNATE_CHAINS
   {
     struct request_t: public rpc_request_base
@@ -2584,6 +3023,9 @@ namespace cryptonote
       std::list<peer> peers;
       std::list<span> spans;
       std::string overview;
+      bool history_verification;
+      uint64_t history_verified_height;
+      bool history_verification_failed;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
@@ -2593,6 +3035,9 @@ namespace cryptonote
         KV_SERIALIZE(peers)
         KV_SERIALIZE(spans)
         KV_SERIALIZE(overview)
+        KV_SERIALIZE_OPT(history_verification, false)
+        KV_SERIALIZE_OPT(history_verified_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(history_verification_failed, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -2909,10 +3354,14 @@ namespace cryptonote
     struct request_t: public rpc_request_base
     {
       bool check;
+      bool background;
+      bool compact;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_request_base)
         KV_SERIALIZE_OPT(check, false)
+        KV_SERIALIZE_OPT(background, false)
+        KV_SERIALIZE_OPT(compact, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -2921,11 +3370,15 @@ namespace cryptonote
     {
       bool pruned;
       uint32_t pruning_seed;
+      bool background_pruning;
+      std::string compacted_path;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_response_base)
         KV_SERIALIZE(pruned)
         KV_SERIALIZE(pruning_seed)
+        KV_SERIALIZE(background_pruning)
+        KV_SERIALIZE(compacted_path)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -39,6 +39,7 @@
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/blobdatatype.h"
+#include "storages/portable_storage_template_helper.h"
 #include "ringct/rctSigs.h"
 #include "version.h"
 
@@ -107,6 +108,36 @@ namespace rpc
       {u8"start_mining", handle_message<StartMining>},
       {u8"stop_mining", handle_message<StopMining>}
     };
+
+    template<typename Command>
+    epee::byte_slice handle_binary_message(DaemonHandler& handler, const epee::span<const std::uint8_t> parameters)
+    {
+      typename Command::request request{};
+      typename Command::response response{};
+      if (epee::serialization::load_t_from_binary(request, parameters))
+        handler.handle(request, response);
+      else
+        response.status = "Failed to parse binary request";
+      return epee::serialization::store_t_to_binary(response);
+    }
+
+    struct binary_handler_map
+    {
+      const char* method_name;
+      epee::byte_slice (*call)(DaemonHandler& handler, epee::span<const std::uint8_t> parameters);
+    };
+
+    bool operator<(const binary_handler_map& lhs, const boost::string_ref rhs) noexcept
+    {
+      return boost::string_ref{lhs.method_name} < rhs;
+    }
+
+    // the messages where JSON is most of the cost, blocks and transactions stay blobs
+    constexpr const binary_handler_map binary_handlers[] =
+    {
+      {u8"get_blocks_fast", handle_binary_message<COMMAND_RPC_GET_BLOCKS_FAST>},
+      {u8"get_tx_global_output_indices", handle_binary_message<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>}
+    };
   } // anonymous
 
   DaemonHandler::DaemonHandler(cryptonote::core& c, t_p2p& p2p)
@@ -115,6 +146,10 @@ namespace rpc
     const auto last_sorted = std::is_sorted_until(std::begin(handlers), std::end(handlers));
     if (last_sorted != std::end(handlers))
       throw std::logic_error{std::string{"ZMQ JSON-RPC handlers map is not properly sorted, see "} + last_sorted->method_name};
+    const auto last_binary_sorted = std::is_sorted_until(std::begin(binary_handlers), std::end(binary_handlers),
+      [](const binary_handler_map& lhs, const binary_handler_map& rhs) { return std::strcmp(lhs.method_name, rhs.method_name) < 0; });
+    if (last_binary_sorted != std::end(binary_handlers))
+      throw std::logic_error{std::string{"ZMQ binary RPC handlers map is not properly sorted, see "} + last_binary_sorted->method_name};
   }
 
   void DaemonHandler::handle(const GetHeight::Request& req, GetHeight::Response& res)
@@ -367,6 +402,94 @@ namespace rpc
     res.status = Message::STATUS_OK;
   }
 
+  void DaemonHandler::handle(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res)
+  {
+    if (req.requested_info != COMMAND_RPC_GET_BLOCKS_FAST::BLOCKS_ONLY)
+    {
+      res.status = "Failed, only blocks are served over ZMQ";
+      return;
+    }
+
+    // the blocks and their output indices must come from the same chain
+    cryptonote::Blockchain::read_snapshot snapshot(m_core.get_blockchain_storage(), true);
+
+    size_t max_blocks = COMMAND_RPC_GET_BLOCKS_FAST_MAX_BLOCK_COUNT;
+    if (req.max_block_count && req.max_block_count < max_blocks)
+      max_blocks = req.max_block_count;
+
+    std::vector<std::pair<std::pair<blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, blobdata> > > > blocks;
+    if (!m_core.find_blockchain_supplement(req.start_height, req.block_ids, blocks, res.current_height, res.start_height, req.prune, !req.no_miner_tx, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
+    {
+      res.status = "Failed";
+      return;
+    }
+
+    res.blocks.reserve(blocks.size());
+    res.output_indices.reserve(blocks.size());
+    res.asset_type_output_indices.reserve(blocks.size());
+    for (auto& bd : blocks)
+    {
+      res.blocks.emplace_back();
+      res.blocks.back().pruned = req.prune;
+      res.blocks.back().block = std::move(bd.first.first);
+      res.output_indices.emplace_back();
+      res.asset_type_output_indices.emplace_back();
+      if (req.no_miner_tx)
+      {
+        res.output_indices.back().indices.emplace_back();
+        res.asset_type_output_indices.back().indices.emplace_back();
+      }
+      res.blocks.back().txs.reserve(bd.second.size());
+      for (auto& tx : bd.second)
+        res.blocks.back().txs.push_back({std::move(tx.second), crypto::null_hash});
+
+      // the miner and protocol txs come first, unless the miner tx was left out
+      const size_t n_txes_to_lookup = bd.second.size() + (req.no_miner_tx ? 0 : 2);
+      if (n_txes_to_lookup == 0)
+        continue;
+      std::vector<std::vector<std::pair<uint64_t, uint64_t>>> indices;
+      if (!m_core.get_tx_outputs_gindexs(req.no_miner_tx ? bd.second.front().first : bd.first.second, n_txes_to_lookup, indices) || indices.size() != n_txes_to_lookup)
+      {
+        res.blocks.clear();
+        res.output_indices.clear();
+        res.asset_type_output_indices.clear();
+        res.status = "Failed";
+        return;
+      }
+      for (const auto& tx_indices : indices)
+      {
+        res.output_indices.back().indices.emplace_back();
+        res.asset_type_output_indices.back().indices.emplace_back();
+        for (const auto& index : tx_indices)
+        {
+          res.output_indices.back().indices.back().indices.push_back(index.first);
+          res.asset_type_output_indices.back().indices.back().indices.push_back(index.second);
+        }
+      }
+    }
+
+    res.status = CORE_RPC_STATUS_OK;
+  }
+
+  void DaemonHandler::handle(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res)
+  {
+    std::vector<std::pair<uint64_t, uint64_t>> output_indices;
+    if (!m_core.get_tx_outputs_gindexs(req.txid, output_indices))
+    {
+      res.status = "Failed";
+      return;
+    }
+
+    res.o_indexes.reserve(output_indices.size());
+    res.asset_type_output_indices.reserve(output_indices.size());
+    for (const auto& index : output_indices)
+    {
+      res.o_indexes.push_back(index.first);
+      res.asset_type_output_indices.push_back(index.second);
+    }
+    res.status = CORE_RPC_STATUS_OK;
+  }
+
   void DaemonHandler::handle(const SendRawTx::Request& req, SendRawTx::Response& res)
   {
     handleTxBlob(cryptonote::tx_to_blob(req.tx), req.relay, res);
@@ -941,6 +1064,23 @@ namespace rpc
 
   epee::byte_slice DaemonHandler::handle(std::string&& request)
   {
+    const std::size_t separator = request.find('\0');
+    if (separator != std::string::npos)
+    {
+      const boost::string_ref method{request.data(), separator};
+      MDEBUG("Handling binary RPC request: " << method);
+
+      epee::span<const std::uint8_t> parameters = epee::strspan<std::uint8_t>(request);
+      parameters.remove_prefix(separator + 1);
+      const auto matched_handler = std::lower_bound(std::begin(binary_handlers), std::end(binary_handlers), method);
+      if (matched_handler != std::end(binary_handlers) && method == matched_handler->method_name)
+        return matched_handler->call(*this, parameters);
+
+      cryptonote::rpc_response_base response{};
+      response.status = "Unknown binary method";
+      return epee::serialization::store_t_to_binary(response);
+    }
+
     MDEBUG("Handling RPC request: " << request);
 
     try
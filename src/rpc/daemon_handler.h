@@ -32,6 +32,7 @@
 #include "daemon_messages.h"
 #include "daemon_rpc_version.h"
 #include "rpc_handler.h"
+#include "rpc/core_rpc_server_commands_defs.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_protocol/cryptonote_protocol_handler.h"
 #include "p2p/net_node.h"
@@ -133,6 +134,13 @@ class DaemonHandler : public RpcHandler
 
     void handle(const GetOutputDistribution::Request& req, GetOutputDistribution::Response& res);
 
+    // binary encodings, same as the /getblocks.bin and /get_o_indexes.bin HTTP RPC
+    void handle(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
+
+    void handle(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
+
+    /*! A JSON-RPC request, or a binary one: the method name, a NUL byte and
+        the epee binary request. Binary requests get epee binary responses. */
     epee::byte_slice handle(std::string&& request) override final;
 
   private:
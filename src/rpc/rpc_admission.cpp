@@ -0,0 +1,144 @@
+// Copyright (c) 2024, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+#include "misc_log_ex.h"
+#include "rpc_admission.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "daemon.rpc.admission"
+
+namespace cryptonote
+{
+  //------------------------------------------------------------------------------------------------------------------------------
+  rpc_admission::rpc_admission(std::chrono::microseconds budget, std::chrono::seconds burst):
+    m_budget_us(0),
+    m_capacity_us(0),
+    m_burst(std::max(burst, std::chrono::seconds{1})),
+    m_rejected(0)
+  {
+    set_budget(budget);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_admission::set_budget(std::chrono::microseconds budget)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_budget_us = std::max<int64_t>(budget.count(), 0);
+    m_capacity_us = m_budget_us * m_burst.count();
+    m_buckets.clear();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool rpc_admission::enabled() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_budget_us != 0;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_admission::refill(bucket &b, clock::time_point now) const
+  {
+    if (now <= b.updated)
+      return;
+    const uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(now - b.updated).count();
+    // elapsed * budget / 1s, without overflowing on long idle periods
+    const uint64_t refill = elapsed_us >= (uint64_t)m_burst.count() * 1000000 ? m_capacity_us : elapsed_us * m_budget_us / 1000000;
+    b.tokens = std::min(m_capacity_us, b.tokens + refill);
+    b.updated = now;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_admission::prune(clock::time_point now)
+  {
+    for (auto i = m_buckets.begin(); i != m_buckets.end(); )
+    {
+      refill(i->second, now);
+      if (i->second.tokens == m_capacity_us)
+        i = m_buckets.erase(i);
+      else
+        ++i;
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool rpc_admission::admit(const std::string &client, const std::string &method, clock::time_point now)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if (m_budget_us == 0)
+      return true;
+
+    const auto cost_it = m_costs.find(method);
+    // a single call never costs more than a full bucket, or slow methods could never run at all
+    const uint64_t cost = std::min(m_capacity_us, cost_it == m_costs.end() ? default_cost_us : cost_it->second);
+
+    auto it = m_buckets.find(client);
+    if (it == m_buckets.end())
+    {
+      if (m_buckets.size() >= max_clients)
+        prune(now);
+      it = m_buckets.emplace(client, bucket{m_capacity_us, now}).first;
+    }
+    else
+      refill(it->second, now);
+
+    if (it->second.tokens < cost)
+    {
+      ++m_rejected;
+      MDEBUG("Rejecting " << method << " from " << client << ": cost " << cost << " us, " << it->second.tokens << " us left");
+      return false;
+    }
+    it->second.tokens -= cost;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_admission::record(const std::string &method, std::chrono::microseconds elapsed)
+  {
+    const uint64_t us = std::max<int64_t>(elapsed.count(), 1);
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    auto it = m_costs.find(method);
+    if (it == m_costs.end())
+    {
+      // method names come from the request, do not let clients grow this forever
+      if (m_costs.size() < max_methods)
+        m_costs.emplace(method, us);
+    }
+    else
+      it->second = (it->second * 7 + us) / 8;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  uint64_t rpc_admission::get_cost(const std::string &method) const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    const auto it = m_costs.find(method);
+    return it == m_costs.end() ? default_cost_us : it->second;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  uint64_t rpc_admission::get_rejected() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_rejected;
+  }
+}
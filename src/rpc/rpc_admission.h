@@ -0,0 +1,92 @@
+// Copyright (c) 2024, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
+
+namespace cryptonote
+{
+  /*! Admission control for restricted RPC clients.
+
+      Each method's cost is the moving average of the wall time its handler
+      was measured to take. Each client gets a token bucket that refills at
+      `budget` microseconds of handler time per second and holds at most
+      `burst` seconds of it, so a client may make many cheap calls or a few
+      expensive ones, but cannot keep the RPC threads busy on its own. */
+  class rpc_admission
+  {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    //! Cost charged for a method that has never been measured.
+    static constexpr const uint64_t default_cost_us = 1000;
+    //! Buckets kept before full (idle) ones are dropped.
+    static constexpr const std::size_t max_clients = 4096;
+    //! Distinct method costs kept.
+    static constexpr const std::size_t max_methods = 512;
+
+    explicit rpc_admission(std::chrono::microseconds budget = std::chrono::microseconds{0}, std::chrono::seconds burst = std::chrono::seconds{2});
+
+    //! Set the per-client budget of handler time per second. Zero disables admission control.
+    void set_budget(std::chrono::microseconds budget);
+    bool enabled() const;
+
+    //! \return False if `client` cannot currently afford a call to `method`; its bucket is charged otherwise.
+    bool admit(const std::string &client, const std::string &method, clock::time_point now = clock::now());
+    //! Folds the measured duration of one call to `method` into its cost.
+    void record(const std::string &method, std::chrono::microseconds elapsed);
+
+    //! \return Current cost of `method`, in microseconds.
+    uint64_t get_cost(const std::string &method) const;
+    uint64_t get_rejected() const;
+
+  private:
+    struct bucket
+    {
+      uint64_t tokens;
+      clock::time_point updated;
+    };
+
+    void refill(bucket &b, clock::time_point now) const;
+    void prune(clock::time_point now);
+
+    mutable boost::mutex m_mutex;
+    std::unordered_map<std::string, uint64_t> m_costs;
+    std::unordered_map<std::string, bucket> m_buckets;
+    uint64_t m_budget_us;
+    uint64_t m_capacity_us;
+    std::chrono::seconds m_burst;
+    uint64_t m_rejected;
+  };
+}
@@ -83,6 +83,9 @@ namespace cryptonote
       ssl_options.auth = epee::net_utils::ssl_authentication_t{
         command_line::get_arg(vm, arg.rpc_ssl_private_key), command_line::get_arg(vm, arg.rpc_ssl_certificate)
       };
+      ssl_options.session_resumption = command_line::get_arg(vm, arg.rpc_ssl_session_resumption);
+      ssl_options.cipher_list = command_line::get_arg(vm, arg.rpc_ssl_ciphers);
+      ssl_options.ciphersuites = command_line::get_arg(vm, arg.rpc_ssl_ciphersuites);
 
       return {std::move(ssl_options)};
     }
@@ -105,6 +108,9 @@ namespace cryptonote
      , rpc_ssl_allowed_fingerprints({"rpc-ssl-allowed-fingerprints", rpc_args::tr("List of certificate fingerprints to allow")})
      , rpc_ssl_allow_chained({"rpc-ssl-allow-chained", rpc_args::tr("Allow user (via --rpc-ssl-certificates) chain certificates"), false})
      , rpc_ssl_allow_any_cert({"rpc-ssl-allow-any-cert", rpc_args::tr("Allow any peer certificate"), false})
+     , rpc_ssl_session_resumption({"rpc-ssl-session-resumption", rpc_args::tr("Let reconnecting clients resume their SSL session instead of doing a full handshake"), false})
+     , rpc_ssl_ciphers({"rpc-ssl-ciphers", rpc_args::tr("OpenSSL cipher list for TLS 1.2 RPC connections, empty for the default"), ""})
+     , rpc_ssl_ciphersuites({"rpc-ssl-ciphersuites", rpc_args::tr("OpenSSL ciphersuites for TLS 1.3 RPC connections, empty for the default"), ""})
      , disable_rpc_ban({"disable-rpc-ban", rpc_args::tr("Do not ban hosts on RPC errors"), false, false})
   {}
 
@@ -128,6 +134,9 @@ namespace cryptonote
     command_line::add_arg(desc, arg.rpc_ssl_ca_certificates);
     command_line::add_arg(desc, arg.rpc_ssl_allowed_fingerprints);
     command_line::add_arg(desc, arg.rpc_ssl_allow_chained);
+    command_line::add_arg(desc, arg.rpc_ssl_session_resumption);
+    command_line::add_arg(desc, arg.rpc_ssl_ciphers);
+    command_line::add_arg(desc, arg.rpc_ssl_ciphersuites);
     command_line::add_arg(desc, arg.disable_rpc_ban);
     if (any_cert_option)
       command_line::add_arg(desc, arg.rpc_ssl_allow_any_cert);
@@ -67,6 +67,9 @@ namespace cryptonote
       const command_line::arg_descriptor<std::vector<std::string>> rpc_ssl_allowed_fingerprints;
       const command_line::arg_descriptor<bool> rpc_ssl_allow_chained;
       const command_line::arg_descriptor<bool> rpc_ssl_allow_any_cert;
+      const command_line::arg_descriptor<bool> rpc_ssl_session_resumption;
+      const command_line::arg_descriptor<std::string> rpc_ssl_ciphers;
+      const command_line::arg_descriptor<std::string> rpc_ssl_ciphersuites;
       const command_line::arg_descriptor<bool> disable_rpc_ban;
     };
 
@@ -44,7 +44,9 @@
 #define COST_PER_OUTPUT_DISTRIBUTION 50000
 #define COST_PER_COINBASE_TX_SUM_BLOCK 2
 #define COST_PER_BLOCK_HASH 0.002
+#define COST_PER_BLOCK_SCAN_RECORD 0.005
 #define COST_PER_FEE_ESTIMATE 1
+#define COST_PER_CHAIN_STATE 2
 #define COST_PER_SYNC_INFO 2
 #define COST_PER_HARD_FORK_INFO 1
 #define COST_PER_PEER_LIST 2
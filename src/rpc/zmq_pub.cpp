@@ -44,9 +44,11 @@
 #include <utility>
 
 #include "common/expect.h"
+#include "common/varint.h"
 #include "crypto/crypto.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/events.h"
+#include "cryptonote_basic/verification_context.h"
 #include "misc_log_ex.h"
 #include "serialization/json_object.h"
 #include "ringct/rctTypes.h"
@@ -58,9 +60,14 @@
 namespace
 {
   constexpr const char txpool_signal[] = "tx_signal";
+  constexpr const char chain_signal[] = "chain_signal";
+
+  //! What `relay_block_pub` pulled off the relay socket
+  enum class relay_event { forwarded, txpool, chain };
 
   using chain_writer =  void(epee::byte_stream&, std::uint64_t, epee::span<const cryptonote::block>);
-  using miner_writer =  void(epee::byte_stream&, uint8_t, uint64_t, const crypto::hash&, const crypto::hash&, cryptonote::difficulty_type, uint64_t, uint64_t, const std::vector<cryptonote::tx_block_template_backlog_entry>&);
+  using miner_writer =  void(epee::byte_stream&, uint8_t, uint64_t, const crypto::hash&, const crypto::hash&, cryptonote::difficulty_type, uint64_t, uint64_t, const std::vector<cryptonote::tx_block_template_backlog_entry>&, const cryptonote::tx_block_template_backlog_diff&);
+  using stats_writer =  void(epee::byte_stream&, const cryptonote::block_processing_stats&);
   using txpool_writer = void(epee::byte_stream&, epee::span<const cryptonote::txpool_event>);
 
   template<typename F>
@@ -104,6 +111,20 @@ namespace
     buf.put(':');
   }
 
+  void write_varint(epee::byte_stream& buf, const std::uint64_t value)
+  {
+    char bytes[(sizeof(value) * 8 + 6) / 7];
+    char* end = bytes;
+    tools::write_varint(end, value);
+    buf.write(bytes, end - bytes);
+  }
+
+  void write_blob(epee::byte_stream& buf, const cryptonote::blobdata& blob)
+  {
+    write_varint(buf, blob.size());
+    buf.write(blob.data(), blob.size());
+  }
+
   //! \return `name:...` where `...` is JSON and `name` is directly copied (no quotes - not JSON).
   template<typename T>
   void json_pub(epee::byte_stream& buf, const T value)
@@ -133,6 +154,19 @@ namespace
     const std::vector<cryptonote::tx_block_template_backlog_entry>& tx_backlog;
   };
 
+  //! Object for "minimal" miner data serialization, backlog sent as a diff
+  struct minimal_miner_data
+  {
+    const miner_data& data;
+    const cryptonote::tx_block_template_backlog_diff& tx_backlog_diff;
+  };
+
+  //! Object for block stats serialization
+  struct block_stats
+  {
+    const cryptonote::block_processing_stats& stats;
+  };
+
   //! Object for "minimal" tx serialization
   struct minimal_txpool
   {
@@ -178,6 +212,44 @@ namespace
     dest.EndObject();
   }
 
+  void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const minimal_miner_data& self)
+  {
+    dest.StartObject();
+    INSERT_INTO_JSON_OBJECT(dest, major_version, self.data.major_version);
+    INSERT_INTO_JSON_OBJECT(dest, height, self.data.height);
+    INSERT_INTO_JSON_OBJECT(dest, prev_id, self.data.prev_id);
+    INSERT_INTO_JSON_OBJECT(dest, seed_hash, self.data.seed_hash);
+    INSERT_INTO_JSON_OBJECT(dest, difficulty, cryptonote::hex(self.data.diff));
+    INSERT_INTO_JSON_OBJECT(dest, median_weight, self.data.median_weight);
+    INSERT_INTO_JSON_OBJECT(dest, already_generated_coins, self.data.already_generated_coins);
+    INSERT_INTO_JSON_OBJECT(dest, backlog_version, self.tx_backlog_diff.version);
+    INSERT_INTO_JSON_OBJECT(dest, backlog_base_version, self.tx_backlog_diff.base_version);
+    INSERT_INTO_JSON_OBJECT(dest, tx_backlog, self.tx_backlog_diff.changed);
+    INSERT_INTO_JSON_OBJECT(dest, tx_backlog_removed, self.tx_backlog_diff.removed);
+    dest.EndObject();
+  }
+
+  void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const block_stats& wrapper)
+  {
+    const cryptonote::block_processing_stats& self = wrapper.stats;
+    dest.StartObject();
+    INSERT_INTO_JSON_OBJECT(dest, height, self.height);
+    INSERT_INTO_JSON_OBJECT(dest, id, self.id);
+    INSERT_INTO_JSON_OBJECT(dest, timestamp, self.timestamp);
+    INSERT_INTO_JSON_OBJECT(dest, n_txs, self.n_txs);
+    INSERT_INTO_JSON_OBJECT(dest, difficulty_us, self.difficulty_us);
+    INSERT_INTO_JSON_OBJECT(dest, pow_us, self.pow_us);
+    INSERT_INTO_JSON_OBJECT(dest, tx_inputs_us, self.tx_inputs_us);
+    INSERT_INTO_JSON_OBJECT(dest, rct_batch_us, self.rct_batch_us);
+    INSERT_INTO_JSON_OBJECT(dest, miner_tx_us, self.miner_tx_us);
+    INSERT_INTO_JSON_OBJECT(dest, protocol_tx_us, self.protocol_tx_us);
+    INSERT_INTO_JSON_OBJECT(dest, payouts_us, self.payouts_us);
+    INSERT_INTO_JSON_OBJECT(dest, db_add_us, self.db_add_us);
+    INSERT_INTO_JSON_OBJECT(dest, ybi_us, self.ybi_us);
+    INSERT_INTO_JSON_OBJECT(dest, total_us, self.total_us);
+    dest.EndObject();
+  }
+
   void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const minimal_txpool& self)
   {
     dest.StartObject();
@@ -198,11 +270,63 @@ namespace
     json_pub(buf, minimal_chain{height, blocks});
   }
 
-  void json_miner_data(epee::byte_stream& buf, uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, cryptonote::difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<cryptonote::tx_block_template_backlog_entry>& tx_backlog)
+  void json_miner_data(epee::byte_stream& buf, uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, cryptonote::difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<cryptonote::tx_block_template_backlog_entry>& tx_backlog, const cryptonote::tx_block_template_backlog_diff& tx_backlog_diff)
   {
     json_pub(buf, miner_data{major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog});
   }
 
+  /*! The backlog is sent as changes since the previous miner_data, see
+      `backlog_base_version`. Subscribers that missed one, or joined late,
+      catch up with the `get_miner_data` RPC and `since_backlog_version`. */
+  void json_minimal_miner_data(epee::byte_stream& buf, uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, cryptonote::difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<cryptonote::tx_block_template_backlog_entry>& tx_backlog, const cryptonote::tx_block_template_backlog_diff& tx_backlog_diff)
+  {
+    const miner_data data{major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog};
+    json_pub(buf, minimal_miner_data{data, tx_backlog_diff});
+  }
+
+  void json_block_stats(epee::byte_stream& buf, const cryptonote::block_processing_stats& stats)
+  {
+    json_pub(buf, block_stats{stats});
+  }
+
+  /* Binary topics are `name:` followed by varint fields. Chain topics start
+     with the first height and the block count, then one varint length
+     prefixed blob per block. */
+
+  void bin_chain_header(epee::byte_stream& buf, const std::uint64_t height, const epee::span<const cryptonote::block> blocks)
+  {
+    write_varint(buf, height);
+    write_varint(buf, blocks.size());
+  }
+
+  void bin_full_chain(epee::byte_stream& buf, const std::uint64_t height, const epee::span<const cryptonote::block> blocks)
+  {
+    bin_chain_header(buf, height, blocks);
+    for (const cryptonote::block& bl : blocks)
+      write_blob(buf, cryptonote::block_to_blob(bl));
+  }
+
+  //! Blob is empty for blocks without a pricing record
+  void bin_pricing_record_chain(epee::byte_stream& buf, const std::uint64_t height, const epee::span<const cryptonote::block> blocks)
+  {
+    bin_chain_header(buf, height, blocks);
+    for (const cryptonote::block& bl : blocks)
+    {
+      if (bl.major_version < HF_VERSION_ENABLE_ORACLE || bl.pricing_record.empty())
+        write_varint(buf, 0);
+      else
+        write_blob(buf, cryptonote::t_serializable_object_to_blob(bl.pricing_record));
+    }
+  }
+
+  //! The protocol tx carries the conversion, yield and audit payouts of each block
+  void bin_protocol_tx_chain(epee::byte_stream& buf, const std::uint64_t height, const epee::span<const cryptonote::block> blocks)
+  {
+    bin_chain_header(buf, height, blocks);
+    for (const cryptonote::block& bl : blocks)
+      write_blob(buf, cryptonote::tx_to_blob(bl.protocol_tx));
+  }
+
   // boost::adaptors are in place "views" - no copy/move takes place
   // moving transactions (via sort, etc.), is expensive!
 
@@ -226,19 +350,40 @@ namespace
     json_pub(buf, (txes | adapt::filtered(is_valid{}) | adapt::transformed(to_minimal_tx)));
   }
 
-  constexpr const std::array<context<chain_writer>, 2> chain_contexts =
+  //! Varint tx count, then one varint length prefixed blob per valid tx
+  void bin_full_txpool(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    write_varint(buf, std::count_if(txes.begin(), txes.end(), is_valid{}));
+    for (const cryptonote::txpool_event& event : txes)
+    {
+      if (is_valid{}(event))
+        write_blob(buf, cryptonote::tx_to_blob(event.tx));
+    }
+  }
+
+  constexpr const std::array<context<chain_writer>, 5> chain_contexts =
   {{
+    {u8"bin-full-chain_main", bin_full_chain},
+    {u8"bin-pricing_record-chain_main", bin_pricing_record_chain},
+    {u8"bin-protocol_tx-chain_main", bin_protocol_tx_chain},
     {u8"json-full-chain_main", json_full_chain},
     {u8"json-minimal-chain_main", json_minimal_chain}
   }};
 
-  constexpr const std::array<context<miner_writer>, 1> miner_contexts =
+  constexpr const std::array<context<miner_writer>, 2> miner_contexts =
   {{
     {u8"json-full-miner_data", json_miner_data},
+    {u8"json-minimal-miner_data", json_minimal_miner_data},
+  }};
+
+  constexpr const std::array<context<stats_writer>, 1> stats_contexts =
+  {{
+    {u8"json-full-block_stats", json_block_stats},
   }};
 
-  constexpr const std::array<context<txpool_writer>, 2> txpool_contexts =
+  constexpr const std::array<context<txpool_writer>, 3> txpool_contexts =
   {{
+    {u8"bin-full-txpool_add", bin_full_txpool},
     {u8"json-full-txpool_add", json_full_txpool},
     {u8"json-minimal-txpool_add", json_minimal_txpool}
   }};
@@ -326,7 +471,7 @@ namespace
     return count;
   }
 
-  expect<bool> relay_block_pub(void* const relay, void* const pub) noexcept
+  expect<relay_event> relay_block_pub(void* const relay, void* const pub) noexcept
   {
     zmq_msg_t msg;
     zmq_msg_init(std::addressof(msg));
@@ -337,20 +482,21 @@ namespace
       zmq_msg_size(std::addressof(msg))
     };
 
-    if (payload == txpool_signal)
+    if (payload == txpool_signal || payload == chain_signal)
     {
+      const bool txpool = (payload == txpool_signal);
       zmq_msg_close(std::addressof(msg));
-      return false;
+      return txpool ? relay_event::txpool : relay_event::chain;
     }
 
-    // forward block messages (serialized on P2P thread for now)
+    // forward miner data and block stats messages (serialized on the notifying thread)
     const expect<void> sent = net::zmq::retry_op(zmq_msg_send, std::addressof(msg), pub, ZMQ_DONTWAIT);
     if (!sent)
     {
       zmq_msg_close(std::addressof(msg));
       return sent.error();
     }
-    return true;
+    return relay_event::forwarded;
   }
 } // anonymous
 
@@ -359,8 +505,11 @@ namespace cryptonote { namespace listener
 
 zmq_pub::zmq_pub(void* context)
   : relay_(),
+    txes_(),
+    chains_(),
     chain_subs_{{0}},
     miner_subs_{{0}},
+    stats_subs_{{0}},
     txpool_subs_{{0}},
     sync_()
 {
@@ -369,6 +518,7 @@ zmq_pub::zmq_pub(void* context)
 
   verify_sorted(chain_contexts, "chain_contexts");
   verify_sorted(miner_contexts, "miner_contexts");
+  verify_sorted(stats_contexts, "stats_contexts");
   verify_sorted(txpool_contexts, "txpool_contexts");
 
   relay_.reset(zmq_socket(context, ZMQ_PAIR));
@@ -390,12 +540,14 @@ bool zmq_pub::sub_request(boost::string_ref message)
 
     const auto chain_range = get_range(chain_contexts, message);
     const auto miner_range = get_range(miner_contexts, message);
+    const auto stats_range = get_range(stats_contexts, message);
     const auto txpool_range = get_range(txpool_contexts, message);
 
-    if (!chain_range.empty() || !miner_range.empty() || !txpool_range.empty())
+    if (!chain_range.empty() || !miner_range.empty() || !stats_range.empty() || !txpool_range.empty())
     {
       MDEBUG("Client " << (tag ? "subscribed" : "unsubscribed") << " to " <<
-             chain_range.size() << " chain topic(s), " << miner_range.size() << " miner topic(s) and " << txpool_range.size() << " txpool topic(s)");
+             chain_range.size() << " chain topic(s), " << miner_range.size() << " miner topic(s), " <<
+             stats_range.size() << " block stats topic(s) and " << txpool_range.size() << " txpool topic(s)");
 
       const boost::lock_guard<boost::mutex> lock{sync_};
       switch (tag)
@@ -403,11 +555,13 @@ bool zmq_pub::sub_request(boost::string_ref message)
       case 0:
         remove_subscriptions(chain_subs_, chain_range, chain_contexts.begin());
         remove_subscriptions(miner_subs_, miner_range, miner_contexts.begin());
+        remove_subscriptions(stats_subs_, stats_range, stats_contexts.begin());
         remove_subscriptions(txpool_subs_, txpool_range, txpool_contexts.begin());
         return true;
       case 1:
         add_subscriptions(chain_subs_, chain_range, chain_contexts.begin());
         add_subscriptions(miner_subs_, miner_range, miner_contexts.begin());
+        add_subscriptions(stats_subs_, stats_range, stats_contexts.begin());
         add_subscriptions(txpool_subs_, txpool_range, txpool_contexts.begin());
         return true;
       default:
@@ -421,16 +575,33 @@ bool zmq_pub::sub_request(boost::string_ref message)
 
 bool zmq_pub::relay_to_pub(void* const relay, void* const pub)
 {
-  const expect<bool> relayed = relay_block_pub(relay, pub);
+  const expect<relay_event> relayed = relay_block_pub(relay, pub);
   if (!relayed)
   {
     MERROR("Error relaying ZMQ/Pub: " << relayed.error().message());
     return false;
   }
 
-  if (!*relayed)
+  if (*relayed == relay_event::chain)
   {
-    std::array<std::size_t, 2> subs;
+    decltype(chain_subs_) subs;
+    chain_event event;
+    {
+      const boost::lock_guard<boost::mutex> lock{sync_};
+      if (chains_.empty())
+        return false;
+
+      subs = chain_subs_;
+      event = std::move(chains_.front());
+      chains_.pop_front();
+    }
+    auto messages = make_pubs(subs, chain_contexts, event.height, epee::to_span(event.blocks));
+    send_messages(pub, messages);
+    MDEBUG("Sent chain_main ZMQ/Pub");
+  }
+  else if (*relayed == relay_event::txpool)
+  {
+    decltype(txpool_subs_) subs;
     std::vector<cryptonote::txpool_event> events;
     {
       const boost::lock_guard<boost::mutex> lock{sync_};
@@ -446,7 +617,7 @@ bool zmq_pub::relay_to_pub(void* const relay, void* const pub)
     MDEBUG("Sent txpool ZMQ/Pub");
   }
   else
-    MDEBUG("Sent chain_main ZMQ/Pub");
+    MDEBUG("Sent miner_data or block_stats ZMQ/Pub");
 
   return true;
 }
@@ -456,8 +627,10 @@ std::size_t zmq_pub::send_chain_main(const std::uint64_t height, const epee::spa
   if (blocks.empty())
     return 0;
 
-  /* Block format only sends one block at a time - multiple block notifications
-     are less common and only occur on rollbacks. */
+  /* cryptonote_core/blockchain.cpp cannot "give" us the block like core
+     does for txpool events. Copying the blocks is still much cheaper than
+     serializing them, so the copy is handed to the ZMQ thread and every
+     topic is serialized there, once, keeping block processing unblocked. */
 
   boost::unique_lock<boost::mutex> guard{sync_};
 
@@ -468,19 +641,20 @@ std::size_t zmq_pub::send_chain_main(const std::uint64_t height, const epee::spa
   {
     if (sub)
     {
-      /* cryptonote_core/blockchain.cpp cannot "give" us the block like core
-         does for txpool events. Since copying the block is expensive anyway,
-         serialization is done right here on the p2p thread (for now). */
-
-        auto messages = make_pubs(subs_copy, chain_contexts, height, blocks);
-        guard.lock();
-        return send_messages(relay_.get(), messages);
+      chain_event event{height, {blocks.begin(), blocks.end()}};
+      guard.lock();
+      const expect<void> sent = net::zmq::retry_op(zmq_send_const, relay_.get(), chain_signal, sizeof(chain_signal) - 1, ZMQ_DONTWAIT);
+      if (sent)
+        chains_.emplace_back(std::move(event));
+      else
+        MERROR("ZMQ/Pub failure, relay queue error: " << sent.error().message());
+      return bool(sent);
     }
   }
   return 0;
 }
 
-std::size_t zmq_pub::send_miner_data(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog)
+std::size_t zmq_pub::send_miner_data(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog, const tx_block_template_backlog_diff& tx_backlog_diff)
 {
   boost::unique_lock<boost::mutex> guard{sync_};
 
@@ -491,7 +665,7 @@ std::size_t zmq_pub::send_miner_data(uint8_t major_version, uint64_t height, con
   {
     if (sub)
     {
-        auto messages = make_pubs(subs_copy, miner_contexts, major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog);
+        auto messages = make_pubs(subs_copy, miner_contexts, major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog, tx_backlog_diff);
         guard.lock();
         return send_messages(relay_.get(), messages);
     }
@@ -499,6 +673,25 @@ std::size_t zmq_pub::send_miner_data(uint8_t major_version, uint64_t height, con
   return 0;
 }
 
+std::size_t zmq_pub::send_block_stats(const cryptonote::block_processing_stats& stats)
+{
+  boost::unique_lock<boost::mutex> guard{sync_};
+
+  const auto subs_copy = stats_subs_;
+  guard.unlock();
+
+  for (const std::size_t sub : subs_copy)
+  {
+    if (sub)
+    {
+      auto messages = make_pubs(subs_copy, stats_contexts, stats);
+      guard.lock();
+      return send_messages(relay_.get(), messages);
+    }
+  }
+  return 0;
+}
+
 std::size_t zmq_pub::send_txpool_add(std::vector<txpool_event> txes)
 {
   if (txes.empty())
@@ -529,11 +722,20 @@ void zmq_pub::chain_main::operator()(const std::uint64_t height, epee::span<cons
     MERROR("Unable to send ZMQ/Pub - ZMQ server destroyed");
 }
 
-void zmq_pub::miner_data::operator()(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog) const
+void zmq_pub::miner_data::operator()(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog, const tx_block_template_backlog_diff& tx_backlog_diff) const
+{
+  const std::shared_ptr<zmq_pub> self = self_.lock();
+  if (self)
+    self->send_miner_data(major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog, tx_backlog_diff);
+  else
+    MERROR("Unable to send ZMQ/Pub - ZMQ server destroyed");
+}
+
+void zmq_pub::block_stats::operator()(const cryptonote::block_processing_stats& stats) const
 {
   const std::shared_ptr<zmq_pub> self = self_.lock();
   if (self)
-    self->send_miner_data(major_version, height, prev_id, seed_hash, diff, median_weight, already_generated_coins, tx_backlog);
+    self->send_block_stats(stats);
   else
     MERROR("Unable to send ZMQ/Pub - ZMQ server destroyed");
 }
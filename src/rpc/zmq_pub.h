@@ -58,11 +58,20 @@ class zmq_pub
      the messages being published are not guaranteed to be in the same order
      pushed. */
 
+    //! Copy of a main chain change, serialized on the ZMQ thread.
+    struct chain_event
+    {
+      std::uint64_t height;
+      std::vector<cryptonote::block> blocks;
+    };
+
     net::zmq::socket relay_;
     std::deque<std::vector<txpool_event>> txes_;
-    std::array<std::size_t, 2> chain_subs_;
-    std::array<std::size_t, 1> miner_subs_;
-    std::array<std::size_t, 2> txpool_subs_;
+    std::deque<chain_event> chains_;
+    std::array<std::size_t, 5> chain_subs_;
+    std::array<std::size_t, 2> miner_subs_;
+    std::array<std::size_t, 1> stats_subs_;
+    std::array<std::size_t, 3> txpool_subs_;
     boost::mutex sync_; //!< Synchronizes counts in `*_subs_` arrays.
 
   public:
@@ -82,8 +91,9 @@ class zmq_pub
     //! Process a client subscription request (from XPUB sockets). Thread-safe.
     bool sub_request(const boost::string_ref message);
 
-    /*! Forward ZMQ messages sent to `relay` via `send_chain_main` or
-      `send_txpool_add` to `pub`. Used by `ZmqServer`. */
+    /*! Serialize events queued by `send_chain_main` or `send_txpool_add`,
+      or forward ZMQ messages sent to `relay`, to `pub`. Used by
+      `ZmqServer`. */
     bool relay_to_pub(void* relay, void* pub);
 
     /*! Send a `ZMQ_PUB` notification for a change to the main chain.
@@ -91,10 +101,16 @@ class zmq_pub
         \return Number of ZMQ messages sent to relay. */
     std::size_t send_chain_main(std::uint64_t height, epee::span<const cryptonote::block> blocks);
 
-    /*! Send a `ZMQ_PUB` notification for a new miner data.
+    /*! Send a `ZMQ_PUB` notification for a new miner data. `tx_backlog_diff`
+        holds the changes to `tx_backlog` since the previous notification.
         Thread-safe.
         \return Number of ZMQ messages sent to relay. */
-    std::size_t send_miner_data(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog);
+    std::size_t send_miner_data(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog, const tx_block_template_backlog_diff& tx_backlog_diff);
+
+    /*! Send a `ZMQ_PUB` notification with the timing breakdown of a block
+        added to the main chain. Thread-safe.
+        \return Number of ZMQ messages sent to relay. */
+    std::size_t send_block_stats(const cryptonote::block_processing_stats& stats);
 
     /*! Send a `ZMQ_PUB` notification for new tx(es) being added to the local
         pool. Thread-safe.
@@ -112,7 +128,14 @@ class zmq_pub
     struct miner_data
     {
       std::weak_ptr<zmq_pub> self_;
-      void operator()(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog) const;
+      void operator()(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog, const tx_block_template_backlog_diff& tx_backlog_diff) const;
+    };
+
+    //! Callable for `send_block_stats` with weak ownership to `zmq_pub` object.
+    struct block_stats
+    {
+      std::weak_ptr<zmq_pub> self_;
+      void operator()(const cryptonote::block_processing_stats& stats) const;
     };
 
     //! Callable for `send_txpool_add` with weak ownership to `zmq_pub` object.
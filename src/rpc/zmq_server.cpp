@@ -30,6 +30,7 @@
 
 #include <chrono>
 #include <cstring>
+#include <limits>
 #include <utility>
 #include <stdexcept>
 #include <system_error>
@@ -48,8 +49,11 @@ namespace
   constexpr const int num_zmq_threads = 1;
   constexpr const std::int64_t max_message_size = 10 * 1024 * 1024; // 10 MiB
   constexpr const std::chrono::seconds linger_timeout{2}; // wait period for pending out messages
+  constexpr const int pub_send_hwm = 256; // per subscriber, in messages
+  constexpr const char workers_endpoint[] = "inproc://zmq_rpc_workers";
+  constexpr const std::size_t no_socket = std::numeric_limits<std::size_t>::max();
 
-  net::zmq::socket init_socket(void* context, int type, epee::span<const std::string> addresses)
+  net::zmq::socket init_socket(void* context, int type, epee::span<const std::string> addresses, const int send_hwm = 0)
   {
     if (context == nullptr)
       throw std::logic_error{"NULL context provided"};
@@ -75,6 +79,15 @@ namespace
       return nullptr;
     }
 
+    /* A XPUB socket has one queue per subscriber; once it fills, messages to
+       that subscriber are dropped instead of queueing without bound. Must be
+       set before binding to apply to every subscriber. */
+    if (send_hwm && zmq_setsockopt(out.get(), ZMQ_SNDHWM, std::addressof(send_hwm), sizeof(send_hwm)) != 0)
+    {
+      MONERO_LOG_ZMQ_ERROR("Failed to set send high water mark");
+      return nullptr;
+    }
+
     for (const std::string& address : addresses)
     {
       if (zmq_bind(out.get(), address.c_str()) < 0)
@@ -87,6 +100,34 @@ namespace
 
     return out;
   }
+
+  //! Move every frame of one message, the ROUTER envelope included, from `source` to `destination`
+  void forward_message(void* source, void* destination)
+  {
+    for (;;)
+    {
+      zmq_msg_t part;
+      if (zmq_msg_init(std::addressof(part)) != 0)
+        MONERO_ZMQ_THROW("zmq_msg_init failed");
+      if (zmq_msg_recv(std::addressof(part), source, ZMQ_DONTWAIT) < 0)
+      {
+        const std::error_code error = net::zmq::get_error_code();
+        zmq_msg_close(std::addressof(part));
+        if (error == net::zmq::make_error_code(EAGAIN))
+          return;
+        MONERO_THROW(error, "Read failure on ZMQ-RPC");
+      }
+      const bool more = zmq_msg_more(std::addressof(part));
+      if (zmq_msg_send(std::addressof(part), destination, more ? ZMQ_SNDMORE : 0) < 0)
+      {
+        const std::error_code error = net::zmq::get_error_code();
+        zmq_msg_close(std::addressof(part));
+        MONERO_THROW(error, "Write failure on ZMQ-RPC");
+      }
+      if (!more)
+        return;
+    }
+  }
 } // anonymous
 
 namespace rpc
@@ -96,6 +137,8 @@ ZmqServer::ZmqServer(RpcHandler& h) :
     handler(h),
     context(zmq_init(num_zmq_threads)),
     rep_socket(nullptr),
+    dealer_socket(nullptr),
+    worker_sockets(),
     pub_socket(nullptr),
     relay_socket(nullptr),
     shared_state(nullptr)
@@ -114,6 +157,7 @@ void ZmqServer::serve()
   {
     // socket must close before `zmq_term` will exit.
     const net::zmq::socket rep = std::move(rep_socket);
+    const net::zmq::socket dealer = std::move(dealer_socket);
     const net::zmq::socket pub = std::move(pub_socket);
     const net::zmq::socket relay = std::move(relay_socket);
     const std::shared_ptr<listener::zmq_pub> state = std::move(shared_state);
@@ -127,18 +171,30 @@ void ZmqServer::serve()
 
     MINFO("ZMQ Server started");
 
-    const int read_flags = pub ? ZMQ_DONTWAIT : 0;
-    std::array<zmq_pollitem_t, 3> sockets =
-    {{
-      {relay.get(), 0, ZMQ_POLLIN, 0},
-      {pub.get(), 0, ZMQ_POLLIN, 0},
-      {rep.get(), 0, ZMQ_POLLIN, 0}
-    }};
+    std::vector<zmq_pollitem_t> sockets;
+    const auto add_poll = [&sockets] (void* socket) -> std::size_t
+    {
+      if (!socket)
+        return no_socket;
+      sockets.push_back({socket, 0, ZMQ_POLLIN, 0});
+      return sockets.size() - 1;
+    };
+    const std::size_t relay_index = add_poll(relay.get());
+    const std::size_t pub_index = add_poll(pub.get());
+    const std::size_t rep_index = add_poll(rep.get());
+    const std::size_t dealer_index = add_poll(dealer.get());
+    const auto readable = [&sockets] (const std::size_t index)
+    {
+      return index != no_socket && sockets[index].revents;
+    };
+
+    // a lone REP socket is read blocking, there is nothing else to wait on
+    const bool poll = sockets.size() > 1;
+    const int read_flags = poll ? ZMQ_DONTWAIT : 0;
 
     /* This uses XPUB to watch for subscribers, to reduce CPU cycles for
-       serialization when the data will be dropped. This is important for block
-       serialization, which is done on the p2p threads currently (see
-       zmq_pub.cpp).
+       serialization when the data will be dropped. Block and txpool topics are
+       serialized on this thread (see zmq_pub.cpp).
 
        XPUB sockets are not thread-safe, so the p2p thread cannot write into
        the socket while we read here for subscribers. A ZMQ_PAIR socket is
@@ -147,16 +203,24 @@ void ZmqServer::serve()
 
     while (1)
     {
-      if (pub)
+      if (poll)
         MONERO_UNWRAP(net::zmq::retry_op(zmq_poll, sockets.data(), sockets.size(), -1));
 
-      if (sockets[0].revents)
+      if (readable(relay_index))
         state->relay_to_pub(relay.get(), pub.get());
 
-      if (sockets[1].revents)
+      if (readable(pub_index))
         state->sub_request(MONERO_UNWRAP(net::zmq::receive(pub.get(), ZMQ_DONTWAIT)));
 
-      if (!pub || sockets[2].revents)
+      if (dealer)
+      {
+        // requests and replies only pass through, the workers handle them
+        if (readable(rep_index))
+          forward_message(rep.get(), dealer.get());
+        if (readable(dealer_index))
+          forward_message(dealer.get(), rep.get());
+      }
+      else if (!poll || readable(rep_index))
       {
         expect<std::string> message = net::zmq::receive(rep.get(), read_flags);
         if (!message)
@@ -192,7 +256,39 @@ void ZmqServer::serve()
   }
 }
 
-void* ZmqServer::init_rpc(boost::string_ref address, boost::string_ref port)
+void ZmqServer::work(const std::size_t index)
+{
+  try
+  {
+    // socket must close before `zmq_term` will exit.
+    const net::zmq::socket rep = std::move(worker_sockets[index]);
+    while (1)
+    {
+      expect<std::string> message = net::zmq::receive(rep.get());
+      if (!message)
+        MONERO_THROW(message.error(), "Read failure on ZMQ-RPC worker");
+
+      MDEBUG("Received RPC request: \"" << *message << "\"");
+      epee::byte_slice response = handler.handle(std::move(*message));
+      MONERO_UNWRAP(net::zmq::send(std::move(response), rep.get()));
+    }
+  }
+  catch (const std::system_error& e)
+  {
+    if (e.code() != net::zmq::make_error_code(ETERM))
+      MERROR("ZMQ RPC worker error: " << e.what());
+  }
+  catch (const std::exception& e)
+  {
+    MERROR("ZMQ RPC worker error: " << e.what());
+  }
+  catch (...)
+  {
+    MERROR("Unknown error in ZMQ RPC worker");
+  }
+}
+
+void* ZmqServer::init_rpc(boost::string_ref address, boost::string_ref port, const unsigned threads)
 {
   if (!context)
   {
@@ -210,8 +306,38 @@ void* ZmqServer::init_rpc(boost::string_ref address, boost::string_ref port)
   bind_address += ":";
   bind_address.append(port.data(), port.size());
 
-  rep_socket = init_socket(context.get(), ZMQ_REP, {std::addressof(bind_address), 1});
-  return bool(rep_socket) ? context.get() : nullptr;
+  if (threads <= 1)
+  {
+    rep_socket = init_socket(context.get(), ZMQ_REP, {std::addressof(bind_address), 1});
+    return bool(rep_socket) ? context.get() : nullptr;
+  }
+
+  rep_socket = init_socket(context.get(), ZMQ_ROUTER, {std::addressof(bind_address), 1});
+  const std::string workers_address[] = {workers_endpoint};
+  dealer_socket = init_socket(context.get(), ZMQ_DEALER, workers_address);
+  if (!rep_socket || !dealer_socket)
+  {
+    rep_socket = nullptr;
+    dealer_socket = nullptr;
+    return nullptr;
+  }
+
+  // inproc endpoints must be bound before they are connected to
+  worker_sockets.clear();
+  for (unsigned i = 0; i < threads; ++i)
+  {
+    worker_sockets.push_back(init_socket(context.get(), ZMQ_REP, {}));
+    if (!worker_sockets.back() || zmq_connect(worker_sockets.back().get(), workers_endpoint) != 0)
+    {
+      MONERO_LOG_ZMQ_ERROR("Failed to connect ZMQ RPC worker");
+      worker_sockets.clear();
+      rep_socket = nullptr;
+      dealer_socket = nullptr;
+      return nullptr;
+    }
+  }
+  MINFO("ZMQ RPC requests are handled by " << threads << " workers");
+  return context.get();
 }
 
 std::shared_ptr<listener::zmq_pub> ZmqServer::init_pub(epee::span<const std::string> addresses)
@@ -219,7 +345,7 @@ std::shared_ptr<listener::zmq_pub> ZmqServer::init_pub(epee::span<const std::str
   try
   {
     shared_state = std::make_shared<listener::zmq_pub>(context.get());
-    pub_socket = init_socket(context.get(), ZMQ_XPUB, addresses);
+    pub_socket = init_socket(context.get(), ZMQ_XPUB, addresses, pub_send_hwm);
     if (!pub_socket)
       throw std::runtime_error{"Unable to initialize ZMQ_XPUB socket"};
 
@@ -243,6 +369,8 @@ std::shared_ptr<listener::zmq_pub> ZmqServer::init_pub(epee::span<const std::str
 void ZmqServer::run()
 {
   run_thread = boost::thread(boost::bind(&ZmqServer::serve, this));
+  for (std::size_t i = 0; i < worker_sockets.size(); ++i)
+    worker_threads.emplace_back(boost::bind(&ZmqServer::work, this, i));
 }
 
 void ZmqServer::stop()
@@ -252,6 +380,9 @@ void ZmqServer::stop()
 
   context.reset(); // destroying context terminates all calls
   run_thread.join();
+  for (boost::thread& worker : worker_threads)
+    worker.join();
+  worker_threads.clear();
 }
 
 }  // namespace cryptonote
@@ -33,6 +33,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "common/command_line.h"
 #include "cryptonote_basic/fwd.h"
@@ -57,8 +58,12 @@ class ZmqServer final
 
     void serve();
 
-    //! \return ZMQ context on success, `nullptr` on failure
-    void* init_rpc(boost::string_ref address, boost::string_ref port);
+    /*! With more than one thread, requests arrive on a ROUTER socket and are
+        handed to `threads` workers over an inproc DEALER, so they are handled
+        concurrently. One thread keeps a single REP socket.
+
+        \return ZMQ context on success, `nullptr` on failure */
+    void* init_rpc(boost::string_ref address, boost::string_ref port, unsigned threads = 1);
 
     //! \return `nullptr` on errors.
     std::shared_ptr<listener::zmq_pub> init_pub(epee::span<const std::string> addresses);
@@ -67,13 +72,18 @@ class ZmqServer final
     void stop();
 
   private:
+    void work(std::size_t index);
+
     RpcHandler& handler;
 
     net::zmq::context context;
 
     boost::thread run_thread;
+    std::vector<boost::thread> worker_threads;
 
     net::zmq::socket rep_socket;
+    net::zmq::socket dealer_socket;
+    std::vector<net::zmq::socket> worker_sockets;
     net::zmq::socket pub_socket;
     net::zmq::socket relay_socket;
     std::shared_ptr<listener::zmq_pub> shared_state;
@@ -150,6 +150,15 @@ struct binary_archive<false> : public binary_archive_base<false>
     bytes_ = {current, std::size_t(bytes_.cend() - current)};
   }
 
+  //! reads cnt varints in one pass, see tools::read_varint_array
+  void serialize_uvarint_array(std::uint64_t *v, std::size_t cnt)
+  {
+    auto current = bytes_.cbegin();
+    good_ &= tools::read_varint_array(current, bytes_.cend(), v, cnt);
+    current = std::min(current, bytes_.cend());
+    bytes_ = {current, std::size_t(bytes_.cend() - current)};
+  }
+
   void begin_array(size_t &s)
   {
     serialize_varint(s);
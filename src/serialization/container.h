@@ -28,6 +28,9 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+template <bool W>
+struct binary_archive;
+
 namespace serialization
 {
   namespace detail
@@ -59,6 +62,65 @@ namespace serialization
 
     template <typename C>
     void do_reserve(C &c, size_t N) {}
+
+    //! element types whose binary encoding is exactly their in-memory bytes
+    template<typename T>
+    inline constexpr bool is_blob_element() noexcept
+    {
+      return is_blob_type<T>::type::value || (std::is_integral<T>::value && sizeof(T) == 1 && !std::is_same<T, bool>::value);
+    }
+
+    //! loads a whole container in one go if the archive and element type allow it
+    template <typename Archive, typename C>
+    bool load_container_bulk(Archive &ar, C &v, size_t cnt)
+    {
+      return false;
+    }
+
+    template <typename Archive, typename T>
+    typename std::enable_if<std::is_same<Archive, binary_archive<false>>::value && is_blob_element<T>(), bool>::type
+    load_container_bulk(Archive &ar, std::vector<T> &v, size_t cnt)
+    {
+      if (ar.remaining_bytes() / sizeof(T) < cnt)
+      {
+        ar.set_fail();
+        return true;
+      }
+      v.resize(cnt);
+      if (cnt)
+        ar.serialize_blob(v.data(), cnt * sizeof(T));
+      return true;
+    }
+
+    //! varint arrays, key offsets most of all, are decoded in one pass
+    template <typename Archive>
+    typename std::enable_if<std::is_same<Archive, binary_archive<false>>::value, bool>::type
+    load_container_bulk(Archive &ar, std::vector<std::uint64_t> &v, size_t cnt)
+    {
+      v.resize(cnt);
+      if (cnt)
+        ar.serialize_uvarint_array(v.data(), cnt);
+      return true;
+    }
+
+    //! deserializes straight into the container's storage where it can
+    template <typename Archive, typename C>
+    bool load_container_element(Archive &ar, C &v)
+    {
+      typename C::value_type e;
+      if (!serialize_container_element(ar, e))
+        return false;
+      do_add(v, std::move(e));
+      return true;
+    }
+
+    template <typename Archive, typename T>
+    typename std::enable_if<!std::is_same<T, bool>::value, bool>::type
+    load_container_element(Archive &ar, std::vector<T> &v)
+    {
+      v.emplace_back();
+      return serialize_container_element(ar, v.back());
+    }
   }
 }
 
@@ -77,15 +139,21 @@ bool do_serialize_container(Archive<false> &ar, C &v)
     return false;
   }
 
+  if (::serialization::detail::load_container_bulk(ar, v, cnt))
+  {
+    if (!ar.good())
+      return false;
+    ar.end_array();
+    return true;
+  }
+
   ::serialization::detail::do_reserve(v, cnt);
 
   for (size_t i = 0; i < cnt; i++) {
     if (i > 0)
       ar.delimit_array();
-    typename C::value_type e;
-    if (!::serialization::detail::serialize_container_element(ar, e))
+    if (!::serialization::detail::load_container_element(ar, v))
       return false;
-    ::serialization::detail::do_add(v, std::move(e));
     if (!ar.good())
       return false;
   }
@@ -53,14 +53,10 @@ bool do_serialize(Archive<false> &ar, std::vector<crypto::signature> &v)
     return false;
   }
 
-  v.reserve(cnt);
-  for (size_t i = 0; i < cnt; i++) {
-    v.resize(i+1);
-    ar.serialize_blob(&(v[i]), sizeof(crypto::signature), "");
-    if (!ar.good())
-      return false;
-  }
-  return true;
+  v.resize(cnt);
+  if (cnt)
+    ar.serialize_blob(v.data(), cnt * sizeof(crypto::signature), "");
+  return ar.good();
 }
 
 // write
@@ -151,8 +151,13 @@ void fromJsonValue(const rapidjson::Value& val, std::string& str)
 
 void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const std::vector<std::uint8_t>& src)
 {
-  const std::string hex = epee::to_hex::string(epee::to_span(src));
-  dest.String(hex.data(), hex.size());
+  // hex never needs escaping, so write it raw
+  std::string quoted;
+  quoted.resize(src.size() * 2 + 2);
+  quoted.front() = '"';
+  quoted.back() = '"';
+  epee::to_hex::buffer({&quoted[1], src.size() * 2}, epee::to_span(src));
+  dest.RawValue(quoted.data(), quoted.size(), rapidjson::kStringType);
 }
 
 void fromJsonValue(const rapidjson::Value& val, std::vector<std::uint8_t>& dest)
@@ -773,6 +778,68 @@ void fromJsonValue(const rapidjson::Value& val, cryptonote::tx_out& txout)
   }
 }
 
+void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::connection_command_traffic& traffic)
+{
+  dest.StartObject();
+
+  INSERT_INTO_JSON_OBJECT(dest, command, traffic.command);
+  INSERT_INTO_JSON_OBJECT(dest, recv_count, traffic.recv_count);
+  INSERT_INTO_JSON_OBJECT(dest, recv_bytes, traffic.recv_bytes);
+  INSERT_INTO_JSON_OBJECT(dest, send_count, traffic.send_count);
+  INSERT_INTO_JSON_OBJECT(dest, send_bytes, traffic.send_bytes);
+
+  dest.EndObject();
+}
+
+
+void fromJsonValue(const rapidjson::Value& val, cryptonote::connection_command_traffic& traffic)
+{
+  if (!val.IsObject())
+  {
+    throw WRONG_TYPE("json object");
+  }
+
+  GET_FROM_JSON_OBJECT(val, traffic.command, command);
+  GET_FROM_JSON_OBJECT(val, traffic.recv_count, recv_count);
+  GET_FROM_JSON_OBJECT(val, traffic.recv_bytes, recv_bytes);
+  GET_FROM_JSON_OBJECT(val, traffic.send_count, send_count);
+  GET_FROM_JSON_OBJECT(val, traffic.send_bytes, send_bytes);
+}
+
+void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::connection_compression_traffic& traffic)
+{
+  dest.StartObject();
+
+  INSERT_INTO_JSON_OBJECT(dest, send_count, traffic.send_count);
+  INSERT_INTO_JSON_OBJECT(dest, send_bytes, traffic.send_bytes);
+  INSERT_INTO_JSON_OBJECT(dest, send_wire_bytes, traffic.send_wire_bytes);
+  INSERT_INTO_JSON_OBJECT(dest, compress_us, traffic.compress_us);
+  INSERT_INTO_JSON_OBJECT(dest, recv_count, traffic.recv_count);
+  INSERT_INTO_JSON_OBJECT(dest, recv_bytes, traffic.recv_bytes);
+  INSERT_INTO_JSON_OBJECT(dest, recv_wire_bytes, traffic.recv_wire_bytes);
+  INSERT_INTO_JSON_OBJECT(dest, decompress_us, traffic.decompress_us);
+
+  dest.EndObject();
+}
+
+
+void fromJsonValue(const rapidjson::Value& val, cryptonote::connection_compression_traffic& traffic)
+{
+  if (!val.IsObject())
+  {
+    throw WRONG_TYPE("json object");
+  }
+
+  GET_FROM_JSON_OBJECT(val, traffic.send_count, send_count);
+  GET_FROM_JSON_OBJECT(val, traffic.send_bytes, send_bytes);
+  GET_FROM_JSON_OBJECT(val, traffic.send_wire_bytes, send_wire_bytes);
+  GET_FROM_JSON_OBJECT(val, traffic.compress_us, compress_us);
+  GET_FROM_JSON_OBJECT(val, traffic.recv_count, recv_count);
+  GET_FROM_JSON_OBJECT(val, traffic.recv_bytes, recv_bytes);
+  GET_FROM_JSON_OBJECT(val, traffic.recv_wire_bytes, recv_wire_bytes);
+  GET_FROM_JSON_OBJECT(val, traffic.decompress_us, decompress_us);
+}
+
 void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::connection_info& info)
 {
   dest.StartObject();
@@ -805,6 +872,11 @@ void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::c
   INSERT_INTO_JSON_OBJECT(dest, avg_upload, info.avg_upload);
   INSERT_INTO_JSON_OBJECT(dest, current_upload, info.current_upload);
 
+  INSERT_INTO_JSON_OBJECT(dest, command_traffic, info.command_traffic);
+
+  INSERT_INTO_JSON_OBJECT(dest, compression, info.compression);
+  INSERT_INTO_JSON_OBJECT(dest, compression_traffic, info.compression_traffic);
+
   dest.EndObject();
 }
 
@@ -843,6 +915,11 @@ void fromJsonValue(const rapidjson::Value& val, cryptonote::connection_info& inf
 
   GET_FROM_JSON_OBJECT(val, info.avg_upload, avg_upload);
   GET_FROM_JSON_OBJECT(val, info.current_upload, current_upload);
+
+  GET_FROM_JSON_OBJECT(val, info.command_traffic, command_traffic);
+
+  GET_FROM_JSON_OBJECT(val, info.compression, compression);
+  GET_FROM_JSON_OBJECT(val, info.compression_traffic, compression_traffic);
 }
 
 void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::tx_blob_entry& tx)
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <array>
 #include <boost/utility/string_ref.hpp>
 #include <cstring>
 #include <rapidjson/document.h>
@@ -130,12 +131,15 @@ inline typename std::enable_if<is_to_hex<Type>()>::type toJsonKey(rapidjson::Wri
   dest.Key(hex.data(), hex.size());
 }
 
-// POD to json value
+// POD to json value, written raw since hex never needs escaping
 template <class Type>
 inline typename std::enable_if<is_to_hex<Type>()>::type toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const Type& pod)
 {
-  const auto hex = epee::to_hex::array(pod);
-  dest.String(hex.data(), hex.size());
+  std::array<char, sizeof(Type) * 2 + 2> quoted;
+  quoted.front() = '"';
+  quoted.back() = '"';
+  epee::to_hex::buffer({quoted.data() + 1, sizeof(Type) * 2}, epee::as_byte_span(pod));
+  dest.RawValue(quoted.data(), quoted.size(), rapidjson::kStringType);
 }
 
 template <class Type>
@@ -242,6 +246,12 @@ void fromJsonValue(const rapidjson::Value& val, cryptonote::txout_to_carrot_v1&
 void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::tx_out& txout);
 void fromJsonValue(const rapidjson::Value& val, cryptonote::tx_out& txout);
 
+void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::connection_command_traffic& traffic);
+void fromJsonValue(const rapidjson::Value& val, cryptonote::connection_command_traffic& traffic);
+
+void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::connection_compression_traffic& traffic);
+void fromJsonValue(const rapidjson::Value& val, cryptonote::connection_compression_traffic& traffic);
+
 void toJsonValue(rapidjson::Writer<epee::byte_stream>& dest, const cryptonote::connection_info& info);
 void fromJsonValue(const rapidjson::Value& val, cryptonote::connection_info& info);
 
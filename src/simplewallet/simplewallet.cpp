@@ -321,6 +321,7 @@ namespace
   const char* USAGE_HELP("help [<command> | all]");
   const char* USAGE_APROPOS("apropos <keyword> [<keyword> ...]");
   const char* USAGE_SCAN_TX("scan_tx <txid> [<txid> ...]");
+  const char* USAGE_IMPORT_ENOTE_STREAM("import_enote_stream <filename>");
 
   std::string input_line(const std::string& prompt, bool yesno = false)
   {
@@ -3384,6 +3385,25 @@ bool simple_wallet::set_send_change_back_to_subaddress(const std::vector<std::st
   return true;
 }
 
+bool simple_wallet::set_store_cache_delta(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
+{
+  if (args.size() < 2)
+  {
+    fail_msg_writer() << tr("Value not specified");
+    return true;
+  }
+
+  const auto pwd_container = get_and_verify_password();
+  if (pwd_container)
+  {
+    parse_bool_and_use(args[1], [&](bool r) {
+      m_wallet->store_cache_delta(r);
+      m_wallet->rewrite(m_wallet_file, pwd_container->password());
+    });
+  }
+  return true;
+}
+
 bool simple_wallet::help(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
 {
   if(args.empty())
@@ -3505,6 +3525,37 @@ bool simple_wallet::scan_tx(const std::vector<std::string> &args)
   return true;
 }
 
+bool simple_wallet::import_enote_stream(const std::vector<std::string> &args)
+{
+  CHECK_IF_BACKGROUND_SYNCING("cannot import enote stream");
+  if (args.size() != 1)
+  {
+    PRINT_USAGE(USAGE_IMPORT_ENOTE_STREAM);
+    return true;
+  }
+
+  if (!m_wallet->is_trusted_daemon()) {
+    message_writer(console_color_red, true) << tr("WARNING: this operation may reveal the txids to the remote node and affect your privacy");
+    if (!command_line::is_yes(input_line("Do you want to continue?", true))) {
+      message_writer() << tr("You have canceled the operation");
+      return true;
+    }
+  }
+
+  LOCK_IDLE_SCOPE();
+  m_in_manual_refresh.store(true);
+  try {
+    const size_t scanned = m_wallet->import_enote_stream(args[0]);
+    success_msg_writer() << tr("Scanned ") << scanned << tr(" new transactions");
+  } catch (const tools::error::wont_reprocess_recent_txs_via_untrusted_daemon &e) {
+    fail_msg_writer() << e.what() << ". Either connect to a trusted daemon by passing --trusted-daemon when starting the wallet, or use rescan_bc to rescan the chain.";
+  } catch (const std::exception &e) {
+    fail_msg_writer() << e.what();
+  }
+  m_in_manual_refresh.store(false);
+  return true;
+}
+
 simple_wallet::simple_wallet()
   : m_refresh_progress_reporter(*this)
   , m_idle_run(true)
@@ -3754,7 +3805,9 @@ simple_wallet::simple_wallet()
                                   "freeze-incoming-payments <1|0>\n "
                                   "  Whether to have incoming payments automatically frozen, so they cannot be spent erroneously.\n"
                                   "send-change-back-to-subaddress <1|0>\n "
-                                  "  Whether to have change from transactions sent back subaddresses (1) or to main address (0) (ignored for AUDIT commands)."));
+                                  "  Whether to have change from transactions sent back subaddresses (1) or to main address (0) (ignored for AUDIT commands).\n"
+                                  "store-cache-delta <1|0>\n "
+                                  "  Whether to save only the changes to the wallet cache to a .delta file, rewriting the full cache when the changes grow large. Older versions ignore the .delta file."));
   m_cmd_binder.set_handler("encrypted_seed",
                            boost::bind(&simple_wallet::on_command, this, &simple_wallet::encrypted_seed, _1),
                            tr("Display the encrypted Electrum-style mnemonic seed."));
@@ -3811,7 +3864,8 @@ simple_wallet::simple_wallet()
                               "Pending or Failed:               \"failed\"|\"pending\", \"out\", Time, Amount*, Transaction Hash, Payment ID, Fee, Input addresses**,               \"-\", Note\n"
                               "Staked or Burnt:   Block Number, \"out\",                     Time, Amount*, Asset Type, Transaction Hash, Payment ID, Fee, Input addresses**,               \"-\", Note\n\n"
                               "* Excluding change and fee.\n"
-                              "** Set of address indices used as inputs in this transfer."));
+                              "** Set of address indices used as inputs in this transfer.\n\n"
+                              "In a terminal, long listings are shown 100 transfers at a time."));
   m_cmd_binder.set_handler("export_transfers",
                            boost::bind(&simple_wallet::on_command, this, &simple_wallet::export_transfers, _1),
                            tr("export_transfers [in|out|all|pending|failed|pool|coinbase|burnt|staked|yield] [index=<N1>[,<N2>,...]] [<min_height> [<max_height>]] [output=<filepath>] [option=<with_keys>]"),
@@ -4098,6 +4152,10 @@ simple_wallet::simple_wallet()
                            boost::bind(&simple_wallet::on_command, this, &simple_wallet::scan_tx, _1),
                            tr(USAGE_SCAN_TX),
                            tr("Scan the transactions given by <txid>(s), processing them and looking for outputs"));
+ m_cmd_binder.set_handler("import_enote_stream",
+                           boost::bind(&simple_wallet::on_command, this, &simple_wallet::import_enote_stream, _1),
+                           tr(USAGE_IMPORT_ENOTE_STREAM),
+                           tr("Scan the transactions in which salvium-blockchain-enote-scanner found outputs, as written to <filename>"));
   m_cmd_binder.set_unknown_command_handler(boost::bind(&simple_wallet::on_command, this, &simple_wallet::on_unknown_command, _1));
   m_cmd_binder.set_empty_command_handler(boost::bind(&simple_wallet::on_empty_command, this));
   m_cmd_binder.set_cancel_handler(boost::bind(&simple_wallet::on_cancelled_command, this));
@@ -4173,6 +4231,7 @@ bool simple_wallet::set_variable(const std::vector<std::string> &args)
     success_msg_writer() << "enable-multisig-experimental = " << m_wallet->is_multisig_enabled();
     success_msg_writer() << "freeze-incoming-payments = " << m_wallet->is_freeze_incoming_payments_enabled();
     success_msg_writer() << "send-change-back-to-subaddress = " << m_wallet->is_send_change_back_to_subaddress_enabled();
+    success_msg_writer() << "store-cache-delta = " << m_wallet->is_store_cache_delta_enabled();
     return true;
   }
   else
@@ -4244,6 +4303,7 @@ bool simple_wallet::set_variable(const std::vector<std::string> &args)
     CHECK_SIMPLE_VARIABLE("enable-multisig-experimental", set_enable_multisig, tr("0 or 1"));
     CHECK_SIMPLE_VARIABLE("freeze-incoming-payments", set_freeze_incoming_payments, tr("0 or 1"));
     CHECK_SIMPLE_VARIABLE("send-change-back-to-subaddress", set_send_change_back_to_subaddress, tr("0 or 1"));
+    CHECK_SIMPLE_VARIABLE("store-cache-delta", set_store_cache_delta, tr("0 or 1"));
   }
   fail_msg_writer() << tr("set: unrecognized argument(s)");
   return true;
@@ -6110,6 +6170,8 @@ void simple_wallet::on_new_block(uint64_t height, const cryptonote::block& block
     return;
   if (!m_auto_refresh_refreshing)
     m_refresh_progress_reporter.update(height, false);
+  else
+    m_balance_snapshot_updater.do_call([this](){ update_balance_snapshot(); return true; });
 }
 //----------------------------------------------------------------------------------------------------
 void simple_wallet::on_money_received(uint64_t height, const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t amount, const std::string& asset_type, uint64_t burnt, const cryptonote::subaddress_index& subaddr_index, bool is_change, uint64_t unlock_time, const uint64_t& td_origin_idx)
@@ -6516,11 +6578,43 @@ bool simple_wallet::show_balance(const std::vector<std::string>& args/* = std::v
     PRINT_USAGE(USAGE_SHOW_BALANCE);
     return true;
   }
+  // don't hold the prompt up behind a long background refresh, the last snapshot will do
+  if (args.empty() && m_auto_refresh_refreshing && show_balance_snapshot())
+    return true;
   LOCK_IDLE_SCOPE();
   show_balance_unlocked(args.size() == 1);
   return true;
 }
 //----------------------------------------------------------------------------------------------------
+void simple_wallet::update_balance_snapshot()
+{
+  // called from the refreshing thread, between blocks
+  balance_snapshot snapshot;
+  snapshot.account = m_current_subaddress_account;
+  snapshot.label = m_wallet->get_subaddress_label({m_current_subaddress_account, 0});
+  snapshot.height = m_wallet->get_blockchain_current_height();
+  for (const std::string &asset: m_wallet->list_asset_types())
+    snapshot.balances.emplace_back(asset,
+      m_wallet->balance(m_current_subaddress_account, asset, false),
+      m_wallet->unlocked_balance(m_current_subaddress_account, asset, false));
+
+  boost::unique_lock<boost::mutex> lock(m_balance_snapshot_mutex);
+  m_balance_snapshot = std::move(snapshot);
+}
+//----------------------------------------------------------------------------------------------------
+bool simple_wallet::show_balance_snapshot()
+{
+  boost::unique_lock<boost::mutex> lock(m_balance_snapshot_mutex);
+  if (!m_balance_snapshot || m_balance_snapshot->account != m_current_subaddress_account)
+    return false;
+  success_msg_writer() << tr("Currently selected account: [") << m_balance_snapshot->account << tr("] ") << m_balance_snapshot->label;
+  for (const auto &balance: m_balance_snapshot->balances)
+    success_msg_writer() << tr("Asset: ") << std::get<0>(balance) << tr(", balance: ") << print_money(std::get<1>(balance)) << ", "
+                         << tr("unlocked balance: ") << print_money(std::get<2>(balance));
+  message_writer() << boost::format(tr("As of block %llu, the wallet is still refreshing")) % (m_balance_snapshot->height - 1);
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
 bool simple_wallet::show_incoming_transfers(const std::vector<std::string>& args)
 {
   if (args.size() > 3)
@@ -10100,17 +10194,29 @@ bool simple_wallet::show_transfers(const std::vector<std::string> &args_)
     return true;
   }
 
-  LOCK_IDLE_SCOPE();
-
   std::vector<transfer_view> all_transfers;
+  {
+    LOCK_IDLE_SCOPE();
+    if (!get_transfers(local_args, all_transfers))
+      return true;
+  }
 
-  if (!get_transfers(local_args, all_transfers))
-    return true;
+  // the listing is printed with the idle lock released, so a background refresh carries on
+  // while a long history scrolls by a page at a time
+  static constexpr size_t SHOW_TRANSFERS_PAGE_SIZE = 100;
+  const bool paged = epee::is_stdout_a_tty();
 
   PAUSE_READLINE();
 
-  for (const auto& transfer : all_transfers)
+  for (size_t n = 0; n < all_transfers.size(); ++n)
   {
+    if (paged && n > 0 && n % SHOW_TRANSFERS_PAGE_SIZE == 0)
+    {
+      const std::string more = input_line((boost::format(tr("%llu of %llu shown, Enter for more or q to stop")) % n % all_transfers.size()).str());
+      if (std::cin.eof() || (!more.empty() && (more[0] == 'q' || more[0] == 'Q')))
+        break;
+    }
+    const transfer_view &transfer = all_transfers[n];
     const auto color =
       transfer.type == "failed" ? console_color_red :
       transfer.type == "burnt"  ? console_color_yellow :
@@ -10557,6 +10663,7 @@ bool simple_wallet::check_refresh()
         bool received_money;
         if (try_connect_to_daemon(true))
           m_wallet->refresh(m_wallet->is_trusted_daemon(), 0, fetched_blocks, received_money, false); // don't check the pool in background mode
+        update_balance_snapshot();
       }
       catch(...) {}
       m_auto_refresh_refreshing = false;
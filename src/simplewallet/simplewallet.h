@@ -164,12 +164,14 @@ namespace cryptonote
     bool set_enable_multisig(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_freeze_incoming_payments(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_send_change_back_to_subaddress(const std::vector<std::string> &args = std::vector<std::string>());
+    bool set_store_cache_delta(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_persistent_rpc_client_id(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_auto_mine_for_rpc_payment_threshold(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_credits_target(const std::vector<std::string> &args = std::vector<std::string>());
     bool help(const std::vector<std::string> &args = std::vector<std::string>());
     bool apropos(const std::vector<std::string> &args);
     bool scan_tx(const std::vector<std::string> &args);
+    bool import_enote_stream(const std::vector<std::string> &args);
     bool start_mining(const std::vector<std::string> &args);
     bool stop_mining(const std::vector<std::string> &args);
     bool set_daemon(const std::vector<std::string> &args);
@@ -325,6 +327,18 @@ namespace cryptonote
     };
     bool get_transfers(std::vector<std::string>& args_, std::vector<transfer_view>& transfers);
 
+    // balances of the current account as of some height, kept up to date by the refresh thread so
+    // `balance` can answer without stopping a background refresh
+    struct balance_snapshot
+    {
+      uint32_t account;
+      std::string label;
+      uint64_t height;
+      std::vector<std::tuple<std::string, uint64_t, uint64_t>> balances; // asset type, balance, unlocked balance
+    };
+    void update_balance_snapshot();
+    bool show_balance_snapshot();
+
     /*!
      * \brief Prints the seed with a nice message
      * \param seed seed to print
@@ -465,7 +479,7 @@ namespace cryptonote
     boost::condition_variable m_idle_cond;
 
     std::atomic<bool> m_auto_refresh_enabled;
-    bool m_auto_refresh_refreshing;
+    std::atomic<bool> m_auto_refresh_refreshing;
     std::atomic<bool> m_in_manual_refresh;
     uint32_t m_current_subaddress_account;
 
@@ -473,9 +487,13 @@ namespace cryptonote
     std::atomic<bool> m_locked;
     std::atomic<bool> m_in_command;
 
+    boost::mutex m_balance_snapshot_mutex;
+    boost::optional<balance_snapshot> m_balance_snapshot;
+
     template<uint64_t mini, uint64_t maxi> struct get_random_interval { public: uint64_t operator()() const { return crypto::rand_range(mini, maxi); } };
 
     epee::math_helper::once_a_time_seconds<1> m_inactivity_checker;
+    epee::math_helper::once_a_time_seconds<2> m_balance_snapshot_updater;
     epee::math_helper::once_a_time_seconds_range<get_random_interval<80 * 1000000, 100 * 1000000>> m_refresh_checker;
     epee::math_helper::once_a_time_seconds_range<get_random_interval<90 * 1000000, 110 * 1000000>> m_mms_checker;
     epee::math_helper::once_a_time_seconds_range<get_random_interval<90 * 1000000, 115 * 1000000>> m_rpc_payment_checker;
@@ -133,6 +133,8 @@ bool PendingTransactionImpl::commit(const std::string &filename, bool overwrite)
             // if no exception, remove element from vector
             m_pending_tx.pop_back();
         } // TODO: extract method;
+        // the sent txs show up as pending in the history on the next refresh
+        m_wallet.historyChangedFrom(m_wallet.blockChainHeight());
       }
     } catch (const tools::error::daemon_busy&) {
         // TODO: make it translatable with "tr"?
@@ -37,6 +37,7 @@
 #include "wallet/wallet2.h"
 
 
+#include <algorithm>
 #include <string>
 #include <list>
 
@@ -104,6 +105,11 @@ void TransactionHistoryImpl::setTxNote(const std::string &txid, const std::strin
 }
 
 void TransactionHistoryImpl::refresh()
+{
+    refreshFrom(0);
+}
+
+void TransactionHistoryImpl::refreshFrom(uint64_t height)
 {
     // multithreaded access:
     // boost::lock_guard<boost::mutex> guarg(m_historyMutex);
@@ -111,14 +117,26 @@ void TransactionHistoryImpl::refresh()
     boost::unique_lock<boost::shared_mutex> lock(m_historyMutex);
 
     // TODO: configurable values;
-    uint64_t min_height = 0;
+    uint64_t min_height = height;
     uint64_t max_height = (uint64_t)-1;
     uint64_t wallet_height = m_wallet->blockChainHeight();
 
-    // delete old transactions;
-    for (auto t : m_history)
+    // delete the transactions that are read again below, all of them for a full refresh;
+    // pending ones never have a block height, so they are always re-read
+    auto removed = std::remove_if(m_history.begin(), m_history.end(), [min_height](TransactionInfo *t) {
+        if (!t->isPending() && t->blockHeight() <= min_height)
+            return false;
         delete t;
-    m_history.clear();
+        return true;
+    });
+    m_history.erase(removed, m_history.end());
+
+    // confirmations of the kept transactions still move with the wallet height
+    for (auto t : m_history)
+    {
+        TransactionInfoImpl *ti = static_cast<TransactionInfoImpl*>(t);
+        ti->m_confirmations = (wallet_height > ti->m_blockheight) ? wallet_height - ti->m_blockheight : 0;
+    }
 
     // transactions are stored in wallet2:
     // - confirmed_transfer_details   - out transfers
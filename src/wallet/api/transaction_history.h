@@ -45,6 +45,8 @@ public:
     virtual TransactionInfo * transaction(const std::string &id) const;
     virtual std::vector<TransactionInfo*> getAll() const;
     virtual void refresh();
+    // re-reads transactions above height and all pending ones, keeping the others as they are
+    void refreshFrom(uint64_t height);
     virtual void setTxNote(const std::string &txid, const std::string &note);
 
 private:
@@ -43,6 +43,7 @@
 #include "mnemonics/electrum-words.h"
 #include "mnemonics/english.h"
 #include <boost/format.hpp>
+#include <limits>
 #include <sstream>
 #include <unordered_map>
 
@@ -158,6 +159,8 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
     Wallet2CallbackImpl(WalletImpl * wallet)
      : m_listener(nullptr)
      , m_wallet(wallet)
+     , m_historyChangedHeight(std::numeric_limits<uint64_t>::max())
+     , m_syncTargetHeight(0)
     {
 
     }
@@ -177,6 +180,24 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
         return m_listener;
     }
 
+    // history entries above height need to be read again, as well as all pending ones
+    void markHistoryChanged(uint64_t height)
+    {
+        uint64_t current = m_historyChangedHeight.load();
+        while (height < current && !m_historyChangedHeight.compare_exchange_weak(current, height));
+    }
+
+    // the height passed to markHistoryChanged since the last call, or max if the history did not change
+    uint64_t takeHistoryChangedHeight()
+    {
+        return m_historyChangedHeight.exchange(std::numeric_limits<uint64_t>::max());
+    }
+
+    void setSyncTargetHeight(uint64_t height)
+    {
+        m_syncTargetHeight = height;
+    }
+
     virtual void on_new_block(uint64_t height, const cryptonote::block& block)
     {
         // Don't flood the GUI with signals. On fast refresh - send signal every 1000th block
@@ -186,10 +207,21 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
             // LOG_PRINT_L3(__FUNCTION__ << ": new block. height: " << height);
             if (m_listener) {
                 m_listener->newBlock(height);
+                m_listener->syncProgress(height, m_syncTargetHeight);
             }
         }
     }
 
+    virtual void on_reorg(uint64_t height, uint64_t blocks_detached, size_t transfers_detached)
+    {
+        markHistoryChanged(height > 0 ? height - 1 : 0);
+    }
+
+    virtual void on_pool_tx_removed(const crypto::hash &txid)
+    {
+        markHistoryChanged(m_wallet->m_wallet->get_blockchain_current_height());
+    }
+
   virtual void on_money_received(uint64_t height, const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t amount, const std::string& asset_type, uint64_t burnt, const cryptonote::subaddress_index& subaddr_index, bool is_change, uint64_t unlock_time, const uint64_t& td_origin_idx)
     {
 
@@ -202,6 +234,7 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
                      << ", burnt: " << print_money(burnt)
                      << ", raw_output_value: " << print_money(amount)
                      << ", idx: " << subaddr_index);
+        markHistoryChanged(height > 0 ? height - 1 : 0);
         // do not signal on received tx if wallet is not syncronized completely
         if (m_listener && m_wallet->synchronized()) {
             m_listener->moneyReceived(tx_hash, amount - burnt);
@@ -218,6 +251,7 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
                      << ", tx: " << tx_hash
                      << ", amount: " << print_money(amount)
                      << ", idx: " << subaddr_index);
+        markHistoryChanged(m_wallet->m_wallet->get_blockchain_current_height());
         // do not signal on received tx if wallet is not syncronized completely
         if (m_listener && m_wallet->synchronized()) {
             m_listener->unconfirmedMoneyReceived(tx_hash, amount);
@@ -235,6 +269,7 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
                      << ", amount: " << print_money(amount)
                      << " " << asset_type
                      << ", idx: " << subaddr_index);
+        markHistoryChanged(height > 0 ? height - 1 : 0);
         // do not signal on sent tx if wallet is not syncronized completely
         if (m_listener && m_wallet->synchronized()) {
             m_listener->moneySpent(tx_hash, amount);
@@ -294,6 +329,8 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback
 
     WalletListener * m_listener;
     WalletImpl     * m_wallet;
+    std::atomic<uint64_t> m_historyChangedHeight;
+    std::atomic<uint64_t> m_syncTargetHeight;
 };
 
 Wallet::~Wallet() {}
@@ -1048,6 +1085,46 @@ uint64_t WalletImpl::daemonBlockChainTargetHeight() const
     return result;
 }
 
+void WalletImpl::historyChangedFrom(uint64_t height)
+{
+    m_wallet2Callback->markHistoryChanged(height);
+}
+
+void WalletImpl::notifyRefreshChanges()
+{
+    // assuming if we have empty history, it wasn't initialized yet; after that
+    // only the transactions the refresh touched are read again
+    const uint64_t changedHeight = m_wallet2Callback->takeHistoryChangedHeight();
+    bool historyChanged = false;
+    if (m_history->count() == 0) {
+        m_history->refresh();
+        historyChanged = m_history->count() != 0;
+    } else if (changedHeight != std::numeric_limits<uint64_t>::max()) {
+        m_history->refreshFrom(changedHeight);
+        historyChanged = true;
+    }
+
+    WalletListener *listener = m_wallet2Callback->getListener();
+    if (!listener)
+        return;
+    if (historyChanged)
+        listener->historyChanged();
+
+    // unlocked balances also change as blocks pass, without any transfer
+    const std::vector<std::string> assets = m_wallet->list_asset_types();
+    for (uint32_t account = 0; account < m_wallet->get_num_subaddress_accounts(); ++account) {
+        for (const std::string &asset: assets) {
+            const uint64_t balance = m_wallet->balance(account, asset, false);
+            const uint64_t unlocked = m_wallet->unlocked_balance(account, asset, false);
+            std::pair<uint64_t, uint64_t> &reported = m_reportedBalances[{account, asset}];
+            if (reported.first == balance && reported.second == unlocked)
+                continue;
+            reported = {balance, unlocked};
+            listener->balanceChanged(account, asset, balance, unlocked);
+        }
+    }
+}
+
 bool WalletImpl::daemonSynced() const
 {   
     if(connected() == Wallet::ConnectionStatus_Disconnected)
@@ -2487,14 +2564,10 @@ void WalletImpl::doRefresh()
         if (daemonSynced()) {
             if(rescan)
                 m_wallet->rescan_blockchain(false);
+            m_wallet2Callback->setSyncTargetHeight(daemonBlockChainHeight());
             m_wallet->refresh(trustedDaemon());
             m_synchronized = m_wallet->is_synced();
-            // assuming if we have empty history, it wasn't initialized yet
-            // for further history changes client need to update history in
-            // "on_money_received" and "on_money_sent" callbacks
-            if (m_history->count() == 0) {
-                m_history->refresh();
-            }
+            notifyRefreshChanges();
             m_wallet->find_and_save_rings(false);
         } else {
            LOG_PRINT_L3(__FUNCTION__ << ": skipping refresh - daemon is not synced");
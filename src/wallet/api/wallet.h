@@ -34,6 +34,7 @@
 #include "wallet/api/wallet2_api.h"
 #include "wallet/wallet2.h"
 
+#include <map>
 #include <string>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
@@ -258,6 +259,8 @@ private:
     void stopRefresh();
     bool isNewWallet() const;
     void pendingTxPostProcess(PendingTransactionImpl * pending);
+    void historyChangedFrom(uint64_t height);
+    void notifyRefreshChanges();
     bool doInit(const std::string &daemon_address, const std::string &proxy_address, uint64_t upper_transaction_size_limit = 0, bool ssl = false);
     bool checkBackgroundSync(const std::string &message) const;
 
@@ -305,6 +308,8 @@ private:
     std::atomic<bool>   m_recoveringFromDevice;
     std::atomic<bool>   m_synchronized;
     std::atomic<bool>   m_rebuildWalletCache;
+    // balances last reported to the listener by (account, asset), only used by doRefresh
+    std::map<std::pair<uint32_t, std::string>, std::pair<uint64_t, uint64_t>> m_reportedBalances;
     // cache connection status to avoid unnecessary RPC calls
     mutable std::atomic<bool>   m_is_connected;
     boost::optional<epee::net_utils::http::login> m_daemon_login{};
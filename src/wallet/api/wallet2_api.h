@@ -433,6 +433,30 @@ struct WalletListener
      */
     virtual void refreshed() = 0;
 
+    /**
+     * @brief syncProgress - called along with newBlock while the wallet is catching up
+     * @param height        - wallet height reached
+     * @param targetHeight  - daemon height the current refresh is syncing to
+     */
+    virtual void syncProgress(uint64_t height, uint64_t targetHeight) { (void)height; (void)targetHeight; }
+
+    /**
+     * @brief balanceChanged  - called after a refresh for every account/asset pair whose balance
+     *                          or unlocked balance changed since the previous refresh
+     * @param accountIndex    - subaddress account
+     * @param asset           - asset type
+     * @param balance         - new balance
+     * @param unlockedBalance - new unlocked balance
+     */
+    virtual void balanceChanged(uint32_t accountIndex, const std::string &asset, uint64_t balance, uint64_t unlockedBalance) { (void)accountIndex; (void)asset; (void)balance; (void)unlockedBalance; }
+
+    /**
+     * @brief historyChanged - called after a refresh that changed the transaction history; history()
+     *                         has already been updated with just the affected transactions, so there
+     *                         is no need to call TransactionHistory::refresh()
+     */
+    virtual void historyChanged() { }
+
     /**
      * @brief called by device if the action is required
      */
@@ -1478,6 +1502,9 @@ struct WalletManager
 
     //! sets proxy address, empty string to disable
     virtual bool setProxy(const std::string &address) = 0;
+
+    //! lets the wallets of this process share pulled blocks, keeping the last `batches` batches, 0 to disable
+    virtual void setSharedBlockCacheSize(size_t batches) = 0;
 };
 
 
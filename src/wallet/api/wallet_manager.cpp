@@ -385,6 +385,11 @@ bool WalletManagerImpl::setProxy(const std::string &address)
     return m_http_client.set_proxy(address);
 }
 
+void WalletManagerImpl::setSharedBlockCacheSize(size_t batches)
+{
+    tools::wallet2::set_shared_block_cache_size(batches);
+}
+
 ///////////////////// WalletManagerFactory implementation //////////////////////
 WalletManager *WalletManagerFactory::getWalletManager()
 {
@@ -93,6 +93,7 @@ public:
     bool stopMining() override;
     std::string resolveOpenAlias(const std::string &address, bool &dnssec_valid) const override;
     bool setProxy(const std::string &address) override;
+    void setSharedBlockCacheSize(size_t batches) override;
 
 private:
     WalletManagerImpl();
@@ -0,0 +1,189 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+//paired header
+#include "cache_delta.h"
+
+//local headers
+#include "misc_log_ex.h"
+
+//third party headers
+
+//standard headers
+#include <array>
+#include <cstring>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "wallet.cache_delta"
+
+namespace tools
+{
+namespace wallet
+{
+//-------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------
+static constexpr std::size_t MIN_CHUNK_SIZE = 2 * 1024;
+static constexpr std::size_t MAX_CHUNK_SIZE = 64 * 1024;
+// chunk boundary when the top 13 bits of the gear hash are zero: ~8 KiB average chunk past the minimum
+static constexpr std::uint64_t CHUNK_BOUNDARY_MASK = ~((~std::uint64_t(0)) >> 13);
+//-------------------------------------------------------------------------------------------------------------------
+static const std::array<std::uint64_t, 256> &gear_table()
+{
+    // fixed pseudo-random table (splitmix64), chunk boundaries must be stable across versions
+    static const std::array<std::uint64_t, 256> table = []{
+        std::array<std::uint64_t, 256> t;
+        std::uint64_t x = 0x53616c7669756dULL;
+        for (std::uint64_t &e : t)
+        {
+            std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            e = z ^ (z >> 31);
+        }
+        return t;
+    }();
+    return table;
+}
+//-------------------------------------------------------------------------------------------------------------------
+template <typename F>
+static void for_each_chunk(const std::string &data, F &&f)
+{
+    const std::array<std::uint64_t, 256> &gear = gear_table();
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data.data());
+    const std::size_t n = data.size();
+
+    std::size_t start = 0;
+    while (start < n)
+    {
+        const std::size_t limit = std::min(n, start + MAX_CHUNK_SIZE);
+        std::size_t end = std::min(n, start + MIN_CHUNK_SIZE);
+        std::uint64_t h = 0;
+        for (; end < limit; ++end)
+        {
+            h = (h << 1) + gear[p[end]];
+            if ((h & CHUNK_BOUNDARY_MASK) == 0)
+            {
+                ++end;
+                break;
+            }
+        }
+        f(start, end - start);
+        start = end;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------------
+static crypto::hash chunk_digest(const std::string &data, const std::size_t offset, const std::size_t size)
+{
+    return crypto::cn_fast_hash(data.data() + offset, size);
+}
+//-------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------
+cache_chunk_index make_cache_chunk_index(const std::string &checkpoint)
+{
+    cache_chunk_index index;
+    index.reserve(checkpoint.size() / (MIN_CHUNK_SIZE * 4) + 1);
+    for_each_chunk(checkpoint, [&](const std::size_t offset, const std::size_t size){
+        index.emplace(chunk_digest(checkpoint, offset, size), cache_chunk{offset, size});
+    });
+    return index;
+}
+//-------------------------------------------------------------------------------------------------------------------
+cache_delta make_cache_delta(const cache_chunk_index &checkpoint_index, const std::string &cache)
+{
+    cache_delta delta;
+    delta.result_size = cache.size();
+    delta.result_hash = crypto::cn_fast_hash(cache.data(), cache.size());
+
+    for_each_chunk(cache, [&](const std::size_t offset, const std::size_t size){
+        const auto it = checkpoint_index.find(chunk_digest(cache, offset, size));
+        if (it != checkpoint_index.cend() && it->second.size == size)
+        {
+            // extend the previous copy if this chunk directly follows it in the checkpoint
+            if (!delta.ops.empty() && delta.ops.back().literal.empty() &&
+                    delta.ops.back().offset + delta.ops.back().size == it->second.offset)
+                delta.ops.back().size += size;
+            else
+                delta.ops.push_back(cache_delta_op{it->second.offset, size, {}});
+        }
+        else
+        {
+            if (delta.ops.empty() || delta.ops.back().literal.empty())
+                delta.ops.push_back(cache_delta_op{0, 0, {}});
+            delta.ops.back().literal.append(cache, offset, size);
+            delta.ops.back().size = delta.ops.back().literal.size();
+        }
+    });
+
+    return delta;
+}
+//-------------------------------------------------------------------------------------------------------------------
+std::uint64_t get_cache_delta_literal_size(const cache_delta &delta)
+{
+    std::uint64_t literal_size = 0;
+    for (const cache_delta_op &op : delta.ops)
+        literal_size += op.literal.size();
+    return literal_size;
+}
+//-------------------------------------------------------------------------------------------------------------------
+bool apply_cache_delta(const std::string &checkpoint, const cache_delta &delta, std::string &cache_out)
+{
+    cache_out.clear();
+    if (delta.result_size > checkpoint.size() + get_cache_delta_literal_size(delta))
+    {
+        MERROR("Cache delta is larger than its checkpoint allows");
+        return false;
+    }
+    cache_out.reserve(delta.result_size);
+
+    for (const cache_delta_op &op : delta.ops)
+    {
+        if (!op.literal.empty())
+        {
+            cache_out.append(op.literal);
+            continue;
+        }
+        if (op.offset > checkpoint.size() || op.size > checkpoint.size() - op.offset)
+        {
+            MERROR("Cache delta copies past the end of its checkpoint");
+            return false;
+        }
+        cache_out.append(checkpoint, op.offset, op.size);
+    }
+
+    if (cache_out.size() != delta.result_size ||
+            crypto::cn_fast_hash(cache_out.data(), cache_out.size()) != delta.result_hash)
+    {
+        MERROR("Cache delta does not reproduce the recorded cache");
+        return false;
+    }
+    return true;
+}
+//-------------------------------------------------------------------------------------------------------------------
+} //namespace wallet
+} //namespace tools
@@ -0,0 +1,123 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+//local headers
+#include "crypto/hash.h"
+#include "serialization/containers.h"
+#include "serialization/crypto.h"
+#include "serialization/serialization.h"
+#include "serialization/string.h"
+
+//third party headers
+
+//standard headers
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//forward declarations
+
+/**
+ * A wallet cache delta describes a serialized wallet cache as a sequence of byte ranges copied
+ * from an older checkpoint of the same cache, interleaved with literal bytes. Both are cut into
+ * content-defined chunks, so a small change in the cache only produces literals for the chunks
+ * around it, and storing the wallet no longer needs to rewrite the whole cache file.
+ */
+
+namespace tools
+{
+namespace wallet
+{
+struct cache_chunk
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// chunk digest -> location of that chunk in the checkpoint
+using cache_chunk_index = std::unordered_map<crypto::hash, cache_chunk>;
+
+struct cache_delta_op
+{
+    // if literal is empty, copy `size` bytes at `offset` of the checkpoint, else insert literal
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::string literal;
+
+    BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(offset)
+        VARINT_FIELD(size)
+        FIELD(literal)
+    END_SERIALIZE()
+};
+
+struct cache_delta
+{
+    std::uint64_t result_size;
+    crypto::hash result_hash;
+    std::vector<cache_delta_op> ops;
+
+    BEGIN_SERIALIZE_OBJECT()
+        VERSION_FIELD(0)
+        VARINT_FIELD(result_size)
+        FIELD(result_hash)
+        FIELD(ops)
+    END_SERIALIZE()
+};
+
+/**
+* brief: make_cache_chunk_index - index the content-defined chunks of a checkpoint cache
+* param: checkpoint -
+* return: digests of all chunks of checkpoint
+*/
+cache_chunk_index make_cache_chunk_index(const std::string &checkpoint);
+/**
+* brief: make_cache_delta - describe a cache in terms of a previously indexed checkpoint
+* param: checkpoint_index - index of the checkpoint, as returned by make_cache_chunk_index()
+* param: cache - new serialized cache
+* return: delta which reproduces cache when applied to the checkpoint
+*/
+cache_delta make_cache_delta(const cache_chunk_index &checkpoint_index, const std::string &cache);
+/**
+* brief: get_cache_delta_literal_size - number of bytes of a delta not shared with its checkpoint
+*/
+std::uint64_t get_cache_delta_literal_size(const cache_delta &delta);
+/**
+* brief: apply_cache_delta - rebuild a cache from its checkpoint and a delta
+* param: checkpoint -
+* param: delta -
+* outparam: cache_out -
+* return: false if delta does not belong to checkpoint or does not reproduce the recorded cache
+*/
+bool apply_cache_delta(const std::string &checkpoint, const cache_delta &delta, std::string &cache_out);
+} //namespace wallet
+} //namespace tools
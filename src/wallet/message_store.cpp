@@ -88,6 +88,7 @@ void message_store::init(const multisig_wallet_state &state, const std::string &
   m_num_required_signers = num_required_signers;
   m_signers.clear();
   m_messages.clear();
+  rebuild_message_indexes();
   m_next_message_id = 1;
 
   // The vector "m_signers" gets here once the required number of elements, one for each authorized signer,
@@ -551,6 +552,18 @@ void message_store::process_wallet_created_data(const multisig_wallet_state &sta
 size_t message_store::add_message(const multisig_wallet_state &state,
                                   uint32_t signer_index, message_type type, message_direction direction,
                                   const std::string &content)
+{
+  size_t index = append_message(state, signer_index, type, direction, content);
+
+  // Save for every new message right away (at least while in beta)
+  save(state);
+  return index;
+}
+
+// Add a message without saving, for callers that add several messages in a row and save once
+size_t message_store::append_message(const multisig_wallet_state &state,
+                                     uint32_t signer_index, message_type type, message_direction direction,
+                                     const std::string &content)
 {
   message m;
   m.id = m_next_message_id++;
@@ -581,25 +594,53 @@ size_t message_store::add_message(const multisig_wallet_state &state,
   m.signature_count = 0;  // Future expansion for signature counting when signing txs
   m.hash = crypto::null_hash;
   m_messages.push_back(m);
-
-  // Save for every new message right away (at least while in beta)
-  save(state);
+  index_message(m_messages.size() - 1);
 
   MINFO(boost::format("Added %s message %s for signer %s of type %s")
           % message_direction_to_string(direction) % m.id % signer_index % message_type_to_string(type));
   return m_messages.size() - 1;
 }
 
+void message_store::index_message(size_t index)
+{
+  const message &m = m_messages[index];
+  m_message_index_by_id[m.id] = index;
+  m_message_indices_by_type[(uint32_t)m.type].push_back(index);
+  if (m.hash != crypto::null_hash)
+  {
+    m_message_hashes.insert(m.hash);
+  }
+}
+
+// Positions shift when messages get deleted, so simply index everything again; deletions
+// are rare compared to lookups, which happen for every processing step
+void message_store::rebuild_message_indexes()
+{
+  m_message_index_by_id.clear();
+  m_message_indices_by_type.clear();
+  m_message_hashes.clear();
+  for (size_t i = 0; i < m_messages.size(); ++i)
+  {
+    index_message(i);
+  }
+}
+
+// Indices into "m_messages" of all messages of type "type", oldest first
+const std::vector<size_t> &message_store::get_message_indices_by_type(message_type type) const
+{
+  static const std::vector<size_t> none;
+  const auto it = m_message_indices_by_type.find((uint32_t)type);
+  return it == m_message_indices_by_type.end() ? none : it->second;
+}
+
 // Get the index of the message with id "id", return false if not found
 bool message_store::get_message_index_by_id(uint32_t id, size_t &index) const
 {
-  for (size_t i = 0; i < m_messages.size(); ++i)
+  const auto it = m_message_index_by_id.find(id);
+  if (it != m_message_index_by_id.end())
   {
-    if (m_messages[i].id == id)
-    {
-      index = i;
-      return true;
-    }
+    index = it->second;
+    return true;
   }
   MWARNING("No message found with an id of " << id);
   return false;
@@ -644,9 +685,9 @@ message message_store::get_message_by_id(uint32_t id) const
 
 bool message_store::any_message_of_type(message_type type, message_direction direction) const
 {
-  for (size_t i = 0; i < m_messages.size(); ++i)
+  for (size_t i: get_message_indices_by_type(type))
   {
-    if ((m_messages[i].type == type) && (m_messages[i].direction == direction))
+    if (m_messages[i].direction == direction)
     {
       return true;
     }
@@ -656,14 +697,7 @@ bool message_store::any_message_of_type(message_type type, message_direction dir
 
 bool message_store::any_message_with_hash(const crypto::hash &hash) const
 {
-  for (size_t i = 0; i < m_messages.size(); ++i)
-  {
-    if (m_messages[i].hash == hash)
-    {
-      return true;
-    }
-  }
-  return false;
+  return m_message_hashes.count(hash) > 0;
 }
 
 // Count the ids in the vector that are set i.e. not 0, while ignoring index 0
@@ -695,6 +729,7 @@ void message_store::delete_message(uint32_t id)
   delete_transport_message(id);
   size_t index = get_message_index_by_id(id);
   m_messages.erase(m_messages.begin() + index);
+  rebuild_message_indexes();
 }
 
 void message_store::delete_all_messages()
@@ -704,6 +739,7 @@ void message_store::delete_all_messages()
     delete_transport_message(m_messages[i].id);
   }
   m_messages.clear();
+  rebuild_message_indexes();
 }
 
 // Make a text, which is "attacker controlled data", reasonably safe to display
@@ -852,6 +888,7 @@ void message_store::read_from_file(const multisig_wallet_state &state, const std
     THROW_WALLET_EXCEPTION_IF(true, tools::error::file_read_error, filename);
   }
 
+  rebuild_message_indexes();
   m_filename = filename;
 }
 
@@ -880,10 +917,10 @@ bool message_store::get_processable_messages(const multisig_wallet_state &state,
   std::vector<uint32_t> auto_config_messages(m_num_authorized_signers, 0);
   bool any_auto_config = false;
 
-  for (size_t i = 0; i < m_messages.size(); ++i)
+  for (size_t i: get_message_indices_by_type(message_type::auto_config_data))
   {
     message &m = m_messages[i];
-    if ((m.type == message_type::auto_config_data) && (m.state == message_state::waiting))
+    if (m.state == message_state::waiting)
     {
       if (auto_config_messages[m.signer_index] == 0)
       {
@@ -917,10 +954,10 @@ bool message_store::get_processable_messages(const multisig_wallet_state &state,
   }
 
   // Any signer config that arrived will be processed right away, regardless of other things that may wait
-  for (size_t i = 0; i < m_messages.size(); ++i)
+  for (size_t i: get_message_indices_by_type(message_type::signer_config))
   {
     message &m = m_messages[i];
-    if ((m.type == message_type::signer_config) && (m.state == message_state::waiting))
+    if (m.state == message_state::waiting)
     {
       processing_data data;
       data.processing = message_processing::process_signer_config;
@@ -958,10 +995,10 @@ bool message_store::get_processable_messages(const multisig_wallet_state &state,
     // with not yet multisig the only possible round 0
     std::vector<uint32_t> key_set_messages(m_num_authorized_signers, 0);
 
-    for (size_t i = 0; i < m_messages.size(); ++i)
+    for (size_t i: get_message_indices_by_type(message_type::key_set))
     {
       message &m = m_messages[i];
-      if ((m.type == message_type::key_set) && (m.state == message_state::waiting)
+      if ((m.state == message_state::waiting)
           && (m.round == 0))
       {
         if (key_set_messages[m.signer_index] == 0)
@@ -1001,10 +1038,10 @@ bool message_store::get_processable_messages(const multisig_wallet_state &state,
     // "state.multisig_rounds_passed".
     std::vector<uint32_t> additional_key_set_messages(m_num_authorized_signers, 0);
 
-    for (size_t i = 0; i < m_messages.size(); ++i)
+    for (size_t i: get_message_indices_by_type(message_type::additional_key_set))
     {
       message &m = m_messages[i];
-      if ((m.type == message_type::additional_key_set) && (m.state == message_state::waiting)
+      if ((m.state == message_state::waiting)
          && (m.round == state.multisig_rounds_passed))
       {
         if (additional_key_set_messages[m.signer_index] == 0)
@@ -1052,10 +1089,10 @@ bool message_store::get_processable_messages(const multisig_wallet_state &state,
     // any processable sync info from other signers on the way in case we need it
     bool own_sync_data_created = false;
     std::vector<uint32_t> sync_messages(m_num_authorized_signers, 0);
-    for (size_t i = 0; i < m_messages.size(); ++i)
+    for (size_t i: get_message_indices_by_type(message_type::multisig_sync_data))
     {
       message &m = m_messages[i];
-      if ((m.type == message_type::multisig_sync_data) && (force_sync || (m.wallet_height == wallet_height)))
+      if (force_sync || (m.wallet_height == wallet_height))
       // It's data for the same "round" of syncing, on the same "wallet height", therefore relevant
       // With "force_sync" take ANY waiting sync data, maybe it will work out
       {
@@ -1404,9 +1441,10 @@ bool message_store::check_for_messages(const multisig_wallet_state &state, std::
 
         std::string plaintext;
         decrypt(rm.content, rm.encryption_public_key, rm.iv, decrypt_key, plaintext);
-        size_t index = add_message(state, sender_index, (message_type)rm.type, message_direction::in, plaintext);
+        size_t index = append_message(state, sender_index, (message_type)rm.type, message_direction::in, plaintext);
         message &m = m_messages[index];
         m.hash = rm.hash;
+        m_message_hashes.insert(m.hash);
         m.transport_id = rm.transport_id;
         m.sent = rm.timestamp;
         m.round = rm.round;
@@ -1416,6 +1454,11 @@ bool message_store::check_for_messages(const multisig_wallet_state &state, std::
       }
     }
   }
+  if (new_messages)
+  {
+    // One save for the whole batch instead of one per received message
+    save(state);
+  }
   return new_messages;
 }
 
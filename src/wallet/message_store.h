@@ -31,6 +31,8 @@
 
 #include <cstdlib>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "crypto/hash.h"
 #include <boost/serialization/vector.hpp>
@@ -396,10 +398,21 @@ namespace mms
     std::vector<authorized_signer> m_signers;
     std::vector<message> m_messages;
     uint32_t m_next_message_id;
+    // In-memory indexes over "m_messages", never serialized but rebuilt from the vector
+    // after loading and after deletions, so lookups do not slow down with long histories
+    std::unordered_map<uint32_t, size_t> m_message_index_by_id;
+    std::unordered_map<uint32_t, std::vector<size_t>> m_message_indices_by_type;
+    std::unordered_set<crypto::hash> m_message_hashes;
     std::string m_filename;
     message_transporter m_transporter;
     std::atomic<bool> m_run;
 
+    void rebuild_message_indexes();
+    void index_message(size_t index);
+    const std::vector<size_t> &get_message_indices_by_type(message_type type) const;
+    size_t append_message(const multisig_wallet_state &state,
+                          uint32_t signer_index, message_type type, message_direction direction,
+                          const std::string &content);
     bool get_message_index_by_id(uint32_t id, size_t &index) const;
     size_t get_message_index_by_id(uint32_t id) const;
     message& get_message_ref_by_id(uint32_t id);
@@ -53,6 +53,11 @@ namespace tools
 
 static const std::chrono::seconds rpc_timeout = std::chrono::minutes(3) + std::chrono::seconds(30);
 
+// grace blocks asked for by chain state fetches made before any fee estimate was requested
+static constexpr uint64_t DEFAULT_FEE_ESTIMATE_GRACE_BLOCKS = 10;
+// JSON-RPC error code of daemons predating get_chain_state
+static constexpr int64_t JSON_RPC_METHOD_NOT_FOUND = -32601;
+
 NodeRPCProxy::NodeRPCProxy(epee::net_utils::http::abstract_http_client &http_client, rpc_payment_state_t &rpc_payment_state, boost::recursive_mutex &mutex)
   : m_http_client(http_client)
   , m_rpc_payment_state(rpc_payment_state)
@@ -77,6 +82,8 @@ void NodeRPCProxy::invalidate()
   m_block_weight_limit = 0;
   m_adjusted_time = 0;
   m_get_info_time = 0;
+  m_chain_state_supported = true;
+  m_top_block_hash = crypto::null_hash;
   m_rpc_payment_info_time = 0;
   m_rpc_payment_seed_height = 0;
   m_rpc_payment_seed_hash = crypto::null_hash;
@@ -131,15 +138,70 @@ boost::optional<std::string> NodeRPCProxy::get_rpc_version(uint32_t &rpc_version
 
 void NodeRPCProxy::set_height(uint64_t h)
 {
+  // the chain moved: everything fetched with the chain state is outdated, whatever its age
+  if (h != m_height)
+    m_get_info_time = 0;
   m_height = h;
   m_height_time = time(NULL);
 }
 
+boost::optional<std::string> NodeRPCProxy::get_chain_state(uint64_t grace_blocks, time_t seen_get_info_time)
+{
+  const time_t now = time(NULL);
+  cryptonote::COMMAND_RPC_GET_CHAIN_STATE::request req_t = AUTO_VAL_INIT(req_t);
+  cryptonote::COMMAND_RPC_GET_CHAIN_STATE::response resp_t = AUTO_VAL_INIT(resp_t);
+  req_t.grace_blocks = grace_blocks;
+
+  {
+    const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
+
+    // another caller refreshed the chain state while we were waiting for the lock
+    if (m_get_info_time != seen_get_info_time && m_get_info_time != 0 && m_dynamic_base_fee_estimate_grace_blocks == grace_blocks)
+      return boost::optional<std::string>();
+
+    uint64_t pre_call_credits = m_rpc_payment_state.credits;
+    req_t.client = cryptonote::make_rpc_payment_signature(m_client_id_secret_key);
+    epee::json_rpc::error error;
+    bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_chain_state", req_t, resp_t, error, m_http_client, rpc_timeout);
+    if (error.code == JSON_RPC_METHOD_NOT_FOUND)
+    {
+      MINFO("Daemon does not support get_chain_state, falling back to separate calls");
+      m_chain_state_supported = false;
+      return boost::optional<std::string>();
+    }
+    RETURN_ON_RPC_RESPONSE_ERROR(r, error, resp_t, "get_chain_state");
+    check_rpc_cost(m_rpc_payment_state, "get_chain_state", resp_t.credits, pre_call_credits, COST_PER_CHAIN_STATE);
+  }
+
+  m_height = resp_t.height;
+  m_target_height = resp_t.target_height;
+  if (!epee::string_tools::hex_to_pod(resp_t.top_block_hash, m_top_block_hash))
+    m_top_block_hash = crypto::null_hash;
+  m_block_weight_limit = resp_t.block_weight_limit;
+  m_adjusted_time = resp_t.adjusted_time;
+  m_dynamic_base_fee_estimate = resp_t.fee;
+  m_dynamic_base_fee_estimate_cached_height = resp_t.height;
+  m_dynamic_base_fee_estimate_grace_blocks = grace_blocks;
+  m_dynamic_base_fee_estimate_vector = !resp_t.fees.empty() ? std::move(resp_t.fees) : std::vector<uint64_t>{m_dynamic_base_fee_estimate};
+  m_fee_quantization_mask = resp_t.quantization_mask;
+  m_get_info_time = now;
+  m_height_time = now;
+  m_target_height_time = now;
+  return boost::optional<std::string>();
+}
+
 boost::optional<std::string> NodeRPCProxy::get_info()
 {
   if (m_offline)
     return boost::optional<std::string>("offline");
   const time_t now = time(NULL);
+  if (now >= m_get_info_time + 30 && m_chain_state_supported) // re-cache every 30 seconds, or once the height changed
+  {
+    const uint64_t grace_blocks = m_dynamic_base_fee_estimate_grace_blocks ? m_dynamic_base_fee_estimate_grace_blocks : DEFAULT_FEE_ESTIMATE_GRACE_BLOCKS;
+    auto res = get_chain_state(grace_blocks, m_get_info_time);
+    if (res || m_chain_state_supported)
+      return res;
+  }
   if (now >= m_get_info_time + 30) // re-cache every 30 seconds
   {
     cryptonote::COMMAND_RPC_GET_INFO::request req_t = AUTO_VAL_INIT(req_t);
@@ -251,6 +313,14 @@ boost::optional<std::string> NodeRPCProxy::get_dynamic_base_fee_estimate_2021_sc
 
   if (m_offline)
     return boost::optional<std::string>("offline");
+  if ((m_dynamic_base_fee_estimate_cached_height != height || m_dynamic_base_fee_estimate_grace_blocks != grace_blocks) && m_chain_state_supported)
+  {
+    result = get_chain_state(grace_blocks, m_get_info_time);
+    if (result)
+      return result;
+    if (m_chain_state_supported)
+      height = m_dynamic_base_fee_estimate_cached_height;
+  }
   if (m_dynamic_base_fee_estimate_cached_height != height || m_dynamic_base_fee_estimate_grace_blocks != grace_blocks)
   {
     cryptonote::COMMAND_RPC_GET_BASE_FEE_ESTIMATE::request req_t = AUTO_VAL_INIT(req_t);
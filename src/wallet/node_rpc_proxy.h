@@ -50,6 +50,7 @@ public:
 
   boost::optional<std::string> get_rpc_version(uint32_t &rpc_version, std::vector<std::pair<uint8_t, uint64_t>> &daemon_hard_forks, uint64_t &height, uint64_t &target_height);
   boost::optional<std::string> get_height(uint64_t &height);
+  // brief: set_height - push a height learnt elsewhere (e.g. by refresh); a change invalidates the chain state
   void set_height(uint64_t h);
   boost::optional<std::string> get_target_height(uint64_t &height);
   boost::optional<std::string> get_block_weight_limit(uint64_t &block_weight_limit);
@@ -76,6 +77,7 @@ private:
 
 private:
   boost::optional<std::string> get_info();
+  boost::optional<std::string> get_chain_state(uint64_t grace_blocks, time_t seen_get_info_time);
 
   epee::net_utils::http::abstract_http_client &m_http_client;
   rpc_payment_state_t &m_rpc_payment_state;
@@ -95,6 +97,8 @@ private:
   uint64_t m_target_height;
   uint64_t m_block_weight_limit;
   time_t m_get_info_time;
+  bool m_chain_state_supported;
+  crypto::hash m_top_block_hash;
   time_t m_rpc_payment_info_time;
   uint64_t m_rpc_payment_diff;
   uint64_t m_rpc_payment_credits_per_hash_found;
@@ -76,12 +76,12 @@ static std::string compress_ring(const std::vector<uint64_t> &ring, uint64_t tag
 static std::vector<uint64_t> decompress_ring(const std::string &s, uint64_t tag)
 {
   std::vector<uint64_t> ring;
-  int read = 0;
-  for (std::string::const_iterator i = s.begin(); i != s.cend(); std::advance(i, read))
+  std::string::const_iterator i = s.begin(), end = s.end();
+  while (i != end)
   {
     uint64_t out;
-    std::string tmp(i, s.cend());
-    read = tools::read_varint(tmp.begin(), tmp.end(), out);
+    // read_varint advances i past what it read
+    const int read = tools::read_varint(i, end, out);
     THROW_WALLET_EXCEPTION_IF(read <= 0 || read > 256, tools::error::wallet_internal_error, "Internal error decompressing ring");
     if (tag)
     {
@@ -133,30 +133,39 @@ static std::string encrypt(const crypto::key_image &key_image, const crypto::cha
   return encrypt(std::string((const char*)&key_image, sizeof(key_image)), key_image, key, field);
 }
 
-static std::string decrypt(const std::string &ciphertext, const crypto::key_image &key_image, const crypto::chacha_key &key, uint8_t field)
+static std::string decrypt(const MDB_val &ciphertext, const crypto::key_image &key_image, const crypto::chacha_key &key, uint8_t field)
 {
   const crypto::chacha_iv iv = make_iv(key_image, key, field);
   std::string plaintext;
-  THROW_WALLET_EXCEPTION_IF(ciphertext.size() < sizeof(iv), tools::error::wallet_internal_error, "Bad ciphertext text");
-  plaintext.resize(ciphertext.size() - sizeof(iv));
-  crypto::chacha20(ciphertext.data() + sizeof(iv), ciphertext.size() - sizeof(iv), key, iv, &plaintext[0]);
+  THROW_WALLET_EXCEPTION_IF(ciphertext.mv_size < sizeof(iv), tools::error::wallet_internal_error, "Bad ciphertext text");
+  plaintext.resize(ciphertext.mv_size - sizeof(iv));
+  crypto::chacha20((const char*)ciphertext.mv_data + sizeof(iv), ciphertext.mv_size - sizeof(iv), key, iv, &plaintext[0]);
   return plaintext;
 }
 
-static void store_relative_ring(MDB_txn *txn, MDB_dbi &dbi, const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
+// encrypted (key, data) for a ring
+static std::pair<std::string, std::string> make_ring_entry(const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
 {
-  MDB_val key, data;
-  std::string key_ciphertext = encrypt(key_image, chacha_key, 0);
-  key.mv_data = (void*)key_ciphertext.data();
-  key.mv_size = key_ciphertext.size();
   std::string compressed_ring = compress_ring(relative_ring, V1TAG);
-  std::string data_ciphertext = encrypt(compressed_ring, key_image, chacha_key, 1);
-  data.mv_size = data_ciphertext.size();
-  data.mv_data = (void*)data_ciphertext.c_str();
+  return std::make_pair(encrypt(key_image, chacha_key, 0), encrypt(compressed_ring, key_image, chacha_key, 1));
+}
+
+static void store_ring_entry(MDB_txn *txn, MDB_dbi &dbi, const std::pair<std::string, std::string> &entry)
+{
+  MDB_val key, data;
+  key.mv_data = (void*)entry.first.data();
+  key.mv_size = entry.first.size();
+  data.mv_data = (void*)entry.second.data();
+  data.mv_size = entry.second.size();
   int dbr = mdb_put(txn, dbi, &key, &data, 0);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set ring for key image in LMDB table: " + std::string(mdb_strerror(dbr)));
 }
 
+static void store_relative_ring(MDB_txn *txn, MDB_dbi &dbi, const crypto::key_image &key_image, const std::vector<uint64_t> &relative_ring, const crypto::chacha_key &chacha_key)
+{
+  store_ring_entry(txn, dbi, make_ring_entry(key_image, relative_ring, chacha_key));
+}
+
 static int resize_env(MDB_env *env, const char *db_path, size_t needed)
 {
   MDB_envinfo mei;
@@ -376,12 +385,12 @@ bool ringdb::get_rings(const crypto::chacha_key &chacha_key, const std::vector<c
 
   std::vector<uint64_t> outs;
   bool try_v0 = false;
-  std::string data_plaintext = decrypt(std::string((const char*)data.mv_data, data.mv_size), key_image, chacha_key, 1);
+  std::string data_plaintext = decrypt(data, key_image, chacha_key, 1);
   try { outs = decompress_ring(data_plaintext, V1TAG); if (outs.empty()) try_v0 = true; }
   catch(...) { try_v0 = true; }
   if (try_v0)
   {
-    data_plaintext = decrypt(std::string((const char*)data.mv_data, data.mv_size), key_image, chacha_key, 0);
+    data_plaintext = decrypt(data, key_image, chacha_key, 0);
     outs = decompress_ring(data_plaintext, 0);
   }
   MDEBUG("Found ring for key image " << key_image << ":");
@@ -423,8 +432,17 @@ bool ringdb::set_rings(const crypto::chacha_key &chacha_key, const std::vector<s
   epee::misc_utils::auto_scope_leave_caller txn_dtor = epee::misc_utils::create_scope_leave_handler([&](){if (tx_active) mdb_txn_abort(txn);});
   tx_active = true;
 
+  // encrypt everything first, then insert in table order, so LMDB fills pages in order instead of jumping around
+  std::vector<std::pair<std::string, std::string>> entries;
+  entries.reserve(rings.size());
   for (const auto &e: rings)
-    store_relative_ring(txn, dbi_rings, e.first, relative ? e.second : cryptonote::absolute_output_offsets_to_relative(e.second), chacha_key);
+    entries.push_back(make_ring_entry(e.first, relative ? e.second : cryptonote::absolute_output_offsets_to_relative(e.second), chacha_key));
+  std::sort(entries.begin(), entries.end(), [](const std::pair<std::string, std::string> &a, const std::pair<std::string, std::string> &b) {
+    const MDB_val ka{a.first.size(), (void*)a.first.data()}, kb{b.first.size(), (void*)b.first.data()};
+    return compare_hash32(&ka, &kb) < 0;
+  });
+  for (const auto &e: entries)
+    store_ring_entry(txn, dbi_rings, e);
 
   dbr = mdb_txn_commit(txn);
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to commit txn setting ring to database: " + std::string(mdb_strerror(dbr)));
@@ -439,7 +457,7 @@ bool ringdb::set_ring(const crypto::chacha_key &chacha_key, const crypto::key_im
   return set_rings(chacha_key, rings, relative);
 }
 
-bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &outputs, int op)
+bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &unsorted_outputs, int op)
 {
   MDB_txn *txn;
   MDB_cursor *cursor;
@@ -447,7 +465,17 @@ bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &
   bool tx_active = false;
   bool ret = true;
 
-  THROW_WALLET_EXCEPTION_IF(outputs.size() > 1 && op == BLACKBALL_QUERY, tools::error::wallet_internal_error, "Blackball query only makes sense for a single output");
+  THROW_WALLET_EXCEPTION_IF(unsorted_outputs.size() > 1 && op == BLACKBALL_QUERY, tools::error::wallet_internal_error, "Blackball query only makes sense for a single output");
+
+  // go through the table in order (the table's order is the natural one for (amount, offset))
+  std::vector<std::pair<uint64_t, uint64_t>> sorted_outputs;
+  const bool sort_outputs = unsorted_outputs.size() > 1 && !std::is_sorted(unsorted_outputs.begin(), unsorted_outputs.end());
+  if (sort_outputs)
+  {
+    sorted_outputs = unsorted_outputs;
+    std::sort(sorted_outputs.begin(), sorted_outputs.end());
+  }
+  const std::vector<std::pair<uint64_t, uint64_t>> &outputs = sort_outputs ? sorted_outputs : unsorted_outputs;
 
   dbr = resize_env(env, filename.c_str(), 32 * 2 * outputs.size()); // a pubkey, and some slack
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to set env map size: " + std::string(mdb_strerror(dbr)));
@@ -460,8 +488,29 @@ bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &
   THROW_WALLET_EXCEPTION_IF(dbr, tools::error::wallet_internal_error, "Failed to create cursor for blackballs table: " + std::string(mdb_strerror(dbr)));
 
   MDB_val key, data;
-  for (const std::pair<uint64_t, uint64_t> &output: outputs)
+
+  // if everything goes after what's already there (eg, importing a list into an empty table), LMDB can just append
+  bool append = false, table_empty = false;
+  std::pair<uint64_t, uint64_t> last_output;
+  if (op == BLACKBALL_BLACKBALL && !outputs.empty())
+  {
+    dbr = mdb_cursor_get(cursor, &key, &data, MDB_LAST);
+    THROW_WALLET_EXCEPTION_IF(dbr && dbr != MDB_NOTFOUND, tools::error::wallet_internal_error, "Failed to query blackballs table: " + std::string(mdb_strerror(dbr)));
+    table_empty = dbr == MDB_NOTFOUND;
+    if (table_empty)
+      append = true;
+    else
+    {
+      last_output = std::make_pair(*(const uint64_t*)key.mv_data, *(const uint64_t*)data.mv_data);
+      append = outputs.front() > last_output;
+    }
+  }
+
+  for (size_t n = 0; n < outputs.size(); ++n)
   {
+    const std::pair<uint64_t, uint64_t> &output = outputs[n];
+    if (n > 0 && output == outputs[n - 1] && op != BLACKBALL_QUERY)
+      continue;
     key.mv_data = (void*)&output.first;
     key.mv_size = sizeof(output.first);
     data.mv_data = (void*)&output.second;
@@ -471,9 +520,18 @@ bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &
     {
       case BLACKBALL_BLACKBALL:
         MDEBUG("Marking output " << output.first << "/" << output.second << " as spent");
-        dbr = mdb_cursor_put(cursor, &key, &data, MDB_NODUPDATA);
-        if (dbr == MDB_KEYEXIST)
-          dbr = 0;
+        if (append)
+        {
+          // a new amount goes at the end of the table, a new offset at the end of its amount
+          const bool new_key = n == 0 ? (table_empty || output.first > last_output.first) : output.first != outputs[n - 1].first;
+          dbr = mdb_cursor_put(cursor, &key, &data, new_key ? MDB_APPEND : MDB_APPENDDUP);
+        }
+        else
+        {
+          dbr = mdb_cursor_put(cursor, &key, &data, MDB_NODUPDATA);
+          if (dbr == MDB_KEYEXIST)
+            dbr = 0;
+        }
         break;
       case BLACKBALL_UNBLACKBALL:
         MDEBUG("Marking output " << output.first << "/" << output.second << " as unspent");
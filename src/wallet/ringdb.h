@@ -60,7 +60,7 @@ namespace tools
     bool clear_blackballs();
 
   private:
-    bool blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &outputs, int op);
+    bool blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>> &unsorted_outputs, int op);
 
   private:
     std::string filename;
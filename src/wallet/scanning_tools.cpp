@@ -60,9 +60,27 @@ bool parse_tx_extra_for_scanning(const std::vector<std::uint8_t> &tx_extra,
     std::vector<crypto::public_key> &additional_tx_ephemeral_pubkeys_out,
     cryptonote::blobdata &tx_extra_nonce_out)
 {
-    // 1. parse extra fields
+    // 1. parse extra fields, in one pass unless there are more main tx pubkeys than the view keeps
+    cryptonote::tx_extra_view extra;
+    bool fully_parsed = cryptonote::parse_tx_extra_view(tx_extra, extra);
+    if (extra.num_pub_keys <= cryptonote::tx_extra_view::MAX_PUB_KEYS)
+    {
+        for (size_t i = 0; i < extra.num_pub_keys; ++i)
+            main_tx_ephemeral_pubkeys_out.push_back(*extra.pub_keys[i]);
+        if (extra.has_additional_pub_keys)
+        {
+            if (extra.additional_pub_keys.size() == n_outputs)
+                additional_tx_ephemeral_pubkeys_out.assign(extra.additional_pub_keys.begin(), extra.additional_pub_keys.end());
+            else
+                fully_parsed = false;
+        }
+        if (extra.has_nonce)
+            tx_extra_nonce_out.assign(reinterpret_cast<const char*>(extra.nonce.data()), extra.nonce.size());
+        return fully_parsed;
+    }
+
     std::vector<cryptonote::tx_extra_field> tx_extra_fields;
-    bool fully_parsed = cryptonote::parse_tx_extra(tx_extra, tx_extra_fields);
+    fully_parsed = cryptonote::parse_tx_extra(tx_extra, tx_extra_fields);
 
     // 2. extract main tx pubkey
     cryptonote::tx_extra_pub_key field_main_pubkey;
@@ -270,48 +288,45 @@ static std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_carrot_
 {
     enote_view_incoming_scan_info_t res;
 
+    // check for known return addresses first: the map lookup is cheaper than the coinbase scan
     bool found_in_return = false;
-    if (!carrot::try_scan_carrot_coinbase_enote_receiver(enote,
-            s_sender_receiver_unctx,
-            main_address_spend_pubkey,
-            res.sender_extension_g,
-            res.sender_extension_t))
+    const auto &return_map = account.get_return_output_map_ref();
+    const auto return_it = return_map.find(enote.onetime_address);
+    if (return_it != return_map.end())
     {
-        // check for known return addresses
-        const auto &return_map = account.get_return_output_map_ref();
-        if (return_map.find(enote.onetime_address) == return_map.end())
-            return std::nullopt;
-
-        found_in_return = true;
-    }
-
-    if (found_in_return) {
         // scan the return output
         crypto::public_key address_spend_pubkey;
         carrot::encrypted_amount_t amount_enc;
         crypto::secret_key amount_blinding_factor;
         rct::xmr_amount amount;
-        if (!scan_return_output(
-                enote.onetime_address,
-                enote.enote_ephemeral_pubkey,
-                enote.view_tag,
-                enote.anchor_enc,
-                amount_enc,
-                std::nullopt, // no amount commitment for coinbase enotes
-                account.get_return_output_map_ref()
-                .at(enote.onetime_address).input_context,
-                account,
-                address_spend_pubkey,
-                amount,
-                amount_blinding_factor)
-        ) {
-            return std::nullopt;
+        found_in_return = scan_return_output(
+            enote.onetime_address,
+            enote.enote_ephemeral_pubkey,
+            enote.view_tag,
+            enote.anchor_enc,
+            amount_enc,
+            std::nullopt, // no amount commitment for coinbase enotes
+            return_it->second.input_context,
+            account,
+            address_spend_pubkey,
+            amount,
+            amount_blinding_factor);
+        if (found_in_return)
+        {
+            res.address_spend_pubkey = address_spend_pubkey;
+            res.return_address = enote.onetime_address;
+            res.is_return = true;
         }
+    }
+
+    if (!found_in_return) {
+        if (!carrot::try_scan_carrot_coinbase_enote_receiver(enote,
+                s_sender_receiver_unctx,
+                main_address_spend_pubkey,
+                res.sender_extension_g,
+                res.sender_extension_t))
+            return std::nullopt;
 
-        res.address_spend_pubkey = address_spend_pubkey;
-        res.return_address = enote.onetime_address;
-        res.is_return = true;
-    } else {
         // we received a coinbase enote
         res.address_spend_pubkey = main_address_spend_pubkey;
         res.is_return = false;
@@ -379,10 +394,7 @@ static std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_carrot_
 //-------------------------------------------------------------------------------------------------------------------
 static std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_carrot_enote_receiver(
     const carrot::CarrotEnoteV1 &enote,
-    const std::optional<carrot::encrypted_payment_id_t> &encrypted_payment_id,
-    const mx25519_pubkey &s_sender_receiver_unctx,
-    const crypto::public_key &main_address_spend_pubkey,
-    const carrot::view_incoming_key_device &k_view_dev,
+    const std::optional<carrot::CarrotEnoteExternalScanResultV1> &external_scan_result,
     carrot::carrot_and_legacy_account &account)
 {
     enote_view_incoming_scan_info_t res;
@@ -394,18 +406,16 @@ static std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_carrot_
     carrot::payment_id_t payment_id;
     carrot::CarrotEnoteType dummy_enote_type;
     carrot::janus_anchor_t internal_message;
-    if (!carrot::try_scan_carrot_enote_external_receiver(enote,
-        encrypted_payment_id,
-        s_sender_receiver_unctx,
-        {&main_address_spend_pubkey, 1},
-        k_view_dev,
-        res.sender_extension_g,
-        res.sender_extension_t,
-        res.address_spend_pubkey,
-        res.amount,
-        amount_blinding_factor_sk,
-        payment_id,
-        dummy_enote_type))
+    if (external_scan_result)
+    {
+        res.sender_extension_g = external_scan_result->sender_extension_g;
+        res.sender_extension_t = external_scan_result->sender_extension_t;
+        res.address_spend_pubkey = external_scan_result->address_spend_pubkey;
+        res.amount = external_scan_result->amount;
+        amount_blinding_factor_sk = external_scan_result->amount_blinding_factor;
+        payment_id = external_scan_result->payment_id;
+    }
+    else
     {
         if (!carrot::try_scan_carrot_enote_internal_receiver(enote,
             account,
@@ -424,13 +434,13 @@ static std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_carrot_
     }
 
     if (!res.is_return) {
-        const auto subaddr_it = account.get_subaddress_map_ref().find(res.address_spend_pubkey);
-        CHECK_AND_ASSERT_MES(subaddr_it != account.get_subaddress_map_ref().cend(),
+        const std::optional<carrot::subaddress_index_extended> found_subaddr_index = account.find_subaddress(res.address_spend_pubkey);
+        CHECK_AND_ASSERT_MES(found_subaddr_index,
             std::nullopt,
             "view_incoming_scan_carrot_enote: carrot enote scanned successfully, "
             "but the recovered address spend pubkey was not found in the subaddress map");
     
-        const carrot::subaddress_index_extended subaddr_index = subaddr_it->second;
+        const carrot::subaddress_index_extended subaddr_index = *found_subaddr_index;
         memset(&res.payment_id, 0, sizeof(res.payment_id));
         memcpy(&res.payment_id, &payment_id, sizeof(carrot::payment_id_t));
         res.subaddr_index = subaddr_index;
@@ -485,19 +495,8 @@ void perform_ecdh_derivations(const epee::span<const crypto::public_key> main_tx
     }
     else // !is_carrot
     {
-        for (const crypto::public_key &main_tx_ephemeral_pubkey : main_tx_ephemeral_pubkeys)
-        {
-            hwdev.generate_key_derivation(main_tx_ephemeral_pubkey,
-                k_view_incoming,
-                main_derivations_out.emplace_back());
-        }
-
-        for (const crypto::public_key &additional_tx_ephemeral_pubkey : additional_tx_ephemeral_pubkeys)
-        {
-            hwdev.generate_key_derivation(additional_tx_ephemeral_pubkey,
-                k_view_incoming,
-                additional_derivations_out.emplace_back());
-        }
+        hwdev.generate_key_derivations(main_tx_ephemeral_pubkeys, k_view_incoming, main_derivations_out);
+        hwdev.generate_key_derivations(additional_tx_ephemeral_pubkeys, k_view_incoming, additional_derivations_out);
     }
 }
 //-------------------------------------------------------------------------------------------------------------------
@@ -527,6 +526,15 @@ bool try_load_pre_carrot_enote_from_transaction_prefix(const cryptonote::transac
     return true;
 }
 //-------------------------------------------------------------------------------------------------------------------
+static std::optional<carrot::encrypted_payment_id_t> get_encrypted_payment_id_from_tx_extra_nonce(
+    const cryptonote::blobdata &tx_extra_nonce)
+{
+    crypto::hash8 pid_hash8;
+    if (!cryptonote::get_encrypted_payment_id_from_tx_extra_nonce(tx_extra_nonce, pid_hash8))
+        return std::nullopt;
+    return carrot::raw_byte_convert<carrot::encrypted_payment_id_t>(pid_hash8);
+}
+//-------------------------------------------------------------------------------------------------------------------
 std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_enote(
     const MoneroEnoteVariant &enote,
     const std::size_t local_output_index,
@@ -546,12 +554,8 @@ std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_enote(
         "view_incoming_scan_enote: additional derivations wrong size");
 
     //pid_enc
-    std::optional<carrot::encrypted_payment_id_t> encrypted_payment_id;
-    {
-        crypto::hash8 pid_hash8;
-        if (cryptonote::get_encrypted_payment_id_from_tx_extra_nonce(tx_extra_nonce, pid_hash8))
-            encrypted_payment_id = carrot::raw_byte_convert<carrot::encrypted_payment_id_t>(pid_hash8);
-    }
+    const std::optional<carrot::encrypted_payment_id_t> encrypted_payment_id =
+        get_encrypted_payment_id_from_tx_extra_nonce(tx_extra_nonce);
 
     struct view_incoming_scan_enote_visitor
     {
@@ -602,11 +606,16 @@ std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_enote(
             }
             else
             {
-                return view_incoming_scan_carrot_enote_receiver(enote,
+                std::vector<std::optional<carrot::CarrotEnoteExternalScanResultV1>> external_scan_results;
+                carrot::try_scan_carrot_enotes_external_receiver({&enote, 1},
+                    {&s_sender_receiver_unctx, 1},
                     encrypted_payment_id,
-                    s_sender_receiver_unctx,
-                    address.m_spend_public_key,
+                    {&address.m_spend_public_key, 1},
                     *k_view_dev,
+                    external_scan_results);
+
+                return view_incoming_scan_carrot_enote_receiver(enote,
+                    external_scan_results.at(0),
                     account);
             }
         }
@@ -771,6 +780,81 @@ std::optional<enote_view_incoming_scan_info_t> view_incoming_scan_enote_from_pre
         hwdev);
 }
 //-------------------------------------------------------------------------------------------------------------------
+static void view_incoming_scan_carrot_transaction_receiver(
+    const cryptonote::transaction &tx,
+    const epee::span<const crypto::public_key> main_tx_ephemeral_pubkeys,
+    const epee::span<const crypto::public_key> additional_tx_ephemeral_pubkeys,
+    const cryptonote::blobdata &tx_extra_nonce,
+    const epee::span<const crypto::key_derivation> main_derivations,
+    const epee::span<const crypto::key_derivation> additional_derivations,
+    const carrot::view_incoming_key_device &k_view_dev,
+    carrot::carrot_and_legacy_account &account,
+    const epee::span<std::optional<enote_view_incoming_scan_info_t>> enote_scan_infos_out)
+{
+    const size_t n_outputs = tx.vout.size();
+
+    for (size_t local_output_index = 0; local_output_index < n_outputs; ++local_output_index)
+        const_cast<std::optional<enote_view_incoming_scan_info_t>&>(enote_scan_infos_out[local_output_index]).reset();
+
+    CHECK_AND_ASSERT_MES(!main_derivations.empty() || !additional_derivations.empty(),,
+        "view_incoming_scan_carrot_transaction_receiver: no derivations provided");
+    CHECK_AND_ASSERT_MES(additional_derivations.empty() || n_outputs <= additional_derivations.size(),,
+        "view_incoming_scan_carrot_transaction_receiver: additional derivations wrong size");
+
+    const epee::span<const crypto::public_key> enote_ephemeral_pubkeys_pk = main_tx_ephemeral_pubkeys.empty()
+        ? additional_tx_ephemeral_pubkeys
+        : main_tx_ephemeral_pubkeys;
+
+    //! @TODO: breaks strict aliasing rules
+    const epee::span<const mx25519_pubkey> enote_ephemeral_pubkeys = {
+        reinterpret_cast<const mx25519_pubkey*>(enote_ephemeral_pubkeys_pk.data()),
+        enote_ephemeral_pubkeys_pk.size()};
+
+    // 1. load all enotes and their s_sr so that the external scan can be done as one batch
+    std::vector<carrot::CarrotEnoteV1> enotes;
+    std::vector<mx25519_pubkey> s_sender_receiver_unctx;
+    std::vector<size_t> local_output_indices;
+    enotes.reserve(n_outputs);
+    s_sender_receiver_unctx.reserve(n_outputs);
+    local_output_indices.reserve(n_outputs);
+    for (size_t local_output_index = 0; local_output_index < n_outputs; ++local_output_index)
+    {
+        carrot::CarrotEnoteV1 enote;
+        if (!carrot::try_load_carrot_enote_from_transaction_v1(tx,
+                enote_ephemeral_pubkeys,
+                local_output_index,
+                enote))
+            continue;
+
+        const crypto::key_derivation &kd = main_derivations.size()
+            ? main_derivations[0]
+            : additional_derivations[local_output_index];
+
+        enotes.push_back(enote);
+        s_sender_receiver_unctx.push_back(carrot::raw_byte_convert<mx25519_pubkey>(kd));
+        local_output_indices.push_back(local_output_index);
+    }
+
+    // 2. external scan: view tag filter, then full scan only on view tag matches
+    std::vector<std::optional<carrot::CarrotEnoteExternalScanResultV1>> external_scan_results;
+    carrot::try_scan_carrot_enotes_external_receiver(epee::to_span(enotes),
+        epee::to_span(s_sender_receiver_unctx),
+        get_encrypted_payment_id_from_tx_extra_nonce(tx_extra_nonce),
+        {&account.get_keys().m_carrot_account_address.m_spend_public_key, 1},
+        k_view_dev,
+        external_scan_results);
+
+    // 3. finish external scans and try internal scans on everything else
+    for (size_t i = 0; i < enotes.size(); ++i)
+    {
+        auto &enote_scan_info = const_cast<std::optional<enote_view_incoming_scan_info_t>&>(
+            enote_scan_infos_out[local_output_indices[i]]);
+        enote_scan_info = view_incoming_scan_carrot_enote_receiver(enotes[i],
+            external_scan_results[i],
+            account);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------------
 void view_incoming_scan_transaction(
     const cryptonote::transaction &tx,
     const epee::span<const crypto::public_key> main_tx_ephemeral_pubkeys,
@@ -795,6 +879,21 @@ void view_incoming_scan_transaction(
     const cryptonote::account_public_address &address =
         is_carrot ? account.get_keys().m_carrot_account_address : account.get_keys().m_account_address;
 
+    // scan non-coinbase carrot enotes as a single batch
+    if (is_carrot && !cryptonote::is_coinbase(tx))
+    {
+        view_incoming_scan_carrot_transaction_receiver(tx,
+            main_tx_ephemeral_pubkeys,
+            additional_tx_ephemeral_pubkeys,
+            tx_extra_nonce,
+            main_derivations,
+            additional_derivations,
+            k_view_dev,
+            account,
+            enote_scan_infos_out);
+        return;
+    }
+
     // do view-incoming scan for each output enotes
     for (size_t local_output_index = 0; local_output_index < n_outputs; ++local_output_index)
     {
@@ -855,6 +954,105 @@ void view_incoming_scan_transaction(
                                    enote_scan_infos_out);
 }
 //-------------------------------------------------------------------------------------------------------------------
+std::size_t view_incoming_scan_protocol_transaction(
+    const cryptonote::transaction &tx,
+    const std::unordered_set<crypto::public_key> &payout_onetime_addresses,
+    carrot::carrot_and_legacy_account &account,
+    const epee::span<std::optional<enote_view_incoming_scan_info_t>> enote_scan_infos_out)
+{
+    const size_t n_outputs = tx.vout.size();
+
+    CHECK_AND_ASSERT_THROW_MES(enote_scan_infos_out.size() == n_outputs,
+        "view_incoming_scan_protocol_transaction: enote scan span wrong length");
+
+    // 1. find the outputs paying a known return address: no other output can be ours
+    std::vector<std::size_t> candidates;
+    for (size_t local_output_index = 0; local_output_index < n_outputs; ++local_output_index)
+    {
+        const_cast<std::optional<enote_view_incoming_scan_info_t>&>(enote_scan_infos_out[local_output_index]) = std::nullopt;
+        crypto::public_key onetime_address;
+        if (cryptonote::get_output_public_key(tx.vout[local_output_index], onetime_address)
+                && payout_onetime_addresses.count(onetime_address))
+            candidates.push_back(local_output_index);
+    }
+    if (candidates.empty())
+        return 0;
+
+    // 2. parse tx extra
+    std::vector<crypto::public_key> main_tx_ephemeral_pubkeys;
+    std::vector<crypto::public_key> additional_tx_ephemeral_pubkeys;
+    cryptonote::blobdata tx_extra_nonce;
+    if (!parse_tx_extra_for_scanning(tx.extra,
+            n_outputs,
+            main_tx_ephemeral_pubkeys,
+            additional_tx_ephemeral_pubkeys,
+            tx_extra_nonce))
+        MWARNING("Transaction extra has unsupported format: " << cryptonote::get_transaction_hash(tx));
+
+    CHECK_AND_ASSERT_MES(!main_tx_ephemeral_pubkeys.empty() || !additional_tx_ephemeral_pubkeys.empty(), 0,
+        "Transaction missing ephemeral pubkeys");
+
+    // 3. perform the ECDH derivations of the candidates only, the other additional derivations are never read
+    const bool is_carrot = carrot::is_carrot_transaction_v1(tx);
+    const crypto::secret_key &k_view_incoming = is_carrot
+        ? account.get_keys().k_view_incoming : account.get_keys().m_view_secret_key;
+    hw::device &hwdev = account.get_keys().get_device();
+    std::vector<crypto::key_derivation> main_derivations;
+    std::vector<crypto::key_derivation> additional_derivations;
+    perform_ecdh_derivations(epee::to_span(main_tx_ephemeral_pubkeys),
+                             {},
+                             k_view_incoming,
+                             hwdev,
+                             is_carrot,
+                             main_derivations,
+                             additional_derivations);
+    if (!additional_tx_ephemeral_pubkeys.empty())
+    {
+        additional_derivations.resize(additional_tx_ephemeral_pubkeys.size());
+        std::vector<crypto::key_derivation> unused_main_derivations;
+        std::vector<crypto::key_derivation> candidate_derivation;
+        for (const std::size_t local_output_index : candidates)
+        {
+            if (local_output_index >= additional_tx_ephemeral_pubkeys.size())
+                continue;
+            perform_ecdh_derivations({},
+                                     {&additional_tx_ephemeral_pubkeys[local_output_index], 1},
+                                     k_view_incoming,
+                                     hwdev,
+                                     is_carrot,
+                                     unused_main_derivations,
+                                     candidate_derivation);
+            if (!candidate_derivation.empty())
+                additional_derivations[local_output_index] = candidate_derivation[0];
+        }
+    }
+
+    // 4. view-incoming scan the candidates
+    //! @TODO: HW device
+    carrot::view_incoming_key_ram_borrowed_device k_view_dev(k_view_incoming);
+    const cryptonote::account_public_address &address =
+        is_carrot ? account.get_keys().m_carrot_account_address : account.get_keys().m_account_address;
+    std::size_t n_owned = 0;
+    for (const std::size_t local_output_index : candidates)
+    {
+        auto &enote_scan_info = const_cast<std::optional<enote_view_incoming_scan_info_t>&>(enote_scan_infos_out[local_output_index]);
+        enote_scan_info = view_incoming_scan_enote(tx,
+                                                   local_output_index,
+                                                   epee::to_span(main_tx_ephemeral_pubkeys),
+                                                   epee::to_span(additional_tx_ephemeral_pubkeys),
+                                                   tx_extra_nonce,
+                                                   epee::to_span(main_derivations),
+                                                   epee::to_span(additional_derivations),
+                                                   address,
+                                                   &k_view_dev,
+                                                   account,
+                                                   hwdev);
+        if (enote_scan_info)
+            ++n_owned;
+    }
+    return n_owned;
+}
+//-------------------------------------------------------------------------------------------------------------------
 std::vector<std::optional<enote_view_incoming_scan_info_t>> view_incoming_scan_transaction(
     const cryptonote::transaction &tx,
     carrot::carrot_and_legacy_account &account)
@@ -914,6 +1112,101 @@ std::vector<std::optional<enote_view_incoming_scan_info_t>> view_incoming_scan_t
     return res;
 }
 //-------------------------------------------------------------------------------------------------------------------
+bool tx_scan_record_may_have_owned_enotes(const cryptonote::tx_scan_record &record,
+    const carrot::carrot_and_legacy_account &account,
+    hw::device &hwdev)
+{
+    const auto &return_map = account.get_return_output_map_ref();
+    bool is_carrot = false;
+    for (const cryptonote::output_scan_record &out : record.outputs)
+    {
+        if (return_map.count(out.onetime_address))
+            return true;
+        is_carrot = is_carrot || out.view_tag.size() == sizeof(carrot::view_tag_t);
+    }
+
+    const epee::span<const crypto::public_key> ephemeral_pubkeys = record.tx_pub_keys.empty()
+        ? epee::to_span(record.additional_tx_pub_keys)
+        : epee::to_span(record.tx_pub_keys);
+
+    if (is_carrot)
+    {
+        const carrot::input_context_t input_context = record.first_key_image != crypto::key_image{}
+            ? carrot::make_carrot_input_context(record.first_key_image)
+            : carrot::make_carrot_input_context_coinbase(record.coinbase_height);
+
+        std::optional<crypto::public_key> last_ephemeral_pubkey;
+        mx25519_pubkey s_sender_receiver_unctx;
+        for (std::size_t i = 0; i < record.outputs.size(); ++i)
+        {
+            const cryptonote::output_scan_record &out = record.outputs[i];
+            if (out.view_tag.size() != sizeof(carrot::view_tag_t))
+                continue;
+            carrot::view_tag_t view_tag;
+            memcpy(view_tag.bytes, out.view_tag.data(), sizeof(view_tag.bytes));
+
+            // s_vb || input_context || Ko
+            carrot::view_tag_t internal_view_tag;
+            account.s_view_balance_dev.make_internal_view_tag(input_context, out.onetime_address, internal_view_tag);
+            if (internal_view_tag == view_tag)
+                return true;
+
+            // k_v * D_e || input_context || Ko, reusing the ECDH while D_e is shared
+            const std::size_t pubkey_index = ephemeral_pubkeys.size() == 1 ? 0 : i;
+            if (pubkey_index >= ephemeral_pubkeys.size())
+                continue;
+            if (!last_ephemeral_pubkey || *last_ephemeral_pubkey != ephemeral_pubkeys[pubkey_index])
+            {
+                last_ephemeral_pubkey = ephemeral_pubkeys[pubkey_index];
+                if (!account.k_view_incoming_dev.view_key_scalar_mult_x25519(
+                        carrot::raw_byte_convert<mx25519_pubkey>(*last_ephemeral_pubkey),
+                        s_sender_receiver_unctx))
+                {
+                    last_ephemeral_pubkey.reset();
+                    continue;
+                }
+            }
+            if (carrot::test_carrot_view_tag(s_sender_receiver_unctx.data, input_context, out.onetime_address, view_tag))
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<crypto::key_derivation> main_derivations;
+    std::vector<crypto::key_derivation> additional_derivations;
+    perform_ecdh_derivations(epee::to_span(record.tx_pub_keys),
+        epee::to_span(record.additional_tx_pub_keys),
+        account.get_keys().m_view_secret_key,
+        hwdev,
+        /*is_carrot=*/false,
+        main_derivations,
+        additional_derivations);
+
+    for (std::size_t i = 0; i < record.outputs.size(); ++i)
+    {
+        const cryptonote::output_scan_record &out = record.outputs[i];
+        if (out.view_tag.size() != sizeof(crypto::view_tag))
+            return true;
+        crypto::view_tag view_tag;
+        memcpy(&view_tag, out.view_tag.data(), sizeof(view_tag));
+
+        crypto::view_tag derived_view_tag;
+        for (const crypto::key_derivation &derivation : main_derivations)
+        {
+            crypto::derive_view_tag(derivation, i, derived_view_tag);
+            if (derived_view_tag == view_tag)
+                return true;
+        }
+        if (i < additional_derivations.size())
+        {
+            crypto::derive_view_tag(additional_derivations[i], i, derived_view_tag);
+            if (derived_view_tag == view_tag)
+                return true;
+        }
+    }
+    return false;
+}
+//-------------------------------------------------------------------------------------------------------------------
 bool is_long_payment_id(const crypto::hash &pid)
 {
     static_assert(sizeof(pid.data) / sizeof(pid.data[0]) == 32);
@@ -923,10 +1216,17 @@ bool is_long_payment_id(const crypto::hash &pid)
     return c != 0;
 }
 //-------------------------------------------------------------------------------------------------------------------
-std::optional<crypto::key_image> try_derive_enote_key_image(
+// Returns the key image directly when it is already known or derived through the account (carrot), otherwise sets
+// `legacy_out` and leaves the legacy key image L = x Hp(O) to the caller so that many of them can be batched
+static std::optional<crypto::key_image> try_derive_enote_key_image_or_defer(
     const enote_view_incoming_scan_info_t &enote_scan_info,
-    const carrot::carrot_and_legacy_account &acc)
-{   
+    const carrot::carrot_and_legacy_account &acc,
+    crypto::public_key &onetime_address_out,
+    crypto::secret_key &x_out,
+    bool &legacy_out)
+{
+    legacy_out = false;
+
     // we skip the return output key image generation here to do it in process_new_scanned_transaction.
     if (!enote_scan_info.subaddr_index)
         return std::nullopt;
@@ -937,6 +1237,30 @@ std::optional<crypto::key_image> try_derive_enote_key_image(
         return acc.get_return_output_map_ref().at(enote_scan_info.return_address).key_image;
     }
 
+    // O = K^j_s + k^g_o G + k^t_o T
+    static const ge_p3 T_p3 = crypto::get_T_p3();
+    ge_p3 tT;
+    ge_cached K_s_cached;
+    ge_p1p1 sum;
+    ge_p3 onetime_address_p3;
+    ge_scalarmult_p3(&tT, to_bytes(enote_scan_info.sender_extension_t), &T_p3);
+    ge_p3_to_cached(&K_s_cached, &tT);
+    ge_scalarmult_base(&onetime_address_p3, to_bytes(enote_scan_info.sender_extension_g));
+    ge_add(&sum, &onetime_address_p3, &K_s_cached);
+    ge_p1p1_to_p3(&onetime_address_p3, &sum);
+    rct::key onetime_address;
+    ge_p3_tobytes(onetime_address.bytes, &onetime_address_p3);
+    rct::addKeys(onetime_address, onetime_address, rct::pk2rct(enote_scan_info.address_spend_pubkey));
+    onetime_address_out = rct::rct2pk(onetime_address);
+
+    //! @TODO: HW devices
+    if (enote_scan_info.is_carrot) {
+      return acc.derive_key_image(enote_scan_info.address_spend_pubkey,
+                                  enote_scan_info.sender_extension_g,
+                                  enote_scan_info.sender_extension_t,
+                                  onetime_address_out);
+    }
+
     // k^j_subext
     rct::key subaddress_extension;
     if (enote_scan_info.subaddr_index->index.is_subaddress())
@@ -946,10 +1270,7 @@ std::optional<crypto::key_image> try_derive_enote_key_image(
         subaddress_extension = rct::sk2rct(
             acc.get_keys()
             .get_device()
-            .get_subaddress_secret_key(
-                enote_scan_info.is_carrot ? acc.get_keys().k_view_incoming : acc.get_keys().m_view_secret_key, 
-                subaddr_index_cn
-            )
+            .get_subaddress_secret_key(acc.get_keys().m_view_secret_key, subaddr_index_cn)
         );
     }
     else // !subaddr_index_cn.is_zero()
@@ -957,35 +1278,69 @@ std::optional<crypto::key_image> try_derive_enote_key_image(
         subaddress_extension = rct::Z;
     }
 
-    // O = K^j_s + k^g_o G + k^t_o T
-    rct::key onetime_address = rct::scalarmultKey(
-        rct::pk2rct(crypto::get_T()),
-        rct::sk2rct(enote_scan_info.sender_extension_t)
-    );
-    rct::addKeys1(onetime_address, rct::sk2rct(enote_scan_info.sender_extension_g), onetime_address);
-    rct::addKeys(onetime_address, onetime_address, rct::pk2rct(enote_scan_info.address_spend_pubkey));
+    // x = k_s + k^j_subext + k^g_o
+    sc_add(to_bytes(x_out),
+           to_bytes(acc.get_keys().m_spend_secret_key),
+           to_bytes(enote_scan_info.sender_extension_g));
+    sc_add(to_bytes(x_out), to_bytes(x_out), subaddress_extension.bytes);
+    memwipe(subaddress_extension.bytes, sizeof(subaddress_extension));
 
-    // I = Hp(O)
-    crypto::ec_point ki_generator;
-    crypto::derive_key_image_generator(rct::rct2pk(onetime_address), ki_generator);
+    legacy_out = true;
+    return std::nullopt;
+}
+//-------------------------------------------------------------------------------------------------------------------
+std::optional<crypto::key_image> try_derive_enote_key_image(
+    const enote_view_incoming_scan_info_t &enote_scan_info,
+    const carrot::carrot_and_legacy_account &acc)
+{
+    crypto::public_key onetime_address;
+    crypto::secret_key x;
+    bool legacy;
+    std::optional<crypto::key_image> ki = try_derive_enote_key_image_or_defer(enote_scan_info, acc,
+        onetime_address, x, legacy);
+    if (!legacy)
+        return ki;
 
-    //! @TODO: HW devices
-    // x = k_s + k^j_subext + k^g_o
-    rct::key x;
-    if (enote_scan_info.is_carrot) {
-      return acc.derive_key_image(enote_scan_info.address_spend_pubkey,
-                                  enote_scan_info.sender_extension_g,
-                                  enote_scan_info.sender_extension_t,
-                                  rct::rct2pk(onetime_address));
-    } else {
-      sc_add(x.bytes,
-             to_bytes(acc.get_keys().m_spend_secret_key),
-             to_bytes(enote_scan_info.sender_extension_g));
-      sc_add(x.bytes, x.bytes, subaddress_extension.bytes);
-    }
-    
     // L = x I = (k_s + k^j_subext + k^g_o) Hp(O)
-    return rct::rct2ki(rct::scalarmultKey(rct::pt2rct(ki_generator), x));
+    crypto::key_image legacy_ki;
+    crypto::generate_key_image(onetime_address, x, legacy_ki);
+    return legacy_ki;
+}
+//-------------------------------------------------------------------------------------------------------------------
+void try_derive_enote_key_images(
+    const epee::span<const std::optional<enote_view_incoming_scan_info_t>> enote_scan_infos,
+    const carrot::carrot_and_legacy_account &acc,
+    epee::span<std::optional<crypto::key_image>> key_images_out)
+{
+    CHECK_AND_ASSERT_THROW_MES(enote_scan_infos.size() == key_images_out.size(),
+        "try_derive_enote_key_images: mismatched enote and key image counts");
+
+    std::vector<size_t> legacy_indices;
+    std::vector<crypto::public_key> onetime_addresses;
+    std::vector<crypto::secret_key> xs;
+    for (size_t i = 0; i < enote_scan_infos.size(); ++i)
+    {
+        key_images_out[i] = std::nullopt;
+        if (!enote_scan_infos[i])
+            continue;
+
+        crypto::public_key onetime_address;
+        crypto::secret_key x;
+        bool legacy;
+        key_images_out[i] = try_derive_enote_key_image_or_defer(*enote_scan_infos[i], acc, onetime_address, x, legacy);
+        if (legacy)
+        {
+            legacy_indices.push_back(i);
+            onetime_addresses.push_back(onetime_address);
+            xs.push_back(x);
+        }
+    }
+
+    // L = x Hp(O) for all the legacy enotes at once, sharing the field inversion of the point compressions
+    std::vector<crypto::key_image> legacy_key_images(legacy_indices.size());
+    crypto::generate_key_images(onetime_addresses.data(), xs.data(), legacy_indices.size(), legacy_key_images.data());
+    for (size_t i = 0; i < legacy_indices.size(); ++i)
+        key_images_out[legacy_indices[i]] = legacy_key_images[i];
 }
 //-------------------------------------------------------------------------------------------------------------------
 } //namespace wallet
@@ -36,6 +36,7 @@
 #include "crypto/crypto.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/blobdatatype.h"
+#include "cryptonote_basic/block_scan_record.h"
 #include "cryptonote_basic/subaddress_index.h"
 #include "cryptonote_basic/tx_extra.h"
 #include "common/variant.h"
@@ -44,6 +45,7 @@
 
 //standard headers
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
 #include <vector>
 
@@ -150,16 +152,57 @@ std::vector<std::optional<enote_view_incoming_scan_info_t>> view_incoming_scan_t
     const cryptonote::transaction &tx,
     carrot::carrot_and_legacy_account &account);
 
+/**
+* brief: view_incoming_scan_protocol_transaction - view-incoming scan the protocol_tx outputs paying known return addresses
+*   A protocol_tx output pays the return address of the STAKE or AUDIT tx it returns, so only outputs whose onetime
+*   address is a pending payout of the wallet can be owned. The others are skipped without any ECDH derivation.
+* param: tx - a PROTOCOL tx
+* param: payout_onetime_addresses - return addresses of the wallet's pending payouts
+* param: account -
+* outparam: enote_scan_infos_out - one entry per output, std::nullopt for enotes that aren't ours
+* return: the number of owned enotes found
+*/
+std::size_t view_incoming_scan_protocol_transaction(
+    const cryptonote::transaction &tx,
+    const std::unordered_set<crypto::public_key> &payout_onetime_addresses,
+    carrot::carrot_and_legacy_account &account,
+    const epee::span<std::optional<enote_view_incoming_scan_info_t>> enote_scan_infos_out);
+
 std::vector<std::optional<enote_view_incoming_scan_info_t>> view_incoming_scan_transaction_as_sender(
     const cryptonote::transaction &tx,
     const epee::span<const crypto::key_derivation> custom_main_derivations,
     const epee::span<const crypto::key_derivation> custom_additional_derivations,
     const cryptonote::account_public_address &address);
 
+/**
+* brief: tx_scan_record_may_have_owned_enotes - test the view tags and known return addresses of a compact tx record
+*   A false positive rate of 2^-24 (Carrot) or 2^-8 (legacy) is expected, untagged legacy outputs always pass,
+*   and spends are not detected: the caller must fetch and fully scan every tx that passes.
+* param: record - tx record from a block_scan_record
+* param: account -
+* param: hwdev -
+* return: true if the tx may contain an enote owned by the account
+*/
+bool tx_scan_record_may_have_owned_enotes(const cryptonote::tx_scan_record &record,
+    const carrot::carrot_and_legacy_account &account,
+    hw::device &hwdev);
+
 bool is_long_payment_id(const crypto::hash &pid);
 
 std::optional<crypto::key_image> try_derive_enote_key_image(
     const enote_view_incoming_scan_info_t &enote_scan_info,
     const carrot::carrot_and_legacy_account &acc);
+/**
+* brief: try_derive_enote_key_images - try_derive_enote_key_image() over many enotes
+*   Legacy key images are generated together with crypto::generate_key_images(), which normalizes all of the
+*   resulting points with a single field inversion.
+* param: enote_scan_infos - view-incoming scan results, std::nullopt for enotes that aren't ours
+* param: acc -
+* outparam: key_images_out - one entry per enote scan info, std::nullopt when no key image could be derived
+*/
+void try_derive_enote_key_images(
+    const epee::span<const std::optional<enote_view_incoming_scan_info_t>> enote_scan_infos,
+    const carrot::carrot_and_legacy_account &acc,
+    epee::span<std::optional<crypto::key_image>> key_images_out);
 } //namespace wallet
 } //namespace tools
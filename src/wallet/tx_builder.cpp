@@ -47,11 +47,14 @@
 #include "ringct/bulletproofs_plus.h"
 #include "wallet/scanning_tools.cpp"
 #include "common/container_helpers.h"
+#include "common/threadpool.h"
 #include "carrot_core/payment_proposal.cpp"
 
 //third party headers
 
 //standard headers
+#include <exception>
+#include <numeric>
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "wallet.tx_builder"
@@ -260,12 +263,40 @@ carrot::select_inputs_func_t make_wallet2_single_transfer_input_selector(
     const bool allow_pre_carrot_inputs_in_normal_transfers,
     std::set<size_t> &selected_transfer_indices_out)
 {
-    // Collect transfer_container into a `std::vector<carrot::InputCandidate>` for usable inputs
+    std::vector<size_t> candidate_transfer_indices(transfers.size());
+    std::iota(candidate_transfer_indices.begin(), candidate_transfer_indices.end(), 0);
+    return make_wallet2_single_transfer_input_selector(transfers,
+        candidate_transfer_indices,
+        from_account,
+        from_subaddresses,
+        ignore_above,
+        ignore_below,
+        top_block_index,
+        allow_carrot_external_inputs_in_normal_transfers,
+        allow_pre_carrot_inputs_in_normal_transfers,
+        selected_transfer_indices_out);
+}
+//-------------------------------------------------------------------------------------------------------------------
+carrot::select_inputs_func_t make_wallet2_single_transfer_input_selector(
+    const wallet2::transfer_container &transfers,
+    const std::vector<size_t> &candidate_transfer_indices,
+    const std::uint32_t from_account,
+    const std::set<std::uint32_t> &from_subaddresses,
+    const rct::xmr_amount ignore_above,
+    const rct::xmr_amount ignore_below,
+    const std::uint64_t top_block_index,
+    const bool allow_carrot_external_inputs_in_normal_transfers,
+    const bool allow_pre_carrot_inputs_in_normal_transfers,
+    std::set<size_t> &selected_transfer_indices_out)
+{
+    // Collect candidate transfers into a `std::vector<carrot::InputCandidate>` for usable inputs. If the
+    // candidates come in ascending amount order, e.g. from wallet2::get_unspent_transfer_indices(),
+    // so do the input candidates, and the selection policies can skip sorting them
     std::vector<carrot::InputCandidate> input_candidates;
     std::vector<size_t> input_candidates_transfer_indices;
-    input_candidates.reserve(transfers.size());
-    input_candidates_transfer_indices.reserve(transfers.size());
-    for (size_t i = 0; i < transfers.size(); ++i)
+    input_candidates.reserve(candidate_transfer_indices.size());
+    input_candidates_transfer_indices.reserve(candidate_transfer_indices.size());
+    for (const size_t i : candidate_transfer_indices)
     {
         const wallet2::transfer_details &td = transfers.at(i);
         if (is_transfer_usable_for_input_selection(td,
@@ -301,7 +332,10 @@ carrot::select_inputs_func_t make_wallet2_single_transfer_input_selector(
                 const std::size_t num_selfsend_payment_proposals,
                 std::vector<carrot::CarrotSelectedInput> &selected_inputs_outs
             ){
+                // prefer the selection leaving the least change, falling back to greedy aging if the search
+                // runs out of budget before it finds one
                 const std::vector<carrot::input_selection_policy_t> policies{
+                    &carrot::ispolicy::select_branch_and_bound,
                     &carrot::ispolicy::select_greedy_aging
                 };
 
@@ -445,8 +479,8 @@ std::vector<carrot::CarrotTransactionProposalV1> make_carrot_transaction_proposa
     wallet2::unique_index_container subtract_fee_from_outputs,
     const std::uint64_t top_block_index)
 {
-    wallet2::transfer_container unused_transfers;
-    w.get_transfers(unused_transfers);
+    const wallet2::transfer_container &transfers = w.get_transfers_ref();
+    std::vector<size_t> unused_transfer_indices = w.get_unspent_transfer_indices("SAL1", subaddr_account);
 
     std::vector<carrot::CarrotTransactionProposalV1> tx_proposals;
     tx_proposals.reserve(dsts.size() / (carrot::CARROT_MAX_TX_OUTPUTS - 1) + 1);
@@ -483,7 +517,8 @@ std::vector<carrot::CarrotTransactionProposalV1> make_carrot_transaction_proposa
         // make input selector
         std::set<size_t> selected_transfer_indices;
         carrot::select_inputs_func_t select_inputs = make_wallet2_single_transfer_input_selector(
-            unused_transfers,
+            transfers,
+            unused_transfer_indices,
             subaddr_account,
             subaddr_indices,
             w.ignore_outputs_above(),
@@ -514,16 +549,16 @@ std::vector<carrot::CarrotTransactionProposalV1> make_carrot_transaction_proposa
         for (const auto &ki: tx_proposal.key_images_sorted) {
             selected_transfer_indices_sorted.push_back(w.get_transfer_details(ki));
         }
-        tx_proposal.sources = get_sources(unused_transfers, selected_transfer_indices_sorted, "SAL1", w);
+        tx_proposal.sources = get_sources(transfers, selected_transfer_indices_sorted, "SAL1", w);
 
-        // update `unused_transfers` for next proposal by removing selected transfers
-        tools::for_all_in_vector_erase_no_preserve_order_if(unused_transfers,
-            [&tx_proposal](const wallet2::transfer_details &td) -> bool {
+        // update `unused_transfer_indices` for next proposal by removing selected transfers, keeping amount order
+        unused_transfer_indices.erase(std::remove_if(unused_transfer_indices.begin(), unused_transfer_indices.end(),
+            [&transfers, &tx_proposal](const size_t idx) -> bool {
                 const auto &used_kis = tx_proposal.key_images_sorted;
-                const auto ki_it = std::find(used_kis.cbegin(), used_kis.cend(), td.m_key_image);
+                const auto ki_it = std::find(used_kis.cbegin(), used_kis.cend(), transfers.at(idx).m_key_image);
                 return ki_it != used_kis.cend();
-            }
-        );
+            }),
+            unused_transfer_indices.end());
 
         tx_proposals.push_back(std::move(tx_proposal));
     }
@@ -723,15 +758,17 @@ std::vector<carrot::CarrotTransactionProposalV1> make_carrot_transaction_proposa
     const std::set<uint32_t> &subaddr_indices,
     const std::uint64_t top_block_index)
 {
-    wallet2::transfer_container transfers;
-    w.get_transfers(transfers);
+    const wallet2::transfer_container &transfers = w.get_transfers_ref();
 
     const std::unordered_map<crypto::key_image, size_t> unburned_transfers_by_key_image =
         collect_non_burned_transfers_by_key_image(transfers);
 
+    // only visit unspent transfers of this account, but keep sweeping them in the order they were received
+    std::vector<size_t> unspent_transfer_indices = w.get_unspent_transfer_indices("SAL1", subaddr_account);
+    std::sort(unspent_transfer_indices.begin(), unspent_transfer_indices.end());
     std::vector<crypto::key_image> input_key_images;
-    input_key_images.reserve(transfers.size());
-    for (std::size_t transfer_idx = 0; transfer_idx < transfers.size(); ++transfer_idx)
+    input_key_images.reserve(unspent_transfer_indices.size());
+    for (const std::size_t transfer_idx : unspent_transfer_indices)
     {
         const wallet2::transfer_details &td = transfers.at(transfer_idx);
 
@@ -992,6 +1029,7 @@ void encrypt_change_index(
 //-------------------------------------------------------------------------------------------------------------------
 cryptonote::transaction finalize_all_proofs_from_transfer_details(
     const carrot::CarrotTransactionProposalV1 &tx_proposal,
+    const wallet2::transfer_container &transfers,
     const wallet2 &w)
 {
     const size_t n_inputs = tx_proposal.key_images_sorted.size();
@@ -1005,8 +1043,6 @@ cryptonote::transaction finalize_all_proofs_from_transfer_details(
         << tx_proposal.selfsend_payment_proposals.size() << " self-send payment proposals, and a fee of "
         << cryptonote::print_money(tx_proposal.fee) << " SAL1");
 
-    wallet2::transfer_container transfers;
-    w.get_transfers(transfers);
     cryptonote::account_keys acc_keys = w.get_account().get_keys();
 
     // collect core selfsend proposals
@@ -1240,6 +1276,16 @@ cryptonote::transaction finalize_all_proofs_from_transfer_details(
     return tx;
 }
 //-------------------------------------------------------------------------------------------------------------------
+cryptonote::transaction finalize_all_proofs_from_transfer_details(
+    const carrot::CarrotTransactionProposalV1 &tx_proposal,
+    const wallet2 &w)
+{
+    wallet2::transfer_container transfers;
+    w.get_transfers(transfers);
+
+    return finalize_all_proofs_from_transfer_details(tx_proposal, transfers, w);
+}
+//-------------------------------------------------------------------------------------------------------------------
 wallet2::pending_tx make_pending_carrot_tx(const carrot::CarrotTransactionProposalV1 &tx_proposal,
     const wallet2::transfer_container &transfers,
     const carrot::carrot_and_legacy_account &account)
@@ -1390,6 +1436,7 @@ wallet2::pending_tx finalize_all_proofs_from_transfer_details_as_pending_tx(
 
     ptx.tx = finalize_all_proofs_from_transfer_details(
         tx_proposal,
+        transfers,
         w
     );
 
@@ -1409,5 +1456,50 @@ wallet2::pending_tx finalize_all_proofs_from_transfer_details_as_pending_tx(
         w);
 }
 //-------------------------------------------------------------------------------------------------------------------
+std::vector<wallet2::pending_tx> finalize_all_proofs_from_transfer_details_as_pending_txs(
+    const std::vector<carrot::CarrotTransactionProposalV1> &tx_proposals,
+    const wallet2 &w)
+{
+    wallet2::transfer_container transfers;
+    w.get_transfers(transfers);
+
+    std::vector<wallet2::pending_tx> ptx_vector(tx_proposals.size());
+
+    // a hardware device keeps per tx state, so its proposals are proven one by one
+    const bool parallel = tx_proposals.size() > 1
+        && w.get_account().get_device().get_type() == hw::device::SOFTWARE;
+    if (!parallel)
+    {
+        for (size_t i = 0; i < tx_proposals.size(); ++i)
+            ptx_vector[i] = finalize_all_proofs_from_transfer_details_as_pending_tx(tx_proposals[i], transfers, w);
+        return ptx_vector;
+    }
+
+    // each proposal is independent, and fills in its own slot so the order stays that of the proposals
+    std::vector<std::exception_ptr> errors(tx_proposals.size());
+    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+    tools::threadpool::waiter waiter(tpool);
+    for (size_t i = 0; i < tx_proposals.size(); ++i)
+    {
+        tpool.submit(&waiter, [&, i]() {
+            try
+            {
+                ptx_vector[i] = finalize_all_proofs_from_transfer_details_as_pending_tx(tx_proposals[i], transfers, w);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error,
+        "Unrecognized exception while finalizing tx proposals");
+    for (const std::exception_ptr &e : errors)
+        if (e)
+            std::rethrow_exception(e);
+
+    return ptx_vector;
+}
+//-------------------------------------------------------------------------------------------------------------------
 } //namespace wallet
 } //namespace tools
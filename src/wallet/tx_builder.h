@@ -46,6 +46,18 @@ namespace wallet
 std::unordered_map<crypto::key_image, size_t> collect_non_burned_transfers_by_key_image(
     const wallet2::transfer_container &transfers);
 
+carrot::select_inputs_func_t make_wallet2_single_transfer_input_selector(
+    const wallet2::transfer_container &transfers,
+    const std::vector<size_t> &candidate_transfer_indices,
+    const std::uint32_t from_account,
+    const std::set<std::uint32_t> &from_subaddresses,
+    const rct::xmr_amount ignore_above,
+    const rct::xmr_amount ignore_below,
+    const std::uint64_t top_block_index,
+    const bool allow_carrot_external_inputs_in_normal_transfers,
+    const bool allow_pre_carrot_inputs_in_normal_transfers,
+    std::set<size_t> &selected_transfer_indices_out);
+
 carrot::select_inputs_func_t make_wallet2_single_transfer_input_selector(
     const wallet2::transfer_container &transfers,
     const std::uint32_t from_account,
@@ -129,7 +141,11 @@ wallet2::pending_tx make_pending_carrot_tx(const carrot::CarrotTransactionPropos
 
 cryptonote::transaction finalize_all_proofs_from_transfer_details(
     const carrot::CarrotTransactionProposalV1 &tx_proposal,
-    const cryptonote::transaction_type tx_type,
+    const wallet2::transfer_container &transfers,
+    const wallet2 &w);
+
+cryptonote::transaction finalize_all_proofs_from_transfer_details(
+    const carrot::CarrotTransactionProposalV1 &tx_proposal,
     const wallet2 &w);
 
 wallet2::pending_tx finalize_all_proofs_from_transfer_details_as_pending_tx(
@@ -141,6 +157,12 @@ wallet2::pending_tx finalize_all_proofs_from_transfer_details_as_pending_tx(
     const carrot::CarrotTransactionProposalV1 &tx_proposal,
     const wallet2 &w);
 
+// proves the proposals concurrently on the compute threadpool when the wallet device allows it,
+// the pending txs come back in the order of the proposals
+std::vector<wallet2::pending_tx> finalize_all_proofs_from_transfer_details_as_pending_txs(
+    const std::vector<carrot::CarrotTransactionProposalV1> &tx_proposals,
+    const wallet2 &w);
+
 carrot::AddressDeriveType resolve_derive_type(const carrot::AddressDeriveType derive_type);
 } //namespace wallet
 } //namespace tools
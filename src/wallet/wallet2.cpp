@@ -30,6 +30,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <algorithm>
+#include <future>
 #include <numeric>
 #include <tuple>
 #include <queue>
@@ -50,6 +51,7 @@ using namespace epee;
 
 #include "cryptonote_config.h"
 #include "hardforks/hardforks.h"
+#include "cryptonote_core/enote_stream.h"
 #include "cryptonote_core/tx_sanity_check.h"
 #include "wallet_rpc_helpers.h"
 #include "wallet2.h"
@@ -69,6 +71,8 @@ using namespace epee;
 #include "common/boost_serialization_helper.h"
 #include "common/command_line.h"
 #include "common/threadpool.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "int-util.h"
 #include "profile_tools.h"
 #include "crypto/crypto.h"
@@ -135,6 +139,8 @@ using namespace cryptonote;
 #define SUBADDRESS_LOOKAHEAD_MINOR 200
 
 #define KEY_IMAGE_EXPORT_FILE_MAGIC "Salvium key image export\003"
+#define KEY_IMAGE_EXPORT_CHUNKED_FILE_MAGIC "Salvium key image export\004"
+#define KEY_IMAGE_EXPORT_CHUNK_SIZE 4096 // signed key images per encrypted chunk of a key image export file
 
 #define MULTISIG_EXPORT_FILE_MAGIC "Salvium multisig export\001"
 
@@ -147,8 +153,12 @@ using namespace cryptonote;
 
 #define FIRST_REFRESH_GRANULARITY     1024
 
+#define REFRESH_MIN_BLOCK_COUNT       20
+#define REFRESH_MAX_BATCH_BYTES       (64 * 1024 * 1024) // cap on block data pulled in one refresh batch
+
 #define GAMMA_SHAPE 19.28
 #define GAMMA_SCALE (1/1.61)
+#define GAMMA_PICK_BATCH_SIZE 256 // gamma picks drawn at once to serve single picks
 
 #define DEFAULT_MIN_OUTPUT_COUNT 5
 #define DEFAULT_MIN_OUTPUT_VALUE (2*COIN)
@@ -158,6 +168,15 @@ using namespace cryptonote;
 #define IGNORE_LONG_PAYMENT_ID_FROM_BLOCK_VERSION 12
 
 #define DEFAULT_UNLOCK_TIME (CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE * DIFFICULTY_TARGET_V2)
+#define CACHE_DELTA_COMPACTION_RATIO 4 // store the full cache once a delta would exceed a quarter of it
+
+#define RCT_DISTRIBUTION_REFRESH_DEPTH 10 // blocks of a cached output distribution requested again, to follow small reorgs
+#define OUTKEY_CACHE_SIZE 8192 // output keys kept from previous get_outs.bin calls
+#define DAEMON_CONNECTION_POOL_SIZE 2 // keep-alive daemon connections besides the main one
+#define SCANNED_POOL_TXS_GENERATION_SIZE 5000 // pool txids per generation of the scanned pool tx cache
+
+#define BALANCE_HISTORY_SNAPSHOT_INTERVAL 1000 // blocks between balance history checkpoints
+
 #define RECENT_SPEND_WINDOW (15 * DIFFICULTY_TARGET_V2)
 
 static const std::string MULTISIG_SIGNATURE_MAGIC = "SigMultisigPkV1";
@@ -171,6 +190,21 @@ std::string tools::wallet2::default_daemon_address = "";
 
 namespace
 {
+  tools::metrics::histogram &refresh_stage_time(const char *stage)
+  {
+    return tools::metrics::get_histogram("wallet_refresh_seconds", "Time taken by each stage of a wallet refresh", tools::metrics::label("stage", stage));
+  }
+
+  // the onetime address the protocol_tx pays a STAKE / AUDIT tx out to, as the daemon records it
+  crypto::public_key get_protocol_payout_key(const cryptonote::transaction_prefix &tx)
+  {
+    if (tx.type == cryptonote::transaction_type::STAKE && tx.version >= TRANSACTION_VERSION_CARROT)
+      return tx.protocol_tx_data.return_address;
+    if (tx.version >= TRANSACTION_VERSION_N_OUTS && !tx.return_address_list.empty())
+      return tx.return_address_list[0];
+    return tx.return_address;
+  }
+
   std::string get_default_ringdb_path()
   {
     boost::filesystem::path dir = tools::get_default_data_dir();
@@ -1043,6 +1077,21 @@ crypto::chacha_key derive_cache_key(const crypto::chacha_key& keys_data_key, con
 
   return cache_key;
 }
+
+// the wallet cache containers that are kept serialized until first accessed
+struct history_section
+{
+  serializable_unordered_map<crypto::hash, tools::wallet2::confirmed_transfer_details> &confirmed_txs;
+  serializable_unordered_map<crypto::hash, std::string> &tx_notes;
+  std::vector<tools::wallet2::address_book_row> &address_book;
+
+  BEGIN_SERIALIZE_OBJECT()
+    VERSION_FIELD(0)
+    FIELD(confirmed_txs)
+    FIELD(tx_notes)
+    FIELD(address_book)
+  END_SERIALIZE()
+};
   //-----------------------------------------------------------------
 } //namespace
 
@@ -1052,7 +1101,8 @@ constexpr const std::chrono::seconds wallet2::rpc_timeout;
 const char* wallet2::tr(const char* str) { return i18n_translate(str, "tools::wallet2"); }
 
 gamma_picker::gamma_picker(const std::vector<uint64_t> &rct_offsets, double shape, double scale):
-    rct_offsets(rct_offsets)
+    rct_offsets(rct_offsets),
+    next_batched_pick(0)
 {
   gamma = std::gamma_distribution<double>(shape, scale);
   THROW_WALLET_EXCEPTION_IF(rct_offsets.size() <= CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE, error::wallet_internal_error, "Bad offset calculation");
@@ -1069,6 +1119,41 @@ gamma_picker::gamma_picker(const std::vector<uint64_t> &rct_offsets, double shap
 gamma_picker::gamma_picker(const std::vector<uint64_t> &rct_offsets): gamma_picker(rct_offsets, GAMMA_SHAPE, GAMMA_SCALE) {}
 
 uint64_t gamma_picker::pick()
+{
+  if (next_batched_pick >= batched_picks.size())
+  {
+    pick(GAMMA_PICK_BATCH_SIZE, batched_picks);
+    next_batched_pick = 0;
+  }
+  return batched_picks[next_batched_pick++];
+};
+
+void gamma_picker::pick(size_t count, std::vector<uint64_t> &picks_out)
+{
+  picks_out.assign(count, std::numeric_limits<uint64_t>::max());
+
+  // draw all the samples first, remembering where each one goes, so the output order stays random
+  std::vector<std::pair<uint64_t, size_t>> output_indices;
+  output_indices.reserve(count);
+  for (size_t n = 0; n < count; ++n)
+  {
+    const uint64_t output_index = pick_output_index();
+    if (output_index != std::numeric_limits<uint64_t>::max())
+      output_indices.push_back({output_index, n});
+  }
+
+  // then find their blocks in one pass, each search starting where the previous one ended
+  std::sort(output_indices.begin(), output_indices.end());
+  const uint64_t *it = begin;
+  for (const auto &e: output_indices)
+  {
+    it = std::lower_bound(it, end, e.first);
+    THROW_WALLET_EXCEPTION_IF(it == end, error::wallet_internal_error, "output_index not found");
+    picks_out[e.second] = pick_in_block(std::distance(begin, it));
+  }
+}
+
+uint64_t gamma_picker::pick_output_index()
 {
   double x = gamma(engine);
   x = exp(x);
@@ -1103,12 +1188,11 @@ uint64_t gamma_picker::pick()
   uint64_t output_index = x / average_output_time;
   if (output_index >= num_rct_outputs)
     return std::numeric_limits<uint64_t>::max(); // bad pick
-  output_index = num_rct_outputs - 1 - output_index;
-
-  const uint64_t *it = std::lower_bound(begin, end, output_index);
-  THROW_WALLET_EXCEPTION_IF(it == end, error::wallet_internal_error, "output_index not found");
-  uint64_t index = std::distance(begin, it);
+  return num_rct_outputs - 1 - output_index;
+};
 
+uint64_t gamma_picker::pick_in_block(uint64_t index)
+{
   const uint64_t first_rct = index == 0 ? 0 : rct_offsets[index - 1];
   const uint64_t n_rct = rct_offsets[index] - first_rct;
   if (n_rct == 0)
@@ -1203,6 +1287,10 @@ void wallet_device_callback::on_progress(const hw::device_progress& event)
 
 wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended, std::unique_ptr<epee::net_utils::http::http_client_factory> http_client_factory):
   m_http_client(http_client_factory->create()),
+  m_balance_history_valid(false),
+  m_protocol_payout_keys_complete(true),
+  m_outkey_cache(OUTKEY_CACHE_SIZE),
+  m_history_section_loaded(true),
   m_multisig_rescan_info(NULL),
   m_multisig_rescan_k(NULL),
   m_upper_transaction_weight_limit(0),
@@ -1225,6 +1313,7 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended, std
   m_confirm_non_default_ring_size(true),
   m_ask_password(AskPasswordToDecrypt),
   m_max_reorg_depth(ORPHANED_BLOCKS_MAX_COUNT),
+  m_refresh_block_count(COMMAND_RPC_GET_BLOCKS_FAST_MAX_BLOCK_COUNT),
   m_min_output_count(0),
   m_min_output_value(0),
   m_merge_destinations(false),
@@ -1277,10 +1366,18 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended, std
   m_enable_multisig(false),
   m_freeze_incoming_payments(false),
   m_send_change_back_to_subaddress(false),
+  m_store_cache_delta(false),
+  m_cache_checkpoint_size(0),
   m_pool_info_query_time(0),
   m_has_ever_refreshed_from_node(false),
   m_allow_mismatched_daemon_version(false)
 {
+  for (size_t n = 0; n < DAEMON_CONNECTION_POOL_SIZE; ++n)
+  {
+    std::unique_ptr<daemon_connection> connection(new daemon_connection());
+    connection->http_client = http_client_factory->create();
+    m_daemon_connection_pool.push_back(std::move(connection));
+  }
   set_rpc_client_secret_key(rct::rct2sk(rct::skGen()));
 }
 
@@ -1289,6 +1386,23 @@ wallet2::~wallet2()
   deinit();
 }
 
+wallet2::daemon_connection_lease::daemon_connection_lease(wallet2 &wallet):
+  m_http_client(nullptr)
+{
+  for (const auto &connection: wallet.m_daemon_connection_pool)
+  {
+    boost::unique_lock<boost::mutex> pool_lock(connection->mutex, boost::try_to_lock);
+    if (pool_lock.owns_lock())
+    {
+      m_pool_lock = std::move(pool_lock);
+      m_http_client = connection->http_client.get();
+      return;
+    }
+  }
+  m_daemon_rpc_lock = boost::unique_lock<boost::recursive_mutex>(wallet.m_daemon_rpc_mutex);
+  m_http_client = wallet.m_http_client.get();
+}
+
 bool wallet2::has_testnet_option(const boost::program_options::variables_map& vm)
 {
   return command_line::get_arg(vm, options().testnet);
@@ -1394,6 +1508,12 @@ bool wallet2::set_daemon(std::string daemon_address, boost::optional<epee::net_u
 
   if(m_http_client->is_connected())
     m_http_client->disconnect();
+  for (const auto &connection: m_daemon_connection_pool)
+  {
+    boost::lock_guard<boost::mutex> connection_lock(connection->mutex);
+    if (connection->http_client->is_connected())
+      connection->http_client->disconnect();
+  }
   CHECK_AND_ASSERT_MES2(m_proxy.empty() || proxy.empty() , "It is not possible to set global proxy (--proxy) and daemon specific proxy together.");
   if(m_proxy.empty())
     CHECK_AND_ASSERT_MES(set_proxy(proxy), false, "failed to set proxy address");
@@ -1415,6 +1535,12 @@ bool wallet2::set_daemon(std::string daemon_address, boost::optional<epee::net_u
 
   const std::string address = get_daemon_address();
   MINFO("setting daemon to " << address);
+  for (const auto &connection: m_daemon_connection_pool)
+  {
+    boost::lock_guard<boost::mutex> connection_lock(connection->mutex);
+    CHECK_AND_ASSERT_MES(connection->http_client->set_server(address, get_daemon_login(), ssl_options), false,
+      "failed to set daemon address on pooled connection");
+  }
   bool ret =  m_http_client->set_server(address, get_daemon_login(), std::move(ssl_options));
   if (ret)
   {
@@ -1426,6 +1552,12 @@ bool wallet2::set_daemon(std::string daemon_address, boost::optional<epee::net_u
 //----------------------------------------------------------------------------------------------------
 bool wallet2::set_proxy(const std::string &address)
 {
+  for (const auto &connection: m_daemon_connection_pool)
+  {
+    boost::lock_guard<boost::mutex> connection_lock(connection->mutex);
+    if (!connection->http_client->set_proxy(address))
+      return false;
+  }
   return m_http_client->set_proxy(address);
 }
 //----------------------------------------------------------------------------------------------------
@@ -1572,11 +1704,10 @@ cryptonote::account_public_address wallet2::get_subaddress(const cryptonote::sub
 //----------------------------------------------------------------------------------------------------
 boost::optional<cryptonote::subaddress_index> wallet2::get_subaddress_index(const cryptonote::account_public_address& address) const
 {
-  const auto subaddress_map = m_account.get_subaddress_map_ref();
-  auto carrot_index = subaddress_map.find(address.m_spend_public_key);
-  if (carrot_index == subaddress_map.end())
+  const std::optional<carrot::subaddress_index_extended> carrot_index = m_account.find_subaddress(address.m_spend_public_key);
+  if (!carrot_index)
     return boost::none;
-  cryptonote::subaddress_index index{carrot_index->second.index.major, carrot_index->second.index.minor};
+  cryptonote::subaddress_index index{carrot_index->index.major, carrot_index->index.minor};
   return index;
 }
 //----------------------------------------------------------------------------------------------------
@@ -1652,45 +1783,91 @@ bool wallet2::should_expand(const cryptonote::subaddress_index &index) const
 //----------------------------------------------------------------------------------------------------
 void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index)
 {
-  hw::device &hwdev = m_account.get_device();
-  std::unordered_map<crypto::public_key, carrot::subaddress_index_extended> new_addresses;
+  // {major, begin, end} ranges of minor indices to add
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> ranges;
   if (m_subaddress_labels.size() <= index.major)
   {
     // add new accounts
-    cryptonote::subaddress_index index2;
     const uint32_t major_end = get_subaddress_clamped_sum(index.major, m_subaddress_lookahead_major);
-    for (index2.major = m_subaddress_labels.size(); index2.major < major_end; ++index2.major)
-    {
-      const uint32_t end = get_subaddress_clamped_sum((index2.major == index.major ? index.minor : 0), m_subaddress_lookahead_minor);
-      const std::vector<crypto::public_key> pkeys = hwdev.get_subaddress_spend_public_keys(m_account.get_keys(), index2.major, 0, end);
-      for (index2.minor = 0; index2.minor < end; ++index2.minor)
-      {
-         const crypto::public_key &D = pkeys[index2.minor];
-         m_subaddresses[D] = index2;
-         new_addresses.insert({D, {{index2.major, index2.minor}, carrot::AddressDeriveType::PreCarrot, false}});
-      }
-    }
+    for (uint32_t major = m_subaddress_labels.size(); major < major_end; ++major)
+      ranges.emplace_back(major, 0, get_subaddress_clamped_sum((major == index.major ? index.minor : 0), m_subaddress_lookahead_minor));
+  }
+  else if (m_subaddress_labels[index.major].size() <= index.minor)
+  {
+    // add new subaddresses
+    ranges.emplace_back(index.major, m_subaddress_labels[index.major].size(), get_subaddress_clamped_sum(index.minor, m_subaddress_lookahead_minor));
+  }
+
+  generate_subaddresses(ranges);
+
+  if (m_subaddress_labels.size() <= index.major)
+  {
     m_subaddress_labels.resize(index.major + 1, {"Untitled account"});
     m_subaddress_labels[index.major].resize(index.minor + 1);
     get_account_tags();
   }
   else if (m_subaddress_labels[index.major].size() <= index.minor)
   {
-    // add new subaddresses
-    const uint32_t end = get_subaddress_clamped_sum(index.minor, m_subaddress_lookahead_minor);
-    const uint32_t begin = m_subaddress_labels[index.major].size();
-    cryptonote::subaddress_index index2 = {index.major, begin};
-    const std::vector<crypto::public_key> pkeys = hwdev.get_subaddress_spend_public_keys(m_account.get_keys(), index2.major, index2.minor, end);
-    for (; index2.minor < end; ++index2.minor)
-    {
-       const crypto::public_key &D = pkeys[index2.minor - begin];
-       m_subaddresses[D] = index2;
-       new_addresses.insert({D, {{index2.major, index2.minor}, carrot::AddressDeriveType::PreCarrot, false}});
-    }
     m_subaddress_labels[index.major].resize(index.minor + 1);
   }
-  // Add to the Carrot account
-  m_account.insert_subaddresses(new_addresses);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::generate_subaddresses(const std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> &ranges)
+{
+  // ranges are cut in chunks so a big lookahead spreads over the threadpool, each chunk also
+  // makes its own matching Carrot subaddresses
+  static constexpr uint32_t SUBADDRESS_CHUNK_SIZE = 1024;
+  struct subaddress_chunk
+  {
+    uint32_t major;
+    uint32_t begin;
+    uint32_t end;
+    std::vector<crypto::public_key> pkeys;
+    std::vector<std::pair<crypto::public_key, carrot::subaddress_index_extended>> entries;
+  };
+  std::vector<subaddress_chunk> chunks;
+  for (const auto &range : ranges)
+  {
+    const uint32_t major = std::get<0>(range);
+    const uint32_t end = std::get<2>(range);
+    for (uint32_t begin = std::get<1>(range); begin < end; begin = end - begin > SUBADDRESS_CHUNK_SIZE ? begin + SUBADDRESS_CHUNK_SIZE : end)
+      chunks.push_back({major, begin, end - begin > SUBADDRESS_CHUNK_SIZE ? begin + SUBADDRESS_CHUNK_SIZE : end, {}, {}});
+  }
+  if (chunks.empty())
+    return;
+
+  hw::device &hwdev = m_account.get_device();
+  const auto generate_chunk = [this, &hwdev](subaddress_chunk &chunk)
+  {
+    chunk.pkeys = hwdev.get_subaddress_spend_public_keys(m_account.get_keys(), chunk.major, chunk.begin, chunk.end);
+    std::unordered_map<crypto::public_key, carrot::subaddress_index_extended> new_addresses;
+    for (uint32_t minor = chunk.begin; minor < chunk.end; ++minor)
+      new_addresses.insert({chunk.pkeys[minor - chunk.begin], {{chunk.major, minor}, carrot::AddressDeriveType::PreCarrot, false}});
+    chunk.entries = m_account.make_subaddress_entries(new_addresses);
+  };
+
+  // hardware devices keep a session, so they are asked serially
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  if (chunks.size() == 1 || hwdev.get_type() != hw::device::SOFTWARE || tpool.get_max_concurrency() <= 1)
+  {
+    for (subaddress_chunk &chunk : chunks)
+      generate_chunk(chunk);
+  }
+  else
+  {
+    tools::threadpool::waiter waiter(tpool);
+    for (subaddress_chunk &chunk : chunks)
+      tpool.submit(&waiter, [&generate_chunk, &chunk]() { generate_chunk(chunk); }, true);
+    THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+  }
+
+  for (const subaddress_chunk &chunk : chunks)
+  {
+    for (uint32_t minor = chunk.begin; minor < chunk.end; ++minor)
+      m_subaddresses[chunk.pkeys[minor - chunk.begin]] = {chunk.major, minor};
+    // Add to the Carrot account
+    m_account.insert_subaddress_entries(chunk.entries);
+  }
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::create_one_off_subaddress(const cryptonote::subaddress_index& index)
@@ -1878,6 +2055,7 @@ void wallet2::process_scan_txs(const tx_entry_data &txs_to_scan, const tx_entry_
       ignore_callbacks);
 
     // Re-set destination addresses if they were previously set
+    ensure_history_loaded();
     if (m_confirmed_txs.find(tx_info.tx_hash) != m_confirmed_txs.end() &&
         dbd.detached_confirmed_txs_dests.find(tx_info.tx_hash) != dbd.detached_confirmed_txs_dests.end())
     {
@@ -1948,14 +2126,14 @@ void wallet2::scan_tx(const std::unordered_set<crypto::hash> &txids)
     // tx that the user did not request to scan, then we fail out because
     // re-requesting those unexpected txs from the daemon poses a more severe
     // and unintuitive privacy risk to the user
+    ensure_history_loaded();
     THROW_WALLET_EXCEPTION_IF(!is_trusted_daemon() &&
       has_nonrequested_tx_at_height_or_above_requested(txs_to_scan.lowest_height, txids, m_transfers, m_payments, m_confirmed_txs),
       error::wont_reprocess_recent_txs_via_untrusted_daemon
     );
 
     LOG_PRINT_L0("Re-processing wallet's existing txs (if any) starting from height " << txs_to_scan.lowest_height);
-    auto output_tracker_cache = create_output_tracker_cache();
-    dbd = detach_blockchain(txs_to_scan.lowest_height, output_tracker_cache);
+    dbd = detach_blockchain(txs_to_scan.lowest_height);
   }
   std::unordered_set<crypto::hash> tx_hashes_to_reprocess;
   tx_hashes_to_reprocess.reserve(dbd.detached_tx_hashes.size());
@@ -2000,6 +2178,32 @@ void wallet2::scan_tx(const std::unordered_set<crypto::hash> &txids)
   }
 }
 //----------------------------------------------------------------------------------------------------
+size_t wallet2::import_enote_stream(const std::string &filename)
+{
+  std::ifstream in(filename, std::ios_base::binary);
+  THROW_WALLET_EXCEPTION_IF(!in, error::file_read_error, filename);
+
+  std::vector<cryptonote::light_wallet_output> outputs;
+  uint64_t scanned_height;
+  crypto::hash top_id;
+  THROW_WALLET_EXCEPTION_IF(!cryptonote::enote_stream::read(in, outputs, scanned_height, top_id),
+    error::wallet_internal_error, "Not an enote stream: " + filename);
+  MINFO("Enote stream " << filename << " covers " << scanned_height << " blocks, " << outputs.size() << " enotes");
+
+  // only the txs the wallet has not processed yet, scan_tx would re-process the others
+  std::unordered_set<crypto::hash> known_txids;
+  for (const transfer_details &td : m_transfers)
+    known_txids.insert(td.m_txid);
+  std::unordered_set<crypto::hash> txids;
+  for (const cryptonote::light_wallet_output &output : outputs)
+    if (known_txids.find(output.tx_hash) == known_txids.end())
+      txids.insert(output.tx_hash);
+
+  if (!txids.empty())
+    scan_tx(txids);
+  return txids.size();
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::set_subaddress_label(const cryptonote::subaddress_index& index, const std::string &label)
 {
   THROW_WALLET_EXCEPTION_IF(index.major >= m_subaddress_labels.size(), error::account_index_outofbound);
@@ -2032,6 +2236,7 @@ void wallet2::set_spent(size_t idx, uint64_t height)
   LOG_PRINT_L2("Setting SPENT at " << height << ": ki " << td.m_key_image << ", amount " << print_money(td.m_amount));
   td.m_spent = true;
   td.m_spent_height = height;
+  update_unspent_transfer_index(idx);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::set_spent(const crypto::key_image &ki, const uint64_t height)
@@ -2054,6 +2259,246 @@ void wallet2::set_unspent(size_t idx)
   LOG_PRINT_L2("Setting UNSPENT: ki " << td.m_key_image << ", amount " << print_money(td.m_amount));
   td.m_spent = false;
   td.m_spent_height = 0;
+  update_unspent_transfer_index(idx);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::update_unspent_transfer_index(size_t idx)
+{
+  const transfer_details &td = m_transfers[idx];
+  const std::pair<uint64_t, size_t> entry{td.amount(), idx};
+  auto &unspent = m_unspent_transfer_index[{td.asset_type, td.m_subaddr_index.major}];
+  if (td.m_spent)
+    unspent.erase(entry);
+  else
+    unspent.insert(entry);
+  update_balance_index(idx);
+  m_balance_history_valid = false;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_unspent_transfer_index()
+{
+  m_unspent_transfer_index.clear();
+  m_balance_index.clear();
+  m_balance_contributions.clear();
+  m_balance_history_valid = false;
+  for (size_t i = 0; i < m_transfers.size(); ++i)
+    update_unspent_transfer_index(i);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::get_transfer_unlock_heights(const transfer_details &td, uint64_t &unlock_height, uint64_t &reported_unlock_height) const
+{
+  // mirrors is_transfer_unlocked() and the reporting in unlocked_balance_per_subaddress()
+  const bool mined = td.m_tx.type == cryptonote::transaction_type::MINER || td.m_tx.type == cryptonote::transaction_type::PROTOCOL;
+  uint64_t unlock_time = 0;
+  if (!cryptonote::get_output_unlock_time(td.m_tx.vout[td.m_internal_output_index], unlock_time))
+  {
+    unlock_height = std::numeric_limits<uint64_t>::max();
+    reported_unlock_height = td.m_block_height + (mined ? CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW : CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
+    return;
+  }
+  if (mined)
+    reported_unlock_height = td.m_block_height + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+  else
+    reported_unlock_height = td.m_block_height + std::max<uint64_t>(unlock_time, CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
+
+  if (unlock_time == 0)
+    unlock_time = mined ? CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW : CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE;
+  if (unlock_time >= CRYPTONOTE_MAX_BLOCK_NUMBER)
+  {
+    unlock_height = std::numeric_limits<uint64_t>::max();
+    return;
+  }
+  const uint64_t spendtime_height = td.m_block_height + std::max<uint64_t>(CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE, unlock_time) + 1 - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS;
+  unlock_height = std::max<uint64_t>(spendtime_height, td.m_block_height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::update_balance_index(size_t idx)
+{
+  const transfer_details &td = m_transfers[idx];
+  if (m_balance_contributions.size() < m_transfers.size())
+    m_balance_contributions.resize(m_transfers.size());
+  balance_contribution &contribution = m_balance_contributions[idx];
+
+  balance_contribution updated;
+  if (!td.m_frozen)
+  {
+    if (!td.m_spent)
+      updated.category = balance_contribution::unspent;
+    else if (td.m_spent_height == 0)
+      updated.category = balance_contribution::pending_spend;
+  }
+  if (updated.category != balance_contribution::none)
+  {
+    updated.amount = td.amount();
+    get_transfer_unlock_heights(td, updated.unlock_height, updated.reported_unlock_height);
+  }
+
+  const std::pair<std::string, uint32_t> account{td.asset_type, td.m_subaddr_index.major};
+  if (contribution.category != balance_contribution::none)
+  {
+    auto account_it = m_balance_index.find(account);
+    THROW_WALLET_EXCEPTION_IF(account_it == m_balance_index.end(), error::wallet_internal_error, "Balance index out of sync");
+    auto subaddr_it = account_it->second.find(td.m_subaddr_index.minor);
+    THROW_WALLET_EXCEPTION_IF(subaddr_it == account_it->second.end(), error::wallet_internal_error, "Balance index out of sync");
+    subaddress_balance &balance = subaddr_it->second;
+    const size_t c = contribution.category - 1;
+    balance.amount[c] -= contribution.amount;
+    --balance.count[c];
+    auto bucket = balance.by_unlock_height[c].find({contribution.unlock_height, contribution.reported_unlock_height});
+    THROW_WALLET_EXCEPTION_IF(bucket == balance.by_unlock_height[c].end(), error::wallet_internal_error, "Balance index out of sync");
+    bucket->second.first -= contribution.amount;
+    if (--bucket->second.second == 0)
+      balance.by_unlock_height[c].erase(bucket);
+    if (balance.count[0] == 0 && balance.count[1] == 0)
+    {
+      account_it->second.erase(subaddr_it);
+      if (account_it->second.empty())
+        m_balance_index.erase(account_it);
+    }
+  }
+
+  if (updated.category != balance_contribution::none)
+  {
+    subaddress_balance &balance = m_balance_index[account][td.m_subaddr_index.minor];
+    const size_t c = updated.category - 1;
+    balance.amount[c] += updated.amount;
+    ++balance.count[c];
+    auto &bucket = balance.by_unlock_height[c][{updated.unlock_height, updated.reported_unlock_height}];
+    bucket.first += updated.amount;
+    ++bucket.second;
+  }
+  contribution = updated;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::add_locked_coins(const crypto::public_key &pk, const locked_yield_details &details)
+{
+  if (m_locked_coins.insert({pk, details}).second)
+    m_locked_coins_balance[details.m_asset_type] += details.m_amount;
+}
+//----------------------------------------------------------------------------------------------------
+bool wallet2::remove_locked_coins(const crypto::public_key &pk)
+{
+  const auto it = m_locked_coins.find(pk);
+  if (it == m_locked_coins.end())
+    return false;
+  m_locked_coins_balance[it->second.m_asset_type] -= it->second.m_amount;
+  m_locked_coins.erase(it);
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_locked_coins_balance()
+{
+  m_locked_coins_balance.clear();
+  for (const auto &i: m_locked_coins)
+    m_locked_coins_balance[i.second.m_asset_type] += i.second.m_amount;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_protocol_payout_keys()
+{
+  m_protocol_payout_keys.clear();
+  m_protocol_payout_keys_complete = true;
+  for (const auto &i: m_locked_coins)
+  {
+    const auto it = m_pub_keys.find(i.first);
+    const crypto::public_key payout_key = it != m_pub_keys.end() && it->second < m_transfers.size()
+      ? get_protocol_payout_key(m_transfers[it->second].m_tx) : crypto::null_pkey;
+    if (payout_key == crypto::null_pkey)
+      m_protocol_payout_keys_complete = false;
+    else
+      m_protocol_payout_keys.insert(payout_key);
+  }
+  if (!m_protocol_payout_keys_complete)
+    MWARNING("Return address of a pending stake payout not found, protocol transactions will be scanned in full");
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::add_payment(const crypto::hash &payment_id, const payment_details &pd)
+{
+  const auto it = m_payments.emplace(payment_id, pd);
+  m_payments_index[pd.m_subaddr_index.major].insert({pd.m_block_height, &*it});
+}
+//----------------------------------------------------------------------------------------------------
+wallet2::payment_container::iterator wallet2::erase_payment(payment_container::iterator it)
+{
+  const auto account = m_payments_index.find(it->second.m_subaddr_index.major);
+  if (account != m_payments_index.end())
+  {
+    account->second.erase({it->second.m_block_height, &*it});
+    if (account->second.empty())
+      m_payments_index.erase(account);
+  }
+  return m_payments.erase(it);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::index_confirmed_tx(const std::pair<const crypto::hash, confirmed_transfer_details> &entry)
+{
+  m_confirmed_txs_index[entry.second.m_subaddr_account].insert({entry.second.m_block_height, &entry});
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::unindex_confirmed_tx(const std::pair<const crypto::hash, confirmed_transfer_details> &entry)
+{
+  const auto account = m_confirmed_txs_index.find(entry.second.m_subaddr_account);
+  if (account == m_confirmed_txs_index.end())
+    return;
+  account->second.erase({entry.second.m_block_height, &entry});
+  if (account->second.empty())
+    m_confirmed_txs_index.erase(account);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_history_index()
+{
+  m_payments_index.clear();
+  for (const auto &p: m_payments)
+    m_payments_index[p.second.m_subaddr_index.major].insert({p.second.m_block_height, &p});
+  // an unloaded history section gets indexed by ensure_history_loaded()
+  m_confirmed_txs_index.clear();
+  for (const auto &p: m_confirmed_txs)
+    index_confirmed_tx(p);
+}
+//----------------------------------------------------------------------------------------------------
+std::string wallet2::serialize_history_section()
+{
+  history_section section{m_confirmed_txs, m_tx_notes, m_address_book};
+  std::string blob;
+  THROW_WALLET_EXCEPTION_IF(!::serialization::dump_binary(section, blob), error::wallet_internal_error, "Failed to serialize wallet history");
+  return blob;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::ensure_history_loaded() const
+{
+  if (m_history_section_loaded)
+    return;
+
+  // wallet2 is not used from several threads at once, so a const accessor may complete the load
+  wallet2 &self = const_cast<wallet2&>(*this);
+  history_section section{self.m_confirmed_txs, self.m_tx_notes, self.m_address_book};
+  bool loaded = false;
+  try
+  {
+    binary_archive<false> ar{epee::strspan<std::uint8_t>(m_history_section)};
+    loaded = ::serialization::serialize(ar, section) && ::serialization::check_stream_state(ar);
+  }
+  catch (...) {}
+  // the section stays unloaded, so a store writes it back untouched
+  THROW_WALLET_EXCEPTION_IF(!loaded, error::wallet_internal_error, "Failed to load wallet history from " + m_wallet_file);
+
+  MDEBUG("Loaded wallet history: " << m_confirmed_txs.size() << " outgoing txs, " << m_tx_notes.size()
+      << " tx notes, " << m_address_book.size() << " address book entries");
+  std::string().swap(m_history_section);
+  m_history_section_loaded = true;
+  for (const auto &p: self.m_confirmed_txs)
+    self.index_confirmed_tx(p);
+}
+//----------------------------------------------------------------------------------------------------
+std::vector<size_t> wallet2::get_unspent_transfer_indices(const std::string &asset_type, uint32_t subaddr_account) const
+{
+  std::vector<size_t> indices;
+  const auto it = m_unspent_transfer_index.find({asset_type, subaddr_account});
+  if (it == m_unspent_transfer_index.end())
+    return indices;
+  indices.reserve(it->second.size());
+  for (const auto &entry: it->second)
+    indices.push_back(entry.second);
+  return indices;
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::is_spent(const transfer_details &td, bool strict) const
@@ -2080,6 +2525,7 @@ void wallet2::freeze(size_t idx)
   CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid transfer_details index");
   transfer_details &td = m_transfers[idx];
   td.m_frozen = true;
+  update_balance_index(idx);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::thaw(size_t idx)
@@ -2087,6 +2533,7 @@ void wallet2::thaw(size_t idx)
   CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid transfer_details index");
   transfer_details &td = m_transfers[idx];
   td.m_frozen = false;
+  update_balance_index(idx);
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::frozen(size_t idx) const
@@ -2432,15 +2879,10 @@ bool wallet2::verify_spend_authority_proof(const cryptonote::transaction &tx, co
 }
 */
 //----------------------------------------------------------------------------------------------------
-void wallet2::scan_key_image(const wallet::enote_view_incoming_scan_info_t &enote_scan_info,
-  const bool pool,
-  std::optional<crypto::key_image> &ki_out,
-  bool &password_failure_inout)
+bool wallet2::unlock_spend_key_for_key_image_scan(const bool pool, bool &password_failure_inout)
 {
-  ki_out = std::nullopt;
-
   if (m_multisig || m_background_syncing || m_watch_only) // no complete spend privkey
-    return;
+    return false;
 
   // if keys are encrypted, ask for password
   if (is_key_encryption_enabled())
@@ -2461,9 +2903,43 @@ void wallet2::scan_key_image(const wallet::enote_view_incoming_scan_info_t &enot
     }
   }
 
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::scan_key_image(const wallet::enote_view_incoming_scan_info_t &enote_scan_info,
+  const bool pool,
+  std::optional<crypto::key_image> &ki_out,
+  bool &password_failure_inout)
+{
+  ki_out = std::nullopt;
+
+  if (!unlock_spend_key_for_key_image_scan(pool, password_failure_inout))
+    return;
+
   ki_out = wallet::try_derive_enote_key_image(enote_scan_info, m_account);
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::scan_key_images(const epee::span<const std::optional<wallet::enote_view_incoming_scan_info_t>> enote_scan_infos,
+  const bool pool,
+  epee::span<std::optional<crypto::key_image>> kis_out,
+  bool &password_failure_inout)
+{
+  THROW_WALLET_EXCEPTION_IF(enote_scan_infos.size() != kis_out.size(), error::wallet_internal_error,
+    "Mismatched sizes of enote scan infos and key images");
+  for (std::optional<crypto::key_image> &ki : kis_out)
+    ki = std::nullopt;
+
+  // don't prompt for a password unless there's something to derive
+  if (std::none_of(enote_scan_infos.begin(), enote_scan_infos.end(),
+      [](const std::optional<wallet::enote_view_incoming_scan_info_t> &info) { return bool(info); }))
+    return;
+
+  if (!unlock_spend_key_for_key_image_scan(pool, password_failure_inout))
+    return;
+
+  wallet::try_derive_enote_key_images(enote_scan_infos, m_account, kis_out);
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::process_new_transaction(
   const crypto::hash &txid,
   const cryptonote::transaction& tx,
@@ -2489,13 +2965,7 @@ void wallet2::process_new_transaction(
   // if view-incoming scan was successful, try deriving the key image
   bool password_failure = false;
   std::vector<std::optional<crypto::key_image>> output_key_images(n_outputs);
-  for (size_t i = 0; i < n_outputs; ++i)
-    if (enote_scan_infos.at(i))
-      scan_key_image(*enote_scan_infos.at(i), pool, output_key_images[i], password_failure);
-
-  // create output tracker cache from scratch
-  // this is kind of slow, but in the cases where this function is called (i.e. not normal block syncing), it's okay
-  std::map<std::pair<uint64_t, uint64_t>, size_t> output_tracker_cache = create_output_tracker_cache();
+  scan_key_images(epee::to_span(enote_scan_infos), pool, epee::to_mut_span(output_key_images), password_failure);
 
   // process scanned tx
   process_new_scanned_transaction(txid,
@@ -2510,7 +2980,6 @@ void wallet2::process_new_transaction(
     miner_tx,
     pool,
     double_spend_seen,
-    output_tracker_cache,
     ignore_callbacks);
 }
 //----------------------------------------------------------------------------------------------------
@@ -2527,7 +2996,6 @@ void wallet2::process_new_scanned_transaction(
   const bool miner_tx,
   const bool pool,
   const bool double_spend_seen,
-  std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache,
   const bool ignore_callbacks)
 {
   PERF_TIMER(process_new_scanned_transaction);
@@ -2722,12 +3190,11 @@ void wallet2::process_new_scanned_transaction(
 
     set_unspent(m_transfers.size() - 1);
 
-    // update m_key_images, m_pub_keys, and output_tracker_cache
+    // update m_key_images, m_pub_keys, and m_output_tracker_index
     if (td.m_key_image_known)
       m_key_images[td.m_key_image] = m_transfers.size() - 1;
     m_pub_keys[onetime_address] = m_transfers.size() - 1;
-    output_tracker_cache[std::make_pair(tx.vout.at(td.m_internal_output_index).amount, td.m_global_output_index)] =
-      m_transfers.size() - 1;
+    m_output_tracker_index[td.asset_type][td.m_asset_type_output_index] = m_transfers.size() - 1;
 
     // update m_transfer_indices
     m_transfers_indices[enote_scan_info->asset_type].insert(m_transfers.size()-1);
@@ -2751,16 +3218,22 @@ void wallet2::process_new_scanned_transaction(
                                 "Failed to get output public key for locked coins");
 
       // At this point, we need to clear the "locked coins" count, because otherwise we will be counting yield stakes twice in our balance
-      if (!m_locked_coins.erase(pk_locked_coins)) {
+      if (!remove_locked_coins(pk_locked_coins)) {
         LOG_ERROR("Failed to remove protocol_tx entry from m_locked_coins - possible duplicate output key detected");
       }
+      m_protocol_payout_keys.erase(onetime_address);
     }
 
     // Check for STAKE / AUDIT TXs
     if (tx.type == cryptonote::transaction_type::AUDIT || tx.type == cryptonote::transaction_type::STAKE) {
 
       // Add a "locked coins" entry so users don't freak out when they STAKE/AUDITOA
-      m_locked_coins.insert({onetime_address, {0, tx.amount_burnt, tx.source_asset_type}});
+      add_locked_coins(onetime_address, {0, tx.amount_burnt, tx.source_asset_type});
+      const crypto::public_key payout_key = get_protocol_payout_key(tx);
+      if (payout_key == crypto::null_pkey)
+        m_protocol_payout_keys_complete = false;
+      else
+        m_protocol_payout_keys.insert(payout_key);
     }
     
     // update multisig info
@@ -2807,7 +3280,10 @@ void wallet2::process_new_scanned_transaction(
           //   1) the same output pub key was used as destination multiple times,
           //   2) the wallet set the highest amount among them to transfer_details::m_amount, and
           //   3) the wallet somehow spent that output with an amount smaller than the above amount, causing inconsistency
+          m_unspent_transfer_index[{td.asset_type, td.m_subaddr_index.major}].erase({td.amount(), it->second});
           td.m_amount = amount;
+          invalidate_transfers_hash_chain(it->second);
+          update_unspent_transfer_index(it->second);
         }
       }
       else
@@ -2832,16 +3308,18 @@ void wallet2::process_new_scanned_transaction(
 
     if (!pool && (m_track_uses || (m_background_syncing && it == m_key_images.end())))
     {
-      const uint64_t amount = in_to_key.amount;
-      std::vector<uint64_t> offsets = cryptonote::relative_output_offsets_to_absolute(in_to_key.key_offsets);
+      // ring members are asset type output indices
+      const auto asset_outputs = m_output_tracker_index.find(in_to_key.asset_type);
+      if (asset_outputs != m_output_tracker_index.end())
       {
+        std::vector<uint64_t> offsets = cryptonote::relative_output_offsets_to_absolute(in_to_key.key_offsets);
         for (uint64_t offset: offsets)
         {
-          const std::map<std::pair<uint64_t, uint64_t>, size_t>::const_iterator i = output_tracker_cache.find(std::make_pair(amount, offset));
-          if (i != output_tracker_cache.end())
+          const auto i = asset_outputs->second.find(offset);
+          if (i != asset_outputs->second.end())
           {
             size_t idx = i->second;
-            THROW_WALLET_EXCEPTION_IF(idx >= m_transfers.size(), error::wallet_internal_error, "Output tracker cache index out of range");
+            THROW_WALLET_EXCEPTION_IF(idx >= m_transfers.size(), error::wallet_internal_error, "Output tracker index out of range");
 
             if (m_track_uses)
               m_transfers[idx].m_uses.push_back(std::make_pair(height, txid));
@@ -2893,6 +3371,7 @@ void wallet2::process_new_scanned_transaction(
     // if sending to yourself at the same subaddress account, set the outgoing payment amount to 0 so that it's less confusing
     if (tx_money_spent_in_ins == self_received[source_asset] + fee)
     {
+      ensure_history_loaded();
       auto i = m_confirmed_txs.find(txid);
       THROW_WALLET_EXCEPTION_IF(i == m_confirmed_txs.end(), error::wallet_internal_error,
         "confirmed tx wasn't found: " + string_tools::pod_to_hex(txid));
@@ -2964,7 +3443,7 @@ void wallet2::process_new_scanned_transaction(
             m_callback->on_unconfirmed_money_received(height, txid, tx, payment.m_amount, payment.m_subaddr_index);
         }
         else
-          m_payments.emplace(payment_id, payment);
+          add_payment(payment_id, payment);
         LOG_PRINT_L2("Payment found in " << (pool ? "pool" : "block") << ": " << payment_id << " / " << payment.m_tx_hash << " / " << payment.m_amount);
       }
     }
@@ -2991,7 +3470,10 @@ void wallet2::process_unconfirmed(const crypto::hash &txid, const cryptonote::tr
   if(unconf_it != m_unconfirmed_txs.end()) {
     if (store_tx_info()) {
       try {
-        m_confirmed_txs.insert(std::make_pair(txid, confirmed_transfer_details(unconf_it->second, height)));
+        ensure_history_loaded();
+        const auto entry = m_confirmed_txs.insert(std::make_pair(txid, confirmed_transfer_details(unconf_it->second, height)));
+        if (entry.second)
+          index_confirmed_tx(*entry.first);
       }
       catch (...) {
         // can fail if the tx has unexpected input types
@@ -3004,7 +3486,11 @@ void wallet2::process_unconfirmed(const crypto::hash &txid, const cryptonote::tr
 //----------------------------------------------------------------------------------------------------
 void wallet2::process_outgoing(const crypto::hash &txid, const cryptonote::transaction &tx, uint64_t height, uint64_t ts, uint64_t spent, const std::string& source_asset, uint64_t received, uint32_t subaddr_account, const std::set<uint32_t>& subaddr_indices)
 {
+  ensure_history_loaded();
   std::pair<std::unordered_map<crypto::hash, confirmed_transfer_details>::iterator, bool> entry = m_confirmed_txs.insert(std::make_pair(txid, confirmed_transfer_details()));
+  // the height (and, for a new entry, the account) is about to change
+  if (!entry.second)
+    unindex_confirmed_tx(*entry.first);
   // fill with the info we know, some info might already be there
   if (entry.second)
   {
@@ -3044,6 +3530,7 @@ void wallet2::process_outgoing(const crypto::hash &txid, const cryptonote::trans
 
   // SRCG: added by me - used to be in the code, but previously removed in 0.18.3.3
   entry.first->second.m_tx = (cryptonote::transaction_prefix)tx;
+  index_confirmed_tx(*entry.first);
   
   add_rings(tx);
 }
@@ -3061,8 +3548,7 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b,
   const crypto::hash& bl_id,
   const uint64_t height,
   epee::span<const std::optional<wallet::enote_view_incoming_scan_info_t>> enote_scan_infos,
-  epee::span<const std::optional<crypto::key_image>> output_key_images,
-  std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache)
+  epee::span<const std::optional<crypto::key_image>> output_key_images)
 {
   THROW_WALLET_EXCEPTION_IF(bche.txs.size() + 2 != parsed_block.o_indices.indices.size(), error::wallet_internal_error,
       "block transactions=" + std::to_string(bche.txs.size()) +
@@ -3102,8 +3588,7 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b,
                                       b.timestamp,
                                       /*miner_tx=*/true,
                                       /*pool=*/false,
-                                      /*double_spend_seen=*/false,
-                                      output_tracker_cache);
+                                      /*double_spend_seen=*/false);
     }
     enote_scan_infos.remove_prefix(n_outs_in_tx);
     output_key_images.remove_prefix(n_outs_in_tx);
@@ -3126,8 +3611,7 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b,
                                         b.timestamp,
                                         /*miner_tx=*/true,
                                         /*pool=*/false,
-                                        /*double_spend_seen=*/false,
-                                        output_tracker_cache);
+                                        /*double_spend_seen=*/false);
       }
       enote_scan_infos.remove_prefix(n_outs_in_tx);
       output_key_images.remove_prefix(n_outs_in_tx);
@@ -3152,8 +3636,7 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b,
                                       b.timestamp,
                                       /*miner_tx=*/false,
                                       /*pool=*/false,
-                                      /*double_spend_seen=*/false,
-                                      output_tracker_cache);
+                                      /*double_spend_seen=*/false);
       enote_scan_infos.remove_prefix(n_outs_in_tx);
       output_key_images.remove_prefix(n_outs_in_tx);
     }
@@ -3262,8 +3745,17 @@ void wallet2::process_pool_info_extent(const cryptonote::COMMAND_RPC_GET_BLOCKS_
   std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> added_pool_txs;
   added_pool_txs.reserve(res.added_pool_txs.size() + res.remaining_added_pool_txids.size());
 
+  // pool txs we already scanned and found not to be for us are neither parsed nor downloaded again,
+  // they only count as still being in the pool
+  std::vector<crypto::hash> skipped_pool_txids;
+
   for (const auto &pool_tx: res.added_pool_txs)
   {
+    if (is_scanned_pool_tx_not_for_us(pool_tx.tx_hash))
+    {
+      skipped_pool_txids.push_back(pool_tx.tx_hash);
+      continue;
+    }
     cryptonote::transaction tx;
     THROW_WALLET_EXCEPTION_IF(!cryptonote::parse_and_validate_tx_base_from_blob(pool_tx.tx_blob, tx),
         error::wallet_internal_error, "Failed to validate transaction base from daemon");
@@ -3271,20 +3763,34 @@ void wallet2::process_pool_info_extent(const cryptonote::COMMAND_RPC_GET_BLOCKS_
   }
 
   // getblocks.bin may return more added pool transactions than we're allowed to request in restricted mode
-  if (!res.remaining_added_pool_txids.empty())
+  std::vector<crypto::hash> remaining_added_pool_txids;
+  remaining_added_pool_txids.reserve(res.remaining_added_pool_txids.size());
+  for (const crypto::hash &txid: res.remaining_added_pool_txids)
+  {
+    if (is_scanned_pool_tx_not_for_us(txid))
+      skipped_pool_txids.push_back(txid);
+    else
+      remaining_added_pool_txids.push_back(txid);
+  }
+  if (!remaining_added_pool_txids.empty())
   {
     // request the remaining txs
-    m_node_rpc_proxy.get_transactions(res.remaining_added_pool_txids,
-      [this, &res, &added_pool_txs](const cryptonote::COMMAND_RPC_GET_TRANSACTIONS::request &req_t, const cryptonote::COMMAND_RPC_GET_TRANSACTIONS::response &resp_t, bool r)
+    m_node_rpc_proxy.get_transactions(remaining_added_pool_txids,
+      [this, &remaining_added_pool_txids, &added_pool_txs](const cryptonote::COMMAND_RPC_GET_TRANSACTIONS::request &req_t, const cryptonote::COMMAND_RPC_GET_TRANSACTIONS::response &resp_t, bool r)
       {
-        read_pool_txs(req_t, resp_t, r, res.remaining_added_pool_txids, added_pool_txs);
+        read_pool_txs(req_t, resp_t, r, remaining_added_pool_txids, added_pool_txs);
         if (!r || resp_t.status != CORE_RPC_STATUS_OK)
           LOG_PRINT_L0("Error calling gettransactions daemon RPC: r " << r << ", status " << get_rpc_status(resp_t.status));
       }
     );
   }
+  if (!skipped_pool_txids.empty())
+    LOG_PRINT_L2("Skipped " << skipped_pool_txids.size() << " already scanned pool txs not for us");
+  // keep txs that are still in the pool from aging out of the cache
+  for (const crypto::hash &txid: skipped_pool_txids)
+    add_scanned_pool_tx(txid);
 
-  update_pool_state_from_pool_data(res.pool_info_extent == COMMAND_RPC_GET_BLOCKS_FAST::INCREMENTAL, res.removed_pool_txids, added_pool_txs, process_txs, refreshed);
+  update_pool_state_from_pool_data(res.pool_info_extent == COMMAND_RPC_GET_BLOCKS_FAST::INCREMENTAL, res.removed_pool_txids, added_pool_txs, skipped_pool_txids, process_txs, refreshed);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::pull_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> &asset_type_output_indices, uint64_t &current_height, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>>& process_pool_txs)
@@ -3296,6 +3802,7 @@ void wallet2::pull_blocks(bool first, bool try_incremental, uint64_t start_heigh
   req.prune = true;
   req.start_height = start_height;
   req.no_miner_tx = m_refresh_type == RefreshNoCoinbase;
+  req.max_block_count = m_refresh_block_count;
 
   MDEBUG("Pulling blocks: start_height " << start_height);
 
@@ -3304,8 +3811,10 @@ void wallet2::pull_blocks(bool first, bool try_incremental, uint64_t start_heigh
     req.pool_info_since = m_pool_info_query_time;
 
   {
-    const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
-    bool r = net_utils::invoke_http_bin("/getblocks.bin", req, res, *m_http_client, rpc_timeout);
+    // getblocks.bin is not paid for, so it can use a pooled connection without upsetting credit accounting,
+    // and a prefetch does not hold up calls made meanwhile, e.g. get_outs.bin while building a tx
+    daemon_connection_lease connection(*this);
+    bool r = net_utils::invoke_http_bin("/getblocks.bin", req, res, connection.http_client(), rpc_timeout);
     THROW_ON_RPC_RESPONSE_ERROR(r, {}, res, "getblocks.bin", error::get_blocks_error, get_rpc_status(res.status));
     THROW_WALLET_EXCEPTION_IF(res.blocks.size() != res.output_indices.size(), error::wallet_internal_error,
         "mismatched blocks (" + boost::lexical_cast<std::string>(res.blocks.size()) + ") and output_indices (" +
@@ -3362,7 +3871,38 @@ void wallet2::pull_hashes(uint64_t start_height, uint64_t &blocks_start_height,
   hashes = std::move(res.m_block_ids);
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache)
+uint64_t wallet2::get_block_scan_record_matches(uint64_t start_height, uint64_t count, std::vector<crypto::hash> &txids, uint64_t &current_height)
+{
+  cryptonote::COMMAND_RPC_GET_BLOCK_SCAN_RECORDS::request req = AUTO_VAL_INIT(req);
+  cryptonote::COMMAND_RPC_GET_BLOCK_SCAN_RECORDS::response res = AUTO_VAL_INIT(res);
+  req.start_height = start_height;
+  req.count = count;
+
+  {
+    const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
+    req.client = get_client_signature();
+    uint64_t pre_call_credits = m_rpc_payment_state.credits;
+    bool r = net_utils::invoke_http_bin("/get_block_scan_records.bin", req, res, *m_http_client, rpc_timeout);
+    THROW_ON_RPC_RESPONSE_ERROR(r, {}, res, "get_block_scan_records.bin", error::get_blocks_error, get_rpc_status(res.status));
+    check_rpc_cost("/get_block_scan_records.bin", res.credits, pre_call_credits, 1 + res.records.size() * COST_PER_BLOCK_SCAN_RECORD);
+  }
+
+  current_height = res.current_height;
+  txids.clear();
+  hw::device &hwdev = m_account.get_device();
+  for (const cryptonote::blobdata &blob : res.records)
+  {
+    cryptonote::block_scan_record record;
+    THROW_WALLET_EXCEPTION_IF(!cryptonote::t_serializable_object_from_blob(record, blob),
+        error::wallet_internal_error, "Failed to parse block scan record");
+    for (const cryptonote::tx_scan_record &tx_record : record.txs)
+      if (wallet::tx_scan_record_may_have_owned_enotes(tx_record, m_account, hwdev))
+        txids.push_back(tx_record.tx_hash);
+  }
+  return res.records.size();
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added)
 {
   blocks_added = 0;
 
@@ -3395,7 +3935,11 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
   std::vector<std::optional<wallet::enote_view_incoming_scan_info_t>> enote_scan_infos(num_tx_outputs);
   std::vector<std::optional<crypto::key_image>> output_key_images(num_tx_outputs);
   bool password_failure = false;
-  auto tx_scan_job = [this, &enote_scan_infos, &output_key_images, &password_failure]
+  // return addresses of our STAKE / AUDIT txs found in the current chunk, added to m_protocol_payout_keys once
+  // it's scanned. a payout matures at least STAKE_LOCK_PERIOD blocks after its tx, so always in a later chunk
+  boost::mutex new_payout_keys_mutex;
+  std::vector<crypto::public_key> new_payout_keys;
+  auto tx_scan_job = [this, &enote_scan_infos, &output_key_images, &password_failure, &new_payout_keys_mutex, &new_payout_keys]
     (const cryptonote::transaction &tx, size_t tx_output_idx)
   {
     if (tx.vout.empty())
@@ -3411,26 +3955,58 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
       return;
     }
 
-    wallet::view_incoming_scan_transaction(tx,
-      this->m_account,
-      {&enote_scan_infos[0] + tx_output_idx, tx.vout.size()});
-
-    // if view-incoming scan was successful, try deriving the key image
-    for (size_t i = tx_output_idx; i < output_span_end; ++i)
+    const epee::span<std::optional<wallet::enote_view_incoming_scan_info_t>> tx_enote_scan_infos{
+      &enote_scan_infos[0] + tx_output_idx, tx.vout.size()};
+    if (tx.type == cryptonote::transaction_type::PROTOCOL && m_protocol_payout_keys_complete)
     {
-      if (!enote_scan_infos.at(i))
-        continue;
+      // only outputs paying out one of our stakes or audits can be ours
+      if (!wallet::view_incoming_scan_protocol_transaction(tx, m_protocol_payout_keys, this->m_account, tx_enote_scan_infos))
+        return;
+    }
+    else
+    {
+      wallet::view_incoming_scan_transaction(tx, this->m_account, tx_enote_scan_infos);
+    }
 
-      scan_key_image(*enote_scan_infos.at(i), /*pool=*/false, output_key_images[i], password_failure);
+    if (tx.type == cryptonote::transaction_type::STAKE || tx.type == cryptonote::transaction_type::AUDIT)
+    {
+      const bool owned = std::any_of(tx_enote_scan_infos.begin(), tx_enote_scan_infos.end(),
+        [](const std::optional<wallet::enote_view_incoming_scan_info_t> &info) { return bool(info); });
+      const crypto::public_key payout_key = get_protocol_payout_key(tx);
+      if (owned && payout_key != crypto::null_pkey)
+      {
+        boost::unique_lock<boost::mutex> lock(new_payout_keys_mutex);
+        new_payout_keys.push_back(payout_key);
+      }
     }
+
+    // if view-incoming scan was successful, try deriving the key images
+    scan_key_images({enote_scan_infos.data() + tx_output_idx, tx.vout.size()},
+      /*pool=*/false,
+      {output_key_images.data() + tx_output_idx, tx.vout.size()},
+      password_failure);
   }; //tx_scan_job
 
+  // the scan jobs only read the account's subaddress and return output maps: anything they'd insert is queued
+  // and applied serially once every job of a chunk has finished. a return output can only show up at least
+  // CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE blocks after the change output it depends on, so chunks of that many
+  // blocks always see the entries they need
+  m_account.set_defer_inserts(true);
+  auto defer_inserts_guard = epee::misc_utils::create_scope_leave_handler([this]() {
+    m_account.set_defer_inserts(false);
+  });
+
+  static tools::metrics::histogram &scan_time = refresh_stage_time("scan");
+  static tools::metrics::histogram &process_time = refresh_stage_time("process");
+
   // create tx scanning jobs for all relevant tx outputs in all blocks
+  const auto scan_start = std::chrono::steady_clock::now();
   size_t i = 0;
   size_t tx_output_idx = 0;
   while (i < blocks.size()) {
+    TRACE_SPAN("wallet_refresh_scan");
     tools::threadpool::waiter scan_blocks_waiter(tpool);
-    for (size_t j = 0; j < 10; ++j)
+    for (size_t j = 0; j < CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE; ++j)
     {
       if (i+j >= blocks.size()) break;
       const parsed_block &par_blk = parsed_blocks.at(i+j);
@@ -3454,10 +4030,17 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
       THROW_WALLET_EXCEPTION_IF(password_failure, error::password_needed);
       THROW_WALLET_EXCEPTION(error::wallet_internal_error, "Unrecognized exception in enote scanning threadpool");
     }
-    i+=10;
+    m_account.apply_deferred_inserts();
+    m_protocol_payout_keys.insert(new_payout_keys.begin(), new_payout_keys.end());
+    new_payout_keys.clear();
+    i += CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE;
   }
+  defer_inserts_guard.reset();
+  scan_time.observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - scan_start));
 
   // Start processing blockchain entries with scanned outputs
+  tools::metrics::scoped_timer process_timer(process_time);
+  TRACE_SPAN("wallet_refresh_process");
   size_t current_index = start_height;
   tx_output_idx = 0;
   for (i = 0; i < blocks.size(); ++i)
@@ -3476,7 +4059,7 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
 
     if(!current_index || current_index >= m_blockchain.size())
     {
-      process_new_blockchain_entry(bl, blocks[i], parsed_blocks[i], bl_id, current_index, enote_scan_infos_span, output_key_images_span, output_tracker_cache);
+      process_new_blockchain_entry(bl, blocks[i], parsed_blocks[i], bl_id, current_index, enote_scan_infos_span, output_key_images_span);
       ++blocks_added;
     }
     else if(bl_id != m_blockchain[current_index])
@@ -3492,8 +4075,8 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
         tr("reorg exceeds maximum allowed depth, use 'set max-reorg-depth N' to allow it, reorg depth: ") +
         std::to_string(reorg_depth));
 
-      handle_reorg(current_index, output_tracker_cache);
-      process_new_blockchain_entry(bl, blocks[i], parsed_blocks[i], bl_id, current_index, enote_scan_infos_span, output_key_images_span, output_tracker_cache);
+      handle_reorg(current_index);
+      process_new_blockchain_entry(bl, blocks[i], parsed_blocks[i], bl_id, current_index, enote_scan_infos_span, output_key_images_span);
     }
     else
     {
@@ -3514,6 +4097,20 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
     }
   }
 
+  // forget the return output info of returns we spent deeper than we can reorg: nothing will scan or spend them
+  // again, and keeping them would only grow the set every incoming enote is tested against
+  std::vector<crypto::public_key> spent_return_outputs;
+  const uint64_t current_height = get_blockchain_current_height();
+  for (const auto& output_info: m_account.get_return_output_map_ref()) {
+    const auto ki_it = m_key_images.find(output_info.second.key_image);
+    if (ki_it == m_key_images.end() || ki_it->second >= m_transfers.size())
+      continue;
+    const transfer_details &td = m_transfers[ki_it->second];
+    if (td.m_spent && td.m_spent_height < current_height && current_height - td.m_spent_height > m_max_reorg_depth)
+      spent_return_outputs.push_back(output_info.first);
+  }
+  m_account.remove_return_output_info(spent_return_outputs);
+
   // save accumulated return output info to wallet
   m_return_output_info.clear();
   for (const auto& output_info: m_account.get_return_output_map_ref()) {
@@ -3521,6 +4118,41 @@ void wallet2::process_parsed_blocks(const uint64_t start_height, const std::vect
   }
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::update_refresh_block_count(const std::vector<cryptonote::block_complete_entry> &blocks, std::chrono::steady_clock::duration pull_time, std::chrono::steady_clock::duration process_time)
+{
+  // a short batch means we've reached the top of the chain (or the daemon's own limits), which says
+  // nothing about how long a full batch would take
+  if (blocks.empty() || blocks.size() < m_refresh_block_count)
+    return;
+
+  size_t batch_bytes = 0;
+  for (const cryptonote::block_complete_entry &bce : blocks)
+  {
+    batch_bytes += bce.block.size();
+    for (const cryptonote::tx_blob_entry &tx : bce.txs)
+      batch_bytes += tx.blob.size();
+  }
+  const uint64_t bytes_per_block = std::max<uint64_t>(1, batch_bytes / blocks.size());
+  const uint64_t max_block_count = std::max<uint64_t>(REFRESH_MIN_BLOCK_COUNT,
+    std::min<uint64_t>(COMMAND_RPC_GET_BLOCKS_FAST_MAX_BLOCK_COUNT, REFRESH_MAX_BATCH_BYTES / bytes_per_block));
+
+  // pulling the next batch runs while the current one is scanned: if the pull is the slower of the two, we're
+  // paying for round trips and larger batches amortize them, otherwise smaller batches keep memory use down
+  uint64_t block_count = m_refresh_block_count;
+  if (pull_time > process_time)
+    block_count *= 2;
+  else if (pull_time * 2 < process_time)
+    block_count = block_count * 3 / 4;
+  block_count = std::min(std::max<uint64_t>(block_count, REFRESH_MIN_BLOCK_COUNT), max_block_count);
+
+  if (block_count != m_refresh_block_count)
+    MDEBUG("Refresh batch size " << m_refresh_block_count << " -> " << block_count << " blocks (pull "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(pull_time).count() << " ms, scan "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(process_time).count() << " ms, "
+      << bytes_per_block << " bytes/block)");
+  m_refresh_block_count = block_count;
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::refresh(bool trusted_daemon)
 {
   uint64_t blocks_fetched = 0;
@@ -3553,6 +4185,67 @@ void check_block_hard_fork_version(cryptonote::network_type nettype, uint8_t hf_
   daemon_is_outdated = height < start_height || height >= end_height;
 }
 //----------------------------------------------------------------------------------------------------
+namespace
+{
+  struct shared_block_batch
+  {
+    uint64_t blocks_start_height;
+    uint64_t current_height;
+    std::vector<cryptonote::block_complete_entry> blocks;
+    std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  };
+  typedef std::shared_future<std::shared_ptr<const shared_block_batch>> shared_block_batch_future;
+
+  // batches pulled without pool info by any wallet of the process; an entry is registered before pulling, so
+  // wallets asking for the same batch meanwhile wait for that pull instead of making their own
+  constexpr time_t SHARED_BLOCK_BATCH_LIFETIME = 60; // seconds
+  boost::mutex shared_block_batches_mutex;
+  std::unique_ptr<tools::lru_cache<std::string, std::pair<time_t, shared_block_batch_future>>> shared_block_batches;
+
+  // the hash bytes as a string, crypto::hash has no ordering for the LRU cache's map
+  std::string get_shared_block_batch_key(const std::string &daemon_address, uint64_t start_height, const std::list<crypto::hash> &short_chain_history, bool no_miner_tx, uint64_t max_block_count)
+  {
+    std::string data = daemon_address;
+    data.push_back('\0');
+    data.append((const char*)&start_height, sizeof(start_height));
+    data.push_back(no_miner_tx ? 1 : 0);
+    data.append((const char*)&max_block_count, sizeof(max_block_count));
+    for (const crypto::hash &h: short_chain_history)
+      data.append(h.data, sizeof(h.data));
+    const crypto::hash key = crypto::cn_fast_hash(data.data(), data.size());
+    return std::string(key.data, sizeof(key.data));
+  }
+
+  // returns a batch pulled by another wallet, or sets promise if the caller is to pull it and publish it
+  std::shared_ptr<const shared_block_batch> find_shared_block_batch(const std::string &key, std::shared_ptr<std::promise<std::shared_ptr<const shared_block_batch>>> &promise)
+  {
+    boost::unique_lock<boost::mutex> lock(shared_block_batches_mutex);
+    if (!shared_block_batches)
+      return nullptr;
+    const time_t now = time(NULL);
+    const auto *entry = shared_block_batches->get(key);
+    if (entry && entry->first + SHARED_BLOCK_BATCH_LIFETIME >= now)
+    {
+      const shared_block_batch_future future = entry->second;
+      lock.unlock();
+      // null if the other pull failed, then we just pull it ourselves
+      return future.get();
+    }
+    promise = std::make_shared<std::promise<std::shared_ptr<const shared_block_batch>>>();
+    shared_block_batches->put(key, std::make_pair(now, promise->get_future().share()));
+    return nullptr;
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::set_shared_block_cache_size(size_t batches)
+{
+  boost::unique_lock<boost::mutex> lock(shared_block_batches_mutex);
+  if (batches == 0)
+    shared_block_batches.reset();
+  else
+    shared_block_batches.reset(new tools::lru_cache<std::string, std::pair<time_t, shared_block_batch_future>>(batches));
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::pull_and_parse_next_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>>& process_pool_txs, bool &last, bool &error, std::exception_ptr &exception)
 {
   error = false;
@@ -3572,24 +4265,76 @@ void wallet2::pull_and_parse_next_blocks(bool first, bool try_incremental, uint6
       short_chain_history.push_front(s->hash);
     }
 
-    // pull the new blocks
-    std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
-    std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> asset_type_output_indices;
-    
-    uint64_t current_height;
-    pull_blocks(first, try_incremental, start_height, blocks_start_height, short_chain_history, blocks, o_indices, asset_type_output_indices, current_height, process_pool_txs);
-    THROW_WALLET_EXCEPTION_IF(blocks.size() != o_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and o_indices");
-    THROW_WALLET_EXCEPTION_IF(blocks.size() != asset_type_output_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and asset_type_output_indices");
+    // batches without pool info are the same for every wallet following this daemon from the same point
+    std::shared_ptr<std::promise<std::shared_ptr<const shared_block_batch>>> batch_promise;
+    std::shared_ptr<const shared_block_batch> shared_batch;
+    if (!first || m_background_syncing)
+    {
+      const std::string key = get_shared_block_batch_key(m_daemon_address, start_height, short_chain_history, m_refresh_type == RefreshNoCoinbase, m_refresh_block_count);
+      shared_batch = find_shared_block_batch(key, batch_promise);
+    }
+    epee::misc_utils::auto_scope_leave_caller batch_promise_handler = epee::misc_utils::create_scope_leave_handler([&batch_promise](){
+      // let any wallet waiting for this batch know it has to pull it itself
+      if (batch_promise)
+        batch_promise->set_value(nullptr);
+    });
 
-    tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
-    tools::threadpool::waiter waiter(tpool);
-    parsed_blocks.resize(blocks.size());
-    for (size_t i = 0; i < blocks.size(); ++i)
+    uint64_t current_height;
+    if (shared_batch)
     {
-      tpool.submit(&waiter, boost::bind(&wallet2::parse_block_round, this, std::cref(blocks[i].block),
-        std::ref(parsed_blocks[i].block), std::ref(parsed_blocks[i].hash), std::ref(parsed_blocks[i].error)), true);
+      blocks_start_height = shared_batch->blocks_start_height;
+      current_height = shared_batch->current_height;
+      blocks = shared_batch->blocks;
+      parsed_blocks = shared_batch->parsed_blocks;
     }
-    THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+    else
+    {
+      // pull the new blocks
+      std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
+      std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> asset_type_output_indices;
+    
+      pull_blocks(first, try_incremental, start_height, blocks_start_height, short_chain_history, blocks, o_indices, asset_type_output_indices, current_height, process_pool_txs);
+      THROW_WALLET_EXCEPTION_IF(blocks.size() != o_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and o_indices");
+      THROW_WALLET_EXCEPTION_IF(blocks.size() != asset_type_output_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and asset_type_output_indices");
+
+      tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+      tools::threadpool::waiter waiter(tpool);
+      parsed_blocks.resize(blocks.size());
+      for (size_t i = 0; i < blocks.size(); ++i)
+      {
+        tpool.submit(&waiter, boost::bind(&wallet2::parse_block_round, this, std::cref(blocks[i].block),
+          std::ref(parsed_blocks[i].block), std::ref(parsed_blocks[i].hash), std::ref(parsed_blocks[i].error)), true);
+      }
+      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      for (size_t i = 0; i < blocks.size(); ++i)
+      {
+        parsed_blocks[i].o_indices = std::move(o_indices[i]);
+        parsed_blocks[i].asset_type_output_indices = std::move(asset_type_output_indices[i]);
+      }
+
+      boost::mutex error_lock;
+      for (size_t i = 0; i < blocks.size(); ++i)
+      {
+        parsed_blocks[i].txes.resize(blocks[i].txs.size());
+        for (size_t j = 0; j < blocks[i].txs.size(); ++j)
+        {
+          tpool.submit(&waiter, [&, i, j](){
+            if (!parse_and_validate_tx_base_from_blob(blocks[i].txs[j].blob, parsed_blocks[i].txes[j]))
+            {
+              boost::unique_lock<boost::mutex> lock(error_lock);
+              error = true;
+            }
+          }, true);
+        }
+      }
+      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      if (batch_promise && !error && std::none_of(parsed_blocks.begin(), parsed_blocks.end(), [](const parsed_block &pb) { return pb.error; }))
+      {
+        batch_promise->set_value(std::make_shared<const shared_block_batch>(shared_block_batch{blocks_start_height, current_height, blocks, parsed_blocks}));
+        batch_promise.reset();
+      }
+    }
+
     for (size_t i = 0; i < blocks.size(); ++i)
     {
       if (parsed_blocks[i].error)
@@ -3613,27 +4358,7 @@ void wallet2::pull_and_parse_next_blocks(bool first, bool try_incremental, uint6
             : "Make sure the node you are connected to is running the latest version")
         );
       }
-
-      parsed_blocks[i].o_indices = std::move(o_indices[i]);
-      parsed_blocks[i].asset_type_output_indices = std::move(asset_type_output_indices[i]);
-    }
-
-    boost::mutex error_lock;
-    for (size_t i = 0; i < blocks.size(); ++i)
-    {
-      parsed_blocks[i].txes.resize(blocks[i].txs.size());
-      for (size_t j = 0; j < blocks[i].txs.size(); ++j)
-      {
-        tpool.submit(&waiter, [&, i, j](){
-          if (!parse_and_validate_tx_base_from_blob(blocks[i].txs[j].blob, parsed_blocks[i].txes[j]))
-          {
-            boost::unique_lock<boost::mutex> lock(error_lock);
-            error = true;
-          }
-        }, true);
-      }
     }
-    THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
     last = !blocks.empty() && cryptonote::get_block_height(parsed_blocks.back().block) + 1 == current_height;
   }
   catch(...)
@@ -3686,7 +4411,7 @@ bool wallet2::accept_pool_tx_for_processing(const crypto::hash &txid)
       break;
     }
   }
-  if (m_scanned_pool_txs[0].find(txid) != m_scanned_pool_txs[0].end() || m_scanned_pool_txs[1].find(txid) != m_scanned_pool_txs[1].end())
+  if (m_scanned_pool_txs[0].count(txid) || m_scanned_pool_txs[1].count(txid))
   {
     // if it's for us, we want to keep track of whether we saw a double spend, so don't bail out
     if (!txid_found_in_up)
@@ -3735,6 +4460,35 @@ bool wallet2::accept_pool_tx_for_processing(const crypto::hash &txid)
   }
 }
 //----------------------------------------------------------------------------------------------------
+// Whether a pool tx was scanned already and is not one we track for double spends, so it does not
+// have to be downloaded or scanned again while it stays in the pool
+bool wallet2::is_scanned_pool_tx_not_for_us(const crypto::hash &txid) const
+{
+  if (!m_scanned_pool_txs[0].count(txid) && !m_scanned_pool_txs[1].count(txid))
+    return false;
+  for (const auto &up: m_unconfirmed_payments)
+  {
+    if (up.second.m_pd.m_tx_hash == txid)
+      return false;
+  }
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+// Remember a scanned pool tx; the cache is bounded by keeping two generations and dropping the older
+// one whenever the newer one fills up. Txs that stay in the pool are refreshed into the newer one.
+void wallet2::add_scanned_pool_tx(const crypto::hash &txid)
+{
+  if (m_scanned_pool_txs[0].count(txid))
+    return;
+  m_scanned_pool_txs[1].erase(txid);
+  m_scanned_pool_txs[0].insert(txid);
+  if (m_scanned_pool_txs[0].size() > SCANNED_POOL_TXS_GENERATION_SIZE)
+  {
+    std::swap(m_scanned_pool_txs[0], m_scanned_pool_txs[1]);
+    m_scanned_pool_txs[0].clear();
+  }
+}
+//----------------------------------------------------------------------------------------------------
 // Code that is common to 'update_pool_state_by_pool_query' and 'update_pool_state_from_pool_data':
 // Process an unconfirmed transfer after we know whether it's in the pool or not
 void wallet2::process_unconfirmed_transfer(bool incremental, const crypto::hash &txid, wallet2::unconfirmed_transfer_details &tx_details, bool seen_in_pool, std::chrono::system_clock::time_point now, bool refreshed)
@@ -3928,7 +4682,7 @@ void wallet2::update_pool_state_by_pool_query(std::vector<std::tuple<cryptonote:
 // txs that are new in the pool since the last time we queried and the ids of txs that were
 // removed from the pool since then, or the whole content of the pool if incremental was not
 // possible, e.g. because the server was just started or restarted.
-void wallet2::update_pool_state_from_pool_data(bool incremental, const std::vector<crypto::hash> &removed_pool_txids, const std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &added_pool_txs, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed)
+void wallet2::update_pool_state_from_pool_data(bool incremental, const std::vector<crypto::hash> &removed_pool_txids, const std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &added_pool_txs, const std::vector<crypto::hash> &skipped_pool_txids, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed)
 {
   MTRACE("update_pool_state_from_pool_data start");
   auto keys_reencryptor = epee::misc_utils::create_scope_leave_handler([&, this]() {
@@ -3952,11 +4706,12 @@ void wallet2::update_pool_state_from_pool_data(bool incremental, const std::vect
       // unfortunate that we have to build a new vector with ids first, but better than copying and
       // modifying the code of 'remove_obsolete_pool_txs' here
       std::vector<crypto::hash> txids;
-      txids.reserve(added_pool_txs.size());
+      txids.reserve(added_pool_txs.size() + skipped_pool_txids.size());
       for (const auto &pool_tx: added_pool_txs)
       {
         txids.push_back(std::get<1>(pool_tx));
       }
+      txids.insert(txids.end(), skipped_pool_txids.begin(), skipped_pool_txids.end());
       remove_obsolete_pool_txs(txids, false);
     }
   }
@@ -3977,6 +4732,8 @@ void wallet2::update_pool_state_from_pool_data(bool incremental, const std::vect
         break;
       }
     }
+    if (!found)
+      found = std::find(skipped_pool_txids.begin(), skipped_pool_txids.end(), txid) != skipped_pool_txids.end();
     auto pit = it++;
     process_unconfirmed_transfer(incremental, txid, pit->second, found, now, refreshed);
     MDEBUG("Resulting state of that entry: " << pit->second.m_state);
@@ -4007,12 +4764,7 @@ void wallet2::process_pool_state(const std::vector<std::tuple<cryptonote::transa
     const crypto::hash &tx_hash = std::get<1>(e);
     const bool double_spend_seen = std::get<2>(e);
     process_new_transaction(tx_hash, tx, std::vector<uint64_t>(), std::vector<uint64_t>(), 0, 0, now, false, true, double_spend_seen);
-    m_scanned_pool_txs[0].insert(tx_hash);
-    if (m_scanned_pool_txs[0].size() > 5000)
-    {
-      std::swap(m_scanned_pool_txs[0], m_scanned_pool_txs[1]);
-      m_scanned_pool_txs[0].clear();
-    }
+    add_scanned_pool_tx(tx_hash);
   }
   MTRACE("process_pool_state end");
 }
@@ -4092,6 +4844,7 @@ bool wallet2::add_address_book_row(const cryptonote::account_public_address &add
   a.m_is_subaddress = is_subaddress;
   a.m_is_carrot = is_carrot;
   
+  ensure_history_loaded();
   auto old_size = m_address_book.size();
   m_address_book.push_back(a);
   if(m_address_book.size() == old_size+1)
@@ -4109,6 +4862,7 @@ bool wallet2::set_address_book_row(size_t row_id, const cryptonote::account_publ
   a.m_is_subaddress = is_subaddress;
   a.m_is_carrot = is_carrot;
 
+  ensure_history_loaded();
   const auto size = m_address_book.size();
   if (row_id >= size)
     return false;
@@ -4117,6 +4871,7 @@ bool wallet2::set_address_book_row(size_t row_id, const cryptonote::account_publ
 }
 
 bool wallet2::delete_address_book_row(std::size_t row_id) {
+  ensure_history_loaded();
   if(m_address_book.size() <= row_id)
     return false;
   
@@ -4126,15 +4881,14 @@ bool wallet2::delete_address_book_row(std::size_t row_id) {
 }
 
 //----------------------------------------------------------------------------------------------------
-std::map<std::pair<uint64_t, uint64_t>, size_t> wallet2::create_output_tracker_cache() const
+void wallet2::rebuild_output_tracker_index()
 {
-  std::map<std::pair<uint64_t, uint64_t>, size_t> cache;
+  m_output_tracker_index.clear();
   for (size_t i = 0; i < m_transfers.size(); ++i)
   {
     const transfer_details &td = m_transfers[i];
-    cache[std::make_pair(td.is_rct() ? 0 : td.amount(), td.m_global_output_index)] = i;
+    m_output_tracker_index[td.asset_type][td.m_asset_type_output_index] = i;
   }
-  return cache;
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blocks_fetched, bool& received_money, bool check_pool, bool try_incremental, uint64_t max_blocks)
@@ -4162,7 +4916,6 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
   // It was pretty subtle IIRC, and so I needed time to think about how to refix it after the move, and I never got to it."
   // https://github.com/monero-project/monero/pull/6097
   bool refreshed = false;
-  std::map<std::pair<uint64_t, uint64_t>, size_t> output_tracker_cache = create_output_tracker_cache();
   hw::device &hwdev = m_account.get_device();
 
   // pull the first set of blocks
@@ -4194,6 +4947,7 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
 
   auto scope_exit_handler_hwdev = epee::misc_utils::create_scope_leave_handler([&](){hwdev.computing_key_images(false);});
 
+  static tools::metrics::histogram &pull_stage_time = refresh_stage_time("pull");
   std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> process_pool_txs;
   // Getting and processing the pool state has moved down into method 'pull_blocks' to
   // allow for "conventional" as well as "incremental" update. However the following
@@ -4212,6 +4966,7 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
     std::vector<parsed_block> next_parsed_blocks;
     bool error;
     std::exception_ptr exception;
+    std::chrono::steady_clock::duration pull_time{}, process_time{};
     try
     {
       // pull the next set of blocks while we're processing the current one
@@ -4226,13 +4981,21 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
         break;
       }
       if (!last)
-        tpool.submit(&waiter, [&]{pull_and_parse_next_blocks(first, try_incremental, start_height, next_blocks_start_height, short_chain_history, blocks, parsed_blocks, next_blocks, next_parsed_blocks, process_pool_txs, last, error, exception);});
+        tpool.submit(&waiter, [&]{
+          TRACE_SPAN("wallet_refresh_pull");
+          const auto pull_start = std::chrono::steady_clock::now();
+          pull_and_parse_next_blocks(first, try_incremental, start_height, next_blocks_start_height, short_chain_history, blocks, parsed_blocks, next_blocks, next_parsed_blocks, process_pool_txs, last, error, exception);
+          pull_time = std::chrono::steady_clock::now() - pull_start;
+          pull_stage_time.observe(std::chrono::duration_cast<std::chrono::microseconds>(pull_time));
+        });
 
       if (!first)
       {
         try
         {
-          process_parsed_blocks(blocks_start_height, blocks, parsed_blocks, added_blocks, output_tracker_cache);
+          const auto process_start = std::chrono::steady_clock::now();
+          process_parsed_blocks(blocks_start_height, blocks, parsed_blocks, added_blocks);
+          process_time = std::chrono::steady_clock::now() - process_start;
         }
         catch (const tools::error::out_of_hashchain_bounds_error&)
         {
@@ -4279,6 +5042,9 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
 
       m_has_ever_refreshed_from_node = true;
 
+      if (!first && !last)
+        update_refresh_block_count(next_blocks, pull_time, process_time);
+
       if(!first && blocks_start_height == next_blocks_start_height)
       {
         m_node_rpc_proxy.set_height(m_blockchain.size());
@@ -4371,12 +5137,19 @@ bool wallet2::refresh(bool trusted_daemon, uint64_t & blocks_fetched, bool& rece
 //----------------------------------------------------------------------------------------------------
 bool wallet2::get_rct_distribution(const bool use_global_outs, const std::string &rct_asset_type, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &num_spendable_global_outs)
 {
-  MDEBUG("Requesting rct distribution");
+  // only the tail of a cached distribution is requested again, and spliced onto the cached part
+  const std::string cache_key = use_global_outs ? std::string() : rct_asset_type;
+  auto cached = m_rct_distribution_cache.find(cache_key);
+  uint64_t from_height = 0;
+  if (cached != m_rct_distribution_cache.end() && cached->second.distribution.size() > RCT_DISTRIBUTION_REFRESH_DEPTH)
+    from_height = cached->second.start_height + cached->second.distribution.size() - RCT_DISTRIBUTION_REFRESH_DEPTH;
+
+  MDEBUG("Requesting rct distribution from height " << from_height);
 
   cryptonote::COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::request req = AUTO_VAL_INIT(req);
   cryptonote::COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::response res = AUTO_VAL_INIT(res);
   req.amounts.push_back(0);
-  req.from_height = 0;
+  req.from_height = from_height;
   req.cumulative = false;
   req.binary = true;
   req.compress = true;
@@ -4395,6 +5168,12 @@ bool wallet2::get_rct_distribution(const bool use_global_outs, const std::string
   }
   catch(...)
   {
+    if (from_height > 0)
+    {
+      // the daemon may be behind our cached distribution now
+      m_rct_distribution_cache.erase(cached);
+      return get_rct_distribution(use_global_outs, rct_asset_type, start_height, distribution, num_spendable_global_outs);
+    }
     return false;
   }
   if (res.distributions.size() != 1)
@@ -4407,18 +5186,52 @@ bool wallet2::get_rct_distribution(const bool use_global_outs, const std::string
     MWARNING("Failed to request output distribution: results are not for amount 0");
     return false;
   }
-  num_spendable_global_outs = res.distributions[0].data.num_spendable_global_outs;
-  for (size_t i = 1; i < res.distributions[0].data.distribution.size(); ++i)
-    res.distributions[0].data.distribution[i] += res.distributions[0].data.distribution[i-1];
-  start_height = res.distributions[0].data.start_height;
-  distribution = std::move(res.distributions[0].data.distribution);
+  cryptonote::rpc::output_distribution_data &data = res.distributions[0].data;
+  if (from_height > 0)
+  {
+    rct_distribution_cache_entry &entry = cached->second;
+    const size_t kept = from_height - entry.start_height;
+    if (data.start_height != from_height || entry.distribution[kept - 1] != data.base)
+    {
+      // a reorg deeper than the refreshed tail, or a daemon with different data
+      MDEBUG("Cached rct distribution does not match the daemon's, requesting it in full");
+      m_rct_distribution_cache.erase(cached);
+      return get_rct_distribution(use_global_outs, rct_asset_type, start_height, distribution, num_spendable_global_outs);
+    }
+    entry.distribution.resize(kept);
+    entry.distribution.reserve(kept + data.distribution.size());
+    uint64_t cumulative = data.base;
+    for (const uint64_t count: data.distribution)
+      entry.distribution.push_back(cumulative += count);
+    entry.num_spendable_global_outs = data.num_spendable_global_outs;
+  }
+  else
+  {
+    for (size_t i = 1; i < data.distribution.size(); ++i)
+      data.distribution[i] += data.distribution[i-1];
+    rct_distribution_cache_entry &entry = m_rct_distribution_cache[cache_key];
+    entry.start_height = data.start_height;
+    entry.distribution = std::move(data.distribution);
+    entry.num_spendable_global_outs = data.num_spendable_global_outs;
+    cached = m_rct_distribution_cache.find(cache_key);
+  }
+  start_height = cached->second.start_height;
+  distribution = cached->second.distribution;
+  num_spendable_global_outs = cached->second.num_spendable_global_outs;
   return true;
 }
 //----------------------------------------------------------------------------------------------------
-wallet2::detached_blockchain_data wallet2::detach_blockchain(uint64_t height, std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache)
+void wallet2::clear_rct_distribution_cache()
+{
+  m_rct_distribution_cache.clear();
+  m_outkey_cache.clear();
+}
+//----------------------------------------------------------------------------------------------------
+wallet2::detached_blockchain_data wallet2::detach_blockchain(uint64_t height)
 {
   LOG_PRINT_L0("Detaching blockchain on height " << height);
   detached_blockchain_data dbd;
+  clear_rct_distribution_cache();
 
   size_t transfers_detached = 0;
 
@@ -4464,6 +5277,9 @@ wallet2::detached_blockchain_data wallet2::detach_blockchain(uint64_t height, st
     auto it_pk = m_pub_keys.find(m_transfers[i].get_public_key());
     THROW_WALLET_EXCEPTION_IF(it_pk == m_pub_keys.end(), error::wallet_internal_error, "public key not found");
     m_pub_keys.erase(it_pk);
+    // a detached payout may come back on the new chain
+    if (m_transfers[i].m_tx.type == cryptonote::transaction_type::PROTOCOL)
+      m_protocol_payout_keys.insert(m_transfers[i].get_public_key());
   }
 
   transfers_detached = std::distance(it, m_transfers.end());
@@ -4472,9 +5288,11 @@ wallet2::detached_blockchain_data wallet2::detach_blockchain(uint64_t height, st
     dbd.detached_tx_hashes.insert(std::move(m_transfers[i].m_txid));
   MDEBUG(transfers_detached << " transfers detached / expected " << dbd.detached_tx_hashes.size());
   m_transfers.erase(it, m_transfers.end());
+  invalidate_transfers_hash_chain(i_start);
 
-  // the output tracker cache depends upon m_transfers, which was just mangled above
-  output_tracker_cache = create_output_tracker_cache();
+  // the output tracker index depends upon m_transfers, which was just mangled above
+  rebuild_output_tracker_index();
+  rebuild_unspent_transfer_index();
 
   uint64_t blocks_detached = 0;
   dbd.original_chain_size = m_blockchain.size();
@@ -4487,34 +5305,45 @@ wallet2::detached_blockchain_data wallet2::detach_blockchain(uint64_t height, st
     MDEBUG(blocks_detached << " blocks detached / expected " << dbd.detached_blockchain.size());
   }
 
-  for (auto it = m_payments.begin(); it != m_payments.end(); )
+  // only the top of the height indices needs looking at
+  std::vector<const std::pair<const crypto::hash, payment_details>*> detached_payments;
+  for (const auto &account: m_payments_index)
+    for (auto it = account.second.lower_bound({height, nullptr}); it != account.second.end(); ++it)
+      detached_payments.push_back(it->second);
+  for (const auto *payment: detached_payments)
   {
-    if(height <= it->second.m_block_height)
+    auto range = m_payments.equal_range(payment->first);
+    for (auto it = range.first; it != range.second; ++it)
     {
-      dbd.detached_tx_hashes.insert(it->second.m_tx_hash);
-      it = m_payments.erase(it);
+      if (&*it == payment)
+      {
+        dbd.detached_tx_hashes.insert(it->second.m_tx_hash);
+        erase_payment(it);
+        break;
+      }
     }
-    else
-      ++it;
   }
 
-  for (auto it = m_confirmed_txs.begin(); it != m_confirmed_txs.end(); )
+  ensure_history_loaded();
+  std::vector<crypto::hash> detached_confirmed_txs;
+  for (const auto &account: m_confirmed_txs_index)
+    for (auto it = account.second.lower_bound({height, nullptr}); it != account.second.end(); ++it)
+      detached_confirmed_txs.push_back(it->second->first);
+  for (const crypto::hash &txid: detached_confirmed_txs)
   {
-    if(height <= it->second.m_block_height)
-    {
-      dbd.detached_tx_hashes.insert(it->first);
-      dbd.detached_confirmed_txs_dests[it->first] = std::move(it->second.m_dests);
-      it = m_confirmed_txs.erase(it);
-    }
-    else
-      ++it;
+    auto it = m_confirmed_txs.find(txid);
+    THROW_WALLET_EXCEPTION_IF(it == m_confirmed_txs.end(), error::wallet_internal_error, "Confirmed tx index out of sync");
+    dbd.detached_tx_hashes.insert(it->first);
+    dbd.detached_confirmed_txs_dests[it->first] = std::move(it->second.m_dests);
+    unindex_confirmed_tx(*it);
+    m_confirmed_txs.erase(it);
   }
 
   LOG_PRINT_L0("Detached blockchain on height " << height << ", transfers detached " << transfers_detached << ", blocks detached " << blocks_detached);
   return dbd;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::handle_reorg(uint64_t height, std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache)
+void wallet2::handle_reorg(uint64_t height)
 {
   // size  1 2 3 4 5 6 7 8 9
   // block 0 1 2 3 4 5 6 7 8
@@ -4522,7 +5351,7 @@ void wallet2::handle_reorg(uint64_t height, std::map<std::pair<uint64_t, uint64_
   THROW_WALLET_EXCEPTION_IF(height < m_blockchain.offset() && m_blockchain.size() > m_blockchain.offset(),
       error::wallet_internal_error, "Daemon claims reorg below last checkpoint");
 
-  detached_blockchain_data dbd = detach_blockchain(height, output_tracker_cache);
+  detached_blockchain_data dbd = detach_blockchain(height);
 
   if (m_background_syncing && height < m_background_sync_data.start_height)
     m_background_sync_data.start_height = height;
@@ -4544,18 +5373,31 @@ bool wallet2::deinit()
 //----------------------------------------------------------------------------------------------------
 bool wallet2::clear()
 {
+  ensure_history_loaded();
   m_blockchain.clear();
   m_transfers.clear();
+  m_transfers_hash_chain.clear();
   m_transfers_indices.clear();
+  m_output_tracker_index.clear();
+  m_unspent_transfer_index.clear();
+  m_balance_index.clear();
+  m_balance_contributions.clear();
+  m_balance_history.clear();
+  m_balance_history_valid = false;
   m_locked_coins.clear();
+  m_locked_coins_balance.clear();
+  m_protocol_payout_keys.clear();
+  m_protocol_payout_keys_complete = true;
   m_salvium_txs.clear();
   m_key_images.clear();
   m_pub_keys.clear();
   m_unconfirmed_txs.clear();
   m_payments.clear();
+  m_payments_index.clear();
   m_tx_keys.clear();
   m_additional_tx_keys.clear();
   m_confirmed_txs.clear();
+  m_confirmed_txs_index.clear();
   m_unconfirmed_payments.clear();
   m_scanned_pool_txs[0].clear();
   m_scanned_pool_txs[1].clear();
@@ -4569,22 +5411,40 @@ bool wallet2::clear()
   m_background_sync_data = background_sync_data_t{};
   m_subaddresses_extended.clear();
   m_return_output_info.clear();
+  m_subaddress_table_fingerprint = boost::none;
+  m_cache_checkpoint_iv = boost::none;
+  m_cache_checkpoint_size = 0;
+  m_cache_checkpoint_index.clear();
+  clear_rct_distribution_cache();
   return true;
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::clear_soft(bool keep_key_images)
 {
+  ensure_history_loaded();
   m_blockchain.clear();
   m_transfers.clear();
+  m_transfers_hash_chain.clear();
   m_transfers_indices.clear();
+  m_output_tracker_index.clear();
+  m_unspent_transfer_index.clear();
+  m_balance_index.clear();
+  m_balance_contributions.clear();
+  m_balance_history.clear();
+  m_balance_history_valid = false;
   m_locked_coins.clear();
+  m_locked_coins_balance.clear();
+  m_protocol_payout_keys.clear();
+  m_protocol_payout_keys_complete = true;
   m_salvium_txs.clear();
   if (!keep_key_images)
     m_key_images.clear();
   m_pub_keys.clear();
   m_unconfirmed_txs.clear();
   m_payments.clear();
+  m_payments_index.clear();
   m_confirmed_txs.clear();
+  m_confirmed_txs_index.clear();
   m_unconfirmed_payments.clear();
   m_scanned_pool_txs[0].clear();
   m_scanned_pool_txs[1].clear();
@@ -4593,6 +5453,7 @@ void wallet2::clear_soft(bool keep_key_images)
   m_background_sync_data = background_sync_data_t{};
   m_subaddresses_extended.clear();
   m_return_output_info.clear();
+  clear_rct_distribution_cache();
 
   cryptonote::block b;
   generate_genesis(b);
@@ -4602,12 +5463,14 @@ void wallet2::clear_soft(bool keep_key_images)
 //----------------------------------------------------------------------------------------------------
 void wallet2::clear_user_data()
 {
+  ensure_history_loaded();
   for (auto i = m_confirmed_txs.begin(); i != m_confirmed_txs.end(); ++i)
     i->second.m_dests.clear();
   for (auto i = m_unconfirmed_txs.begin(); i != m_unconfirmed_txs.end(); ++i)
     i->second.m_dests.clear();
   for (auto i = m_transfers.begin(); i != m_transfers.end(); ++i)
     i->m_frozen = false;
+  rebuild_unspent_transfer_index();
   m_tx_keys.clear();
   m_tx_notes.clear();
   m_address_book.clear();
@@ -4888,6 +5751,9 @@ boost::optional<wallet2::keys_file_data> wallet2::get_keys_file_data(const crypt
   value2.SetInt(m_send_change_back_to_subaddress ? 1 : 0);
   json.AddMember("send_change_back_to_subaddress", value2, json.GetAllocator());
 
+  value2.SetInt(m_store_cache_delta ? 1 : 0);
+  json.AddMember("store_cache_delta", value2, json.GetAllocator());
+
   if (m_background_sync_type == BackgroundSyncCustomPassword && !background_keys_file && m_custom_background_key)
   {
     value.SetString(reinterpret_cast<const char*>(m_custom_background_key.get().data()), m_custom_background_key.get().size());
@@ -4921,6 +5787,8 @@ void wallet2::setup_keys(const epee::wipeable_string &password)
   }
 
   m_cache_key = derive_cache_key(key, config::HASH_KEY_WALLET_CACHE);
+  // a cache delta must be encrypted with the same key as its checkpoint
+  m_cache_checkpoint_iv = boost::none;
 
   get_ringdb_key();
 }
@@ -5127,6 +5995,7 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_enable_multisig = false;
     m_freeze_incoming_payments = false;
     m_send_change_back_to_subaddress = false;
+    m_store_cache_delta = false;
     m_allow_mismatched_daemon_version = false;
     m_custom_background_key = boost::none;
   }
@@ -5369,6 +6238,8 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_freeze_incoming_payments = field_freeze_incoming_payments;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, send_change_back_to_subaddress, int, Int, false, false);
     m_send_change_back_to_subaddress = field_send_change_back_to_subaddress;
+    GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, store_cache_delta, int, Int, false, false);
+    m_store_cache_delta = field_store_cache_delta;
 
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, background_sync_type, BackgroundSyncType, Int, false, BackgroundSyncOff);
     m_background_sync_type = field_background_sync_type;
@@ -6043,27 +6914,24 @@ std::string wallet2::make_multisig(const epee::wipeable_string &password,
     };
 
   // open initial kex messages, validate them, extract signers
-  std::vector<multisig::multisig_kex_msg> expanded_msgs;
+  const std::vector<multisig::multisig_kex_msg> expanded_msgs = multisig::parse_multisig_kex_msgs(initial_kex_msgs);
   std::vector<crypto::public_key> signers;
-  expanded_msgs.reserve(initial_kex_msgs.size());
   signers.reserve(initial_kex_msgs.size() + 1);
 
-  for (const auto &msg : initial_kex_msgs)
+  for (const multisig::multisig_kex_msg &expanded_msg : expanded_msgs)
   {
-    expanded_msgs.emplace_back(msg);
-
     // validate each message
     // 1. must be 'round 1'
-    CHECK_AND_ASSERT_THROW_MES(expanded_msgs.back().get_round() == 1,
+    CHECK_AND_ASSERT_THROW_MES(expanded_msg.get_round() == 1,
       "Trying to make multisig with message that has invalid multisig kex round (should be '1').");
 
     // 2. duplicate signers not allowed
-    CHECK_AND_ASSERT_THROW_MES(std::find(signers.begin(), signers.end(), expanded_msgs.back().get_signing_pubkey()) == signers.end(),
+    CHECK_AND_ASSERT_THROW_MES(std::find(signers.begin(), signers.end(), expanded_msg.get_signing_pubkey()) == signers.end(),
       "Duplicate signers not allowed when converting a wallet to multisig.");
 
     // add signer (skip self for now)
-    if (expanded_msgs.back().get_signing_pubkey() != multisig_account.get_base_pubkey())
-      signers.push_back(expanded_msgs.back().get_signing_pubkey());
+    if (expanded_msg.get_signing_pubkey() != multisig_account.get_base_pubkey())
+      signers.push_back(expanded_msg.get_signing_pubkey());
   }
 
   // add self to signers
@@ -6149,11 +7017,7 @@ std::string wallet2::exchange_multisig_keys(const epee::wipeable_string &passwor
   }
 
   // open kex messages
-  std::vector<multisig::multisig_kex_msg> expanded_msgs;
-  expanded_msgs.reserve(kex_messages.size());
-
-  for (const std::string &msg : kex_messages)
-    expanded_msgs.emplace_back(msg);
+  const std::vector<multisig::multisig_kex_msg> expanded_msgs = multisig::parse_multisig_kex_msgs(kex_messages);
 
   // update multisig kex
   multisig_account.kex_update(expanded_msgs, force_update_use_with_caution);
@@ -6266,11 +7130,7 @@ std::string wallet2::get_multisig_key_exchange_booster(const epee::wipeable_stri
   }
 
   // open kex messages
-  std::vector<multisig::multisig_kex_msg> expanded_msgs;
-  expanded_msgs.reserve(kex_messages.size());
-
-  for (const std::string &msg : kex_messages)
-    expanded_msgs.emplace_back(msg);
+  const std::vector<multisig::multisig_kex_msg> expanded_msgs = multisig::parse_multisig_kex_msgs(kex_messages);
 
   // get kex booster message
   // note: booster does not change wallet state other than decrypting/reencrypting account keys
@@ -6572,6 +7432,13 @@ void wallet2::set_offline(bool offline)
   m_offline = offline;
   m_node_rpc_proxy.set_offline(offline);
   m_http_client->set_auto_connect(!offline);
+  for (const auto &connection: m_daemon_connection_pool)
+  {
+    boost::lock_guard<boost::mutex> connection_lock(connection->mutex);
+    connection->http_client->set_auto_connect(!offline);
+    if (offline && connection->http_client->is_connected())
+      connection->http_client->disconnect();
+  }
   if (offline)
   {
     boost::lock_guard<boost::recursive_mutex> lock(m_daemon_rpc_mutex);
@@ -6629,6 +7496,11 @@ void wallet2::load(const std::string& wallet_, const epee::wipeable_string& pass
   //keys loaded ok!
   //try to load wallet cache. but even if we failed, it is not big problem
   load_wallet_cache(use_fs, cache_buf);
+  rebuild_output_tracker_index();
+  rebuild_unspent_transfer_index();
+  rebuild_locked_coins_balance();
+  rebuild_protocol_payout_keys();
+  rebuild_history_index();
 
   // Wallets used to wipe, but not erase, old unused multisig key info, which lead to huge memory leaks.
   // Here we erase these multisig keys if they're zero'd out to free up space.
@@ -6663,19 +7535,41 @@ void wallet2::load(const std::string& wallet_, const epee::wipeable_string& pass
   if (get_num_subaddress_accounts() == 0)
     add_subaddress_account(tr("Primary account"));
 
-  m_account.generate_subaddress_map(get_subaddress_lookahead());
-  
-  // populate account subaddress list
-  if (!m_subaddresses.empty())
+  // a subaddress table written by a previous store() saves re-deriving every Carrot subaddress
+  std::shared_ptr<const carrot::subaddress_lookup_table> subaddress_table;
+  if (use_subaddress_table())
+  {
+    crypto::secret_key table_key;
+    carrot::make_subaddress_lookup_table_key(m_account.get_keys().m_view_secret_key, table_key);
+    const carrot::subaddress_lookup_table::fingerprint_t fingerprint = get_subaddress_table_fingerprint();
+    subaddress_table = carrot::subaddress_lookup_table::open(get_subaddress_table_file(), table_key, fingerprint);
+    memwipe(&table_key, sizeof(table_key));
+    if (subaddress_table)
+      m_subaddress_table_fingerprint = fingerprint;
+  }
+
+  if (subaddress_table)
+  {
+    MDEBUG("Loaded " << subaddress_table->size() << " subaddresses from " << get_subaddress_table_file());
+    m_account.set_subaddress_table(std::move(subaddress_table));
+  }
+  else
   {
-    // if we have subaddresses, we need to insert them into the account
-    for (const auto &subaddress : m_subaddresses)
-      m_account.insert_subaddresses(
+    m_account.generate_subaddress_map(get_subaddress_lookahead());
+
+    // populate account subaddress list
+    if (!m_subaddresses.empty())
+    {
+      // if we have subaddresses, we need to insert them into the account, all at once so their Carrot
+      // counterparts are made in bulk
+      std::unordered_map<crypto::public_key, carrot::subaddress_index_extended> subaddresses;
+      for (const auto &subaddress : m_subaddresses)
         // we assume none of these subaddresses are return tx subaddresses
-        {{subaddress.first, {{subaddress.second.major, subaddress.second.minor}, carrot::AddressDeriveType::PreCarrot, false}}}
-      );
+        subaddresses.insert({subaddress.first, {{subaddress.second.major, subaddress.second.minor}, carrot::AddressDeriveType::PreCarrot, false}});
+      m_account.insert_subaddresses(subaddresses);
+    }
+    m_account.insert_subaddresses(m_subaddresses_extended);
   }
-  m_account.insert_subaddresses(m_subaddresses_extended);
 
   // populate account return output info
   m_account.insert_return_output_info(m_return_output_info);
@@ -6741,18 +7635,23 @@ void wallet2::load_wallet_cache(const bool use_fs, const std::string& cache_buf)
       cache_data.resize(cache_file_data.cache_data.size());
       crypto::chacha20(cache_file_data.cache_data.data(), cache_file_data.cache_data.size(), get_cache_key(), cache_file_data.iv, &cache_data[0]);
 
+      // apply the changes stored since this cache file was written, if any
+      std::string delta_cache_data;
+      const bool loaded_delta = use_fs && load_cache_delta_file(cache_file_data.iv, cache_data, delta_cache_data);
+      const std::string &current_cache_data = loaded_delta ? delta_cache_data : cache_data;
+
       try {
         bool loaded = false;
 
         try
         {
-          binary_archive<false> ar{epee::strspan<std::uint8_t>(cache_data)};
+          binary_archive<false> ar{epee::strspan<std::uint8_t>(current_cache_data)};
           if (::serialization::serialize(ar, *this))
             if (::serialization::check_stream_state(ar))
               loaded = true;
           if (!loaded)
           {
-            binary_archive<false> ar{epee::strspan<std::uint8_t>(cache_data)};
+            binary_archive<false> ar{epee::strspan<std::uint8_t>(current_cache_data)};
             ar.enable_varint_bug_backward_compatibility();
             if (::serialization::serialize(ar, *this))
               if (::serialization::check_stream_state(ar))
@@ -6764,7 +7663,7 @@ void wallet2::load_wallet_cache(const bool use_fs, const std::string& cache_buf)
         if (!loaded)
         {
           std::stringstream iss;
-          iss << cache_data;
+          iss << current_cache_data;
           boost::archive::portable_binary_iarchive ar(iss);
           ar >> *this;
         }
@@ -6937,6 +7836,66 @@ void wallet2::trim_hashchain()
   }
 }
 //----------------------------------------------------------------------------------------------------
+carrot::subaddress_lookup_table::fingerprint_t wallet2::get_subaddress_table_fingerprint() const
+{
+  carrot::subaddress_lookup_table::fingerprint_t fingerprint;
+  fingerprint.legacy_subaddress_count = m_subaddresses.size();
+  fingerprint.extended_subaddress_count = m_subaddresses_extended.size();
+  fingerprint.lookahead_major = m_subaddress_lookahead_major;
+  fingerprint.lookahead_minor = m_subaddress_lookahead_minor;
+  return fingerprint;
+}
+//----------------------------------------------------------------------------------------------------
+std::string wallet2::get_subaddress_table_file() const
+{
+  return m_wallet_file + ".subaddresses";
+}
+//----------------------------------------------------------------------------------------------------
+bool wallet2::use_subaddress_table() const
+{
+  // the table is keyed by the view secret key, which a hardware device may not hand out
+  return !m_wallet_file.empty() && !m_is_background_wallet && !key_on_device();
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::store_subaddress_table()
+{
+  if (!use_subaddress_table())
+    return;
+
+  const carrot::subaddress_lookup_table::fingerprint_t fingerprint = get_subaddress_table_fingerprint();
+  if (m_subaddress_table_fingerprint &&
+      m_subaddress_table_fingerprint->legacy_subaddress_count == fingerprint.legacy_subaddress_count &&
+      m_subaddress_table_fingerprint->extended_subaddress_count == fingerprint.extended_subaddress_count &&
+      m_subaddress_table_fingerprint->lookahead_major == fingerprint.lookahead_major &&
+      m_subaddress_table_fingerprint->lookahead_minor == fingerprint.lookahead_minor)
+    return;
+
+  // merge and release the old mapping before its file is replaced
+  m_account.set_subaddress_table(nullptr);
+  m_subaddress_table_fingerprint = boost::none;
+
+  crypto::secret_key table_key;
+  carrot::make_subaddress_lookup_table_key(m_account.get_keys().m_view_secret_key, table_key);
+  const std::string table_file = get_subaddress_table_file();
+  const std::string new_table_file = table_file + ".new";
+  bool r = carrot::subaddress_lookup_table::write(new_table_file, m_account.get_subaddress_map_ref(), table_key, fingerprint);
+  if (r)
+  {
+    const std::error_code e = tools::replace_file(new_table_file, table_file);
+    r = !e;
+  }
+  memwipe(&table_key, sizeof(table_key));
+  if (!r)
+  {
+    // not fatal: the map is regenerated from the cache on the next load
+    MWARNING("Failed to store subaddress table to " << table_file);
+    boost::system::error_code ignore;
+    boost::filesystem::remove(new_table_file, ignore);
+    return;
+  }
+  m_subaddress_table_fingerprint = fingerprint;
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::check_genesis(const crypto::hash& genesis_hash) const {
   std::string what("Genesis block mismatch. You probably use wallet without testnet (or stagenet) flag with blockchain from test (or stage) network or vice versa");
 
@@ -6956,6 +7915,10 @@ void wallet2::store()
 //----------------------------------------------------------------------------------------------------
 void wallet2::store_to(const std::string &path, const epee::wipeable_string &password, bool force_rewrite_keys)
 {
+  static tools::metrics::histogram &store_time = refresh_stage_time("store");
+  tools::metrics::scoped_timer timer(store_time);
+  TRACE_SPAN("wallet_store");
+
   trim_hashchain();
 
   const bool had_old_wallet_files = !m_wallet_file.empty();
@@ -7017,14 +7980,22 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
   }
 
   // get wallet cache data
-  boost::optional<wallet2::cache_file_data> cache_file_data = get_cache_file_data();
-  THROW_WALLET_EXCEPTION_IF(cache_file_data == boost::none, error::wallet_internal_error, "failed to generate wallet cache data");
+  std::string cache_data;
+  THROW_WALLET_EXCEPTION_IF(!get_cache_data(cache_data), error::wallet_internal_error, "failed to generate wallet cache data");
+
+  // if enabled, only store what changed since the last full cache file
+  const bool stored_delta = same_file && store_cache_delta_file(cache_data);
+  boost::optional<wallet2::cache_file_data> cache_file_data;
+  if (!stored_delta)
+    cache_file_data = encrypt_cache_data(cache_data);
 
   const std::string new_file = same_file ? m_wallet_file + ".new" : path;
   const std::string old_file = m_wallet_file;
+  const std::string old_delta_file = get_cache_delta_file();
   const std::string old_keys_file = m_keys_file;
   const std::string old_address_file = m_wallet_file + ".address.txt";
   const std::string old_mms_file = m_mms_file;
+  const std::string old_subaddress_table_file = get_subaddress_table_file();
 
   if (!same_file)
   {
@@ -7057,17 +8028,37 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
     if (!r) {
       LOG_ERROR("error removing file: " << old_keys_file);
     }
-    // remove old message store file
-    if (boost::filesystem::exists(old_mms_file))
+    // remove old message store file
+    if (boost::filesystem::exists(old_mms_file))
+    {
+      r = boost::filesystem::remove(old_mms_file);
+      if (!r) {
+        LOG_ERROR("error removing file: " << old_mms_file);
+      }
+    }
+    // remove old cache delta, the full cache is written below under the new name
+    if (boost::filesystem::exists(old_delta_file))
+    {
+      r = boost::filesystem::remove(old_delta_file);
+      if (!r) {
+        LOG_ERROR("error removing file: " << old_delta_file);
+      }
+    }
+    // remove old subaddress table, it is rewritten below under the new name
+    if (boost::filesystem::exists(old_subaddress_table_file))
     {
-      r = boost::filesystem::remove(old_mms_file);
+      m_account.set_subaddress_table(nullptr);
+      m_subaddress_table_fingerprint = boost::none;
+      r = boost::filesystem::remove(old_subaddress_table_file);
       if (!r) {
-        LOG_ERROR("error removing file: " << old_mms_file);
+        LOG_ERROR("error removing file: " << old_subaddress_table_file);
       }
     }
   }
 
-  // Save cache to new file. If storing to the same file, the temp path has the ".new" extension
+  if (!stored_delta)
+  {
+    // Save cache to new file. If storing to the same file, the temp path has the ".new" extension
 #ifdef WIN32
     // On Windows avoid using std::ofstream which does not work with UTF-8 filenames
     // The price to pay is temporary higher memory consumption for string stream + binary archive
@@ -7087,19 +8078,23 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
     THROW_WALLET_EXCEPTION_IF(!success || !ostr.good(), error::file_save_error, new_file);
 #endif
 
-  if (same_file)
-  {
-    // here we have "*.new" file, we need to rename it to be without ".new"
-    std::error_code e = tools::replace_file(new_file, m_wallet_file);
-    THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, m_wallet_file, e);
-  }
-  else if (!same_file && had_old_wallet_files)
-  {
-    // remove old wallet file
-    bool r = boost::filesystem::remove(old_file);
-    if (!r) {
-      LOG_ERROR("error removing file: " << old_file);
+    if (same_file)
+    {
+      // here we have "*.new" file, we need to rename it to be without ".new"
+      std::error_code e = tools::replace_file(new_file, m_wallet_file);
+      THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, m_wallet_file, e);
+    }
+    else if (!same_file && had_old_wallet_files)
+    {
+      // remove old wallet file
+      bool r = boost::filesystem::remove(old_file);
+      if (!r) {
+        LOG_ERROR("error removing file: " << old_file);
+      }
     }
+
+    // the file just written is the checkpoint for future deltas
+    reset_cache_checkpoint(cache_data, cache_file_data->iv);
   }
   
   if (m_message_store.get_active())
@@ -7109,6 +8104,8 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
     m_message_store.write_to_file(get_multisig_wallet_state(), m_mms_file);
   }
 
+  store_subaddress_table();
+
   if (m_background_sync_type == BackgroundSyncCustomPassword && !m_background_syncing && !m_is_background_wallet)
   {
     // Update the background wallet cache when we store the main wallet cache
@@ -7127,6 +8124,14 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
 }
 //----------------------------------------------------------------------------------------------------
 boost::optional<wallet2::cache_file_data> wallet2::get_cache_file_data()
+{
+  std::string cache_data;
+  if (!get_cache_data(cache_data))
+    return boost::none;
+  return encrypt_cache_data(cache_data);
+}
+//----------------------------------------------------------------------------------------------------
+bool wallet2::get_cache_data(std::string &cache_data)
 {
   trim_hashchain();
   try
@@ -7134,21 +8139,138 @@ boost::optional<wallet2::cache_file_data> wallet2::get_cache_file_data()
     std::stringstream oss;
     binary_archive<true> ar(oss);
     if (!::serialization::serialize(ar, *this))
-      return boost::none;
-
-    boost::optional<wallet2::cache_file_data> cache_file_data = (wallet2::cache_file_data) {};
-    cache_file_data.get().cache_data = oss.str();
-    std::string cipher;
-    cipher.resize(cache_file_data.get().cache_data.size());
-    cache_file_data.get().iv = crypto::rand<crypto::chacha_iv>();
-    crypto::chacha20(cache_file_data.get().cache_data.data(), cache_file_data.get().cache_data.size(), get_cache_key(), cache_file_data.get().iv, &cipher[0]);
-    cache_file_data.get().cache_data = cipher;
-    return cache_file_data;
+      return false;
+    cache_data = oss.str();
+    return true;
   }
   catch(...)
   {
-    return boost::none;
+    return false;
+  }
+}
+//----------------------------------------------------------------------------------------------------
+wallet2::cache_file_data wallet2::encrypt_cache_data(const std::string &cache_data)
+{
+  wallet2::cache_file_data cache_file_data;
+  cache_file_data.cache_data.resize(cache_data.size());
+  cache_file_data.iv = crypto::rand<crypto::chacha_iv>();
+  crypto::chacha20(cache_data.data(), cache_data.size(), get_cache_key(), cache_file_data.iv, &cache_file_data.cache_data[0]);
+  return cache_file_data;
+}
+//----------------------------------------------------------------------------------------------------
+std::string wallet2::get_cache_delta_file() const
+{
+  return m_wallet_file.empty() ? std::string() : m_wallet_file + ".delta";
+}
+//----------------------------------------------------------------------------------------------------
+bool wallet2::store_cache_delta_file(const std::string &cache_data)
+{
+  if (!m_store_cache_delta || !m_cache_checkpoint_iv)
+    return false;
+
+  tools::wallet::cache_delta delta = tools::wallet::make_cache_delta(m_cache_checkpoint_index, cache_data);
+  const uint64_t literal_size = tools::wallet::get_cache_delta_literal_size(delta);
+  if (literal_size > m_cache_checkpoint_size / CACHE_DELTA_COMPACTION_RATIO)
+  {
+    MDEBUG("Cache delta of " << literal_size << " bytes is too large, storing full cache");
+    return false;
+  }
+
+  std::string delta_data;
+  if (!::serialization::dump_binary(delta, delta_data))
+    return false;
+
+  cache_delta_file_data delta_file_data;
+  delta_file_data.checkpoint_iv = *m_cache_checkpoint_iv;
+  delta_file_data.iv = crypto::rand<crypto::chacha_iv>();
+  delta_file_data.delta_data.resize(delta_data.size());
+  crypto::chacha20(delta_data.data(), delta_data.size(), get_cache_key(), delta_file_data.iv, &delta_file_data.delta_data[0]);
+  memwipe(&delta_data[0], delta_data.size());
+
+  std::string buf;
+  if (!::serialization::dump_binary(delta_file_data, buf))
+    return false;
+
+  const std::string delta_file = get_cache_delta_file();
+  const std::string new_delta_file = delta_file + ".new";
+  if (!save_to_file(new_delta_file, buf))
+  {
+    MWARNING("Failed to write cache delta to " << new_delta_file << ", storing full cache");
+    return false;
+  }
+  const std::error_code e = tools::replace_file(new_delta_file, delta_file);
+  if (e)
+  {
+    MWARNING("Failed to replace cache delta " << delta_file << ": " << e.message() << ", storing full cache");
+    return false;
+  }
+  MDEBUG("Stored cache delta of " << literal_size << " changed bytes out of " << cache_data.size());
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::reset_cache_checkpoint(const std::string &cache_data, const crypto::chacha_iv &iv)
+{
+  const std::string delta_file = get_cache_delta_file();
+  boost::system::error_code ignore;
+  if (!delta_file.empty() && boost::filesystem::exists(delta_file, ignore))
+  {
+    if (!boost::filesystem::remove(delta_file, ignore))
+      LOG_ERROR("error removing file: " << delta_file);
+  }
+
+  m_cache_checkpoint_index.clear();
+  m_cache_checkpoint_iv = boost::none;
+  m_cache_checkpoint_size = 0;
+  if (!m_store_cache_delta)
+    return;
+  m_cache_checkpoint_index = tools::wallet::make_cache_chunk_index(cache_data);
+  m_cache_checkpoint_iv = iv;
+  m_cache_checkpoint_size = cache_data.size();
+}
+//----------------------------------------------------------------------------------------------------
+bool wallet2::load_cache_delta_file(const crypto::chacha_iv &checkpoint_iv, const std::string &checkpoint, std::string &cache_data_out)
+{
+  if (m_store_cache_delta)
+  {
+    m_cache_checkpoint_index = tools::wallet::make_cache_chunk_index(checkpoint);
+    m_cache_checkpoint_iv = checkpoint_iv;
+    m_cache_checkpoint_size = checkpoint.size();
+  }
+
+  const std::string delta_file = get_cache_delta_file();
+  boost::system::error_code e;
+  if (delta_file.empty() || !boost::filesystem::exists(delta_file, e) || e)
+    return false;
+
+  std::string buf;
+  cache_delta_file_data delta_file_data;
+  if (!load_from_file(delta_file, buf) || !::serialization::parse_binary(buf, delta_file_data))
+  {
+    MWARNING("Failed to read cache delta " << delta_file << ", ignoring it");
+    return false;
+  }
+  if (memcmp(&delta_file_data.checkpoint_iv, &checkpoint_iv, sizeof(checkpoint_iv)))
+  {
+    // the full cache was rewritten after this delta, e.g. by a version without delta support
+    MWARNING("Cache delta " << delta_file << " does not belong to " << m_wallet_file << ", ignoring it");
+    return false;
+  }
+
+  std::string delta_data;
+  delta_data.resize(delta_file_data.delta_data.size());
+  crypto::chacha20(delta_file_data.delta_data.data(), delta_file_data.delta_data.size(), get_cache_key(), delta_file_data.iv, &delta_data[0]);
+  tools::wallet::cache_delta delta;
+  const bool r = ::serialization::parse_binary(delta_data, delta) &&
+    tools::wallet::apply_cache_delta(checkpoint, delta, cache_data_out);
+  memwipe(&delta_data[0], delta_data.size());
+  if (!r)
+  {
+    // the checkpoint alone is still a consistent, older state of the wallet
+    MERROR("Failed to apply cache delta " << delta_file << ", loading " << m_wallet_file << " without it");
+    return false;
   }
+  LOG_PRINT_L1("Applied cache delta " << delta_file);
+  return true;
 }
 //----------------------------------------------------------------------------------------------------
 std::vector<std::string> wallet2::list_asset_types() const
@@ -7166,11 +8288,12 @@ uint64_t wallet2::balance(uint32_t index_major, const std::string& asset_type, b
   for (const auto& i : balance_per_subaddress(index_major, asset_type, strict))
     amount += i.second;
 
-  // Iterate over the locked coins, adding them to the _locked_ balance
-  for (const auto& i : m_locked_coins) {
-    if (index_major == 0 && asset_type == i.second.m_asset_type) {
-      amount += i.second.m_amount;
-    }
+  // Add the locked coins to the _locked_ balance of the primary account
+  if (index_major == 0)
+  {
+    const auto it = m_locked_coins_balance.find(asset_type);
+    if (it != m_locked_coins_balance.end())
+      amount += it->second;
   }
   return amount;
 }
@@ -7196,18 +8319,22 @@ uint64_t wallet2::unlocked_balance(uint32_t index_major, const std::string& asse
 std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(uint32_t index_major, const std::string& asset_type, bool strict) const
 {
   std::map<uint32_t, uint64_t> amount_per_subaddr;
-  if (m_transfers_indices.count(asset_type) > 0) {
-    for (const auto& idx: m_transfers_indices.at(asset_type))
+  const auto account_it = m_balance_index.find({asset_type, index_major});
+  if (account_it != m_balance_index.end())
+  {
+    // outputs spent by a tx which is not yet in a block are only counted by strict queries
+    const size_t categories = strict ? 2 : 1;
+    for (const auto &subaddr: account_it->second)
     {
-      const transfer_details& td = m_transfers[idx];
-      if (td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen)
+      uint64_t amount = 0;
+      size_t count = 0;
+      for (size_t c = 0; c < categories; ++c)
       {
-        auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-        if (found == amount_per_subaddr.end())
-          amount_per_subaddr[td.m_subaddr_index.minor] = td.amount();
-        else
-          found->second += td.amount();
+        amount += subaddr.second.amount[c];
+        count += subaddr.second.count[c];
       }
+      if (count > 0)
+        amount_per_subaddr[subaddr.first] = amount;
     }
   }
 
@@ -7252,51 +8379,95 @@ std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(uint32_t index_majo
   return amount_per_subaddr;
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_balance_history() const
+{
+  std::map<std::pair<std::string, uint32_t>, std::map<uint64_t, std::pair<uint64_t, uint64_t>>> deltas;
+  for (const auto &td: m_transfers)
+  {
+    auto &account = deltas[{td.asset_type, td.m_subaddr_index.major}];
+    account[td.m_block_height].first += td.amount();
+    // spends which are not yet in a block do not change any past balance
+    if (td.m_spent && td.m_spent_height != 0)
+      account[td.m_spent_height].second += td.amount();
+  }
+
+  m_balance_history.clear();
+  for (const auto &account: deltas)
+  {
+    balance_history &history = m_balance_history[account.first];
+    history.deltas.reserve(account.second.size());
+    uint64_t balance = 0;
+    for (const auto &d: account.second)
+    {
+      // checkpoints are only taken where something changed, so quiet stretches cost nothing
+      const uint64_t snapshot_height = d.first - d.first % BALANCE_HISTORY_SNAPSHOT_INTERVAL;
+      if (snapshot_height > 0 && (history.snapshots.empty() || history.snapshots.back().height < snapshot_height))
+        history.snapshots.push_back({snapshot_height, balance, history.deltas.size()});
+      history.deltas.push_back({d.first, d.second.first, d.second.second});
+      balance += d.second.first;
+      balance -= std::min(balance, d.second.second);
+    }
+  }
+  m_balance_history_valid = true;
+}
+//----------------------------------------------------------------------------------------------------
+uint64_t wallet2::balance_at_height(uint32_t index_major, const std::string& asset_type, uint64_t height) const
+{
+  if (!m_balance_history_valid)
+    rebuild_balance_history();
+  const auto it = m_balance_history.find({asset_type, index_major});
+  if (it == m_balance_history.end())
+    return 0;
+  const balance_history &history = it->second;
+
+  // start from the last checkpoint which does not cover anything above the requested height
+  uint64_t balance = 0;
+  size_t delta = 0;
+  const auto snapshot = std::upper_bound(history.snapshots.begin(), history.snapshots.end(), height,
+      [](uint64_t h, const balance_history::snapshot &s) { return h < s.height - 1; });
+  if (snapshot != history.snapshots.begin())
+  {
+    balance = std::prev(snapshot)->balance;
+    delta = std::prev(snapshot)->delta;
+  }
+  for (; delta < history.deltas.size() && history.deltas[delta].height <= height; ++delta)
+  {
+    balance += history.deltas[delta].received;
+    balance -= std::min(balance, history.deltas[delta].spent);
+  }
+  return balance;
+}
+//----------------------------------------------------------------------------------------------------
 std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> wallet2::unlocked_balance_per_subaddress(uint32_t index_major, const std::string& asset_type, bool strict)
 {
   std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> amount_per_subaddr;
   const uint64_t blockchain_height = get_blockchain_current_height();
-  const uint64_t now = time(NULL);
-  if (m_transfers_indices.count(asset_type) == 0) {
+  const auto account_it = m_balance_index.find({asset_type, index_major});
+  if (account_it == m_balance_index.end())
     return amount_per_subaddr;
-  }
 
-  for(const auto& idx: m_transfers_indices[asset_type])
+  const size_t categories = strict ? 2 : 1;
+  for (const auto &subaddr: account_it->second)
   {
-    transfer_details& td = m_transfers[idx];
-    if(td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen)
+    uint64_t amount = 0, blocks_to_unlock = 0;
+    size_t count = 0;
+    for (size_t c = 0; c < categories; ++c)
     {
-      uint64_t amount = 0, blocks_to_unlock = 0, time_to_unlock = 0;
-      if (is_transfer_unlocked(td))
-      {
-        amount = td.amount();
-        blocks_to_unlock = 0;
-        time_to_unlock = 0;
-      }
-      else
-      {
-        uint64_t unlock_height = 0;
-        if (td.m_tx.type == cryptonote::transaction_type::MINER || td.m_tx.type == cryptonote::transaction_type::PROTOCOL)
-          unlock_height = td.m_block_height + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
-        else {
-          uint64_t unlock_blocks = 0;
-          THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_unlock_time(td.m_tx.vout[td.m_internal_output_index], unlock_blocks), error::wallet_internal_error, "failed to get unlock_time");
-          unlock_height = td.m_block_height + ((unlock_blocks > CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE) ? unlock_blocks : CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
-        }
-        blocks_to_unlock = (unlock_height > blockchain_height) ? unlock_height - blockchain_height : 0;
-        time_to_unlock = 0;
-        amount = 0;
-      }
-      auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-      if (found == amount_per_subaddr.end())
-        amount_per_subaddr[td.m_subaddr_index.minor] = std::make_pair(amount, std::make_pair(blocks_to_unlock, time_to_unlock));
-      else
+      const subaddress_balance &balance = subaddr.second;
+      amount += balance.amount[c];
+      count += balance.count[c];
+      // only the buckets which unlock above the current height hold locked outputs
+      const auto &by_height = balance.by_unlock_height[c];
+      for (auto it = by_height.upper_bound({blockchain_height, std::numeric_limits<uint64_t>::max()}); it != by_height.end(); ++it)
       {
-        found->second.first += amount;
-        found->second.second.first = std::max(found->second.second.first, blocks_to_unlock);
-        found->second.second.second = std::max(found->second.second.second, time_to_unlock);
+        amount -= it->second.first;
+        const uint64_t unlock_height = it->first.second;
+        if (unlock_height > blockchain_height)
+          blocks_to_unlock = std::max(blocks_to_unlock, unlock_height - blockchain_height);
       }
     }
+    if (count > 0)
+      amount_per_subaddr[subaddr.first] = std::make_pair(amount, std::make_pair(blocks_to_unlock, uint64_t(0)));
   }
   return amount_per_subaddr;
 }
@@ -7364,31 +8535,59 @@ void wallet2::get_payments(const crypto::hash& payment_id, std::list<wallet2::pa
   });
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::get_payments(std::list<std::pair<crypto::hash,wallet2::payment_details>>& payments, uint64_t min_height, uint64_t max_height, const boost::optional<uint32_t>& subaddr_account, const std::set<uint32_t>& subaddr_indices) const
+namespace
 {
-  auto range = std::make_pair(m_payments.begin(), m_payments.end());
-  std::for_each(range.first, range.second, [&payments, &min_height, &max_height, &subaddr_account, &subaddr_indices](const payment_container::value_type& x) {
-    if (min_height < x.second.m_block_height && max_height >= x.second.m_block_height &&
-      (!subaddr_account || *subaddr_account == x.second.m_subaddr_index.major) &&
-      (subaddr_indices.empty() || subaddr_indices.count(x.second.m_subaddr_index.minor) == 1))
+  // walks the (min_height, max_height] slice of per account height indices, in ascending height order
+  template<typename T, typename F, typename L>
+  void get_history_range(const std::map<uint32_t, std::set<std::pair<uint64_t, const T*>>> &index, uint64_t min_height, uint64_t max_height,
+      const boost::optional<uint32_t>& subaddr_account, size_t max_count, F filter, L &out)
+  {
+    if (min_height >= max_height)
+      return;
+    std::vector<std::pair<uint64_t, const T*>> entries;
+    size_t partitions = 0;
+    for (auto account = subaddr_account ? index.find(*subaddr_account) : index.begin(); account != index.end(); ++account)
+    {
+      if (subaddr_account && account->first != *subaddr_account)
+        break;
+      ++partitions;
+      size_t count = 0;
+      for (auto it = account->second.lower_bound({min_height + 1, nullptr}); it != account->second.end() && it->first <= max_height; ++it)
+      {
+        // finish the last height we started on, so callers can resume from it
+        if (max_count && count >= max_count && it->first != entries.back().first)
+          break;
+        if (!filter(*it->second))
+          continue;
+        entries.push_back(*it);
+        ++count;
+      }
+    }
+    if (partitions > 1)
+      std::stable_sort(entries.begin(), entries.end(), [](const std::pair<uint64_t, const T*> &a, const std::pair<uint64_t, const T*> &b) { return a.first < b.first; });
+    for (size_t n = 0; n < entries.size(); ++n)
     {
-      payments.push_back(x);
+      if (max_count && n >= max_count && entries[n].first != entries[n - 1].first)
+        break;
+      out.push_back(*entries[n].second);
     }
-  });
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::get_payments(std::list<std::pair<crypto::hash,wallet2::payment_details>>& payments, uint64_t min_height, uint64_t max_height, const boost::optional<uint32_t>& subaddr_account, const std::set<uint32_t>& subaddr_indices, size_t max_count) const
+{
+  get_history_range(m_payments_index, min_height, max_height, subaddr_account, max_count, [&subaddr_indices](const std::pair<const crypto::hash, payment_details>& x) {
+    return subaddr_indices.empty() || subaddr_indices.count(x.second.m_subaddr_index.minor) == 1;
+  }, payments);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::get_payments_out(std::list<std::pair<crypto::hash,wallet2::confirmed_transfer_details>>& confirmed_payments,
-    uint64_t min_height, uint64_t max_height, const boost::optional<uint32_t>& subaddr_account, const std::set<uint32_t>& subaddr_indices) const
+    uint64_t min_height, uint64_t max_height, const boost::optional<uint32_t>& subaddr_account, const std::set<uint32_t>& subaddr_indices, size_t max_count) const
 {
-  for (auto i = m_confirmed_txs.begin(); i != m_confirmed_txs.end(); ++i) {
-    if (i->second.m_block_height <= min_height || i->second.m_block_height > max_height)
-      continue;
-    if (subaddr_account && *subaddr_account != i->second.m_subaddr_account)
-      continue;
-    if (!subaddr_indices.empty() && std::count_if(i->second.m_subaddr_indices.begin(), i->second.m_subaddr_indices.end(), [&subaddr_indices](uint32_t index) { return subaddr_indices.count(index) == 1; }) == 0)
-      continue;
-    confirmed_payments.push_back(*i);
-  }
+  ensure_history_loaded();
+  get_history_range(m_confirmed_txs_index, min_height, max_height, subaddr_account, max_count, [&subaddr_indices](const std::pair<const crypto::hash, confirmed_transfer_details>& x) {
+    return subaddr_indices.empty() || std::count_if(x.second.m_subaddr_indices.begin(), x.second.m_subaddr_indices.end(), [&subaddr_indices](uint32_t index) { return subaddr_indices.count(index) == 1; }) != 0;
+  }, confirmed_payments);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::get_unconfirmed_payments_out(std::list<std::pair<crypto::hash,wallet2::unconfirmed_transfer_details>>& unconfirmed_payments, const boost::optional<uint32_t>& subaddr_account, const std::set<uint32_t>& subaddr_indices) const
@@ -7800,6 +8999,7 @@ void wallet2::commit_tx(pending_tx& ptx)
     MDEBUG("Transaction " << txid << " already processed");
     return;
   }
+  ensure_history_loaded();
   if (m_confirmed_txs.find(txid) != m_confirmed_txs.end())
   {
     MDEBUG("Transaction " << txid << " already processed");
@@ -9051,6 +10251,7 @@ bool wallet2::get_rings(const crypto::chacha_key &key, const std::vector<crypto:
 
 bool wallet2::get_rings(const crypto::hash &txid, std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>> &outs)
 {
+  ensure_history_loaded();
   for (auto i: m_confirmed_txs)
   {
     if (txid == i.first)
@@ -9886,10 +11087,23 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
             boost::join(o.second | boost::adaptors::transformed([](uint64_t out){return std::to_string(out);}), " "));
     }
 
-    // get the keys for those
+    // get the keys for those, reusing what earlier calls already fetched
+    const std::string outkey_cache_asset_type = use_global_outs ? std::string() : rct_asset_type;
+    std::vector<size_t> uncached_outputs;
+    daemon_resp.outs.resize(req.outputs.size());
+    for (size_t i = 0; i < req.outputs.size(); ++i)
+    {
+      const COMMAND_RPC_GET_OUTPUTS_BIN::outkey *cached = m_outkey_cache.get(std::make_tuple(outkey_cache_asset_type, req.outputs[i].amount, req.outputs[i].index));
+      if (cached)
+        daemon_resp.outs[i] = *cached;
+      else
+        uncached_outputs.push_back(i);
+    }
+    MDEBUG("Found " << (req.outputs.size() - uncached_outputs.size()) << "/" << req.outputs.size() << " requested outputs in the output key cache");
+
     // the response can get large and end up rejected by the anti DoS limits, so chunk it if needed
     size_t offset = 0;
-    while (offset < req.outputs.size())
+    while (offset < uncached_outputs.size())
     {
       static const size_t chunk_size = 1000;
       COMMAND_RPC_GET_OUTPUTS_BIN::request chunk_req = AUTO_VAL_INIT(chunk_req);
@@ -9897,10 +11111,10 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
       chunk_req.get_txid = false;
       if (!use_global_outs)
         chunk_req.asset_type = rct_asset_type;
-      const size_t this_chunk_size = std::min<size_t>(req.outputs.size() - offset, chunk_size);
+      const size_t this_chunk_size = std::min<size_t>(uncached_outputs.size() - offset, chunk_size);
       chunk_req.outputs.reserve(this_chunk_size);
       for (size_t i = 0; i < this_chunk_size; ++i)
-        chunk_req.outputs.push_back(req.outputs[offset + i]);
+        chunk_req.outputs.push_back(req.outputs[uncached_outputs[offset + i]]);
 
       const boost::lock_guard<boost::recursive_mutex> lock{m_daemon_rpc_mutex};
       uint64_t pre_call_credits = m_rpc_payment_state.credits;
@@ -9912,9 +11126,15 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
         std::to_string(chunk_daemon_resp.outs.size()) + ", expected " +  std::to_string(chunk_req.outputs.size()));
       check_rpc_cost("/get_outs.bin", chunk_daemon_resp.credits, pre_call_credits, chunk_daemon_resp.outs.size() * COST_PER_OUT);
 
-      offset += chunk_size;
       for (size_t i = 0; i < chunk_daemon_resp.outs.size(); ++i)
-        daemon_resp.outs.push_back(std::move(chunk_daemon_resp.outs[i]));
+      {
+        const get_outputs_out &out = chunk_req.outputs[i];
+        // locked outputs will unlock later, so only keep the final state
+        if (chunk_daemon_resp.outs[i].unlocked)
+          m_outkey_cache.put(std::make_tuple(outkey_cache_asset_type, out.amount, out.index), chunk_daemon_resp.outs[i]);
+        daemon_resp.outs[uncached_outputs[offset + i]] = std::move(chunk_daemon_resp.outs[i]);
+      }
+      offset += this_chunk_size;
     }
 
     std::unordered_map<uint64_t, uint64_t> scanty_outs;
@@ -10822,11 +12042,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
   if (hf_version >= HF_VERSION_CARROT)
   {
     const auto tx_proposals = tools::wallet::make_carrot_transaction_proposals_wallet2_transfer(*this, dsts, priority, extra, tx_type, subaddr_account, subaddr_indices, subtract_fee_from_outputs);
-    std::vector<pending_tx> ptx_vector;
-    ptx_vector.reserve(tx_proposals.size());
-    for (const auto &tx_proposal : tx_proposals)
-      ptx_vector.push_back(tools::wallet::finalize_all_proofs_from_transfer_details_as_pending_tx(tx_proposal, *this));
-    return ptx_vector;
+    return tools::wallet::finalize_all_proofs_from_transfer_details_as_pending_txs(tx_proposals, *this);
   }
 
   auto original_dsts = dsts;
@@ -11661,11 +12877,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_all(uint64_t below
     THROW_WALLET_EXCEPTION_IF(!address.m_is_carrot, error::wallet_internal_error, "CryptoNote address supplied, but Carrot is now active");
     
     const auto tx_proposals = tools::wallet::make_carrot_transaction_proposals_wallet2_sweep_all(*this, below, address, is_subaddress, outputs, priority, extra, tx_type, subaddr_account, subaddr_indices);
-    std::vector<pending_tx> ptx_vector;
-    ptx_vector.reserve(tx_proposals.size());
-    for (const auto &tx_proposal : tx_proposals)
-      ptx_vector.push_back(tools::wallet::finalize_all_proofs_from_transfer_details_as_pending_tx(tx_proposal, *this));
-    return ptx_vector;
+    return tools::wallet::finalize_all_proofs_from_transfer_details_as_pending_txs(tx_proposals, *this);
   }
 
   // Sanity checks
@@ -12046,11 +13258,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
       input_key_images.push_back(m_transfers.at(transfer_idx).m_key_image);
 
     const auto tx_proposals = tools::wallet::make_carrot_transaction_proposals_wallet2_sweep(*this, input_key_images, address, is_subaddress, outputs, priority, extra, tx_type);
-    std::vector<pending_tx> ptx_vector;
-    ptx_vector.reserve(tx_proposals.size());
-    for (const auto &tx_proposal : tx_proposals)
-      ptx_vector.push_back(tools::wallet::finalize_all_proofs_from_transfer_details_as_pending_tx(tx_proposal, *this));
-    return ptx_vector;
+    return tools::wallet::finalize_all_proofs_from_transfer_details_as_pending_txs(tx_proposals, *this);
   }
 
   //ensure device is let in NONE mode in any case
@@ -13762,11 +14970,13 @@ uint64_t wallet2::get_approximate_blockchain_height() const
 
 void wallet2::set_tx_note(const crypto::hash &txid, const std::string &note)
 {
+  ensure_history_loaded();
   m_tx_notes[txid] = note;
 }
 
 std::string wallet2::get_tx_note(const crypto::hash &txid) const
 {
+  ensure_history_loaded();
   std::unordered_map<crypto::hash, std::string>::const_iterator i = m_tx_notes.find(txid);
   if (i == m_tx_notes.end())
     return std::string();
@@ -14039,50 +15249,153 @@ crypto::public_key wallet2::get_tx_pub_key_from_received_outs(const tools::walle
   return main_tx_pubkey;
 }
 //----------------------------------------------------------------------------------------------------
-bool wallet2::export_key_images(const std::string &filename, bool all) const
+bool wallet2::export_key_images(const std::string &filename, bool all, size_t start) const
 {
   PERF_TIMER(export_key_images);
-  std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> ski = export_key_images(all);
-  std::string magic(KEY_IMAGE_EXPORT_FILE_MAGIC, strlen(KEY_IMAGE_EXPORT_FILE_MAGIC));
+#ifdef WIN32
+  // On Windows avoid using std::ofstream which does not work with UTF-8 filenames
+  std::ostringstream oss;
+  write_key_images_chunked(oss, all, start);
+  return save_to_file(filename, oss.str());
+#else
+  if (m_export_format != ExportFormat::Binary)
+  {
+    std::ostringstream oss;
+    write_key_images_chunked(oss, all, start);
+    return save_to_file(filename, oss.str());
+  }
+  std::ofstream ostr;
+  ostr.open(filename, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+  if (!ostr.good())
+    return false;
+  write_key_images_chunked(ostr, all, start);
+  ostr.close();
+  return ostr.good();
+#endif
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::write_key_images_chunked(std::ostream &out, bool all, size_t start) const
+{
+  PERF_TIMER(write_key_images_chunked);
+  THROW_WALLET_EXCEPTION_IF(!all && start > 0, error::wallet_internal_error, "Incremental mode is incompatible with non-zero start");
+
+  // the magic is plaintext, then each chunk is encrypted separately and prefixed with its size,
+  // so neither side has to hold the whole file: the first chunk is the header, the others hold
+  // up to KEY_IMAGE_EXPORT_CHUNK_SIZE signed key images each
+  const auto write_chunk = [this, &out](const std::string &plaintext)
+  {
+    const std::string ciphertext = encrypt_with_view_secret_key(plaintext);
+    const uint32_t size = ciphertext.size();
+    const char size_bytes[4] = {(char)(size & 0xff), (char)((size >> 8) & 0xff), (char)((size >> 16) & 0xff), (char)((size >> 24) & 0xff)};
+    out.write(size_bytes, sizeof(size_bytes));
+    out.write(ciphertext.data(), ciphertext.size());
+  };
+
+  out.write(KEY_IMAGE_EXPORT_CHUNKED_FILE_MAGIC, strlen(KEY_IMAGE_EXPORT_CHUNKED_FILE_MAGIC));
+
   const cryptonote::account_public_address &keys = get_account().get_keys().m_account_address;
-  const uint32_t offset = ski.first;
+  const uint32_t offset = export_key_images(all, start, 0).first;
+  std::string header(4, '\0');
+  header[0] = offset & 0xff;
+  header[1] = (offset >> 8) & 0xff;
+  header[2] = (offset >> 16) & 0xff;
+  header[3] = (offset >> 24) & 0xff;
+  header += std::string((const char *)&keys.m_spend_public_key, sizeof(crypto::public_key));
+  header += std::string((const char *)&keys.m_view_public_key, sizeof(crypto::public_key));
+  write_chunk(header);
+
+  std::string data;
+  for (size_t n = offset; n < m_transfers.size(); n += KEY_IMAGE_EXPORT_CHUNK_SIZE)
+  {
+    const auto ski = export_key_images(true, n, KEY_IMAGE_EXPORT_CHUNK_SIZE);
+    data.clear();
+    data.reserve(ski.second.size() * (sizeof(crypto::key_image) + sizeof(crypto::signature)));
+    for (const auto &i: ski.second)
+    {
+      data += std::string((const char *)&i.first, sizeof(crypto::key_image));
+      data += std::string((const char *)&i.second, sizeof(crypto::signature));
+    }
+    write_chunk(data);
+  }
+}
+//----------------------------------------------------------------------------------------------------
+uint32_t wallet2::read_key_images_chunked(std::istream &in, const std::string &filename, std::vector<std::pair<crypto::key_image, crypto::signature>> &ski) const
+{
+  PERF_TIMER(read_key_images_chunked);
+  const size_t record_size = sizeof(crypto::key_image) + sizeof(crypto::signature);
+  const size_t max_chunk_size = KEY_IMAGE_EXPORT_CHUNK_SIZE * record_size + 4096;
+  const auto read_chunk = [this, &in, &filename, max_chunk_size](std::string &plaintext)
+  {
+    unsigned char size_bytes[4];
+    if (!in.read((char*)size_bytes, sizeof(size_bytes)))
+      return false;
+    const uint32_t size = size_bytes[0] | (size_bytes[1] << 8) | (size_bytes[2] << 16) | ((uint32_t)size_bytes[3] << 24);
+    THROW_WALLET_EXCEPTION_IF(size > max_chunk_size, error::wallet_internal_error, std::string("Bad chunk size from file ") + filename);
+    std::string ciphertext(size, '\0');
+    THROW_WALLET_EXCEPTION_IF(size > 0 && !in.read(&ciphertext[0], size), error::wallet_internal_error, std::string("Truncated key image export file ") + filename);
+    try
+    {
+      plaintext = decrypt_with_view_secret_key(ciphertext);
+    }
+    catch (const std::exception &e)
+    {
+      THROW_WALLET_EXCEPTION(error::wallet_internal_error, std::string("Failed to decrypt ") + filename + ": " + e.what());
+    }
+    return true;
+  };
 
   std::string data;
-  data.reserve(4 + ski.second.size() * (sizeof(crypto::key_image) + sizeof(crypto::signature)) + 2 * sizeof(crypto::public_key));
-  data.resize(4);
-  data[0] = offset & 0xff;
-  data[1] = (offset >> 8) & 0xff;
-  data[2] = (offset >> 16) & 0xff;
-  data[3] = (offset >> 24) & 0xff;
-  data += std::string((const char *)&keys.m_spend_public_key, sizeof(crypto::public_key));
-  data += std::string((const char *)&keys.m_view_public_key, sizeof(crypto::public_key));
-  for (const auto &i: ski.second)
+  const size_t headerlen = 4 + 2 * sizeof(crypto::public_key);
+  THROW_WALLET_EXCEPTION_IF(!read_chunk(data) || data.size() != headerlen, error::wallet_internal_error, std::string("Bad header from file ") + filename);
+  const uint32_t offset = (uint8_t)data[0] | (((uint8_t)data[1]) << 8) | (((uint8_t)data[2]) << 16) | (((uint8_t)data[3]) << 24);
+  const crypto::public_key &public_spend_key = *(const crypto::public_key*)&data[4];
+  const crypto::public_key &public_view_key = *(const crypto::public_key*)&data[4 + sizeof(crypto::public_key)];
+  const cryptonote::account_public_address &keys = get_account().get_keys().m_account_address;
+  if (public_spend_key != keys.m_spend_public_key || public_view_key != keys.m_view_public_key)
   {
-    data += std::string((const char *)&i.first, sizeof(crypto::key_image));
-    data += std::string((const char *)&i.second, sizeof(crypto::signature));
+    THROW_WALLET_EXCEPTION(error::wallet_internal_error, std::string( "Key images from ") + filename + " are for a different account");
   }
+  THROW_WALLET_EXCEPTION_IF(offset > m_transfers.size(), error::wallet_internal_error, "Offset larger than known outputs");
 
-  // encrypt data, keep magic plaintext
-  PERF_TIMER(export_key_images_encrypt);
-  std::string ciphertext = encrypt_with_view_secret_key(data);
-  return save_to_file(filename, magic + ciphertext);
+  while (read_chunk(data))
+  {
+    THROW_WALLET_EXCEPTION_IF(data.size() % record_size, error::wallet_internal_error, std::string("Bad data size from file ") + filename);
+    const size_t nki = data.size() / record_size;
+    THROW_WALLET_EXCEPTION_IF(nki > m_transfers.size() - offset - ski.size(), error::wallet_internal_error,
+        "The blockchain is out of date compared to the signed key images");
+    for (size_t n = 0; n < nki; ++n)
+    {
+      crypto::key_image key_image = *reinterpret_cast<const crypto::key_image*>(&data[n * record_size]);
+      crypto::signature signature = *reinterpret_cast<const crypto::signature*>(&data[n * record_size + sizeof(crypto::key_image)]);
+      ski.push_back(std::make_pair(key_image, signature));
+    }
+  }
+  THROW_WALLET_EXCEPTION_IF(!in.eof(), error::wallet_internal_error, std::string("Truncated key image export file ") + filename);
+  return offset;
 }
 
 //----------------------------------------------------------------------------------------------------
-std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> wallet2::export_key_images(bool all) const
+std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> wallet2::export_key_images(bool all, size_t start, size_t count) const
 {
   PERF_TIMER(export_key_images_raw);
   std::vector<std::pair<crypto::key_image, crypto::signature>> ski;
 
+  THROW_WALLET_EXCEPTION_IF(!all && start > 0, error::wallet_internal_error, "Incremental mode is incompatible with non-zero start");
+
+  // all: all key images, subject to start/count
+  // !all: from the first requested key image, subject to count
   size_t offset = 0;
   if (!all)
   {
     while (offset < m_transfers.size() && !m_transfers[offset].m_key_image_request)
       ++offset;
   }
+  else
+    offset = start;
 
-  ski.reserve(m_transfers.size() - offset);
-  for (size_t n = offset; n < m_transfers.size(); ++n)
+  if (offset < m_transfers.size())
+    ski.reserve(std::min(m_transfers.size() - offset, count));
+  for (size_t n = offset; n < m_transfers.size() && n - offset < count; ++n)
   {
     const transfer_details &td = m_transfers[n];
 
@@ -14130,12 +15443,34 @@ std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>
 uint64_t wallet2::import_key_images(const std::string &filename, uint64_t &spent, uint64_t &unspent)
 {
   PERF_TIMER(import_key_images_fsu);
+  static_assert(sizeof(KEY_IMAGE_EXPORT_CHUNKED_FILE_MAGIC) == sizeof(KEY_IMAGE_EXPORT_FILE_MAGIC), "Key image export magics differ in size");
+  const size_t magiclen = strlen(KEY_IMAGE_EXPORT_FILE_MAGIC);
+  std::vector<std::pair<crypto::key_image, crypto::signature>> ski;
+#ifndef WIN32
+  {
+    // binary chunked exports are read chunk by chunk rather than loaded whole
+    std::ifstream istr(filename, std::ios_base::binary | std::ios_base::in);
+    std::string magic(magiclen, '\0');
+    if (istr.read(&magic[0], magiclen) && !memcmp(magic.data(), KEY_IMAGE_EXPORT_CHUNKED_FILE_MAGIC, magiclen))
+    {
+      const uint32_t offset = read_key_images_chunked(istr, filename, ski);
+      return import_key_images(ski, offset, spent, unspent);
+    }
+  }
+#endif
+
   std::string data;
   bool r = load_from_file(filename, data);
 
   THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, std::string(tr("failed to read file ")) + filename);
 
-  const size_t magiclen = strlen(KEY_IMAGE_EXPORT_FILE_MAGIC);
+  if (data.size() >= magiclen && !memcmp(data.data(), KEY_IMAGE_EXPORT_CHUNKED_FILE_MAGIC, magiclen))
+  {
+    std::istringstream iss(std::string(data, magiclen));
+    const uint32_t offset = read_key_images_chunked(iss, filename, ski);
+    return import_key_images(ski, offset, spent, unspent);
+  }
+
   if (data.size() < magiclen || memcmp(data.data(), KEY_IMAGE_EXPORT_FILE_MAGIC, magiclen))
   {
     THROW_WALLET_EXCEPTION(error::wallet_internal_error, std::string("Bad key image export file magic in ") + filename);
@@ -14168,7 +15503,6 @@ uint64_t wallet2::import_key_images(const std::string &filename, uint64_t &spent
       error::wallet_internal_error, std::string("Bad data size from file ") + filename);
   size_t nki = (data.size() - headerlen) / record_size;
 
-  std::vector<std::pair<crypto::key_image, crypto::signature>> ski;
   ski.reserve(nki);
   for (size_t n = 0; n < nki; ++n)
   {
@@ -14202,28 +15536,56 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
   req.key_images.reserve(signed_key_images.size());
 
   PERF_TIMER_START(import_key_images_A);
+  // check the key images on the compute pool, then report the first failure (if any) in import order
+  enum key_image_check_result : uint8_t { KI_CHECK_OK, KI_CHECK_DOMAIN, KI_CHECK_SIGNATURE };
+  std::vector<uint8_t> check_results(signed_key_images.size(), KI_CHECK_OK);
+  auto check_key_images = [this, &signed_key_images, &check_results, offset](size_t begin, size_t end)
+  {
+    for (size_t n = begin; n < end; ++n)
+    {
+      const transfer_details &td = m_transfers[n + offset];
+      const crypto::key_image &key_image = signed_key_images[n].first;
+      if (td.m_key_image_known && key_image == td.m_key_image)
+        continue;
+
+      // get ephemeral public key
+      const crypto::public_key pkey = td.get_public_key();
+      const std::vector<const crypto::public_key*> pkeys{&pkey};
+      if (!(rct::scalarmultKey(rct::ki2rct(key_image), rct::curveOrder()) == rct::identity()))
+        check_results[n] = KI_CHECK_DOMAIN;
+      else if (!crypto::check_ring_signature((const crypto::hash&)key_image, key_image, pkeys, &signed_key_images[n].second))
+        check_results[n] = KI_CHECK_SIGNATURE;
+    }
+  };
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  const size_t n_jobs = std::min<size_t>(std::max(1u, tpool.get_max_concurrency()), signed_key_images.size());
+  if (n_jobs <= 1)
+  {
+    check_key_images(0, signed_key_images.size());
+  }
+  else
+  {
+    tools::threadpool::waiter waiter(tpool);
+    const size_t chunk_size = (signed_key_images.size() + n_jobs - 1) / n_jobs;
+    for (size_t begin = 0; begin < signed_key_images.size(); begin += chunk_size)
+      tpool.submit(&waiter, std::bind(check_key_images, begin, std::min(begin + chunk_size, signed_key_images.size())), true);
+    THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+  }
+
   for (size_t n = 0; n < signed_key_images.size(); ++n)
   {
-    const transfer_details &td = m_transfers[n + offset];
     const crypto::key_image &key_image = signed_key_images[n].first;
     const crypto::signature &signature = signed_key_images[n].second;
 
-    // get ephemeral public key
-    const crypto::public_key pkey = td.get_public_key();
+    THROW_WALLET_EXCEPTION_IF(check_results[n] == KI_CHECK_DOMAIN,
+        error::wallet_internal_error, "Key image out of validity domain: input " + boost::lexical_cast<std::string>(n + offset) + "/"
+        + boost::lexical_cast<std::string>(signed_key_images.size()) + ", key image " + epee::string_tools::pod_to_hex(key_image));
 
-    if (!td.m_key_image_known || !(key_image == td.m_key_image))
-    {
-      std::vector<const crypto::public_key*> pkeys;
-      pkeys.push_back(&pkey);
-      THROW_WALLET_EXCEPTION_IF(!(rct::scalarmultKey(rct::ki2rct(key_image), rct::curveOrder()) == rct::identity()),
-          error::wallet_internal_error, "Key image out of validity domain: input " + boost::lexical_cast<std::string>(n + offset) + "/"
-          + boost::lexical_cast<std::string>(signed_key_images.size()) + ", key image " + epee::string_tools::pod_to_hex(key_image));
+    THROW_WALLET_EXCEPTION_IF(check_results[n] == KI_CHECK_SIGNATURE,
+        error::signature_check_failed, boost::lexical_cast<std::string>(n + offset) + "/"
+        + boost::lexical_cast<std::string>(signed_key_images.size()) + ", key image " + epee::string_tools::pod_to_hex(key_image)
+        + ", signature " + epee::string_tools::pod_to_hex(signature) + ", pubkey " + epee::string_tools::pod_to_hex(m_transfers[n + offset].get_public_key()));
 
-      THROW_WALLET_EXCEPTION_IF(!crypto::check_ring_signature((const crypto::hash&)key_image, key_image, pkeys, &signature),
-          error::signature_check_failed, boost::lexical_cast<std::string>(n + offset) + "/"
-          + boost::lexical_cast<std::string>(signed_key_images.size()) + ", key image " + epee::string_tools::pod_to_hex(key_image)
-          + ", signature " + epee::string_tools::pod_to_hex(signature) + ", pubkey " + epee::string_tools::pod_to_hex(*pkeys[0]));
-    }
     req.key_images.push_back(epee::string_tools::pod_to_hex(key_image));
   }
   PERF_TIMER_STOP(import_key_images_A);
@@ -14258,6 +15620,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
     {
       transfer_details &td = m_transfers[n + offset];
       td.m_spent = daemon_resp.spent_status[n] != COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT;
+      update_unspent_transfer_index(n + offset);
     }
   }
   spent = 0;
@@ -14415,7 +15778,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
       {
         if (j->second.m_tx_hash == *spent_txid)
         {
-          m_payments.erase(j);
+          erase_payment(j);
           break;
         }
       }
@@ -14433,7 +15796,10 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
       pd.m_amount_in = pd.m_amount_out = td.amount();         // fee is unknown
       pd.m_block_height = 0;  // spent block height is unknown
       const crypto::hash &spent_txid = crypto::null_hash; // spent txid is unknown
-      m_confirmed_txs.insert(std::make_pair(spent_txid, pd));
+      ensure_history_loaded();
+      const auto entry = m_confirmed_txs.insert(std::make_pair(spent_txid, pd));
+      if (entry.second)
+        index_confirmed_tx(*entry.first);
     }
     PERF_TIMER_STOP(import_key_images_G);
   }
@@ -14587,8 +15953,7 @@ void wallet2::process_background_cache(const background_sync_data_t &background_
   // chronological order. The background cache should contain a superset of
   // *all* the wallet's txs from after the background sync start height.
   MDEBUG("Processing " << background_sync_data.txs.size() << " background synced txs starting from height " << background_sync_data.start_height);
-  auto output_tracker_cache = create_output_tracker_cache();
-  detached_blockchain_data dbd = detach_blockchain(background_sync_data.start_height, output_tracker_cache);
+  detached_blockchain_data dbd = detach_blockchain(background_sync_data.start_height);
 
   for (const auto &bgs_tx : sorted_bgs_cache)
   {
@@ -14598,6 +15963,7 @@ void wallet2::process_background_cache(const background_sync_data_t &background_
         cryptonote::is_coinbase(bgs_tx.second.tx), false/*pool*/, bgs_tx.second.double_spend_seen, true/*ignore_callbacks*/);
 
     // Re-set destination addresses if they were previously set
+    ensure_history_loaded();
     if (m_confirmed_txs.find(bgs_tx.first) != m_confirmed_txs.end() &&
         dbd.detached_confirmed_txs_dests.find(bgs_tx.first) != dbd.detached_confirmed_txs_dests.end())
     {
@@ -14904,17 +16270,22 @@ wallet2::payment_container wallet2::export_payments() const
 void wallet2::import_payments(const payment_container &payments)
 {
   m_payments.clear();
+  m_payments_index.clear();
   for (auto const &p : payments)
   {
-    m_payments.emplace(p);
+    add_payment(p.first, p.second);
   }
 }
 void wallet2::import_payments_out(const std::list<std::pair<crypto::hash,wallet2::confirmed_transfer_details>> &confirmed_payments)
 {
+  ensure_history_loaded();
   m_confirmed_txs.clear();
+  m_confirmed_txs_index.clear();
   for (auto const &p : confirmed_payments)
   {
-    m_confirmed_txs.emplace(p);
+    const auto entry = m_confirmed_txs.emplace(p);
+    if (entry.second)
+      index_confirmed_tx(*entry.first);
   }
 }
 
@@ -15041,6 +16412,7 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     m_transfers.resize(offset + output_array.size());
   else if (num_outputs < m_transfers.size())
     m_transfers.resize(num_outputs);
+  invalidate_transfers_hash_chain(offset);
 
   for (size_t i = 0; i < output_array.size(); ++i)
   {
@@ -15100,6 +16472,8 @@ process:
     m_transfers[i + offset] = std::move(td);
   }
 
+  rebuild_output_tracker_index();
+  rebuild_unspent_transfer_index();
   return m_transfers.size();
 }
 //----------------------------------------------------------------------------------------------------
@@ -15126,6 +16500,7 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     m_transfers.resize(offset + output_array.size());
   else if (num_outputs < m_transfers.size())
     m_transfers.resize(num_outputs);
+  invalidate_transfers_hash_chain(offset);
 
   for (size_t i = 0; i < output_array.size(); ++i)
   {
@@ -15208,6 +16583,8 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     m_pub_keys[td.get_public_key()] = i + offset;
   }
 
+  rebuild_output_tracker_index();
+  rebuild_unspent_transfer_index();
   return m_transfers.size();
 }
 //----------------------------------------------------------------------------------------------------
@@ -15628,8 +17005,7 @@ size_t wallet2::import_multisig(std::vector<cryptonote::blobdata> blobs)
     if (!td.m_key_image_partial)
       continue;
     MINFO("Multisig info importing from block height " << td.m_block_height);
-    auto output_tracker_cache = create_output_tracker_cache();
-    handle_reorg(td.m_block_height, output_tracker_cache);
+    handle_reorg(td.m_block_height);
     break;
   }
 
@@ -16248,25 +17624,30 @@ void wallet2::hash_m_transfer(const transfer_details & transfer, crypto::hash &h
 uint64_t wallet2::hash_m_transfers(boost::optional<uint64_t> transfer_height, crypto::hash &hash) const
 {
   CHECK_AND_ASSERT_THROW_MES(!transfer_height || *transfer_height <= m_transfers.size(), "Hash height is greater than number of transfers");
+  const uint64_t count = transfer_height ? *transfer_height : m_transfers.size();
 
-  KECCAK_CTX state;
+  // only transfers not hashed yet (or changed since) are hashed, any prefix is then a lookup
+  if (m_transfers_hash_chain.size() > m_transfers.size())
+    m_transfers_hash_chain.resize(m_transfers.size());
+  m_transfers_hash_chain.reserve(count);
   crypto::hash tmp_hash{};
-  uint64_t current_height = 0;
-
-  keccak_init(&state);
-  for(const transfer_details & transfer : m_transfers){
-    if (transfer_height && current_height >= *transfer_height){
-      break;
-    }
-
+  while (m_transfers_hash_chain.size() < count)
+  {
+    const transfer_details &transfer = m_transfers[m_transfers_hash_chain.size()];
+    const crypto::hash prev = m_transfers_hash_chain.empty() ? crypto::null_hash : m_transfers_hash_chain.back();
+    KECCAK_CTX state;
+    keccak_init(&state);
+    keccak_update(&state, (const uint8_t *) prev.data, sizeof(prev.data));
     hash_m_transfer(transfer, tmp_hash);
     keccak_update(&state, (const uint8_t *) &transfer.m_block_height, sizeof(transfer.m_block_height));
     keccak_update(&state, (const uint8_t *) tmp_hash.data, sizeof(tmp_hash.data));
-    current_height += 1;
+    crypto::hash link;
+    keccak_finish(&state, (uint8_t *) link.data);
+    m_transfers_hash_chain.push_back(link);
   }
 
-  keccak_finish(&state, (uint8_t *) hash.data);
-  return current_height;
+  hash = count == 0 ? crypto::null_hash : m_transfers_hash_chain[count - 1];
+  return count;
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::finish_rescan_bc_keep_key_images(uint64_t transfer_height, const crypto::hash &hash)
@@ -16298,12 +17679,18 @@ void wallet2::finish_rescan_bc_keep_key_images(uint64_t transfer_height, const c
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::get_bytes_sent() const
 {
-  return m_http_client->get_bytes_sent();
+  uint64_t bytes_sent = m_http_client->get_bytes_sent();
+  for (const auto &connection: m_daemon_connection_pool)
+    bytes_sent += connection->http_client->get_bytes_sent();
+  return bytes_sent;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::get_bytes_received() const
 {
-  return m_http_client->get_bytes_received();
+  uint64_t bytes_received = m_http_client->get_bytes_received();
+  for (const auto &connection: m_daemon_connection_pool)
+    bytes_received += connection->http_client->get_bytes_received();
+  return bytes_received;
 }
 //----------------------------------------------------------------------------------------------------
 std::vector<cryptonote::public_node> wallet2::get_public_nodes(bool white_only)
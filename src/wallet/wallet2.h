@@ -59,6 +59,7 @@
 #include "cryptonote_core/cryptonote_tx_utils.h"
 #include "common/unordered_containers_boost_serialization.h"
 #include "common/util.h"
+#include "common/lru_cache.h"
 #include "crypto/chacha.h"
 #include "crypto/hash.h"
 #include "multisig/multisig_account.h"
@@ -71,6 +72,7 @@
 #include "serialization/tuple.h"
 #include "serialization/containers.h"
 #include "scanning_tools.h"
+#include "cache_delta.h"
 
 #include "wallet_errors.h"
 #include "common/password.h"
@@ -106,6 +108,9 @@ namespace tools
   {
   public:
     uint64_t pick();
+    // picks count outputs at once, resolving them against rct_offsets in a single ascending pass;
+    // bad picks are std::numeric_limits<uint64_t>::max(), as with pick()
+    void pick(size_t count, std::vector<uint64_t> &picks_out);
     gamma_picker(const std::vector<uint64_t> &rct_offsets);
     gamma_picker(const std::vector<uint64_t> &rct_offsets, double shape, double scale);
     uint64_t get_num_rct_outs() const { return num_rct_outputs; }
@@ -120,11 +125,16 @@ namespace tools
     } engine;
 
 private:
+    uint64_t pick_output_index();
+    uint64_t pick_in_block(uint64_t index);
+
     std::gamma_distribution<double> gamma;
     const std::vector<uint64_t> &rct_offsets;
     const uint64_t *begin, *end;
     uint64_t num_rct_outputs;
     double average_output_time;
+    std::vector<uint64_t> batched_picks;
+    size_t next_batched_pick;
   };
 
   class wallet_keys_unlocker
@@ -857,6 +867,21 @@ private:
       END_SERIALIZE()
     };
 
+    // changes to the cache since the full cache file with IV checkpoint_iv was written
+    struct cache_delta_file_data
+    {
+      crypto::chacha_iv checkpoint_iv;
+      crypto::chacha_iv iv;
+      std::string delta_data;
+
+      BEGIN_SERIALIZE_OBJECT()
+        VERSION_FIELD(0)
+        FIELD(checkpoint_iv)
+        FIELD(iv)
+        FIELD(delta_data)
+      END_SERIALIZE()
+    };
+
     // GUI Address book
     struct address_book_row
     {
@@ -1173,6 +1198,8 @@ private:
     bool set_proxy(const std::string &address);
 
     void stop() { m_run.store(false, std::memory_order_relaxed); m_message_store.stop(); }
+    //! Makes a running refresh return at the next block boundary, leaving the message store alone
+    void stop_refresh() { m_run.store(false, std::memory_order_relaxed); }
 
     i_wallet2_callback* callback() const { return m_callback; }
     void callback(i_wallet2_callback* callback) { m_callback = callback; }
@@ -1254,6 +1281,9 @@ private:
     std::map<std::string, uint64_t> unlocked_balance_all(bool strict, uint64_t *blocks_to_unlock = NULL, uint64_t *time_to_unlock = NULL);
     uint64_t balance_all(bool strict, const std::string& asset_type) const;
     uint64_t unlocked_balance_all(bool strict, const std::string& asset_type, uint64_t *blocks_to_unlock = NULL, uint64_t *time_to_unlock = NULL);
+    // balance of given subaddress account once the block at the given height was added, from received
+    // and mined spent transfers: locked stakes and frozen state are not taken into account
+    uint64_t balance_at_height(uint32_t subaddr_index_major, const std::string& asset_type, uint64_t height) const;
     template<typename T>
     void transfer_selected(const std::vector<cryptonote::tx_destination_entry>& dsts, const std::vector<size_t>& selected_transfers, size_t fake_outputs_count,
       std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs, std::unordered_set<crypto::public_key> &valid_public_keys_cache,
@@ -1316,10 +1346,21 @@ private:
     bool check_version(uint32_t *version, bool *wallet_is_outdated, bool *daemon_is_outdated);
     bool check_hard_fork_version(cryptonote::network_type nettype, const std::vector<std::pair<uint8_t, uint64_t>> &daemon_hard_forks, const uint64_t height, const uint64_t target_height, bool *wallet_is_outdated, bool *daemon_is_outdated);
     void get_transfers(wallet2::transfer_container& incoming_transfers) const;
+    const transfer_container &get_transfers_ref() const { return m_transfers; }
+    /*!
+     * \brief get_unspent_transfer_indices  Get the unspent transfers of one asset type and subaddress account
+     * \return                              Indices into the transfer container, in ascending amount order
+     */
+    std::vector<size_t> get_unspent_transfer_indices(const std::string &asset_type, uint32_t subaddr_account) const;
     void get_payments(const crypto::hash& payment_id, std::list<wallet2::payment_details>& payments, uint64_t min_height = 0, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}) const;
-    void get_payments(std::list<std::pair<crypto::hash,wallet2::payment_details>>& payments, uint64_t min_height, uint64_t max_height = (uint64_t)-1, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}) const;
+    /*!
+     * \brief  Gets the payments/outgoing txs mined in (min_height, max_height], in ascending height order
+     * \param  max_count  If non zero, stop after that many entries, but always return every entry at the
+     *                    last height returned, so the next page can start with min_height set to that height
+     */
+    void get_payments(std::list<std::pair<crypto::hash,wallet2::payment_details>>& payments, uint64_t min_height, uint64_t max_height = (uint64_t)-1, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}, size_t max_count = 0) const;
     void get_payments_out(std::list<std::pair<crypto::hash,wallet2::confirmed_transfer_details>>& confirmed_payments,
-      uint64_t min_height, uint64_t max_height = (uint64_t)-1, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}) const;
+      uint64_t min_height, uint64_t max_height = (uint64_t)-1, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}, size_t max_count = 0) const;
     void get_unconfirmed_payments_out(std::list<std::pair<crypto::hash,wallet2::unconfirmed_transfer_details>>& unconfirmed_payments, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}) const;
     void get_unconfirmed_payments(std::list<std::pair<crypto::hash,wallet2::pool_payment_details>>& unconfirmed_payments, const boost::optional<uint32_t>& subaddr_account = boost::none, const std::set<uint32_t>& subaddr_indices = {}) const;
 
@@ -1477,7 +1518,7 @@ private:
 
     BEGIN_SERIALIZE_OBJECT()
       MAGIC_FIELD("monero wallet cache")
-      VERSION_FIELD(2)
+      VERSION_FIELD(3)
       FIELD(m_blockchain)
       FIELD(m_transfers)
       FIELD(m_transfers_indices)
@@ -1488,11 +1529,17 @@ private:
       FIELD(m_unconfirmed_txs)
       FIELD(m_payments)
       FIELD(m_tx_keys)
-      FIELD(m_confirmed_txs)
-      FIELD(m_tx_notes)
+      if (version < 3)
+      {
+        FIELD(m_confirmed_txs)
+        FIELD(m_tx_notes)
+      }
       FIELD(m_unconfirmed_payments)
       FIELD(m_pub_keys)
-      FIELD(m_address_book)
+      if (version < 3)
+      {
+        FIELD(m_address_book)
+      }
       FIELD(m_scanned_pool_txs[0])
       FIELD(m_scanned_pool_txs[1])
       FIELD(m_subaddresses)
@@ -1522,6 +1569,16 @@ private:
       FIELD(m_background_sync_data)
       FIELD(m_subaddresses_extended)
       FIELD(m_return_output_info)
+      if (version < 3)
+        return true;
+      // a history section that was never accessed is written back as it was read
+      if (W && m_history_section_loaded)
+        m_history_section = serialize_history_section();
+      FIELD(m_history_section)
+      if (W && m_history_section_loaded)
+        std::string().swap(m_history_section);
+      if (!W)
+        m_history_section_loaded = false;
     END_SERIALIZE()
 
     /*!
@@ -1531,6 +1588,13 @@ private:
      * \param  wallet_file_exists  Whether bin file exists
      */
     static void wallet_exists(const std::string& file_path, bool& keys_file_exists, bool& wallet_file_exists);
+    /*!
+     * \brief  Share pulled and parsed block batches between all the wallets of this process
+     * \param  batches  Number of recent batches to keep, 0 (the default) disables sharing
+     *
+     * Wallets following the same daemon from the same point then pull and parse each batch once.
+     */
+    static void set_shared_block_cache_size(size_t batches);
     /*!
      * \brief  Check if wallet file path is valid format
      * \param  file_path      Wallet file path
@@ -1618,6 +1682,8 @@ private:
     void freeze_incoming_payments(bool enable) { m_freeze_incoming_payments = enable; }
     bool is_send_change_back_to_subaddress_enabled() const { return m_send_change_back_to_subaddress; }
     void send_change_back_to_subaddress(bool enable) { m_send_change_back_to_subaddress = enable; }
+    bool is_store_cache_delta_enabled() const { return m_store_cache_delta; }
+    void store_cache_delta(bool enable) { m_store_cache_delta = enable; }
     bool is_mismatched_daemon_version_allowed() const { return m_allow_mismatched_daemon_version; }
     void allow_mismatched_daemon_version(bool allow_mismatch) { m_allow_mismatched_daemon_version = allow_mismatch; }
 
@@ -1637,6 +1703,13 @@ private:
 
     void scan_tx(const std::unordered_set<crypto::hash> &txids);
 
+    /*!
+     * \brief Scan the transactions an external scanner found outputs in
+     * \param filename  enote stream written by salvium-blockchain-enote-scanner
+     * \return          the number of transactions scanned
+     */
+    size_t import_enote_stream(const std::string &filename);
+
     /*!
      * \brief  Generates a proof that proves the reserve of unspent funds
      * \param  account_minreserve       When specified, collect outputs only belonging to the given account and prove the smallest reserve above the given amount
@@ -1659,7 +1732,7 @@ private:
    /*!
     * \brief GUI Address book get/store
     */
-    std::vector<address_book_row> get_address_book() const { return m_address_book; }
+    std::vector<address_book_row> get_address_book() const { ensure_history_loaded(); return m_address_book; }
     bool add_address_book_row(const cryptonote::account_public_address &address, const crypto::hash8 *payment_id, const std::string &description, bool is_subaddress, bool is_carrot);
     bool set_address_book_row(size_t row_id, const cryptonote::account_public_address &address, const crypto::hash8 *payment_id, const std::string &description, bool is_subaddress, bool is_carrot);
     bool delete_address_book_row(std::size_t row_id);
@@ -1682,6 +1755,18 @@ private:
     uint64_t get_daemon_blockchain_target_height(std::string& err);
     uint64_t get_daemon_adjusted_time();
 
+   /*!
+    * \brief Tests the view tags of the daemon's compact block scan records against this wallet.
+    * \param start_height   First block height to test
+    * \param count          Maximum number of blocks to test (the daemon may return fewer)
+    * \param txids          Hashes of txs which may hold an output for this wallet; they must be fetched and fully scanned
+    * \param current_height The daemon's blockchain height
+    * \return               The number of blocks tested
+    *
+    * Spends are not detected from the records, so this is a light pre-filter, not a replacement for refresh().
+    */
+    uint64_t get_block_scan_record_matches(uint64_t start_height, uint64_t count, std::vector<crypto::hash> &txids, uint64_t &current_height);
+
    /*!
     * \brief Calculates the approximate blockchain height from current date/time.
     */
@@ -1754,8 +1839,8 @@ private:
     void import_payments_out(const std::list<std::pair<crypto::hash,wallet2::confirmed_transfer_details>> &confirmed_payments);
     std::tuple<size_t, crypto::hash, std::vector<crypto::hash>> export_blockchain() const;
     void import_blockchain(const std::tuple<size_t, crypto::hash, std::vector<crypto::hash>> &bc);
-    bool export_key_images(const std::string &filename, bool all = false) const;
-    std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> export_key_images(bool all = false) const;
+    bool export_key_images(const std::string &filename, bool all = false, size_t start = 0) const;
+    std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> export_key_images(bool all = false, size_t start = 0, size_t count = std::numeric_limits<size_t>::max()) const;
     uint64_t import_key_images(const std::vector<std::pair<crypto::key_image, crypto::signature>> &signed_key_images, size_t offset, uint64_t &spent, uint64_t &unspent, bool check_spent = true);
     uint64_t import_key_images(const std::string &filename, uint64_t &spent, uint64_t &unspent);
     bool import_key_images(std::vector<crypto::key_image> key_images, size_t offset=0, boost::optional<std::unordered_set<size_t>> selected_transfers=boost::none);
@@ -1909,6 +1994,8 @@ private:
     bool is_tx_spendtime_unlocked(uint64_t unlock_time, uint64_t block_height);
     void hash_m_transfer(const transfer_details & transfer, crypto::hash &hash) const;
     uint64_t hash_m_transfers(boost::optional<uint64_t> transfer_height, crypto::hash &hash) const;
+    //! Drops the cached hash chain from this transfer on, after a hashed field or the container changed
+    void invalidate_transfers_hash_chain(size_t from) const { if (m_transfers_hash_chain.size() > from) m_transfers_hash_chain.resize(from); }
     void finish_rescan_bc_keep_key_images(uint64_t transfer_height, const crypto::hash &hash);
     void enable_dns(bool enable) { m_use_dns = enable; }
     void set_offline(bool offline = true);
@@ -1979,6 +2066,19 @@ private:
       const bool pool,
       std::optional<crypto::key_image> &ki_out,
       bool &password_failure_inout);
+    /*!
+     * \brief Same as `scan_key_image()` for every engaged entry of `enote_scan_infos`, batching the legacy key images
+     * \param[out] kis_out key image results, one per entry of `enote_scan_infos`
+     */
+    void scan_key_images(const epee::span<const std::optional<wallet::enote_view_incoming_scan_info_t>> enote_scan_infos,
+      const bool pool,
+      epee::span<std::optional<crypto::key_image>> kis_out,
+      bool &password_failure_inout);
+    /*!
+     * \brief Check that a complete spend privkey is available, requesting password and decrypting it if applicable
+     * \return false if the wallet has no complete spend privkey (multisig, background syncing, watch-only)
+     */
+    bool unlock_spend_key_for_key_image_scan(const bool pool, bool &password_failure_inout);
 
     void scan_protocol_tx_output(
       const cryptonote::transaction& tx,
@@ -2015,7 +2115,6 @@ private:
         const bool miner_tx,
         const bool pool,
         const bool double_spend_seen,
-        std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache,
         const bool ignore_callbacks = false);
     bool should_skip_block(const cryptonote::block &b, uint64_t height) const;
     void process_new_blockchain_entry(const cryptonote::block& b,
@@ -2024,11 +2123,9 @@ private:
       const crypto::hash& bl_id,
       const uint64_t height,
       epee::span<const std::optional<wallet::enote_view_incoming_scan_info_t>> enote_scan_infos,
-      epee::span<const std::optional<crypto::key_image>> output_key_images,
-      std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache);
-    detached_blockchain_data detach_blockchain(uint64_t height,
-      std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache);
-    void handle_reorg(uint64_t height, std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache);
+      epee::span<const std::optional<crypto::key_image>> output_key_images);
+    detached_blockchain_data detach_blockchain(uint64_t height);
+    void handle_reorg(uint64_t height);
     void get_short_chain_history(std::list<crypto::hash>& ids, uint64_t granularity = 1) const;
     bool clear();
     void clear_soft(bool keep_key_images=false);
@@ -2045,12 +2142,17 @@ private:
     void pull_hashes(uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<crypto::hash> &hashes);
     void fast_refresh(uint64_t stop_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, bool force = false);
     void pull_and_parse_next_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>>& process_pool_txs, bool &last, bool &error, std::exception_ptr &exception);
-    void process_parsed_blocks(const uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> &output_tracker_cache);
+    void process_parsed_blocks(const uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added);
+    void update_refresh_block_count(const std::vector<cryptonote::block_complete_entry> &blocks, std::chrono::steady_clock::duration pull_time, std::chrono::steady_clock::duration process_time);
     bool accept_pool_tx_for_processing(const crypto::hash &txid);
+    void write_key_images_chunked(std::ostream &out, bool all, size_t start) const;
+    uint32_t read_key_images_chunked(std::istream &in, const std::string &filename, std::vector<std::pair<crypto::key_image, crypto::signature>> &ski) const;
+    bool is_scanned_pool_tx_not_for_us(const crypto::hash &txid) const;
+    void add_scanned_pool_tx(const crypto::hash &txid);
     void process_unconfirmed_transfer(bool incremental, const crypto::hash &txid, wallet2::unconfirmed_transfer_details &tx_details, bool seen_in_pool, std::chrono::system_clock::time_point now, bool refreshed);
     void process_pool_info_extent(const cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response &res, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed);
     void update_pool_state_by_pool_query(std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed = false);
-    void update_pool_state_from_pool_data(bool incremental, const std::vector<crypto::hash> &removed_pool_txids, const std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &added_pool_txs, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed);
+    void update_pool_state_from_pool_data(bool incremental, const std::vector<crypto::hash> &removed_pool_txids, const std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &added_pool_txs, const std::vector<crypto::hash> &skipped_pool_txids, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed);
     uint64_t select_transfers(uint64_t needed_money, std::vector<size_t> unused_transfers_indices, std::vector<size_t>& selected_transfers) const;
     bool prepare_file_names(const std::string& file_path);
     void process_unconfirmed(const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t height);
@@ -2081,6 +2183,32 @@ private:
     bool should_pick_a_second_output(bool use_rct, size_t n_transfers, const std::vector<size_t> &unused_transfers_indices, const std::vector<size_t> &unused_dust_indices) const;
     std::vector<size_t> get_only_rct(const std::vector<size_t> &unused_dust_indices, const std::vector<size_t> &unused_transfers_indices) const;
     void trim_hashchain();
+    carrot::subaddress_lookup_table::fingerprint_t get_subaddress_table_fingerprint() const;
+    std::string get_subaddress_table_file() const;
+    bool use_subaddress_table() const;
+    void store_subaddress_table();
+    void update_unspent_transfer_index(size_t idx);
+    void rebuild_unspent_transfer_index();
+    void update_balance_index(size_t idx);
+    void rebuild_balance_history() const;
+    void get_transfer_unlock_heights(const transfer_details &td, uint64_t &unlock_height, uint64_t &reported_unlock_height) const;
+    void add_locked_coins(const crypto::public_key &pk, const locked_yield_details &details);
+    bool remove_locked_coins(const crypto::public_key &pk);
+    void rebuild_locked_coins_balance();
+    void rebuild_protocol_payout_keys();
+    void add_payment(const crypto::hash &payment_id, const payment_details &pd);
+    payment_container::iterator erase_payment(payment_container::iterator it);
+    std::string serialize_history_section();
+    void ensure_history_loaded() const;
+    void index_confirmed_tx(const std::pair<const crypto::hash, confirmed_transfer_details> &entry);
+    void unindex_confirmed_tx(const std::pair<const crypto::hash, confirmed_transfer_details> &entry);
+    void rebuild_history_index();
+    std::string get_cache_delta_file() const;
+    bool get_cache_data(std::string &cache_data);
+    wallet2::cache_file_data encrypt_cache_data(const std::string &cache_data);
+    bool store_cache_delta_file(const std::string &cache_data);
+    void reset_cache_checkpoint(const std::string &cache_data, const crypto::chacha_iv &iv);
+    bool load_cache_delta_file(const crypto::chacha_iv &checkpoint_iv, const std::string &checkpoint, std::string &cache_data_out);
     crypto::key_image get_multisig_composite_key_image(size_t n) const;
     rct::multisig_kLRki get_multisig_composite_kLRki(size_t n,  const std::unordered_set<crypto::public_key> &ignore_set, std::unordered_set<rct::key> &used_L, std::unordered_set<rct::key> &new_used_L) const;
     rct::multisig_kLRki get_multisig_kLRki(size_t n, const rct::key &k) const;
@@ -2113,10 +2241,13 @@ private:
     hw::device& lookup_device(const std::string & device_descriptor);
 
     bool get_rct_distribution(const bool use_global_outs, const std::string &rct_asset_type, uint64_t &start_height, std::vector<uint64_t> &distribution, uint64_t &num_spendable_global_outs);
+    void clear_rct_distribution_cache();
 
     uint64_t get_segregation_fork_height() const;
 
-    std::map<std::pair<uint64_t, uint64_t>, size_t> create_output_tracker_cache() const;
+    void rebuild_output_tracker_index();
+    // adds the {major, begin, end} ranges of subaddresses to m_subaddresses and the Carrot account
+    void generate_subaddresses(const std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> &ranges);
 
     void init_type(hw::device::device_type device_type);
     void setup_new_blockchain();
@@ -2146,16 +2277,105 @@ private:
     std::string m_keys_file;
     std::string m_mms_file;
     const std::unique_ptr<epee::net_utils::http::abstract_http_client> m_http_client;
+    // extra keep-alive connections to the same daemon, for unpaid bulk calls (refresh block pulls) which
+    // would otherwise queue behind everything else using m_http_client
+    struct daemon_connection
+    {
+      std::unique_ptr<epee::net_utils::http::abstract_http_client> http_client;
+      boost::mutex mutex;
+    };
+    std::vector<std::unique_ptr<daemon_connection>> m_daemon_connection_pool;
+    // exclusive use of a free pooled connection, or of m_http_client under m_daemon_rpc_mutex if none is free
+    class daemon_connection_lease
+    {
+    public:
+      explicit daemon_connection_lease(wallet2 &wallet);
+      epee::net_utils::http::abstract_http_client &http_client() { return *m_http_client; }
+    private:
+      boost::unique_lock<boost::mutex> m_pool_lock;
+      boost::unique_lock<boost::recursive_mutex> m_daemon_rpc_lock;
+      epee::net_utils::http::abstract_http_client *m_http_client;
+    };
     hashchain m_blockchain;
     serializable_unordered_map<crypto::hash, unconfirmed_transfer_details> m_unconfirmed_txs;
     serializable_unordered_map<crypto::hash, confirmed_transfer_details> m_confirmed_txs;
+    // m_payments and m_confirmed_txs entries by subaddress account and block height, rebuilt on load
+    std::map<uint32_t, std::set<std::pair<uint64_t, const std::pair<const crypto::hash, payment_details>*>>> m_payments_index;
+    std::map<uint32_t, std::set<std::pair<uint64_t, const std::pair<const crypto::hash, confirmed_transfer_details>*>>> m_confirmed_txs_index;
     serializable_unordered_multimap<crypto::hash, pool_payment_details> m_unconfirmed_payments;
     serializable_unordered_map<crypto::hash, crypto::secret_key> m_tx_keys;
     cryptonote::checkpoints m_checkpoints;
     serializable_unordered_map<crypto::hash, std::vector<crypto::secret_key>> m_additional_tx_keys;
 
     transfer_container m_transfers;
+    // chained hash of m_transfers: entry i covers transfers 0..i, extended
+    // lazily by hash_m_transfers() and cut back wherever a transfer changes
+    mutable std::vector<crypto::hash> m_transfers_hash_chain;
     transfer_details_indices m_transfers_indices;
+    // transfer index by asset type and asset type output index, to find our outputs among ring members, rebuilt on load
+    std::unordered_map<std::string, std::unordered_map<uint64_t, size_t>> m_output_tracker_index;
+    // unspent (amount, transfer index) by asset type and subaddress account, rebuilt on load
+    std::map<std::pair<std::string, uint32_t>, std::set<std::pair<uint64_t, size_t>>> m_unspent_transfer_index;
+    // what each transfer currently adds to m_balance_index, so it can be taken out again exactly
+    struct balance_contribution
+    {
+      enum category_t : uint8_t { none = 0, unspent = 1, pending_spend = 2 }; // pending_spend: spent, not yet mined
+      category_t category = none;
+      uint64_t amount = 0;
+      uint64_t unlock_height = 0;          // first height at which is_transfer_unlocked() holds
+      uint64_t reported_unlock_height = 0; // height reported through blocks_to_unlock
+    };
+    struct subaddress_balance
+    {
+      // indexed by balance_contribution::category_t - 1
+      uint64_t amount[2] = {0, 0};
+      size_t count[2] = {0, 0};
+      // (unlock height, reported unlock height) -> (amount, count): everything keyed above the current
+      // height is still locked, so nothing has to be moved around when blocks are added or popped
+      std::map<std::pair<uint64_t, uint64_t>, std::pair<uint64_t, size_t>> by_unlock_height[2];
+    };
+    // non frozen balances by (asset type, subaddress account) and subaddress minor index, rebuilt along with m_unspent_transfer_index
+    std::map<std::pair<std::string, uint32_t>, std::map<uint32_t, subaddress_balance>> m_balance_index;
+    std::vector<balance_contribution> m_balance_contributions;
+    // received and spent amounts by height for a subaddress account, with the running balance
+    // checkpointed every BALANCE_HISTORY_SNAPSHOT_INTERVAL blocks so queries only walk the deltas after a checkpoint
+    struct balance_history
+    {
+      struct delta
+      {
+        uint64_t height;
+        uint64_t received;
+        uint64_t spent;
+      };
+      struct snapshot
+      {
+        uint64_t height;  // balance covers all deltas below this height
+        uint64_t balance;
+        size_t delta;     // first delta at or above height
+      };
+      std::vector<delta> deltas;
+      std::vector<snapshot> snapshots;
+    };
+    // by (asset type, subaddress account), built from m_transfers on the first query after a transfer changed
+    mutable std::map<std::pair<std::string, uint32_t>, balance_history> m_balance_history;
+    mutable bool m_balance_history_valid;
+    // sum of m_locked_coins amounts by asset type
+    std::unordered_map<std::string, uint64_t> m_locked_coins_balance;
+    // onetime addresses the protocol_tx payouts of our STAKE / AUDIT txs use, which are the return addresses
+    // of those txs: protocol_tx outputs paying anything else are not scanned
+    std::unordered_set<crypto::public_key> m_protocol_payout_keys;
+    // false if the return address of a pending payout could not be found, protocol_txes are then scanned in full
+    bool m_protocol_payout_keys_complete;
+    struct rct_distribution_cache_entry
+    {
+      uint64_t start_height;
+      std::vector<uint64_t> distribution; // cumulative
+      uint64_t num_spendable_global_outs;
+    };
+    // cumulative rct output distribution by asset type ("" for global outputs), extended by height
+    std::unordered_map<std::string, rct_distribution_cache_entry> m_rct_distribution_cache;
+    // unlocked output keys previously returned by get_outs.bin, keyed by (asset type, amount, index)
+    tools::lru_cache<std::tuple<std::string, uint64_t, uint64_t>, cryptonote::COMMAND_RPC_GET_OUTPUTS_BIN::outkey> m_outkey_cache;
     serializable_unordered_map<crypto::public_key, locked_yield_details> m_locked_coins;
     serializable_map<crypto::public_key, size_t> m_salvium_txs;
     payment_container m_payments;
@@ -2169,6 +2389,10 @@ private:
     serializable_unordered_map<crypto::hash, std::string> m_tx_notes;
     serializable_unordered_map<std::string, std::string> m_attributes;
     std::vector<tools::wallet2::address_book_row> m_address_book;
+    // m_confirmed_txs, m_tx_notes and m_address_book are not needed for balance or refresh, so
+    // a loaded cache keeps them serialized here until ensure_history_loaded() is first called
+    mutable std::string m_history_section;
+    mutable bool m_history_section_loaded;
     std::pair<serializable_map<std::string, std::string>, std::vector<std::string>> m_account_tags;
     uint64_t m_upper_transaction_weight_limit; //TODO: auto-calc this value or request from daemon, now use some fixed value
     const std::vector<std::vector<tools::wallet2::multisig_info>> *m_multisig_rescan_info;
@@ -2212,6 +2436,7 @@ private:
     bool m_confirm_non_default_ring_size;
     AskPasswordType m_ask_password;
     uint64_t m_max_reorg_depth;
+    uint64_t m_refresh_block_count;
     uint32_t m_min_output_count;
     uint64_t m_min_output_value;
     bool m_merge_destinations;
@@ -2249,6 +2474,7 @@ private:
     bool m_enable_multisig;
     bool m_freeze_incoming_payments;
     bool m_send_change_back_to_subaddress;
+    bool m_store_cache_delta;
     bool m_allow_mismatched_daemon_version;
 
     // Aux transaction data from device
@@ -2261,6 +2487,12 @@ private:
     bool m_ring_history_saved;
     std::unique_ptr<ringdb> m_ringdb;
     boost::optional<crypto::chacha_key> m_ringdb_key;
+    // fingerprint of the subaddress lookup table file last loaded or written, if any
+    boost::optional<carrot::subaddress_lookup_table::fingerprint_t> m_subaddress_table_fingerprint;
+    // full cache file the next delta is made against, if store_cache_delta is enabled
+    boost::optional<crypto::chacha_iv> m_cache_checkpoint_iv;
+    uint64_t m_cache_checkpoint_size;
+    tools::wallet::cache_chunk_index m_cache_checkpoint_index;
 
     uint64_t m_last_block_reward;
     std::unique_ptr<tools::file_locker> m_keys_file_locker;
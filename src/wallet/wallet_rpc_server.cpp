@@ -180,12 +180,13 @@ namespace tools
   }
 
   //------------------------------------------------------------------------------------------------------------------------------
-  wallet_rpc_server::wallet_rpc_server():m_wallet(NULL), rpc_login_file(), m_stop(false), m_restricted(false), m_vm(NULL)
+  wallet_rpc_server::wallet_rpc_server():m_wallet(NULL), rpc_login_file(), m_stop(false), m_restricted(false), m_vm(NULL), m_auto_refresh_run(false), m_calls_waiting(0)
   {
   }
   //------------------------------------------------------------------------------------------------------------------------------
   wallet_rpc_server::~wallet_rpc_server()
   {
+    stop_auto_refresh_thread();
     if (m_wallet)
       delete m_wallet;
   }
@@ -198,39 +199,105 @@ namespace tools
   bool wallet_rpc_server::run()
   {
     m_stop = false;
+    m_auto_refresh_run = true;
+    m_auto_refresh_thread = boost::thread([this](){ auto_refresh_loop(); });
     m_net_server.add_idle_handler([this](){
+      if (m_stop.load(std::memory_order_relaxed))
+      {
+        send_stop_signal();
+        return false;
+      }
+      return true;
+    }, 500);
+
+    //DO NOT START THIS SERVER IN MORE THEN 1 THREADS WITHOUT REFACTORING
+    const bool r = epee::http_server_impl_base<wallet_rpc_server, connection_context>::run(1, true);
+    stop_auto_refresh_thread();
+    return r;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_rpc_server::auto_refresh_loop()
+  {
+    boost::unique_lock<boost::timed_mutex> lock(m_wallet_mutex);
+    while (m_auto_refresh_run.load(std::memory_order_relaxed))
+    {
+      m_auto_refresh_cond.wait_for(lock, boost::chrono::seconds(1));
+      if (!m_auto_refresh_run.load(std::memory_order_relaxed))
+        break;
+      if (!m_wallet || m_calls_waiting.load(std::memory_order_relaxed) > 0)
+        continue;
       if (m_auto_refresh_period == 0) // disabled
-        return true;
+        continue;
       if (boost::posix_time::microsec_clock::universal_time() < m_last_auto_refresh_time + boost::posix_time::seconds(m_auto_refresh_period))
-        return true;
+        continue;
       uint64_t blocks_fetched = 0;
       try {
         bool received_money = false;
-        if (m_wallet) m_wallet->refresh(m_wallet->is_trusted_daemon(), 0, blocks_fetched, received_money, true, true, REFRESH_INFICATIVE_BLOCK_CHUNK_SIZE);
+        m_wallet->refresh(m_wallet->is_trusted_daemon(), 0, blocks_fetched, received_money, true, true, REFRESH_INFICATIVE_BLOCK_CHUNK_SIZE);
       } catch (const std::exception& ex) {
         LOG_ERROR("Exception at while refreshing, what=" << ex.what());
       }
-      // if we got the max amount of blocks, do not set the last refresh time, we did only part of the refresh and will
-      // continue asap, and only set the last refresh time once the refresh is actually finished
-      if (blocks_fetched < REFRESH_INFICATIVE_BLOCK_CHUNK_SIZE)
+      // if we got the max amount of blocks, or a call interrupted us, do not set the last refresh time, we did only part
+      // of the refresh and will continue asap, and only set the last refresh time once the refresh is actually finished
+      if (blocks_fetched < REFRESH_INFICATIVE_BLOCK_CHUNK_SIZE && m_calls_waiting.load(std::memory_order_relaxed) == 0)
         m_last_auto_refresh_time = boost::posix_time::microsec_clock::universal_time();
-      return true;
-    }, 1000);
-    m_net_server.add_idle_handler([this](){
-      if (m_stop.load(std::memory_order_relaxed))
-      {
-        send_stop_signal();
-        return false;
-      }
-      return true;
-    }, 500);
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_rpc_server::stop_auto_refresh_thread()
+  {
+    if (!m_auto_refresh_thread.joinable())
+      return;
+    m_auto_refresh_run = false;
+    {
+      boost::unique_lock<boost::timed_mutex> lock = preempt_auto_refresh();
+      m_auto_refresh_cond.notify_all();
+    }
+    m_auto_refresh_thread.join();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  boost::unique_lock<boost::timed_mutex> wallet_rpc_server::preempt_auto_refresh()
+  {
+    // a refresh which started just before we asked resets the stop request, so keep asking until it hands the wallet
+    // over; m_wallet is only replaced on the server thread, so reading it here is safe
+    boost::unique_lock<boost::timed_mutex> lock(m_wallet_mutex, boost::defer_lock);
+    do
+    {
+      if (m_wallet) m_wallet->stop_refresh();
+    } while (!lock.try_lock_for(boost::chrono::milliseconds(100)));
+    return lock;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context)
+  {
+    // a background refresh stops at the next block boundary, so calls see a consistent wallet without waiting for
+    // the whole refresh; it picks up where it left off once no call is waiting
+    ++m_calls_waiting;
+    boost::unique_lock<boost::timed_mutex> lock = preempt_auto_refresh();
+    epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([this](){
+      --m_calls_waiting;
+    });
 
-    //DO NOT START THIS SERVER IN MORE THEN 1 THREADS WITHOUT REFACTORING
-    return epee::http_server_impl_base<wallet_rpc_server, connection_context>::run(1, true);
+    MINFO("HTTP [" << m_conn_context.m_remote_address.host_str() << "] " << query_info.m_http_method_str << " " << query_info.m_URI);
+    response.m_response_code = 200;
+    response.m_response_comment = "Ok";
+    try
+    {
+      if(!handle_http_request_map(query_info, response, m_conn_context))
+      {response.m_response_code = 404;response.m_response_comment = "Not found";}
+    }
+    catch (const std::exception &e)
+    {
+      MERROR(m_conn_context << "Exception in handle_http_request_map: " << e.what());
+      response.m_response_code = 500;
+      response.m_response_comment = "Internal Server Error";
+    }
+    return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
   void wallet_rpc_server::stop()
   {
+    stop_auto_refresh_thread();
     if (m_wallet)
     {
       m_wallet->store();
@@ -623,6 +690,50 @@ namespace tools
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::on_get_balance_at_height(const wallet_rpc::COMMAND_RPC_GET_BALANCE_AT_HEIGHT::request& req, wallet_rpc::COMMAND_RPC_GET_BALANCE_AT_HEIGHT::response& res, epee::json_rpc::error& er, const connection_context *ctx)
+  {
+    if (!m_wallet) return not_open(er);
+
+    if (req.account_index >= m_wallet->get_num_subaddress_accounts())
+    {
+      er.code = WALLET_RPC_ERROR_CODE_ACCOUNT_INDEX_OUT_OF_BOUNDS;
+      er.message = "Account index is out of bound";
+      return false;
+    }
+    if (req.height >= m_wallet->get_blockchain_current_height())
+    {
+      er.code = WALLET_RPC_ERROR_CODE_WRONG_INDEX;
+      er.message = "Height is not below the wallet's blockchain height";
+      return false;
+    }
+
+    std::vector<std::string> assets_in_wallet = m_wallet->list_asset_types();
+    std::string asset_type = req.asset_type.empty() ? "SAL1" : boost::algorithm::to_upper_copy(req.asset_type);
+    if (!req.all_assets && std::find(assets_in_wallet.begin(), assets_in_wallet.end(), asset_type) == assets_in_wallet.end()) {
+      er.message = std::string("Source asset '") + asset_type + "' not found in wallet";
+      return false;
+    }
+    std::vector<std::string> assets = req.all_assets ? assets_in_wallet : std::vector<std::string>{asset_type};
+
+    try
+    {
+      res.height = req.height;
+      for (const auto& asset: assets)
+      {
+        wallet_rpc::COMMAND_RPC_GET_BALANCE_AT_HEIGHT::balance_info balance_info;
+        balance_info.asset_type = asset;
+        balance_info.balance = m_wallet->balance_at_height(req.account_index, asset, req.height);
+        res.balances.emplace_back(std::move(balance_info));
+      }
+    }
+    catch (const std::exception& e)
+    {
+      handle_rpc_exception(std::current_exception(), er, WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR);
+      return false;
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::on_getaddress(const wallet_rpc::COMMAND_RPC_GET_ADDRESS::request& req, wallet_rpc::COMMAND_RPC_GET_ADDRESS::response& res, epee::json_rpc::error& er, const connection_context *ctx)
   {
     if (!m_wallet) return not_open(er);
@@ -1381,6 +1492,70 @@ namespace tools
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::on_transfer_batch(const wallet_rpc::COMMAND_RPC_TRANSFER_BATCH::request& req, wallet_rpc::COMMAND_RPC_TRANSFER_BATCH::response& res, epee::json_rpc::error& er, const connection_context *ctx)
+  {
+    if (!m_wallet) return not_open(er);
+    if (m_restricted)
+    {
+      er.code = WALLET_RPC_ERROR_CODE_DENIED;
+      er.message = "Command unavailable in restricted mode.";
+      return false;
+    }
+
+    CHECK_MULTISIG_ENABLED();
+
+    // one create_transactions_2 per asset type, so inputs picked for one tx are never picked again for another
+    std::map<std::string, std::list<wallet_rpc::transfer_destination>> destinations_by_asset;
+    for (wallet_rpc::transfer_destination destination : req.destinations)
+    {
+      destination.asset_type = destination.asset_type.empty() ? "SAL1" : boost::algorithm::to_upper_copy(destination.asset_type);
+      destinations_by_asset[destination.asset_type].push_back(std::move(destination));
+    }
+    if (destinations_by_asset.empty())
+    {
+      er.code = WALLET_RPC_ERROR_CODE_ZERO_DESTINATION;
+      er.message = "Transaction has no destination";
+      return false;
+    }
+
+    try
+    {
+      uint64_t mixin = m_wallet->adjust_mixin(req.ring_size ? req.ring_size - 1 : 0);
+      uint32_t priority = m_wallet->adjust_priority(req.priority);
+      std::vector<wallet2::pending_tx> ptx_vector;
+      for (const auto &e : destinations_by_asset)
+      {
+        std::vector<cryptonote::tx_destination_entry> dsts;
+        std::vector<uint8_t> extra;
+        if (!validate_transfer(e.second, e.first, e.first, cryptonote::transaction_type::TRANSFER, "", dsts, extra, true, er))
+          return false;
+
+        MINFO("transfer_batch: packing " << dsts.size() << " " << e.first << " destinations");
+        std::vector<wallet2::pending_tx> asset_ptx_vector = m_wallet->create_transactions_2(dsts, e.first, e.first, cryptonote::transaction_type::TRANSFER, mixin, req.unlock_time, priority, extra, req.account_index, req.subaddr_indices);
+        if (asset_ptx_vector.empty())
+        {
+          er.code = WALLET_RPC_ERROR_CODE_TX_NOT_POSSIBLE;
+          er.message = "No transaction created for " + e.first;
+          return false;
+        }
+        MINFO("transfer_batch: " << e.first << " destinations packed into " << asset_ptx_vector.size() << " transactions");
+
+        for (size_t i = 0; i < asset_ptx_vector.size(); ++i)
+          res.asset_type_list.push_back(e.first);
+        ptx_vector.insert(ptx_vector.end(), std::make_move_iterator(asset_ptx_vector.begin()), std::make_move_iterator(asset_ptx_vector.end()));
+      }
+
+      return fill_response(ptx_vector, req.get_tx_keys, res.tx_key_list, res.amount_list, res.amounts_by_dest_list, res.fee_list, res.weight_list, res.multisig_txset, res.unsigned_txset, req.do_not_relay,
+          res.tx_hash_list, req.get_tx_hex, res.tx_blob_list, req.get_tx_metadata, res.tx_metadata_list, res.spent_key_images_list, er);
+    }
+    catch (const std::exception& e)
+    {
+      handle_rpc_exception(std::current_exception(), er, WALLET_RPC_ERROR_CODE_GENERIC_TRANSFER_ERROR);
+      return false;
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::on_sign_transfer(const wallet_rpc::COMMAND_RPC_SIGN_TRANSFER::request& req, wallet_rpc::COMMAND_RPC_SIGN_TRANSFER::response& res, epee::json_rpc::error& er, const connection_context *ctx)
   {
     if (!m_wallet) return not_open(er);
@@ -2958,7 +3133,7 @@ namespace tools
     if (req.in)
     {
       std::list<std::pair<crypto::hash, tools::wallet2::payment_details>> payments;
-      m_wallet->get_payments(payments, min_height, max_height, account_index, subaddr_indices);
+      m_wallet->get_payments(payments, min_height, max_height, account_index, subaddr_indices, req.limit);
       for (std::list<std::pair<crypto::hash, tools::wallet2::payment_details>>::const_iterator i = payments.begin(); i != payments.end(); ++i) {
         res.in.push_back(wallet_rpc::transfer_entry());
         fill_transfer_entry(res.in.back(), i->second.m_tx_hash, i->first, i->second);
@@ -2968,7 +3143,7 @@ namespace tools
     if (req.out)
     {
       std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>> payments;
-      m_wallet->get_payments_out(payments, min_height, max_height, account_index, subaddr_indices);
+      m_wallet->get_payments_out(payments, min_height, max_height, account_index, subaddr_indices, req.limit);
       for (std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>>::const_iterator i = payments.begin(); i != payments.end(); ++i) {
         res.out.push_back(wallet_rpc::transfer_entry());
         fill_transfer_entry(res.out.back(), i->first, i->second);
@@ -3174,7 +3349,7 @@ namespace tools
     CHECK_IF_BACKGROUND_SYNCING();
     try
     {
-      std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> ski = m_wallet->export_key_images(req.all);
+      std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>> ski = m_wallet->export_key_images(req.all, req.start, req.count);
       res.offset = ski.first;
       res.signed_key_images.resize(ski.second.size());
       for (size_t n = 0; n < ski.second.size(); ++n)
@@ -32,8 +32,7 @@ void wallet_accessor_test::set_account(tools::wallet2 * wallet, cryptonote::acco
 void wallet_accessor_test::process_parsed_blocks(tools::wallet2 * wallet, uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<tools::wallet2::parsed_block> &parsed_blocks, uint64_t& blocks_added)
 {
   if (wallet != nullptr) {
-    auto output_tracker_cache = wallet->create_output_tracker_cache();
-    wallet->process_parsed_blocks(start_height, blocks, parsed_blocks, blocks_added, output_tracker_cache);
+    wallet->process_parsed_blocks(start_height, blocks, parsed_blocks, blocks_added);
   }
 }
 
@@ -0,0 +1,747 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Sync profiling: many simulated peers connect to a running daemon over p2p, advertise and
+// serve a chain read from an LMDB database, then fluff the txs of the blocks above the
+// served height and time how long the daemon takes to relay them to the other peers.
+//
+// The daemon should start from an empty data dir and accept all the connections from one
+// address, e.g.:
+//   salviumd --data-dir /tmp/sync --out-peers 0 --in-peers 1000 --max-connections-per-ip 1000
+//   net_load_tests_sync --db-path ~/.salvium/lmdb --peers 200 --sync-height 100000 --daemon-pid <pid>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "include_base_utils.h"
+#include "misc_log_ex.h"
+#include "net/levin_protocol_handler_async.h"
+#include "net/abstract_tcp_server2.h"
+#include "storages/levin_abstract_invoke2.h"
+#include "common/command_line.h"
+#include "common/util.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "blockchain_db/blockchain_db.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "p2p/p2p_protocol_defs.h"
+#include "cryptonote_config.h"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  const command_line::arg_descriptor<std::string> arg_db_path           = {"db-path", "LMDB database the simulated peers serve blocks from, opened read only", ""};
+  const command_line::arg_descriptor<std::string> arg_daemon_host       = {"daemon-host", "Address of the daemon's p2p port", "127.0.0.1"};
+  const command_line::arg_descriptor<uint16_t>    arg_daemon_port       = {"daemon-port", "Daemon's p2p port, 0 for the network's default", 0};
+  const command_line::arg_descriptor<bool>        arg_testnet           = {"testnet", "Use the testnet network id"};
+  const command_line::arg_descriptor<bool>        arg_stagenet          = {"stagenet", "Use the stagenet network id"};
+  const command_line::arg_descriptor<size_t>      arg_peers             = {"peers", "Number of simulated peers", 200};
+  const command_line::arg_descriptor<size_t>      arg_threads           = {"threads", "Network threads for the simulated peers, 0 for one per core", 0};
+  const command_line::arg_descriptor<uint64_t>    arg_sync_height       = {"sync-height", "Chain height the peers advertise and serve, 0 for the whole database", 0};
+  const command_line::arg_descriptor<uint32_t>    arg_latency_ms        = {"latency-ms", "One way latency added to everything a peer sends", 50};
+  const command_line::arg_descriptor<uint32_t>    arg_bandwidth_kbps    = {"bandwidth-kbps", "Upload bandwidth of each peer in kB/s, 0 for unlimited", 0};
+  const command_line::arg_descriptor<double>      arg_drop_rate         = {"drop-rate", "Fraction of block requests a peer silently ignores", 0.0};
+  const command_line::arg_descriptor<size_t>      arg_relay_txs         = {"relay-txs", "Txs from above the sync height to fluff once synced", 100};
+  const command_line::arg_descriptor<uint32_t>    arg_relay_interval_ms = {"relay-interval-ms", "Time between two fluffed txs", 100};
+  const command_line::arg_descriptor<uint32_t>    arg_daemon_pid        = {"daemon-pid", "Daemon's pid, to report its CPU time (linux only)", 0};
+  const command_line::arg_descriptor<uint32_t>    arg_timeout_s         = {"timeout-s", "Give up syncing after this long", 3600};
+
+  const uint32_t CONNECTION_TIMEOUT = 10000;
+  const uint32_t RELAY_WAIT_MS = 30000;
+
+  typedef nodetool::COMMAND_HANDSHAKE_T<cryptonote::CORE_SYNC_DATA> COMMAND_HANDSHAKE;
+  typedef nodetool::COMMAND_TIMED_SYNC_T<cryptonote::CORE_SYNC_DATA> COMMAND_TIMED_SYNC;
+
+  struct sync_connection_context : epee::net_utils::connection_context_base
+  {
+    sync_connection_context(): epee::net_utils::connection_context_base(boost::uuids::nil_uuid(), {}, false, false) {}
+    static constexpr int handshake_command() noexcept { return COMMAND_HANDSHAKE::ID; }
+    static constexpr bool handshake_complete() noexcept { return true; }
+    size_t get_max_bytes(int command) const { return LEVIN_DEFAULT_MAX_PACKET_SIZE; }
+  };
+
+  typedef epee::levin::async_protocol_handler<sync_connection_context> sync_levin_protocol_handler;
+  typedef epee::net_utils::boosted_tcp_server<sync_levin_protocol_handler> sync_tcp_server;
+
+  struct sync_options
+  {
+    uint32_t latency_ms;
+    uint32_t bandwidth_kbps;
+    double drop_rate;
+  };
+
+  /// the chain the peers share, cut at the advertised height
+  class chain_source
+  {
+  public:
+    chain_source(const cryptonote::BlockchainDB &db, uint64_t height): m_db(db), m_height(height) {}
+
+    uint64_t height() const { return m_height; }
+
+    void fill_sync_data(cryptonote::CORE_SYNC_DATA &data) const
+    {
+      const cryptonote::difficulty_type cumulative_difficulty = m_db.get_block_cumulative_difficulty(m_height - 1);
+      data.current_height = m_height;
+      data.cumulative_difficulty = (cumulative_difficulty & 0xffffffffffffffff).convert_to<uint64_t>();
+      data.cumulative_difficulty_top64 = ((cumulative_difficulty >> 64) & 0xffffffffffffffff).convert_to<uint64_t>();
+      data.top_id = m_db.get_block_hash_from_height(m_height - 1);
+      data.top_version = m_db.get_hard_fork_version(m_height - 1);
+      data.pruning_seed = 0;
+    }
+
+    bool fill_chain_entry(const cryptonote::NOTIFY_REQUEST_CHAIN::request &req, cryptonote::NOTIFY_RESPONSE_CHAIN_ENTRY::request &rsp) const
+    {
+      // the daemon's list is newest first and ends with genesis, so the first known one is the split point
+      uint64_t start_height = m_height;
+      for (const crypto::hash &id: req.block_ids)
+      {
+        uint64_t height;
+        if (m_db.block_exists(id, &height) && height < m_height)
+        {
+          start_height = height;
+          break;
+        }
+      }
+      if (start_height == m_height)
+        return false;
+
+      const size_t count = std::min<uint64_t>(m_height - start_height, BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT);
+      const cryptonote::difficulty_type cumulative_difficulty = m_db.get_block_cumulative_difficulty(m_height - 1);
+      rsp.start_height = start_height;
+      rsp.total_height = m_height;
+      rsp.cumulative_difficulty = (cumulative_difficulty & 0xffffffffffffffff).convert_to<uint64_t>();
+      rsp.cumulative_difficulty_top64 = ((cumulative_difficulty >> 64) & 0xffffffffffffffff).convert_to<uint64_t>();
+      rsp.m_block_ids.reserve(count);
+      for (uint64_t height = start_height; height < start_height + count; ++height)
+        rsp.m_block_ids.push_back(m_db.get_block_hash_from_height(height));
+      rsp.m_block_weights = m_db.get_block_weights(start_height, count);
+      return true;
+    }
+
+    /// returns the number of blocks served
+    size_t fill_objects(const cryptonote::NOTIFY_REQUEST_GET_OBJECTS::request &req, cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request &rsp) const
+    {
+      rsp.current_blockchain_height = m_height;
+      rsp.blocks.reserve(req.blocks.size());
+      for (const crypto::hash &id: req.blocks)
+      {
+        uint64_t height;
+        cryptonote::block b;
+        cryptonote::block_complete_entry entry;
+        if (!m_db.block_exists(id, &height) || height >= m_height)
+        {
+          rsp.missed_ids.push_back(id);
+          continue;
+        }
+        entry.block = m_db.get_block_blob_from_height(height);
+        if (!cryptonote::parse_and_validate_block_from_blob(entry.block, b))
+        {
+          rsp.missed_ids.push_back(id);
+          continue;
+        }
+        entry.block_weight = m_db.get_block_weight(height);
+        entry.pruned = req.prune;
+        entry.txs.reserve(b.tx_hashes.size());
+        for (const crypto::hash &txid: b.tx_hashes)
+        {
+          cryptonote::tx_blob_entry tx;
+          const bool r = req.prune ?
+            m_db.get_pruned_tx_blob(txid, tx.blob) && m_db.get_prunable_tx_hash(txid, tx.prunable_hash) :
+            m_db.get_tx_blob(txid, tx.blob);
+          if (!r)
+            throw std::runtime_error("Tx " + epee::string_tools::pod_to_hex(txid) + " not found in the database");
+          entry.txs.push_back(std::move(tx));
+        }
+        rsp.blocks.push_back(std::move(entry));
+      }
+      return rsp.blocks.size();
+    }
+
+    /// txs of the blocks above the served height, which the synced daemon has never seen
+    std::vector<cryptonote::blobdata> get_relay_txs(size_t count) const
+    {
+      std::vector<cryptonote::blobdata> txs;
+      const uint64_t db_height = m_db.height();
+      for (uint64_t height = m_height; height < db_height && txs.size() < count; ++height)
+      {
+        const cryptonote::block b = m_db.get_block_from_height(height);
+        for (const crypto::hash &txid: b.tx_hashes)
+        {
+          if (txs.size() >= count)
+            break;
+          cryptonote::blobdata blob;
+          if (m_db.get_tx_blob(txid, blob))
+            txs.push_back(std::move(blob));
+        }
+      }
+      return txs;
+    }
+
+  private:
+    const cryptonote::BlockchainDB &m_db;
+    const uint64_t m_height;
+  };
+
+  struct peer_stats
+  {
+    bool handshaked = false;
+    uint64_t blocks_served = 0;
+    uint64_t bytes_served = 0;
+    uint64_t requests = 0;
+    uint64_t dropped = 0;
+    std::chrono::steady_clock::time_point link_free;
+  };
+
+  struct relayed_tx
+  {
+    boost::uuids::uuid sender;
+    std::chrono::steady_clock::time_point sent;
+    std::chrono::steady_clock::time_point first_seen;
+    std::chrono::steady_clock::time_point last_seen;
+    size_t seen = 0;
+  };
+
+  class sync_commands_handler : public epee::levin::levin_commands_handler<sync_connection_context>
+  {
+  public:
+    sync_commands_handler(sync_tcp_server &tcp_server, const chain_source &chain, const sync_options &options)
+      : m_tcp_server(tcp_server)
+      , m_chain(chain)
+      , m_options(options)
+      , m_daemon_height(0)
+      , m_failed(0)
+    {
+    }
+
+    CHAIN_LEVIN_INVOKE_MAP2(sync_connection_context);
+    CHAIN_LEVIN_NOTIFY_MAP2(sync_connection_context);
+
+    BEGIN_INVOKE_MAP2(sync_commands_handler)
+      HANDLE_INVOKE_T2(COMMAND_TIMED_SYNC, &sync_commands_handler::handle_timed_sync)
+      HANDLE_INVOKE_T2(nodetool::COMMAND_PING, &sync_commands_handler::handle_ping)
+      HANDLE_INVOKE_T2(nodetool::COMMAND_REQUEST_SUPPORT_FLAGS, &sync_commands_handler::handle_support_flags)
+      HANDLE_NOTIFY_T2(cryptonote::NOTIFY_REQUEST_CHAIN, &sync_commands_handler::handle_request_chain)
+      HANDLE_NOTIFY_T2(cryptonote::NOTIFY_REQUEST_GET_OBJECTS, &sync_commands_handler::handle_request_get_objects)
+      HANDLE_NOTIFY_T2(cryptonote::NOTIFY_NEW_TRANSACTIONS, &sync_commands_handler::handle_new_transactions)
+      HANDLE_NOTIFY_T2(cryptonote::NOTIFY_NEW_BLOCK, &sync_commands_handler::handle_ignored<cryptonote::NOTIFY_NEW_BLOCK>)
+      HANDLE_NOTIFY_T2(cryptonote::NOTIFY_NEW_FLUFFY_BLOCK, &sync_commands_handler::handle_ignored<cryptonote::NOTIFY_NEW_FLUFFY_BLOCK>)
+      HANDLE_NOTIFY_T2(cryptonote::NOTIFY_GET_TXPOOL_COMPLEMENT, &sync_commands_handler::handle_ignored<cryptonote::NOTIFY_GET_TXPOOL_COMPLEMENT>)
+    END_INVOKE_MAP2()
+
+    virtual void callback(sync_connection_context& context) {}
+    virtual void on_connection_new(sync_connection_context& context) {}
+
+    virtual void on_connection_close(sync_connection_context& context)
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      m_peers[context.m_connection_id].handshaked = false;
+    }
+
+    void handshake(const sync_connection_context &context, const boost::uuids::uuid &network_id)
+    {
+      COMMAND_HANDSHAKE::request req;
+      req.node_data.network_id = network_id;
+      req.node_data.peer_id = crypto::rand<uint64_t>();
+      req.node_data.my_port = 0; // so the daemon doesn't try to ping us back
+      req.node_data.rpc_port = 0;
+      req.node_data.rpc_credits_per_hash = 0;
+      req.node_data.support_flags = P2P_SUPPORT_FLAGS;
+      m_chain.fill_sync_data(req.payload_data);
+
+      const bool r = epee::net_utils::async_invoke_remote_command2<COMMAND_HANDSHAKE::response>(context, COMMAND_HANDSHAKE::ID, req,
+        m_tcp_server.get_config_object(), [this](int code, const COMMAND_HANDSHAKE::response &rsp, const sync_connection_context &ctx) {
+          if (code <= 0)
+          {
+            LOG_PRINT_L1("Handshake failed, code " << code);
+            ++m_failed;
+            return;
+          }
+          note_daemon_height(rsp.payload_data.current_height);
+          boost::unique_lock<boost::mutex> lock(m_lock);
+          m_peers[ctx.m_connection_id].handshaked = true;
+        }, P2P_DEFAULT_HANDSHAKE_INVOKE_TIMEOUT);
+      if (!r)
+        ++m_failed;
+    }
+
+    /// asks one peer's connection for the daemon's height, the answer lands in daemon_height()
+    void poll_daemon_height()
+    {
+      m_tcp_server.get_config_object().foreach_connection([this](sync_connection_context &ctx) {
+        {
+          boost::unique_lock<boost::mutex> lock(m_lock);
+          if (!m_peers[ctx.m_connection_id].handshaked)
+            return true;
+        }
+        COMMAND_TIMED_SYNC::request req;
+        m_chain.fill_sync_data(req.payload_data);
+        epee::net_utils::async_invoke_remote_command2<COMMAND_TIMED_SYNC::response>(ctx, COMMAND_TIMED_SYNC::ID, req,
+          m_tcp_server.get_config_object(), [this](int code, const COMMAND_TIMED_SYNC::response &rsp, const sync_connection_context&) {
+            if (code > 0)
+              note_daemon_height(rsp.payload_data.current_height);
+          });
+        return false;
+      });
+    }
+
+    /// fluffs a tx from one of the handshaked peers, picked round robin
+    bool relay(const cryptonote::blobdata &blob, size_t n)
+    {
+      std::vector<boost::uuids::uuid> peers = handshaked_peers();
+      if (peers.empty())
+        return false;
+      const boost::uuids::uuid &sender = peers[n % peers.size()];
+
+      cryptonote::NOTIFY_NEW_TRANSACTIONS::request req;
+      req.txs.push_back(blob);
+      req.dandelionpp_fluff = true;
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        relayed_tx &tx = m_relayed[crypto::cn_fast_hash(blob.data(), blob.size())];
+        tx.sender = sender;
+        tx.sent = std::chrono::steady_clock::now();
+      }
+      send_delayed(sender, cryptonote::NOTIFY_NEW_TRANSACTIONS::ID, req);
+      return true;
+    }
+
+    std::vector<boost::uuids::uuid> handshaked_peers() const
+    {
+      std::vector<boost::uuids::uuid> peers;
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      for (const auto &p: m_peers)
+        if (p.second.handshaked)
+          peers.push_back(p.first);
+      return peers;
+    }
+
+    std::map<boost::uuids::uuid, peer_stats> get_peer_stats() const
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      return m_peers;
+    }
+
+    std::unordered_map<crypto::hash, relayed_tx> get_relayed() const
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      return m_relayed;
+    }
+
+    uint64_t daemon_height() const { return m_daemon_height; }
+    size_t failed() const { return m_failed; }
+
+  private:
+    int handle_timed_sync(int command, const COMMAND_TIMED_SYNC::request &req, COMMAND_TIMED_SYNC::response &rsp, sync_connection_context &context)
+    {
+      note_daemon_height(req.payload_data.current_height);
+      m_chain.fill_sync_data(rsp.payload_data);
+      return 1;
+    }
+
+    int handle_ping(int command, const nodetool::COMMAND_PING::request &req, nodetool::COMMAND_PING::response &rsp, sync_connection_context &context)
+    {
+      rsp.status = PING_OK_RESPONSE_STATUS_TEXT;
+      rsp.peer_id = 0;
+      return 1;
+    }
+
+    int handle_support_flags(int command, const nodetool::COMMAND_REQUEST_SUPPORT_FLAGS::request &req, nodetool::COMMAND_REQUEST_SUPPORT_FLAGS::response &rsp, sync_connection_context &context)
+    {
+      rsp.support_flags = P2P_SUPPORT_FLAGS;
+      return 1;
+    }
+
+    int handle_request_chain(int command, const cryptonote::NOTIFY_REQUEST_CHAIN::request &req, sync_connection_context &context)
+    {
+      cryptonote::NOTIFY_RESPONSE_CHAIN_ENTRY::request rsp;
+      if (!m_chain.fill_chain_entry(req, rsp))
+      {
+        LOG_PRINT_L0("The daemon's chain doesn't share a block with the database");
+        return 1;
+      }
+      send_delayed(context.m_connection_id, cryptonote::NOTIFY_RESPONSE_CHAIN_ENTRY::ID, rsp);
+      return 1;
+    }
+
+    int handle_request_get_objects(int command, const cryptonote::NOTIFY_REQUEST_GET_OBJECTS::request &req, sync_connection_context &context)
+    {
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        peer_stats &peer = m_peers[context.m_connection_id];
+        ++peer.requests;
+        if (m_options.drop_rate > 0 && crypto::rand<uint32_t>() < m_options.drop_rate * std::numeric_limits<uint32_t>::max())
+        {
+          ++peer.dropped;
+          return 1;
+        }
+      }
+
+      cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
+      const size_t n_blocks = m_chain.fill_objects(req, rsp);
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        m_peers[context.m_connection_id].blocks_served += n_blocks;
+      }
+      send_delayed(context.m_connection_id, cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::ID, rsp);
+      return 1;
+    }
+
+    int handle_new_transactions(int command, const cryptonote::NOTIFY_NEW_TRANSACTIONS::request &req, sync_connection_context &context)
+    {
+      const auto now = std::chrono::steady_clock::now();
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      for (const cryptonote::blobdata &blob: req.txs)
+      {
+        auto it = m_relayed.find(crypto::cn_fast_hash(blob.data(), blob.size()));
+        if (it == m_relayed.end() || it->second.sender == context.m_connection_id)
+          continue;
+        if (it->second.seen++ == 0)
+          it->second.first_seen = now;
+        it->second.last_seen = now;
+      }
+      return 1;
+    }
+
+    template<typename t_notify>
+    int handle_ignored(int command, const typename t_notify::request &req, sync_connection_context &context)
+    {
+      return 1;
+    }
+
+    void note_daemon_height(uint64_t height)
+    {
+      uint64_t current = m_daemon_height;
+      while (height > current && !m_daemon_height.compare_exchange_weak(current, height));
+    }
+
+    /// sends once the peer's simulated uplink has carried the message, plus the latency
+    template<typename t_message>
+    void send_delayed(const boost::uuids::uuid &conn_id, int command, const t_message &msg)
+    {
+      epee::serialization::portable_storage stg;
+      msg.store(stg);
+      epee::levin::message_writer out;
+      stg.store_to_binary(out.buffer);
+      const size_t bytes = out.payload_size();
+      auto message = std::make_shared<epee::byte_slice>(out.finalize_notify(command));
+
+      std::chrono::steady_clock::time_point when;
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        peer_stats &peer = m_peers[conn_id];
+        when = std::max(std::chrono::steady_clock::now(), peer.link_free);
+        if (m_options.bandwidth_kbps)
+          when += std::chrono::microseconds(bytes * 1000000 / (m_options.bandwidth_kbps * 1024ull));
+        peer.link_free = when;
+        peer.bytes_served += bytes;
+      }
+      when += std::chrono::milliseconds(m_options.latency_ms);
+
+      auto timer = std::make_shared<boost::asio::steady_timer>(m_tcp_server.get_io_context(), when);
+      timer->async_wait([this, timer, conn_id, message](const boost::system::error_code &ec) {
+        if (!ec)
+          m_tcp_server.get_config_object().send(std::move(*message), conn_id);
+      });
+    }
+
+    sync_tcp_server &m_tcp_server;
+    const chain_source &m_chain;
+    const sync_options m_options;
+    std::atomic<uint64_t> m_daemon_height;
+    std::atomic<size_t> m_failed;
+    mutable boost::mutex m_lock;
+    std::map<boost::uuids::uuid, peer_stats> m_peers;
+    std::unordered_map<crypto::hash, relayed_tx> m_relayed;
+  };
+
+  /// user + system CPU seconds of a process, negative if unavailable
+  double get_cpu_seconds(uint32_t pid)
+  {
+#ifdef __linux__
+    std::ifstream stat("/proc/" + (pid ? std::to_string(pid) : std::string("self")) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line))
+      return -1;
+    // the command name may contain spaces, the fields we want come after its closing paren
+    const size_t paren = line.rfind(')');
+    if (paren == std::string::npos)
+      return -1;
+    std::istringstream fields(line.substr(paren + 2));
+    std::string field;
+    unsigned long long utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; ++i)
+    {
+      if (i == 14)
+        utime = std::stoull(field);
+      else if (i == 15)
+        stime = std::stoull(field);
+    }
+    return (utime + stime) / (double)sysconf(_SC_CLK_TCK);
+#else
+    return -1;
+#endif
+  }
+
+  double to_ms(std::chrono::steady_clock::duration d)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+  }
+
+  double percentile(std::vector<double> &v, double p)
+  {
+    if (v.empty())
+      return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min<size_t>(v.size() - 1, v.size() * p)];
+  }
+}
+
+int main(int argc, char** argv)
+{
+  TRY_ENTRY();
+  tools::on_startup();
+  epee::string_tools::set_module_name_and_folder(argv[0]);
+  mlog_configure(mlog_get_default_log_path("net_load_tests_sync.log"), true);
+
+  po::options_description desc_options("Allowed options");
+  command_line::add_arg(desc_options, command_line::arg_help);
+  command_line::add_arg(desc_options, arg_db_path);
+  command_line::add_arg(desc_options, arg_daemon_host);
+  command_line::add_arg(desc_options, arg_daemon_port);
+  command_line::add_arg(desc_options, arg_testnet);
+  command_line::add_arg(desc_options, arg_stagenet);
+  command_line::add_arg(desc_options, arg_peers);
+  command_line::add_arg(desc_options, arg_threads);
+  command_line::add_arg(desc_options, arg_sync_height);
+  command_line::add_arg(desc_options, arg_latency_ms);
+  command_line::add_arg(desc_options, arg_bandwidth_kbps);
+  command_line::add_arg(desc_options, arg_drop_rate);
+  command_line::add_arg(desc_options, arg_relay_txs);
+  command_line::add_arg(desc_options, arg_relay_interval_ms);
+  command_line::add_arg(desc_options, arg_daemon_pid);
+  command_line::add_arg(desc_options, arg_timeout_s);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_options, [&]()
+  {
+    po::store(po::parse_command_line(argc, argv, desc_options), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (!r)
+    return 1;
+
+  if (command_line::get_arg(vm, command_line::arg_help) || command_line::get_arg(vm, arg_db_path).empty())
+  {
+    std::cout << desc_options << std::endl;
+    return 0;
+  }
+
+  const cryptonote::network_type nettype = command_line::get_arg(vm, arg_testnet) ? cryptonote::TESTNET :
+    command_line::get_arg(vm, arg_stagenet) ? cryptonote::STAGENET : cryptonote::MAINNET;
+  const cryptonote::config_t &config = cryptonote::get_config(nettype);
+  const uint16_t daemon_port = command_line::get_arg(vm, arg_daemon_port) ? command_line::get_arg(vm, arg_daemon_port) : config.P2P_DEFAULT_PORT;
+  const std::string daemon_host = command_line::get_arg(vm, arg_daemon_host);
+  const size_t n_peers = command_line::get_arg(vm, arg_peers);
+  const uint32_t daemon_pid = command_line::get_arg(vm, arg_daemon_pid);
+
+  std::unique_ptr<cryptonote::BlockchainDB> db(cryptonote::new_db());
+  try
+  {
+    db->open(command_line::get_arg(vm, arg_db_path), DBF_RDONLY);
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to open " << command_line::get_arg(vm, arg_db_path) << ": " << e.what());
+    return 1;
+  }
+  uint64_t sync_height = command_line::get_arg(vm, arg_sync_height);
+  if (sync_height == 0 || sync_height > db->height())
+    sync_height = db->height();
+  if (sync_height < 2)
+  {
+    MERROR("The database has no blocks to serve");
+    return 1;
+  }
+  const chain_source chain(*db, sync_height);
+
+  sync_options options;
+  options.latency_ms = command_line::get_arg(vm, arg_latency_ms);
+  options.bandwidth_kbps = command_line::get_arg(vm, arg_bandwidth_kbps);
+  options.drop_rate = command_line::get_arg(vm, arg_drop_rate);
+
+  size_t thread_count = command_line::get_arg(vm, arg_threads);
+  if (thread_count == 0)
+    thread_count = std::max(2u, boost::thread::hardware_concurrency());
+
+  sync_tcp_server tcp_server(epee::net_utils::e_connection_type_P2P);
+  sync_commands_handler *commands_handler = new sync_commands_handler(tcp_server, chain, options);
+  tcp_server.get_config_object().set_handler(commands_handler, [](epee::levin::levin_commands_handler<sync_connection_context> *handler) { delete handler; });
+  tcp_server.get_config_object().m_invoke_timeout = CONNECTION_TIMEOUT;
+  if (!tcp_server.init_server(0, "127.0.0.1"))
+    return 1;
+  if (!tcp_server.run_server(thread_count, false))
+    return 1;
+
+  std::cout << "Connecting " << n_peers << " peers to " << daemon_host << ":" << daemon_port << ", serving " << sync_height << " blocks" << std::endl;
+  const double daemon_cpu_start = get_cpu_seconds(daemon_pid);
+  const double self_cpu_start = get_cpu_seconds(0);
+  const auto start = std::chrono::steady_clock::now();
+
+  std::atomic<size_t> connect_failed{0};
+  for (size_t i = 0; i < n_peers; ++i)
+  {
+    tcp_server.connect_async(daemon_host, std::to_string(daemon_port), CONNECTION_TIMEOUT,
+      [&, commands_handler](const sync_connection_context &context, const boost::system::error_code &ec) {
+        if (ec)
+          ++connect_failed;
+        else
+          commands_handler->handshake(context, config.NETWORK_ID);
+      });
+  }
+
+  for (size_t i = 0; i < CONNECTION_TIMEOUT / 100; ++i)
+  {
+    if (commands_handler->handshaked_peers().size() + connect_failed + commands_handler->failed() >= n_peers)
+      break;
+    epee::misc_utils::sleep_no_w(100);
+  }
+  const size_t n_connected = commands_handler->handshaked_peers().size();
+  std::cout << n_connected << " peers handshaked, " << connect_failed << " failed to connect, "
+    << commands_handler->failed() << " failed to handshake" << std::endl;
+  if (n_connected == 0)
+  {
+    tcp_server.send_stop_signal();
+    return 1;
+  }
+
+  // sync phase, the daemon's height comes back in the answers to our timed syncs
+  const uint64_t initial_height = commands_handler->daemon_height();
+  const auto sync_start = std::chrono::steady_clock::now();
+  const auto deadline = sync_start + std::chrono::seconds(command_line::get_arg(vm, arg_timeout_s));
+  auto last_report = sync_start;
+  uint64_t last_height = initial_height;
+  while (commands_handler->daemon_height() < sync_height && std::chrono::steady_clock::now() < deadline)
+  {
+    commands_handler->poll_daemon_height();
+    epee::misc_utils::sleep_no_w(1000);
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_report >= std::chrono::seconds(10))
+    {
+      const uint64_t height = commands_handler->daemon_height();
+      std::cout << "height " << height << "/" << sync_height << ", "
+        << (height - last_height) * 1000.0 / to_ms(now - last_report) << " blocks/s, "
+        << commands_handler->handshaked_peers().size() << " peers" << std::endl;
+      last_report = now;
+      last_height = height;
+    }
+  }
+  const auto sync_end = std::chrono::steady_clock::now();
+  const uint64_t synced_height = commands_handler->daemon_height();
+  const double daemon_cpu_sync = get_cpu_seconds(daemon_pid);
+
+  // relay phase, only meaningful once the daemon has the chain the txs spend from
+  std::vector<double> first_ms, last_ms;
+  size_t n_relayed = 0, n_unseen = 0;
+  if (synced_height >= sync_height)
+  {
+    const std::vector<cryptonote::blobdata> txs = chain.get_relay_txs(command_line::get_arg(vm, arg_relay_txs));
+    const uint32_t relay_interval_ms = command_line::get_arg(vm, arg_relay_interval_ms);
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+      if (commands_handler->relay(txs[i], i))
+        ++n_relayed;
+      epee::misc_utils::sleep_no_w(relay_interval_ms);
+    }
+    epee::misc_utils::sleep_no_w(RELAY_WAIT_MS);
+    for (const auto &tx: commands_handler->get_relayed())
+    {
+      if (tx.second.seen == 0)
+      {
+        ++n_unseen;
+        continue;
+      }
+      first_ms.push_back(to_ms(tx.second.first_seen - tx.second.sent));
+      last_ms.push_back(to_ms(tx.second.last_seen - tx.second.sent));
+    }
+  }
+  const double daemon_cpu_end = get_cpu_seconds(daemon_pid);
+  const double self_cpu_end = get_cpu_seconds(0);
+
+  uint64_t blocks_served = 0, bytes_served = 0, requests = 0, dropped = 0;
+  for (const auto &peer: commands_handler->get_peer_stats())
+  {
+    blocks_served += peer.second.blocks_served;
+    bytes_served += peer.second.bytes_served;
+    requests += peer.second.requests;
+    dropped += peer.second.dropped;
+  }
+
+  const double sync_s = to_ms(sync_end - sync_start) / 1000;
+  std::cout << std::endl << "Sync: " << initial_height << " -> " << synced_height << " of " << sync_height
+    << (synced_height >= sync_height ? "" : " (timed out)") << " in " << sync_s << " s, "
+    << (synced_height - initial_height) / std::max(sync_s, 0.001) << " blocks/s" << std::endl;
+  std::cout << "Served: " << blocks_served << " blocks in " << requests << " requests (" << dropped << " dropped), "
+    << bytes_served / (1024.0 * 1024.0) << " MB" << std::endl;
+  if (n_relayed)
+  {
+    std::cout << "Relay: " << n_relayed << " txs, " << n_unseen << " never relayed back" << std::endl;
+    std::cout << "  first peer: median " << percentile(first_ms, 0.5) << " ms, p90 " << percentile(first_ms, 0.9) << " ms" << std::endl;
+    std::cout << "  last peer:  median " << percentile(last_ms, 0.5) << " ms, p90 " << percentile(last_ms, 0.9) << " ms" << std::endl;
+  }
+  if (daemon_cpu_start >= 0 && daemon_cpu_end >= 0)
+  {
+    std::cout << "Daemon CPU: " << daemon_cpu_sync - daemon_cpu_start << " s syncing, " << daemon_cpu_end - daemon_cpu_sync << " s relaying, "
+      << (daemon_cpu_end - daemon_cpu_start) * 1000 / n_connected << " ms per connection" << std::endl;
+  }
+  if (self_cpu_start >= 0 && self_cpu_end >= 0)
+    std::cout << "Peers CPU: " << self_cpu_end - self_cpu_start << " s" << std::endl;
+  std::cout << "Total time: " << to_ms(std::chrono::steady_clock::now() - start) / 1000 << " s" << std::endl;
+
+  tcp_server.send_stop_signal();
+  tcp_server.timed_wait_server_stop(CONNECTION_TIMEOUT);
+  db->close();
+  return synced_height >= sync_height ? 0 : 2;
+  CATCH_ENTRY_L0("main", 1);
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include "carrot_core/enote_utils.h"
+#include "carrot_core/sparc.h"
+#include "crypto/crypto.h"
+#include "crypto/generators.h"
+#include "ringct/rctOps.h"
+
+enum carrot_op
+{
+  op_make_carrot_uncontextualized_shared_key_receiver,
+  op_make_carrot_view_tag,
+  op_make_carrot_sender_receiver_secret,
+  op_make_carrot_onetime_address_extension_g,
+  op_make_carrot_onetime_address_extension_t,
+  op_make_carrot_amount_blinding_factor,
+  op_make_carrot_anchor_encryption_mask,
+  op_make_carrot_amount_encryption_mask,
+  carrot_ops_fast,
+
+  op_make_sparc_spend_authority_proof,
+  op_verify_sparc_spend_authority_proof,
+};
+
+template<carrot_op op>
+class test_carrot_ops
+{
+public:
+  static const size_t loop_count = op < carrot_ops_fast ? 100000 : 1000;
+
+  bool init()
+  {
+    m_k_view = rct::rct2sk(rct::skGen());
+    m_enote_ephemeral_pubkey = carrot::gen_x25519_pubkey();
+    if (!carrot::make_carrot_uncontextualized_shared_key_receiver(m_k_view, m_enote_ephemeral_pubkey, m_s_sender_receiver_unctx))
+      return false;
+    m_input_context = carrot::make_carrot_input_context(rct::rct2ki(rct::pkGen()));
+    m_onetime_address = rct::rct2pk(rct::pkGen());
+    m_address_spend_pubkey = rct::rct2pk(rct::pkGen());
+    m_amount_commitment = rct::pkGen();
+    carrot::make_carrot_sender_receiver_secret(m_s_sender_receiver_unctx.data,
+      m_enote_ephemeral_pubkey,
+      m_input_context,
+      m_s_sender_receiver);
+
+    // K_o = x G + y T
+    m_x = rct::skGen();
+    m_y = rct::skGen();
+    m_K_o = rct::addKeys(rct::scalarmultBase(m_x), rct::scalarmultKey(rct::pk2rct(crypto::get_T()), m_y));
+    carrot::make_sparc_spend_authority_proof(m_x, m_y, m_K_o, m_proof);
+    return carrot::verify_sparc_spend_authority_proof(m_proof, m_K_o);
+  }
+
+  bool test()
+  {
+    mx25519_pubkey s_sender_receiver_unctx;
+    carrot::view_tag_t view_tag;
+    crypto::hash s_sender_receiver;
+    crypto::secret_key sk;
+    carrot::encrypted_janus_anchor_t anchor_mask;
+    carrot::encrypted_amount_t amount_mask;
+    rct::zk_proof proof;
+    switch (op)
+    {
+      case op_make_carrot_uncontextualized_shared_key_receiver: return carrot::make_carrot_uncontextualized_shared_key_receiver(m_k_view, m_enote_ephemeral_pubkey, s_sender_receiver_unctx);
+      case op_make_carrot_view_tag: carrot::make_carrot_view_tag(m_s_sender_receiver_unctx.data, m_input_context, m_onetime_address, view_tag); break;
+      case op_make_carrot_sender_receiver_secret: carrot::make_carrot_sender_receiver_secret(m_s_sender_receiver_unctx.data, m_enote_ephemeral_pubkey, m_input_context, s_sender_receiver); break;
+      case op_make_carrot_onetime_address_extension_g: carrot::make_carrot_onetime_address_extension_g(m_s_sender_receiver, m_amount_commitment, sk); break;
+      case op_make_carrot_onetime_address_extension_t: carrot::make_carrot_onetime_address_extension_t(m_s_sender_receiver, m_amount_commitment, sk); break;
+      case op_make_carrot_amount_blinding_factor: carrot::make_carrot_amount_blinding_factor(m_s_sender_receiver, 1000, m_address_spend_pubkey, carrot::CarrotEnoteType::PAYMENT, sk); break;
+      case op_make_carrot_anchor_encryption_mask: carrot::make_carrot_anchor_encryption_mask(m_s_sender_receiver, m_onetime_address, anchor_mask); break;
+      case op_make_carrot_amount_encryption_mask: carrot::make_carrot_amount_encryption_mask(m_s_sender_receiver, m_onetime_address, amount_mask); break;
+      case op_make_sparc_spend_authority_proof: carrot::make_sparc_spend_authority_proof(m_x, m_y, m_K_o, proof); break;
+      case op_verify_sparc_spend_authority_proof: return carrot::verify_sparc_spend_authority_proof(m_proof, m_K_o);
+      default: return false;
+    }
+    return true;
+  }
+
+private:
+  crypto::secret_key m_k_view;
+  mx25519_pubkey m_enote_ephemeral_pubkey;
+  mx25519_pubkey m_s_sender_receiver_unctx;
+  carrot::input_context_t m_input_context;
+  crypto::public_key m_onetime_address;
+  crypto::public_key m_address_spend_pubkey;
+  rct::key m_amount_commitment;
+  crypto::hash m_s_sender_receiver;
+  rct::key m_x, m_y, m_K_o;
+  rct::zk_proof m_proof;
+};
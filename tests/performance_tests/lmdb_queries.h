@@ -0,0 +1,224 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/thread/thread.hpp>
+
+#include "blockchain_db/blockchain_db.h"
+#include "crypto/crypto.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "ringct/rctOps.h"
+
+/// where the read-only database for the lmdb query tests lives, the tests are skipped if empty
+struct ParamsShuttleLMDB final : public ParamsShuttle
+{
+  std::string db_path;
+};
+
+enum class lmdb_query
+{
+  output_key,             // a ring: asset type output indices to output ids, then the output keys
+  output_id,              // just the asset type output index to output id part
+  key_image,              // has_key_image, half of them spent
+  cumulative_rct_outputs, // get_block_cumulative_rct_outputs at a ring's worth of heights
+  circulating_supply,
+  yield_tx_info,
+  tx_blob,
+};
+
+/// the database is opened once and shared by all the lmdb query tests of a run
+inline cryptonote::BlockchainDB *get_performance_test_db(const std::string &path)
+{
+  static std::unique_ptr<cryptonote::BlockchainDB> db;
+  if (!db && !path.empty())
+  {
+    db.reset(cryptonote::new_db());
+    try
+    {
+      db->open(path, DBF_RDONLY);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "Failed to open " << path << ": " << e.what() << std::endl;
+      db.reset();
+    }
+  }
+  return db.get();
+}
+
+/// each call runs queries_per_thread queries on each of n_threads fresh threads, so multi threaded
+/// runs also pay for setting up a read txn per thread, as a burst of RPC requests would
+template<lmdb_query query, size_t n_threads>
+class test_lmdb_query
+{
+public:
+  static const size_t loop_count = 100;
+  static const size_t queries_per_thread = 64;
+  static const size_t ring_size = 16;
+
+  bool init(const ParamsShuttleLMDB &params)
+  {
+    m_db = get_performance_test_db(params.db_path);
+    if (!m_db)
+      return false;
+    const uint64_t height = m_db->height();
+    if (height < 2)
+      return false;
+
+    for (const auto &supply: m_db->get_circulating_supply())
+    {
+      const uint64_t n_outputs = m_db->get_num_outputs_of_asset_type(supply.first);
+      if (n_outputs > 0)
+        m_asset_types.emplace_back(supply.first, n_outputs);
+    }
+    if (m_asset_types.empty())
+      return false;
+
+    // real txs and key images from random blocks, so lookups hit what a node is actually asked for
+    std::vector<crypto::hash> tx_hashes;
+    std::vector<crypto::key_image> key_images;
+    for (size_t i = 0; i < 256 && tx_hashes.size() < 1024; ++i)
+    {
+      const cryptonote::block b = m_db->get_block_from_height(crypto::rand_idx(height));
+      for (const crypto::hash &txid: b.tx_hashes)
+      {
+        tx_hashes.push_back(txid);
+        cryptonote::blobdata blob;
+        cryptonote::transaction tx;
+        if (!m_db->get_tx_blob(txid, blob) || !cryptonote::parse_and_validate_tx_base_from_blob(blob, tx))
+          continue;
+        for (const auto &in: tx.vin)
+          if (const cryptonote::txin_to_key *in_to_key = boost::get<cryptonote::txin_to_key>(&in))
+            key_images.push_back(in_to_key->k_image);
+      }
+      tx_hashes.push_back(cryptonote::get_transaction_hash(b.miner_tx));
+    }
+
+    m_work.resize(n_threads);
+    for (thread_work &work: m_work)
+    {
+      for (size_t i = 0; i < queries_per_thread; ++i)
+      {
+        const auto &asset_type = m_asset_types[crypto::rand_idx(m_asset_types.size())];
+        work.asset_types.push_back(asset_type.first);
+        work.indices.emplace_back();
+        work.heights.emplace_back();
+        for (size_t j = 0; j < ring_size; ++j)
+        {
+          work.indices.back().push_back(crypto::rand_idx(asset_type.second));
+          work.heights.back().push_back(crypto::rand_idx(height));
+        }
+        if (!key_images.empty() && i % 2 == 0)
+          work.key_images.push_back(key_images[crypto::rand_idx(key_images.size())]);
+        else
+          work.key_images.push_back(rct::rct2ki(rct::pkGen()));
+        work.tx_hashes.push_back(tx_hashes[crypto::rand_idx(tx_hashes.size())]);
+      }
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    if (n_threads == 1)
+      return run(m_work[0]);
+
+    std::atomic<bool> ok{true};
+    boost::thread_group threads;
+    for (thread_work &work: m_work)
+      threads.create_thread([this, &work, &ok]() { if (!run(work)) ok = false; });
+    threads.join_all();
+    return ok;
+  }
+
+private:
+  struct thread_work
+  {
+    std::vector<std::string> asset_types;
+    std::vector<std::vector<uint64_t>> indices;
+    std::vector<std::vector<uint64_t>> heights;
+    std::vector<crypto::key_image> key_images;
+    std::vector<crypto::hash> tx_hashes;
+  };
+
+  bool run(const thread_work &work) const
+  {
+    try
+    {
+      std::vector<uint64_t> output_ids;
+      std::vector<cryptonote::output_data_t> outputs;
+      const std::vector<uint64_t> amounts(ring_size, 0);
+      std::vector<cryptonote::yield_tx_info> ytis;
+      cryptonote::blobdata blob;
+      for (size_t i = 0; i < queries_per_thread; ++i)
+      {
+        switch (query)
+        {
+          case lmdb_query::output_key:
+            output_ids.clear();
+            outputs.clear();
+            m_db->get_output_id_from_asset_type_output_index(work.asset_types[i], work.indices[i], output_ids);
+            m_db->get_output_key(epee::to_span(amounts), output_ids, outputs);
+            break;
+          case lmdb_query::output_id:
+            output_ids.clear();
+            m_db->get_output_id_from_asset_type_output_index(work.asset_types[i], work.indices[i], output_ids);
+            break;
+          case lmdb_query::key_image:
+            m_db->has_key_image(work.key_images[i]);
+            break;
+          case lmdb_query::cumulative_rct_outputs:
+            m_db->get_block_cumulative_rct_outputs(work.heights[i], work.asset_types[i]);
+            break;
+          case lmdb_query::circulating_supply:
+            m_db->get_circulating_supply();
+            break;
+          case lmdb_query::yield_tx_info:
+            ytis.clear();
+            m_db->get_yield_tx_info(work.heights[i][0], ytis);
+            break;
+          case lmdb_query::tx_blob:
+            if (!m_db->get_tx_blob(work.tx_hashes[i], blob))
+              return false;
+            break;
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "lmdb query failed: " << e.what() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  cryptonote::BlockchainDB *m_db = nullptr;
+  std::vector<std::pair<std::string, uint64_t>> m_asset_types;
+  std::vector<thread_work> m_work;
+};
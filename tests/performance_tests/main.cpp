@@ -63,11 +63,16 @@
 #include "bulletproof.h"
 #include "bulletproof_plus.h"
 #include "crypto_ops.h"
+#include "carrot_ops.h"
 #include "multiexp.h"
 #include "sig_mlsag.h"
 #include "sig_clsag.h"
 // #include "torsion_ops.h"
 #include "view_scan.h"
+#include "protocol_payouts.h"
+#include "wallet_refresh.h"
+#include "lmdb_queries.h"
+#include "txpool.h"
 // #include "zero_commit.h"
 
 namespace po = boost::program_options;
@@ -87,11 +92,13 @@ int main(int argc, char** argv)
   const command_line::arg_descriptor<bool> arg_stats = { "stats", "Including statistics (min/median)", false };
   const command_line::arg_descriptor<unsigned> arg_loop_multiplier = { "loop-multiplier", "Run for that many times more loops", 1 };
   const command_line::arg_descriptor<std::string> arg_timings_database = { "timings-database", "Keep timings history in a file" };
+  const command_line::arg_descriptor<std::string> arg_lmdb_dir = { "lmdb-dir", "Run the database query tests against this (read only) lmdb directory" };
   command_line::add_arg(desc_options, arg_filter);
   command_line::add_arg(desc_options, arg_verbose);
   command_line::add_arg(desc_options, arg_stats);
   command_line::add_arg(desc_options, arg_loop_multiplier);
   command_line::add_arg(desc_options, arg_timings_database);
+  command_line::add_arg(desc_options, arg_lmdb_dir);
 
   po::variables_map vm;
   bool r = command_line::handle_error_helper(desc_options, [&]()
@@ -198,10 +205,13 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_cn);
   TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_cn_optimized);
   TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_carrot);
+  TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_carrot_coinbase);
   p_view_scan.test_view_tag_check = true;
   TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_cn);
   TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_cn_optimized);
   TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_carrot);
+  TEST_PERFORMANCE0(filter, p_view_scan, test_view_scan_carrot_coinbase);
+  TEST_PERFORMANCE0(filter, p, test_view_scan_sparc_return);
 
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc);
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc_precomp);
@@ -228,6 +238,48 @@ int main(int argc, char** argv)
 
   TEST_PERFORMANCE2(filter, p, test_wallet2_expand_subaddresses, 50, 200);
 
+  TEST_PERFORMANCE2(filter, p, test_yield_payouts, 1000, 1);
+  TEST_PERFORMANCE2(filter, p, test_yield_payouts, 1000, 100);
+  TEST_PERFORMANCE2(filter, p, test_yield_payouts, 10000, 100);
+  TEST_PERFORMANCE2(filter, p, test_yield_payouts, 100000, 1000);
+  TEST_PERFORMANCE2(filter, p, test_yield_payouts, 1000000, 10000);
+  TEST_PERFORMANCE1(filter, p, test_audit_payouts, 1000);
+  TEST_PERFORMANCE1(filter, p, test_audit_payouts, 1000000);
+  TEST_PERFORMANCE2(filter, p, test_construct_protocol_tx, 1000, false);
+  TEST_PERFORMANCE2(filter, p, test_construct_protocol_tx, 1000, true);
+  TEST_PERFORMANCE2(filter, p, test_construct_protocol_tx, 100000, false);
+  TEST_PERFORMANCE2(filter, p, test_construct_protocol_tx, 100000, true);
+
+  TEST_PERFORMANCE3(filter, p, test_wallet_refresh, 10000, 0, false);
+  TEST_PERFORMANCE3(filter, p, test_wallet_refresh, 10000, 10, false);
+  TEST_PERFORMANCE3(filter, p, test_wallet_refresh, 10000, 0, true);
+  TEST_PERFORMANCE3(filter, p, test_wallet_refresh, 10000, 10, true);
+  TEST_PERFORMANCE3(filter, p, test_wallet_refresh, 10000, 100, true);
+
+  TEST_PERFORMANCE3(filter, p, test_txpool_stress, 1000, 0, false);
+  TEST_PERFORMANCE3(filter, p, test_txpool_stress, 1000, 0, true);
+  TEST_PERFORMANCE3(filter, p, test_txpool_stress, 2000, 0, true);
+  TEST_PERFORMANCE3(filter, p, test_txpool_stress, 1000, 200, true);
+
+  ParamsShuttleLMDB p_lmdb;
+  p_lmdb.core_params = p.core_params;
+  p_lmdb.db_path = command_line::get_arg(vm, arg_lmdb_dir);
+  if (!p_lmdb.db_path.empty())
+  {
+#define TEST_LMDB_QUERY(query) \
+    TEST_PERFORMANCE2(filter, p_lmdb, test_lmdb_query, lmdb_query::query, 1); \
+    TEST_PERFORMANCE2(filter, p_lmdb, test_lmdb_query, lmdb_query::query, 4); \
+    TEST_PERFORMANCE2(filter, p_lmdb, test_lmdb_query, lmdb_query::query, 16)
+    TEST_LMDB_QUERY(output_key);
+    TEST_LMDB_QUERY(output_id);
+    TEST_LMDB_QUERY(key_image);
+    TEST_LMDB_QUERY(cumulative_rct_outputs);
+    TEST_LMDB_QUERY(circulating_supply);
+    TEST_LMDB_QUERY(yield_tx_info);
+    TEST_LMDB_QUERY(tx_blob);
+#undef TEST_LMDB_QUERY
+  }
+
   TEST_PERFORMANCE0(filter, p, test_is_valid_decomposed_amount);
 
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 0);
@@ -329,6 +381,17 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_zeroCommitUncached);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_zeroCommitCached);
 
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_uncontextualized_shared_key_receiver);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_view_tag);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_sender_receiver_secret);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_onetime_address_extension_g);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_onetime_address_extension_t);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_amount_blinding_factor);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_anchor_encryption_mask);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_carrot_amount_encryption_mask);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_make_sparc_spend_authority_proof);
+  TEST_PERFORMANCE1(filter, p, test_carrot_ops, op_verify_sparc_spend_authority_proof);
+
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 2);
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 4);
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 8);
@@ -393,6 +456,13 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 1024, 7);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2048, 8);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 4096, 9);
+
+  // multiexp backends, against the CPU reference, at batch verification sizes
+  TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_pippenger, 8192);
+  TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_pippenger, 16384);
+  TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_threads, 4096);
+  TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_threads, 8192);
+  TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_threads, 16384);
 #else
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2, 1);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2, 2);
@@ -42,6 +42,7 @@ enum test_multiexp_algorithm
   multiexp_straus_cached,
   multiexp_pippenger,
   multiexp_pippenger_cached,
+  multiexp_threads,
 };
 
 template<test_multiexp_algorithm algorithm, size_t npoints, size_t c=0>
@@ -65,6 +66,7 @@ public:
     }
     straus_cache = rct::straus_init_cache(data);
     pippenger_cache = rct::pippenger_init_cache(data);
+    threaded_backend = rct::make_threaded_multiexp_backend();
     return true;
   }
 
@@ -82,6 +84,14 @@ public:
         return res == pippenger(data, NULL, 0, c);
       case multiexp_pippenger_cached:
         return res == pippenger(data, pippenger_cache, 0, c);
+      case multiexp_threads:
+      {
+        // must match the reference result computed in init()
+        const ge_p3 result_p3 = threaded_backend->multiexp_p3(data);
+        rct::key result;
+        ge_p3_tobytes(result.bytes, &result_p3);
+        return res == result;
+      }
       default:
         return false;
     }
@@ -91,5 +101,6 @@ private:
   std::vector<rct::MultiexpData> data;
   std::shared_ptr<rct::straus_cached_data> straus_cache;
   std::shared_ptr<rct::pippenger_cached_data> pippenger_cache;
+  std::shared_ptr<rct::multiexp_backend> threaded_backend;
   rct::key res;
 };
@@ -0,0 +1,202 @@
+// Copyright (c) 2025, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "blockchain_db/testdb.h"
+#include "cryptonote_core/blockchain.h"
+#include "cryptonote_core/blockchain_and_pool.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "crypto/crypto.h"
+#include "ringct/rctOps.h"
+
+/// a chain which is one lock period (plus one block) into a synthetic stake population:
+/// every block locks the same n_stakers stakes, and every accrual_every'th block produces slippage
+class test_payouts_db: public cryptonote::BaseTestDB
+{
+public:
+  test_payouts_db(size_t n_stakers, uint64_t accrual_every): m_height(0), m_accrual_every(accrual_every)
+  {
+    m_open = true;
+    m_stakes.resize(n_stakers);
+    for (size_t n = 0; n < n_stakers; ++n)
+    {
+      m_stakes[n].tx_hash = crypto::rand<crypto::hash>();
+      m_stakes[n].locked_coins = 1000000000 + crypto::rand<uint32_t>();
+      m_stakes[n].return_address = rct::rct2pk(rct::pkGen());
+      m_stakes[n].return_pubkey = rct::rct2pk(rct::pkGen());
+      m_locked_coins += m_stakes[n].locked_coins;
+    }
+  }
+
+  void set_height(uint64_t height) { m_height = height; }
+
+  virtual void add_block( const cryptonote::block& blk
+                        , size_t block_weight
+                        , uint64_t long_term_block_weight
+                        , const cryptonote::difficulty_type& cumulative_difficulty
+                        , const uint64_t& coins_generated
+                        , uint64_t num_rct_outs
+                        , oracle::asset_type_counts& cum_rct_by_asset_type
+                        , const crypto::hash& blk_hash
+                        , uint64_t slippage_total
+                        , uint64_t yield_total
+                        , uint64_t audit_total
+                        , const cryptonote::network_type nettype
+                        , cryptonote::yield_block_info& ybi
+                        , cryptonote::audit_block_info& abi
+                        ) override { ++m_height; }
+  virtual uint64_t height() const override { return m_height; }
+  virtual crypto::hash get_block_hash_from_height(const uint64_t &height) const override {
+    crypto::hash hash = crypto::null_hash;
+    *(uint64_t*)&hash = height;
+    return hash;
+  }
+  virtual crypto::hash top_block_hash(uint64_t *block_height = NULL) const override {
+    if (block_height)
+      *block_height = m_height - 1;
+    return get_block_hash_from_height(m_height - 1);
+  }
+
+  virtual int get_yield_block_info(const uint64_t height, cryptonote::yield_block_info& ybi) const override {
+    ybi.block_height = height;
+    ybi.slippage_total_this_block = height % m_accrual_every ? 0 : 50000000000;
+    ybi.locked_coins_this_block = m_locked_coins;
+    ybi.locked_coins_tally = m_locked_coins * std::min<uint64_t>(height + 1, cryptonote::get_config(cryptonote::FAKECHAIN).STAKE_LOCK_PERIOD);
+    ybi.network_health_percentage = 100;
+    return 0;
+  }
+  virtual int get_yield_tx_info(const uint64_t height, std::vector<cryptonote::yield_tx_info>& yti_container) const override {
+    yti_container = m_stakes;
+    for (auto &yti: yti_container)
+      yti.block_height = height;
+    return 0;
+  }
+  virtual int get_audit_tx_info(const uint64_t height, std::vector<cryptonote::yield_tx_info>& ati_container) const override {
+    return get_yield_tx_info(height, ati_container);
+  }
+
+private:
+  uint64_t m_height;
+  uint64_t m_accrual_every;
+  uint64_t m_locked_coins = 0;
+  std::vector<cryptonote::yield_tx_info> m_stakes;
+};
+
+/// base for the payout tests: a blockchain over test_payouts_db, with the yield cache paged in
+template<size_t n_stakers, uint64_t accrual_every>
+class test_payouts_base
+{
+public:
+  bool init()
+  {
+    m_bap.reset(new cryptonote::BlockchainAndPool());
+    test_payouts_db *db = new test_payouts_db(n_stakers, accrual_every);
+    static const std::pair<uint8_t, uint64_t> hard_forks[2] = {std::make_pair(1, 0), std::make_pair(0, 0)};
+    static const cryptonote::test_options test_options = {hard_forks, 0};
+    if (!m_bap->blockchain.init(db, cryptonote::FAKECHAIN, true, &test_options, 0, NULL))
+      return false;
+
+    const uint64_t stake_lock_period = cryptonote::get_config(cryptonote::FAKECHAIN).STAKE_LOCK_PERIOD;
+    db->set_height(stake_lock_period + 2);
+    m_start_height = 1;
+
+    epee::span<const cryptonote::yield_block_info> ybi_cache;
+    return m_bap->blockchain.get_ybi_cache(ybi_cache) && ybi_cache.size() == stake_lock_period + 1;
+  }
+
+protected:
+  std::unique_ptr<cryptonote::BlockchainAndPool> m_bap;
+  uint64_t m_start_height;
+};
+
+/// yield payouts for one matured block: n_stakers stakes accruing over the lock period
+template<size_t n_stakers, uint64_t accrual_every>
+class test_yield_payouts: public test_payouts_base<n_stakers, accrual_every>
+{
+public:
+  static const size_t loop_count = n_stakers >= 100000 ? 5 : 50;
+
+  bool test()
+  {
+    std::vector<std::pair<cryptonote::yield_tx_info, uint64_t>> yield_payouts;
+    return this->m_bap->blockchain.calculate_yield_payouts(this->m_start_height, yield_payouts) && yield_payouts.size() == n_stakers;
+  }
+};
+
+/// audit payouts for one matured block of n_stakers audit txs
+template<size_t n_stakers>
+class test_audit_payouts: public test_payouts_base<n_stakers, 1>
+{
+public:
+  static const size_t loop_count = n_stakers >= 100000 ? 5 : 50;
+
+  bool test()
+  {
+    std::vector<std::pair<cryptonote::yield_tx_info, uint64_t>> audit_payouts;
+    return this->m_bap->blockchain.calculate_audit_payouts(this->m_start_height, audit_payouts) && audit_payouts.size() == n_stakers;
+  }
+};
+
+/// protocol tx construction for n_entries payouts
+template<size_t n_entries, bool carrot>
+class test_construct_protocol_tx
+{
+public:
+  static const size_t loop_count = n_entries >= 10000 ? 10 : 100;
+
+  bool init()
+  {
+    m_protocol_data.resize(n_entries);
+    for (auto &entry: m_protocol_data)
+    {
+      entry.return_address = rct::rct2pk(rct::pkGen());
+      entry.amount_burnt = 1000000000 + crypto::rand<uint32_t>();
+      entry.source_asset = "SAL1";
+      entry.destination_asset = "SAL1";
+      entry.type = cryptonote::transaction_type::STAKE;
+      entry.return_pubkey = rct::rct2pk(rct::pkGen());
+      entry.is_carrot = carrot;
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    cryptonote::transaction tx;
+    return cryptonote::construct_protocol_tx(123456, tx, m_protocol_data, carrot ? HF_VERSION_CARROT : HF_VERSION_CARROT - 1);
+  }
+
+private:
+  std::vector<cryptonote::protocol_data_entry> m_protocol_data;
+};
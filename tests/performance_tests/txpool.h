@@ -0,0 +1,460 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+#include "blockchain_db/testdb.h"
+#include "common/metrics.h"
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/blockchain.h"
+#include "cryptonote_core/blockchain_and_pool.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "cryptonote_core/tx_pool.h"
+#include "crypto/crypto.h"
+#include "ringct/rctOps.h"
+
+/// a chain which only knows the ring members of the stress txs, with the pool tables kept in memory
+class test_txpool_db: public cryptonote::BaseTestDB
+{
+public:
+  test_txpool_db(const std::vector<cryptonote::output_data_t> &outputs): m_height(0), m_outputs(outputs) { m_open = true; }
+
+  void set_height(uint64_t height) { m_height = height; }
+
+  virtual void add_block( const cryptonote::block& blk
+                        , size_t block_weight
+                        , uint64_t long_term_block_weight
+                        , const cryptonote::difficulty_type& cumulative_difficulty
+                        , const uint64_t& coins_generated
+                        , uint64_t num_rct_outs
+                        , oracle::asset_type_counts& cum_rct_by_asset_type
+                        , const crypto::hash& blk_hash
+                        , uint64_t slippage_total
+                        , uint64_t yield_total
+                        , uint64_t audit_total
+                        , const cryptonote::network_type nettype
+                        , cryptonote::yield_block_info& ybi
+                        , cryptonote::audit_block_info& abi
+                        ) override { ++m_height; }
+  virtual uint64_t height() const override { return m_height; }
+  virtual crypto::hash get_block_hash_from_height(const uint64_t &height) const override {
+    crypto::hash hash = crypto::null_hash;
+    *(uint64_t*)&hash = height;
+    return hash;
+  }
+  virtual crypto::hash top_block_hash(uint64_t *block_height = NULL) const override {
+    if (block_height)
+      *block_height = m_height - 1;
+    return get_block_hash_from_height(m_height - 1);
+  }
+
+  // one asset type, and asset type output indices are the global ones
+  virtual void get_output_id_from_asset_type_output_index(const std::string asset_type, const std::vector<uint64_t> &asset_type_output_indices, std::vector<uint64_t> &output_indices) const override {
+    output_indices = asset_type_output_indices;
+  }
+  virtual uint64_t get_output_id_from_asset_type_output_index(const std::string asset_type, const uint64_t &asset_type_output_index) const override {
+    return asset_type_output_index;
+  }
+  virtual cryptonote::output_data_t get_output_key(const uint64_t& amount, const uint64_t& index, bool include_commitmemt) const override {
+    if (index >= m_outputs.size())
+      throw cryptonote::OUTPUT_DNE("output not found");
+    return m_outputs[index];
+  }
+  virtual void get_output_key(const epee::span<const uint64_t> &amounts, const std::vector<uint64_t> &offsets, std::vector<cryptonote::output_data_t> &outputs, bool allow_partial = false) const override {
+    outputs.clear();
+    for (const uint64_t offset: offsets)
+    {
+      if (offset >= m_outputs.size())
+      {
+        if (allow_partial)
+          return;
+        throw cryptonote::OUTPUT_DNE("output not found");
+      }
+      outputs.push_back(m_outputs[offset]);
+    }
+  }
+
+  virtual void add_txpool_tx(const crypto::hash &txid, const cryptonote::blobdata_ref &blob, const cryptonote::txpool_tx_meta_t& details) override {
+    m_txpool[txid] = {details, cryptonote::blobdata(blob.data(), blob.size())};
+  }
+  virtual void update_txpool_tx(const crypto::hash &txid, const cryptonote::txpool_tx_meta_t& details) override {
+    auto it = m_txpool.find(txid);
+    if (it != m_txpool.end())
+      it->second.first = details;
+  }
+  virtual uint64_t get_txpool_tx_count(cryptonote::relay_category category = cryptonote::relay_category::broadcasted) const override {
+    uint64_t count = 0;
+    for (const auto &e: m_txpool)
+      count += e.second.first.matches(category);
+    return count;
+  }
+  virtual bool txpool_has_tx(const crypto::hash &txid, cryptonote::relay_category category) const override {
+    auto it = m_txpool.find(txid);
+    return it != m_txpool.end() && it->second.first.matches(category);
+  }
+  virtual void remove_txpool_tx(const crypto::hash& txid) override { m_txpool.erase(txid); }
+  virtual bool get_txpool_tx_meta(const crypto::hash& txid, cryptonote::txpool_tx_meta_t &meta) const override {
+    auto it = m_txpool.find(txid);
+    if (it == m_txpool.end())
+      return false;
+    meta = it->second.first;
+    return true;
+  }
+  virtual bool get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd, cryptonote::relay_category category) const override {
+    auto it = m_txpool.find(txid);
+    if (it == m_txpool.end() || !it->second.first.matches(category))
+      return false;
+    bd = it->second.second;
+    return true;
+  }
+  virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid, cryptonote::relay_category category) const override {
+    cryptonote::blobdata bd;
+    get_txpool_tx_blob(txid, bd, category);
+    return bd;
+  }
+  virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const cryptonote::txpool_tx_meta_t&, const cryptonote::blobdata_ref*)> f, bool include_blob = false, cryptonote::relay_category category = cryptonote::relay_category::broadcasted) const override {
+    for (const auto &e: m_txpool)
+    {
+      if (!e.second.first.matches(category))
+        continue;
+      const cryptonote::blobdata_ref blob{e.second.second.data(), e.second.second.size()};
+      if (!f(e.first, e.second.first, include_blob ? &blob : NULL))
+        return false;
+    }
+    return true;
+  }
+
+private:
+  uint64_t m_height;
+  const std::vector<cryptonote::output_data_t> &m_outputs;
+  std::unordered_map<crypto::hash, std::pair<cryptonote::txpool_tx_meta_t, cryptonote::blobdata>> m_txpool;
+};
+
+/// signed txs spending one coinbase output each, with rings over the other coinbase outputs;
+/// every stake_every'th one is a STAKE, the rest are TRANSFERs, and fees vary by up to 8x
+struct txpool_stress_txs
+{
+  static const size_t max_txs = 2000;
+  static const size_t ring_size = 16;
+  static const size_t stake_every = 5;
+  static constexpr const uint64_t chain_height = 1000;
+
+  std::vector<cryptonote::output_data_t> outputs;
+  std::vector<cryptonote::transaction> txs;
+
+  bool build(uint64_t fee_per_byte)
+  {
+    cryptonote::account_base sender, recipient;
+    sender.generate();
+    recipient.generate();
+
+    std::vector<cryptonote::transaction> miner_txs(max_txs);
+    outputs.resize(max_txs);
+    for (size_t i = 0; i < max_txs; ++i)
+    {
+      crypto::public_key output_key;
+      if (!cryptonote::construct_miner_tx(i, 0, 0, 0, 0, sender.get_keys().m_account_address, miner_txs[i], cryptonote::FAKECHAIN, {}, cryptonote::blobdata(), 1)
+          || !cryptonote::get_output_public_key(miner_txs[i].vout[0], output_key))
+        return false;
+      outputs[i] = {output_key, 0, 0, cryptonote::asset_id_from_type("SAL"), rct::zeroCommit(miner_txs[i].vout[0].amount)};
+    }
+
+    // signing dominates, so spread it over the cores
+    txs.resize(max_txs);
+    std::atomic<bool> ok{true};
+    const size_t n_threads = std::max(1u, boost::thread::hardware_concurrency());
+    boost::thread_group threads;
+    for (size_t t = 0; t < n_threads; ++t)
+    {
+      threads.create_thread([&, t]() {
+        for (size_t i = t; i < max_txs && ok; i += n_threads)
+          if (!build_tx(i, sender, recipient, miner_txs[i], fee_per_byte))
+            ok = false;
+      });
+    }
+    threads.join_all();
+    return ok;
+  }
+
+private:
+  bool build_tx(size_t i, const cryptonote::account_base &sender, const cryptonote::account_base &recipient, const cryptonote::transaction &miner_tx, uint64_t fee_per_byte)
+  {
+    std::vector<uint64_t> ring{i};
+    while (ring.size() < ring_size)
+    {
+      const uint64_t decoy = crypto::rand_idx<uint64_t>(max_txs);
+      if (std::find(ring.begin(), ring.end(), decoy) == ring.end())
+        ring.push_back(decoy);
+    }
+    std::sort(ring.begin(), ring.end());
+
+    cryptonote::tx_source_entry source;
+    for (const uint64_t idx: ring)
+      source.outputs.push_back({idx, rct::ctkey({rct::pk2rct(outputs[idx].pubkey), outputs[idx].commitment})});
+    source.real_output = std::find(ring.begin(), ring.end(), i) - ring.begin();
+    source.real_out_tx_key = cryptonote::get_tx_pub_key_from_extra(miner_tx);
+    source.real_output_in_tx_index = 0;
+    source.amount = miner_tx.vout[0].amount;
+    source.rct = false;
+    source.carrot = false;
+    source.coinbase = true;
+    source.mask = rct::identity();
+    source.asset_type = "SAL";
+    std::vector<cryptonote::tx_source_entry> sources{source};
+
+    const uint64_t mask = cryptonote::Blockchain::get_fee_quantization_mask();
+    const uint64_t fee = (fee_per_byte * 4000 * (1 + crypto::rand_idx<uint64_t>(8)) + mask - 1) / mask * mask;
+    if (fee * 2 >= source.amount)
+      return false;
+    const bool stake = i % stake_every == 0;
+    const uint64_t sent = (source.amount - fee) / 2;
+
+    std::vector<cryptonote::tx_destination_entry> destinations;
+    destinations.push_back(cryptonote::tx_destination_entry(sent, (stake ? sender : recipient).get_keys().m_account_address, false));
+    destinations.push_back(cryptonote::tx_destination_entry(source.amount - fee - sent, sender.get_keys().m_account_address, false));
+    destinations.back().is_change = true;
+    for (auto &d: destinations)
+      d.asset_type = "SAL";
+
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    subaddresses[sender.get_keys().m_account_address.m_spend_public_key] = {0,0};
+    const rct::RCTConfig rct_config{rct::RangeProofPaddedBulletproof, 4};
+    return cryptonote::construct_tx_and_get_tx_key(sender.get_keys(), subaddresses, sources, destinations, 1, "SAL", "SAL",
+      stake ? cryptonote::transaction_type::STAKE : cryptonote::transaction_type::TRANSFER, sender.get_keys().m_account_address,
+      std::vector<uint8_t>(), txs[i], 0, tx_key, additional_tx_keys, true, rct_config, true);
+  }
+};
+
+/// a blockchain over test_txpool_db with an empty pool, one per replay
+struct txpool_stress_chain
+{
+  std::unique_ptr<cryptonote::BlockchainAndPool> bap;
+
+  bool init(const std::vector<cryptonote::output_data_t> &outputs)
+  {
+    bap.reset(new cryptonote::BlockchainAndPool());
+    test_txpool_db *db = new test_txpool_db(outputs);
+    static const std::pair<uint8_t, uint64_t> hard_forks[2] = {std::make_pair(1, 0), std::make_pair(0, 0)};
+    static const cryptonote::test_options test_options = {hard_forks, 0};
+    if (!bap->blockchain.init(db, cryptonote::FAKECHAIN, true, &test_options, 0, NULL))
+      return false;
+    db->set_height(txpool_stress_txs::chain_height);
+    return bap->tx_pool.init();
+  }
+};
+
+/// the txs are signed once per run and shared by all the pool tests
+inline const txpool_stress_txs *get_txpool_stress_txs()
+{
+  static std::unique_ptr<txpool_stress_txs> txs;
+  static bool tried = false;
+  if (!tried)
+  {
+    tried = true;
+    std::vector<cryptonote::output_data_t> no_outputs;
+    txpool_stress_chain chain;
+    if (!chain.init(no_outputs))
+      return NULL;
+    txs.reset(new txpool_stress_txs());
+    if (!txs->build(chain.bap->blockchain.get_dynamic_base_fee_estimate(10)))
+    {
+      std::cerr << "Failed to build the txpool stress txs" << std::endl;
+      txs.reset();
+    }
+  }
+  return txs.get();
+}
+
+/**
+ * Replays n_txs arrivals into an empty pool, at arrivals_per_s (0 for back to back), optionally
+ * with another thread building a block template every 100 ms meanwhile, as a mining node would.
+ * Once all are in, a template is filled from the full pool, and the backlog and on_idle are timed.
+ * Admission goes through tx_memory_pool::add_tx only, so the semantic checks (range proofs) the
+ * core runs before handing a tx to the pool are not included. Percentiles of each step, and the
+ * m_transactions_lock hold times per holder, are printed when the test is done.
+ */
+template<size_t n_txs, size_t arrivals_per_s, bool concurrent_templates>
+class test_txpool_stress
+{
+  static_assert(n_txs <= txpool_stress_txs::max_txs, "n_txs must be at most txpool_stress_txs::max_txs");
+
+public:
+  static const size_t loop_count = 3;
+
+  ~test_txpool_stress()
+  {
+    if (m_admission_us.empty())
+      return;
+    std::cout << "  admission (ms): " << percentiles(m_admission_us) << std::endl;
+    if (!m_contended_template_us.empty())
+      std::cout << "  template while admitting (ms): " << percentiles(m_contended_template_us) << std::endl;
+    std::cout << "  full pool (ms): template " << mean(m_template_us) << ", backlog " << mean(m_backlog_us) << ", on_idle " << mean(m_idle_us) << std::endl;
+    std::cout << "  lock hold (ms, mean/calls):";
+    for (const char *holder: lock_holders)
+    {
+      const tools::metrics::histogram &h = lock_hold(holder);
+      const uint64_t calls = h.count() - m_lock_start[holder].first;
+      if (calls)
+        std::cout << " " << holder << " " << (h.sum_us() - m_lock_start[holder].second) / 1000.0 / calls << "/" << calls;
+    }
+    std::cout << std::endl;
+  }
+
+  bool init()
+  {
+    m_txs = get_txpool_stress_txs();
+    if (!m_txs)
+      return false;
+    for (const char *holder: lock_holders)
+      m_lock_start[holder] = {lock_hold(holder).count(), lock_hold(holder).sum_us()};
+    return true;
+  }
+
+  bool test()
+  {
+    txpool_stress_chain chain;
+    if (!chain.init(m_txs->outputs))
+      return false;
+    cryptonote::tx_memory_pool &pool = chain.bap->tx_pool;
+
+    std::atomic<bool> admitting{true};
+    boost::thread template_thread;
+    if (concurrent_templates)
+    {
+      template_thread = boost::thread([&]() {
+        while (admitting)
+        {
+          const uint64_t us = fill_template(pool);
+          boost::unique_lock<boost::mutex> lock(m_lock);
+          m_contended_template_us.push_back(us);
+          lock.unlock();
+          boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+        }
+      });
+    }
+
+    bool ok = true;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n_txs && ok; ++i)
+    {
+      if (arrivals_per_s)
+        std::this_thread::sleep_until(start + std::chrono::microseconds(i * 1000000 / arrivals_per_s));
+      cryptonote::transaction tx = m_txs->txs[i];
+      cryptonote::tx_verification_context tvc{};
+      const auto t0 = std::chrono::steady_clock::now();
+      ok = pool.add_tx(tx, tvc, cryptonote::relay_method::fluff, false, 1) && tvc.m_added_to_pool;
+      const uint64_t us = elapsed_us(t0);
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      m_admission_us.push_back(us);
+    }
+    admitting = false;
+    if (template_thread.joinable())
+      template_thread.join();
+    if (!ok)
+      return false;
+
+    m_template_us.push_back(fill_template(pool));
+
+    std::vector<cryptonote::tx_backlog_entry> backlog;
+    auto t0 = std::chrono::steady_clock::now();
+    pool.get_transaction_backlog(backlog);
+    m_backlog_us.push_back(elapsed_us(t0));
+
+    // the first on_idle of a pool does walk it for stuck txs, later ones wait for the interval
+    t0 = std::chrono::steady_clock::now();
+    pool.on_idle();
+    m_idle_us.push_back(elapsed_us(t0));
+
+    return backlog.size() == n_txs && pool.get_transactions_count() == n_txs;
+  }
+
+private:
+  static constexpr const char *lock_holders[] = {"add_tx", "fill_block_template", "get_transaction_backlog", "remove_stuck_transactions"};
+
+  static tools::metrics::histogram &lock_hold(const char *holder)
+  {
+    return tools::metrics::get_histogram("txpool_lock_hold_seconds", "Time the pool lock is held, by holder", tools::metrics::label("holder", holder));
+  }
+
+  static uint64_t elapsed_us(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static uint64_t fill_template(cryptonote::tx_memory_pool &pool)
+  {
+    cryptonote::block b;
+    size_t total_weight;
+    uint64_t fee, expected_reward;
+    const auto t0 = std::chrono::steady_clock::now();
+    pool.fill_block_template(b, CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE_V5, 0, total_weight, fee, expected_reward, 1);
+    return elapsed_us(t0);
+  }
+
+  static double mean(const std::vector<uint64_t> &us)
+  {
+    return us.empty() ? 0.0 : std::accumulate(us.begin(), us.end(), uint64_t(0)) / 1000.0 / us.size();
+  }
+
+  static std::string percentiles(std::vector<uint64_t> us)
+  {
+    std::sort(us.begin(), us.end());
+    const auto at = [&us](double p) { return us[std::min<size_t>(us.size() - 1, us.size() * p)] / 1000.0; };
+    std::ostringstream ss;
+    ss << "p50 " << at(0.5) << ", p90 " << at(0.9) << ", p99 " << at(0.99) << ", max " << us.back() / 1000.0 << " (" << us.size() << ")";
+    return ss.str();
+  }
+
+  const txpool_stress_txs *m_txs = nullptr;
+  boost::mutex m_lock;
+  std::vector<uint64_t> m_admission_us;
+  std::vector<uint64_t> m_contended_template_us;
+  std::vector<uint64_t> m_template_us;
+  std::vector<uint64_t> m_backlog_us;
+  std::vector<uint64_t> m_idle_us;
+  std::map<std::string, std::pair<uint64_t, uint64_t>> m_lock_start;
+};
+
+template<size_t n_txs, size_t arrivals_per_s, bool concurrent_templates>
+constexpr const char *test_txpool_stress<n_txs, arrivals_per_s, concurrent_templates>::lock_holders[];
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include "carrot_core/account.h"
 #include "carrot_core/device_ram_borrowed.h"
 #include "carrot_core/enote_utils.h"
 #include "carrot_core/payment_proposal.h"
@@ -311,3 +312,153 @@ private:
 //---------------------------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------------------------
+
+/// carrot coinbase enote scanning
+class test_view_scan_carrot_coinbase
+{
+public:
+    static const size_t loop_count = 1000;
+
+    bool init(const ParamsShuttleViewScan &params)
+    {
+        m_test_view_tag_check = params.test_view_tag_check;
+
+        m_k_view_incoming = rct::rct2sk(rct::skGen());
+
+        m_account_spend_pubkey = rct::rct2pk(rct::pkGen());
+        const crypto::public_key account_view_pubkey = rct::rct2pk(rct::scalarmultKey(rct::pk2rct(m_account_spend_pubkey), rct::sk2rct(m_k_view_incoming)));
+
+        carrot::CarrotDestinationV1 main_address;
+        carrot::make_carrot_main_address_v1(m_account_spend_pubkey, account_view_pubkey, main_address);
+
+        const carrot::CarrotPaymentProposalV1 payment_proposal{
+            .destination = main_address,
+            .amount = crypto::rand<rct::xmr_amount>(),
+            .randomness = carrot::gen_janus_anchor()
+        };
+        carrot::get_coinbase_output_proposal_v1(payment_proposal, 123456, m_enote);
+
+        if (!test_scan())
+            return false;
+
+        if (m_test_view_tag_check)
+            m_enote.view_tag.bytes[0] ^= 1;
+
+        return true;
+    }
+
+    bool test()
+    {
+        return test_scan() ^ m_test_view_tag_check;
+    }
+
+private:
+    bool test_scan() const
+    {
+        mx25519_pubkey s_sender_receiver_unctx;
+        carrot::make_carrot_uncontextualized_shared_key_receiver(m_k_view_incoming,
+            m_enote.enote_ephemeral_pubkey,
+            s_sender_receiver_unctx);
+
+        crypto::secret_key _1, _2;
+        return carrot::try_scan_carrot_coinbase_enote_receiver(m_enote,
+            s_sender_receiver_unctx,
+            m_account_spend_pubkey,
+            _1,
+            _2);
+    }
+
+    crypto::public_key m_account_spend_pubkey;
+    crypto::secret_key m_k_view_incoming;
+
+    carrot::CarrotCoinbaseEnoteV1 m_enote;
+
+    bool m_test_view_tag_check;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
+
+/// SPARC return output scanning, for an output sent back to us in reply to one of our payments
+class test_view_scan_sparc_return
+{
+public:
+    static const size_t loop_count = 1000;
+
+    bool init()
+    {
+        m_account.generate();
+
+        // the origin payment: its input context and onetime address, plus our change output's onetime address
+        const carrot::input_context_t origin_input_context = carrot::make_carrot_input_context(rct::rct2ki(rct::pkGen()));
+        const crypto::public_key origin_onetime_address = rct::rct2pk(rct::pkGen());
+        const crypto::public_key change_onetime_address = rct::rct2pk(rct::pkGen());
+
+        // K_return = k_return G
+        crypto::secret_key k_return;
+        m_account.s_view_balance_dev.make_internal_return_privkey(origin_input_context, origin_onetime_address, k_return);
+        crypto::public_key return_pubkey;
+        crypto::secret_key_to_public_key(k_return, return_pubkey);
+
+        // the return payment, to (K_change, K_return)
+        carrot::CarrotDestinationV1 return_destination;
+        carrot::make_carrot_main_address_v1(change_onetime_address, return_pubkey, return_destination);
+        const carrot::CarrotPaymentProposalV1 proposal_return{
+            .destination = return_destination,
+            .amount = crypto::rand<rct::xmr_amount>(),
+            .randomness = carrot::gen_janus_anchor()
+        };
+        carrot::RCTOutputEnoteProposal enote_proposal_return;
+        carrot::encrypted_payment_id_t encrypted_payment_id_return;
+        carrot::get_output_proposal_return_v1(proposal_return,
+            rct::rct2ki(rct::pkGen()),
+            nullptr,
+            enote_proposal_return,
+            encrypted_payment_id_return);
+        m_enote = enote_proposal_return.enote;
+        m_input_context = carrot::make_carrot_input_context(m_enote.tx_first_key_image);
+
+        m_account.insert_return_output_info({{m_enote.onetime_address,
+            carrot::return_output_info_t(origin_input_context,
+                origin_onetime_address,
+                change_onetime_address,
+                crypto::key_image{},
+                crypto::secret_key{},
+                crypto::secret_key{})}});
+
+        rct::xmr_amount recovered_amount;
+        if (!test_scan(recovered_amount))
+            return false;
+        return recovered_amount == proposal_return.amount;
+    }
+
+    bool test()
+    {
+        rct::xmr_amount recovered_amount;
+        return test_scan(recovered_amount);
+    }
+
+private:
+    bool test_scan(rct::xmr_amount &amount_out)
+    {
+        crypto::public_key recovered_address_spend_pubkey;
+        crypto::secret_key recovered_amount_blinding_factor;
+        return carrot::scan_return_output(m_enote.onetime_address,
+            m_enote.enote_ephemeral_pubkey,
+            m_enote.view_tag,
+            m_enote.anchor_enc,
+            m_enote.amount_enc,
+            m_enote.amount_commitment,
+            m_input_context,
+            m_account,
+            recovered_address_spend_pubkey,
+            amount_out,
+            recovered_amount_blinding_factor);
+    }
+
+    carrot::carrot_and_legacy_account m_account;
+
+    carrot::CarrotEnoteV1 m_enote;
+    carrot::input_context_t m_input_context;
+};
@@ -0,0 +1,298 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <map>
+
+#include "carrot_impl/format_utils.h"
+#include "common/metrics.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "net/abstract_http_client.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/portable_storage_template_helper.h"
+#include "wallet/wallet2.h"
+
+/// a chain of coinbase-only blocks, a share of which pays the wallet under test
+struct replay_chain
+{
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> output_indices;
+  std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> asset_type_output_indices;
+  std::unordered_map<crypto::hash, uint64_t> heights;
+
+  // serialized responses, keyed by start height and block count, so replays don't pay for serialization
+  std::map<std::pair<uint64_t, uint64_t>, std::string> responses;
+  boost::mutex responses_lock;
+
+  bool add_block(const cryptonote::transaction &miner_tx, uint8_t hf_version)
+  {
+    const uint64_t height = blocks.size();
+
+    cryptonote::block b;
+    b.major_version = hf_version;
+    b.minor_version = hf_version;
+    b.timestamp = time(NULL);
+    b.prev_id = blocks.empty() ? crypto::null_hash : cryptonote::get_block_hash(last_block);
+    b.nonce = 0;
+    b.miner_tx = miner_tx;
+    std::vector<cryptonote::protocol_data_entry> protocol_entries;
+    if (!cryptonote::construct_protocol_tx(height, b.protocol_tx, protocol_entries, hf_version))
+      return false;
+
+    cryptonote::block_complete_entry bce;
+    bce.pruned = true;
+    bce.block = cryptonote::block_to_blob(b);
+    blocks.push_back(std::move(bce));
+    heights.emplace(cryptonote::get_block_hash(b), height);
+
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices indices;
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices asset_type_indices;
+    for (const cryptonote::transaction *tx: {&b.miner_tx, &b.protocol_tx})
+    {
+      indices.indices.emplace_back();
+      asset_type_indices.indices.emplace_back();
+      for (size_t i = 0; i < tx->vout.size(); ++i)
+      {
+        indices.indices.back().indices.push_back(n_outputs);
+        asset_type_indices.indices.back().indices.push_back(n_outputs);
+        ++n_outputs;
+      }
+    }
+    output_indices.push_back(std::move(indices));
+    asset_type_output_indices.push_back(std::move(asset_type_indices));
+
+    last_block = std::move(b);
+    return true;
+  }
+
+  // answer as a daemon would: from the newest block the wallet told us about, or from genesis
+  const std::string &get_blocks(const cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request &req)
+  {
+    uint64_t start = 0;
+    for (const crypto::hash &id: req.block_ids)
+    {
+      const auto it = heights.find(id);
+      if (it != heights.end())
+      {
+        start = it->second;
+        break;
+      }
+    }
+    const uint64_t count = std::min<uint64_t>(req.max_block_count ? req.max_block_count : 1000, blocks.size() - start);
+
+    boost::lock_guard<boost::mutex> lock(responses_lock);
+    std::string &blob = responses[std::make_pair(start, count)];
+    if (blob.empty())
+    {
+      cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response res = AUTO_VAL_INIT(res);
+      res.blocks.assign(blocks.begin() + start, blocks.begin() + start + count);
+      res.output_indices.assign(output_indices.begin() + start, output_indices.begin() + start + count);
+      res.asset_type_output_indices.assign(asset_type_output_indices.begin() + start, asset_type_output_indices.begin() + start + count);
+      res.start_height = start;
+      res.current_height = blocks.size();
+      res.daemon_time = time(NULL);
+      res.pool_info_extent = cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::FULL;
+      res.status = CORE_RPC_STATUS_OK;
+      epee::byte_slice bin;
+      if (epee::serialization::store_t_to_binary(res, bin))
+        blob.assign(reinterpret_cast<const char*>(bin.data()), bin.size());
+    }
+    return blob;
+  }
+
+private:
+  cryptonote::block last_block;
+  uint64_t n_outputs = 0;
+};
+
+/// stands in for the daemon connection, serving /getblocks.bin from a replay_chain
+class replay_http_client: public epee::net_utils::http::abstract_http_client
+{
+public:
+  explicit replay_http_client(std::shared_ptr<replay_chain> chain): m_chain(std::move(chain)) {}
+
+  void set_server(std::string host, std::string port, boost::optional<epee::net_utils::http::login> user, epee::net_utils::ssl_options_t ssl_options) override {}
+  void set_auto_connect(bool auto_connect) override {}
+  bool connect(std::chrono::milliseconds timeout) override { return true; }
+  bool disconnect() override { return true; }
+  bool is_connected(bool *ssl) override { if (ssl) *ssl = false; return true; }
+  uint64_t get_bytes_sent() const override { return 0; }
+  uint64_t get_bytes_received() const override { return 0; }
+
+  bool invoke(const boost::string_ref uri, const boost::string_ref method, const boost::string_ref body, std::chrono::milliseconds timeout, const epee::net_utils::http::http_response_info** ppresponse_info, const epee::net_utils::http::fields_list& additional_params) override
+  {
+    m_response.clear();
+    m_response.m_response_code = 404;
+    if (uri == "/getblocks.bin")
+    {
+      cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
+      if (epee::serialization::load_t_from_binary(req, epee::span<const uint8_t>(reinterpret_cast<const uint8_t*>(body.data()), body.size())))
+      {
+        m_response.m_response_code = 200;
+        m_response.m_body = m_chain->get_blocks(req);
+      }
+    }
+    else
+    {
+      MERROR("replay_http_client: no canned response for " << uri);
+    }
+    if (ppresponse_info)
+      *ppresponse_info = &m_response;
+    return true;
+  }
+
+  bool invoke_get(const boost::string_ref uri, std::chrono::milliseconds timeout, const std::string& body, const epee::net_utils::http::http_response_info** ppresponse_info, const epee::net_utils::http::fields_list& additional_params) override
+  {
+    return invoke(uri, "GET", body, timeout, ppresponse_info, additional_params);
+  }
+
+  bool invoke_post(const boost::string_ref uri, const std::string& body, std::chrono::milliseconds timeout, const epee::net_utils::http::http_response_info** ppresponse_info, const epee::net_utils::http::fields_list& additional_params) override
+  {
+    return invoke(uri, "POST", body, timeout, ppresponse_info, additional_params);
+  }
+
+private:
+  std::shared_ptr<replay_chain> m_chain;
+  epee::net_utils::http::http_response_info m_response;
+};
+
+class replay_http_client_factory: public epee::net_utils::http::http_client_factory
+{
+public:
+  explicit replay_http_client_factory(std::shared_ptr<replay_chain> chain): m_chain(std::move(chain)) {}
+  std::unique_ptr<epee::net_utils::http::abstract_http_client> create() override
+  {
+    return std::unique_ptr<epee::net_utils::http::abstract_http_client>(new replay_http_client(m_chain));
+  }
+
+private:
+  std::shared_ptr<replay_chain> m_chain;
+};
+
+/**
+ * Full wallet2::refresh from a fresh hash chain, then store, against n_blocks canned blocks of which
+ * owned_percent pay the wallet. The per stage split from the wallet_refresh_seconds histograms is
+ * printed when the test is done.
+ */
+template<size_t n_blocks, size_t owned_percent, bool carrot>
+class test_wallet_refresh
+{
+public:
+  static const size_t loop_count = 3;
+
+  test_wallet_refresh(): m_chain(std::make_shared<replay_chain>()) {}
+
+  ~test_wallet_refresh()
+  {
+    if (m_wallet)
+    {
+      std::cout << "  refresh stages (ms per call):";
+      for (const char *stage: stages)
+      {
+        const uint64_t us = stage_time(stage).sum_us() - m_stage_us_start[stage];
+        std::cout << " " << stage << " " << us / 1000.0 / loop_count;
+      }
+      std::cout << std::endl;
+    }
+
+    boost::system::error_code ec;
+    if (!m_wallet_path.empty())
+    {
+      boost::filesystem::remove(m_wallet_path, ec);
+      boost::filesystem::remove(m_wallet_path + ".keys", ec);
+    }
+  }
+
+  bool init()
+  {
+    m_wallet.reset(new tools::wallet2(cryptonote::MAINNET, 1, true, std::unique_ptr<epee::net_utils::http::http_client_factory>(new replay_http_client_factory(m_chain))));
+    m_wallet->set_subaddress_lookahead(1, 1);
+    m_wallet->allow_mismatched_daemon_version(true);
+    m_wallet_path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("performance_tests_wallet_%%%%-%%%%")).string();
+    m_wallet->generate(m_wallet_path, "", rct::rct2sk(rct::skGen()), true, false);
+
+    carrot::carrot_and_legacy_account other;
+    other.generate();
+
+    const uint8_t hf_version = carrot ? HF_VERSION_CARROT : 1;
+    for (size_t height = 0; height < n_blocks; ++height)
+    {
+      const bool owned = (height * owned_percent) % 100 < owned_percent;
+      cryptonote::transaction miner_tx;
+      if (carrot)
+      {
+        const carrot::CarrotDestinationV1 destination = owned
+          ? m_wallet->get_account().cryptonote_address(carrot::null_payment_id, carrot::AddressDeriveType::Carrot)
+          : other.cryptonote_address(carrot::null_payment_id, carrot::AddressDeriveType::Carrot);
+        miner_tx = carrot::make_single_enote_carrot_coinbase_transaction_v1(destination, 1000000000, height, {});
+      }
+      else
+      {
+        const cryptonote::account_public_address &address = owned ? m_wallet->get_account().get_keys().m_account_address : other.get_keys().m_account_address;
+        if (!cryptonote::construct_miner_tx(height, 0, 0, 0, 0, address, miner_tx, cryptonote::MAINNET))
+          return false;
+      }
+      if (!m_chain->add_block(miner_tx, hf_version))
+        return false;
+    }
+
+    for (const char *stage: stages)
+      m_stage_us_start[stage] = stage_time(stage).sum_us();
+    return true;
+  }
+
+  bool test()
+  {
+    m_wallet->rescan_blockchain(true, false);
+    uint64_t blocks_fetched = 0;
+    bool received_money = false;
+    m_wallet->refresh(true, 0, blocks_fetched, received_money, false);
+    m_wallet->store();
+    return blocks_fetched + 1 >= n_blocks && received_money == (owned_percent > 0);
+  }
+
+private:
+  static constexpr const char *stages[] = {"pull", "scan", "process", "store"};
+
+  static tools::metrics::histogram &stage_time(const char *stage)
+  {
+    return tools::metrics::get_histogram("wallet_refresh_seconds", "Time taken by each stage of a wallet refresh", tools::metrics::label("stage", stage));
+  }
+
+  std::shared_ptr<replay_chain> m_chain;
+  std::unique_ptr<tools::wallet2> m_wallet;
+  std::string m_wallet_path;
+  std::map<std::string, uint64_t> m_stage_us_start;
+};
+
+template<size_t n_blocks, size_t owned_percent, bool carrot>
+constexpr const char *test_wallet_refresh<n_blocks, owned_percent, carrot>::stages[];
@@ -0,0 +1,180 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_set>
+
+#include "crypto/crypto.h"
+#include "cryptonote_core/alt_block_index.h"
+
+namespace
+{
+  //! adds `count` alt blocks on top of `prev`, the first at `height`, returns them bottom up
+  std::vector<crypto::hash> add_chain(cryptonote::alt_block_index_t &index, crypto::hash prev, uint64_t height, size_t count)
+  {
+    std::vector<crypto::hash> chain;
+    for (size_t i = 0; i < count; ++i)
+    {
+      const crypto::hash h = crypto::rand<crypto::hash>();
+      index.emplace(h, cryptonote::alt_block_index_entry{prev, height + i});
+      chain.push_back(h);
+      prev = h;
+    }
+    return chain;
+  }
+
+  //! the quadratic search get_alternative_chains used to do on the parsed blocks
+  std::vector<std::vector<crypto::hash>> get_alt_chains_by_search(const cryptonote::alt_block_index_t &index)
+  {
+    std::vector<std::vector<crypto::hash>> chains;
+    for (const auto &i: index)
+    {
+      bool found = false;
+      for (const auto &j: index)
+      {
+        if (j.second.prev_id == i.first)
+        {
+          found = true;
+          break;
+        }
+      }
+      if (found)
+        continue;
+      std::vector<crypto::hash> chain;
+      auto h = i.second.prev_id;
+      chain.push_back(i.first);
+      cryptonote::alt_block_index_t::const_iterator prev;
+      while ((prev = index.find(h)) != index.end())
+      {
+        chain.push_back(h);
+        h = prev->second.prev_id;
+      }
+      chains.push_back(chain);
+    }
+    return chains;
+  }
+
+  struct hash_less
+  {
+    bool operator()(const crypto::hash &a, const crypto::hash &b) const { return memcmp(a.data, b.data, sizeof(a.data)) < 0; }
+  };
+
+  //! chains by tip, as their order is up to the index
+  std::map<crypto::hash, std::vector<crypto::hash>, hash_less> by_tip(const std::vector<std::vector<crypto::hash>> &chains)
+  {
+    std::map<crypto::hash, std::vector<crypto::hash>, hash_less> tips;
+    for (const auto &chain: chains)
+      EXPECT_TRUE(tips.emplace(chain.front(), chain).second);
+    return tips;
+  }
+}
+
+TEST(alt_block_index, empty)
+{
+  cryptonote::alt_block_index_t index;
+  ASSERT_TRUE(cryptonote::get_alt_chains(index).empty());
+  ASSERT_TRUE(cryptonote::get_stale_alt_blocks(index, 100).empty());
+}
+
+TEST(alt_block_index, chains_match_search)
+{
+  cryptonote::alt_block_index_t index;
+  std::vector<crypto::hash> blocks;
+  for (int i = 0; i < 8; ++i)
+  {
+    const auto chain = add_chain(index, crypto::rand<crypto::hash>(), 10 * i, 5);
+    blocks.insert(blocks.end(), chain.begin(), chain.end());
+  }
+  // branch off random alt blocks, including off earlier branches
+  for (int i = 0; i < 40; ++i)
+  {
+    const crypto::hash &base = blocks[crypto::rand_idx<size_t>(blocks.size())];
+    const auto chain = add_chain(index, base, index.at(base).height + 1, 1 + crypto::rand_idx<size_t>(4));
+    blocks.insert(blocks.end(), chain.begin(), chain.end());
+  }
+
+  const auto chains = cryptonote::get_alt_chains(index);
+  ASSERT_EQ(by_tip(chains), by_tip(get_alt_chains_by_search(index)));
+  for (const auto &chain: chains)
+  {
+    ASSERT_FALSE(chain.empty());
+    for (size_t i = 1; i < chain.size(); ++i)
+      ASSERT_EQ(index.at(chain[i - 1]).prev_id, chain[i]);
+    ASSERT_TRUE(index.find(index.at(chain.back()).prev_id) == index.end());
+  }
+}
+
+TEST(alt_block_index, prune_stale)
+{
+  static constexpr const uint64_t cutoff = 50;
+  cryptonote::alt_block_index_t index;
+
+  // abandoned at 15, but a recent chain branches off at 12
+  const auto a = add_chain(index, crypto::rand<crypto::hash>(), 10, 6);
+  const auto b = add_chain(index, a[2], 13, 48);
+  // abandoned on its own
+  const auto c = add_chain(index, crypto::rand<crypto::hash>(), 20, 11);
+  // still being mined, its bottom blocks are well below the cutoff
+  const auto d = add_chain(index, crypto::rand<crypto::hash>(), 5, 66);
+  // two abandoned tips sharing their lower blocks
+  const auto e = add_chain(index, crypto::rand<crypto::hash>(), 30, 3);
+  const auto e1 = add_chain(index, e.back(), 33, 2);
+  const auto e2 = add_chain(index, e.back(), 33, 1);
+
+  const std::vector<crypto::hash> stale = cryptonote::get_stale_alt_blocks(index, cutoff);
+  const std::unordered_set<crypto::hash> removed(stale.begin(), stale.end());
+  ASSERT_EQ(removed.size(), stale.size());
+
+  std::unordered_set<crypto::hash> expected(a.begin() + 3, a.end());
+  expected.insert(c.begin(), c.end());
+  expected.insert(e.begin(), e.end());
+  expected.insert(e1.begin(), e1.end());
+  expected.insert(e2.begin(), e2.end());
+  ASSERT_EQ(removed, expected);
+
+  // each chain is listed from its tip down
+  const auto pos = [&stale](const crypto::hash &h) { return std::find(stale.begin(), stale.end(), h) - stale.begin(); };
+  ASSERT_LT(pos(a[5]), pos(a[3]));
+  ASSERT_LT(pos(c.back()), pos(c.front()));
+
+  for (const crypto::hash &h: stale)
+    index.erase(h);
+  std::vector<crypto::hash> ab(a.begin(), a.begin() + 3);
+  ab.insert(ab.end(), b.begin(), b.end());
+  std::reverse(ab.begin(), ab.end());
+  std::vector<crypto::hash> dr(d.rbegin(), d.rend());
+  ASSERT_EQ(by_tip(cryptonote::get_alt_chains(index)), by_tip({ab, dr}));
+
+  // nothing left is stale
+  ASSERT_TRUE(cryptonote::get_stale_alt_blocks(index, cutoff).empty());
+}
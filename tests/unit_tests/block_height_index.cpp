@@ -0,0 +1,105 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "cryptonote_core/block_height_index.h"
+
+TEST(block_height_index, empty)
+{
+  cryptonote::block_height_index index;
+  uint64_t height;
+  ASSERT_EQ(index.end_height(), 0);
+  ASSERT_FALSE(index.find(crypto::rand<crypto::hash>(), height));
+  index.pop_back();
+  ASSERT_TRUE(index.empty());
+}
+
+TEST(block_height_index, push_find_pop)
+{
+  cryptonote::block_height_index index;
+  std::vector<crypto::hash> hashes;
+  for (size_t i = 0; i < 5000; ++i)
+  {
+    hashes.push_back(crypto::rand<crypto::hash>());
+    index.push_back(hashes.back());
+  }
+  ASSERT_EQ(index.end_height(), hashes.size());
+
+  uint64_t height;
+  for (size_t i = 0; i < hashes.size(); ++i)
+  {
+    ASSERT_TRUE(index.find(hashes[i], height));
+    ASSERT_EQ(height, i);
+  }
+  ASSERT_FALSE(index.find(crypto::rand<crypto::hash>(), height));
+
+  // popped heights are gone, the rest are still found after the probe runs are shifted
+  for (size_t i = 0; i < 3000; ++i)
+  {
+    index.pop_back();
+    ASSERT_FALSE(index.find(hashes.back(), height));
+    hashes.pop_back();
+  }
+  for (size_t i = 0; i < hashes.size(); ++i)
+  {
+    ASSERT_TRUE(index.find(hashes[i], height));
+    ASSERT_EQ(height, i);
+  }
+
+  // a replacement block at a popped height
+  const crypto::hash replacement = crypto::rand<crypto::hash>();
+  index.push_back(replacement);
+  ASSERT_TRUE(index.find(replacement, height));
+  ASSERT_EQ(height, hashes.size());
+}
+
+TEST(block_height_index, collisions)
+{
+  // hashes sharing their low bytes land in the same probe run
+  cryptonote::block_height_index index;
+  std::vector<crypto::hash> hashes;
+  for (size_t i = 0; i < 64; ++i)
+  {
+    crypto::hash hash = crypto::rand<crypto::hash>();
+    hash.data[0] = 0x42;
+    hash.data[1] = 0;
+    hashes.push_back(hash);
+    index.push_back(hash);
+  }
+  index.pop_back();
+  hashes.pop_back();
+  uint64_t height;
+  for (size_t i = 0; i < hashes.size(); ++i)
+  {
+    ASSERT_TRUE(index.find(hashes[i], height));
+    ASSERT_EQ(height, i);
+  }
+}
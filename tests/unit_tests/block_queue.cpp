@@ -29,6 +29,7 @@
 #include <boost/uuid/uuid.hpp>
 #include "gtest/gtest.h"
 #include "crypto/crypto.h"
+#include "common/pruning.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_protocol/block_queue.h"
 
@@ -87,3 +88,73 @@ TEST(block_queue, flush_uuid)
   bq.add_blocks(0, 200, uuid1(), na);
   ASSERT_EQ(bq.get_max_block_height(), 399);
 }
+
+TEST(block_queue, average_block_size)
+{
+  cryptonote::block_queue bq;
+  epee::net_utils::network_address na;
+
+  ASSERT_EQ(bq.get_average_block_size(), 0.0f);
+  bq.add_blocks(0, 10, uuid1(), na);
+  ASSERT_EQ(bq.get_average_block_size(), 0.0f);
+  bq.add_blocks(0, std::vector<cryptonote::block_complete_entry>(10), uuid1(), na, 1000.0f, 10000);
+  ASSERT_EQ(bq.get_average_block_size(), 1000.0f);
+  bq.add_blocks(10, std::vector<cryptonote::block_complete_entry>(5), uuid2(), na, 1000.0f, 15000);
+  ASSERT_EQ(bq.get_average_block_size(), 2000.0f);
+  bq.add_blocks(15, std::vector<cryptonote::block_complete_entry>(), uuid2(), na, 1000.0f, 0);
+  ASSERT_EQ(bq.get_average_block_size(), 2000.0f);
+}
+
+TEST(block_queue, stripe_peers)
+{
+  cryptonote::block_queue bq;
+  const uint32_t seed1 = tools::make_pruning_seed(1, CRYPTONOTE_PRUNING_LOG_STRIPES);
+  const uint32_t seed2 = tools::make_pruning_seed(2, CRYPTONOTE_PRUNING_LOG_STRIPES);
+
+  ASSERT_EQ(bq.get_num_stripe_peers(1), 0);
+  bq.add_stripe_peer(uuid1(), seed1);
+  bq.add_stripe_peer(uuid2(), seed1);
+  ASSERT_EQ(bq.get_num_stripe_peers(1), 2);
+  bq.add_stripe_peer(uuid2(), seed2);
+  ASSERT_EQ(bq.get_num_stripe_peers(1), 1);
+  ASSERT_EQ(bq.get_num_stripe_peers(2), 1);
+  bq.remove_stripe_peer(uuid1());
+  ASSERT_EQ(bq.get_num_stripe_peers(1), 0);
+  bq.add_stripe_peer(uuid1(), 0);
+  ASSERT_EQ(bq.get_num_stripe_peers(0), 1);
+  bq.flush_stale_spans({uuid1()});
+  ASSERT_EQ(bq.get_num_stripe_peers(0), 1);
+  ASSERT_EQ(bq.get_num_stripe_peers(2), 0);
+}
+
+TEST(block_queue, full_peer_skips_covered_stripe)
+{
+  epee::net_utils::network_address na;
+  const uint64_t blockchain_height = 100000;
+  std::vector<std::pair<crypto::hash, uint64_t>> hashes;
+  for (size_t i = 0; i < 3 * CRYPTONOTE_PRUNING_STRIPE_SIZE; ++i)
+    hashes.push_back({crypto::rand<crypto::hash>(), 0});
+
+  cryptonote::block_queue bq;
+  std::pair<uint64_t, uint64_t> span = bq.reserve_span(0, hashes.size() - 1, 100, uuid1(), na, false, 0, 0, blockchain_height, hashes);
+  ASSERT_EQ(span.first, 0);
+  bq.flush_spans(uuid1());
+
+  // a pruned peer serves stripe 1, so the full peer starts on stripe 2
+  bq.add_stripe_peer(uuid2(), tools::make_pruning_seed(1, CRYPTONOTE_PRUNING_LOG_STRIPES));
+  span = bq.reserve_span(0, hashes.size() - 1, 100, uuid1(), na, false, 0, 0, blockchain_height, hashes);
+  ASSERT_EQ(span.first, CRYPTONOTE_PRUNING_STRIPE_SIZE);
+  ASSERT_EQ(span.second, 100);
+
+  // and the pruned peer gets its own stripe
+  span = bq.reserve_span(0, hashes.size() - 1, 100, uuid2(), na, false, 0, tools::make_pruning_seed(1, CRYPTONOTE_PRUNING_LOG_STRIPES), blockchain_height, hashes);
+  ASSERT_EQ(span.first, 0);
+  bq.flush_spans(uuid1());
+  bq.flush_spans(uuid2());
+
+  // all stripes within reach are covered: no skip
+  bq.add_stripe_peer(crypto::rand<boost::uuids::uuid>(), tools::make_pruning_seed(2, CRYPTONOTE_PRUNING_LOG_STRIPES));
+  bq.add_stripe_peer(crypto::rand<boost::uuids::uuid>(), tools::make_pruning_seed(3, CRYPTONOTE_PRUNING_LOG_STRIPES));
+  span = bq.reserve_span(0, hashes.size() - 1, 100, uuid1(), na, false, 0, 0, blockchain_height, hashes);
+  ASSERT_EQ(span.first, 0);
+}
@@ -32,6 +32,8 @@
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <set>
+#include <tuple>
 
 #include "gtest/gtest.h"
 
@@ -302,6 +304,202 @@ TYPED_TEST(BlockchainDBTest, AddBlock)
   }
 }
 
+TYPED_TEST(BlockchainDBTest, StateRecords)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  {
+    db_wtxn_guard guard(this->m_db);
+    cryptonote::audit_block_info abi;
+    cryptonote::yield_block_info ybi;
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0], cryptonote::FAKECHAIN, ybi, abi));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1], cryptonote::FAKECHAIN, ybi, abi));
+  }
+
+  // the walk is deterministic, and each table comes as one run of records
+  std::vector<std::tuple<std::string, std::string, std::string>> records[2];
+  for (auto &walk: records)
+  {
+    ASSERT_TRUE(this->m_db->for_all_state_records([&walk](const char *table, const epee::span<const uint8_t> key, const epee::span<const uint8_t> value) {
+      walk.emplace_back(table, std::string(reinterpret_cast<const char*>(key.data()), key.size()), std::string(reinterpret_cast<const char*>(value.data()), value.size()));
+      return true;
+    }));
+  }
+  ASSERT_FALSE(records[0].empty());
+  ASSERT_EQ(records[0], records[1]);
+
+  std::vector<std::string> tables;
+  for (const auto &record: records[0])
+    if (tables.empty() || tables.back() != std::get<0>(record))
+      tables.push_back(std::get<0>(record));
+  ASSERT_EQ(std::set<std::string>(tables.begin(), tables.end()).size(), tables.size());
+  ASSERT_NE(std::find(tables.begin(), tables.end(), "output_amounts"), tables.end());
+
+  // stopping early is reported
+  size_t calls = 0;
+  ASSERT_FALSE(this->m_db->for_all_state_records([&calls](const char*, const epee::span<const uint8_t>, const epee::span<const uint8_t>) { ++calls; return false; }));
+  ASSERT_EQ(1, calls);
+}
+
+TYPED_TEST(BlockchainDBTest, EmissionTotals)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  {
+    db_wtxn_guard guard(this->m_db);
+    cryptonote::audit_block_info abi;
+    cryptonote::yield_block_info ybi;
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0], cryptonote::FAKECHAIN, ybi, abi));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1], cryptonote::FAKECHAIN, ybi, abi));
+  }
+
+  // each entry is the previous one plus the block's own sums
+  cryptonote::block_emission_totals expected = AUTO_VAL_INIT(expected), totals;
+  for (size_t i = 0; i < 2; ++i)
+  {
+    cryptonote::add_block_emission(this->m_blocks[i].first, expected);
+    for (const auto &tx: this->m_txs[i])
+      cryptonote::add_tx_emission(tx.first, expected);
+    ASSERT_TRUE(this->m_db->get_block_emission_totals(i, totals));
+    ASSERT_EQ(0, totals.first_height);
+    ASSERT_EQ(cryptonote::t_serializable_object_to_blob(expected), cryptonote::t_serializable_object_to_blob(totals));
+  }
+  ASSERT_FALSE(this->m_db->get_block_emission_totals(2, totals));
+
+  // and goes with its block
+  {
+    db_wtxn_guard guard(this->m_db);
+    cryptonote::block blk;
+    std::vector<cryptonote::transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  }
+  ASSERT_FALSE(this->m_db->get_block_emission_totals(1, totals));
+  ASSERT_TRUE(this->m_db->get_block_emission_totals(0, totals));
+}
+
+TYPED_TEST(BlockchainDBTest, TxIndex)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  this->m_db->set_tx_index(true);
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  uint64_t index_height;
+  ASSERT_TRUE(this->m_db->get_tx_index_height(index_height));
+  ASSERT_EQ(0, index_height);
+
+  {
+    db_wtxn_guard guard(this->m_db);
+    cryptonote::audit_block_info abi;
+    cryptonote::yield_block_info ybi;
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0], cryptonote::FAKECHAIN, ybi, abi));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1], cryptonote::FAKECHAIN, ybi, abi));
+  }
+
+  // one miner tx per block, in height order, one page at a time
+  const uint8_t miner_type = this->m_blocks[0].first.miner_tx.type;
+  std::vector<tx_index_entry> txs;
+  this->m_db->get_txs_by_type(miner_type, 0, 0, 1, 1, txs);
+  ASSERT_EQ(1, txs.size());
+  ASSERT_EQ(0, txs[0].height);
+  ASSERT_EQ(get_transaction_hash(this->m_blocks[0].first.miner_tx), txs[0].tx_hash);
+  this->m_db->get_txs_by_type(miner_type, txs[0].height, txs[0].tx_id + 1, 1, 10, txs);
+  ASSERT_EQ(1, txs.size());
+  ASSERT_EQ(1, txs[0].height);
+  ASSERT_EQ(get_transaction_hash(this->m_blocks[1].first.miner_tx), txs[0].tx_hash);
+
+  std::string asset_type;
+  ASSERT_TRUE(get_output_asset_type(this->m_blocks[0].first.miner_tx.vout[0], asset_type));
+  size_t n_outputs = 0;
+  for (size_t i = 0; i < 2; ++i)
+  {
+    for (const auto &tx: {this->m_blocks[i].first.miner_tx, this->m_blocks[i].first.protocol_tx})
+      for (const auto &vout: tx.vout)
+      {
+        std::string out_asset_type;
+        ASSERT_TRUE(get_output_asset_type(vout, out_asset_type));
+        n_outputs += out_asset_type == asset_type;
+      }
+  }
+  std::vector<output_index_entry> outputs;
+  this->m_db->get_outputs_by_asset_type(asset_type, 0, 0, 1, 1000, outputs);
+  ASSERT_EQ(n_outputs, outputs.size());
+  for (size_t i = 1; i < outputs.size(); ++i)
+    ASSERT_LT(outputs[i - 1].output_id, outputs[i].output_id);
+
+  // popping a block takes its entries out
+  {
+    db_wtxn_guard guard(this->m_db);
+    cryptonote::block blk;
+    std::vector<cryptonote::transaction> pool_txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, pool_txs));
+  }
+  this->m_db->get_txs_by_type(miner_type, 0, 0, 1, 10, txs);
+  ASSERT_EQ(1, txs.size());
+  this->m_db->get_outputs_by_asset_type(asset_type, 1, 0, 1, 1000, outputs);
+  ASSERT_TRUE(outputs.empty());
+}
+
+TYPED_TEST(BlockchainDBTest, HasKeyImages)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  {
+    db_wtxn_guard guard(this->m_db);
+    cryptonote::audit_block_info abi;
+    cryptonote::yield_block_info ybi;
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0], cryptonote::FAKECHAIN, ybi, abi));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1], cryptonote::FAKECHAIN, ybi, abi));
+  }
+
+  // spent key images mixed with unknown ones, in no particular order
+  std::vector<crypto::key_image> key_images;
+  for (const auto &txs: this->m_txs)
+    for (const auto &tx: txs)
+      for (const auto &in: tx.first.vin)
+        if (in.type() == typeid(txin_to_key))
+          key_images.push_back(boost::get<txin_to_key>(in).k_image);
+  for (size_t n = 0; n < 64; ++n)
+    key_images.push_back(crypto::rand<crypto::key_image>());
+  key_images.push_back(key_images.front());
+  std::shuffle(key_images.begin(), key_images.end(), crypto::random_device{});
+
+  std::vector<bool> spent;
+  ASSERT_NO_THROW(this->m_db->has_key_images(epee::to_span(key_images), spent));
+  ASSERT_EQ(key_images.size(), spent.size());
+  for (size_t n = 0; n < key_images.size(); ++n)
+    ASSERT_EQ(this->m_db->has_key_image(key_images[n]), spent[n]);
+
+  ASSERT_NO_THROW(this->m_db->has_key_images({}, spent));
+  ASSERT_TRUE(spent.empty());
+}
+
 TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
 {
   boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
@@ -345,4 +543,40 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1].first), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, ColdStorage)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+  std::string coldPath = (tempPath / "cold").string();
+
+  this->set_prefix(dirPath);
+
+  this->m_db->set_cold_storage_path(coldPath);
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  cryptonote::audit_block_info abi;
+  cryptonote::yield_block_info ybi;
+  {
+    db_wtxn_guard guard(this->m_db);
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0], cryptonote::FAKECHAIN, ybi, abi));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1], cryptonote::FAKECHAIN, ybi, abi));
+  }
+
+  // the cold files are reported along with the main ones
+  ASSERT_EQ(4, this->m_filenames.size());
+
+  ASSERT_NO_THROW(this->m_db->close());
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+
+  // full txs are put back together from both dbs
+  for (const auto& tx : this->m_txs[0])
+  {
+    cryptonote::blobdata bd;
+    ASSERT_TRUE(this->m_db->get_tx_blob(get_transaction_hash(tx.first), bd));
+    ASSERT_EQ(tx.second, bd);
+  }
+}
+
 }  // anonymous namespace
@@ -171,3 +171,39 @@ TEST_F(bootstrap_node_selector, selector_auto_max_nodes)
 
   EXPECT_EQ(unique_nodes.size(), max_nodes);
 }
+
+TEST_F(bootstrap_node_selector, selector_auto_hedge_node)
+{
+  cryptonote::bootstrap_node::selector_auto selector([this]() {
+    return white_nodes;
+  });
+
+  const auto primary = selector.next_node();
+  ASSERT_TRUE(primary);
+  for (size_t i = 0; i < 10; ++i)
+  {
+    const auto hedge = selector.next_hedge_node(primary->address);
+    ASSERT_TRUE(hedge);
+    EXPECT_NE(hedge->address, primary->address);
+    EXPECT_TRUE(white_nodes.count(hedge->address) > 0);
+  }
+}
+
+TEST_F(bootstrap_node_selector, selector_auto_prefers_faster)
+{
+  cryptonote::bootstrap_node::selector_auto selector([this]() {
+    return white_nodes;
+  });
+
+  ASSERT_TRUE(selector.next_node());
+  selector.handle_latency("white_node_1:18089", std::chrono::milliseconds(10));
+  selector.handle_latency("white_node_2:18081", std::chrono::milliseconds(1000));
+
+  size_t faster = 0;
+  for (size_t i = 0; i < 100; ++i)
+  {
+    if (selector.next_node()->address == "white_node_1:18089")
+      ++faster;
+  }
+  EXPECT_GT(faster, 50u);
+}
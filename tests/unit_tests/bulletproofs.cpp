@@ -302,6 +302,12 @@ TEST(bulletproof, weight_pruned)
     ASSERT_TRUE(parse_and_validate_tx_from_blob(bd, tx, tx_hash, tx_prefix_hash));
     ASSERT_TRUE(tx.version == 3); // >=2
     ASSERT_FALSE(tx.pruned);
+    // hashes taken from the parsed blob match the ones of the re-serialized tx
+    cryptonote::transaction tx_copy = tx;
+    tx_copy.invalidate_hashes();
+    ASSERT_EQ(tx_hash, cryptonote::get_transaction_hash(tx_copy));
+    ASSERT_EQ(tx_prefix_hash, cryptonote::get_transaction_prefix_hash(tx));
+    ASSERT_EQ(tx.prunable_hash, cryptonote::get_transaction_prunable_hash(tx_copy));
     ASSERT_TRUE(rct::is_rct_bulletproof_plus(tx.rct_signatures.type)); // salvium started with bulletproof+
     const uint64_t tx_weight = cryptonote::get_transaction_weight(tx);
     ASSERT_TRUE(parse_and_validate_tx_base_from_blob(bd, pruned_tx));
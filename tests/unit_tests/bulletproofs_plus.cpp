@@ -77,6 +77,36 @@ TEST(bulletproofs_plus, valid_multi_random)
   }
 }
 
+TEST(bulletproofs_plus, valid_batch_prove)
+{
+  std::vector<std::vector<uint64_t>> amounts(6);
+  std::vector<rct::keyV> gamma(amounts.size());
+  for (size_t n = 0; n < amounts.size(); ++n)
+  {
+    for (size_t i = 0; i < 1 + n % 3; ++i)
+    {
+      amounts[n].push_back(crypto::rand<uint64_t>());
+      gamma[n].push_back(rct::skGen());
+    }
+  }
+  std::vector<rct::BulletproofPlus> proofs = rct::bulletproof_plus_PROVE(amounts, gamma);
+  ASSERT_EQ(proofs.size(), amounts.size());
+  for (size_t n = 0; n < proofs.size(); ++n)
+  {
+    ASSERT_EQ(proofs[n].V.size(), amounts[n].size());
+    for (size_t i = 0; i < amounts[n].size(); ++i)
+    {
+      // V is the commitment scaled by 1/8
+      ASSERT_EQ(rct::scalarmult8(proofs[n].V[i]), rct::commit(amounts[n][i], gamma[n][i]));
+    }
+  }
+  ASSERT_TRUE(rct::bulletproof_plus_VERIFY(proofs));
+
+  amounts.push_back(std::vector<uint64_t>(BULLETPROOF_PLUS_MAX_OUTPUTS + 1, 0));
+  gamma.push_back(rct::keyV(BULLETPROOF_PLUS_MAX_OUTPUTS + 1, rct::skGen()));
+  ASSERT_ANY_THROW(rct::bulletproof_plus_PROVE(amounts, gamma));
+}
+
 TEST(bulletproofs_plus, valid_aggregated)
 {
   static const size_t N_PROOFS = 8;
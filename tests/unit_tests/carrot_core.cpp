@@ -28,11 +28,15 @@
 
 #include "gtest/gtest.h"
 
+#include <boost/filesystem.hpp>
+
 #include "carrot_core/output_set_finalization.h"
 #include "carrot_core/payment_proposal.h"
 #include "carrot_core/scan.h"
 #include "carrot_core/scan_unsafe.h"
+#include "carrot_core/subaddress_lookup_table.h"
 #include "carrot_mock_helpers.h"
+#include "file_io_utils.h"
 
 using namespace carrot;
 
@@ -648,6 +652,196 @@ TEST(carrot_core, main_address_coinbase_scan_completeness)
         enote.onetime_address));
 }
 //----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_core, batch_ECDH_match_single)
+{
+    mock::mock_carrot_and_legacy_keys keys;
+    keys.generate();
+
+    // a mix of unique and repeated (adjacent and not) ephemeral pubkeys
+    std::vector<mx25519_pubkey> enote_ephemeral_pubkeys;
+    for (std::size_t i = 0; i < 6; ++i)
+        enote_ephemeral_pubkeys.push_back(gen_x25519_pubkey());
+    enote_ephemeral_pubkeys.push_back(enote_ephemeral_pubkeys[5]);
+    enote_ephemeral_pubkeys.push_back(enote_ephemeral_pubkeys[0]);
+    enote_ephemeral_pubkeys.push_back(gen_x25519_pubkey());
+
+    std::vector<mx25519_pubkey> s_sender_receiver_unctx(enote_ephemeral_pubkeys.size());
+    make_carrot_uncontextualized_shared_keys_receiver(keys.legacy_acb.get_keys().m_view_secret_key,
+        epee::to_span(enote_ephemeral_pubkeys),
+        epee::to_mut_span(s_sender_receiver_unctx));
+
+    std::vector<mx25519_pubkey> s_sender_receiver_unctx_dev(enote_ephemeral_pubkeys.size());
+    std::vector<bool> failed;
+    keys.k_view_incoming_dev.view_key_scalar_mult_x25519_batch(epee::to_span(enote_ephemeral_pubkeys),
+        epee::to_mut_span(s_sender_receiver_unctx_dev),
+        failed);
+    ASSERT_EQ(enote_ephemeral_pubkeys.size(), failed.size());
+
+    for (std::size_t i = 0; i < enote_ephemeral_pubkeys.size(); ++i)
+    {
+        mx25519_pubkey s_sr;
+        ASSERT_TRUE(make_carrot_uncontextualized_shared_key_receiver(keys.legacy_acb.get_keys().m_view_secret_key,
+            enote_ephemeral_pubkeys[i],
+            s_sr));
+        EXPECT_EQ(0, memcmp(s_sr.data, s_sender_receiver_unctx[i].data, sizeof(s_sr.data)));
+        EXPECT_EQ(0, memcmp(s_sr.data, s_sender_receiver_unctx_dev[i].data, sizeof(s_sr.data)));
+        EXPECT_FALSE(failed[i]);
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_core, batch_hash_functions_match_single)
+{
+    // enough enotes to cover the batched lanes and the leftovers, for every count up to that
+    for (std::size_t count = 0; count <= 11; ++count)
+    {
+        std::vector<mx25519_pubkey> s_sender_receiver_unctx(count);
+        std::vector<mx25519_pubkey> enote_ephemeral_pubkeys(count);
+        std::vector<input_context_t> input_contexts(count);
+        std::vector<crypto::public_key> onetime_addresses(count);
+        std::vector<crypto::hash> s_sender_receiver(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            s_sender_receiver_unctx[i] = gen_x25519_pubkey();
+            enote_ephemeral_pubkeys[i] = gen_x25519_pubkey();
+            input_contexts[i] = make_carrot_input_context(rct::rct2ki(rct::pkGen()));
+            onetime_addresses[i] = rct::rct2pk(rct::pkGen());
+            s_sender_receiver[i] = crypto::rand<crypto::hash>();
+        }
+
+        std::vector<view_tag_t> view_tags(count);
+        make_carrot_view_tags(epee::to_span(s_sender_receiver_unctx),
+            epee::to_span(input_contexts),
+            epee::to_span(onetime_addresses),
+            epee::to_mut_span(view_tags));
+
+        std::vector<crypto::hash> s_sender_receiver_ctx(count);
+        make_carrot_sender_receiver_secrets(epee::to_span(s_sender_receiver_unctx),
+            epee::to_span(enote_ephemeral_pubkeys),
+            epee::to_span(input_contexts),
+            epee::to_mut_span(s_sender_receiver_ctx));
+
+        std::vector<encrypted_amount_t> amount_masks(count);
+        make_carrot_amount_encryption_masks(epee::to_span(s_sender_receiver),
+            epee::to_span(onetime_addresses),
+            epee::to_mut_span(amount_masks));
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            view_tag_t view_tag;
+            make_carrot_view_tag(s_sender_receiver_unctx[i].data, input_contexts[i], onetime_addresses[i], view_tag);
+            EXPECT_EQ(view_tag, view_tags[i]);
+
+            crypto::hash s_sr_ctx;
+            make_carrot_sender_receiver_secret(s_sender_receiver_unctx[i].data,
+                enote_ephemeral_pubkeys[i],
+                input_contexts[i],
+                s_sr_ctx);
+            EXPECT_EQ(s_sr_ctx, s_sender_receiver_ctx[i]);
+
+            encrypted_amount_t amount_mask;
+            make_carrot_amount_encryption_mask(s_sender_receiver[i], onetime_addresses[i], amount_mask);
+            EXPECT_EQ(0, memcmp(amount_mask.bytes, amount_masks[i].bytes, sizeof(amount_mask.bytes)));
+        }
+    }
+
+    std::vector<view_tag_t> too_few(1);
+    EXPECT_ANY_THROW(make_carrot_view_tags({}, {}, {}, epee::to_mut_span(too_few)));
+}
+//----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_core, bulk_subaddress_spend_pubkeys_match_single)
+{
+    mock::mock_carrot_and_legacy_keys keys;
+    keys.generate();
+
+    // small batches and large ones take different paths
+    for (const std::size_t n : {std::size_t(3), std::size_t(100)})
+    {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> subaddress_indices{{0, 0}};
+        while (subaddress_indices.size() < n)
+            subaddress_indices.emplace_back(crypto::rand_idx(mock::MAX_SUBADDRESS_MAJOR_INDEX),
+                1 + crypto::rand_idx(mock::MAX_SUBADDRESS_MINOR_INDEX));
+
+        std::vector<crypto::public_key> address_spend_pubkeys;
+        make_carrot_subaddress_spend_pubkeys_v1(keys.carrot_account_spend_pubkey,
+            keys.s_generate_address_dev,
+            subaddress_indices,
+            address_spend_pubkeys);
+        ASSERT_EQ(n, address_spend_pubkeys.size());
+
+        EXPECT_EQ(keys.carrot_account_spend_pubkey, address_spend_pubkeys[0]);
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            CarrotDestinationV1 subaddress;
+            make_carrot_subaddress_v1(keys.carrot_account_spend_pubkey,
+                keys.carrot_account_view_pubkey,
+                keys.s_generate_address_dev,
+                subaddress_indices[i].first,
+                subaddress_indices[i].second,
+                subaddress);
+            EXPECT_EQ(subaddress.address_spend_pubkey, address_spend_pubkeys[i]);
+        }
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_core, batch_external_scan_completeness)
+{
+    mock::mock_carrot_and_legacy_keys keys;
+    keys.generate();
+    mock::mock_carrot_and_legacy_keys other_keys;
+    other_keys.generate();
+
+    // interleave enotes to us and to someone else, with two of ours sharing a tx
+    const crypto::key_image tx_first_key_image = rct::rct2ki(rct::pkGen());
+    std::vector<CarrotEnoteV1> enotes;
+    std::vector<rct::xmr_amount> amounts;
+    std::vector<bool> is_ours;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        const bool ours = i % 2 == 0;
+        const CarrotPaymentProposalV1 proposal = CarrotPaymentProposalV1{
+            .destination = ours ? keys.cryptonote_address() : other_keys.cryptonote_address(),
+            .amount = crypto::rand<rct::xmr_amount>(),
+            .randomness = gen_janus_anchor()
+        };
+
+        RCTOutputEnoteProposal enote_proposal;
+        encrypted_payment_id_t encrypted_payment_id;
+        get_output_proposal_normal_v1(proposal,
+            i < 3 ? tx_first_key_image : rct::rct2ki(rct::pkGen()),
+            nullptr, // s_view_balance_dev
+            enote_proposal,
+            encrypted_payment_id);
+
+        enotes.push_back(enote_proposal.enote);
+        amounts.push_back(proposal.amount);
+        is_ours.push_back(ours);
+    }
+
+    std::vector<std::optional<CarrotEnoteExternalScanResultV1>> results;
+    try_scan_carrot_enotes_external_receiver(epee::to_span(enotes),
+        std::nullopt,
+        {&keys.carrot_account_spend_pubkey, 1},
+        keys.k_view_incoming_dev,
+        results);
+
+    ASSERT_EQ(enotes.size(), results.size());
+    for (size_t i = 0; i < enotes.size(); ++i)
+    {
+        ASSERT_EQ(is_ours[i], bool(results[i]));
+        if (!is_ours[i])
+            continue;
+
+        EXPECT_EQ(keys.carrot_account_spend_pubkey, results[i]->address_spend_pubkey);
+        EXPECT_EQ(amounts[i], results[i]->amount);
+        EXPECT_EQ(null_payment_id, results[i]->payment_id);
+        EXPECT_EQ(CarrotEnoteType::PAYMENT, results[i]->enote_type);
+        EXPECT_TRUE(keys.can_open_fcmp_onetime_address(results[i]->address_spend_pubkey,
+            results[i]->sender_extension_g,
+            results[i]->sender_extension_t,
+            enotes[i].onetime_address));
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
 TEST(carrot_core, keys_opening_for_main_address)
 {
     mock::mock_carrot_and_legacy_keys keys;
@@ -1784,3 +1978,58 @@ TEST(carrot_core, janus_protection_use_readjusted_spend_pubkey_in_ephemeral_priv
         sizeof(output_enote1.enote_ephemeral_pubkey)));
 }
 //----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_core, subaddress_lookup_table_round_trip)
+{
+    std::unordered_map<crypto::public_key, subaddress_index_extended> entries;
+    for (std::uint32_t major = 0; major < 10; ++major)
+        for (std::uint32_t minor = 0; minor < 50; ++minor)
+            entries.insert({rct::rct2pk(rct::pkGen()),
+                {{major, minor}, minor % 2 ? AddressDeriveType::Carrot : AddressDeriveType::PreCarrot, minor == 7}});
+
+    const crypto::secret_key k_view = rct::rct2sk(rct::skGen());
+    crypto::secret_key table_key;
+    make_subaddress_lookup_table_key(k_view, table_key);
+    const subaddress_lookup_table::fingerprint_t fingerprint{250, 3, 10, 50};
+
+    const boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    ASSERT_TRUE(subaddress_lookup_table::write(path.string(), entries, table_key, fingerprint));
+
+    {
+        const auto table = subaddress_lookup_table::open(path.string(), table_key, fingerprint);
+        ASSERT_NE(nullptr, table);
+        ASSERT_EQ(entries.size(), table->size());
+
+        for (const auto &entry : entries)
+        {
+            const std::optional<subaddress_index_extended> found = table->find(entry.first);
+            ASSERT_TRUE(found);
+            EXPECT_EQ(entry.second, *found);
+        }
+        EXPECT_FALSE(table->find(rct::rct2pk(rct::pkGen())));
+
+        std::size_t n_visited = 0;
+        table->for_each([&](const crypto::public_key &address_spend_pubkey, const subaddress_index_extended &subaddr_index)
+        {
+            ASSERT_EQ(1, entries.count(address_spend_pubkey));
+            EXPECT_EQ(entries.at(address_spend_pubkey), subaddr_index);
+            ++n_visited;
+        });
+        EXPECT_EQ(entries.size(), n_visited);
+
+        // the stored keys are masked
+        std::string contents;
+        ASSERT_TRUE(epee::file_io_utils::load_file_to_string(path.string(), contents));
+        const crypto::public_key &some_pubkey = entries.begin()->first;
+        EXPECT_EQ(std::string::npos, contents.find(std::string(some_pubkey.data, sizeof(some_pubkey.data))));
+    }
+
+    // another account's key or a stale fingerprint is refused
+    crypto::secret_key other_table_key;
+    make_subaddress_lookup_table_key(rct::rct2sk(rct::skGen()), other_table_key);
+    EXPECT_EQ(nullptr, subaddress_lookup_table::open(path.string(), other_table_key, fingerprint));
+    EXPECT_EQ(nullptr, subaddress_lookup_table::open(path.string(), table_key, {251, 3, 10, 50}));
+
+    boost::filesystem::remove(path);
+    EXPECT_EQ(nullptr, subaddress_lookup_table::open(path.string(), table_key, fingerprint));
+}
+//----------------------------------------------------------------------------------------------------------------------
@@ -1176,6 +1176,30 @@ TEST(carrot_impl, multi_account_transfer_over_transaction_16)
     subtest_multi_account_transfer_over_transaction(tx_proposal);
 }
 //----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_impl, get_carrot_fee_per_input_count_matches_estimate)
+{
+    const rct::xmr_amount fee_per_weight = 314159;
+    const rct::xmr_amount fee_quantization_mask = 10000;
+    for (size_t n_outputs = CARROT_MIN_TX_OUTPUTS; n_outputs <= CARROT_MAX_TX_OUTPUTS; ++n_outputs)
+    {
+        const size_t tx_extra_size = get_carrot_default_tx_extra_size(n_outputs) + n_outputs;
+        // second round is served from the memoized weights
+        for (int round = 0; round < 2; ++round)
+        {
+            const std::map<size_t, rct::xmr_amount> fee_per_input_count = get_carrot_fee_per_input_count(n_outputs,
+                tx_extra_size,
+                fee_per_weight,
+                fee_quantization_mask);
+            ASSERT_EQ(CARROT_MAX_TX_INPUTS - CARROT_MIN_TX_INPUTS + 1, fee_per_input_count.size());
+            for (const auto &e : fee_per_input_count)
+            {
+                EXPECT_EQ(estimate_fee_carrot(e.first, 15, n_outputs, tx_extra_size, true, true, true, true,
+                    fee_per_weight, fee_quantization_mask), e.second);
+            }
+        }
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
 TEST(carrot_impl, make_single_transfer_input_selector_not_enough_money_1)
 {
     // no input candidates, should throw `not_enough_money`
@@ -1529,3 +1553,96 @@ TEST(carrot_impl, make_single_transfer_input_selector_greedy_aging_3)
     ASSERT_EQ(std::set<size_t>({0, 1, 2, 4}), selected_input_indices);
 }
 //----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_impl, select_greedy_aging_replaces_newest_from_amount_sorted_candidates)
+{
+    // Candidates in ascending amount order, as wallet2 provides them from its unspent transfer index.
+    // The largest input alone pays, but an older input with enough money should replace it
+
+    const std::vector<InputCandidate> input_candidates = {
+        InputCandidate {
+            .core = CarrotSelectedInput {
+                .amount = 300,
+                .key_image = mock::gen_key_image(),
+            },
+            .is_pre_carrot = false,
+            .is_external = false,
+            .block_index = 10
+        },
+        InputCandidate {
+            .core = CarrotSelectedInput {
+                .amount = 400,
+                .key_image = mock::gen_key_image(),
+            },
+            .is_pre_carrot = false,
+            .is_external = false,
+            .block_index = 20
+        },
+        InputCandidate {
+            .core = CarrotSelectedInput {
+                .amount = 1000,
+                .key_image = mock::gen_key_image(),
+            },
+            .is_pre_carrot = false,
+            .is_external = false,
+            .block_index = 90
+        }
+    };
+
+    std::set<size_t> selected_input_indices;
+    carrot::ispolicy::select_greedy_aging(epee::to_span(input_candidates),
+        /*selectable_inputs=*/{0, 1, 2},
+        /*n_inputs=*/1,
+        /*required_money=*/250,
+        selected_input_indices);
+
+    ASSERT_EQ(std::set<size_t>{0}, selected_input_indices);
+}
+//----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_impl, select_branch_and_bound_least_surplus)
+{
+    const std::vector<rct::xmr_amount> amounts = {500, 100, 450, 300, 200};
+    std::vector<InputCandidate> input_candidates;
+    for (const rct::xmr_amount amount : amounts)
+    {
+        input_candidates.push_back(InputCandidate {
+            .core = CarrotSelectedInput {
+                .amount = amount,
+                .key_image = mock::gen_key_image(),
+            },
+            .is_pre_carrot = false,
+            .is_external = false,
+            .block_index = 10
+        });
+    }
+    const std::set<size_t> selectable_inputs = {0, 1, 2, 3, 4};
+
+    // 450 + 200 is the only pair within 10 of 640
+    std::set<size_t> selected_input_indices;
+    carrot::ispolicy::select_branch_and_bound(epee::to_span(input_candidates),
+        selectable_inputs,
+        /*n_inputs=*/2,
+        /*required_money=*/640,
+        selected_input_indices);
+    EXPECT_EQ(std::set<size_t>({2, 4}), selected_input_indices);
+
+    // exact match with 3 inputs: 500 + 300 + 200 or 500 + 450 + 100 -> either sums to 1000
+    carrot::ispolicy::select_branch_and_bound(epee::to_span(input_candidates),
+        selectable_inputs,
+        /*n_inputs=*/3,
+        /*required_money=*/1000,
+        selected_input_indices);
+    ASSERT_EQ(3, selected_input_indices.size());
+    rct::xmr_amount selected_sum = 0;
+    for (const size_t idx : selected_input_indices)
+        selected_sum += input_candidates.at(idx).core.amount;
+    EXPECT_EQ(1000, selected_sum);
+
+    // not enough money in the 2 largest inputs
+    carrot::ispolicy::select_branch_and_bound(epee::to_span(input_candidates),
+        selectable_inputs,
+        /*n_inputs=*/2,
+        /*required_money=*/951,
+        selected_input_indices);
+    EXPECT_TRUE(selected_input_indices.empty());
+}
+//----------------------------------------------------------------------------------------------------------------------
@@ -383,3 +383,50 @@ TEST(carrot_sparc, get_spend_authority_proof_completeness)
   // Verify the proof
   EXPECT_TRUE(carrot::verify_sparc_spend_authority_proof(proof, K_o));
 }
+//----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_sparc, get_spend_authority_proof_challenge_is_hash_of_keys)
+{
+  rct::zk_proof proof;
+  const rct::key x = rct::skGen();
+  const rct::key y = rct::skGen();
+  const rct::key K_o = rct::addKeys(rct::scalarmultBase(x), rct::scalarmultKey(rct::pk2rct(crypto::get_T()), y));
+  carrot::make_sparc_spend_authority_proof(x, y, K_o, proof);
+
+  // proofs must keep checking against c = H_n(R || K_o) computed over a key vector
+  const rct::key c = rct::hash_to_scalar(rct::keyV{proof.R, K_o});
+  const rct::key resZ = rct::addKeys(rct::scalarmultBase(proof.z1), rct::scalarmultKey(rct::pk2rct(crypto::get_T()), proof.z2));
+  const rct::key resC = rct::addKeys(proof.R, rct::scalarmultKey(K_o, c));
+  EXPECT_TRUE(rct::equalKeys(resZ, resC));
+}
+//----------------------------------------------------------------------------------------------------------------------
+TEST(carrot_sparc, return_output_map_insert_remove)
+{
+  carrot::carrot_and_legacy_account alice;
+  alice.generate();
+  const auto &return_map = alice.get_return_output_map_ref();
+
+  const crypto::public_key K_r_1 = rct::rct2pk(rct::pkGen());
+  const crypto::public_key K_r_2 = rct::rct2pk(rct::pkGen());
+  const crypto::public_key K_o_other = rct::rct2pk(rct::pkGen());
+  EXPECT_EQ(0, return_map.count(K_r_1));
+
+  alice.insert_return_output_info({{K_r_1, {}}, {K_r_2, {}}});
+  EXPECT_EQ(1, return_map.count(K_r_1));
+  EXPECT_EQ(1, return_map.count(K_r_2));
+  EXPECT_EQ(0, return_map.count(K_o_other));
+
+  // deferred entries only show up once applied
+  const crypto::public_key K_r_3 = rct::rct2pk(rct::pkGen());
+  alice.set_defer_inserts(true);
+  alice.insert_return_output_info({{K_r_3, {}}});
+  EXPECT_EQ(0, return_map.count(K_r_3));
+  alice.set_defer_inserts(false);
+  EXPECT_EQ(1, return_map.count(K_r_3));
+
+  // removing a spent return ignores unknown keys
+  alice.remove_return_output_info({K_r_1, K_o_other});
+  EXPECT_EQ(0, return_map.count(K_r_1));
+  EXPECT_EQ(1, return_map.count(K_r_2));
+  EXPECT_EQ(2, return_map.size());
+}
+
@@ -164,3 +164,27 @@ TEST(checkpoints_is_alternative_block_allowed, handles_two_and_more_checkpoints)
   ASSERT_TRUE (cp.is_alternative_block_allowed(11, 10));
   ASSERT_TRUE (cp.is_alternative_block_allowed(11, 11));
 }
+
+TEST(checkpoints_load_checkpoints_from_dns_records, parses_valid_records)
+{
+  checkpoints cp;
+  const std::vector<std::string> records = {
+    "5:0000000000000000000000000000000000000000000000000000000000000001",
+    "not a checkpoint",
+    "x:0000000000000000000000000000000000000000000000000000000000000002",
+    "7:not a hash",
+    "9:0000000000000000000000000000000000000000000000000000000000000003"
+  };
+  ASSERT_TRUE(cp.load_checkpoints_from_dns_records(records));
+  ASSERT_EQ(2, cp.get_points().size());
+  ASSERT_TRUE(cp.is_in_checkpoint_zone(9));
+  ASSERT_FALSE(cp.is_in_checkpoint_zone(10));
+}
+
+TEST(checkpoints_load_checkpoints_from_dns_records, rejects_conflicts)
+{
+  checkpoints cp;
+  ASSERT_TRUE(cp.add_checkpoint(5, "0000000000000000000000000000000000000000000000000000000000000000"));
+  ASSERT_FALSE(cp.load_checkpoints_from_dns_records({"5:0000000000000000000000000000000000000000000000000000000000000001"}));
+  ASSERT_TRUE(cp.load_checkpoints_from_dns_records({"5:0000000000000000000000000000000000000000000000000000000000000000"}));
+}
@@ -104,6 +104,29 @@ TEST(Crypto, verify_32)
   }
 }
 
+TEST(Crypto, batch_key_images)
+{
+  static const size_t N = 17;
+  std::vector<crypto::public_key> pubs(N);
+  std::vector<crypto::secret_key> secs(N);
+  for (size_t i = 0; i < N; ++i)
+    crypto::generate_keys(pubs[i], secs[i]);
+
+  std::vector<crypto::key_image> images(N);
+  crypto::generate_key_images(pubs.data(), secs.data(), N, images.data());
+  for (size_t i = 0; i < N; ++i)
+  {
+    crypto::key_image expected;
+    crypto::generate_key_image(pubs[i], secs[i], expected);
+    ASSERT_EQ(images[i], expected);
+  }
+
+  crypto::key_image single;
+  crypto::generate_key_images(pubs.data(), secs.data(), 1, &single);
+  ASSERT_EQ(single, images[0]);
+  crypto::generate_key_images(pubs.data(), secs.data(), 0, nullptr);
+}
+
 TEST(Crypto, tree_branch)
 {
   crypto::hash inputs[6];
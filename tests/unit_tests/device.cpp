@@ -129,3 +129,33 @@ TEST(device, ecdh32)
   ASSERT_EQ(tuple2.amount, tuple.amount);
 }
 
+
+TEST(device, batched_derivations)
+{
+  hw::core::device_default dev;
+  const rct::key sk = rct::skGen();
+  std::vector<crypto::public_key> pubs;
+  for (int i = 0; i < 5; ++i)
+    pubs.push_back(rct::rct2pk(rct::pkGen()));
+
+  std::vector<crypto::key_derivation> derivations;
+  ASSERT_TRUE(dev.generate_key_derivations(epee::to_span(pubs), rct::rct2sk(sk), derivations));
+  ASSERT_EQ(derivations.size(), pubs.size());
+  for (size_t i = 0; i < pubs.size(); ++i)
+  {
+    crypto::key_derivation der;
+    ASSERT_TRUE(dev.generate_key_derivation(pubs[i], rct::rct2sk(sk), der));
+    ASSERT_FALSE(memcmp(&derivations[i], &der, sizeof(der)));
+  }
+
+  const std::vector<std::size_t> output_indices = {0, 1, 7, 3};
+  std::vector<crypto::view_tag> view_tags;
+  ASSERT_TRUE(dev.derive_view_tags(derivations[0], epee::to_span(output_indices), view_tags));
+  ASSERT_EQ(view_tags.size(), output_indices.size());
+  for (size_t i = 0; i < output_indices.size(); ++i)
+  {
+    crypto::view_tag view_tag;
+    crypto::derive_view_tag(derivations[0], output_indices[i], view_tag);
+    ASSERT_EQ(view_tags[i], view_tag);
+  }
+}
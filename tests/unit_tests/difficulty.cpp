@@ -72,3 +72,46 @@ TEST(difficulty, check_hash)
   ASSERT_TRUE(cryptonote::check_hash(MKHASH(0xffffffffffffffff, 1), MKDIFF(0xffffffffffffffff, 1)));
   ASSERT_FALSE(cryptonote::check_hash(MKHASH(0xffffffffffffffff, 1), MKDIFF(0xffffffffffffffff, 2)));
 }
+
+TEST(difficulty, window)
+{
+  cryptonote::difficulty_window window;
+  window.reset(10);
+  ASSERT_TRUE(window.empty());
+  ASSERT_EQ(window.end_height(), 10);
+
+  for (uint64_t h = 10; h < 20; ++h)
+    window.push_back(1000 + h, h * 7, crypto::hash{{(char)h}});
+  ASSERT_EQ(window.size(), 10);
+  ASSERT_EQ(window.start_height(), 10);
+  ASSERT_EQ(window.end_height(), 20);
+
+  window.pop_front();
+  window.push_front(1010, 10 * 7, crypto::hash{{10}});
+  window.push_front(1009, 9 * 7, crypto::hash{{9}});
+  window.push_front(1008, 8 * 7, crypto::hash{{8}});
+  ASSERT_EQ(window.start_height(), 8);
+  ASSERT_EQ(window.top_hash(), crypto::hash{{19}});
+
+  ASSERT_TRUE(window.covers(8, 20));
+  ASSERT_TRUE(window.covers(12, 12));
+  ASSERT_FALSE(window.covers(7, 12));
+  ASSERT_FALSE(window.covers(12, 21));
+
+  std::vector<uint64_t> timestamps;
+  std::vector<cryptonote::difficulty_type> difficulties;
+  window.copy(12, 15, timestamps, difficulties);
+  ASSERT_EQ(timestamps, std::vector<uint64_t>({1012, 1013, 1014}));
+  ASSERT_EQ(difficulties.size(), 3);
+  ASSERT_EQ(difficulties[0], 12 * 7);
+  ASSERT_EQ(difficulties[2], 14 * 7);
+
+  window.truncate(16);
+  ASSERT_EQ(window.end_height(), 16);
+  ASSERT_EQ(window.top_hash(), crypto::hash{{15}});
+  window.truncate(30);
+  ASSERT_EQ(window.end_height(), 16);
+  window.truncate(4);
+  ASSERT_TRUE(window.empty());
+  ASSERT_EQ(window.start_height(), 4);
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "crypto/crypto.h"
+#include "cryptonote_core/enote_stream.h"
+
+namespace
+{
+  cryptonote::light_wallet_output make_output(uint64_t height, uint64_t amount)
+  {
+    cryptonote::light_wallet_output output;
+    output.tx_hash = crypto::rand<crypto::hash>();
+    output.height = height;
+    output.timestamp = 1700000000 + height;
+    output.local_output_index = height % 3;
+    output.onetime_address = crypto::rand<crypto::public_key>();
+    output.address_spend_pubkey = crypto::rand<crypto::public_key>();
+    output.amount = amount;
+    output.asset_type = "SAL1";
+    output.payment_id = crypto::rand<carrot::payment_id_t>();
+    output.coinbase = height % 2 == 0;
+    return output;
+  }
+
+  void expect_equal(const cryptonote::light_wallet_output &a, const cryptonote::light_wallet_output &b)
+  {
+    EXPECT_EQ(a.tx_hash, b.tx_hash);
+    EXPECT_EQ(a.height, b.height);
+    EXPECT_EQ(a.timestamp, b.timestamp);
+    EXPECT_EQ(a.local_output_index, b.local_output_index);
+    EXPECT_EQ(a.onetime_address, b.onetime_address);
+    EXPECT_EQ(a.address_spend_pubkey, b.address_spend_pubkey);
+    EXPECT_EQ(a.amount, b.amount);
+    EXPECT_EQ(a.asset_type, b.asset_type);
+    EXPECT_EQ(a.payment_id, b.payment_id);
+    EXPECT_EQ(a.coinbase, b.coinbase);
+  }
+}
+
+TEST(enote_stream, round_trip)
+{
+  const std::vector<cryptonote::light_wallet_output> written{make_output(10, 5), make_output(11, 7)};
+  const crypto::hash top_id = crypto::rand<crypto::hash>();
+
+  std::stringstream ss;
+  cryptonote::enote_stream::write_header(ss);
+  for (const auto &output: written)
+    cryptonote::enote_stream::write_enote(ss, output);
+  cryptonote::enote_stream::write_scanned(ss, 12, top_id);
+
+  std::vector<cryptonote::light_wallet_output> outputs;
+  uint64_t scanned_height;
+  crypto::hash scanned_id;
+  ASSERT_TRUE(cryptonote::enote_stream::read(ss, outputs, scanned_height, scanned_id));
+  ASSERT_EQ(outputs.size(), written.size());
+  for (size_t i = 0; i < outputs.size(); ++i)
+    expect_equal(outputs[i], written[i]);
+  EXPECT_EQ(scanned_height, 12);
+  EXPECT_EQ(scanned_id, top_id);
+}
+
+TEST(enote_stream, rollback_drops_outputs_from_height)
+{
+  const cryptonote::light_wallet_output kept = make_output(10, 1), dropped = make_output(20, 2), replacement = make_output(20, 3);
+
+  std::stringstream ss;
+  cryptonote::enote_stream::write_header(ss);
+  cryptonote::enote_stream::write_enote(ss, kept);
+  cryptonote::enote_stream::write_enote(ss, dropped);
+  cryptonote::enote_stream::write_scanned(ss, 30, crypto::rand<crypto::hash>());
+  cryptonote::enote_stream::write_rollback(ss, 15);
+
+  std::vector<cryptonote::light_wallet_output> outputs;
+  uint64_t scanned_height;
+  crypto::hash scanned_id;
+  {
+    std::stringstream in(ss.str());
+    ASSERT_TRUE(cryptonote::enote_stream::read(in, outputs, scanned_height, scanned_id));
+    ASSERT_EQ(outputs.size(), 1);
+    expect_equal(outputs[0], kept);
+    EXPECT_EQ(scanned_height, 15);
+    EXPECT_EQ(scanned_id, crypto::null_hash);
+  }
+
+  cryptonote::enote_stream::write_enote(ss, replacement);
+  ASSERT_TRUE(cryptonote::enote_stream::read(ss, outputs, scanned_height, scanned_id));
+  ASSERT_EQ(outputs.size(), 2);
+  expect_equal(outputs[1], replacement);
+}
+
+TEST(enote_stream, partial_record_and_bad_header)
+{
+  std::stringstream ss;
+  cryptonote::enote_stream::write_header(ss);
+  cryptonote::enote_stream::write_enote(ss, make_output(10, 1));
+  cryptonote::enote_stream::write_enote(ss, make_output(11, 1));
+
+  // a record still being appended is left for the next read
+  std::string truncated = ss.str();
+  truncated.resize(truncated.size() - 5);
+  std::stringstream partial(truncated);
+  std::vector<cryptonote::light_wallet_output> outputs;
+  uint64_t scanned_height;
+  crypto::hash scanned_id;
+  ASSERT_TRUE(cryptonote::enote_stream::read(partial, outputs, scanned_height, scanned_id));
+  EXPECT_EQ(outputs.size(), 1);
+
+  std::string bad_magic = ss.str();
+  bad_magic[0] = 'X';
+  std::stringstream bad(bad_magic);
+  EXPECT_FALSE(cryptonote::enote_stream::read(bad, outputs, scanned_height, scanned_id));
+
+  cryptonote::light_wallet_output long_asset = make_output(12, 1);
+  long_asset.asset_type = "TOOLONGASSET";
+  EXPECT_THROW(cryptonote::enote_stream::write_enote(ss, long_asset), std::runtime_error);
+}
@@ -34,6 +34,7 @@
 #include <boost/thread/mutex.hpp>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #include "gtest/gtest.h"
 
@@ -135,6 +136,43 @@ TEST(boosted_tcp_server, worker_threads_are_exception_resistant)
   ASSERT_TRUE(srv.deinit_server());
 }
 
+TEST(boosted_tcp_server, io_loops_share_incoming_connections)
+{
+  test_tcp_server srv(epee::net_utils::e_connection_type_RPC);
+  ASSERT_TRUE(srv.set_io_loops(2));
+  ASSERT_TRUE(srv.init_server(test_server_port, test_server_host));
+  ASSERT_FALSE(srv.set_io_loops(3));
+  ASSERT_TRUE(srv.run_server(2, false));
+
+  boost::asio::io_context io_context;
+  const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address(test_server_host), test_server_port);
+  std::vector<boost::asio::ip::tcp::socket> sockets;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    sockets.emplace_back(io_context);
+    sockets.back().connect(endpoint);
+  }
+
+  std::vector<test_tcp_server::io_loop_stats> stats;
+  for (size_t i = 0; i < 500; ++i)
+  {
+    stats = srv.get_io_loop_stats();
+    ASSERT_EQ(2, stats.size());
+    if (stats[0].accepted + stats[1].accepted == 4)
+      break;
+    epee::misc_utils::sleep_no_w(10);
+  }
+  // each accept goes to the loop with the fewest live connections
+  EXPECT_EQ(2, stats[0].accepted);
+  EXPECT_EQ(2, stats[1].accepted);
+  EXPECT_EQ(2, stats[0].connections);
+  EXPECT_EQ(2, stats[1].connections);
+
+  sockets.clear();
+  srv.send_stop_signal();
+  ASSERT_TRUE(srv.timed_wait_server_stop(5 * 1000));
+  ASSERT_TRUE(srv.deinit_server());
+}
 
 TEST(test_epee_connection, test_lifetime)
 {
@@ -581,6 +619,52 @@ TEST(test_epee_connection, ssl_handshake)
     workers.back().join();
 }
 
+TEST(test_epee_connection, ssl_session_resumption)
+{
+  using socket_t = boost::asio::ip::tcp::socket;
+  using ssl_socket_t = boost::asio::ssl::stream<socket_t>;
+  using ssl_options_t = epee::net_utils::ssl_options_t;
+
+  ssl_options_t server_options{epee::net_utils::ssl_support_t::e_ssl_support_enabled};
+  server_options.verification = epee::net_utils::ssl_verification_t::none;
+  server_options.session_resumption = true;
+  ssl_options_t client_options{epee::net_utils::ssl_support_t::e_ssl_support_enabled};
+  client_options.verification = epee::net_utils::ssl_verification_t::none;
+  auto server_context = server_options.create_context();
+  auto client_context = client_options.create_context();
+
+  boost::asio::io_context server_io_context;
+  boost::asio::io_context client_io_context;
+  boost::asio::ip::tcp::acceptor acceptor(server_io_context, {boost::asio::ip::make_address("127.0.0.1"), 0});
+  const auto before = epee::net_utils::get_ssl_handshake_stats();
+  std::shared_ptr<SSL_SESSION> session;
+  for (size_t i = 0; i < 3; ++i)
+  {
+    ssl_socket_t server_socket(server_io_context, server_context);
+    ssl_socket_t client_socket(client_io_context, client_context);
+    std::thread server([&]{
+      acceptor.accept(server_socket.next_layer());
+      EXPECT_TRUE(server_options.handshake(server_io_context, server_socket, ssl_socket_t::server));
+      // tls 1.3 tickets are only read by the client along with application data
+      char c = 'x';
+      boost::asio::write(server_socket, boost::asio::buffer(&c, 1));
+    });
+    client_socket.next_layer().connect(acceptor.local_endpoint());
+    if (session)
+      SSL_set_session(client_socket.native_handle(), session.get());
+    EXPECT_TRUE(client_options.handshake(client_io_context, client_socket, ssl_socket_t::client));
+    char c;
+    boost::asio::read(client_socket, boost::asio::buffer(&c, 1));
+    server.join();
+    EXPECT_EQ(i > 0, bool(SSL_session_reused(client_socket.native_handle())));
+    // a copy, the session is no longer resumable once the connection is dropped without close_notify
+    session.reset(SSL_SESSION_dup(SSL_get_session(client_socket.native_handle())), SSL_SESSION_free);
+  }
+  const auto after = epee::net_utils::get_ssl_handshake_stats();
+  EXPECT_EQ(2 * 1, after.full - before.full);
+  EXPECT_EQ(2 * 2, after.resumed - before.resumed);
+  EXPECT_EQ(0, after.failed - before.failed);
+}
 
 TEST(boosted_tcp_server, strand_deadlock)
 {
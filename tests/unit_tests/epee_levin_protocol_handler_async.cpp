@@ -637,6 +637,16 @@ TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, handles_unexpe
   ASSERT_FALSE(m_conn->m_protocol_handler.handle_recv(m_buf.data(), m_buf.size()));
 }
 
+TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, handles_unnegotiated_compression)
+{
+  m_req_head.m_flags = SWAP32LE(LEVIN_PACKET_REQUEST | LEVIN_PACKET_COMPRESSED);
+  prepare_buf();
+
+  ASSERT_FALSE(m_conn->m_protocol_handler.handle_recv(m_buf.data(), m_buf.size()));
+  ASSERT_EQ(0u, m_commands_handler.invoke_counter());
+  ASSERT_EQ(0u, m_commands_handler.notify_counter());
+}
+
 TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, handles_short_fragment)
 {
   m_req_head.m_cb = 1;
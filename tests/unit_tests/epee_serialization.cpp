@@ -30,7 +30,10 @@
 #include <cstdint>
 #include <gtest/gtest.h>
 
+#include "serialization/keyvalue_serialization.h"
 #include "storages/portable_storage.h"
+#include "storages/portable_storage_from_json.h"
+#include "storages/portable_storage_template_helper.h"
 #include "span.h"
 
 TEST(epee_binary, two_keys)
@@ -54,3 +57,126 @@ TEST(epee_binary, duplicate_key)
   epee::serialization::portable_storage storage{};
   EXPECT_FALSE(storage.load_from_binary(data));
 }
+
+namespace
+{
+  struct ps_inner
+  {
+    std::string name;
+    std::vector<uint32_t> values;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(name)
+      KV_SERIALIZE(values)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct ps_outer
+  {
+    std::vector<uint64_t> heights;
+    std::vector<std::string> blobs;
+    std::vector<ps_inner> inner;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(heights)
+      KV_SERIALIZE(blobs)
+      KV_SERIALIZE(inner)
+    END_KV_SERIALIZE_MAP()
+  };
+}
+
+TEST(epee_binary, arrays_round_trip)
+{
+  ps_outer out;
+  out.heights = {0, 1, 0xffffffffffffffff};
+  out.blobs = {"", "a", std::string(300, 'x')};
+  out.inner.resize(3);
+  out.inner[1].name = "second";
+  out.inner[2].values = {7, 8, 9};
+
+  epee::byte_slice blob;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(out, blob));
+
+  ps_outer in;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(in, epee::to_span(blob)));
+  EXPECT_EQ(in.heights, out.heights);
+  EXPECT_EQ(in.blobs, out.blobs);
+  ASSERT_EQ(in.inner.size(), out.inner.size());
+  for (size_t i = 0; i < in.inner.size(); ++i)
+  {
+    EXPECT_EQ(in.inner[i].name, out.inner[i].name);
+    EXPECT_EQ(in.inner[i].values, out.inner[i].values);
+  }
+
+  // truncating the blob anywhere inside the arrays must fail cleanly
+  ps_outer truncated;
+  EXPECT_FALSE(epee::serialization::load_t_from_binary(truncated, epee::span<const uint8_t>(blob.data(), blob.size() - 3)));
+}
+
+namespace
+{
+  struct ps_json
+  {
+    int64_t negative;
+    uint64_t big;
+    double real;
+    bool flag;
+    std::string text;
+    std::string skipped;
+    ps_outer outer;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(negative)
+      KV_SERIALIZE(big)
+      KV_SERIALIZE(real)
+      KV_SERIALIZE(flag)
+      KV_SERIALIZE(text)
+      KV_SERIALIZE_OPT(skipped, std::string("default"))
+      KV_SERIALIZE(outer)
+    END_KV_SERIALIZE_MAP()
+  };
+}
+
+TEST(epee_json, load_values)
+{
+  ps_json in;
+  ASSERT_TRUE(epee::serialization::load_t_from_json(in,
+    "{\"negative\": -5, \"big\": 18446744073709551615, \"real\": 1.5e1, \"flag\": true,"
+    " \"text\": \"a\\\"b\\u00e9\", \"skipped\": null, \"outer\": {\"heights\": [1, 2, 3], \"blobs\": [],"
+    " \"inner\": [{\"name\": \"first\", \"values\": [4]}, {\"values\": [5, 6]}]}}"));
+  EXPECT_EQ(in.negative, -5);
+  EXPECT_EQ(in.big, 0xffffffffffffffff);
+  EXPECT_EQ(in.real, 15.0);
+  EXPECT_TRUE(in.flag);
+  EXPECT_EQ(in.text, "a\"b\xc3\xa9");
+  EXPECT_EQ(in.skipped, "default");
+  EXPECT_EQ(in.outer.heights, (std::vector<uint64_t>{1, 2, 3}));
+  EXPECT_TRUE(in.outer.blobs.empty());
+  ASSERT_EQ(in.outer.inner.size(), 2);
+  EXPECT_EQ(in.outer.inner[0].name, "first");
+  EXPECT_EQ(in.outer.inner[0].values, (std::vector<uint32_t>{4}));
+  EXPECT_EQ(in.outer.inner[1].values, (std::vector<uint32_t>{5, 6}));
+}
+
+TEST(epee_json, reject_invalid)
+{
+  epee::serialization::portable_storage ps;
+  EXPECT_FALSE(ps.load_from_json("[1, 2]"));
+  EXPECT_FALSE(ps.load_from_json("\"text\""));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": [[1]]}"));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": [1, \"b\"]}"));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": [1, -1]}"));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": [null]}"));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": 18446744073709551616}"));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": 1,}"));
+  EXPECT_FALSE(ps.load_from_json("{\"a\": 1"));
+  EXPECT_FALSE(ps.load_from_json(std::string("{\"a\": 1}\0{\"b\": 2}", 17)));
+  EXPECT_FALSE(ps.load_from_json(std::string("{\"a\": \"x\0y\"}", 12)));
+
+  std::string deep;
+  for (size_t i = 0; i <= EPEE_JSON_RECURSION_LIMIT_INTERNAL; ++i)
+    deep += "{\"a\":";
+  deep += "1" + std::string(EPEE_JSON_RECURSION_LIMIT_INTERNAL + 1, '}');
+  EXPECT_FALSE(ps.load_from_json(deep));
+  EXPECT_TRUE(ps.load_from_json(deep.substr(5, deep.size() - 6)));
+}
@@ -1729,6 +1729,27 @@ TEST(net_buffer, move)
   ASSERT_TRUE(!memcmp(span.data() + 1, std::string(4000, '0').c_str(), 4000));
 }
 
+TEST(net_buffer, reserve)
+{
+  epee::net_utils::buffer buf;
+
+  buf.append(std::string(400, ' ').c_str(), 400);
+  buf.erase(300);
+  buf.reserve(20000);
+  ASSERT_EQ(buf.size(), 100);
+  const uint8_t *data = buf.span(100).data();
+  buf.append(std::string(19900, '0').c_str(), 19900);
+  ASSERT_EQ(buf.size(), 20000);
+  epee::span<const uint8_t> span = buf.span(20000);
+  ASSERT_EQ(span.data(), data);
+  ASSERT_TRUE(!memcmp(span.data(), std::string(100, ' ').c_str(), 100));
+  ASSERT_TRUE(!memcmp(span.data() + 100, std::string(19900, '0').c_str(), 19900));
+
+  buf.reserve(10);
+  ASSERT_EQ(buf.size(), 20000);
+  ASSERT_EQ(buf.span(20000).data(), data);
+}
+
 TEST(parsing, isspace)
 {
   ASSERT_FALSE(epee::misc_utils::parse::isspace(0));
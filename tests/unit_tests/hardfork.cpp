@@ -648,3 +648,91 @@ TEST(get, earliest_ideal_height)
     ASSERT_EQ(hf.get_earliest_ideal_height_for_version(10), std::numeric_limits<uint64_t>::max());
 }
 
+
+TEST(get, version_table)
+{
+    TestDB db;
+    HardFork hf(db, 1, 0, 1, 1, 1, 100);
+    oracle::asset_type_counts num_rct_outs_by_asset_type;
+    cryptonote::audit_block_info abi;
+    cryptonote::yield_block_info ybi;
+
+    //                 v  h   t
+    ASSERT_TRUE(hf.add_fork(1, 0, 0));
+    ASSERT_TRUE(hf.add_fork(2, 3, 1));
+    ASSERT_TRUE(hf.add_fork(3, 7, 2));
+    ASSERT_TRUE(hf.add_fork(4, 20, 3));
+    hf.init();
+
+    for (uint64_t h = 0; h < 30; ++h) {
+      db.add_block(mkblock(hf, h, hf.get_ideal_version(h)), 0, 0, 0, 0, 0, num_rct_outs_by_asset_type, crypto::hash(), 0, 0, 0, cryptonote::FAKECHAIN, ybi, abi);
+      ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
+    }
+    for (uint64_t h = 0; h < 30; ++h)
+      ASSERT_EQ(hf.get(h), db.get_hard_fork_version(h));
+    ASSERT_EQ(hf.get_current_version(), 4);
+
+    // a fresh instance rebuilds the table from the db
+    HardFork hf2(db, 1, 0, 1, 1, 1, 100);
+    ASSERT_TRUE(hf2.add_fork(1, 0, 0));
+    ASSERT_TRUE(hf2.add_fork(2, 3, 1));
+    ASSERT_TRUE(hf2.add_fork(3, 7, 2));
+    ASSERT_TRUE(hf2.add_fork(4, 20, 3));
+    hf2.init();
+    for (uint64_t h = 0; h < 30; ++h)
+      ASSERT_EQ(hf2.get(h), db.get_hard_fork_version(h));
+    ASSERT_EQ(hf2.get_current_version(), 4);
+
+    // popping blocks back past a fork drops it from the table
+    for (int n = 0; n < 12; ++n)
+      db.remove_block();
+    hf2.on_block_popped(12);
+    ASSERT_EQ(hf2.get_current_version(), 3);
+    for (uint64_t h = 18; h < 30; ++h) {
+      db.add_block(mkblock(hf2, h, 3), 0, 0, 0, 0, 0, num_rct_outs_by_asset_type, crypto::hash(), 0, 0, 0, cryptonote::FAKECHAIN, ybi, abi);
+      ASSERT_TRUE(hf2.add(db.get_block_from_height(h), h));
+    }
+    for (uint64_t h = 0; h < 30; ++h)
+      ASSERT_EQ(hf2.get(h), db.get_hard_fork_version(h));
+    ASSERT_EQ(hf2.get(25), 3);
+}
+
+TEST(get, blocks_added_elsewhere)
+{
+    TestDB db;
+    HardFork hf(db, 1, 0, 1, 1, 4, 50);
+    HardFork replica(db, 1, 0, 1, 1, 4, 50);
+    oracle::asset_type_counts num_rct_outs_by_asset_type;
+    cryptonote::audit_block_info abi;
+    cryptonote::yield_block_info ybi;
+
+    //                 v  h   t
+    ASSERT_TRUE(hf.add_fork(1, 0, 0));
+    ASSERT_TRUE(hf.add_fork(2, 3, 1));
+    ASSERT_TRUE(hf.add_fork(3, 7, 2));
+    ASSERT_TRUE(hf.add_fork(4, 20, 3));
+    hf.init();
+    ASSERT_TRUE(replica.add_fork(1, 0, 0));
+    ASSERT_TRUE(replica.add_fork(2, 3, 1));
+    ASSERT_TRUE(replica.add_fork(3, 7, 2));
+    ASSERT_TRUE(replica.add_fork(4, 20, 3));
+
+    db.add_block(mkblock(hf, 0, 1), 0, 0, 0, 0, 0, num_rct_outs_by_asset_type, crypto::hash(), 0, 0, 0, cryptonote::FAKECHAIN, ybi, abi);
+    ASSERT_TRUE(hf.add(db.get_block_from_height(0), 0));
+    replica.init();
+
+    // only the primary writes, the replica catches up in uneven steps
+    uint64_t seen = 1;
+    for (uint64_t h = 1; h < 30; ++h) {
+      db.add_block(mkblock(hf, h, hf.get_ideal_version(h)), 0, 0, 0, 0, 0, num_rct_outs_by_asset_type, crypto::hash(), 0, 0, 0, cryptonote::FAKECHAIN, ybi, abi);
+      ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
+      if (h % 3 == 0 || h == 29) {
+        replica.on_blocks_added(h + 1 - seen);
+        seen = h + 1;
+        ASSERT_EQ(replica.get_current_version(), hf.get_current_version());
+        for (uint64_t hh = 0; hh <= h; ++hh)
+          ASSERT_EQ(replica.get(hh), hf.get(hh));
+      }
+    }
+    ASSERT_EQ(replica.get_current_version(), 4);
+}
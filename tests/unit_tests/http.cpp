@@ -28,6 +28,7 @@
 
 #include "gtest/gtest.h"
 #include "net/http_auth.h"
+#include "net/http_server_handlers_map2.h"
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -743,3 +744,64 @@ TEST(HTTP, Add_Field)
 
   EXPECT_STREQ("leading textfoo: bar\r\nbar: foo\r\nmoarbars: moarfoo\r\n", str.c_str());
 }
+
+TEST(HTTP, JSON_RPC_Batch)
+{
+  EXPECT_TRUE(epee::json_rpc::is_batch(" \n[{}]"));
+  EXPECT_FALSE(epee::json_rpc::is_batch("{\"method\":\"a\"}"));
+  EXPECT_FALSE(epee::json_rpc::is_batch(""));
+
+  const auto handle_call = [](const http::http_request_info& query, http::http_response_info& response)
+  {
+    epee::serialization::portable_storage ps;
+    std::string method;
+    EXPECT_TRUE(ps.load_from_json(query.m_body));
+    EXPECT_TRUE(ps.get_value("method", method, nullptr));
+    EXPECT_EQ(query.m_URI, "/json_rpc");
+    response.m_body = "\"" + method + "\"";
+    return true;
+  };
+
+  http::http_request_info query;
+  http::http_response_info response;
+  query.m_URI = "/json_rpc";
+  query.m_body = "[{\"jsonrpc\":\"2.0\",\"id\":0,\"method\":\"a\"}, {\"jsonrpc\":\"2.0\",\"id\":\"x\",\"method\":\"b\",\"params\":{\"n\":1}}]";
+  ASSERT_TRUE(epee::json_rpc::handle_batch(query, response, handle_call));
+  EXPECT_EQ(response.m_body, "[\"a\",\"b\"]");
+
+  query.m_body = "[]";
+  ASSERT_TRUE(epee::json_rpc::handle_batch(query, response, handle_call));
+  EXPECT_NE(response.m_body.find("-32600"), std::string::npos);
+
+  query.m_body = "[{\"method\" \"a\"}]";
+  ASSERT_TRUE(epee::json_rpc::handle_batch(query, response, handle_call));
+  EXPECT_NE(response.m_body.find("-32700"), std::string::npos);
+
+  // entries which are not objects get an error each, the calls around them still run
+  query.m_body = "[1, {\"method\":\"a\",\"params\":{\"n\":[1,2],\"m\":{}}}, [], \"x\"]";
+  ASSERT_TRUE(epee::json_rpc::handle_batch(query, response, handle_call));
+  http::http_response_info invalid;
+  epee::json_rpc::store_batch_error(invalid, -32600, "Invalid Request");
+  EXPECT_EQ(response.m_body, "[" + invalid.m_body + ",\"a\"," + invalid.m_body + "," + invalid.m_body + "]");
+
+  query.m_body = "[";
+  for (size_t i = 0; i <= epee::json_rpc::max_batch_size; ++i)
+    query.m_body += std::string(i ? "," : "") + "{\"method\":\"a\"}";
+  query.m_body += "]";
+  ASSERT_TRUE(epee::json_rpc::handle_batch(query, response, handle_call));
+  EXPECT_NE(response.m_body.find("-32600"), std::string::npos);
+
+  const auto refuse_b = [&](const http::http_request_info& query, http::http_response_info& response)
+  {
+    if (query.m_body.find("\"b\"") == std::string::npos)
+      return handle_call(query, response);
+    response.m_response_code = 429;
+    response.m_response_comment = "Too Many Requests";
+    return true;
+  };
+  query.m_body = "[{\"method\":\"a\"},{\"method\":\"b\"},{\"method\":\"a\"}]";
+  ASSERT_TRUE(epee::json_rpc::handle_batch(query, response, refuse_b));
+  EXPECT_EQ(response.m_body.find("[\"a\",{"), 0u);
+  EXPECT_NE(response.m_body.find("Too Many Requests"), std::string::npos);
+  EXPECT_EQ(response.m_body.rfind(",\"a\"]"), response.m_body.size() - 5);
+}
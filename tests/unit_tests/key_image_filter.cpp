@@ -0,0 +1,85 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "blockchain_db/key_image_filter.h"
+
+TEST(key_image_filter, not_ready_answers_maybe)
+{
+  cryptonote::key_image_filter filter;
+  ASSERT_TRUE(filter.maybe_contains(crypto::rand<crypto::key_image>()));
+  filter.reset(1000);
+  ASSERT_FALSE(filter.is_ready());
+  ASSERT_TRUE(filter.maybe_contains(crypto::rand<crypto::key_image>()));
+}
+
+TEST(key_image_filter, no_false_negatives)
+{
+  cryptonote::key_image_filter filter;
+  filter.reset(1000);
+  std::vector<crypto::key_image> images(1000);
+  for (auto &ki: images)
+  {
+    ki = crypto::rand<crypto::key_image>();
+    filter.insert(ki);
+  }
+  filter.set_ready();
+  ASSERT_EQ(filter.size(), images.size());
+  for (const auto &ki: images)
+    ASSERT_TRUE(filter.maybe_contains(ki));
+}
+
+TEST(key_image_filter, rejects_most_misses)
+{
+  cryptonote::key_image_filter filter;
+  filter.reset(10000);
+  for (size_t i = 0; i < 10000; ++i)
+    filter.insert(crypto::rand<crypto::key_image>());
+  filter.set_ready();
+  size_t false_positives = 0;
+  for (size_t i = 0; i < 10000; ++i)
+    false_positives += filter.maybe_contains(crypto::rand<crypto::key_image>());
+  ASSERT_LT(false_positives, 100);
+}
+
+TEST(key_image_filter, clear)
+{
+  cryptonote::key_image_filter filter;
+  filter.reset(1000);
+  const crypto::key_image ki = crypto::rand<crypto::key_image>();
+  filter.insert(ki);
+  filter.set_ready();
+  ASSERT_TRUE(filter.maybe_contains(ki));
+  filter.clear();
+  ASSERT_TRUE(filter.is_ready());
+  ASSERT_EQ(filter.size(), 0);
+  ASSERT_FALSE(filter.maybe_contains(ki));
+}
@@ -485,6 +485,96 @@ TEST(message_writer, error)
     EXPECT_THROW(writer.finalize_response(0, 0), std::runtime_error);
 }
 
+TEST(message_writer, compress_notify)
+{
+    std::string bytes{};
+    for (unsigned i = 0; bytes.size() < LEVIN_COMPRESSION_THRESHOLD * 2; ++i)
+        bytes += "block entry " + std::to_string(i % 64) + ";";
+
+    epee::levin::message_writer writer{};
+    writer.buffer.write(epee::to_span(bytes));
+    EXPECT_EQ(bytes.size(), writer.compress());
+    EXPECT_GT(bytes.size(), writer.payload_size());
+
+    const std::size_t compressed = writer.payload_size();
+    const epee::byte_slice message = writer.finalize_notify(443);
+    const epee::levin::bucket_head2 header =
+        epee::levin::make_header(443, compressed, LEVIN_PACKET_REQUEST | LEVIN_PACKET_COMPRESSED, false);
+
+    ASSERT_EQ(sizeof(header) + compressed, message.size());
+    EXPECT_TRUE(std::memcmp(std::addressof(header), message.data(), sizeof(header)) == 0);
+
+    std::string uncompressed{};
+    ASSERT_TRUE(
+        epee::levin::decompress_payload(
+            {message.data() + sizeof(header), compressed}, bytes.size(), uncompressed
+        )
+    );
+    EXPECT_EQ(bytes, uncompressed);
+}
+
+TEST(message_writer, compress_skipped)
+{
+    std::string bytes(LEVIN_COMPRESSION_THRESHOLD, 'a');
+    std::generate(bytes.begin(), bytes.end(), crypto::random_device{});
+
+    epee::levin::message_writer random{};
+    random.buffer.write(epee::to_span(bytes));
+    EXPECT_EQ(0u, random.compress());
+    EXPECT_EQ(bytes.size(), random.payload_size());
+
+    const std::string small(LEVIN_COMPRESSION_THRESHOLD - 1, 'a');
+    epee::levin::message_writer writer{};
+    writer.buffer.write(epee::to_span(small));
+    EXPECT_EQ(0u, writer.compress());
+
+    const epee::byte_slice message = writer.finalize_notify(443);
+    const epee::levin::bucket_head2 header =
+        epee::levin::make_header(443, small.size(), LEVIN_PACKET_REQUEST, false);
+    ASSERT_EQ(sizeof(header) + small.size(), message.size());
+    EXPECT_TRUE(std::memcmp(std::addressof(header), message.data(), sizeof(header)) == 0);
+}
+
+TEST(compress_payload, round_trip)
+{
+    for (const std::size_t size : {std::size_t(1000), std::size_t(70000), std::size_t(300000)})
+    {
+        std::string bytes(size, 0);
+        std::generate(bytes.begin(), bytes.end(), crypto::random_device{});
+        for (std::size_t i = 0; i + 128 <= bytes.size(); i += 128)
+            std::memcpy(std::addressof(bytes[i + 64]), std::addressof(bytes[i]), 64);
+
+        epee::byte_stream compressed{};
+        ASSERT_TRUE(epee::levin::compress_payload(epee::strspan<std::uint8_t>(bytes), compressed));
+        EXPECT_GT(bytes.size(), compressed.size());
+
+        std::string uncompressed{};
+        ASSERT_TRUE(epee::levin::decompress_payload({compressed.data(), compressed.size()}, size, uncompressed));
+        EXPECT_EQ(bytes, uncompressed);
+
+        EXPECT_FALSE(epee::levin::decompress_payload({compressed.data(), compressed.size()}, size - 1, uncompressed));
+        EXPECT_FALSE(epee::levin::decompress_payload({compressed.data(), compressed.size() - 1}, size, uncompressed));
+    }
+}
+
+TEST(compress_payload, malformed)
+{
+    std::string uncompressed{};
+    EXPECT_FALSE(epee::levin::decompress_payload({}, 100, uncompressed));
+
+    // 8 byte raw size; a single match token with no preceding output
+    const std::uint8_t bad_offset[] = {8, 0, 0, 0, 0x04, 0x01, 0x00};
+    EXPECT_FALSE(epee::levin::decompress_payload(bad_offset, 100, uncompressed));
+
+    // claims 4 literals but carries 2
+    const std::uint8_t short_literals[] = {4, 0, 0, 0, 0x40, 'a', 'b'};
+    EXPECT_FALSE(epee::levin::decompress_payload(short_literals, 100, uncompressed));
+
+    const std::uint8_t literals[] = {4, 0, 0, 0, 0x40, 'a', 'b', 'c', 'd'};
+    ASSERT_TRUE(epee::levin::decompress_payload(literals, 100, uncompressed));
+    EXPECT_EQ("abcd", uncompressed);
+}
+
 TEST(make_noise, invalid)
 {
     EXPECT_TRUE(epee::levin::make_noise_notify(sizeof(epee::levin::bucket_head2) - 1).empty());
@@ -685,11 +775,11 @@ TEST_F(levin_notify, stem_without_padding)
         const bool is_stem = events_.has_stem_txes();
         EXPECT_EQ(txs, events_.take_relayed(is_stem ? cryptonote::relay_method::stem : cryptonote::relay_method::fluff));
 
-        if (!is_stem)
-        {
+        if (is_stem)
+            notifier.run_stems();
+        else
             notifier.run_fluff();
-            ASSERT_LT(0u, io_service_.poll());
-        }
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -825,11 +915,11 @@ TEST_F(levin_notify, local_without_padding)
         const bool is_stem = events_.has_stem_txes();
         EXPECT_EQ(their_txs, events_.take_relayed(is_stem ? cryptonote::relay_method::stem : cryptonote::relay_method::fluff));
 
-        if (!is_stem)
-        {
+        if (is_stem)
+            notifier.run_stems();
+        else
             notifier.run_fluff();
-            ASSERT_LT(0u, io_service_.poll());
-        }
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -864,6 +954,8 @@ TEST_F(levin_notify, local_without_padding)
         ASSERT_LT(0u, io_service_.poll());
         EXPECT_TRUE(events_.has_stem_txes());
         EXPECT_EQ(my_txs, events_.take_relayed(cryptonote::relay_method::stem));
+        notifier.run_stems();
+        ASSERT_LT(0u, io_service_.poll());
 
         send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -927,11 +1019,11 @@ TEST_F(levin_notify, forward_without_padding)
         const bool is_stem = events_.has_stem_txes();
         EXPECT_EQ(txs, events_.take_relayed(is_stem ? cryptonote::relay_method::stem : cryptonote::relay_method::fluff));
 
-        if (!is_stem)
-        {
+        if (is_stem)
+            notifier.run_stems();
+        else
             notifier.run_fluff();
-            ASSERT_LT(0u, io_service_.poll());
-        }
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -1108,11 +1200,11 @@ TEST_F(levin_notify, stem_with_padding)
         const bool is_stem = events_.has_stem_txes();
         EXPECT_EQ(txs, events_.take_relayed(is_stem ? cryptonote::relay_method::stem : cryptonote::relay_method::fluff));
 
-        if (!is_stem)
-        {
+        if (is_stem)
+            notifier.run_stems();
+        else
             notifier.run_fluff();
-            ASSERT_LT(0u, io_service_.poll());
-        }
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -1240,11 +1332,11 @@ TEST_F(levin_notify, local_with_padding)
         const bool is_stem = events_.has_stem_txes();
         EXPECT_EQ(their_txs, events_.take_relayed(is_stem ? cryptonote::relay_method::stem : cryptonote::relay_method::fluff));
 
-        if (!is_stem)
-        {
+        if (is_stem)
+            notifier.run_stems();
+        else
             notifier.run_fluff();
-            ASSERT_LT(0u, io_service_.poll());
-        }
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -1277,6 +1369,8 @@ TEST_F(levin_notify, local_with_padding)
         ASSERT_LT(0u, io_service_.poll());
         EXPECT_TRUE(events_.has_stem_txes());
         EXPECT_EQ(my_txs, events_.take_relayed(cryptonote::relay_method::stem));
+        notifier.run_stems();
+        ASSERT_LT(0u, io_service_.poll());
 
         send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -1337,11 +1431,11 @@ TEST_F(levin_notify, forward_with_padding)
         const bool is_stem = events_.has_stem_txes();
         EXPECT_EQ(txs, events_.take_relayed(is_stem ? cryptonote::relay_method::stem : cryptonote::relay_method::fluff));
 
-        if (!is_stem)
-        {
+        if (is_stem)
+            notifier.run_stems();
+        else
             notifier.run_fluff();
-            ASSERT_LT(0u, io_service_.poll());
-        }
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -2036,6 +2130,8 @@ TEST_F(levin_notify, stem_mappings)
         ASSERT_LT(0u, io_service_.poll());
     }
     EXPECT_EQ(txs, events_.take_relayed(cryptonote::relay_method::stem));
+    notifier.run_stems();
+    ASSERT_LT(0u, io_service_.poll());
 
     std::set<boost::uuids::uuid> used;
     std::map<boost::uuids::uuid, boost::uuids::uuid> mappings;
@@ -2073,6 +2169,8 @@ TEST_F(levin_notify, stem_mappings)
         io_service_.restart();
         ASSERT_LT(0u, io_service_.poll());
         EXPECT_EQ(txs, events_.take_relayed(cryptonote::relay_method::stem));
+        notifier.run_stems();
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         for (auto context = contexts_.begin(); context != contexts_.end(); ++context)
@@ -2104,6 +2202,73 @@ TEST_F(levin_notify, stem_mappings)
     EXPECT_EQ(CRYPTONOTE_DANDELIONPP_STEMS, used.size());
 }
 
+TEST_F(levin_notify, stem_batching)
+{
+    std::shared_ptr<cryptonote::levin::notify> notifier_ptr = make_notifier(0, true, false);
+    auto &notifier = *notifier_ptr;
+
+    for (unsigned count = 0; count < 10; ++count)
+        add_connection(count % 2 == 0);
+
+    notifier.new_out_connection();
+    io_service_.poll();
+
+    std::vector<cryptonote::blobdata> txs(2);
+    txs[0].resize(100, 'f');
+    txs[1].resize(200, 'e');
+
+    std::vector<cryptonote::blobdata> more_txs(1);
+    more_txs[0].resize(150, 'd');
+
+    ASSERT_EQ(10u, contexts_.size());
+    auto context = contexts_.begin();
+    for (;;)
+    {
+        EXPECT_TRUE(notifier.send_txs(txs, context->get_id(), cryptonote::relay_method::stem));
+
+        io_service_.restart();
+        ASSERT_LT(0u, io_service_.poll());
+        if (events_.has_stem_txes())
+            break;
+
+        EXPECT_EQ(txs, events_.take_relayed(cryptonote::relay_method::fluff));
+        notifier.run_fluff();
+        ASSERT_LT(0u, io_service_.poll());
+        for (auto& other : contexts_)
+            other.process_send_queue();
+        while (receiver_.notified_size())
+            receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>();
+
+        notifier.run_epoch();
+        io_service_.restart();
+        ASSERT_LT(0u, io_service_.poll());
+    }
+    EXPECT_EQ(txs, events_.take_relayed(cryptonote::relay_method::stem));
+
+    // same source, same epoch: queued behind the first batch and not sent yet
+    EXPECT_TRUE(notifier.send_txs(more_txs, context->get_id(), cryptonote::relay_method::stem));
+    ASSERT_LT(0u, io_service_.poll());
+    EXPECT_EQ(more_txs, events_.take_relayed(cryptonote::relay_method::stem));
+    for (auto& other : contexts_)
+        EXPECT_EQ(0u, other.process_send_queue());
+
+    notifier.run_stems();
+    ASSERT_LT(0u, io_service_.poll());
+
+    std::size_t send_count = 0;
+    for (auto& other : contexts_)
+        send_count += other.process_send_queue();
+
+    EXPECT_EQ(1u, send_count);
+    ASSERT_EQ(1u, receiver_.notified_size());
+    auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+    std::vector<cryptonote::blobdata> expected = txs;
+    expected.insert(expected.end(), more_txs.begin(), more_txs.end());
+    EXPECT_EQ(expected, notification.txs);
+    EXPECT_TRUE(notification._.empty());
+    EXPECT_FALSE(notification.dandelionpp_fluff);
+}
+
 TEST_F(levin_notify, fluff_multiple)
 {
     static constexpr const unsigned test_connections_count = (CRYPTONOTE_DANDELIONPP_STEMS + 1) * 2;
@@ -2139,6 +2304,8 @@ TEST_F(levin_notify, fluff_multiple)
             break;
 
         EXPECT_EQ(txs, events_.take_relayed(cryptonote::relay_method::stem));
+        notifier.run_stems();
+        ASSERT_LT(0u, io_service_.poll());
 
         std::size_t send_count = 0;
         EXPECT_EQ(0u, context->process_send_queue());
@@ -2276,6 +2443,65 @@ TEST_F(levin_notify, fluff_with_duplicate)
 
 }
 
+TEST_F(levin_notify, fluff_skips_known_txs)
+{
+    std::shared_ptr<cryptonote::levin::notify> notifier_ptr = make_notifier(0, true, false);
+    auto &notifier = *notifier_ptr;
+
+    for (unsigned count = 0; count < 10; ++count)
+        add_connection(count % 2 == 0);
+
+    notifier.new_out_connection();
+    io_service_.poll();
+
+    std::vector<cryptonote::blobdata> txs(2);
+    txs[0].resize(100, 'f');
+    txs[1].resize(200, 'e');
+    const cryptonote::blobdata tx0 = txs[0];
+    const cryptonote::blobdata tx1 = txs[1];
+    const crypto::hash hash0 = crypto::cn_fast_hash(tx0.data(), tx0.size());
+    const crypto::hash hash1 = crypto::cn_fast_hash(tx1.data(), tx1.size());
+
+    ASSERT_EQ(10u, contexts_.size());
+    {
+        auto context = contexts_.begin();
+        const boost::uuids::uuid source = context->get_id();
+        const boost::uuids::uuid sent_before = (++context)->get_id();
+        const boost::uuids::uuid sent_after = (++context)->get_id();
+
+        // one peer sends us tx 1 before we relay, the other sends tx 0 while it is queued
+        notifier.on_txs_received(sent_before, {hash1});
+        io_service_.restart();
+        io_service_.poll();
+        EXPECT_TRUE(notifier.send_txs(txs, source, cryptonote::relay_method::fluff));
+        io_service_.restart();
+        ASSERT_LT(0u, io_service_.poll());
+        notifier.on_txs_received(sent_after, {hash0});
+        io_service_.restart();
+        ASSERT_LT(0u, io_service_.poll());
+        notifier.run_fluff();
+        ASSERT_LT(0u, io_service_.poll());
+
+        for (context = contexts_.begin(); context != contexts_.end(); ++context)
+            EXPECT_EQ(context->get_id() == source ? 0u : 1u, context->process_send_queue());
+
+        EXPECT_EQ(txs, events_.take_relayed(cryptonote::relay_method::fluff));
+        std::sort(txs.begin(), txs.end());
+        ASSERT_EQ(9u, receiver_.notified_size());
+        for (unsigned count = 0; count < 9; ++count)
+        {
+            auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>();
+            if (notification.first == sent_before)
+                EXPECT_EQ(std::vector<cryptonote::blobdata>{tx0}, notification.second.txs);
+            else if (notification.first == sent_after)
+                EXPECT_EQ(std::vector<cryptonote::blobdata>{tx1}, notification.second.txs);
+            else
+                EXPECT_EQ(txs, notification.second.txs);
+            EXPECT_TRUE(notification.second.dandelionpp_fluff);
+        }
+    }
+}
+
 TEST_F(levin_notify, noise)
 {
     for (unsigned count = 0; count < 10; ++count)
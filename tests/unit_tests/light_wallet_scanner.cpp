@@ -0,0 +1,142 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <boost/thread/thread.hpp>
+#include <chrono>
+
+#include "carrot_impl/format_utils.h"
+#include "carrot_mock_helpers.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/light_wallet_scanner.h"
+
+namespace
+{
+  cryptonote::account_public_address main_address(const carrot::mock::mock_carrot_and_legacy_keys &keys)
+  {
+    const carrot::CarrotDestinationV1 destination = keys.cryptonote_address();
+    return {destination.address_spend_pubkey, destination.address_view_pubkey, true};
+  }
+
+  bool noop_fetch(const std::vector<crypto::hash> &, std::vector<cryptonote::transaction> &txs)
+  {
+    txs.clear();
+    return true;
+  }
+
+  // waits for the background thread to get through the given height
+  bool wait_for_scan(const cryptonote::light_wallet_scanner &scanner, const cryptonote::account_public_address &address,
+      const crypto::secret_key &view_key, uint64_t height, std::vector<cryptonote::light_wallet_output> &outputs)
+  {
+    for (int i = 0; i < 500; ++i)
+    {
+      uint64_t start_height = 0, scanned_height = 0;
+      if (!scanner.get_outputs(address, view_key, outputs, start_height, scanned_height))
+        return false;
+      if (scanned_height > height)
+        return true;
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+    }
+    return false;
+  }
+}
+
+TEST(light_wallet_scanner, register_accounts)
+{
+  carrot::mock::mock_carrot_and_legacy_keys keys;
+  keys.generate();
+  const cryptonote::account_public_address address = main_address(keys);
+  const crypto::secret_key &view_key = keys.legacy_acb.get_keys().m_view_secret_key;
+
+  cryptonote::light_wallet_scanner scanner;
+  bool is_new = true;
+  EXPECT_FALSE(scanner.add_account(address, view_key, is_new)); // not started
+  EXPECT_FALSE(is_new);
+
+  scanner.start(noop_fetch, 1);
+  EXPECT_FALSE(scanner.add_account(address, rct::rct2sk(rct::skGen()), is_new));
+  EXPECT_TRUE(scanner.add_account(address, view_key, is_new));
+  EXPECT_TRUE(is_new);
+  EXPECT_TRUE(scanner.add_account(address, view_key, is_new));
+  EXPECT_FALSE(is_new);
+
+  carrot::mock::mock_carrot_and_legacy_keys other;
+  other.generate();
+  EXPECT_FALSE(scanner.add_account(main_address(other), other.legacy_acb.get_keys().m_view_secret_key, is_new)); // limit
+
+  std::vector<cryptonote::light_wallet_output> outputs;
+  uint64_t start_height, scanned_height;
+  EXPECT_FALSE(scanner.get_outputs(address, rct::rct2sk(rct::skGen()), outputs, start_height, scanned_height));
+  EXPECT_TRUE(scanner.get_outputs(address, view_key, outputs, start_height, scanned_height));
+  EXPECT_TRUE(outputs.empty());
+  scanner.stop();
+}
+
+TEST(light_wallet_scanner, coinbase_and_reorg)
+{
+  carrot::mock::mock_carrot_and_legacy_keys keys;
+  keys.generate();
+  const cryptonote::account_public_address address = main_address(keys);
+  const crypto::secret_key &view_key = keys.legacy_acb.get_keys().m_view_secret_key;
+
+  carrot::mock::mock_carrot_and_legacy_keys other;
+  other.generate();
+
+  cryptonote::light_wallet_scanner scanner;
+  scanner.start(noop_fetch);
+  bool is_new = false;
+  ASSERT_TRUE(scanner.add_account(address, view_key, is_new));
+
+  cryptonote::block mine{};
+  mine.timestamp = 100;
+  mine.miner_tx = carrot::make_single_enote_carrot_coinbase_transaction_v1(keys.cryptonote_address(), 1000, 0, {});
+  cryptonote::block theirs{};
+  theirs.timestamp = 200;
+  theirs.miner_tx = carrot::make_single_enote_carrot_coinbase_transaction_v1(other.cryptonote_address(), 2000, 1, {});
+
+  const cryptonote::block blocks[] = {mine, theirs};
+  scanner.notify_block(0, epee::span<const cryptonote::block>(blocks, 2));
+
+  std::vector<cryptonote::light_wallet_output> outputs;
+  ASSERT_TRUE(wait_for_scan(scanner, address, view_key, 1, outputs));
+  ASSERT_EQ(1u, outputs.size());
+  EXPECT_EQ(1000u, outputs[0].amount);
+  EXPECT_EQ(0u, outputs[0].height);
+  EXPECT_EQ(100u, outputs[0].timestamp);
+  EXPECT_TRUE(outputs[0].coinbase);
+  EXPECT_EQ(cryptonote::get_transaction_hash(mine.miner_tx), outputs[0].tx_hash);
+
+  // the block at height 0 is replaced by one paying someone else
+  cryptonote::block replaced = theirs;
+  replaced.miner_tx = carrot::make_single_enote_carrot_coinbase_transaction_v1(other.cryptonote_address(), 3000, 0, {});
+  scanner.notify_block(0, {std::addressof(replaced), 1});
+  ASSERT_TRUE(wait_for_scan(scanner, address, view_key, 0, outputs));
+  EXPECT_TRUE(outputs.empty());
+  scanner.stop();
+}
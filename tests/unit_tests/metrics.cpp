@@ -0,0 +1,100 @@
+// Copyright (c) 2024, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include "common/metrics.h"
+
+namespace
+{
+  bool contains(const std::string &haystack, const std::string &needle)
+  {
+    return haystack.find(needle) != std::string::npos;
+  }
+}
+
+TEST(metrics, counter)
+{
+  tools::metrics::counter &c = tools::metrics::get_counter("test_counter_total", "A test counter", tools::metrics::label("kind", "a"));
+  EXPECT_EQ(&c, &tools::metrics::get_counter("test_counter_total", "A test counter", tools::metrics::label("kind", "a")));
+  EXPECT_NE(&c, &tools::metrics::get_counter("test_counter_total", "A test counter", tools::metrics::label("kind", "b")));
+  c.inc();
+  c.inc(41);
+  EXPECT_EQ(c.get(), 42);
+
+  const std::string text = tools::metrics::render();
+  EXPECT_TRUE(contains(text, "# HELP salvium_test_counter_total A test counter\n"));
+  EXPECT_TRUE(contains(text, "# TYPE salvium_test_counter_total counter\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_counter_total{kind=\"a\"} 42\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_counter_total{kind=\"b\"} 0\n"));
+}
+
+TEST(metrics, histogram)
+{
+  tools::metrics::histogram &h = tools::metrics::get_histogram("test_seconds", "A test histogram");
+  h.observe(std::chrono::microseconds{10});
+  h.observe(std::chrono::microseconds{100});
+  h.observe(std::chrono::milliseconds{3});
+  h.observe(std::chrono::seconds{60});
+  EXPECT_EQ(h.count(), 4);
+
+  const std::string text = tools::metrics::render();
+  EXPECT_TRUE(contains(text, "# TYPE salvium_test_seconds histogram\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_bucket{le=\"0.00005\"} 1\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_bucket{le=\"0.0001\"} 2\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_bucket{le=\"0.0025\"} 2\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_bucket{le=\"0.005\"} 3\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_bucket{le=\"10\"} 3\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_bucket{le=\"+Inf\"} 4\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_sum 60.00311\n"));
+  EXPECT_TRUE(contains(text, "salvium_test_seconds_count 4\n"));
+}
+
+TEST(metrics, labels)
+{
+  EXPECT_EQ(tools::metrics::label("k", "a\"b\\c\nd"), "k=\"a\\\"b\\\\c\\nd\"");
+  EXPECT_THROW(tools::metrics::get_gauge("test_counter_total", "Wrong type"), std::logic_error);
+}
+
+TEST(metrics, bounded_labels)
+{
+  tools::metrics::counter *first = nullptr;
+  for (int i = 0; i < 1000; ++i)
+  {
+    tools::metrics::counter &c = tools::metrics::get_counter("test_bounded_total", "", tools::metrics::label("i", std::to_string(i)));
+    if (i == 0)
+      first = &c;
+    c.inc();
+  }
+  EXPECT_EQ(first->get(), 1);
+
+  const std::string text = tools::metrics::render();
+  EXPECT_TRUE(contains(text, "salvium_test_bounded_total{i=\"0\"} 1\n"));
+  EXPECT_FALSE(contains(text, "salvium_test_bounded_total{i=\"999\"}"));
+}
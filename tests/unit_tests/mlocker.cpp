@@ -27,6 +27,7 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <thread>
 #include "gtest/gtest.h"
 
 #include "misc_log_ex.h"
@@ -193,4 +194,48 @@ TEST(mlocker, mlocked)
   ASSERT_EQ(epee::mlocker::get_num_locked_objects(), base_objects + 0);
 }
 
+TEST(mlocker, retained_stack_pages)
+{
+  epee::mlocker::release_retained_pages();
+  const size_t base_pages = epee::mlocker::get_num_locked_pages();
+  const size_t base_retained = epee::mlocker::get_num_retained_pages();
+  {
+    struct Foo { uint64_t u; };
+    epee::mlocked<Foo> l0;
+    epee::mlocked<Foo> l1;
+  }
+  // the page may stay locked for the next object, but is no longer counted as in use
+  ASSERT_EQ(epee::mlocker::get_num_locked_pages(), base_pages + 0);
+  ASSERT_LE(epee::mlocker::get_num_retained_pages(), base_retained + 1);
+  {
+    struct Foo { uint64_t u; };
+    epee::mlocked<Foo> l;
+    ASSERT_EQ(epee::mlocker::get_num_locked_pages(), base_pages + 1);
+  }
+  epee::mlocker::release_retained_pages();
+  ASSERT_EQ(epee::mlocker::get_num_retained_pages(), base_retained + 0);
+}
+
+TEST(mlocker, heap_pages_not_retained)
+{
+  const size_t page_size = epee::mlocker::get_page_size();
+  ASSERT_TRUE(page_size > 0);
+  const size_t base_retained = epee::mlocker::get_num_retained_pages();
+  std::unique_ptr<char[]> data{new char[8 * page_size]};
+  std::shared_ptr<epee::mlocker> m0{new epee::mlocker(BASE(data), 1)};
+  m0 = NULL;
+  ASSERT_EQ(epee::mlocker::get_num_retained_pages(), base_retained + 0);
+}
+
+TEST(mlocker, retained_released_at_thread_exit)
+{
+  const size_t base_retained = epee::mlocker::get_num_retained_pages();
+  std::thread t([](){
+    struct Foo { uint64_t u; };
+    epee::mlocked<Foo> l;
+  });
+  t.join();
+  ASSERT_EQ(epee::mlocker::get_num_retained_pages(), base_retained + 0);
+}
+
 #endif
@@ -28,6 +28,10 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <random>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
 #include "gtest/gtest.h"
 
 #include "int-util.h"
@@ -318,4 +322,45 @@ namespace
     ASSERT_EQ(qhi, 405997335029502627ull);
     ASSERT_EQ(qlo, 2552775575832427192ull);
   }
+
+  // the yield payout path used to compute this with boost int128_t and numeric_cast, which keeps
+  // the low 64 bits of a quotient that does not fit
+  uint64_t mul_div64_reference(uint64_t a, uint64_t b, uint64_t c)
+  {
+    const boost::multiprecision::int128_t r = (boost::multiprecision::int128_t(a) * boost::multiprecision::int128_t(b)) / boost::multiprecision::int128_t(c);
+    return boost::numeric_cast<uint64_t>(r);
+  }
+
+  TEST(mul_div64, edge_cases)
+  {
+    bool overflow;
+    ASSERT_EQ(mul_div64(0, 0, 1, &overflow), 0);
+    ASSERT_FALSE(overflow);
+    ASSERT_EQ(mul_div64(7, 5, 3, &overflow), 11);
+    ASSERT_FALSE(overflow);
+    ASSERT_EQ(mul_div64(UINT64_MAX, UINT64_MAX, UINT64_MAX, &overflow), UINT64_MAX);
+    ASSERT_FALSE(overflow);
+    ASSERT_EQ(mul_div64(UINT64_MAX, 2, 2, &overflow), UINT64_MAX);
+    ASSERT_FALSE(overflow);
+    ASSERT_EQ(mul_div64(UINT64_MAX, 2, 1, &overflow), UINT64_MAX - 1);
+    ASSERT_TRUE(overflow);
+    ASSERT_EQ(mul_div64(1ull << 32, 1ull << 32, 1, &overflow), 0);
+    ASSERT_TRUE(overflow);
+    ASSERT_EQ(mul_div64(1ull << 32, 1ull << 32, 1, NULL), 0);
+  }
+
+  TEST(mul_div64, matches_multiprecision)
+  {
+    std::mt19937_64 rng(42);
+    for (int i = 0; i < 100000; ++i)
+    {
+      // mix full width values with small ones, so both fitting and oversized quotients are common
+      const auto draw = [&rng]() { const uint64_t v = rng(); return (v & 1) ? v : v >> (rng() % 64); };
+      const uint64_t a = draw(), b = draw(), c = draw() | 1;
+      bool overflow;
+      ASSERT_EQ(mul_div64(a, b, c, &overflow), mul_div64_reference(a, b, c)) << a << " * " << b << " / " << c;
+      const boost::multiprecision::uint128_t full = boost::multiprecision::uint128_t(a) * b / c;
+      ASSERT_EQ(overflow, full > std::numeric_limits<uint64_t>::max()) << a << " * " << b << " / " << c;
+    }
+  }
 }
@@ -315,3 +315,12 @@ TEST(multiexp, scalarmult_triple)
     }
   }
 }
+
+TEST(multiexp, calibrate)
+{
+  const rct::multiexp_crossover crossover = rct::multiexp_calibrate();
+  ASSERT_GE(crossover.straus_max, 16);
+  ASSERT_LE(crossover.straus_max, 256);
+  ASSERT_GE(crossover.straus_cached_max, 16);
+  ASSERT_LE(crossover.straus_cached_max, 232);
+}
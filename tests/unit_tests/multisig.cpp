@@ -497,3 +497,25 @@ TEST(multisig, multisig_kex_msg)
   EXPECT_EQ(msg_rnd2.get_msg_privkey(), crypto::null_skey);
   EXPECT_EQ(msg_rnd2.get_msg_privkey(), msg_rnd2_reverse.get_msg_privkey());
 }
+
+TEST(multisig, parse_multisig_kex_msgs)
+{
+  using namespace multisig;
+
+  std::vector<std::string> msgs;
+  for (int i = 0; i < 7; ++i)
+  {
+    crypto::public_key pubkey;
+    crypto::secret_key_to_public_key(rct::rct2sk(rct::skGen()), pubkey);
+    msgs.push_back(multisig_kex_msg{2, rct::rct2sk(rct::skGen()), std::vector<crypto::public_key>{pubkey}}.get_msg());
+  }
+
+  std::vector<multisig_kex_msg> expanded_msgs;
+  EXPECT_NO_THROW(expanded_msgs = parse_multisig_kex_msgs(msgs));
+  ASSERT_EQ(expanded_msgs.size(), msgs.size());
+  for (std::size_t i = 0; i < msgs.size(); ++i)
+    EXPECT_EQ(expanded_msgs[i].get_msg(), msgs[i]);
+
+  msgs[3] = "abc";
+  EXPECT_ANY_THROW(parse_multisig_kex_msgs(msgs));
+}
@@ -39,8 +39,9 @@
 #include "string_tools.h"
 #include "file_io_utils.h"
 #include "common/notify.h"
+#include "cryptonote_core/notify_dispatcher.h"
 
-TEST(notify, works)
+static std::string make_notify_file()
 {
 #ifdef __GLIBC__
   mode_t prevmode = umask(077);
@@ -52,20 +53,34 @@ TEST(notify, works)
   const size_t len = strlen(tmp) + 1 + strlen(filename);
   std::unique_ptr<char[]> name_template_(new char[len + 1]);
   char *name_template = name_template_.get();
-  ASSERT_TRUE(name_template != NULL);
+  if (!name_template)
+    return {};
   snprintf(name_template, len + 1, "%s/%s", tmp, filename);
   int fd = mkstemp(name_template);
 #ifdef __GLIBC__
   umask(prevmode);
 #endif
-  ASSERT_TRUE(fd >= 0);
+  if (fd < 0)
+    return {};
   close(fd);
+  return name_template;
+}
 
-  const std::string spec = epee::string_tools::get_current_module_folder() + "/test_notifier"
+static std::string notifier_spec(const std::string &filename)
+{
+  return epee::string_tools::get_current_module_folder() + "/test_notifier"
 #ifdef _WIN32
       + ".exe"
 #endif
-      + " " + name_template + " %s";
+      + " " + filename + " %s";
+}
+
+TEST(notify, works)
+{
+  const std::string name_template = make_notify_file();
+  ASSERT_FALSE(name_template.empty());
+
+  const std::string spec = notifier_spec(name_template);
 
   tools::Notify notify(spec.c_str());
   notify.notify("%s", "1111111111111111111111111111111111111111111111111111111111111111", NULL);
@@ -88,3 +103,36 @@ TEST(notify, works)
   boost::filesystem::remove(name_template);
   ASSERT_TRUE(ok);
 }
+
+TEST(notify, dispatcher_covers_latest_block)
+{
+  const std::string name_template = make_notify_file();
+  ASSERT_FALSE(name_template.empty());
+
+  std::vector<crypto::hash> ids(100);
+  for (size_t i = 0; i < ids.size(); ++i)
+    ids[i] = crypto::cn_fast_hash(&i, sizeof(i));
+  const std::string last = epee::string_tools::pod_to_hex(ids.back());
+
+  {
+    cryptonote::notify_dispatcher dispatcher;
+    dispatcher.set_block_notify(std::make_shared<tools::Notify>(notifier_spec(name_template).c_str()));
+    for (size_t i = 0; i < ids.size(); ++i)
+      dispatcher.on_block(i, ids[i]);
+
+    bool ok = false;
+    std::string s;
+    for (int i = 0; i < 20 && !ok; ++i)
+    {
+      epee::misc_utils::sleep_no_w(100);
+      if (epee::file_io_utils::load_file_to_string(name_template, s))
+        ok = s.find(last) != std::string::npos;
+    }
+    EXPECT_TRUE(ok);
+
+    // every run writes one whole hash, and a burst can only shrink the count
+    EXPECT_EQ(s.size() % 64, 0);
+    EXPECT_LE(s.size() / 64, ids.size());
+  }
+  boost::filesystem::remove(name_template);
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/output_distribution_cache.h"
+
+TEST(output_distribution_cache, empty)
+{
+  cryptonote::output_distribution_cache cache;
+  std::vector<uint64_t> distribution;
+  uint64_t base;
+  ASSERT_EQ(cache.end_height("SAL1"), 0);
+  ASSERT_FALSE(cache.get("SAL1", 0, 0, distribution, base));
+}
+
+TEST(output_distribution_cache, update_and_get)
+{
+  cryptonote::output_distribution_cache cache;
+  ASSERT_TRUE(cache.update("SAL1", 0, {1, 3, 6}));
+  ASSERT_FALSE(cache.update("SAL1", 4, {10}));
+  ASSERT_TRUE(cache.update("SAL1", 3, {10, 15}));
+  ASSERT_EQ(cache.end_height("SAL1"), 5);
+  ASSERT_EQ(cache.end_height(""), 0);
+
+  std::vector<uint64_t> distribution;
+  uint64_t base;
+  ASSERT_TRUE(cache.get("SAL1", 0, 4, distribution, base));
+  ASSERT_EQ(distribution, std::vector<uint64_t>({1, 3, 6, 10, 15}));
+  ASSERT_EQ(base, 0);
+  ASSERT_TRUE(cache.get("SAL1", 2, 3, distribution, base));
+  ASSERT_EQ(distribution, std::vector<uint64_t>({6, 10}));
+  ASSERT_EQ(base, 3);
+  ASSERT_FALSE(cache.get("SAL1", 2, 5, distribution, base));
+  ASSERT_EQ(cache.at("SAL1", 4), 15);
+}
+
+TEST(output_distribution_cache, trim)
+{
+  cryptonote::output_distribution_cache cache;
+  ASSERT_TRUE(cache.update("", 0, {2, 4, 6, 8}));
+  ASSERT_TRUE(cache.update("SAL1", 0, {1, 2}));
+  cache.trim(2);
+  ASSERT_EQ(cache.end_height(""), 2);
+  ASSERT_EQ(cache.end_height("SAL1"), 2);
+
+  // a popped height is replaced by the new block's count
+  ASSERT_TRUE(cache.update("", 2, {5}));
+  std::vector<uint64_t> distribution;
+  uint64_t base;
+  ASSERT_TRUE(cache.get("", 1, 2, distribution, base));
+  ASSERT_EQ(distribution, std::vector<uint64_t>({4, 5}));
+  ASSERT_EQ(base, 2);
+}
+
+TEST(output_distribution_cache, limit)
+{
+  cryptonote::output_distribution_cache cache;
+  ASSERT_TRUE(cache.update("", 0, std::vector<uint64_t>(100, 1)));
+  ASSERT_TRUE(cache.update("SAL1", 0, std::vector<uint64_t>(100, 1)));
+  ASSERT_TRUE(cache.update("VSD", 0, std::vector<uint64_t>(100, 1)));
+  ASSERT_TRUE(cache.update("USD", 0, std::vector<uint64_t>(100, 1)));
+  ASSERT_GE(cache.memory_usage(), 4 * 100 * sizeof(uint64_t));
+
+  // no limit by default
+  cache.enforce_limit("USD");
+  ASSERT_EQ(cache.end_height("SAL1"), 100);
+
+  std::vector<uint64_t> distribution;
+  uint64_t base;
+  ASSERT_TRUE(cache.get("SAL1", 0, 10, distribution, base));
+
+  // VSD is the least recently used, then SAL1; the global and requested counts stay
+  cache.set_max_bytes(3 * 100 * sizeof(uint64_t) + 64);
+  cache.enforce_limit("USD");
+  ASSERT_EQ(cache.end_height("VSD"), 0);
+  ASSERT_EQ(cache.end_height("SAL1"), 100);
+  ASSERT_EQ(cache.end_height("USD"), 100);
+
+  cache.set_max_bytes(1);
+  cache.enforce_limit("USD");
+  ASSERT_EQ(cache.end_height("SAL1"), 0);
+  ASSERT_EQ(cache.end_height(""), 100);
+  ASSERT_EQ(cache.end_height("USD"), 100);
+}
@@ -218,3 +218,32 @@ TEST(select_outputs, same_distribution)
   MDEBUG("avg_dev: " << avg_dev);
   ASSERT_LT(avg_dev, 0.02);
 }
+
+TEST(select_outputs, gamma_batch)
+{
+  std::vector<uint64_t> offsets;
+
+  MKOFFSETS(300000, 1);
+  tools::gamma_picker picker(offsets);
+
+  std::vector<uint64_t> picks;
+  std::vector<double> ages;
+  for (int batch = 0; batch < 100; ++batch)
+  {
+    picker.pick(1000, picks);
+    ASSERT_EQ(picks.size(), 1000);
+    for (uint64_t o: picks)
+    {
+      if (o >= n_outs)
+        continue;
+      ages.push_back((n_outs - 1 - o) * 120. * (offsets.size() / (double)n_outs));
+    }
+    // picks come back in the order they were drawn, not sorted
+    ASSERT_FALSE(std::is_sorted(picks.begin(), picks.end()));
+  }
+  ASSERT_GT(ages.size(), 90000);
+  double median = epee::misc_utils::median(ages);
+  MDEBUG("median age: " << median / 86400. << " days");
+  ASSERT_GE(median, 1.3 * 86400);
+  ASSERT_LE(median, 1.4 * 86400);
+}
@@ -300,6 +300,55 @@ TEST(ringct, CLSAG)
   ASSERT_TRUE(rct::verRctCLSAGSimple(message,clsag,pubs,Cout));
 }
 
+TEST(ringct, CLSAG_cached_ring_members)
+{
+  const size_t N = 11;
+  const size_t idx = 3;
+  ctkeyV pubs;
+  for (size_t i = 0; i < N; ++i)
+  {
+    key sk;
+    ctkey tmp;
+    skpkGen(sk, tmp.dest);
+    skpkGen(sk, tmp.mask);
+    pubs.push_back(tmp);
+  }
+
+  ctkey insk;
+  skpkGen(insk.dest, pubs[idx].dest);
+  insk.mask = skGen();
+  const key u = skGen();
+  addKeys2(pubs[idx].mask, insk.mask, u, H);
+  const key t2 = skGen();
+  key Cout;
+  addKeys2(Cout, t2, u, H);
+  const key message = skGen();
+
+  const clsag sig = rct::proveRctCLSAGSimple(message,pubs,insk,t2,Cout,idx,hw::get_device("default"));
+
+  // invalid points must not end up cached
+  ctkeyV members = pubs;
+  key invalid = zero();
+  invalid.bytes[0] = 2; // y = 2 is not on the curve
+  ge_p3 p3;
+  ASSERT_NE(ge_frombytes_vartime(&p3, invalid.bytes), 0);
+  members.push_back({invalid, invalid});
+  rct::cache_ring_member_points(members);
+
+  ASSERT_TRUE(rct::verRctCLSAGSimple(message,sig,pubs,Cout));
+  ASSERT_TRUE(rct::verRctCLSAGSimple(message,sig,pubs,Cout));
+
+  ctkeyV bad_pubs = pubs;
+  bad_pubs[idx].mask = scalarmultBase(skGen());
+  ASSERT_FALSE(rct::verRctCLSAGSimple(message,sig,bad_pubs,Cout));
+  bad_pubs = pubs;
+  bad_pubs[(idx + 1) % N].dest = invalid;
+  ASSERT_FALSE(rct::verRctCLSAGSimple(message,sig,bad_pubs,Cout));
+  bad_pubs = pubs;
+  bad_pubs[(idx + 1) % N].mask = invalid;
+  ASSERT_FALSE(rct::verRctCLSAGSimple(message,sig,bad_pubs,Cout));
+}
+
 TEST(ringct, TCLSAG)
 {
   const size_t N = 16;
@@ -1516,3 +1565,21 @@ TEST(ringct, sa_proof)
   }
   ASSERT_EQ(failure, 9);
 }
+
+TEST(ringct, scalarmultH_precomp)
+{
+  // the fixed-base table must agree with the generic scalar multiplication
+  for (size_t i = 0; i < 256; ++i)
+  {
+    const key a = i % 2 ? skGen() : d2h(i * 1000000007ull);
+    ge_p3 H;
+    ASSERT_EQ(ge_frombytes_vartime(&H, rct::H.bytes), 0);
+    ge_p2 R;
+    ge_scalarmult(&R, a.bytes, &H);
+    key expected;
+    ge_tobytes(expected.bytes, &R);
+    ASSERT_EQ(scalarmultH(a), expected);
+  }
+  ASSERT_EQ(scalarmultH(rct::zero()), rct::identity());
+  ASSERT_EQ(scalarmultH(rct::identity()), rct::H);
+}
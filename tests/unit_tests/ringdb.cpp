@@ -197,3 +197,60 @@ TEST(spent_outputs, clear)
   ASSERT_FALSE(ringdb.blackballed(OUTPUT_1));
 }
 
+
+TEST(ringdb, bulk)
+{
+  RingDB ringdb;
+  std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>> rings;
+  std::vector<crypto::key_image> key_images;
+  for (uint64_t n = 0; n < 64; ++n)
+  {
+    key_images.push_back(generate_key_image());
+    rings.push_back(std::make_pair(key_images.back(), std::vector<uint64_t>{n, n + 1000, n + 200000, n + 30000000}));
+  }
+  ASSERT_TRUE(ringdb.set_rings(KEY_1, rings, false));
+  std::vector<std::vector<uint64_t>> all_outs;
+  ASSERT_TRUE(ringdb.get_rings(KEY_1, key_images, all_outs));
+  ASSERT_EQ(all_outs.size(), rings.size());
+  for (size_t n = 0; n < rings.size(); ++n)
+    ASSERT_EQ(all_outs[n], rings[n].second);
+}
+
+TEST(spent_outputs, unsorted_vector)
+{
+  RingDB ringdb;
+  std::vector<std::pair<uint64_t, uint64_t>> outputs;
+  outputs.push_back(std::make_pair(20, 1));
+  outputs.push_back(std::make_pair(10, 8));
+  outputs.push_back(std::make_pair(10, 3));
+  outputs.push_back(std::make_pair(20, 1));
+  outputs.push_back(std::make_pair(0, 1));
+  ASSERT_TRUE(ringdb.blackball(outputs));
+
+  // these all go after what is there
+  outputs.clear();
+  outputs.push_back(std::make_pair(30, 5));
+  outputs.push_back(std::make_pair(20, 7));
+  outputs.push_back(std::make_pair(20, 2));
+  ASSERT_TRUE(ringdb.blackball(outputs));
+
+  // these don't
+  outputs.clear();
+  outputs.push_back(std::make_pair(40, 0));
+  outputs.push_back(std::make_pair(10, 4));
+  outputs.push_back(std::make_pair(10, 3));
+  ASSERT_TRUE(ringdb.blackball(outputs));
+
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(0, 1)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(10, 3)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(10, 4)));
+  ASSERT_FALSE(ringdb.blackballed(std::make_pair(10, 5)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(10, 8)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(20, 1)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(20, 2)));
+  ASSERT_FALSE(ringdb.blackballed(std::make_pair(20, 3)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(20, 7)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(30, 5)));
+  ASSERT_TRUE(ringdb.blackballed(std::make_pair(40, 0)));
+  ASSERT_FALSE(ringdb.blackballed(std::make_pair(40, 1)));
+}
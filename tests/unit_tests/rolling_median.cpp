@@ -229,3 +229,35 @@ TEST(rolling_median, copy)
     ASSERT_EQ(m.median(), copy.median());
   }
 }
+
+TEST(rolling_median, undo_insert)
+{
+  for (int N: {1, 2, 3, 10, 101})
+  {
+    epee::misc_utils::rolling_median_t<uint64_t> m(N);
+    std::vector<uint64_t> series;
+    ASSERT_FALSE(m.undo_insert(0));
+    for (int i = 0; i < 5000; ++i)
+    {
+      // wander back and forth, as the chain tip does through reorgs
+      if (series.size() > (size_t)N && crypto::rand<uint8_t>() < 64)
+      {
+        const size_t depth = std::min<size_t>(1 + crypto::rand<uint8_t>() % 8, series.size() - N);
+        for (size_t d = 0; d < depth; ++d)
+        {
+          series.pop_back();
+          ASSERT_TRUE(m.undo_insert(series[series.size() - N]));
+        }
+      }
+      else
+      {
+        series.push_back(crypto::rand<uint16_t>() % 1000);
+        m.insert(series.back());
+      }
+      const size_t n = std::min<size_t>(N, series.size());
+      std::vector<uint64_t> window(series.end() - n, series.end());
+      ASSERT_EQ(m.size(), (int)n);
+      ASSERT_EQ(m.median(), epee::misc_utils::median(window));
+    }
+  }
+}
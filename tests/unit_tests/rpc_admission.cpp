@@ -0,0 +1,87 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include "rpc/rpc_admission.h"
+
+using namespace std::chrono;
+
+TEST(rpc_admission, disabled)
+{
+  cryptonote::rpc_admission admission;
+  EXPECT_FALSE(admission.enabled());
+  for (int i = 0; i < 100000; ++i)
+    ASSERT_TRUE(admission.admit("1.2.3.4", "/get_info"));
+  EXPECT_EQ(admission.get_rejected(), 0);
+}
+
+TEST(rpc_admission, measured_cost)
+{
+  cryptonote::rpc_admission admission(milliseconds{100}, seconds{1});
+  EXPECT_EQ(admission.get_cost("/get_info"), cryptonote::rpc_admission::default_cost_us);
+  admission.record("/get_info", microseconds{100});
+  EXPECT_EQ(admission.get_cost("/get_info"), 100);
+  admission.record("/get_info", microseconds{900});
+  EXPECT_EQ(admission.get_cost("/get_info"), 200);
+}
+
+TEST(rpc_admission, cheap_and_expensive)
+{
+  const auto now = cryptonote::rpc_admission::clock::now();
+  cryptonote::rpc_admission admission(milliseconds{100}, seconds{1});
+  admission.record("cheap", microseconds{100});
+  admission.record("expensive", microseconds{40000});
+
+  // a 100 ms bucket pays for two expensive calls, and then many cheap ones
+  EXPECT_TRUE(admission.admit("a", "expensive", now));
+  EXPECT_TRUE(admission.admit("a", "expensive", now));
+  EXPECT_FALSE(admission.admit("a", "expensive", now));
+  for (int i = 0; i < 200; ++i)
+    ASSERT_TRUE(admission.admit("a", "cheap", now));
+  EXPECT_FALSE(admission.admit("a", "cheap", now));
+  EXPECT_EQ(admission.get_rejected(), 2);
+
+  // other clients have their own bucket
+  EXPECT_TRUE(admission.admit("b", "expensive", now));
+
+  // and it refills at the budget rate
+  EXPECT_FALSE(admission.admit("a", "expensive", now + milliseconds{300}));
+  EXPECT_TRUE(admission.admit("a", "expensive", now + milliseconds{400}));
+}
+
+TEST(rpc_admission, slow_method_still_runs)
+{
+  const auto now = cryptonote::rpc_admission::clock::now();
+  cryptonote::rpc_admission admission(milliseconds{10}, seconds{1});
+  admission.record("slow", seconds{5});
+  EXPECT_TRUE(admission.admit("a", "slow", now));
+  EXPECT_FALSE(admission.admit("a", "slow", now + milliseconds{500}));
+  EXPECT_TRUE(admission.admit("a", "slow", now + seconds{1}));
+}
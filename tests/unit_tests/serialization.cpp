@@ -37,6 +37,7 @@
 #include <boost/archive/portable_binary_iarchive.hpp>
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "cryptonote_basic/supply_series.h"
 #include "ringct/rctSigs.h"
 #include "serialization/binary_archive.h"
 #include "serialization/json_archive.h"
@@ -1221,8 +1222,84 @@ TEST(Serialization, difficulty_type)
   ASSERT_EQ(v_original, v_unserialized);
 }
 
+TEST(Serialization, supply_series_entry)
+{
+  std::vector<cryptonote::supply_series_entry> blocks(3);
+  for (size_t n = 0; n < blocks.size(); ++n)
+  {
+    cryptonote::supply_series_entry &b = blocks[n];
+    b.first_height = b.last_height = 100 + n;
+    b.first_timestamp = b.last_timestamp = 1700000000 + 120 * n;
+    b.slippage_total = b.yield_total = 1000 * (n + 1);
+    b.burnt_total = 0;
+    b.staked_total = 7 * n;
+    b.audit_total = n;
+    b.locked_coins_tally = 50000 + n;
+    b.network_health_percentage = 100 - n;
+    b.assets.push_back({"SAL", 1000000 + n, 0, 0});
+    b.assets.push_back({"SAL1", 2000000 - n, 12345 + n, 12000 + n});
+  }
+
+  cryptonote::supply_series_entry bucket = blocks[0];
+  bucket.add_block(blocks[1]);
+  const cryptonote::supply_series_entry two_blocks = bucket;
+  bucket.add_block(blocks[2]);
+  ASSERT_EQ(bucket.first_height, 100);
+  ASSERT_EQ(bucket.last_height, 102);
+  ASSERT_EQ(bucket.slippage_total, 6000);
+  ASSERT_EQ(bucket.staked_total, 21);
+  ASSERT_EQ(bucket.locked_coins_tally, 50002);
+  ASSERT_EQ(bucket.assets[1].spot_price, 12347);
+
+  cryptonote::blobdata blob;
+  ASSERT_TRUE(serialization::dump_binary(bucket, blob));
+  cryptonote::supply_series_entry loaded;
+  ASSERT_TRUE(serialization::parse_binary(blob, loaded));
+  ASSERT_EQ(loaded.last_timestamp, bucket.last_timestamp);
+  ASSERT_EQ(loaded.network_health_percentage, bucket.network_health_percentage);
+  ASSERT_EQ(loaded.assets.size(), 2);
+  ASSERT_EQ(loaded.assets[1].asset_type, "SAL1");
+  ASSERT_EQ(loaded.assets[1].ma_price, 12002);
+
+  // popping the top block restores the bucket as it was before it was added
+  loaded.remove_block(blocks[2], blocks[1]);
+  ASSERT_EQ(cryptonote::t_serializable_object_to_blob(loaded), cryptonote::t_serializable_object_to_blob(two_blocks));
+}
+
 // TODO: seems like this is an outdated method of doing json serialization
 /*
+TEST(Serialization, tx_prefix_from_blob)
+{
+  using namespace cryptonote;
+
+  transaction tx;
+  tx.set_null();
+  tx.version = 1;
+  txin_to_key txin;
+  txin.amount = 7;
+  txin.key_offsets = {1, 300, 70000};
+  txin.k_image.data[0] = 42;
+  tx.vin.push_back(txin);
+  tx.vout.resize(2);
+  tx.extra = {1, 2, 3};
+  tx.signatures.resize(1);
+  tx.signatures[0].resize(txin.key_offsets.size());
+  tx.invalidate_hashes();
+
+  string blob;
+  ASSERT_TRUE(serialization::dump_binary(tx, blob));
+
+  transaction_prefix prefix;
+  crypto::hash prefix_hash;
+  ASSERT_TRUE(parse_and_validate_tx_prefix_from_blob(blob, prefix, prefix_hash));
+  ASSERT_EQ(prefix.vin.size(), 1);
+  ASSERT_EQ(boost::get<txin_to_key>(prefix.vin[0]).key_offsets, txin.key_offsets);
+  ASSERT_EQ(prefix.extra, tx.extra);
+  ASSERT_EQ(prefix_hash, get_transaction_prefix_hash(tx));
+
+  ASSERT_FALSE(parse_and_validate_tx_prefix_from_blob(blob.substr(0, 5), prefix, prefix_hash));
+}
+
 TEST(Serialization, adl_free_function)
 {
   std::stringstream ss;
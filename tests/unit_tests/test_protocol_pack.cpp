@@ -54,3 +54,39 @@ TEST(protocol_pack, protocol_pack_command)
     ASSERT_TRUE(r.total_height == 3);
   }
 }
+
+TEST(protocol_pack, response_get_objects_txs)
+{
+  for (const bool pruned: {false, true})
+  {
+    epee::byte_slice buff;
+    cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r;
+    r.current_blockchain_height = 10;
+    for (size_t n = 0; n < 4; ++n)
+    {
+      cryptonote::block_complete_entry bce;
+      bce.pruned = pruned;
+      bce.block = std::string(n + 1, 'b');
+      for (size_t i = 0; i < n; ++i)
+        bce.txs.push_back({std::string(i + 1, 't'), pruned ? crypto::hash{{(char)i}} : crypto::null_hash});
+      r.blocks.push_back(std::move(bce));
+    }
+    ASSERT_TRUE(epee::serialization::store_t_to_binary(r, buff));
+
+    cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r2;
+    ASSERT_TRUE(epee::serialization::load_t_from_binary(r2, epee::to_span(buff)));
+    ASSERT_EQ(r2.current_blockchain_height, 10);
+    ASSERT_EQ(r2.blocks.size(), r.blocks.size());
+    for (size_t n = 0; n < r.blocks.size(); ++n)
+    {
+      ASSERT_EQ(r2.blocks[n].pruned, pruned);
+      ASSERT_EQ(r2.blocks[n].block, r.blocks[n].block);
+      ASSERT_EQ(r2.blocks[n].txs.size(), r.blocks[n].txs.size());
+      for (size_t i = 0; i < r.blocks[n].txs.size(); ++i)
+      {
+        ASSERT_EQ(r2.blocks[n].txs[i].blob, r.blocks[n].txs[i].blob);
+        ASSERT_EQ(r2.blocks[n].txs[i].prunable_hash, r.blocks[n].txs[i].prunable_hash);
+      }
+    }
+  }
+}
@@ -135,6 +135,55 @@ TEST(parse_tx_extra, handles_pub_key_and_padding)
   ASSERT_EQ(typeid(cryptonote::tx_extra_padding), tx_extra_fields[1].type());
 }
 
+TEST(parse_tx_extra, view_matches_fields)
+{
+  std::vector<uint8_t> valid;
+  ASSERT_TRUE(cryptonote::add_tx_pub_key_to_extra(valid, crypto::rand<crypto::public_key>()));
+  std::string nonce;
+  cryptonote::set_encrypted_payment_id_to_tx_extra_nonce(nonce, crypto::rand<crypto::hash8>());
+  ASSERT_TRUE(cryptonote::add_extra_nonce_to_tx_extra(valid, nonce));
+  ASSERT_TRUE(cryptonote::add_additional_tx_pub_keys_to_extra(valid, {crypto::rand<crypto::public_key>(), crypto::rand<crypto::public_key>()}));
+  ASSERT_TRUE(cryptonote::add_mm_merkle_root_to_tx_extra(valid, crypto::rand<crypto::hash>(), 3));
+  ASSERT_TRUE(cryptonote::add_tx_pub_key_to_extra(valid, crypto::rand<crypto::public_key>()));
+  valid.insert(valid.end(), 10, 0);
+
+  // every truncation and a few corruptions, which parse_tx_extra() keeps the leading fields of
+  std::vector<std::vector<uint8_t>> extras;
+  for (size_t n = 0; n <= valid.size(); ++n)
+    extras.emplace_back(valid.begin(), valid.begin() + n);
+  for (const size_t i : {0, 33, 34, 45, 46, 47, 111})
+  {
+    extras.push_back(valid);
+    extras.back()[i] ^= 0xff;
+  }
+
+  for (const std::vector<uint8_t> &extra : extras)
+  {
+    std::vector<cryptonote::tx_extra_field> fields;
+    const bool complete = cryptonote::parse_tx_extra(extra, fields);
+    cryptonote::tx_extra_view view;
+    ASSERT_EQ(complete, cryptonote::parse_tx_extra_view(extra, view));
+    ASSERT_EQ(complete, view.complete);
+
+    size_t num_pub_keys = 0;
+    cryptonote::tx_extra_pub_key pub_key;
+    while (cryptonote::find_tx_extra_field_by_type(fields, pub_key, num_pub_keys))
+    {
+      ASSERT_EQ(pub_key.pub_key, *view.pub_keys[num_pub_keys]);
+      ++num_pub_keys;
+    }
+    ASSERT_EQ(num_pub_keys, view.num_pub_keys);
+
+    cryptonote::tx_extra_additional_pub_keys additional_pub_keys;
+    ASSERT_EQ(cryptonote::find_tx_extra_field_by_type(fields, additional_pub_keys), view.has_additional_pub_keys);
+    ASSERT_EQ(additional_pub_keys.data, std::vector<crypto::public_key>(view.additional_pub_keys.begin(), view.additional_pub_keys.end()));
+
+    cryptonote::tx_extra_nonce extra_nonce;
+    ASSERT_EQ(cryptonote::find_tx_extra_field_by_type(fields, extra_nonce), view.has_nonce);
+    ASSERT_EQ(extra_nonce.nonce, std::string(view.nonce.begin(), view.nonce.end()));
+  }
+}
+
 TEST(parse_and_validate_tx_extra, is_valid_tx_extra_parsed)
 {
   cryptonote::transaction tx = AUTO_VAL_INIT(tx);
@@ -357,3 +406,30 @@ TEST(remove_field_from_tx_extra, invalid_varint)
   ASSERT_FALSE(cryptonote::remove_field_from_tx_extra(extra, typeid(cryptonote::tx_extra_nonce)));
   ASSERT_EQ(sizeof(extra_arr), extra.size());
 }
+
+TEST(get_block_template_backlog_diff, changes)
+{
+  crypto::hash ids[4];
+  for (size_t i = 0; i < 4; ++i)
+    ids[i] = crypto::cn_fast_hash(&i, sizeof(i));
+
+  const std::vector<cryptonote::tx_block_template_backlog_entry> from{{ids[0], 1000, 10}, {ids[1], 2000, 20}, {ids[2], 3000, 30}};
+  const std::vector<cryptonote::tx_block_template_backlog_entry> to{{ids[3], 4000, 40}, {ids[2], 3000, 35}, {ids[0], 1000, 10}};
+
+  cryptonote::tx_block_template_backlog_diff diff;
+  cryptonote::get_block_template_backlog_diff(from, to, diff);
+  ASSERT_EQ(2, diff.changed.size());
+  ASSERT_EQ(ids[3], diff.changed[0].id);
+  ASSERT_EQ(ids[2], diff.changed[1].id);
+  ASSERT_EQ(35, diff.changed[1].fee);
+  ASSERT_EQ(1, diff.removed.size());
+  ASSERT_EQ(ids[1], diff.removed[0]);
+
+  cryptonote::get_block_template_backlog_diff(to, to, diff);
+  ASSERT_TRUE(diff.changed.empty());
+  ASSERT_TRUE(diff.removed.empty());
+
+  cryptonote::get_block_template_backlog_diff({}, to, diff);
+  ASSERT_EQ(to.size(), diff.changed.size());
+  ASSERT_TRUE(diff.removed.empty());
+}
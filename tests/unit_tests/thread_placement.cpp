@@ -0,0 +1,126 @@
+// Copyright (c) 2026, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <boost/thread/thread.hpp>
+#include "gtest/gtest.h"
+#include "thread_placement.h"
+
+namespace
+{
+  const epee::thread_placement::usage *find_group(const std::vector<epee::thread_placement::usage> &usage, const std::string &group)
+  {
+    for (const auto &u: usage)
+      if (u.group == group)
+        return &u;
+    return nullptr;
+  }
+}
+
+TEST(thread_placement, parse_cpu_list)
+{
+  std::vector<unsigned> cpus;
+  ASSERT_TRUE(epee::thread_placement::parse_cpu_list("3", cpus));
+  ASSERT_EQ(cpus, std::vector<unsigned>({3}));
+  ASSERT_TRUE(epee::thread_placement::parse_cpu_list("0-3,8,10-11", cpus));
+  ASSERT_EQ(cpus, std::vector<unsigned>({0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_TRUE(epee::thread_placement::parse_cpu_list("5,1-2,2", cpus));
+  ASSERT_EQ(cpus, std::vector<unsigned>({1, 2, 5}));
+
+  cpus = {7};
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list(",", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("1,", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("3-1", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("1-", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("-1", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("a", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("1 ", cpus));
+  ASSERT_FALSE(epee::thread_placement::parse_cpu_list("99999999", cpus));
+  ASSERT_EQ(cpus, std::vector<unsigned>({7}));
+}
+
+TEST(thread_placement, usage)
+{
+  const std::string group = "unit_test_usage";
+  ASSERT_EQ(find_group(epee::thread_placement::get_usage(), group), nullptr);
+
+  boost::thread thread([&group]() {
+    const epee::thread_placement::member member(group);
+    const std::vector<epee::thread_placement::usage> usage = epee::thread_placement::get_usage();
+    const epee::thread_placement::usage *u = find_group(usage, group);
+    ASSERT_NE(u, nullptr);
+    EXPECT_EQ(u->threads, 1);
+    // burn some CPU so there is something to account for
+    volatile uint64_t x = 0;
+    while (member.cpu_us() < 2000)
+      for (int i = 0; i < 100000; ++i)
+        x = x + i;
+  });
+  thread.join();
+
+  // the time of an exited thread is kept
+  const std::vector<epee::thread_placement::usage> usage = epee::thread_placement::get_usage();
+  const epee::thread_placement::usage *u = find_group(usage, group);
+  ASSERT_NE(u, nullptr);
+  EXPECT_EQ(u->threads, 0);
+#if defined(__linux__)
+  EXPECT_GE(u->cpu_us, 2000);
+#endif
+}
+
+#if defined(__linux__)
+TEST(thread_placement, policy)
+{
+  const std::string group = "unit_test_policy";
+  epee::thread_placement::policy p;
+  p.cpus = {0};
+  p.nice = 5;
+  p.batch = true;
+  epee::thread_placement::set_policy(group, p);
+
+  boost::thread thread([&group]() {
+    const int nice_before = getpriority(PRIO_PROCESS, syscall(SYS_gettid));
+    const epee::thread_placement::member member(group);
+    cpu_set_t cpuset;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(cpuset), &cpuset), 0);
+    EXPECT_EQ(CPU_COUNT(&cpuset), 1);
+    EXPECT_TRUE(CPU_ISSET(0, &cpuset));
+    EXPECT_EQ(sched_getscheduler(0), SCHED_BATCH);
+    // lowering a nice level takes privileges, raising it does not
+    if (nice_before <= 5)
+      EXPECT_EQ(getpriority(PRIO_PROCESS, syscall(SYS_gettid)), 5);
+  });
+  thread.join();
+}
+#endif
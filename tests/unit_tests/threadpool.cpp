@@ -145,3 +145,36 @@ TEST(threadpool, leaf_reentrancy)
   waiter.wait();
   ASSERT_EQ(counter, 500000);
 }
+
+TEST(threadpool, parallel_for)
+{
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(4));
+
+  std::vector<std::atomic<int>> hits(10007);
+  for (auto &h: hits)
+    h = 0;
+  ASSERT_TRUE(tpool->parallel_for(0, hits.size(), [&](size_t i){ ++hits[i]; }, 64));
+  for (const auto &h: hits)
+    ASSERT_EQ(h, 1);
+
+  ASSERT_TRUE(tpool->parallel_for(5, 5, [&](size_t i){ ++hits[i]; }));
+  ASSERT_EQ(hits[5], 1);
+}
+
+TEST(threadpool, error_reported)
+{
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(4));
+  tools::threadpool::waiter waiter(*tpool);
+
+  std::atomic<unsigned int> counter(0);
+  for (size_t n = 0; n < 64; ++n)
+  {
+    tpool->submit(&waiter, [&counter, n](){
+      if (n == 17)
+        throw std::runtime_error("expected");
+      ++counter;
+    }, true);
+  }
+  ASSERT_FALSE(waiter.wait());
+  ASSERT_EQ(counter, 63);
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <boost/thread/thread.hpp>
+#include "common/trace.h"
+
+namespace
+{
+  size_t count(const std::string &haystack, const std::string &needle)
+  {
+    size_t n = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1))
+      ++n;
+    return n;
+  }
+}
+
+TEST(trace, disabled)
+{
+  tools::trace::enable(false);
+  tools::trace::clear();
+  {
+    TRACE_SPAN("test_disabled");
+  }
+  EXPECT_EQ(count(tools::trace::render(), "test_disabled"), 0);
+}
+
+TEST(trace, spans)
+{
+  tools::trace::clear();
+  tools::trace::enable(true);
+  {
+    TRACE_SPAN("test_outer");
+    TRACE_SPAN("test_inner");
+  }
+  boost::thread t([]() { TRACE_SPAN("test_thread"); });
+  t.join();
+  {
+    tools::trace::span span(nullptr);
+  }
+  tools::trace::enable(false);
+
+  const std::string text = tools::trace::render();
+  EXPECT_EQ(text.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0);
+  EXPECT_EQ(count(text, "{\"name\":\"test_outer\",\"ph\":\"X\",\"pid\":1,\"tid\":"), 1);
+  EXPECT_EQ(count(text, "{\"name\":\"test_inner\",\"ph\":\"X\""), 1);
+  EXPECT_EQ(count(text, "{\"name\":\"test_thread\",\"ph\":\"X\""), 1);
+  EXPECT_EQ(count(text, "\"ph\":\"X\""), 3);
+
+  // the exited thread's spans went out with that export
+  EXPECT_EQ(count(tools::trace::render(), "test_thread"), 0);
+  tools::trace::clear();
+  EXPECT_EQ(count(tools::trace::render(), "\"ph\":\"X\""), 0);
+}
+
+TEST(trace, ring)
+{
+  tools::trace::clear();
+  tools::trace::enable(true);
+  for (int i = 0; i < 5000; ++i)
+  {
+    TRACE_SPAN(i == 0 ? "test_first" : i == 4999 ? "test_last" : "test_middle");
+  }
+  tools::trace::enable(false);
+
+  const std::string text = tools::trace::render();
+  EXPECT_EQ(count(text, "test_first"), 0);
+  EXPECT_EQ(count(text, "test_last"), 1);
+  EXPECT_EQ(count(text, "\"ph\":\"X\""), 4096);
+  EXPECT_GT(text.find("test_last"), text.rfind("test_middle"));
+  tools::trace::clear();
+}
+
+TEST(trace, intern)
+{
+  const char *name = tools::trace::intern("test \"quoted\"\n");
+  EXPECT_EQ(name, tools::trace::intern(std::string("test \"quoted\"\n")));
+  EXPECT_STREQ(name, "test \"quoted\"\n");
+
+  tools::trace::clear();
+  tools::trace::enable(true);
+  {
+    TRACE_SPAN(name);
+  }
+  tools::trace::enable(false);
+  EXPECT_EQ(count(tools::trace::render(), "{\"name\":\"test \\\"quoted\\\"\\u000a\""), 1);
+  tools::trace::clear();
+}
@@ -62,3 +62,55 @@ TEST(varint, equal)
     ASSERT_TRUE(idx2 == idx);
   }
 }
+
+TEST(varint, array)
+{
+  std::vector<uint64_t> values;
+  for (uint64_t idx = 0; idx < 65537; idx += 7)
+    values.push_back(idx);
+  for (int bits = 0; bits < 64; ++bits)
+  {
+    values.push_back(uint64_t(1) << bits);
+    values.push_back((uint64_t(1) << bits) - 1);
+  }
+  values.push_back(std::numeric_limits<uint64_t>::max());
+  for (size_t n = 0; n < 1000; ++n)
+    values.push_back(crypto::rand<uint64_t>() >> (crypto::rand<uint8_t>() % 64));
+
+  std::string blob;
+  for (const uint64_t v: values)
+    tools::write_varint(std::back_inserter(blob), v);
+
+  std::vector<uint64_t> decoded(values.size());
+  const uint8_t *first = reinterpret_cast<const uint8_t*>(blob.data());
+  const uint8_t *last = first + blob.size();
+  ASSERT_TRUE(tools::read_varint_array(first, last, decoded.data(), decoded.size()));
+  ASSERT_EQ(first, last);
+  ASSERT_EQ(decoded, values);
+
+  // a non canonical encoding is refused like read_varint does, on both paths
+  for (size_t padding: {0, 8})
+  {
+    std::string bad("\x81\x80\x00", 3);
+    bad.append(padding, '\0');
+    uint64_t v;
+    first = reinterpret_cast<const uint8_t*>(bad.data());
+    ASSERT_FALSE(tools::read_varint_array(first, first + bad.size(), &v, 1));
+  }
+}
+
+TEST(varint, serialize_vector)
+{
+  std::vector<uint64_t> values, loaded;
+  for (uint64_t v = 1; v != 0; v <<= 3)
+    values.push_back(v + 0x55);
+  std::string blob;
+  ASSERT_TRUE(serialization::dump_binary(values, blob));
+  ASSERT_TRUE(serialization::parse_binary(blob, loaded));
+  ASSERT_EQ(loaded, values);
+
+  // a non canonical element must not parse
+  blob.insert(2, std::string("\x80\x00", 2));
+  blob[0] += 1;
+  ASSERT_FALSE(serialization::parse_binary(blob, loaded));
+}
@@ -428,3 +428,37 @@ TEST(verRctNonSemanticsSimple, expand_transaction_2_failures)
     EXPAND_TRANSACTION_2_FAILURES_SUBTEST(rct_signatures.mixRing[0][15].dest[31]++)
     EXPAND_TRANSACTION_2_FAILURES_SUBTEST(rct_signatures.mixRing[0][15].mask[31]++)
 }
+
+TEST(verRctNonSemanticsSimple, rct_ver_cache_eviction_and_stats)
+{
+    // 16 shards of one entry each
+    cryptonote::rct_ver_cache_t cache(16);
+
+    // all of these land in the same shard, so the older ones get evicted
+    std::vector<crypto::hash> hashes(3, crypto::null_hash);
+    for (size_t i = 0; i < hashes.size(); ++i)
+        hashes[i].data[1] = i + 1;
+
+    cache.add(hashes[0]);
+    EXPECT_TRUE(cache.has(hashes[0]));
+    cache.add(hashes[0]);
+    cache.add(hashes[1]);
+    EXPECT_FALSE(cache.has(hashes[0]));
+    EXPECT_TRUE(cache.has(hashes[1]));
+    cache.add(hashes[2]);
+    EXPECT_FALSE(cache.has(hashes[1]));
+    EXPECT_TRUE(cache.has(hashes[2]));
+
+    cryptonote::rct_ver_cache_t::stats_t stats = cache.get_stats();
+    EXPECT_EQ(3, stats.hits);
+    EXPECT_EQ(2, stats.misses);
+    EXPECT_EQ(2, stats.evictions);
+    EXPECT_EQ(1, stats.size);
+    EXPECT_EQ(16, stats.capacity);
+
+    cache.set_capacity(cryptonote::RCT_VER_CACHE_SIZE);
+    EXPECT_FALSE(cache.has(hashes[2]));
+    stats = cache.get_stats();
+    EXPECT_EQ(0, stats.size);
+    EXPECT_EQ(cryptonote::RCT_VER_CACHE_SIZE, stats.capacity);
+}
@@ -31,9 +31,11 @@
 #include "carrot_impl/address_device_ram_borrowed.h"
 #include "carrot_mock_helpers.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
 // #include "fake_pruned_blockchain.h"
 // #include "fcmp_pp/prove.h"
 #include "tx_construction_helpers.h"
+#include "wallet/scanning_tools.h"
 #include "wallet/tx_builder.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -256,6 +258,126 @@ TEST(wallet_scanning, view_scan_short_payment_id)
     }
 }
 //----------------------------------------------------------------------------------------------------------------------
+TEST(wallet_scanning, tx_scan_record_view_tag_filter)
+{
+  carrot::carrot_and_legacy_account aether;
+  aether.generate();
+
+  carrot::carrot_and_legacy_account bob;
+  bob.generate();
+    const cryptonote::account_public_address bob_main_addr = bob.get_keys().m_account_address;
+
+    const rct::xmr_amount amount = rct::randXmrAmount(10 * COIN);
+
+    const rct::xmr_amount fee = 565678;
+
+    for (uint8_t hf_version = 1; hf_version < HF_VERSION_CARROT; ++hf_version)
+    {
+        MDEBUG("tx_scan_record_view_tag_filter: hf_version=" << static_cast<int>(hf_version));
+
+        std::vector<cryptonote::tx_destination_entry> destinations{
+            cryptonote::tx_destination_entry(amount, bob_main_addr, false)};
+
+        crypto::secret_key main_tx_privkey;
+        std::vector<crypto::secret_key> additional_tx_privkeys;
+        const cryptonote::transaction tx = mock::construct_pre_carrot_tx_with_fake_inputs(aether.get_keys(),
+            {{aether.get_keys().m_account_address.m_spend_public_key, {0, 0}}},
+            {},
+            destinations,
+            {},
+            crypto::null_hash,
+            fee,
+            hf_version,
+            main_tx_privkey,
+            additional_tx_privkeys);
+
+        cryptonote::tx_scan_record record;
+        ASSERT_TRUE(cryptonote::get_tx_scan_record(tx, cryptonote::get_transaction_hash(tx), record));
+        ASSERT_EQ(tx.vout.size(), record.outputs.size());
+        ASSERT_EQ(1, record.tx_pub_keys.size());
+
+        // the record must survive the trip through the RPC blob
+        cryptonote::tx_scan_record parsed_record;
+        ASSERT_TRUE(cryptonote::t_serializable_object_from_blob(parsed_record,
+            cryptonote::t_serializable_object_to_blob(record)));
+        ASSERT_EQ(record.tx_hash, parsed_record.tx_hash);
+        ASSERT_EQ(record.first_key_image, parsed_record.first_key_image);
+        ASSERT_EQ(record.outputs.size(), parsed_record.outputs.size());
+
+        // the receiver must never be filtered out
+        ASSERT_TRUE(tools::wallet::tx_scan_record_may_have_owned_enotes(parsed_record, bob, hw::get_device("default")));
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+TEST(wallet_scanning, view_scan_protocol_tx_known_payouts)
+{
+  carrot::carrot_and_legacy_account bob;
+  bob.generate();
+  const cryptonote::account_public_address bob_main_addr = bob.get_keys().m_account_address;
+
+  // a yield payout to bob amongst payouts to others
+  std::vector<cryptonote::protocol_data_entry> entries(3);
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    cryptonote::protocol_data_entry &entry = entries[i];
+    const cryptonote::keypair r = cryptonote::keypair::generate(hw::get_device("default"));
+    entry.return_pubkey = r.pub;
+    entry.amount_burnt = 1000 + i;
+    entry.amount_minted = 0;
+    entry.amount_slippage_limit = 0;
+    entry.source_asset = "SAL";
+    entry.destination_asset = "SAL";
+    entry.type = cryptonote::transaction_type::STAKE;
+    entry.origin_height = 0;
+    entry.is_carrot = false;
+    if (i == 1)
+    {
+      // payouts use output index 0 whatever their place in the protocol_tx
+      crypto::key_derivation derivation;
+      ASSERT_TRUE(crypto::generate_key_derivation(bob_main_addr.m_view_public_key, r.sec, derivation));
+      ASSERT_TRUE(crypto::derive_public_key(derivation, 0, bob_main_addr.m_spend_public_key, entry.return_address));
+    }
+    else
+    {
+      entry.return_address = cryptonote::keypair::generate(hw::get_device("default")).pub;
+    }
+  }
+
+  cryptonote::transaction tx;
+  ASSERT_TRUE(cryptonote::construct_protocol_tx(100, tx, entries, HF_VERSION_CARROT - 1));
+  ASSERT_EQ(entries.size(), tx.vout.size());
+
+  std::vector<std::optional<tools::wallet::enote_view_incoming_scan_info_t>> enote_scan_infos(tx.vout.size());
+
+  // no pending payout: nothing is scanned
+  ASSERT_EQ(0, tools::wallet::view_incoming_scan_protocol_transaction(tx, {}, bob, epee::to_mut_span(enote_scan_infos)));
+  for (const auto &enote_scan_info : enote_scan_infos)
+    ASSERT_FALSE(enote_scan_info);
+
+  // a known return address that isn't ours
+  ASSERT_EQ(0, tools::wallet::view_incoming_scan_protocol_transaction(tx, {entries[0].return_address}, bob,
+    epee::to_mut_span(enote_scan_infos)));
+  for (const auto &enote_scan_info : enote_scan_infos)
+    ASSERT_FALSE(enote_scan_info);
+
+  // bob's payout is found, and agrees with a full scan
+  ASSERT_EQ(1, tools::wallet::view_incoming_scan_protocol_transaction(tx,
+    {entries[0].return_address, entries[1].return_address}, bob, epee::to_mut_span(enote_scan_infos)));
+  ASSERT_FALSE(enote_scan_infos[0]);
+  ASSERT_TRUE(enote_scan_infos[1]);
+  ASSERT_FALSE(enote_scan_infos[2]);
+  ASSERT_EQ(entries[1].amount_burnt, enote_scan_infos[1]->amount);
+  ASSERT_EQ(bob_main_addr.m_spend_public_key, enote_scan_infos[1]->address_spend_pubkey);
+
+  const auto full_enote_scan_infos = tools::wallet::view_incoming_scan_transaction(tx, bob);
+  ASSERT_EQ(tx.vout.size(), full_enote_scan_infos.size());
+  ASSERT_FALSE(full_enote_scan_infos[0]);
+  ASSERT_TRUE(full_enote_scan_infos[1]);
+  ASSERT_FALSE(full_enote_scan_infos[2]);
+  ASSERT_EQ(full_enote_scan_infos[1]->amount, enote_scan_infos[1]->amount);
+  ASSERT_EQ(full_enote_scan_infos[1]->address_spend_pubkey, enote_scan_infos[1]->address_spend_pubkey);
+}
+//----------------------------------------------------------------------------------------------------------------------
 // TEST(wallet_scanning, positive_smallout_main_addr_all_types_outputs)
 // {
 //     // Test that wallet can scan and recover enotes of following type:
@@ -296,8 +418,7 @@ TEST(wallet_scanning, view_scan_short_payment_id)
 //         std::vector<tools::wallet2::parsed_block> parsed_blocks;
 //         bc.get_blocks_data(0, bc.height()-1, block_entries, parsed_blocks); //! @TODO: figure out why starting from refresh_height doesn't work
 //         uint64_t blocks_added{};
-//         auto output_tracker_cache = w.create_output_tracker_cache();
-//         w.process_parsed_blocks(0, block_entries, parsed_blocks, blocks_added, output_tracker_cache);
+//         w.process_parsed_blocks(0, block_entries, parsed_blocks, blocks_added);
 
 //         // update refresh_height
 //         refresh_height = bc.height();
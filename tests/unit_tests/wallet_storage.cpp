@@ -30,9 +30,12 @@
 #include "gtest/gtest.h"
 
 #include <cctype>
+#include <random>
 
 #include "file_io_utils.h"
+#include "wallet/cache_delta.h"
 #include "wallet/wallet2.h"
+#include "serialization/binary_utils.h"
 #include "common/util.h"
 
 using namespace boost::filesystem;
@@ -382,3 +385,76 @@ TEST(wallet_storage, change_export_format)
 
     EXPECT_EQ(primary_address_1, primary_address_2);
 }
+
+TEST(wallet_storage, cache_delta_round_trip)
+{
+    std::mt19937_64 rng(42);
+    std::string checkpoint(1024 * 1024, '\0');
+    for (char &c : checkpoint)
+        c = static_cast<char>(rng());
+
+    // overwrite a few bytes in the middle and insert some at the front
+    std::string cache = checkpoint;
+    cache[cache.size() / 2] ^= 0x5a;
+    cache.insert(0, "new transfer details");
+
+    const tools::wallet::cache_chunk_index index = tools::wallet::make_cache_chunk_index(checkpoint);
+    tools::wallet::cache_delta delta = tools::wallet::make_cache_delta(index, cache);
+    EXPECT_LT(tools::wallet::get_cache_delta_literal_size(delta), cache.size() / 16);
+
+    // serialized deltas apply the same way
+    std::string delta_blob;
+    ASSERT_TRUE(::serialization::dump_binary(delta, delta_blob));
+    tools::wallet::cache_delta parsed_delta;
+    ASSERT_TRUE(::serialization::parse_binary(delta_blob, parsed_delta));
+
+    std::string rebuilt;
+    ASSERT_TRUE(tools::wallet::apply_cache_delta(checkpoint, parsed_delta, rebuilt));
+    EXPECT_EQ(cache, rebuilt);
+
+    // a delta made against another checkpoint is rejected
+    std::string other_checkpoint = checkpoint;
+    other_checkpoint[10] ^= 0x01;
+    EXPECT_FALSE(tools::wallet::apply_cache_delta(other_checkpoint, parsed_delta, rebuilt));
+    EXPECT_FALSE(tools::wallet::apply_cache_delta(checkpoint.substr(0, 1000), parsed_delta, rebuilt));
+}
+
+TEST(wallet_storage, lazy_history_section)
+{
+    const path target_wallet_file = unit_test::data_dir / "wallet_lazy_history";
+
+    if (is_file_exist(target_wallet_file.string()))
+        remove(target_wallet_file);
+    if (is_file_exist(target_wallet_file.string() + ".keys"))
+        remove(target_wallet_file.string() + ".keys");
+
+    epee::wipeable_string password("beepbeep");
+    const crypto::hash txid = crypto::cn_fast_hash("txid", 4);
+    cryptonote::account_public_address address;
+
+    {
+        tools::wallet2 w;
+        w.generate("", password);
+        address = w.get_address();
+        w.set_tx_note(txid, "a note");
+        ASSERT_TRUE(w.add_address_book_row(address, nullptr, "myself", false, false));
+        w.store_to(target_wallet_file.string(), password);
+    }
+
+    // stored again without touching the history, which is then written back as it was read
+    {
+        tools::wallet2 w;
+        w.load(target_wallet_file.string(), password);
+        w.store();
+    }
+
+    {
+        tools::wallet2 w;
+        w.load(target_wallet_file.string(), password);
+        EXPECT_EQ("a note", w.get_tx_note(txid));
+        const std::vector<tools::wallet2::address_book_row> address_book = w.get_address_book();
+        ASSERT_EQ(1, address_book.size());
+        EXPECT_EQ(address, address_book[0].m_address);
+        EXPECT_EQ("myself", address_book[0].m_description);
+    }
+}
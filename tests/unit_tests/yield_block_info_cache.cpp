@@ -0,0 +1,162 @@
+// Copyright (c) 2025, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+#include "cryptonote_core/yield_block_info_cache.h"
+
+namespace
+{
+  cryptonote::yield_block_info make_ybi(uint64_t height, uint64_t slippage = 0, uint64_t tally = 0)
+  {
+    cryptonote::yield_block_info ybi{};
+    ybi.block_height = height;
+    ybi.slippage_total_this_block = slippage;
+    ybi.locked_coins_tally = tally;
+    return ybi;
+  }
+}
+
+TEST(yield_block_info_cache, empty)
+{
+  cryptonote::yield_block_info_cache cache(4);
+  ASSERT_TRUE(cache.empty());
+  ASSERT_EQ(cache.capacity(), 4);
+  ASSERT_FALSE(cache.contains(0));
+  ASSERT_EQ(cache.get(0), nullptr);
+  ASSERT_TRUE(cache.get_range(0, 10).empty());
+  ASSERT_FALSE(cache.pop_back());
+}
+
+TEST(yield_block_info_cache, zero_capacity)
+{
+  cryptonote::yield_block_info_cache cache;
+  ASSERT_FALSE(cache.push_back(make_ybi(0)));
+  ASSERT_TRUE(cache.empty());
+}
+
+TEST(yield_block_info_cache, contiguous_heights)
+{
+  cryptonote::yield_block_info_cache cache(4);
+  ASSERT_TRUE(cache.push_back(make_ybi(10)));
+  ASSERT_FALSE(cache.push_back(make_ybi(12)));
+  ASSERT_FALSE(cache.push_back(make_ybi(10)));
+  ASSERT_TRUE(cache.push_back(make_ybi(11)));
+  ASSERT_EQ(cache.start_height(), 10);
+  ASSERT_EQ(cache.end_height(), 12);
+}
+
+TEST(yield_block_info_cache, eviction_and_wraparound)
+{
+  cryptonote::yield_block_info_cache cache(4);
+  for (uint64_t h = 0; h < 11; ++h)
+    ASSERT_TRUE(cache.push_back(make_ybi(h)));
+  ASSERT_EQ(cache.size(), 4);
+  ASSERT_EQ(cache.start_height(), 7);
+  ASSERT_EQ(cache.end_height(), 11);
+  ASSERT_FALSE(cache.contains(6));
+  for (uint64_t h = 7; h < 11; ++h)
+  {
+    ASSERT_NE(cache.get(h), nullptr);
+    ASSERT_EQ(cache.get(h)->block_height, h);
+  }
+
+  // ranges are contiguous across the wrap point, and clamped to the cached heights
+  const epee::span<const cryptonote::yield_block_info> range = cache.get_range(0, 100);
+  ASSERT_EQ(range.size(), 4);
+  for (size_t i = 0; i < range.size(); ++i)
+    ASSERT_EQ(range[i].block_height, 7 + i);
+  ASSERT_EQ(cache.get_range(8, 10).size(), 2);
+  ASSERT_EQ(cache.get_range(8, 10)[0].block_height, 8);
+  ASSERT_TRUE(cache.get_range(10, 8).empty());
+}
+
+TEST(yield_block_info_cache, pop_back)
+{
+  cryptonote::yield_block_info_cache cache(4);
+  for (uint64_t h = 0; h < 6; ++h)
+    ASSERT_TRUE(cache.push_back(make_ybi(h)));
+  ASSERT_TRUE(cache.pop_back());
+  ASSERT_TRUE(cache.pop_back());
+  ASSERT_EQ(cache.start_height(), 2);
+  ASSERT_EQ(cache.end_height(), 4);
+  ASSERT_FALSE(cache.contains(4));
+
+  // replacement entries for the popped heights are stored in place
+  ASSERT_TRUE(cache.push_back(make_ybi(4, 5, 6)));
+  ASSERT_EQ(cache.get(4)->slippage_total_this_block, 5);
+  ASSERT_EQ(cache.get_range(2, 5).size(), 3);
+  ASSERT_EQ(cache.get_range(2, 5)[2].slippage_total_this_block, 5);
+}
+
+TEST(yield_block_info_cache, push_front)
+{
+  cryptonote::yield_block_info_cache cache(4);
+  ASSERT_TRUE(cache.push_front(make_ybi(5, 1, 1)));
+  ASSERT_FALSE(cache.push_front(make_ybi(3)));
+  ASSERT_TRUE(cache.push_front(make_ybi(4)));
+  ASSERT_TRUE(cache.push_front(make_ybi(3, 1, 1)));
+  ASSERT_TRUE(cache.push_back(make_ybi(6)));
+  ASSERT_FALSE(cache.push_front(make_ybi(2)));
+  ASSERT_EQ(cache.start_height(), 3);
+  ASSERT_EQ(cache.end_height(), 7);
+  const epee::span<const cryptonote::yield_block_info> range = cache.get_range(3, 7);
+  ASSERT_EQ(range.size(), 4);
+  for (size_t i = 0; i < range.size(); ++i)
+    ASSERT_EQ(range[i].block_height, 3 + i);
+  ASSERT_EQ(cache.get_accrual_heights().size(), 2);
+  ASSERT_EQ(cache.get_accrual_heights().front(), 3);
+  ASSERT_EQ(cache.get_accrual_heights().back(), 5);
+
+  // prepending below height 0 is not possible
+  cryptonote::yield_block_info_cache low(2);
+  ASSERT_TRUE(low.push_back(make_ybi(0)));
+  ASSERT_FALSE(low.push_front(make_ybi(0)));
+}
+
+TEST(yield_block_info_cache, accrual_heights)
+{
+  cryptonote::yield_block_info_cache cache(3);
+  ASSERT_TRUE(cache.push_back(make_ybi(0, 1, 1)));
+  ASSERT_TRUE(cache.push_back(make_ybi(1, 0, 1)));
+  ASSERT_TRUE(cache.push_back(make_ybi(2, 1, 0)));
+  ASSERT_TRUE(cache.push_back(make_ybi(3, 2, 2)));
+  const std::deque<uint64_t> &accrual = cache.get_accrual_heights();
+  ASSERT_EQ(accrual.size(), 1);
+  ASSERT_EQ(accrual.front(), 3);
+
+  ASSERT_TRUE(cache.pop_back());
+  ASSERT_TRUE(cache.get_accrual_heights().empty());
+  ASSERT_TRUE(cache.push_back(make_ybi(3, 4, 4)));
+  ASSERT_TRUE(cache.push_back(make_ybi(4, 4, 4)));
+  ASSERT_EQ(cache.get_accrual_heights().size(), 2);
+
+  cache.clear();
+  ASSERT_TRUE(cache.empty());
+  ASSERT_TRUE(cache.get_accrual_heights().empty());
+}
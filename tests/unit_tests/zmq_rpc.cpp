@@ -31,16 +31,19 @@
 #include <gtest/gtest.h>
 #include <rapidjson/document.h>
 
+#include "common/varint.h"
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/events.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/verification_context.h"
 #include "json_serialization.h"
 #include "net/zmq.h"
 #include "rpc/message.h"
 #include "rpc/zmq_pub.h"
 #include "rpc/zmq_server.h"
 #include "serialization/json_object.h"
+#include "string_tools.h"
 
 #define MASSERT(...)                                                      \
   if (!(__VA_ARGS__))                                                     \
@@ -706,8 +709,7 @@ TEST_F(zmq_pub, JsonAll)
   {
     const std::array<cryptonote::block, 1> blocks{{make_block()}};
 
-    EXPECT_EQ(2u, pub->send_chain_main(100, epee::to_span(blocks)));
-    EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+    EXPECT_EQ(1u, pub->send_chain_main(100, epee::to_span(blocks)));
     EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
 
     auto pubs = get_published(dummy_client.get());
@@ -718,7 +720,6 @@ TEST_F(zmq_pub, JsonAll)
 
     EXPECT_NO_THROW(cryptonote::listener::zmq_pub::chain_main{pub}(533, epee::to_span(blocks)));
     EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
-    EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
 
     pubs = get_published(dummy_client.get());
     EXPECT_EQ(2u, pubs.size());
@@ -728,6 +729,83 @@ TEST_F(zmq_pub, JsonAll)
   }
 }
 
+TEST_F(zmq_pub, BinFullChain)
+{
+  static constexpr const char topic[] = "\1bin-full-chain_main";
+  static constexpr const char header[] = "bin-full-chain_main:";
+
+  ASSERT_TRUE(sub_request(topic));
+
+  const std::array<cryptonote::block, 2> blocks{{make_block(), make_block()}};
+
+  EXPECT_EQ(1u, pub->send_chain_main(100, epee::to_span(blocks)));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+
+  const auto messages = get_messages(dummy_client.get());
+  ASSERT_EQ(1u, messages.size());
+  ASSERT_EQ(0u, messages.front().find(header));
+
+  std::string::const_iterator next = messages.front().begin() + sizeof(header) - 1;
+  std::string::const_iterator end = messages.front().end();
+
+  std::uint64_t height = 0;
+  std::uint64_t count = 0;
+  ASSERT_LT(0, tools::read_varint(next, end, height));
+  ASSERT_LT(0, tools::read_varint(next, end, count));
+  EXPECT_EQ(100u, height);
+  ASSERT_EQ(blocks.size(), count);
+
+  for (const cryptonote::block& expected : blocks)
+  {
+    std::uint64_t size = 0;
+    ASSERT_LT(0, tools::read_varint(next, end, size));
+    ASSERT_LE(size, std::uint64_t(end - next));
+
+    cryptonote::block actual{};
+    ASSERT_TRUE(cryptonote::parse_and_validate_block_from_blob({std::addressof(*next), std::size_t(size)}, actual));
+    EXPECT_EQ(cryptonote::get_block_hash(expected), cryptonote::get_block_hash(actual));
+    next += size;
+  }
+  EXPECT_TRUE(next == end);
+}
+
+TEST_F(zmq_pub, JsonFullBlockStats)
+{
+  static constexpr const char topic[] = "\1json-full-block_stats";
+
+  EXPECT_EQ(0u, pub->send_block_stats({}));
+  ASSERT_TRUE(sub_request(topic));
+
+  cryptonote::block_processing_stats stats{};
+  stats.height = 100;
+  stats.id = cryptonote::get_block_hash(make_block());
+  stats.n_txs = 3;
+  stats.pow_us = 1500;
+  stats.payouts_us = 20;
+  stats.ybi_us = 7;
+  stats.total_us = 4000;
+
+  EXPECT_EQ(1u, pub->send_block_stats(stats));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+
+  auto pubs = get_published(dummy_client.get());
+  ASSERT_EQ(1u, pubs.size());
+  EXPECT_EQ("json-full-block_stats", pubs.front().first);
+  const rapidjson::Document& doc = pubs.front().second;
+  ASSERT_TRUE(doc.IsObject());
+  EXPECT_EQ(100u, doc["height"].GetUint64());
+  EXPECT_EQ(epee::string_tools::pod_to_hex(stats.id), doc["id"].GetString());
+  EXPECT_EQ(3u, doc["n_txs"].GetUint64());
+  EXPECT_EQ(1500u, doc["pow_us"].GetUint64());
+  EXPECT_EQ(20u, doc["payouts_us"].GetUint64());
+  EXPECT_EQ(7u, doc["ybi_us"].GetUint64());
+  EXPECT_EQ(4000u, doc["total_us"].GetUint64());
+
+  EXPECT_NO_THROW(cryptonote::listener::zmq_pub::block_stats{pub}(stats));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+  EXPECT_EQ(1u, get_published(dummy_client.get()).size());
+}
+
 TEST_F(zmq_pub, JsonChainWeakPtrSkip)
 {
   static constexpr const char topic[] = "\1json";
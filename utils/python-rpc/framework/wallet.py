@@ -80,6 +80,26 @@ class Wallet(object):
         }
         return self.rpc.send_json_rpc_request(transfer)   
 
+    def transfer_batch(self, destinations, account_index = 0, subaddr_indices = [], priority = 0, ring_size = 0, unlock_time = 0, get_tx_keys = True, do_not_relay = False, get_tx_hex = False, get_tx_metadata = False):
+        transfer_batch = {
+            "method": "transfer_batch",
+            "params": {
+                'destinations': destinations,
+                'account_index': account_index,
+                'subaddr_indices': subaddr_indices,
+                'priority': priority,
+                'ring_size' : ring_size,
+                'unlock_time' : unlock_time,
+                'get_tx_keys' : get_tx_keys,
+                'do_not_relay' : do_not_relay,
+                'get_tx_hex' : get_tx_hex,
+                'get_tx_metadata' : get_tx_metadata,
+            },
+            "jsonrpc": "2.0",
+            "id": "0"
+        }
+        return self.rpc.send_json_rpc_request(transfer_batch)
+
     def get_transfer_by_txid(self, txid, account_index = 0):
         get_transfer_by_txid = {
             'method': 'get_transfer_by_txid',